@@ -208,6 +208,29 @@ typedef struct _CONSOLE_GETDISPLAYMODE_MSG {
     OUT ULONG ModeFlags;
 } CONSOLE_GETDISPLAYMODE_MSG, *PCONSOLE_GETDISPLAYMODE_MSG;
 
+//
+// Undocumented, for diagnosing memory use. Each call gets one of these.
+//
+
+typedef enum _CONSOLE_MEMORY_SUBSYSTEM {
+    ConsoleMemoryTextBufferCells,
+    ConsoleMemoryTextBufferRows,
+    ConsoleMemoryAttributeRuns,
+    ConsoleMemoryUnicodeStorage,
+    ConsoleMemoryAttributePalettes,
+    ConsoleMemoryTextBufferOther,
+    ConsoleMemoryInputBuffer,
+    ConsoleMemoryCommandHistories,
+    ConsoleMemoryRenderCaches,
+    ConsoleMemorySubsystemCount
+} CONSOLE_MEMORY_SUBSYSTEM, *PCONSOLE_MEMORY_SUBSYSTEM;
+
+typedef struct _CONSOLE_GETMEMORYUSAGE_MSG {
+    IN ULONG Subsystem;
+    OUT ULONG64 Bytes;
+    OUT ULONG64 Allocations;
+} CONSOLE_GETMEMORYUSAGE_MSG, *PCONSOLE_GETMEMORYUSAGE_MSG;
+
 typedef struct _CONSOLE_GETKEYBOARDLAYOUTNAME_MSG {
     union {
         WCHAR awchLayout[9];
@@ -317,6 +340,7 @@ typedef enum _CONSOLE_API_NUMBER_L3 {
     ConsolepGetHistory,
     ConsolepSetHistory,
     ConsolepSetCurrentFont,
+    ConsolepGetMemoryUsage,
 } CONSOLE_API_NUMBER_L3, *PCONSOLE_API_NUMBER_L3;
 
 typedef union _CONSOLE_MSG_BODY_L3 {
@@ -374,6 +398,7 @@ typedef union _CONSOLE_MSG_BODY_L3 {
     CONSOLE_CURRENTFONT_MSG SetCurrentConsoleFont;
     CONSOLE_HISTORY_MSG SetConsoleHistory;
     CONSOLE_HISTORY_MSG GetConsoleHistory;
+    CONSOLE_GETMEMORYUSAGE_MSG GetConsoleMemoryUsage;
 } CONSOLE_MSG_BODY_L3, *PCONSOLE_MSG_BODY_L3;
 
 #ifndef __cplusplus
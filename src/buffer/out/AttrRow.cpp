@@ -9,15 +9,34 @@
  // Arguments:
  // - cchRowWidth - the length of the default text attribute
  // - attr - the default text attribute
+ // - palette - the intern table for attributes, shared by every row of a text buffer.
+ //             it must outlive the row.
  // Return Value:
  // - constructed object
  // Note: will throw exception if unable to allocate memory for text attribute storage
-ATTR_ROW::ATTR_ROW(const UINT cchRowWidth, const TextAttribute attr)
+ATTR_ROW::ATTR_ROW(const UINT cchRowWidth, const TextAttribute attr, TextAttributePalette& palette) :
+    _palette{ &palette }
 {
-    _list.push_back(TextAttributeRun(cchRowWidth, attr));
+    _list.push_back(InternedAttributeRun(cchRowWidth, _palette->Intern(attr)));
     _cchRowWidth = cchRowWidth;
 }
 
+// Routine Description:
+// - constructor for a copy of a row that will use a copy of the source row's palette.
+// Arguments:
+// - source - the row to copy
+// - palette - the intern table for the new row. It must hand out the same handles
+//             as the source row's palette did, e.g. by being a copy of it.
+// Return Value:
+// - constructed object
+// Note: will throw exception if unable to allocate memory for text attribute storage
+ATTR_ROW::ATTR_ROW(const ATTR_ROW& source, TextAttributePalette& palette) :
+    _list{ source._list },
+    _cchRowWidth{ source._cchRowWidth },
+    _palette{ &palette }
+{
+}
+
 // Routine Description:
 // - Sets all properties of the ATTR_ROW to default values
 // Arguments:
@@ -25,7 +44,7 @@ ATTR_ROW::ATTR_ROW(const UINT cchRowWidth, const TextAttribute attr)
 void ATTR_ROW::Reset(const TextAttribute attr)
 {
     _list.clear();
-    _list.push_back(TextAttributeRun(_cchRowWidth, attr));
+    _list.push_back(InternedAttributeRun(_cchRowWidth, _palette->Intern(attr)));
 }
 
 // Routine Description:
@@ -108,7 +127,7 @@ TextAttribute ATTR_ROW::GetAttrByColumn(const size_t column,
 {
     THROW_HR_IF(E_INVALIDARG, column >= _cchRowWidth);
     const auto runPos = FindAttrIndex(column, pApplies);
-    return _list[runPos].GetAttributes();
+    return _palette->Lookup(_list[runPos].GetHandle());
 }
 
 // Routine Description:
@@ -120,6 +139,60 @@ size_t ATTR_ROW::GetNumberOfRuns() const noexcept
     return _list.size();
 }
 
+// Routine Description:
+// - Gets the runs as they're stored, with handles into the text buffer's attribute
+//   palette instead of the attributes themselves.
+gsl::span<const InternedAttributeRun> ATTR_ROW::GetInternedRuns() const noexcept
+{
+    return _list;
+}
+
+// Routine Description:
+// - Replaces all of the runs with ones that were got from GetInternedRuns, e.g. when
+//   the text buffer is restored from a saved copy of itself. The handles have to be
+//   valid in this row's palette.
+// - NOTE: Throws E_INVALIDARG if the runs don't cover exactly the width of the row
+//   or refer to handles that aren't in the palette.
+// Arguments:
+// - runs - the new runs for the row
+void ATTR_ROW::SetInternedRuns(const gsl::span<const InternedAttributeRun> runs)
+{
+    size_t total = 0;
+    for (const auto& run : runs)
+    {
+        THROW_HR_IF(E_INVALIDARG, run.GetLength() == 0 || run.GetHandle() >= _palette->size());
+        total += run.GetLength();
+    }
+    THROW_HR_IF(E_INVALIDARG, total != _cchRowWidth);
+
+    _list.assign(runs.begin(), runs.end());
+}
+
+// Routine Description:
+// - Gets the number of bytes allocated on the heap for this row's runs.
+size_t ATTR_ROW::GetMemoryUsage() const noexcept
+{
+    return MeasureMemory().bytes;
+}
+
+// Routine Description:
+// - Gets the bytes allocated on the heap for this row's runs, and how many
+//   allocations they're in.
+Microsoft::Console::Types::MemoryUsage ATTR_ROW::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddContiguous(_list);
+    return usage;
+}
+
+// Routine Description:
+// - Gives back any space for runs that this row isn't using anymore.
+// Note: may throw exception if the runs can't be reallocated
+void ATTR_ROW::ReleaseUnusedMemory()
+{
+    _list.shrink_to_fit();
+}
+
 // Routine Description:
 // - This routine finds the nth attribute in this ATTR_ROW.
 // Arguments:
@@ -221,13 +294,19 @@ void ATTR_ROW::ReplaceLegacyAttrs(_In_ WORD wToBeReplacedAttr, _In_ WORD wReplac
 // - <none>
 void ATTR_ROW::ReplaceAttrs(const TextAttribute& toBeReplacedAttr, const TextAttribute& replaceWith) noexcept
 {
-    for (auto& run : _list)
+    try
     {
-        if (run.GetAttributes() == toBeReplacedAttr)
+        const auto toBeReplaced = _palette->Intern(toBeReplacedAttr);
+        const auto replacement = _palette->Intern(replaceWith);
+        for (auto& run : _list)
         {
-            run.SetAttributes(replaceWith);
+            if (run.GetHandle() == toBeReplaced)
+            {
+                run.SetHandle(replacement);
+            }
         }
     }
+    CATCH_LOG();
 }
 
 
@@ -250,6 +329,42 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
                                  const size_t iStart,
                                  const size_t iEnd,
                                  const size_t cBufferWidth)
+{
+    try
+    {
+        // Swap each attribute for its handle in the palette before merging.
+        // The single run case is by far the most common, so keep it off the heap.
+        if (newAttrs.size() == 1)
+        {
+            const InternedAttributeRun run(newAttrs.front().GetLength(), _palette->Intern(newAttrs.front().GetAttributes()));
+            return _InsertInternedRuns({ &run, 1 }, iStart, iEnd, cBufferWidth);
+        }
+
+        std::vector<InternedAttributeRun> interned;
+        interned.reserve(newAttrs.size());
+        for (const auto& run : newAttrs)
+        {
+            interned.emplace_back(run.GetLength(), _palette->Intern(run.GetAttributes()));
+        }
+        return _InsertInternedRuns(interned, iStart, iEnd, cBufferWidth);
+    }
+    CATCH_RETURN();
+}
+
+// Routine Description:
+// - Does the work of InsertAttrRuns once the runs to insert have been interned.
+// Arguments:
+// - newAttrs - The runs to merge into this row.
+// - iStart - The index in the row to place the array of runs.
+// - iEnd - the final index of the merge runs
+// - cBufferWidth - the width of the row.
+// Return Value:
+// - S_OK if we were successful, otherwise a relevant error code.
+[[nodiscard]]
+HRESULT ATTR_ROW::_InsertInternedRuns(const gsl::span<const InternedAttributeRun> newAttrs,
+                                      const size_t iStart,
+                                      const size_t iEnd,
+                                      const size_t cBufferWidth)
 {
     // Definitions:
     // Existing Run = The run length encoded color array we're already storing in memory before this was called.
@@ -273,11 +388,11 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
     if (newAttrs.size() == 1)
     {
         // Get the new color attribute we're trying to apply
-        const TextAttribute NewAttr = newAttrs.at(0).GetAttributes();
+        const auto NewAttr = newAttrs[0].GetHandle();
 
         // If the existing run was only 1 element...
         // ...and the new color is the same as the old, we don't have to do anything and can exit quick.
-        if (_list.size() == 1 && _list.at(0).GetAttributes() == NewAttr)
+        if (_list.size() == 1 && _list.at(0).GetHandle() == NewAttr)
         {
             return S_OK;
         }
@@ -291,10 +406,10 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
         // Check for that circumstance by seeing if we're inserting a single run of the
         // left side color right at the boundary and just adjust the counts in the existing
         // two elements in our internal list.
-        else if (_list.size() == 2 && newAttrs.at(0).GetLength() == 1)
+        else if (_list.size() == 2 && newAttrs[0].GetLength() == 1)
         {
             auto left = _list.begin();
-            if (iStart == left->GetLength() && NewAttr == left->GetAttributes())
+            if (iStart == left->GetLength() && NewAttr == left->GetHandle())
             {
                 auto right = left + 1;
                 left->IncrementLength();
@@ -326,8 +441,9 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
     // becomes R3->B2->Y2->B1->G2.
     // The original run was 3 long. The insertion run was 1 long. We need 1 more for the
     // fact that an existing piece of the run was split in half (to hold the latter half).
-    const size_t cNewRun = _list.size() + newAttrs.size() + 1;
-    std::vector<TextAttributeRun> newRun;
+    const size_t cInsertRun = gsl::narrow_cast<size_t>(newAttrs.size());
+    const size_t cNewRun = _list.size() + cInsertRun + 1;
+    std::vector<InternedAttributeRun> newRun;
     newRun.resize(cNewRun);
 
     // We will start analyzing from the beginning of our existing run.
@@ -338,7 +454,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
     auto pExistingRunPos = existingRun;
     const auto pExistingRunEnd = existingRun + _list.size();
     auto pInsertRunPos = newAttrs.begin();
-    size_t cInsertRunRemaining = newAttrs.size();
+    size_t cInsertRunRemaining = cInsertRun;
     auto pNewRunPos = newRun.begin();
     size_t iExistingRunCoverage = 0;
 
@@ -392,7 +508,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
         // Now we're still on that "last cell copied" into the new run.
         // If the color of that existing copied cell matches the color of the first segment
         // of the run we're about to insert, we can just increment the length to extend the coverage.
-        if (pNewRunPos->GetAttributes() == pInsertRunPos->GetAttributes())
+        if (pNewRunPos->GetHandle() == pInsertRunPos->GetHandle())
         {
             length += pInsertRunPos->GetLength();
 
@@ -457,7 +573,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
             // This case is slightly off from the example above. This case is for if the B2 above was actually Y2.
             // That Y2 from the existing run is the same color as the Y2 we just filled a few columns left in the final run
             // so we can just adjust the final run's column count instead of adding another segment here.
-            if (pNewRunPos->GetAttributes() == pExistingRunPos->GetAttributes())
+            if (pNewRunPos->GetHandle() == pExistingRunPos->GetHandle())
             {
                 size_t length = pNewRunPos->GetLength();
                 length += (iExistingRunCoverage - (iEnd + 1));
@@ -472,7 +588,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
                 pNewRunPos++;
 
                 // Copy the existing run's color information to the new run
-                pNewRunPos->SetAttributes(pExistingRunPos->GetAttributes());
+                pNewRunPos->SetHandle(pExistingRunPos->GetHandle());
 
                 // Adjust the length of that copied color to cover only the reduced number of columns needed
                 // now that some have been replaced by the insert run.
@@ -494,7 +610,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
         // New Run desired when done = R3 -> B7
         // Existing run pointer is on B2.
         // We want to merge the 2 from the B2 into the B5 so we get B7.
-        else if (pNewRunPos->GetAttributes() == pExistingRunPos->GetAttributes())
+        else if (pNewRunPos->GetHandle() == pExistingRunPos->GetHandle())
         {
             // Add the value from the existing run into the current new run position.
             size_t length = pNewRunPos->GetLength();
@@ -555,6 +671,20 @@ std::vector<TextAttributeRun> ATTR_ROW::PackAttrs(const std::vector<TextAttribut
     return runs;
 }
 
+// Routine Description:
+// - Moves this row's runs over to a freshly compacted palette. The row's palette
+//   must already hold the new table; the handles in the row still refer to the old one.
+// Arguments:
+// - oldPalette - the palette that the row's handles currently refer to
+// Note: will throw exception if unable to allocate memory for new palette entries
+void ATTR_ROW::RemapPalette(const TextAttributePalette& oldPalette)
+{
+    for (auto& run : _list)
+    {
+        run.SetHandle(_palette->Intern(oldPalette.Lookup(run.GetHandle())));
+    }
+}
+
 ATTR_ROW::const_iterator ATTR_ROW::begin() const noexcept
 {
     return AttrRowIterator(this);
@@ -22,13 +22,15 @@ Revision History:
 
 #include "TextAttributeRun.hpp"
 #include "AttrRowIterator.hpp"
+#include "../types/inc/MemoryUsage.hpp"
 
 class ATTR_ROW final
 {
 public:
     using const_iterator = typename AttrRowIterator;
 
-    ATTR_ROW(const UINT cchRowWidth, const TextAttribute attr);
+    ATTR_ROW(const UINT cchRowWidth, const TextAttribute attr, TextAttributePalette& palette);
+    ATTR_ROW(const ATTR_ROW& source, TextAttributePalette& palette);
 
     void Reset(const TextAttribute attr);
 
@@ -37,6 +39,11 @@ public:
                                   size_t* const pApplies) const;
 
     size_t GetNumberOfRuns() const noexcept;
+    gsl::span<const InternedAttributeRun> GetInternedRuns() const noexcept;
+    void SetInternedRuns(const gsl::span<const InternedAttributeRun> runs);
+    size_t GetMemoryUsage() const noexcept;
+    Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+    void ReleaseUnusedMemory();
 
     size_t FindAttrIndex(const size_t index,
                          size_t* const pApplies) const;
@@ -55,6 +62,8 @@ public:
 
     static std::vector<TextAttributeRun> PackAttrs(const std::vector<TextAttribute>& attrs);
 
+    void RemapPalette(const TextAttributePalette& oldPalette);
+
     const_iterator begin() const noexcept;
     const_iterator end() const noexcept;
 
@@ -66,8 +75,16 @@ public:
 
 private:
 
-    std::vector<TextAttributeRun> _list;
+    // runs of handles into the owning text buffer's attribute palette.
+    std::vector<InternedAttributeRun> _list;
     size_t _cchRowWidth;
+    TextAttributePalette* _palette; // non ownership pointer
+
+    [[nodiscard]]
+    HRESULT _InsertInternedRuns(const gsl::span<const InternedAttributeRun> newAttrs,
+                                const size_t iStart,
+                                const size_t iEnd,
+                                const size_t cBufferWidth);
 
 #ifdef UNIT_TESTING
     friend class AttrRowTests;
@@ -84,12 +84,12 @@ AttrRowIterator AttrRowIterator::operator--(int)
 
 const TextAttribute* AttrRowIterator::operator->() const
 {
-    return &_run->GetAttributes();
+    return &_pAttrRow->_palette->Lookup(_run->GetHandle());
 }
 
 const TextAttribute& AttrRowIterator::operator*() const
 {
-    return _run->GetAttributes();
+    return _pAttrRow->_palette->Lookup(_run->GetHandle());
 }
 
 // Routine Description:
@@ -10,17 +10,107 @@
 // Routine Description:
 // - constructor
 // Arguments:
-// - rowWidth - the size (in wchar_t) of the char and attribute rows
+// - cells - the backing cells for this row. these are owned by the text buffer's cell arena
+//           and must outlive the CharRow (or be replaced via Resize).
 // - pParent - the parent ROW
 // Return Value:
 // - instantiated object
-// Note: will through if unable to allocate char/attribute buffers
-CharRow::CharRow(size_t rowWidth, ROW* const pParent) :
+CharRow::CharRow(gsl::span<value_type> cells, ROW* const pParent) :
     _wrapForced{ false },
     _doubleBytePadded{ false },
-    _data(rowWidth, value_type()),
-    _pParent{ FAIL_FAST_IF_NULL(pParent) }
+    _data{ cells },
+    _pParent{ FAIL_FAST_IF_NULL(pParent) },
+    _unicodeStorage{},
+    _sharedCells{ false },
+    _narrowOnly{ true }
 {
+    std::fill(_data.begin(), _data.end(), value_type());
+}
+
+// Routine Description:
+// - constructor for a row that starts out packed (cold) and holds no cells
+// Arguments:
+// - rowWidth - the width of the row, in cells
+// - pParent - the parent ROW
+// Return Value:
+// - instantiated object
+CharRow::CharRow(const size_t rowWidth, ROW* const pParent) :
+    _wrapForced{ false },
+    _doubleBytePadded{ false },
+    _data{},
+    _pParent{ FAIL_FAST_IF_NULL(pParent) },
+    _unicodeStorage{},
+    _cold{ std::make_unique<PackedCells>() },
+    _sharedCells{ false },
+    _narrowOnly{ false }
+{
+    _cold->width = rowWidth;
+    _cold->packed = true;
+}
+
+// Routine Description:
+// - constructor for a row in a snapshot of a text buffer. If the source row's cells are in
+//   its buffer's arena, they're shared rather than copied, and both rows take a private
+//   copy of them the first time they're written to. Anything else is copied.
+// Arguments:
+// - source - the row to copy. It is marked as shared too.
+// - pParent - the parent ROW
+// Return Value:
+// - instantiated object
+// Note: will throw exception if unable to allocate
+CharRow::CharRow(CharRow& source, ROW* const pParent) :
+    _wrapForced{ source._wrapForced },
+    _doubleBytePadded{ source._doubleBytePadded },
+    _data{},
+    _pParent{ FAIL_FAST_IF_NULL(pParent) },
+    _unicodeStorage{ source._unicodeStorage },
+    _sharedCells{ false },
+    _narrowOnly{ source._narrowOnly }
+{
+    if (source._cold)
+    {
+        // packed rows, and cold rows thawed into cells of their own, aren't in the arena.
+        _cold = std::make_unique<PackedCells>(*source._cold);
+        if (!_cold->packed)
+        {
+            _data = { _cold->thawed.data(), gsl::narrow<ptrdiff_t>(_cold->thawed.size()) };
+        }
+    }
+    else
+    {
+        _data = source._data;
+        _sharedCells = true;
+        source._sharedCells = true;
+    }
+}
+
+// Routine Description:
+// - constructor for a copy of a row that can be read from even if the row is packed.
+//   The copy has cells of its own, which the source row's are decoded into, and the
+//   source row isn't changed at all, so this is safe to do while others read it too.
+// Arguments:
+// - source - the row to copy
+// - pParent - the parent ROW
+// Return Value:
+// - instantiated object
+// Note: will throw exception if unable to allocate
+CharRow::CharRow(const CharRow& source, ROW* const pParent, Decoded) :
+    _wrapForced{ source._wrapForced },
+    _doubleBytePadded{ source._doubleBytePadded },
+    _data{},
+    _pParent{ FAIL_FAST_IF_NULL(pParent) },
+    _unicodeStorage{ source._unicodeStorage },
+    _cold{ std::make_unique<PackedCells>() },
+    _sharedCells{ false },
+    _narrowOnly{ false }
+{
+    _cold->width = source.size();
+    _cold->packed = false;
+    _cold->thawed.resize(_cold->width);
+
+    _data = { _cold->thawed.data(), gsl::narrow<ptrdiff_t>(_cold->thawed.size()) };
+    source.CopyCellsTo(_data);
+    _narrowOnly = _MeasureNarrowOnly();
 }
 
 // Routine Description:
@@ -31,7 +121,11 @@ CharRow::CharRow(size_t rowWidth, ROW* const pParent) :
 // - <none>
 void CharRow::SetWrapForced(const bool wrapForced) noexcept
 {
-    _wrapForced = wrapForced;
+    if (_wrapForced != wrapForced)
+    {
+        _wrapForced = wrapForced;
+        _pParent->NotifyWrapChanged();
+    }
 }
 
 // Routine Description:
@@ -75,7 +169,11 @@ bool CharRow::WasDoubleBytePadded() const noexcept
 // - the size of the row
 size_t CharRow::size() const noexcept
 {
-    return _data.size();
+    if (IsPacked())
+    {
+        return _cold->width;
+    }
+    return gsl::narrow_cast<size_t>(_data.size());
 }
 
 // Routine Description:
@@ -86,52 +184,80 @@ size_t CharRow::size() const noexcept
 // - <none>
 void CharRow::Reset()
 {
-    for (auto& cell : _data)
+    if (IsPacked())
     {
-        cell.Reset();
+        _cold->glyphs.clear();
+        _cold->dbcsRuns.clear();
     }
+    _CopyOnWrite();
+    std::fill(_data.begin(), _data.end(), value_type());
+    _unicodeStorage.Clear();
+    _narrowOnly = true;
 
-    _wrapForced = false;
     _doubleBytePadded = false;
+    if (_wrapForced)
+    {
+        _wrapForced = false;
+        _pParent->NotifyWrapChanged();
+    }
 }
 
 // Routine Description:
-// - resizes the width of the CharRowBase
+// - moves this row onto a new set of backing cells, carrying over as much of the existing
+//   glyph data as fits and filling any additional cells with the default value.
 // Arguments:
-// - newSize - the new width of the character and attributes rows
+// - newCells - the new backing cells for this row (from the text buffer's cell arena)
 // Return Value:
 // - S_OK on success, otherwise relevant error code
 [[nodiscard]]
-HRESULT CharRow::Resize(const size_t newSize) noexcept
+HRESULT CharRow::Resize(gsl::span<value_type> newCells) noexcept
 {
-    try
+    RETURN_HR_IF(E_INVALIDARG, newCells.size() == 0);
+
+    if (IsPacked())
     {
-        const value_type insertVals;
-        _data.resize(newSize, insertVals);
+        Unpack(newCells);
     }
-    CATCH_RETURN();
+    else
+    {
+        const auto preserved = std::min(_data.size(), newCells.size());
+        std::copy(_data.begin(), _data.begin() + preserved, newCells.begin());
+        std::fill(newCells.begin() + preserved, newCells.end(), value_type());
+
+        _data = newCells;
+    }
+
+    // the row now lives in the given cells, so any cold storage can be let go.
+    _cold.reset();
+    _sharedCells = false;
+
+    // drop any long glyphs that fell off the end of the row.
+    _unicodeStorage.Truncate(gsl::narrow_cast<size_t>(newCells.size()));
+    _narrowOnly = _MeasureNarrowOnly();
 
     return S_OK;
 }
 
-typename CharRow::iterator CharRow::begin() noexcept
+typename CharRow::iterator CharRow::begin()
 {
-    return _data.begin();
+    _PrepareForWrite();
+    return _data.data();
 }
 
 typename CharRow::const_iterator CharRow::cbegin() const noexcept
 {
-    return _data.cbegin();
+    return _data.data();
 }
 
-typename CharRow::iterator CharRow::end() noexcept
+typename CharRow::iterator CharRow::end()
 {
-    return _data.end();
+    _PrepareForWrite();
+    return _data.data() + _data.size();
 }
 
 typename CharRow::const_iterator CharRow::cend() const noexcept
 {
-    return _data.cend();
+    return _data.data() + _data.size();
 }
 
 // Routine Description:
@@ -142,12 +268,12 @@ typename CharRow::const_iterator CharRow::cend() const noexcept
 // - The calculated left boundary of the internal string.
 size_t CharRow::MeasureLeft() const
 {
-    std::vector<value_type>::const_iterator it = _data.cbegin();
-    while (it != _data.cend() && it->IsSpace())
+    auto it = cbegin();
+    while (it != cend() && it->IsSpace())
     {
         ++it;
     }
-    return it - _data.cbegin();
+    return it - cbegin();
 }
 
 // Routine Description:
@@ -158,17 +284,20 @@ size_t CharRow::MeasureLeft() const
 // - The calculated right boundary of the internal string.
 size_t CharRow::MeasureRight() const noexcept
 {
-    std::vector<value_type>::const_reverse_iterator it = _data.crbegin();
-    while (it != _data.crend() && it->IsSpace())
+    auto it = cend();
+    while (it != cbegin() && (it - 1)->IsSpace())
     {
-        ++it;
+        --it;
     }
-    return _data.crend() - it;
+    return it - cbegin();
 }
 
 void CharRow::ClearCell(const size_t column)
 {
-    _data.at(column).Reset();
+    THROW_HR_IF(E_INVALIDARG, column >= size());
+    _CopyOnWrite();
+    _data[column].Reset();
+    _unicodeStorage.Erase(column);
 }
 
 // Routine Description:
@@ -189,6 +318,113 @@ bool CharRow::ContainsText() const noexcept
     return false;
 }
 
+// Routine Description:
+// - Tells whether every cell in this row holds one narrow glyph that fits in the cell
+//   itself, so the row's text can be read straight out of its cells.
+// - This is kept up to date by whatever writes to the row, so reading it never changes
+//   the row. Writes that can't tell what they wrote (through the non-const iterators and
+//   references) make it false until the row is next reset, moved or unpacked.
+// Return Value:
+// - True if there are no double width cells and no long glyphs. False otherwise,
+//   including for packed rows.
+bool CharRow::IsNarrowOnly() const noexcept
+{
+    return !IsPacked() && _narrowOnly;
+}
+
+// Routine Description:
+// - Writes a glyph that fits in a single wchar_t into a cell, replacing any long glyph that
+//   was there, and keeps track of whether the row is still narrow only.
+// Arguments:
+// - column - the column to write to
+// - wch - the glyph
+// - attr - the dbcs attribute of the cell
+// Note: will throw exception if column is out of bounds or the cells are shared and can't be copied
+void CharRow::WriteCell(const size_t column, const wchar_t wch, const DbcsAttribute attr)
+{
+    THROW_HR_IF(E_INVALIDARG, column >= size());
+    _CopyOnWrite();
+
+    auto& cell = _data[column];
+    if (cell.DbcsAttr().IsGlyphStored())
+    {
+        _unicodeStorage.Erase(column);
+    }
+    cell = value_type{ wch, attr };
+    cell.DbcsAttr().SetGlyphStored(false);
+
+    _narrowOnly = _narrowOnly && attr.IsSingle();
+}
+
+// Routine Description:
+// - Fills a span of cells with one narrow glyph, replacing any long glyphs that were there.
+//   If the row wasn't narrow only, that might have made it so, and it's worked out again.
+// Arguments:
+// - column - the first column to fill
+// - count - how many cells to fill. Must fit in the row.
+// - wch - the glyph. Must not be full width.
+// Note: will throw exception if the span is out of bounds or the cells are shared and can't be copied
+void CharRow::FillCells(const size_t column, const size_t count, const wchar_t wch)
+{
+    THROW_HR_IF(E_INVALIDARG, column > size() || count > size() - column);
+    _CopyOnWrite();
+
+    for (size_t i = column; i < column + count; ++i)
+    {
+        auto& cell = _data[i];
+        if (cell.DbcsAttr().IsGlyphStored())
+        {
+            _unicodeStorage.Erase(i);
+        }
+        cell = value_type{ wch, DbcsAttribute{} };
+    }
+
+    if (!_narrowOnly)
+    {
+        _narrowOnly = _MeasureNarrowOnly();
+    }
+}
+
+// Routine Description:
+// - Writes narrow glyphs into a span of cells, one for each character of the text,
+//   replacing any long glyphs that were there. Like FillCells, that might have made
+//   the row narrow only, so that's worked out again if it wasn't.
+// Arguments:
+// - column - the first column to write to
+// - text - the glyphs. Must fit in the row, and none of them may be full width.
+// Note: will throw exception if the span is out of bounds or the cells are shared and can't be copied
+void CharRow::WriteNarrowCells(const size_t column, const std::wstring_view text)
+{
+    THROW_HR_IF(E_INVALIDARG, column > size() || text.size() > size() - column);
+    _CopyOnWrite();
+
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        auto& cell = _data[column + i];
+        if (cell.DbcsAttr().IsGlyphStored())
+        {
+            _unicodeStorage.Erase(column + i);
+        }
+        cell = value_type{ text[i], DbcsAttribute{} };
+    }
+
+    if (!_narrowOnly)
+    {
+        _narrowOnly = _MeasureNarrowOnly();
+    }
+}
+
+// Routine Description:
+// - Works out from scratch whether every cell in this row holds one narrow glyph. See IsNarrowOnly.
+bool CharRow::_MeasureNarrowOnly() const noexcept
+{
+    return !IsPacked() &&
+           _unicodeStorage.empty() &&
+           std::all_of(_data.begin(), _data.end(), [](const value_type& cell) noexcept {
+               return cell.DbcsAttr().IsSingle() && !cell.DbcsAttr().IsGlyphStored();
+           });
+}
+
 // Routine Description:
 // - gets the attribute at the specified column
 // Arguments:
@@ -198,7 +434,8 @@ bool CharRow::ContainsText() const noexcept
 // Note: will throw exception if column is out of bounds
 const DbcsAttribute& CharRow::DbcsAttrAt(const size_t column) const
 {
-    return _data.at(column).DbcsAttr();
+    THROW_HR_IF(E_INVALIDARG, column >= size());
+    return _data[column].DbcsAttr();
 }
 
 // Routine Description:
@@ -210,6 +447,7 @@ const DbcsAttribute& CharRow::DbcsAttrAt(const size_t column) const
 // Note: will throw exception if column is out of bounds
 DbcsAttribute& CharRow::DbcsAttrAt(const size_t column)
 {
+    _PrepareForWrite();
     return const_cast<DbcsAttribute&>(static_cast<const CharRow* const>(this)->DbcsAttrAt(column));
 }
 
@@ -222,7 +460,10 @@ DbcsAttribute& CharRow::DbcsAttrAt(const size_t column)
 // Note: will throw exception if column is out of bounds
 void CharRow::ClearGlyph(const size_t column)
 {
-    _data.at(column).EraseChars();
+    THROW_HR_IF(E_INVALIDARG, column >= size());
+    _CopyOnWrite();
+    _data[column].EraseChars();
+    _unicodeStorage.Erase(column);
 }
 
 // Routine Description:
@@ -234,7 +475,7 @@ void CharRow::ClearGlyph(const size_t column)
 // - Note: will throw exception if column is out of bounds
 const CharRow::reference CharRow::GlyphAt(const size_t column) const
 {
-    THROW_HR_IF(E_INVALIDARG, column >= _data.size());
+    THROW_HR_IF(E_INVALIDARG, column >= size());
     return { const_cast<CharRow&>(*this), column };
 }
 
@@ -247,7 +488,8 @@ const CharRow::reference CharRow::GlyphAt(const size_t column) const
 // - Note: will throw exception if column is out of bounds
 CharRow::reference CharRow::GlyphAt(const size_t column)
 {
-    THROW_HR_IF(E_INVALIDARG, column >= _data.size());
+    THROW_HR_IF(E_INVALIDARG, column >= size());
+    _PrepareForWrite();
     return { *this, column };
 }
 
@@ -262,8 +504,14 @@ CharRow::reference CharRow::GlyphAt(const size_t column)
 std::wstring CharRow::GetTextRaw() const
 {
     std::wstring wstr;
-    wstr.reserve(_data.size());
-    for (size_t i = 0;  i < _data.size(); ++i)
+    wstr.reserve(size());
+    if (IsNarrowOnly())
+    {
+        std::transform(cbegin(), cend(), std::back_inserter(wstr), [](const value_type& cell) noexcept { return cell.Char(); });
+        return wstr;
+    }
+
+    for (size_t i = 0;  i < size(); ++i)
     {
         auto glyph = GlyphAt(i);
         for (auto it = glyph.begin(); it != glyph.end(); ++it)
@@ -277,9 +525,16 @@ std::wstring CharRow::GetTextRaw() const
 std::wstring CharRow::GetText() const
 {
     std::wstring wstr;
-    wstr.reserve(_data.size());
+    wstr.reserve(size());
+
+    // without any wide or long glyphs, there's one character per cell and nothing to skip.
+    if (IsNarrowOnly())
+    {
+        std::transform(cbegin(), cend(), std::back_inserter(wstr), [](const value_type& cell) noexcept { return cell.Char(); });
+        return wstr;
+    }
 
-    for (size_t i = 0;  i < _data.size(); ++i)
+    for (size_t i = 0;  i < size(); ++i)
     {
         auto glyph = GlyphAt(i);
         if (!DbcsAttrAt(i).IsTrailing())
@@ -293,25 +548,23 @@ std::wstring CharRow::GetText() const
     return wstr;
 }
 
-UnicodeStorage& CharRow::GetUnicodeStorage()
-{
-    return _pParent->GetUnicodeStorage();
-}
-
-const UnicodeStorage& CharRow::GetUnicodeStorage() const
+// Routine Description:
+// - gets the storage for the glyphs in this row that don't fit in a single cell
+// Return Value:
+// - the row's glyph storage, keyed by column
+UnicodeStorage& CharRow::GetUnicodeStorage() noexcept
 {
-    return _pParent->GetUnicodeStorage();
+    _narrowOnly = false;
+    return _unicodeStorage;
 }
 
 // Routine Description:
-// - calculates the key used by the given column of the char row to store glyph data in UnicodeStorage
-// Arguments:
-// - column - the column to generate the key for
+// - gets the storage for the glyphs in this row that don't fit in a single cell
 // Return Value:
-// - the COORD key for data access from UnicodeStorage for the column
-COORD CharRow::GetStorageKey(const size_t column) const
+// - the row's glyph storage, keyed by column
+const UnicodeStorage& CharRow::GetUnicodeStorage() const noexcept
 {
-    return { gsl::narrow<SHORT>(column), _pParent->GetId() };
+    return _unicodeStorage;
 }
 
 // Routine Description:
@@ -322,3 +575,313 @@ void CharRow::UpdateParent(ROW* const pParent) noexcept
 {
     _pParent = FAIL_FAST_IF_NULL(pParent);
 }
+
+// Routine Description:
+// - Tells whether this row is currently packed into its cold form.
+// Return Value:
+// - True if the row holds no cells and must be unpacked before use.
+bool CharRow::IsPacked() const noexcept
+{
+    return _cold && _cold->packed;
+}
+
+// Routine Description:
+// - Gets the number of bytes this row has allocated on the heap. Cells that live in
+//   the text buffer's cell arena are counted by the buffer, not by the row.
+size_t CharRow::GetMemoryUsage() const noexcept
+{
+    return _unicodeStorage.GetMemoryUsage() + MeasurePackedMemory().bytes;
+}
+
+// Routine Description:
+// - Gets the bytes allocated on the heap for this row's cold form, if it has one,
+//   and how many allocations they're in. That's the packed text, and the cells of
+//   a cold row that's been thawed outside of the arena.
+Microsoft::Console::Types::MemoryUsage CharRow::MeasurePackedMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    if (_cold)
+    {
+        usage.AddAllocation(sizeof(PackedCells));
+        usage.AddContiguous(_cold->glyphs);
+        usage.AddContiguous(_cold->dbcsRuns);
+        usage.AddContiguous(_cold->thawed);
+    }
+    return usage;
+}
+
+// Routine Description:
+// - Gives back any space this row has allocated but isn't using anymore, like
+//   what was left over from a packed row's text after it was reset.
+// Note: may throw exception if anything can't be reallocated
+void CharRow::ReleaseUnusedMemory()
+{
+    if (IsPacked())
+    {
+        _cold->glyphs.shrink_to_fit();
+        _cold->dbcsRuns.shrink_to_fit();
+    }
+    _unicodeStorage.ReleaseUnusedMemory();
+}
+
+// Routine Description:
+// - Compares two dbcs attributes including whether they refer to a stored glyph.
+bool CharRow::_IsSameDbcs(const DbcsAttribute a, const DbcsAttribute b) noexcept
+{
+    return a == b && a.IsGlyphStored() == b.IsGlyphStored();
+}
+
+// Routine Description:
+// - Packs the cells of this row into their compact cold form and lets go of them.
+// - If the cells belonged to the text buffer's arena, the buffer is responsible for
+//   reclaiming that slice after this returns.
+// Note: will throw exception if unable to allocate the packed storage
+void CharRow::Pack()
+{
+    if (IsPacked())
+    {
+        return;
+    }
+
+    _cold = MakePacked(size());
+    _data = {};
+    _sharedCells = false;
+    _narrowOnly = false;
+}
+
+// Routine Description:
+// - Decodes packed cells into the given cells. If the cells are wider than the packed
+//   row, the remainder is filled with blanks. If they are narrower, the row is truncated.
+// Arguments:
+// - packed - the packed form of a row
+// - cells - the cells to fill
+void CharRow::_UnpackInto(const PackedCells& packed, gsl::span<value_type> cells) noexcept
+{
+    std::fill(cells.begin(), cells.end(), value_type());
+
+    const size_t width = gsl::narrow_cast<size_t>(cells.size());
+    size_t column = 0;
+    for (const auto& run : packed.dbcsRuns)
+    {
+        for (size_t i = 0; i < run.length && column < width; ++i, ++column)
+        {
+            cells[column] = value_type{ packed.glyphs[column], run.attr };
+        }
+    }
+}
+
+// Routine Description:
+// - Restores a packed row into the given cells.
+// Arguments:
+// - cells - the cells that will hold this row from now on.
+void CharRow::Unpack(gsl::span<value_type> cells) noexcept
+{
+    if (!IsPacked())
+    {
+        return;
+    }
+
+    _UnpackInto(*_cold, cells);
+
+    _data = cells;
+    _cold.reset();
+    _narrowOnly = _MeasureNarrowOnly();
+}
+
+// Routine Description:
+// - Restores a packed row into cells owned by the row itself. This is used when a cold row
+//   is touched and the text buffer has no arena space to spare for it.
+// Note: will throw exception if unable to allocate the cells
+void CharRow::UnpackOwned()
+{
+    if (!IsPacked())
+    {
+        return;
+    }
+
+    auto thawed = std::make_unique<PackedCells>();
+    thawed->width = _cold->width;
+    thawed->packed = false;
+    thawed->thawed.resize(_cold->width);
+
+    _UnpackInto(*_cold, { thawed->thawed.data(), gsl::narrow<ptrdiff_t>(thawed->thawed.size()) });
+
+    _cold = std::move(thawed);
+    _data = { _cold->thawed.data(), gsl::narrow<ptrdiff_t>(_cold->thawed.size()) };
+    _narrowOnly = _MeasureNarrowOnly();
+}
+
+// Routine Description:
+// - Makes a packed copy of this row at the given width, whether it's packed already or not.
+//   The row itself isn't changed. If the width is less than the row's, the copy is truncated.
+// Arguments:
+// - width - the width of the copy, in cells
+// Return Value:
+// - the packed copy, for AdoptPacked
+// Note: will throw exception if unable to allocate the packed storage
+std::unique_ptr<CharRow::PackedCells> CharRow::MakePacked(const size_t width) const
+{
+    auto packed = std::make_unique<PackedCells>();
+    packed->width = width;
+    packed->packed = true;
+
+    if (IsPacked())
+    {
+        packed->glyphs = _cold->glyphs.substr(0, width);
+
+        size_t remaining = packed->glyphs.size();
+        for (auto it = _cold->dbcsRuns.cbegin(); it != _cold->dbcsRuns.cend() && remaining > 0; ++it)
+        {
+            const auto length = std::min(it->length, remaining);
+            packed->dbcsRuns.push_back({ it->attr, length });
+            remaining -= length;
+        }
+        return packed;
+    }
+
+    // Trailing blank cells are implied by the width, so don't bother storing them.
+    size_t used = std::min(size(), width);
+    while (used > 0)
+    {
+        const auto& cell = _data[used - 1];
+        if (!cell.IsSpace() || !cell.DbcsAttr().IsSingle())
+        {
+            break;
+        }
+        --used;
+    }
+
+    packed->glyphs.reserve(used);
+    for (size_t i = 0; i < used; ++i)
+    {
+        const auto& cell = _data[i];
+        packed->glyphs.push_back(cell.Char());
+
+        if (!packed->dbcsRuns.empty() && _IsSameDbcs(packed->dbcsRuns.back().attr, cell.DbcsAttr()))
+        {
+            packed->dbcsRuns.back().length++;
+        }
+        else
+        {
+            packed->dbcsRuns.push_back({ cell.DbcsAttr(), 1 });
+        }
+    }
+    return packed;
+}
+
+// Routine Description:
+// - Moves this row onto cells that already hold its contents, taking on their width.
+//   Any cold storage is let go, and long glyphs that fell off the end of the row are dropped.
+// Arguments:
+// - cells - the cells that will hold this row from now on, e.g. filled in by CopyCellsTo.
+void CharRow::AdoptCells(gsl::span<value_type> cells) noexcept
+{
+    _data = cells;
+    _cold.reset();
+    _sharedCells = false;
+    _unicodeStorage.Truncate(gsl::narrow_cast<size_t>(cells.size()));
+    _narrowOnly = _MeasureNarrowOnly();
+}
+
+// Routine Description:
+// - Packs this row into cold storage by taking on a packed form made for it earlier,
+//   along with its width. Long glyphs that fell off the end of the row are dropped.
+// - If the cells belonged to the text buffer's arena, the buffer is responsible for
+//   reclaiming that slice after this returns.
+// Arguments:
+// - packed - the row's packed form, from MakePacked.
+void CharRow::AdoptPacked(std::unique_ptr<PackedCells> packed) noexcept
+{
+    _unicodeStorage.Truncate(packed->width);
+    _cold = std::move(packed);
+    _data = {};
+    _sharedCells = false;
+    _narrowOnly = false;
+}
+
+// Routine Description:
+// - Copies this row's cells out, whether it's packed or not. If the cells are wider than
+//   the row, the remainder is filled with blanks. If they are narrower, the row is truncated.
+// Arguments:
+// - cells - where to copy the cells to
+void CharRow::CopyCellsTo(gsl::span<value_type> cells) const noexcept
+{
+    if (IsPacked())
+    {
+        _UnpackInto(*_cold, cells);
+        return;
+    }
+
+    const auto count = std::min(cells.size(), _data.size());
+    std::copy_n(_data.begin(), count, cells.begin());
+    std::fill(cells.begin() + count, cells.end(), value_type());
+}
+
+// Routine Description:
+// - Tells whether this row's cells are shared with a snapshot of its text buffer.
+//   Cells that were shared stop being shared once the other buffer is destroyed.
+bool CharRow::IsShared() const noexcept
+{
+    return _sharedCells && _pParent->IsArenaShared();
+}
+
+// Routine Description:
+// - Gives this row a private copy of its cells if they are shared, so they can be written.
+//   The copy is owned by the row the same way a cold row thawed outside the arena is.
+// Note: will throw exception if unable to allocate the cells
+void CharRow::_CopyOnWrite()
+{
+    if (!_sharedCells)
+    {
+        return;
+    }
+
+    // nobody else can see the cells anymore, so they're ours to write.
+    if (!_pParent->IsArenaShared())
+    {
+        _sharedCells = false;
+        return;
+    }
+
+    auto owned = std::make_unique<PackedCells>();
+    owned->width = size();
+    owned->packed = false;
+    owned->thawed.assign(_data.begin(), _data.end());
+
+    _cold = std::move(owned);
+    _data = { _cold->thawed.data(), gsl::narrow<ptrdiff_t>(_cold->thawed.size()) };
+    _sharedCells = false;
+}
+
+// Routine Description:
+// - Called before anything is allowed to write to this row's cells.
+// Note: will throw exception if the cells are shared and can't be copied
+void CharRow::_PrepareForWrite()
+{
+    _CopyOnWrite();
+    _narrowOnly = false;
+}
+
+bool operator==(const CharRow& a, const CharRow& b) noexcept
+{
+    if (a._wrapForced != b._wrapForced ||
+        a._doubleBytePadded != b._doubleBytePadded ||
+        a.IsPacked() != b.IsPacked() ||
+        a.size() != b.size() ||
+        !(a._unicodeStorage == b._unicodeStorage))
+    {
+        return false;
+    }
+
+    if (a.IsPacked())
+    {
+        return a._cold->glyphs == b._cold->glyphs &&
+               std::equal(a._cold->dbcsRuns.cbegin(), a._cold->dbcsRuns.cend(),
+                          b._cold->dbcsRuns.cbegin(), b._cold->dbcsRuns.cend(),
+                          [](const auto& x, const auto& y) noexcept {
+                              return x.length == y.length && CharRow::_IsSameDbcs(x.attr, y.attr);
+                          });
+    }
+
+    return std::equal(a.cbegin(), a.cend(), b.cbegin());
+}
@@ -42,11 +42,19 @@ class CharRow final
 public:
     using glyph_type = typename wchar_t;
     using value_type = typename CharRowCell;
-    using iterator = typename std::vector<value_type>::iterator;
-    using const_iterator = typename std::vector<value_type>::const_iterator;
+    using iterator = typename value_type*;
+    using const_iterator = typename const value_type*;
     using reference = typename CharRowCellReference;
 
-    CharRow(size_t rowWidth, ROW* const pParent);
+    // picks the constructor that decodes a copy of a row, see TextBuffer::GetRowByOffset.
+    struct Decoded final
+    {
+    };
+
+    CharRow(gsl::span<value_type> cells, ROW* const pParent);
+    CharRow(const size_t rowWidth, ROW* const pParent);
+    CharRow(CharRow& source, ROW* const pParent);
+    CharRow(const CharRow& source, ROW* const pParent, Decoded);
 
     void SetWrapForced(const bool wrap) noexcept;
     bool WasWrapForced() const noexcept;
@@ -55,11 +63,15 @@ public:
     size_t size() const noexcept;
     void Reset();
     [[nodiscard]]
-    HRESULT Resize(const size_t newSize) noexcept;
+    HRESULT Resize(gsl::span<value_type> newCells) noexcept;
     size_t MeasureLeft() const;
     size_t MeasureRight() const noexcept;
     void ClearCell(const size_t column);
+    void WriteCell(const size_t column, const wchar_t wch, const DbcsAttribute attr);
+    void FillCells(const size_t column, const size_t count, const wchar_t wch);
+    void WriteNarrowCells(const size_t column, const std::wstring_view text);
     bool ContainsText() const noexcept;
+    bool IsNarrowOnly() const noexcept;
     const DbcsAttribute& DbcsAttrAt(const size_t column) const;
     DbcsAttribute& DbcsAttrAt(const size_t column);
     void ClearGlyph(const size_t column);
@@ -72,21 +84,61 @@ public:
     const reference GlyphAt(const size_t column) const;
     reference GlyphAt(const size_t column);
 
-    // iterators
-    iterator begin() noexcept;
+    // iterators. the non-const ones give write access, so they take a private copy of shared cells.
+    iterator begin();
     const_iterator cbegin() const noexcept;
 
-    iterator end() noexcept;
+    iterator end();
     const_iterator cend() const noexcept;
 
-    UnicodeStorage& GetUnicodeStorage();
-    const UnicodeStorage& GetUnicodeStorage() const;
-    COORD GetStorageKey(const size_t column) const;
+    UnicodeStorage& GetUnicodeStorage() noexcept;
+    const UnicodeStorage& GetUnicodeStorage() const noexcept;
 
     void UpdateParent(ROW* const pParent) noexcept;
 
+    // cold scrollback support. a packed row holds no cells, only a compact copy of its text.
+    // it must be unpacked (see TextBuffer) before any cell data is accessed.
+    bool IsPacked() const noexcept;
+    void Pack();
+    void Unpack(gsl::span<value_type> cells) noexcept;
+    void UnpackOwned();
+    void CopyCellsTo(gsl::span<value_type> cells) const noexcept;
+
+    // the compact form of a row that has gone cold. the glyphs are stored one wchar_t per cell
+    // with the trailing blank cells trimmed off, and the dbcs attributes are run length encoded.
+    struct PackedCells
+    {
+        struct DbcsRun
+        {
+            DbcsAttribute attr;
+            size_t length;
+        };
+
+        std::wstring glyphs;
+        std::vector<DbcsRun> dbcsRuns;
+        size_t width;
+
+        // while a cold row has been thawed outside of the buffer's cell arena,
+        // this owns the cells that _data points at.
+        std::vector<value_type> thawed;
+        bool packed;
+    };
+
+    // moving a row onto a new layout. the new cells or packed form are made up front
+    // (see CopyCellsTo and MakePacked) so that handing them to the row can't fail.
+    std::unique_ptr<PackedCells> MakePacked(const size_t width) const;
+    void AdoptCells(gsl::span<value_type> cells) noexcept;
+    void AdoptPacked(std::unique_ptr<PackedCells> packed) noexcept;
+
+    size_t GetMemoryUsage() const noexcept;
+    Microsoft::Console::Types::MemoryUsage MeasurePackedMemory() const noexcept;
+    void ReleaseUnusedMemory();
+
+    // copy-on-write support for text buffer snapshots. see the copying constructor.
+    bool IsShared() const noexcept;
+
     friend CharRowCellReference;
-    friend constexpr bool operator==(const CharRow& a, const CharRow& b) noexcept;
+    friend bool operator==(const CharRow& a, const CharRow& b) noexcept;
 
 protected:
     // Occurs when the user runs out of text in a given row and we're forced to wrap the cursor to the next line
@@ -95,19 +147,37 @@ protected:
     // Occurs when the user runs out of text to support a double byte character and we're forced to the next line
     bool _doubleBytePadded;
 
-    // storage for glyph data and dbcs attributes
-    std::vector<value_type> _data;
+    // view of this row's glyph data and dbcs attributes. the cells themselves are
+    // owned by the TextBuffer's contiguous cell arena, not by the CharRow.
+    gsl::span<value_type> _data;
 
     // ROW that this CharRow belongs to
     ROW* _pParent;
+
+    // glyphs in this row that are too long to fit in a single cell, keyed by column.
+    // this stays with the row when it is packed, moved to a new arena slice, or renumbered.
+    UnicodeStorage _unicodeStorage;
+
+    // the cold form of this row, if it has one. see PackedCells.
+    std::unique_ptr<PackedCells> _cold;
+
+    // set while _data points at arena cells that a snapshot of the text buffer (or the
+    // buffer a snapshot was taken from) can still see. they're copied before any write.
+    bool _sharedCells;
+
+    // whether every cell holds a single narrow glyph, with nothing in _unicodeStorage.
+    // kept up to date by every write, so that reading it never changes the row. see IsNarrowOnly.
+    bool _narrowOnly;
+
+    void _CopyOnWrite();
+    void _PrepareForWrite();
+    bool _MeasureNarrowOnly() const noexcept;
+
+    static bool _IsSameDbcs(const DbcsAttribute a, const DbcsAttribute b) noexcept;
+    static void _UnpackInto(const PackedCells& packed, gsl::span<value_type> cells) noexcept;
 };
 
-constexpr bool operator==(const CharRow& a, const CharRow& b) noexcept
-{
-    return (a._wrapForced == b._wrapForced &&
-            a._doubleBytePadded == b._doubleBytePadded &&
-            a._data == b._data);
-}
+bool operator==(const CharRow& a, const CharRow& b) noexcept;
 
 template<typename InputIt1, typename InputIt2>
 void OverwriteColumns(InputIt1 startChars, InputIt1 endChars, InputIt2 startAttrs, CharRow::iterator outIt)
@@ -0,0 +1,336 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "HyperlinkTable.hpp"
+
+// Once a table has this few handles left, the owning buffer should collect it at its
+// next opportunity so that links keep getting handles of their own.
+static constexpr size_t s_CollectionSlack = 4096;
+
+// The owning buffer should also collect the table once its links hold this many
+// characters, so that a flood of long, different URIs doesn't hold on to memory.
+static constexpr size_t s_CollectionLength = 1024 * 1024;
+
+// Routine Description:
+// - constructor. The first handle is never given out, since it means "not a link".
+// Return Value:
+// - constructed object
+// Note: will throw exception if unable to allocate memory for the table
+HyperlinkTable::HyperlinkTable() :
+    _entries{},
+    _handles{},
+    _freeHandles{},
+    _textLength{ 0 },
+    _collectAt{ MaxEntries - s_CollectionSlack },
+    _collectAtLength{ s_CollectionLength }
+{
+    _entries.emplace_back();
+}
+
+// Routine Description:
+// - copy constructor. The lookup refers to the text of the entries it's in, so it's made again.
+// Arguments:
+// - other - the table to copy
+// Return Value:
+// - constructed object
+// Note: will throw exception if unable to allocate memory for the table
+HyperlinkTable::HyperlinkTable(const HyperlinkTable& other) :
+    _entries{ other._entries },
+    _handles{},
+    _freeHandles{ other._freeHandles },
+    _textLength{ other._textLength },
+    _collectAt{ other._collectAt },
+    _collectAtLength{ other._collectAtLength }
+{
+    _RebuildHandles();
+}
+
+// Routine Description:
+// - copy assignment. See the copy constructor.
+// Note: will throw exception if unable to allocate memory for the table
+HyperlinkTable& HyperlinkTable::operator=(const HyperlinkTable& other)
+{
+    if (this != &other)
+    {
+        _handles.clear();
+        _entries = other._entries;
+        _freeHandles = other._freeHandles;
+        _textLength = other._textLength;
+        _collectAt = other._collectAt;
+        _collectAtLength = other._collectAtLength;
+        _RebuildHandles();
+    }
+    return *this;
+}
+
+// Routine Description:
+// - Gets the handle for the link with the given URI and id, adding it to the table
+//   if it isn't there yet. Links without an id only match other links without one.
+// Arguments:
+// - uri - where the link goes. Must not be empty.
+// - id - the id the application gave the link, if any. Must not contain a ';',
+//   and can be at most MaxIdLength long.
+// Return Value:
+// - the handle for the link. If the table is full, NoHyperlink is returned instead.
+// Note: will throw exception if unable to allocate memory for the new entry
+HyperlinkTable::handle_type HyperlinkTable::Add(const std::wstring_view uri, const std::wstring_view id)
+{
+    THROW_HR_IF(E_INVALIDARG, uri.empty() || id.size() > MaxIdLength || id.find(L';') != std::wstring_view::npos);
+
+    std::wstring text;
+    text.reserve(id.size() + 1 + uri.size());
+    text.append(id).append(1, L';').append(uri);
+
+    const auto found = _handles.find(text);
+    if (found != _handles.end())
+    {
+        return found->second;
+    }
+
+    handle_type handle = NoHyperlink;
+    if (!_freeHandles.empty())
+    {
+        handle = _freeHandles.back();
+        _freeHandles.pop_back();
+    }
+    else if (_entries.size() < MaxEntries)
+    {
+        handle = gsl::narrow_cast<handle_type>(_entries.size());
+        _entries.emplace_back();
+    }
+    else
+    {
+        return NoHyperlink;
+    }
+
+    auto& entry = _entries[handle];
+    entry.text = std::move(text);
+    entry.idLength = id.size();
+    _textLength += entry.text.size();
+
+    try
+    {
+        _handles.emplace(entry.text, handle);
+    }
+    catch (...)
+    {
+        _Free(handle);
+        throw;
+    }
+    return handle;
+}
+
+// Routine Description:
+// - Puts a link back at the handle it had before, e.g. when loading a buffer that
+//   was saved with Serialize. The table grows to fit the handle if it has to.
+// Arguments:
+// - handle - the handle the link had. Must not be NoHyperlink.
+// - uri - where the link goes
+// - id - the id the application gave the link, if any
+// Return Value:
+// - true if the link is in the table at that handle now. false if the handle is
+//   already in use, or the link is already in the table at another handle.
+// Note: will throw exception if unable to allocate memory for the new entry
+bool HyperlinkTable::Restore(const handle_type handle, const std::wstring_view uri, const std::wstring_view id)
+{
+    if (handle == NoHyperlink || uri.empty() || id.size() > MaxIdLength || id.find(L';') != std::wstring_view::npos || IsInUse(handle))
+    {
+        return false;
+    }
+
+    std::wstring text;
+    text.reserve(id.size() + 1 + uri.size());
+    text.append(id).append(1, L';').append(uri);
+    if (_handles.find(text) != _handles.end())
+    {
+        return false;
+    }
+
+    // Every handle it takes to get there is free until it's restored too. Links are
+    // usually restored in order, so the handle is rarely one of those already.
+    if (handle >= _entries.size())
+    {
+        while (_entries.size() < handle)
+        {
+            _freeHandles.push_back(gsl::narrow_cast<handle_type>(_entries.size()));
+            _entries.emplace_back();
+        }
+        _entries.emplace_back();
+    }
+    else
+    {
+        _freeHandles.erase(std::find(_freeHandles.begin(), _freeHandles.end(), handle));
+    }
+
+    auto& entry = _entries[handle];
+    entry.text = std::move(text);
+    entry.idLength = id.size();
+    _textLength += entry.text.size();
+    _handles.emplace(entry.text, handle);
+    return true;
+}
+
+// Routine Description:
+// - Gets where a link goes.
+// Arguments:
+// - handle - the handle of the link
+// Return Value:
+// - the link's URI, or an empty string if the handle isn't a link that's in the table.
+//   The view stays valid until the link is collected.
+std::wstring_view HyperlinkTable::GetUri(const handle_type handle) const noexcept
+{
+    if (!IsInUse(handle))
+    {
+        return {};
+    }
+    const auto& entry = _entries[handle];
+    return std::wstring_view{ entry.text }.substr(entry.idLength + 1);
+}
+
+// Routine Description:
+// - Gets the id an application gave a link.
+// Arguments:
+// - handle - the handle of the link
+// Return Value:
+// - the link's id, or an empty string if it doesn't have one or isn't in the table.
+std::wstring_view HyperlinkTable::GetId(const handle_type handle) const noexcept
+{
+    if (!IsInUse(handle))
+    {
+        return {};
+    }
+    const auto& entry = _entries[handle];
+    return std::wstring_view{ entry.text }.substr(0, entry.idLength);
+}
+
+// Routine Description:
+// - Tells whether a handle refers to a link that's in the table.
+bool HyperlinkTable::IsInUse(const handle_type handle) const noexcept
+{
+    return handle != NoHyperlink && handle < _entries.size() && !_entries[handle].text.empty();
+}
+
+// Routine Description:
+// - Gets the number of handles the table has room for right now, in use or not,
+//   counting NoHyperlink. Every handle in use is less than this.
+size_t HyperlinkTable::size() const noexcept
+{
+    return _entries.size();
+}
+
+// Routine Description:
+// - Gets the number of links in the table.
+size_t HyperlinkTable::GetLinkCount() const noexcept
+{
+    return _handles.size();
+}
+
+// Routine Description:
+// - Estimates the bytes allocated on the heap for the table, and how many
+//   allocations they're in. Each entry is a block of the deque of its own.
+Microsoft::Console::Types::MemoryUsage HyperlinkTable::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.bytes += _entries.size() * sizeof(_Entry);
+    usage.allocations += _entries.size();
+    for (const auto& entry : _entries)
+    {
+        usage.AddContiguous(entry.text);
+    }
+    usage.AddHashTable(_handles);
+    usage.AddContiguous(_freeHandles);
+    return usage;
+}
+
+// Routine Description:
+// - Tells whether the table is close to running out of handles, or is holding on
+//   to a lot of text, and should be collected.
+bool HyperlinkTable::NeedsCollection() const noexcept
+{
+    return (_entries.size() - _freeHandles.size()) >= _collectAt || _textLength >= _collectAtLength;
+}
+
+// Routine Description:
+// - Lets go of every link that isn't referred to by any of the given attributes.
+//   Their handles are given out again to links that are added later.
+// - The palette should have just been compacted, so that it only has attributes
+//   that are still in use by a row.
+// Arguments:
+// - palette - the attributes in use in the buffer
+// - currentAttributes - the attributes the buffer is writing with, which might not be anywhere yet
+// Note: will throw exception if unable to allocate memory for the counts
+void HyperlinkTable::Collect(const TextAttributePalette& palette, const TextAttribute& currentAttributes)
+{
+    std::vector<size_t> references(_entries.size());
+    const auto reference = [&](const TextAttribute& attr) noexcept {
+        const auto handle = attr.GetHyperlinkId();
+        if (handle < references.size())
+        {
+            ++references[handle];
+        }
+    };
+
+    for (size_t handle = 0; handle < palette.size(); ++handle)
+    {
+        reference(palette.Lookup(gsl::narrow_cast<TextAttributePalette::handle_type>(handle)));
+    }
+    reference(currentAttributes);
+
+    for (size_t handle = 1; handle < _entries.size(); ++handle)
+    {
+        if (references[handle] == 0 && !_entries[handle].text.empty())
+        {
+            _Free(gsl::narrow_cast<handle_type>(handle));
+        }
+    }
+
+    // If most of what was there is still in use, don't try again right away.
+    _DeferCollection();
+}
+
+// Routine Description:
+// - Points the lookup at the text of every entry that's in use.
+// Note: will throw exception if unable to allocate memory for the lookup
+void HyperlinkTable::_RebuildHandles()
+{
+    _handles.reserve(_entries.size() - _freeHandles.size());
+    for (size_t handle = 1; handle < _entries.size(); ++handle)
+    {
+        const auto& entry = _entries[handle];
+        if (!entry.text.empty())
+        {
+            _handles.emplace(entry.text, gsl::narrow_cast<handle_type>(handle));
+        }
+    }
+}
+
+// Routine Description:
+// - Takes a link out of the table and gives its memory back.
+// Arguments:
+// - handle - the handle of the link. Must be in use.
+// Note: the free list has room for every handle, since it never holds more than the table
+//   has, but growing it can still fail. The handle is lost then, rather than the whole table.
+void HyperlinkTable::_Free(const handle_type handle) noexcept
+{
+    auto& entry = _entries[handle];
+    _handles.erase(std::wstring_view{ entry.text });
+    _textLength -= entry.text.size();
+    std::wstring{}.swap(entry.text);
+    entry.idLength = 0;
+    try
+    {
+        _freeHandles.push_back(handle);
+    }
+    CATCH_LOG();
+}
+
+// Routine Description:
+// - Called on a freshly collected table. Holds off on asking for another collection
+//   until a reasonable number of new links, or amount of text, has been added.
+void HyperlinkTable::_DeferCollection() noexcept
+{
+    const auto inUse = _entries.size() - _freeHandles.size();
+    _collectAt = std::max(_collectAt, std::min(inUse + s_CollectionSlack, MaxEntries));
+    _collectAtLength = std::max(_collectAtLength, _textLength + s_CollectionLength / 4);
+}
@@ -0,0 +1,84 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- HyperlinkTable.hpp
+
+Abstract:
+- Intern table for the hyperlinks (OSC 8) used by one text buffer. A text
+  attribute only holds a 16-bit handle into this table, so a link that's on
+  every cell of a line costs as much as a color, and the URI is only stored once.
+- Links aren't freed as soon as nothing uses them. Whenever the buffer compacts
+  its attribute palette, the links the remaining attributes refer to are counted
+  and the rest are let go, so links go away once the rows they were on scroll out.
+--*/
+
+#pragma once
+
+#include "TextAttributePalette.hpp"
+#include "../types/inc/MemoryUsage.hpp"
+
+#include <deque>
+#include <unordered_map>
+
+class HyperlinkTable final
+{
+public:
+    using handle_type = uint16_t;
+
+    HyperlinkTable();
+    HyperlinkTable(const HyperlinkTable& other);
+    HyperlinkTable(HyperlinkTable&&) = default;
+    HyperlinkTable& operator=(const HyperlinkTable& other);
+    HyperlinkTable& operator=(HyperlinkTable&&) = default;
+
+    handle_type Add(const std::wstring_view uri, const std::wstring_view id);
+    [[nodiscard]]
+    bool Restore(const handle_type handle, const std::wstring_view uri, const std::wstring_view id);
+
+    std::wstring_view GetUri(const handle_type handle) const noexcept;
+    std::wstring_view GetId(const handle_type handle) const noexcept;
+    bool IsInUse(const handle_type handle) const noexcept;
+
+    size_t size() const noexcept;
+    size_t GetLinkCount() const noexcept;
+    Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+
+    bool NeedsCollection() const noexcept;
+    void Collect(const TextAttributePalette& palette, const TextAttribute& currentAttributes);
+
+    // the handle of text that isn't a link, and what's handed out once the table is full.
+    static constexpr handle_type NoHyperlink = 0;
+
+    static constexpr size_t MaxEntries = static_cast<size_t>(std::numeric_limits<handle_type>::max()) + 1;
+
+    // ids are meant to be short, and have to fit in the 16 bits Serialize keeps their length in.
+    static constexpr size_t MaxIdLength = std::numeric_limits<uint16_t>::max();
+
+private:
+    // The id and the URI are kept together as "id;uri", which is also what the
+    //      table is looked up by. An id can't have a ';' in it, so that's unambiguous.
+    //      An entry whose text is empty isn't in use.
+    struct _Entry
+    {
+        std::wstring text;
+        size_t idLength;
+    };
+
+    // a deque so that the views _handles holds into the entries stay put as entries are added.
+    std::deque<_Entry> _entries;
+    std::unordered_map<std::wstring_view, handle_type> _handles;
+    std::vector<handle_type> _freeHandles;
+
+    // the number of characters held by the entries in use.
+    size_t _textLength;
+
+    // the size and the text length at which the owning buffer should collect the table.
+    size_t _collectAt;
+    size_t _collectAtLength;
+
+    void _RebuildHandles();
+    void _Free(const handle_type handle) noexcept;
+    void _DeferCollection() noexcept;
+};
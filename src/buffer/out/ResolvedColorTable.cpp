@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "ResolvedColorTable.hpp"
+
+static constexpr COLORREF s_Opaque = 0xff000000;
+
+// Routine Description:
+// - constructor. Every color is black until the table is first updated.
+// Return Value:
+// - constructed object
+ResolvedColorTable::ResolvedColorTable() noexcept :
+    _foreground{},
+    _boldForeground{},
+    _background{}
+{
+}
+
+// Routine Description:
+// - Works out every color out of a color table and pair of default colors.
+//   Must be called again whenever any of them change.
+// Arguments:
+// - colorTable - the color table. Only as many slots as it has are filled in,
+//   and it needs at least 16 for bold colors to be brightened.
+// - defaultFg - the default foreground color.
+// - defaultBg - the default background color.
+void ResolvedColorTable::Update(std::basic_string_view<COLORREF> colorTable,
+                                const COLORREF defaultFg,
+                                const COLORREF defaultBg) noexcept
+{
+    const auto size = std::min(colorTable.size(), s_DefaultSlot);
+    for (size_t i = 0; i < size; ++i)
+    {
+        _foreground.at(i) = colorTable.at(i);
+        _background.at(i) = colorTable.at(i);
+
+        // If the color is already bright (it's in index [8,15] or it's a
+        //       256color value [16,255], then boldness does nothing.
+        _boldForeground.at(i) = (i < 8 && colorTable.size() >= 16) ? colorTable.at(i + 8) : colorTable.at(i);
+    }
+
+    _foreground.at(s_DefaultSlot) = defaultFg;
+    _background.at(s_DefaultSlot) = defaultBg;
+
+    // A bold default foreground that's one of the dark colors of the table is
+    // shown as the bright version of that color. See TextColor::GetColor.
+    _boldForeground.at(s_DefaultSlot) = defaultFg;
+    if (colorTable.size() >= 16)
+    {
+        for (size_t i = 0; i < 8; ++i)
+        {
+            if (colorTable.at(i) == defaultFg)
+            {
+                _boldForeground.at(s_DefaultSlot) = colorTable.at(i + 8);
+                break;
+            }
+        }
+    }
+}
+
+// Routine Description:
+// - Gets the color the foreground of an attribute is painted with.
+// Arguments:
+// - attr - the attribute.
+// Return Value:
+// - the opaque foreground color.
+COLORREF ResolvedColorTable::GetForeground(const TextAttribute& attr) const noexcept
+{
+    const auto color = attr._IsReverseVideo() ?
+                           s_Lookup(_background, attr._background) :
+                           s_Lookup(attr._isBold ? _boldForeground : _foreground, attr._foreground);
+    return s_Opaque | color;
+}
+
+// Routine Description:
+// - Gets the color the background of an attribute is painted with.
+// Arguments:
+// - attr - the attribute.
+// Return Value:
+// - the background color. It's opaque unless the attribute's background is the
+//   default background, which keeps whatever alpha the default background has.
+COLORREF ResolvedColorTable::GetBackground(const TextAttribute& attr) const noexcept
+{
+    const auto color = attr._IsReverseVideo() ?
+                           s_Lookup(attr._isBold ? _boldForeground : _foreground, attr._foreground) :
+                           s_Lookup(_background, attr._background);
+    return attr._background.IsDefault() ? color : s_Opaque | color;
+}
+
+// Routine Description:
+// - Gets the color a TextColor stands for from one of the tables.
+// Arguments:
+// - table - the table for the kind of color it is.
+// - color - the color.
+// Return Value:
+// - the color.
+COLORREF ResolvedColorTable::s_Lookup(const Table& table, const TextColor color) noexcept
+{
+    if (color.IsRgb())
+    {
+        return color._GetRGB();
+    }
+    return color.IsDefault() ? table[s_DefaultSlot] : table[color._index];
+}
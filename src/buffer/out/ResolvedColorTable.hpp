@@ -0,0 +1,50 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ResolvedColorTable.hpp
+
+Abstract:
+- The colors a terminal paints text attributes with, worked out ahead of time.
+- Resolving an attribute against a color table means checking whether each of
+  its colors is a default, indexed or RGB color, brightening bold indexed colors,
+  searching the table for a bold default foreground, and swapping for reverse
+  video. Doing that for every run of every frame adds up, so this does all of
+  that once for each slot of the table whenever the table or the default colors
+  change, and resolving a color is then a single indexed load.
+- The results are exactly those of TextAttribute::CalculateRgbForeground and
+  CalculateRgbBackground, with the foreground made opaque, and the background
+  made opaque unless it's the default background (which is how acrylic shows
+  through).
+--*/
+
+#pragma once
+
+#include "TextAttribute.hpp"
+
+#include <array>
+
+class ResolvedColorTable final
+{
+public:
+    ResolvedColorTable() noexcept;
+
+    void Update(std::basic_string_view<COLORREF> colorTable,
+                const COLORREF defaultFg,
+                const COLORREF defaultBg) noexcept;
+
+    COLORREF GetForeground(const TextAttribute& attr) const noexcept;
+    COLORREF GetBackground(const TextAttribute& attr) const noexcept;
+
+private:
+    // Every index a TextColor can hold, and one more for the default color.
+    static constexpr size_t s_DefaultSlot = 256;
+    using Table = std::array<COLORREF, s_DefaultSlot + 1>;
+
+    static COLORREF s_Lookup(const Table& table, const TextColor color) noexcept;
+
+    Table _foreground;
+    Table _boldForeground;
+    Table _background;
+};
@@ -11,17 +11,75 @@
 // - constructor
 // Arguments:
 // - rowId - the row index in the text buffer
+// - cells - the slice of the text buffer's cell arena that holds this row's character data.
+//           the width of the row is the length of this slice.
+// - fillAttribute - the default text attribute
+// - pParent - the text buffer that this row belongs to
+// Return Value:
+// - constructed object
+ROW::ROW(const SHORT rowId, gsl::span<CharRowCell> cells, const TextAttribute fillAttribute, TextBuffer* const pParent) :
+    _id{ rowId },
+    _rowWidth{ gsl::narrow<size_t>(cells.size()) },
+    _charRow{ cells, this },
+    _attrRow{ gsl::narrow<UINT>(cells.size()), fillAttribute, FAIL_FAST_IF_NULL(pParent)->GetAttributePalette() },
+    _pParent{ pParent },
+    _generation{ pParent->NextGeneration() }
+{
+}
+
+// Routine Description:
+// - constructor for a row that starts out in cold (packed) storage without any cells
+// Arguments:
+// - rowId - the row index in the text buffer
 // - rowWidth - the width of the row, cell elements
 // - fillAttribute - the default text attribute
 // - pParent - the text buffer that this row belongs to
 // Return Value:
 // - constructed object
-ROW::ROW(const SHORT rowId, const short rowWidth, const TextAttribute fillAttribute, TextBuffer* const pParent) :
+ROW::ROW(const SHORT rowId, const size_t rowWidth, const TextAttribute fillAttribute, TextBuffer* const pParent) :
     _id{ rowId },
-    _rowWidth{ gsl::narrow<size_t>(rowWidth) },
-    _charRow{ gsl::narrow<size_t>(rowWidth), this },
-    _attrRow{ gsl::narrow<UINT>(rowWidth), fillAttribute },
-    _pParent{ pParent }
+    _rowWidth{ rowWidth },
+    _charRow{ rowWidth, this },
+    _attrRow{ gsl::narrow<UINT>(rowWidth), fillAttribute, FAIL_FAST_IF_NULL(pParent)->GetAttributePalette() },
+    _pParent{ pParent },
+    _generation{ pParent->NextGeneration() }
+{
+}
+
+// Routine Description:
+// - constructor for a row in a snapshot of a text buffer. The character cells are shared
+//   with the source row until either of them is written to.
+// Arguments:
+// - source - the row to copy
+// - pParent - the snapshot that this row belongs to. Its attribute palette must be a copy
+//             of the source row's buffer's palette.
+// Return Value:
+// - constructed object
+ROW::ROW(ROW& source, TextBuffer* const pParent) :
+    _id{ source._id },
+    _rowWidth{ source._rowWidth },
+    _charRow{ source._charRow, this },
+    _attrRow{ source._attrRow, FAIL_FAST_IF_NULL(pParent)->GetAttributePalette() },
+    _pParent{ pParent },
+    _generation{ source._generation }
+{
+}
+
+// Routine Description:
+// - constructor for a copy of a row whose cells can be read even when the row is packed
+//   in cold storage. The source row isn't changed. See TextBuffer::GetRowByOffset.
+// Arguments:
+// - source - the row to copy
+// Return Value:
+// - constructed object
+// Note: will throw exception if unable to allocate
+ROW::ROW(const ROW& source, CharRow::Decoded) :
+    _id{ source._id },
+    _rowWidth{ source._rowWidth },
+    _charRow{ source._charRow, this, CharRow::Decoded{} },
+    _attrRow{ source._attrRow },
+    _pParent{ source._pParent },
+    _generation{ source._generation }
 {
 }
 
@@ -60,6 +118,29 @@ void ROW::SetId(const SHORT id) noexcept
     _id = id;
 }
 
+// Routine Description:
+// - Gets the generation at which the contents of this row last changed.
+uint64_t ROW::GetGeneration() const noexcept
+{
+    return _generation;
+}
+
+// Routine Description:
+// - Records that the contents of this row just changed by stamping it with the
+//   text buffer's next generation.
+void ROW::MarkChanged() noexcept
+{
+    _generation = _pParent->NextGeneration();
+}
+
+// Routine Description:
+// - Lets the text buffer know that this row's text now does or doesn't wrap onto
+//   the next row, so that it can keep track of which rows make up which line.
+void ROW::NotifyWrapChanged() noexcept
+{
+    _pParent->NotifyWrapChanged(*this);
+}
+
 // Routine Description:
 // - Sets all properties of the ROW to default values
 // Arguments:
@@ -68,6 +149,7 @@ void ROW::SetId(const SHORT id) noexcept
 // - <none>
 bool ROW::Reset(const TextAttribute Attr)
 {
+    MarkChanged();
     _charRow.Reset();
     try
     {
@@ -84,13 +166,14 @@ bool ROW::Reset(const TextAttribute Attr)
 // Routine Description:
 // - resizes ROW to new width
 // Arguments:
-// - width - the new width, in cells
+// - cells - the new slice of the text buffer's cell arena for this row. Its length is the new width.
 // Return Value:
 // - S_OK if successful, otherwise relevant error
 [[nodiscard]]
-HRESULT ROW::Resize(const size_t width)
+HRESULT ROW::Resize(gsl::span<CharRowCell> cells)
 {
-    RETURN_IF_FAILED(_charRow.Resize(width));
+    const auto width = gsl::narrow<size_t>(cells.size());
+    RETURN_IF_FAILED(_charRow.Resize(cells));
     try
     {
         _attrRow.Resize(width);
@@ -98,10 +181,102 @@ HRESULT ROW::Resize(const size_t width)
     CATCH_RETURN();
 
     _rowWidth = width;
+    MarkChanged();
 
     return S_OK;
 }
 
+// Routine Description:
+// - Tells whether the character data of this row is packed away in cold storage.
+bool ROW::IsPacked() const noexcept
+{
+    return _charRow.IsPacked();
+}
+
+// Routine Description:
+// - Tells whether the buffer this row belongs to shares its cell arena with another
+//   buffer. See TextBuffer::IsCellArenaShared.
+bool ROW::IsArenaShared() const noexcept
+{
+    return _pParent->IsCellArenaShared();
+}
+
+// Routine Description:
+// - Packs the character data of this row into cold storage. Attributes are already run length
+//   encoded and stay as they are.
+void ROW::Pack()
+{
+    _charRow.Pack();
+}
+
+// Routine Description:
+// - Restores the character data of this row from cold storage into the given cells.
+// Arguments:
+// - cells - the slice of the text buffer's cell arena for this row. Must match the row width.
+void ROW::Unpack(gsl::span<CharRowCell> cells) noexcept
+{
+    _charRow.Unpack(cells);
+}
+
+// Routine Description:
+// - Restores the character data of this row from cold storage into cells owned by the row.
+void ROW::UnpackOwned()
+{
+    _charRow.UnpackOwned();
+}
+
+// Routine Description:
+// - Moves this ROW onto cells that already hold its character data, taking on their width.
+//   Used by the text buffer to lay rows out in a new arena once everything's been allocated.
+// Arguments:
+// - cells - the slice of the text buffer's cell arena for this row, already filled in
+// - attrRow - the row's attributes resized to the new width, or nullopt if the width isn't changing
+void ROW::AdoptCells(gsl::span<CharRowCell> cells, std::optional<ATTR_ROW> attrRow) noexcept
+{
+    _charRow.AdoptCells(cells);
+    if (attrRow.has_value())
+    {
+        _attrRow = std::move(attrRow.value());
+    }
+    _rowWidth = gsl::narrow_cast<size_t>(cells.size());
+    MarkChanged();
+}
+
+// Routine Description:
+// - Moves this ROW into cold storage at the width of the given packed form.
+// Arguments:
+// - packed - the row's packed form, or nullptr if it's already packed at the width it's staying at
+// - attrRow - the row's attributes resized to the new width, or nullopt if the width isn't changing
+void ROW::AdoptPacked(std::unique_ptr<CharRow::PackedCells> packed, std::optional<ATTR_ROW> attrRow) noexcept
+{
+    if (packed)
+    {
+        _charRow.AdoptPacked(std::move(packed));
+    }
+    if (attrRow.has_value())
+    {
+        _attrRow = std::move(attrRow.value());
+    }
+    _rowWidth = _charRow.size();
+    MarkChanged();
+}
+
+// Routine Description:
+// - Gets the number of bytes this row takes up, not counting its cells in the text buffer's cell arena.
+size_t ROW::GetMemoryUsage() const noexcept
+{
+    return sizeof(ROW) + _charRow.GetMemoryUsage() + _attrRow.GetMemoryUsage();
+}
+
+// Routine Description:
+// - Gives back any space this row has allocated but isn't using anymore.
+// Note: may throw exception if anything can't be reallocated
+void ROW::ReleaseUnusedMemory()
+{
+    _charRow.ReleaseUnusedMemory();
+    _attrRow.ReleaseUnusedMemory();
+}
+
 // Routine Description:
 // - clears char data in column in row
 // Arguments:
@@ -112,6 +287,7 @@ void ROW::ClearColumn(const size_t column)
 {
     THROW_HR_IF(E_INVALIDARG, column >= _charRow.size());
     _charRow.ClearCell(column);
+    MarkChanged();
 }
 
 // Routine Description:
@@ -133,14 +309,14 @@ RowCellIterator ROW::AsCellIter(const size_t startIndex, const size_t count) con
     return RowCellIterator(*this, startIndex, count);
 }
 
-UnicodeStorage& ROW::GetUnicodeStorage()
+UnicodeStorage& ROW::GetUnicodeStorage() noexcept
 {
-    return _pParent->GetUnicodeStorage();
+    return _charRow.GetUnicodeStorage();
 }
 
-const UnicodeStorage& ROW::GetUnicodeStorage() const
+const UnicodeStorage& ROW::GetUnicodeStorage() const noexcept
 {
-    return _pParent->GetUnicodeStorage();
+    return _charRow.GetUnicodeStorage();
 }
 
 // Routine Description:
@@ -161,16 +337,44 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const size_t index, co
     // If we're given a right-side column limit, use it. Otherwise, the write limit is the final column index available in the char row.
     const auto finalColumnInRow = limitRight.value_or(_charRow.size() - 1);
 
+    // Rather than merging every cell's color into the attribute row one at a time,
+    // gather up the runs for a contiguous stretch of written cells and insert them all at once.
+    std::vector<TextAttributeRun> pendingRuns;
+    size_t pendingStart = 0;
+    const auto flushPendingRuns = [&](const size_t endInclusive) {
+        if (!pendingRuns.empty())
+        {
+            LOG_IF_FAILED(_attrRow.InsertAttrRuns({ pendingRuns.data(), pendingRuns.size() },
+                                                  pendingStart,
+                                                  endInclusive,
+                                                  _charRow.size()));
+            pendingRuns.clear();
+        }
+    };
+
     while (it && currentIndex <= finalColumnInRow)
     {
         // Fill the color if the behavior isn't set to keeping the current color.
         if (it->TextAttrBehavior() != TextAttributeBehavior::Current)
         {
-            const TextAttributeRun attrRun{ 1, it->TextAttr() };
-            LOG_IF_FAILED(_attrRow.InsertAttrRuns({ &attrRun, 1 },
-                                                  currentIndex,
-                                                  currentIndex,
-                                                  _charRow.size()));
+            if (pendingRuns.empty())
+            {
+                pendingStart = currentIndex;
+                pendingRuns.emplace_back(1, it->TextAttr());
+            }
+            else if (pendingRuns.back().GetAttributes() == it->TextAttr())
+            {
+                pendingRuns.back().IncrementLength();
+            }
+            else
+            {
+                pendingRuns.emplace_back(1, it->TextAttr());
+            }
+        }
+        else
+        {
+            // This cell keeps its color, so the stretch of new colors ends just before it.
+            flushPendingRuns(currentIndex - 1);
         }
 
         // Fill the text if the behavior isn't set to saying there's only a color stored in this iterator.
@@ -195,6 +399,13 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const size_t index, co
                 _charRow.ClearCell(currentIndex);
                 _charRow.SetDoubleBytePadded(true);
             }
+            // Narrow glyphs (the overwhelmingly common case) go straight into the cell
+            // without a round trip through the glyph reference and UnicodeStorage.
+            else if (it->Chars().size() == 1)
+            {
+                _charRow.WriteCell(currentIndex, it->Chars().front(), it->DbcsAttr());
+                ++it;
+            }
             // Otherwise, copy the data given and increment the iterator.
             else
             {
@@ -218,5 +429,222 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const size_t index, co
         ++currentIndex;
     }
 
+    flushPendingRuns(currentIndex - 1);
+
+    if (currentIndex > index)
+    {
+        MarkChanged();
+    }
+
     return it;
 }
+
+// Routine Description:
+// - Writes legacy CHAR_INFO cells into the row, the same way that WriteCells would with an iterator over them,
+//   but without making a view of every cell on the way. The characters go straight into the char row, and the
+//   colors go into the attribute row as runs of cells with the same legacy attributes.
+// Arguments:
+// - cells - The cells to write. As many as fit in the row from index on are written.
+// - index - The column to start writing at
+// - setWrap - Whether to set the wrap flag if we fill the last column of the row
+// Return Value:
+// - The number of cells that were written from the given ones.
+size_t ROW::WriteCharInfos(const std::basic_string_view<CHAR_INFO> cells, const size_t index, const bool setWrap)
+{
+    THROW_HR_IF(E_INVALIDARG, index >= _charRow.size());
+    const size_t finalColumnInRow = _charRow.size() - 1;
+
+    std::vector<TextAttributeRun> runs;
+    WORD runLegacyAttributes = 0;
+
+    size_t consumed = 0;
+    size_t currentIndex = index;
+    while (consumed < cells.size() && currentIndex <= finalColumnInRow)
+    {
+        const CHAR_INFO& charInfo = cells[consumed];
+
+        // Whether it's the leading or trailing half of a character doesn't change its color.
+        const WORD legacyAttributes = charInfo.Attributes & ~COMMON_LVB_SBCSDBCS;
+        if (!runs.empty() && legacyAttributes == runLegacyAttributes)
+        {
+            runs.back().IncrementLength();
+        }
+        else
+        {
+            TextAttribute attr;
+            attr.SetFromLegacy(legacyAttributes);
+            runs.emplace_back(1, attr);
+            runLegacyAttributes = legacyAttributes;
+        }
+
+        DbcsAttribute dbcsAttr;
+        if (WI_IsFlagSet(charInfo.Attributes, COMMON_LVB_LEADING_BYTE))
+        {
+            dbcsAttr.SetLeading();
+        }
+        else if (WI_IsFlagSet(charInfo.Attributes, COMMON_LVB_TRAILING_BYTE))
+        {
+            dbcsAttr.SetTrailing();
+        }
+
+        const bool fillingLastColumn = currentIndex == finalColumnInRow;
+
+        // Like WriteCells, pad out a trailing half in the first column and try the cell again in the next one,
+        // and pad out a leading half in the last column and stop there.
+        if (currentIndex == 0 && dbcsAttr.IsTrailing())
+        {
+            _charRow.ClearCell(currentIndex);
+        }
+        else if (fillingLastColumn && dbcsAttr.IsLeading())
+        {
+            _charRow.ClearCell(currentIndex);
+            _charRow.SetDoubleBytePadded(true);
+        }
+        else
+        {
+            _charRow.WriteCell(currentIndex, charInfo.Char.UnicodeChar, dbcsAttr);
+            ++consumed;
+        }
+
+        if (setWrap && fillingLastColumn)
+        {
+            _charRow.SetWrapForced(true);
+        }
+
+        ++currentIndex;
+    }
+
+    if (currentIndex > index)
+    {
+        LOG_IF_FAILED(_attrRow.InsertAttrRuns({ runs.data(), runs.size() },
+                                              index,
+                                              currentIndex - 1,
+                                              _charRow.size()));
+        MarkChanged();
+    }
+
+    return consumed;
+}
+
+// Routine Description:
+// - Gives a span of cells in the row one color, with a single insertion into the attribute row, like WriteCells
+//   would with an iterator that only has that color stored in it. The text isn't touched.
+// Arguments:
+// - attr - The color to fill with
+// - index - The column to start filling at
+// - count - How many cells to fill. Stops at the end of the row.
+// Return Value:
+// - The number of cells that were filled.
+size_t ROW::FillAttributes(const TextAttribute attr, const size_t index, const size_t count)
+{
+    THROW_HR_IF(E_INVALIDARG, index >= _charRow.size());
+    const size_t filled = std::min(count, _charRow.size() - index);
+    if (filled > 0)
+    {
+        const TextAttributeRun run{ filled, attr };
+        LOG_IF_FAILED(_attrRow.InsertAttrRuns({ &run, 1 },
+                                              index,
+                                              index + filled - 1,
+                                              _charRow.size()));
+        MarkChanged();
+    }
+    return filled;
+}
+
+// Routine Description:
+// - Fills a span of cells in the row with one narrow character, like WriteCells would with an iterator that
+//   repeats it, but straight into the char row. The colors aren't touched.
+// Arguments:
+// - wch - The character to fill with. Must not be full width.
+// - index - The column to start filling at
+// - count - How many cells to fill. Stops at the end of the row.
+// - setWrap - Whether to set the wrap flag if we fill the last column of the row
+// Return Value:
+// - The number of cells that were filled.
+size_t ROW::FillCharacters(const wchar_t wch, const size_t index, const size_t count, const bool setWrap)
+{
+    THROW_HR_IF(E_INVALIDARG, index >= _charRow.size());
+    const size_t filled = std::min(count, _charRow.size() - index);
+    if (filled == 0)
+    {
+        return 0;
+    }
+
+    _charRow.FillCells(index, filled, wch);
+
+    if (setWrap && index + filled == _charRow.size())
+    {
+        _charRow.SetWrapForced(true);
+    }
+
+    MarkChanged();
+    return filled;
+}
+
+// Routine Description:
+// - Writes a run of narrow text in one color into the row, like WriteCells would with an iterator over the
+//   text and the color, but straight into the char row, and with one attribute run for all of it.
+// Arguments:
+// - text - The text to write, one cell per character. See TextBuffer::IsNarrowText.
+// - attr - The color to give the text
+// - index - The column to start writing at
+// - setWrap - Whether to set the wrap flag if we fill the last column of the row
+// Return Value:
+// - The number of characters that were written. Stops at the end of the row.
+size_t ROW::WriteNarrowText(const std::wstring_view text, const TextAttribute attr, const size_t index, const bool setWrap)
+{
+    THROW_HR_IF(E_INVALIDARG, index >= _charRow.size());
+    const size_t written = std::min(text.size(), _charRow.size() - index);
+    if (written == 0)
+    {
+        return 0;
+    }
+
+    _charRow.WriteNarrowCells(index, text.substr(0, written));
+
+    const TextAttributeRun run{ written, attr };
+    LOG_IF_FAILED(_attrRow.InsertAttrRuns({ &run, 1 }, index, index + written - 1, _charRow.size()));
+
+    if (setWrap && index + written == _charRow.size())
+    {
+        _charRow.SetWrapForced(true);
+    }
+
+    MarkChanged();
+    return written;
+}
+
+// Routine Description:
+// - Appends the text of a span of cells in the row to the given string. The trailing halves of characters that
+//   are two cells wide are skipped, since they're copies of the leading halves.
+// Arguments:
+// - text - The string to append to
+// - index - The column to start reading at
+// - count - How many cells to read. Stops at the end of the row.
+// Return Value:
+// - The number of cells that were read.
+size_t ROW::AppendText(std::pmr::wstring& text, const size_t index, const size_t count) const
+{
+    THROW_HR_IF(E_INVALIDARG, index >= _charRow.size());
+    const size_t read = std::min(count, _charRow.size() - index);
+
+    const auto cells = _charRow.cbegin() + index;
+    for (size_t i = 0; i < read; i++)
+    {
+        const auto& cell = cells[i];
+        if (cell.DbcsAttr().IsTrailing())
+        {
+            continue;
+        }
+
+        if (cell.DbcsAttr().IsGlyphStored())
+        {
+            text += std::wstring_view{ _charRow.GlyphAt(index + i) };
+        }
+        else
+        {
+            text += cell.Char();
+        }
+    }
+    return read;
+}
@@ -27,12 +27,17 @@ Revision History:
 #include "RowCellIterator.hpp"
 #include "UnicodeStorage.hpp"
 
+#include <memory_resource>
+
 class TextBuffer;
 
 class ROW final
 {
 public:
-    ROW(const SHORT rowId, const short rowWidth, const TextAttribute fillAttribute, TextBuffer* const pParent);
+    ROW(const SHORT rowId, gsl::span<CharRowCell> cells, const TextAttribute fillAttribute, TextBuffer* const pParent);
+    ROW(const SHORT rowId, const size_t rowWidth, const TextAttribute fillAttribute, TextBuffer* const pParent);
+    ROW(ROW& source, TextBuffer* const pParent);
+    ROW(const ROW& source, CharRow::Decoded);
 
     size_t size() const noexcept;
 
@@ -45,9 +50,24 @@ public:
     SHORT GetId() const noexcept;
     void SetId(const SHORT id) noexcept;
 
+    uint64_t GetGeneration() const noexcept;
+    void MarkChanged() noexcept;
+    void NotifyWrapChanged() noexcept;
+
     bool Reset(const TextAttribute Attr);
     [[nodiscard]]
-    HRESULT Resize(const size_t width);
+    HRESULT Resize(gsl::span<CharRowCell> cells);
+
+    bool IsPacked() const noexcept;
+    bool IsArenaShared() const noexcept;
+    void Pack();
+    void Unpack(gsl::span<CharRowCell> cells) noexcept;
+    void UnpackOwned();
+    void AdoptCells(gsl::span<CharRowCell> cells, std::optional<ATTR_ROW> attrRow) noexcept;
+    void AdoptPacked(std::unique_ptr<CharRow::PackedCells> packed, std::optional<ATTR_ROW> attrRow) noexcept;
+
+    size_t GetMemoryUsage() const noexcept;
+    void ReleaseUnusedMemory();
 
     void ClearColumn(const size_t column);
     std::wstring GetText() const;
@@ -55,10 +75,15 @@ public:
     RowCellIterator AsCellIter(const size_t startIndex) const;
     RowCellIterator AsCellIter(const size_t startIndex, const size_t count) const;
 
-    UnicodeStorage& GetUnicodeStorage();
-    const UnicodeStorage& GetUnicodeStorage() const;
+    UnicodeStorage& GetUnicodeStorage() noexcept;
+    const UnicodeStorage& GetUnicodeStorage() const noexcept;
 
     OutputCellIterator WriteCells(OutputCellIterator it, const size_t index, const bool setWrap, std::optional<size_t> limitRight = std::nullopt);
+    size_t WriteCharInfos(const std::basic_string_view<CHAR_INFO> cells, const size_t index, const bool setWrap);
+    size_t FillAttributes(const TextAttribute attr, const size_t index, const size_t count);
+    size_t FillCharacters(const wchar_t wch, const size_t index, const size_t count, const bool setWrap);
+    size_t WriteNarrowText(const std::wstring_view text, const TextAttribute attr, const size_t index, const bool setWrap);
+    size_t AppendText(std::pmr::wstring& text, const size_t index, const size_t count) const;
 
     friend bool operator==(const ROW& a, const ROW& b) noexcept;
 
@@ -72,6 +97,7 @@ private:
     SHORT _id;
     size_t _rowWidth;
     TextBuffer* _pParent; // non ownership pointer
+    uint64_t _generation; // when the contents of this row last changed. see TextBuffer::GetRowsChangedSince
 };
 
 inline bool operator==(const ROW& a, const ROW& b) noexcept
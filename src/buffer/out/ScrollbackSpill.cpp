@@ -0,0 +1,393 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "ScrollbackSpill.hpp"
+#include "CharRow.hpp"
+
+#pragma hdrstop
+
+static_assert(std::is_trivially_copyable_v<CharRowCell>, "CharRowCell is written to the spill file as raw bytes");
+static_assert(std::is_trivially_copyable_v<TextAttribute>, "TextAttribute is written to the spill file as raw bytes");
+
+// Routine Description:
+// - Creates a new spill file at the given path. Any existing file is replaced, and the
+//   file is deleted again when the spill is destroyed.
+// Arguments:
+// - path - location of the spill file
+// Return Value:
+// - constructed object
+// Note: will throw exception if the file cannot be created
+ScrollbackSpill::ScrollbackSpill(const std::wstring_view path) :
+    _fileSize{ 0 },
+    _staging{},
+    _index{},
+    _rowCount{ 0 },
+    _mappingSize{ 0 },
+    _viewStart{ 0 },
+    _viewEnd{ 0 }
+{
+    const std::wstring filePath{ path };
+    _file.reset(CreateFileW(filePath.c_str(),
+                            GENERIC_READ | GENERIC_WRITE,
+                            0,
+                            nullptr,
+                            CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                            nullptr));
+    THROW_LAST_ERROR_IF(!_file);
+
+    _staging.reserve(s_StagingLimit);
+}
+
+// Routine Description:
+// - Creates a spill file with a unique name in the user's temp directory.
+// Return Value:
+// - the new spill
+// Note: will throw exception if the file cannot be created
+std::unique_ptr<ScrollbackSpill> ScrollbackSpill::CreateInTempDirectory()
+{
+    wchar_t tempPath[MAX_PATH + 1];
+    THROW_LAST_ERROR_IF(0 == GetTempPathW(ARRAYSIZE(tempPath), tempPath));
+
+    wchar_t tempFile[MAX_PATH + 1];
+    THROW_LAST_ERROR_IF(0 == GetTempFileNameW(tempPath, L"cnh", 0, tempFile));
+
+    return std::make_unique<ScrollbackSpill>(tempFile);
+}
+
+// Routine Description:
+// - Gets the number of rows that have been spilled so far.
+size_t ScrollbackSpill::size() const noexcept
+{
+    const auto lock = _lock.lock_shared();
+    return _rowCount;
+}
+
+// Routine Description:
+// - Gets the number of bytes of memory the spill is using. The mapped view of the
+//   file isn't counted, since it's backed by the file and not by the page file.
+size_t ScrollbackSpill::GetMemoryUsage() const noexcept
+{
+    return MeasureMemory().bytes;
+}
+
+// Routine Description:
+// - Gets the bytes of memory the spill is using, and how many allocations they're
+//   in. Like GetMemoryUsage, this doesn't count the mapped view of the file.
+Microsoft::Console::Types::MemoryUsage ScrollbackSpill::MeasureMemory() const noexcept
+{
+    const auto lock = _lock.lock_shared();
+
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddContiguous(_staging);
+    usage.AddContiguous(_index);
+    return usage;
+}
+
+// Routine Description:
+// - Gets the size in bytes of a row record, including its header.
+size_t ScrollbackSpill::_RecordSize(const RecordHeader& header) noexcept
+{
+    // glyphCount is the number of wchar_t in the stored glyph section, not the number of glyphs.
+    return sizeof(RecordHeader) +
+           (header.cellCount * sizeof(CharRowCell)) +
+           (header.glyphCount * sizeof(wchar_t)) +
+           (header.attrRunCount * sizeof(AttrRunRecord));
+}
+
+// Routine Description:
+// - Appends a row to the end of the spill file.
+// - Record layout: header, trimmed cells, stored glyph text, attribute runs.
+//   Stored glyphs are written as (column, length, chars...) triples, all as wchar_t.
+// Arguments:
+// - row - the row to write. It must not be packed.
+// Note: will throw exception on I/O failure
+void ScrollbackSpill::Append(const ROW& row)
+{
+    THROW_HR_IF(E_INVALIDARG, row.IsPacked());
+
+    const auto& charRow = row.GetCharRow();
+    const auto width = row.size();
+    const auto cellCount = charRow.MeasureRight();
+
+    // Gather up any glyphs that live in the row's UnicodeStorage.
+    std::vector<wchar_t> glyphs;
+    for (size_t column = 0; column < cellCount; ++column)
+    {
+        if (charRow.DbcsAttrAt(column).IsGlyphStored())
+        {
+            const std::wstring_view glyph = charRow.GlyphAt(column);
+            glyphs.push_back(gsl::narrow<wchar_t>(column));
+            glyphs.push_back(gsl::narrow<wchar_t>(glyph.size()));
+            glyphs.insert(glyphs.end(), glyph.cbegin(), glyph.cend());
+        }
+    }
+
+    // A hyperlink's handle is only good for as long as the buffer's table keeps the
+    // link, which it doesn't once the row's left the buffer. Spilled text isn't a link.
+    std::vector<AttrRunRecord> runs;
+    const auto& attrRow = row.GetAttrRow();
+    for (size_t column = 0; column < width;)
+    {
+        size_t applies = 0;
+        auto attr = attrRow.GetAttrByColumn(column, &applies);
+        attr.SetHyperlinkId(0);
+        applies = std::min(applies, width - column);
+        if (!runs.empty() && runs.back().attr == attr)
+        {
+            runs.back().length = gsl::narrow<uint16_t>(runs.back().length + applies);
+        }
+        else
+        {
+            runs.push_back({ gsl::narrow<uint16_t>(applies), attr });
+        }
+        column += applies;
+    }
+
+    RecordHeader header;
+    header.width = gsl::narrow<uint16_t>(width);
+    header.cellCount = gsl::narrow<uint16_t>(cellCount);
+    header.glyphCount = gsl::narrow<uint16_t>(glyphs.size());
+    header.attrRunCount = gsl::narrow<uint16_t>(runs.size());
+    header.flags = 0;
+    if (charRow.WasWrapForced())
+    {
+        header.flags |= s_FlagWrapForced;
+    }
+    if (charRow.WasDoubleBytePadded())
+    {
+        header.flags |= s_FlagDoubleBytePadded;
+    }
+
+    const auto lock = _lock.lock_exclusive();
+
+    if (_rowCount % s_IndexStride == 0)
+    {
+        _index.push_back(_fileSize + _staging.size());
+    }
+
+    const auto append = [this](const void* const data, const size_t length) {
+        const auto bytes = static_cast<const BYTE*>(data);
+        _staging.insert(_staging.end(), bytes, bytes + length);
+    };
+
+    append(&header, sizeof(header));
+    append(charRow.cbegin(), cellCount * sizeof(CharRowCell));
+    append(glyphs.data(), glyphs.size() * sizeof(wchar_t));
+    append(runs.data(), runs.size() * sizeof(AttrRunRecord));
+
+    ++_rowCount;
+
+    if (_staging.size() >= s_StagingLimit)
+    {
+        _Flush();
+    }
+}
+
+// Routine Description:
+// - Writes out any staged rows to the end of the file.
+// Note: will throw exception on I/O failure
+void ScrollbackSpill::_Flush()
+{
+    if (_staging.empty())
+    {
+        return;
+    }
+
+    LARGE_INTEGER position;
+    position.QuadPart = gsl::narrow<LONGLONG>(_fileSize);
+    THROW_IF_WIN32_BOOL_FALSE(SetFilePointerEx(_file.get(), position, nullptr, FILE_BEGIN));
+
+    DWORD written = 0;
+    THROW_IF_WIN32_BOOL_FALSE(WriteFile(_file.get(), _staging.data(), gsl::narrow<DWORD>(_staging.size()), &written, nullptr));
+    THROW_HR_IF(E_UNEXPECTED, written != _staging.size());
+
+    _fileSize += written;
+    _staging.clear();
+}
+
+// Routine Description:
+// - Makes sure the given byte range of the file is mapped into memory.
+// - Only one window is mapped at a time, so resident memory is bounded by the
+//   size of one indexed block of rows.
+// Arguments:
+// - start - offset of the first byte needed
+// - end - offset one past the last byte needed
+// Return Value:
+// - pointer to the byte at start
+// Note: will throw exception if the range can't be mapped
+const BYTE* ScrollbackSpill::_MapRange(const uint64_t start, const uint64_t end)
+{
+    if (_view && start >= _viewStart && end <= _viewEnd)
+    {
+        return _view.get() + (start - _viewStart);
+    }
+
+    _view.reset();
+
+    // A mapping object can't see past the size the file was when it was created.
+    if (!_mapping || end > _mappingSize)
+    {
+        _mapping.reset(CreateFileMappingW(_file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+        THROW_LAST_ERROR_IF(!_mapping);
+        _mappingSize = _fileSize;
+    }
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const uint64_t granularity = info.dwAllocationGranularity;
+    const uint64_t alignedStart = start - (start % granularity);
+
+    ULARGE_INTEGER offset;
+    offset.QuadPart = alignedStart;
+    _view.reset(static_cast<BYTE*>(MapViewOfFile(_mapping.get(),
+                                                 FILE_MAP_READ,
+                                                 offset.HighPart,
+                                                 offset.LowPart,
+                                                 gsl::narrow<SIZE_T>(end - alignedStart))));
+    THROW_LAST_ERROR_IF(!_view);
+
+    _viewStart = alignedStart;
+    _viewEnd = end;
+
+    return _view.get() + (start - _viewStart);
+}
+
+// Routine Description:
+// - Reads a spilled row back out of the file.
+// Arguments:
+// - index - 0 is the oldest row that was spilled
+// Return Value:
+// - the row's text (padded to its width, trailing bytes of double width glyphs skipped),
+//   attributes and wrap state.
+// Note: will throw exception if the index is out of range or on I/O failure
+ScrollbackSpill::SpilledRow ScrollbackSpill::ReadRow(const size_t index)
+{
+    const auto lock = _lock.lock_exclusive();
+
+    SpilledRow row;
+    _ReadRow(index, row);
+    return row;
+}
+
+// Routine Description:
+// - Reads a run of spilled rows back out of the file, under one hold of the lock.
+//   Rows that are already in the vector are read into again, so reading a long
+//   history a batch at a time only allocates for the first batch.
+// Arguments:
+// - first - the index of the first row to read. 0 is the oldest row that was spilled.
+// - count - how many rows to read. The run is clipped to the rows there are.
+// - rows - receives the rows, as ReadRow returns them. Resized to the rows that were read.
+// Note: will throw exception if first is out of range or on I/O failure
+void ScrollbackSpill::ReadRows(const size_t first, const size_t count, std::vector<SpilledRow>& rows)
+{
+    const auto lock = _lock.lock_exclusive();
+
+    THROW_HR_IF(E_BOUNDS, first >= _rowCount);
+
+    rows.resize(std::min(count, _rowCount - first));
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        _ReadRow(first + i, rows[i]);
+    }
+}
+
+// Routine Description:
+// - Reads a spilled row into the given one. The caller holds the lock.
+// Arguments:
+// - index - 0 is the oldest row that was spilled
+// - row - receives the row. Whatever it held before is replaced.
+// Note: will throw exception if the index is out of range or on I/O failure
+void ScrollbackSpill::_ReadRow(const size_t index, SpilledRow& row)
+{
+    THROW_HR_IF(E_BOUNDS, index >= _rowCount);
+
+    _Flush();
+
+    // Walk forward from the closest indexed row.
+    const size_t block = index / s_IndexStride;
+    const uint64_t blockStart = _index.at(block);
+    const uint64_t blockEnd = (block + 1 < _index.size()) ? _index.at(block + 1) : _fileSize;
+
+    const BYTE* record = _MapRange(blockStart, blockEnd);
+    const BYTE* const limit = record + (blockEnd - blockStart);
+
+    RecordHeader header;
+    for (size_t i = block * s_IndexStride; ; ++i)
+    {
+        THROW_HR_IF(E_UNEXPECTED, record + sizeof(header) > limit);
+        memcpy(&header, record, sizeof(header));
+        THROW_HR_IF(E_UNEXPECTED, record + _RecordSize(header) > limit);
+
+        if (i == index)
+        {
+            break;
+        }
+        record += _RecordSize(header);
+    }
+
+    const BYTE* const cellsStart = record + sizeof(header);
+    const BYTE* const glyphsStart = cellsStart + (header.cellCount * sizeof(CharRowCell));
+    const BYTE* const runsStart = glyphsStart + (header.glyphCount * sizeof(wchar_t));
+
+    // Stored glyphs, keyed by column.
+    std::vector<wchar_t> glyphData(header.glyphCount);
+    memcpy(glyphData.data(), glyphsStart, glyphData.size() * sizeof(wchar_t));
+    std::unordered_map<size_t, std::wstring_view> glyphs;
+    for (size_t i = 0; i + 1 < glyphData.size();)
+    {
+        const size_t column = glyphData[i];
+        const size_t length = glyphData[i + 1];
+        glyphs.emplace(column, std::wstring_view{ glyphData.data() + i + 2, length });
+        i += 2 + length;
+    }
+
+    row.width = header.width;
+    row.wrapForced = WI_IsFlagSet(header.flags, s_FlagWrapForced);
+    row.doubleBytePadded = WI_IsFlagSet(header.flags, s_FlagDoubleBytePadded);
+    row.text.clear();
+    row.text.reserve(header.width);
+    row.attributes.clear();
+    row.textOffsets.clear();
+    row.textOffsets.reserve(header.width + 1);
+
+    for (size_t column = 0; column < header.cellCount; ++column)
+    {
+        CharRowCell cell;
+        memcpy(&cell, cellsStart + (column * sizeof(CharRowCell)), sizeof(cell));
+
+        row.textOffsets.push_back(row.text.size());
+        if (cell.DbcsAttr().IsTrailing())
+        {
+            continue;
+        }
+
+        if (cell.DbcsAttr().IsGlyphStored())
+        {
+            const auto found = glyphs.find(column);
+            if (found != glyphs.end())
+            {
+                row.text.append(found->second);
+                continue;
+            }
+        }
+
+        row.text.push_back(cell.Char());
+    }
+    for (size_t column = header.cellCount; column < header.width; ++column)
+    {
+        row.textOffsets.push_back(row.text.size());
+        row.text.push_back(UNICODE_SPACE);
+    }
+    row.textOffsets.push_back(row.text.size());
+
+    row.attributes.reserve(header.attrRunCount);
+    for (size_t i = 0; i < header.attrRunCount; ++i)
+    {
+        AttrRunRecord run;
+        memcpy(&run, runsStart + (i * sizeof(AttrRunRecord)), sizeof(run));
+        row.attributes.emplace_back(run.length, run.attr);
+    }
+}
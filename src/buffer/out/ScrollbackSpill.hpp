@@ -0,0 +1,107 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ScrollbackSpill.hpp
+
+Abstract:
+- Append-only, memory-mapped backing store for rows that have been evicted from
+  the top of a TextBuffer. Rows are written in a compact format (trailing blank
+  cells trimmed, attributes run length encoded) to a temporary file and read back
+  lazily through a small mapped window, so resident memory stays bounded no matter
+  how much history has been spilled.
+- A sparse index stores the file offset of every Nth row. Finding any other row
+  means walking forward from the nearest indexed one.
+- Rows can be read on another thread while the buffer spills more, e.g. to export
+  the history. A lock of the spill's own guards the file and the index.
+
+--*/
+
+#pragma once
+
+#include "Row.hpp"
+#include "TextAttributeRun.hpp"
+
+class ScrollbackSpill final
+{
+public:
+    // A row that was read back from the spill file.
+    struct SpilledRow
+    {
+        size_t width;
+        bool wrapForced;
+        bool doubleBytePadded;
+        std::wstring text;
+        std::vector<TextAttributeRun> attributes;
+        // where in text each column starts, and then where the text ends. The
+        // trailing half of a double width glyph is where the glyph after it starts,
+        // so a run of columns that ends on the leading half still has the whole glyph.
+        std::vector<size_t> textOffsets;
+    };
+
+    ScrollbackSpill(const std::wstring_view path);
+    ~ScrollbackSpill() = default;
+
+    ScrollbackSpill(const ScrollbackSpill&) = delete;
+    ScrollbackSpill& operator=(const ScrollbackSpill&) = delete;
+
+    static std::unique_ptr<ScrollbackSpill> CreateInTempDirectory();
+
+    void Append(const ROW& row);
+
+    size_t size() const noexcept;
+    size_t GetMemoryUsage() const noexcept;
+    Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+    SpilledRow ReadRow(const size_t index);
+    void ReadRows(const size_t first, const size_t count, std::vector<SpilledRow>& rows);
+
+private:
+    // the sparse index keeps the offset of every s_IndexStride'th row.
+    static constexpr size_t s_IndexStride = 64;
+
+    // rows are staged in memory and written out in chunks of about this size.
+    static constexpr size_t s_StagingLimit = 64 * 1024;
+
+#pragma pack(push, 1)
+    struct RecordHeader
+    {
+        uint16_t width;
+        uint16_t cellCount;
+        uint16_t glyphCount;
+        uint16_t attrRunCount;
+        uint8_t flags;
+    };
+
+    struct AttrRunRecord
+    {
+        uint16_t length;
+        TextAttribute attr;
+    };
+#pragma pack(pop)
+
+    static constexpr uint8_t s_FlagWrapForced = 0x1;
+    static constexpr uint8_t s_FlagDoubleBytePadded = 0x2;
+
+    // guards everything below it.
+    mutable wil::srwlock _lock;
+
+    wil::unique_hfile _file;
+    uint64_t _fileSize;
+
+    std::vector<BYTE> _staging;
+    std::vector<uint64_t> _index;
+    size_t _rowCount;
+
+    // the currently mapped window of the file
+    wil::unique_handle _mapping;
+    uint64_t _mappingSize;
+    wil::unique_mapview_ptr<BYTE> _view;
+    uint64_t _viewStart;
+    uint64_t _viewEnd;
+
+    void _Flush();
+    void _ReadRow(const size_t index, SpilledRow& row);
+    const BYTE* _MapRange(const uint64_t start, const uint64_t end);
+    static size_t _RecordSize(const RecordHeader& header) noexcept;
+};
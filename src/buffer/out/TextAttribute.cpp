@@ -222,6 +222,15 @@ void TextAttribute::Invert() noexcept
     WI_ToggleFlag(_wAttrLegacy, COMMON_LVB_REVERSE_VIDEO);
 }
 
+// Routine Description:
+// - makes the text with this attribute a link, or stops it from being one
+// Arguments:
+// - hyperlinkId - the link's handle in the text buffer's HyperlinkTable, or 0 for no link
+void TextAttribute::SetHyperlinkId(const uint16_t hyperlinkId) noexcept
+{
+    _hyperlinkId = hyperlinkId;
+}
+
 void TextAttribute::_SetBoldness(const bool isBold) noexcept
 {
     _isBold = isBold;
@@ -34,6 +34,7 @@ public:
         _wAttrLegacy{ 0 },
         _foreground{},
         _background{},
+        _hyperlinkId{ 0 },
         _isBold{ false }
     {
     }
@@ -42,6 +43,7 @@ public:
         _wAttrLegacy{ static_cast<WORD>(wLegacyAttr & META_ATTRS) },
         _foreground{ static_cast<BYTE>(wLegacyAttr & FG_ATTRS) },
         _background{ static_cast<BYTE>((wLegacyAttr & BG_ATTRS) >> 4) },
+        _hyperlinkId{ 0 },
         _isBold{ false }
     {
         // If we're given lead/trailing byte information with the legacy color, strip it.
@@ -53,6 +55,7 @@ public:
         _wAttrLegacy{ 0 },
         _foreground{ rgbForeground },
         _background{ rgbBackground },
+        _hyperlinkId{ 0 },
         _isBold{ false }
     {
     }
@@ -148,6 +151,20 @@ public:
         return _foreground.IsRgb() || _background.IsRgb();
     }
 
+    // Hyperlinks (OSC 8) are kept in the text buffer's HyperlinkTable, and the
+    //      attribute only holds the link's handle in it. 0 means the text isn't a link.
+    constexpr uint16_t GetHyperlinkId() const noexcept
+    {
+        return _hyperlinkId;
+    }
+
+    constexpr bool IsHyperlink() const noexcept
+    {
+        return _hyperlinkId != 0;
+    }
+
+    void SetHyperlinkId(const uint16_t hyperlinkId) noexcept;
+
 private:
     COLORREF _GetRgbForeground(std::basic_string_view<COLORREF> colorTable,
                                COLORREF defaultColor) const;
@@ -159,11 +176,16 @@ private:
     WORD _wAttrLegacy;
     TextColor _foreground;
     TextColor _background;
+    uint16_t _hyperlinkId;
     bool _isBold;
 
+    friend struct std::hash<TextAttribute>;
+    friend class ResolvedColorTable;
+
 #ifdef UNIT_TESTING
     friend class TextBufferTests;
     friend class TextAttributeTests;
+    friend class ResolvedColorTableTests;
     template<typename TextAttribute> friend class WEX::TestExecution::VerifyOutputTraits;
 #endif
 };
@@ -180,6 +202,7 @@ constexpr bool operator==(const TextAttribute& a, const TextAttribute& b) noexce
     return a._wAttrLegacy == b._wAttrLegacy &&
            a._foreground == b._foreground &&
            a._background == b._background &&
+           a._hyperlinkId == b._hyperlinkId &&
            a._isBold == b._isBold;
 }
 
@@ -208,6 +231,31 @@ constexpr bool operator!=(const WORD& legacyAttr, const TextAttribute& attr) noe
     return !(attr == legacyAttr);
 }
 
+namespace std
+{
+    template <>
+    struct hash<TextAttribute>
+    {
+        // Routine Description:
+        // - hashes a text attribute by mixing the hashes of its two colors with its
+        //   legacy meta attributes, hyperlink and boldness.
+        // Arguments:
+        // - attr - the attribute to hash
+        // Return Value:
+        // - the hashed attribute
+        size_t operator()(const TextAttribute& attr) const noexcept
+        {
+            const std::hash<TextColor> colorHash;
+            size_t retVal = colorHash(attr._foreground);
+            retVal ^= colorHash(attr._background) * 0x9E3779B1u;
+            retVal ^= static_cast<size_t>(attr._wAttrLegacy) << 5;
+            retVal ^= static_cast<size_t>(attr._hyperlinkId) * 0x85EBCA6Bu;
+            retVal ^= attr._isBold ? 1 : 0;
+            return retVal;
+        }
+    };
+}
+
 #ifdef UNIT_TESTING
 
 #define LOG_ATTR(attr) (Log::Comment(NoThrowString().Format(\
@@ -222,11 +270,12 @@ namespace WEX {
             static WEX::Common::NoThrowString ToString(const TextAttribute& attr)
             {
                 return WEX::Common::NoThrowString().Format(
-                    L"{FG:%s,BG:%s,bold:%d,wLegacy:(0x%04x)}",
+                    L"{FG:%s,BG:%s,bold:%d,wLegacy:(0x%04x),link:%u}",
                     VerifyOutputTraits<TextColor>::ToString(attr._foreground).GetBuffer(),
                     VerifyOutputTraits<TextColor>::ToString(attr._background).GetBuffer(),
                     attr.IsBold(),
-                    attr._wAttrLegacy
+                    attr._wAttrLegacy,
+                    attr._hyperlinkId
                 );
             }
         };
@@ -0,0 +1,128 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "TextAttributePalette.hpp"
+
+// Once a table has this few handles left, the owning buffer should compact it at its
+// next opportunity so that writes don't run out of them.
+static constexpr size_t s_CompactionSlack = 4096;
+
+// Routine Description:
+// - constructor. The fallback handle always refers to the default attribute.
+// Return Value:
+// - constructed object
+// Note: will throw exception if unable to allocate memory for the table
+TextAttributePalette::TextAttributePalette() :
+    _entries{},
+    _handles{},
+    _lastAttr{},
+    _lastHandle{ FallbackHandle },
+    _compactAt{ MaxEntries - s_CompactionSlack },
+    _overflowCount{ 0 }
+{
+    _entries.emplace_back(_lastAttr);
+    _handles.emplace(_lastAttr, FallbackHandle);
+}
+
+// Routine Description:
+// - Gets the handle for the given attribute, adding it to the table if it isn't there yet.
+// Arguments:
+// - attr - the attribute to look up
+// Return Value:
+// - the handle for attr. If the table is full and attr isn't already in it,
+//   the fallback handle is returned instead, and it's counted as an overflow
+//   so that the owning buffer can compact the table and try again.
+// Note: will throw exception if unable to allocate memory for the new entry
+TextAttributePalette::handle_type TextAttributePalette::Intern(const TextAttribute& attr)
+{
+    if (attr == _lastAttr)
+    {
+        return _lastHandle;
+    }
+
+    handle_type handle = FallbackHandle;
+    const auto found = _handles.find(attr);
+    if (found != _handles.end())
+    {
+        handle = found->second;
+    }
+    else if (_entries.size() < MaxEntries)
+    {
+        handle = gsl::narrow_cast<handle_type>(_entries.size());
+        _entries.emplace_back(attr);
+        _handles.emplace(attr, handle);
+    }
+    else
+    {
+        // Out of handles. Don't remember this miss so the next lookup tries again.
+        ++_overflowCount;
+        return FallbackHandle;
+    }
+
+    _lastAttr = attr;
+    _lastHandle = handle;
+    return handle;
+}
+
+// Routine Description:
+// - Gets the attribute for a handle that was returned by Intern.
+// Arguments:
+// - handle - the handle to look up
+// Return Value:
+// - the attribute. The reference stays valid for as long as the table does.
+const TextAttribute& TextAttributePalette::Lookup(const handle_type handle) const noexcept
+{
+    return _entries[handle];
+}
+
+// Routine Description:
+// - Gets the number of distinct attributes in the table.
+size_t TextAttributePalette::size() const noexcept
+{
+    return _entries.size();
+}
+
+// Routine Description:
+// - Estimates the number of bytes allocated on the heap for the table. Hash nodes
+//   are counted as their value plus a pair of pointers.
+size_t TextAttributePalette::GetMemoryUsage() const noexcept
+{
+    return MeasureMemory().bytes;
+}
+
+// Routine Description:
+// - Estimates the bytes allocated on the heap for the table, and how many
+//   allocations they're in. The blocks of a deque only hold one of anything as
+//   big as an attribute, so each entry is an allocation of its own.
+Microsoft::Console::Types::MemoryUsage TextAttributePalette::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.bytes += _entries.size() * sizeof(TextAttribute);
+    usage.allocations += _entries.size();
+    usage.AddHashTable(_handles);
+    return usage;
+}
+
+// Routine Description:
+// - Tells whether the table is close to running out of handles and should be compacted.
+bool TextAttributePalette::NeedsCompaction() const noexcept
+{
+    return _entries.size() >= _compactAt;
+}
+
+// Routine Description:
+// - Called on a freshly compacted table. Holds off on asking for another compaction
+//   until a reasonable number of new attributes have been added.
+void TextAttributePalette::DeferCompaction() noexcept
+{
+    _compactAt = std::max(_compactAt, std::min(_entries.size() + s_CompactionSlack, MaxEntries));
+}
+
+// Routine Description:
+// - Gets how many times Intern has handed out the fallback handle because the table was full.
+size_t TextAttributePalette::GetOverflowCount() const noexcept
+{
+    return _overflowCount;
+}
+
@@ -0,0 +1,64 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- TextAttributePalette.hpp
+
+Abstract:
+- Intern table for the text attributes used by one text buffer. Attribute runs
+  store a 16-bit handle into this table instead of a full TextAttribute, so
+  comparing two runs is an integer compare and a row full of truecolor runs
+  stays small.
+--*/
+
+#pragma once
+
+#include "TextAttribute.hpp"
+#include "../types/inc/MemoryUsage.hpp"
+
+#include <deque>
+#include <unordered_map>
+
+class TextAttributePalette final
+{
+public:
+    using handle_type = typename uint16_t;
+
+    TextAttributePalette();
+
+    handle_type Intern(const TextAttribute& attr);
+    const TextAttribute& Lookup(const handle_type handle) const noexcept;
+
+    size_t size() const noexcept;
+    size_t GetMemoryUsage() const noexcept;
+    Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+
+    bool NeedsCompaction() const noexcept;
+    void DeferCompaction() noexcept;
+    size_t GetOverflowCount() const noexcept;
+
+    // handed out once the table is full and an attribute can't be added to it.
+    static constexpr handle_type FallbackHandle = 0;
+
+    static constexpr size_t MaxEntries = static_cast<size_t>(std::numeric_limits<handle_type>::max()) + 1;
+
+private:
+    // a deque so that references returned by Lookup stay valid as entries are added.
+    std::deque<TextAttribute> _entries;
+    std::unordered_map<TextAttribute, handle_type> _handles;
+
+    // most writes use the same attribute as the one before, so remember it.
+    TextAttribute _lastAttr;
+    handle_type _lastHandle;
+
+    // the size at which the owning buffer should rebuild the table.
+    size_t _compactAt;
+
+    // how many times an attribute got the fallback handle because the table was full.
+    size_t _overflowCount;
+
+#ifdef UNIT_TESTING
+    friend class TextAttributePaletteTests;
+#endif
+};
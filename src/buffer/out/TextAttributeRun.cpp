@@ -56,3 +56,45 @@ void TextAttributeRun::SetAttributesFromLegacy(const WORD wNew) noexcept
 {
     _attributes.SetFromLegacy(wNew);
 }
+
+InternedAttributeRun::InternedAttributeRun() noexcept :
+    _cchLength{ 0 },
+    _handle{ TextAttributePalette::FallbackHandle }
+{
+}
+
+InternedAttributeRun::InternedAttributeRun(const size_t cchLength, const handle_type handle) noexcept :
+    _cchLength{ gsl::narrow_cast<uint16_t>(cchLength) },
+    _handle{ handle }
+{
+}
+
+size_t InternedAttributeRun::GetLength() const noexcept
+{
+    return _cchLength;
+}
+
+void InternedAttributeRun::SetLength(const size_t cchLength) noexcept
+{
+    _cchLength = gsl::narrow_cast<uint16_t>(cchLength);
+}
+
+void InternedAttributeRun::IncrementLength() noexcept
+{
+    _cchLength++;
+}
+
+void InternedAttributeRun::DecrementLength() noexcept
+{
+    _cchLength--;
+}
+
+InternedAttributeRun::handle_type InternedAttributeRun::GetHandle() const noexcept
+{
+    return _handle;
+}
+
+void InternedAttributeRun::SetHandle(const handle_type handle) noexcept
+{
+    _handle = handle;
+}
@@ -21,6 +21,7 @@ Revision History:
 #pragma once
 
 #include "TextAttribute.hpp"
+#include "TextAttributePalette.hpp"
 
 class TextAttributeRun final
 {
@@ -45,3 +46,28 @@ private:
     friend class AttrRowTests;
 #endif
 };
+
+// The form of a run that ATTR_ROW actually stores: a length and a handle into
+// the text buffer's TextAttributePalette. Row widths fit in a SHORT, so the length
+// does too, and the whole run packs into 4 bytes.
+class InternedAttributeRun final
+{
+public:
+    using handle_type = typename TextAttributePalette::handle_type;
+
+    InternedAttributeRun() noexcept;
+    InternedAttributeRun(const size_t cchLength, const handle_type handle) noexcept;
+
+    size_t GetLength() const noexcept;
+    void SetLength(const size_t cchLength) noexcept;
+    void IncrementLength() noexcept;
+    void DecrementLength() noexcept;
+
+    handle_type GetHandle() const noexcept;
+    void SetHandle(const handle_type handle) noexcept;
+
+private:
+    uint16_t _cchLength;
+    handle_type _handle;
+};
+
@@ -0,0 +1,567 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "TextBufferExport.hpp"
+
+#pragma hdrstop
+
+// Routine Description:
+// - Gets how many of a buffer's rows are in use: the ones down to the last text,
+//   or to the cursor if it's further down. The empty rows below that are left out.
+static size_t s_RowsInUse(const TextBuffer& buffer)
+{
+    const auto lastText = buffer.GetLastNonSpaceCharacter().Y;
+    const auto cursor = buffer.GetCursor().GetPosition().Y;
+    return gsl::narrow<size_t>(std::max(lastText, cursor)) + 1;
+}
+
+// Routine Description:
+// - Formats a color the way CSS takes it. Alpha is left out.
+static std::wstring s_HtmlColor(const COLORREF color)
+{
+    wchar_t text[8];
+    swprintf_s(text, L"#%02x%02x%02x", GetRValue(color), GetGValue(color), GetBValue(color));
+    return text;
+}
+
+// Routine Description:
+// - Starts exporting a buffer to a file. The snapshot of the buffer is taken right
+//   away, so the caller should hold whatever lock guards the buffer, and can let
+//   it go as soon as this returns. The export goes on on a thread of its own.
+// - Only the rows the buffer has spilled so far are exported. If it spills more
+//   while the export is going, those rows are in the snapshot still.
+// Arguments:
+// - buffer - the buffer to export
+// - colors - what the buffer's colors are painted as, for the VT and HTML formats
+// - path - the file to write. An existing file is replaced.
+// - format - what to write the rows as
+// Return Value:
+// - constructed object
+// Note: will throw exception if the file can't be created or the snapshot can't be taken
+TextBufferExport::TextBufferExport(TextBuffer& buffer,
+                                   const ResolvedColorTable& colors,
+                                   const std::wstring_view path,
+                                   const Format format) :
+    _renderTarget{},
+    _snapshot{ buffer.CreateSnapshot(_renderTarget) },
+    _bufferRows{ s_RowsInUse(buffer) },
+    _spill{ buffer.GetScrollbackSpill() },
+    _spilledRows{ _spill ? _spill->size() : 0 },
+    _colors{ colors },
+    _format{ format },
+    _text{},
+    _runs{},
+    _pending{},
+    _lastAttr{},
+    _lastHyperlinkId{ 0 },
+    _cancel{ false },
+    _done{ false },
+    _rowsWritten{ 0 },
+    _result{ S_OK },
+    _thread{}
+{
+    const std::wstring filePath{ path };
+    _file.reset(CreateFileW(filePath.c_str(),
+                            GENERIC_WRITE,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr));
+    THROW_LAST_ERROR_IF(!_file);
+
+    _pending.reserve(s_WriteLimit + s_WriteLimit / 4);
+
+    _thread = std::thread([this]() noexcept {
+        try
+        {
+            _Export();
+            _result = _cancel ? HRESULT_FROM_WIN32(ERROR_CANCELLED) : S_OK;
+        }
+        catch (...)
+        {
+            _result = LOG_CAUGHT_EXCEPTION();
+        }
+        _done = true;
+    });
+}
+
+// Routine Description:
+// - Stops the export, if it's still going, and waits for its thread. What's been
+//   written stays in the file.
+TextBufferExport::~TextBufferExport()
+{
+    Cancel();
+    LOG_IF_FAILED(Wait());
+}
+
+// Routine Description:
+// - Asks the export to stop after the row it's on. This doesn't wait for it.
+void TextBufferExport::Cancel() noexcept
+{
+    _cancel = true;
+}
+
+// Routine Description:
+// - Tells whether the export has finished, successfully or not.
+bool TextBufferExport::IsDone() const noexcept
+{
+    return _done;
+}
+
+// Routine Description:
+// - Waits for the export to finish. Only one thread should wait at a time.
+// Return Value:
+// - S_OK if every row was written, HRESULT_FROM_WIN32(ERROR_CANCELLED) if the
+//   export was cancelled, or else the error it stopped at.
+[[nodiscard]]
+HRESULT TextBufferExport::Wait() noexcept
+{
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+    return _result;
+}
+
+// Routine Description:
+// - Gets how many rows the export writes in all, spilled ones included.
+size_t TextBufferExport::GetRowCount() const noexcept
+{
+    return _spilledRows + _bufferRows;
+}
+
+// Routine Description:
+// - Gets how many rows have been written so far, to show how far along the export is.
+size_t TextBufferExport::GetRowsWritten() const noexcept
+{
+    return _rowsWritten;
+}
+
+// Routine Description:
+// - The export's thread. Writes the rows from the oldest down, the spilled ones first.
+// Note: will throw exception on I/O failure
+void TextBufferExport::_Export()
+{
+    _WriteHeader();
+    _ExportSpilledRows();
+    _ExportBufferRows();
+    if (!_cancel)
+    {
+        _WriteFooter();
+    }
+    _Flush();
+}
+
+// Routine Description:
+// - Writes the rows the buffer had spilled when the export started. They're read a
+//   batch at a time, so the buffer's only kept from spilling more for a moment.
+// Note: will throw exception on I/O failure
+void TextBufferExport::_ExportSpilledRows()
+{
+    std::vector<ScrollbackSpill::SpilledRow> rows;
+    for (size_t first = 0; first < _spilledRows && !_cancel; first += s_BatchRows)
+    {
+        _spill->ReadRows(first, std::min(s_BatchRows, _spilledRows - first), rows);
+        for (const auto& row : rows)
+        {
+            _text.assign(row.text);
+            _runs.clear();
+
+            size_t column = 0;
+            for (const auto& run : row.attributes)
+            {
+                const auto end = std::min(column + run.GetLength(), row.width);
+                _AddRun(row.textOffsets.at(end) - row.textOffsets.at(column), run.GetAttributes());
+                column = end;
+            }
+            if (column < row.width)
+            {
+                _AddRun(_text.size() - row.textOffsets.at(column), _runs.empty() ? TextAttribute{} : _runs.back().attr);
+            }
+
+            _WriteRow(row.wrapForced);
+        }
+    }
+}
+
+// Routine Description:
+// - Writes the rows of the snapshot, from the top of the buffer down. Cold rows are
+//   decoded into a scratch row, without being unpacked.
+// Note: will throw exception on I/O failure
+void TextBufferExport::_ExportBufferRows()
+{
+    std::optional<ROW> scratch;
+    for (size_t y = 0; y < _bufferRows && !_cancel; ++y)
+    {
+        const ROW& row = std::as_const(*_snapshot).GetRowByOffset(y, scratch);
+        const CharRow& charRow = row.GetCharRow();
+        _text.clear();
+        _runs.clear();
+
+        // Go a run of attributes at a time, the same way GetSelectedText does.
+        for (size_t column = 0; column < charRow.size();)
+        {
+            size_t applies = 0;
+            const auto attr = row.GetAttrRow().GetAttrByColumn(column, &applies);
+            const size_t runEnd = std::min(column + std::max<size_t>(applies, 1), charRow.size());
+
+            const size_t runStart = _text.size();
+            if (charRow.IsNarrowOnly())
+            {
+                std::transform(charRow.cbegin() + column,
+                               charRow.cbegin() + runEnd,
+                               std::back_inserter(_text),
+                               [](const CharRowCell& cell) noexcept { return cell.Char(); });
+            }
+            else
+            {
+                for (size_t glyphColumn = column; glyphColumn < runEnd; ++glyphColumn)
+                {
+                    if (!charRow.DbcsAttrAt(glyphColumn).IsTrailing())
+                    {
+                        const std::wstring_view glyph = charRow.GlyphAt(glyphColumn);
+                        _text.append(glyph);
+                    }
+                }
+            }
+
+            _AddRun(_text.size() - runStart, attr);
+            column = runEnd;
+        }
+
+        _WriteRow(charRow.WasWrapForced());
+    }
+}
+
+// Routine Description:
+// - Adds some of the row's text in the given attributes, joining it to the last run if it's the same.
+// Arguments:
+// - length - how many characters at the end of _text are in the attributes
+// - attr - the attributes of the text
+void TextBufferExport::_AddRun(const size_t length, const TextAttribute& attr)
+{
+    if (length == 0)
+    {
+        return;
+    }
+    if (!_runs.empty() && _runs.back().attr == attr)
+    {
+        _runs.back().length += length;
+    }
+    else
+    {
+        _runs.push_back({ length, attr });
+    }
+}
+
+// Routine Description:
+// - Writes the row in _text and _runs out in the export's format.
+// - A row that doesn't wrap has its trailing spaces left out, and ends the line.
+//   Spaces that would show, because of their background or their underline, are
+//   kept in the VT and HTML, so a line that's colored to the edge still is.
+// Arguments:
+// - wrapForced - true if the row goes on into the next one
+// Note: will throw exception on I/O failure
+void TextBufferExport::_WriteRow(const bool wrapForced)
+{
+    if (!wrapForced)
+    {
+        while (!_runs.empty())
+        {
+            auto& run = _runs.back();
+            const auto meta = run.attr.GetMetaAttributes();
+            if (_format != Format::PlainText &&
+                (!run.attr.BackgroundIsDefault() || WI_IsAnyFlagSet(meta, COMMON_LVB_REVERSE_VIDEO | COMMON_LVB_UNDERSCORE)))
+            {
+                break;
+            }
+
+            const size_t runStart = _text.size() - run.length;
+            const auto lastNonSpace = _text.find_last_not_of(UNICODE_SPACE);
+            const size_t keep = (lastNonSpace == std::wstring::npos || lastNonSpace < runStart) ? runStart : lastNonSpace + 1;
+            run.length -= _text.size() - keep;
+            _text.erase(keep);
+            if (run.length != 0)
+            {
+                break;
+            }
+            _runs.pop_back();
+        }
+    }
+
+    size_t start = 0;
+    for (const auto& run : _runs)
+    {
+        const std::wstring_view text{ _text.data() + start, run.length };
+        switch (_format)
+        {
+        case Format::Vt:
+            _WriteVtAttributes(run.attr);
+            _Append(text);
+            break;
+        case Format::Html:
+            _WriteHtmlAttributes(run.attr);
+            _WriteHtmlText(text);
+            break;
+        default:
+            _Append(text);
+            break;
+        }
+        start += run.length;
+    }
+
+    if (!wrapForced)
+    {
+        _Append(L"\r\n");
+    }
+
+    ++_rowsWritten;
+    if (_pending.size() >= s_WriteLimit)
+    {
+        _Flush();
+    }
+}
+
+// Routine Description:
+// - Writes what comes before the rows. Only the HTML has anything there: the page
+//   is laid out in the buffer's default colors, and the runs only change them.
+void TextBufferExport::_WriteHeader()
+{
+    if (_format != Format::Html)
+    {
+        return;
+    }
+
+    const TextAttribute defaults{};
+    _Append(L"<!DOCTYPE html>\r\n<html>\r\n<head>\r\n<meta charset=\"utf-8\">\r\n</head>\r\n<body>\r\n");
+    _Append(L"<pre style=\"font-family:monospace;color:");
+    _Append(s_HtmlColor(_colors.GetForeground(defaults)));
+    _Append(L";background-color:");
+    _Append(s_HtmlColor(_colors.GetBackground(defaults)));
+    _Append(L"\">");
+}
+
+// Routine Description:
+// - Closes whatever the rows left open, so that what's written after the file
+//   (say, when it's cat'd to a terminal) isn't in the last row's colors.
+void TextBufferExport::_WriteFooter()
+{
+    switch (_format)
+    {
+    case Format::Vt:
+        if (_lastHyperlinkId != 0)
+        {
+            _Append(L"\x1b]8;;\x1b\\");
+        }
+        _Append(L"\x1b[0m");
+        break;
+    case Format::Html:
+        if (_lastAttr)
+        {
+            _Append(L"</span>");
+        }
+        if (_lastHyperlinkId != 0)
+        {
+            _Append(L"</a>");
+        }
+        _Append(L"</pre>\r\n</body>\r\n</html>\r\n");
+        break;
+    default:
+        break;
+    }
+}
+
+// Routine Description:
+// - Switches the VT output to the given attributes, if it isn't in them already.
+// - The colors are written as RGB, as they were painted, so the file looks the same
+//   whatever palette the terminal that shows it has. Default colors stay default.
+//   Reverse video is written as such, with the colors as they'd be without it.
+// Arguments:
+// - attr - the attributes of the text that's about to be written
+void TextBufferExport::_WriteVtAttributes(const TextAttribute& attr)
+{
+    const auto hyperlinkId = attr.GetHyperlinkId();
+    if (hyperlinkId != _lastHyperlinkId)
+    {
+        _Append(L"\x1b]8;;");
+        _Append(_snapshot->GetHyperlinkUri(hyperlinkId));
+        _Append(L"\x1b\\");
+        _lastHyperlinkId = hyperlinkId;
+    }
+
+    auto colors = attr;
+    colors.SetHyperlinkId(0);
+    if (_lastAttr == colors)
+    {
+        return;
+    }
+    _lastAttr = colors;
+
+    const auto meta = colors.GetMetaAttributes();
+    colors.SetMetaAttributes(meta & ~COMMON_LVB_REVERSE_VIDEO);
+
+    const auto appendColor = [](std::wstring& sgr, const wchar_t* const intro, const COLORREF color) {
+        sgr.append(intro);
+        sgr.append(std::to_wstring(GetRValue(color))).push_back(L';');
+        sgr.append(std::to_wstring(GetGValue(color))).push_back(L';');
+        sgr.append(std::to_wstring(GetBValue(color)));
+    };
+
+    std::wstring sgr{ L"\x1b[0" };
+    if (colors.IsBold())
+    {
+        sgr.append(L";1");
+    }
+    if (WI_IsFlagSet(meta, COMMON_LVB_UNDERSCORE))
+    {
+        sgr.append(L";4");
+    }
+    if (WI_IsFlagSet(meta, COMMON_LVB_REVERSE_VIDEO))
+    {
+        sgr.append(L";7");
+    }
+    if (!colors.ForegroundIsDefault())
+    {
+        appendColor(sgr, L";38;2;", _colors.GetForeground(colors));
+    }
+    if (!colors.BackgroundIsDefault())
+    {
+        appendColor(sgr, L";48;2;", _colors.GetBackground(colors));
+    }
+    sgr.push_back(L'm');
+    _Append(sgr);
+}
+
+// Routine Description:
+// - Starts a span in the given attributes, closing the last one, if the HTML isn't
+//   in them already. A link is an anchor around the spans of its text.
+// Arguments:
+// - attr - the attributes of the text that's about to be written
+void TextBufferExport::_WriteHtmlAttributes(const TextAttribute& attr)
+{
+    const auto hyperlinkId = attr.GetHyperlinkId();
+    auto colors = attr;
+    colors.SetHyperlinkId(0);
+    if (_lastAttr == colors && hyperlinkId == _lastHyperlinkId)
+    {
+        return;
+    }
+
+    if (_lastAttr)
+    {
+        _Append(L"</span>");
+    }
+    if (hyperlinkId != _lastHyperlinkId)
+    {
+        if (_lastHyperlinkId != 0)
+        {
+            _Append(L"</a>");
+        }
+        if (hyperlinkId != 0)
+        {
+            _Append(L"<a href=\"");
+            _WriteHtmlText(_snapshot->GetHyperlinkUri(hyperlinkId));
+            _Append(L"\">");
+        }
+        _lastHyperlinkId = hyperlinkId;
+    }
+    _lastAttr = colors;
+
+    _Append(L"<span style=\"color:");
+    _Append(s_HtmlColor(_colors.GetForeground(colors)));
+    _Append(L";background-color:");
+    _Append(s_HtmlColor(_colors.GetBackground(colors)));
+    if (colors.IsBold())
+    {
+        _Append(L";font-weight:bold");
+    }
+    if (WI_IsFlagSet(colors.GetMetaAttributes(), COMMON_LVB_UNDERSCORE))
+    {
+        _Append(L";text-decoration:underline");
+    }
+    _Append(L"\">");
+}
+
+// Routine Description:
+// - Writes some text into the HTML, escaping what would be taken for markup.
+// Arguments:
+// - text - the text to write
+void TextBufferExport::_WriteHtmlText(const std::wstring_view text)
+{
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        const wchar_t* escaped = nullptr;
+        switch (text[i])
+        {
+        case L'&':
+            escaped = L"&amp;";
+            break;
+        case L'<':
+            escaped = L"&lt;";
+            break;
+        case L'>':
+            escaped = L"&gt;";
+            break;
+        case L'"':
+            escaped = L"&quot;";
+            break;
+        default:
+            continue;
+        }
+        _Append(text.substr(start, i - start));
+        _Append(escaped);
+        start = i + 1;
+    }
+    _Append(text.substr(start));
+}
+
+// Routine Description:
+// - Adds some text to the output, as UTF-8. It's written out by _Flush.
+// Arguments:
+// - text - the text to add. Surrogate pairs mustn't be split between calls.
+// Note: will throw exception if the text can't be converted
+void TextBufferExport::_Append(const std::wstring_view text)
+{
+    if (text.empty())
+    {
+        return;
+    }
+
+    // Every UTF-16 code unit is at most 3 bytes of UTF-8. A pair is 4, for 2 units.
+    const auto start = _pending.size();
+    _pending.resize(start + text.size() * 3);
+    const auto written = WideCharToMultiByte(CP_UTF8,
+                                             0,
+                                             text.data(),
+                                             gsl::narrow<int>(text.size()),
+                                             _pending.data() + start,
+                                             gsl::narrow<int>(text.size() * 3),
+                                             nullptr,
+                                             nullptr);
+    if (written == 0)
+    {
+        _pending.resize(start);
+        THROW_LAST_ERROR();
+    }
+    _pending.resize(start + written);
+}
+
+// Routine Description:
+// - Writes out the output that's built up so far.
+// Note: will throw exception on I/O failure
+void TextBufferExport::_Flush()
+{
+    if (_pending.empty())
+    {
+        return;
+    }
+
+    DWORD written = 0;
+    THROW_IF_WIN32_BOOL_FALSE(WriteFile(_file.get(), _pending.data(), gsl::narrow<DWORD>(_pending.size()), &written, nullptr));
+    THROW_HR_IF(E_UNEXPECTED, written != _pending.size());
+    _pending.clear();
+}
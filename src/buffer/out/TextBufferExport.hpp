@@ -0,0 +1,110 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- TextBufferExport.hpp
+
+Abstract:
+- Writes everything a text buffer holds - the rows it spilled to disk, and then
+  its own rows, cold ones included - to a file, as plain text, as VT that keeps
+  the colors and styles (and links), or as an HTML page.
+- The export works from a snapshot of the buffer that's taken when it starts, on
+  a thread of its own, so the buffer can go on taking output meanwhile. Nothing
+  in the export sees that output.
+- Rows are read a batch at a time and the output is written out whenever a chunk
+  of it has built up, so memory stays the same however long the history is.
+--*/
+
+#pragma once
+
+#include "textBuffer.hpp"
+#include "ResolvedColorTable.hpp"
+#include "ScrollbackSpill.hpp"
+#include "../renderer/inc/DummyRenderTarget.hpp"
+
+class TextBufferExport final
+{
+public:
+    enum class Format
+    {
+        PlainText,
+        Vt,
+        Html
+    };
+
+    TextBufferExport(TextBuffer& buffer,
+                     const ResolvedColorTable& colors,
+                     const std::wstring_view path,
+                     const Format format);
+    ~TextBufferExport();
+
+    TextBufferExport(const TextBufferExport&) = delete;
+    TextBufferExport& operator=(const TextBufferExport&) = delete;
+
+    void Cancel() noexcept;
+    bool IsDone() const noexcept;
+    [[nodiscard]]
+    HRESULT Wait() noexcept;
+
+    size_t GetRowCount() const noexcept;
+    size_t GetRowsWritten() const noexcept;
+
+private:
+    // how many spilled rows are read under one hold of the spill's lock.
+    static constexpr size_t s_BatchRows = 256;
+
+    // the output is written out to the file in chunks of about this size.
+    static constexpr size_t s_WriteLimit = 64 * 1024;
+
+    // A stretch of a row's text that's all in the same attributes.
+    struct _Run
+    {
+        size_t length; // in characters of the text
+        TextAttribute attr;
+    };
+
+    // The snapshot never sends render notifications anywhere.
+    DummyRenderTarget _renderTarget;
+    std::unique_ptr<TextBuffer> _snapshot;
+    const size_t _bufferRows;
+
+    // Not owned. The buffer the export was taken of keeps its spill, and has
+    //      to outlive the export, or at least keep its spill until then.
+    ScrollbackSpill* const _spill;
+    const size_t _spilledRows;
+
+    const ResolvedColorTable _colors;
+    const Format _format;
+    wil::unique_hfile _file;
+
+    // The row being written, and the output that hasn't been written out yet.
+    std::wstring _text;
+    std::vector<_Run> _runs;
+    std::string _pending;
+
+    // What the output was last left in, so only changes are written.
+    std::optional<TextAttribute> _lastAttr;
+    uint16_t _lastHyperlinkId;
+
+    std::atomic<bool> _cancel;
+    std::atomic<bool> _done;
+    std::atomic<size_t> _rowsWritten;
+    HRESULT _result;
+    std::thread _thread;
+
+    void _Export();
+    void _ExportSpilledRows();
+    void _ExportBufferRows();
+
+    void _AddRun(const size_t length, const TextAttribute& attr);
+    void _WriteRow(const bool wrapForced);
+    void _WriteHeader();
+    void _WriteFooter();
+    void _WriteVtAttributes(const TextAttribute& attr);
+    void _WriteHtmlAttributes(const TextAttribute& attr);
+    void _WriteHtmlText(const std::wstring_view text);
+
+    void _Append(const std::wstring_view text);
+    void _Flush();
+};
@@ -0,0 +1,388 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "TextBufferRegex.hpp"
+#include "CharRow.hpp"
+
+#pragma hdrstop
+
+// Routine Description:
+// - Compiles a regular expression to find in text buffers.
+// - NOTE: Throws E_INVALIDARG if the expression isn't valid ECMAScript.
+// Arguments:
+// - pattern - the regular expression.
+// - caseSensitive - whether letters only match letters of the same case.
+// Return Value:
+// - constructed object
+TextBufferRegex::TextBufferRegex(const std::wstring_view pattern, const bool caseSensitive) :
+    _caseSensitive{ caseSensitive },
+    _regex{ s_CreateRegex(pattern, caseSensitive) },
+    _prefix{ s_CreatePrefix(pattern, caseSensitive) }
+{
+}
+
+// Routine Description:
+// - Finds the first match that starts in the given range of cells.
+// Arguments:
+// - textBuffer - the buffer to search.
+// - firstCell - the first cell a match can start in.
+// - endCell - the cell after the last one a match can start in.
+// - start - the first cell of the match, if one's found.
+// - end - the last cell of the match, if one's found. It can be past endCell.
+// Return Value:
+// - true if a match was found.
+bool TextBufferRegex::FindFirst(const TextBuffer& textBuffer,
+                                const size_t firstCell,
+                                const size_t endCell,
+                                size_t& start,
+                                size_t& end) const
+{
+    const auto size = textBuffer.GetSize();
+    if (firstCell >= endCell)
+    {
+        return false;
+    }
+
+    // The line that the first cell is in is read from its start, so that
+    // anything the expression looks for before the match is still there.
+    Line line;
+    SHORT row = _GetLineStart(textBuffer, gsl::narrow<SHORT>(firstCell / size.Width()));
+    while (row < size.Height() && static_cast<size_t>(row) * size.Width() < endCell)
+    {
+        _ReadLine(textBuffer, row, line);
+
+        bool found = false;
+        _ForEachMatch(line, firstCell, endCell, [&](const size_t matchStart, const size_t matchEnd) {
+            start = matchStart;
+            end = matchEnd;
+            found = true;
+            return false;
+        });
+        if (found)
+        {
+            return true;
+        }
+
+        row = line.endRow;
+    }
+    return false;
+}
+
+// Routine Description:
+// - Finds the last match that starts in the given range of cells.
+// Arguments:
+// - textBuffer - the buffer to search.
+// - firstCell - the first cell a match can start in.
+// - endCell - the cell after the last one a match can start in.
+// - start - the first cell of the match, if one's found.
+// - end - the last cell of the match, if one's found. It can be past endCell.
+// Return Value:
+// - true if a match was found.
+bool TextBufferRegex::FindLast(const TextBuffer& textBuffer,
+                               const size_t firstCell,
+                               const size_t endCell,
+                               size_t& start,
+                               size_t& end) const
+{
+    const auto size = textBuffer.GetSize();
+    if (firstCell >= endCell)
+    {
+        return false;
+    }
+
+    Line line;
+    SHORT row = _GetLineStart(textBuffer, gsl::narrow<SHORT>((endCell - 1) / size.Width()));
+    while (true)
+    {
+        _ReadLine(textBuffer, row, line);
+
+        bool found = false;
+        _ForEachMatch(line, firstCell, endCell, [&](const size_t matchStart, const size_t matchEnd) {
+            start = matchStart;
+            end = matchEnd;
+            found = true;
+            return true;
+        });
+        if (found)
+        {
+            return true;
+        }
+
+        if (row == 0 || static_cast<size_t>(row) * size.Width() <= firstCell)
+        {
+            return false;
+        }
+        row = _GetLineStart(textBuffer, row - 1);
+    }
+}
+
+// Routine Description:
+// - Finds the literal text that every match of an expression has to start
+//      with, so that lines without it can be passed over. Anything that's
+//      unsure, like an alternation, gives no prefix at all.
+// Arguments:
+// - pattern - the regular expression.
+// Return Value:
+// - The text every match starts with. Can be empty.
+std::wstring TextBufferRegex::s_GetLiteralPrefix(const std::wstring_view pattern)
+{
+    // An alternation outside of any group means a match can start with
+    // something else entirely.
+    size_t depth = 0;
+    bool inClass = false;
+    for (size_t i = 0; i < pattern.size(); i++)
+    {
+        const auto wch = pattern[i];
+        if (wch == L'\\')
+        {
+            i++;
+        }
+        else if (inClass)
+        {
+            inClass = wch != L']';
+        }
+        else if (wch == L'[')
+        {
+            inClass = true;
+        }
+        else if (wch == L'(')
+        {
+            depth++;
+        }
+        else if (wch == L')' && depth > 0)
+        {
+            depth--;
+        }
+        else if (wch == L'|' && depth == 0)
+        {
+            return {};
+        }
+    }
+
+    static constexpr std::wstring_view special{ L"^$\\.|?*+()[]{}" };
+    static constexpr std::wstring_view quantifiers{ L"?*+{" };
+
+    std::wstring prefix;
+    size_t i = pattern.size() > 0 && pattern.front() == L'^' ? 1 : 0;
+    while (i < pattern.size())
+    {
+        wchar_t literal = pattern[i];
+        size_t length = 1;
+        if (literal == L'\\')
+        {
+            // Only escaped punctuation is literal. The rest are classes,
+            // assertions and character codes.
+            if (i + 1 >= pattern.size() || !iswpunct(pattern[i + 1]))
+            {
+                break;
+            }
+            literal = pattern[i + 1];
+            length = 2;
+        }
+        else if (special.find(literal) != std::wstring_view::npos)
+        {
+            break;
+        }
+
+        // A quantifier makes the character optional, except for a + which
+        // still needs it there once.
+        const size_t next = i + length;
+        if (next < pattern.size() && quantifiers.find(pattern[next]) != std::wstring_view::npos)
+        {
+            if (pattern[next] == L'+')
+            {
+                prefix += literal;
+            }
+            break;
+        }
+
+        prefix += literal;
+        i = next;
+    }
+    return prefix;
+}
+
+std::wregex TextBufferRegex::s_CreateRegex(const std::wstring_view pattern, const bool caseSensitive)
+{
+    auto flags = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+    if (!caseSensitive)
+    {
+        flags |= std::regex_constants::icase;
+    }
+
+    try
+    {
+        return std::wregex{ pattern.data(), pattern.size(), flags };
+    }
+    catch (const std::regex_error&)
+    {
+        THROW_HR(E_INVALIDARG);
+    }
+}
+
+std::wstring TextBufferRegex::s_CreatePrefix(const std::wstring_view pattern, const bool caseSensitive)
+{
+    auto prefix = s_GetLiteralPrefix(pattern);
+    if (!caseSensitive)
+    {
+        std::transform(prefix.begin(), prefix.end(), prefix.begin(), ::towlower);
+    }
+    return prefix;
+}
+
+// Routine Description:
+// - Finds the first row of the logical line that a row is in.
+// Arguments:
+// - textBuffer - the buffer the row is in.
+// - row - the row.
+// Return Value:
+// - The row the line starts in.
+SHORT TextBufferRegex::_GetLineStart(const TextBuffer& textBuffer, SHORT row) const
+{
+    return gsl::narrow_cast<SHORT>(textBuffer.GetLogicalLineStart(gsl::narrow<size_t>(row)));
+}
+
+// Routine Description:
+// - Reads the text of a logical line, from the row it starts in to the first
+//      one whose text wasn't wrapped onto the next.
+// Arguments:
+// - textBuffer - the buffer the line is in.
+// - firstRow - the row the line starts in.
+// - line - filled in with the line.
+// Return Value:
+// - <none>
+void TextBufferRegex::_ReadLine(const TextBuffer& textBuffer, const SHORT firstRow, Line& line) const
+{
+    const auto size = textBuffer.GetSize();
+
+    line.firstRow = firstRow;
+    line.text.clear();
+    line.cells.clear();
+
+    SHORT row = firstRow;
+    size_t endCell = 0;
+    bool wrapped = true;
+    std::optional<ROW> scratch;
+    while (wrapped && row < size.Height())
+    {
+        const auto& charRow = textBuffer.GetRowByOffset(row, scratch).GetCharRow();
+        const auto cells = charRow.cbegin();
+        wrapped = charRow.WasWrapForced();
+
+        // The blanks after the end of the line's text aren't part of it.
+        size_t columns = charRow.size();
+        while (!wrapped && columns > 0 && !cells[columns - 1].DbcsAttr().IsGlyphStored() && cells[columns - 1].Char() == UNICODE_SPACE)
+        {
+            columns--;
+        }
+
+        const size_t rowCell = static_cast<size_t>(row) * size.Width();
+        for (size_t column = 0; column < columns; column++)
+        {
+            const auto& cell = cells[column];
+            if (cell.DbcsAttr().IsTrailing())
+            {
+                continue;
+            }
+
+            if (cell.DbcsAttr().IsGlyphStored())
+            {
+                line.text += std::wstring_view{ charRow.GlyphAt(column) };
+            }
+            else
+            {
+                line.text += cell.Char();
+            }
+            line.cells.resize(line.text.size(), rowCell + column);
+        }
+
+        endCell = rowCell + columns;
+        row++;
+    }
+
+    line.endRow = row;
+    line.cells.push_back(endCell);
+}
+
+// Routine Description:
+// - Checks whether a line has the text that every match starts with.
+// Arguments:
+// - line - the line.
+// Return Value:
+// - false if the line can't match.
+bool TextBufferRegex::_MightMatch(const Line& line) const
+{
+    if (_prefix.empty())
+    {
+        return true;
+    }
+
+    if (_caseSensitive)
+    {
+        return line.text.find(_prefix) != std::wstring::npos;
+    }
+
+    return std::search(line.text.begin(), line.text.end(), _prefix.begin(), _prefix.end(), [](const wchar_t a, const wchar_t b) {
+               return ::towlower(a) == b;
+           }) != line.text.end();
+}
+
+// Routine Description:
+// - Goes through the matches in a line that start in the given range of cells,
+//      in order. Matches of nothing at all are passed over, since there'd be
+//      nothing to select.
+// - If the expression would take too long to run over the line, std::regex
+//      gives up on it rather than hanging, and the line is taken not to match.
+// Arguments:
+// - line - the line.
+// - firstCell - the first cell a match can start in.
+// - endCell - the cell after the last one a match can start in.
+// - callback - called with the first and last cell of each match. Returns
+//      false to stop there.
+// Return Value:
+// - <none>
+template<typename T>
+void TextBufferRegex::_ForEachMatch(const Line& line, const size_t firstCell, const size_t endCell, T&& callback) const
+{
+    if (!_MightMatch(line))
+    {
+        return;
+    }
+
+    try
+    {
+        const auto begin = line.text.data();
+        const std::wcregex_iterator stop;
+        for (std::wcregex_iterator it{ begin, begin + line.text.size(), _regex }; it != stop; ++it)
+        {
+            const auto& match = *it;
+            if (match.length(0) == 0)
+            {
+                continue;
+            }
+
+            const auto offset = gsl::narrow_cast<size_t>(match.position(0));
+            const size_t start = line.cells[offset];
+            if (start < firstCell)
+            {
+                continue;
+            }
+            if (start >= endCell)
+            {
+                break;
+            }
+
+            const size_t end = line.cells[offset + gsl::narrow_cast<size_t>(match.length(0))] - 1;
+            if (!callback(start, std::max(start, end)))
+            {
+                break;
+            }
+        }
+    }
+    catch (const std::regex_error&)
+    {
+        LOG_CAUGHT_EXCEPTION();
+    }
+}
@@ -0,0 +1,68 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- TextBufferRegex.hpp
+
+Abstract:
+- Finds matches of an ECMAScript regular expression in a TextBuffer.
+- The expression is matched against logical lines: runs of rows joined where
+  the text was wrapped onto the next row, so a match isn't lost where a long
+  line happens to be broken. The blanks at the end of a line aren't part of it.
+- Most expressions start with some literal text. A line that doesn't contain
+  it can't match, so it's rejected without running the expression at all.
+- Matches are given as cells, counting across each row and then down, the same
+  as Search does.
+--*/
+
+#pragma once
+
+#include "textBuffer.hpp"
+
+#include <regex>
+
+class TextBufferRegex final
+{
+public:
+    TextBufferRegex(const std::wstring_view pattern, const bool caseSensitive);
+
+    bool FindFirst(const TextBuffer& textBuffer,
+                   const size_t firstCell,
+                   const size_t endCell,
+                   size_t& start,
+                   size_t& end) const;
+    bool FindLast(const TextBuffer& textBuffer,
+                  const size_t firstCell,
+                  const size_t endCell,
+                  size_t& start,
+                  size_t& end) const;
+
+    static std::wstring s_GetLiteralPrefix(const std::wstring_view pattern);
+
+private:
+    // A logical line's text, and the cell each of the characters in it starts in.
+    // A character that's in the middle of a glyph gets the cell of its glyph, and
+    // there's one more cell at the end for where the line stops.
+    struct Line
+    {
+        SHORT firstRow;
+        SHORT endRow;
+        std::wstring text;
+        std::vector<size_t> cells;
+    };
+
+    static std::wregex s_CreateRegex(const std::wstring_view pattern, const bool caseSensitive);
+    static std::wstring s_CreatePrefix(const std::wstring_view pattern, const bool caseSensitive);
+
+    SHORT _GetLineStart(const TextBuffer& textBuffer, SHORT row) const;
+    void _ReadLine(const TextBuffer& textBuffer, const SHORT firstRow, Line& line) const;
+    bool _MightMatch(const Line& line) const;
+
+    template<typename T>
+    void _ForEachMatch(const Line& line, const size_t firstCell, const size_t endCell, T&& callback) const;
+
+    const bool _caseSensitive;
+    const std::wregex _regex;
+    const std::wstring _prefix;
+};
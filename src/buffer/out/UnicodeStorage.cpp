@@ -4,95 +4,148 @@
 #include "precomp.h"
 #include "UnicodeStorage.hpp"
 
-UnicodeStorage::UnicodeStorage() :
-    _map{}
+UnicodeStorage::UnicodeStorage() noexcept :
+    _glyphs{}
 {
 }
 
+// Routine Description:
+// - finds the first stored item at or after the given column
+// Arguments:
+// - key - the column to search for
+// Return Value:
+// - iterator to the first item whose column is not less than key
+std::vector<UnicodeStorage::value_type>::iterator UnicodeStorage::_LowerBound(const key_type key) noexcept
+{
+    return std::lower_bound(_glyphs.begin(), _glyphs.end(), key, [](const value_type& item, const key_type k) noexcept {
+        return item.first < k;
+    });
+}
+
+// Routine Description:
+// - finds the first stored item at or after the given column
+// Arguments:
+// - key - the column to search for
+// Return Value:
+// - iterator to the first item whose column is not less than key
+std::vector<UnicodeStorage::value_type>::const_iterator UnicodeStorage::_LowerBound(const key_type key) const noexcept
+{
+    return std::lower_bound(_glyphs.cbegin(), _glyphs.cend(), key, [](const value_type& item, const key_type k) noexcept {
+        return item.first < k;
+    });
+}
+
 // Routine Description:
 // - fetches the text associated with key
 // Arguments:
-// - key - the key into the storage
+// - key - the column within the row
 // Return Value:
 // - the glyph data associated with key
 // Note: will throw exception if key is not stored yet
 const UnicodeStorage::mapped_type& UnicodeStorage::GetText(const key_type key) const
 {
-    return _map.at(key);
+    const auto it = _LowerBound(key);
+    THROW_HR_IF(E_INVALIDARG, it == _glyphs.cend() || it->first != key);
+    return it->second;
 }
 
 // Routine Description:
 // - stores glyph data associated with key.
 // Arguments:
-// - key - the key into the storage
+// - key - the column within the row
 // - glyph - the glyph data to store
 void UnicodeStorage::StoreGlyph(const key_type key, const mapped_type& glyph)
 {
-    _map.insert_or_assign(key, glyph);
+    const auto it = _LowerBound(key);
+    if (it != _glyphs.end() && it->first == key)
+    {
+        it->second = glyph;
+    }
+    else
+    {
+        _glyphs.emplace(it, key, glyph);
+    }
 }
 
 // Routine Description:
 // - erases key and its associated data from the storage
 // Arguments:
-// - key - the key to remove
+// - key - the column to remove
 void UnicodeStorage::Erase(const key_type key) noexcept
 {
-    _map.erase(key);
+    const auto it = _LowerBound(key);
+    if (it != _glyphs.end() && it->first == key)
+    {
+        _glyphs.erase(it);
+    }
 }
 
 // Routine Description:
-// - Remaps all of the stored items to new coordinate positions
-//   based on a bulk rearrangement of row IDs and potential row width resize.
+// - Removes all of the stored items that no longer fit in a row of the given width.
 // Arguments:
-// - rowMap - A map of the old row IDs to the new row IDs.
-// - width - The width of the new row. Remove any items that are beyond the row width.
-//         - Use nullopt if we're not resizing the width of the row, just renumbering the rows.
-void UnicodeStorage::Remap(const std::map<SHORT, SHORT>& rowMap, const std::optional<SHORT> width)
+// - width - The new width of the row.
+void UnicodeStorage::Truncate(const size_t width) noexcept
 {
-    // Make a temporary map to hold all the new row positioning
-    std::unordered_map<key_type, mapped_type> newMap;
+    _glyphs.erase(_LowerBound(width), _glyphs.end());
+}
+
+// Routine Description:
+// - Removes all of the stored items.
+void UnicodeStorage::Clear() noexcept
+{
+    _glyphs.clear();
+}
 
-    // Walk through every stored item.
-    for (const auto& pair : _map)
+bool UnicodeStorage::empty() const noexcept
+{
+    return _glyphs.empty();
+}
+
+size_t UnicodeStorage::size() const noexcept
+{
+    return _glyphs.size();
+}
+
+UnicodeStorage::const_iterator UnicodeStorage::begin() const noexcept
+{
+    return _glyphs.cbegin();
+}
+
+UnicodeStorage::const_iterator UnicodeStorage::end() const noexcept
+{
+    return _glyphs.cend();
+}
+
+// Routine Description:
+// - Gets the number of bytes allocated on the heap for the glyphs kept here.
+size_t UnicodeStorage::GetMemoryUsage() const noexcept
+{
+    return MeasureMemory().bytes;
+}
+
+// Routine Description:
+// - Gets the bytes allocated on the heap for the glyphs kept here, and how many
+//   allocations they're in: one for the list, and one for each glyph.
+Microsoft::Console::Types::MemoryUsage UnicodeStorage::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddContiguous(_glyphs);
+    for (const auto& glyph : _glyphs)
     {
-        // Extract the old coordinate position
-        const auto oldCoord = pair.first;
-
-        // Only try to short-circuit based on width if we were told it changed
-        // by being given a new width value.
-        if (width.has_value())
-        {
-            // Get the column ID
-            const auto oldColId = oldCoord.X;
-
-            // If the column index is at/beyond the row width, don't bother copying it to the new map.
-            if (oldColId >= width.value())
-            {
-                continue;
-            }
-        }
-
-        // Get the row ID from the position as that's what we need to remap
-        const auto oldRowId = oldCoord.Y;
-
-        // Use the mapping given to convert the old row ID to the new row ID
-        const auto mapIter = rowMap.find(oldRowId);
-
-        // If there's no mapping to a new row, don't bother copying it to the new map. The row is gone.
-        if (mapIter == rowMap.end())
-        {
-            continue;
-        }
-
-        const auto newRowId = mapIter->second;
-
-        // Generate a new coordinate with the same X as the old one, but a new Y value.
-        const auto newCoord = COORD{ oldCoord.X, newRowId };
-
-        // Put the adjusted coordinate into the map with the original value.
-        newMap.emplace(newCoord, pair.second);
+        usage.AddContiguous(glyph.second);
     }
+    return usage;
+}
 
-    // Swap into the stored map, free the temporary when we exit.
-    _map.swap(newMap);
+// Routine Description:
+// - Gives back any space for glyphs that isn't being used anymore.
+// Note: may throw exception if the glyphs can't be reallocated
+void UnicodeStorage::ReleaseUnusedMemory()
+{
+    _glyphs.shrink_to_fit();
+}
+
+bool operator==(const UnicodeStorage& a, const UnicodeStorage& b) noexcept
+{
+    return a._glyphs == b._glyphs;
 }
@@ -15,40 +15,22 @@ Author(s):
 #pragma once
 
 #include <vector>
-#include <unordered_map>
-#include <climits>
 
-// std::unordered_map needs help to know how to hash a COORD
-namespace std
-{
-    template <>
-    struct hash<COORD>
-    {
-
-        // Routine Description:
-        // - hashes a coord. coord will be hashed by storing the x and y values consecutively in the lower
-        // bits of a size_t.
-        // Arguments:
-        // - coord - the coord to hash
-        // Return Value:
-        // - the hashed coord
-        constexpr size_t operator()(const COORD& coord) const noexcept
-        {
-            size_t retVal = coord.Y;
-            const size_t xCoord = coord.X;
-            retVal |= xCoord << (sizeof(coord.Y) * CHAR_BIT);
-            return retVal;
-        }
-    };
-}
+#include "../types/inc/MemoryUsage.hpp"
 
+// Holds the glyphs of one row that are too long to fit in a single CharRowCell.
+// Each ROW owns its own storage keyed by column, so rows can be rotated, renumbered,
+// or recycled by the text buffer without rekeying anything. Most rows hold zero or
+// a handful of these, so they're kept in a small vector sorted by column.
 class UnicodeStorage final
 {
 public:
-    using key_type = typename COORD;
+    using key_type = typename size_t;
     using mapped_type = typename std::vector<wchar_t>;
+    using value_type = typename std::pair<key_type, mapped_type>;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
 
-    UnicodeStorage();
+    UnicodeStorage() noexcept;
 
     const mapped_type& GetText(const key_type key) const;
 
@@ -56,13 +38,32 @@ public:
 
     void Erase(const key_type key) noexcept;
 
-    void Remap(const std::map<SHORT, SHORT>& rowMap, const std::optional<SHORT> width);
+    void Truncate(const size_t width) noexcept;
+
+    void Clear() noexcept;
+
+    bool empty() const noexcept;
+    size_t size() const noexcept;
+    size_t GetMemoryUsage() const noexcept;
+    Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+    void ReleaseUnusedMemory();
+
+    // the stored glyphs, in order of their columns.
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    friend bool operator==(const UnicodeStorage& a, const UnicodeStorage& b) noexcept;
 
 private:
-    std::unordered_map<key_type, mapped_type> _map;
+    std::vector<value_type> _glyphs;
+
+    std::vector<value_type>::iterator _LowerBound(const key_type key) noexcept;
+    std::vector<value_type>::const_iterator _LowerBound(const key_type key) const noexcept;
 
 #ifdef UNIT_TESTING
     friend class UnicodeStorageTests;
     friend class TextBufferTests;
 #endif
 };
+
+bool operator==(const UnicodeStorage& a, const UnicodeStorage& b) noexcept;
@@ -29,15 +29,539 @@ TextBuffer::TextBuffer(const COORD screenBufferSize,
     _firstRow{ 0 },
     _currentAttributes{ defaultAttributes },
     _cursor{ cursorSize, *this },
+    _attributePalette{},
+    _hyperlinks{},
+    _generation{ 0 },
+    _layoutGeneration{ 0 },
+    _paletteGeneration{ 0 },
+    _circledRowCount{ 0 },
+    _lines{},
+    _linesSuspended{ false },
+    _cellArena{},
     _storage{},
-    _unicodeStorage{},
+    _hotRowCount{ SIZE_MAX },
+    _freeArenaSlots{},
+    _thawedRowIds{},
+    _spill{},
     _renderTarget{ renderTarget }
 {
-    // initialize ROWs
-    for (size_t i = 0; i < static_cast<size_t>(screenBufferSize.Y); ++i)
+    const size_t width = gsl::narrow<size_t>(screenBufferSize.X);
+    const size_t height = gsl::narrow<size_t>(screenBufferSize.Y);
+
+    // allocate the cells for every row in one go
+    _cellArena = std::make_shared<std::vector<CharRowCell>>(width * height);
+
+    // initialize ROWs as views over their slice of the arena
+    _storage.reserve(height);
+    for (size_t i = 0; i < height; ++i)
+    {
+        _storage.emplace_back(static_cast<SHORT>(i), _GetArenaSlice(*_cellArena, i, width), _currentAttributes, this);
+    }
+
+    _RebuildLines();
+}
+
+// Routine Description:
+// - Constructs a snapshot of another text buffer. See CreateSnapshot.
+// Arguments:
+// - source - the buffer to take a snapshot of
+// - renderTarget - where the snapshot should send its render notifications
+// Return Value:
+// - constructed object
+// Note: may throw exception
+TextBuffer::TextBuffer(TextBuffer& source, Microsoft::Console::Render::IRenderTarget& renderTarget) :
+    _firstRow{ source._firstRow },
+    _currentAttributes{ source._currentAttributes },
+    _cursor{ source._cursor.GetSize(), *this },
+    _attributePalette{ source._attributePalette },
+    _hyperlinks{ source._hyperlinks },
+    _generation{ source._generation },
+    _layoutGeneration{ source._layoutGeneration },
+    _paletteGeneration{ source._paletteGeneration },
+    _circledRowCount{ source._circledRowCount },
+    _lines{ source._lines },
+    _linesSuspended{ false },
+    _cellArena{ source._cellArena },
+    _storage{},
+    _hotRowCount{ source._hotRowCount },
+    _freeArenaSlots{},
+    _thawedRowIds{ source._thawedRowIds },
+    _spill{},
+    _renderTarget{ renderTarget }
+{
+    // Rows keep a pointer to their parent, so they have to stay put once they're made.
+    _storage.reserve(source._storage.size());
+    for (auto& row : source._storage)
+    {
+        _storage.emplace_back(row, this);
+    }
+
+    CopyProperties(source);
+    _cursor.SetPosition(source._cursor.GetPosition());
+}
+
+// Routine Description:
+// - Takes a snapshot of this buffer, e.g. for reading it outside of the lock or to
+//   restore it later. The snapshot doesn't copy any of the rows' character cells.
+//   Instead both buffers share them, and a row is only copied once either buffer
+//   writes to it. Attributes and long glyphs are small and are copied outright.
+// - The snapshot doesn't keep scrollback spilled to disk.
+// Arguments:
+// - renderTarget - where the snapshot should send its render notifications
+// Return Value:
+// - the snapshot
+// Note: will throw exception if unable to allocate the snapshot
+std::unique_ptr<TextBuffer> TextBuffer::CreateSnapshot(Microsoft::Console::Render::IRenderTarget& renderTarget)
+{
+    return std::unique_ptr<TextBuffer>(new TextBuffer(*this, renderTarget));
+}
+
+// Routine Description:
+// - Tells whether another buffer (i.e. a snapshot, or the buffer a snapshot was taken of)
+//   still holds this buffer's cell arena. Rows that were shared with a buffer that has
+//   since been destroyed aren't shared anymore, and can be written in place.
+// Return Value:
+// - true if the cell arena is held by another buffer
+bool TextBuffer::IsCellArenaShared() const noexcept
+{
+    if (_cellArena.use_count() > 1)
+    {
+        return true;
+    }
+
+    // The other buffer may have been destroyed on another thread (e.g. an export of a
+    // snapshot). Make sure its last reads have happened before the cells are written.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return false;
+}
+
+// Routine Description:
+// - Brings some of the rows of a snapshot back up to date with the buffer it was taken of,
+//   e.g. the rows in view before painting them. Only the rows that changed since they were
+//   last copied are copied again, sharing their cells the same way CreateSnapshot does.
+//   Rows outside of the range are left as they were.
+// - This must be called on the snapshot, not on the source.
+// Arguments:
+// - source - the buffer this snapshot was taken of
+// - firstRow - the offset of the first row to refresh, from the top of the buffer
+// - count - how many rows to refresh. The range is clipped to the buffer.
+// Return Value:
+// - true if the rows were refreshed. false if the source has been resized since
+//   the snapshot was taken, in which case a new snapshot has to be taken instead.
+// Note: will throw exception if unable to allocate the copied rows
+bool TextBuffer::RefreshSnapshot(TextBuffer& source, const size_t firstRow, const size_t count)
+{
+    if (_cellArena != source._cellArena || _storage.size() != source._storage.size())
+    {
+        return false;
+    }
+
+    // Handles are only ever added to the palette until it's rebuilt, so the copy
+    // only needs to be refreshed when the source has grown it or started over.
+    // A link is always added before the attribute that refers to it, so the
+    // hyperlinks are up to date for as long as the palette is.
+    if (_paletteGeneration != source._paletteGeneration ||
+        _attributePalette.size() != source._attributePalette.size())
+    {
+        _attributePalette = source._attributePalette;
+        _hyperlinks = source._hyperlinks;
+        _paletteGeneration = source._paletteGeneration;
+    }
+
+    // The lines are only a couple of numbers a row, so they're copied whole whenever
+    // anything changed, even outside of the rows being refreshed.
+    if (_generation != source._generation)
+    {
+        _lines = source._lines;
+    }
+
+    _firstRow = source._firstRow;
+    _generation = source._generation;
+    _layoutGeneration = source._layoutGeneration;
+    _circledRowCount = source._circledRowCount;
+
+    // Rows stay at the same index in storage when the buffer circles, so a row's
+    // generation is enough to tell whether our copy of it is still current.
+    const size_t totalRows = _storage.size();
+    const size_t endRow = firstRow + std::min(count, totalRows - std::min(firstRow, totalRows));
+    for (size_t offset = firstRow; offset < endRow; ++offset)
+    {
+        const size_t index = (_firstRow + offset) % totalRows;
+        auto& sourceRow = source._storage.at(index);
+        auto& row = _storage.at(index);
+        if (row.GetGeneration() != sourceRow.GetGeneration())
+        {
+            row = ROW{ sourceRow, this };
+            row.GetCharRow().UpdateParent(&row);
+        }
+    }
+
+    return true;
+}
+
+// The bits of a row's flags byte, and of the cursor's, in a serialized buffer.
+static constexpr uint8_t s_RowWrapForced = 0x1;
+static constexpr uint8_t s_RowDoubleBytePadded = 0x2;
+static constexpr uint8_t s_CursorVisible = 0x1;
+static constexpr uint8_t s_CursorBlinkingAllowed = 0x2;
+
+// Routine Description:
+// - Writes out a compact copy of the buffer's contents: every row's cells, attribute runs,
+//   long glyphs and wrap flags, the palette the runs refer to, the current attributes and
+//   the cursor. Each of them is stored the way the buffer holds it in memory, so saving
+//   and loading is mostly a matter of a few big copies. See Deserialize.
+// - Cold rows are written out unpacked, without being thawed. Scrollback spilled to disk isn't written.
+// - The copy can only be read by the same build, on the same architecture.
+// Arguments:
+// - data - receives the copy, replacing what it held
+// Note: will throw exception if unable to allocate the copy
+void TextBuffer::Serialize(std::vector<std::byte>& data) const
+{
+    static_assert(std::is_trivially_copyable_v<TextAttribute>);
+    static_assert(std::is_trivially_copyable_v<CharRowCell>);
+    static_assert(std::is_trivially_copyable_v<InternedAttributeRun>);
+
+    const size_t width = gsl::narrow<size_t>(GetSize().Width());
+    const size_t height = _storage.size();
+    const auto rowAt = [&](const size_t offset) -> const ROW& {
+        return _storage[(_firstRow + offset) % height];
+    };
+
+    size_t runCount = 0;
+    size_t glyphCount = 0;
+    size_t glyphLength = 0;
+    for (const auto& row : _storage)
+    {
+        runCount += row.GetAttrRow().GetNumberOfRuns();
+        for (const auto& glyph : row.GetUnicodeStorage())
+        {
+            ++glyphCount;
+            glyphLength += glyph.second.size();
+        }
+    }
+
+    size_t hyperlinkLength = 0;
+    for (size_t handle = 1; handle < _hyperlinks.size(); ++handle)
+    {
+        const auto link = gsl::narrow_cast<HyperlinkTable::handle_type>(handle);
+        hyperlinkLength += _hyperlinks.GetId(link).size() + _hyperlinks.GetUri(link).size();
+    }
+
+    _SerializedHeader header{};
+    header.signature = s_SerializedSignature;
+    header.formatVersion = s_SerializedFormatVersion;
+    header.width = gsl::narrow<uint16_t>(width);
+    header.height = gsl::narrow<uint16_t>(height);
+    header.paletteSize = gsl::narrow<uint32_t>(_attributePalette.size());
+    header.runCount = gsl::narrow<uint32_t>(runCount);
+    header.glyphCount = gsl::narrow<uint32_t>(glyphCount);
+    header.glyphLength = gsl::narrow<uint32_t>(glyphLength);
+    header.hyperlinkCount = gsl::narrow<uint32_t>(_hyperlinks.GetLinkCount());
+    header.hyperlinkLength = gsl::narrow<uint32_t>(hyperlinkLength);
+    header.cursorPosition = _cursor.GetPosition();
+    header.cursorSize = _cursor.GetSize();
+    header.cursorColor = _cursor.GetColor();
+    header.cursorType = gsl::narrow_cast<uint8_t>(_cursor.GetType());
+    header.cursorFlags = (_cursor.IsVisible() ? s_CursorVisible : 0) |
+                         (_cursor.IsBlinkingAllowed() ? s_CursorBlinkingAllowed : 0);
+    header.currentAttributes = _currentAttributes;
+
+    data.resize(sizeof(header) +
+                header.paletteSize * sizeof(TextAttribute) +
+                header.hyperlinkCount * sizeof(_SerializedHyperlink) +
+                width * height * sizeof(CharRowCell) +
+                height * (sizeof(uint8_t) + sizeof(uint16_t)) +
+                runCount * sizeof(InternedAttributeRun) +
+                glyphCount * sizeof(_SerializedGlyph) +
+                glyphLength * sizeof(wchar_t) +
+                hyperlinkLength * sizeof(wchar_t));
+
+    auto out = data.data();
+    const auto write = [&](const void* const source, const size_t size) {
+        memcpy(out, source, size);
+        out += size;
+    };
+
+    write(&header, sizeof(header));
+
+    // The palette's a deque, so its entries have to be copied one at a time.
+    for (size_t handle = 0; handle < header.paletteSize; ++handle)
+    {
+        write(&_attributePalette.Lookup(gsl::narrow_cast<TextAttributePalette::handle_type>(handle)), sizeof(TextAttribute));
+    }
+
+    // Links are written with their handles, since the attributes refer to them by those.
+    for (size_t handle = 1; handle < _hyperlinks.size(); ++handle)
+    {
+        const auto link = gsl::narrow_cast<HyperlinkTable::handle_type>(handle);
+        if (_hyperlinks.IsInUse(link))
+        {
+            const _SerializedHyperlink entry{ link,
+                                              gsl::narrow<uint16_t>(_hyperlinks.GetId(link).size()),
+                                              gsl::narrow<uint32_t>(_hyperlinks.GetUri(link).size()) };
+            write(&entry, sizeof(entry));
+        }
+    }
+
+    // CharRowCell is packed, so the cells can be copied straight into the output.
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        rowAt(offset).GetCharRow().CopyCellsTo({ reinterpret_cast<CharRowCell*>(out), gsl::narrow<ptrdiff_t>(width) });
+        out += width * sizeof(CharRowCell);
+    }
+
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        const auto& charRow = rowAt(offset).GetCharRow();
+        const uint8_t flags = (charRow.WasWrapForced() ? s_RowWrapForced : 0) |
+                              (charRow.WasDoubleBytePadded() ? s_RowDoubleBytePadded : 0);
+        write(&flags, sizeof(flags));
+    }
+
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        const auto count = gsl::narrow<uint16_t>(rowAt(offset).GetAttrRow().GetNumberOfRuns());
+        write(&count, sizeof(count));
+    }
+
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        const auto runs = rowAt(offset).GetAttrRow().GetInternedRuns();
+        write(runs.data(), runs.size_bytes());
+    }
+
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        for (const auto& glyph : rowAt(offset).GetUnicodeStorage())
+        {
+            const _SerializedGlyph entry{ gsl::narrow_cast<uint16_t>(offset),
+                                          gsl::narrow<uint16_t>(glyph.first),
+                                          gsl::narrow<uint32_t>(glyph.second.size()) };
+            write(&entry, sizeof(entry));
+        }
+    }
+
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        for (const auto& glyph : rowAt(offset).GetUnicodeStorage())
+        {
+            write(glyph.second.data(), glyph.second.size() * sizeof(wchar_t));
+        }
+    }
+
+    for (size_t handle = 1; handle < _hyperlinks.size(); ++handle)
+    {
+        const auto link = gsl::narrow_cast<HyperlinkTable::handle_type>(handle);
+        const auto id = _hyperlinks.GetId(link);
+        const auto uri = _hyperlinks.GetUri(link);
+        write(id.data(), id.size() * sizeof(wchar_t));
+        write(uri.data(), uri.size() * sizeof(wchar_t));
+    }
+}
+
+// Routine Description:
+// - Replaces the buffer's contents with a copy that Serialize wrote out, taking on its
+//   size as well. The rows come back in the order they were in, starting at the top of
+//   the buffer, and the buffer's hot row count and scrollback spill are kept.
+// - Everything's checked and allocated before the buffer is changed, so if the copy
+//   isn't valid, or can't be loaded, the buffer is left as it was.
+// - NOTE: Throws HRESULT_FROM_WIN32(ERROR_INVALID_DATA) if the copy isn't valid, or was
+//   written by a different version of the format.
+// Arguments:
+// - data - the copy to load
+// Note: will throw exception if unable to allocate the new contents
+void TextBuffer::Deserialize(const gsl::span<const std::byte> data)
+{
+    constexpr auto invalidData = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    size_t consumed = 0;
+    const auto take = [&](const size_t count, const size_t size) {
+        THROW_HR_IF(invalidData, count > (gsl::narrow_cast<size_t>(data.size()) - consumed) / std::max<size_t>(size, 1));
+        const auto position = data.data() + consumed;
+        consumed += count * size;
+        return position;
+    };
+
+    _SerializedHeader header;
+    memcpy(&header, take(1, sizeof(header)), sizeof(header));
+    THROW_HR_IF(invalidData, header.signature != s_SerializedSignature || header.formatVersion != s_SerializedFormatVersion);
+    THROW_HR_IF(invalidData, header.width == 0 || header.width > SHRT_MAX || header.height == 0 || header.height > SHRT_MAX);
+    THROW_HR_IF(invalidData, header.paletteSize == 0 || header.paletteSize > TextAttributePalette::MaxEntries);
+    THROW_HR_IF(invalidData, header.cursorType > static_cast<uint8_t>(CursorType::FullBox));
+
+    const size_t width = header.width;
+    const size_t height = header.height;
+
+    // The entries have to go back in the same order to get the same handles,
+    // which works out as long as none of them are there twice.
+    TextAttributePalette palette;
+    const auto entries = take(header.paletteSize, sizeof(TextAttribute));
+    for (size_t handle = 0; handle < header.paletteSize; ++handle)
+    {
+        TextAttribute attr;
+        memcpy(&attr, entries + handle * sizeof(TextAttribute), sizeof(attr));
+        THROW_HR_IF(invalidData, palette.Intern(attr) != handle);
+    }
+
+    std::vector<_SerializedHyperlink> links(header.hyperlinkCount);
+    memcpy(links.data(), take(links.size(), sizeof(_SerializedHyperlink)), links.size() * sizeof(_SerializedHyperlink));
+
+    const auto cells = reinterpret_cast<const CharRowCell*>(take(width * height, sizeof(CharRowCell)));
+    const auto flags = reinterpret_cast<const uint8_t*>(take(height, sizeof(uint8_t)));
+
+    // The rest might not be aligned, so it's copied out before it's looked at.
+    std::vector<uint16_t> runCounts(height);
+    memcpy(runCounts.data(), take(height, sizeof(uint16_t)), height * sizeof(uint16_t));
+
+    std::vector<InternedAttributeRun> runs(header.runCount);
+    memcpy(runs.data(), take(runs.size(), sizeof(InternedAttributeRun)), runs.size() * sizeof(InternedAttributeRun));
+
+    std::vector<_SerializedGlyph> glyphs(header.glyphCount);
+    memcpy(glyphs.data(), take(glyphs.size(), sizeof(_SerializedGlyph)), glyphs.size() * sizeof(_SerializedGlyph));
+
+    const auto glyphText = take(header.glyphLength, sizeof(wchar_t));
+    const auto hyperlinkText = take(header.hyperlinkLength, sizeof(wchar_t));
+    THROW_HR_IF(invalidData, consumed != gsl::narrow_cast<size_t>(data.size()));
+
+    // The text might not be aligned either, so every link's is copied out on its own.
+    HyperlinkTable hyperlinks;
+    size_t hyperlinkLength = 0;
+    for (const auto& link : links)
+    {
+        THROW_HR_IF(invalidData, link.uriLength == 0 || link.idLength + size_t{ link.uriLength } > header.hyperlinkLength - hyperlinkLength);
+        std::wstring text(link.idLength + size_t{ link.uriLength }, UNICODE_NULL);
+        memcpy(text.data(), hyperlinkText + hyperlinkLength * sizeof(wchar_t), text.size() * sizeof(wchar_t));
+        hyperlinkLength += text.size();
+
+        const std::wstring_view view{ text };
+        THROW_HR_IF(invalidData, !hyperlinks.Restore(link.handle, view.substr(link.idLength), view.substr(0, link.idLength)));
+    }
+    THROW_HR_IF(invalidData, hyperlinkLength != header.hyperlinkLength);
+
+    // Every link an attribute refers to has to be there.
+    for (size_t handle = 0; handle < header.paletteSize; ++handle)
+    {
+        const auto& attr = palette.Lookup(gsl::narrow_cast<TextAttributePalette::handle_type>(handle));
+        THROW_HR_IF(invalidData, attr.IsHyperlink() && !hyperlinks.IsInUse(attr.GetHyperlinkId()));
+    }
+    THROW_HR_IF(invalidData, header.currentAttributes.IsHyperlink() && !hyperlinks.IsInUse(header.currentAttributes.GetHyperlinkId()));
+
+    size_t glyphLength = 0;
+    for (const auto& glyph : glyphs)
+    {
+        THROW_HR_IF(invalidData, glyph.row >= height || glyph.column >= width || glyph.length == 0);
+        glyphLength += glyph.length;
+    }
+    THROW_HR_IF(invalidData, glyphLength != header.glyphLength);
+
+    // ATTR_ROW checks the runs too, but by then it'd be too late to back out.
+    auto run = runs.cbegin();
+    for (const auto count : runCounts)
+    {
+        THROW_HR_IF(invalidData, static_cast<ptrdiff_t>(count) > runs.cend() - run);
+        size_t length = 0;
+        for (const auto end = run + count; run != end; ++run)
+        {
+            THROW_HR_IF(invalidData, run->GetLength() == 0 || run->GetHandle() >= header.paletteSize);
+            length += run->GetLength();
+        }
+        THROW_HR_IF(invalidData, length != width);
+    }
+    THROW_HR_IF(invalidData, run != runs.cend());
+
+    // The rows refer to the palette by pointer, so the new one is swapped into place
+    // before they're made, and swapped back out if they can't be.
+    std::swap(_attributePalette, palette);
+    auto restorePalette = wil::scope_exit([&]() noexcept {
+        std::swap(_attributePalette, palette);
+    });
+
+    auto arena = std::make_shared<std::vector<CharRowCell>>(width * height);
+    std::vector<ROW> storage;
+    storage.reserve(height);
+    size_t firstRun = 0;
+    for (size_t i = 0; i < height; ++i)
     {
-        _storage.emplace_back(static_cast<SHORT>(i), screenBufferSize.X, _currentAttributes, this);
+        auto& row = storage.emplace_back(gsl::narrow_cast<SHORT>(i), _GetArenaSlice(*arena, i, width), header.currentAttributes, this);
+        auto& charRow = row.GetCharRow();
+        std::copy_n(cells + i * width, width, charRow.begin());
+        charRow.SetWrapForced(WI_IsFlagSet(flags[i], s_RowWrapForced));
+        charRow.SetDoubleBytePadded(WI_IsFlagSet(flags[i], s_RowDoubleBytePadded));
+
+        row.GetAttrRow().SetInternedRuns({ runs.data() + firstRun, gsl::narrow<ptrdiff_t>(runCounts[i]) });
+        firstRun += runCounts[i];
     }
+
+    auto text = reinterpret_cast<const wchar_t*>(glyphText);
+    for (const auto& glyph : glyphs)
+    {
+        UnicodeStorage::mapped_type chars(glyph.length);
+        memcpy(chars.data(), text, glyph.length * sizeof(wchar_t));
+        storage[glyph.row].GetUnicodeStorage().StoreGlyph(glyph.column, chars);
+        text += glyph.length;
+    }
+
+    // Whatever's above the hot window goes back into cold storage. That's laid out
+    // here too, so that nothing's left that can fail once the buffer's changed.
+    std::vector<ROW*> rows;
+    rows.reserve(height);
+    for (auto& row : storage)
+    {
+        rows.push_back(&row);
+    }
+
+    std::optional<_ArenaLayout> layout;
+    if (std::min(_hotRowCount, height) < height)
+    {
+        layout.emplace(_PrepareLayout(rows, width, _hotRowCount));
+    }
+    _lines.reserve(height);
+
+    // Moving the vector keeps the rows where they are, so they don't need new parents.
+    restorePalette.release();
+    _hyperlinks = std::move(hyperlinks);
+    _currentAttributes = header.currentAttributes;
+    _storage = std::move(storage);
+    _firstRow = 0;
+    if (layout.has_value())
+    {
+        _CommitLayout(rows, std::move(layout.value()));
+    }
+    else
+    {
+        _cellArena = std::move(arena);
+        _freeArenaSlots.clear();
+        _thawedRowIds.clear();
+    }
+    _RebuildLines();
+
+    _cursor.SetSize(header.cursorSize);
+    _cursor.SetColor(header.cursorColor);
+    _cursor.SetType(static_cast<CursorType>(header.cursorType));
+    _cursor.SetIsVisible(WI_IsFlagSet(header.cursorFlags, s_CursorVisible));
+    _cursor.SetBlinkingAllowed(WI_IsFlagSet(header.cursorFlags, s_CursorBlinkingAllowed));
+    _cursor.SetPosition({ std::clamp<SHORT>(header.cursorPosition.X, 0, gsl::narrow_cast<SHORT>(width - 1)),
+                          std::clamp<SHORT>(header.cursorPosition.Y, 0, gsl::narrow_cast<SHORT>(height - 1)) });
+
+    // Everything's somewhere new, and every copy of the palette is out of date.
+    _layoutGeneration = NextGeneration();
+    _paletteGeneration = _layoutGeneration;
+}
+
+// Routine Description:
+// - Gets the slice of a cell arena that belongs to the row stored at the given index.
+// Arguments:
+// - arena - The cell arena holding all of the rows' cells
+// - rowIndex - The storage index of the row (not the offset from the first row)
+// - rowWidth - The width of every row in the arena
+// Return Value:
+// - A view over the cells belonging to the requested row.
+gsl::span<CharRowCell> TextBuffer::_GetArenaSlice(std::vector<CharRowCell>& arena,
+                                                  const size_t rowIndex,
+                                                  const size_t rowWidth)
+{
+    FAIL_FAST_IF(!((rowIndex + 1) * rowWidth <= arena.size()));
+    return { arena.data() + (rowIndex * rowWidth), gsl::narrow<ptrdiff_t>(rowWidth) };
 }
 
 // Routine Description:
@@ -66,6 +590,9 @@ UINT TextBuffer::TotalRowCount() const
 // Routine Description:
 // - Retrieves a row from the buffer by its offset from the first row of the text buffer (what corresponds to
 // the top row of the screen buffer)
+// - A row that's packed in cold storage is returned as it is, so only what a row keeps while it's packed
+//   (its attributes, whether it wraps, its long glyphs...) can be read from it. Use the overload that takes
+//   a scratch row to read its cells.
 // Arguments:
 // - Number of rows down from the first row of the buffer.
 // Return Value:
@@ -79,16 +606,41 @@ const ROW& TextBuffer::GetRowByOffset(const size_t index) const
     return _storage[offsetIndex];
 }
 
+// Routine Description:
+// - Retrieves a row from the buffer by its offset from the first row of the text buffer, to read its cells.
+// - A row that's packed in cold storage is decoded into the given scratch row rather than unpacked in place,
+//   so reading never changes the buffer and can happen while others read it too.
+// Arguments:
+// - index - Number of rows down from the first row of the buffer.
+// - scratch - where to decode the row to, if it's packed. Must outlive the returned reference.
+// Return Value:
+// - const reference to the requested row, or to scratch. Asserts if out of bounds.
+// Note: will throw exception if unable to allocate the scratch row's cells
+const ROW& TextBuffer::GetRowByOffset(const size_t index, std::optional<ROW>& scratch) const
+{
+    const ROW& row = GetRowByOffset(index);
+    if (!row.IsPacked())
+    {
+        return row;
+    }
+    return scratch.emplace(row, CharRow::Decoded{});
+}
+
 // Routine Description:
 // - Retrieves a row from the buffer by its offset from the first row of the text buffer (what corresponds to
 // the top row of the screen buffer)
+// - Cold rows are unpacked the first time anything that can write to them asks for them. Since that changes
+//   the buffer, it must only be done by whoever has it to themselves.
 // Arguments:
 // - Number of rows down from the first row of the buffer.
 // Return Value:
 // - reference to the requested row. Asserts if out of bounds.
+// Note: will throw exception if unable to allocate the cells of a cold row
 ROW& TextBuffer::GetRowByOffset(const size_t index)
 {
-    return const_cast<ROW&>(static_cast<const TextBuffer*>(this)->GetRowByOffset(index));
+    ROW& row = const_cast<ROW&>(static_cast<const TextBuffer*>(this)->GetRowByOffset(index));
+    _ThawRow(row);
+    return row;
 }
 
 // Routine Description:
@@ -291,6 +843,45 @@ bool TextBuffer::_PrepareForDoubleByteSequence(const DbcsAttribute dbcsAttribute
     return fSuccess;
 }
 
+// Routine Description:
+// - Runs a write to a row. If the palette ran out of handles along the way, whatever
+//   didn't fit got the fallback attribute, so the palette is compacted and the write
+//   is run again. The fallback attribute is only kept if the palette is still full
+//   of attributes that are in use.
+// Arguments:
+// - write - writes to the row. It has to write the same thing every time it's called.
+// Return Value:
+// - what the last call to write returned
+// Note: will throw exception if the write does
+template<typename TWrite>
+auto TextBuffer::_WriteRow(TWrite&& write)
+{
+    const auto overflows = _attributePalette.GetOverflowCount();
+    auto result = write();
+    if (_attributePalette.GetOverflowCount() == overflows)
+    {
+        return result;
+    }
+
+    try
+    {
+        _CompactAttributePalette();
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return result;
+    }
+
+    const auto retriedOverflows = _attributePalette.GetOverflowCount();
+    result = write();
+    if (_attributePalette.GetOverflowCount() != retriedOverflows)
+    {
+        LOG_HR_MSG(HRESULT_FROM_WIN32(ERROR_BUFFER_OVERFLOW), "The attribute palette is full, so text was written with the default attributes");
+    }
+    return result;
+}
+
 // Routine Description:
 // - Writes cells to the output buffer. Writes at the cursor.
 // Arguments:
@@ -360,9 +951,13 @@ OutputCellIterator TextBuffer::WriteLine(const OutputCellIterator givenIt,
         return givenIt;
     }
 
+    _CompactAttributePaletteIfNeeded();
+
     //  Get the row and write the cells
     ROW& row = GetRowByOffset(target.Y);
-    const auto newIt = row.WriteCells(givenIt, target.X, setWrap, limitRight);
+    const auto newIt = _WriteRow([&]() {
+        return row.WriteCells(givenIt, target.X, setWrap, limitRight);
+    });
 
     // Take the cell distance written and notify that it needs to be repainted.
     const auto written = newIt.GetCellDistance(givenIt);
@@ -372,73 +967,327 @@ OutputCellIterator TextBuffer::WriteLine(const OutputCellIterator givenIt,
     return newIt;
 }
 
-//Routine Description:
-// - Inserts one codepoint into the buffer at the current cursor position and advances the cursor as appropriate.
-//Arguments:
-// - chars - The codepoint to insert
-// - dbcsAttribute - Double byte information associated with the codepoint
-// - bAttr - Color data associated with the character
-//Return Value:
-// - true if we successfully inserted the character
-// - false otherwise (out of memory)
-bool TextBuffer::InsertCharacter(const std::wstring_view chars,
-                                 const DbcsAttribute dbcsAttribute,
-                                 const TextAttribute attr)
+// Routine Description:
+// - Tells whether every character of the text takes up exactly one cell whatever the font, so that WriteNarrowLine
+//   can write it. That's printable ASCII, which is never a control character either.
+// Arguments:
+// - text - The text to check
+// Return Value:
+// - true if the text can be written with WriteNarrowLine.
+bool TextBuffer::IsNarrowText(const std::wstring_view text) noexcept
 {
-    // Ensure consistent buffer state for double byte characters based on the character type we're about to insert
-    bool fSuccess = _PrepareForDoubleByteSequence(dbcsAttribute);
+    return NarrowTextLength(text) == text.size();
+}
 
-    if (fSuccess)
-    {
-        // Get the current cursor position
-        short const iRow = GetCursor().GetPosition().Y; // row stored as logical position, not array position
-        short const iCol = GetCursor().GetPosition().X; // column logical and array positions are equal.
+// Routine Description:
+// - Counts how many characters at the start of the text IsNarrowText would accept.
+// Arguments:
+// - text - The text to check
+// Return Value:
+// - The number of characters at the start of the text that WriteNarrowLine can write.
+size_t TextBuffer::NarrowTextLength(const std::wstring_view text) noexcept
+{
+    const auto end = std::find_if(text.begin(), text.end(), [](const wchar_t wch) noexcept {
+        return wch < L' ' || wch > L'~';
+    });
+    return gsl::narrow_cast<size_t>(end - text.begin());
+}
 
-        // Get the row associated with the given logical position
-        ROW& Row = GetRowByOffset(iRow);
+// Routine Description:
+// - Writes one line of narrow text in one color to the output buffer, the way WriteLine would with an iterator over
+//   the text and the color. The characters are copied straight into the row's cells, and the color is merged into
+//   its attributes as a single run, instead of a cell at a time.
+// Arguments:
+// - text - The text to write. It has to be IsNarrowText.
+// - attr - The color to give the text
+// - target - Coordinate targeted within output buffer
+// - setWrap - Whether we should set the wrap flag if we write up to the end of the line
+// Return Value:
+// - The number of characters written, which is also the number of cells. Stops at the end of the line.
+// Note:
+// - will throw exception on error.
+size_t TextBuffer::WriteNarrowLine(const std::wstring_view text,
+                                   const TextAttribute attr,
+                                   const COORD target,
+                                   const bool setWrap)
+{
+    if (!GetSize().IsInBounds(target))
+    {
+        return 0;
+    }
 
-        // Store character and double byte data
-        CharRow& charRow = Row.GetCharRow();
-        short const cBufferWidth = GetSize().Width();
+    _CompactAttributePaletteIfNeeded();
 
-        try
-        {
-            charRow.GlyphAt(iCol) = chars;
-            charRow.DbcsAttrAt(iCol) = dbcsAttribute;
-        }
-        catch (...)
-        {
-            LOG_HR(wil::ResultFromCaughtException());
-            return false;
-        }
+    ROW& row = GetRowByOffset(target.Y);
+    const auto written = _WriteRow([&]() {
+        return row.WriteNarrowText(text, attr, target.X, setWrap);
+    });
 
-        // Store color data
-        fSuccess = Row.GetAttrRow().SetAttrToEnd(iCol, attr);
-        if (fSuccess)
-        {
-            // Advance the cursor
-            fSuccess = IncrementCursor();
-        }
-    }
-    return fSuccess;
+    _NotifyPaint(Viewport::FromDimensions(target, { gsl::narrow<SHORT>(written), 1 }));
+    return written;
 }
 
-//Routine Description:
-// - Inserts one ucs2 codepoint into the buffer at the current cursor position and advances the cursor as appropriate.
-//Arguments:
-// - wch - The codepoint to insert
-// - dbcsAttribute - Double byte information associated with the codepoint
-// - bAttr - Color data associated with the character
-//Return Value:
-// - true if we successfully inserted the character
-// - false otherwise (out of memory)
-bool TextBuffer::InsertCharacter(const wchar_t wch, const DbcsAttribute dbcsAttribute, const TextAttribute attr)
+// Routine Description:
+// - Writes a rectangle of legacy CHAR_INFO cells to the output buffer, a row at a time, and notifies that the
+//   whole rectangle needs to be repainted at once.
+// Arguments:
+// - cells - The cells to write, in rows that are stride cells apart, starting with the top left one.
+// - stride - How many cells apart the start of each row is in cells. At least as many as the rectangle is wide.
+// - rect - Where in the buffer to write the cells to. Must be inside the buffer.
+// Return Value:
+// - <none>
+// Note:
+// - will throw exception on error.
+void TextBuffer::WriteCharInfoRect(const std::basic_string_view<CHAR_INFO> cells,
+                                   const size_t stride,
+                                   const Viewport rect)
 {
-    return InsertCharacter({ &wch, 1 }, dbcsAttribute, attr);
-}
+    THROW_HR_IF(E_INVALIDARG, !GetSize().IsInBounds(rect));
+    const size_t width = gsl::narrow<size_t>(rect.Width());
+    const size_t height = gsl::narrow<size_t>(rect.Height());
+    THROW_HR_IF(E_INVALIDARG, stride < width);
+    THROW_HR_IF(E_INVALIDARG, height > 0 && cells.size() < (height - 1) * stride + width);
 
-//Routine Description:
-// - Finds the current row in the buffer (as indicated by the cursor position)
+    _CompactAttributePaletteIfNeeded();
+
+    for (size_t i = 0; i < height; i++)
+    {
+        ROW& row = GetRowByOffset(gsl::narrow<size_t>(rect.Top()) + i);
+        _WriteRow([&]() {
+            return row.WriteCharInfos(cells.substr(i * stride, width), rect.Left(), true);
+        });
+    }
+
+    _NotifyPaint(rect);
+}
+
+// Routine Description:
+// - Gives a linear run of cells one color, a row at a time, the way Write would with an iterator that only has
+//   that color stored in it, and notifies that the rows it touched need to be repainted at once.
+// Arguments:
+// - attr - The color to fill with
+// - target - The cell to start filling at
+// - count - How many cells to fill. Stops at the end of the buffer.
+// Return Value:
+// - The number of cells that were filled.
+// Note:
+// - will throw exception on error.
+size_t TextBuffer::FillAttributes(const TextAttribute attr, const COORD target, const size_t count)
+{
+    const auto size = GetSize();
+    if (!size.IsInBounds(target))
+    {
+        return 0;
+    }
+
+    _CompactAttributePaletteIfNeeded();
+
+    size_t filled = 0;
+    COORD lineTarget = target;
+    while (filled < count && size.IsInBounds(lineTarget))
+    {
+        ROW& row = GetRowByOffset(lineTarget.Y);
+        filled += _WriteRow([&]() {
+            return row.FillAttributes(attr, lineTarget.X, count - filled);
+        });
+
+        lineTarget.X = 0;
+        ++lineTarget.Y;
+    }
+
+    _NotifyPaint(_GetSpanExtent(target, filled));
+    return filled;
+}
+
+// Routine Description:
+// - Fills a linear run of cells with one narrow character, a row at a time, the way Write would with an
+//   iterator that repeats it, and notifies that the rows it touched need to be repainted at once.
+// Arguments:
+// - wch - The character to fill with. Must not be full width.
+// - target - The cell to start filling at
+// - count - How many cells to fill. Stops at the end of the buffer.
+// Return Value:
+// - The number of cells that were filled.
+// Note:
+// - will throw exception on error.
+size_t TextBuffer::FillCharacters(const wchar_t wch, const COORD target, const size_t count)
+{
+    const auto size = GetSize();
+    if (!size.IsInBounds(target))
+    {
+        return 0;
+    }
+
+    size_t filled = 0;
+    COORD lineTarget = target;
+    while (filled < count && size.IsInBounds(lineTarget))
+    {
+        ROW& row = GetRowByOffset(lineTarget.Y);
+        filled += row.FillCharacters(wch, lineTarget.X, count - filled, true);
+
+        lineTarget.X = 0;
+        ++lineTarget.Y;
+    }
+
+    _NotifyPaint(_GetSpanExtent(target, filled));
+    return filled;
+}
+
+// Routine Description:
+// - Appends the text of a linear run of cells to the given string, a row at a time. A character two cells wide
+//   that's cut in half by either end of the run is read as a space, and otherwise only its leading half is read.
+// Arguments:
+// - text - The string to append to
+// - target - The cell to start reading at
+// - count - How many cells to read. Stops at the end of the buffer.
+// Return Value:
+// - <none>
+// Note:
+// - will throw exception on error.
+void TextBuffer::ReadText(std::pmr::wstring& text, const COORD target, const size_t count) const
+{
+    const auto size = GetSize();
+    if (count == 0 || !size.IsInBounds(target))
+    {
+        return;
+    }
+
+    size_t read = 0;
+    COORD lineTarget = target;
+    std::optional<ROW> scratch;
+    while (read < count && size.IsInBounds(lineTarget))
+    {
+        const ROW& row = GetRowByOffset(lineTarget.Y, scratch);
+        const auto& charRow = row.GetCharRow();
+        const bool first = read == 0;
+        size_t index = lineTarget.X;
+        size_t remaining = std::min(count - read, row.size() - index);
+        read += remaining;
+
+        if (first && charRow.DbcsAttrAt(index).IsTrailing())
+        {
+            text += UNICODE_SPACE;
+            ++index;
+            --remaining;
+        }
+
+        const bool paddedEnd = remaining > 0 && read == count &&
+                               charRow.DbcsAttrAt(index + remaining - 1).IsLeading();
+        if (paddedEnd)
+        {
+            --remaining;
+        }
+
+        if (remaining > 0)
+        {
+            row.AppendText(text, index, remaining);
+        }
+
+        if (paddedEnd)
+        {
+            text += UNICODE_SPACE;
+        }
+
+        lineTarget.X = 0;
+        ++lineTarget.Y;
+    }
+}
+
+// Routine Description:
+// - Finds the part of the buffer that a linear run of cells covers: just the run if it's all on one row,
+//   otherwise every row it touches, all the way across.
+// Arguments:
+// - target - The first cell of the run
+// - count - How many cells are in it. Must all be in the buffer.
+// Return Value:
+// - The region to repaint for the run.
+Viewport TextBuffer::_GetSpanExtent(const COORD target, const size_t count) const
+{
+    const auto size = GetSize();
+    const size_t width = gsl::narrow_cast<size_t>(size.Width());
+    if (count == 0)
+    {
+        return Viewport::Empty();
+    }
+
+    if (target.X + count <= width)
+    {
+        return Viewport::FromDimensions(target, { gsl::narrow<SHORT>(count), 1 });
+    }
+
+    const size_t lastRow = target.Y + (target.X + count - 1) / width;
+    return Viewport::FromInclusive({ 0, target.Y, size.RightInclusive(), gsl::narrow<SHORT>(lastRow) });
+}
+
+//Routine Description:
+// - Inserts one codepoint into the buffer at the current cursor position and advances the cursor as appropriate.
+//Arguments:
+// - chars - The codepoint to insert
+// - dbcsAttribute - Double byte information associated with the codepoint
+// - bAttr - Color data associated with the character
+//Return Value:
+// - true if we successfully inserted the character
+// - false otherwise (out of memory)
+bool TextBuffer::InsertCharacter(const std::wstring_view chars,
+                                 const DbcsAttribute dbcsAttribute,
+                                 const TextAttribute attr)
+{
+    // Ensure consistent buffer state for double byte characters based on the character type we're about to insert
+    bool fSuccess = _PrepareForDoubleByteSequence(dbcsAttribute);
+
+    if (fSuccess)
+    {
+        // Get the current cursor position
+        short const iRow = GetCursor().GetPosition().Y; // row stored as logical position, not array position
+        short const iCol = GetCursor().GetPosition().X; // column logical and array positions are equal.
+
+        // Get the row associated with the given logical position
+        ROW& Row = GetRowByOffset(iRow);
+
+        // Store character and double byte data
+        CharRow& charRow = Row.GetCharRow();
+        short const cBufferWidth = GetSize().Width();
+
+        try
+        {
+            charRow.GlyphAt(iCol) = chars;
+            charRow.DbcsAttrAt(iCol) = dbcsAttribute;
+        }
+        catch (...)
+        {
+            LOG_HR(wil::ResultFromCaughtException());
+            return false;
+        }
+
+        // Store color data
+        Row.MarkChanged();
+
+        fSuccess = Row.GetAttrRow().SetAttrToEnd(iCol, attr);
+        if (fSuccess)
+        {
+            // Advance the cursor
+            fSuccess = IncrementCursor();
+        }
+    }
+    return fSuccess;
+}
+
+//Routine Description:
+// - Inserts one ucs2 codepoint into the buffer at the current cursor position and advances the cursor as appropriate.
+//Arguments:
+// - wch - The codepoint to insert
+// - dbcsAttribute - Double byte information associated with the codepoint
+// - bAttr - Color data associated with the character
+//Return Value:
+// - true if we successfully inserted the character
+// - false otherwise (out of memory)
+bool TextBuffer::InsertCharacter(const wchar_t wch, const DbcsAttribute dbcsAttribute, const TextAttribute attr)
+{
+    return InsertCharacter({ &wch, 1 }, dbcsAttribute, attr);
+}
+
+//Routine Description:
+// - Finds the current row in the buffer (as indicated by the cursor position)
 //   and specifies that we have forced a line wrap on that row
 //Arguments:
 // - <none> - Always sets to wrap
@@ -517,43 +1366,481 @@ bool TextBuffer::NewlineCursor()
         // Stay on the final logical/offset row of the buffer.
         GetCursor().SetYPosition(iFinalRowIndex);
 
-        // Instead increment the circular buffer to move us into the "oldest" row of the backing buffer
-        fSuccess = IncrementCircularBuffer();
+        // Instead increment the circular buffer to move us into the "oldest" row of the backing buffer
+        fSuccess = IncrementCircularBuffer();
+    }
+    else
+    {
+        fSuccess = true;
+    }
+    return fSuccess;
+}
+
+//Routine Description:
+// - Increments the circular buffer by one. Circular buffer is represented by FirstRow variable.
+//Arguments:
+// - <none>
+//Return Value:
+// - true if we successfully incremented the buffer.
+bool TextBuffer::IncrementCircularBuffer()
+{
+    // FirstRow is at any given point in time the array index in the circular buffer that corresponds
+    // to the logical position 0 in the window (cursor coordinates and all other coordinates).
+    _renderTarget.TriggerCircling();
+
+    // If we're keeping history beyond the buffer, save the old "first row" before we lose it.
+    if (_spill)
+    {
+        try
+        {
+            auto& evicted = _storage.at(_firstRow);
+            _ThawRow(evicted);
+            _spill->Append(evicted);
+        }
+        CATCH_LOG();
+    }
+
+    // If the old "first row" wrapped, its line carries on at the next row down, which
+    // becomes the first row of the line that's still in the buffer.
+    const auto topWrapped = _IsWrapForcedAt(0);
+    const auto topLineEnd = _GetLogicalLine(0).end;
+
+    // First, clean out the old "first row" as it will become the "last row" of the buffer after the circle is performed.
+    _linesSuspended = true;
+    bool fSuccess = _storage.at(_firstRow).Reset(_currentAttributes);
+    _linesSuspended = false;
+    if (!fSuccess)
+    {
+        _RelinkLines(0, 1);
+    }
+    else
+    {
+        // Now proceed to increment.
+        // Incrementing it will cause the next line down to become the new "top" of the window (the new "0" in logical coordinates)
+        _firstRow++;
+
+        // If we pass up the height of the buffer, loop back to 0.
+        if (_firstRow >= GetSize().Height())
+        {
+            _firstRow = 0;
+        }
+
+        // Every row now sits one offset higher than it did.
+        _layoutGeneration = NextGeneration();
+        ++_circledRowCount;
+
+        // The rows keep their lines, since they're numbered the same as before. Only
+        // the first one might have to take over its line's end, and the recycled row
+        // at the bottom has to be linked in.
+        if (topWrapped)
+        {
+            _GetLogicalLine(0).end = topLineEnd;
+        }
+        _RelinkLines(_storage.size() - 1, _storage.size());
+
+        // The row we just recycled is now the bottom row and must stay hot,
+        // while the row that slid out of the hot window can be packed away.
+        if (_GetEffectiveHotRowCount() < _storage.size())
+        {
+            try
+            {
+                _FreezeColdRows();
+            }
+            catch (...)
+            {
+                LOG_CAUGHT_EXCEPTION();
+                fSuccess = false;
+            }
+        }
+    }
+    return fSuccess;
+}
+
+// Routine Description:
+// - Rebuilds the attribute palette with only the attributes that are still in use by a row,
+//   and lets go of the hyperlinks that none of those refer to.
+// - Rows refer to the palette by pointer, so the table is swapped out in place.
+// Note: will throw exception if unable to allocate memory for the new table
+void TextBuffer::_CompactAttributePalette()
+{
+    auto oldPalette = std::move(_attributePalette);
+    _attributePalette = TextAttributePalette{};
+
+    // Every row's handles change, so copies of the rows (see RefreshSnapshot) have to be taken again.
+    for (auto& row : _storage)
+    {
+        row.GetAttrRow().RemapPalette(oldPalette);
+        row.MarkChanged();
+    }
+    _paletteGeneration = NextGeneration();
+
+    // If most of what was there is still in use, don't try again right away.
+    _attributePalette.DeferCompaction();
+
+    // Links keep their handles, so the attributes that refer to them don't change.
+    _hyperlinks.Collect(_attributePalette, _currentAttributes);
+}
+
+// Routine Description:
+// - Attributes are only ever added to the palette, so before a write adds more, this gives back
+//   the ones nothing refers to anymore if the palette is running out of handles.
+// Note: a failure to compact is logged, and the write goes ahead with the handles that are left.
+void TextBuffer::_CompactAttributePaletteIfNeeded() noexcept
+{
+    if (_attributePalette.NeedsCompaction())
+    {
+        try
+        {
+            _CompactAttributePalette();
+        }
+        CATCH_LOG();
+    }
+}
+
+// Routine Description:
+// - Gets the intern table shared by the attribute runs of every row in this buffer.
+TextAttributePalette& TextBuffer::GetAttributePalette() noexcept
+{
+    return _attributePalette;
+}
+
+// Routine Description:
+// - Gets the intern table shared by the attribute runs of every row in this buffer.
+const TextAttributePalette& TextBuffer::GetAttributePalette() const noexcept
+{
+    return _attributePalette;
+}
+
+// Routine Description:
+// - Adds a hyperlink (OSC 8) to the buffer, for the attribute of the text that's
+//   written as part of it to refer to. Links that were added before with the same
+//   URI and id get the same handle.
+// - If there are too many links, the ones that aren't on any row anymore are let go first.
+// Arguments:
+// - uri - where the link goes. Must not be empty.
+// - id - the id the application gave the link, if any
+// Return Value:
+// - the handle for TextAttribute::SetHyperlinkId. If the buffer can't hold any more
+//   links, 0 is returned, and the text won't be a link.
+// Note: will throw exception if unable to allocate memory for the link
+uint16_t TextBuffer::AddHyperlink(const std::wstring_view uri, const std::wstring_view id)
+{
+    if (_hyperlinks.NeedsCollection())
+    {
+        try
+        {
+            _CompactAttributePalette();
+        }
+        CATCH_LOG();
+    }
+    return _hyperlinks.Add(uri, id);
+}
+
+// Routine Description:
+// - Gets where a hyperlink in the buffer goes.
+// Arguments:
+// - hyperlinkId - the handle of the link, from a TextAttribute
+// Return Value:
+// - the link's URI, or an empty string if the handle isn't a link.
+std::wstring_view TextBuffer::GetHyperlinkUri(const uint16_t hyperlinkId) const noexcept
+{
+    return _hyperlinks.GetUri(hyperlinkId);
+}
+
+// Routine Description:
+// - Gets the hyperlinks the attributes in this buffer refer to.
+const HyperlinkTable& TextBuffer::GetHyperlinks() const noexcept
+{
+    return _hyperlinks;
+}
+
+// Routine Description:
+// - Gets an attribute from another buffer ready to be used in this one. Only its
+//   hyperlink needs anything done to it, as the handle is only good in the buffer it's from.
+// Arguments:
+// - source - the buffer the attribute is from
+// - attr - the attribute
+// Return Value:
+// - the same attribute, referring to the same link in this buffer
+// Note: will throw exception if unable to allocate memory for the link
+TextAttribute TextBuffer::ImportAttributes(const TextBuffer& source, const TextAttribute attr)
+{
+    auto imported = attr;
+    if (attr.IsHyperlink() && &source != this)
+    {
+        const auto handle = attr.GetHyperlinkId();
+        const auto uri = source._hyperlinks.GetUri(handle);
+        imported.SetHyperlinkId(uri.empty() ? HyperlinkTable::NoHyperlink : AddHyperlink(uri, source._hyperlinks.GetId(handle)));
+    }
+    return imported;
+}
+
+// Routine Description:
+// - Gets the most recent generation stamped on any row of this buffer. Hold on to this
+//   and pass it to GetRowsChangedSince later to find out what has changed since now.
+uint64_t TextBuffer::GetGeneration() const noexcept
+{
+    return _generation;
+}
+
+// Routine Description:
+// - Hands out a new generation for a row that is being changed. Generations only ever increase.
+// - They're counted across all buffers, so that a row of a new buffer never has the same
+//   generation as one that was cached from a buffer that used to be at the same address.
+uint64_t TextBuffer::NextGeneration() noexcept
+{
+    static std::atomic<uint64_t> lastGeneration{ 0 };
+    _generation = ++lastGeneration;
+    return _generation;
+}
+
+// Routine Description:
+// - Finds the rows in a range that have changed since the given generation.
+// - If the rows have shifted offsets since then (the buffer circled or was resized),
+//   every row in the range is reported because its contents are not where they were.
+// - This doesn't unpack cold rows.
+// Arguments:
+// - generation - a value previously returned by GetGeneration
+// - firstRow - the offset of the first row to consider, from the top of the buffer
+// - count - how many rows to consider. The range is clipped to the buffer.
+// Return Value:
+// - the offsets of the changed rows, in increasing order
+std::vector<size_t> TextBuffer::GetRowsChangedSince(const uint64_t generation,
+                                                    const size_t firstRow,
+                                                    const size_t count) const
+{
+    const size_t totalRows = TotalRowCount();
+    const size_t endRow = firstRow + std::min(count, totalRows - std::min(firstRow, totalRows));
+
+    std::vector<size_t> changed;
+    for (size_t offset = firstRow; offset < endRow; ++offset)
+    {
+        const auto& row = _storage.at((_firstRow + offset) % totalRows);
+        if (_layoutGeneration > generation || row.GetGeneration() > generation)
+        {
+            changed.push_back(offset);
+        }
+    }
+    return changed;
+}
+
+// Routine Description:
+// - Gets the generation of the row at the given offset. Unlike GetRowByOffset,
+//   this doesn't unpack the row if it's cold.
+// Arguments:
+// - index - the offset of the row, from the top of the buffer
+// Return Value:
+// - the generation the row was last changed at
+uint64_t TextBuffer::GetRowGeneration(const size_t index) const
+{
+    return _storage.at((_firstRow + index) % TotalRowCount()).GetGeneration();
+}
+
+// Routine Description:
+// - Gets the number of rows that have circled off the top of the buffer since
+//   it was created. The row at a given offset is the same row for as long as
+//   (offset + circled row count) stays the same, until the buffer is resized.
+uint64_t TextBuffer::GetCircledRowCount() const noexcept
+{
+    return _circledRowCount;
+}
+
+// Routine Description:
+// - Finds the first row of the logical line that a row is in, i.e. the row after the
+//   last one above it that doesn't wrap. Lines that started above the top of the buffer
+//   start at its top row.
+// Arguments:
+// - rowOffset - the offset of the row from the top of the buffer
+// Return Value:
+// - the offset of the row the line starts in
+// Note: will throw exception if the row isn't in the buffer
+size_t TextBuffer::GetLogicalLineStart(const size_t rowOffset) const
+{
+    THROW_HR_IF(E_INVALIDARG, rowOffset >= _storage.size());
+
+    const auto start = _GetLogicalLine(rowOffset).start;
+    return gsl::narrow_cast<size_t>(start > _circledRowCount ? start - _circledRowCount : 0);
+}
+
+// Routine Description:
+// - Finds the last row of the logical line that a row is in, i.e. the first one at
+//   or below it that doesn't wrap. Lines that reach the bottom of the buffer end there.
+// Arguments:
+// - rowOffset - the offset of the row from the top of the buffer
+// Return Value:
+// - the offset of the row the line ends in
+// Note: will throw exception if the row isn't in the buffer
+size_t TextBuffer::GetLogicalLineEnd(const size_t rowOffset) const
+{
+    return gsl::narrow_cast<size_t>(_GetLogicalLine(GetLogicalLineStart(rowOffset)).end - _circledRowCount);
+}
+
+// Routine Description:
+// - Called by a row when its text starts or stops wrapping onto the next row.
+//   Links up the rows it joins or splits into lines again.
+// Arguments:
+// - row - the row that changed
+void TextBuffer::NotifyWrapChanged(const ROW& row) noexcept
+{
+    // Rows that aren't in the storage yet, like the ones Deserialize is filling in,
+    // are linked once they're all there.
+    const size_t height = _storage.size();
+    const auto id = gsl::narrow_cast<size_t>(row.GetId());
+    if (_linesSuspended || id >= height || &_storage[id] != &row)
+    {
+        return;
+    }
+
+    const size_t offset = (id + height - gsl::narrow_cast<size_t>(_firstRow)) % height;
+    _RelinkLines(offset, offset + 1);
+}
+
+// Routine Description:
+// - Gets the entry of _lines that belongs to a row.
+// Arguments:
+// - rowOffset - the offset of the row from the top of the buffer. Must be in the buffer.
+TextBuffer::_LogicalLine& TextBuffer::_GetLogicalLine(const size_t rowOffset) noexcept
+{
+    return _lines[(_circledRowCount + rowOffset) % _lines.size()];
+}
+
+const TextBuffer::_LogicalLine& TextBuffer::_GetLogicalLine(const size_t rowOffset) const noexcept
+{
+    return _lines[(_circledRowCount + rowOffset) % _lines.size()];
+}
+
+// Routine Description:
+// - Tells whether the text of a row wraps onto the next one.
+// Arguments:
+// - rowOffset - the offset of the row from the top of the buffer. Must be in the buffer.
+bool TextBuffer::_IsWrapForcedAt(const size_t rowOffset) const noexcept
+{
+    return _storage[(_firstRow + rowOffset) % _storage.size()].GetCharRow().WasWrapForced();
+}
+
+// Routine Description:
+// - Works out again which line each of the given rows is in, after they were moved
+//   or started or stopped wrapping. Past them, rows are only linked again for as far
+//   as the lines that changed reach, so this is usually a handful of rows.
+// - The bottom row always ends its line, even if it wraps, until a row circles in below it.
+// Arguments:
+// - begin - the offset of the first row that changed
+// - end - the offset just past the last row that changed
+void TextBuffer::_RelinkLines(const size_t begin, const size_t end) noexcept
+{
+    const size_t height = _storage.size();
+    if (_lines.size() != height || begin >= height)
+    {
+        return;
+    }
+
+    // The first row carries on the line above it, if that one wraps.
+    auto lineStart = _circledRowCount + begin;
+    if (begin > 0 && _IsWrapForcedAt(begin - 1))
+    {
+        lineStart = _GetLogicalLine(begin - 1).start;
+    }
+
+    for (size_t offset = begin; offset < height; ++offset)
+    {
+        // Once a row below the ones that changed is already in the right
+        // line, so is every row after it.
+        auto& line = _GetLogicalLine(offset);
+        if (offset >= end && line.start == lineStart)
+        {
+            break;
+        }
+
+        line.start = lineStart;
+        if (!_IsWrapForcedAt(offset) || offset == height - 1)
+        {
+            const auto head = lineStart > _circledRowCount ? lineStart - _circledRowCount : 0;
+            _GetLogicalLine(gsl::narrow_cast<size_t>(head)).end = _circledRowCount + offset;
+            lineStart = _circledRowCount + offset + 1;
+        }
+    }
+}
+
+// Routine Description:
+// - Works out which line every row is in from scratch, e.g. after the rows were rearranged.
+// Note: will throw exception if unable to allocate memory for the lines
+void TextBuffer::_RebuildLines()
+{
+    _lines.resize(_storage.size());
+    _RelinkLines(0, _storage.size());
+}
+
+// Routine Description:
+// - Gets the number of bytes this buffer has allocated, counting the cell arena,
+//   every row, the attribute palette and the scrollback spill's bookkeeping.
+//   Allocator overhead isn't included, so this is a lower bound.
+// - This doesn't unpack cold rows.
+size_t TextBuffer::GetMemoryUsage() const noexcept
+{
+    const auto breakdown = MeasureMemory();
+    return sizeof(TextBuffer) +
+           breakdown.cells.bytes +
+           breakdown.rows.bytes +
+           breakdown.attributeRuns.bytes +
+           breakdown.unicodeStorage.bytes +
+           breakdown.attributePalette.bytes +
+           breakdown.other.bytes;
+}
+
+// Routine Description:
+// - Gets what GetMemoryUsage does, split up by what it's for, along with how
+//   many allocations each part is in. The cell arena is counted here even while
+//   a snapshot shares it.
+// - This doesn't unpack cold rows.
+TextBuffer::MemoryBreakdown TextBuffer::MeasureMemory() const noexcept
+{
+    MemoryBreakdown breakdown;
+    breakdown.cells.AddContiguous(*_cellArena);
+    breakdown.rows.AddContiguous(_storage);
+    for (const auto& row : _storage)
+    {
+        const auto& charRow = row.GetCharRow();
+        breakdown.rows += charRow.MeasurePackedMemory();
+        breakdown.unicodeStorage += charRow.GetUnicodeStorage().MeasureMemory();
+        breakdown.attributeRuns += row.GetAttrRow().MeasureMemory();
     }
-    else
+    breakdown.attributePalette = _attributePalette.MeasureMemory();
+    breakdown.attributePalette += _hyperlinks.MeasureMemory();
+    breakdown.other.AddContiguous(_freeArenaSlots);
+    breakdown.other.AddContiguous(_thawedRowIds);
+    breakdown.other.AddContiguous(_lines);
+    if (_spill)
     {
-        fSuccess = true;
+        breakdown.other.AddAllocation(sizeof(ScrollbackSpill));
+        breakdown.other += _spill->MeasureMemory();
     }
-    return fSuccess;
+    return breakdown;
 }
 
-//Routine Description:
-// - Increments the circular buffer by one. Circular buffer is represented by FirstRow variable.
-//Arguments:
-// - <none>
-//Return Value:
-// - true if we successfully incremented the buffer.
-bool TextBuffer::IncrementCircularBuffer()
+// Routine Description:
+// - Blanks the rows at the top of the buffer and gives back whatever they had
+//   allocated. Cold rows stay packed, so this never has to unpack anything.
+// Arguments:
+// - count - how many rows to clear, counting down from the top. Clipped to the buffer.
+// Note: may throw exception if the rows' memory can't be reallocated
+void TextBuffer::ClearOldestRows(const size_t count)
 {
-    // FirstRow is at any given point in time the array index in the circular buffer that corresponds
-    // to the logical position 0 in the window (cursor coordinates and all other coordinates).
-    _renderTarget.TriggerCircling();
+    const size_t height = _storage.size();
+    const size_t clear = std::min(count, height);
 
-    // First, clean out the old "first row" as it will become the "last row" of the buffer after the circle is performed.
-    bool fSuccess = _storage.at(_firstRow).Reset(_currentAttributes);
-    if (fSuccess)
-    {
-        // Now proceed to increment.
-        // Incrementing it will cause the next line down to become the new "top" of the window (the new "0" in logical coordinates)
-        _firstRow++;
+    // Link up the lines once the rows are all clear, rather than once for every row that wrapped.
+    _linesSuspended = true;
+    auto relink = wil::scope_exit([&]() noexcept {
+        _linesSuspended = false;
+        _RelinkLines(0, clear);
+    });
 
-        // If we pass up the height of the buffer, loop back to 0.
-        if (_firstRow >= GetSize().Height())
-        {
-            _firstRow = 0;
-        }
+    for (size_t offset = 0; offset < clear; ++offset)
+    {
+        auto& row = _storage.at((_firstRow + offset) % height);
+        row.Reset(_currentAttributes);
+        row.ReleaseUnusedMemory();
     }
-    return fSuccess;
 }
 
 //Routine Description:
@@ -568,7 +1855,8 @@ COORD TextBuffer::GetLastNonSpaceCharacter() const
     // Always search the whole buffer, by starting at the bottom.
     coordEndOfText.Y = GetSize().BottomInclusive();
 
-    const ROW* pCurrRow = &GetRowByOffset(coordEndOfText.Y);
+    std::optional<ROW> scratch;
+    const ROW* pCurrRow = &GetRowByOffset(coordEndOfText.Y, scratch);
     // The X position of the end of the valid text is the Right draw boundary (which is one beyond the final valid character)
     coordEndOfText.X = static_cast<short>(pCurrRow->GetCharRow().MeasureRight()) - 1;
 
@@ -577,7 +1865,7 @@ COORD TextBuffer::GetLastNonSpaceCharacter() const
     while (fDoBackUp)
     {
         coordEndOfText.Y--;
-        pCurrRow = &GetRowByOffset(coordEndOfText.Y);
+        pCurrRow = &GetRowByOffset(coordEndOfText.Y, scratch);
         // We need to back up to the previous row if this line is empty, AND there are more rows
 
         coordEndOfText.X = static_cast<short>(pCurrRow->GetCharRow().MeasureRight()) - 1;
@@ -645,10 +1933,18 @@ void TextBuffer::ScrollRows(const SHORT firstRow, const SHORT size, const SHORT
         return;
     }
 
-    // OK. We're about to play games by moving rows around within the deque to
+    // The rows that move, along with the ones they move over, by offset.
+    const size_t height = _storage.size();
+    const size_t spanStart = gsl::narrow<size_t>((delta < 0) ? firstRow + delta : firstRow);
+    const size_t spanEnd = gsl::narrow<size_t>((delta < 0) ? firstRow + size : firstRow + size + delta);
+
+    // OK. We're about to play games by moving rows around within the storage to
     // scroll a massive region in a faster way than copying things.
-    // To make this easier, first correct the circular buffer to have the first row be 0 again.
-    if (_firstRow != 0)
+    // If the span doesn't wrap around the end of the storage, its rows are already
+    // in order and can be rotated right where they are. Otherwise, to make this
+    // easier, first correct the circular buffer to have the first row be 0 again.
+    const bool wholeStorage = (_firstRow + spanStart) % height + (spanEnd - spanStart) > height;
+    if (wholeStorage)
     {
         // Rotate the buffer to put the first row at the front.
         std::rotate(_storage.begin(), _storage.begin() + _firstRow, _storage.end());
@@ -657,6 +1953,10 @@ void TextBuffer::ScrollRows(const SHORT firstRow, const SHORT size, const SHORT
         _firstRow = 0;
     }
 
+    // Where the span starts in the storage, and where a row at the given offset inside of it is.
+    const size_t storageStart = (_firstRow + spanStart) % height;
+    const auto at = [&](const size_t offset) { return _storage.begin() + (storageStart + offset - spanStart); };
+
     // Rotate just the subsection specified
     if (delta < 0)
     {
@@ -693,7 +1993,7 @@ void TextBuffer::ScrollRows(const SHORT firstRow, const SHORT size, const SHORT
         // | 10
         // | 11
         // - end
-        std::rotate(_storage.begin() + firstRow + delta, _storage.begin() + firstRow, _storage.begin() + firstRow + size);
+        std::rotate(at(firstRow + delta), at(firstRow), at(firstRow + size));
     }
     else
     {
@@ -730,186 +2030,926 @@ void TextBuffer::ScrollRows(const SHORT firstRow, const SHORT size, const SHORT
         // | 10
         // | 11
         // - end
-        std::rotate(_storage.begin() + firstRow, _storage.begin() + firstRow + size, _storage.begin() + firstRow + size + delta);
+        std::rotate(at(firstRow), at(firstRow + size), at(firstRow + size + delta));
+    }
+
+    // Renumber the IDs now that we've rearranged where the rows sit within the buffer.
+    // Long glyphs are stored with their rows, so nothing needs to be re-keyed.
+    if (wholeStorage)
+    {
+        _RefreshRowIDs();
+    }
+    else
+    {
+        _RefreshRowIDs(storageStart, storageStart + spanEnd - spanStart);
+    }
+
+    // Every row in the rotated span now shows different contents at its offset.
+    for (auto i = storageStart; i < storageStart + spanEnd - spanStart; ++i)
+    {
+        _storage.at(i).MarkChanged();
+    }
+
+    // And they might be in different lines now.
+    _RelinkLines(spanStart, spanEnd);
+}
+
+// Routine Description:
+// - Blanks out whole rows of the buffer with spaces in the given attributes,
+//   a row at a time instead of a cell at a time, and notifies that they all
+//   need to be repainted at once.
+// Arguments:
+// - firstRow - The offset of the first row to blank out.
+// - count - How many rows to blank out.
+// - attr - The attributes to give the blanked out rows.
+// Return Value:
+// - <none>
+// Note:
+// - will throw exception on error.
+void TextBuffer::ClearRows(const size_t firstRow, const size_t count, const TextAttribute attr)
+{
+    const auto size = GetSize();
+    THROW_HR_IF(E_INVALIDARG, firstRow + count > gsl::narrow<size_t>(size.Height()));
+    if (count == 0)
+    {
+        return;
+    }
+
+    _CompactAttributePaletteIfNeeded();
+
+    _linesSuspended = true;
+    auto relink = wil::scope_exit([&]() noexcept {
+        _linesSuspended = false;
+        _RelinkLines(firstRow, firstRow + count);
+    });
+
+    for (size_t i = 0; i < count; i++)
+    {
+        THROW_HR_IF(E_OUTOFMEMORY, !GetRowByOffset(firstRow + i).Reset(attr));
+    }
+
+    _NotifyPaint(Viewport::FromDimensions({ 0, gsl::narrow<SHORT>(firstRow) },
+                                          { size.Width(), gsl::narrow<SHORT>(count) }));
+}
+
+Cursor& TextBuffer::GetCursor()
+{
+    return _cursor;
+}
+
+const Cursor& TextBuffer::GetCursor() const
+{
+    return _cursor;
+}
+
+[[nodiscard]]
+TextAttribute TextBuffer::GetCurrentAttributes() const noexcept
+{
+    return _currentAttributes;
+}
+
+void TextBuffer::SetCurrentAttributes(const TextAttribute currentAttributes) noexcept
+{
+    _currentAttributes = currentAttributes;
+}
+
+// Routine Description:
+// - Resets the text contents of this buffer with the default character
+//   and the default current color attributes
+void TextBuffer::Reset()
+{
+    const auto attr = GetCurrentAttributes();
+
+    _linesSuspended = true;
+    auto relink = wil::scope_exit([&]() noexcept {
+        _linesSuspended = false;
+        _RelinkLines(0, _storage.size());
+    });
+
+    for (auto& row : _storage)
+    {
+        row.GetCharRow().Reset();
+        row.GetAttrRow().Reset(attr);
+        row.MarkChanged();
+    }
+}
+
+// Routine Description:
+// - This is the legacy screen resize with minimal changes
+// - Rows that it drops off the top of the buffer go to its spill, if it has one.
+// - If it fails, the buffer is left as it was.
+// Arguments:
+// - newSize - new size of screen.
+// Return Value:
+// - Success if successful. Invalid parameter if screen buffer size is unexpected. No memory if allocation failed.
+[[nodiscard]]
+NTSTATUS TextBuffer::ResizeTraditional(const COORD newSize) noexcept
+{
+    RETURN_HR_IF(E_INVALIDARG, newSize.X < 0 || newSize.Y < 0);
+
+    const auto currentSize = GetSize().Dimensions();
+    const auto attributes = GetCurrentAttributes();
+
+    SHORT TopRow = 0; // new top row of the screen buffer
+    if (newSize.Y <= GetCursor().GetPosition().Y)
+    {
+        TopRow = GetCursor().GetPosition().Y - newSize.Y + 1;
+    }
+    const SHORT TopRowIndex = (GetFirstRowIndex() + TopRow) % currentSize.Y;
+
+    try
+    {
+        const size_t newWidth = gsl::narrow<size_t>(newSize.X);
+        const size_t newHeight = gsl::narrow<size_t>(newSize.Y);
+        const size_t keptRows = std::min(_storage.size(), newHeight);
+
+        // Everything that can fail is done before any row is touched, so that
+        // the buffer is left as it was if it does.
+        // Making room moves the rows, but doesn't change them otherwise.
+        _storage.reserve(newHeight);
+        for (auto& row : _storage)
+        {
+            row.GetCharRow().UpdateParent(&row);
+        }
+        _lines.reserve(newHeight);
+
+        // add rows if we're growing. They start out without any cells and
+        // get placed into the arena below along with everybody else.
+        std::vector<ROW> addedRows;
+        addedRows.reserve(newHeight - keptRows);
+        while (keptRows + addedRows.size() < newHeight)
+        {
+            addedRows.emplace_back(gsl::narrow_cast<SHORT>(keptRows + addedRows.size()), newWidth, attributes, this);
+        }
+
+        // The rows that'll be in the buffer, from the new top row down.
+        std::vector<ROW*> rows;
+        rows.reserve(newHeight);
+        for (size_t i = 0; i < keptRows; ++i)
+        {
+            rows.push_back(&_storage[(TopRowIndex + i) % _storage.size()]);
+        }
+        for (auto& row : addedRows)
+        {
+            rows.push_back(&row);
+        }
+
+        // Work out where the hot rows go in a new arena and pack the cold ones.
+        // This also takes care of resizing them in the X dimension.
+        auto layout = _PrepareLayout(rows, newWidth, _hotRowCount);
+
+        // The rows above the new top row are dropped. If we're keeping history beyond the
+        // buffer, save them first, as IncrementCircularBuffer does. Rows that don't fit
+        // below the cursor come after the ones that stay, so they aren't history to keep.
+        if (_spill)
+        {
+            try
+            {
+                std::optional<ROW> scratch;
+                for (SHORT y = 0; y < TopRow; ++y)
+                {
+                    _spill->Append(std::as_const(*this).GetRowByOffset(y, scratch));
+                }
+            }
+            CATCH_LOG();
+        }
+
+        // Nothing past here can fail. Move every row onto the new layout first,
+        // while the pointers to them are still good. That marks them all as
+        // changed too, since rows that were rearranged don't hold what they did
+        // before, even if they happen to end up at the same offset.
+        // Long glyphs that fell outside the new width are dropped as well.
+        _CommitLayout(rows, std::move(layout));
+
+        // rotate rows until the top row is at index 0
+        std::rotate(_storage.begin(), _storage.begin() + TopRowIndex, _storage.end());
+
+        _SetFirstRowIndex(0);
+
+        // realloc in the Y direction. There's already room for the added rows.
+        _storage.erase(_storage.begin() + keptRows, _storage.end());
+        std::move(addedRows.begin(), addedRows.end(), std::back_inserter(_storage));
+
+        // Now that we've tampered with the row placement, refresh all the row IDs.
+        // Every row is in the new arena or packed, so none are tracked as thawed.
+        _RefreshRowIDs();
+        _layoutGeneration = NextGeneration();
+
+        // There's already room for the lines too.
+        _RebuildLines();
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Routine Description:
+// - This is a resize algorithm which will reflow the ends of lines based on the
+//   line wrap state used for clipboard line-based copy.
+// - The text is copied a run of cells at a time, up to whichever of the end of the
+//   old row's text or the end of the new row comes first. Each run's characters,
+//   long glyphs and attributes are moved in one go, so the whole pass is linear in
+//   the amount of text rather than inserting every character on its own.
+// - The new buffer's cursor is placed on the character equivalent to where the
+//   old buffer's cursor was.
+// Arguments:
+// - oldBuffer - the buffer to copy the text from
+// - newBuffer - a freshly constructed buffer of the new size to reflow the text into
+// Return Value:
+// - S_OK if we successfully copied the text into the new buffer
+// - E_OUTOFMEMORY if the new cursor couldn't be moved, or another failure HRESULT as appropriate.
+[[nodiscard]]
+HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer) noexcept
+{
+    try
+    {
+        const Cursor& oldCursor = oldBuffer.GetCursor();
+        Cursor& newCursor = newBuffer.GetCursor();
+
+        // The new buffer hasn't got any links of its own yet, so it can take the old
+        // buffer's as they are, and the copied attributes' handles stay good.
+        newBuffer._hyperlinks = oldBuffer._hyperlinks;
+
+        // We need to save the old cursor position so that we can
+        // place the new cursor back on the equivalent character in
+        // the new buffer.
+        const COORD cOldCursorPos = oldCursor.GetPosition();
+        const COORD cOldLastChar = oldBuffer.GetLastNonSpaceCharacter();
+
+        const short cOldRowsTotal = cOldLastChar.Y + 1;
+        const short cOldColsTotal = oldBuffer.GetSize().Width();
+        const short cNewColsTotal = newBuffer.GetSize().Width();
+
+        COORD cNewCursorPos = { 0 };
+        bool fFoundCursorPos = false;
+
+        // Loop through all the rows of the old buffer and reprint them into the new buffer
+        for (short iOldRow = 0; iOldRow < cOldRowsTotal; iOldRow++)
+        {
+            // Fetch the row and its "right" which is the last printable character.
+            const ROW& row = oldBuffer.GetRowByOffset(iOldRow);
+            const CharRow& charRow = row.GetCharRow();
+            short iRight = static_cast<short>(charRow.MeasureRight());
+
+            // There is a special case here. If the row has a "wrap"
+            // flag on it, but the right isn't equal to the width (one
+            // index past the final valid index in the row) then there
+            // were a bunch trailing of spaces in the row.
+            // (But the measuring functions for each row Left/Right do
+            // not count spaces as "displayable" so they're not
+            // included.)
+            // As such, adjust the "right" to be the width of the row
+            // to capture all these spaces
+            if (charRow.WasWrapForced())
+            {
+                iRight = cOldColsTotal;
+
+                // And a combined special case.
+                // If we wrapped off the end of the row by adding a
+                // piece of padding because of a double byte LEADING
+                // character, then remove one from the "right" to
+                // leave this padding out of the copy process.
+                if (charRow.WasDoubleBytePadded())
+                {
+                    iRight--;
+                }
+            }
+
+            // Copy everything up to the "right" boundary (which is one
+            // past the final valid character) over as a series of runs.
+            short iOldCol = 0;
+            while (iOldCol < iRight)
+            {
+                const COORD coordNewPos = newCursor.GetPosition();
+
+                // A leading byte can't sit in the final column of a row. Pad it
+                // out onto the next row, then copy it on the next time around.
+                if (cNewColsTotal > 1 &&
+                    coordNewPos.X == cNewColsTotal - 1 &&
+                    charRow.DbcsAttrAt(iOldCol).IsLeading())
+                {
+                    if (iOldCol == cOldCursorPos.X && iOldRow == cOldCursorPos.Y)
+                    {
+                        cNewCursorPos = coordNewPos;
+                        fFoundCursorPos = true;
+                    }
+
+                    newBuffer.GetRowByOffset(coordNewPos.Y).GetCharRow().SetDoubleBytePadded(true);
+                    RETURN_HR_IF(E_OUTOFMEMORY, !newBuffer.IncrementCursor());
+                    continue;
+                }
+
+                // Take as much of the old row as still fits on the new one. If that would
+                // leave a leading byte in the final column, stop just short of it.
+                short cCopy = gsl::narrow_cast<short>(std::min(iRight - iOldCol, cNewColsTotal - coordNewPos.X));
+                if (cCopy > 1 &&
+                    coordNewPos.X + cCopy == cNewColsTotal &&
+                    charRow.DbcsAttrAt(iOldCol + cCopy - 1).IsLeading())
+                {
+                    cCopy--;
+                }
+
+                if (!fFoundCursorPos &&
+                    iOldRow == cOldCursorPos.Y &&
+                    cOldCursorPos.X >= iOldCol &&
+                    cOldCursorPos.X < iOldCol + cCopy)
+                {
+                    cNewCursorPos = coordNewPos;
+                    cNewCursorPos.X += cOldCursorPos.X - iOldCol;
+                    fFoundCursorPos = true;
+                }
+
+                newBuffer._CopyCellsToCursor(row, iOldCol, cCopy);
+
+                // Put the cursor on the last cell we copied and step off of it, so that
+                // wrapping and circling the new buffer happen just as they do for typed text.
+                newCursor.SetXPosition(coordNewPos.X + cCopy - 1);
+                RETURN_HR_IF(E_OUTOFMEMORY, !newBuffer.IncrementCursor());
+
+                iOldCol += cCopy;
+            }
+
+            // If we didn't have a full row to copy, insert a new
+            // line into the new buffer.
+            // Only do so if we were not forced to wrap. If we did
+            // force a word wrap, then the existing line break was
+            // only because we ran out of space.
+            if (iRight < cOldColsTotal && !charRow.WasWrapForced())
+            {
+                if (iRight == cOldCursorPos.X && iOldRow == cOldCursorPos.Y)
+                {
+                    cNewCursorPos = newCursor.GetPosition();
+                    fFoundCursorPos = true;
+                }
+                // Only do this if it's not the final line in the buffer.
+                // On the final line, we want the cursor to sit
+                // where it is done printing for the cursor
+                // adjustment to follow.
+                if (iOldRow < cOldRowsTotal - 1)
+                {
+                    RETURN_HR_IF(E_OUTOFMEMORY, !newBuffer.NewlineCursor());
+                }
+                else
+                {
+                    // If we are on the final line of the buffer, we have one more check.
+                    // We got into this code path because we are at the right most column of a row in the old buffer
+                    // that had a hard return (no wrap was forced).
+                    // However, as we're inserting, the old row might have just barely fit into the new buffer and
+                    // caused a new soft return (wrap was forced) putting the cursor at x=0 on the line just below.
+                    // We need to preserve the memory of the hard return at this point by inserting one additional
+                    // hard newline, otherwise we've lost that information.
+                    // We only do this when the cursor has just barely poured over onto the next line so the hard return
+                    // isn't covered by the soft one.
+                    // e.g.
+                    // The old line was:
+                    // |aaaaaaaaaaaaaaaaaaa | with no wrap which means there was a newline after that final a.
+                    // The cursor was here ^
+                    // And the new line will be:
+                    // |aaaaaaaaaaaaaaaaaaa| and show a wrap at the end
+                    // |                   |
+                    //  ^ and the cursor is now there.
+                    // If we leave it like this, we've lost the newline information.
+                    // So we insert one more newline so a continued reflow of this buffer by resizing larger will
+                    // continue to look as the original output intended with the newline data.
+                    // After this fix, it looks like this:
+                    // |aaaaaaaaaaaaaaaaaaa| no wrap at the end (preserved hard newline)
+                    // |                   |
+                    //  ^ and the cursor is now here.
+                    const COORD coordNewCursor = newCursor.GetPosition();
+                    if (coordNewCursor.X == 0 && coordNewCursor.Y > 0)
+                    {
+                        if (newBuffer.GetRowByOffset(coordNewCursor.Y - 1).GetCharRow().WasWrapForced())
+                        {
+                            RETURN_HR_IF(E_OUTOFMEMORY, !newBuffer.NewlineCursor());
+                        }
+                    }
+                }
+            }
+        }
+
+        // Finish copying remaining parameters from the old text buffer to the new one
+        newBuffer.CopyProperties(oldBuffer);
+
+        // If we found where to put the cursor while placing characters into the buffer,
+        //   just put the cursor there. Otherwise we have to advance manually.
+        if (fFoundCursorPos)
+        {
+            newCursor.SetPosition(cNewCursorPos);
+        }
+        else
+        {
+            // Advance the cursor to the same offset as before
+            // get the number of newlines and spaces between the old end of text and the old cursor,
+            //   then advance that many newlines and chars
+            int iNewlines = cOldCursorPos.Y - cOldLastChar.Y;
+            const int iIncrements = cOldCursorPos.X - cOldLastChar.X;
+            const COORD cNewLastChar = newBuffer.GetLastNonSpaceCharacter();
+
+            // If the last row of the new buffer wrapped, there's going to be one less newline needed,
+            //   because the cursor is already on the next line
+            if (newBuffer.GetRowByOffset(cNewLastChar.Y).GetCharRow().WasWrapForced())
+            {
+                iNewlines = std::max(iNewlines - 1, 0);
+            }
+            else
+            {
+                // if this buffer didn't wrap, but the old one DID, then the d(columns) of the
+                //   old buffer will be one more than in this buffer, so new need one LESS.
+                if (oldBuffer.GetRowByOffset(cOldLastChar.Y).GetCharRow().WasWrapForced())
+                {
+                    iNewlines = std::max(iNewlines - 1, 0);
+                }
+            }
+
+            for (int r = 0; r < iNewlines; r++)
+            {
+                RETURN_HR_IF(E_OUTOFMEMORY, !newBuffer.NewlineCursor());
+            }
+            for (int c = 0; c < iIncrements - 1; c++)
+            {
+                RETURN_HR_IF(E_OUTOFMEMORY, !newBuffer.IncrementCursor());
+            }
+        }
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Copies a run of cells from a row into the row under the cursor, starting at the
+//   cursor, along with any long glyphs they refer to and their attributes. The final
+//   attribute is carried on to the end of the row as InsertCharacter would have done.
+// - Unlike InsertCharacter, this does not move the cursor.
+// Arguments:
+// - source - the row to copy from
+// - sourceColumn - the first column of source to copy
+// - count - how many cells to copy. They must all fit on the cursor's row.
+// Note: will throw exception on failure
+void TextBuffer::_CopyCellsToCursor(const ROW& source, const size_t sourceColumn, const size_t count)
+{
+    const COORD target = GetCursor().GetPosition();
+    const size_t targetColumn = gsl::narrow<size_t>(target.X);
+    const size_t width = gsl::narrow<size_t>(GetSize().Width());
+    THROW_HR_IF(E_INVALIDARG, count == 0 || targetColumn + count > width || sourceColumn + count > source.size());
+
+    ROW& row = GetRowByOffset(target.Y);
+    const CharRow& sourceChars = source.GetCharRow();
+    CharRow& chars = row.GetCharRow();
+    row.MarkChanged();
+
+    // The cells themselves are plain data, so they can be copied straight across.
+    std::copy_n(sourceChars.cbegin() + sourceColumn, count, chars.begin() + targetColumn);
+
+    const auto& sourceStorage = sourceChars.GetUnicodeStorage();
+    auto& storage = chars.GetUnicodeStorage();
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (sourceChars.DbcsAttrAt(sourceColumn + i).IsGlyphStored())
+        {
+            storage.StoreGlyph(targetColumn + i, sourceStorage.GetText(sourceColumn + i));
+        }
+        else
+        {
+            storage.Erase(targetColumn + i);
+        }
+    }
+
+    std::vector<TextAttributeRun> runs;
+    const ATTR_ROW& sourceAttrs = source.GetAttrRow();
+    for (size_t column = sourceColumn; column < sourceColumn + count;)
+    {
+        size_t applies = 0;
+        const auto attr = sourceAttrs.GetAttrByColumn(column, &applies);
+        applies = std::min(applies, sourceColumn + count - column);
+        runs.emplace_back(applies, attr);
+        column += applies;
+    }
+    runs.back().SetLength(runs.back().GetLength() + width - (targetColumn + count));
+
+    THROW_IF_FAILED(row.GetAttrRow().InsertAttrRuns({ runs.data(), runs.size() }, targetColumn, width - 1, width));
+}
+
+// Routine Description:
+// - Method to help refresh all the Row IDs after manipulating the row
+//   by shuffling pointers around.
+// - This will also update parent pointers that are stored in depth within the buffer
+//   (e.g. it will update CharRow parents pointing at Rows that might have been moved around)
+// Arguments:
+// - <none>
+void TextBuffer::_RefreshRowIDs()
+{
+    _RefreshRowIDs(0, _storage.size());
+}
+
+// Routine Description:
+// - Renumbers the rows in part of the storage after they've been moved around within it.
+// Arguments:
+// - begin - The index of the first row in the storage that moved.
+// - end - The index just past the last row in the storage that moved.
+// Return Value:
+// - <none>
+void TextBuffer::_RefreshRowIDs(const size_t begin, const size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        auto& row = _storage.at(i);
+
+        // Update the IDs
+        row.SetId(gsl::narrow<SHORT>(i));
+
+        // Also update the char row parent pointers as they can get shuffled up in the rotates.
+        row.GetCharRow().UpdateParent(&row);
     }
 
-    // Renumber the IDs now that we've rearranged where the rows sit within the buffer.
-    // Refreshing should also delegate to the UnicodeStorage to re-key all the stored unicode sequences (where applicable).
-    _RefreshRowIDs(std::nullopt);
+    // Thawed cold rows are tracked by ID, which we just changed for these.
+    _thawedRowIds.erase(std::remove_if(_thawedRowIds.begin(), _thawedRowIds.end(), [=](const SHORT id) {
+                            return gsl::narrow_cast<size_t>(id) >= begin && gsl::narrow_cast<size_t>(id) < end;
+                        }),
+                        _thawedRowIds.end());
+    for (size_t i = begin; i < end; i++)
+    {
+        const auto& row = _storage.at(i);
+        if (!row.IsPacked() && !_GetArenaSlotOf(row).has_value())
+        {
+            _thawedRowIds.push_back(row.GetId());
+        }
+    }
 }
 
-Cursor& TextBuffer::GetCursor()
+void TextBuffer::_NotifyPaint(const Viewport& viewport) const
 {
-    return _cursor;
+    _renderTarget.TriggerRedraw(viewport);
 }
 
-const Cursor& TextBuffer::GetCursor() const
+// Routine Description:
+// - Retrieves the first row from the underlying buffer.
+// Arguments:
+// - <none>
+// Return Value:
+//  - reference to the first row.
+ROW& TextBuffer::_GetFirstRow()
 {
-    return _cursor;
+    return GetRowByOffset(0);
 }
 
-[[nodiscard]]
-TextAttribute TextBuffer::GetCurrentAttributes() const noexcept
+// Routine Description:
+// - Retrieves the row that comes before the given row.
+// - Does not wrap around the screen buffer.
+// Arguments:
+// - The current row.
+// Return Value:
+// - reference to the previous row
+// Note:
+// - will throw exception if called with the first row of the text buffer
+ROW& TextBuffer::_GetPrevRowNoWrap(const ROW& Row)
 {
-    return _currentAttributes;
+    int prevRowIndex = Row.GetId() - 1;
+    if (prevRowIndex < 0)
+    {
+        prevRowIndex = TotalRowCount() - 1;
+    }
+
+    THROW_HR_IF(E_FAIL, Row.GetId() == _firstRow);
+    auto& prevRow = _storage[prevRowIndex];
+    _ThawRow(prevRow);
+    return prevRow;
 }
 
-void TextBuffer::SetCurrentAttributes(const TextAttribute currentAttributes) noexcept
+// Routine Description:
+// - Sets how many rows, counting up from the bottom of the buffer, keep their cells
+//   unpacked in the arena. Rows above that are packed into cold storage and only
+//   re-inflated when something (rendering, search, selection...) touches them.
+// Arguments:
+// - hotRows - the number of hot rows. SIZE_MAX (or anything at least as large as
+//             the buffer) keeps all rows hot.
+// Note: will throw exception if unable to allocate the new arena
+void TextBuffer::SetHotRowCount(const size_t hotRows)
 {
-    _currentAttributes = currentAttributes;
+    THROW_HR_IF(E_INVALIDARG, hotRows == 0);
+
+    _LayoutArena(gsl::narrow<size_t>(GetSize().Width()), hotRows);
+    _hotRowCount = hotRows;
 }
 
 // Routine Description:
-// - Resets the text contents of this buffer with the default character
-//   and the default current color attributes
-void TextBuffer::Reset()
+// - Gets the requested number of hot rows. See SetHotRowCount.
+size_t TextBuffer::GetHotRowCount() const noexcept
 {
-    const auto attr = GetCurrentAttributes();
-
-    for (auto& row : _storage)
-    {
-        row.GetCharRow().Reset();
-        row.GetAttrRow().Reset(attr);
-    }
+    return _hotRowCount;
 }
 
 // Routine Description:
-// - This is the legacy screen resize with minimal changes
+// - Gives the buffer a backing store for the rows that circle off its top.
 // Arguments:
-// - newSize - new size of screen.
+// - spill - the store to use, or nullptr to stop keeping evicted rows.
+void TextBuffer::SetScrollbackSpill(std::unique_ptr<ScrollbackSpill> spill) noexcept
+{
+    _spill = std::move(spill);
+}
+
+// Routine Description:
+// - Gets the backing store for rows that circled off the top of the buffer, if there is one.
 // Return Value:
-// - Success if successful. Invalid parameter if screen buffer size is unexpected. No memory if allocation failed.
-[[nodiscard]]
-NTSTATUS TextBuffer::ResizeTraditional(const COORD newSize) noexcept
+// - the spill store, or nullptr if evicted rows are discarded.
+ScrollbackSpill* TextBuffer::GetScrollbackSpill() const noexcept
 {
-    RETURN_HR_IF(E_INVALIDARG, newSize.X < 0 || newSize.Y < 0);
+    return _spill.get();
+}
 
-    const auto currentSize = GetSize().Dimensions();
-    const auto attributes = GetCurrentAttributes();
+// Routine Description:
+// - Gets how many rows have been spilled out of the top of the buffer so far.
+// Return Value:
+// - the number of spilled rows, or 0 if evicted rows are discarded.
+size_t TextBuffer::GetSpilledRowCount() const noexcept
+{
+    return _spill ? _spill->size() : 0;
+}
 
-    SHORT TopRow = 0; // new top row of the screen buffer
-    if (newSize.Y <= GetCursor().GetPosition().Y)
-    {
-        TopRow = GetCursor().GetPosition().Y - newSize.Y + 1;
-    }
-    const SHORT TopRowIndex = (GetFirstRowIndex() + TopRow) % currentSize.Y;
+// Routine Description:
+// - Reads back a row that was spilled out of the top of the buffer.
+// Arguments:
+// - y - where the row is relative to the top of the buffer. The row spilled last is at -1.
+// Return Value:
+// - the row, as the spill hands it back
+// Note: will throw exception if the row was never spilled, or on I/O failure
+ScrollbackSpill::SpilledRow TextBuffer::_ReadSpilledRow(const int y) const
+{
+    const auto above = -static_cast<int64_t>(y);
+    THROW_HR_IF(E_BOUNDS, above <= 0 || static_cast<uint64_t>(above) > GetSpilledRowCount());
+    return _spill->ReadRow(_spill->size() - gsl::narrow_cast<size_t>(above));
+}
 
-    // rotate rows until the top row is at index 0
-    try
+// Routine Description:
+// - Goes through the text of some of a spilled row's columns, a run of attributes at a time.
+//   A double width glyph is in the run of its leading half.
+// Arguments:
+// - row - the spilled row
+// - left - the first column to go through
+// - right - the column after the last one to go through. Clipped to the row's width.
+// - action - called with the first column, text and attributes of each run
+template<typename TAction>
+void TextBuffer::_ForEachSpilledRun(const ScrollbackSpill::SpilledRow& row,
+                                    const size_t left,
+                                    const size_t right,
+                                    TAction&& action)
+{
+    const std::wstring_view text{ row.text };
+    const auto end = std::min(right, row.width);
+    size_t column = 0;
+    for (const auto& run : row.attributes)
     {
-        const ROW& newTopRow = _storage[TopRowIndex];
-        while (&newTopRow != &_storage.front())
+        if (column >= end)
         {
-            _storage.push_back(std::move(_storage.front()));
-            _storage.pop_front();
+            break;
         }
 
-        _SetFirstRowIndex(0);
-
-        // realloc in the Y direction
-        // remove rows if we're shrinking
-        while (_storage.size() > static_cast<size_t>(newSize.Y))
-        {
-            _storage.pop_back();
-        }
-        // add rows if we're growing
-        while (_storage.size() < static_cast<size_t>(newSize.Y))
+        const auto runStart = std::max(column, left);
+        column += run.GetLength();
+        const auto runEnd = std::min(column, end);
+        if (runStart < runEnd)
         {
-            _storage.emplace_back(static_cast<short>(_storage.size()), newSize.X, attributes, this);
+            const auto offset = row.textOffsets.at(runStart);
+            action(runStart, text.substr(offset, row.textOffsets.at(runEnd) - offset), run.GetAttributes());
         }
+    }
+}
 
-        // Now that we've tampered with the row placement, refresh all the row IDs.
-        // Also take advantage of the row ID refresh loop to resize the rows in the X dimension
-        // and cleanup the UnicodeStorage characters that might fall outside the resized buffer.
-        _RefreshRowIDs(newSize.X);
+// Routine Description:
+// - Writes a row that was spilled out of a buffer over one of this buffer's rows, to show
+//   it again. Columns past this buffer's width are dropped, and the rest is left blank.
+// Arguments:
+// - row - the spilled row, as the spill hands it back
+// - target - the offset of the row to write it over
+// Note: will throw exception if unable to allocate memory
+void TextBuffer::WriteSpilledRow(const ScrollbackSpill::SpilledRow& row, const size_t target)
+{
+    const auto y = gsl::narrow<SHORT>(target);
+    THROW_HR_IF(E_BOUNDS, !GetSize().IsInBounds({ 0, y }));
 
-    }
-    CATCH_RETURN();
+    ROW& targetRow = GetRowByOffset(target);
+    THROW_HR_IF(E_OUTOFMEMORY, !targetRow.Reset(TextAttribute{}));
 
-    return S_OK;
+    _ForEachSpilledRun(row, 0, gsl::narrow<size_t>(GetSize().Width()), [&](const size_t column, const std::wstring_view text, const TextAttribute& attr) {
+        WriteLine(OutputCellIterator(text, attr), { gsl::narrow<SHORT>(column), y });
+    });
+
+    targetRow.GetCharRow().SetWrapForced(row.wrapForced);
+    targetRow.GetCharRow().SetDoubleBytePadded(row.doubleBytePadded);
 }
 
-const UnicodeStorage& TextBuffer::GetUnicodeStorage() const
+// Routine Description:
+// - Gets the number of rows that are actually kept hot given the current buffer height.
+size_t TextBuffer::_GetEffectiveHotRowCount() const noexcept
 {
-    return _unicodeStorage;
+    return std::min(_hotRowCount, _storage.size());
 }
 
-UnicodeStorage& TextBuffer::GetUnicodeStorage()
+// Routine Description:
+// - Determines whether the row at the given storage index falls within the hot window
+//   at the bottom of the buffer.
+bool TextBuffer::_IsRowHot(const size_t storageIndex) const noexcept
 {
-    return _unicodeStorage;
+    const size_t height = _storage.size();
+    const size_t offset = (storageIndex + height - _firstRow) % height;
+    return offset >= height - _GetEffectiveHotRowCount();
 }
 
 // Routine Description:
-// - Method to help refresh all the Row IDs after manipulating the row
-//   by shuffling pointers around.
-// - This will also update parent pointers that are stored in depth within the buffer
-//   (e.g. it will update CharRow parents pointing at Rows that might have been moved around)
-// - Optionally takes a new row width if we're resizing to perform a resize operation and cleanup
-//   any high unicode (UnicodeStorage) runs while we're already looping through the rows.
+// - Finds which slice of the cell arena the given row is using, if any.
+// Return Value:
+// - The slot index of the row's arena slice, or nullopt if it is packed or owns its own cells.
+std::optional<size_t> TextBuffer::_GetArenaSlotOf(const ROW& row) const noexcept
+{
+    const auto& charRow = row.GetCharRow();
+    const auto rowWidth = row.size();
+    if (row.IsPacked() || rowWidth == 0 || _cellArena->empty())
+    {
+        return std::nullopt;
+    }
+
+    const auto first = charRow.cbegin();
+    if (first < _cellArena->data() || first >= _cellArena->data() + _cellArena->size())
+    {
+        return std::nullopt;
+    }
+
+    return static_cast<size_t>(first - _cellArena->data()) / rowWidth;
+}
+
+// Routine Description:
+// - Unpacks a cold row so its cells can be used. A spare arena slice is used if there is one,
+//   otherwise the row gets cells of its own until it is frozen again.
 // Arguments:
-// - newRowWidth - Optional new value for the row width.
-void TextBuffer::_RefreshRowIDs(std::optional<SHORT> newRowWidth)
+// - row - the row to unpack
+void TextBuffer::_ThawRow(ROW& row)
 {
-    std::map<SHORT, SHORT> rowMap;
-    SHORT i = 0;
-    for (auto& it : _storage)
+    if (!row.IsPacked())
     {
-        // Build a map so we can update Unicode Storage
-        rowMap.emplace(it.GetId(), i);
+        return;
+    }
 
-        // Update the IDs
-        it.SetId(i++);
+    if (!_freeArenaSlots.empty())
+    {
+        const auto slot = _freeArenaSlots.back();
+        _freeArenaSlots.pop_back();
+        row.Unpack(_GetArenaSlice(*_cellArena, slot, row.size()));
+    }
+    else
+    {
+        row.UnpackOwned();
+        _thawedRowIds.push_back(row.GetId());
+    }
+}
 
-        // Also update the char row parent pointers as they can get shuffled up in the rotates.
-        it.GetCharRow().UpdateParent(&it);
+// Routine Description:
+// - Packs a row into cold storage, handing its arena slice (if any) back to the free list.
+// Arguments:
+// - row - the row to pack
+void TextBuffer::_FreezeRow(ROW& row)
+{
+    if (row.IsPacked())
+    {
+        return;
+    }
+
+    // A slice that a snapshot can still see can't be handed out again.
+    const auto slot = row.GetCharRow().IsShared() ? std::optional<size_t>{} : _GetArenaSlotOf(row);
+    row.Pack();
+    if (slot.has_value())
+    {
+        _freeArenaSlots.push_back(slot.value());
+    }
+}
 
-        // Resize the rows in the X dimension if we have a new width
-        if (newRowWidth.has_value())
+// Routine Description:
+// - Called after circling the buffer in cold scrollback mode. Packs the row that just
+//   left the hot window and any touched cold rows, then makes sure the bottom row is hot.
+void TextBuffer::_FreezeColdRows()
+{
+    const size_t height = _storage.size();
+    const size_t hot = _GetEffectiveHotRowCount();
+
+    // The row just above the hot window has left it.
+    _FreezeRow(_storage[(_firstRow + height - hot - 1) % height]);
+
+    // Cold rows that were thawed to be looked at go back into storage.
+    auto it = _thawedRowIds.begin();
+    while (it != _thawedRowIds.end())
+    {
+        const size_t index = gsl::narrow<size_t>(*it);
+        if (index < height && !_IsRowHot(index))
+        {
+            _FreezeRow(_storage[index]);
+            it = _thawedRowIds.erase(it);
+        }
+        else
         {
-            // Realloc in the X direction
-            THROW_IF_FAILED(it.Resize(newRowWidth.value()));
+            ++it;
         }
     }
 
-    // Give the new mapping to Unicode Storage
-    _unicodeStorage.Remap(rowMap, newRowWidth);
+    // The recycled row is now at the bottom and takes over the freed slice.
+    _ThawRow(_storage[(_firstRow + height - 1) % height]);
 }
 
-void TextBuffer::_NotifyPaint(const Viewport& viewport) const
+// Routine Description:
+// - Allocates a new cell arena for the given rows and fills it in, without touching them.
+//   The bottom rows (the hot window) get consecutive slices of it with their cells copied
+//   in, the rest get packed forms, and any row whose width changes gets resized attributes.
+// Arguments:
+// - rows - the rows to lay out, from the top of the buffer down
+// - rowWidth - the width of every row once laid out
+// - hotRows - how many rows stay hot, see SetHotRowCount
+// Return Value:
+// - the layout, for _CommitLayout
+// Note: will throw exception if unable to allocate the new arena or any of the rows
+TextBuffer::_ArenaLayout TextBuffer::_PrepareLayout(const gsl::span<ROW* const> rows,
+                                                    const size_t rowWidth,
+                                                    const size_t hotRows) const
 {
-    _renderTarget.TriggerRedraw(viewport);
+    const size_t height = gsl::narrow_cast<size_t>(rows.size());
+
+    _ArenaLayout layout;
+    layout.rowWidth = rowWidth;
+    layout.hotRows = std::min(hotRows, height);
+    layout.arena = std::make_shared<std::vector<CharRowCell>>(layout.hotRows * rowWidth);
+    layout.attrRows.resize(height);
+    layout.packedRows.resize(height);
+
+    const size_t firstHot = height - layout.hotRows;
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        const ROW& row = *rows[offset];
+        if (row.size() != rowWidth)
+        {
+            layout.attrRows[offset].emplace(row.GetAttrRow()).Resize(rowWidth);
+        }
+
+        if (offset >= firstHot)
+        {
+            row.GetCharRow().CopyCellsTo(_GetArenaSlice(*layout.arena, offset - firstHot, rowWidth));
+        }
+        else if (!row.IsPacked() || row.size() != rowWidth)
+        {
+            layout.packedRows[offset] = row.GetCharRow().MakePacked(rowWidth);
+        }
+    }
+
+    return layout;
 }
 
 // Routine Description:
-// - Retrieves the first row from the underlying buffer.
+// - Moves the given rows onto a layout that _PrepareLayout made for them, and makes its
+//   arena the buffer's. Every row is marked as changed.
 // Arguments:
-// - <none>
-// Return Value:
-//  - reference to the first row.
-ROW& TextBuffer::_GetFirstRow()
+// - rows - the same rows the layout was prepared for, in the same order. They don't
+//          have to be where they were, or in the buffer's storage yet.
+// - layout - the layout to use
+void TextBuffer::_CommitLayout(const gsl::span<ROW* const> rows, _ArenaLayout&& layout) noexcept
 {
-    return GetRowByOffset(0);
+    const size_t height = gsl::narrow_cast<size_t>(rows.size());
+    const size_t firstHot = height - layout.hotRows;
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        ROW& row = *rows[offset];
+        if (offset >= firstHot)
+        {
+            row.AdoptCells(_GetArenaSlice(*layout.arena, offset - firstHot, layout.rowWidth), std::move(layout.attrRows[offset]));
+        }
+        else
+        {
+            row.AdoptPacked(std::move(layout.packedRows[offset]), std::move(layout.attrRows[offset]));
+        }
+    }
+
+    // Every hot row now points into the new arena and every cold one is packed,
+    // so the old arena can go (unless a snapshot is still using it).
+    _cellArena = std::move(layout.arena);
+    _freeArenaSlots.clear();
+    _thawedRowIds.clear();
 }
 
 // Routine Description:
-// - Retrieves the row that comes before the given row.
-// - Does not wrap around the screen buffer.
+// - Builds a new cell arena for the current rows. Rows in the hot window are moved onto
+//   consecutive slices of it and everything else is packed into cold storage.
+// - If anything can't be allocated, the rows are left as they were.
 // Arguments:
-// - The current row.
-// Return Value:
-// - reference to the previous row
-// Note:
-// - will throw exception if called with the first row of the text buffer
-ROW& TextBuffer::_GetPrevRowNoWrap(const ROW& Row)
+// - rowWidth - the width of every row once laid out
+// - hotRows - how many rows stay hot, see SetHotRowCount
+// Note: will throw exception if unable to allocate the new arena
+void TextBuffer::_LayoutArena(const size_t rowWidth, const size_t hotRows)
 {
-    int prevRowIndex = Row.GetId() - 1;
-    if (prevRowIndex < 0)
+    const size_t height = _storage.size();
+
+    std::vector<ROW*> rows;
+    rows.reserve(height);
+    for (size_t offset = 0; offset < height; ++offset)
     {
-        prevRowIndex = TotalRowCount() - 1;
+        rows.push_back(&_storage[(_firstRow + offset) % height]);
     }
 
-    THROW_HR_IF(E_FAIL, Row.GetId() == _firstRow);
-    return _storage[prevRowIndex];
+    _CommitLayout(rows, _PrepareLayout(rows, rowWidth, hotRows));
 }
 
 // Method Description:
@@ -928,7 +2968,8 @@ Microsoft::Console::Render::IRenderTarget& TextBuffer::GetRenderTarget()
 // Arguments:
 // - lineSelection - true if entire line is being selected. False otherwise (box selection)
 // - trimTrailingWhitespace - setting flag removes trailing whitespace at the end of each row in selection
-// - selectionRects - the selection regions from which the data will be extracted from the buffer
+// - selectionRects - the selection regions from which the data will be extracted from the buffer.
+//     Rows above the top of the buffer are read back from its spill.
 // - GetForegroundColor - function used to map TextAttribute to RGB COLORREF for foreground color
 // - GetBackgroundColor - function used to map TextAttribute to RGB COLORREF for foreground color
 // Return Value:
@@ -950,13 +2991,8 @@ const TextBuffer::TextAndColor TextBuffer::GetTextForClipboard(const bool lineSe
     // for each row in the selection
     for (UINT i = 0; i < rows; i++)
     {
-        const UINT iRow = selectionRects.at(i).Top;
-
         const Viewport highlight = Viewport::FromInclusive(selectionRects.at(i));
 
-        // retrieve the data from the screen buffer
-        auto it = GetCellDataAt(highlight.Origin(), highlight);
-
         // allocate a string buffer
         std::wstring selectionText;
         std::vector<COLORREF> selectionFgAttr;
@@ -967,33 +3003,74 @@ const TextBuffer::TextAndColor TextBuffer::GetTextForClipboard(const bool lineSe
         selectionFgAttr.reserve(highlight.Width() + 2);
         selectionBkAttr.reserve(highlight.Width() + 2);
 
-        // copy char data into the string buffer, skipping trailing bytes
-        while (it)
+        bool wrapForced = false;
+        if (highlight.Top() < 0)
         {
-            const auto& cell = *it;
-            auto cellData = cell.TextAttr();
-            COLORREF const CellFgAttr = GetForegroundColor(cellData);
-            COLORREF const CellBkAttr = GetBackgroundColor(cellData);
-
-            if (!cell.DbcsAttr().IsTrailing())
+            // A row above the top of the buffer is one that it spilled.
+            const auto spilledRow = _ReadSpilledRow(highlight.Top());
+            wrapForced = spilledRow.wrapForced;
+            _ForEachSpilledRun(spilledRow,
+                               gsl::narrow<size_t>(highlight.Left()),
+                               gsl::narrow<size_t>(highlight.RightExclusive()),
+                               [&](const size_t, const std::wstring_view text, TextAttribute attr) {
+                                   selectionText.append(text);
+                                   selectionFgAttr.insert(selectionFgAttr.end(), text.size(), GetForegroundColor(attr));
+                                   selectionBkAttr.insert(selectionBkAttr.end(), text.size(), GetBackgroundColor(attr));
+                               });
+        }
+        else
+        {
+            const UINT iRow = highlight.Top();
+            std::optional<ROW> scratch;
+            const ROW& highlightRow = GetRowByOffset(iRow, scratch);
+            const CharRow& highlightChars = highlightRow.GetCharRow();
+            wrapForced = highlightChars.WasWrapForced();
+            if (highlightChars.IsNarrowOnly() &&
+                highlightRow.GetAttrRow().GetNumberOfRuns() == 1 &&
+                gsl::narrow_cast<size_t>(highlight.RightExclusive()) <= highlightChars.size())
+            {
+                // A row of narrow glyphs in a single color has one character per cell and
+                // one pair of colors for all of them, so it can be copied straight out.
+                auto rowAttr = highlightRow.GetAttrRow().GetAttrByColumn(0);
+                std::transform(highlightChars.cbegin() + highlight.Left(),
+                               highlightChars.cbegin() + highlight.RightExclusive(),
+                               std::back_inserter(selectionText),
+                               [](const CharRowCell& cell) noexcept { return cell.Char(); });
+                selectionFgAttr.assign(selectionText.size(), GetForegroundColor(rowAttr));
+                selectionBkAttr.assign(selectionText.size(), GetBackgroundColor(rowAttr));
+            }
+            else
             {
-                selectionText.append(cell.Chars());
-                for (const wchar_t wch : cell.Chars())
+                // retrieve the data from the screen buffer
+                auto it = GetCellDataAt(highlight.Origin(), highlight);
+
+                // copy char data into the string buffer, skipping trailing bytes
+                while (it)
                 {
-                    selectionFgAttr.push_back(CellFgAttr);
-                    selectionBkAttr.push_back(CellBkAttr);
+                    const auto& cell = *it;
+                    auto cellData = cell.TextAttr();
+                    COLORREF const CellFgAttr = GetForegroundColor(cellData);
+                    COLORREF const CellBkAttr = GetBackgroundColor(cellData);
+
+                    if (!cell.DbcsAttr().IsTrailing())
+                    {
+                        selectionText.append(cell.Chars());
+                        for (const wchar_t wch : cell.Chars())
+                        {
+                            selectionFgAttr.push_back(CellFgAttr);
+                            selectionBkAttr.push_back(CellBkAttr);
+                        }
+                    }
+                    it++;
                 }
             }
-            it++;
         }
 
         // trim trailing spaces if SHIFT key not held
         if (trimTrailingWhitespace)
         {
-            const ROW& Row = GetRowByOffset(iRow);
-
             // FOR LINE SELECTION ONLY: if the row was wrapped, don't remove the spaces at the end.
-            if (!lineSelection || !Row.GetCharRow().WasWrapForced())
+            if (!lineSelection || !wrapForced)
             {
                 while (!selectionText.empty() && selectionText.back() == UNICODE_SPACE)
                 {
@@ -1010,7 +3087,7 @@ const TextBuffer::TextAndColor TextBuffer::GetTextForClipboard(const bool lineSe
                 // FOR LINE SELECTION ONLY: if the row was wrapped, do not apply CR/LF.
                 // a.k.a. if the row was NOT wrapped, then we can assume a CR/LF is proper
                 // always apply \r\n for box selection
-                if (!lineSelection || !GetRowByOffset(iRow).GetCharRow().WasWrapForced())
+                if (!lineSelection || !wrapForced)
                 {
                     COLORREF const Blackness = RGB(0x00, 0x00, 0x00);      // cant see CR/LF so just use black FG & BK
 
@@ -1031,3 +3108,156 @@ const TextBuffer::TextAndColor TextBuffer::GetTextForClipboard(const bool lineSe
 
     return data;
 }
+
+// Routine Description:
+// - Retrieves the text from the selected region, all in one string, exactly as
+//   GetTextForClipboard would lay it out.
+// - Unlike GetTextForClipboard, nothing is kept per row or per cell. The text is
+//   written straight into the caller's string, which is grown once up front, and
+//   colors are only looked up (once per attribute run, not per cell) if they're asked for.
+// Arguments:
+// - lineSelection - true if entire line is being selected. False otherwise (box selection)
+// - trimTrailingWhitespace - setting flag removes trailing whitespace at the end of each row in selection
+// - selectionRects - the selection regions from which the data will be extracted from the buffer.
+//     Rows above the top of the buffer are read back from its spill.
+// - text - the selected text is appended to this
+// - colors - if not null, receives the colors of the text as runs, in the order of the text.
+// - GetForegroundColor - function used to map TextAttribute to RGB COLORREF for foreground color. Only needed with colors.
+// - GetBackgroundColor - function used to map TextAttribute to RGB COLORREF for background color. Only needed with colors.
+void TextBuffer::GetSelectedText(const bool lineSelection,
+                                 const bool trimTrailingWhitespace,
+                                 const std::vector<SMALL_RECT>& selectionRects,
+                                 std::wstring& text,
+                                 std::vector<ColorRun>* const colors,
+                                 const std::function<COLORREF(TextAttribute&)>& GetForegroundColor,
+                                 const std::function<COLORREF(TextAttribute&)>& GetBackgroundColor) const
+{
+    THROW_HR_IF(E_INVALIDARG, colors && (!GetForegroundColor || !GetBackgroundColor));
+
+    // Adds some text in the given colors, joining it to the last run if it's the same.
+    const auto addRun = [colors](const size_t length, const COLORREF foreground, const COLORREF background) {
+        if (!colors || length == 0)
+        {
+            return;
+        }
+        if (!colors->empty() && colors->back().foreground == foreground && colors->back().background == background)
+        {
+            colors->back().length += length;
+        }
+        else
+        {
+            colors->push_back({ length, foreground, background });
+        }
+    };
+
+    // Takes some text off the end, along with its colors.
+    const auto trimEnd = [&text, colors](size_t length) {
+        text.erase(text.size() - length);
+        while (colors && length > 0)
+        {
+            auto& last = colors->back();
+            const auto trimmed = std::min(length, last.length);
+            last.length -= trimmed;
+            length -= trimmed;
+            if (last.length == 0)
+            {
+                colors->pop_back();
+            }
+        }
+    };
+
+    size_t capacity = text.size();
+    for (const auto& rect : selectionRects)
+    {
+        capacity += (rect.Right - rect.Left + 1) + 2; // + 2 for \r\n
+    }
+    text.reserve(capacity);
+
+    for (size_t i = 0; i < selectionRects.size(); i++)
+    {
+        const auto& rect = selectionRects.at(i);
+        const size_t rowStart = text.size();
+        bool wrapForced = false;
+        if (rect.Top < 0)
+        {
+            // A row above the top of the buffer is one that it spilled.
+            const auto spilledRow = _ReadSpilledRow(rect.Top);
+            wrapForced = spilledRow.wrapForced;
+            _ForEachSpilledRun(spilledRow,
+                               gsl::narrow<size_t>(rect.Left),
+                               gsl::narrow<size_t>(rect.Right) + 1,
+                               [&](const size_t, const std::wstring_view runText, TextAttribute attr) {
+                                   text.append(runText);
+                                   if (colors)
+                                   {
+                                       addRun(runText.size(), GetForegroundColor(attr), GetBackgroundColor(attr));
+                                   }
+                               });
+        }
+        else
+        {
+            std::optional<ROW> scratch;
+            const ROW& row = GetRowByOffset(rect.Top, scratch);
+            const CharRow& charRow = row.GetCharRow();
+            wrapForced = charRow.WasWrapForced();
+
+            const size_t right = std::min(gsl::narrow<size_t>(rect.Right) + 1, charRow.size());
+            for (size_t column = gsl::narrow<size_t>(rect.Left); column < right;)
+            {
+                // Go a run of attributes at a time, so colors are only worked out once for each one.
+                size_t applies = 0;
+                auto attr = row.GetAttrRow().GetAttrByColumn(column, &applies);
+                const size_t runEnd = std::min(column + std::max<size_t>(applies, 1), right);
+
+                const size_t runStart = text.size();
+                if (charRow.IsNarrowOnly())
+                {
+                    std::transform(charRow.cbegin() + column,
+                                   charRow.cbegin() + runEnd,
+                                   std::back_inserter(text),
+                                   [](const CharRowCell& cell) noexcept { return cell.Char(); });
+                }
+                else
+                {
+                    for (size_t glyphColumn = column; glyphColumn < runEnd; ++glyphColumn)
+                    {
+                        if (!charRow.DbcsAttrAt(glyphColumn).IsTrailing())
+                        {
+                            const std::wstring_view glyph = charRow.GlyphAt(glyphColumn);
+                            text.append(glyph);
+                        }
+                    }
+                }
+
+                if (colors)
+                {
+                    addRun(text.size() - runStart, GetForegroundColor(attr), GetBackgroundColor(attr));
+                }
+                column = runEnd;
+            }
+        }
+
+        // trim trailing spaces if SHIFT key not held
+        if (trimTrailingWhitespace)
+        {
+            // FOR LINE SELECTION ONLY: if the row was wrapped, don't remove the spaces at the end.
+            if (!lineSelection || !wrapForced)
+            {
+                const auto lastNonSpace = text.find_last_not_of(UNICODE_SPACE);
+                const size_t keep = (lastNonSpace == std::wstring::npos || lastNonSpace < rowStart) ? rowStart : lastNonSpace + 1;
+                trimEnd(text.size() - keep);
+            }
+
+            // apply CR/LF to the end of the final string, unless we're the last line.
+            // FOR LINE SELECTION ONLY: if the row was wrapped, do not apply CR/LF.
+            if (i < selectionRects.size() - 1 && (!lineSelection || !wrapForced))
+            {
+                COLORREF const Blackness = RGB(0x00, 0x00, 0x00); // cant see CR/LF so just use black FG & BK
+
+                text.push_back(UNICODE_CARRIAGERETURN);
+                text.push_back(UNICODE_LINEFEED);
+                addRun(2, Blackness, Blackness);
+            }
+        }
+    }
+}
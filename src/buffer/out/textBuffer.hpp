@@ -52,7 +52,9 @@ filling in the last row, and updating the screen.
 #include "cursor.h"
 #include "Row.hpp"
 #include "TextAttribute.hpp"
-#include "UnicodeStorage.hpp"
+#include "TextAttributePalette.hpp"
+#include "HyperlinkTable.hpp"
+#include "ScrollbackSpill.hpp"
 #include "../types/inc/Viewport.hpp"
 
 #include "../buffer/out/textBufferCellIterator.hpp"
@@ -69,13 +71,24 @@ public:
                Microsoft::Console::Render::IRenderTarget& renderTarget);
     TextBuffer(const TextBuffer& a) = delete;
 
+    // A copy of this buffer that shares its rows' cells until either side writes to them.
+    std::unique_ptr<TextBuffer> CreateSnapshot(Microsoft::Console::Render::IRenderTarget& renderTarget);
+    [[nodiscard]]
+    bool RefreshSnapshot(TextBuffer& source, const size_t firstRow, const size_t count);
+
     ~TextBuffer() = default;
 
+    // A compact copy of the buffer's contents that can be written out and loaded back
+    // in later, e.g. to restore a session when the app starts again.
+    void Serialize(std::vector<std::byte>& data) const;
+    void Deserialize(const gsl::span<const std::byte> data);
+
     // Used for duplicating properties to another text buffer
     void CopyProperties(const TextBuffer& OtherBuffer);
 
     // row manipulation
     const ROW& GetRowByOffset(const size_t index) const;
+    const ROW& GetRowByOffset(const size_t index, std::optional<ROW>& scratch) const;
     ROW& GetRowByOffset(const size_t index);
 
     TextBufferCellIterator GetCellDataAt(const COORD at) const;
@@ -96,6 +109,21 @@ public:
                                  const bool setWrap = false,
                                  const std::optional<size_t> limitRight = std::nullopt);
 
+    static bool IsNarrowText(const std::wstring_view text) noexcept;
+    static size_t NarrowTextLength(const std::wstring_view text) noexcept;
+    size_t WriteNarrowLine(const std::wstring_view text,
+                           const TextAttribute attr,
+                           const COORD target,
+                           const bool setWrap = false);
+
+    void WriteCharInfoRect(const std::basic_string_view<CHAR_INFO> cells,
+                           const size_t stride,
+                           const Microsoft::Console::Types::Viewport rect);
+
+    size_t FillAttributes(const TextAttribute attr, const COORD target, const size_t count);
+    size_t FillCharacters(const wchar_t wch, const COORD target, const size_t count);
+    void ReadText(std::pmr::wstring& text, const COORD target, const size_t count) const;
+
     bool InsertCharacter(const wchar_t wch, const DbcsAttribute dbcsAttribute, const TextAttribute attr);
     bool InsertCharacter(const std::wstring_view chars, const DbcsAttribute dbcsAttribute, const TextAttribute attr);
     bool IncrementCursor();
@@ -114,6 +142,7 @@ public:
     const Microsoft::Console::Types::Viewport GetSize() const;
 
     void ScrollRows(const SHORT firstRow, const SHORT size, const SHORT delta);
+    void ClearRows(const size_t firstRow, const size_t count, const TextAttribute attr);
 
     UINT TotalRowCount() const;
 
@@ -127,8 +156,70 @@ public:
     [[nodiscard]]
     HRESULT ResizeTraditional(const COORD newSize) noexcept;
 
-    const UnicodeStorage& GetUnicodeStorage() const;
-    UnicodeStorage& GetUnicodeStorage();
+    [[nodiscard]]
+    static HRESULT Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer) noexcept;
+
+    // Cold scrollback: only the bottom-most hotRows rows keep their cells in the arena.
+    // Older rows are packed and only unpacked again when they are touched.
+    void SetHotRowCount(const size_t hotRows);
+    size_t GetHotRowCount() const noexcept;
+
+    // Snapshots share the cell arena until they're destroyed. See CreateSnapshot.
+    bool IsCellArenaShared() const noexcept;
+
+    // Rows that circle off the top of the buffer, or that a resize drops off it, are
+    // written here instead of being lost. The selection methods below take a row above
+    // the top of the buffer (a negative Y) to be one of these, the last one spilled being -1.
+    void SetScrollbackSpill(std::unique_ptr<ScrollbackSpill> spill) noexcept;
+    ScrollbackSpill* GetScrollbackSpill() const noexcept;
+    size_t GetSpilledRowCount() const noexcept;
+    void WriteSpilledRow(const ScrollbackSpill::SpilledRow& row, const size_t target);
+
+    TextAttributePalette& GetAttributePalette() noexcept;
+    const TextAttributePalette& GetAttributePalette() const noexcept;
+
+    // Hyperlinks (OSC 8) are interned here, and attributes only hold their handle.
+    uint16_t AddHyperlink(const std::wstring_view uri, const std::wstring_view id);
+    std::wstring_view GetHyperlinkUri(const uint16_t hyperlinkId) const noexcept;
+    const HyperlinkTable& GetHyperlinks() const noexcept;
+    TextAttribute ImportAttributes(const TextBuffer& source, const TextAttribute attr);
+
+    // Every change to a row stamps it with a new generation, so that consumers can
+    // tell which rows changed since they last looked without re-reading all of them.
+    uint64_t GetGeneration() const noexcept;
+    uint64_t NextGeneration() noexcept;
+    std::vector<size_t> GetRowsChangedSince(const uint64_t generation,
+                                            const size_t firstRow,
+                                            const size_t count) const;
+    uint64_t GetRowGeneration(const size_t index) const;
+
+    // Together with a row's offset, this gives it a number that doesn't change as the
+    // buffer circles, so consumers can keep track of a row as it scrolls up.
+    uint64_t GetCircledRowCount() const noexcept;
+
+    // Rows whose text wraps onto the next one make up one logical line with it. These
+    // find the first and last row of the line a row is in without walking the rows.
+    // A line that started above the top of the buffer starts at the top row.
+    size_t GetLogicalLineStart(const size_t rowOffset) const;
+    size_t GetLogicalLineEnd(const size_t rowOffset) const;
+    void NotifyWrapChanged(const ROW& row) noexcept;
+
+    // An estimate of how much memory the buffer is holding on to, and a way to give
+    // some back by blanking the oldest rows.
+    size_t GetMemoryUsage() const noexcept;
+    void ClearOldestRows(const size_t count);
+
+    // The same estimate, split up by what the memory is for.
+    struct MemoryBreakdown
+    {
+        Microsoft::Console::Types::MemoryUsage cells; // the cell arena
+        Microsoft::Console::Types::MemoryUsage rows; // the rows, and the packed text of the cold ones
+        Microsoft::Console::Types::MemoryUsage attributeRuns;
+        Microsoft::Console::Types::MemoryUsage unicodeStorage;
+        Microsoft::Console::Types::MemoryUsage attributePalette; // and the hyperlinks its attributes refer to
+        Microsoft::Console::Types::MemoryUsage other; // the scrollback spill and the buffer's own bookkeeping
+    };
+    MemoryBreakdown MeasureMemory() const noexcept;
 
     Microsoft::Console::Render::IRenderTarget& GetRenderTarget();
 
@@ -146,19 +237,175 @@ public:
                                            std::function<COLORREF(TextAttribute&)> GetForegroundColor,
                                            std::function<COLORREF(TextAttribute&)> GetBackgroundColor) const;
 
+    // A stretch of selected text that's all in the same colors.
+    struct ColorRun
+    {
+        size_t length; // in characters of the text
+        COLORREF foreground;
+        COLORREF background;
+    };
+
+    void GetSelectedText(const bool lineSelection,
+                         const bool trimTrailingWhitespace,
+                         const std::vector<SMALL_RECT>& selectionRects,
+                         std::wstring& text,
+                         std::vector<ColorRun>* const colors = nullptr,
+                         const std::function<COLORREF(TextAttribute&)>& GetForegroundColor = nullptr,
+                         const std::function<COLORREF(TextAttribute&)>& GetBackgroundColor = nullptr) const;
+
 private:
+    TextBuffer(TextBuffer& source, Microsoft::Console::Render::IRenderTarget& renderTarget);
+
+    // The layout of Serialize's output. The header is followed by the palette's
+    // entries, then the hyperlinks, then every row's cells, then a byte of flags and
+    // a count of attribute runs for each row, then the runs, then the long glyphs,
+    // then their text, then the hyperlinks' ids and URIs.
+    // Rows are stored from the top of the buffer down, and can be copied in one go.
+    struct _SerializedHeader
+    {
+        uint32_t signature;
+        uint32_t formatVersion;
+        uint16_t width;
+        uint16_t height;
+        uint32_t paletteSize;
+        uint32_t runCount;
+        uint32_t glyphCount;
+        uint32_t glyphLength; // the total length of the long glyphs, in wchar_ts
+        uint32_t hyperlinkCount;
+        uint32_t hyperlinkLength; // the total length of the hyperlinks' ids and URIs, in wchar_ts
+        COORD cursorPosition;
+        uint32_t cursorSize;
+        COLORREF cursorColor;
+        uint8_t cursorType;
+        uint8_t cursorFlags;
+        uint16_t reserved;
+        TextAttribute currentAttributes;
+    };
 
-    std::deque<ROW> _storage;
+    struct _SerializedGlyph
+    {
+        uint16_t row;
+        uint16_t column;
+        uint32_t length;
+    };
+
+    struct _SerializedHyperlink
+    {
+        uint16_t handle;
+        uint16_t idLength;
+        uint32_t uriLength;
+    };
+
+    static constexpr uint32_t s_SerializedSignature = 0x46425854; // "TXBF"
+    static constexpr uint32_t s_SerializedFormatVersion = 2;
+
+    // The attributes used anywhere in the buffer, interned so each attribute run only
+    // needs a handle. This must be declared before the rows that point into it.
+    TextAttributePalette _attributePalette;
+
+    // The hyperlinks the attributes in the palette refer to. It's collected along
+    // with the palette, and copied along with it too.
+    HyperlinkTable _hyperlinks;
+
+    // the most recent generation handed out to a row.
+    uint64_t _generation;
+
+    // the generation at which rows last moved to different offsets en masse
+    // (circling or resizing), making every row look changed to a consumer.
+    uint64_t _layoutGeneration;
+
+    // the generation at which the attribute palette was last rebuilt, invalidating
+    // every handle held by a copy of it.
+    uint64_t _paletteGeneration;
+
+    // the number of rows that have circled off the top of the buffer so far.
+    uint64_t _circledRowCount;
+
+    // Which logical line every row is in, kept up to date as rows wrap, circle and
+    //      scroll. Rows are numbered the way GetCircledRowCount does, so circling
+    //      doesn't renumber them, and a row's entry is found at that number modulo
+    //      the height. Every row knows the row its line starts in, and the line's
+    //      first row that's still in the buffer also knows the row it ends in.
+    struct _LogicalLine
+    {
+        uint64_t start;
+        uint64_t end;
+    };
+    std::vector<_LogicalLine> _lines;
+
+    // Set while rows are being rearranged wholesale, after which _lines is rebuilt.
+    bool _linesSuspended;
+
+    // All of the character cells for every row live in this one contiguous arena.
+    // Each ROW is a lightweight view over its own Width-sized slice of it, so rotating
+    // or circling rows never has to move or reallocate cell data.
+    // A snapshot of the buffer holds on to the arena too, for as long as its rows view it.
+    std::shared_ptr<std::vector<CharRowCell>> _cellArena;
+    std::vector<ROW> _storage;
     Cursor _cursor;
 
+    // How many rows (counting up from the bottom of the buffer) stay unpacked in the arena.
+    // SIZE_MAX means every row is hot and nothing is ever packed.
+    size_t _hotRowCount;
+
+    // arena slices that aren't currently held by any row
+    std::vector<size_t> _freeArenaSlots;
+
+    // IDs of cold rows that were touched and unpacked into their own cells
+    std::vector<SHORT> _thawedRowIds;
+
+    // optional backing store for rows evicted from the top of the buffer
+    std::unique_ptr<ScrollbackSpill> _spill;
+
     SHORT _firstRow; // indexes top row (not necessarily 0)
 
     TextAttribute _currentAttributes;
 
-    // storage location for glyphs that can't fit into the buffer normally
-    UnicodeStorage _unicodeStorage;
+    void _RefreshRowIDs();
+    void _RefreshRowIDs(const size_t begin, const size_t end);
+    _LogicalLine& _GetLogicalLine(const size_t rowOffset) noexcept;
+    const _LogicalLine& _GetLogicalLine(const size_t rowOffset) const noexcept;
+    bool _IsWrapForcedAt(const size_t rowOffset) const noexcept;
+    void _RelinkLines(const size_t begin, const size_t end) noexcept;
+    void _RebuildLines();
+    void _CompactAttributePalette();
+    void _CompactAttributePaletteIfNeeded() noexcept;
+    template<typename TWrite>
+    auto _WriteRow(TWrite&& write);
+
+    ScrollbackSpill::SpilledRow _ReadSpilledRow(const int y) const;
+    template<typename TAction>
+    static void _ForEachSpilledRun(const ScrollbackSpill::SpilledRow& row,
+                                   const size_t left,
+                                   const size_t right,
+                                   TAction&& action);
+
+    static gsl::span<CharRowCell> _GetArenaSlice(std::vector<CharRowCell>& arena,
+                                                 const size_t rowIndex,
+                                                 const size_t rowWidth);
+
+    size_t _GetEffectiveHotRowCount() const noexcept;
+    bool _IsRowHot(const size_t storageIndex) const noexcept;
+    std::optional<size_t> _GetArenaSlotOf(const ROW& row) const noexcept;
+    void _ThawRow(ROW& row);
+    void _FreezeRow(ROW& row);
+    void _FreezeColdRows();
+
+    // Everything the rows need to move onto a new arena, allocated before any of them
+    // are touched so that moving them can't fail halfway through.
+    struct _ArenaLayout
+    {
+        std::shared_ptr<std::vector<CharRowCell>> arena;
+        size_t rowWidth;
+        size_t hotRows;
 
-    void _RefreshRowIDs(std::optional<SHORT> newRowWidth);
+        // by offset. set for rows whose width changes, and for cold rows that need packing.
+        std::vector<std::optional<ATTR_ROW>> attrRows;
+        std::vector<std::unique_ptr<CharRow::PackedCells>> packedRows;
+    };
+    _ArenaLayout _PrepareLayout(const gsl::span<ROW* const> rows, const size_t rowWidth, const size_t hotRows) const;
+    void _CommitLayout(const gsl::span<ROW* const> rows, _ArenaLayout&& layout) noexcept;
+    void _LayoutArena(const size_t rowWidth, const size_t hotRows);
 
     Microsoft::Console::Render::IRenderTarget& _renderTarget;
 
@@ -170,11 +417,14 @@ private:
     void _AdjustWrapOnCurrentRow(const bool fSet);
 
     void _NotifyPaint(const Microsoft::Console::Types::Viewport& viewport) const;
+    Microsoft::Console::Types::Viewport _GetSpanExtent(const COORD target, const size_t count) const;
 
     // Assist with maintaining proper buffer state for Double Byte character sequences
     bool _PrepareForDoubleByteSequence(const DbcsAttribute dbcsAttribute);
     bool _AssertValidDoubleByteSequence(const DbcsAttribute dbcsAttribute);
 
+    void _CopyCellsToCursor(const ROW& source, const size_t sourceColumn, const size_t count);
+
     ROW& _GetFirstRow();
     ROW& _GetPrevRowNoWrap(const ROW& row);
 
@@ -34,6 +34,7 @@ TextBufferCellIterator::TextBufferCellIterator(const TextBuffer& buffer, COORD p
     _buffer(buffer),
     _pos(pos),
     _pRow(s_GetRow(buffer, pos)),
+    _decodedRow(s_DecodeRow(*s_GetRow(buffer, pos))),
     _bounds(limits),
     _exceeded(false),
     _view({}, {}, {}, TextAttributeBehavior::Stored),
@@ -206,6 +207,7 @@ void TextBufferCellIterator::_SetPos(const COORD newPos)
     if (newPos.Y != _pos.Y)
     {
         _pRow = s_GetRow(_buffer, newPos);
+        _decodedRow = s_DecodeRow(*_pRow);
         _attrIter = _pRow->GetAttrRow().cbegin();
         _pos.X = 0;
     }
@@ -234,12 +236,29 @@ const ROW* TextBufferCellIterator::s_GetRow(const TextBuffer& buffer, const COOR
     return &buffer.GetRowByOffset(pos.Y);
 }
 
+// Routine Description:
+// - Decodes the cells of a row that's packed in cold storage, so the iterator can read
+//   them without unpacking the row in the buffer (which other readers may be looking at).
+// Arguments:
+// - row - the row to decode
+// Return Value:
+// - The decoded copy of the row, or nullptr if it isn't packed and can be read as it is.
+std::shared_ptr<const ROW> TextBufferCellIterator::s_DecodeRow(const ROW& row)
+{
+    if (!row.IsPacked())
+    {
+        return nullptr;
+    }
+    return std::make_shared<const ROW>(row, CharRow::Decoded{});
+}
+
 // Routine Description:
 // - Updates the internal view. Call after updating row, attribute, or positions.
 void TextBufferCellIterator::_GenerateView()
 {
-    _view = OutputCellView(_pRow->GetCharRow().GlyphAt(_pos.X),
-                           _pRow->GetCharRow().DbcsAttrAt(_pos.X),
+    const auto& charRow = (_decodedRow ? _decodedRow.get() : _pRow)->GetCharRow();
+    _view = OutputCellView(charRow.GlyphAt(_pos.X),
+                           charRow.DbcsAttrAt(_pos.X),
                            *_attrIter,
                            TextAttributeBehavior::Stored);
 }
@@ -54,10 +54,15 @@ protected:
     void _SetPos(const COORD newPos);
     void _GenerateView();
     static const ROW* s_GetRow(const TextBuffer& buffer, const COORD pos);
+    static std::shared_ptr<const ROW> s_DecodeRow(const ROW& row);
 
     OutputCellView _view;
 
     const ROW* _pRow;
+
+    // the cells of _pRow if it's packed in cold storage, decoded so they can be read
+    // without unpacking the row. copies of the iterator share them.
+    std::shared_ptr<const ROW> _decodedRow;
     AttrRowIterator _attrIter;
     const TextBuffer& _buffer;
     const Microsoft::Console::Types::Viewport _bounds;
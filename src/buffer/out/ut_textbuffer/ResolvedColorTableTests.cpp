@@ -0,0 +1,132 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "../../inc/consoletaeftemplates.hpp"
+
+#include "../ResolvedColorTable.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class ResolvedColorTableTests
+{
+    TEST_CLASS(ResolvedColorTableTests);
+    TEST_CLASS_SETUP(ClassSetup);
+
+    TEST_METHOD(TestMatchesTextAttribute);
+    TEST_METHOD(TestBoldDefaultForeground);
+    TEST_METHOD(TestUpdate);
+
+    static const int COLOR_TABLE_SIZE = 256;
+    COLORREF _colorTable[COLOR_TABLE_SIZE];
+    COLORREF _defaultFg = RGB(1, 2, 3);
+    COLORREF _defaultBg = 0x00060504; // transparent, like an acrylic background
+    std::basic_string_view<COLORREF> _GetTableView();
+
+    std::vector<TextAttribute> _GetAttributes();
+    void _VerifyMatches(const ResolvedColorTable& table, const COLORREF defaultFg, const COLORREF defaultBg);
+};
+
+bool ResolvedColorTableTests::ClassSetup()
+{
+    for (int i = 0; i < COLOR_TABLE_SIZE; ++i)
+    {
+        _colorTable[i] = RGB(i, 255 - i, i / 2);
+    }
+    return true;
+}
+
+std::basic_string_view<COLORREF> ResolvedColorTableTests::_GetTableView()
+{
+    return std::basic_string_view<COLORREF>(&_colorTable[0], COLOR_TABLE_SIZE);
+}
+
+// Every kind of color in both halves of an attribute, with and without bold and
+// reverse video.
+std::vector<TextAttribute> ResolvedColorTableTests::_GetAttributes()
+{
+    std::vector<TextColor> colors{ TextColor{}, TextColor{ RGB(7, 8, 9) } };
+    for (const BYTE index : { 0, 3, 7, 8, 15, 16, 200, 255 })
+    {
+        colors.emplace_back(index);
+    }
+
+    std::vector<TextAttribute> attrs;
+    for (const auto& foreground : colors)
+    {
+        for (const auto& background : colors)
+        {
+            for (const bool bold : { false, true })
+            {
+                for (const bool reverse : { false, true })
+                {
+                    TextAttribute attr{};
+                    attr._foreground = foreground;
+                    attr._background = background;
+                    if (bold)
+                    {
+                        attr.Embolden();
+                    }
+                    if (reverse)
+                    {
+                        attr.SetMetaAttributes(COMMON_LVB_REVERSE_VIDEO);
+                    }
+                    attrs.push_back(attr);
+                }
+            }
+        }
+    }
+    return attrs;
+}
+
+void ResolvedColorTableTests::_VerifyMatches(const ResolvedColorTable& table, const COLORREF defaultFg, const COLORREF defaultBg)
+{
+    for (const auto& attr : _GetAttributes())
+    {
+        const auto expectedFg = 0xff000000 | attr.CalculateRgbForeground(_GetTableView(), defaultFg, defaultBg);
+        auto expectedBg = attr.CalculateRgbBackground(_GetTableView(), defaultFg, defaultBg);
+        if (!attr.BackgroundIsDefault())
+        {
+            expectedBg |= 0xff000000;
+        }
+
+        VERIFY_ARE_EQUAL(expectedFg, table.GetForeground(attr));
+        VERIFY_ARE_EQUAL(expectedBg, table.GetBackground(attr));
+    }
+}
+
+void ResolvedColorTableTests::TestMatchesTextAttribute()
+{
+    ResolvedColorTable table;
+    table.Update(_GetTableView(), _defaultFg, _defaultBg);
+    _VerifyMatches(table, _defaultFg, _defaultBg);
+}
+
+void ResolvedColorTableTests::TestBoldDefaultForeground()
+{
+    // A default foreground that's one of the dark colors is brightened when it's bold.
+    const auto defaultFg = _colorTable[3];
+
+    ResolvedColorTable table;
+    table.Update(_GetTableView(), defaultFg, _defaultBg);
+    _VerifyMatches(table, defaultFg, _defaultBg);
+
+    TextAttribute attr{};
+    attr.Embolden();
+    VERIFY_ARE_EQUAL(0xff000000 | _colorTable[11], table.GetForeground(attr));
+}
+
+void ResolvedColorTableTests::TestUpdate()
+{
+    ResolvedColorTable table;
+    table.Update(_GetTableView(), _defaultFg, _defaultBg);
+
+    const auto oldColor = _colorTable[4];
+    _colorTable[4] = RGB(10, 20, 30);
+    table.Update(_GetTableView(), RGB(40, 50, 60), 0xff5a5046);
+    _VerifyMatches(table, RGB(40, 50, 60), 0xff5a5046);
+    _colorTable[4] = oldColor;
+}
@@ -19,17 +19,16 @@ class UnicodeStorageTests
     TEST_METHOD(CanOverwriteEmoji)
     {
         UnicodeStorage storage;
-        const COORD coord{ 1, 3 };
+        const UnicodeStorage::key_type column = 3;
         const std::vector<wchar_t> newMoon{ 0xD83C, 0xDF11 };
         const std::vector<wchar_t> fullMoon{ 0xD83C, 0xDF15 };
 
         // store initial glyph
-        storage.StoreGlyph(coord, newMoon);
+        storage.StoreGlyph(column, newMoon);
 
         // verify it was stored
-        auto findIt = storage._map.find(coord);
-        VERIFY_ARE_NOT_EQUAL(findIt, storage._map.end());
-        const std::vector<wchar_t>& newMoonGlyph = findIt->second;
+        VERIFY_ARE_EQUAL(1u, storage.size());
+        const std::vector<wchar_t>& newMoonGlyph = storage.GetText(column);
         VERIFY_ARE_EQUAL(newMoonGlyph.size(), newMoon.size());
         for (size_t i = 0; i < newMoon.size(); ++i)
         {
@@ -37,16 +36,46 @@ class UnicodeStorageTests
         }
 
         // overwrite it
-        storage.StoreGlyph(coord, fullMoon);
+        storage.StoreGlyph(column, fullMoon);
 
         // verify the glyph was overwritten
-        findIt = storage._map.find(coord);
-        VERIFY_ARE_NOT_EQUAL(findIt, storage._map.end());
-        const std::vector<wchar_t>& fullMoonGlyph = findIt->second;
+        VERIFY_ARE_EQUAL(1u, storage.size());
+        const std::vector<wchar_t>& fullMoonGlyph = storage.GetText(column);
         VERIFY_ARE_EQUAL(fullMoonGlyph.size(), fullMoon.size());
         for (size_t i = 0; i < fullMoon.size(); ++i)
         {
             VERIFY_ARE_EQUAL(fullMoonGlyph.at(i), fullMoon.at(i));
         }
     }
+
+    TEST_METHOD(KeepsColumnsSortedAndTruncates)
+    {
+        UnicodeStorage storage;
+        const std::vector<wchar_t> newMoon{ 0xD83C, 0xDF11 };
+        const std::vector<wchar_t> fullMoon{ 0xD83C, 0xDF15 };
+
+        // store out of order
+        storage.StoreGlyph(7, fullMoon);
+        storage.StoreGlyph(2, newMoon);
+        storage.StoreGlyph(5, fullMoon);
+
+        VERIFY_ARE_EQUAL(3u, storage.size());
+        for (size_t i = 1; i < storage._glyphs.size(); ++i)
+        {
+            VERIFY_IS_LESS_THAN(storage._glyphs.at(i - 1).first, storage._glyphs.at(i).first);
+        }
+        VERIFY_IS_TRUE(storage.GetText(2) == newMoon);
+
+        // erasing a column that isn't stored is harmless
+        storage.Erase(3);
+        VERIFY_ARE_EQUAL(3u, storage.size());
+
+        // columns at or past the new width go away
+        storage.Truncate(5);
+        VERIFY_ARE_EQUAL(1u, storage.size());
+        VERIFY_IS_TRUE(storage.GetText(2) == newMoon);
+
+        storage.Clear();
+        VERIFY_IS_TRUE(storage.empty());
+    }
 };
@@ -47,7 +47,9 @@ namespace winrt::TerminalApp::implementation
         _tabs{  },
         _loadedInitialSettings{ false },
         _settingsLoadedResult{ S_OK },
-        _dialogLock{}
+        _dialogLock{},
+        _launchTime{ std::chrono::steady_clock::now() },
+        _settingsLoadedTime{}
     {
         // For your own sanity, it's better to do setup outside the ctor.
         // If you do any setup in the ctor that ends up throwing an exception,
@@ -71,11 +73,19 @@ namespace winrt::TerminalApp::implementation
         // this as a MTA, before the app is Create()'d
         WINRT_ASSERT(_loadedInitialSettings);
         TraceLoggingRegister(g_hTerminalAppProvider);
+        // The settings were loaded before there was a provider to trace them with.
+        _TraceStartupPhase("SettingsLoaded", _settingsLoadedTime);
+
         _Create();
+        _TraceStartupPhase("UiCreated", std::chrono::steady_clock::now());
     }
 
     App::~App()
     {
+        if (_memoryBudgetTimer)
+        {
+            _memoryBudgetTimer.Stop();
+        }
         TraceLoggingUnregister(g_hTerminalAppProvider);
     }
 
@@ -173,6 +183,15 @@ namespace winrt::TerminalApp::implementation
 
         _OpenNewTab(std::nullopt);
 
+        // Every so often, make sure all the tabs together are within the memory
+        // budget. The budget is looked up each time, so it follows settings reloads.
+        _memoryBudgetTimer = DispatcherTimer();
+        _memoryBudgetTimer.Interval(s_MemoryBudgetInterval);
+        _memoryBudgetTimer.Tick([this](auto&&, auto&&) {
+            _EnforceMemoryBudget();
+        });
+        _memoryBudgetTimer.Start();
+
         _root.Loaded({ this, &App::_OnLoaded });
     }
 
@@ -228,6 +247,8 @@ namespace winrt::TerminalApp::implementation
     void App::_OnLoaded(const IInspectable& /*sender*/,
                         const RoutedEventArgs& /*eventArgs*/)
     {
+        _TraceStartupPhase("Loaded", std::chrono::steady_clock::now());
+
         if (FAILED(_settingsLoadedResult))
         {
             const winrt::hstring titleKey = L"InitialJsonParseErrorTitle";
@@ -463,6 +484,11 @@ namespace winrt::TerminalApp::implementation
     //      happening during startup, it'll need to happen on a background thread.
     void App::LoadSettings()
     {
+        // The renderer's device takes about as long to make as the settings
+        //      take to load, and doesn't depend on them, so it's made on
+        //      another thread while we do.
+        TermControl::WarmUpRenderer();
+
         // Attempt to load the settings.
         // If it fails,
         //  - use Default settings,
@@ -482,6 +508,7 @@ namespace winrt::TerminalApp::implementation
         _HookupKeyBindings(_settings->GetKeybindings());
 
         _loadedInitialSettings = true;
+        _settingsLoadedTime = std::chrono::steady_clock::now();
 
         // Register for directory change notification.
         _RegisterSettingsChange();
@@ -561,7 +588,9 @@ namespace winrt::TerminalApp::implementation
         // new AppKeyBindings object.
         _HookupKeyBindings(_settings->GetKeybindings());
 
-        // Refresh UI elements
+        // Refresh UI elements. Each control works out for itself which of its
+        // settings actually changed, and only reapplies those.
+        std::vector<std::pair<::TerminalApp::Profile, winrt::Microsoft::UI::Xaml::Controls::TabViewItem>> iconUpdates;
 
         auto profiles = _settings->GetProfiles();
         for (auto &profile : profiles)
@@ -577,17 +606,24 @@ namespace winrt::TerminalApp::implementation
                 if (profileGuid == tabProfile)
                 {
                     term.UpdateSettings(settings);
-
-                    // Update the icons of the tabs with this profile open.
-                    auto tabViewItem = tab->GetTabViewItem();
-                    tabViewItem.Dispatcher().RunAsync(CoreDispatcherPriority::Normal, [profile, tabViewItem]() {
-                        // _GetIconFromProfile has to run on the main thread
-                        tabViewItem.Icon(App::_GetIconFromProfile(profile));
-                    });
+                    iconUpdates.emplace_back(profile, tab->GetTabViewItem());
                 }
             }
         }
 
+        // Update the icons of the tabs all at once, rather than queueing up
+        // something on the main thread for each of them.
+        if (!iconUpdates.empty())
+        {
+            _root.Dispatcher().RunAsync(CoreDispatcherPriority::Low, [iconUpdates{ std::move(iconUpdates) }]() {
+                for (const auto& [profile, tabViewItem] : iconUpdates)
+                {
+                    // _GetIconFromProfile has to run on the main thread
+                    tabViewItem.Icon(App::_GetIconFromProfile(profile));
+                }
+            });
+        }
+
 
         _root.Dispatcher().RunAsync(CoreDispatcherPriority::Normal, [this]() {
             // Refresh the UI theme
@@ -600,6 +636,64 @@ namespace winrt::TerminalApp::implementation
 
     }
 
+    // Method Description:
+    // - Brings the memory used by all the tabs' buffers back within the budget
+    //   from the settings, if they've gone over it. Tabs in the background give up
+    //   their oldest scrollback first, biggest first, and the focused tab only
+    //   gives up any if that wasn't enough. What's on screen is always kept.
+    void App::_EnforceMemoryBudget()
+    {
+        const uint64_t budget = uint64_t{ _settings->GlobalSettings().GetMemoryBudget() } * 1024 * 1024;
+        if (budget == 0)
+        {
+            return;
+        }
+
+        const int focusedTabIndex = _GetFocusedTabIndex();
+        std::vector<std::pair<uint64_t, TermControl>> background;
+        std::optional<std::pair<uint64_t, TermControl>> focused;
+        uint64_t total = 0;
+        for (size_t i = 0; i < _tabs.size(); ++i)
+        {
+            auto control = _tabs.at(i)->GetTerminalControl();
+            const auto usage = control.GetMemoryUsage();
+            total += usage;
+            if (static_cast<int>(i) == focusedTabIndex)
+            {
+                focused.emplace(usage, control);
+            }
+            else
+            {
+                background.emplace_back(usage, control);
+            }
+        }
+
+        if (total <= budget)
+        {
+            return;
+        }
+
+        std::sort(background.begin(), background.end(), [](const auto& a, const auto& b) {
+            return a.first > b.first;
+        });
+        if (focused.has_value())
+        {
+            background.push_back(focused.value());
+        }
+
+        for (auto& [usage, control] : background)
+        {
+            const auto excess = total - budget;
+            const auto target = usage > excess ? usage - excess : 0;
+            const auto trimmed = control.TrimMemoryUsage(target);
+            total -= usage - std::min(usage, trimmed);
+            if (total <= budget)
+            {
+                break;
+            }
+        }
+    }
+
     // Method Description:
     // - Update the current theme of the application. This will manually update
     //   all of the elements in our UI to match the given theme.
@@ -695,6 +789,30 @@ namespace winrt::TerminalApp::implementation
             TelemetryPrivacyDataTag(PDT_ProductAndServicePerformance));
     }
 
+    // Method Description:
+    // - Traces that startup got through one of its phases, and how long after
+    //   launch it was. The phases are, in order:
+    //   * SettingsLoaded - the settings have been read and parsed.
+    //   * UiCreated - the tab row and the first tab have been created.
+    //   * Loaded - the first layout has been done, and the first tab's
+    //     control has started its connection (see TermControl's own
+    //     TerminalInitialized event).
+    // Arguments:
+    // - phase: the name of the phase
+    // - when: when the phase was done
+    void App::_TraceStartupPhase(const char* const phase, const std::chrono::steady_clock::time_point when) const
+    {
+        const auto sinceLaunch = std::chrono::duration_cast<std::chrono::microseconds>(when - _launchTime);
+        TraceLoggingWrite(
+            g_hTerminalAppProvider,
+            "StartupPhase",
+            TraceLoggingDescription("Event emitted as startup gets through each of its phases"),
+            TraceLoggingString(phase, "Phase", "The phase that was finished"),
+            TraceLoggingUInt64(sinceLaunch.count(), "SinceLaunchMicroseconds", "How long after launch it was finished"),
+            TraceLoggingKeyword(MICROSOFT_KEYWORD_MEASURES),
+            TelemetryPrivacyDataTag(PDT_ProductAndServicePerformance));
+    }
+
     // Function Description:
     // - Copies and processes the text data from the Windows Clipboard.
     //   Does some of this in a background thread, as to not hang/crash the UI thread.
@@ -902,10 +1020,13 @@ namespace winrt::TerminalApp::implementation
         auto tabView = sender.as<MUX::Controls::TabView>();
         auto selectedIndex = tabView.SelectedIndex();
 
-        // Unfocus all the tabs.
-        for (auto tab : _tabs)
+        // Unfocus all the tabs, and put all but the selected one in the background
+        //      so that nothing's painted for them while they can't be seen.
+        for (size_t i = 0; i < _tabs.size(); ++i)
         {
+            const auto& tab = _tabs.at(i);
             tab->SetFocused(false);
+            tab->GetTerminalControl().SetInBackground(static_cast<int32_t>(i) != selectedIndex);
         }
 
         if (selectedIndex >= 0)
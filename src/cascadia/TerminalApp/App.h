@@ -73,6 +73,15 @@ namespace winrt::TerminalApp::implementation
 
         wil::unique_folder_change_reader_nothrow _reader;
 
+        Windows::UI::Xaml::DispatcherTimer _memoryBudgetTimer{ nullptr };
+        static constexpr std::chrono::seconds s_MemoryBudgetInterval{ 5 };
+
+        // When the app was constructed, which is the first thing the host does
+        //      at launch, and when the settings were done loading. Startup is
+        //      traced as phases measured from the launch (see _TraceStartupPhase).
+        std::chrono::steady_clock::time_point _launchTime;
+        std::chrono::steady_clock::time_point _settingsLoadedTime;
+
         void _Create();
         void _CreateNewTabFlyout();
 
@@ -119,6 +128,9 @@ namespace winrt::TerminalApp::implementation
 
         void _ApplyTheme(const Windows::UI::Xaml::ElementTheme& newTheme);
 
+        void _EnforceMemoryBudget();
+        void _TraceStartupPhase(const char* const phase, const std::chrono::steady_clock::time_point when) const;
+
         static Windows::UI::Xaml::Controls::IconElement _GetIconFromProfile(const ::TerminalApp::Profile& profile);
         static void _SetAcceleratorForMenuItem(Windows::UI::Xaml::Controls::MenuFlyoutItem& menuItem, const winrt::Microsoft::Terminal::Settings::KeyChord& keyChord);
     };
@@ -93,6 +93,7 @@ namespace winrt::TerminalApp::implementation
                                        const Settings::KeyChord& chord)
     {
         _keyShortcuts[chord] = action;
+        _actionsByChord[s_PackKeyChord(chord.Modifiers(), chord.Vkey())] = action;
     }
 
     Microsoft::Terminal::Settings::KeyChord AppKeyBindings::GetKeyBinding(TerminalApp::ShortcutAction const& action)
@@ -106,8 +107,8 @@ namespace winrt::TerminalApp::implementation
 
     bool AppKeyBindings::TryKeyChord(const Settings::KeyChord& kc)
     {
-        const auto keyIter = _keyShortcuts.find(kc);
-        if (keyIter != _keyShortcuts.end())
+        const auto keyIter = _actionsByChord.find(s_PackKeyChord(kc.Modifiers(), kc.Vkey()));
+        if (keyIter != _actionsByChord.end())
         {
             const auto action = keyIter->second;
             return _DoAction(action);
@@ -115,6 +116,18 @@ namespace winrt::TerminalApp::implementation
         return false;
     }
 
+    // Function Description:
+    // - Packs a chord's modifiers and key into one value, to look it up by.
+    // Arguments:
+    // - modifiers: the chord's modifiers
+    // - vkey: the chord's virtual key. Virtual keys all fit in 16 bits.
+    // Return Value:
+    // - the packed chord
+    uint32_t AppKeyBindings::s_PackKeyChord(const Settings::KeyModifiers modifiers, const int32_t vkey) noexcept
+    {
+        return (static_cast<uint32_t>(modifiers) << 16) | (static_cast<uint32_t>(vkey) & 0xffff);
+    }
+
     bool AppKeyBindings::_DoAction(ShortcutAction action)
     {
         switch (action)
@@ -357,6 +370,42 @@ namespace winrt::TerminalApp::implementation
         return bindingsArray;
     }
 
+    // Method Description:
+    // - Reads a set of keybindings back out of a settings snapshot.
+    // Arguments:
+    // - reader: the snapshot, where WriteSnapshot wrote the keybindings
+    // Return Value:
+    // - the newly constructed AppKeyBindings object.
+    TerminalApp::AppKeyBindings AppKeyBindings::ReadSnapshot(::TerminalApp::SettingsSnapshot::Reader& reader)
+    {
+        TerminalApp::AppKeyBindings newBindings{};
+
+        const auto count = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const auto modifiers = reader.Read<Settings::KeyModifiers>();
+            const auto vkey = reader.Read<int32_t>();
+            const auto action = reader.Read<ShortcutAction>();
+            newBindings.SetKeyBinding(action, Settings::KeyChord{ modifiers, vkey });
+        }
+        return newBindings;
+    }
+
+    // Method Description:
+    // - Writes these keybindings into a settings snapshot.
+    // Arguments:
+    // - writer: the snapshot being written
+    void AppKeyBindings::WriteSnapshot(::TerminalApp::SettingsSnapshot::Writer& writer) const
+    {
+        writer.Write(gsl::narrow<uint32_t>(_keyShortcuts.size()));
+        for (const auto& kv : _keyShortcuts)
+        {
+            writer.Write(kv.first.Modifiers());
+            writer.Write(kv.first.Vkey());
+            writer.Write(kv.second);
+        }
+    }
+
     // Method Description:
     // - Takes the KeyModifier flags from Terminal and maps them to the WinRT types which are used by XAML
     // Return Value:
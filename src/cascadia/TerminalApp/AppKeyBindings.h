@@ -5,6 +5,7 @@
 
 #include "AppKeyBindings.g.h"
 #include "..\inc\cppwinrt_utils.h"
+#include "SettingsSnapshot.h"
 
 namespace winrt::TerminalApp::implementation
 {
@@ -34,6 +35,8 @@ namespace winrt::TerminalApp::implementation
 
         static TerminalApp::AppKeyBindings FromJson(Windows::Data::Json::JsonArray const& json);
         Windows::Data::Json::JsonArray ToJson();
+        static TerminalApp::AppKeyBindings ReadSnapshot(::TerminalApp::SettingsSnapshot::Reader& reader);
+        void WriteSnapshot(::TerminalApp::SettingsSnapshot::Writer& writer) const;
         static Windows::System::VirtualKeyModifiers ConvertVKModifiers(winrt::Microsoft::Terminal::Settings::KeyModifiers modifiers);
         static winrt::hstring FormatOverrideShortcutText(winrt::Microsoft::Terminal::Settings::KeyModifiers modifiers);
 
@@ -61,6 +64,14 @@ namespace winrt::TerminalApp::implementation
 
     private:
         std::unordered_map<winrt::Microsoft::Terminal::Settings::KeyChord, TerminalApp::ShortcutAction, KeyChordHash, KeyChordEquality> _keyShortcuts;
+
+        // The same bindings, by s_PackKeyChord of their chord. Every key the
+        // user presses is looked up in here, so it's keyed by a plain integer
+        // rather than by the KeyChord, which would be hashed and compared
+        // through its interface.
+        std::unordered_map<uint32_t, TerminalApp::ShortcutAction> _actionsByChord;
+
+        static uint32_t s_PackKeyChord(const winrt::Microsoft::Terminal::Settings::KeyModifiers modifiers, const int32_t vkey) noexcept;
         bool _DoAction(ShortcutAction action);
 
     };
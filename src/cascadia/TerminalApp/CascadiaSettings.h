@@ -47,6 +47,9 @@ public:
     winrt::Windows::Data::Json::JsonObject ToJson() const;
     static std::unique_ptr<CascadiaSettings> FromJson(winrt::Windows::Data::Json::JsonObject json);
 
+    void WriteSnapshot(SettingsSnapshot::Writer& writer) const;
+    static std::unique_ptr<CascadiaSettings> ReadSnapshot(SettingsSnapshot::Reader& reader);
+
     static winrt::hstring GetSettingsPath();
 
     const Profile* FindProfile(GUID profileGuid) const noexcept;
@@ -68,6 +71,9 @@ private:
     static winrt::hstring _GetPackagedSettingsPath();
     static std::optional<winrt::hstring> _LoadAsPackagedApp();
     static std::optional<winrt::hstring> _LoadAsUnpackagedApp();
+    static std::wstring _GetSnapshotPath();
+    static uint64_t _GetAppVersion();
+    void _TrySaveSnapshot(const winrt::hstring& content) const noexcept;
     static bool _isPowerShellCoreInstalledInPath(const std::wstring_view programFileEnv, std::filesystem::path& cmdline);
     static bool _isPowerShellCoreInstalled(std::filesystem::path& cmdline);
     static std::wstring ExpandEnvironmentVariableString(std::wstring_view source);
@@ -19,6 +19,7 @@ using namespace winrt::Windows::Storage::Streams;
 using namespace ::Microsoft::Console;
 
 static constexpr std::wstring_view FILENAME { L"profiles.json" };
+static constexpr std::wstring_view SNAPSHOT_FILENAME{ L"profiles.cache" };
 static constexpr std::wstring_view SETTINGS_FOLDER_NAME{ L"\\Microsoft\\Windows Terminal\\" };
 
 static constexpr std::wstring_view PROFILES_KEY{ L"profiles" };
@@ -31,6 +32,9 @@ static constexpr std::wstring_view SCHEMES_KEY{ L"schemes" };
 //      it will load the settings from our packaged localappdata. If we're
 //      running as an unpackaged application, it will read it from the path
 //      we've set under localappdata.
+// - If the file hasn't changed since it was last parsed, the settings are
+//      read from the snapshot that was taken of them then, rather than parsed
+//      from the json again. See SettingsSnapshot.h.
 // Arguments:
 // - saveOnLoad: If true, we'll write the settings back out after we load them,
 //   to make sure the schema is updated.
@@ -47,11 +51,27 @@ std::unique_ptr<CascadiaSettings> CascadiaSettings::LoadAll(const bool saveOnLoa
     {
         const auto actualData = fileData.value();
 
+        const auto snapshotPath = _GetSnapshotPath();
+        const auto foundSnapshot = SettingsSnapshot::s_TryRead(snapshotPath,
+                                                               SettingsSnapshot::s_HashSettings(actualData),
+                                                               _GetAppVersion(),
+                                                               [&](SettingsSnapshot::Reader& reader) {
+                                                                   resultPtr = ReadSnapshot(reader);
+                                                               });
+        if (foundSnapshot)
+        {
+            // The file was saved in the current schema when the snapshot was
+            // taken, so there's nothing to update.
+            return resultPtr;
+        }
+
         // If Parse fails, it'll throw a hresult_error
         JsonObject root = JsonObject::Parse(actualData);
 
         resultPtr = FromJson(root);
 
+        auto snapshotData = actualData;
+
         //  Update profile only if it has changed.
         if (saveOnLoad)
         {
@@ -61,8 +81,11 @@ std::unique_ptr<CascadiaSettings> CascadiaSettings::LoadAll(const bool saveOnLoa
             if (actualData != serializedSettings)
             {
                 resultPtr->SaveAll();
+                snapshotData = serializedSettings;
             }
         }
+
+        resultPtr->_TrySaveSnapshot(snapshotData);
     }
     else
     {
@@ -199,6 +222,121 @@ std::unique_ptr<CascadiaSettings> CascadiaSettings::FromJson(JsonObject json)
     return resultPtr;
 }
 
+// Method Description:
+// - Writes this object into a settings snapshot.
+// Arguments:
+// - writer: the snapshot being written
+void CascadiaSettings::WriteSnapshot(SettingsSnapshot::Writer& writer) const
+{
+    _globals.WriteSnapshot(writer);
+
+    writer.Write(gsl::narrow<uint32_t>(_profiles.size()));
+    for (const auto& profile : _profiles)
+    {
+        profile.WriteSnapshot(writer);
+    }
+}
+
+// Method Description:
+// - Create a new instance of this class from a settings snapshot.
+// Arguments:
+// - reader: the snapshot, where WriteSnapshot wrote the settings
+// Return Value:
+// - a new CascadiaSettings instance with the values from the snapshot
+std::unique_ptr<CascadiaSettings> CascadiaSettings::ReadSnapshot(SettingsSnapshot::Reader& reader)
+{
+    std::unique_ptr<CascadiaSettings> resultPtr = std::make_unique<CascadiaSettings>();
+
+    resultPtr->_globals = GlobalAppSettings::ReadSnapshot(reader);
+
+    const auto profileCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < profileCount; ++i)
+    {
+        resultPtr->_profiles.emplace_back(Profile::ReadSnapshot(reader));
+    }
+
+    return resultPtr;
+}
+
+// Method Description:
+// - Takes a snapshot of these settings, for the next time the settings file
+//      is loaded. If the snapshot can't be written, the settings will just be
+//      parsed from the json again next time.
+// Arguments:
+// - content: the text of the settings file these settings were parsed from
+//      (or saved as)
+void CascadiaSettings::_TrySaveSnapshot(const winrt::hstring& content) const noexcept
+{
+    try
+    {
+        SettingsSnapshot::Writer writer;
+        WriteSnapshot(writer);
+        SettingsSnapshot::s_Write(_GetSnapshotPath(),
+                                  SettingsSnapshot::s_HashSettings(content),
+                                  _GetAppVersion(),
+                                  writer);
+    }
+    CATCH_LOG();
+}
+
+// Function Description:
+// - Get the full path to the settings snapshot. It's kept in the local cache
+//      folder when we're packaged, since it's only a copy of what's in the
+//      roaming settings file, and beside the settings under localappdata when
+//      we're not.
+// Arguments:
+// - <none>
+// Return Value:
+// - the full path to the settings snapshot
+//   This can throw an exception if it fails to get the local app data folder.
+std::wstring CascadiaSettings::_GetSnapshotPath()
+{
+    std::wstring parentDirectory;
+    if (_IsPackaged())
+    {
+        parentDirectory = ApplicationData::Current().LocalCacheFolder().Path();
+        parentDirectory.append(L"\\");
+    }
+    else
+    {
+        wil::unique_cotaskmem_string localAppDataFolder;
+        THROW_IF_FAILED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, 0, &localAppDataFolder));
+
+        parentDirectory = localAppDataFolder.get();
+        parentDirectory.append(SETTINGS_FOLDER_NAME);
+        wil::CreateDirectoryDeep(parentDirectory.c_str());
+    }
+
+    parentDirectory.append(SNAPSHOT_FILENAME);
+    return parentDirectory;
+}
+
+// Function Description:
+// - Gets a number that changes whenever the app does, so that a snapshot taken
+//      by one build is never read by another. That's the package's version
+//      if we're packaged, or the link time of this module if we're not.
+// Arguments:
+// - <none>
+// Return Value:
+// - the app's version
+uint64_t CascadiaSettings::_GetAppVersion()
+{
+    UINT32 length = 0;
+    if (GetCurrentPackageId(&length, nullptr) == ERROR_INSUFFICIENT_BUFFER)
+    {
+        auto buffer = std::make_unique<BYTE[]>(length);
+        if (GetCurrentPackageId(&length, buffer.get()) == ERROR_SUCCESS)
+        {
+            return reinterpret_cast<const PACKAGE_ID*>(buffer.get())->version.Version;
+        }
+    }
+
+    const auto module = reinterpret_cast<const BYTE*>(wil::GetModuleInstanceHandle());
+    const auto dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(module);
+    const auto ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(module + dosHeader->e_lfanew);
+    return ntHeaders->FileHeader.TimeDateStamp;
+}
+
 // Function Description:
 // - Returns true if we're running in a packaged context. If we are, then we
 //      have to use the Windows.Storage API's to save/load our files. If we're
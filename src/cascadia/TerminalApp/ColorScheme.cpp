@@ -38,6 +38,7 @@ static const std::array<std::wstring, 16> TABLE_COLORS =
 
 ColorScheme::ColorScheme() :
     _schemeName{ L"" },
+    _unparsed{ std::nullopt },
     _table{  },
     _defaultForeground{ RGB(242, 242, 242) },
     _defaultBackground{ RGB(12, 12, 12) }
@@ -47,6 +48,7 @@ ColorScheme::ColorScheme() :
 
 ColorScheme::ColorScheme(std::wstring name, COLORREF defaultFg, COLORREF defaultBg) :
     _schemeName{ name },
+    _unparsed{ std::nullopt },
     _table{  },
     _defaultForeground{ defaultFg },
     _defaultBackground{ defaultBg }
@@ -68,6 +70,8 @@ ColorScheme::~ColorScheme()
 // - <none>
 void ColorScheme::ApplyScheme(TerminalSettings terminalSettings) const
 {
+    _EnsureParsed();
+
     terminalSettings.DefaultForeground(_defaultForeground);
     terminalSettings.DefaultBackground(_defaultBackground);
 
@@ -85,6 +89,13 @@ void ColorScheme::ApplyScheme(TerminalSettings terminalSettings) const
 // - a JsonObject which is an equivalent serialization of this object.
 JsonObject ColorScheme::ToJson() const
 {
+    // Nothing's been read from a scheme that hasn't been parsed, so nothing's
+    // changed in it either.
+    if (_unparsed.has_value())
+    {
+        return _unparsed.value();
+    }
+
     winrt::Windows::Data::Json::JsonObject jsonObject;
 
     auto fg = JsonValue::CreateStringValue(Utils::ColorToHexString(_defaultForeground));
@@ -109,7 +120,8 @@ JsonObject ColorScheme::ToJson() const
 }
 
 // Method Description:
-// - Create a new instance of this class from a serialized JsonObject.
+// - Create a new instance of this class from a serialized JsonObject. Only
+//      the name is read now. The colors are read the first time they're used.
 // Arguments:
 // - json: an object which should be a serialization of a ColorScheme object.
 // Return Value:
@@ -122,17 +134,80 @@ ColorScheme ColorScheme::FromJson(winrt::Windows::Data::Json::JsonObject json)
     {
         result._schemeName = json.GetNamedString(NAME_KEY);
     }
+    result._unparsed = json;
+
+    return result;
+}
+
+// Method Description:
+// - Writes this scheme into a settings snapshot. The snapshot holds its
+//      colors, so a scheme that hasn't been parsed yet is parsed now.
+// Arguments:
+// - writer: the snapshot being written
+void ColorScheme::WriteSnapshot(SettingsSnapshot::Writer& writer) const
+{
+    _EnsureParsed();
+
+    writer.WriteString(_schemeName);
+    writer.Write(_table);
+    writer.Write(_defaultForeground);
+    writer.Write(_defaultBackground);
+}
+
+// Method Description:
+// - Reads a scheme back out of a settings snapshot.
+// Arguments:
+// - reader: the snapshot, where WriteSnapshot wrote the scheme
+// Return Value:
+// - a new ColorScheme instance with the values from the snapshot
+ColorScheme ColorScheme::ReadSnapshot(SettingsSnapshot::Reader& reader)
+{
+    ColorScheme result{};
+    result._schemeName = reader.ReadString();
+    result._table = reader.Read<decltype(_table)>();
+    result._defaultForeground = reader.Read<COLORREF>();
+    result._defaultBackground = reader.Read<COLORREF>();
+    return result;
+}
+
+// Method Description:
+// - Reads the colors of a scheme that came from json, if they haven't been
+//      already. If any of them can't be read, the ones that couldn't be read
+//      are left as the defaults.
+void ColorScheme::_EnsureParsed() const noexcept
+{
+    if (!_unparsed.has_value())
+    {
+        return;
+    }
+
+    const auto json = std::move(_unparsed.value());
+    _unparsed.reset();
+
+    try
+    {
+        _ParseColors(json);
+    }
+    CATCH_LOG();
+}
+
+// Method Description:
+// - Reads a scheme's colors from its json.
+// Arguments:
+// - json: an object which should be a serialization of a ColorScheme object.
+void ColorScheme::_ParseColors(const winrt::Windows::Data::Json::JsonObject& json) const
+{
     if (json.HasKey(FOREGROUND_KEY))
     {
         const auto fgString = json.GetNamedString(FOREGROUND_KEY);
         const auto color = Utils::ColorFromHexString(fgString.c_str());
-        result._defaultForeground = color;
+        _defaultForeground = color;
     }
     if (json.HasKey(BACKGROUND_KEY))
     {
         const auto bgString = json.GetNamedString(BACKGROUND_KEY);
         const auto color = Utils::ColorFromHexString(bgString.c_str());
-        result._defaultBackground = color;
+        _defaultBackground = color;
     }
 
     // Legacy Deserialization. Leave in place to allow forward compatibility
@@ -147,7 +222,7 @@ ColorScheme ColorScheme::FromJson(winrt::Windows::Data::Json::JsonObject json)
             {
                 auto str = v.GetString();
                 auto color = Utils::ColorFromHexString(str.c_str());
-                result._table.at(i) = color;
+                _table.at(i) = color;
             }
             i++;
         }
@@ -160,12 +235,10 @@ ColorScheme ColorScheme::FromJson(winrt::Windows::Data::Json::JsonObject json)
         {
             const auto str = json.GetNamedString(current);
             const auto color = Utils::ColorFromHexString(str.c_str());
-            result._table.at(i) = color;
+            _table.at(i) = color;
         }
         i++;
     }
-
-    return result;
 }
 
 std::wstring_view ColorScheme::GetName() const noexcept
@@ -175,15 +248,18 @@ std::wstring_view ColorScheme::GetName() const noexcept
 
 std::array<COLORREF, COLOR_TABLE_SIZE>& ColorScheme::GetTable() noexcept
 {
+    _EnsureParsed();
     return _table;
 }
 
 COLORREF ColorScheme::GetForeground() const noexcept
 {
+    _EnsureParsed();
     return _defaultForeground;
 }
 
 COLORREF ColorScheme::GetBackground() const noexcept
 {
+    _EnsureParsed();
     return _defaultBackground;
 }
@@ -20,6 +20,7 @@ Author(s):
 #include <winrt/TerminalApp.h>
 #include "../../inc/conattrs.hpp"
 #include <conattrs.hpp>
+#include "SettingsSnapshot.h"
 
 namespace TerminalApp
 {
@@ -39,14 +40,25 @@ public:
     winrt::Windows::Data::Json::JsonObject ToJson() const;
     static ColorScheme FromJson(winrt::Windows::Data::Json::JsonObject json);
 
+    void WriteSnapshot(SettingsSnapshot::Writer& writer) const;
+    static ColorScheme ReadSnapshot(SettingsSnapshot::Reader& reader);
+
     std::wstring_view GetName() const noexcept;
     std::array<COLORREF, COLOR_TABLE_SIZE>& GetTable() noexcept;
     COLORREF GetForeground() const noexcept;
     COLORREF GetBackground() const noexcept;
 
 private:
+    void _EnsureParsed() const noexcept;
+    void _ParseColors(const winrt::Windows::Data::Json::JsonObject& json) const;
+
     std::wstring _schemeName;
-    std::array<COLORREF, COLOR_TABLE_SIZE> _table;
-    COLORREF _defaultForeground;
-    COLORREF _defaultBackground;
+
+    // Only the name of a scheme that's read from the settings is parsed up
+    // front. Most schemes are never used, so the rest of its json is kept here
+    // until something asks for its colors.
+    mutable std::optional<winrt::Windows::Data::Json::JsonObject> _unparsed;
+    mutable std::array<COLORREF, COLOR_TABLE_SIZE> _table;
+    mutable COLORREF _defaultForeground;
+    mutable COLORREF _defaultBackground;
 };
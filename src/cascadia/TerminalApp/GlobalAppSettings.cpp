@@ -20,6 +20,8 @@ static constexpr std::wstring_view INITIALCOLS_KEY{ L"initialCols" };
 static constexpr std::wstring_view SHOW_TITLE_IN_TITLEBAR_KEY{ L"showTerminalTitleInTitlebar" };
 static constexpr std::wstring_view REQUESTED_THEME_KEY{ L"requestedTheme" };
 static constexpr std::wstring_view SHOW_TABS_IN_TITLEBAR_KEY{ L"showTabsInTitlebar" };
+static constexpr std::wstring_view MEMORY_BUDGET_KEY{ L"memoryBudget" };
+static constexpr std::wstring_view MAX_FRAME_RATE_KEY{ L"maxFrameRate" };
 
 static constexpr std::wstring_view LIGHT_THEME_VALUE{ L"light" };
 static constexpr std::wstring_view DARK_THEME_VALUE{ L"dark" };
@@ -34,7 +36,9 @@ GlobalAppSettings::GlobalAppSettings() :
     _initialCols{ DEFAULT_COLS },
     _showTitleInTitlebar{ true },
     _showTabsInTitlebar{ true },
-    _requestedTheme{ ElementTheme::Default }
+    _requestedTheme{ ElementTheme::Default },
+    _memoryBudget{ 0 },
+    _maxFrameRate{ 0 }
 {
 
 }
@@ -105,6 +109,31 @@ void GlobalAppSettings::SetRequestedTheme(const ElementTheme requestedTheme) noe
     _requestedTheme = requestedTheme;
 }
 
+// Method Description:
+// - Gets how much memory (in megabytes) the buffers of all the tabs together may
+//   use before the oldest scrollback starts being given up. 0 means no limit.
+uint32_t GlobalAppSettings::GetMemoryBudget() const noexcept
+{
+    return _memoryBudget;
+}
+
+void GlobalAppSettings::SetMemoryBudget(const uint32_t megabytes) noexcept
+{
+    _memoryBudget = megabytes;
+}
+
+// Method Description:
+// - Gets the most frames a second that each tab paints. 0 means the default.
+uint32_t GlobalAppSettings::GetMaxFrameRate() const noexcept
+{
+    return _maxFrameRate;
+}
+
+void GlobalAppSettings::SetMaxFrameRate(const uint32_t framesPerSecond) noexcept
+{
+    _maxFrameRate = framesPerSecond;
+}
+
 #pragma region ExperimentalSettings
 bool GlobalAppSettings::GetShowTabsInTitlebar() const noexcept
 {
@@ -128,6 +157,7 @@ void GlobalAppSettings::ApplyToSettings(TerminalSettings& settings) const noexce
     settings.KeyBindings(GetKeybindings());
     settings.InitialRows(_initialRows);
     settings.InitialCols(_initialCols);
+    settings.MaxFrameRate(_maxFrameRate);
 }
 
 // Method Description:
@@ -157,6 +187,10 @@ JsonObject GlobalAppSettings::ToJson() const
                       JsonValue::CreateBooleanValue(_showTabsInTitlebar));
     jsonObject.Insert(REQUESTED_THEME_KEY,
                       JsonValue::CreateStringValue(_SerializeTheme(_requestedTheme)));
+    jsonObject.Insert(MEMORY_BUDGET_KEY,
+                      JsonValue::CreateNumberValue(_memoryBudget));
+    jsonObject.Insert(MAX_FRAME_RATE_KEY,
+                      JsonValue::CreateNumberValue(_maxFrameRate));
 
     // We'll add the keybindings later in CascadiaSettings, because if we do it
     // here, they'll appear before the profiles.
@@ -210,6 +244,83 @@ GlobalAppSettings GlobalAppSettings::FromJson(winrt::Windows::Data::Json::JsonOb
         result._requestedTheme = _ParseTheme(themeStr.c_str());
     }
 
+    if (json.HasKey(MEMORY_BUDGET_KEY))
+    {
+        const auto budget = json.GetNamedNumber(MEMORY_BUDGET_KEY);
+        result._memoryBudget = budget > 0 ? static_cast<uint32_t>(budget) : 0;
+    }
+
+    if (json.HasKey(MAX_FRAME_RATE_KEY))
+    {
+        const auto frameRate = json.GetNamedNumber(MAX_FRAME_RATE_KEY);
+        result._maxFrameRate = frameRate > 0 ? static_cast<uint32_t>(frameRate) : 0;
+    }
+
+    return result;
+}
+
+// Method Description:
+// - Writes these settings, their schemes and their keybindings into a
+//   settings snapshot.
+// Arguments:
+// - writer: the snapshot being written
+void GlobalAppSettings::WriteSnapshot(SettingsSnapshot::Writer& writer) const
+{
+    writer.Write(_defaultProfile);
+    winrt::get_self<winrt::TerminalApp::implementation::AppKeyBindings>(_keybindings)->WriteSnapshot(writer);
+
+    writer.Write(gsl::narrow<uint32_t>(_colorSchemes.size()));
+    for (const auto& scheme : _colorSchemes)
+    {
+        scheme.WriteSnapshot(writer);
+    }
+
+    writer.Write(_initialRows);
+    writer.Write(_initialCols);
+
+    writer.Write(_showStatusline);
+    writer.Write(_alwaysShowTabs);
+    writer.Write(_showTitleInTitlebar);
+
+    writer.Write(_showTabsInTitlebar);
+    writer.Write(_requestedTheme);
+
+    writer.Write(_memoryBudget);
+    writer.Write(_maxFrameRate);
+}
+
+// Method Description:
+// - Reads the global settings back out of a settings snapshot.
+// Arguments:
+// - reader: the snapshot, where WriteSnapshot wrote the settings
+// Return Value:
+// - a new GlobalAppSettings instance with the values from the snapshot
+GlobalAppSettings GlobalAppSettings::ReadSnapshot(SettingsSnapshot::Reader& reader)
+{
+    GlobalAppSettings result{};
+
+    result._defaultProfile = reader.Read<GUID>();
+    result._keybindings = winrt::TerminalApp::implementation::AppKeyBindings::ReadSnapshot(reader);
+
+    const auto schemeCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < schemeCount; ++i)
+    {
+        result._colorSchemes.emplace_back(ColorScheme::ReadSnapshot(reader));
+    }
+
+    result._initialRows = reader.Read<int32_t>();
+    result._initialCols = reader.Read<int32_t>();
+
+    result._showStatusline = reader.Read<bool>();
+    result._alwaysShowTabs = reader.Read<bool>();
+    result._showTitleInTitlebar = reader.Read<bool>();
+
+    result._showTabsInTitlebar = reader.Read<bool>();
+    result._requestedTheme = reader.Read<ElementTheme>();
+
+    result._memoryBudget = reader.Read<uint32_t>();
+    result._maxFrameRate = reader.Read<uint32_t>();
+
     return result;
 }
 
@@ -50,9 +50,18 @@ public:
 
     winrt::Windows::UI::Xaml::ElementTheme GetRequestedTheme() const noexcept;
 
+    uint32_t GetMemoryBudget() const noexcept;
+    void SetMemoryBudget(const uint32_t megabytes) noexcept;
+
+    uint32_t GetMaxFrameRate() const noexcept;
+    void SetMaxFrameRate(const uint32_t framesPerSecond) noexcept;
+
     winrt::Windows::Data::Json::JsonObject ToJson() const;
     static GlobalAppSettings FromJson(winrt::Windows::Data::Json::JsonObject json);
 
+    void WriteSnapshot(SettingsSnapshot::Writer& writer) const;
+    static GlobalAppSettings ReadSnapshot(SettingsSnapshot::Reader& reader);
+
     void ApplyToSettings(winrt::Microsoft::Terminal::Settings::TerminalSettings& settings) const noexcept;
 
 private:
@@ -71,6 +80,9 @@ private:
     bool _showTabsInTitlebar;
     winrt::Windows::UI::Xaml::ElementTheme _requestedTheme;
 
+    uint32_t _memoryBudget;
+    uint32_t _maxFrameRate;
+
     static winrt::Windows::UI::Xaml::ElementTheme _ParseTheme(const std::wstring& themeString) noexcept;
     static std::wstring_view _SerializeTheme(const winrt::Windows::UI::Xaml::ElementTheme theme) noexcept;
 
@@ -22,6 +22,8 @@ static constexpr std::wstring_view BACKGROUND_KEY{ L"background" };
 static constexpr std::wstring_view COLORTABLE_KEY{ L"colorTable" };
 static constexpr std::wstring_view HISTORYSIZE_KEY{ L"historySize" };
 static constexpr std::wstring_view SNAPONINPUT_KEY{ L"snapOnInput" };
+static constexpr std::wstring_view PREDICTIVEECHO_KEY{ L"predictiveEcho" };
+static constexpr std::wstring_view RECORDINGDIRECTORY_KEY{ L"recordingDirectory" };
 static constexpr std::wstring_view CURSORCOLOR_KEY{ L"cursorColor" };
 static constexpr std::wstring_view CURSORSHAPE_KEY{ L"cursorShape" };
 static constexpr std::wstring_view CURSORHEIGHT_KEY{ L"cursorHeight" };
@@ -63,6 +65,8 @@ Profile::Profile(const winrt::guid& guid):
     _colorTable{},
     _historySize{ DEFAULT_HISTORY_SIZE },
     _snapOnInput{ true },
+    _predictiveEcho{ false },
+    _recordingDirectory{},
     _cursorColor{ DEFAULT_CURSOR_COLOR },
     _cursorShape{ CursorStyle::Bar },
     _cursorHeight{ DEFAULT_CURSOR_HEIGHT },
@@ -129,6 +133,11 @@ TerminalSettings Profile::CreateTerminalSettings(const std::vector<ColorScheme>&
     }
     terminalSettings.HistorySize(_historySize);
     terminalSettings.SnapOnInput(_snapOnInput);
+    terminalSettings.PredictiveEcho(_predictiveEcho);
+    if (_recordingDirectory)
+    {
+        terminalSettings.RecordingDirectory(winrt::to_hstring(_recordingDirectory.value().c_str()));
+    }
     terminalSettings.CursorColor(_cursorColor);
     terminalSettings.CursorHeight(_cursorHeight);
     terminalSettings.CursorShape(_cursorShape);
@@ -194,6 +203,7 @@ JsonObject Profile::ToJson() const
     // Core Settings
     const auto historySize = JsonValue::CreateNumberValue(_historySize);
     const auto snapOnInput = JsonValue::CreateBooleanValue(_snapOnInput);
+    const auto predictiveEcho = JsonValue::CreateBooleanValue(_predictiveEcho);
     const auto cursorColor = JsonValue::CreateStringValue(Utils::ColorToHexString(_cursorColor));
 
     // Control Settings
@@ -244,6 +254,11 @@ JsonObject Profile::ToJson() const
     }
     jsonObject.Insert(HISTORYSIZE_KEY, historySize);
     jsonObject.Insert(SNAPONINPUT_KEY, snapOnInput);
+    jsonObject.Insert(PREDICTIVEECHO_KEY, predictiveEcho);
+    if (_recordingDirectory)
+    {
+        jsonObject.Insert(RECORDINGDIRECTORY_KEY, JsonValue::CreateStringValue(_recordingDirectory.value()));
+    }
     jsonObject.Insert(CURSORCOLOR_KEY, cursorColor);
 
     // Only add the cursor height property if we're a legacy-style cursor.
@@ -347,6 +362,14 @@ Profile Profile::FromJson(winrt::Windows::Data::Json::JsonObject json)
     {
         result._snapOnInput = json.GetNamedBoolean(SNAPONINPUT_KEY);
     }
+    if (json.HasKey(PREDICTIVEECHO_KEY))
+    {
+        result._predictiveEcho = json.GetNamedBoolean(PREDICTIVEECHO_KEY);
+    }
+    if (json.HasKey(RECORDINGDIRECTORY_KEY))
+    {
+        result._recordingDirectory = json.GetNamedString(RECORDINGDIRECTORY_KEY);
+    }
     if (json.HasKey(CURSORCOLOR_KEY))
     {
         const auto cursorString = json.GetNamedString(CURSORCOLOR_KEY);
@@ -409,6 +432,82 @@ Profile Profile::FromJson(winrt::Windows::Data::Json::JsonObject json)
     return result;
 }
 
+// Method Description:
+// - Writes this profile into a settings snapshot.
+// Arguments:
+// - writer: the snapshot being written
+void Profile::WriteSnapshot(SettingsSnapshot::Writer& writer) const
+{
+    writer.Write(_guid);
+    writer.WriteString(_name);
+    writer.WriteOptionalString(_schemeName);
+
+    writer.WriteOptional(_defaultForeground);
+    writer.WriteOptional(_defaultBackground);
+    writer.Write(_colorTable);
+    writer.Write(_historySize);
+    writer.Write(_snapOnInput);
+    writer.Write(_predictiveEcho);
+    writer.WriteOptionalString(_recordingDirectory);
+    writer.Write(_cursorColor);
+    writer.Write(_cursorHeight);
+    writer.Write(_cursorShape);
+
+    writer.WriteString(_commandline);
+    writer.WriteString(_fontFace);
+    writer.WriteOptionalString(_startingDirectory);
+    writer.Write(_fontSize);
+    writer.Write(_acrylicTransparency);
+    writer.Write(_useAcrylic);
+
+    writer.WriteOptionalString(_scrollbarState);
+    writer.Write(_closeOnExit);
+    writer.WriteString(_padding);
+
+    writer.WriteOptionalString(_icon);
+}
+
+// Method Description:
+// - Reads a profile back out of a settings snapshot.
+// Arguments:
+// - reader: the snapshot, where WriteSnapshot wrote the profile
+// Return Value:
+// - a new Profile instance with the values from the snapshot
+Profile Profile::ReadSnapshot(SettingsSnapshot::Reader& reader)
+{
+    Profile result{};
+
+    result._guid = reader.Read<GUID>();
+    result._name = reader.ReadString();
+    result._schemeName = reader.ReadOptionalString();
+
+    result._defaultForeground = reader.ReadOptional<uint32_t>();
+    result._defaultBackground = reader.ReadOptional<uint32_t>();
+    result._colorTable = reader.Read<decltype(_colorTable)>();
+    result._historySize = reader.Read<int32_t>();
+    result._snapOnInput = reader.Read<bool>();
+    result._predictiveEcho = reader.Read<bool>();
+    result._recordingDirectory = reader.ReadOptionalString();
+    result._cursorColor = reader.Read<uint32_t>();
+    result._cursorHeight = reader.Read<uint32_t>();
+    result._cursorShape = reader.Read<CursorStyle>();
+
+    result._commandline = reader.ReadString();
+    result._fontFace = reader.ReadString();
+    result._startingDirectory = reader.ReadOptionalString();
+    result._fontSize = reader.Read<int32_t>();
+    result._acrylicTransparency = reader.Read<double>();
+    result._useAcrylic = reader.Read<bool>();
+
+    result._scrollbarState = reader.ReadOptionalString();
+    result._closeOnExit = reader.Read<bool>();
+    result._padding = reader.ReadString();
+
+    result._icon = reader.ReadOptionalString();
+
+    return result;
+}
+
 
 
 void Profile::SetFontFace(std::wstring fontFace) noexcept
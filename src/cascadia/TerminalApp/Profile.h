@@ -35,6 +35,9 @@ public:
     winrt::Windows::Data::Json::JsonObject ToJson() const;
     static Profile FromJson(winrt::Windows::Data::Json::JsonObject json);
 
+    void WriteSnapshot(SettingsSnapshot::Writer& writer) const;
+    static Profile ReadSnapshot(SettingsSnapshot::Reader& reader);
+
     GUID GetGuid() const noexcept;
     std::wstring_view GetName() const noexcept;
 
@@ -73,6 +76,8 @@ private:
     std::array<uint32_t, COLOR_TABLE_SIZE> _colorTable;
     int32_t _historySize;
     bool _snapOnInput;
+    bool _predictiveEcho;
+    std::optional<std::wstring> _recordingDirectory;
     uint32_t _cursorColor;
     uint32_t _cursorHeight;
     winrt::Microsoft::Terminal::Settings::CursorStyle _cursorShape;
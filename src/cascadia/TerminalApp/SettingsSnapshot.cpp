@@ -0,0 +1,216 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "SettingsSnapshot.h"
+
+using namespace ::TerminalApp;
+
+void SettingsSnapshot::Writer::WriteString(const std::wstring_view value)
+{
+    Write(gsl::narrow<uint32_t>(value.size()));
+    const auto bytes = reinterpret_cast<const BYTE*>(value.data());
+    _data.insert(_data.end(), bytes, bytes + value.size() * sizeof(wchar_t));
+}
+
+void SettingsSnapshot::Writer::WriteOptionalString(const std::optional<std::wstring>& value)
+{
+    Write(value.has_value());
+    if (value.has_value())
+    {
+        WriteString(value.value());
+    }
+}
+
+const std::vector<BYTE>& SettingsSnapshot::Writer::GetData() const noexcept
+{
+    return _data;
+}
+
+SettingsSnapshot::Reader::Reader(const BYTE* const data, const size_t size) noexcept :
+    _data{ data },
+    _size{ size },
+    _position{ 0 }
+{
+}
+
+std::wstring SettingsSnapshot::Reader::ReadString()
+{
+    const auto length = Read<uint32_t>();
+    const auto chars = _Take(static_cast<size_t>(length) * sizeof(wchar_t));
+
+    std::wstring value(length, UNICODE_NULL);
+    memcpy(value.data(), chars, value.size() * sizeof(wchar_t));
+    return value;
+}
+
+std::optional<std::wstring> SettingsSnapshot::Reader::ReadOptionalString()
+{
+    if (Read<bool>())
+    {
+        return ReadString();
+    }
+    return std::nullopt;
+}
+
+bool SettingsSnapshot::Reader::IsAtEnd() const noexcept
+{
+    return _position == _size;
+}
+
+// Method Description:
+// - Moves past the next size bytes of the snapshot.
+// Arguments:
+// - size: the number of bytes to take
+// Return Value:
+// - the bytes that were taken
+// Note: throws if there aren't that many bytes left, which means the snapshot's damaged.
+const BYTE* SettingsSnapshot::Reader::_Take(const size_t size)
+{
+    THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), size > _size - _position);
+    const auto bytes = _data + _position;
+    _position += size;
+    return bytes;
+}
+
+// Function Description:
+// - Hashes the text of the settings file, to tell whether it's changed since
+//   a snapshot was taken of it.
+// Arguments:
+// - settings: the text of the settings file
+// Return Value:
+// - the hash
+uint64_t SettingsSnapshot::s_HashSettings(const std::wstring_view settings) noexcept
+{
+    return s_Hash(settings.data(), settings.size() * sizeof(wchar_t));
+}
+
+// Function Description:
+// - 64-bit FNV-1a. It doesn't need to be more than that: it's only telling
+//   apart versions of one file, not standing up to anyone trying to fool it.
+uint64_t SettingsSnapshot::s_Hash(const void* const data, const size_t size) noexcept
+{
+    const auto bytes = static_cast<const BYTE*>(data);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Function Description:
+// - Reads the snapshot at the given path, if it was taken of the same settings
+//   by the same version of the app. The snapshot file is mapped, and read
+//   straight out of the view.
+// Arguments:
+// - path: the snapshot file
+// - settingsHash: the s_HashSettings of the settings, as they are now
+// - appVersion: the version of the app that's running
+// - read: reads the settings out of the snapshot. If it throws, the snapshot
+//   is treated as damaged.
+// Return Value:
+// - true if the snapshot was there, valid, and read in full.
+bool SettingsSnapshot::s_TryRead(const std::wstring_view path,
+                                 const uint64_t settingsHash,
+                                 const uint64_t appVersion,
+                                 const std::function<void(Reader&)>& read) noexcept
+try
+{
+    const std::wstring filePath{ path };
+    wil::unique_hfile file{ CreateFileW(filePath.c_str(),
+                                        GENERIC_READ,
+                                        FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                        nullptr,
+                                        OPEN_EXISTING,
+                                        FILE_ATTRIBUTE_NORMAL,
+                                        nullptr) };
+    if (!file)
+    {
+        // There's no snapshot until the settings have been parsed once.
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    THROW_IF_WIN32_BOOL_FALSE(GetFileSizeEx(file.get(), &size));
+    if (size.QuadPart < static_cast<LONGLONG>(sizeof(Header)))
+    {
+        return false;
+    }
+
+    wil::unique_handle mapping{ CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+    THROW_LAST_ERROR_IF(!mapping);
+
+    const wil::unique_mapview_ptr<BYTE> view{ static_cast<BYTE*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)) };
+    THROW_LAST_ERROR_IF(!view);
+
+    Header header;
+    memcpy(&header, view.get(), sizeof(header));
+
+    const auto payload = view.get() + sizeof(header);
+    const auto payloadSize = static_cast<uint64_t>(size.QuadPart) - sizeof(header);
+    if (header.signature != s_Signature ||
+        header.formatVersion != s_FormatVersion ||
+        header.appVersion != appVersion ||
+        header.settingsHash != settingsHash ||
+        header.payloadSize != payloadSize ||
+        header.payloadHash != s_Hash(payload, gsl::narrow<size_t>(payloadSize)))
+    {
+        return false;
+    }
+
+    Reader reader{ payload, gsl::narrow<size_t>(payloadSize) };
+    read(reader);
+    THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), !reader.IsAtEnd());
+    return true;
+}
+catch (...)
+{
+    LOG_CAUGHT_EXCEPTION();
+    return false;
+}
+
+// Function Description:
+// - Writes a snapshot of the given settings. It's written beside the old one
+//   and then moved over it, so that a snapshot is never seen half written.
+// Arguments:
+// - path: the snapshot file
+// - settingsHash: the s_HashSettings of the settings the snapshot was taken of
+// - appVersion: the version of the app that's running
+// - writer: what the settings wrote into the snapshot
+// Note: throws if the snapshot can't be written
+void SettingsSnapshot::s_Write(const std::wstring_view path,
+                               const uint64_t settingsHash,
+                               const uint64_t appVersion,
+                               const Writer& writer)
+{
+    const auto& payload = writer.GetData();
+
+    Header header;
+    header.signature = s_Signature;
+    header.formatVersion = s_FormatVersion;
+    header.appVersion = appVersion;
+    header.settingsHash = settingsHash;
+    header.payloadSize = payload.size();
+    header.payloadHash = s_Hash(payload.data(), payload.size());
+
+    const std::wstring filePath{ path };
+    const auto tempPath = filePath + L".tmp";
+    {
+        wil::unique_hfile file{ CreateFileW(tempPath.c_str(),
+                                            GENERIC_WRITE,
+                                            0,
+                                            nullptr,
+                                            CREATE_ALWAYS,
+                                            FILE_ATTRIBUTE_NORMAL,
+                                            nullptr) };
+        THROW_LAST_ERROR_IF(!file);
+
+        DWORD written = 0;
+        THROW_IF_WIN32_BOOL_FALSE(WriteFile(file.get(), &header, sizeof(header), &written, nullptr));
+        THROW_IF_WIN32_BOOL_FALSE(WriteFile(file.get(), payload.data(), gsl::narrow<DWORD>(payload.size()), &written, nullptr));
+    }
+
+    THROW_IF_WIN32_BOOL_FALSE(MoveFileExW(tempPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING));
+}
@@ -0,0 +1,126 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- SettingsSnapshot.h
+
+Abstract:
+- A binary copy of the settings as they were after they were last parsed, so
+    that a launch where profiles.json hasn't changed doesn't have to parse it.
+- The snapshot is keyed by a hash of the settings file's text and the version
+    of the app. If either doesn't match, or the snapshot is damaged in any way,
+    it's ignored, and the settings are parsed from the json as usual (and a new
+    snapshot is written).
+- The settings classes write themselves into a Writer, and read themselves
+    back out of a Reader, in the same order. A Reader reads straight out of a
+    view of the snapshot file, and throws if it's asked to read past the end.
+--*/
+
+#pragma once
+
+namespace TerminalApp
+{
+    class SettingsSnapshot;
+};
+
+class TerminalApp::SettingsSnapshot final
+{
+public:
+    SettingsSnapshot() = delete;
+
+    class Writer final
+    {
+    public:
+        template<typename T>
+        void Write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const auto bytes = reinterpret_cast<const BYTE*>(&value);
+            _data.insert(_data.end(), bytes, bytes + sizeof(value));
+        }
+
+        template<typename T>
+        void WriteOptional(const std::optional<T>& value)
+        {
+            Write(value.has_value());
+            if (value.has_value())
+            {
+                Write(value.value());
+            }
+        }
+
+        void WriteString(const std::wstring_view value);
+        void WriteOptionalString(const std::optional<std::wstring>& value);
+
+        const std::vector<BYTE>& GetData() const noexcept;
+
+    private:
+        std::vector<BYTE> _data;
+    };
+
+    class Reader final
+    {
+    public:
+        Reader(const BYTE* const data, const size_t size) noexcept;
+
+        template<typename T>
+        T Read()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            T value;
+            memcpy(&value, _Take(sizeof(value)), sizeof(value));
+            return value;
+        }
+
+        template<typename T>
+        std::optional<T> ReadOptional()
+        {
+            if (Read<bool>())
+            {
+                return Read<T>();
+            }
+            return std::nullopt;
+        }
+
+        std::wstring ReadString();
+        std::optional<std::wstring> ReadOptionalString();
+
+        bool IsAtEnd() const noexcept;
+
+    private:
+        const BYTE* _Take(const size_t size);
+
+        const BYTE* const _data;
+        const size_t _size;
+        size_t _position;
+    };
+
+    static uint64_t s_HashSettings(const std::wstring_view settings) noexcept;
+
+    static bool s_TryRead(const std::wstring_view path,
+                          const uint64_t settingsHash,
+                          const uint64_t appVersion,
+                          const std::function<void(Reader&)>& read) noexcept;
+    static void s_Write(const std::wstring_view path,
+                        const uint64_t settingsHash,
+                        const uint64_t appVersion,
+                        const Writer& writer);
+
+private:
+    // Bump this whenever anything about what the settings write changes.
+    static constexpr uint32_t s_FormatVersion = 2;
+    static constexpr uint32_t s_Signature = 0x53535457; // "WTSS"
+
+    struct Header
+    {
+        uint32_t signature;
+        uint32_t formatVersion;
+        uint64_t appVersion;
+        uint64_t settingsHash;
+        uint64_t payloadSize;
+        uint64_t payloadHash;
+    };
+
+    static uint64_t s_Hash(const void* const data, const size_t size) noexcept;
+};
@@ -17,6 +17,7 @@
 #include "../../types/inc/Utils.hpp"
 
 using namespace ::Microsoft::Console;
+using namespace ::Microsoft::Console::Types;
 
 namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 {
@@ -42,6 +43,16 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         return _guid;
     }
 
+    uint64_t ConhostConnection::BytesRead() const noexcept
+    {
+        return _outputReader.BytesRead();
+    }
+
+    uint64_t ConhostConnection::ReadCount() const noexcept
+    {
+        return _outputReader.ReadCount();
+    }
+
     winrt::event_token ConhostConnection::TerminalOutput(Microsoft::Terminal::TerminalConnection::TerminalOutputEventArgs const& handler)
     {
         return _outputHandlers.add(handler);
@@ -52,6 +63,16 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         _outputHandlers.remove(token);
     }
 
+    winrt::event_token ConhostConnection::TerminalOutputBuffer(Microsoft::Terminal::TerminalConnection::TerminalOutputBufferEventArgs const& handler)
+    {
+        return _outputBufferHandlers.add(handler);
+    }
+
+    void ConhostConnection::TerminalOutputBuffer(winrt::event_token const& token) noexcept
+    {
+        _outputBufferHandlers.remove(token);
+    }
+
     winrt::event_token ConhostConnection::TerminalDisconnected(Microsoft::Terminal::TerminalConnection::TerminalDisconnectedEventArgs const& handler)
     {
         return _disconnectHandlers.add(handler);
@@ -83,16 +104,45 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             extraEnvVars.emplace(L"WT_SESSION", pwszGuid);
         }
 
-        THROW_IF_FAILED(
-            CreateConPty(cmdline,
-                         startingDirectory,
-                         static_cast<short>(_initialCols),
-                         static_cast<short>(_initialRows),
-                         &_inPipe,
-                         &_outPipe,
-                         &_signalPipe,
-                         &_piConhost,
-                         extraEnvVars));
+        // Have conhost write its output into a ring we share with it, rather than
+        //      the pipe, whenever we can make one. The ring's handles are only
+        //      inheritable while conhost is launched, so no other process gets them.
+        std::unique_ptr<SharedRing> outputRing;
+        if (FAILED(LOG_IF_FAILED(SharedRing::s_Create(SharedRing::DefaultCapacity, outputRing))) ||
+            FAILED(LOG_IF_FAILED(outputRing->SetInheritable(true))))
+        {
+            outputRing.reset();
+        }
+
+        const auto hr = CreateConPty(cmdline,
+                                     startingDirectory,
+                                     static_cast<short>(_initialCols),
+                                     static_cast<short>(_initialRows),
+                                     &_inPipe,
+                                     &_outPipe,
+                                     &_signalPipe,
+                                     &_piConhost,
+                                     extraEnvVars,
+                                     outputRing ? outputRing->GetSection() : nullptr);
+        if (outputRing)
+        {
+            LOG_IF_FAILED(outputRing->SetInheritable(false));
+        }
+        THROW_IF_FAILED(hr);
+
+        if (outputRing)
+        {
+            THROW_IF_WIN32_BOOL_FALSE(DuplicateHandle(GetCurrentProcess(),
+                                                      _piConhost.hProcess,
+                                                      GetCurrentProcess(),
+                                                      _conhostProcess.put(),
+                                                      SYNCHRONIZE,
+                                                      FALSE,
+                                                      0));
+            _outputRing = std::move(outputRing);
+        }
+
+        _inputWriter = std::make_unique<::Microsoft::Terminal::TerminalConnection::InputPipeWriter>(_inPipe);
 
         _connected = true;
 
@@ -114,10 +164,9 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             return;
         }
 
-        // convert from UTF-16LE to UTF-8 as ConPty expects UTF-8
-        std::string str = winrt::to_string(data);
-        bool fSuccess = !!WriteFile(_inPipe, str.c_str(), (DWORD)str.length(), nullptr, nullptr);
-        fSuccess;
+        // The writer converts it to UTF-8 (as ConPty expects) and writes it for us,
+        // merged with any other input that's still waiting to be written.
+        _inputWriter->Write(data);
     }
 
     void ConhostConnection::Resize(uint32_t rows, uint32_t columns)
@@ -144,12 +193,21 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         //      Close the Pseudoconsole
         //      terminate our processes
         CloseHandle(_signalPipe);
-        CloseHandle(_inPipe);
         CloseHandle(_outPipe);
+        if (_outputRing)
+        {
+            // Wakes the output thread, and tells it to stop.
+            _outputRing->Close();
+        }
         // What? CreateThread is in app partition but TerminateThread isn't?
         //TerminateThread(_hOutputThread, 0);
         TerminateProcess(_piConhost.hProcess, 0);
         CloseHandle(_piConhost.hProcess);
+
+        // With conhost gone, a write that was blocked on the pipe fails, so the
+        // writer can stop. It has to be done with the pipe before we close it.
+        _inputWriter->Shutdown();
+        CloseHandle(_inPipe);
     }
 
     DWORD WINAPI ConhostConnection::StaticOutputThreadProc(LPVOID lpParameter)
@@ -158,39 +216,53 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         return pInstance->_OutputThread();
     }
 
+    // Method Description:
+    // - Reads conhost's output, from our shared ring if it has one or the pipe
+    //      otherwise, and passes it along to our handlers until conhost goes
+    //      away. If we didn't close the connection ourselves, we report the
+    //      disconnect.
     DWORD ConhostConnection::_OutputThread()
     {
-        const size_t bufferSize = 4096;
-        BYTE buffer[bufferSize];
-        DWORD dwRead;
-        while (true)
+        const auto callback = [this](const std::string_view chunk) { _SendOutput(chunk); };
+        const auto hr = _outputRing ? _outputReader.ReadRing(*_outputRing, _conhostProcess.get(), callback) :
+                                      _outputReader.ReadPipe(_outPipe, callback);
+        if (_closing)
         {
-            dwRead = 0;
-            bool fSuccess = false;
+            // This is okay, we closed the pipe (or the ring) to stop reading.
+            return 0;
+        }
 
-            fSuccess = !!ReadFile(_outPipe, buffer, bufferSize, &dwRead, nullptr);
-            if (!fSuccess)
-            {
-                if (_closing)
-                {
-                    // This is okay, break out to kill the thread
-                    return 0;
-                }
-                else
-                {
-                    _disconnectHandlers();
-                    return (DWORD)-1;
-                }
+        // A pipe that's broken, or a conhost that's exited, is just the end of the output.
+        if (hr != HRESULT_FROM_WIN32(ERROR_BROKEN_PIPE))
+        {
+            LOG_IF_FAILED(hr);
+        }
+        _disconnectHandlers();
+        return (DWORD)-1;
+    }
 
+    // Method Description:
+    // - Passes a chunk of output on to our handlers.
+    // Arguments:
+    // - chunk: the output, in UTF-8. Only valid for the duration of the call.
+    void ConhostConnection::_SendOutput(const std::string_view chunk)
+    {
+        // Lend the buffer itself to anyone who can take the output as it is.
+        const auto data = reinterpret_cast<const uint8_t*>(chunk.data());
+        if (_outputBufferHandlers)
+        {
+            _outputBufferHandlers(winrt::array_view<const uint8_t>{ data, data + chunk.size() });
+        }
+
+        // Decode the chunk for everyone who wants a string. A read that only
+        // held the start of a character has nothing to pass along yet.
+        if (_outputHandlers)
+        {
+            const auto text = _outputReader.Decode(chunk);
+            if (!text.empty())
+            {
+                _outputHandlers(winrt::hstring{ text });
             }
-            if (dwRead == 0) continue;
-            // Convert buffer to hstring
-            char* pchStr = (char*)(buffer);
-            std::string str{pchStr, dwRead};
-            auto hstr = winrt::to_hstring(str);
-
-            // Pass the output to our registered event handlers
-            _outputHandlers(hstr);
         }
     }
 }
@@ -4,6 +4,8 @@
 #pragma once
 
 #include "ConhostConnection.g.h"
+#include "InputPipeWriter.h"
+#include "OutputReader.h"
 
 namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 {
@@ -13,6 +15,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         winrt::event_token TerminalOutput(TerminalConnection::TerminalOutputEventArgs const& handler);
         void TerminalOutput(winrt::event_token const& token) noexcept;
+        winrt::event_token TerminalOutputBuffer(TerminalConnection::TerminalOutputBufferEventArgs const& handler);
+        void TerminalOutputBuffer(winrt::event_token const& token) noexcept;
         winrt::event_token TerminalDisconnected(TerminalConnection::TerminalDisconnectedEventArgs const& handler);
         void TerminalDisconnected(winrt::event_token const& token) noexcept;
         void Start();
@@ -22,8 +26,12 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         winrt::guid Guid() const noexcept;
 
+        uint64_t BytesRead() const noexcept;
+        uint64_t ReadCount() const noexcept;
+
     private:
         winrt::event<TerminalConnection::TerminalOutputEventArgs> _outputHandlers;
+        winrt::event<TerminalConnection::TerminalOutputBufferEventArgs> _outputBufferHandlers;
         winrt::event<TerminalConnection::TerminalDisconnectedEventArgs> _disconnectHandlers;
 
         uint32_t _initialRows{};
@@ -41,8 +49,21 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         guid _guid{}; // A "unique" session identifier for connected client
         bool _closing{};
 
+        // Reads the output off of _outPipe or _outputRing, on the output thread.
+        ::Microsoft::Terminal::TerminalConnection::OutputReader _outputReader;
+
+        // Input is written to _inPipe by this, off of the caller's thread.
+        std::unique_ptr<::Microsoft::Terminal::TerminalConnection::InputPipeWriter> _inputWriter;
+
+        // If we could set one up, conhost writes its output here instead of to _outPipe.
+        std::unique_ptr<::Microsoft::Console::Types::SharedRing> _outputRing;
+        // The output thread's own handle to the conhost process, for noticing
+        //      that it's gone when its output doesn't come through a pipe.
+        wil::unique_handle _conhostProcess;
+
         static DWORD WINAPI StaticOutputThreadProc(LPVOID lpParameter);
         DWORD _OutputThread();
+        void _SendOutput(const std::string_view chunk);
     };
 }
 
@@ -5,6 +5,7 @@
 #include "ConptyConnection.h"
 
 #include <Windows.h>
+#include <conpty-universal.h>
 
 namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 {
@@ -17,7 +18,9 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         _hPC{ INVALID_HANDLE_VALUE },
         _outputThreadId{ 0 },
         _hOutputThread{ INVALID_HANDLE_VALUE },
-        _piClient{ 0 }
+        _piClient{ 0 },
+        _outputReader{ s_ReadSize },
+        _inputWriter{}
     {
         _commandline = commandline;
         _initialRows = initialRows;
@@ -35,6 +38,16 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         _outputHandlers.remove(token);
     }
 
+    winrt::event_token ConptyConnection::TerminalOutputBuffer(TerminalConnection::TerminalOutputBufferEventArgs const& handler)
+    {
+        return _outputBufferHandlers.add(handler);
+    }
+
+    void ConptyConnection::TerminalOutputBuffer(winrt::event_token const& token) noexcept
+    {
+        _outputBufferHandlers.remove(token);
+    }
+
     winrt::event_token ConptyConnection::TerminalDisconnected(TerminalConnection::TerminalDisconnectedEventArgs const& handler)
     {
         handler;
@@ -52,6 +65,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
     void ConptyConnection::Start()
     {
         _CreatePseudoConsole();
+        _inputWriter = std::make_unique<::Microsoft::Terminal::TerminalConnection::InputPipeWriter>(_inPipe);
 
         _connected = true;
 
@@ -74,9 +88,14 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
     void ConptyConnection::WriteInput(hstring const& data)
     {
-        data;
+        if (!_connected)
+        {
+            return;
+        }
 
-        throw hresult_not_implemented();
+        // The writer converts it to UTF-8 (as the pseudoconsole expects) and writes it
+        // for us, merged with any other input that's still waiting to be written.
+        _inputWriter->Write(data);
     }
 
     void ConptyConnection::Resize(uint32_t rows, uint32_t columns)
@@ -97,17 +116,29 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         throw hresult_not_implemented();
     }
 
+    uint64_t ConptyConnection::BytesRead() const noexcept
+    {
+        return _outputReader.BytesRead();
+    }
+
+    uint64_t ConptyConnection::ReadCount() const noexcept
+    {
+        return _outputReader.ReadCount();
+    }
 
     // Function Description:
-    // - Sample function which combines the creation of some basic anonymous pipes
-    //      and passes them to CreatePseudoConsole.
+    // - Sample function which combines the creation of some basic pipes
+    //      and passes them to CreatePseudoConsole. The output pipe is
+    //      overlapped, see CreateOverlappedPipe.
     // Arguments:
     // - size: The size of the conpty to create, in characters.
     // - phInput: Receives the handle to the newly-created anonymous pipe for writing input to the conpty.
     // - phOutput: Receives the handle to the newly-created anonymous pipe for reading the output of the conpty.
     // - phPty: Receives a token value to identify this conpty
+    // - outputBufferSize: The size of the buffer to suggest for the output pipe, in bytes.
     HRESULT _CreatePseudoConsoleAndHandles(COORD size,
                                            _In_ DWORD dwFlags,
+                                           const DWORD outputBufferSize,
                                            _Out_ HANDLE* phInput,
                                            _Out_ HANDLE* phOutput,
                                            _Out_ HPCON* phPC)
@@ -129,10 +160,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         }
         if (SUCCEEDED(hr))
         {
-            if (!CreatePipe(&outPipeOurSide, &outPipePseudoConsoleSide, NULL, 0))
-            {
-                hr = HRESULT_FROM_WIN32(GetLastError());
-            }
+            hr = CreateOverlappedPipe(outputBufferSize, &outPipeOurSide, &outPipePseudoConsoleSide);
             if (SUCCEEDED(hr))
             {
                 hr = CreatePseudoConsole(size, inPipePseudoConsoleSide, outPipePseudoConsoleSide, dwFlags, phPC);
@@ -176,12 +204,45 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         return fSuccess ? S_OK : HRESULT_FROM_WIN32(GetLastError());
     }
 
+    // Method Description:
+    // - Gets the pool of warm pseudoconsoles that every connection shares.
+    ::Microsoft::Terminal::TerminalConnection::PseudoConsolePool& ConptyConnection::_Pool()
+    {
+        return ::Microsoft::Terminal::TerminalConnection::PseudoConsolePool::Instance(
+            [](const COORD size, ::Microsoft::Terminal::TerminalConnection::PseudoConsolePool::Host& host) {
+                return _CreatePseudoConsoleAndHandles(size, 0, gsl::narrow<DWORD>(s_ReadSize), &host.input, &host.output, &host.hPC);
+            });
+    }
+
+    // Method Description:
+    // - Starts pseudoconsoles of the given size in the background, so that the
+    //      next connections to start can use them instead of waiting for conhost.
+    // Arguments:
+    // - rows, columns: the size that the next connections will probably be
+    void ConptyConnection::Prewarm(uint32_t rows, uint32_t columns)
+    {
+        _Pool().Prewarm({ gsl::narrow<SHORT>(columns), gsl::narrow<SHORT>(rows) });
+    }
+
     void ConptyConnection::_CreatePseudoConsole()
     {
         bool fSuccess;
 
-        COORD dimensions{_initialCols, _initialRows};
-        THROW_IF_FAILED(_CreatePseudoConsoleAndHandles(dimensions, 0, &_inPipe, &_outPipe, &_hPC));
+        // Use a host that's already started if there is one, and start another in
+        //      its place for the next connection.
+        COORD dimensions{ gsl::narrow<SHORT>(_initialCols), gsl::narrow<SHORT>(_initialRows) };
+        ::Microsoft::Terminal::TerminalConnection::PseudoConsolePool::Host host{};
+        if (_Pool().TryTake(dimensions, host))
+        {
+            _inPipe = host.input;
+            _outPipe = host.output;
+            _hPC = host.hPC;
+        }
+        else
+        {
+            THROW_IF_FAILED(_CreatePseudoConsoleAndHandles(dimensions, 0, gsl::narrow<DWORD>(s_ReadSize), &_inPipe, &_outPipe, &_hPC));
+        }
+        _Pool().Prewarm(dimensions);
 
         STARTUPINFOEX siEx;
         siEx = { 0 };
@@ -228,31 +289,37 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         return pInstance->_OutputThread();
     }
 
+    // Method Description:
+    // - Reads output from the pseudoconsole and passes it along to our handlers,
+    //   until the pseudoconsole goes away.
     DWORD ConptyConnection::_OutputThread()
     {
-        BYTE buffer[256];
-        DWORD dwRead;
-        while (true)
-        {
-            dwRead = 0;
-            bool fSuccess = false;
-
-            fSuccess = !!ReadFile(_outPipe, buffer, ARRAYSIZE(buffer), &dwRead, nullptr);
-
-            THROW_LAST_ERROR_IF(!fSuccess);
-
-            // Convert buffer to hstring
-            char* pchStr = (char*)(buffer);
-            std::string str{pchStr, dwRead};
-            auto hstr = winrt::to_hstring(str);
+        const auto hr = _outputReader.ReadPipe(_outPipe, [this](const std::string_view chunk) { _SendOutput(chunk); });
+        return SUCCEEDED(LOG_IF_FAILED(hr)) ? 0 : (DWORD)-1;
+    }
 
-            // Pass the output to our registered event handlers
-            _outputHandlers(hstr);
+    // Method Description:
+    // - Passes a chunk of output on to our handlers.
+    // Arguments:
+    // - chunk: the output, in UTF-8. Only valid for the duration of the call.
+    void ConptyConnection::_SendOutput(const std::string_view chunk)
+    {
+        // Lend the buffer itself to anyone who can take the output as it is.
+        const auto data = reinterpret_cast<const uint8_t*>(chunk.data());
+        if (_outputBufferHandlers)
+        {
+            _outputBufferHandlers(winrt::array_view<const uint8_t>{ data, data + chunk.size() });
+        }
 
-            // if (this->_active)
-            // {
-            //     _pfnReadCallback(buffer, dwRead);
-            // }
+        // Decode the chunk for everyone who wants a string. A read that only
+        // held the start of a character has nothing to pass along yet.
+        if (_outputHandlers)
+        {
+            const auto text = _outputReader.Decode(chunk);
+            if (!text.empty())
+            {
+                _outputHandlers(winrt::hstring{ text });
+            }
         }
     }
 }
@@ -4,6 +4,9 @@
 #pragma once
 
 #include "ConptyConnection.g.h"
+#include "InputPipeWriter.h"
+#include "OutputReader.h"
+#include "PseudoConsolePool.h"
 // Note that the ConptyConnection is no longer a part of this project
 // Until there's platform-level support for full-trust universal applications,
 // all ProcThreadAttribute things will be unusable. Unfortunately, this means
@@ -17,6 +20,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         winrt::event_token TerminalOutput(TerminalConnection::TerminalOutputEventArgs const& handler);
         void TerminalOutput(winrt::event_token const& token) noexcept;
+        winrt::event_token TerminalOutputBuffer(TerminalConnection::TerminalOutputBufferEventArgs const& handler);
+        void TerminalOutputBuffer(winrt::event_token const& token) noexcept;
         winrt::event_token TerminalDisconnected(TerminalConnection::TerminalDisconnectedEventArgs const& handler);
         void TerminalDisconnected(winrt::event_token const& token) noexcept;
         void Start();
@@ -24,8 +29,14 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         void Resize(uint32_t rows, uint32_t columns);
         void Close();
 
+        uint64_t BytesRead() const noexcept;
+        uint64_t ReadCount() const noexcept;
+
+        static void Prewarm(uint32_t rows, uint32_t columns);
+
     private:
         winrt::event<TerminalConnection::TerminalOutputEventArgs> _outputHandlers;
+        winrt::event<TerminalConnection::TerminalOutputBufferEventArgs> _outputBufferHandlers;
 
         uint32_t _initialRows;
         uint32_t _initialCols;
@@ -39,9 +50,19 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         HANDLE _hOutputThread;
         PROCESS_INFORMATION _piClient;
 
+        static constexpr size_t s_ReadSize = ::Microsoft::Terminal::TerminalConnection::OutputReader::DefaultReadSize;
+
+        // Reads the output off of _outPipe, on the output thread.
+        ::Microsoft::Terminal::TerminalConnection::OutputReader _outputReader;
+
+        // Input is written to _inPipe by this, off of the caller's thread.
+        std::unique_ptr<::Microsoft::Terminal::TerminalConnection::InputPipeWriter> _inputWriter;
+
         static DWORD WINAPI StaticOutputThreadProc(LPVOID lpParameter);
+        static ::Microsoft::Terminal::TerminalConnection::PseudoConsolePool& _Pool();
         void _CreatePseudoConsole();
         DWORD _OutputThread();
+        void _SendOutput(const std::string_view chunk);
     };
 }
 
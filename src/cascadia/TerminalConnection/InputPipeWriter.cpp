@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "InputPipeWriter.h"
+
+using namespace Microsoft::Terminal::TerminalConnection;
+
+// Method Description:
+// - Starts a writer for the given pipe.
+// Arguments:
+// - pipe: the pipe to write the input to. The writer doesn't own it, but it
+//      has to stay open until the writer is shut down.
+// Note: will throw exception if the thread can't be started
+InputPipeWriter::InputPipeWriter(const HANDLE pipe) :
+    _pipe{ pipe },
+    _lock{},
+    _pending{},
+    _shutdown{ false },
+    _inputAvailable{ wil::EventOptions::None },
+    _thread{}
+{
+    _thread = std::thread([this]() { _WriteLoop(); });
+}
+
+InputPipeWriter::~InputPipeWriter()
+{
+    Shutdown();
+}
+
+// Method Description:
+// - Queues up some input to be written to the pipe. It's converted to UTF-8,
+//      which is what the other end of the pipe expects. This never waits on
+//      the pipe, and it can be called from any thread.
+// Arguments:
+// - text: the input to write
+void InputPipeWriter::Write(const std::wstring_view text)
+{
+    if (text.empty() || _shutdown.load())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard{ _lock };
+
+        // No UTF-16 code unit takes more than three bytes of UTF-8.
+        const auto start = _pending.size();
+        _pending.resize(start + text.size() * 3);
+        const auto cch = WideCharToMultiByte(CP_UTF8,
+                                             0,
+                                             text.data(),
+                                             gsl::narrow<int>(text.size()),
+                                             _pending.data() + start,
+                                             gsl::narrow<int>(text.size() * 3),
+                                             nullptr,
+                                             nullptr);
+        _pending.resize(start + cch);
+    }
+
+    _inputAvailable.SetEvent();
+}
+
+// Method Description:
+// - Stops the writer once it's done with the write it's in the middle of, if
+//      any. Input that hasn't been written yet is dropped. If the write might
+//      be blocked on a pipe that nobody's reading anymore, break the pipe first
+//      (by ending the process on the other end of it), or this will wait on it.
+void InputPipeWriter::Shutdown() noexcept
+{
+    _shutdown.store(true);
+    _inputAvailable.SetEvent();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+// Method Description:
+// - The writer's thread. Takes everything that's been queued up since the last
+//      write and writes it all at once, until it's shut down.
+void InputPipeWriter::_WriteLoop()
+{
+    std::string writing;
+    while (!_shutdown.load())
+    {
+        _inputAvailable.wait();
+
+        {
+            // Swapping hands our empty buffer back to be filled, so neither side
+            //      has to allocate once both have grown big enough.
+            std::lock_guard<std::mutex> guard{ _lock };
+            writing.swap(_pending);
+        }
+
+        if (!writing.empty() && !_shutdown.load())
+        {
+            DWORD written = 0;
+            LOG_IF_WIN32_BOOL_FALSE(WriteFile(_pipe, writing.data(), gsl::narrow<DWORD>(writing.size()), &written, nullptr));
+        }
+        writing.clear();
+    }
+}
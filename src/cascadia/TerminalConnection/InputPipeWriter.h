@@ -0,0 +1,39 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+namespace Microsoft::Terminal::TerminalConnection
+{
+    class InputPipeWriter;
+}
+
+// Writes a connection's input to its pipe on a thread of its own, so that
+//      whoever sends the input (the UI thread, for a key press or a paste)
+//      never blocks on the pipe.
+// Input that's written while the thread is still busy with the last write, or
+//      before it's had a chance to wake up, is all merged into one write. Key
+//      repeat and the characters of a paste end up costing a handful of pipe
+//      writes instead of one each.
+class Microsoft::Terminal::TerminalConnection::InputPipeWriter final
+{
+public:
+    InputPipeWriter(const HANDLE pipe);
+    ~InputPipeWriter();
+
+    void Write(const std::wstring_view text);
+    void Shutdown() noexcept;
+
+private:
+    const HANDLE _pipe;
+
+    // the UTF-8 input waiting to be written, guarded by _lock.
+    std::mutex _lock;
+    std::string _pending;
+
+    std::atomic<bool> _shutdown;
+    wil::unique_event _inputAvailable;
+    std::thread _thread;
+
+    void _WriteLoop();
+};
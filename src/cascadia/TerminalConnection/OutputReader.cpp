@@ -0,0 +1,196 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "OutputReader.h"
+
+using namespace Microsoft::Terminal::TerminalConnection;
+using namespace Microsoft::Console::Types;
+
+// Method Description:
+// - Creates a reader, and the buffers it reads into.
+// Arguments:
+// - readSize: the most that's read at once, in bytes
+OutputReader::OutputReader(const size_t readSize) :
+    _buffers{},
+    _decoder{},
+    _bytesRead{ 0 },
+    _readCount{ 0 }
+{
+    for (auto& buffer : _buffers)
+    {
+        buffer.resize(readSize);
+    }
+}
+
+// Method Description:
+// - Reads the pipe until it's closed, handing each chunk to the callback. This
+//      returns once there's nothing more to read.
+// - The pipe must have been opened for overlapped I/O.
+// Arguments:
+// - pipe: the pipe to read. The reader doesn't own it.
+// - callback: gets each chunk, on this thread
+// Return Value:
+// - S_OK once the other end of the pipe has been closed, or a suitable HRESULT
+//      for failing to read from it. Closing the pipe from our end makes the
+//      read fail, which the caller should expect if that's what it did.
+[[nodiscard]]
+HRESULT OutputReader::ReadPipe(const HANDLE pipe, const Callback& callback) noexcept
+{
+    std::array<OVERLAPPED, 2> overlapped{};
+    std::array<wil::unique_event_nothrow, 2> events;
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        RETURN_IF_FAILED(events.at(i).create(wil::EventOptions::ManualReset));
+        overlapped.at(i).hEvent = events.at(i).get();
+    }
+
+    // Starts a read into the given buffer. Sets pending if there's a read to
+    //      wait for, which there isn't once the pipe is closed.
+    bool pending = false;
+    const auto startRead = [&](const size_t index) -> HRESULT {
+        auto& buffer = _buffers.at(index);
+        pending = true;
+        if (!ReadFile(pipe, buffer.data(), gsl::narrow<DWORD>(buffer.size()), nullptr, &overlapped.at(index)))
+        {
+            const auto error = GetLastError();
+            if (error == ERROR_BROKEN_PIPE)
+            {
+                pending = false;
+                return S_OK;
+            }
+            if (error != ERROR_IO_PENDING)
+            {
+                pending = false;
+                RETURN_WIN32(error);
+            }
+        }
+        return S_OK;
+    };
+
+    size_t current = 0;
+    RETURN_IF_FAILED(startRead(current));
+
+    // The buffers mustn't be touched again while the kernel may still be writing
+    //      into one of them.
+    auto cancelPendingRead = wil::scope_exit([&]() {
+        if (pending)
+        {
+            DWORD ignored = 0;
+            CancelIoEx(pipe, &overlapped.at(current));
+            GetOverlappedResult(pipe, &overlapped.at(current), &ignored, TRUE);
+        }
+    });
+
+    try
+    {
+        while (pending)
+        {
+            DWORD read = 0;
+            const bool success = !!GetOverlappedResult(pipe, &overlapped.at(current), &read, TRUE);
+            pending = false;
+            if (!success)
+            {
+                const auto error = GetLastError();
+                if (error == ERROR_BROKEN_PIPE)
+                {
+                    break;
+                }
+                RETURN_WIN32(error);
+            }
+
+            const auto completed = current;
+            current = 1 - current;
+            RETURN_IF_FAILED(startRead(current));
+
+            // The next read into this buffer doesn't start until the callback's
+            //      done with it.
+            _Deliver({ _buffers.at(completed).data(), read }, callback);
+        }
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Method Description:
+// - Drains the ring whenever it's written to, handing each chunk to the
+//      callback, until the ring's closed or the process writing into it exits.
+//      Whatever was written before the process exited is still handed over.
+// Arguments:
+// - ring: the ring to read
+// - process: the process that writes into the ring. It needs SYNCHRONIZE access.
+// - callback: gets each chunk, on this thread
+// Return Value:
+// - S_OK once the ring is closed, HRESULT_FROM_WIN32(ERROR_BROKEN_PIPE) once the
+//      process has exited, or a suitable HRESULT for failing to wait.
+[[nodiscard]]
+HRESULT OutputReader::ReadRing(SharedRing& ring, const HANDLE process, const Callback& callback) noexcept
+{
+    auto& buffer = _buffers.at(0);
+    const HANDLE waits[]{ ring.GetDataEvent(), process };
+    bool exited = false;
+    try
+    {
+        while (true)
+        {
+            const auto read = ring.Read(buffer.data(), buffer.size());
+            if (read != 0)
+            {
+                _Deliver({ buffer.data(), read }, callback);
+                continue;
+            }
+
+            if (ring.IsClosed())
+            {
+                return S_OK;
+            }
+            if (exited)
+            {
+                return HRESULT_FROM_WIN32(ERROR_BROKEN_PIPE);
+            }
+
+            const auto wait = WaitForMultipleObjects(ARRAYSIZE(waits), waits, FALSE, INFINITE);
+            RETURN_LAST_ERROR_IF(wait == WAIT_FAILED);
+
+            // Once the process is gone, go around once more to drain what's left.
+            exited = (wait == WAIT_OBJECT_0 + 1);
+        }
+    }
+    CATCH_RETURN();
+}
+
+// Method Description:
+// - Decodes a chunk of output into text, holding on to the start of any
+//      character that's cut off at the end until the next chunk completes it.
+//      Only the reading thread may call this, from its callback.
+// Arguments:
+// - chunk: the output, in UTF-8
+// Return Value:
+// - the text, which is only valid until the next call. It's empty if the
+//      chunk only held the start of a character.
+std::wstring_view OutputReader::Decode(const std::string_view chunk)
+{
+    return _decoder.Decode(chunk);
+}
+
+uint64_t OutputReader::BytesRead() const noexcept
+{
+    return _bytesRead.load(std::memory_order_relaxed);
+}
+
+uint64_t OutputReader::ReadCount() const noexcept
+{
+    return _readCount.load(std::memory_order_relaxed);
+}
+
+void OutputReader::_Deliver(const std::string_view chunk, const Callback& callback)
+{
+    _bytesRead.fetch_add(chunk.size(), std::memory_order_relaxed);
+    _readCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (!chunk.empty())
+    {
+        callback(chunk);
+    }
+}
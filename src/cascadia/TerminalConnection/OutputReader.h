@@ -0,0 +1,52 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "../../types/inc/SharedRing.hpp"
+#include "../../types/inc/Utf8Decoder.hpp"
+
+namespace Microsoft::Terminal::TerminalConnection
+{
+    class OutputReader;
+}
+
+// Reads a connection's output, for whichever thread the connection drains its
+//      host on. Every connection reads the same way, whatever it's attached to:
+//   * A pipe is read with overlapped reads into two buffers. As soon as one read
+//      completes, the next one is started in the other buffer, and only then is
+//      the completed chunk handed over. The pipe keeps draining while the
+//      Terminal is busy with the last chunk.
+//   * A SharedRing is drained into the same buffers whenever it's written to.
+// The buffers are allocated once, and reused for every read. Decode turns the
+//      chunks back into text as they arrive, even when a character is split
+//      between two of them.
+class Microsoft::Terminal::TerminalConnection::OutputReader final
+{
+public:
+    static constexpr size_t DefaultReadSize = 64 * 1024;
+
+    // Gets each chunk of output, in UTF-8. The chunk is only valid for the
+    //      duration of the call.
+    using Callback = std::function<void(const std::string_view chunk)>;
+
+    OutputReader(const size_t readSize = DefaultReadSize);
+
+    [[nodiscard]] HRESULT ReadPipe(const HANDLE pipe, const Callback& callback) noexcept;
+    [[nodiscard]] HRESULT ReadRing(::Microsoft::Console::Types::SharedRing& ring, const HANDLE process, const Callback& callback) noexcept;
+
+    std::wstring_view Decode(const std::string_view chunk);
+
+    uint64_t BytesRead() const noexcept;
+    uint64_t ReadCount() const noexcept;
+
+private:
+    std::array<std::string, 2> _buffers;
+    ::Microsoft::Console::Types::Utf8Decoder _decoder;
+
+    // Only the reading thread moves these, but anyone may read them.
+    std::atomic<uint64_t> _bytesRead;
+    std::atomic<uint64_t> _readCount;
+
+    void _Deliver(const std::string_view chunk, const Callback& callback);
+};
@@ -0,0 +1,126 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "PseudoConsolePool.h"
+
+using namespace ::Microsoft::Terminal::TerminalConnection;
+
+PseudoConsolePool::PseudoConsolePool(Factory factory) :
+    _factory{ std::move(factory) },
+    _lock{},
+    _hosts{},
+    _warming{ 0 }
+{
+}
+
+// Method Description:
+// - Gets the pool that's shared by every connection in the process.
+// - It's never destroyed: hosts may still be being started in the background
+//      when the process exits, and any that are left over go away along with
+//      their pipes.
+// Arguments:
+// - factory: how to create a host. Only used the first time this is called.
+// Return Value:
+// - the pool
+PseudoConsolePool& PseudoConsolePool::Instance(Factory factory)
+{
+    static PseudoConsolePool* const s_pool = new PseudoConsolePool(std::move(factory));
+    return *s_pool;
+}
+
+// Method Description:
+// - Takes a warm host out of the pool, and resizes it if it was started at a
+//      different size.
+// Arguments:
+// - size: the size the host should be
+// - host: receives the host. The caller owns it, and its pipes, from here on.
+// Return Value:
+// - true if there was a host to take. If there wasn't, the caller has to
+//      create one itself.
+bool PseudoConsolePool::TryTake(const COORD size, Host& host) noexcept
+{
+    {
+        std::lock_guard<std::mutex> guard{ _lock };
+        if (_hosts.empty())
+        {
+            return false;
+        }
+
+        host = _hosts.front();
+        _hosts.pop_front();
+    }
+
+    if (host.size.X != size.X || host.size.Y != size.Y)
+    {
+        if (FAILED(LOG_IF_FAILED(ResizePseudoConsole(host.hPC, size))))
+        {
+            ClosePseudoConsole(host.hPC);
+            CloseHandle(host.input);
+            CloseHandle(host.output);
+            return false;
+        }
+        host.size = size;
+    }
+
+    return true;
+}
+
+// Method Description:
+// - Starts enough hosts in the background to fill the pool back up. This
+//      returns right away.
+// Arguments:
+// - size: the size to start them at. This should be the size the next tab
+//      is likely to be, usually the size of the one that was just opened.
+void PseudoConsolePool::Prewarm(const COORD size)
+{
+    size_t needed = 0;
+    {
+        std::lock_guard<std::mutex> guard{ _lock };
+        const auto have = _hosts.size() + _warming;
+        needed = have < s_Capacity ? s_Capacity - have : 0;
+        _warming += needed;
+    }
+
+    for (size_t i = 0; i < needed; ++i)
+    {
+        try
+        {
+            std::thread([this, size]() { _Warm(size); }).detach();
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            std::lock_guard<std::mutex> guard{ _lock };
+            --_warming;
+        }
+    }
+}
+
+// Method Description:
+// - Starts one host, and puts it into the pool.
+// Arguments:
+// - size: the size to start it at
+void PseudoConsolePool::_Warm(const COORD size) noexcept
+{
+    Host host{};
+    const auto hr = LOG_IF_FAILED(_factory(size, host));
+
+    std::lock_guard<std::mutex> guard{ _lock };
+    --_warming;
+    if (SUCCEEDED(hr))
+    {
+        host.size = size;
+        try
+        {
+            _hosts.push_back(host);
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            ClosePseudoConsole(host.hPC);
+            CloseHandle(host.input);
+            CloseHandle(host.output);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+namespace Microsoft::Terminal::TerminalConnection
+{
+    class PseudoConsolePool;
+}
+
+// Keeps a few pseudoconsoles started ahead of time, so that opening a tab only
+//      has to start the client, and not conhost as well. Creating the host is
+//      most of the time it takes to open a tab, especially on machines that
+//      scan every process that's started.
+// A host that was warmed up for a different size is resized when it's taken,
+//      which is far quicker than starting a new one.
+// Like the ConptyConnection that uses it, this isn't a part of the project
+//      until the pseudoconsole APIs can be used from a universal application.
+class Microsoft::Terminal::TerminalConnection::PseudoConsolePool final
+{
+public:
+    struct Host
+    {
+        HPCON hPC;
+        HANDLE input;  // the pipe for writing input to
+        HANDLE output; // the pipe for reading output from
+        COORD size;
+    };
+
+    // Creates a new host of the given size, with all of its pipes.
+    using Factory = std::function<HRESULT(const COORD size, Host& host)>;
+
+    static PseudoConsolePool& Instance(Factory factory);
+
+    bool TryTake(const COORD size, Host& host) noexcept;
+    void Prewarm(const COORD size);
+
+private:
+    PseudoConsolePool(Factory factory);
+
+    static constexpr size_t s_Capacity = 2;
+
+    const Factory _factory;
+
+    // the warm hosts, and the number that are being started, guarded by _lock.
+    std::mutex _lock;
+    std::deque<Host> _hosts;
+    size_t _warming;
+
+    void _Warm(const COORD size) noexcept;
+};
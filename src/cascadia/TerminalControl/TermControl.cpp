@@ -9,6 +9,8 @@
 #include <Utf16Parser.hpp>
 #include <WinUser.h>
 #include "..\..\types\inc\GlyphWidth.hpp"
+#include "..\..\renderer\base\InputLatency.hpp"
+#include "..\..\renderer\base\SharedRenderThread.hpp"
 
 #include "TermControl.g.cpp"
 
@@ -19,8 +21,43 @@ using namespace winrt::Windows::UI::Core;
 using namespace winrt::Windows::System;
 using namespace winrt::Microsoft::Terminal::Settings;
 
+// Note: Generate GUID using TlgGuid.exe tool
+TRACELOGGING_DEFINE_PROVIDER(
+    g_hTerminalControlProvider,
+    "Microsoft.Windows.Terminal.Control",
+    // {28c82e50-57af-5a86-c25b-e39cd990032b}
+    (0x28c82e50, 0x57af, 0x5a86, 0xc2, 0x5b, 0xe3, 0x9c, 0xd9, 0x90, 0x03, 0x2b));
+
+namespace
+{
+    // The provider stays registered for as long as there's a TermControl around.
+    std::mutex s_providerLock;
+    size_t s_providerUsers = 0;
+
+    void _AddProviderUser()
+    {
+        std::lock_guard<std::mutex> guard{ s_providerLock };
+        if (s_providerUsers++ == 0)
+        {
+            TraceLoggingRegister(g_hTerminalControlProvider);
+        }
+    }
+
+    void _RemoveProviderUser()
+    {
+        std::lock_guard<std::mutex> guard{ s_providerLock };
+        if (--s_providerUsers == 0)
+        {
+            TraceLoggingUnregister(g_hTerminalControlProvider);
+        }
+    }
+}
+
 namespace winrt::Microsoft::Terminal::TerminalControl::implementation
 {
+    std::optional<DispatcherTimer> TermControl::s_cursorTimer{};
+    std::vector<TermControl*> TermControl::s_blinkingControls{};
+    bool TermControl::s_windowActive{ true };
 
     TermControl::TermControl() :
         TermControl(Settings::TerminalSettings{})
@@ -28,20 +65,50 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     }
 
     TermControl::TermControl(Settings::IControlSettings settings) :
-        _connection{ TerminalConnection::ConhostConnection(winrt::to_hstring("cmd.exe"), winrt::hstring(), 30, 80, winrt::guid()) },
+        TermControl(settings, nullptr, nullptr)
+    {
+    }
+
+    // Method Description:
+    // - Makes a control that shows the given terminal in a view of its own (see
+    //   CreateView), or, without a terminal, one that makes its own terminal and
+    //   connection from the settings.
+    // Arguments:
+    // - settings: the settings for this control
+    // - terminal: the terminal to show, or nullptr
+    // - connection: the connection the terminal's attached to, if there's a terminal
+    TermControl::TermControl(Settings::IControlSettings settings,
+                             std::shared_ptr<::Microsoft::Terminal::Core::Terminal> terminal,
+                             TerminalConnection::ITerminalConnection connection) :
+        _connection{ terminal ? connection : TerminalConnection::ConhostConnection(winrt::to_hstring("cmd.exe"), winrt::hstring(), 30, 80, winrt::guid()) },
+        _terminal{ terminal },
+        _secondaryView{ terminal ? std::make_unique<::Microsoft::Terminal::Core::TerminalView>(*terminal) : nullptr },
+        _view{ _secondaryView.get() },
         _initializedTerminal{ false },
         _root{ nullptr },
         _controlRoot{ nullptr },
         _swapChainPanel{ nullptr },
         _settings{ settings },
         _closing{ false },
+        _inBackground{ false },
         _lastScrollOffset{ std::nullopt },
         _desiredFont{ DEFAULT_FONT_FACE.c_str(), 0, 10, { 0, DEFAULT_FONT_SIZE }, CP_UTF8 },
         _actualFont{ DEFAULT_FONT_FACE.c_str(), 0, 10, { 0, DEFAULT_FONT_SIZE }, CP_UTF8, false },
         _touchAnchor{ std::nullopt },
         _leadingSurrogate{},
-        _cursorTimer{}
+        _countersTimer{ nullptr },
+        _connectionCounters{ nullptr },
+        _lastBytesRead{ 0 },
+        _lastReadCount{ 0 },
+        _lastWriteLockWaitTime{ 0 },
+        _selectionUpdateTimer{ nullptr },
+        _pendingSelectionEnd{ std::nullopt },
+        _resizeTimer{ nullptr },
+        _pendingResize{ std::nullopt },
+        _appliedSize{ 0, 0 },
+        _predictedEchoTimer{ nullptr }
     {
+        _AddProviderUser();
         _Create();
     }
 
@@ -99,7 +166,12 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         _controlRoot.Content(_root);
 
         _ApplyUISettings();
-        _ApplyConnectionSettings();
+        _ApplyFontSettings();
+        // A view uses the connection of the control it was made from.
+        if (!_secondaryView)
+        {
+            _ApplyConnectionSettings();
+        }
 
         // These are important:
         // 1. When we get tapped, focus us
@@ -122,32 +194,60 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
 
     // Method Description:
     // - Given new settings for this profile, applies the settings to the current terminal.
+    // - Only what's changed since the last settings is reapplied. The font, and
+    //   with it the glyphs and the size of the buffer, is only recreated if the
+    //   font's face or size changed. Otherwise (say, only the colors changed),
+    //   the terminal's just repainted with the new values.
+    // - The settings are applied at a low priority, so that when every control
+    //   is updated at once, input and painting still go ahead of them.
     // Arguments:
     // - newSettings: New settings values for the profile in this terminal.
     // Return Value:
     // - <none>
     void TermControl::UpdateSettings(Settings::IControlSettings newSettings)
     {
+        const auto oldSettings = _settings;
         _settings = newSettings;
 
         // Dispatch a call to the UI thread to apply the new settings to the
         // terminal.
-        _root.Dispatcher().RunAsync(CoreDispatcherPriority::Normal,[this](){
-            // Update our control settings
+        _root.Dispatcher().RunAsync(CoreDispatcherPriority::Low, [this, oldSettings]() {
+            if (_closing)
+            {
+                return;
+            }
+
+            const bool fontChanged = oldSettings.FontFace() != _settings.FontFace() ||
+                                     oldSettings.FontSize() != _settings.FontSize();
+
+            // Update our control settings. A change in padding resizes the
+            //      _swapChainPanel, which resizes the buffer on its own.
             _ApplyUISettings();
-            // Update the terminal core with its new Core settings
-            _terminal->UpdateSettings(_settings);
+
+            // Update the terminal core with its new Core settings. It's the
+            //      control that made the terminal that keeps it up to date.
+            if (!_secondaryView)
+            {
+                auto lock = _terminal->LockForWriting();
+                _terminal->UpdateSettings(_settings);
+            }
+
+            if (!fontChanged)
+            {
+                _renderer->TriggerRedrawAll();
+                return;
+            }
 
             // Refresh our font with the renderer
+            _ApplyFontSettings();
             _UpdateFont();
 
             const auto width = _swapChainPanel.ActualWidth();
             const auto height = _swapChainPanel.ActualHeight();
             if (width != 0 && height != 0)
             {
-                // If the font size changed, or the _swapchainPanel's size changed
-                // for any reason, we'll need to make sure to also resize the
-                // buffer. _DoResize will invalidate everything for us.
+                // The font size changed, so we'll need to make sure to also
+                // resize the buffer. _DoResize will invalidate everything for us.
                 auto lock = _terminal->LockForWriting();
                 _DoResize(width, height);
             }
@@ -202,7 +302,17 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         // Apply padding to the root Grid
         auto thickness = _ParseThicknessFromPadding(_settings.Padding());
         _root.Padding(thickness);
+    }
 
+    // Method Description:
+    // - Set up the font the renderer should look for from the values in our
+    //   _settings. The font itself is only looked up by _UpdateFont.
+    // Arguments:
+    // - <none>
+    // Return Value:
+    // - <none>
+    void TermControl::_ApplyFontSettings()
+    {
         // Initialize our font information.
         const auto* fontFace = _settings.FontFace().c_str();
         const short fontHeight = gsl::narrow<short>(_settings.FontSize());
@@ -229,19 +339,67 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     TermControl::~TermControl()
     {
         _closing = true;
+
+        _StopBlinking();
+
+        if (_countersTimer)
+        {
+            _countersTimer.Stop();
+        }
+
+        if (_selectionUpdateTimer)
+        {
+            _selectionUpdateTimer.Stop();
+        }
+
+        if (_resizeTimer)
+        {
+            _resizeTimer.Stop();
+        }
+
+        if (_predictedEchoTimer)
+        {
+            _predictedEchoTimer.Stop();
+        }
+
+        // The parse worker might be waiting on the lock, so stop it before we take it.
+        if (_parseWorker)
+        {
+            _parseWorker->Shutdown();
+        }
+
         // Don't let anyone else do something to the buffer.
         auto lock = _terminal->LockForWriting();
 
-        if (_connection != nullptr)
+        if (_secondaryView)
+        {
+            // The session carries on in the control this view was made from.
+            //      Our renderer just stops hearing about it.
+            _secondaryView->Detach();
+        }
+        else
         {
-            _connection.Close();
+            // Any views of the terminal outlive us, so it mustn't call back
+            //      into this control anymore.
+            _terminal->SetWriteInputCallback(nullptr);
+            _terminal->SetTitleChangedCallback(nullptr);
+            _view->SetScrollPositionChangedCallback(nullptr);
+            _view->Detach();
+
+            if (_connection != nullptr)
+            {
+                _connection.Close();
+            }
         }
 
         _renderer->TriggerTeardown();
 
         _swapChainPanel = nullptr;
         _root = nullptr;
+        _connectionCounters = nullptr;
         _connection = nullptr;
+
+        _RemoveProviderUser();
     }
 
     UIElement TermControl::GetRoot()
@@ -277,17 +435,31 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
             return;
         }
 
+        const auto initializeStart = std::chrono::steady_clock::now();
+
         const auto windowWidth = _swapChainPanel.ActualWidth();  // Width() and Height() are NaN?
         const auto windowHeight = _swapChainPanel.ActualHeight();
 
-        _terminal = std::make_unique<::Microsoft::Terminal::Core::Terminal>();
+        // A view shares the terminal it was made for, and everything that feeds it.
+        const bool isView = _secondaryView != nullptr;
+        if (!isView)
+        {
+            _terminal = std::make_shared<::Microsoft::Terminal::Core::Terminal>();
+            _view = &_terminal->GetPrimaryView();
+        }
 
-        // First create the render thread.
-        auto renderThread = std::make_unique<::Microsoft::Console::Render::RenderThread>();
+        // First create the render thread. Every control in the process paints on
+        //      the same few threads, rather than each having one of its own.
+        auto renderThread = std::make_unique<::Microsoft::Console::Render::SharedRenderThread>();
+        renderThread->SetMaxFrameRate(_settings.MaxFrameRate());
         // Stash a local pointer to the render thread, so we can enable it after
         //       we hand off ownership to the renderer.
         auto* const localPointerToThread = renderThread.get();
-        _renderer = std::make_unique<::Microsoft::Console::Render::Renderer>(_terminal.get(), nullptr, 0, std::move(renderThread));
+        _renderer = std::make_unique<::Microsoft::Console::Render::Renderer>(_view, nullptr, 0, std::move(renderThread));
+
+        // Paint from a copy of the terminal, so that painting doesn't hold up output.
+        _renderFrame = std::make_unique<::Microsoft::Terminal::Core::TerminalRenderFrame>(*_terminal, *_view);
+        _renderer->SetFrameData(_renderFrame.get());
         ::Microsoft::Console::Render::IRenderTarget& renderTarget = *_renderer;
 
         // Set up the DX Engine
@@ -314,13 +486,28 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         const auto vp = dxEngine->GetViewportInCharacters(viewInPixels);
         const auto width = vp.Width();
         const auto height = vp.Height();
-        _connection.Resize(height, width);
 
-        // Override the default width and height to match the size of the swapChainPanel
-        _settings.InitialCols(width);
-        _settings.InitialRows(height);
+        auto pfnScrollPositionChanged = std::bind(&TermControl::_TerminalScrollPositionChanged, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+        if (isView)
+        {
+            // The terminal's already running, so this has to be done under its lock.
+            //      The terminal keeps the width the connection was sized for, but
+            //      the view can be as tall as we are.
+            auto lock = _terminal->LockForWriting();
+            _secondaryView->Attach(renderTarget);
+            _secondaryView->SetScrollPositionChangedCallback(pfnScrollPositionChanged);
+            _secondaryView->SetViewHeight(height);
+        }
+        else
+        {
+            _connection.Resize(height, width);
+
+            // Override the default width and height to match the size of the swapChainPanel
+            _settings.InitialCols(width);
+            _settings.InitialRows(height);
 
-        _terminal->CreateFromSettings(_settings, renderTarget);
+            _terminal->CreateFromSettings(_settings, renderTarget);
+        }
 
         // Tell the DX Engine to notify us when the swap chain changes.
         dxEngine->SetCallback(std::bind(&TermControl::SwapChainChanged, this));
@@ -328,17 +515,77 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         THROW_IF_FAILED(dxEngine->Enable());
         _renderEngine = std::move(dxEngine);
 
-        auto onRecieveOutputFn = [this](const hstring str) {
-            _terminal->Write(str.c_str());
-        };
-        _connectionOutputEventToken = _connection.TerminalOutput(onRecieveOutputFn);
+        // Don't hold up the connection's reader while the output is parsed - hand it
+        //      over to the parse worker and let it go back to reading. Output's only
+        //      parsed once, by the control that made the terminal, whatever views
+        //      there are of it.
+        if (!isView)
+        {
+            _parseWorker = std::make_unique<::Microsoft::Terminal::Core::TerminalParseWorker>(*_terminal);
+            if (const auto buffered = _connection.try_as<TerminalConnection::IBufferedTerminalConnection>())
+            {
+                // The connection only lends us its buffer, and the worker copies it into
+                //      a slot of its own, so there's no conversion and nothing to allocate.
+                auto onRecieveOutputFn = [this](const winrt::array_view<const uint8_t> output) {
+                    _parseWorker->Enqueue(std::string_view{ reinterpret_cast<const char*>(output.data()), output.size() });
+                };
+                _connectionOutputEventToken = buffered.TerminalOutputBuffer(onRecieveOutputFn);
+            }
+            else
+            {
+                auto onRecieveOutputFn = [this](const hstring str) {
+                    _parseWorker->Enqueue(std::wstring{ str });
+                };
+                _connectionOutputEventToken = _connection.TerminalOutput(onRecieveOutputFn);
+            }
+
+            _connectionCounters = _connection.try_as<TerminalConnection::IConnectionCounters>();
+            _countersTimer = DispatcherTimer();
+            _countersTimer.Interval(s_CountersInterval);
+            _countersTimer.Tick({ this, &TermControl::_TraceCounters });
+            _countersTimer.Start();
+        }
+
+        _selectionUpdateTimer = DispatcherTimer();
+        _selectionUpdateTimer.Interval(s_SelectionUpdateInterval);
+        _selectionUpdateTimer.Tick({ this, &TermControl::_SelectionUpdateTick });
 
-        auto inputFn = std::bind(&TermControl::_SendInputToConnection, this, std::placeholders::_1);
-        _terminal->SetWriteInputCallback(inputFn);
+        _resizeTimer = DispatcherTimer();
+        _resizeTimer.Interval(s_ResizeInterval);
+        _resizeTimer.Tick({ this, &TermControl::_ResizeTick });
+
+        _predictedEchoTimer = DispatcherTimer();
+        _predictedEchoTimer.Interval(s_PredictedEchoInterval);
+        _predictedEchoTimer.Tick({ this, &TermControl::_PredictedEchoTick });
 
         THROW_IF_FAILED(localPointerToThread->Initialize(_renderer.get()));
 
+        // Input from every view goes out through the control that made the
+        //      terminal, and only it hears about the title changing.
+        if (!isView)
+        {
+            auto inputFn = std::bind(&TermControl::_SendInputToConnection, this, std::placeholders::_1);
+            _terminal->SetWriteInputCallback(inputFn);
+
+            auto pfnTitleChanged = std::bind(&TermControl::_TerminalTitleChanged, this, std::placeholders::_1);
+            _terminal->SetTitleChangedCallback(pfnTitleChanged);
+
+            _view->SetScrollPositionChangedCallback(pfnScrollPositionChanged);
+        }
+
+        // Start the connection as soon as there's somewhere for its output to go,
+        //      so that the client starts up while we make the swap chain and
+        //      finish setting up the control. Nothing's painted until the end.
+        const auto connectionStart = std::chrono::steady_clock::now();
+        if (!isView)
+        {
+            _connection.Start();
+        }
+        const auto connectionStarted = std::chrono::steady_clock::now();
+
         auto chain = _renderEngine->GetSwapChain();
+        const auto swapChainCreated = std::chrono::steady_clock::now();
+
         _swapChainPanel.Dispatcher().RunAsync(CoreDispatcherPriority::High, [this, chain]()
         {
             _terminal->LockConsole();
@@ -348,7 +595,7 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         });
 
         // Set up the height of the ScrollViewer and the grid we're using to fake our scrolling height
-        auto bottom = _terminal->GetViewport().BottomExclusive();
+        auto bottom = _view->GetViewport().BottomExclusive();
         auto bufferHeight = bottom;
 
         const auto originalMaximum = _scrollBar.Maximum();
@@ -403,25 +650,18 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         _controlRoot.PreviewKeyDown({this, &TermControl::_KeyDownHandler });
         _controlRoot.CharacterReceived({this, &TermControl::_CharacterHandler });
 
-        auto pfnTitleChanged = std::bind(&TermControl::_TerminalTitleChanged, this, std::placeholders::_1);
-        _terminal->SetTitleChangedCallback(pfnTitleChanged);
-
-        auto pfnScrollPositionChanged = std::bind(&TermControl::_TerminalScrollPositionChanged, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
-        _terminal->SetScrollPositionChangedCallback(pfnScrollPositionChanged);
-
-        // Set up blinking cursor
-        int blinkTime = GetCaretBlinkTime();
-        if (blinkTime != INFINITE)
-        {
-            // Create a timer
-            _cursorTimer = std::make_optional(DispatcherTimer());
-            _cursorTimer.value().Interval(std::chrono::milliseconds(blinkTime));
-            _cursorTimer.value().Tick({ this, &TermControl::_BlinkCursor });
-        }
-        else
+        // Set up blinking cursor. The first control to get here creates the timer
+        //      that all of them share. If the user has disabled cursor blinking,
+        //      there's no timer at all.
+        if (!s_cursorTimer.has_value())
         {
-            // The user has disabled cursor blinking
-            _cursorTimer = std::nullopt;
+            int blinkTime = GetCaretBlinkTime();
+            if (blinkTime != INFINITE)
+            {
+                s_cursorTimer = std::make_optional(DispatcherTimer());
+                s_cursorTimer.value().Interval(std::chrono::milliseconds(blinkTime));
+                s_cursorTimer.value().Tick(&TermControl::s_BlinkCursors);
+            }
         }
 
         _controlRoot.GotFocus({ this, &TermControl::_GotFocusHandler });
@@ -433,8 +673,25 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         //      becomes a no-op.
         _controlRoot.Focus(FocusState::Programmatic);
 
-        _connection.Start();
         _initializedTerminal = true;
+
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        TraceLoggingWrite(
+            g_hTerminalControlProvider,
+            "TerminalInitialized",
+            TraceLoggingDescription("How long it took to get the control ready, after it was first laid out"),
+            TraceLoggingUInt64(duration_cast<microseconds>(std::chrono::steady_clock::now() - initializeStart).count(), "InitializeMicroseconds", "Time spent in all"),
+            TraceLoggingUInt64(duration_cast<microseconds>(connectionStarted - connectionStart).count(), "ConnectionStartMicroseconds", "Time spent starting the connection"),
+            TraceLoggingUInt64(duration_cast<microseconds>(swapChainCreated - connectionStarted).count(), "SwapChainMicroseconds", "Time spent making the swap chain, and the device if it wasn't made yet"),
+            TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE));
+
+        // It might have been sent to the background before it was ever shown.
+        if (_inBackground)
+        {
+            _inBackground = false;
+            SetInBackground(true);
+        }
     }
 
     void TermControl::_CharacterHandler(winrt::Windows::Foundation::IInspectable const& /*sender*/,
@@ -463,6 +720,7 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
                 // we already were storing a leading surrogate but we got another one. Go ahead and send the
                 // saved surrogate piece and save the new one
                 auto hstr = to_hstring(_leadingSurrogate.value());
+                _terminal->RecordInput(hstr);
                 _connection.WriteInput(hstr);
             }
             // save the leading portion of a surrogate pair so that they can be sent at the same time
@@ -476,14 +734,31 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
             wstr.push_back(ch);
             _leadingSurrogate.reset();
 
+            _terminal->ResetPredictedEcho();
             auto hstr = to_hstring(wstr.c_str());
+            _terminal->RecordInput(hstr);
             _connection.WriteInput(hstr);
         }
         else
         {
+            // Draw the character before it's sent, so that its echo can't beat us to it.
+            if (_terminal->PredictEcho(ch))
+            {
+                if (!_predictedEchoTimer.IsEnabled())
+                {
+                    _predictedEchoTimer.Start();
+                }
+            }
+            else if (!::Microsoft::Terminal::Core::TerminalPredictiveEcho::s_IsPredictable(ch))
+            {
+                _terminal->ResetPredictedEcho();
+            }
+
             auto hstr = to_hstring(ch);
+            _terminal->RecordInput(hstr);
             _connection.WriteInput(hstr);
         }
+        ::Microsoft::Console::Render::InputLatency::Mark(::Microsoft::Console::Render::LatencyStage::InputSent);
         e.Handled(true);
     }
 
@@ -503,6 +778,8 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
             return;
         }
 
+        ::Microsoft::Console::Render::InputLatency::InputArrived(::Microsoft::Console::Render::LatencyStage::KeyReceived);
+
         auto modifiers = _GetPressedModifierKeys();
 
         const auto vkey = static_cast<WORD>(e.OriginalKey());
@@ -517,21 +794,21 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
 
         if (!handled)
         {
-            _terminal->ClearSelection();
+            _view->ClearSelection();
             // If the terminal translated the key, mark the event as handled.
             // This will prevent the system from trying to get the character out
             // of it and sending us a CharacterRecieved event.
-            handled = _terminal->SendKeyEvent(vkey,
-                                              WI_IsFlagSet(modifiers, KeyModifiers::Ctrl),
-                                              WI_IsFlagSet(modifiers, KeyModifiers::Alt),
-                                              WI_IsFlagSet(modifiers, KeyModifiers::Shift));
+            handled = _view->SendKeyEvent(vkey,
+                                          WI_IsFlagSet(modifiers, KeyModifiers::Ctrl),
+                                          WI_IsFlagSet(modifiers, KeyModifiers::Alt),
+                                          WI_IsFlagSet(modifiers, KeyModifiers::Shift));
 
-            if (_cursorTimer.has_value())
+            if (s_cursorTimer.has_value())
             {
                 // Manually show the cursor when a key is pressed. Restarting
                 // the timer prevents flickering.
                 _terminal->SetCursorVisible(true);
-                _cursorTimer.value().Start();
+                s_UpdateCursorTimer();
             }
         }
 
@@ -569,27 +846,31 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
                 const auto cursorPosition = point.Position();
                 const auto terminalPosition = _GetTerminalPosition(cursorPosition);
 
+                // A move from the selection before this one mustn't end up on this one.
+                _pendingSelectionEnd = std::nullopt;
+
                 // save location before rendering
-                _terminal->SetSelectionAnchor(terminalPosition);
+                _view->SetSelectionAnchor(terminalPosition);
 
                 // handle ALT key
-                _terminal->SetBoxSelection(altEnabled);
+                _view->SetBoxSelection(altEnabled);
 
                 _renderer->TriggerSelection();
             }
             else if (point.Properties().IsRightButtonPressed())
             {
                 // copy selection, if one exists
-                if (_terminal->IsSelectionActive())
+                _ApplyPendingSelectionEnd();
+                if (_view->IsSelectionActive())
                 {
                     CopySelectionToClipboard(!shiftEnabled);
                 }
                 // paste selection, otherwise
                 else
                 {
-                    // attach TermControl::_SendInputToConnection() as the clipboardDataHandler.
+                    // attach TermControl::_SendPastedTextToConnection() as the clipboardDataHandler.
                     // This is called when the clipboard data is loaded.
-                    auto clipboardDataHandler = std::bind(&TermControl::_SendInputToConnection, this, std::placeholders::_1);
+                    auto clipboardDataHandler = std::bind(&TermControl::_SendPastedTextToConnection, this, std::placeholders::_1);
                     auto pasteArgs = winrt::make_self<PasteFromClipboardEventArgs>(clipboardDataHandler);
 
                     // send paste event up to TermApp
@@ -625,9 +906,15 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
                 const auto cursorPosition = point.Position();
                 const auto terminalPosition = _GetTerminalPosition(cursorPosition);
 
-                // save location (for rendering) + render
-                _terminal->SetEndSelectionPosition(terminalPosition);
-                _renderer->TriggerSelection();
+                // save location (for rendering) + render. The first move
+                //      after a pause is applied right away, and the ones after
+                //      it only once a frame, with wherever the mouse is by then.
+                _pendingSelectionEnd = terminalPosition;
+                if (!_selectionUpdateTimer.IsEnabled())
+                {
+                    _ApplyPendingSelectionEnd();
+                    _selectionUpdateTimer.Start();
+                }
             }
         }
         else if (ptr.PointerDeviceType() == Windows::Devices::Input::PointerDeviceType::Touch && _touchAnchor)
@@ -678,7 +965,13 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     {
         const auto ptr = args.Pointer();
 
-        if (ptr.PointerDeviceType() == Windows::Devices::Input::PointerDeviceType::Touch)
+        if (ptr.PointerDeviceType() == Windows::Devices::Input::PointerDeviceType::Mouse)
+        {
+            // The selection ends where the button was let go, not where it
+            //      was a frame ago.
+            _ApplyPendingSelectionEnd();
+        }
+        else if (ptr.PointerDeviceType() == Windows::Devices::Input::PointerDeviceType::Touch)
         {
             _touchAnchor = std::nullopt;
         }
@@ -686,6 +979,55 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         args.Handled(true);
     }
 
+    // Method Description:
+    // - Applies the latest position the mouse was dragged to since the last
+    //      tick, if it's moved at all. Once it stops moving, the timer is
+    //      stopped until it moves again.
+    // Arguments:
+    // - sender: not used
+    // - e: not used
+    void TermControl::_SelectionUpdateTick(Windows::Foundation::IInspectable const& /* sender */,
+                                           Windows::Foundation::IInspectable const& /* e */)
+    {
+        if (_pendingSelectionEnd.has_value() && !_closing)
+        {
+            _ApplyPendingSelectionEnd();
+        }
+        else
+        {
+            _selectionUpdateTimer.Stop();
+        }
+    }
+
+    // Method Description:
+    // - Rolls back the echoes that were predicted too long ago to still be
+    //      coming. Once none are left, the timer is stopped until the next
+    //      prediction.
+    // Arguments:
+    // - sender: not used
+    // - e: not used
+    void TermControl::_PredictedEchoTick(Windows::Foundation::IInspectable const& /* sender */,
+                                         Windows::Foundation::IInspectable const& /* e */)
+    {
+        if (_closing || !_terminal->ExpirePredictedEcho())
+        {
+            _predictedEchoTimer.Stop();
+        }
+    }
+
+    // Method Description:
+    // - Moves the end of the selection to where the mouse was last dragged, if
+    //      that hasn't been done yet, and has the renderer paint it.
+    void TermControl::_ApplyPendingSelectionEnd()
+    {
+        if (_pendingSelectionEnd.has_value())
+        {
+            _view->SetEndSelectionPosition(_pendingSelectionEnd.value());
+            _renderer->TriggerSelection();
+            _pendingSelectionEnd = std::nullopt;
+        }
+    }
+
     // Method Description:
     // - Event handler for the PointerWheelChanged event. This is raised in
     //   response to mouse wheel changes. Depending upon what modifier keys are
@@ -829,8 +1171,7 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     {
         _focused = true;
 
-        if (_cursorTimer.has_value())
-            _cursorTimer.value().Start();
+        _StartBlinking();
     }
 
     // Method Description:
@@ -841,9 +1182,9 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     {
         _focused = false;
 
-        if (_cursorTimer.has_value())
+        if (s_cursorTimer.has_value())
         {
-            _cursorTimer.value().Stop();
+            _StopBlinking();
             _terminal->SetCursorVisible(false);
         }
     }
@@ -851,6 +1192,18 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     void TermControl::_SendInputToConnection(const std::wstring& wstr)
     {
         _connection.WriteInput(wstr);
+        ::Microsoft::Console::Render::InputLatency::Mark(::Microsoft::Console::Render::LatencyStage::InputSent);
+    }
+
+    // Method Description:
+    // - Pastes text into the terminal. The text goes to the connection as it
+    //      is, in one write, wrapped in the bracketed paste markers if the
+    //      app asked for them.
+    // Arguments:
+    // - wstr: the text from the clipboard.
+    void TermControl::_SendPastedTextToConnection(const std::wstring& wstr)
+    {
+        _view->SendPaste(wstr);
     }
 
     // Method Description:
@@ -862,6 +1215,7 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     void TermControl::_UpdateFont()
     {
         auto lock = _terminal->LockForWriting();
+        auto paintLock = _renderFrame->LockPainting();
 
         const int newDpi = static_cast<int>(static_cast<double>(USER_DEFAULT_SCREEN_DPI) * _swapChainPanel.CompositionScaleX());
 
@@ -874,6 +1228,10 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     // Method Description:
     // - Triggered when the swapchain changes size. We use this to resize the
     //      terminal buffers to match the new visible size.
+    // - The first change is applied right away. While more keep coming (the
+    //      user is dragging the window's border), the last frame is stretched
+    //      to each of them, and only the latest is applied, once a
+    //      s_ResizeInterval. The timer stops once a tick goes by without one.
     // Arguments:
     // - e: a SizeChangedEventArgs with the new dimensions of the SwapChainPanel
     void TermControl::_SwapChainSizeChanged(winrt::Windows::Foundation::IInspectable const& /*sender*/,
@@ -884,11 +1242,63 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
             return;
         }
 
-        auto lock = _terminal->LockForWriting();
-
         const auto foundationSize = e.NewSize();
 
-        _DoResize(foundationSize.Width, foundationSize.Height);
+        if (_resizeTimer.IsEnabled())
+        {
+            _pendingResize = foundationSize;
+            _StretchToSize(foundationSize);
+            return;
+        }
+
+        {
+            auto lock = _terminal->LockForWriting();
+            _DoResize(foundationSize.Width, foundationSize.Height);
+        }
+        _resizeTimer.Start();
+    }
+
+    // Method Description:
+    // - Resizes the buffer and the swap chain to the latest size the control
+    //      was given, if it's changed since the last tick. Otherwise, the
+    //      resize is over, and the timer is stopped until the next one.
+    // Arguments:
+    // - sender: not used
+    // - e: not used
+    void TermControl::_ResizeTick(Windows::Foundation::IInspectable const& /* sender */,
+                                  Windows::Foundation::IInspectable const& /* e */)
+    {
+        if (_pendingResize.has_value() && !_closing)
+        {
+            const auto size = _pendingResize.value();
+            _pendingResize = std::nullopt;
+
+            auto lock = _terminal->LockForWriting();
+            _DoResize(size.Width, size.Height);
+        }
+        else
+        {
+            _resizeTimer.Stop();
+        }
+    }
+
+    // Method Description:
+    // - Stretches what's on the screen, painted at _appliedSize, to fill the
+    //      given size, without painting anything. The buffer and the swap
+    //      chain stay the size they are.
+    // Arguments:
+    // - newSize: the size of the SwapChainPanel
+    void TermControl::_StretchToSize(const Windows::Foundation::Size newSize)
+    {
+        if (_appliedSize.Width <= 0 || _appliedSize.Height <= 0)
+        {
+            return;
+        }
+
+        Media::ScaleTransform stretch;
+        stretch.ScaleX(newSize.Width / _appliedSize.Width);
+        stretch.ScaleY(newSize.Height / _appliedSize.Height);
+        _swapChainPanel.RenderTransform(stretch);
     }
 
     void TermControl::_SwapChainScaleChanged(Windows::UI::Xaml::Controls::SwapChainPanel const& sender,
@@ -898,10 +1308,56 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         const auto dpi = (int)(scale * USER_DEFAULT_SCREEN_DPI);
 
         // TODO: MSFT: 21169071 - Shouldn't this all happen through _renderer and trigger the invalidate automatically on DPI change?
-        THROW_IF_FAILED(_renderEngine->UpdateDpi(dpi));
+        {
+            auto paintLock = _renderFrame->LockPainting();
+            THROW_IF_FAILED(_renderEngine->UpdateDpi(dpi));
+        }
         _renderer->TriggerRedrawAll();
     }
 
+    // Method Description:
+    // - Traces how output has been getting from the connection into the
+    //      terminal since the last time we were called: how much was read, in
+    //      how many reads, how long the parser spent waiting for the terminal's
+    //      lock, and how far the parse worker has fallen behind. The counters
+    //      are always kept, but only traced while someone's listening.
+    // Arguments:
+    // - sender: not used
+    // - e: not used
+    void TermControl::_TraceCounters(Windows::Foundation::IInspectable const& /* sender */,
+                                     Windows::Foundation::IInspectable const& /* e */)
+    {
+        if (!_initializedTerminal || _closing)
+        {
+            return;
+        }
+
+        const auto bytesRead = _connectionCounters ? _connectionCounters.BytesRead() : 0;
+        const auto readCount = _connectionCounters ? _connectionCounters.ReadCount() : 0;
+        const auto writeLockWaitTime = _terminal->GetWriteLockWaitTime();
+        const auto queueDepth = _parseWorker->GetQueueDepth();
+        const auto peakQueueDepth = _parseWorker->TakePeakQueueDepth();
+
+        const auto bytes = bytesRead - _lastBytesRead;
+        const auto reads = readCount - _lastReadCount;
+        const auto waited = std::chrono::duration_cast<std::chrono::microseconds>(writeLockWaitTime - _lastWriteLockWaitTime);
+        _lastBytesRead = bytesRead;
+        _lastReadCount = readCount;
+        _lastWriteLockWaitTime = writeLockWaitTime;
+
+        TraceLoggingWrite(
+            g_hTerminalControlProvider,
+            "ConnectionCounters",
+            TraceLoggingDescription("How output got from the connection into the terminal, since the last sample"),
+            TraceLoggingUInt64(bytes, "BytesRead", "Bytes of output read from the connection"),
+            TraceLoggingUInt64(reads, "ReadCount", "Reads it took to get them"),
+            TraceLoggingUInt64(reads == 0 ? 0 : bytes / reads, "AverageChunkSize", "Bytes per read"),
+            TraceLoggingUInt64(waited.count(), "WriteLockWaitMicroseconds", "Time the parser spent waiting for the terminal's lock"),
+            TraceLoggingUInt64(queueDepth, "QueueDepth", "Chunks waiting to be parsed right now"),
+            TraceLoggingUInt64(peakQueueDepth, "PeakQueueDepth", "The most chunks that were waiting at once"),
+            TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE));
+    }
+
     // Method Description:
     // - Toggle the cursor on and off when called by the cursor blink timer.
     // Arguments:
@@ -917,6 +1373,120 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         _terminal->SetCursorVisible(!_terminal->IsCursorVisible());
     }
 
+    // Method Description:
+    // - Starts blinking this control's cursor, along with any others that are.
+    void TermControl::_StartBlinking()
+    {
+        if (!s_cursorTimer.has_value())
+        {
+            return;
+        }
+
+        if (std::find(s_blinkingControls.begin(), s_blinkingControls.end(), this) == s_blinkingControls.end())
+        {
+            s_blinkingControls.push_back(this);
+        }
+        s_UpdateCursorTimer();
+    }
+
+    // Method Description:
+    // - Stops blinking this control's cursor. Once no cursor is blinking, the
+    //   timer stops too.
+    void TermControl::_StopBlinking()
+    {
+        s_blinkingControls.erase(std::remove(s_blinkingControls.begin(), s_blinkingControls.end(), this),
+                                 s_blinkingControls.end());
+        s_UpdateCursorTimer();
+    }
+
+    // Method Description:
+    // - Toggles the cursor of every control that's blinking, when the shared
+    //   cursor blink timer goes off.
+    // Arguments:
+    // - sender: not used
+    // - e: not used
+    void TermControl::s_BlinkCursors(Windows::Foundation::IInspectable const& sender,
+                                     Windows::Foundation::IInspectable const& e)
+    {
+        for (auto control : s_blinkingControls)
+        {
+            control->_BlinkCursor(sender, e);
+        }
+    }
+
+    // Method Description:
+    // - (Re)starts the shared cursor blink timer if there's a cursor to blink in
+    //   the active window, and stops it if there isn't. Starting it again when
+    //   it's already running pushes back the next blink.
+    void TermControl::s_UpdateCursorTimer()
+    {
+        if (!s_cursorTimer.has_value())
+        {
+            return;
+        }
+
+        if (s_windowActive && !s_blinkingControls.empty())
+        {
+            s_cursorTimer.value().Start();
+        }
+        else
+        {
+            s_cursorTimer.value().Stop();
+        }
+    }
+
+    // Method Description:
+    // - Tells the controls whether the window they're in is the active one. The
+    //   cursors of an inactive or minimized window don't blink. They're left
+    //   showing, so that the cursor isn't lost in a window that's in the
+    //   background.
+    // Arguments:
+    // - active: true if the window was activated, false if it was deactivated
+    //      or minimized.
+    void TermControl::SetWindowActive(const bool active)
+    {
+        if (s_windowActive == active)
+        {
+            return;
+        }
+        s_windowActive = active;
+
+        if (!active)
+        {
+            for (auto control : s_blinkingControls)
+            {
+                control->_terminal->SetCursorVisible(true);
+            }
+        }
+        s_UpdateCursorTimer();
+    }
+
+    // Method Description:
+    // - Starts making what the renderers draw with (the Direct3D device and the
+    //   DirectX factories) on a background thread. Every control in the process
+    //   shares them, so the first one to be shown doesn't have to wait for them,
+    //   as long as this was called early enough. This is meant to be called at
+    //   launch, before anything else is done.
+    void TermControl::WarmUpRenderer()
+    {
+        LOG_IF_WIN32_BOOL_FALSE(TrySubmitThreadpoolCallback(
+            [](PTP_CALLBACK_INSTANCE, PVOID) {
+                using ::Microsoft::Console::Render::SharedResources;
+
+                ::Microsoft::WRL::ComPtr<ID2D1Factory1> d2dFactory;
+                ::Microsoft::WRL::ComPtr<IDWriteFactory2> dwriteFactory;
+                LOG_IF_FAILED(SharedResources::GetFactories(d2dFactory, dwriteFactory));
+
+                ::Microsoft::WRL::ComPtr<IDXGIFactory2> dxgiFactory;
+                ::Microsoft::WRL::ComPtr<IDXGIAdapter1> adapter;
+                ::Microsoft::WRL::ComPtr<ID3D11Device> device;
+                ::Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
+                LOG_IF_FAILED(SharedResources::GetDevice(dxgiFactory, adapter, device, deviceContext));
+            },
+            nullptr,
+            nullptr));
+    }
+
     // Method Description:
     // - Process a resize event that was initiated by the user. This can either be due to the user resizing the window (causing the swapchain to resize) or due to the DPI changing (causing us to need to resize the buffer to match)
     // Arguments:
@@ -928,8 +1498,16 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         size.cx = static_cast<long>(newWidth);
         size.cy = static_cast<long>(newHeight);
 
+        // The next frame is painted at this size, so it doesn't need stretching.
+        _appliedSize = { static_cast<float>(newWidth), static_cast<float>(newHeight) };
+        _swapChainPanel.RenderTransform(nullptr);
+
         // Tell the dx engine that our window is now the new size.
-        THROW_IF_FAILED(_renderEngine->SetWindowSize(size));
+        // The renderer paints without the terminal's lock, so keep it from painting while we do.
+        {
+            auto paintLock = _renderFrame->LockPainting();
+            THROW_IF_FAILED(_renderEngine->SetWindowSize(size));
+        }
 
         // Invalidate everything
         _renderer->TriggerRedrawAll();
@@ -945,6 +1523,14 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         // TODO: MSFT:20642295 Resizing the buffer will corrupt it
         // I believe we'll need support for CSI 2J, and additionally I think
         //      we're resetting the viewport to the top
+        // A view doesn't resize the terminal, or the connection - it's as tall
+        //      as it can be, and keeps the width of the control it was made from.
+        if (_secondaryView)
+        {
+            _secondaryView->SetViewHeight(vp.Height());
+            return;
+        }
+
         const HRESULT hr = _terminal->UserResize({ vp.Width(), vp.Height() });
         if (SUCCEEDED(hr) && hr != S_FALSE)
         {
@@ -986,6 +1572,9 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     //      viewport top, viewport height, and buffer size.
     //   Additionally fires a ScrollPositionChanged event for anyone who's
     //      registered an event handler for us.
+    // - This is called from the output thread, with the terminal locked. The
+    //      position is only kept until the UI thread gets to it, and if it's
+    //      already been asked to, it'll take this one instead when it does.
     // Arguments:
     // - viewTop: the top of the visible viewport, in rows. 0 indicates the top
     //      of the buffer.
@@ -995,13 +1584,42 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
                                                      const int viewHeight,
                                                      const int bufferSize)
     {
-        // Update our scrollbar
-        _scrollBar.Dispatcher().RunAsync(CoreDispatcherPriority::Low, [=]() {
-            _ScrollbarUpdater(_scrollBar, viewTop, viewHeight, bufferSize);
-        });
+        bool queued;
+        {
+            std::unique_lock<std::mutex> lock{ _scrollPositionLock };
+            queued = _pendingScrollPosition.has_value();
+            _pendingScrollPosition = { viewTop, viewHeight, bufferSize };
+        }
+
+        if (!queued)
+        {
+            _scrollBar.Dispatcher().RunAsync(CoreDispatcherPriority::Low, [this]() {
+                _ApplyPendingScrollPosition();
+            });
+        }
+    }
+
+    // Method Description:
+    // - Moves the scrollbar to the latest position the terminal reported. This
+    //      should be done on the UI thread.
+    void TermControl::_ApplyPendingScrollPosition()
+    {
+        std::optional<std::tuple<int, int, int>> position;
+        {
+            std::unique_lock<std::mutex> lock{ _scrollPositionLock };
+            position.swap(_pendingScrollPosition);
+        }
+
+        if (!position.has_value())
+        {
+            return;
+        }
+
+        const auto [viewTop, viewHeight, bufferSize] = position.value();
 
         // Set this value as our next expected scroll position.
         _lastScrollOffset = { viewTop };
+        _ScrollbarUpdater(_scrollBar, viewTop, viewHeight, bufferSize);
         _scrollPositionChangedHandlers(viewTop, viewHeight, bufferSize);
     }
 
@@ -1021,9 +1639,9 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     void TermControl::CopySelectionToClipboard(bool trimTrailingWhitespace)
     {
         // extract text from buffer
-        const auto copiedData = _terminal->RetrieveSelectedTextFromBuffer(trimTrailingWhitespace);
+        const auto copiedData = _view->RetrieveSelectedTextFromBuffer(trimTrailingWhitespace);
 
-        _terminal->ClearSelection();
+        _view->ClearSelection();
 
         // send data up for clipboard
         _clipboardCopyHandlers(copiedData);
@@ -1037,9 +1655,27 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         }
     }
 
+    // Method Description:
+    // - Makes another control that shows this control's session: the same buffer,
+    //   fed by the same connection, but scrolled and selected in on its own, and
+    //   painted by a renderer of its own. Output is still only parsed once.
+    // - Input typed into the new control goes to the connection as well. Only this
+    //   control raises TitleChanged, and resizing the new control doesn't resize
+    //   the session. The new control can outlive this one, but once this one's
+    //   closed, the connection is closed with it.
+    // Return Value:
+    // - the new control
+    // Note: throws E_ILLEGAL_METHOD_CALL if this control's terminal hasn't been
+    //   initialized yet.
+    TerminalControl::TermControl TermControl::CreateView()
+    {
+        THROW_HR_IF(E_ILLEGAL_METHOD_CALL, !_initializedTerminal || _closing);
+        return winrt::make<TermControl>(_settings, _terminal, _connection);
+    }
+
     void TermControl::ScrollViewport(int viewTop)
     {
-        _terminal->UserScrollViewport(viewTop);
+        _view->UserScrollViewport(viewTop);
     }
 
     // Method Description:
@@ -1051,14 +1687,14 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     // ScrollViewport is because ScrollViewport is being called by _ScrollbarChangeHandler
     void TermControl::KeyboardScrollViewport(int viewTop)
     {
-        _terminal->UserScrollViewport(viewTop);
+        _view->UserScrollViewport(viewTop);
         _lastScrollOffset = std::nullopt;
         _scrollBar.Value(static_cast<int>(viewTop));
     }
 
     int TermControl::GetScrollOffset()
     {
-        return _terminal->GetScrollOffset();
+        return _view->GetScrollOffset();
     }
 
     // Function Description:
@@ -1067,10 +1703,81 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     // - The height of the terminal in lines of text
     int TermControl::GetViewHeight() const
     {
-        const auto viewPort = _terminal->GetViewport();
+        const auto viewPort = _view->GetViewport();
         return viewPort.Height();
     }
 
+    // Function Description:
+    // - Gets an estimate of how much memory the terminal's buffers are using.
+    // Return Value:
+    // - The number of bytes in use, or 0 if the terminal hasn't been set up yet.
+    uint64_t TermControl::GetMemoryUsage()
+    {
+        if (!_initializedTerminal || _closing)
+        {
+            return 0;
+        }
+
+        auto lock = _terminal->LockForReading();
+        return _terminal->GetMemoryUsage();
+    }
+
+    // Function Description:
+    // - Gives up the oldest scrollback until the terminal's buffers use no more
+    //   than the given amount of memory, or there's no scrollback left to give up.
+    //   What's on screen is always kept.
+    // Arguments:
+    // - target: the number of bytes to get down to
+    // Return Value:
+    // - The number of bytes in use afterwards.
+    uint64_t TermControl::TrimMemoryUsage(uint64_t target)
+    {
+        if (!_initializedTerminal || _closing)
+        {
+            return 0;
+        }
+
+        auto lock = _terminal->LockForWriting();
+        return _terminal->TrimMemoryUsage(gsl::narrow_cast<size_t>(target));
+    }
+
+    // Function Description:
+    // - Puts the control in the background while it isn't shown, or brings it back.
+    //   In the background nothing is painted, and the terminal keeps up with its
+    //   output in batches. When it's brought back, it's all painted again at once.
+    // Arguments:
+    // - inBackground: true if the control isn't being shown
+    void TermControl::SetInBackground(bool inBackground)
+    {
+        if (!_initializedTerminal || _closing)
+        {
+            // It's applied once the terminal's been set up.
+            _inBackground = inBackground;
+            return;
+        }
+
+        if (inBackground == _inBackground)
+        {
+            return;
+        }
+        _inBackground = inBackground;
+
+        // A view doesn't parse anything, so it's only its painting that stops.
+        if (_parseWorker)
+        {
+            _parseWorker->SetBackground(inBackground);
+        }
+        if (inBackground)
+        {
+            _renderer->WaitForPaintCompletionAndDisable(s_BackgroundPaintTimeoutMs);
+        }
+        else
+        {
+            _renderer->EnablePainting();
+            _renderer->TriggerRedrawAll();
+        }
+    }
+
     // Function Description:
     // - Determines how much space (in pixels) an app would need to reserve to
     //   create a control with the settings stored in the settings param. This
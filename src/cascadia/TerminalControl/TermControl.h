@@ -10,6 +10,9 @@
 #include "../../renderer/base/Renderer.hpp"
 #include "../../renderer/dx/DxRenderer.hpp"
 #include "../../cascadia/TerminalCore/Terminal.hpp"
+#include "../../cascadia/TerminalCore/TerminalRenderFrame.hpp"
+#include "../../cascadia/TerminalCore/TerminalView.hpp"
+#include "../../cascadia/TerminalCore/TerminalParseWorker.hpp"
 #include "../../cascadia/inc/cppwinrt_utils.h"
 
 namespace winrt::Microsoft::Terminal::TerminalControl::implementation
@@ -33,6 +36,9 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
     {
         TermControl();
         TermControl(Settings::IControlSettings settings);
+        TermControl(Settings::IControlSettings settings,
+                    std::shared_ptr<::Microsoft::Terminal::Core::Terminal> terminal,
+                    TerminalConnection::ITerminalConnection connection);
 
         Windows::UI::Xaml::UIElement GetRoot();
         Windows::UI::Xaml::Controls::UserControl GetControl();
@@ -42,15 +48,24 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         void CopySelectionToClipboard(bool trimTrailingWhitespace);
         void Close();
 
+        TerminalControl::TermControl CreateView();
+
         void ScrollViewport(int viewTop);
         void KeyboardScrollViewport(int viewTop);
         int GetScrollOffset();
         int GetViewHeight() const;
 
+        uint64_t GetMemoryUsage();
+        uint64_t TrimMemoryUsage(uint64_t target);
+
+        void SetInBackground(bool inBackground);
+
         void SwapChainChanged();
         ~TermControl();
 
         static Windows::Foundation::Point GetProposedDimensions(Microsoft::Terminal::Settings::IControlSettings const& settings, const uint32_t dpi);
+        static void SetWindowActive(const bool active);
+        static void WarmUpRenderer();
 
         // -------------------------------- WinRT Events ---------------------------------
         DECLARE_EVENT(TitleChanged,             _titleChangedHandlers,              TerminalControl::TitleChangedEventArgs);
@@ -70,7 +85,18 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         Windows::UI::Xaml::Controls::Primitives::ScrollBar _scrollBar;
         event_token _connectionOutputEventToken;
 
-        std::unique_ptr<::Microsoft::Terminal::Core::Terminal> _terminal;
+        // A control made by CreateView shares the terminal (and the connection) of
+        //      the control it was made from, and shows it in a view of its own.
+        std::shared_ptr<::Microsoft::Terminal::Core::Terminal> _terminal;
+        std::unique_ptr<::Microsoft::Terminal::Core::TerminalView> _secondaryView;
+        // The view this control shows - the terminal's primary view, or _secondaryView.
+        ::Microsoft::Terminal::Core::TerminalView* _view;
+
+        // Output from the connection is parsed on this worker's thread, not the connection's.
+        std::unique_ptr<::Microsoft::Terminal::Core::TerminalParseWorker> _parseWorker;
+
+        // The renderer paints from this copy of the terminal, so it has to outlive the renderer.
+        std::unique_ptr<::Microsoft::Terminal::Core::TerminalRenderFrame> _renderFrame;
 
         std::unique_ptr<::Microsoft::Console::Render::Renderer> _renderer;
         std::unique_ptr<::Microsoft::Console::Render::DxEngine> _renderEngine;
@@ -79,15 +105,67 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         bool _focused;
         bool _closing;
 
+        // While the control isn't shown (its tab isn't the selected one), nothing
+        //      is painted, and output is parsed in batches. It's all painted again
+        //      once it's shown.
+        bool _inBackground;
+        static constexpr DWORD s_BackgroundPaintTimeoutMs = 1000;
+
         FontInfoDesired _desiredFont;
         FontInfo _actualFont;
 
         std::optional<int> _lastScrollOffset;
 
+        // While output scrolls, the terminal can move its viewport every line.
+        //      Only the latest position is kept, and one update at a time is
+        //      queued to the UI thread, which applies whatever's latest once it
+        //      gets there (see _TerminalScrollPositionChanged).
+        std::mutex _scrollPositionLock;
+        std::optional<std::tuple<int, int, int>> _pendingScrollPosition;
+
         // storage location for the leading surrogate of a utf-16 surrogate pair
         std::optional<wchar_t> _leadingSurrogate;
 
-        std::optional<Windows::UI::Xaml::DispatcherTimer> _cursorTimer;
+        // One timer blinks the cursor of every control, and only while one of
+        //      them has focus in the active window. Nothing wakes up to blink a
+        //      cursor in a background tab, or a window that's minimized or
+        //      behind another one. These are only used on the UI thread.
+        static std::optional<Windows::UI::Xaml::DispatcherTimer> s_cursorTimer;
+        static std::vector<TermControl*> s_blinkingControls;
+        static bool s_windowActive;
+
+        // Every s_CountersInterval, we trace how output got from the connection
+        //      into the terminal (see _TraceCounters). The connection's counters
+        //      only grow, so we keep the last sample to trace the difference.
+        Windows::UI::Xaml::DispatcherTimer _countersTimer;
+        TerminalConnection::IConnectionCounters _connectionCounters;
+        uint64_t _lastBytesRead;
+        uint64_t _lastReadCount;
+        std::chrono::nanoseconds _lastWriteLockWaitTime;
+        static constexpr std::chrono::seconds s_CountersInterval{ 1 };
+
+        // A mouse can report moves a thousand times a second, far more often
+        //      than we paint. While a selection's being dragged out, only the
+        //      latest position is kept, and it's applied to the selection at
+        //      most once every s_SelectionUpdateInterval, about a frame.
+        Windows::UI::Xaml::DispatcherTimer _selectionUpdateTimer;
+        std::optional<COORD> _pendingSelectionEnd;
+        static constexpr std::chrono::milliseconds s_SelectionUpdateInterval{ 16 };
+
+        // While the control's being resized, the buffer and the swap chain are
+        //      resized to the latest size at most once every s_ResizeInterval.
+        //      In between, the last frame is stretched to fit the control, from
+        //      _appliedSize, the size it was painted at.
+        Windows::UI::Xaml::DispatcherTimer _resizeTimer;
+        std::optional<Windows::Foundation::Size> _pendingResize;
+        Windows::Foundation::Size _appliedSize;
+        static constexpr std::chrono::milliseconds s_ResizeInterval{ 50 };
+
+        // While there are echoes predicted that haven't come back yet, this
+        //      checks on them every so often, and rolls back the ones that have
+        //      taken too long (see Terminal::PredictEcho).
+        Windows::UI::Xaml::DispatcherTimer _predictedEchoTimer;
+        static constexpr std::chrono::milliseconds s_PredictedEchoInterval{ 100 };
 
         // If this is set, then we assume we are in the middle of panning the
         //      viewport via touch input.
@@ -95,6 +173,7 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
 
         void _Create();
         void _ApplyUISettings();
+        void _ApplyFontSettings();
         void _ApplyConnectionSettings();
         void _InitializeTerminal();
         void _UpdateFont();
@@ -109,7 +188,19 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         void _LostFocusHandler(Windows::Foundation::IInspectable const& sender, Windows::UI::Xaml::RoutedEventArgs const& e);
 
         void _BlinkCursor(Windows::Foundation::IInspectable const& sender, Windows::Foundation::IInspectable const& e);
+        void _StartBlinking();
+        void _StopBlinking();
+        static void s_BlinkCursors(Windows::Foundation::IInspectable const& sender, Windows::Foundation::IInspectable const& e);
+        static void s_UpdateCursorTimer();
+        void _TraceCounters(Windows::Foundation::IInspectable const& sender, Windows::Foundation::IInspectable const& e);
+        void _SelectionUpdateTick(Windows::Foundation::IInspectable const& sender, Windows::Foundation::IInspectable const& e);
+        void _ResizeTick(Windows::Foundation::IInspectable const& sender, Windows::Foundation::IInspectable const& e);
+        void _StretchToSize(const Windows::Foundation::Size newSize);
+        void _ApplyPendingSelectionEnd();
+        void _ApplyPendingScrollPosition();
+        void _PredictedEchoTick(Windows::Foundation::IInspectable const& sender, Windows::Foundation::IInspectable const& e);
         void _SendInputToConnection(const std::wstring& wstr);
+        void _SendPastedTextToConnection(const std::wstring& wstr);
         void _SwapChainSizeChanged(Windows::Foundation::IInspectable const& sender, Windows::UI::Xaml::SizeChangedEventArgs const& e);
         void _SwapChainScaleChanged(Windows::UI::Xaml::Controls::SwapChainPanel const& sender, Windows::Foundation::IInspectable const& args);
         void _DoResize(const double newWidth, const double newHeight);
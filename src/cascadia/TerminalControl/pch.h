@@ -30,3 +30,7 @@
 
 #include <windows.ui.xaml.media.dxinterop.h>
 
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+TRACELOGGING_DECLARE_PROVIDER(g_hTerminalControlProvider);
+
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "../../terminal/adapter/DispatchTypes.hpp"
+#include "../../buffer/out/TextAttribute.hpp"
 
 namespace Microsoft::Terminal::Core
 {
@@ -20,6 +21,8 @@ namespace Microsoft::Terminal::Core
         virtual bool BoldText(bool boldOn) = 0;
         virtual bool UnderlineText(bool underlineOn) = 0;
         virtual bool ReverseText(bool reversed) = 0;
+        virtual TextAttribute GetTextAttributes() const = 0;
+        virtual bool SetTextAttributes(const TextAttribute& attrs) = 0;
 
         virtual bool SetCursorPosition(short x, short y) = 0;
         virtual COORD GetCursorPosition() = 0;
@@ -31,5 +34,13 @@ namespace Microsoft::Terminal::Core
         virtual bool SetColorTableEntry(const size_t tableIndex, const DWORD dwColor) = 0;
 
         virtual bool SetCursorStyle(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::CursorStyle cursorStyle) = 0;
+
+        virtual bool UseAlternateScreenBuffer() = 0;
+        virtual bool UseMainScreenBuffer() = 0;
+
+        virtual bool EnableBracketedPasteMode(const bool enabled) = 0;
+
+        virtual bool AddHyperlink(std::wstring_view uri, std::wstring_view id) = 0;
+        virtual bool EndHyperlink() = 0;
     };
 }
@@ -10,6 +10,7 @@ namespace Microsoft::Terminal::Core
         virtual ~ITerminalInput() {}
 
         virtual bool SendKeyEvent(const WORD vkey, const bool ctrlPressed, const bool altPressed, const bool shiftPressed) = 0;
+        virtual void SendPaste(std::wstring_view text) = 0;
 
         // void SendMouseEvent(uint row, uint col, KeyModifiers modifiers);
         [[nodiscard]]
@@ -9,6 +9,8 @@
 #include "../../inc/DefaultSettings.h"
 #include "../../inc/argb.h"
 #include "../../types/inc/utils.hpp"
+#include "../../renderer/base/InputLatency.hpp"
+#include "../../renderer/base/PipelineActivity.hpp"
 
 #include "winrt/Microsoft.Terminal.Settings.h"
 
@@ -39,25 +41,38 @@ static std::wstring _KeyEventsToText(std::deque<std::unique_ptr<IInputEvent>>& i
 }
 
 Terminal::Terminal() :
+    _mainBuffer{},
+    _altBuffer{},
+    _buffer{ nullptr },
+    _export{},
     _mutableViewport{Viewport::Empty()},
+    _mainViewport{ Viewport::Empty() },
+    _views{},
+    _primaryView{ *this },
     _title{ L"" },
     _colorTable{},
     _defaultFg{ RGB(255, 255, 255) },
     _defaultBg{ ARGB(0, 0, 0, 0) },
+    _resolvedColors{},
     _pfnWriteInput{ nullptr },
-    _scrollOffset{ 0 },
     _snapOnInput{ true },
-    _boxSelection{ false },
-    _selectionActive{ false },
-    _selectionAnchor{ 0, 0 },
-    _endSelectionPosition { 0, 0 }
+    _searchIndex{},
+    _searchMatches{},
+    _predictiveEchoEnabled{ false },
+    _predictiveEcho{},
+    _lockWaiters{ 0 },
+    _writeLockWaitTime{ 0 }
 {
     _stateMachine = std::make_unique<StateMachine>(new OutputStateMachineEngine(new TerminalDispatch(*this)));
 
     auto passAlongInput = [&](std::deque<std::unique_ptr<IInputEvent>>& inEventsToWrite)
     {
         if(!_pfnWriteInput) return;
+        // A key that's translated isn't plain text, so there's no telling what
+        //      the app will echo for it, or for what was typed before it.
+        ResetPredictedEcho();
         std::wstring wstr = _KeyEventsToText(inEventsToWrite);
+        RecordInput(wstr);
         _pfnWriteInput(wstr);
     };
 
@@ -66,6 +81,13 @@ Terminal::Terminal() :
     _InitializeColorTable();
 }
 
+// Method Description:
+// - Sets up the Terminal's buffers, and shows them in its primary view.
+// Arguments:
+// - viewportSize: the size of the viewport, in characters
+// - scrollbackLines: how many rows of scrollback to keep above it
+// - renderTarget: the render target of the primary view. The render targets of
+//      every view are told about changes to the buffers.
 void Terminal::Create(COORD viewportSize, SHORT scrollbackLines, IRenderTarget& renderTarget)
 {
     _mutableViewport = Viewport::FromDimensions({ 0,0 }, viewportSize);
@@ -73,7 +95,13 @@ void Terminal::Create(COORD viewportSize, SHORT scrollbackLines, IRenderTarget&
     const COORD bufferSize { viewportSize.X, _ClampToShortMax(viewportSize.Y + scrollbackLines, 1) };
     const TextAttribute attr{};
     const UINT cursorSize = 12;
-    _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, renderTarget);
+    _mainBuffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _views);
+
+    // Allocate the alt buffer now, so that switching to it later doesn't have to.
+    _altBuffer = std::make_unique<TextBuffer>(viewportSize, attr, cursorSize, _views);
+
+    _buffer = _mainBuffer.get();
+    _primaryView.Attach(renderTarget);
 }
 
 // Method Description:
@@ -85,8 +113,31 @@ void Terminal::CreateFromSettings(winrt::Microsoft::Terminal::Settings::ICoreSet
             Microsoft::Console::Render::IRenderTarget& renderTarget)
 {
     const COORD viewportSize{ _ClampToShortMax(settings.InitialCols(), 1), _ClampToShortMax(settings.InitialRows(), 1) };
-    // TODO:MSFT:20642297 - Support infinite scrollback here, if HistorySize is -1
-    Create(viewportSize, _ClampToShortMax(settings.HistorySize(), 0), renderTarget);
+
+    // A HistorySize of -1 means unlimited scrollback. Keep the usual amount of
+    // history in memory and spill everything older than that out to disk.
+    const bool unlimitedHistory = settings.HistorySize() < 0;
+    const auto historySize = unlimitedHistory ? DEFAULT_HISTORY_SIZE : _ClampToShortMax(settings.HistorySize(), 0);
+    Create(viewportSize, historySize, renderTarget);
+
+    if (unlimitedHistory)
+    {
+        try
+        {
+            _mainBuffer->SetScrollbackSpill(ScrollbackSpill::CreateInTempDirectory());
+        }
+        CATCH_LOG();
+    }
+
+    const auto recordingDirectory = settings.RecordingDirectory();
+    if (!recordingDirectory.empty())
+    {
+        try
+        {
+            StartRecording(TerminalRecorder::s_MakePath(recordingDirectory));
+        }
+        CATCH_LOG();
+    }
 
     UpdateSettings(settings);
 }
@@ -122,17 +173,27 @@ void Terminal::UpdateSettings(winrt::Microsoft::Terminal::Settings::ICoreSetting
             break;
     }
 
-    _buffer->GetCursor().SetStyle(settings.CursorHeight(),
-                                  settings.CursorColor(),
-                                  cursorShape);
+    for (auto* const buffer : { _mainBuffer.get(), _altBuffer.get() })
+    {
+        buffer->GetCursor().SetStyle(settings.CursorHeight(),
+                                     settings.CursorColor(),
+                                     cursorShape);
+    }
 
     for (int i = 0; i < 16; i++)
     {
         _colorTable[i] = settings.GetColorTableEntry(i);
     }
+    _UpdateResolvedColors();
 
     _snapOnInput = settings.SnapOnInput();
 
+    _predictiveEchoEnabled = settings.PredictiveEcho();
+    if (!_predictiveEchoEnabled && _buffer)
+    {
+        _predictiveEcho.Reset(*_buffer);
+    }
+
     // TODO:MSFT:21327402 - if HistorySize has changed, resize the buffer so we
     // have a smaller scrollback. We should do this carefully - if the new buffer
     // size is smaller than where the mutable viewport currently is, we'll want
@@ -157,11 +218,24 @@ HRESULT Terminal::UserResize(const COORD viewportSize) noexcept
         return S_FALSE;
     }
 
-    const auto oldTop = _mutableViewport.Top();
+    // The rows are about to move under the predictions.
+    _predictiveEcho.Reset(*_buffer);
+
+    // Both buffers follow the size of the viewport, whichever one is in use.
+    //      The main buffer's viewport is only the one on screen while the alt buffer isn't.
+    const bool inAltBuffer = _buffer == _altBuffer.get();
+    auto& mainViewport = inAltBuffer ? _mainViewport : _mutableViewport;
+    const auto oldTop = mainViewport.Top();
 
     const short newBufferHeight = viewportSize.Y + _scrollbackLines;
     COORD bufferSize{ viewportSize.X, newBufferHeight };
-    RETURN_IF_FAILED(_buffer->ResizeTraditional(bufferSize));
+    RETURN_IF_FAILED(_mainBuffer->ResizeTraditional(bufferSize));
+    RETURN_IF_FAILED(_altBuffer->ResizeTraditional(viewportSize));
+
+    if (_recorder)
+    {
+        _recorder->RecordResize(viewportSize);
+    }
 
     auto proposedTop = oldTop;
     const auto newView = Viewport::FromDimensions({ 0, proposedTop }, viewportSize);
@@ -173,18 +247,120 @@ HRESULT Terminal::UserResize(const COORD viewportSize) noexcept
         proposedTop -= (proposedBottom - bufferSize.Y);
     }
 
-    _mutableViewport = Viewport::FromDimensions({ 0, proposedTop }, viewportSize);
-    _scrollOffset = 0;
-    _NotifyScrollEvent();
+    mainViewport = Viewport::FromDimensions({ 0, proposedTop }, viewportSize);
+    if (inAltBuffer)
+    {
+        _mutableViewport = Viewport::FromDimensions({ 0, 0 }, viewportSize);
+    }
+    for (auto* const view : _views.GetViews())
+    {
+        view->_ResetScroll(inAltBuffer);
+    }
 
     return S_OK;
 }
 
+// Method Description:
+// - Parses a string of output from the connection and applies it to the buffer.
+// Arguments:
+// - stringView: the output
 void Terminal::Write(std::wstring_view stringView)
 {
-    auto lock = LockForWriting();
+    if (_recorder)
+    {
+        _recorder->RecordOutput(stringView);
+    }
+    _ParseOutput(stringView);
+}
+
+// Method Description:
+// - Parses output and applies it to the buffer.
+// - A flood of output is parsed in slices of at most s_WriteSliceSize
+//   characters, and the write lock is let go between slices. If anyone is
+//   waiting on the lock (the UI thread with a key press, or the renderer
+//   wanting to take a frame), they get it before the next slice is parsed, so
+//   a long write can't starve them. The state machine keeps its state between
+//   slices, so a sequence that straddles two of them is parsed just the same.
+//   So is a UTF-8 character, which the state machine holds on to until the
+//   next slice finishes it.
+// Arguments:
+// - output: the output, either UTF-16 or UTF-8
+template<typename TChar>
+void Terminal::_ParseOutput(std::basic_string_view<TChar> output)
+{
+    Microsoft::Console::Render::PipelineActivity activity{ Microsoft::Console::Render::PipelineStage::Output, output.size() };
+
+    while (!output.empty())
+    {
+        auto slice = output.substr(0, s_WriteSliceSize);
+        if constexpr (std::is_same_v<TChar, wchar_t>)
+        {
+            // Don't split a surrogate pair across two slices.
+            if (slice.size() < output.size() && IS_HIGH_SURROGATE(slice.back()))
+            {
+                slice.remove_suffix(1);
+            }
+        }
+
+        {
+            // Only look at the clock when we actually have to wait.
+            std::unique_lock<std::shared_mutex> lock{ _readWriteLock, std::try_to_lock };
+            if (!lock.owns_lock())
+            {
+                const auto start = std::chrono::steady_clock::now();
+                lock.lock();
+                const auto waited = std::chrono::steady_clock::now() - start;
+                _writeLockWaitTime.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count(),
+                                             std::memory_order_relaxed);
+            }
+
+            // Everything the slice redraws is handed to the renderer at once,
+            //      before we let go of the lock.
+            RenderTargetBatch renderBatch{ _buffer->GetRenderTarget() };
+            Microsoft::Console::Render::PipelineActivity parse{ Microsoft::Console::Render::PipelineStage::Parse, slice.size() };
+            if constexpr (std::is_same_v<TChar, wchar_t>)
+            {
+                _stateMachine->ProcessString(slice.data(), slice.size());
+            }
+            else
+            {
+                _stateMachine->ProcessUtf8String(slice.data(), slice.size());
+            }
+            _predictiveEcho.Reconcile(*_buffer);
+        }
+
+        output.remove_prefix(slice.size());
+
+        // The lock isn't fair - we'd usually get it straight back. Stand aside
+        //      until everybody who was waiting on it has had their turn.
+        while (!output.empty() && _lockWaiters.load() != 0)
+        {
+            SwitchToThread();
+        }
+    }
+
+    Microsoft::Console::Render::InputLatency::OutputArrived(Microsoft::Console::Render::LatencyStage::OutputParsed);
+}
+
+// Method Description:
+// - Parses a chunk of UTF-8 output from the connection, straight from the bytes
+//   that were read. The state machine only widens the text between sequences,
+//   right before printing it. A character that's cut off at the end of one
+//   chunk is held on to until the next one completes it. Invalid sequences
+//   become U+FFFD.
+// - Only the connection's output thread should call this - the UTF-8 state
+//   belongs to whoever's writing.
+// Arguments:
+// - utf8: the bytes that were read
+void Terminal::Write(std::string_view utf8)
+{
+    // Recorded as the bytes that came in, which is usually half the size.
+    if (_recorder)
+    {
+        _recorder->RecordOutput(utf8);
+    }
 
-    _stateMachine->ProcessString(stringView.data(), stringView.size());
+    _ParseOutput(utf8);
 }
 
 // Method Description:
@@ -194,6 +370,7 @@ void Terminal::Write(std::wstring_view stringView)
 //   event should NOT br processed any further. If we return false, the event
 //   was NOT translated, and we should instead use the event to try and get the
 //   real character out of the event.
+// - It's the primary view that snaps to the bottom, see TerminalView::SendKeyEvent.
 // Arguments:
 // - vkey: The vkey of the key pressed.
 // - ctrlPressed: true iff either ctrl key is pressed.
@@ -207,13 +384,17 @@ bool Terminal::SendKeyEvent(const WORD vkey,
                             const bool altPressed,
                             const bool shiftPressed)
 {
-    if (_snapOnInput && _scrollOffset != 0)
-    {
-        auto lock = LockForWriting();
-        _scrollOffset = 0;
-        _NotifyScrollEvent();
-    }
+    return _primaryView.SendKeyEvent(vkey, ctrlPressed, altPressed, shiftPressed);
+}
 
+// Method Description:
+// - Translates a key event and sends it to the connection, whichever view it
+//   was pressed in. See SendKeyEvent.
+bool Terminal::_SendKeyEvent(const WORD vkey,
+                             const bool ctrlPressed,
+                             const bool altPressed,
+                             const bool shiftPressed)
+{
     DWORD modifiers = 0
                       | (ctrlPressed? LEFT_CTRL_PRESSED : 0)
                       | (altPressed? LEFT_ALT_PRESSED : 0)
@@ -249,6 +430,42 @@ bool Terminal::SendKeyEvent(const WORD vkey,
     return translated && manuallyHandled;
 }
 
+// Method Description:
+// - Sends pasted text to the connection as one string, rather than as a key
+//   press for each character. If the app turned on bracketed paste mode, the
+//   text is sent between the bracketed paste markers, so that the app can
+//   tell it apart from what's typed.
+// Arguments:
+// - text: the text that was pasted.
+void Terminal::SendPaste(std::wstring_view text)
+{
+    _primaryView.SendPaste(text);
+}
+
+// Method Description:
+// - Sends pasted text to the connection, whichever view it was pasted in. The
+//   caller has to have checked that there's text, and somewhere to send it.
+//   See SendPaste.
+void Terminal::_SendPaste(std::wstring_view text)
+{
+    ResetPredictedEcho();
+
+    std::wstring wstr;
+    if (_terminalInput->IsBracketedPasteModeEnabled())
+    {
+        wstr.reserve(TerminalInput::s_BracketedPasteStart.size() + text.size() + TerminalInput::s_BracketedPasteEnd.size());
+        wstr.append(TerminalInput::s_BracketedPasteStart);
+        wstr.append(text);
+        wstr.append(TerminalInput::s_BracketedPasteEnd);
+    }
+    else
+    {
+        wstr.assign(text);
+    }
+    RecordInput(wstr);
+    _pfnWriteInput(wstr);
+}
+
 // Method Description:
 // - Aquire a read lock on the terminal.
 // Return Value:
@@ -257,7 +474,10 @@ bool Terminal::SendKeyEvent(const WORD vkey,
 [[nodiscard]]
 std::shared_lock<std::shared_mutex> Terminal::LockForReading()
 {
-    return std::shared_lock<std::shared_mutex>(_readWriteLock);
+    ++_lockWaiters;
+    auto lock = std::shared_lock<std::shared_mutex>(_readWriteLock);
+    --_lockWaiters;
+    return lock;
 }
 
 // Method Description:
@@ -268,7 +488,10 @@ std::shared_lock<std::shared_mutex> Terminal::LockForReading()
 [[nodiscard]]
 std::unique_lock<std::shared_mutex> Terminal::LockForWriting()
 {
-    return std::unique_lock<std::shared_mutex>(_readWriteLock);
+    ++_lockWaiters;
+    auto lock = std::unique_lock<std::shared_mutex>(_readWriteLock);
+    --_lockWaiters;
+    return lock;
 }
 
 
@@ -282,56 +505,47 @@ short Terminal::GetBufferHeight() const noexcept
     return _mutableViewport.BottomExclusive();
 }
 
-// _ViewStartIndex is also the length of the scrollback
-int Terminal::_ViewStartIndex() const noexcept
-{
-    return _mutableViewport.Top();
-}
-
-// _VisibleStartIndex is the first visible line of the buffer
-int Terminal::_VisibleStartIndex() const noexcept
-{
-    return std::max(0, _ViewStartIndex() - _scrollOffset);
-}
-
-Viewport Terminal::_GetVisibleViewport() const noexcept
+TerminalView& Terminal::GetPrimaryView() noexcept
 {
-    const COORD origin{ 0, gsl::narrow<short>(_VisibleStartIndex()) };
-    return Viewport::FromDimensions(origin,
-                                    _mutableViewport.Dimensions());
+    return _primaryView;
 }
 
 // Writes a string of text to the buffer, then moves the cursor (and viewport)
 //      in accordance with the written text.
 // This method is our proverbial `WriteCharsLegacy`, and great care should be made to
 //      keep it minimal and orderly, lest it become WriteCharsLegacy2ElectricBoogaloo
-// TODO: MSFT 21006766
-//       This needs to become stream logic on the buffer itself sooner rather than later
-//       because it's otherwise impossible to avoid the Electric Boogaloo-ness here.
-//       I had to make a bunch of hacks to get Japanese and emoji to work-ish.
+// The string is split at the control characters we handle here. Each run of
+//      printable text between them is written a row at a time, and the cursor
+//      is only moved once per row we write to.
 void Terminal::_WriteBuffer(const std::wstring_view& stringView)
 {
+    Microsoft::Console::Render::PipelineActivity activity{ Microsoft::Console::Render::PipelineStage::BufferWrite, stringView.size() };
+
     auto& cursor = _buffer->GetCursor();
     const Viewport bufferSize = _buffer->GetSize();
+    bool notifyScroll = false;
 
-    for (size_t i = 0; i < stringView.size(); i++)
+    size_t i = 0;
+    while (i < stringView.size())
     {
-        wchar_t wch = stringView[i];
-        const COORD cursorPosBefore = cursor.GetPosition();
-        COORD proposedCursorPosition = cursorPosBefore;
-        bool notifyScroll = false;
+        const wchar_t wch = stringView[i];
+        COORD proposedCursorPosition = cursor.GetPosition();
 
         if (wch == UNICODE_LINEFEED)
         {
             proposedCursorPosition.Y++;
+            notifyScroll = _AdjustCursorPosition(proposedCursorPosition) || notifyScroll;
+            i++;
         }
         else if (wch == UNICODE_CARRIAGERETURN)
         {
             proposedCursorPosition.X = 0;
+            notifyScroll = _AdjustCursorPosition(proposedCursorPosition) || notifyScroll;
+            i++;
         }
         else if (wch == UNICODE_BACKSPACE)
         {
-            if (cursorPosBefore.X == 0)
+            if (proposedCursorPosition.X == 0)
             {
                 proposedCursorPosition.X = bufferSize.Width() - 1;
                 proposedCursorPosition.Y--;
@@ -340,91 +554,199 @@ void Terminal::_WriteBuffer(const std::wstring_view& stringView)
             {
                 proposedCursorPosition.X--;
             }
+            notifyScroll = _AdjustCursorPosition(proposedCursorPosition) || notifyScroll;
+            i++;
         }
         else
         {
-            // TODO: MSFT 21006766
-            // This is not great but I need it demoable. Fix by making a buffer stream writer.
-            if (wch >= 0xD800 && wch <= 0xDFFF)
-            {
-                OutputCellIterator it{ stringView.substr(i, 2) , _buffer->GetCurrentAttributes() };
-                const auto end = _buffer->Write(it);
-                const auto cellDistance = end.GetCellDistance(it);
-                i += cellDistance - 1;
-                proposedCursorPosition.X += gsl::narrow<SHORT>(cellDistance);
-            }
-            else
+            // Find the end of this run of printable text.
+            size_t runEnd = i + 1;
+            while (runEnd < stringView.size() &&
+                   stringView[runEnd] != UNICODE_LINEFEED &&
+                   stringView[runEnd] != UNICODE_CARRIAGERETURN &&
+                   stringView[runEnd] != UNICODE_BACKSPACE)
             {
-                OutputCellIterator it{ stringView.substr(i, 1) , _buffer->GetCurrentAttributes() };
-                const auto end = _buffer->Write(it);
-                const auto cellDistance = end.GetCellDistance(it);
-                proposedCursorPosition.X += gsl::narrow<SHORT>(cellDistance);
+                runEnd++;
             }
+
+            notifyScroll = _WriteRun(stringView.substr(i, runEnd - i)) || notifyScroll;
+            i = runEnd;
+        }
+    }
+
+    // The render target has already been told about each scroll as it
+    //      happened, so all that's left is to update the scrollbar.
+    if (notifyScroll)
+    {
+        _NotifyScrollEvent();
+    }
+}
+
+// Method Description:
+// - Writes a run of printable text at the cursor, a row at a time. When the
+//   text reaches the end of a row, the row is marked as wrapped, and the text
+//   continues at the start of the next one.
+// Arguments:
+// - run: the text to write. It shouldn't contain any control characters
+//   that move the cursor.
+// Return Value:
+// - true if the buffer or the viewport scrolled while writing the run.
+bool Terminal::_WriteRun(std::wstring_view run)
+{
+    auto& cursor = _buffer->GetCursor();
+    const auto width = _buffer->GetSize().Width();
+    const auto attributes = _buffer->GetCurrentAttributes();
+    bool notifyScroll = false;
+
+    // Plain text (the common case for cat and build logs) is copied straight into the rows.
+    const bool narrow = TextBuffer::IsNarrowText(run);
+
+    while (!run.empty())
+    {
+        COORD position = cursor.GetPosition();
+
+        // The last run ended exactly at the end of the row, so this one starts on the next.
+        if (position.X >= width)
+        {
+            notifyScroll = _AdjustCursorPosition({ 0, gsl::narrow<SHORT>(position.Y + 1) }) || notifyScroll;
+            position = cursor.GetPosition();
         }
 
-        // If we're about to scroll past the bottom of the buffer, instead cycle the buffer.
-        const auto newRows = proposedCursorPosition.Y - bufferSize.Height() + 1;
-        if (newRows > 0)
+        size_t consumed = 0;
+        SHORT cellsWritten = 0;
+        if (narrow)
         {
-            for(auto dy = 0; dy < newRows; dy++)
-            {
-                _buffer->IncrementCircularBuffer();
-                proposedCursorPosition.Y--;
-            }
-            notifyScroll = true;
+            consumed = _buffer->WriteNarrowLine(run, attributes, position, true);
+            cellsWritten = gsl::narrow<SHORT>(consumed);
+        }
+        else
+        {
+            const OutputCellIterator it{ run, attributes };
+            const auto end = _buffer->WriteLine(it, position, true);
+            consumed = gsl::narrow<size_t>(end.GetInputDistance(it));
+            cellsWritten = gsl::narrow<SHORT>(end.GetCellDistance(it));
         }
 
-        // This section is essentially equivalent to `AdjustCursorPosition`
-        // Update Cursor Position
-        cursor.SetPosition(proposedCursorPosition);
+        if (consumed == 0 && position.X == 0)
+        {
+            // Not even an empty row could fit the next glyph. Skip it, so that we don't loop forever.
+            run = run.substr(1);
+            continue;
+        }
 
-        const COORD cursorPosAfter = cursor.GetPosition();
+        run = run.substr(consumed);
 
-        // Move the viewport down if the cursor moved below the viewport.
-        if (cursorPosAfter.Y > _mutableViewport.BottomInclusive())
+        position.X += cellsWritten;
+        if (!run.empty())
         {
-            const auto newViewTop = std::max(0, cursorPosAfter.Y - (_mutableViewport.Height() - 1));
-            if (newViewTop != _mutableViewport.Top())
-            {
-                _mutableViewport = Viewport::FromDimensions({0, gsl::narrow<short>(newViewTop)}, _mutableViewport.Dimensions());
-                notifyScroll = true;
-            }
+            // There's more text than fits on this row, so continue on the next one.
+            position.X = 0;
+            position.Y++;
         }
+        notifyScroll = _AdjustCursorPosition(position) || notifyScroll;
+    }
+
+    return notifyScroll;
+}
 
-        if (notifyScroll)
+// Method Description:
+// - Moves the cursor to the given position. If that's past the bottom of the
+//   buffer, the buffer is cycled instead, and if it's below the viewport, the
+//   viewport is moved down to follow it.
+// - This is essentially equivalent to conhost's `AdjustCursorPosition`.
+// - The render target is told about any scrolling right away, the same way
+//   conhost's StreamScrollRegion does it, so that rows invalidated before and
+//   after the scroll all end up in the right place. The rest of the frame
+//   can then be moved, instead of being drawn all over again.
+// Arguments:
+// - proposedCursorPosition: where the cursor should move to
+// Return Value:
+// - true if the buffer or the viewport scrolled.
+bool Terminal::_AdjustCursorPosition(COORD proposedCursorPosition)
+{
+    auto& cursor = _buffer->GetCursor();
+    auto& renderTarget = _buffer->GetRenderTarget();
+    const Viewport bufferSize = _buffer->GetSize();
+    bool notifyScroll = false;
+
+    // If we're about to scroll past the bottom of the buffer, instead cycle the buffer.
+    const auto newRows = proposedCursorPosition.Y - bufferSize.Height() + 1;
+    if (newRows > 0)
+    {
+        for(auto dy = 0; dy < newRows; dy++)
         {
-            _buffer->GetRenderTarget().TriggerRedrawAll();
-            _NotifyScrollEvent();
+            _buffer->IncrementCircularBuffer();
+            proposedCursorPosition.Y--;
         }
+        notifyScroll = true;
+
+        // Everything moved up within the buffer, but the viewport stayed
+        //      where it was, so tell the renderer how far the contents moved,
+        //      and which rows at the bottom are new.
+        const SHORT scrolledRows = gsl::narrow<SHORT>(std::min<int>(newRows, bufferSize.Height()));
+        const COORD delta{ 0, gsl::narrow<SHORT>(-scrolledRows) };
+        renderTarget.TriggerScroll(&delta);
+        renderTarget.TriggerRedraw(Viewport::FromDimensions({ 0, gsl::narrow<SHORT>(bufferSize.Height() - scrolledRows) },
+                                                            { bufferSize.Width(), scrolledRows }));
     }
+
+    // Update Cursor Position
+    cursor.SetPosition(proposedCursorPosition);
+
+    const COORD cursorPosAfter = cursor.GetPosition();
+
+    // Move the viewport down if the cursor moved below the viewport.
+    if (cursorPosAfter.Y > _mutableViewport.BottomInclusive())
+    {
+        const auto newViewTop = std::max(0, cursorPosAfter.Y - (_mutableViewport.Height() - 1));
+        if (newViewTop != _mutableViewport.Top())
+        {
+            _mutableViewport = Viewport::FromDimensions({0, gsl::narrow<short>(newViewTop)}, _mutableViewport.Dimensions());
+            notifyScroll = true;
+
+            // The renderer works out how far the viewport moved by itself.
+            renderTarget.TriggerScroll();
+        }
+    }
+
+    return notifyScroll;
 }
 
 void Terminal::UserScrollViewport(const int viewTop)
 {
-    const auto clampedNewTop = std::max(0, viewTop);
-    const auto realTop = _ViewStartIndex();
-    const auto newDelta = realTop - clampedNewTop;
-    // if viewTop > realTop, we want the offset to be 0.
-
-    _scrollOffset = std::max(0, newDelta);
-    _buffer->GetRenderTarget().TriggerRedrawAll();
+    _primaryView.UserScrollViewport(viewTop);
 }
 
 int Terminal::GetScrollOffset()
 {
-    return _VisibleStartIndex();
+    return _primaryView.GetScrollOffset();
 }
 
+// Method Description:
+// - Tells the scrollbar of every view where its view is now.
 void Terminal::_NotifyScrollEvent()
 {
-    if (_pfnScrollPositionChanged)
+    for (auto* const view : _views.GetViews())
+    {
+        view->_NotifyScrollEvent();
+    }
+}
+
+// Method Description:
+// - Lets everyone know that _buffer now points at the other buffer. The whole
+//      screen has to be painted again, the scrollbar has a different buffer to
+//      scroll, and a selection in the old buffer doesn't mean anything anymore.
+void Terminal::_NotifyBufferSwitched()
+{
+    // The predictions were made in the other buffer.
+    _predictiveEcho.Reset(*_buffer);
+    for (auto* const view : _views.GetViews())
     {
-        const auto visible = _GetVisibleViewport();
-        const auto top = visible.Top();
-        const auto height = visible.Height();
-        const auto bottom = this->GetBufferHeight();
-        _pfnScrollPositionChanged(top, height, bottom);
+        view->ClearSelection();
     }
+    ClearSearch();
+    _buffer->GetRenderTarget().TriggerRedrawAll();
+    _NotifyScrollEvent();
 }
 
 void Terminal::SetWriteInputCallback(std::function<void(std::wstring&)> pfn) noexcept
@@ -439,51 +761,23 @@ void Terminal::SetTitleChangedCallback(std::function<void(const std::wstring_vie
 
 void Terminal::SetScrollPositionChangedCallback(std::function<void(const int, const int, const int)> pfn) noexcept
 {
-    _pfnScrollPositionChanged = pfn;
+    _primaryView.SetScrollPositionChangedCallback(pfn);
 }
 
-// Method Description:
-// - Checks if selection is active
-// Return Value:
-// - bool representing if selection is active. Used to decide copy/paste on right click
+// The selection is the primary view's. See TerminalView for each of these.
 const bool Terminal::IsSelectionActive() const noexcept
 {
-    return _selectionActive;
+    return _primaryView.IsSelectionActive();
 }
 
-// Method Description:
-// - Record the position of the beginning of a selection
-// Arguments:
-// - position: the (x,y) coordinate on the visible viewport
 void Terminal::SetSelectionAnchor(const COORD position)
 {
-    _selectionAnchor = position;
-
-    // include _scrollOffset here to ensure this maps to the right spot of the original viewport
-    THROW_IF_FAILED(ShortSub(_selectionAnchor.Y, gsl::narrow<SHORT>(_scrollOffset), &_selectionAnchor.Y));
-
-    // copy value of ViewStartIndex to support scrolling
-    // and update on new buffer output (used in _GetSelectionRects())
-    _selectionAnchor_YOffset = gsl::narrow<SHORT>(_ViewStartIndex());
-
-    _selectionActive = true;
-    SetEndSelectionPosition(position);
+    _primaryView.SetSelectionAnchor(position);
 }
 
-// Method Description:
-// - Record the position of the end of a selection
-// Arguments:
-// - position: the (x,y) coordinate on the visible viewport
 void Terminal::SetEndSelectionPosition(const COORD position)
 {
-    _endSelectionPosition = position;
-
-    // include _scrollOffset here to ensure this maps to the right spot of the original viewport
-    THROW_IF_FAILED(ShortSub(_endSelectionPosition.Y, gsl::narrow<SHORT>(_scrollOffset), &_endSelectionPosition.Y));
-
-    // copy value of ViewStartIndex to support scrolling
-    // and update on new buffer output (used in _GetSelectionRects())
-    _endSelectionPosition_YOffset = gsl::narrow<SHORT>(_ViewStartIndex());
+    _primaryView.SetEndSelectionPosition(position);
 }
 
 void Terminal::_InitializeColorTable()
@@ -495,105 +789,280 @@ void Terminal::_InitializeColorTable()
     ::Microsoft::Console::Utils::InitializeCampbellColorTable(tableView);
     // Then make sure all the values have an alpha of 255
     ::Microsoft::Console::Utils::SetColorTableAlpha(tableView, 0xff);
+
+    _UpdateResolvedColors();
 }
 
 // Method Description:
-// - Helper to determine the selected region of the buffer. Used for rendering.
+// - Works out the colors every attribute is painted with, from the color table
+//   and the default colors. Must be called whenever any of them change.
+void Terminal::_UpdateResolvedColors() noexcept
+{
+    _resolvedColors.Update({ &_colorTable[0], _colorTable.size() }, _defaultFg, _defaultBg);
+}
+
+void Terminal::SetBoxSelection(const bool isEnabled) noexcept
+{
+    _primaryView.SetBoxSelection(isEnabled);
+}
+
+void Terminal::ClearSelection() noexcept
+{
+    _primaryView.ClearSelection();
+}
+
+// Method Description:
+// - Finds every occurrence of a string in the buffer, and highlights them all
+//      until the next search or ClearSearch. The caller should hold the write lock.
+// - Lines are indexed as they're written, so find-as-you-type only has to look
+//      at the rows that might hold the query.
+// Arguments:
+// - query: the text to look for. An empty query clears the search.
+// - sensitivity: whether letters have to match in case
 // Return Value:
-// - A vector of rectangles representing the regions to select, line by line. They are absolute coordinates relative to the buffer origin.
-std::vector<SMALL_RECT> Terminal::_GetSelectionRects() const
+// - the number of matches that were found
+size_t Terminal::Search(const std::wstring_view query, const TerminalSearchIndex::Sensitivity sensitivity)
+{
+    _searchMatches = _searchIndex.FindAll(*_buffer, query, sensitivity);
+    _buffer->GetRenderTarget().TriggerSelection();
+    return _searchMatches.size();
+}
+
+// Method Description:
+// - Stops highlighting the matches of the last search.
+void Terminal::ClearSearch() noexcept
 {
-    std::vector<SMALL_RECT> selectionArea;
+    _searchMatches.clear();
+    _buffer->GetRenderTarget().TriggerSelection();
+}
 
-    if (!_selectionActive)
+// Method Description:
+// - Predicts the echo of a character that was just typed, so that it can be
+//      drawn before the connection echoes it back. Only the main buffer is
+//      predicted in - what's typed in a full-screen app is rarely echoed as it is.
+// Arguments:
+// - wch: the character that was typed
+// Return Value:
+// - true if the character was predicted. ExpirePredictedEcho should then be
+//      called every so often, until there's nothing left to expire.
+bool Terminal::PredictEcho(const wchar_t wch)
+{
+    if (!_predictiveEchoEnabled)
     {
-        return selectionArea;
+        return false;
     }
 
-    // Add anchor offset here to update properly on new buffer output
-    SHORT temp1, temp2;
-    THROW_IF_FAILED(ShortAdd(_selectionAnchor.Y, _selectionAnchor_YOffset, &temp1));
-    THROW_IF_FAILED(ShortAdd(_endSelectionPosition.Y, _endSelectionPosition_YOffset, &temp2));
-
-    // create these new anchors for comparison and rendering
-    const COORD selectionAnchorWithOffset = { _selectionAnchor.X, temp1 };
-    const COORD endSelectionPositionWithOffset = { _endSelectionPosition.X, temp2 };
+    auto lock = LockForWriting();
+    if (_buffer != _mainBuffer.get())
+    {
+        return false;
+    }
+    return _predictiveEcho.Predict(*_buffer, wch);
+}
 
-    // NOTE: (0,0) is top-left so vertical comparison is inverted
-    const COORD &higherCoord = (selectionAnchorWithOffset.Y <= endSelectionPositionWithOffset.Y) ? selectionAnchorWithOffset : endSelectionPositionWithOffset;
-    const COORD &lowerCoord = (selectionAnchorWithOffset.Y > endSelectionPositionWithOffset.Y) ? selectionAnchorWithOffset : endSelectionPositionWithOffset;
+// Method Description:
+// - Rolls back the predictions if they've gone unconfirmed for too long.
+// Return Value:
+// - true if there are still predictions waiting to be confirmed.
+bool Terminal::ExpirePredictedEcho()
+{
+    auto lock = LockForWriting();
+    return _predictiveEcho.Expire(*_buffer, std::chrono::steady_clock::now());
+}
 
-    selectionArea.reserve(lowerCoord.Y - higherCoord.Y + 1);
-    for (auto row = higherCoord.Y; row <= lowerCoord.Y; row++)
+// Method Description:
+// - Drops the predictions, for input that isn't plain text.
+void Terminal::ResetPredictedEcho()
+{
+    if (!_predictiveEchoEnabled)
     {
-        SMALL_RECT selectionRow;
+        return;
+    }
 
-        selectionRow.Top = row;
-        selectionRow.Bottom = row;
+    auto lock = LockForWriting();
+    _predictiveEcho.Reset(*_buffer);
+}
 
-        if (_boxSelection || higherCoord.Y == lowerCoord.Y)
-        {
-            selectionRow.Left = std::min(higherCoord.X, lowerCoord.X);
-            selectionRow.Right = std::max(higherCoord.X, lowerCoord.X);
-        }
-        else
-        {
-            selectionRow.Left = (row == higherCoord.Y) ? higherCoord.X : 0;
-            selectionRow.Right = (row == lowerCoord.Y) ? lowerCoord.X : _buffer->GetSize().RightInclusive();
-        }
+// Method Description:
+// - Starts recording the session to the given file: everything that's written
+//   to the terminal from here on, the input that's sent back, and every resize.
+//   This has to be called before any output is written. The recording starts
+//   with the size of the viewport.
+// Arguments:
+// - path: the file to record to. Whatever's there already is replaced.
+// Note: throws if the file can't be created
+void Terminal::StartRecording(const std::wstring& path)
+{
+    _recorder = std::make_unique<TerminalRecorder>(path);
+    _recorder->RecordResize(_mutableViewport.Dimensions());
+}
 
-        selectionArea.emplace_back(selectionRow);
+// Method Description:
+// - Records input that's being sent to the connection, if the session's being
+//   recorded. The terminal records what it sends itself - this is for whoever
+//   sends input to the connection without going through the terminal.
+// Arguments:
+// - text: the input
+void Terminal::RecordInput(const std::wstring_view text) noexcept
+{
+    if (_recorder)
+    {
+        _recorder->RecordInput(text);
     }
-    return selectionArea;
 }
 
 // Method Description:
-// - enable/disable box selection (ALT + selection)
+// - Starts exporting the main buffer's scrollback and what's on screen, spilled
+//   rows and all, to a file. The export goes on in the background, from a snapshot
+//   taken now, so output keeps coming in meanwhile. The caller should hold the
+//   write lock. An export that's still going from before is cancelled first.
+// - It's the main buffer that's exported even while the alt buffer is in use,
+//   since that's the one with the history.
 // Arguments:
-// - isEnabled: new value for _boxSelection
-void Terminal::SetBoxSelection(const bool isEnabled) noexcept
+// - path: the file to export to. Whatever's there already is replaced.
+// - format: whether to write plain text, VT or HTML
+// Return Value:
+// - the export, to follow its progress or wait for it. It's good until the next
+//   export is started, or the Terminal goes away.
+// Note: throws if the file can't be created
+TextBufferExport& Terminal::StartExport(const std::wstring& path, const TextBufferExport::Format format)
 {
-    _boxSelection = isEnabled;
+    // The old export only takes the spill's own lock, never ours, so it can be
+    //      waited for while we hold it.
+    _export.reset();
+    _export = std::make_unique<TextBufferExport>(*_mainBuffer, _resolvedColors, path, format);
+    return *_export;
 }
 
 // Method Description:
-// - clear selection data and disable rendering it
-void Terminal::ClearSelection() noexcept
+// - Stops the export that's going, if there is one, and waits for it to let go
+//   of the buffer. What it had written stays in the file.
+void Terminal::CancelExport() noexcept
 {
-    _selectionActive = false;
-    _selectionAnchor = {0, 0};
-    _endSelectionPosition = {0, 0};
-    _selectionAnchor_YOffset = 0;
-    _endSelectionPosition_YOffset = 0;
+    _export.reset();
+}
 
-    _buffer->GetRenderTarget().TriggerSelection();
+// Method Description:
+// - Estimates how much memory the Terminal's buffers are holding on to. The
+//      caller should hold the read lock.
+// Return Value:
+// - the number of bytes allocated by both the main and the alt buffer.
+size_t Terminal::GetMemoryUsage() const noexcept
+{
+    return _mainBuffer->GetMemoryUsage() + _altBuffer->GetMemoryUsage();
 }
 
 // Method Description:
-// - get wstring text from highlighted portion of text buffer
+// - Tries to bring the Terminal's memory usage down to the given target, by giving
+//      up the oldest scrollback first. The caller should hold the write lock.
+// - First, every row of scrollback is packed into cold storage, which keeps its text
+//      but gives up its cells. If that isn't enough, the oldest rows are cleared, a
+//      block at a time. Neither step touches the main viewport or whatever part of
+//      the scrollback is on screen.
 // Arguments:
-// - trimTrailingWhitespace: enable removing any whitespace from copied selection
-//    and get text to appear on separate lines.
+// - target: the number of bytes to get down to
 // Return Value:
-// - wstring text from buffer. If extended to multiple lines, each line is separated by \r\n
-const std::wstring Terminal::RetrieveSelectedTextFromBuffer(bool trimTrailingWhitespace) const
+// - the number of bytes used once done. This may still be over the target.
+size_t Terminal::TrimMemoryUsage(const size_t target)
+{
+    auto usage = GetMemoryUsage();
+    if (usage <= target)
+    {
+        return usage;
+    }
+
+    const bool inAltBuffer = _buffer == _altBuffer.get();
+    const auto& mainViewport = inAltBuffer ? _mainViewport : _mutableViewport;
+    // Whatever any of the views show is kept.
+    auto keepTop = mainViewport.Top();
+    if (!inAltBuffer)
+    {
+        for (const auto* const view : _views.GetViews())
+        {
+            keepTop = std::min(keepTop, view->_VisibleStartIndex());
+        }
+    }
+    const size_t scrollback = gsl::narrow<size_t>(std::max(0, keepTop));
+
+    const size_t height = gsl::narrow<size_t>(_mainBuffer->GetSize().Height());
+    const size_t hotRows = std::max<size_t>(1, height - scrollback);
+    if (hotRows < _mainBuffer->GetHotRowCount())
+    {
+        _mainBuffer->SetHotRowCount(hotRows);
+        usage = GetMemoryUsage();
+    }
+
+    for (size_t cleared = 0; usage > target && cleared < scrollback;)
+    {
+        cleared = std::min(cleared + s_TrimBlockRows, scrollback);
+        _mainBuffer->ClearOldestRows(cleared);
+        usage = GetMemoryUsage();
+    }
+
+    return usage;
+}
+
+// Method Description:
+// - Gets the total time that Write has spent waiting for the lock, while
+//      somebody else (usually the UI thread or the renderer) held it. This can
+//      be called without holding the lock.
+// Return Value:
+// - The time spent waiting, since the terminal was created.
+std::chrono::nanoseconds Terminal::GetWriteLockWaitTime() const noexcept
 {
-    std::function<COLORREF(TextAttribute&)> GetForegroundColor = std::bind(&Terminal::GetForegroundColor, this, std::placeholders::_1);
-    std::function<COLORREF(TextAttribute&)> GetBackgroundColor = std::bind(&Terminal::GetBackgroundColor, this, std::placeholders::_1);
+    return std::chrono::nanoseconds{ _writeLockWaitTime.load(std::memory_order_relaxed) };
+}
 
-    auto data = _buffer->GetTextForClipboard(!_boxSelection,
-                                             trimTrailingWhitespace,
-                                             _GetSelectionRects(),
-                                             GetForegroundColor,
-                                             GetBackgroundColor);
+// Method Description:
+// - Helper to determine which matches of the last search are in view. Matches on
+//      rows that have since been written to aren't shown.
+// Arguments:
+// - visible: the part of the buffer that's on screen, in the view that asked
+// - spilledAbove: how many of the rows the buffer spilled that view shows above
+//      the top of the buffer. Everything in it is moved down by as many rows.
+// Return Value:
+// - A rectangle for each visible match, in absolute coordinates relative to the buffer origin.
+std::vector<SMALL_RECT> Terminal::_GetSearchHighlightRects(const Viewport& visible, const int spilledAbove) const
+{
+    std::vector<SMALL_RECT> highlights;
 
-    std::wstring result;
-    for (const auto& text : data.text)
+    const auto circled = _buffer->GetCircledRowCount();
+    const auto spilled = _buffer->GetSpilledRowCount();
+    for (const auto& match : _searchMatches)
     {
-        result += text;
+        // Spilled rows are above the top of the buffer, the last one spilled at -1.
+        int64_t offset;
+        if (match.spilled)
+        {
+            offset = static_cast<int64_t>(match.row) - static_cast<int64_t>(spilled);
+        }
+        else if (match.row >= circled)
+        {
+            offset = static_cast<int64_t>(match.row - circled);
+        }
+        else
+        {
+            continue;
+        }
+
+        const auto shown = offset + spilledAbove;
+        if (shown < visible.Top() ||
+            shown > visible.BottomInclusive() ||
+            (!match.spilled && _buffer->GetRowGeneration(gsl::narrow<size_t>(offset)) != match.generation))
+        {
+            continue;
+        }
+
+        const auto row = gsl::narrow<SHORT>(shown);
+        highlights.push_back({ match.startColumn, row, match.endColumn, row });
     }
 
-    return result;
+    return highlights;
+}
+
+const std::wstring Terminal::RetrieveSelectedTextFromBuffer(bool trimTrailingWhitespace) const
+{
+    return _primaryView.RetrieveSelectedTextFromBuffer(trimTrailingWhitespace);
 }
 
 // Method Description:
@@ -6,6 +6,8 @@
 #include <conattrs.hpp>
 
 #include "../../buffer/out/textBuffer.hpp"
+#include "../../buffer/out/ResolvedColorTable.hpp"
+#include "../../buffer/out/TextBufferExport.hpp"
 #include "../../renderer/inc/IRenderData.hpp"
 #include "../../terminal/parser/StateMachine.hpp"
 #include "../../terminal/input/terminalInput.hpp"
@@ -13,6 +15,10 @@
 #include "../../types/inc/Viewport.hpp"
 #include "../../cascadia/terminalcore/ITerminalApi.hpp"
 #include "../../cascadia/terminalcore/ITerminalInput.hpp"
+#include "TerminalSearchIndex.hpp"
+#include "TerminalPredictiveEcho.hpp"
+#include "TerminalRecorder.hpp"
+#include "TerminalView.hpp"
 
 // You have to forward decl the ICoreSettings here, instead of including the header.
 // If you include the header, there will be compilation errors with other
@@ -25,6 +31,7 @@ namespace winrt::Microsoft::Terminal::Settings
 namespace Microsoft::Terminal::Core
 {
     class Terminal;
+    class TerminalRenderFrame;
 }
 
 class Microsoft::Terminal::Core::Terminal final :
@@ -47,6 +54,7 @@ public:
 
     // Write goes through the parser
     void Write(std::wstring_view stringView);
+    void Write(std::string_view utf8);
 
     [[nodiscard]]
     std::shared_lock<std::shared_mutex> LockForReading();
@@ -55,6 +63,8 @@ public:
 
     short GetBufferHeight() const noexcept;
 
+    TerminalView& GetPrimaryView() noexcept;
+
     #pragma region ITerminalApi
     // These methods are defined in TerminalApi.cpp
     bool PrintString(std::wstring_view stringView) override;
@@ -66,12 +76,19 @@ public:
     bool BoldText(bool boldOn) override;
     bool UnderlineText(bool underlineOn) override;
     bool ReverseText(bool reversed) override;
+    TextAttribute GetTextAttributes() const override;
+    bool SetTextAttributes(const TextAttribute& attrs) override;
     bool SetCursorPosition(short x, short y) override;
     COORD GetCursorPosition() override;
     bool EraseCharacters(const unsigned int numChars) override;
     bool SetWindowTitle(std::wstring_view title) override;
     bool SetColorTableEntry(const size_t tableIndex, const DWORD dwColor) override;
     bool SetCursorStyle(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::CursorStyle cursorStyle) override;
+    bool UseAlternateScreenBuffer() override;
+    bool UseMainScreenBuffer() override;
+    bool EnableBracketedPasteMode(const bool enabled) override;
+    bool AddHyperlink(std::wstring_view uri, std::wstring_view id) override;
+    bool EndHyperlink() override;
     #pragma endregion
 
     #pragma region ITerminalInput
@@ -80,6 +97,7 @@ public:
                       const bool ctrlPressed,
                       const bool altPressed,
                       const bool shiftPressed) override;
+    void SendPaste(std::wstring_view text) override;
     [[nodiscard]]
     HRESULT UserResize(const COORD viewportSize) noexcept override;
     void UserScrollViewport(const int viewTop) override;
@@ -127,10 +145,44 @@ public:
     const std::wstring RetrieveSelectedTextFromBuffer(bool trimTrailingWhitespace) const;
     #pragma endregion
 
+    #pragma region Search
+    size_t Search(const std::wstring_view query, const TerminalSearchIndex::Sensitivity sensitivity);
+    void ClearSearch() noexcept;
+    #pragma endregion
+
+    #pragma region PredictiveEcho
+    bool PredictEcho(const wchar_t wch);
+    bool ExpirePredictedEcho();
+    void ResetPredictedEcho();
+    #pragma endregion
+
+    #pragma region Recording
+    void StartRecording(const std::wstring& path);
+    void RecordInput(const std::wstring_view text) noexcept;
+    #pragma endregion
+
+    #pragma region Export
+    TextBufferExport& StartExport(const std::wstring& path, const TextBufferExport::Format format);
+    void CancelExport() noexcept;
+    #pragma endregion
+
+    #pragma region Memory
+    size_t GetMemoryUsage() const noexcept;
+    size_t TrimMemoryUsage(const size_t target);
+    #pragma endregion
+
+    #pragma region Counters
+    std::chrono::nanoseconds GetWriteLockWaitTime() const noexcept;
+    #pragma endregion
+
   private:
+    // The frame copies what it needs to paint straight out of the Terminal, under the Terminal's lock.
+    friend class TerminalRenderFrame;
+    // Each view works out what it shows from the Terminal's viewport and buffer.
+    friend class TerminalView;
+
     std::function<void(std::wstring&)> _pfnWriteInput;
     std::function<void(const std::wstring_view&)> _pfnTitleChanged;
-    std::function<void(const int, const int, const int)> _pfnScrollPositionChanged;
 
     std::unique_ptr<::Microsoft::Console::VirtualTerminal::StateMachine> _stateMachine;
     std::unique_ptr<::Microsoft::Console::VirtualTerminal::TerminalInput> _terminalInput;
@@ -141,52 +193,79 @@ public:
     COLORREF _defaultFg;
     COLORREF _defaultBg;
 
+    // The colors above, resolved for painting. Updated by _UpdateResolvedColors
+    //      whenever any of them change.
+    ResolvedColorTable _resolvedColors;
+
     bool _snapOnInput;
 
-    // Text Selection
-    COORD _selectionAnchor;
-    COORD _endSelectionPosition;
-    bool _boxSelection;
-    bool _selectionActive;
-    SHORT _selectionAnchor_YOffset;
-    SHORT _endSelectionPosition_YOffset;
+    // Search. Every match of the last search is highlighted along with the selection.
+    TerminalSearchIndex _searchIndex;
+    std::vector<TerminalSearchIndex::Match> _searchMatches;
 
-    std::shared_mutex _readWriteLock;
+    // What's been typed but not echoed yet, drawn at the cursor in the meantime.
+    //      Only used if the settings turn it on.
+    bool _predictiveEchoEnabled;
+    TerminalPredictiveEcho _predictiveEcho;
 
-    // TODO: These members are not shared by an alt-buffer. They should be
-    //      encapsulated, such that a Terminal can have both a main and alt buffer.
-    std::unique_ptr<TextBuffer> _buffer;
+    std::shared_mutex _readWriteLock;
+    // The number of threads that are waiting to take _readWriteLock. Write uses
+    //      this to hand the lock over between slices of a long write.
+    std::atomic<size_t> _lockWaiters;
+    static constexpr size_t s_WriteSliceSize = 16 * 1024;
+    // The total time Write has spent waiting for someone else to let go of _readWriteLock.
+    std::atomic<std::chrono::nanoseconds::rep> _writeLockWaitTime;
+
+    // how many rows of scrollback TrimMemoryUsage clears at a time.
+    static constexpr size_t s_TrimBlockRows = 1000;
+
+    // Records the session, if the settings asked for it. Only set up before any
+    //      output is written, so the output thread never sees it change.
+    std::unique_ptr<TerminalRecorder> _recorder;
+
+    // The main buffer holds the scrollback. The alt buffer is only as big as the viewport.
+    //      It's allocated along with the main buffer and reused every time an app switches
+    //      to it, so switching buffers is just a matter of changing where _buffer points.
+    std::unique_ptr<TextBuffer> _mainBuffer;
+    std::unique_ptr<TextBuffer> _altBuffer;
+    TextBuffer* _buffer; // Non-ownership pointer to the buffer in use
+
+    // The export of the main buffer that was started last, if any. It reads from
+    //      the main buffer's spill, so it's declared after it, to go away first.
+    std::unique_ptr<TextBufferExport> _export;
     Microsoft::Console::Types::Viewport _mutableViewport;
     SHORT _scrollbackLines;
 
-    // _scrollOffset is the number of lines above the viewport that are currently visible
-    // If _scrollOffset is 0, then the visible region of the buffer is the viewport.
-    int _scrollOffset;
-    // TODO this might not be the value we want to store.
-    // We might want to store the height in the scrollback that's currenty visible.
-    // Think on this some more.
-    // For example: While looking at the scrollback, we probably want the visible region to "stick"
-    //   to the region they scrolled to. If that were the case, then every time we move _mutableViewport,
-    //   we'd also need to update _offset.
-    // However, if we just stored it as a _visibleTop, then that point would remain fixed -
-    //      Though if _visibleTop == _mutableViewport.Top, then we'd need to make sure to update
-    //      _visibleTop as well.
-    // Additionally, maybe some people want to scroll into the history, then have that scroll out from
-    //      underneath them, while others would prefer to anchor it in place.
-    //      Either way, we sohould make this behavior controlled by a setting.
-
-    int _ViewStartIndex() const noexcept;
-    int _VisibleStartIndex() const noexcept;
+    // Where the main buffer's viewport was while the alt buffer is in use.
+    Microsoft::Console::Types::Viewport _mainViewport;
+
+    // Every view that's showing the Terminal. The buffers send their render
+    //      notifications here, to be handed on to each view's renderer.
+    TerminalViewGroup _views;
+    // The view the Terminal's own scrolling and selection methods use. Where each
+    //      view is scrolled to and what's selected in it is kept in the view.
+    TerminalView _primaryView;
 
     Microsoft::Console::Types::Viewport _GetMutableViewport() const noexcept;
-    Microsoft::Console::Types::Viewport _GetVisibleViewport() const noexcept;
 
     void _InitializeColorTable();
+    void _UpdateResolvedColors() noexcept;
 
+    template<typename TChar>
+    void _ParseOutput(std::basic_string_view<TChar> output);
     void _WriteBuffer(const std::wstring_view& stringView);
+    bool _WriteRun(std::wstring_view run);
+    bool _AdjustCursorPosition(COORD proposedCursorPosition);
+
+    bool _SendKeyEvent(const WORD vkey,
+                       const bool ctrlPressed,
+                       const bool altPressed,
+                       const bool shiftPressed);
+    void _SendPaste(std::wstring_view text);
 
     void _NotifyScrollEvent();
+    void _NotifyBufferSwitched();
 
-    std::vector<SMALL_RECT> _GetSelectionRects() const;
+    std::vector<SMALL_RECT> _GetSearchHighlightRects(const Microsoft::Console::Types::Viewport& visible, const int spilledAbove) const;
 };
 
@@ -100,6 +100,17 @@ bool Terminal::ReverseText(bool reversed)
     return true;
 }
 
+TextAttribute Terminal::GetTextAttributes() const
+{
+    return _buffer->GetCurrentAttributes();
+}
+
+bool Terminal::SetTextAttributes(const TextAttribute& attrs)
+{
+    _buffer->SetCurrentAttributes(attrs);
+    return true;
+}
+
 bool Terminal::SetCursorPosition(short x, short y)
 {
     const auto viewport = _GetMutableViewport();
@@ -164,6 +175,7 @@ bool Terminal::SetColorTableEntry(const size_t tableIndex, const DWORD dwColor)
         return false;
     }
     _colorTable.at(tableIndex) = dwColor;
+    _UpdateResolvedColors();
 
     // Repaint everything - the colors might have changed
     _buffer->GetRenderTarget().TriggerRedrawAll();
@@ -219,3 +231,115 @@ bool Terminal::SetCursorStyle(const DispatchTypes::CursorStyle cursorStyle)
 
     return true;
 }
+
+// Method Description:
+// - Switches to the alternate screen buffer (DECSET 1049). The alt buffer has no
+//   scrollback, so a full-screen app doesn't leave anything behind in the main
+//   buffer's history. It's cleared rather than created each time, so this doesn't allocate.
+// - Like xterm, the cursor stays where it is on the screen, and the current
+//   rendition carries over. The main buffer's cursor stays put, ready for when
+//   we switch back.
+// Return Value:
+// - true iff we're now using the alt buffer.
+bool Terminal::UseAlternateScreenBuffer()
+{
+    if (_buffer == _altBuffer.get())
+    {
+        return true;
+    }
+
+    const auto mainCursorPosition = _mainBuffer->GetCursor().GetPosition();
+    const auto viewOrigin = _mutableViewport.Origin();
+
+    _altBuffer->SetCurrentAttributes(_altBuffer->ImportAttributes(*_mainBuffer, _mainBuffer->GetCurrentAttributes()));
+    _altBuffer->Reset();
+    _altBuffer->CopyProperties(*_mainBuffer);
+    _altBuffer->GetCursor().SetPosition({ gsl::narrow<SHORT>(mainCursorPosition.X - viewOrigin.X),
+                                          gsl::narrow<SHORT>(mainCursorPosition.Y - viewOrigin.Y) });
+
+    _mainViewport = _mutableViewport;
+    _mutableViewport = Viewport::FromDimensions({ 0, 0 }, _mutableViewport.Dimensions());
+    for (auto* const view : _views.GetViews())
+    {
+        view->_SwitchBuffer(true);
+    }
+
+    _buffer = _altBuffer.get();
+    _NotifyBufferSwitched();
+    return true;
+}
+
+// Method Description:
+// - Switches back to the main screen buffer (DECRST 1049), exactly as it was left.
+//   Anything that was written to the alt buffer is thrown away the next time it's used.
+// Return Value:
+// - true iff we're now using the main buffer.
+bool Terminal::UseMainScreenBuffer()
+{
+    if (_buffer == _mainBuffer.get())
+    {
+        return true;
+    }
+
+    // Keep whatever the app did to the cursor's style while it was in the alt buffer.
+    _mainBuffer->CopyProperties(*_altBuffer);
+
+    _mutableViewport = _mainViewport;
+    for (auto* const view : _views.GetViews())
+    {
+        view->_SwitchBuffer(false);
+    }
+
+    _buffer = _mainBuffer.get();
+    _NotifyBufferSwitched();
+    return true;
+}
+
+// Method Description:
+// - Turns bracketed paste mode (DECSET 2004) on or off. While it's on, text
+//   that's pasted is sent between ESC [ 200 ~ and ESC [ 201 ~.
+// Arguments:
+// - enabled: true to turn it on, false to turn it off.
+// Return Value:
+// - true
+bool Terminal::EnableBracketedPasteMode(const bool enabled)
+{
+    _terminalInput->ChangeBracketedPasteMode(enabled);
+    return true;
+}
+
+// Method Description:
+// - Starts a hyperlink (OSC 8). The text that's written from here on is part of
+//   the link, until it's ended or another one's started. SGR doesn't end it.
+// - The URI is only stored once in the buffer, however much text is in the link.
+// Arguments:
+// - uri: where the link goes
+// - id: the id the application gave the link, if any. Pieces of text with the
+//      same URI and id are the same link, even if there's other text between them.
+// Return Value:
+// - true iff the text is a link now. It might not be if the buffer can't hold any more.
+bool Terminal::AddHyperlink(std::wstring_view uri, std::wstring_view id)
+{
+    try
+    {
+        TextAttribute attrs = _buffer->GetCurrentAttributes();
+        attrs.SetHyperlinkId(_buffer->AddHyperlink(uri, id));
+        _buffer->SetCurrentAttributes(attrs);
+        return attrs.IsHyperlink();
+    }
+    CATCH_LOG();
+    return false;
+}
+
+// Method Description:
+// - Ends the hyperlink (OSC 8 with an empty URI), so the text that's written
+//   from here on isn't part of it.
+// Return Value:
+// - true
+bool Terminal::EndHyperlink()
+{
+    TextAttribute attrs = _buffer->GetCurrentAttributes();
+    attrs.SetHyperlinkId(0);
+    _buffer->SetCurrentAttributes(attrs);
+    return true;
+}
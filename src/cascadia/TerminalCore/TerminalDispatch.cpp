@@ -75,3 +75,104 @@ bool TerminalDispatch::SetCursorStyle(const DispatchTypes::CursorStyle cursorSty
 {
     return _terminalApi.SetCursorStyle(cursorStyle);
 }
+
+// Routine Description:
+// - DECSET - Enables the given DEC private modes.
+// Arguments:
+// - rgParams - array of params to set
+// - cParams - length of rgParams
+// Return Value:
+// - True if ALL params were handled successfully. False otherwise.
+bool TerminalDispatch::SetPrivateModes(_In_reads_(cParams) const DispatchTypes::PrivateModeParams* const rgParams,
+                                       const size_t cParams)
+{
+    return _SetResetPrivateModes(rgParams, cParams, true);
+}
+
+// Routine Description:
+// - DECRST - Disables the given DEC private modes.
+// Arguments:
+// - rgParams - array of params to reset
+// - cParams - length of rgParams
+// Return Value:
+// - True if ALL params were handled successfully. False otherwise.
+bool TerminalDispatch::ResetPrivateModes(_In_reads_(cParams) const DispatchTypes::PrivateModeParams* const rgParams,
+                                         const size_t cParams)
+{
+    return _SetResetPrivateModes(rgParams, cParams, false);
+}
+
+bool TerminalDispatch::UseAlternateScreenBuffer()
+{
+    return _terminalApi.UseAlternateScreenBuffer();
+}
+
+bool TerminalDispatch::UseMainScreenBuffer()
+{
+    return _terminalApi.UseMainScreenBuffer();
+}
+
+bool TerminalDispatch::EnableBracketedPasteMode(const bool fEnabled)
+{
+    return _terminalApi.EnableBracketedPasteMode(fEnabled);
+}
+
+bool TerminalDispatch::AddHyperlink(const std::wstring_view uri, const std::wstring_view id)
+{
+    return _terminalApi.AddHyperlink(uri, id);
+}
+
+bool TerminalDispatch::EndHyperlink()
+{
+    return _terminalApi.EndHyperlink();
+}
+
+// Routine Description:
+// - Generalized handler for the setting/resetting of DECSET/DECRST parameters.
+//     All params in the rgParams will attempt to be executed, even if one
+//     fails, so that the ones we support still take effect when they're
+//     chained with ones we don't.
+// Arguments:
+// - rgParams - array of params to set/reset
+// - cParams - length of rgParams
+// - fEnable - true for DECSET, false for DECRST
+// Return Value:
+// - True if ALL params were handled successfully. False otherwise.
+bool TerminalDispatch::_SetResetPrivateModes(_In_reads_(cParams) const DispatchTypes::PrivateModeParams* const rgParams,
+                                             const size_t cParams,
+                                             const bool fEnable)
+{
+    size_t cFailures = 0;
+    for (size_t i = 0; i < cParams; i++)
+    {
+        cFailures += _PrivateModeParamsHelper(rgParams[i], fEnable) ? 0 : 1;
+    }
+    return cFailures == 0;
+}
+
+// Routine Description:
+// - Sets or resets a single DEC private mode.
+// Arguments:
+// - param - the mode to set/reset
+// - fEnable - true for DECSET, false for DECRST
+// Return Value:
+// - True if handled successfully. False otherwise.
+bool TerminalDispatch::_PrivateModeParamsHelper(const DispatchTypes::PrivateModeParams param,
+                                                const bool fEnable)
+{
+    bool fSuccess = false;
+    switch (param)
+    {
+    case DispatchTypes::PrivateModeParams::ASB_AlternateScreenBuffer:
+        fSuccess = fEnable ? UseAlternateScreenBuffer() : UseMainScreenBuffer();
+        break;
+    case DispatchTypes::PrivateModeParams::XTERM_BracketedPasteMode:
+        fSuccess = EnableBracketedPasteMode(fEnable);
+        break;
+    default:
+        // If no functions to call, overall dispatch was a failure.
+        fSuccess = false;
+        break;
+    }
+    return fSuccess;
+}
@@ -27,18 +27,39 @@ public:
     bool SetColorTableEntry(const size_t tableIndex, const DWORD dwColor) override;
     bool SetCursorStyle(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::CursorStyle cursorStyle) override;
 
+    bool SetPrivateModes(_In_reads_(cParams) const ::Microsoft::Console::VirtualTerminal::DispatchTypes::PrivateModeParams* const rgParams,
+                         const size_t cParams) override; // DECSET
+    bool ResetPrivateModes(_In_reads_(cParams) const ::Microsoft::Console::VirtualTerminal::DispatchTypes::PrivateModeParams* const rgParams,
+                           const size_t cParams) override; // DECRST
+    bool UseAlternateScreenBuffer() override; // ASBSET
+    bool UseMainScreenBuffer() override; // ASBRST
+    bool EnableBracketedPasteMode(const bool fEnabled) override; // ?2004
+    bool AddHyperlink(const std::wstring_view uri, const std::wstring_view id) override; // OSCHyperlink
+    bool EndHyperlink() override; // OSCHyperlink
+
 private:
     ::Microsoft::Terminal::Core::ITerminalApi& _terminalApi;
 
+    bool _SetResetPrivateModes(_In_reads_(cParams) const ::Microsoft::Console::VirtualTerminal::DispatchTypes::PrivateModeParams* const rgParams,
+                               const size_t cParams,
+                               const bool fEnable);
+    bool _PrivateModeParamsHelper(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::PrivateModeParams param,
+                                  const bool fEnable);
+
     static bool s_IsRgbColorOption(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::GraphicsOptions opt) noexcept;
     static bool s_IsBoldColorOption(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::GraphicsOptions opt) noexcept;
     static bool s_IsDefaultColorOption(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::GraphicsOptions opt) noexcept;
 
     bool _SetRgbColorsHelper(_In_reads_(cOptions) const ::Microsoft::Console::VirtualTerminal::DispatchTypes::GraphicsOptions* const rgOptions,
                              const size_t cOptions,
-                             _Out_ size_t* const pcOptionsConsumed);
-    bool _SetBoldColorHelper(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::GraphicsOptions option);
-    bool _SetDefaultColorHelper(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::GraphicsOptions option);
-    void _SetGraphicsOptionHelper(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::GraphicsOptions opt);
+                             _Out_ size_t* const pcOptionsConsumed,
+                             TextAttribute& attrs);
+    bool _SetBoldColorHelper(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::GraphicsOptions option,
+                             TextAttribute& attrs);
+    bool _SetDefaultColorHelper(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::GraphicsOptions option,
+                                TextAttribute& attrs);
+    bool _SetGraphicsOptionHelper(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::GraphicsOptions opt,
+                                  TextAttribute& attrs);
+    static void s_UpdateMetaAttribute(TextAttribute& attrs, const WORD flag, const bool on) noexcept;
 
 };
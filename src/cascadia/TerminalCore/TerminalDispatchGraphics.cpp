@@ -70,6 +70,7 @@ bool TerminalDispatch::s_IsDefaultColorOption(const DispatchTypes::GraphicsOptio
 // - rgOptions - An array of options that will be used to generate the RGB color
 // - cOptions - The count of options
 // - pcOptionsConsumed - a pointer to place the number of options we consumed parsing this option.
+// - attrs - the attributes to apply the color to.
 // Return Value:
 // Returns true if we successfully parsed an extended color option from the options array.
 // - This corresponds to the following number of options consumed (pcOptionsConsumed):
@@ -79,7 +80,8 @@ bool TerminalDispatch::s_IsDefaultColorOption(const DispatchTypes::GraphicsOptio
 //     5 - true, parsed an RGB color.
 bool TerminalDispatch::_SetRgbColorsHelper(_In_reads_(cOptions) const DispatchTypes::GraphicsOptions* const rgOptions,
                           const size_t cOptions,
-                          _Out_ size_t* const pcOptionsConsumed)
+                          _Out_ size_t* const pcOptionsConsumed,
+                          TextAttribute& attrs)
 {
     COLORREF color = 0;
     bool isForeground = false;
@@ -111,44 +113,82 @@ bool TerminalDispatch::_SetRgbColorsHelper(_In_reads_(cOptions) const DispatchTy
 
             color = RGB(red, green, blue);
 
-            fSuccess = _terminalApi.SetTextRgbColor(color, isForeground);
+            attrs.SetColor(color, isForeground);
+            fSuccess = true;
         }
         else if (typeOpt == DispatchTypes::GraphicsOptions::Xterm256Index && cOptions >= 3)
         {
             *pcOptionsConsumed = 3;
             if (rgOptions[2] <= 255) // ensure that the provided index is on the table
             {
-                unsigned int tableIndex = rgOptions[2];
-                fSuccess = isForeground ?
-                                _terminalApi.SetTextForegroundIndex((BYTE)tableIndex) :
-                                _terminalApi.SetTextBackgroundIndex((BYTE)tableIndex);
+                const BYTE tableIndex = static_cast<BYTE>(rgOptions[2]);
+                if (isForeground)
+                {
+                    attrs.SetIndexedAttributes({ tableIndex }, {});
+                }
+                else
+                {
+                    attrs.SetIndexedAttributes({}, { tableIndex });
+                }
+                fSuccess = true;
             }
         }
     }
     return fSuccess;
 }
 
-bool TerminalDispatch::_SetBoldColorHelper(const DispatchTypes::GraphicsOptions option)
+bool TerminalDispatch::_SetBoldColorHelper(const DispatchTypes::GraphicsOptions option,
+                                           TextAttribute& attrs)
 {
-    const bool bold = (option == DispatchTypes::GraphicsOptions::BoldBright);
-    return _terminalApi.BoldText(bold);
+    if (option == DispatchTypes::GraphicsOptions::BoldBright)
+    {
+        attrs.Embolden();
+    }
+    else
+    {
+        attrs.Debolden();
+    }
+    return true;
 }
 
-bool TerminalDispatch::_SetDefaultColorHelper(const DispatchTypes::GraphicsOptions option)
+bool TerminalDispatch::_SetDefaultColorHelper(const DispatchTypes::GraphicsOptions option,
+                                              TextAttribute& attrs)
 {
     const bool fg = option == DispatchTypes::GraphicsOptions::Off || option == DispatchTypes::GraphicsOptions::ForegroundDefault;
     const bool bg = option == DispatchTypes::GraphicsOptions::Off || option == DispatchTypes::GraphicsOptions::BackgroundDefault;
-    bool success = _terminalApi.SetTextToDefaults(fg, bg);
+    if (fg)
+    {
+        attrs.SetDefaultForeground();
+    }
+    if (bg)
+    {
+        attrs.SetDefaultBackground();
+    }
 
-    if (success && fg && bg)
+    if (fg && bg)
     {
         // If we're resetting both the FG & BG, also reset the meta attributes (underline)
         //      as well as the boldness
-        success = _terminalApi.UnderlineText(false) &&
-                  _terminalApi.ReverseText(false) &&
-                  _terminalApi.BoldText(false);
+        s_UpdateMetaAttribute(attrs, COMMON_LVB_UNDERSCORE, false);
+        s_UpdateMetaAttribute(attrs, COMMON_LVB_REVERSE_VIDEO, false);
+        attrs.Debolden();
     }
-    return success;
+    return true;
+}
+
+// Routine Description:
+// - Sets or clears one of the meta attributes (underline, reverse video) on the given attributes.
+// Arguments:
+// - attrs - the attributes to update
+// - flag - the COMMON_LVB_* flag to update
+// - on - whether the flag should be set
+// Return Value:
+// - <none>
+void TerminalDispatch::s_UpdateMetaAttribute(TextAttribute& attrs, const WORD flag, const bool on) noexcept
+{
+    WORD metaAttrs = attrs.GetMetaAttributes();
+    WI_UpdateFlag(metaAttrs, flag, on);
+    attrs.SetMetaAttributes(metaAttrs);
 }
 
 // Routine Description:
@@ -156,11 +196,13 @@ bool TerminalDispatch::_SetDefaultColorHelper(const DispatchTypes::GraphicsOptio
 // - Placed as a helper so it can be recursive/re-entrant for some of the convenience flag methods that perform similar/multiple operations in one command.
 // Arguments:
 // - opt - Graphics option sent to us by the parser/requestor.
-// - pAttr - Pointer to the font attribute field to adjust
+// - attrs - the attributes to adjust
 // Return Value:
-// - <none>
-void TerminalDispatch::_SetGraphicsOptionHelper(const DispatchTypes::GraphicsOptions opt)
+// - true if the option was recognized and applied, false otherwise.
+bool TerminalDispatch::_SetGraphicsOptionHelper(const DispatchTypes::GraphicsOptions opt,
+                                                TextAttribute& attrs)
 {
+    bool fSuccess = true;
     switch (opt)
     {
     case DispatchTypes::GraphicsOptions::Off:
@@ -170,125 +212,140 @@ void TerminalDispatch::_SetGraphicsOptionHelper(const DispatchTypes::GraphicsOpt
     // case DispatchTypes::GraphicsOptions::BoldBright:
     // case DispatchTypes::GraphicsOptions::UnBold:
     case DispatchTypes::GraphicsOptions::Negative:
-        _terminalApi.ReverseText(true);
+        s_UpdateMetaAttribute(attrs, COMMON_LVB_REVERSE_VIDEO, true);
         break;
     case DispatchTypes::GraphicsOptions::Underline:
-        _terminalApi.UnderlineText(true);
+        s_UpdateMetaAttribute(attrs, COMMON_LVB_UNDERSCORE, true);
         break;
     case DispatchTypes::GraphicsOptions::Positive:
-        _terminalApi.ReverseText(false);
+        s_UpdateMetaAttribute(attrs, COMMON_LVB_REVERSE_VIDEO, false);
         break;
     case DispatchTypes::GraphicsOptions::NoUnderline:
-        _terminalApi.UnderlineText(false);
+        s_UpdateMetaAttribute(attrs, COMMON_LVB_UNDERSCORE, false);
         break;
     case DispatchTypes::GraphicsOptions::ForegroundBlack:
-        _terminalApi.SetTextForegroundIndex(DARK_BLACK);
+        attrs.SetIndexedAttributes({ DARK_BLACK }, {});
         break;
     case DispatchTypes::GraphicsOptions::ForegroundBlue:
-        _terminalApi.SetTextForegroundIndex(DARK_BLUE);
+        attrs.SetIndexedAttributes({ DARK_BLUE }, {});
         break;
     case DispatchTypes::GraphicsOptions::ForegroundGreen:
-        _terminalApi.SetTextForegroundIndex(DARK_GREEN);
+        attrs.SetIndexedAttributes({ DARK_GREEN }, {});
         break;
     case DispatchTypes::GraphicsOptions::ForegroundCyan:
-        _terminalApi.SetTextForegroundIndex(DARK_CYAN);
+        attrs.SetIndexedAttributes({ DARK_CYAN }, {});
         break;
     case DispatchTypes::GraphicsOptions::ForegroundRed:
-        _terminalApi.SetTextForegroundIndex(DARK_RED);
+        attrs.SetIndexedAttributes({ DARK_RED }, {});
         break;
     case DispatchTypes::GraphicsOptions::ForegroundMagenta:
-        _terminalApi.SetTextForegroundIndex(DARK_MAGENTA);
+        attrs.SetIndexedAttributes({ DARK_MAGENTA }, {});
         break;
     case DispatchTypes::GraphicsOptions::ForegroundYellow:
-        _terminalApi.SetTextForegroundIndex(DARK_YELLOW);
+        attrs.SetIndexedAttributes({ DARK_YELLOW }, {});
         break;
     case DispatchTypes::GraphicsOptions::ForegroundWhite:
-        _terminalApi.SetTextForegroundIndex(DARK_WHITE);
+        attrs.SetIndexedAttributes({ DARK_WHITE }, {});
         break;
     case DispatchTypes::GraphicsOptions::ForegroundDefault:
         FAIL_FAST_MSG("GraphicsOptions::ForegroundDefault should be handled by _SetDefaultColorHelper");
         break;
     case DispatchTypes::GraphicsOptions::BackgroundBlack:
-        _terminalApi.SetTextBackgroundIndex(DARK_BLACK);
+        attrs.SetIndexedAttributes({}, { DARK_BLACK });
         break;
     case DispatchTypes::GraphicsOptions::BackgroundBlue:
-        _terminalApi.SetTextBackgroundIndex(DARK_BLUE);
+        attrs.SetIndexedAttributes({}, { DARK_BLUE });
         break;
     case DispatchTypes::GraphicsOptions::BackgroundGreen:
-        _terminalApi.SetTextBackgroundIndex(DARK_GREEN);
+        attrs.SetIndexedAttributes({}, { DARK_GREEN });
         break;
     case DispatchTypes::GraphicsOptions::BackgroundCyan:
-        _terminalApi.SetTextBackgroundIndex(DARK_CYAN);
+        attrs.SetIndexedAttributes({}, { DARK_CYAN });
         break;
     case DispatchTypes::GraphicsOptions::BackgroundRed:
-        _terminalApi.SetTextBackgroundIndex(DARK_RED);
+        attrs.SetIndexedAttributes({}, { DARK_RED });
         break;
     case DispatchTypes::GraphicsOptions::BackgroundMagenta:
-        _terminalApi.SetTextBackgroundIndex(DARK_MAGENTA);
+        attrs.SetIndexedAttributes({}, { DARK_MAGENTA });
         break;
     case DispatchTypes::GraphicsOptions::BackgroundYellow:
-        _terminalApi.SetTextBackgroundIndex(DARK_YELLOW);
+        attrs.SetIndexedAttributes({}, { DARK_YELLOW });
         break;
     case DispatchTypes::GraphicsOptions::BackgroundWhite:
-        _terminalApi.SetTextBackgroundIndex(DARK_WHITE);
+        attrs.SetIndexedAttributes({}, { DARK_WHITE });
         break;
     case DispatchTypes::GraphicsOptions::BackgroundDefault:
         FAIL_FAST_MSG("GraphicsOptions::BackgroundDefault should be handled by _SetDefaultColorHelper");
         break;
     case DispatchTypes::GraphicsOptions::BrightForegroundBlack:
-        _terminalApi.SetTextForegroundIndex(BRIGHT_BLACK);
+        attrs.SetIndexedAttributes({ BRIGHT_BLACK }, {});
         break;
     case DispatchTypes::GraphicsOptions::BrightForegroundBlue:
-        _terminalApi.SetTextForegroundIndex(BRIGHT_BLUE);
+        attrs.SetIndexedAttributes({ BRIGHT_BLUE }, {});
         break;
     case DispatchTypes::GraphicsOptions::BrightForegroundGreen:
-        _terminalApi.SetTextForegroundIndex(BRIGHT_GREEN);
+        attrs.SetIndexedAttributes({ BRIGHT_GREEN }, {});
         break;
     case DispatchTypes::GraphicsOptions::BrightForegroundCyan:
-        _terminalApi.SetTextForegroundIndex(BRIGHT_CYAN);
+        attrs.SetIndexedAttributes({ BRIGHT_CYAN }, {});
         break;
     case DispatchTypes::GraphicsOptions::BrightForegroundRed:
-        _terminalApi.SetTextForegroundIndex(BRIGHT_RED);
+        attrs.SetIndexedAttributes({ BRIGHT_RED }, {});
         break;
     case DispatchTypes::GraphicsOptions::BrightForegroundMagenta:
-        _terminalApi.SetTextForegroundIndex(BRIGHT_MAGENTA);
+        attrs.SetIndexedAttributes({ BRIGHT_MAGENTA }, {});
         break;
     case DispatchTypes::GraphicsOptions::BrightForegroundYellow:
-        _terminalApi.SetTextForegroundIndex(BRIGHT_YELLOW);
+        attrs.SetIndexedAttributes({ BRIGHT_YELLOW }, {});
         break;
     case DispatchTypes::GraphicsOptions::BrightForegroundWhite:
-        _terminalApi.SetTextForegroundIndex(BRIGHT_WHITE);
+        attrs.SetIndexedAttributes({ BRIGHT_WHITE }, {});
         break;
     case DispatchTypes::GraphicsOptions::BrightBackgroundBlack:
-        _terminalApi.SetTextBackgroundIndex(BRIGHT_BLACK);
+        attrs.SetIndexedAttributes({}, { BRIGHT_BLACK });
         break;
     case DispatchTypes::GraphicsOptions::BrightBackgroundBlue:
-        _terminalApi.SetTextBackgroundIndex(BRIGHT_BLUE);
+        attrs.SetIndexedAttributes({}, { BRIGHT_BLUE });
         break;
     case DispatchTypes::GraphicsOptions::BrightBackgroundGreen:
-        _terminalApi.SetTextBackgroundIndex(BRIGHT_GREEN);
+        attrs.SetIndexedAttributes({}, { BRIGHT_GREEN });
         break;
     case DispatchTypes::GraphicsOptions::BrightBackgroundCyan:
-        _terminalApi.SetTextBackgroundIndex(BRIGHT_CYAN);
+        attrs.SetIndexedAttributes({}, { BRIGHT_CYAN });
         break;
     case DispatchTypes::GraphicsOptions::BrightBackgroundRed:
-        _terminalApi.SetTextBackgroundIndex(BRIGHT_RED);
+        attrs.SetIndexedAttributes({}, { BRIGHT_RED });
         break;
     case DispatchTypes::GraphicsOptions::BrightBackgroundMagenta:
-        _terminalApi.SetTextBackgroundIndex(BRIGHT_MAGENTA);
+        attrs.SetIndexedAttributes({}, { BRIGHT_MAGENTA });
         break;
     case DispatchTypes::GraphicsOptions::BrightBackgroundYellow:
-        _terminalApi.SetTextBackgroundIndex(BRIGHT_YELLOW);
+        attrs.SetIndexedAttributes({}, { BRIGHT_YELLOW });
         break;
     case DispatchTypes::GraphicsOptions::BrightBackgroundWhite:
-        _terminalApi.SetTextBackgroundIndex(BRIGHT_WHITE);
+        attrs.SetIndexedAttributes({}, { BRIGHT_WHITE });
+        break;
+    default:
+        fSuccess = false;
         break;
     }
+    return fSuccess;
 }
 
+// Routine Description:
+// - SGR - Modifies the graphical rendering options applied to the next characters written into the buffer.
+// - Every option is applied to a copy of the current attributes, and the
+//   terminal is only handed the result once, however many options there are.
+// Arguments:
+// - rgOptions - An array of options that will be applied from 0 to N, in order.
+// - cOptions - The count of options
+// Return Value:
+// - True if the last option was applied successfully. False otherwise.
 bool TerminalDispatch::SetGraphicsRendition(const DispatchTypes::GraphicsOptions* const rgOptions,
                                             const size_t cOptions)
 {
+    TextAttribute attrs = _terminalApi.GetTextAttributes();
+
     bool fSuccess = false;
     // Run through the graphics options and apply them
     for (size_t i = 0; i < cOptions; i++)
@@ -296,31 +353,25 @@ bool TerminalDispatch::SetGraphicsRendition(const DispatchTypes::GraphicsOptions
         DispatchTypes::GraphicsOptions opt = rgOptions[i];
         if (s_IsDefaultColorOption(opt))
         {
-            fSuccess = _SetDefaultColorHelper(opt);
+            fSuccess = _SetDefaultColorHelper(opt, attrs);
         }
         else if (s_IsBoldColorOption(opt))
         {
-            fSuccess = _SetBoldColorHelper(rgOptions[i]);
+            fSuccess = _SetBoldColorHelper(rgOptions[i], attrs);
         }
         else if (s_IsRgbColorOption(opt))
         {
             size_t cOptionsConsumed = 0;
 
-            // _SetRgbColorsHelper will call the appropriate ConApi function
-            fSuccess = _SetRgbColorsHelper(&(rgOptions[i]), cOptions-i, &cOptionsConsumed);
+            fSuccess = _SetRgbColorsHelper(&(rgOptions[i]), cOptions-i, &cOptionsConsumed, attrs);
 
             i += (cOptionsConsumed - 1); // cOptionsConsumed includes the opt we're currently on.
         }
         else
         {
-            _SetGraphicsOptionHelper(opt);
-
-            // Make sure we un-bold
-            if (fSuccess && opt == DispatchTypes::GraphicsOptions::Off)
-            {
-                fSuccess = _SetBoldColorHelper(opt);
-            }
+            fSuccess = _SetGraphicsOptionHelper(opt, attrs);
         }
     }
-    return fSuccess;
+
+    return _terminalApi.SetTextAttributes(attrs) && fSuccess;
 }
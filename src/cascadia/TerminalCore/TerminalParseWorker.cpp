@@ -0,0 +1,230 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "TerminalParseWorker.hpp"
+#include "Terminal.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+// Method Description:
+// - Starts a worker that parses output into the given terminal.
+// Arguments:
+// - terminal: the terminal to write the output to. It must outlive the worker.
+// Note: will throw exception if the thread can't be started
+TerminalParseWorker::TerminalParseWorker(Terminal& terminal) :
+    _terminal{ terminal },
+    _ring{},
+    _head{ 0 },
+    _tail{ 0 },
+    _parsed{ 0 },
+    _peakDepth{ 0 },
+    _shutdown{ false },
+    _background{ false },
+    _dataAvailable{ wil::EventOptions::None },
+    _spaceAvailable{ wil::EventOptions::None },
+    _thread{}
+{
+    _thread = std::thread([this]() { _ParseLoop(); });
+}
+
+TerminalParseWorker::~TerminalParseWorker()
+{
+    Shutdown();
+}
+
+// Method Description:
+// - Hands a chunk of output over to the worker to be parsed. Only one thread may
+//      call this. If the worker is a whole ring behind, this waits for it to catch
+//      up on one chunk, so a flood of output can't get arbitrarily far ahead of it.
+// Arguments:
+// - chunk: the output to parse
+// Return Value:
+// - false if the worker has been shut down, and the chunk was dropped.
+bool TerminalParseWorker::Enqueue(std::wstring chunk)
+{
+    auto slot = _WaitForSlot();
+    if (!slot)
+    {
+        return false;
+    }
+
+    slot->isUtf8 = false;
+    slot->text = std::move(chunk);
+    _PublishSlot();
+    return true;
+}
+
+// Method Description:
+// - Hands a chunk of UTF-8 output over to the worker to be parsed, like the other
+//      Enqueue. The bytes are copied, so the caller can reuse its buffer as soon as
+//      this returns. A character may be split across two chunks.
+// Arguments:
+// - utf8: the output to parse
+// Return Value:
+// - false if the worker has been shut down, and the chunk was dropped.
+bool TerminalParseWorker::Enqueue(const std::string_view utf8)
+{
+    auto slot = _WaitForSlot();
+    if (!slot)
+    {
+        return false;
+    }
+
+    slot->isUtf8 = true;
+    slot->utf8.assign(utf8);
+    _PublishSlot();
+    return true;
+}
+
+// Method Description:
+// - Waits for the slot at the tail of the ring to be free.
+// Return Value:
+// - the slot to fill, or nullptr if the worker has been shut down.
+TerminalParseWorker::Chunk* TerminalParseWorker::_WaitForSlot()
+{
+    const auto tail = _tail.load(std::memory_order_relaxed);
+    while (tail - _head.load(std::memory_order_acquire) >= s_RingSize)
+    {
+        if (_shutdown.load())
+        {
+            return nullptr;
+        }
+        _spaceAvailable.wait();
+    }
+
+    if (_shutdown.load())
+    {
+        return nullptr;
+    }
+
+    return &_ring.at(tail % s_RingSize);
+}
+
+// Method Description:
+// - Hands the slot that was just filled over to the worker.
+void TerminalParseWorker::_PublishSlot()
+{
+    const auto tail = _tail.load(std::memory_order_relaxed) + 1;
+    _tail.store(tail, std::memory_order_release);
+    _dataAvailable.SetEvent();
+
+    const auto depth = tail - _head.load(std::memory_order_relaxed);
+    if (depth > _peakDepth.load(std::memory_order_relaxed))
+    {
+        _peakDepth.store(depth, std::memory_order_relaxed);
+    }
+}
+
+// Method Description:
+// - Gets the number of chunks that are queued up, including the one that's
+//      being parsed. Any thread may call this.
+size_t TerminalParseWorker::GetQueueDepth() const noexcept
+{
+    return _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_relaxed);
+}
+
+// Method Description:
+// - Gets the most chunks that were queued up at once since the last time this
+//      was called, and starts counting again. Any thread may call this, but the
+//      peak is only meaningful if just one of them does.
+size_t TerminalParseWorker::TakePeakQueueDepth() noexcept
+{
+    return _peakDepth.exchange(0, std::memory_order_relaxed);
+}
+
+// Method Description:
+// - Waits until everything that's been enqueued so far has been parsed. This
+//      must be called from the same thread as Enqueue.
+void TerminalParseWorker::Flush()
+{
+    const auto target = _tail.load(std::memory_order_relaxed);
+    while (_parsed.load() < target && !_shutdown.load())
+    {
+        SwitchToThread();
+    }
+}
+
+// Method Description:
+// - Stops the worker once it's done with the chunk it's parsing, if any. Anything
+//      else that's still queued is dropped. The caller mustn't be holding the
+//      terminal's lock, since the worker may be waiting on it.
+void TerminalParseWorker::Shutdown() noexcept
+{
+    _shutdown.store(true);
+    _dataAvailable.SetEvent();
+    _spaceAvailable.SetEvent();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+// Method Description:
+// - Puts the worker in or out of the background. In the background, output is
+//      parsed in batches, every s_BackgroundBatchIntervalMs at most. Coming out of it,
+//      whatever's waiting is parsed straight away. Any thread may call this.
+// Arguments:
+// - background: true if nobody can see the terminal
+void TerminalParseWorker::SetBackground(const bool background) noexcept
+{
+    _background.store(background);
+    _dataAvailable.SetEvent();
+}
+
+// Method Description:
+// - In the background, waits for more output to come in before parsing what's
+//      there: until the ring is half full, the batch interval has gone by, or the
+//      worker has been brought back to the foreground or shut down.
+void TerminalParseWorker::_WaitForBatch()
+{
+    const auto deadline = GetTickCount64() + s_BackgroundBatchIntervalMs;
+    while (_background.load() && !_shutdown.load() && GetQueueDepth() < s_RingSize / 2)
+    {
+        const auto now = GetTickCount64();
+        if (now >= deadline)
+        {
+            break;
+        }
+        _dataAvailable.wait(gsl::narrow_cast<DWORD>(deadline - now));
+    }
+}
+
+// Method Description:
+// - The worker's thread. Parses chunks in the order they were queued until it's shut down.
+void TerminalParseWorker::_ParseLoop()
+{
+    while (!_shutdown.load())
+    {
+        _dataAvailable.wait();
+
+        if (_background.load())
+        {
+            _WaitForBatch();
+        }
+
+        auto head = _head.load(std::memory_order_relaxed);
+        while (!_shutdown.load() && head != _tail.load(std::memory_order_acquire))
+        {
+            auto& chunk = _ring.at(head % s_RingSize);
+            try
+            {
+                if (chunk.isUtf8)
+                {
+                    _terminal.Write(std::string_view{ chunk.utf8 });
+                }
+                else
+                {
+                    _terminal.Write(std::wstring_view{ chunk.text });
+                    chunk.text = {};
+                }
+            }
+            CATCH_LOG();
+
+            _head.store(++head, std::memory_order_release);
+            _spaceAvailable.SetEvent();
+            _parsed.fetch_add(1);
+        }
+    }
+}
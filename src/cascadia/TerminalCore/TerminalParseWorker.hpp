@@ -0,0 +1,72 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+namespace Microsoft::Terminal::Core
+{
+    class Terminal;
+    class TerminalParseWorker;
+}
+
+// A thread that parses a Terminal's output, so that whoever reads it from the
+//      connection can go straight back to reading instead of waiting on the parser.
+// The reader hands each chunk of output over through a fixed size ring. There's
+//      one producer (the connection's output thread) and one consumer (the worker),
+//      so the ring only needs a pair of atomic indices and no lock. If the worker
+//      falls a whole ring behind, the producer waits for it to free up a slot.
+// UTF-8 output is copied into the slot's own buffer, which is kept from one trip
+//      around the ring to the next, so a steady stream of it doesn't allocate.
+// While the terminal is in the background, nobody's looking at it, so the worker
+//      lets output pile up for a while (or until the ring is half full) and parses
+//      it all at once, rather than waking up for each chunk as it arrives.
+class Microsoft::Terminal::Core::TerminalParseWorker final
+{
+public:
+    TerminalParseWorker(Terminal& terminal);
+    ~TerminalParseWorker();
+
+    bool Enqueue(std::wstring chunk);
+    bool Enqueue(const std::string_view utf8);
+    void Flush();
+    void Shutdown() noexcept;
+    void SetBackground(const bool background) noexcept;
+
+    size_t GetQueueDepth() const noexcept;
+    size_t TakePeakQueueDepth() noexcept;
+
+private:
+    static constexpr size_t s_RingSize = 64;
+    static constexpr DWORD s_BackgroundBatchIntervalMs = 250;
+
+    Terminal& _terminal;
+
+    struct Chunk
+    {
+        bool isUtf8;
+        std::wstring text;
+        std::string utf8;
+    };
+
+    std::array<Chunk, s_RingSize> _ring;
+    // _head is the next slot the worker will parse. The worker only moves it past a
+    //      slot once it's done with it.
+    std::atomic<size_t> _head;
+    // _tail is the next slot the producer will fill. Only the producer moves it.
+    std::atomic<size_t> _tail;
+    // the number of chunks the worker has finished parsing.
+    std::atomic<size_t> _parsed;
+    // the most chunks that have been waiting at once, since it was last taken.
+    std::atomic<size_t> _peakDepth;
+    std::atomic<bool> _shutdown;
+    std::atomic<bool> _background;
+
+    wil::unique_event _dataAvailable;
+    wil::unique_event _spaceAvailable;
+    std::thread _thread;
+
+    Chunk* _WaitForSlot();
+    void _PublishSlot();
+    void _WaitForBatch();
+    void _ParseLoop();
+};
@@ -0,0 +1,250 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "TerminalPredictiveEcho.hpp"
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Types;
+
+TerminalPredictiveEcho::TerminalPredictiveEcho() noexcept :
+    _predictions{},
+    _circledRowCount{ 0 },
+    _suspended{ false },
+    _overlayRenderTarget{},
+    _overlay{ nullptr }
+{
+}
+
+// Method Description:
+// - Whether we'd predict the echo of the given character. Only printable ASCII
+//      is - everything else might not take up exactly one cell, or might not
+//      be echoed as itself.
+// Arguments:
+// - wch: the character that was typed
+// Return Value:
+// - true if it can be predicted.
+bool TerminalPredictiveEcho::s_IsPredictable(const wchar_t wch) noexcept
+{
+    return wch >= L'\x20' && wch <= L'\x7e';
+}
+
+// Method Description:
+// - Predicts that the given character will be echoed, right after the ones
+//      that are already predicted. Nothing's predicted while we're suspended,
+//      or if it would have to go onto the next row.
+// Arguments:
+// - buffer: the buffer the echo will be written to
+// - wch: the character that was typed
+// Return Value:
+// - true if the character was predicted.
+bool TerminalPredictiveEcho::Predict(TextBuffer& buffer, const wchar_t wch)
+{
+    if (_suspended || !s_IsPredictable(wch))
+    {
+        return false;
+    }
+
+    const auto cursor = buffer.GetCursor().GetPosition();
+    COORD position = cursor;
+    if (!_predictions.empty())
+    {
+        position = _predictions.back().position;
+        position.X++;
+    }
+
+    const auto size = buffer.GetSize().Dimensions();
+    // Leave the last column alone. Writing there defers the wrap, and whether
+    //      the cursor stays put or moves on is up to the app.
+    if (position.X >= size.X - 1 || position.Y >= size.Y)
+    {
+        return false;
+    }
+
+    if (!_overlay || _overlay->GetSize().Width() != size.X)
+    {
+        _overlay = std::make_unique<TextBuffer>(COORD{ size.X, 1 }, TextAttribute{}, 0, _overlayRenderTarget);
+    }
+
+    if (_predictions.empty())
+    {
+        _circledRowCount = buffer.GetCircledRowCount();
+    }
+
+    const std::wstring_view text{ &wch, 1 };
+    _overlay->Write(OutputCellIterator(text, buffer.GetCurrentAttributes()), { position.X, 0 });
+    _predictions.push_back({ position, wch, std::chrono::steady_clock::now() });
+
+    // The character, and the cursor just past it.
+    auto& renderTarget = buffer.GetRenderTarget();
+    renderTarget.TriggerRedraw(Viewport::FromDimensions(position, { 2, 1 }));
+    renderTarget.TriggerRedrawCursor(&cursor);
+    return true;
+}
+
+// Method Description:
+// - Checks the predictions against what's been written to the buffer. Every
+//      prediction that the cursor has gone past has been echoed one way or
+//      another. If the right character was echoed, it's dropped. If anything
+//      else was, we mispredicted, and the rest are rolled back too.
+// Arguments:
+// - buffer: the buffer, after some output was written to it
+void TerminalPredictiveEcho::Reconcile(TextBuffer& buffer)
+{
+    if (_predictions.empty())
+    {
+        return;
+    }
+
+    if (buffer.GetCircledRowCount() != _circledRowCount ||
+        buffer.GetSize().Width() != _overlay->GetSize().Width())
+    {
+        Rollback(buffer);
+        return;
+    }
+
+    const auto cursor = buffer.GetCursor().GetPosition();
+    while (!_predictions.empty())
+    {
+        const auto& prediction = _predictions.front();
+        if (cursor.Y == prediction.position.Y && cursor.X <= prediction.position.X)
+        {
+            // The echo hasn't gotten this far yet.
+            break;
+        }
+
+        const auto chars = buffer.GetCellDataAt(prediction.position)->Chars();
+        if (chars.size() != 1 || chars.front() != prediction.wch)
+        {
+            Rollback(buffer);
+            return;
+        }
+
+        buffer.GetRenderTarget().TriggerRedraw(Viewport::FromDimensions(prediction.position, { 1, 1 }));
+        _predictions.pop_front();
+    }
+}
+
+// Method Description:
+// - Drops all the predictions, and starts predicting again if we'd stopped.
+//      This is for input that isn't plain text - the app might do anything
+//      with it, and what's predicted so far might never be echoed as it is.
+// Arguments:
+// - buffer: the buffer the predictions were made in
+void TerminalPredictiveEcho::Reset(TextBuffer& buffer)
+{
+    _Invalidate(buffer);
+    _predictions.clear();
+    _suspended = false;
+}
+
+// Method Description:
+// - Drops all the predictions, because we got one of them wrong. Nothing more
+//      is predicted until the next Reset.
+// Arguments:
+// - buffer: the buffer the predictions were made in
+void TerminalPredictiveEcho::Rollback(TextBuffer& buffer)
+{
+    if (!_predictions.empty())
+    {
+        _Invalidate(buffer);
+        _predictions.clear();
+        _suspended = true;
+    }
+}
+
+// Method Description:
+// - Rolls the predictions back if the oldest of them has gone unconfirmed
+//      for longer than s_ConfirmTimeout. Presumably it's never getting echoed.
+// Arguments:
+// - buffer: the buffer the predictions were made in
+// - now: the current time
+// Return Value:
+// - true if there are still predictions waiting to be confirmed.
+bool TerminalPredictiveEcho::Expire(TextBuffer& buffer, const std::chrono::steady_clock::time_point now)
+{
+    if (!_predictions.empty() && now - _predictions.front().time >= s_ConfirmTimeout)
+    {
+        Rollback(buffer);
+    }
+    return !_predictions.empty();
+}
+
+bool TerminalPredictiveEcho::HasPredictions() const noexcept
+{
+    return !_predictions.empty();
+}
+
+// Method Description:
+// - Gets where the cursor should be drawn: after the last prediction, if
+//      there are any, otherwise where it actually is.
+// Arguments:
+// - actual: the position of the buffer's cursor
+// Return Value:
+// - the position to draw the cursor at, in buffer coordinates.
+COORD TerminalPredictiveEcho::GetCursorPosition(const COORD actual) const noexcept
+{
+    if (_predictions.empty())
+    {
+        return actual;
+    }
+
+    auto position = _predictions.back().position;
+    position.X++;
+    return position;
+}
+
+// Method Description:
+// - Gets the overlay the renderer should draw the predictions with.
+// Arguments:
+// - view: the part of the buffer that's on the screen
+// Return Value:
+// - The overlay, or nothing if there are no predictions on the screen.
+std::optional<RenderOverlay> TerminalPredictiveEcho::GetOverlay(const Viewport& view) const
+{
+    if (_predictions.empty())
+    {
+        return std::nullopt;
+    }
+
+    const auto first = _predictions.front().position;
+    const auto last = _predictions.back().position;
+    if (first.Y < view.Top() || first.Y > view.BottomInclusive())
+    {
+        return std::nullopt;
+    }
+
+    const COORD origin{ 0, gsl::narrow<SHORT>(first.Y - view.Top()) };
+    const auto region = Viewport::FromInclusive({ first.X, 0, last.X, 0 });
+    return RenderOverlay{ *_overlay, origin, region };
+}
+
+// Method Description:
+// - Gets the buffer the overlay draws from, to take a snapshot of it. There's
+//      only one once something's been predicted.
+TextBuffer& TerminalPredictiveEcho::GetOverlayBuffer()
+{
+    return *THROW_HR_IF_NULL(E_NOT_VALID_STATE, _overlay.get());
+}
+
+// Method Description:
+// - Redraws the cells of all the predictions, and the cursor after them.
+// Arguments:
+// - buffer: the buffer the predictions were made in
+void TerminalPredictiveEcho::_Invalidate(TextBuffer& buffer) const
+{
+    if (_predictions.empty())
+    {
+        return;
+    }
+
+    const auto first = _predictions.front().position;
+    const auto last = _predictions.back().position;
+    const auto width = buffer.GetSize().Width();
+    const SHORT right = std::min<SHORT>(last.X + 1, gsl::narrow_cast<SHORT>(width - 1));
+    auto& renderTarget = buffer.GetRenderTarget();
+    renderTarget.TriggerRedraw(Viewport::FromInclusive({ first.X, first.Y, right, first.Y }));
+    const auto cursor = buffer.GetCursor().GetPosition();
+    renderTarget.TriggerRedrawCursor(&cursor);
+}
@@ -0,0 +1,72 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <deque>
+
+#include "../../buffer/out/textBuffer.hpp"
+#include "../../renderer/inc/IRenderData.hpp"
+#include "../../renderer/inc/DummyRenderTarget.hpp"
+
+namespace Microsoft::Terminal::Core
+{
+    class TerminalPredictiveEcho;
+}
+
+// Shows what's typed at the cursor straight away, for connections that take a
+//      while to echo it back (ssh to a host on the other side of the world).
+// Each printable character that's typed is drawn in an overlay, one after the
+//      other from the cursor, and the cursor is drawn after the last of them.
+//      Only one row is ever predicted - a prediction that would wrap isn't made.
+// As output comes in, every prediction that the echo has gone past is checked
+//      against what actually ended up in the buffer. The ones that match are
+//      dropped, since the buffer shows them now. The first one that doesn't
+//      means the app isn't echoing what's typed (a password prompt, an editor's
+//      command mode), so all of them are rolled back. So are the ones that go
+//      unconfirmed for too long. After either, nothing more is predicted until
+//      the next key that isn't plain text - usually Enter.
+class Microsoft::Terminal::Core::TerminalPredictiveEcho final
+{
+public:
+    // How long a prediction can go without being confirmed before it's rolled back.
+    static constexpr std::chrono::milliseconds s_ConfirmTimeout{ 1000 };
+
+    TerminalPredictiveEcho() noexcept;
+
+    bool Predict(TextBuffer& buffer, const wchar_t wch);
+    void Reconcile(TextBuffer& buffer);
+    void Reset(TextBuffer& buffer);
+    void Rollback(TextBuffer& buffer);
+    bool Expire(TextBuffer& buffer, const std::chrono::steady_clock::time_point now);
+
+    bool HasPredictions() const noexcept;
+    COORD GetCursorPosition(const COORD actual) const noexcept;
+    std::optional<Microsoft::Console::Render::RenderOverlay> GetOverlay(const Microsoft::Console::Types::Viewport& view) const;
+    TextBuffer& GetOverlayBuffer();
+
+    static bool s_IsPredictable(const wchar_t wch) noexcept;
+
+private:
+    struct Prediction
+    {
+        COORD position;
+        wchar_t wch;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    // In the order they were typed. They're all on the same row, one after the other.
+    std::deque<Prediction> _predictions;
+    // The buffer's circled row count when the first prediction was made. If it
+    //      circles, the rows have moved under the predictions.
+    uint64_t _circledRowCount;
+    // Set by a misprediction, until the next Reset.
+    bool _suspended;
+
+    // The predicted characters, at the same columns as in the buffer. It
+    //      doesn't draw itself - the renderer picks it up through GetOverlay.
+    DummyRenderTarget _overlayRenderTarget;
+    std::unique_ptr<TextBuffer> _overlay;
+
+    void _Invalidate(TextBuffer& buffer) const;
+};
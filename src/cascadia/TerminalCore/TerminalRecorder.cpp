@@ -0,0 +1,333 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "TerminalRecorder.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+// Method Description:
+// - Makes an empty ring. The size must be a multiple of TerminalRecording::s_Alignment.
+TerminalRecorder::Ring::Ring(const size_t size) :
+    _size{ size },
+    _data{ std::make_unique<std::byte[]>(size) },
+    _head{ 0 },
+    _tail{ 0 }
+{
+    FAIL_FAST_IF(size % TerminalRecording::s_Alignment != 0);
+}
+
+TerminalRecording::RecordHeader* TerminalRecorder::Ring::_HeaderAt(const size_t offset) const noexcept
+{
+    return reinterpret_cast<RecordHeader*>(_data.get() + (offset % _size));
+}
+
+// Method Description:
+// - Copies a record into the ring. Only the ring's producer may call this. If
+//      the record won't fit before the end of the ring, the rest of the ring is
+//      padded out and the record goes at the start, so that it's in one piece.
+// Arguments:
+// - type, microseconds: the record's header
+// - data, size: its payload
+// Return Value:
+// - false if there wasn't room for it, and it was dropped.
+bool TerminalRecorder::Ring::Push(const RecordType type, const int64_t microseconds, const void* const data, const size_t size) noexcept
+{
+    const auto total = sizeof(RecordHeader) + TerminalRecording::s_PaddedSize(size);
+    auto tail = _tail.load(std::memory_order_relaxed);
+    const auto free = _size - (tail - _head.load(std::memory_order_acquire));
+    const auto untilEnd = _size - (tail % _size);
+    const auto padding = untilEnd < total ? untilEnd : 0;
+    if (total + padding > free)
+    {
+        return false;
+    }
+
+    if (padding != 0)
+    {
+        *_HeaderAt(tail) = { 0, gsl::narrow_cast<uint32_t>(padding - sizeof(RecordHeader)), RecordType::Padding, 0 };
+        tail += padding;
+    }
+
+    auto header = _HeaderAt(tail);
+    *header = { microseconds, gsl::narrow_cast<uint32_t>(size), type, 0 };
+    memcpy(header + 1, data, size);
+
+    _tail.store(tail + total, std::memory_order_release);
+    return true;
+}
+
+// Method Description:
+// - Gets the oldest record in the ring, without taking it out. Only the ring's
+//      consumer may call this.
+// Return Value:
+// - the record, with its payload after it, or nullptr if the ring's empty.
+const TerminalRecording::RecordHeader* TerminalRecorder::Ring::Peek() noexcept
+{
+    auto head = _head.load(std::memory_order_relaxed);
+    while (head != _tail.load(std::memory_order_acquire))
+    {
+        const auto header = _HeaderAt(head);
+        if (header->type != RecordType::Padding)
+        {
+            return header;
+        }
+        head += sizeof(RecordHeader) + header->size;
+        _head.store(head, std::memory_order_release);
+    }
+    return nullptr;
+}
+
+// Method Description:
+// - Takes the record that Peek returned out of the ring, and frees up its space.
+void TerminalRecorder::Ring::Pop() noexcept
+{
+    const auto head = _head.load(std::memory_order_relaxed);
+    const auto header = _HeaderAt(head);
+    _head.store(head + sizeof(RecordHeader) + TerminalRecording::s_PaddedSize(header->size), std::memory_order_release);
+}
+
+// Method Description:
+// - Checks if more than half the ring is in use. Either side may call this.
+bool TerminalRecorder::Ring::IsHalfFull() const noexcept
+{
+    return _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_relaxed) > _size / 2;
+}
+
+// Method Description:
+// - Starts recording to the given file, replacing whatever's there.
+// Arguments:
+// - path: the file to record to
+// Note: will throw exception if the file can't be created, or the thread can't be started
+TerminalRecorder::TerminalRecorder(const std::wstring& path) :
+    _file{ CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) },
+    _frequency{},
+    _start{},
+    _output{ s_OutputRingSize },
+    _events{ s_EventRingSize },
+    _dropped{ 0 },
+    _droppedWritten{ 0 },
+    _passes{ 0 },
+    _shutdown{ false },
+    _wake{ wil::EventOptions::None },
+    _thread{}
+{
+    THROW_LAST_ERROR_IF(!_file);
+
+    QueryPerformanceFrequency(&_frequency);
+    QueryPerformanceCounter(&_start);
+
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    TerminalRecording::FileHeader header{ TerminalRecording::s_Signature,
+                                          TerminalRecording::s_FormatVersion,
+                                          (static_cast<uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime };
+    DWORD written = 0;
+    THROW_IF_WIN32_BOOL_FALSE(WriteFile(_file.get(), &header, sizeof(header), &written, nullptr));
+
+    _thread = std::thread([this]() { _WriteLoop(); });
+}
+
+TerminalRecorder::~TerminalRecorder()
+{
+    Shutdown();
+}
+
+// Method Description:
+// - Makes up a name for a new recording in the given directory, from the time
+//      and the process, so that every terminal that's recording gets its own.
+// Arguments:
+// - directory: where the recording should go
+// Return Value:
+// - the path to record to
+std::wstring TerminalRecorder::s_MakePath(const std::wstring_view directory)
+{
+    static std::atomic<unsigned int> s_count{ 0 };
+
+    SYSTEMTIME now;
+    GetLocalTime(&now);
+    wchar_t name[64];
+    swprintf_s(name,
+               L"%04u%02u%02u-%02u%02u%02u-%u-%u.termrec",
+               now.wYear,
+               now.wMonth,
+               now.wDay,
+               now.wHour,
+               now.wMinute,
+               now.wSecond,
+               GetCurrentProcessId(),
+               s_count.fetch_add(1));
+    return (std::filesystem::path{ directory } / name).wstring();
+}
+
+// Method Description:
+// - Records a chunk of output. Only the thread that writes output to the
+//      terminal may call this.
+void TerminalRecorder::RecordOutput(const std::wstring_view text) noexcept
+{
+    _Record(_output, RecordType::Output, text.data(), text.size() * sizeof(wchar_t));
+}
+
+// Method Description:
+// - Records a chunk of UTF-8 output, as the bytes it came in. Only the thread
+//      that writes output to the terminal may call this.
+void TerminalRecorder::RecordOutput(const std::string_view utf8) noexcept
+{
+    _Record(_output, RecordType::OutputUtf8, utf8.data(), utf8.size());
+}
+
+// Method Description:
+// - Records input that's being sent to the connection. Only the UI thread may
+//      call this (or RecordResize).
+void TerminalRecorder::RecordInput(const std::wstring_view text) noexcept
+{
+    _Record(_events, RecordType::Input, text.data(), text.size() * sizeof(wchar_t));
+}
+
+// Method Description:
+// - Records that the viewport was resized.
+// Arguments:
+// - viewportSize: the new size of the viewport, in characters
+void TerminalRecorder::RecordResize(const COORD viewportSize) noexcept
+{
+    const TerminalRecording::ResizePayload payload{ viewportSize.X, viewportSize.Y };
+    _Record(_events, RecordType::Resize, &payload, sizeof(payload));
+}
+
+// Method Description:
+// - Gets the number of records that were dropped because the writer fell behind.
+size_t TerminalRecorder::GetDroppedCount() const noexcept
+{
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+// Method Description:
+// - Waits until everything that's been recorded so far is in the file.
+void TerminalRecorder::Flush()
+{
+    // A whole pass of the writer has to start after this, since the one that's
+    //      running might have looked at the rings before the last record went in.
+    const auto target = _passes.load() + 2;
+    _wake.SetEvent();
+    while (_passes.load() < target && !_shutdown.load())
+    {
+        SwitchToThread();
+    }
+}
+
+// Method Description:
+// - Writes out what's been recorded, and stops recording. Anything that's
+//      recorded after this is dropped.
+void TerminalRecorder::Shutdown() noexcept
+{
+    _shutdown.store(true);
+    _wake.SetEvent();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+// Method Description:
+// - Gets the time since the recording started.
+int64_t TerminalRecorder::_Now() const noexcept
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    const auto ticks = now.QuadPart - _start.QuadPart;
+    // Split up, so that the multiplication can't overflow.
+    return (ticks / _frequency.QuadPart) * 1000000 + (ticks % _frequency.QuadPart) * 1000000 / _frequency.QuadPart;
+}
+
+// Method Description:
+// - Puts a record in the given ring, or counts it as dropped if there's no room.
+//      The writer's only woken up early if the ring's getting full - otherwise
+//      it'll come around for the record soon enough by itself.
+void TerminalRecorder::_Record(Ring& ring, const RecordType type, const void* const data, const size_t size) noexcept
+{
+    if (_shutdown.load(std::memory_order_relaxed) || !ring.Push(type, _Now(), data, size))
+    {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (ring.IsHalfFull())
+    {
+        _wake.SetEvent();
+    }
+}
+
+// Method Description:
+// - Adds a record to what's about to be written to the file.
+void TerminalRecorder::_Stage(std::vector<std::byte>& staging, const RecordHeader& header, const void* const payload)
+{
+    const auto start = staging.size();
+    staging.resize(start + sizeof(RecordHeader) + TerminalRecording::s_PaddedSize(header.size));
+    memcpy(staging.data() + start, &header, sizeof(header));
+    memcpy(staging.data() + start + sizeof(header), payload, header.size);
+}
+
+// Method Description:
+// - Takes everything out of both rings, in the order it was recorded, and
+//      writes it to the file.
+// Arguments:
+// - staging: a buffer to gather the records in, so that they're written all at once
+void TerminalRecorder::_WritePending(std::vector<std::byte>& staging)
+{
+    staging.clear();
+
+    for (;;)
+    {
+        const auto output = _output.Peek();
+        const auto event = _events.Peek();
+        if (!output && !event)
+        {
+            break;
+        }
+
+        auto& ring = !event || (output && output->microseconds <= event->microseconds) ? _output : _events;
+        const auto header = &ring == &_output ? output : event;
+        _Stage(staging, *header, header + 1);
+        ring.Pop();
+    }
+
+    const auto dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != _droppedWritten)
+    {
+        const uint64_t count = dropped - _droppedWritten;
+        _Stage(staging, { _Now(), sizeof(count), RecordType::Dropped, 0 }, &count);
+        _droppedWritten = dropped;
+    }
+
+    if (!staging.empty())
+    {
+        DWORD written = 0;
+        THROW_IF_WIN32_BOOL_FALSE(WriteFile(_file.get(), staging.data(), gsl::narrow<DWORD>(staging.size()), &written, nullptr));
+    }
+}
+
+// Method Description:
+// - The writer's thread. Writes out what's been recorded every s_WriteIntervalMs,
+//      or whenever it's woken up, until it's shut down.
+void TerminalRecorder::_WriteLoop()
+{
+    std::vector<std::byte> staging;
+    for (;;)
+    {
+        _wake.wait(s_WriteIntervalMs);
+        const auto shutdown = _shutdown.load();
+
+        try
+        {
+            _WritePending(staging);
+        }
+        CATCH_LOG();
+
+        _passes.fetch_add(1);
+        if (shutdown)
+        {
+            break;
+        }
+    }
+}
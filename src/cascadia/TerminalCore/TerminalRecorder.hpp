@@ -0,0 +1,96 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "TerminalRecording.hpp"
+
+namespace Microsoft::Terminal::Core
+{
+    class TerminalRecorder;
+}
+
+// Records a terminal session - its output, its input and its resizes - to a file
+//      in the format in TerminalRecording.hpp, for audits, and so that a session
+//      that was slow can be replayed (VtReplay -recording) to find out why.
+// Whoever records something only has to copy it into a ring in memory. A thread
+//      of the recorder's own takes the records out of the ring and writes them to
+//      the file, every s_WriteIntervalMs, or sooner if the ring's filling up.
+// Output is recorded by the thread that writes it to the terminal, and input and
+//      resizes by the UI thread, so there's a ring for each of them. Each ring has
+//      one producer and one consumer, and so needs only a pair of atomic indices
+//      and no lock. A record never wraps around the end of its ring, so recording
+//      one is a single copy of its payload.
+// If the writer falls a whole ring behind, records are dropped rather than making
+//      the terminal wait for the disk. The recording says where they went missing.
+class Microsoft::Terminal::Core::TerminalRecorder final
+{
+public:
+    TerminalRecorder(const std::wstring& path);
+    ~TerminalRecorder();
+
+    void RecordOutput(const std::wstring_view text) noexcept;
+    void RecordOutput(const std::string_view utf8) noexcept;
+    void RecordInput(const std::wstring_view text) noexcept;
+    void RecordResize(const COORD viewportSize) noexcept;
+
+    void Flush();
+    void Shutdown() noexcept;
+
+    size_t GetDroppedCount() const noexcept;
+
+    static std::wstring s_MakePath(const std::wstring_view directory);
+
+    static constexpr size_t s_OutputRingSize = 4 * 1024 * 1024;
+    static constexpr size_t s_EventRingSize = 64 * 1024;
+    static constexpr DWORD s_WriteIntervalMs = 100;
+
+private:
+    using RecordType = TerminalRecording::RecordType;
+    using RecordHeader = TerminalRecording::RecordHeader;
+
+    class Ring final
+    {
+    public:
+        Ring(const size_t size);
+
+        bool Push(const RecordType type, const int64_t microseconds, const void* const data, const size_t size) noexcept;
+        const RecordHeader* Peek() noexcept;
+        void Pop() noexcept;
+        bool IsHalfFull() const noexcept;
+
+    private:
+        const size_t _size;
+        std::unique_ptr<std::byte[]> _data;
+        // _head is the offset of the next record the writer will take out. Only
+        //      the writer moves it, once it's done with the record.
+        std::atomic<size_t> _head;
+        // _tail is where the next record will be put. Only the producer moves it.
+        std::atomic<size_t> _tail;
+
+        RecordHeader* _HeaderAt(const size_t offset) const noexcept;
+    };
+
+    wil::unique_hfile _file;
+    LARGE_INTEGER _frequency;
+    LARGE_INTEGER _start;
+
+    Ring _output;
+    Ring _events;
+    // the number of records that have been dropped, and how many of them the
+    //      file has been told about.
+    std::atomic<size_t> _dropped;
+    size_t _droppedWritten;
+    // how many times the writer has been through its loop.
+    std::atomic<size_t> _passes;
+
+    std::atomic<bool> _shutdown;
+    wil::unique_event _wake;
+    std::thread _thread;
+
+    int64_t _Now() const noexcept;
+    void _Record(Ring& ring, const RecordType type, const void* const data, const size_t size) noexcept;
+    void _WriteLoop();
+    void _WritePending(std::vector<std::byte>& staging);
+    void _Stage(std::vector<std::byte>& staging, const RecordHeader& header, const void* const payload);
+};
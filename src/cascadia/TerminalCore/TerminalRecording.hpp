@@ -0,0 +1,74 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Microsoft::Terminal::Core
+{
+    struct TerminalRecording;
+}
+
+// The layout of a session recording, as TerminalRecorder writes it. This header
+//      doesn't depend on anything else, so that tools that read recordings (like
+//      VtReplay) can include it by itself.
+// A recording is a FileHeader, followed by records one after the other. Each
+//      record is a RecordHeader and then its payload, padded out with zeroes to
+//      a multiple of s_Alignment bytes. Timestamps count the microseconds since
+//      the recording started. The records are in the order of their timestamps,
+//      except that output may come just after input or a resize that's newer
+//      than it, since they're recorded from different threads.
+struct Microsoft::Terminal::Core::TerminalRecording
+{
+    static constexpr uint32_t s_Signature = 0x43455254; // "TREC"
+    static constexpr uint32_t s_FormatVersion = 1;
+    static constexpr size_t s_Alignment = 16;
+
+    enum class RecordType : uint16_t
+    {
+        // Never written to a file - it fills up the end of the recorder's ring.
+        Padding = 0,
+        // Output, as the UTF-16 it was written to the terminal with.
+        Output = 1,
+        // Output, as the UTF-8 bytes it was written to the terminal with.
+        OutputUtf8 = 2,
+        // Input that was sent to the connection, as UTF-16.
+        Input = 3,
+        // The viewport was resized. The payload is a ResizePayload.
+        Resize = 4,
+        // Records were dropped here, because the writer fell behind. The
+        //      payload is a uint64_t count of how many.
+        Dropped = 5,
+    };
+
+    struct FileHeader
+    {
+        uint32_t signature;
+        uint32_t formatVersion;
+        // When the recording started, as a FILETIME in UTC.
+        uint64_t startTime;
+    };
+
+    struct RecordHeader
+    {
+        int64_t microseconds;
+        uint32_t size; // of the payload, without its padding
+        RecordType type;
+        uint16_t reserved;
+    };
+
+    struct ResizePayload
+    {
+        int16_t columns;
+        int16_t rows;
+    };
+
+    static constexpr size_t s_PaddedSize(const size_t size) noexcept
+    {
+        return (size + s_Alignment - 1) & ~(s_Alignment - 1);
+    }
+
+    static_assert(sizeof(RecordHeader) == s_Alignment);
+};
@@ -0,0 +1,284 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "TerminalRenderFrame.hpp"
+#include "Terminal.hpp"
+#include "../../inc/argb.h"
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Types;
+using namespace Microsoft::Console::Render;
+
+TerminalRenderFrame::TerminalRenderFrame(Terminal& terminal) noexcept :
+    TerminalRenderFrame(terminal, terminal.GetPrimaryView())
+{
+}
+
+TerminalRenderFrame::TerminalRenderFrame(Terminal& terminal, TerminalView& view) noexcept :
+    _terminal{ terminal },
+    _view{ view },
+    _paintLock{},
+    _renderTarget{},
+    _buffer{},
+    _spilledBuffer{},
+    _spilledRows{},
+    _spilledCells{},
+    _showingSpill{ false },
+    _overlayBuffer{},
+    _overlayOrigin{ 0, 0 },
+    _overlayRegion{},
+    _viewport{ Viewport::Empty() },
+    _cursorPosition{ 0, 0 },
+    _cursorVisible{ false },
+    _cursorOn{ false },
+    _cursorHeight{ 0 },
+    _cursorPixelWidth{ 1 },
+    _cursorStyle{ CursorType::Legacy },
+    _cursorColor{ INVALID_COLOR },
+    _selectionRects{},
+    _title{},
+    _colors{}
+{
+}
+
+// Method Description:
+// - Keeps the renderer from painting a frame until the returned lock is released.
+//   Use this to change the render engine (e.g. its size or font) from another thread.
+//   Callers that also lock the Terminal must lock it first.
+std::unique_lock<std::mutex> TerminalRenderFrame::LockPainting()
+{
+    return std::unique_lock<std::mutex>(_paintLock);
+}
+
+// Method Description:
+// - Copies what has changed in the Terminal since the last frame into this one.
+// - The copy marks the Terminal's rows as shared with the snapshot, so this takes the
+//      write lock rather than the read lock, to keep that from racing with other readers.
+// Note: may throw exception if unable to allocate the copy
+void TerminalRenderFrame::_Capture()
+{
+    auto lock = _terminal.LockForWriting();
+
+    _viewport = _view.GetViewport();
+
+    auto& source = *_terminal._buffer;
+    const auto spilledAbove = gsl::narrow<size_t>(_view.GetSpilledRowsAbove());
+    if (spilledAbove > 0)
+    {
+        _CaptureSpilledRows(source, spilledAbove);
+        _showingSpill = true;
+    }
+    else
+    {
+        _showingSpill = false;
+        if (!_buffer || !_buffer->RefreshSnapshot(source,
+                                                  gsl::narrow<size_t>(_viewport.Top()),
+                                                  gsl::narrow<size_t>(_viewport.Height())))
+        {
+            _buffer = source.CreateSnapshot(_renderTarget);
+        }
+    }
+
+    // The predictions are at the cursor, and aren't shown while the view's up in the spill.
+    _overlayRegion.reset();
+    const auto overlay = _showingSpill ? std::nullopt : _terminal._predictiveEcho.GetOverlay(_viewport);
+    if (overlay)
+    {
+        auto& overlaySource = _terminal._predictiveEcho.GetOverlayBuffer();
+        if (!_overlayBuffer || !_overlayBuffer->RefreshSnapshot(overlaySource, 0, 1))
+        {
+            _overlayBuffer = overlaySource.CreateSnapshot(_renderTarget);
+        }
+        _overlayOrigin = overlay->origin;
+        _overlayRegion = overlay->region;
+    }
+
+    // The render data's cursor position, in buffer coordinates, with the
+    //      predicted echo - not the one the ITerminalApi hands out, relative to the viewport.
+    _cursorPosition = std::as_const(_terminal).GetCursorPosition();
+    _cursorVisible = _terminal.IsCursorVisible();
+    _cursorOn = _terminal.IsCursorOn();
+    _cursorHeight = _terminal.GetCursorHeight();
+    _cursorPixelWidth = _terminal.GetCursorPixelWidth();
+    _cursorStyle = _terminal.GetCursorStyle();
+    _cursorColor = _terminal.GetCursorColor();
+
+    if (_showingSpill)
+    {
+        // Everything's painted moved down by the spilled rows above the buffer, and
+        //      the cursor's hidden if that takes it out of view.
+        const auto row = gsl::narrow<size_t>(_cursorPosition.Y) + spilledAbove;
+        const auto height = gsl::narrow<size_t>(_viewport.Height());
+        _cursorVisible = _cursorVisible && row < height;
+        _cursorPosition.Y = gsl::narrow_cast<SHORT>(std::min(row, height - 1));
+    }
+
+    _selectionRects = _view.GetSelectionRects();
+
+    _title = _terminal._title;
+
+    _colors = _terminal._resolvedColors;
+}
+
+// Method Description:
+// - Copies what the view shows while it's scrolled up past the top of the buffer: the
+//      spilled rows at its top, read back from the spill, and the top rows of the buffer
+//      under them. They go into a buffer of the view's size, which is painted as if it
+//      were the top of the Terminal's. Every row is copied again each frame, since
+//      there's no telling which of the spilled ones are in the same place.
+// Arguments:
+// - source: the Terminal's buffer
+// - spilledAbove: how many spilled rows are in view above the top of the buffer
+// Note: may throw exception if unable to allocate the copy, or to read the spill
+void TerminalRenderFrame::_CaptureSpilledRows(const TextBuffer& source, const size_t spilledAbove)
+{
+    const auto size = _viewport.Dimensions();
+    if (!_spilledBuffer ||
+        _spilledBuffer->GetSize().Width() != size.X ||
+        _spilledBuffer->GetSize().Height() != size.Y)
+    {
+        _spilledBuffer = std::make_unique<TextBuffer>(size, TextAttribute{}, 0, _renderTarget);
+    }
+
+    const auto height = gsl::narrow<size_t>(size.Y);
+    auto& spill = *FAIL_FAST_IF_NULL(source.GetScrollbackSpill());
+    spill.ReadRows(spill.size() - spilledAbove, std::min(spilledAbove, height), _spilledRows);
+    for (size_t y = 0; y < _spilledRows.size(); ++y)
+    {
+        _spilledBuffer->WriteSpilledRow(_spilledRows.at(y), y);
+    }
+
+    for (size_t y = _spilledRows.size(); y < height; ++y)
+    {
+        _spilledCells.clear();
+        for (auto it = source.GetCellLineDataAt({ 0, gsl::narrow<SHORT>(y - _spilledRows.size()) }); it; ++it)
+        {
+            _spilledCells.emplace_back(*it);
+            _spilledCells.back().TextAttr() = _spilledBuffer->ImportAttributes(source, _spilledCells.back().TextAttr());
+        }
+        _spilledBuffer->WriteLine(OutputCellIterator({ _spilledCells.data(), _spilledCells.size() }), { 0, gsl::narrow<SHORT>(y) });
+    }
+}
+
+Viewport TerminalRenderFrame::GetViewport() noexcept
+{
+    return _viewport;
+}
+
+const TextBuffer& TerminalRenderFrame::GetTextBuffer() noexcept
+{
+    return *FAIL_FAST_IF_NULL((_showingSpill ? _spilledBuffer : _buffer).get());
+}
+
+const FontInfo& TerminalRenderFrame::GetFontInfo() noexcept
+{
+    // The Terminal only hands out a placeholder, see Terminal::GetFontInfo.
+    return _terminal.GetFontInfo();
+}
+
+const TextAttribute TerminalRenderFrame::GetDefaultBrushColors() noexcept
+{
+    return TextAttribute{};
+}
+
+const COLORREF TerminalRenderFrame::GetForegroundColor(const TextAttribute& attr) const noexcept
+{
+    return _colors.GetForeground(attr);
+}
+
+const COLORREF TerminalRenderFrame::GetBackgroundColor(const TextAttribute& attr) const noexcept
+{
+    return _colors.GetBackground(attr);
+}
+
+COORD TerminalRenderFrame::GetCursorPosition() const noexcept
+{
+    return _cursorPosition;
+}
+
+bool TerminalRenderFrame::IsCursorVisible() const noexcept
+{
+    return _cursorVisible;
+}
+
+bool TerminalRenderFrame::IsCursorOn() const noexcept
+{
+    return _cursorOn;
+}
+
+ULONG TerminalRenderFrame::GetCursorPixelWidth() const noexcept
+{
+    return _cursorPixelWidth;
+}
+
+ULONG TerminalRenderFrame::GetCursorHeight() const noexcept
+{
+    return _cursorHeight;
+}
+
+CursorType TerminalRenderFrame::GetCursorStyle() const noexcept
+{
+    return _cursorStyle;
+}
+
+COLORREF TerminalRenderFrame::GetCursorColor() const noexcept
+{
+    return _cursorColor;
+}
+
+bool TerminalRenderFrame::IsCursorDoubleWidth() const noexcept
+{
+    return false;
+}
+
+const std::vector<RenderOverlay> TerminalRenderFrame::GetOverlays() const noexcept
+{
+    try
+    {
+        if (_overlayRegion.has_value())
+        {
+            return { RenderOverlay{ *_overlayBuffer, _overlayOrigin, _overlayRegion.value() } };
+        }
+    }
+    CATCH_LOG();
+    return {};
+}
+
+const bool TerminalRenderFrame::IsGridLineDrawingAllowed() noexcept
+{
+    return true;
+}
+
+std::vector<Viewport> TerminalRenderFrame::GetSelectionRects() noexcept
+{
+    return _selectionRects;
+}
+
+const std::wstring TerminalRenderFrame::GetConsoleTitle() const noexcept
+{
+    return _title;
+}
+
+// Method Description:
+// - Takes the copy of the Terminal that the next frame is painted from, then holds
+//      off anyone using LockPainting until UnlockConsole is called. Unlike
+//      Terminal::LockConsole, the Terminal is only locked while the copy is taken.
+// - If the copy can't be taken, the frame is painted from the last one.
+void TerminalRenderFrame::LockConsole() noexcept
+{
+    try
+    {
+        _Capture();
+    }
+    CATCH_LOG();
+
+    _paintLock.lock();
+}
+
+// Method Description:
+// - Lets go of the frame after a call to TerminalRenderFrame::LockConsole.
+void TerminalRenderFrame::UnlockConsole() noexcept
+{
+    _paintLock.unlock();
+}
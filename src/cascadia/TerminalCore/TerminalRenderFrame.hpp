@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <conattrs.hpp>
+
+#include "../../buffer/out/textBuffer.hpp"
+#include "../../renderer/inc/IRenderData.hpp"
+#include "../../renderer/inc/DummyRenderTarget.hpp"
+#include "../../types/inc/Viewport.hpp"
+
+namespace Microsoft::Terminal::Core
+{
+    class Terminal;
+    class TerminalView;
+    class TerminalRenderFrame;
+}
+
+// A copy of everything the renderer needs from a Terminal to paint one frame.
+// LockConsole takes the copy under a short lock on the Terminal, and the frame is then
+//      painted without holding that lock, so a slow frame doesn't hold up output.
+// The text lives in a snapshot of the Terminal's buffer. Each frame only copies the rows
+//      in view that changed since the last one, and those share their cells with the
+//      Terminal until it writes to them again.
+// A frame paints one view of the Terminal - its primary view, unless it's given another.
+// A view that's scrolled up into the rows the buffer spilled is painted from a buffer of
+//      its own size instead, with those rows read back from the spill at its top.
+class Microsoft::Terminal::Core::TerminalRenderFrame final :
+    public Microsoft::Console::Render::IRenderData
+{
+public:
+    TerminalRenderFrame(Terminal& terminal) noexcept;
+    TerminalRenderFrame(Terminal& terminal, TerminalView& view) noexcept;
+    virtual ~TerminalRenderFrame() {};
+
+    [[nodiscard]]
+    std::unique_lock<std::mutex> LockPainting();
+
+    #pragma region IRenderData
+    Microsoft::Console::Types::Viewport GetViewport() noexcept override;
+    const TextBuffer& GetTextBuffer() noexcept override;
+    const FontInfo& GetFontInfo() noexcept override;
+    const TextAttribute GetDefaultBrushColors() noexcept override;
+    const COLORREF GetForegroundColor(const TextAttribute& attr) const noexcept override;
+    const COLORREF GetBackgroundColor(const TextAttribute& attr) const noexcept override;
+    COORD GetCursorPosition() const noexcept override;
+    bool IsCursorVisible() const noexcept override;
+    bool IsCursorOn() const noexcept override;
+    ULONG GetCursorHeight() const noexcept override;
+    ULONG GetCursorPixelWidth() const noexcept override;
+    CursorType GetCursorStyle() const noexcept override;
+    COLORREF GetCursorColor() const noexcept override;
+    bool IsCursorDoubleWidth() const noexcept override;
+    const std::vector<Microsoft::Console::Render::RenderOverlay> GetOverlays() const noexcept override;
+    const bool IsGridLineDrawingAllowed() noexcept override;
+    std::vector<Microsoft::Console::Types::Viewport> GetSelectionRects() noexcept override;
+    const std::wstring GetConsoleTitle() const noexcept override;
+    void LockConsole() noexcept override;
+    void UnlockConsole() noexcept override;
+    #pragma endregion
+
+private:
+    Terminal& _terminal;
+    TerminalView& _view;
+
+    // Held while a frame is painted, so that the engine isn't changed underneath it.
+    std::mutex _paintLock;
+
+    // The snapshot never sends render notifications anywhere. The renderer hears
+    //      about changes from the Terminal itself.
+    DummyRenderTarget _renderTarget;
+    std::unique_ptr<TextBuffer> _buffer;
+
+    // What the view shows when it's scrolled up into the spilled rows, and whether
+    //      it is. The spilled rows are read into _spilledRows on the way.
+    std::unique_ptr<TextBuffer> _spilledBuffer;
+    std::vector<ScrollbackSpill::SpilledRow> _spilledRows;
+    std::vector<OutputCell> _spilledCells;
+    bool _showingSpill;
+
+    // A snapshot of the predictive echo's overlay, if it's on screen.
+    std::unique_ptr<TextBuffer> _overlayBuffer;
+    COORD _overlayOrigin;
+    std::optional<Microsoft::Console::Types::Viewport> _overlayRegion;
+
+    Microsoft::Console::Types::Viewport _viewport;
+
+    COORD _cursorPosition;
+    bool _cursorVisible;
+    bool _cursorOn;
+    ULONG _cursorHeight;
+    ULONG _cursorPixelWidth;
+    CursorType _cursorStyle;
+    COLORREF _cursorColor;
+
+    std::vector<Microsoft::Console::Types::Viewport> _selectionRects;
+
+    std::wstring _title;
+
+    ResolvedColorTable _colors;
+
+    void _Capture();
+    void _CaptureSpilledRows(const TextBuffer& source, const size_t spilledAbove);
+};
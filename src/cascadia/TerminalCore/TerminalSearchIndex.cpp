@@ -0,0 +1,265 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "TerminalSearchIndex.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+TerminalSearchIndex::TerminalSearchIndex() noexcept :
+    _buffer{ nullptr },
+    _bufferSize{ 0, 0 },
+    _firstRowId{ 0 },
+    _rows{}
+{
+}
+
+// Method Description:
+// - Forgets everything that's been indexed. The next query indexes the whole buffer again.
+void TerminalSearchIndex::Reset() noexcept
+{
+    _buffer = nullptr;
+    _bufferSize = { 0, 0 };
+    _firstRowId = 0;
+    _rows.clear();
+}
+
+// Method Description:
+// - Brings the index up to date with the contents of the buffer. Only the rows
+//      that changed since the last update are read. If the buffer is a
+//      different one, or it's been resized, it's indexed again from scratch.
+// Arguments:
+// - buffer: the buffer to index. It mustn't change while we're looking at it.
+void TerminalSearchIndex::Update(const TextBuffer& buffer)
+{
+    const auto size = buffer.GetSize().Dimensions();
+    if (&buffer != _buffer || size.X != _bufferSize.X || size.Y != _bufferSize.Y)
+    {
+        Reset();
+        _buffer = &buffer;
+        _bufferSize = size;
+    }
+
+    // Let go of the rows that have circled out of the buffer since we last looked.
+    const auto circled = buffer.GetCircledRowCount();
+    while (!_rows.empty() && _firstRowId < circled)
+    {
+        _rows.pop_front();
+        ++_firstRowId;
+    }
+    if (_rows.empty())
+    {
+        _firstRowId = circled;
+    }
+
+    const size_t height = gsl::narrow<size_t>(size.Y);
+    std::optional<ROW> scratch;
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        const auto generation = buffer.GetRowGeneration(offset);
+        if (offset < _rows.size())
+        {
+            auto& entry = _rows.at(offset);
+            if (entry.generation != generation)
+            {
+                entry.generation = generation;
+                entry.signature = s_CreateSignature(buffer.GetRowByOffset(offset, scratch).GetText());
+            }
+        }
+        else
+        {
+            _rows.push_back({ generation, s_CreateSignature(buffer.GetRowByOffset(offset, scratch).GetText()) });
+        }
+    }
+}
+
+// Method Description:
+// - Finds every occurrence of a string in the buffer, and in the rows it spilled.
+//      A match has to fit in a single row. Matches in the same row don't overlap each other.
+// Arguments:
+// - buffer: the buffer to search. It mustn't change while we're looking at it.
+// - query: the text to look for
+// - sensitivity: whether letters have to match in case
+// Return Value:
+// - the matches, from the oldest spilled row down to the bottom of the buffer.
+std::vector<TerminalSearchIndex::Match> TerminalSearchIndex::FindAll(const TextBuffer& buffer,
+                                                                     const std::wstring_view query,
+                                                                     const Sensitivity sensitivity)
+{
+    std::vector<Match> matches;
+    if (query.empty())
+    {
+        return matches;
+    }
+
+    Update(buffer);
+
+    std::wstring needle{ query };
+    if (sensitivity == Sensitivity::CaseInsensitive)
+    {
+        std::transform(needle.begin(), needle.end(), needle.begin(), s_Fold);
+    }
+
+    // The signatures are always made from folded text, so they work for both sensitivities.
+    //      A query too short to have a trigram sets no bits, and every row is a candidate.
+    const auto wanted = s_CreateSignature(query);
+
+    std::wstring text;
+    std::vector<size_t> columns;
+
+    // The rows the buffer spilled are above all of its own, so they're searched first.
+    if (const auto spill = buffer.GetScrollbackSpill())
+    {
+        std::vector<ScrollbackSpill::SpilledRow> rows;
+        const auto spilledRows = spill->size();
+        for (size_t first = 0; first < spilledRows; first += s_SpillBatchRows)
+        {
+            spill->ReadRows(first, std::min(s_SpillBatchRows, spilledRows - first), rows);
+            for (size_t i = 0; i < rows.size(); ++i)
+            {
+                s_GetSpilledRowText(rows.at(i), text, columns);
+                s_FindInRow(text, columns, needle, sensitivity, { first + i, 0, 0, 0, true }, matches);
+            }
+        }
+    }
+
+    std::optional<ROW> scratch;
+    for (size_t offset = 0; offset < _rows.size(); ++offset)
+    {
+        const auto& entry = _rows.at(offset);
+        if (!s_MightContain(entry.signature, wanted))
+        {
+            continue;
+        }
+
+        s_GetRowText(buffer.GetRowByOffset(offset, scratch), text, columns);
+        s_FindInRow(text, columns, needle, sensitivity, { _firstRowId + offset, entry.generation, 0, 0, false }, matches);
+    }
+
+    return matches;
+}
+
+// Method Description:
+// - Finds every occurrence of the query in the text of one row. They don't overlap.
+// Arguments:
+// - text: the row's text. It's folded here if the search is case insensitive.
+// - columns: the column of each character of the text, as s_GetRowText gets them
+// - needle: the query, already folded if the search is case insensitive
+// - sensitivity: whether letters have to match in case
+// - row: where the row is. Each match is a copy of it, with the match's columns.
+// - matches: the matches are added to the end of this
+void TerminalSearchIndex::s_FindInRow(std::wstring& text,
+                                      const std::vector<size_t>& columns,
+                                      const std::wstring_view needle,
+                                      const Sensitivity sensitivity,
+                                      const Match& row,
+                                      std::vector<Match>& matches)
+{
+    if (sensitivity == Sensitivity::CaseInsensitive)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), s_Fold);
+    }
+
+    for (auto found = text.find(needle); found != std::wstring::npos; found = text.find(needle, found + needle.size()))
+    {
+        auto match = row;
+        match.startColumn = gsl::narrow<SHORT>(columns.at(found));
+        match.endColumn = gsl::narrow<SHORT>(columns.at(found + needle.size()) - 1);
+        matches.push_back(match);
+    }
+}
+
+// Method Description:
+// - Gets the character that a case insensitive comparison should use for this one.
+wchar_t TerminalSearchIndex::s_Fold(const wchar_t wch) noexcept
+{
+    return ::towlower(wch);
+}
+
+// Method Description:
+// - Makes the signature for a run of text, with one bit set for each trigram in it.
+TerminalSearchIndex::Signature TerminalSearchIndex::s_CreateSignature(const std::wstring_view text) noexcept
+{
+    Signature signature{};
+    for (size_t i = 2; i < text.size(); ++i)
+    {
+        uint32_t hash = (s_Fold(text[i - 2]) * 0x9E3779B1u) ^
+                        (s_Fold(text[i - 1]) * 0x85EBCA77u) ^
+                        (s_Fold(text[i]) * 0xC2B2AE3Du);
+        hash ^= hash >> 15;
+        const size_t bit = hash % s_SignatureBits;
+        signature[bit / 64] |= (1ull << (bit % 64));
+    }
+    return signature;
+}
+
+// Method Description:
+// - Checks if a row with the haystack signature could contain text with the needle signature.
+bool TerminalSearchIndex::s_MightContain(const Signature& haystack, const Signature& needle) noexcept
+{
+    for (size_t i = 0; i < s_SignatureWords; ++i)
+    {
+        if ((haystack[i] & needle[i]) != needle[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Method Description:
+// - Gets the text of a row, along with the column that each character of it came from.
+// Arguments:
+// - row: the row to read
+// - text: receives the text. The trailing halves of wide glyphs are skipped.
+// - columns: receives the column of each character in text, plus one more entry
+//      with the width of the row, so the last column of the glyph ending at text[i]
+//      is always columns[i + 1] - 1.
+void TerminalSearchIndex::s_GetRowText(const ROW& row, std::wstring& text, std::vector<size_t>& columns)
+{
+    text.clear();
+    columns.clear();
+
+    const auto& charRow = row.GetCharRow();
+    if (charRow.IsNarrowOnly())
+    {
+        text = charRow.GetText();
+        for (size_t column = 0; column <= text.size(); ++column)
+        {
+            columns.push_back(column);
+        }
+        return;
+    }
+
+    for (size_t column = 0; column < charRow.size(); ++column)
+    {
+        if (charRow.DbcsAttrAt(column).IsTrailing())
+        {
+            continue;
+        }
+
+        const std::wstring_view glyph = charRow.GlyphAt(column);
+        text.append(glyph);
+        columns.insert(columns.end(), glyph.size(), column);
+    }
+    columns.push_back(charRow.size());
+}
+
+// Method Description:
+// - Gets the text of a row that the buffer spilled, the same way s_GetRowText does.
+// Arguments:
+// - row: the row, as the spill hands it back
+// - text: receives the text
+// - columns: receives the column of each character in text, plus the width of the row
+void TerminalSearchIndex::s_GetSpilledRowText(const ScrollbackSpill::SpilledRow& row, std::wstring& text, std::vector<size_t>& columns)
+{
+    text = row.text;
+    columns.clear();
+
+    // The trailing half of a wide glyph has no text of its own.
+    for (size_t column = 0; column < row.width; ++column)
+    {
+        columns.insert(columns.end(), row.textOffsets.at(column + 1) - row.textOffsets.at(column), column);
+    }
+    columns.push_back(row.width);
+}
@@ -0,0 +1,84 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "../../buffer/out/textBuffer.hpp"
+
+namespace Microsoft::Terminal::Core
+{
+    class TerminalSearchIndex;
+}
+
+// An index over the rows of a text buffer, for finding every occurrence of a string quickly.
+// Each row gets a small signature with a bit set for every trigram (run of three
+//      characters) in its text. A row can only contain the query if its signature has all
+//      of the query's bits set, so only those rows have to have their text read and searched.
+// The index is brought up to date every time it's queried. Rows are tracked by
+//      generation, so only rows that were written to since the last query are indexed
+//      again, and rows that circle off the top of the buffer are simply dropped.
+// Rows the buffer spilled aren't indexed, since there's no end to them. Each query
+//      reads them back from the spill a batch at a time and searches their text.
+class Microsoft::Terminal::Core::TerminalSearchIndex final
+{
+public:
+    enum class Sensitivity
+    {
+        CaseInsensitive,
+        CaseSensitive
+    };
+
+    // Where a match was found. Rows are identified by their offset plus the buffer's
+    //      circled row count, so a match keeps pointing at the same text as the buffer
+    //      circles. The row's generation is kept to tell when that text is overwritten.
+    //      A row that the buffer spilled is identified by its index in the spill
+    //      instead. Its text never changes, so it has no generation.
+    struct Match
+    {
+        uint64_t row;
+        uint64_t generation;
+        SHORT startColumn;
+        SHORT endColumn; // inclusive
+        bool spilled;
+    };
+
+    TerminalSearchIndex() noexcept;
+
+    void Update(const TextBuffer& buffer);
+    std::vector<Match> FindAll(const TextBuffer& buffer,
+                               const std::wstring_view query,
+                               const Sensitivity sensitivity);
+    void Reset() noexcept;
+
+private:
+    // how many spilled rows are read under one hold of the spill's lock.
+    static constexpr size_t s_SpillBatchRows = 256;
+
+    static constexpr size_t s_SignatureWords = 8;
+    static constexpr size_t s_SignatureBits = s_SignatureWords * 64;
+    using Signature = std::array<uint64_t, s_SignatureWords>;
+
+    struct RowEntry
+    {
+        uint64_t generation;
+        Signature signature;
+    };
+
+    const TextBuffer* _buffer;
+    COORD _bufferSize;
+    // the circled row count of the buffer when _rows.front() was indexed.
+    uint64_t _firstRowId;
+    std::deque<RowEntry> _rows;
+
+    static wchar_t s_Fold(const wchar_t wch) noexcept;
+    static Signature s_CreateSignature(const std::wstring_view text) noexcept;
+    static bool s_MightContain(const Signature& haystack, const Signature& needle) noexcept;
+    static void s_GetRowText(const ROW& row, std::wstring& text, std::vector<size_t>& columns);
+    static void s_GetSpilledRowText(const ScrollbackSpill::SpilledRow& row, std::wstring& text, std::vector<size_t>& columns);
+    static void s_FindInRow(std::wstring& text,
+                            const std::vector<size_t>& columns,
+                            const std::wstring_view needle,
+                            const Sensitivity sensitivity,
+                            const Match& row,
+                            std::vector<Match>& matches);
+};
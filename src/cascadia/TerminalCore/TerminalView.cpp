@@ -0,0 +1,739 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "TerminalView.hpp"
+#include "Terminal.hpp"
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Types;
+
+TerminalView::TerminalView(Terminal& terminal) noexcept :
+    _terminal{ terminal },
+    _renderTarget{ nullptr },
+    _height{},
+    _scrollOffset{ 0 },
+    _mainScrollOffset{ 0 },
+    _pfnScrollPositionChanged{ nullptr },
+    _lastScrollPosition{},
+    _selectionAnchor{ 0, 0 },
+    _endSelectionPosition{ 0, 0 },
+    _boxSelection{ false },
+    _selectionActive{ false },
+    _selectionAnchor_YOffset{ 0 },
+    _endSelectionPosition_YOffset{ 0 }
+{
+}
+
+TerminalView::~TerminalView()
+{
+    Detach();
+}
+
+// Method Description:
+// - Starts showing the Terminal in this view. From here on, the given render
+//      target hears about every change to the Terminal's buffers, along with
+//      the render targets of every other view.
+// Arguments:
+// - renderTarget: where this view's render notifications should go
+void TerminalView::Attach(IRenderTarget& renderTarget)
+{
+    _renderTarget = &renderTarget;
+    _terminal._views.Add(*this);
+}
+
+// Method Description:
+// - Stops showing the Terminal in this view. Its render target won't hear
+//      about anything the Terminal does after this.
+void TerminalView::Detach() noexcept
+{
+    if (_renderTarget)
+    {
+        _terminal._views.Remove(*this);
+        _renderTarget = nullptr;
+    }
+}
+
+// Method Description:
+// - Gets the part of the buffer that this view shows, in buffer coordinates.
+Viewport TerminalView::_GetVisibleViewport() const noexcept
+{
+    const COORD origin{ 0, gsl::narrow_cast<SHORT>(_VisibleStartIndex()) };
+    return Viewport::FromDimensions(origin, { _terminal._mutableViewport.Width(), _GetHeight() });
+}
+
+// Method Description:
+// - Makes this view a different height than the Terminal's viewport, for a pane
+//      that's shorter or taller than the one the connection was sized for. The
+//      bottom of the view stays at the bottom of the Terminal's viewport. Only
+//      views other than the primary one should be given a height of their own.
+// Arguments:
+// - height: how many rows the view has, or 0 to follow the Terminal's viewport again
+void TerminalView::SetViewHeight(const SHORT height)
+{
+    if (height > 0)
+    {
+        _height = height;
+    }
+    else
+    {
+        _height.reset();
+    }
+
+    if (_renderTarget)
+    {
+        _renderTarget->TriggerRedrawAll();
+    }
+    _NotifyScrollEvent();
+}
+
+void TerminalView::UserScrollViewport(const int viewTop)
+{
+    // The scrollbar counts from the oldest row the buffer spilled.
+    const auto clampedNewTop = std::max(0, viewTop);
+    const auto realTop = _SpilledRowCount() + _ViewStartIndex();
+    const auto newDelta = realTop - clampedNewTop;
+    // if viewTop > realTop, we want the offset to be 0.
+
+    const auto wasInSpill = GetSpilledRowsAbove() > 0;
+    _scrollOffset = std::max(0, newDelta);
+
+    // The scrollbar's already where the user put it.
+    _lastScrollPosition = _GetScrollPosition();
+
+    // This view moved, and its renderer will work out by how much. The other
+    //      views stay where they were. While the view shows spilled rows, its
+    //      top is painted at the top of the buffer whatever it shows, so there's
+    //      nothing to work out, and it's painted again in full.
+    if (_renderTarget)
+    {
+        if (wasInSpill || GetSpilledRowsAbove() > 0)
+        {
+            _renderTarget->TriggerRedrawAll();
+        }
+        else
+        {
+            _renderTarget->TriggerScroll();
+        }
+    }
+}
+
+int TerminalView::GetScrollOffset() const noexcept
+{
+    return _SpilledRowCount() - GetSpilledRowsAbove() + _VisibleStartIndex();
+}
+
+// Method Description:
+// - Gets how far this view's been scrolled up past the top of the buffer, into the
+//      rows it spilled. The view shows that many of them above the buffer's top row.
+//      Everything in the view is painted that many rows further down than it is.
+// Return Value:
+// - The number of spilled rows in view above the top of the buffer, or 0 if the
+//      view isn't scrolled up that far.
+int TerminalView::GetSpilledRowsAbove() const noexcept
+{
+    return std::clamp(_scrollOffset - _ViewStartIndex(), 0, _SpilledRowCount());
+}
+
+void TerminalView::SetScrollPositionChangedCallback(std::function<void(const int, const int, const int)> pfn) noexcept
+{
+    _pfnScrollPositionChanged = pfn;
+}
+
+// Method Description:
+// - Sends a key event to the Terminal's connection. See Terminal::SendKeyEvent.
+bool TerminalView::SendKeyEvent(const WORD vkey,
+                                const bool ctrlPressed,
+                                const bool altPressed,
+                                const bool shiftPressed)
+{
+    _SnapOnInput();
+    return _terminal._SendKeyEvent(vkey, ctrlPressed, altPressed, shiftPressed);
+}
+
+// Method Description:
+// - Sends pasted text to the Terminal's connection. See Terminal::SendPaste.
+void TerminalView::SendPaste(std::wstring_view text)
+{
+    if (!_terminal._pfnWriteInput || text.empty())
+    {
+        return;
+    }
+
+    _SnapOnInput();
+    _terminal._SendPaste(text);
+}
+
+// Method Description:
+// - Checks if selection is active
+// Return Value:
+// - bool representing if selection is active. Used to decide copy/paste on right click
+const bool TerminalView::IsSelectionActive() const noexcept
+{
+    return _selectionActive;
+}
+
+// Method Description:
+// - Record the position of the beginning of a selection
+// Arguments:
+// - position: the (x,y) coordinate on the visible viewport
+void TerminalView::SetSelectionAnchor(const COORD position)
+{
+    _selectionAnchor = position;
+
+    // include _scrollOffset here to ensure this maps to the right spot of the original viewport
+    THROW_IF_FAILED(ShortSub(_selectionAnchor.Y, gsl::narrow<SHORT>(_scrollOffset), &_selectionAnchor.Y));
+
+    // copy value of ViewStartIndex to support scrolling
+    // and update on new buffer output (used in _GetSelectionRects())
+    _selectionAnchor_YOffset = gsl::narrow<SHORT>(_ViewStartIndex());
+
+    _selectionActive = true;
+    SetEndSelectionPosition(position);
+}
+
+// Method Description:
+// - Record the position of the end of a selection
+// Arguments:
+// - position: the (x,y) coordinate on the visible viewport
+void TerminalView::SetEndSelectionPosition(const COORD position)
+{
+    _endSelectionPosition = position;
+
+    // include _scrollOffset here to ensure this maps to the right spot of the original viewport
+    THROW_IF_FAILED(ShortSub(_endSelectionPosition.Y, gsl::narrow<SHORT>(_scrollOffset), &_endSelectionPosition.Y));
+
+    // copy value of ViewStartIndex to support scrolling
+    // and update on new buffer output (used in _GetSelectionRects())
+    _endSelectionPosition_YOffset = gsl::narrow<SHORT>(_ViewStartIndex());
+}
+
+// Method Description:
+// - enable/disable box selection (ALT + selection)
+// Arguments:
+// - isEnabled: new value for _boxSelection
+void TerminalView::SetBoxSelection(const bool isEnabled) noexcept
+{
+    _boxSelection = isEnabled;
+}
+
+// Method Description:
+// - clear selection data and disable rendering it. Only this view is repainted.
+void TerminalView::ClearSelection() noexcept
+{
+    _selectionActive = false;
+    _selectionAnchor = { 0, 0 };
+    _endSelectionPosition = { 0, 0 };
+    _selectionAnchor_YOffset = 0;
+    _endSelectionPosition_YOffset = 0;
+
+    if (_renderTarget)
+    {
+        _renderTarget->TriggerSelection();
+    }
+}
+
+// Method Description:
+// - get wstring text from highlighted portion of text buffer
+// Arguments:
+// - trimTrailingWhitespace: enable removing any whitespace from copied selection
+//    and get text to appear on separate lines.
+// Return Value:
+// - wstring text from buffer. If extended to multiple lines, each line is separated by \r\n
+const std::wstring TerminalView::RetrieveSelectedTextFromBuffer(bool trimTrailingWhitespace) const
+{
+    // We only copy plain text, so there's no need to work out any colors.
+    std::wstring result;
+    _terminal._buffer->GetSelectedText(!_boxSelection,
+                                       trimTrailingWhitespace,
+                                       _GetSelectionRects(),
+                                       result);
+    return result;
+}
+
+Viewport TerminalView::GetViewport() noexcept
+{
+    return _GetVisibleViewport();
+}
+
+const TextBuffer& TerminalView::GetTextBuffer() noexcept
+{
+    return _terminal.GetTextBuffer();
+}
+
+const FontInfo& TerminalView::GetFontInfo() noexcept
+{
+    return _terminal.GetFontInfo();
+}
+
+const TextAttribute TerminalView::GetDefaultBrushColors() noexcept
+{
+    return _terminal.GetDefaultBrushColors();
+}
+
+const COLORREF TerminalView::GetForegroundColor(const TextAttribute& attr) const noexcept
+{
+    return _terminal.GetForegroundColor(attr);
+}
+
+const COLORREF TerminalView::GetBackgroundColor(const TextAttribute& attr) const noexcept
+{
+    return _terminal.GetBackgroundColor(attr);
+}
+
+COORD TerminalView::GetCursorPosition() const noexcept
+{
+    return std::as_const(_terminal).GetCursorPosition();
+}
+
+bool TerminalView::IsCursorVisible() const noexcept
+{
+    return _terminal.IsCursorVisible();
+}
+
+bool TerminalView::IsCursorOn() const noexcept
+{
+    return _terminal.IsCursorOn();
+}
+
+ULONG TerminalView::GetCursorHeight() const noexcept
+{
+    return _terminal.GetCursorHeight();
+}
+
+ULONG TerminalView::GetCursorPixelWidth() const noexcept
+{
+    return _terminal.GetCursorPixelWidth();
+}
+
+CursorType TerminalView::GetCursorStyle() const noexcept
+{
+    return _terminal.GetCursorStyle();
+}
+
+COLORREF TerminalView::GetCursorColor() const noexcept
+{
+    return _terminal.GetCursorColor();
+}
+
+bool TerminalView::IsCursorDoubleWidth() const noexcept
+{
+    return _terminal.IsCursorDoubleWidth();
+}
+
+const std::vector<RenderOverlay> TerminalView::GetOverlays() const noexcept
+{
+    try
+    {
+        if (const auto overlay = _terminal._predictiveEcho.GetOverlay(_GetVisibleViewport()))
+        {
+            return { *overlay };
+        }
+    }
+    CATCH_LOG();
+    return {};
+}
+
+const bool TerminalView::IsGridLineDrawingAllowed() noexcept
+{
+    return _terminal.IsGridLineDrawingAllowed();
+}
+
+// Method Description:
+// - Gets what's highlighted in this view: its selection, and the matches of the
+//      Terminal's last search that it shows.
+// Return Value:
+// - A rectangle for each row of the selection and each match, in buffer coordinates.
+//      If the view's scrolled up into the rows the buffer spilled, they're moved
+//      down the way the view's painted, and only the ones in view are kept.
+std::vector<Viewport> TerminalView::GetSelectionRects() noexcept
+{
+    std::vector<Viewport> result;
+
+    const auto visible = _GetVisibleViewport();
+    const auto spilledAbove = GetSpilledRowsAbove();
+    for (auto lineRect : _GetSelectionRects())
+    {
+        if (spilledAbove > 0)
+        {
+            const auto row = lineRect.Top + spilledAbove;
+            if (row < visible.Top() || row > visible.BottomInclusive())
+            {
+                continue;
+            }
+            lineRect.Top = gsl::narrow_cast<SHORT>(row);
+            lineRect.Bottom = lineRect.Top;
+        }
+        result.emplace_back(Viewport::FromInclusive(lineRect));
+    }
+
+    for (const auto& highlight : _terminal._GetSearchHighlightRects(visible, spilledAbove))
+    {
+        result.emplace_back(Viewport::FromInclusive(highlight));
+    }
+
+    return result;
+}
+
+const std::wstring TerminalView::GetConsoleTitle() const noexcept
+{
+    return _terminal.GetConsoleTitle();
+}
+
+void TerminalView::LockConsole() noexcept
+{
+    _terminal.LockConsole();
+}
+
+void TerminalView::UnlockConsole() noexcept
+{
+    _terminal.UnlockConsole();
+}
+
+// Method Description:
+// - Gets how many rows this view shows. It can't be any taller than the buffer.
+SHORT TerminalView::_GetHeight() const noexcept
+{
+    if (!_height)
+    {
+        return _terminal._mutableViewport.Height();
+    }
+    return std::min(*_height, _terminal._buffer->GetSize().Height());
+}
+
+// _ViewStartIndex is where the top of this view is when it's scrolled all the
+//      way down. Its bottom is the Terminal's viewport's.
+int TerminalView::_ViewStartIndex() const noexcept
+{
+    return std::max(0, _terminal._mutableViewport.BottomExclusive() - _GetHeight());
+}
+
+// _VisibleStartIndex is the first visible line of the buffer
+int TerminalView::_VisibleStartIndex() const noexcept
+{
+    return std::max(0, _ViewStartIndex() - _scrollOffset);
+}
+
+// _SpilledRowCount is how many rows the buffer has spilled, as far as the
+//      scrollbar can count them.
+int TerminalView::_SpilledRowCount() const noexcept
+{
+    constexpr size_t limit = std::numeric_limits<int>::max() / 2;
+    return gsl::narrow_cast<int>(std::min(_terminal._buffer->GetSpilledRowCount(), limit));
+}
+
+// Method Description:
+// - Gets where this view is in the buffer, as the scrollbar shows it. The
+//      scrollbar counts from the oldest row the buffer spilled.
+// Return Value:
+// - The top of the view, its height, and the height of the buffer, spilled rows included.
+std::tuple<int, int, int> TerminalView::_GetScrollPosition() const noexcept
+{
+    const auto spilled = _SpilledRowCount();
+    const auto visible = _GetVisibleViewport();
+    return { spilled - GetSpilledRowsAbove() + visible.Top(),
+             visible.Height(),
+             spilled + std::max<int>(_terminal.GetBufferHeight(), visible.BottomExclusive()) };
+}
+
+// Method Description:
+// - Tells the scrollbar where this view is now, unless that's where it was the
+//      last time. Once the buffer's full, output that scrolls the viewport leaves
+//      it in the same place, so most of these go nowhere.
+void TerminalView::_NotifyScrollEvent()
+{
+    if (_pfnScrollPositionChanged)
+    {
+        const auto position = _GetScrollPosition();
+        if (position == _lastScrollPosition)
+        {
+            return;
+        }
+        _lastScrollPosition = position;
+
+        const auto [top, height, bottom] = position;
+        _pfnScrollPositionChanged(top, height, bottom);
+    }
+}
+
+// Method Description:
+// - Scrolls this view back down to the bottom before input's sent, if the
+//      settings say to. Takes the write lock to do it.
+void TerminalView::_SnapOnInput()
+{
+    if (_terminal._snapOnInput && _scrollOffset != 0)
+    {
+        auto lock = _terminal.LockForWriting();
+        if (_renderTarget && GetSpilledRowsAbove() > 0)
+        {
+            _renderTarget->TriggerRedrawAll();
+        }
+        _scrollOffset = 0;
+        _NotifyScrollEvent();
+    }
+}
+
+// Method Description:
+// - Keeps track of where the main buffer was scrolled to, while the alt buffer
+//      (which has no scrollback to scroll) is in use.
+// Arguments:
+// - toAltBuffer: true if the Terminal's switching to the alt buffer, false if it's
+//      switching back to the main one.
+void TerminalView::_SwitchBuffer(const bool toAltBuffer) noexcept
+{
+    if (toAltBuffer)
+    {
+        _mainScrollOffset = _scrollOffset;
+        _scrollOffset = 0;
+    }
+    else
+    {
+        _scrollOffset = _mainScrollOffset;
+    }
+}
+
+// Method Description:
+// - Scrolls this view back down to the bottom, after the Terminal's been resized.
+// Arguments:
+// - inAltBuffer: true if the alt buffer's in use, in which case where the main
+//      buffer was scrolled to is forgotten too.
+void TerminalView::_ResetScroll(const bool inAltBuffer)
+{
+    if (inAltBuffer)
+    {
+        _mainScrollOffset = 0;
+    }
+    _scrollOffset = 0;
+    _NotifyScrollEvent();
+}
+
+// Method Description:
+// - Helper to determine the selected region of the buffer. Used for rendering.
+// Return Value:
+// - A vector of rectangles representing the regions to select, line by line. They are absolute coordinates relative to the buffer origin.
+std::vector<SMALL_RECT> TerminalView::_GetSelectionRects() const
+{
+    std::vector<SMALL_RECT> selectionArea;
+
+    if (!_selectionActive)
+    {
+        return selectionArea;
+    }
+
+    // Add anchor offset here to update properly on new buffer output
+    SHORT temp1, temp2;
+    THROW_IF_FAILED(ShortAdd(_selectionAnchor.Y, _selectionAnchor_YOffset, &temp1));
+    THROW_IF_FAILED(ShortAdd(_endSelectionPosition.Y, _endSelectionPosition_YOffset, &temp2));
+
+    // create these new anchors for comparison and rendering
+    const COORD selectionAnchorWithOffset = { _selectionAnchor.X, temp1 };
+    const COORD endSelectionPositionWithOffset = { _endSelectionPosition.X, temp2 };
+
+    // NOTE: (0,0) is top-left so vertical comparison is inverted
+    const COORD& higherCoord = (selectionAnchorWithOffset.Y <= endSelectionPositionWithOffset.Y) ? selectionAnchorWithOffset : endSelectionPositionWithOffset;
+    const COORD& lowerCoord = (selectionAnchorWithOffset.Y > endSelectionPositionWithOffset.Y) ? selectionAnchorWithOffset : endSelectionPositionWithOffset;
+
+    selectionArea.reserve(lowerCoord.Y - higherCoord.Y + 1);
+    for (auto row = higherCoord.Y; row <= lowerCoord.Y; row++)
+    {
+        SMALL_RECT selectionRow;
+
+        selectionRow.Top = row;
+        selectionRow.Bottom = row;
+
+        if (_boxSelection || higherCoord.Y == lowerCoord.Y)
+        {
+            selectionRow.Left = std::min(higherCoord.X, lowerCoord.X);
+            selectionRow.Right = std::max(higherCoord.X, lowerCoord.X);
+        }
+        else
+        {
+            selectionRow.Left = (row == higherCoord.Y) ? higherCoord.X : 0;
+            selectionRow.Right = (row == lowerCoord.Y) ? lowerCoord.X : _terminal._buffer->GetSize().RightInclusive();
+        }
+
+        selectionArea.emplace_back(selectionRow);
+    }
+    return selectionArea;
+}
+
+TerminalViewGroup::TerminalViewGroup() noexcept :
+    _views{}
+{
+}
+
+// Method Description:
+// - Adds a view to the group, if it isn't in it already.
+void TerminalViewGroup::Add(TerminalView& view)
+{
+    if (std::find(_views.cbegin(), _views.cend(), &view) == _views.cend())
+    {
+        _views.push_back(&view);
+    }
+}
+
+// Method Description:
+// - Takes a view out of the group, if it's in it.
+void TerminalViewGroup::Remove(TerminalView& view) noexcept
+{
+    _views.erase(std::remove(_views.begin(), _views.end(), &view), _views.end());
+}
+
+const std::vector<TerminalView*>& TerminalViewGroup::GetViews() const noexcept
+{
+    return _views;
+}
+
+void TerminalViewGroup::TriggerRedraw(const Viewport& region)
+{
+    for (auto* const view : _views)
+    {
+        if (view->GetSpilledRowsAbove() > 0)
+        {
+            view->_renderTarget->TriggerRedrawAll();
+        }
+        else
+        {
+            view->_renderTarget->TriggerRedraw(region);
+        }
+    }
+}
+
+void TerminalViewGroup::TriggerRedraw(const COORD* const pcoord)
+{
+    for (auto* const view : _views)
+    {
+        if (view->GetSpilledRowsAbove() > 0)
+        {
+            view->_renderTarget->TriggerRedrawAll();
+        }
+        else
+        {
+            view->_renderTarget->TriggerRedraw(pcoord);
+        }
+    }
+}
+
+void TerminalViewGroup::TriggerRedrawCursor(const COORD* const pcoord)
+{
+    for (auto* const view : _views)
+    {
+        if (view->GetSpilledRowsAbove() > 0)
+        {
+            view->_renderTarget->TriggerRedrawAll();
+        }
+        else
+        {
+            view->_renderTarget->TriggerRedrawCursor(pcoord);
+        }
+    }
+}
+
+void TerminalViewGroup::TriggerRedrawAll()
+{
+    for (auto* const view : _views)
+    {
+        view->_renderTarget->TriggerRedrawAll();
+    }
+}
+
+void TerminalViewGroup::TriggerTeardown()
+{
+    for (auto* const view : _views)
+    {
+        view->_renderTarget->TriggerTeardown();
+    }
+}
+
+void TerminalViewGroup::TriggerSelection()
+{
+    for (auto* const view : _views)
+    {
+        view->_renderTarget->TriggerSelection();
+    }
+}
+
+void TerminalViewGroup::TriggerScroll()
+{
+    for (auto* const view : _views)
+    {
+        if (view->GetSpilledRowsAbove() > 0)
+        {
+            view->_renderTarget->TriggerRedrawAll();
+        }
+        else
+        {
+            view->_renderTarget->TriggerScroll();
+        }
+    }
+}
+
+void TerminalViewGroup::TriggerScroll(const COORD* const pcoordDelta)
+{
+    for (auto* const view : _views)
+    {
+        if (view->GetSpilledRowsAbove() > 0)
+        {
+            view->_renderTarget->TriggerRedrawAll();
+        }
+        else
+        {
+            view->_renderTarget->TriggerScroll(pcoordDelta);
+        }
+    }
+}
+
+void TerminalViewGroup::TriggerScroll(const Viewport& region, const COORD* const pcoordDelta)
+{
+    for (auto* const view : _views)
+    {
+        if (view->GetSpilledRowsAbove() > 0)
+        {
+            view->_renderTarget->TriggerRedrawAll();
+        }
+        else
+        {
+            view->_renderTarget->TriggerScroll(region, pcoordDelta);
+        }
+    }
+}
+
+void TerminalViewGroup::TriggerCircling()
+{
+    for (auto* const view : _views)
+    {
+        if (view->GetSpilledRowsAbove() > 0)
+        {
+            view->_renderTarget->TriggerRedrawAll();
+        }
+        else
+        {
+            view->_renderTarget->TriggerCircling();
+        }
+    }
+}
+
+void TerminalViewGroup::TriggerTitleChange()
+{
+    for (auto* const view : _views)
+    {
+        view->_renderTarget->TriggerTitleChange();
+    }
+}
+
+void TerminalViewGroup::BeginBatch()
+{
+    for (auto* const view : _views)
+    {
+        view->_renderTarget->BeginBatch();
+    }
+}
+
+void TerminalViewGroup::EndBatch()
+{
+    for (auto* const view : _views)
+    {
+        view->_renderTarget->EndBatch();
+    }
+}
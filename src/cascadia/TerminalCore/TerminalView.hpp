@@ -0,0 +1,175 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "../../renderer/inc/IRenderData.hpp"
+#include "../../renderer/inc/IRenderTarget.hpp"
+#include "../../types/inc/Viewport.hpp"
+
+namespace Microsoft::Terminal::Core
+{
+    class Terminal;
+    class TerminalView;
+    class TerminalViewGroup;
+}
+
+// One view of a Terminal: where it's scrolled to, what's selected in it, and the
+//      render target that paints it. Everything else - the buffers, the parser, the
+//      connection's input - belongs to the Terminal, and is shared by all of its views.
+// Every Terminal has a primary view, which is the one the Terminal's own scrolling
+//      and selection methods use. More can be made to show the same session in
+//      another pane or window, say one that follows the output while another stays
+//      scrolled back. They cost a renderer each, and nothing more is parsed or kept.
+// A view that isn't the primary one can also be shorter or taller than the
+//      Terminal's viewport (see SetViewHeight). It's the same width, as the rows are.
+// If the buffer spills the rows that go off its top, a view can be scrolled up past
+//      the top of the buffer into them. It's then painted as if the top of the view
+//      were the top of the buffer, so everything in it is moved down (see
+//      GetSpilledRowsAbove), and whatever changes in it is painted again in full.
+// A view is the render data of its renderer, which works out what to repaint from
+//      it. The renderer paints from a TerminalRenderFrame taken of the same view.
+// Unless it says otherwise, the caller should hold the Terminal's write lock.
+class Microsoft::Terminal::Core::TerminalView final :
+    public Microsoft::Console::Render::IRenderData
+{
+public:
+    TerminalView(Terminal& terminal) noexcept;
+    virtual ~TerminalView();
+
+    TerminalView(const TerminalView&) = delete;
+    TerminalView& operator=(const TerminalView&) = delete;
+
+    void Attach(Microsoft::Console::Render::IRenderTarget& renderTarget);
+    void Detach() noexcept;
+
+    void SetViewHeight(const SHORT height);
+
+    void UserScrollViewport(const int viewTop);
+    int GetScrollOffset() const noexcept;
+    int GetSpilledRowsAbove() const noexcept;
+    void SetScrollPositionChangedCallback(std::function<void(const int, const int, const int)> pfn) noexcept;
+
+    // Input's sent to the Terminal's connection, as it would be from the Terminal,
+    //      but it's this view that snaps to the bottom (if the settings say so).
+    //      These take the lock themselves, if they need it.
+    bool SendKeyEvent(const WORD vkey,
+                      const bool ctrlPressed,
+                      const bool altPressed,
+                      const bool shiftPressed);
+    void SendPaste(std::wstring_view text);
+
+    #pragma region TextSelection
+    const bool IsSelectionActive() const noexcept;
+    void SetSelectionAnchor(const COORD position);
+    void SetEndSelectionPosition(const COORD position);
+    void SetBoxSelection(const bool isEnabled) noexcept;
+    void ClearSelection() noexcept;
+
+    const std::wstring RetrieveSelectedTextFromBuffer(bool trimTrailingWhitespace) const;
+    #pragma endregion
+
+    #pragma region IRenderData
+    // Everything but what's in view, and what's highlighted in it, is the Terminal's.
+    Microsoft::Console::Types::Viewport GetViewport() noexcept override;
+    const TextBuffer& GetTextBuffer() noexcept override;
+    const FontInfo& GetFontInfo() noexcept override;
+    const TextAttribute GetDefaultBrushColors() noexcept override;
+    const COLORREF GetForegroundColor(const TextAttribute& attr) const noexcept override;
+    const COLORREF GetBackgroundColor(const TextAttribute& attr) const noexcept override;
+    COORD GetCursorPosition() const noexcept override;
+    bool IsCursorVisible() const noexcept override;
+    bool IsCursorOn() const noexcept override;
+    ULONG GetCursorHeight() const noexcept override;
+    ULONG GetCursorPixelWidth() const noexcept override;
+    CursorType GetCursorStyle() const noexcept override;
+    COLORREF GetCursorColor() const noexcept override;
+    bool IsCursorDoubleWidth() const noexcept override;
+    const std::vector<Microsoft::Console::Render::RenderOverlay> GetOverlays() const noexcept override;
+    const bool IsGridLineDrawingAllowed() noexcept override;
+    std::vector<Microsoft::Console::Types::Viewport> GetSelectionRects() noexcept override;
+    const std::wstring GetConsoleTitle() const noexcept override;
+    void LockConsole() noexcept override;
+    void UnlockConsole() noexcept override;
+    #pragma endregion
+
+private:
+    // The Terminal changes what's in view when it resizes or switches buffers,
+    //      and its group hands the render notifications on to _renderTarget.
+    friend class Terminal;
+    friend class TerminalViewGroup;
+
+    Terminal& _terminal;
+    Microsoft::Console::Render::IRenderTarget* _renderTarget; // non ownership pointer
+
+    // How many rows this view has, if it isn't the Terminal's viewport's height.
+    std::optional<SHORT> _height;
+
+    // _scrollOffset is the number of rows this view is scrolled up from the
+    //      bottom of the Terminal's viewport. Past the top of the buffer, it goes
+    //      on into the rows the buffer spilled.
+    int _scrollOffset;
+    // Where the main buffer was scrolled to while the alt buffer is in use.
+    int _mainScrollOffset;
+
+    std::function<void(const int, const int, const int)> _pfnScrollPositionChanged;
+    // What the scrollbar was last told, so that it isn't told the same again.
+    std::optional<std::tuple<int, int, int>> _lastScrollPosition;
+
+    // Text Selection
+    COORD _selectionAnchor;
+    COORD _endSelectionPosition;
+    bool _boxSelection;
+    bool _selectionActive;
+    SHORT _selectionAnchor_YOffset;
+    SHORT _endSelectionPosition_YOffset;
+
+    Microsoft::Console::Types::Viewport _GetVisibleViewport() const noexcept;
+    int _ViewStartIndex() const noexcept;
+    int _VisibleStartIndex() const noexcept;
+    int _SpilledRowCount() const noexcept;
+    SHORT _GetHeight() const noexcept;
+
+    std::tuple<int, int, int> _GetScrollPosition() const noexcept;
+    void _NotifyScrollEvent();
+    void _SnapOnInput();
+    void _SwitchBuffer(const bool toAltBuffer) noexcept;
+    void _ResetScroll(const bool inAltBuffer);
+
+    std::vector<SMALL_RECT> _GetSelectionRects() const;
+};
+
+// Passes the render notifications of a Terminal's buffers on to the render target
+//      of every view that's attached to it, so each renderer hears about the changes.
+// A view that's scrolled up into the rows the buffer spilled is painted moved down
+//      from where its rows are, so it's told to paint everything again instead.
+class Microsoft::Terminal::Core::TerminalViewGroup final :
+    public Microsoft::Console::Render::IRenderTarget
+{
+public:
+    TerminalViewGroup() noexcept;
+    virtual ~TerminalViewGroup() {};
+
+    void Add(TerminalView& view);
+    void Remove(TerminalView& view) noexcept;
+    const std::vector<TerminalView*>& GetViews() const noexcept;
+
+    #pragma region IRenderTarget
+    void TriggerRedraw(const Microsoft::Console::Types::Viewport& region) override;
+    void TriggerRedraw(const COORD* const pcoord) override;
+    void TriggerRedrawCursor(const COORD* const pcoord) override;
+    void TriggerRedrawAll() override;
+    void TriggerTeardown() override;
+    void TriggerSelection() override;
+    void TriggerScroll() override;
+    void TriggerScroll(const COORD* const pcoordDelta) override;
+    void TriggerScroll(const Microsoft::Console::Types::Viewport& region, const COORD* const pcoordDelta) override;
+    void TriggerCircling() override;
+    void TriggerTitleChange() override;
+    void BeginBatch() override;
+    void EndBatch() override;
+    #pragma endregion
+
+private:
+    std::vector<TerminalView*> _views; // non ownership pointers
+};
@@ -10,7 +10,7 @@ using namespace Microsoft::Console::Render;
 
 Viewport Terminal::GetViewport() noexcept
 {
-    return _GetVisibleViewport();
+    return _primaryView.GetViewport();
 }
 
 const TextBuffer& Terminal::GetTextBuffer() noexcept
@@ -37,25 +37,20 @@ const TextAttribute Terminal::GetDefaultBrushColors() noexcept
 
 const COLORREF Terminal::GetForegroundColor(const TextAttribute& attr) const noexcept
 {
-    return 0xff000000 | attr.CalculateRgbForeground({ &_colorTable[0], _colorTable.size() }, _defaultFg, _defaultBg);
+    return _resolvedColors.GetForeground(attr);
 }
 
 const COLORREF Terminal::GetBackgroundColor(const TextAttribute& attr) const noexcept
 {
-    const auto bgColor = attr.CalculateRgbBackground({ &_colorTable[0], _colorTable.size() }, _defaultFg, _defaultBg);
-    // We only care about alpha for the default BG (which enables acrylic)
-    // If the bg isn't the default bg color, then make it fully opaque.
-    if (!attr.BackgroundIsDefault())
-    {
-        return 0xff000000 | bgColor;
-    }
-    return bgColor;
+    // We only care about alpha for the default BG (which enables acrylic).
+    //      Any other bg is fully opaque.
+    return _resolvedColors.GetBackground(attr);
 }
 
 COORD Terminal::GetCursorPosition() const noexcept
 {
     const auto& cursor = _buffer->GetCursor();
-    return cursor.GetPosition();
+    return _predictiveEcho.GetCursorPosition(cursor.GetPosition());
 }
 
 bool Terminal::IsCursorVisible() const noexcept
@@ -97,6 +92,14 @@ bool Terminal::IsCursorDoubleWidth() const noexcept
 
 const std::vector<RenderOverlay> Terminal::GetOverlays() const noexcept
 {
+    try
+    {
+        if (const auto overlay = _predictiveEcho.GetOverlay(_primaryView._GetVisibleViewport()))
+        {
+            return { *overlay };
+        }
+    }
+    CATCH_LOG();
     return {};
 }
 
@@ -107,14 +110,7 @@ const bool Terminal::IsGridLineDrawingAllowed() noexcept
 
 std::vector<Microsoft::Console::Types::Viewport> Terminal::GetSelectionRects() noexcept
 {
-    std::vector<Viewport> result;
-
-    for (const auto& lineRect : _GetSelectionRects())
-    {
-        result.emplace_back(Viewport::FromInclusive(lineRect));
-    }
-
-    return result;
+    return _primaryView.GetSelectionRects();
 }
 
 const std::wstring Terminal::GetConsoleTitle() const noexcept
@@ -130,7 +126,9 @@ const std::wstring Terminal::GetConsoleTitle() const noexcept
 //      they're done with any querying they need to do.
 void Terminal::LockConsole()  noexcept
 {
+    ++_lockWaiters;
     _readWriteLock.lock_shared();
+    --_lockWaiters;
 }
 
 // Method Description:
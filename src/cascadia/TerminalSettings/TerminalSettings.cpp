@@ -17,6 +17,8 @@ namespace winrt::Microsoft::Terminal::Settings::implementation
         _initialRows{ 30 },
         _initialCols{ 80 },
         _snapOnInput{ true },
+        _predictiveEcho{ false },
+        _recordingDirectory{},
         _cursorColor{ DEFAULT_CURSOR_COLOR },
         _cursorShape{ CursorStyle::Vintage },
         _cursorHeight{ DEFAULT_CURSOR_HEIGHT },
@@ -27,7 +29,8 @@ namespace winrt::Microsoft::Terminal::Settings::implementation
         _fontFace{ DEFAULT_FONT_FACE },
         _fontSize{ DEFAULT_FONT_SIZE },
         _keyBindings{ nullptr },
-        _scrollbarState{ ScrollbarState::Visible }
+        _scrollbarState{ ScrollbarState::Visible },
+        _maxFrameRate{ 0 }
     {
 
     }
@@ -103,6 +106,26 @@ namespace winrt::Microsoft::Terminal::Settings::implementation
         _snapOnInput = value;
     }
 
+    bool TerminalSettings::PredictiveEcho()
+    {
+        return _predictiveEcho;
+    }
+
+    void TerminalSettings::PredictiveEcho(bool value)
+    {
+        _predictiveEcho = value;
+    }
+
+    hstring TerminalSettings::RecordingDirectory()
+    {
+        return _recordingDirectory;
+    }
+
+    void TerminalSettings::RecordingDirectory(hstring const& value)
+    {
+        _recordingDirectory = value;
+    }
+
     uint32_t TerminalSettings::CursorColor()
     {
         return _cursorColor;
@@ -243,4 +266,14 @@ namespace winrt::Microsoft::Terminal::Settings::implementation
         _scrollbarState = value;
     }
 
+    uint32_t TerminalSettings::MaxFrameRate() const noexcept
+    {
+        return _maxFrameRate;
+    }
+
+    void TerminalSettings::MaxFrameRate(uint32_t value) noexcept
+    {
+        _maxFrameRate = value;
+    }
+
 }
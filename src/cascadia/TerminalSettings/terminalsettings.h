@@ -39,6 +39,10 @@ namespace winrt::Microsoft::Terminal::Settings::implementation
         void InitialCols(int32_t value);
         bool SnapOnInput();
         void SnapOnInput(bool value);
+        bool PredictiveEcho();
+        void PredictiveEcho(bool value);
+        hstring RecordingDirectory();
+        void RecordingDirectory(hstring const& value);
         uint32_t CursorColor();
         void CursorColor(uint32_t value);
         CursorStyle CursorShape() const noexcept;
@@ -76,6 +80,9 @@ namespace winrt::Microsoft::Terminal::Settings::implementation
         ScrollbarState ScrollState() const noexcept;
         void ScrollState(winrt::Microsoft::Terminal::Settings::ScrollbarState const& value) noexcept;
 
+        uint32_t MaxFrameRate() const noexcept;
+        void MaxFrameRate(uint32_t value) noexcept;
+
     private:
         uint32_t _defaultForeground;
         uint32_t _defaultBackground;
@@ -84,6 +91,8 @@ namespace winrt::Microsoft::Terminal::Settings::implementation
         int32_t _initialRows;
         int32_t _initialCols;
         bool _snapOnInput;
+        bool _predictiveEcho;
+        hstring _recordingDirectory;
         uint32_t _cursorColor;
         Settings::CursorStyle _cursorShape;
         uint32_t _cursorHeight;
@@ -99,6 +108,7 @@ namespace winrt::Microsoft::Terminal::Settings::implementation
         hstring _envVars;
         Settings::IKeyBindings _keyBindings;
         Settings::ScrollbarState _scrollbarState;
+        uint32_t _maxFrameRate;
     };
 }
 
@@ -32,6 +32,7 @@ public:
     uint32_t DefaultForeground() { return COLOR_WHITE; }
     uint32_t DefaultBackground() { return COLOR_BLACK; }
     bool SnapOnInput() { return false; }
+    bool PredictiveEcho() { return false; }
     uint32_t CursorColor() { return COLOR_WHITE; }
     CursorStyle CursorShape() const noexcept { return CursorStyle::Vintage; }
     uint32_t CursorHeight() { return 42UL; }
@@ -46,6 +47,7 @@ public:
     void DefaultForeground(uint32_t) { }
     void DefaultBackground(uint32_t) { }
     void SnapOnInput(bool) { }
+    void PredictiveEcho(bool) { }
     void CursorColor(uint32_t) { }
     void CursorShape(CursorStyle const&) noexcept { }
     void CursorHeight(uint32_t) { }
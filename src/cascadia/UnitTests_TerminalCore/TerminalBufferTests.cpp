@@ -0,0 +1,144 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../renderer/inc/DummyRenderTarget.hpp"
+#include "consoletaeftemplates.hpp"
+
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+
+namespace TerminalCoreUnitTests
+{
+    class TerminalBufferTests
+    {
+        TEST_CLASS(TerminalBufferTests);
+
+        TEST_METHOD(WriteRunsWrapAtEndOfRow)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+
+            Log::Comment(L"A run longer than a row should continue on the next one.");
+            term.Write(L"0123456789abc");
+
+            const auto& buffer = term.GetTextBuffer();
+            VERIFY_ARE_EQUAL(L"0123456789", buffer.GetRowByOffset(0).GetText());
+            VERIFY_IS_TRUE(buffer.GetRowByOffset(0).GetCharRow().WasWrapForced());
+            VERIFY_ARE_EQUAL(L"abc       ", buffer.GetRowByOffset(1).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 3, 1 }), buffer.GetCursor().GetPosition());
+
+            Log::Comment(L"Control characters split the text into runs.");
+            term.Write(L"\r\nxy\bz");
+            VERIFY_ARE_EQUAL(L"xz        ", buffer.GetRowByOffset(2).GetText());
+            VERIFY_IS_FALSE(buffer.GetRowByOffset(1).GetCharRow().WasWrapForced());
+            VERIFY_ARE_EQUAL((COORD{ 2, 2 }), buffer.GetCursor().GetPosition());
+        }
+
+        TEST_METHOD(WriteRunThatFillsRowWrapsOnNextRun)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+
+            Log::Comment(L"A run ending exactly at the end of the row leaves the cursor there.");
+            term.Write(L"0123456789");
+            const auto& buffer = term.GetTextBuffer();
+            VERIFY_ARE_EQUAL((COORD{ 10, 0 }), buffer.GetCursor().GetPosition());
+
+            Log::Comment(L"The next run starts on the next row.");
+            term.Write(L"\x1b[mab");
+            VERIFY_ARE_EQUAL(L"ab        ", buffer.GetRowByOffset(1).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 2, 1 }), buffer.GetCursor().GetPosition());
+        }
+
+        TEST_METHOD(LongWriteParsesSequencesAcrossSlices)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 80, 5 }, 300, emptyRT);
+
+            Log::Comment(L"A write bigger than one slice has a sequence straddling the slice boundary.");
+            constexpr size_t sliceSize = 16 * 1024;
+            std::wstring text(sliceSize - 2, L'a');
+            text.append(L"\x1b[1mb");
+            term.Write(text);
+
+            const auto& buffer = term.GetTextBuffer();
+            const auto& row = buffer.GetRowByOffset((sliceSize - 2) / 80);
+            const auto column = (sliceSize - 2) % 80;
+            VERIFY_ARE_EQUAL(L'a', row.GetText().at(column - 1));
+            VERIFY_ARE_EQUAL(L'b', row.GetText().at(column));
+            VERIFY_ARE_EQUAL(L' ', row.GetText().at(column + 1));
+            VERIFY_IS_TRUE(row.GetAttrRow().GetAttrByColumn(column).IsBold());
+            VERIFY_IS_FALSE(row.GetAttrRow().GetAttrByColumn(column - 1).IsBold());
+        }
+
+        TEST_METHOD(Utf8WriteKeepsSequencesSplitAcrossWrites)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+
+            Log::Comment(L"A sequence cut off at the end of one write is finished by the next.");
+            term.Write(std::string_view{ "h\xE2\x82" });
+            term.Write(std::string_view{ "\xAC" "i" });
+
+            Log::Comment(L"A sequence that's broken off comes out as a replacement character.");
+            term.Write(std::string_view{ "\xE2\x82" });
+            term.Write(std::string_view{ "z" });
+
+            Log::Comment(L"A sequence can be split over more than two writes.");
+            term.Write(std::string_view{ "\xF0" });
+            term.Write(std::string_view{ "\x9F\x8C" });
+            term.Write(std::string_view{ "\xAE" });
+
+            const auto& buffer = term.GetTextBuffer();
+            const auto text = buffer.GetRowByOffset(0).GetText();
+            VERIFY_ARE_EQUAL(L'h', text.at(0));
+            VERIFY_ARE_EQUAL(L'\x20AC', text.at(1));
+            VERIFY_ARE_EQUAL(L'i', text.at(2));
+            VERIFY_ARE_EQUAL(L'\xFFFD', text.at(3));
+            VERIFY_ARE_EQUAL(L'z', text.at(4));
+            VERIFY_ARE_EQUAL(std::wstring_view(L"\xD83C\xDF2E"), std::wstring_view(buffer.GetRowByOffset(0).GetCharRow().GlyphAt(5)));
+        }
+
+        TEST_METHOD(AltBufferIsReusedAcrossSwitches)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 10, emptyRT);
+
+            term.Write(L"main");
+            const auto* const mainBuffer = &term.GetTextBuffer();
+
+            Log::Comment(L"Entering the alt buffer keeps the cursor where it is on screen.");
+            term.Write(L"\x1b[?1049h");
+            const auto* const altBuffer = &term.GetTextBuffer();
+            VERIFY_ARE_NOT_EQUAL(mainBuffer, altBuffer);
+            VERIFY_ARE_EQUAL(SHORT{ 5 }, altBuffer->GetSize().Height());
+            VERIFY_ARE_EQUAL((COORD{ 4, 0 }), altBuffer->GetCursor().GetPosition());
+
+            term.Write(L"\ralt");
+            VERIFY_ARE_EQUAL(L"altn      ", altBuffer->GetRowByOffset(0).GetText());
+
+            Log::Comment(L"Leaving it brings back the main buffer as it was.");
+            term.Write(L"\x1b[?1049l");
+            VERIFY_ARE_EQUAL(mainBuffer, &term.GetTextBuffer());
+            VERIFY_ARE_EQUAL(L"main      ", mainBuffer->GetRowByOffset(0).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 4, 0 }), mainBuffer->GetCursor().GetPosition());
+
+            Log::Comment(L"Entering it again reuses the same alt buffer, cleared.");
+            term.Write(L"\x1b[?1049h");
+            VERIFY_ARE_EQUAL(altBuffer, &term.GetTextBuffer());
+            VERIFY_ARE_EQUAL(L"          ", altBuffer->GetRowByOffset(0).GetText());
+        }
+    };
+}
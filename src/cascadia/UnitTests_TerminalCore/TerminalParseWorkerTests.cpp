@@ -0,0 +1,96 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../cascadia/TerminalCore/TerminalParseWorker.hpp"
+#include "../renderer/inc/DummyRenderTarget.hpp"
+#include "consoletaeftemplates.hpp"
+
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+
+namespace TerminalCoreUnitTests
+{
+    class TerminalParseWorkerTests
+    {
+        TEST_CLASS(TerminalParseWorkerTests);
+
+        TEST_METHOD(ChunksAreParsedInOrder)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 100, 5 }, 0, emptyRT);
+            TerminalParseWorker worker{ term };
+
+            Log::Comment(L"Queue up more chunks than fit in the ring at once.");
+            std::wstring expected;
+            for (size_t i = 0; i < 100; ++i)
+            {
+                const std::wstring chunk(1, static_cast<wchar_t>(L'a' + (i % 26)));
+                expected += chunk;
+                VERIFY_IS_TRUE(worker.Enqueue(chunk));
+            }
+            worker.Flush();
+
+            {
+                auto lock = term.LockForReading();
+                VERIFY_ARE_EQUAL(expected, term.GetTextBuffer().GetRowByOffset(0).GetText());
+            }
+
+            Log::Comment(L"Once it's shut down, nothing else is parsed.");
+            worker.Shutdown();
+            VERIFY_IS_FALSE(worker.Enqueue(L"zzz"));
+        }
+
+        TEST_METHOD(Utf8ChunksAreCopiedAndDecoded)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 100, 5 }, 0, emptyRT);
+            TerminalParseWorker worker{ term };
+
+            Log::Comment(L"The worker copies the bytes, so the caller's buffer can be reused right away.");
+            std::string buffer{ "a\xE6\xBC" };
+            VERIFY_IS_TRUE(worker.Enqueue(std::string_view{ buffer }));
+            buffer = "\xA2z";
+            VERIFY_IS_TRUE(worker.Enqueue(std::string_view{ buffer }));
+            worker.Flush();
+
+            auto lock = term.LockForReading();
+            VERIFY_ARE_EQUAL(std::wstring{ L"a\x6F22z" }, term.GetTextBuffer().GetRowByOffset(0).GetText().substr(0, 4));
+        }
+
+        TEST_METHOD(QueueDepthAndLockWaitAreCounted)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 100, 5 }, 0, emptyRT);
+            TerminalParseWorker worker{ term };
+
+            Log::Comment(L"While we hold the lock, nothing can be parsed, so everything stays queued.");
+            {
+                auto lock = term.LockForWriting();
+                for (size_t i = 0; i < 5; ++i)
+                {
+                    VERIFY_IS_TRUE(worker.Enqueue(L"x"));
+                }
+                VERIFY_ARE_EQUAL(5u, worker.GetQueueDepth());
+                Sleep(50);
+            }
+            worker.Flush();
+
+            VERIFY_ARE_EQUAL(0u, worker.GetQueueDepth());
+            VERIFY_ARE_EQUAL(5u, worker.TakePeakQueueDepth());
+            VERIFY_ARE_EQUAL(0u, worker.TakePeakQueueDepth());
+
+            Log::Comment(L"The worker had to wait for us to let go of the lock.");
+            VERIFY_IS_GREATER_THAN(term.GetWriteLockWaitTime().count(), 0);
+        }
+    };
+}
@@ -0,0 +1,113 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/TerminalPredictiveEcho.hpp"
+#include "../renderer/inc/DummyRenderTarget.hpp"
+#include "consoletaeftemplates.hpp"
+
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+
+namespace TerminalCoreUnitTests
+{
+    class TerminalPredictiveEchoTests
+    {
+        TEST_CLASS(TerminalPredictiveEchoTests);
+
+        // Writes what the connection would have echoed, and moves the cursor past it.
+        static void s_Echo(TextBuffer& buffer, const std::wstring_view text)
+        {
+            auto& cursor = buffer.GetCursor();
+            const auto position = cursor.GetPosition();
+            buffer.Write(OutputCellIterator(text), position);
+            cursor.SetPosition({ gsl::narrow<SHORT>(position.X + text.size()), position.Y });
+        }
+
+        TEST_METHOD(ConfirmedPredictionsAreDropped)
+        {
+            DummyRenderTarget emptyRT;
+            TextBuffer buffer{ { 10, 3 }, TextAttribute{}, 12, emptyRT };
+            TerminalPredictiveEcho echo;
+
+            VERIFY_IS_TRUE(echo.Predict(buffer, L'a'));
+            VERIFY_IS_TRUE(echo.Predict(buffer, L'b'));
+
+            Log::Comment(L"The cursor is drawn after the predictions, and the overlay covers them.");
+            VERIFY_ARE_EQUAL((COORD{ 2, 0 }), echo.GetCursorPosition(buffer.GetCursor().GetPosition()));
+            auto overlay = echo.GetOverlay(buffer.GetSize());
+            VERIFY_IS_TRUE(overlay.has_value());
+            VERIFY_ARE_EQUAL(SHORT{ 0 }, overlay->region.Left());
+            VERIFY_ARE_EQUAL(SHORT{ 1 }, overlay->region.RightInclusive());
+            VERIFY_IS_TRUE(overlay->buffer.GetCellDataAt({ 1, 0 })->Chars() == L"b");
+
+            Log::Comment(L"Once the first is echoed, only the second is left.");
+            s_Echo(buffer, L"a");
+            echo.Reconcile(buffer);
+            overlay = echo.GetOverlay(buffer.GetSize());
+            VERIFY_IS_TRUE(overlay.has_value());
+            VERIFY_ARE_EQUAL(SHORT{ 1 }, overlay->region.Left());
+            VERIFY_ARE_EQUAL((COORD{ 2, 0 }), echo.GetCursorPosition(buffer.GetCursor().GetPosition()));
+
+            s_Echo(buffer, L"b");
+            echo.Reconcile(buffer);
+            VERIFY_IS_FALSE(echo.HasPredictions());
+            VERIFY_ARE_EQUAL((COORD{ 2, 0 }), echo.GetCursorPosition(buffer.GetCursor().GetPosition()));
+        }
+
+        TEST_METHOD(MispredictionRollsBackUntilReset)
+        {
+            DummyRenderTarget emptyRT;
+            TextBuffer buffer{ { 10, 3 }, TextAttribute{}, 12, emptyRT };
+            TerminalPredictiveEcho echo;
+
+            VERIFY_IS_TRUE(echo.Predict(buffer, L'a'));
+            VERIFY_IS_TRUE(echo.Predict(buffer, L'b'));
+
+            Log::Comment(L"Something else was echoed, so every prediction goes.");
+            s_Echo(buffer, L"*");
+            echo.Reconcile(buffer);
+            VERIFY_IS_FALSE(echo.HasPredictions());
+            VERIFY_IS_FALSE(echo.GetOverlay(buffer.GetSize()).has_value());
+
+            Log::Comment(L"Nothing's predicted again until we're reset.");
+            VERIFY_IS_FALSE(echo.Predict(buffer, L'c'));
+            echo.Reset(buffer);
+            VERIFY_IS_TRUE(echo.Predict(buffer, L'c'));
+        }
+
+        TEST_METHOD(UnconfirmedPredictionsExpire)
+        {
+            DummyRenderTarget emptyRT;
+            TextBuffer buffer{ { 10, 3 }, TextAttribute{}, 12, emptyRT };
+            TerminalPredictiveEcho echo;
+
+            VERIFY_IS_TRUE(echo.Predict(buffer, L'a'));
+            const auto now = std::chrono::steady_clock::now();
+            VERIFY_IS_TRUE(echo.Expire(buffer, now));
+            VERIFY_IS_FALSE(echo.Expire(buffer, now + TerminalPredictiveEcho::s_ConfirmTimeout));
+            VERIFY_IS_FALSE(echo.Predict(buffer, L'b'));
+        }
+
+        TEST_METHOD(OnlyPrintableTextOnOneRowIsPredicted)
+        {
+            DummyRenderTarget emptyRT;
+            TextBuffer buffer{ { 4, 3 }, TextAttribute{}, 12, emptyRT };
+            TerminalPredictiveEcho echo;
+
+            VERIFY_IS_FALSE(echo.Predict(buffer, L'\r'));
+            VERIFY_IS_FALSE(echo.Predict(buffer, L'\x00e9'));
+
+            Log::Comment(L"The last column is left alone, and nothing's wrapped onto the next row.");
+            VERIFY_IS_TRUE(echo.Predict(buffer, L'a'));
+            VERIFY_IS_TRUE(echo.Predict(buffer, L'b'));
+            VERIFY_IS_TRUE(echo.Predict(buffer, L'c'));
+            VERIFY_IS_FALSE(echo.Predict(buffer, L'd'));
+        }
+    };
+}
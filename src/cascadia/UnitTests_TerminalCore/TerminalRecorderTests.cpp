@@ -0,0 +1,201 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../cascadia/TerminalCore/TerminalRecorder.hpp"
+#include "../renderer/inc/DummyRenderTarget.hpp"
+#include "consoletaeftemplates.hpp"
+
+#include <fstream>
+
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+
+namespace TerminalCoreUnitTests
+{
+    class TerminalRecorderTests
+    {
+        TEST_CLASS(TerminalRecorderTests);
+
+        TEST_METHOD_SETUP(MethodSetup)
+        {
+            _path = (std::filesystem::temp_directory_path() / L"TerminalRecorderTests.termrec").wstring();
+            return true;
+        }
+
+        TEST_METHOD_CLEANUP(MethodCleanup)
+        {
+            std::error_code error;
+            std::filesystem::remove(_path, error);
+            return true;
+        }
+
+        TEST_METHOD(RecordsAreWrittenInOrder)
+        {
+            {
+                TerminalRecorder recorder{ _path };
+                recorder.RecordResize({ 80, 25 });
+                recorder.RecordOutput(std::wstring_view{ L"abc" });
+                recorder.RecordOutput(std::string_view{ "\xE6\xBC\xA2" });
+                recorder.RecordInput(L"x");
+                recorder.Flush();
+
+                Log::Comment(L"Once it's flushed, everything recorded so far is in the file.");
+                VERIFY_ARE_EQUAL(4u, _Read().size());
+            }
+
+            const auto records = _Read();
+            VERIFY_ARE_EQUAL(4u, records.size());
+
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::Resize, records[0].type);
+            TerminalRecording::ResizePayload size;
+            VERIFY_ARE_EQUAL(sizeof(size), records[0].payload.size());
+            memcpy(&size, records[0].payload.data(), sizeof(size));
+            VERIFY_ARE_EQUAL(80, size.columns);
+            VERIFY_ARE_EQUAL(25, size.rows);
+
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::Output, records[1].type);
+            VERIFY_ARE_EQUAL(std::wstring{ L"abc" }, _AsText(records[1]));
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::OutputUtf8, records[2].type);
+            VERIFY_ARE_EQUAL(std::string{ "\xE6\xBC\xA2" }, records[2].payload);
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::Input, records[3].type);
+            VERIFY_ARE_EQUAL(std::wstring{ L"x" }, _AsText(records[3]));
+
+            for (size_t i = 1; i < records.size(); ++i)
+            {
+                VERIFY_IS_GREATER_THAN_OR_EQUAL(records[i].microseconds, records[i - 1].microseconds);
+            }
+        }
+
+        TEST_METHOD(OutputWrapsAroundTheRing)
+        {
+            Log::Comment(L"Write a few rings' worth of output, in chunks that don't fit the ring evenly.");
+            std::string expected;
+            {
+                TerminalRecorder recorder{ _path };
+                const size_t chunkSize = 100 * 1000 + 7;
+                const size_t chunksPerFlush = TerminalRecorder::s_OutputRingSize / chunkSize / 2;
+                for (size_t i = 0; i < 3 * 2 * chunksPerFlush; ++i)
+                {
+                    const std::string chunk(chunkSize, static_cast<char>('a' + (i % 26)));
+                    expected += chunk;
+                    recorder.RecordOutput(std::string_view{ chunk });
+                    if ((i + 1) % chunksPerFlush == 0)
+                    {
+                        recorder.Flush();
+                    }
+                }
+                VERIFY_ARE_EQUAL(0u, recorder.GetDroppedCount());
+            }
+
+            std::string actual;
+            for (const auto& record : _Read())
+            {
+                VERIFY_ARE_EQUAL(TerminalRecording::RecordType::OutputUtf8, record.type);
+                actual += record.payload;
+            }
+            VERIFY_ARE_EQUAL(expected.size(), actual.size());
+            VERIFY_IS_TRUE(expected == actual);
+        }
+
+        TEST_METHOD(ChunksTooBigForTheRingAreDropped)
+        {
+            {
+                TerminalRecorder recorder{ _path };
+                const std::string chunk(TerminalRecorder::s_OutputRingSize, 'x');
+                recorder.RecordOutput(std::string_view{ chunk });
+                VERIFY_ARE_EQUAL(1u, recorder.GetDroppedCount());
+            }
+
+            Log::Comment(L"The recording says that something's missing.");
+            const auto records = _Read();
+            VERIFY_ARE_EQUAL(1u, records.size());
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::Dropped, records[0].type);
+            uint64_t count;
+            VERIFY_ARE_EQUAL(sizeof(count), records[0].payload.size());
+            memcpy(&count, records[0].payload.data(), sizeof(count));
+            VERIFY_ARE_EQUAL(1u, count);
+        }
+
+        TEST_METHOD(TerminalRecordsItsSession)
+        {
+            {
+                Terminal term;
+                DummyRenderTarget emptyRT;
+                term.Create({ 100, 5 }, 0, emptyRT);
+                term.SetWriteInputCallback([](std::wstring&) {});
+                term.StartRecording(_path);
+
+                term.Write(std::wstring_view{ L"hello" });
+                term.Write(std::string_view{ "\xE6\xBC" });
+                term.Write(std::string_view{ "\xA2" });
+                VERIFY_SUCCEEDED(term.UserResize({ 50, 10 }));
+                term.SendPaste(L"pasted");
+            }
+
+            Log::Comment(L"UTF-8 is recorded as the bytes it came in, even split up.");
+            const auto records = _Read();
+            VERIFY_ARE_EQUAL(6u, records.size());
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::Resize, records[0].type);
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::Output, records[1].type);
+            VERIFY_ARE_EQUAL(std::wstring{ L"hello" }, _AsText(records[1]));
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::OutputUtf8, records[2].type);
+            VERIFY_ARE_EQUAL(2u, records[2].payload.size());
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::OutputUtf8, records[3].type);
+            VERIFY_ARE_EQUAL(1u, records[3].payload.size());
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::Resize, records[4].type);
+
+            Log::Comment(L"What the terminal sends to the connection is recorded too.");
+            VERIFY_ARE_EQUAL(TerminalRecording::RecordType::Input, records[5].type);
+            VERIFY_ARE_EQUAL(std::wstring{ L"pasted" }, _AsText(records[5]));
+        }
+
+    private:
+        struct Record
+        {
+            TerminalRecording::RecordType type;
+            int64_t microseconds;
+            std::string payload;
+        };
+
+        std::wstring _path;
+
+        std::vector<Record> _Read() const
+        {
+            std::ifstream file{ _path, std::ios::binary };
+            const std::string contents{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+
+            TerminalRecording::FileHeader fileHeader;
+            VERIFY_IS_GREATER_THAN_OR_EQUAL(contents.size(), sizeof(fileHeader));
+            memcpy(&fileHeader, contents.data(), sizeof(fileHeader));
+            VERIFY_ARE_EQUAL(TerminalRecording::s_Signature, fileHeader.signature);
+            VERIFY_ARE_EQUAL(TerminalRecording::s_FormatVersion, fileHeader.formatVersion);
+
+            std::vector<Record> records;
+            size_t offset = sizeof(fileHeader);
+            while (offset < contents.size())
+            {
+                TerminalRecording::RecordHeader header;
+                VERIFY_IS_GREATER_THAN_OR_EQUAL(contents.size() - offset, sizeof(header));
+                memcpy(&header, contents.data() + offset, sizeof(header));
+                offset += sizeof(header);
+
+                VERIFY_IS_GREATER_THAN_OR_EQUAL(contents.size() - offset, TerminalRecording::s_PaddedSize(header.size));
+                records.push_back({ header.type, header.microseconds, contents.substr(offset, header.size) });
+                offset += TerminalRecording::s_PaddedSize(header.size);
+            }
+            return records;
+        }
+
+        static std::wstring _AsText(const Record& record)
+        {
+            return { reinterpret_cast<const wchar_t*>(record.payload.data()), record.payload.size() / sizeof(wchar_t) };
+        }
+    };
+}
@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../cascadia/TerminalCore/TerminalRenderFrame.hpp"
+#include "../renderer/inc/DummyRenderTarget.hpp"
+#include "consoletaeftemplates.hpp"
+
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+
+namespace TerminalCoreUnitTests
+{
+    class TerminalRenderFrameTests
+    {
+        TEST_CLASS(TerminalRenderFrameTests);
+
+        TEST_METHOD(FrameOnlyChangesWhenLocked)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+            TerminalRenderFrame frame{ term };
+
+            term.Write(L"first");
+            frame.LockConsole();
+            frame.UnlockConsole();
+            VERIFY_ARE_EQUAL(L"first     ", frame.GetTextBuffer().GetRowByOffset(0).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 5, 0 }), frame.GetCursorPosition());
+
+            Log::Comment(L"Writing to the terminal leaves the frame as it was.");
+            term.Write(L"\r\nsecond");
+            VERIFY_ARE_EQUAL(L"          ", frame.GetTextBuffer().GetRowByOffset(1).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 5, 0 }), frame.GetCursorPosition());
+
+            Log::Comment(L"Until the next frame is taken.");
+            frame.LockConsole();
+            frame.UnlockConsole();
+            VERIFY_ARE_EQUAL(L"first     ", frame.GetTextBuffer().GetRowByOffset(0).GetText());
+            VERIFY_ARE_EQUAL(L"second    ", frame.GetTextBuffer().GetRowByOffset(1).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 6, 1 }), frame.GetCursorPosition());
+            VERIFY_ARE_EQUAL(term.GetViewport().ToInclusive(), frame.GetViewport().ToInclusive());
+        }
+
+        TEST_METHOD(FrameFollowsTerminalThroughResize)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+            TerminalRenderFrame frame{ term };
+
+            term.Write(L"abc");
+            frame.LockConsole();
+            frame.UnlockConsole();
+
+            VERIFY_SUCCEEDED(term.UserResize({ 12, 5 }));
+            frame.LockConsole();
+            frame.UnlockConsole();
+            VERIFY_ARE_EQUAL(SHORT{ 12 }, frame.GetTextBuffer().GetSize().Width());
+            VERIFY_ARE_EQUAL(L"abc         ", frame.GetTextBuffer().GetRowByOffset(0).GetText());
+        }
+    };
+}
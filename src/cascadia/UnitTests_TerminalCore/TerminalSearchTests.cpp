@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../renderer/inc/DummyRenderTarget.hpp"
+#include "consoletaeftemplates.hpp"
+
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+
+namespace TerminalCoreUnitTests
+{
+    class TerminalSearchTests
+    {
+        TEST_CLASS(TerminalSearchTests);
+
+        TEST_METHOD(SearchFindsEveryMatch)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 20, 5 }, 10, emptyRT);
+
+            term.Write(L"Hello world\r\nhello HELLO\r\nnothing");
+
+            Log::Comment(L"A case insensitive search finds all of them.");
+            VERIFY_ARE_EQUAL(3u, term.Search(L"hello", TerminalSearchIndex::Sensitivity::CaseInsensitive));
+
+            Log::Comment(L"A case sensitive one only finds the one that matches exactly.");
+            VERIFY_ARE_EQUAL(1u, term.Search(L"Hello", TerminalSearchIndex::Sensitivity::CaseSensitive));
+
+            Log::Comment(L"Queries shorter than a trigram still work.");
+            VERIFY_ARE_EQUAL(1u, term.Search(L"wo", TerminalSearchIndex::Sensitivity::CaseSensitive));
+
+            Log::Comment(L"The matches are highlighted with the selection.");
+            term.Search(L"hello", TerminalSearchIndex::Sensitivity::CaseInsensitive);
+            const auto rects = term.GetSelectionRects();
+            VERIFY_ARE_EQUAL(3u, rects.size());
+            VERIFY_ARE_EQUAL(SHORT{ 6 }, rects.at(2).Left());
+            VERIFY_ARE_EQUAL(SHORT{ 10 }, rects.at(2).RightInclusive());
+            VERIFY_ARE_EQUAL(SHORT{ 1 }, rects.at(2).Top());
+
+            term.ClearSearch();
+            VERIFY_ARE_EQUAL(0u, term.GetSelectionRects().size());
+        }
+
+        TEST_METHOD(SearchFollowsRowsAsBufferCircles)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 3 }, 0, emptyRT);
+
+            term.Write(L"abc\r\nfoo\r\nbar");
+            VERIFY_ARE_EQUAL(1u, term.Search(L"foo", TerminalSearchIndex::Sensitivity::CaseSensitive));
+            VERIFY_ARE_EQUAL(SHORT{ 1 }, term.GetSelectionRects().at(0).Top());
+
+            Log::Comment(L"The highlight moves up with its row when the buffer circles.");
+            term.Write(L"\r\nbaz");
+            VERIFY_ARE_EQUAL(SHORT{ 0 }, term.GetSelectionRects().at(0).Top());
+
+            Log::Comment(L"Rows written since the last search are indexed by the next one.");
+            VERIFY_ARE_EQUAL(1u, term.Search(L"baz", TerminalSearchIndex::Sensitivity::CaseSensitive));
+            VERIFY_ARE_EQUAL(0u, term.Search(L"abc", TerminalSearchIndex::Sensitivity::CaseSensitive));
+
+            Log::Comment(L"A highlight goes away when its row is written over.");
+            term.Search(L"foo", TerminalSearchIndex::Sensitivity::CaseSensitive);
+            term.Write(L"\x1b[1;1Hxyz");
+            VERIFY_ARE_EQUAL(0u, term.GetSelectionRects().size());
+            VERIFY_ARE_EQUAL(0u, term.Search(L"foo", TerminalSearchIndex::Sensitivity::CaseSensitive));
+        }
+
+        TEST_METHOD(SearchFindsSpilledRows)
+        {
+            DummyRenderTarget emptyRT;
+            TextBuffer buffer{ { 10, 2 }, TextAttribute{}, 12, emptyRT };
+            buffer.SetScrollbackSpill(ScrollbackSpill::CreateInTempDirectory());
+
+            Log::Comment(L"Circle a couple of rows out of the buffer and into its spill.");
+            buffer.WriteLine(OutputCellIterator{ L"foo one", TextAttribute{} }, { 0, 0 });
+            VERIFY_IS_TRUE(buffer.IncrementCircularBuffer());
+            buffer.WriteLine(OutputCellIterator{ L"two", TextAttribute{} }, { 0, 0 });
+            VERIFY_IS_TRUE(buffer.IncrementCircularBuffer());
+            buffer.WriteLine(OutputCellIterator{ L"xx FOO", TextAttribute{} }, { 0, 0 });
+            VERIFY_ARE_EQUAL(2u, buffer.GetSpilledRowCount());
+
+            TerminalSearchIndex index;
+            const auto matches = index.FindAll(buffer, L"foo", TerminalSearchIndex::Sensitivity::CaseInsensitive);
+            VERIFY_ARE_EQUAL(2u, matches.size());
+
+            Log::Comment(L"The spilled match comes first, and is found by its place in the spill.");
+            VERIFY_IS_TRUE(matches.at(0).spilled);
+            VERIFY_ARE_EQUAL(uint64_t{ 0 }, matches.at(0).row);
+            VERIFY_ARE_EQUAL(SHORT{ 0 }, matches.at(0).startColumn);
+            VERIFY_ARE_EQUAL(SHORT{ 2 }, matches.at(0).endColumn);
+
+            VERIFY_IS_FALSE(matches.at(1).spilled);
+            VERIFY_ARE_EQUAL(SHORT{ 3 }, matches.at(1).startColumn);
+        }
+    };
+}
@@ -0,0 +1,168 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../cascadia/TerminalCore/TerminalView.hpp"
+#include "../cascadia/TerminalCore/TerminalRenderFrame.hpp"
+#include "../renderer/inc/DummyRenderTarget.hpp"
+#include "consoletaeftemplates.hpp"
+
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Types;
+
+namespace TerminalCoreUnitTests
+{
+    // Counts the notifications it's sent, so that the tests can tell which
+    //      view's renderer heard about what.
+    class CountingRenderTarget final : public IRenderTarget
+    {
+    public:
+        size_t redraws = 0;
+        size_t scrolls = 0;
+        size_t selections = 0;
+
+        void TriggerRedraw(const Viewport& /*region*/) override { ++redraws; }
+        void TriggerRedraw(const COORD* const /*pcoord*/) override { ++redraws; }
+        void TriggerRedrawCursor(const COORD* const /*pcoord*/) override {}
+        void TriggerRedrawAll() override { ++redraws; }
+        void TriggerTeardown() override {}
+        void TriggerSelection() override { ++selections; }
+        void TriggerScroll() override { ++scrolls; }
+        void TriggerScroll(const COORD* const /*pcoordDelta*/) override { ++scrolls; }
+        void TriggerScroll(const Viewport& /*region*/, const COORD* const /*pcoordDelta*/) override { ++scrolls; }
+        void TriggerCircling() override {}
+        void TriggerTitleChange() override {}
+        void BeginBatch() override {}
+        void EndBatch() override {}
+    };
+
+    class TerminalViewTests
+    {
+        TEST_CLASS(TerminalViewTests);
+
+        TEST_METHOD(ViewsScrollIndependently)
+        {
+            Terminal term;
+            CountingRenderTarget primaryRT;
+            term.Create({ 10, 5 }, 20, primaryRT);
+            for (auto i = 0; i < 15; ++i)
+            {
+                term.Write(L"line\r\n");
+            }
+
+            CountingRenderTarget secondaryRT;
+            TerminalView view{ term };
+            view.Attach(secondaryRT);
+            VERIFY_ARE_EQUAL(term.GetViewport().ToInclusive(), view.GetViewport().ToInclusive());
+
+            Log::Comment(L"Scrolling the primary view leaves the other one at the bottom.");
+            const auto bottomTop = term.GetViewport().Top();
+            const auto primaryScrolls = primaryRT.scrolls;
+            term.UserScrollViewport(0);
+            VERIFY_ARE_EQUAL(SHORT{ 0 }, term.GetViewport().Top());
+            VERIFY_ARE_EQUAL(bottomTop, view.GetViewport().Top());
+            VERIFY_ARE_EQUAL(primaryScrolls + 1, primaryRT.scrolls);
+            VERIFY_ARE_EQUAL(0u, secondaryRT.scrolls);
+
+            Log::Comment(L"And scrolling the other one back leaves the primary where it was.");
+            view.UserScrollViewport(2);
+            VERIFY_ARE_EQUAL(SHORT{ 2 }, view.GetViewport().Top());
+            VERIFY_ARE_EQUAL(SHORT{ 0 }, term.GetViewport().Top());
+
+            Log::Comment(L"Each frame paints its own view.");
+            TerminalRenderFrame primaryFrame{ term };
+            TerminalRenderFrame secondaryFrame{ term, view };
+            primaryFrame.LockConsole();
+            primaryFrame.UnlockConsole();
+            secondaryFrame.LockConsole();
+            secondaryFrame.UnlockConsole();
+            VERIFY_ARE_EQUAL(SHORT{ 0 }, primaryFrame.GetViewport().Top());
+            VERIFY_ARE_EQUAL(SHORT{ 2 }, secondaryFrame.GetViewport().Top());
+        }
+
+        TEST_METHOD(SelectionIsPerView)
+        {
+            Terminal term;
+            CountingRenderTarget primaryRT;
+            term.Create({ 10, 5 }, 0, primaryRT);
+            term.Write(L"abcdef");
+
+            CountingRenderTarget secondaryRT;
+            TerminalView view{ term };
+            view.Attach(secondaryRT);
+
+            view.SetSelectionAnchor({ 1, 0 });
+            view.SetEndSelectionPosition({ 3, 0 });
+            VERIFY_IS_TRUE(view.IsSelectionActive());
+            VERIFY_IS_FALSE(term.IsSelectionActive());
+            VERIFY_ARE_EQUAL(1u, view.GetSelectionRects().size());
+            VERIFY_ARE_EQUAL(0u, term.GetSelectionRects().size());
+            VERIFY_ARE_EQUAL(std::wstring{ L"bcd" }, view.RetrieveSelectedTextFromBuffer(true));
+
+            Log::Comment(L"Clearing a view's selection only repaints that view.");
+            const auto primarySelections = primaryRT.selections;
+            view.ClearSelection();
+            VERIFY_IS_FALSE(view.IsSelectionActive());
+            VERIFY_ARE_EQUAL(primarySelections, primaryRT.selections);
+            VERIFY_ARE_EQUAL(1u, secondaryRT.selections);
+        }
+
+        TEST_METHOD(OutputReachesEveryAttachedView)
+        {
+            Terminal term;
+            CountingRenderTarget primaryRT;
+            term.Create({ 10, 5 }, 0, primaryRT);
+
+            CountingRenderTarget secondaryRT;
+            TerminalView view{ term };
+            view.Attach(secondaryRT);
+
+            const auto primaryRedraws = primaryRT.redraws;
+            term.Write(L"hello");
+            VERIFY_IS_GREATER_THAN(primaryRT.redraws, primaryRedraws);
+            VERIFY_ARE_EQUAL(primaryRT.redraws - primaryRedraws, secondaryRT.redraws);
+
+            Log::Comment(L"Once it's detached, a view doesn't hear about output anymore.");
+            view.Detach();
+            const auto secondaryRedraws = secondaryRT.redraws;
+            const auto redrawsBefore = primaryRT.redraws;
+            term.Write(L" world");
+            VERIFY_IS_GREATER_THAN(primaryRT.redraws, redrawsBefore);
+            VERIFY_ARE_EQUAL(secondaryRedraws, secondaryRT.redraws);
+        }
+
+        TEST_METHOD(ViewHeightKeepsTheBottomInPlace)
+        {
+            Terminal term;
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 20, emptyRT);
+            for (auto i = 0; i < 15; ++i)
+            {
+                term.Write(L"line\r\n");
+            }
+
+            DummyRenderTarget secondaryRT;
+            TerminalView view{ term };
+            view.Attach(secondaryRT);
+
+            view.SetViewHeight(3);
+            VERIFY_ARE_EQUAL(SHORT{ 3 }, view.GetViewport().Height());
+            VERIFY_ARE_EQUAL(term.GetViewport().BottomInclusive(), view.GetViewport().BottomInclusive());
+
+            Log::Comment(L"A view can be taller than the viewport, but not than the buffer.");
+            view.SetViewHeight(100);
+            VERIFY_ARE_EQUAL(SHORT{ 25 }, view.GetViewport().Height());
+            VERIFY_ARE_EQUAL(SHORT{ 0 }, view.GetViewport().Top());
+
+            view.SetViewHeight(0);
+            VERIFY_ARE_EQUAL(term.GetViewport().ToInclusive(), view.GetViewport().ToInclusive());
+        }
+    };
+}
@@ -153,6 +153,14 @@ LRESULT IslandWindow::MessageHandler(UINT const message, WPARAM const wparam, LP
         _HandleCreateWindow(wparam, lparam);
         return 0;
     }
+    case WM_ACTIVATE:
+    {
+        // The high word is set if we're minimized, which only happens to a window
+        //      once it's been deactivated anyways.
+        const bool active = LOWORD(wparam) != WA_INACTIVE && HIWORD(wparam) == 0;
+        winrt::Microsoft::Terminal::TerminalControl::TermControl::SetWindowActive(active);
+        break;
+    }
     case WM_SETFOCUS:
     {
         if (_interopWindowHandle != nullptr)
@@ -183,6 +191,9 @@ void IslandWindow::OnResize(const UINT width, const UINT height)
 void IslandWindow::OnMinimize()
 {
     // TODO MSFT#21315817 Stop rendering island content when the app is minimized.
+    // Until then, at least stop blinking the cursor. It starts again when we're
+    //      activated after being restored.
+    winrt::Microsoft::Terminal::TerminalControl::TermControl::SetWindowActive(false);
 }
 
 // Method Description:
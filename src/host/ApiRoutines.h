@@ -61,8 +61,8 @@ public:
 
     [[nodiscard]]
     HRESULT PeekConsoleInputWImpl(IConsoleInputObject& context,
-                                  std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                  const size_t eventsToRead,
+                                  gsl::span<INPUT_RECORD> outRecords,
+                                  size_t& eventsRead,
                                   INPUT_READ_HANDLE_DATA& readHandleState,
                                   std::unique_ptr<IWaitRoutine>& waiter) noexcept override;
 
@@ -75,8 +75,8 @@ public:
 
     [[nodiscard]]
     HRESULT ReadConsoleInputWImpl(IConsoleInputObject& context,
-                                  std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                  const size_t eventsToRead,
+                                  gsl::span<INPUT_RECORD> outRecords,
+                                  size_t& eventsRead,
                                   INPUT_READ_HANDLE_DATA& readHandleState,
                                   std::unique_ptr<IWaitRoutine>& waiter) noexcept override;
 
@@ -438,5 +438,10 @@ public:
                                         const bool isForMaximumWindowSize,
                                         const CONSOLE_FONT_INFOEX& consoleFontInfoEx) noexcept override;
 
+    [[nodiscard]]
+    HRESULT GetConsoleMemoryUsageImpl(const ULONG subsystem,
+                                      ULONG64& bytes,
+                                      ULONG64& allocations) noexcept override;
+
 #pragma endregion
 };
@@ -0,0 +1,184 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "ApiStatistics.hpp"
+
+// The ApiStatistics keyword of the console host's provider, see TraceKeywords in tracing.cpp.
+static constexpr ULONGLONG s_apiStatisticsKeyword = 0x1000;
+
+ApiStatistics::Api ApiStatistics::s_apis[ApiStatistics::s_SlotCount]{};
+
+// The call being measured on this thread, if any. The console lock credits
+// the time it waits to it.
+static thread_local ApiStatistics::Call* t_currentCall = nullptr;
+
+// Routine Description:
+// - Starts measuring an API call, if a trace session wants the statistics.
+//   Otherwise this does nothing, and neither does anything else until the call is over.
+// Arguments:
+// - apiNumber - The number of the API, as the client sent it.
+// - traceName - The name of the API, for the rundown.
+ApiStatistics::Call::Call(const ULONG apiNumber, const PCSTR traceName) noexcept :
+    _slot{ s_SlotCount },
+    _traceName{ traceName },
+    _start{},
+    _lockWait{}
+{
+    if (!s_IsEnabled() || t_currentCall != nullptr)
+    {
+        return;
+    }
+
+    const size_t layer = (apiNumber >> 24) - 1;
+    const size_t api = apiNumber & 0xffffff;
+    if (layer >= s_LayerCount || api >= s_ApisPerLayer)
+    {
+        return;
+    }
+
+    _slot = layer * s_ApisPerLayer + api;
+    _start = std::chrono::steady_clock::now();
+    t_currentCall = this;
+}
+
+// Routine Description:
+// - Finishes measuring the call and adds it to the statistics of its API.
+ApiStatistics::Call::~Call()
+{
+    if (t_currentCall != this)
+    {
+        return;
+    }
+
+    t_currentCall = nullptr;
+    s_Record(*this);
+}
+
+// Routine Description:
+// - Checks whether a call is being measured on this thread, so the console
+//   lock knows whether it has to time how long it waits.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if the time spent waiting should be handed to s_AddLockWait.
+bool ApiStatistics::s_IsMeasuringThisThread() noexcept
+{
+    return t_currentCall != nullptr;
+}
+
+// Routine Description:
+// - Credits time spent waiting for the console lock to the call that's being
+//   measured on this thread.
+// Arguments:
+// - wait - How long the lock took to get.
+// Return Value:
+// - <none>
+void ApiStatistics::s_AddLockWait(const std::chrono::steady_clock::duration wait) noexcept
+{
+    if (t_currentCall != nullptr)
+    {
+        t_currentCall->_lockWait += wait;
+    }
+}
+
+// Routine Description:
+// - Writes what's been counted so far, one event per API that's been called,
+//   to the trace sessions listening for it.
+// - This is called when a session asks the provider to capture its state.
+//   The counts are kept, so each rundown has everything since the start.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void ApiStatistics::s_TraceRundown() noexcept
+{
+    if (!s_IsEnabled())
+    {
+        return;
+    }
+
+    for (size_t slot = 0; slot < s_SlotCount; slot++)
+    {
+        const Api& api = s_apis[slot];
+        const ULONG64 calls = api.calls.load(std::memory_order_relaxed);
+        if (calls == 0)
+        {
+            continue;
+        }
+
+        ULONG64 lockWaitHistogram[s_BucketCount];
+        ULONG64 executeHistogram[s_BucketCount];
+        for (size_t bucket = 0; bucket < s_BucketCount; bucket++)
+        {
+            lockWaitHistogram[bucket] = api.lockWaitHistogram[bucket].load(std::memory_order_relaxed);
+            executeHistogram[bucket] = api.executeHistogram[bucket].load(std::memory_order_relaxed);
+        }
+
+        TraceLoggingWrite(g_hConhostV2EventTraceProvider, "ApiStatistics",
+                          TraceLoggingString(api.traceName.load(std::memory_order_relaxed), "ApiName"),
+                          TraceLoggingHexUInt32(gsl::narrow_cast<UINT32>(((slot / s_ApisPerLayer + 1) << 24) | (slot % s_ApisPerLayer)), "ApiNumber"),
+                          TraceLoggingUInt64(calls, "Calls"),
+                          TraceLoggingUInt64(api.lockWaitUs.load(std::memory_order_relaxed), "LockWaitMicroseconds"),
+                          TraceLoggingUInt64(api.executeUs.load(std::memory_order_relaxed), "ExecuteMicroseconds"),
+                          TraceLoggingUInt64Array(lockWaitHistogram, s_BucketCount, "LockWaitHistogram"),
+                          TraceLoggingUInt64Array(executeHistogram, s_BucketCount, "ExecuteHistogram"),
+                          TraceLoggingOpcode(WINEVENT_OPCODE_DC_START),
+                          TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+                          TraceLoggingKeyword(s_apiStatisticsKeyword));
+    }
+}
+
+// Routine Description:
+// - Checks whether a trace session wants the statistics. This is all that a
+//   call costs when none does.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if the calls should be measured.
+bool ApiStatistics::s_IsEnabled() noexcept
+{
+    return TraceLoggingProviderEnabled(g_hConhostV2EventTraceProvider, WINEVENT_LEVEL_INFO, s_apiStatisticsKeyword);
+}
+
+// Routine Description:
+// - Adds a measured call to the statistics of its API. The IO threads can
+//   finish calls at the same time, so everything is counted atomically.
+// Arguments:
+// - call - The call, once it's over.
+// Return Value:
+// - <none>
+void ApiStatistics::s_Record(const Call& call) noexcept
+{
+    using namespace std::chrono;
+
+    const auto total = steady_clock::now() - call._start;
+    const auto lockWait = std::min(call._lockWait, total);
+    const ULONG64 lockWaitUs = duration_cast<microseconds>(lockWait).count();
+    const ULONG64 executeUs = duration_cast<microseconds>(total - lockWait).count();
+
+    Api& api = s_apis[call._slot];
+    api.traceName.store(call._traceName, std::memory_order_relaxed);
+    api.calls.fetch_add(1, std::memory_order_relaxed);
+    api.lockWaitUs.fetch_add(lockWaitUs, std::memory_order_relaxed);
+    api.executeUs.fetch_add(executeUs, std::memory_order_relaxed);
+    api.lockWaitHistogram[s_Bucket(lockWaitUs)].fetch_add(1, std::memory_order_relaxed);
+    api.executeHistogram[s_Bucket(executeUs)].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Routine Description:
+// - Finds the histogram bucket for a duration.
+// Arguments:
+// - us - The duration in microseconds.
+// Return Value:
+// - 0 for under 1us, n for 2^(n-1) up to 2^n us, and the last bucket for anything longer.
+size_t ApiStatistics::s_Bucket(const ULONG64 us) noexcept
+{
+    size_t bucket = 0;
+    for (ULONG64 remaining = us; remaining != 0 && bucket < s_BucketCount - 1; remaining >>= 1)
+    {
+        bucket++;
+    }
+    return bucket;
+}
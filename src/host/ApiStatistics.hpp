@@ -0,0 +1,78 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ApiStatistics.hpp
+
+Abstract:
+- This module counts the API calls the server dispatches, per API, and how
+  long they take, split into the time spent waiting for the console lock and
+  the time spent doing the work.
+- It only measures while a trace session enables the ApiStatistics keyword of
+  the console host's provider. The totals and histograms are written to that
+  session when it asks the provider to capture its state (its rundown).
+
+Author(s):
+--*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+class ApiStatistics final
+{
+public:
+    // Each dispatched call is measured for as long as one of these is around,
+    // on the thread that's servicing it.
+    class Call final
+    {
+    public:
+        Call(const ULONG apiNumber, const PCSTR traceName) noexcept;
+        ~Call();
+
+        Call(const Call&) = delete;
+        Call& operator=(const Call&) = delete;
+
+    private:
+        friend class ApiStatistics;
+
+        size_t _slot;
+        PCSTR _traceName;
+        std::chrono::steady_clock::time_point _start;
+        std::chrono::steady_clock::duration _lockWait;
+    };
+
+    static bool s_IsMeasuringThisThread() noexcept;
+    static void s_AddLockWait(const std::chrono::steady_clock::duration wait) noexcept;
+
+    static void s_TraceRundown() noexcept;
+
+private:
+    // The histograms have a bucket for each power of two microseconds: under
+    //      1us, 1-2us, 2-4us, and so on, with the last one for everything slower.
+    static constexpr size_t s_BucketCount = 20;
+
+    // The API numbers of each layer are small, so the slot of an API is its
+    //      layer and number put together. Anything out past that isn't counted.
+    static constexpr size_t s_ApisPerLayer = 64;
+    static constexpr size_t s_LayerCount = 4;
+    static constexpr size_t s_SlotCount = s_ApisPerLayer * s_LayerCount;
+
+    struct Api
+    {
+        std::atomic<PCSTR> traceName;
+        std::atomic<ULONG64> calls;
+        std::atomic<ULONG64> lockWaitUs;
+        std::atomic<ULONG64> executeUs;
+        std::atomic<ULONG64> lockWaitHistogram[s_BucketCount];
+        std::atomic<ULONG64> executeHistogram[s_BucketCount];
+    };
+
+    static Api s_apis[s_SlotCount];
+
+    static bool s_IsEnabled() noexcept;
+    static void s_Record(const Call& call) noexcept;
+    static size_t s_Bucket(const ULONG64 us) noexcept;
+};
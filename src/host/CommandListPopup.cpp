@@ -14,6 +14,8 @@
 
 #include "..\interactivity\inc\ServiceLocator.hpp"
 
+using Microsoft::Console::Types::Viewport;
+
 static constexpr size_t COMMAND_NUMBER_SIZE = 8;   // size of command number buffer
 
 // Routine Description:
@@ -166,6 +168,8 @@ NTSTATUS CommandListPopup::_deleteSelection(COOKED_READ_DATA& cookedReadData) no
             _bottomIndex = _currentCommand;
         }
 
+        // every command after the deleted one has been renumbered
+        std::fill(_drawnRows.begin(), _drawnRows.end(), DrawnRow{});
         _drawList();
     }
     CATCH_LOG();
@@ -188,8 +192,9 @@ NTSTATUS CommandListPopup::_swapUp(COOKED_READ_DATA& cookedReadData) noexcept
             return STATUS_SUCCESS;
         }
         history.Swap(_currentCommand, _currentCommand - 1);
+        _invalidateCommand(_currentCommand);
+        _invalidateCommand(_currentCommand - 1i16);
         _update(-1);
-        _drawList();
     }
     CATCH_LOG();
     return STATUS_SUCCESS;
@@ -211,8 +216,9 @@ NTSTATUS CommandListPopup::_swapDown(COOKED_READ_DATA& cookedReadData) noexcept
             return STATUS_SUCCESS;
         }
         history.Swap(_currentCommand, _currentCommand + 1);
+        _invalidateCommand(_currentCommand);
+        _invalidateCommand(_currentCommand + 1i16);
         _update(1);
-        _drawList();
     }
     CATCH_LOG();
     return STATUS_SUCCESS;
@@ -325,123 +331,206 @@ NTSTATUS CommandListPopup::Process(COOKED_READ_DATA& cookedReadData) noexcept
 
 void CommandListPopup::_DrawContent()
 {
+    // whatever was drawn before is gone, so start over
+    _drawnRows.clear();
     _drawList();
 }
 
 // Routine Description:
 // - Draws a list of commands for the user to choose from
+// - Only the rows that differ from what was drawn last time are written. When the
+//   list has scrolled, the rows that are still visible are moved by a single copy of
+//   their cells, and only the ones scrolled into view are drawn from the history.
 void CommandListPopup::_drawList()
 {
-    // draw empty popup
-    COORD WriteCoord;
-    WriteCoord.X = _region.Left + 1i16;
-    WriteCoord.Y = _region.Top + 1i16;
-    size_t lStringLength = Width();
-    for (SHORT i = 0; i < Height(); ++i)
+    const SHORT height = Height();
+    const SHORT top = std::max(gsl::narrow<SHORT>(_bottomIndex - height + 1), 0i16);
+
+    if (_drawnRows.size() != gsl::narrow_cast<size_t>(height))
     {
-        const OutputCellIterator spaces(UNICODE_SPACE, _attributes, lStringLength);
-        const auto result = _screenInfo.Write(spaces, WriteCoord);
-        lStringLength = result.GetCellDistance(spaces);
-        WriteCoord.Y += 1i16;
+        _drawnRows.assign(gsl::narrow_cast<size_t>(height), DrawnRow{});
+        _drawnTop = top;
     }
 
-    auto& api = ServiceLocator::LocateGlobals().api;
-
-    WriteCoord.Y = _region.Top + 1i16;
-    SHORT i = std::max(gsl::narrow<SHORT>(_bottomIndex - Height() + 1), 0i16);
-    for (; i <= _bottomIndex; i++)
+    const SHORT shift = top - _drawnTop;
+    if (shift != 0)
     {
-        CHAR CommandNumber[COMMAND_NUMBER_SIZE];
-        // Write command number to screen.
-        if (0 != _itoa_s(i, CommandNumber, ARRAYSIZE(CommandNumber), 10))
-        {
-            return;
-        }
+        _scrollRows(shift);
+        _drawnTop = top;
+    }
 
-        PCHAR CommandNumberPtr = CommandNumber;
+    COORD WriteCoord;
+    WriteCoord.X = _region.Left + 1i16;
+    for (SHORT row = 0; row < height; ++row)
+    {
+        const SHORT command = top + row <= _bottomIndex ? top + row : s_NoCommand;
+        const bool highlighted = command != s_NoCommand && command == _currentCommand;
+        auto& drawn = _drawnRows.at(row);
 
-        size_t CommandNumberLength;
-        if (FAILED(StringCchLengthA(CommandNumberPtr, ARRAYSIZE(CommandNumber), &CommandNumberLength)))
+        WriteCoord.Y = _region.Top + 1i16 + row;
+        if (!drawn.valid || drawn.command != command)
         {
-            return;
+            _drawRow(WriteCoord, command);
+            drawn = { command, false, true };
         }
-        __assume_bound(CommandNumberLength);
 
-        if (CommandNumberLength + 1 >= ARRAYSIZE(CommandNumber))
+        if (drawn.highlighted != highlighted)
         {
-            return;
+            TextAttribute attributes = _attributes;
+            if (highlighted)
+            {
+                attributes.Invert();
+            }
+            _screenInfo.Write(OutputCellIterator(attributes, Width()), WriteCoord);
+            drawn.highlighted = highlighted;
         }
+    }
+}
+
+// Routine Description:
+// - Moves the rows of the list that stay visible when it scrolls, and forgets the
+//   rows they leave behind so that they're drawn again.
+// Arguments:
+// - shift - how many rows the top of the list moved down by. Negative if it moved up.
+void CommandListPopup::_scrollRows(const SHORT shift)
+{
+    const SHORT height = Height();
+    const SHORT kept = height - gsl::narrow_cast<SHORT>(std::abs(shift));
+    if (kept <= 0)
+    {
+        std::fill(_drawnRows.begin(), _drawnRows.end(), DrawnRow{});
+        return;
+    }
+
+    // rows [from, from + kept) of the list end up at rows [to, to + kept)
+    const SHORT from = std::max(shift, 0i16);
+    const SHORT to = std::max(gsl::narrow_cast<SHORT>(-shift), 0i16);
+
+    SMALL_RECT source;
+    source.Left = _region.Left + 1i16;
+    source.Right = _region.Right - 1i16;
+    source.Top = _region.Top + 1i16 + from;
+    source.Bottom = source.Top + kept - 1i16;
+    const auto cells = _screenInfo.ReadRect(Viewport::FromInclusive(source));
+    _screenInfo.WriteRect(cells, { source.Left, gsl::narrow_cast<SHORT>(_region.Top + 1i16 + to) });
 
-        CommandNumber[CommandNumberLength] = ':';
-        CommandNumber[CommandNumberLength + 1] = ' ';
-        CommandNumberLength += 2;
-        if (CommandNumberLength > static_cast<ULONG>(Width()))
+    if (shift > 0)
+    {
+        std::move(_drawnRows.begin() + from, _drawnRows.begin() + from + kept, _drawnRows.begin());
+        std::fill(_drawnRows.begin() + kept, _drawnRows.end(), DrawnRow{});
+    }
+    else
+    {
+        std::move_backward(_drawnRows.begin(), _drawnRows.begin() + kept, _drawnRows.end());
+        std::fill(_drawnRows.begin(), _drawnRows.begin() + to, DrawnRow{});
+    }
+}
+
+// Routine Description:
+// - Forgets the row a command was drawn in, so that it's drawn again.
+// Arguments:
+// - command - the number of the command whose text has changed
+void CommandListPopup::_invalidateCommand(const SHORT command) noexcept
+{
+    for (auto& drawn : _drawnRows)
+    {
+        if (drawn.valid && drawn.command == command)
         {
-            CommandNumberLength = static_cast<ULONG>(Width());
+            drawn.valid = false;
         }
+    }
+}
 
-        WriteCoord.X = _region.Left + 1i16;
+// Routine Description:
+// - Draws one row of the list, unhighlighted.
+// Arguments:
+// - WriteCoord - where the row starts, just inside the popup's border
+// - command - the number of the command to draw, or s_NoCommand to leave the row empty
+void CommandListPopup::_drawRow(COORD WriteCoord, const SHORT command)
+{
+    const OutputCellIterator spaces(UNICODE_SPACE, _attributes, Width());
+    _screenInfo.Write(spaces, WriteCoord);
 
-        LOG_IF_FAILED(api.WriteConsoleOutputCharacterAImpl(_screenInfo,
-                                                           { CommandNumberPtr, CommandNumberLength },
-                                                           WriteCoord,
-                                                           CommandNumberLength));
+    if (command == s_NoCommand)
+    {
+        return;
+    }
 
-        // write command to screen
-        auto command = _history.GetNth(i);
-        lStringLength = command.size();
-        {
-            size_t lTmpStringLength = lStringLength;
-            LONG lPopupLength = static_cast<LONG>(Width() - CommandNumberLength);
-            PCWCHAR lpStr = command.data();
-            while (lTmpStringLength--)
-            {
-                if (IsGlyphFullWidth(*lpStr++))
-                {
-                    lPopupLength -= 2;
-                }
-                else
-                {
-                    lPopupLength--;
-                }
+    auto& api = ServiceLocator::LocateGlobals().api;
 
-                if (lPopupLength <= 0)
-                {
-                    lStringLength -= lTmpStringLength;
-                    if (lPopupLength < 0)
-                    {
-                        lStringLength--;
-                    }
+    CHAR CommandNumber[COMMAND_NUMBER_SIZE];
+    // Write command number to screen.
+    if (0 != _itoa_s(command, CommandNumber, ARRAYSIZE(CommandNumber), 10))
+    {
+        return;
+    }
 
-                    break;
-                }
-            }
-        }
+    PCHAR CommandNumberPtr = CommandNumber;
+
+    size_t CommandNumberLength;
+    if (FAILED(StringCchLengthA(CommandNumberPtr, ARRAYSIZE(CommandNumber), &CommandNumberLength)))
+    {
+        return;
+    }
+    __assume_bound(CommandNumberLength);
 
-        WriteCoord.X = gsl::narrow<SHORT>(WriteCoord.X + CommandNumberLength);
-        size_t used;
-        LOG_IF_FAILED(api.WriteConsoleOutputCharacterWImpl(_screenInfo,
-                                                           { command.data(), lStringLength },
-                                                           WriteCoord,
-                                                           used));
+    if (CommandNumberLength + 1 >= ARRAYSIZE(CommandNumber))
+    {
+        return;
+    }
 
-        // write attributes to screen
-        if (i == _currentCommand)
+    CommandNumber[CommandNumberLength] = ':';
+    CommandNumber[CommandNumberLength + 1] = ' ';
+    CommandNumberLength += 2;
+    if (CommandNumberLength > static_cast<ULONG>(Width()))
+    {
+        CommandNumberLength = static_cast<ULONG>(Width());
+    }
+
+    WriteCoord.X = _region.Left + 1i16;
+
+    LOG_IF_FAILED(api.WriteConsoleOutputCharacterAImpl(_screenInfo,
+                                                       { CommandNumberPtr, CommandNumberLength },
+                                                       WriteCoord,
+                                                       CommandNumberLength));
+
+    // write command to screen
+    const auto text = _history.GetNth(command);
+    size_t lStringLength = text.size();
+    {
+        size_t lTmpStringLength = lStringLength;
+        LONG lPopupLength = static_cast<LONG>(Width() - CommandNumberLength);
+        PCWCHAR lpStr = text.data();
+        while (lTmpStringLength--)
         {
-            WriteCoord.X = _region.Left + 1i16;
-            // inverted attributes
-            lStringLength = Width();
-            TextAttribute inverted = _attributes;
-            inverted.Invert();
+            if (IsGlyphFullWidth(*lpStr++))
+            {
+                lPopupLength -= 2;
+            }
+            else
+            {
+                lPopupLength--;
+            }
 
-            const OutputCellIterator it(inverted, lStringLength);
-            const auto done = _screenInfo.Write(it, WriteCoord);
+            if (lPopupLength <= 0)
+            {
+                lStringLength -= lTmpStringLength;
+                if (lPopupLength < 0)
+                {
+                    lStringLength--;
+                }
 
-            lStringLength = done.GetCellDistance(it);
+                break;
+            }
         }
-
-        WriteCoord.Y += 1;
     }
+
+    WriteCoord.X = gsl::narrow<SHORT>(WriteCoord.X + CommandNumberLength);
+    size_t used;
+    LOG_IF_FAILED(api.WriteConsoleOutputCharacterWImpl(_screenInfo,
+                                                       { text.data(), lStringLength },
+                                                       WriteCoord,
+                                                       used));
 }
 
 // Routine Description:
@@ -480,7 +569,6 @@ void CommandListPopup::_update(const SHORT originalDelta, const bool wrap)
     }
     delta = NewCmdNum - CurCmdNum;
 
-    bool Scroll = false;
     // determine amount to scroll, if any
     if (NewCmdNum <= _bottomIndex - Size)
     {
@@ -489,7 +577,6 @@ void CommandListPopup::_update(const SHORT originalDelta, const bool wrap)
         {
             _bottomIndex = Size - 1i16;
         }
-        Scroll = true;
     }
     else if (NewCmdNum > _bottomIndex)
     {
@@ -498,55 +585,10 @@ void CommandListPopup::_update(const SHORT originalDelta, const bool wrap)
         {
             _bottomIndex = gsl::narrow<SHORT>(_history.GetNumberOfCommands()) - 1i16;
         }
-        Scroll = true;
     }
 
-    // write commands to popup
-    if (Scroll)
-    {
-        _currentCommand = NewCmdNum;
-        _drawList();
-    }
-    else
-    {
-        _updateHighlight(_currentCommand, NewCmdNum);
-        _currentCommand = NewCmdNum;
-    }
+    // write commands to popup, which only touches the rows that changed
+    _currentCommand = NewCmdNum;
+    _drawList();
 }
-
-// Routine Description:
-// - Adjusts the highligted line in a list of commands
-// Arguments:
-// - OldCurrentCommand - The previous command highlighted
-// - NewCurrentCommand - The new command to be highlighted.
-void CommandListPopup::_updateHighlight(const SHORT OldCurrentCommand, const SHORT NewCurrentCommand)
-{
-    SHORT TopIndex;
-    if (_bottomIndex < Height())
-    {
-        TopIndex = 0;
-    }
-    else
-    {
-        TopIndex = _bottomIndex - Height() + 1i16;
-    }
-    COORD WriteCoord;
-    WriteCoord.X = _region.Left + 1i16;
-    size_t lStringLength = Width();
-
-    WriteCoord.Y = _region.Top + 1i16 + OldCurrentCommand - TopIndex;
-
-    const OutputCellIterator it(_attributes, lStringLength);
-    const auto done = _screenInfo.Write(it, WriteCoord);
-    lStringLength = done.GetCellDistance(it);
-
-    // highlight new command
-    WriteCoord.Y = _region.Top + 1i16 + NewCurrentCommand - TopIndex;
-
-    // inverted attributes
-    TextAttribute inverted = _attributes;
-    inverted.Invert();
-    const OutputCellIterator itAttr(inverted, lStringLength);
-    const auto doneAttr = _screenInfo.Write(itAttr, WriteCoord);
-    lStringLength = done.GetCellDistance(itAttr);
 }
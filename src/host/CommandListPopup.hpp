@@ -31,8 +31,10 @@ protected:
 
 private:
     void _drawList();
+    void _scrollRows(const SHORT shift);
+    void _drawRow(COORD WriteCoord, const SHORT command);
+    void _invalidateCommand(const SHORT command) noexcept;
     void _update(const SHORT delta, const bool wrap = false);
-    void _updateHighlight(const SHORT oldCommand, const SHORT newCommand);
 
     void _handleReturn(COOKED_READ_DATA& cookedReadData);
     void _cycleSelectionToMatchingCommands(COOKED_READ_DATA& cookedReadData, const wchar_t wch);
@@ -50,6 +52,18 @@ private:
     SHORT _bottomIndex;  // number of command displayed on last line of popup
     const CommandHistory& _history;
 
+    // What each row of the list was last drawn with, so that moving the selection
+    // or scrolling only redraws the rows that actually change.
+    static constexpr SHORT s_NoCommand = -1;
+    struct DrawnRow
+    {
+        SHORT command = s_NoCommand;
+        bool highlighted = false;
+        bool valid = false;
+    };
+    std::vector<DrawnRow> _drawnRows;
+    SHORT _drawnTop = 0;  // number of command displayed on first line when last drawn
+
 #ifdef UNIT_TESTING
     friend class CommandListPopupTests;
 #endif
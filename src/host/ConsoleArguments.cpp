@@ -9,8 +9,11 @@ using namespace Microsoft::Console::Utils;
 
 const std::wstring_view ConsoleArguments::VT_MODE_ARG = L"--vtmode";
 const std::wstring_view ConsoleArguments::HEADLESS_ARG = L"--headless";
+const std::wstring_view ConsoleArguments::NO_RENDER_ARG = L"--norender";
+const std::wstring_view ConsoleArguments::CAPTURE_FRAMES_ARG = L"--captureframes";
 const std::wstring_view ConsoleArguments::SERVER_HANDLE_ARG = L"--server";
 const std::wstring_view ConsoleArguments::SIGNAL_HANDLE_ARG = L"--signal";
+const std::wstring_view ConsoleArguments::OUTPUT_RING_ARG = L"--outputring";
 const std::wstring_view ConsoleArguments::HANDLE_PREFIX = L"0x";
 const std::wstring_view ConsoleArguments::CLIENT_COMMANDLINE_ARG = L"--";
 const std::wstring_view ConsoleArguments::FORCE_V1_ARG = L"-ForceV1";
@@ -18,6 +21,7 @@ const std::wstring_view ConsoleArguments::FILEPATH_LEADER_PREFIX = L"\\??\\";
 const std::wstring_view ConsoleArguments::WIDTH_ARG = L"--width";
 const std::wstring_view ConsoleArguments::HEIGHT_ARG = L"--height";
 const std::wstring_view ConsoleArguments::INHERIT_CURSOR_ARG = L"--inheritcursor";
+const std::wstring_view ConsoleArguments::PASSTHROUGH_ARG = L"--passthrough";
 const std::wstring_view ConsoleArguments::FEATURE_ARG = L"--feature";
 const std::wstring_view ConsoleArguments::FEATURE_PTY_ARG = L"pty";
 
@@ -33,14 +37,18 @@ ConsoleArguments::ConsoleArguments(const std::wstring& commandline,
 {
     _clientCommandline = L"";
     _vtMode = L"";
+    _frameCapturePath = L"";
     _headless = false;
+    _renderless = false;
     _createServerHandle = true;
     _serverHandle = 0;
     _signalHandle = 0;
+    _outputRingHandle = 0;
     _forceV1 = false;
     _width = 0;
     _height = 0;
     _inheritCursor = false;
+    _passthrough = false;
 }
 
 ConsoleArguments::ConsoleArguments() :
@@ -58,14 +66,18 @@ ConsoleArguments& ConsoleArguments::operator=(const ConsoleArguments & other)
         _vtInHandle = other._vtInHandle;
         _vtOutHandle = other._vtOutHandle;
         _vtMode = other._vtMode;
+        _frameCapturePath = other._frameCapturePath;
         _headless = other._headless;
+        _renderless = other._renderless;
         _createServerHandle = other._createServerHandle;
         _serverHandle = other._serverHandle;
         _signalHandle = other._signalHandle;
+        _outputRingHandle = other._outputRingHandle;
         _forceV1 = other._forceV1;
         _width = other._width;
         _height = other._height;
         _inheritCursor = other._inheritCursor;
+        _passthrough = other._passthrough;
         _recievedEarlySizeChange = other._recievedEarlySizeChange;
     }
 
@@ -370,6 +382,16 @@ HRESULT ConsoleArguments::ParseCommandline()
                 hr = s_ParseHandleArg(signalHandleVal, _signalHandle);
             }
         }
+        else if (arg == OUTPUT_RING_ARG)
+        {
+            std::wstring outputRingHandleVal;
+            hr = s_GetArgumentValue(args, i, &outputRingHandleVal);
+
+            if (SUCCEEDED(hr))
+            {
+                hr = s_ParseHandleArg(outputRingHandleVal, _outputRingHandle);
+            }
+        }
         else if (arg == FORCE_V1_ARG)
         {
             // -ForceV1 command line switch for NTVDM support
@@ -388,6 +410,10 @@ HRESULT ConsoleArguments::ParseCommandline()
         {
             hr = s_GetArgumentValue(args, i, &_vtMode);
         }
+        else if (arg == CAPTURE_FRAMES_ARG)
+        {
+            hr = s_GetArgumentValue(args, i, &_frameCapturePath);
+        }
         else if (arg == WIDTH_ARG)
         {
             hr = s_GetArgumentValue(args, i, &_width);
@@ -406,12 +432,25 @@ HRESULT ConsoleArguments::ParseCommandline()
             s_ConsumeArg(args, i);
             hr = S_OK;
         }
+        else if (arg == NO_RENDER_ARG)
+        {
+            _renderless = true;
+            _headless = true;
+            s_ConsumeArg(args, i);
+            hr = S_OK;
+        }
         else if (arg == INHERIT_CURSOR_ARG)
         {
             _inheritCursor = true;
             s_ConsumeArg(args, i);
             hr = S_OK;
         }
+        else if (arg == PASSTHROUGH_ARG)
+        {
+            _passthrough = true;
+            s_ConsumeArg(args, i);
+            hr = S_OK;
+        }
         else if (arg == CLIENT_COMMANDLINE_ARG)
         {
             // Everything after this is the explicit commandline
@@ -443,6 +482,19 @@ HRESULT ConsoleArguments::ParseCommandline()
         FAIL_FAST_IF(!args.empty());
     }
 
+    // Without anything to render to, the standard handles aren't a VT
+    //      connection, even when they're pipes, like they are on a build agent.
+    //      A signal handle only comes from a pseudoconsole, which always renders.
+    if (SUCCEEDED(hr) && _renderless)
+    {
+        _vtInHandle = INVALID_HANDLE_VALUE;
+        _vtOutHandle = INVALID_HANDLE_VALUE;
+        if (HasSignalHandle())
+        {
+            hr = E_INVALIDARG;
+        }
+    }
+
     return hr;
 }
 
@@ -490,6 +542,18 @@ bool ConsoleArguments::IsHeadless() const
     return _headless;
 }
 
+// Routine Description:
+// - Returns true if we were asked to run without a window, a VT connection or
+//   any render engines. See _renderless.
+// Arguments:
+// - <none> - uses internal state
+// Return Value:
+// - True or false (see description)
+bool ConsoleArguments::IsRenderless() const
+{
+    return _renderless;
+}
+
 bool ConsoleArguments::ShouldCreateServerHandle() const
 {
     return _createServerHandle;
@@ -505,6 +569,23 @@ HANDLE ConsoleArguments::GetSignalHandle() const
     return ULongToHandle(_signalHandle);
 }
 
+// Routine Description:
+// - Returns true if we were passed a seemingly valid section handle for a
+//      shared ring to write our output to, instead of the output pipe.
+// Arguments:
+// - <none> - uses internal state
+// Return Value:
+// - True or false (see description)
+bool ConsoleArguments::HasOutputRingHandle() const
+{
+    return IsValidHandle(GetOutputRingHandle());
+}
+
+HANDLE ConsoleArguments::GetOutputRingHandle() const
+{
+    return ULongToHandle(_outputRingHandle);
+}
+
 HANDLE ConsoleArguments::GetVtInHandle() const
 {
     return _vtInHandle;
@@ -525,6 +606,11 @@ std::wstring ConsoleArguments::GetVtMode() const
     return _vtMode;
 }
 
+std::wstring ConsoleArguments::GetFrameCapturePath() const
+{
+    return _frameCapturePath;
+}
+
 bool ConsoleArguments::GetForceV1() const
 {
     return _forceV1;
@@ -545,6 +631,11 @@ bool ConsoleArguments::GetInheritCursor() const
     return _inheritCursor;
 }
 
+bool ConsoleArguments::GetPassthrough() const
+{
+    return _passthrough;
+}
+
 // Method Description:
 // - Tell us to use a different size than the one parsed as the size of the
 //      console. This is called by the PtySignalInputThread when it recieves a
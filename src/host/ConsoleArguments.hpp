@@ -36,6 +36,7 @@ public:
     bool HasVtHandles() const;
     bool InConptyMode() const noexcept;
     bool IsHeadless() const;
+    bool IsRenderless() const;
     bool ShouldCreateServerHandle() const;
 
     HANDLE GetServerHandle() const;
@@ -45,20 +46,28 @@ public:
     bool HasSignalHandle() const;
     HANDLE GetSignalHandle() const;
 
+    bool HasOutputRingHandle() const;
+    HANDLE GetOutputRingHandle() const;
+
     std::wstring GetClientCommandline() const;
     std::wstring GetVtMode() const;
+    std::wstring GetFrameCapturePath() const;
     bool GetForceV1() const;
 
     short GetWidth() const;
     short GetHeight() const;
     bool GetInheritCursor() const;
+    bool GetPassthrough() const;
 
     void SetExpectedSize(COORD dimensions) noexcept;
 
     static const std::wstring_view VT_MODE_ARG;
     static const std::wstring_view HEADLESS_ARG;
+    static const std::wstring_view NO_RENDER_ARG;
+    static const std::wstring_view CAPTURE_FRAMES_ARG;
     static const std::wstring_view SERVER_HANDLE_ARG;
     static const std::wstring_view SIGNAL_HANDLE_ARG;
+    static const std::wstring_view OUTPUT_RING_ARG;
     static const std::wstring_view HANDLE_PREFIX;
     static const std::wstring_view CLIENT_COMMANDLINE_ARG;
     static const std::wstring_view FORCE_V1_ARG;
@@ -66,6 +75,7 @@ public:
     static const std::wstring_view WIDTH_ARG;
     static const std::wstring_view HEIGHT_ARG;
     static const std::wstring_view INHERIT_CURSOR_ARG;
+    static const std::wstring_view PASSTHROUGH_ARG;
     static const std::wstring_view FEATURE_ARG;
     static const std::wstring_view FEATURE_PTY_ARG;
 
@@ -94,10 +104,13 @@ private:
         _height(height),
         _forceV1(forceV1),
         _headless(headless),
+        _renderless(false),
         _createServerHandle(createServerHandle),
         _serverHandle(serverHandle),
         _signalHandle(signalHandle),
+        _outputRingHandle(0),
         _inheritCursor(inheritCursor),
+        _passthrough(false),
         _recievedEarlySizeChange{ false },
         _originalWidth{ -1 },
         _originalHeight{ -1 }
@@ -116,8 +129,15 @@ private:
 
     std::wstring _vtMode;
 
+    // Where to write down what each frame is painted from, to replay it later.
+    std::wstring _frameCapturePath;
+
     bool _forceV1;
     bool _headless;
+    // No window, no VT connection and no render engines, only the server, the
+    //      buffers and the parsers. For measuring those on machines with no
+    //      desktop. It's always headless too.
+    bool _renderless;
 
     short _width;
     short _height;
@@ -125,7 +145,11 @@ private:
     bool _createServerHandle;
     DWORD _serverHandle;
     DWORD _signalHandle;
+    DWORD _outputRingHandle;
     bool _inheritCursor;
+    // Pass the client's VT output through to the terminal when we can,
+    //      instead of painting it again. See VtIo::PassThrough.
+    bool _passthrough;
 
     bool _recievedEarlySizeChange;
     short _originalWidth;
@@ -0,0 +1,125 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "ConsoleStateSnapshot.hpp"
+
+#include "..\interactivity\inc\ServiceLocator.hpp"
+
+#pragma hdrstop
+
+ConsoleStateSnapshot::ConsoleStateSnapshot() noexcept :
+    _sequence{ 0 },
+    _valid{ false },
+    _wanted{ false },
+    _state{}
+{
+}
+
+// Routine Description:
+// - Checks whether a query on the given output buffer is answered by this state.
+// Arguments:
+// - context - The output buffer the query's handle is for.
+// Return Value:
+// - true if the buffer is the active one, or the main buffer behind it.
+bool ConsoleStateSnapshot::State::IsFor(const SCREEN_INFORMATION& context) const noexcept
+{
+    return &context == activeBuffer || &context == mainBuffer;
+}
+
+// Routine Description:
+// - Takes a new copy of the state, if anyone has asked for it.
+// - The console lock must be held exclusively when calling this routine.
+// Arguments:
+// - gci - The console to copy the state of.
+// Return Value:
+// - <none>
+void ConsoleStateSnapshot::Publish(const CONSOLE_INFORMATION& gci) noexcept
+{
+    if (!_wanted.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    State state{};
+    bool valid = false;
+    if (gci.HasActiveOutputBuffer() && gci.pInputBuffer != nullptr)
+    {
+        try
+        {
+            const SCREEN_INFORMATION& active = gci.GetActiveOutputBuffer();
+            const SCREEN_INFORMATION& main = active.GetMainBuffer();
+
+            state.activeBuffer = &active;
+            state.mainBuffer = &main;
+            active.GetScreenBufferInformation(&state.size,
+                                              &state.cursorPosition,
+                                              &state.window,
+                                              &state.attributes,
+                                              &state.maximumWindowSize,
+                                              &state.popupAttributes,
+                                              state.colorTable);
+
+            state.cursorSize = active.GetTextBuffer().GetCursor().GetSize();
+            state.activeCursorVisible = active.GetTextBuffer().GetCursor().IsVisible();
+            state.mainCursorVisible = main.GetTextBuffer().GetCursor().IsVisible();
+            state.outputMode = active.OutputMode;
+
+            state.inputBuffer = gci.pInputBuffer;
+            state.inputMode = gci.pInputBuffer->InputMode;
+            if (WI_IsFlagSet(gci.Flags, CONSOLE_USE_PRIVATE_FLAGS))
+            {
+                WI_SetFlag(state.inputMode, ENABLE_EXTENDED_FLAGS);
+                WI_SetFlagIf(state.inputMode, ENABLE_INSERT_MODE, gci.GetInsertMode());
+                WI_SetFlagIf(state.inputMode, ENABLE_QUICK_EDIT_MODE, WI_IsFlagSet(gci.Flags, CONSOLE_QUICK_EDIT_MODE));
+                WI_SetFlagIf(state.inputMode, ENABLE_AUTO_POSITION, WI_IsFlagSet(gci.Flags, CONSOLE_AUTO_POSITION));
+            }
+
+            valid = true;
+        }
+        CATCH_LOG();
+    }
+
+    const ULONG sequence = _sequence.load(std::memory_order_relaxed);
+    _sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _valid = valid;
+    _state = state;
+
+    _sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Routine Description:
+// - Copies the state out, without taking the console lock.
+// - The first time this is called, there's nothing to copy yet. From then on,
+//   the state is published for it.
+// Arguments:
+// - state - Receives the state.
+// Return Value:
+// - true if the state was copied. false if the caller has to take the lock and find it out itself.
+bool ConsoleStateSnapshot::TryRead(State& state) noexcept
+{
+    _wanted.store(true, std::memory_order_relaxed);
+
+    for (size_t attempt = 0; attempt < s_ReadAttempts; attempt++)
+    {
+        const ULONG before = _sequence.load(std::memory_order_acquire);
+        if ((before & 1) != 0)
+        {
+            continue;
+        }
+
+        const bool valid = _valid;
+        state = _state;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_sequence.load(std::memory_order_relaxed) == before)
+        {
+            return valid;
+        }
+    }
+
+    return false;
+}
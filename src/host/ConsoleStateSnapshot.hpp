@@ -0,0 +1,77 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ConsoleStateSnapshot.hpp
+
+Abstract:
+- Keeps a copy of what the console's most polled queries answer with (the
+  screen buffer info, the cursor info and the modes) that can be read without
+  the console lock.
+- Runtimes like Python, Node and .NET poll these all the time. Once one of
+  them has been asked for, the copy is published again each time a writer
+  lets go of the console lock. So it's never older than the last change, and a
+  poll only has to take the lock if a writer got in between reading the copy's
+  version and finishing reading it.
+- Only the writers publish, and only with the console lock held exclusively, so
+  there's never more than one at a time. The readers check the sequence number
+  before and after copying: if it's odd, or it moved, they try again.
+
+Author(s):
+--*/
+
+#pragma once
+
+#include <atomic>
+
+class SCREEN_INFORMATION;
+class InputBuffer;
+class CONSOLE_INFORMATION;
+
+class ConsoleStateSnapshot final
+{
+public:
+    struct State
+    {
+        // The active output buffer, and the main buffer if that's the
+        //      alternate one. A handle to either of them is answered with the
+        //      active one, like SCREEN_INFORMATION::GetActiveBuffer does.
+        const SCREEN_INFORMATION* activeBuffer;
+        const SCREEN_INFORMATION* mainBuffer;
+
+        COORD size;
+        COORD cursorPosition;
+        SMALL_RECT window;
+        WORD attributes;
+        COORD maximumWindowSize;
+        WORD popupAttributes;
+        COLORREF colorTable[COLOR_TABLE_SIZE];
+
+        ULONG cursorSize;
+        bool activeCursorVisible;
+        bool mainCursorVisible;
+        ULONG outputMode;
+
+        const InputBuffer* inputBuffer;
+        ULONG inputMode;
+
+        bool IsFor(const SCREEN_INFORMATION& context) const noexcept;
+    };
+
+    ConsoleStateSnapshot() noexcept;
+
+    void Publish(const CONSOLE_INFORMATION& gci) noexcept;
+    bool TryRead(State& state) noexcept;
+
+private:
+    // How many times a read can be spoiled by a writer before it gives up and takes the lock.
+    static constexpr size_t s_ReadAttempts = 4;
+
+    std::atomic<ULONG> _sequence;
+    // Whether there's anything in _state yet. Written with _sequence odd.
+    bool _valid;
+    // Whether anyone's asked for the state. Until then, nothing is published.
+    std::atomic<bool> _wanted;
+    State _state;
+};
@@ -7,19 +7,19 @@
 #pragma hdrstop
 using namespace Microsoft::Console;
 
+static void CALLBACK CursorTimerRoutineWrapper(_Inout_ PTP_CALLBACK_INSTANCE /* Instance */, _Inout_opt_ PVOID /* Context */, _Inout_ PTP_TIMER /* Timer */);
+
 CursorBlinker::CursorBlinker() :
-    _hCaretBlinkTimer(INVALID_HANDLE_VALUE),
-    _hCaretBlinkTimerQueue(THROW_LAST_ERROR_IF_NULL(CreateTimerQueue())),
-    _uCaretBlinkTime(INFINITE) // default to no blink
+    _caretBlinkTimer(THROW_LAST_ERROR_IF_NULL(CreateThreadpoolTimer(CursorTimerRoutineWrapper, this, nullptr))),
+    _uCaretBlinkTime(INFINITE), // default to no blink
+    _hasFocus(false),
+    _isWindowVisible(true)
 {
 }
 
 CursorBlinker::~CursorBlinker()
 {
-    if (_hCaretBlinkTimerQueue)
-    {
-        DeleteTimerQueueEx(_hCaretBlinkTimerQueue, INVALID_HANDLE_VALUE);
-    }
+    // The timer cancels itself and waits for a callback in progress to finish when it's closed.
 }
 
 void CursorBlinker::UpdateSystemMetrics()
@@ -42,14 +42,41 @@ void CursorBlinker::SettingsChanged()
 
 void CursorBlinker::FocusEnd()
 {
+    _hasFocus = false;
     KillCaretTimer();
 }
 
 void CursorBlinker::FocusStart()
 {
+    _hasFocus = true;
     SetCaretTimer();
 }
 
+// Routine Description:
+// - Pauses blinking while the window is minimized or hidden, since nobody can
+//   see the cursor then, and picks it back up when the window comes back.
+// Arguments:
+// - isVisible - Whether the window can be seen now.
+// Return Value:
+// - <none>
+void CursorBlinker::WindowVisibilityChanged(const bool isVisible)
+{
+    if (isVisible == _isWindowVisible)
+    {
+        return;
+    }
+
+    _isWindowVisible = isVisible;
+    if (_isWindowVisible)
+    {
+        SetCaretTimer();
+    }
+    else
+    {
+        KillCaretTimer();
+    }
+}
+
 // Routine Description:
 // - This routine is called when the timer in the console with the focus goes off.  It blinks the cursor.
 // Arguments:
@@ -129,7 +156,7 @@ DoScroll:
     Scrolling::s_ScrollIfNecessary(ScreenInfo);
 }
 
-void CALLBACK CursorTimerRoutineWrapper(_In_ PVOID /* lpParam */, _In_ BOOLEAN /* TimerOrWaitFired */)
+static void CALLBACK CursorTimerRoutineWrapper(_Inout_ PTP_CALLBACK_INSTANCE /* Instance */, _Inout_opt_ PVOID /* Context */, _Inout_ PTP_TIMER /* Timer */)
 {
     // Suppose the following sequence of events takes place:
     //
@@ -139,13 +166,13 @@ void CALLBACK CursorTimerRoutineWrapper(_In_ PVOID /* lpParam */, _In_ BOOLEAN /
     // 4. This causes the current Cursor instance to be deleted, too;
     // 5. The Cursor's destructor is called;
     // => Somewhere between 1 and 5, the timer fires:
-    //    Timer queue timer callbacks execute asynchronously with respect to
+    //    Thread pool timer callbacks execute asynchronously with respect to
     //    the UI thread under which the numbered steps are taking place.
     //    Because the callback touches console state, it needs to acquire the
     //    console lock. But what if the timer callback fires at just the right
     //    time such that 2 has already acquired the lock?
-    // 6. The Cursor's destructor deletes the timer queue and thereby destroys
-    //    the timer queue timer used for blinking. However, because this
+    // 6. The Cursor's destructor closes the thread pool timer used for
+    //    blinking. However, because this
     //    timer's callback modifies console state, it is prudent to not
     //    continue the destruction if the callback has already started but has
     //    not yet finished. Therefore, the destructor waits for the callback to
@@ -179,50 +206,35 @@ void CALLBACK CursorTimerRoutineWrapper(_In_ PVOID /* lpParam */, _In_ BOOLEAN /
 //   need to make sure it gets drawn, so we'll set a short timer. When that
 //   goes off, we'll hit CursorTimerRoutine, and it'll do the right thing if
 //   guCaretBlinkTime is -1.
+// - The timer only runs while the window has the focus and can be seen.
 void CursorBlinker::SetCaretTimer()
 {
     static const DWORD dwDefTimeout = 0x212;
 
     KillCaretTimer();
 
-    if (_hCaretBlinkTimer == INVALID_HANDLE_VALUE)
+    if (_hasFocus && _isWindowVisible)
     {
-        bool bRet = true;
-        DWORD dwEffectivePeriod = _uCaretBlinkTime == -1 ? dwDefTimeout : _uCaretBlinkTime;
-
-        bRet = CreateTimerQueueTimer(&_hCaretBlinkTimer,
-                                     _hCaretBlinkTimerQueue,
-                                     CursorTimerRoutineWrapper,
-                                     this,
-                                     dwEffectivePeriod,
-                                     dwEffectivePeriod,
-                                     0);
-
-        LOG_LAST_ERROR_IF(!bRet);
+        const DWORD dwEffectivePeriod = _uCaretBlinkTime == -1 ? dwDefTimeout : _uCaretBlinkTime;
+
+        // A blink that's a little late won't be noticed, so let the system
+        // wait for up to an eighth of the period to run it along with other timers.
+        const DWORD dwTolerance = dwEffectivePeriod / 8;
+
+        // A negative due time is relative to now, in 100 nanosecond units.
+        ULARGE_INTEGER dueTime;
+        dueTime.QuadPart = static_cast<ULONGLONG>(-static_cast<LONGLONG>(dwEffectivePeriod) * 10000);
+        FILETIME ftDueTime;
+        ftDueTime.dwHighDateTime = dueTime.HighPart;
+        ftDueTime.dwLowDateTime = dueTime.LowPart;
+
+        SetThreadpoolTimer(_caretBlinkTimer.get(), &ftDueTime, dwEffectivePeriod, dwTolerance);
     }
 }
 
 void CursorBlinker::KillCaretTimer()
 {
-    if (_hCaretBlinkTimer != INVALID_HANDLE_VALUE)
-    {
-        bool bRet = true;
-
-        bRet = DeleteTimerQueueTimer(_hCaretBlinkTimerQueue,
-                                     _hCaretBlinkTimer,
-                                     NULL);
-
-        // According to https://msdn.microsoft.com/en-us/library/windows/desktop/ms682569(v=vs.85).aspx
-        // A failure to delete the timer with the LastError being ERROR_IO_PENDING means that the timer is
-        // currently in use and will get cleaned up when released. Delete should not be called again.
-        // We treat that case as a success.
-        if (bRet == false && GetLastError() != ERROR_IO_PENDING)
-        {
-            LOG_LAST_ERROR();
-        }
-        else
-        {
-            _hCaretBlinkTimer = INVALID_HANDLE_VALUE;
-        }
-    }
+    // This only keeps the timer from going off again. A callback that's already
+    // running is left to finish on its own.
+    SetThreadpoolTimer(_caretBlinkTimer.get(), nullptr, 0, 0);
 }
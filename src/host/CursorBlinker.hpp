@@ -7,6 +7,9 @@ Module Name:
 Abstract:
 - Encapsulates all of the behavior needed to blink the cursor, and update the
     blink rate to account for different system settings.
+- The blink timer is a thread pool timer that the system is allowed to run a
+    little late, so that it can wake up for it along with other timers. It only
+    runs while the window has the focus and can be seen.
 
 Author(s):
 - Mike Griese (migrie) Nov 2018
@@ -22,17 +25,19 @@ namespace Microsoft::Console
 
         void FocusStart();
         void FocusEnd();
+        void WindowVisibilityChanged(const bool isVisible);
 
         void UpdateSystemMetrics();
         void SettingsChanged();
         void TimerRoutine(SCREEN_INFORMATION& ScreenInfo);
 
     private:
-        // These use Timer Queues:
-        // https://msdn.microsoft.com/en-us/library/windows/desktop/ms687003(v=vs.85).aspx
-        HANDLE _hCaretBlinkTimer; // timer used to periodically blink the cursor
-        HANDLE _hCaretBlinkTimerQueue; // timer queue where the blink timer lives
+        // This uses a thread pool timer:
+        // https://docs.microsoft.com/en-us/windows/desktop/api/threadpoolapiset/nf-threadpoolapiset-setthreadpooltimer
+        wil::unique_threadpool_timer _caretBlinkTimer; // timer used to periodically blink the cursor
         UINT _uCaretBlinkTime;
+        bool _hasFocus;
+        bool _isWindowVisible;
         void SetCaretTimer();
         void KillCaretTimer();
     };
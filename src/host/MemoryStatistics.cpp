@@ -0,0 +1,138 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "MemoryStatistics.hpp"
+
+#include "handle.h"
+#include "history.h"
+#include "screenInfo.hpp"
+
+#include "..\interactivity\inc\ServiceLocator.hpp"
+
+// The MemoryStatistics keyword of the console host's provider, see TraceKeywords in tracing.cpp.
+static constexpr ULONGLONG s_memoryStatisticsKeyword = 0x2000;
+
+// Routine Description:
+// - Adds up how much memory each part of the console is holding right now.
+// - The console must be locked, at least for reading, while this walks it.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of each part, indexed by CONSOLE_MEMORY_SUBSYSTEM.
+MemoryStatistics::Usage MemoryStatistics::s_Measure()
+{
+    const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    Usage usage{};
+
+    // Every buffer, including the alt buffers, is in the list.
+    for (const SCREEN_INFORMATION* screenInfo = gci.ScreenBuffers; screenInfo != nullptr; screenInfo = screenInfo->Next)
+    {
+        const auto breakdown = screenInfo->GetTextBuffer().MeasureMemory();
+        usage.at(ConsoleMemoryTextBufferCells) += breakdown.cells;
+        usage.at(ConsoleMemoryTextBufferRows) += breakdown.rows;
+        usage.at(ConsoleMemoryAttributeRuns) += breakdown.attributeRuns;
+        usage.at(ConsoleMemoryUnicodeStorage) += breakdown.unicodeStorage;
+        usage.at(ConsoleMemoryAttributePalettes) += breakdown.attributePalette;
+        usage.at(ConsoleMemoryTextBufferOther) += breakdown.other;
+    }
+
+    if (gci.pInputBuffer != nullptr)
+    {
+        usage.at(ConsoleMemoryInputBuffer) = gci.pInputBuffer->MeasureMemory();
+    }
+
+    usage.at(ConsoleMemoryCommandHistories) = CommandHistory::s_MeasureMemory();
+
+    const auto pRender = ServiceLocator::LocateGlobals().pRender;
+    if (pRender != nullptr)
+    {
+        usage.at(ConsoleMemoryRenderCaches) = pRender->GetCacheMemoryUsage();
+    }
+
+    return usage;
+}
+
+// Routine Description:
+// - Gets the name a part of the console goes by in the rundown.
+// Arguments:
+// - subsystem - The part, as a CONSOLE_MEMORY_SUBSYSTEM.
+// Return Value:
+// - Its name.
+PCSTR MemoryStatistics::s_SubsystemName(const size_t subsystem) noexcept
+{
+    switch (subsystem)
+    {
+    case ConsoleMemoryTextBufferCells:
+        return "TextBufferCells";
+    case ConsoleMemoryTextBufferRows:
+        return "TextBufferRows";
+    case ConsoleMemoryAttributeRuns:
+        return "AttributeRuns";
+    case ConsoleMemoryUnicodeStorage:
+        return "UnicodeStorage";
+    case ConsoleMemoryAttributePalettes:
+        return "AttributePalettes";
+    case ConsoleMemoryTextBufferOther:
+        return "TextBufferOther";
+    case ConsoleMemoryInputBuffer:
+        return "InputBuffer";
+    case ConsoleMemoryCommandHistories:
+        return "CommandHistories";
+    case ConsoleMemoryRenderCaches:
+        return "RenderCaches";
+    default:
+        return "Unknown";
+    }
+}
+
+// Routine Description:
+// - Writes how much memory each part of the console is holding, one event per
+//   part, to the trace sessions listening for it.
+// - This is called when a session asks the provider to capture its state. It
+//   locks the console for reading while it adds everything up.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void MemoryStatistics::s_TraceRundown() noexcept
+{
+    if (!s_IsEnabled())
+    {
+        return;
+    }
+
+    try
+    {
+        Usage usage;
+        {
+            LockConsoleShared();
+            auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
+            usage = s_Measure();
+        }
+
+        for (size_t subsystem = 0; subsystem < s_SubsystemCount; subsystem++)
+        {
+            TraceLoggingWrite(g_hConhostV2EventTraceProvider, "MemoryStatistics",
+                              TraceLoggingString(s_SubsystemName(subsystem), "Subsystem"),
+                              TraceLoggingUInt64(usage.at(subsystem).bytes, "Bytes"),
+                              TraceLoggingUInt64(usage.at(subsystem).allocations, "Allocations"),
+                              TraceLoggingOpcode(WINEVENT_OPCODE_DC_START),
+                              TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+                              TraceLoggingKeyword(s_memoryStatisticsKeyword));
+        }
+    }
+    CATCH_LOG();
+}
+
+// Routine Description:
+// - Checks whether a trace session wants the statistics.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if the rundown should add everything up.
+bool MemoryStatistics::s_IsEnabled() noexcept
+{
+    return TraceLoggingProviderEnabled(g_hConhostV2EventTraceProvider, WINEVENT_LEVEL_INFO, s_memoryStatisticsKeyword);
+}
@@ -0,0 +1,41 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- MemoryStatistics.hpp
+
+Abstract:
+- This module adds up how much memory each part of the console is holding:
+  the text buffers (split into their cells, rows, attribute runs, stored
+  glyphs and attribute palettes), the input buffer, the command histories and
+  the render engines' caches. It's for telling which of them is responsible
+  when a console has grown far bigger than it should be.
+- Nothing is counted as it happens. Each part walks its own containers when
+  asked, with the console locked, so this costs nothing until then.
+- The totals are written to a trace session that enables the MemoryStatistics
+  keyword of the console host's provider when it asks the provider to capture
+  its state (its rundown). They can also be read with the undocumented
+  GetConsoleMemoryUsage API, one part at a time.
+--*/
+
+#pragma once
+
+#include "../types/inc/MemoryUsage.hpp"
+
+#include <array>
+
+class MemoryStatistics final
+{
+public:
+    static constexpr size_t s_SubsystemCount = ConsoleMemorySubsystemCount;
+    using Usage = std::array<Microsoft::Console::Types::MemoryUsage, s_SubsystemCount>;
+
+    static Usage s_Measure();
+    static PCSTR s_SubsystemName(const size_t subsystem) noexcept;
+
+    static void s_TraceRundown() noexcept;
+
+private:
+    static bool s_IsEnabled() noexcept;
+};
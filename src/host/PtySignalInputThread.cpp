@@ -11,12 +11,7 @@
 #include "..\terminal\adapter\DispatchCommon.hpp"
 
 #define PTY_SIGNAL_RESIZE_WINDOW 8u
-
-struct PTY_SIGNAL_RESIZE
-{
-    unsigned short sx;
-    unsigned short sy;
-};
+#define PTY_SIGNAL_REATTACH 10u
 
 using namespace Microsoft::Console;
 using namespace Microsoft::Console::Interactivity;
@@ -89,6 +84,9 @@ HRESULT PtySignalInputThread::_InputThread()
             PTY_SIGNAL_RESIZE resizeMsg = { 0 };
             _GetData(&resizeMsg, sizeof(resizeMsg));
 
+            // Don't resize (and repaint) for every size the window went through on its way here.
+            _CoalesceResizes(resizeMsg);
+
             LockConsole();
             auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
             // If the client app hasn't yet connected, stash the new size in the launchArgs.
@@ -115,6 +113,17 @@ HRESULT PtySignalInputThread::_InputThread()
 
             break;
         }
+        case PTY_SIGNAL_REATTACH:
+        {
+            LockConsole();
+            auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+            // Until the client app connects, nothing's been painted to send again.
+            if (_consoleConnected)
+            {
+                LOG_IF_FAILED(ServiceLocator::LocateGlobals().getConsoleInformation().GetVtIo()->Reattach());
+            }
+            break;
+        }
         default:
         {
             THROW_HR(E_UNEXPECTED);
@@ -162,6 +171,73 @@ bool PtySignalInputThread::_GetData(_Out_writes_bytes_(cbBuffer) void* const pBu
     return true;
 }
 
+// Method Description:
+// - Copies bytes out of the pipe without taking them, if there are enough of
+//   them there already. This never waits.
+// Arguments:
+// - pBuffer - Buffer to fill with data.
+// - cbBuffer - Count of bytes in the given buffer.
+// Return Value:
+// - True if cbBuffer bytes were waiting in the pipe. False otherwise, or if
+//   the handle isn't a pipe that can be peeked.
+bool PtySignalInputThread::_PeekData(_Out_writes_bytes_(cbBuffer) void* const pBuffer,
+                                     const DWORD cbBuffer)
+{
+    DWORD dwRead = 0;
+    return PeekNamedPipe(_hFile.get(), pBuffer, cbBuffer, &dwRead, nullptr, nullptr) &&
+           dwRead == cbBuffer;
+}
+
+// Method Description:
+// - Swallows any resizes that follow the one just read in quick succession,
+//   keeping only the latest size. We keep waiting for another one until the
+//   pipe's been quiet for s_ResizeSettleTime, or s_ResizeDeadline has passed
+//   since the first one, so that a window that's still being dragged repaints
+//   at least that often. Any other signal stops us right away, and is left in
+//   the pipe to be handled as usual.
+// Arguments:
+// - resizeMsg - The resize that was just read. Receives the latest one.
+// Return Value:
+// - <none>
+void PtySignalInputThread::_CoalesceResizes(_Inout_ PTY_SIGNAL_RESIZE& resizeMsg)
+{
+    struct
+    {
+        unsigned short signalId;
+        PTY_SIGNAL_RESIZE resize;
+    } next = { 0 };
+    static_assert(sizeof(next) == sizeof(unsigned short) + sizeof(PTY_SIGNAL_RESIZE));
+
+    const auto start = std::chrono::steady_clock::now();
+    auto lastResize = start;
+    while (std::chrono::steady_clock::now() - start < s_ResizeDeadline)
+    {
+        if (_PeekData(&next.signalId, sizeof(next.signalId)))
+        {
+            if (next.signalId != PTY_SIGNAL_RESIZE_WINDOW)
+            {
+                return;
+            }
+
+            // The rest of the message is on its way, if it's not here already.
+            if (!_GetData(&next, sizeof(next)))
+            {
+                return;
+            }
+            resizeMsg = next.resize;
+            lastResize = std::chrono::steady_clock::now();
+        }
+        else if (std::chrono::steady_clock::now() - lastResize >= s_ResizeSettleTime)
+        {
+            return;
+        }
+        else
+        {
+            Sleep(1);
+        }
+    }
+}
+
 // Method Description:
 // - Starts the PTY Signal input thread.
 [[nodiscard]]
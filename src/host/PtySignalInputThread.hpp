@@ -15,6 +15,12 @@ Author(s):
 --*/
 #pragma once
 
+struct PTY_SIGNAL_RESIZE
+{
+    unsigned short sx;
+    unsigned short sy;
+};
+
 namespace Microsoft::Console
 {
     class PtySignalInputThread final
@@ -37,6 +43,8 @@ namespace Microsoft::Console
         [[nodiscard]]
         HRESULT _InputThread();
         bool _GetData(_Out_writes_bytes_(cbBuffer) void* const pBuffer, const DWORD cbBuffer);
+        bool _PeekData(_Out_writes_bytes_(cbBuffer) void* const pBuffer, const DWORD cbBuffer);
+        void _CoalesceResizes(_Inout_ PTY_SIGNAL_RESIZE& resizeMsg);
         void _Shutdown();
 
         wil::unique_hfile _hFile;
@@ -44,5 +52,12 @@ namespace Microsoft::Console
         DWORD _dwThreadId;
         bool _consoleConnected;
         std::unique_ptr<Microsoft::Console::VirtualTerminal::ConGetSet> _pConApi;
+
+        // While the window's being dragged, the terminal sends us a resize for
+        //      every size it passes through. We hold on to a resize until no
+        //      other one has followed it for s_ResizeSettleTime, and only apply
+        //      the last one, but we never hold on for longer than s_ResizeDeadline.
+        static constexpr std::chrono::milliseconds s_ResizeSettleTime{ 8 };
+        static constexpr std::chrono::milliseconds s_ResizeDeadline{ 33 };
     };
 }
@@ -90,6 +90,16 @@ void ScreenBufferRenderTarget::TriggerScroll(const COORD* const pcoordDelta)
     }
 }
 
+void ScreenBufferRenderTarget::TriggerScroll(const Microsoft::Console::Types::Viewport& region, const COORD* const pcoordDelta)
+{
+    auto* pRenderer = ServiceLocator::LocateGlobals().pRender;
+    const auto* pActive = &ServiceLocator::LocateGlobals().getConsoleInformation().GetActiveOutputBuffer().GetActiveBuffer();
+    if (pRenderer != nullptr && pActive == &_owner)
+    {
+        pRenderer->TriggerScroll(region, pcoordDelta);
+    }
+}
+
 void ScreenBufferRenderTarget::TriggerCircling()
 {
     auto* pRenderer = ServiceLocator::LocateGlobals().pRender;
@@ -109,3 +119,24 @@ void ScreenBufferRenderTarget::TriggerTitleChange()
         pRenderer->TriggerTitleChange();
     }
 }
+
+// A batch is begun and ended on the renderer whether we're active or not, so
+//      that it's always ended on the renderer it was begun on, even if the
+//      active buffer changes in the middle of it.
+void ScreenBufferRenderTarget::BeginBatch()
+{
+    auto* pRenderer = ServiceLocator::LocateGlobals().pRender;
+    if (pRenderer != nullptr)
+    {
+        pRenderer->BeginBatch();
+    }
+}
+
+void ScreenBufferRenderTarget::EndBatch()
+{
+    auto* pRenderer = ServiceLocator::LocateGlobals().pRender;
+    if (pRenderer != nullptr)
+    {
+        pRenderer->EndBatch();
+    }
+}
@@ -14,6 +14,7 @@
 #include "server.h"
 #include "output.h"
 #include "handle.h"
+#include "../renderer/base/InputLatency.hpp"
 
 using namespace Microsoft::Console;
 
@@ -27,10 +28,14 @@ VtInputThread::VtInputThread(_In_ wil::unique_hfile hPipe,
                              const bool inheritCursor) :
     _hFile{ std::move(hPipe) },
     _hThread{},
-    _utf8Parser{ CP_UTF8 },
     _dwThreadId{ 0 },
     _exitRequested{ false },
-    _exitResult{ S_OK }
+    _exitResult{ S_OK },
+    _chunk(s_BufferSize),
+    _readBuffer(s_BufferSize),
+    _isOverlapped{ false },
+    _readEvent{},
+    _overlapped{}
 {
     THROW_HR_IF(E_HANDLE, _hFile.get() == INVALID_HANDLE_VALUE);
 
@@ -48,8 +53,9 @@ VtInputThread::VtInputThread(_In_ wil::unique_hfile hPipe,
 
 // Method Description:
 // - Processes a buffer of input characters. The characters should be utf-8
-//      encoded, and will get converted to wchar_t's to be processed by the
-//      input state machine.
+//      encoded. The input state machine parses them as they are, and only
+//      widens the text between sequences. A character that's cut off at the
+//      end of the buffer is held on to until the next one.
 // Arguments:
 // - charBuffer - the UTF-8 characters recieved.
 // - cch - number of UTF-8 characters in charBuffer
@@ -63,21 +69,15 @@ HRESULT VtInputThread::_HandleRunInput(_In_reads_(cch) const byte* const charBuf
     //      gci's unlock, when you press C-c, it won't be dispatched until the
     //      next console API call. For something like `powershell sleep 60`,
     //      that won't happen for 60s
+    Render::InputLatency::InputArrived(Render::LatencyStage::VtInputReceived);
+
     LockConsole();
     auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
 
     try
     {
-        std::unique_ptr<wchar_t[]> pwsSequence;
-        unsigned int cchConsumed;
-        unsigned int cchSequence;
-        auto hr = _utf8Parser.Parse(charBuffer, cch, cchConsumed, pwsSequence, cchSequence);
-        // If we hit a parsing error, eat it. It's bad utf-8, we can't do anything with it.
-        if (FAILED(hr))
-        {
-            return S_FALSE;
-        }
-        _pInputStateMachine->ProcessString(pwsSequence.get(), cchSequence);
+        // Bad utf-8 comes out as U+FFFD.
+        _pInputStateMachine->ProcessUtf8String(reinterpret_cast<const char*>(charBuffer), gsl::narrow<size_t>(cch));
     }
     CATCH_RETURN();
 
@@ -99,6 +99,9 @@ DWORD WINAPI VtInputThread::StaticVtInputThreadProc(_In_ LPVOID lpParameter)
 // Method Description:
 // - Do a single ReadFile from our pipe, and try and handle it. If handling
 //      failed, throw or log, depending on what the caller wants.
+// - This always reads synchronously, and is what's used before the thread's
+//      started, when the console reads the response to its cursor position
+//      request.
 // Arguments:
 // - throwOnFail: If true, throw an exception if there was an error processing
 //      the input recieved. Otherwise, log the error.
@@ -106,9 +109,8 @@ DWORD WINAPI VtInputThread::StaticVtInputThreadProc(_In_ LPVOID lpParameter)
 // - <none>
 void VtInputThread::DoReadInput(const bool throwOnFail)
 {
-    byte buffer[256];
     DWORD dwRead = 0;
-    bool fSuccess = !!ReadFile(_hFile.get(), buffer, ARRAYSIZE(buffer), &dwRead, nullptr);
+    bool fSuccess = !!ReadFile(_hFile.get(), _chunk.data(), s_BufferSize, &dwRead, nullptr);
 
     // If we failed to read because the terminal broke our pipe (usually due
     //      to dying itself), close gracefully with ERROR_BROKEN_PIPE.
@@ -116,12 +118,25 @@ void VtInputThread::DoReadInput(const bool throwOnFail)
     //       we want to gracefully close in.
     if (!fSuccess)
     {
-        _exitRequested = true;
-        _exitResult = HRESULT_FROM_WIN32(GetLastError());
+        _ExitForReadError(GetLastError());
         return;
     }
 
-    HRESULT hr = _HandleRunInput(buffer, dwRead);
+    _HandleChunk(dwRead, throwOnFail);
+}
+
+// Method Description:
+// - Handles the chunk of input that was last read into _chunk. If handling
+//      it failed, throw or log, depending on what the caller wants.
+// Arguments:
+// - cb: how many bytes were read into _chunk.
+// - throwOnFail: If true, request the thread's exit if there was an error
+//      processing the input. Otherwise, log the error.
+// Return Value:
+// - <none>
+void VtInputThread::_HandleChunk(const DWORD cb, const bool throwOnFail)
+{
+    HRESULT hr = _HandleRunInput(_chunk.data(), gsl::narrow_cast<int>(cb));
     if (FAILED(hr))
     {
         if (throwOnFail)
@@ -136,6 +151,18 @@ void VtInputThread::DoReadInput(const bool throwOnFail)
     }
 }
 
+// Method Description:
+// - Requests the thread's exit because reading the pipe failed.
+// Arguments:
+// - error: the error the read failed with.
+// Return Value:
+// - <none>
+void VtInputThread::_ExitForReadError(const DWORD error) noexcept
+{
+    _exitRequested = true;
+    _exitResult = HRESULT_FROM_WIN32(error);
+}
+
 // Method Description:
 // - The ThreadProc for the VT Input Thread. Reads input from the pipe, and
 //      passes it to _HandleRunInput to be processed by the
@@ -145,22 +172,122 @@ void VtInputThread::DoReadInput(const bool throwOnFail)
 //      have caused us to exit.
 DWORD VtInputThread::_InputThread()
 {
-    while (!_exitRequested)
+    if (_isOverlapped)
+    {
+        _OverlappedReadLoop();
+    }
+    else
     {
-        DoReadInput(true);
+        while (!_exitRequested)
+        {
+            DoReadInput(true);
+        }
     }
     ServiceLocator::LocateGlobals().getConsoleInformation().GetVtIo()->CloseInput();
 
     return _exitResult;
 }
 
+// Method Description:
+// - Reads the pipe until we're asked to exit, always with the read for the
+//      next chunk already pending while the chunk before it is handled.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void VtInputThread::_OverlappedReadLoop()
+{
+    bool isReadPending = _StartOverlappedRead();
+    while (isReadPending && !_exitRequested)
+    {
+        DWORD cbRead = 0;
+        isReadPending = false;
+        if (!_FinishOverlappedRead(cbRead))
+        {
+            break;
+        }
+
+        // The chunk that just came in is handled from _chunk while the
+        //      next read fills in the other buffer.
+        _chunk.swap(_readBuffer);
+        isReadPending = _StartOverlappedRead();
+        _HandleChunk(cbRead, true);
+    }
+
+    // Handling the last chunk may have failed while the next read's still
+    //      pending. Its buffer is ours again only once it's cancelled.
+    if (isReadPending)
+    {
+        DWORD cbRead = 0;
+        CancelIoEx(_hFile.get(), &_overlapped);
+        GetOverlappedResult(_hFile.get(), &_overlapped, &cbRead, TRUE);
+    }
+}
+
+// Method Description:
+// - Starts an overlapped read of the pipe into _readBuffer.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if the read is pending (or already done), and has to be finished
+//      with _FinishOverlappedRead. false if it failed, in which case the
+//      thread's been asked to exit.
+bool VtInputThread::_StartOverlappedRead()
+{
+    _overlapped = {};
+    _overlapped.hEvent = _readEvent.get();
+    if (!ReadFile(_hFile.get(), _readBuffer.data(), s_BufferSize, nullptr, &_overlapped))
+    {
+        const DWORD error = GetLastError();
+        if (error != ERROR_IO_PENDING)
+        {
+            _ExitForReadError(error);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Method Description:
+// - Waits for the pending overlapped read to be done.
+// Arguments:
+// - cbRead: receives how many bytes were read into _readBuffer.
+// Return Value:
+// - true if the read succeeded. false if it failed, in which case the
+//      thread's been asked to exit.
+bool VtInputThread::_FinishOverlappedRead(_Out_ DWORD& cbRead)
+{
+    cbRead = 0;
+    if (!GetOverlappedResult(_hFile.get(), &_overlapped, &cbRead, TRUE))
+    {
+        _ExitForReadError(GetLastError());
+        return false;
+    }
+    return true;
+}
+
 // Method Description:
 // - Starts the VT input thread.
 [[nodiscard]]
 HRESULT VtInputThread::Start()
 {
     RETURN_HR_IF(E_HANDLE, !_hFile);
-    
+
+    // The pipe we're given is synchronous. If it can be reopened for
+    //      overlapped IO, the thread can have the next read pending while it
+    //      handles what it's read. If not, it just reads it synchronously.
+    wil::unique_hfile overlappedFile{ ReOpenFile(_hFile.get(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, FILE_FLAG_OVERLAPPED) };
+    if (overlappedFile)
+    {
+        wil::unique_event readEvent;
+        if (readEvent.try_create(wil::EventOptions::ManualReset, nullptr))
+        {
+            _hFile = std::move(overlappedFile);
+            _readEvent = std::move(readEvent);
+            _isOverlapped = true;
+        }
+    }
+
     HANDLE hThread = nullptr;
     // 0 is the right value, https://blogs.msdn.microsoft.com/oldnewthing/20040223-00/?p=40503
     DWORD dwThreadId = 0;
@@ -8,6 +8,9 @@ Module Name:
 Abstract:
 - Defines methods that wrap the thread that reads VT input from a pipe and
   feeds it into the console's input buffer.
+- The pipe is read in large chunks. If it can be reopened for overlapped IO,
+  the read for the next chunk is already pending while the last one is being
+  handled, so that a big paste doesn't wait on a round trip per chunk.
 
 Author(s):
 - Mike Griese (migrie) 15 Aug 2017
@@ -15,7 +18,6 @@ Author(s):
 #pragma once
 
 #include "..\terminal\parser\StateMachine.hpp"
-#include "utf8ToWideCharParser.hpp"
 
 namespace Microsoft::Console
 {
@@ -30,9 +32,16 @@ namespace Microsoft::Console
         void DoReadInput(const bool throwOnFail);
 
     private:
+        static constexpr DWORD s_BufferSize = 16 * 1024;
+
         [[nodiscard]]
         HRESULT _HandleRunInput(_In_reads_(cch) const byte* const charBuffer, const int cch);
+        void _HandleChunk(const DWORD cb, const bool throwOnFail);
         DWORD _InputThread();
+        void _OverlappedReadLoop();
+        bool _StartOverlappedRead();
+        bool _FinishOverlappedRead(_Out_ DWORD& cbRead);
+        void _ExitForReadError(const DWORD error) noexcept;
 
         wil::unique_hfile _hFile;
         wil::unique_handle _hThread;
@@ -42,6 +51,15 @@ namespace Microsoft::Console
         HRESULT _exitResult;
 
         std::unique_ptr<StateMachine> _pInputStateMachine;
-        Utf8ToWideCharParser _utf8Parser;
+
+        // The chunk that's being handled, and the one that the pending read,
+        //      if any, is filling in.
+        std::vector<byte> _chunk;
+        std::vector<byte> _readBuffer;
+
+        // Set up by Start, if the pipe could be reopened for overlapped IO.
+        bool _isOverlapped;
+        wil::unique_event _readEvent;
+        OVERLAPPED _overlapped;
     };
 }
@@ -23,6 +23,7 @@ VtIo::VtIo() :
     _initialized(false),
     _objectsCreated(false),
     _lookingForCursorPosition(false),
+    _passthrough(false),
     _IoMode(VtIoMode::INVALID)
 {
 }
@@ -77,6 +78,17 @@ HRESULT VtIo::Initialize(const ConsoleArguments * const pArgs)
     // If we were already given VT handles, set up the VT IO engine to use those.
     if (pArgs->InConptyMode())
     {
+        // Passing output through only works if the VT engine is the only one
+        //      drawing the buffer, so there has to be no window.
+        _passthrough = pArgs->GetPassthrough() && pArgs->IsHeadless();
+
+        // If the terminal handed us a shared ring for our output, prefer it to
+        //      the output pipe. If we can't open it, the pipe still works.
+        if (pArgs->HasOutputRingHandle())
+        {
+            LOG_IF_FAILED(SharedRing::s_Open(pArgs->GetOutputRingHandle(), _outputRing));
+        }
+
         return _Initialize(pArgs->GetVtInHandle(), pArgs->GetVtOutHandle(), pArgs->GetVtMode(), pArgs->GetSignalHandle());
     }
     // Didn't need to initialize if we didn't have VT stuff. It's still OK, but report we did nothing.
@@ -191,6 +203,10 @@ HRESULT VtIo::CreateIoHandlers() noexcept
             if (_pVtRenderEngine)
             {
                 _pVtRenderEngine->SetTerminalOwner(this);
+                if (_outputRing)
+                {
+                    _pVtRenderEngine->SetOutputRing(std::move(_outputRing));
+                }
             }
         }
     }
@@ -348,6 +364,437 @@ HRESULT VtIo::SetCursorPosition(const COORD coordCursor)
     return hr;
 }
 
+// Method Description:
+// - Writes output that the client wrote with VT processing on to the terminal
+//      as it is, and applies it to the buffer too, so that it's there for the
+//      clients that read the buffer back. Otherwise the VT engine would paint
+//      it all over again, often in a different order than it was written.
+// - This is only done if the terminal asked for it, and if the output only
+//      has sequences that the terminal does the same thing with that we do,
+//      and that we don't have to answer. Anything else is painted, and so is
+//      everything written with the console APIs.
+// - NOTE: The console lock must be held.
+// Arguments:
+// - screenInfo: The buffer the output is written to.
+// - str: The output.
+// Return Value:
+// - true if the output was passed through and applied to the buffer. If
+//      false, nothing was done with it and it has to be processed as usual.
+bool VtIo::PassThrough(SCREEN_INFORMATION& screenInfo, const std::wstring_view str)
+{
+    Globals& g = ServiceLocator::LocateGlobals();
+    if (!_passthrough ||
+        _IoMode != VtIoMode::XTERM_256 ||
+        !_pVtRenderEngine ||
+        g.pRender == nullptr ||
+        !screenInfo.IsActiveScreenBuffer() ||
+        screenInfo.AreMarginsSet() ||
+        !screenInfo.GetStateMachine().IsInGroundState() ||
+        !s_IsPassThroughSafe(str))
+    {
+        return false;
+    }
+
+    // Unless it's been turned off, a line feed returns the cursor too when we
+    //      do it, but not when the terminal does.
+    const CONSOLE_INFORMATION& gci = g.getConsoleInformation();
+    std::wstring translated;
+    std::wstring_view output = str;
+    if (gci.IsReturnOnNewlineAutomatic() && str.find(L'\n') != std::wstring_view::npos)
+    {
+        try
+        {
+            translated.reserve(str.size() + str.size() / 8);
+            for (const wchar_t wch : str)
+            {
+                if (wch == L'\n')
+                {
+                    translated.push_back(L'\r');
+                }
+                translated.push_back(wch);
+            }
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            return false;
+        }
+        output = translated;
+    }
+
+    if (!g.pRender->BeginPassThrough())
+    {
+        return false;
+    }
+    auto endPassThrough = wil::scope_exit([&]() {
+        g.pRender->EndPassThrough();
+    });
+
+    const TextAttribute attributes = screenInfo.GetAttributes();
+    const HRESULT hr = _pVtRenderEngine->BeginPassThrough(output,
+                                                          s_CursorInViewport(screenInfo),
+                                                          gci.LookupForegroundColor(attributes),
+                                                          gci.LookupBackgroundColor(attributes),
+                                                          attributes.GetLegacyAttributes(),
+                                                          attributes.IsBold());
+    LOG_IF_FAILED(hr);
+    if (hr != S_OK)
+    {
+        return false;
+    }
+
+    screenInfo.GetStateMachine().ProcessString(str.data(), str.size());
+
+    // Switching to the alternate buffer makes another one the active one.
+    endPassThrough.reset();
+    _pVtRenderEngine->EndPassThrough(s_CursorInViewport(screenInfo.GetActiveBuffer()));
+    return true;
+}
+
+// Method Description:
+// - Tells if the terminal does the same thing with the given output that we
+//      do, so that it can be passed through to it. That's printable text,
+//      carriage returns, line feeds, backspaces and tabs, and these sequences:
+//   * moving the cursor (CUU, CUD, CUF, CUB, CNL, CPL, CHA, CUP, HVP, VPA)
+//   * erasing (ED, EL, ECH), inserting and deleting (ICH, DCH, IL, DL),
+//      scrolling (SU, SD)
+//   * SGR, with only the attributes we keep and draw in the same way
+//   * showing and hiding the cursor, and the alternate buffer (DECSET and
+//      DECRST 25 and 1049)
+//   * setting the title (OSC 0 and 2)
+//   Anything else, like queries we answer, margins, or a sequence that isn't
+//      finished by the end of the output, has to be processed by us.
+// Arguments:
+// - str: The output.
+// Return Value:
+// - true if the output can be passed through.
+bool VtIo::s_IsPassThroughSafe(const std::wstring_view str) noexcept
+{
+    size_t i = 0;
+    while (i < str.size())
+    {
+        const wchar_t wch = str[i];
+        if (wch == L'\x1b')
+        {
+            const size_t length = s_PassThroughSequenceLength(str.substr(i));
+            if (length == 0)
+            {
+                return false;
+            }
+            i += length;
+        }
+        else if (wch == L'\r' || wch == L'\n' || wch == L'\b' || wch == L'\t' ||
+                 (wch >= L' ' && wch != L'\x7f' && (wch < L'\x80' || wch > L'\x9f')))
+        {
+            ++i;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Method Description:
+// - Gets the length of the sequence at the start of the given output, if it
+//      can be passed through. See s_IsPassThroughSafe.
+// Arguments:
+// - str: The output, starting with the ESC of the sequence.
+// Return Value:
+// - The length of the sequence, or 0 if it can't be passed through.
+size_t VtIo::s_PassThroughSequenceLength(const std::wstring_view str) noexcept
+{
+    if (str.size() < 2)
+    {
+        return 0;
+    }
+
+    if (str[1] == L'[')
+    {
+        size_t i = 2;
+        const bool isPrivate = i < str.size() && str[i] == L'?';
+        if (isPrivate)
+        {
+            ++i;
+        }
+
+        const size_t parametersStart = i;
+        while (i < str.size() && ((str[i] >= L'0' && str[i] <= L'9') || str[i] == L';'))
+        {
+            ++i;
+        }
+        if (i >= str.size())
+        {
+            return 0;
+        }
+
+        const std::wstring_view parameters = str.substr(parametersStart, i - parametersStart);
+        const wchar_t finalChar = str[i];
+        bool safe = false;
+        if (isPrivate)
+        {
+            safe = (finalChar == L'h' || finalChar == L'l') &&
+                   (parameters == L"25" || parameters == L"1049");
+        }
+        else if (finalChar == L'm')
+        {
+            safe = s_IsPassThroughGraphicsRendition(parameters);
+        }
+        else
+        {
+            safe = std::wstring_view{ L"ABCDEFGHJKLMPSTX@df" }.find(finalChar) != std::wstring_view::npos;
+        }
+        return safe ? i + 1 : 0;
+    }
+    else if (str[1] == L']')
+    {
+        if (str.size() < 4 || (str[2] != L'0' && str[2] != L'2') || str[3] != L';')
+        {
+            return 0;
+        }
+
+        for (size_t i = 4; i < str.size(); ++i)
+        {
+            if (str[i] == L'\x07')
+            {
+                return i + 1;
+            }
+            else if (str[i] == L'\x1b')
+            {
+                return (i + 1 < str.size() && str[i + 1] == L'\\') ? i + 2 : 0;
+            }
+            else if (str[i] < L' ')
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Method Description:
+// - Tells if the terminal ends up with the same attributes as we do for the
+//      given SGR parameters. Those are the ones we keep in the buffer and
+//      draw the same way: bold and underline, and the 16 colors, the 256
+//      colors and RGB colors, as well as the defaults.
+// Arguments:
+// - parameters: The parameters of the SGR, without the CSI or the 'm'.
+// Return Value:
+// - true if the SGR can be passed through.
+bool VtIo::s_IsPassThroughGraphicsRendition(const std::wstring_view parameters) noexcept
+{
+    // How many of the parameters that follow are part of a 38 or 48.
+    size_t colorParameters = 0;
+    bool expectingColorKind = false;
+
+    size_t start = 0;
+    while (start <= parameters.size())
+    {
+        size_t end = parameters.find(L';', start);
+        if (end == std::wstring_view::npos)
+        {
+            end = parameters.size();
+        }
+
+        // An empty parameter is a 0. Anything longer than 3 digits is out of
+        //      range anyways.
+        const std::wstring_view parameter = parameters.substr(start, end - start);
+        if (parameter.size() > 3)
+        {
+            return false;
+        }
+        unsigned int value = 0;
+        for (const wchar_t digit : parameter)
+        {
+            value = value * 10 + (digit - L'0');
+        }
+
+        if (expectingColorKind)
+        {
+            expectingColorKind = false;
+            if (value == 5)
+            {
+                colorParameters = 1;
+            }
+            else if (value == 2)
+            {
+                colorParameters = 3;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else if (colorParameters > 0)
+        {
+            if (parameter.empty() || value > 255)
+            {
+                return false;
+            }
+            --colorParameters;
+        }
+        else if (value == 38 || value == 48)
+        {
+            expectingColorKind = true;
+        }
+        else if (!(value == 0 || value == 1 || value == 4 || value == 22 || value == 24 ||
+                   (value >= 30 && value <= 37) || value == 39 ||
+                   (value >= 40 && value <= 47) || value == 49 ||
+                   (value >= 90 && value <= 97) || (value >= 100 && value <= 107)))
+        {
+            return false;
+        }
+
+        start = end + 1;
+    }
+
+    return !expectingColorKind && colorParameters == 0;
+}
+
+// Method Description:
+// - Gets where the cursor of the given buffer is, relative to its viewport.
+//      That's where the VT engine has it.
+// Arguments:
+// - screenInfo: The buffer.
+// Return Value:
+// - The position of the cursor in the viewport.
+COORD VtIo::s_CursorInViewport(const SCREEN_INFORMATION& screenInfo) noexcept
+{
+    COORD position = screenInfo.GetTextBuffer().GetCursor().GetPosition();
+    screenInfo.GetViewport().ConvertToOrigin(&position);
+    return position;
+}
+
+// Method Description:
+// - Sends everything again to a terminal that's reattaching to us, and has
+//      none of what we painted before: the last s_ReattachScrollbackRows rows
+//      above the viewport, for its scrollback, and then the whole viewport. The
+//      next frame does it all at once, so however big the buffer is, the
+//      terminal has its screen back as soon as that frame is painted.
+// - The viewport is painted like any other frame, which already only sends
+//      the attributes that change and squeezes runs of spaces and repeated
+//      characters. The scrollback rows are written the same way.
+// - NOTE: The console lock must be held.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK if the next frame will send everything again, S_FALSE if there's no
+//      terminal to send it to, or it isn't one that can be reattached (only
+//      the UTF-8 xterm modes are), else an appropriate HRESULT for failing
+//      to allocate.
+[[nodiscard]]
+HRESULT VtIo::Reattach() noexcept
+{
+    Globals& g = ServiceLocator::LocateGlobals();
+    if (!_pVtRenderEngine ||
+        (_IoMode != VtIoMode::XTERM_256 && _IoMode != VtIoMode::XTERM) ||
+        g.pRender == nullptr)
+    {
+        return S_FALSE;
+    }
+
+    try
+    {
+        const CONSOLE_INFORMATION& gci = g.getConsoleInformation();
+        const SCREEN_INFORMATION& screenInfo = gci.GetActiveOutputBuffer();
+        const auto& buffer = screenInfo.GetTextBuffer();
+        const size_t top = gsl::narrow_cast<size_t>(screenInfo.GetViewport().Top());
+        const size_t first = top - std::min(top, s_ReattachScrollbackRows);
+
+        std::vector<Render::VtEngine::ReattachRow> scrollback(top - first);
+        std::optional<ROW> scratch;
+        for (size_t y = first; y < top; y++)
+        {
+            s_GetReattachRow(buffer.GetRowByOffset(y, scratch), gci, scrollback.at(y - first));
+        }
+
+        _pVtRenderEngine->Reattach(std::move(scrollback));
+    }
+    CATCH_RETURN();
+
+    g.pRender->TriggerRedrawAll();
+    g.pRender->TriggerTitleChange();
+    return S_OK;
+}
+
+// Method Description:
+// - Gets a row ready to be written to a reattaching terminal: its text, the
+//      clusters in it, and the runs of attributes they're colored in, in the
+//      colors they're painted in. Cells at the end of a row that wasn't wrapped
+//      that look just like erased ones are left off, since the terminal fills
+//      the rest of the row in with those anyways.
+// Arguments:
+// - row: The row.
+// - gci: The console, to look up the attributes' colors with.
+// - reattachRow: Receives the row.
+// Return Value:
+// - <none>
+void VtIo::s_GetReattachRow(const ROW& row,
+                            const CONSOLE_INFORMATION& gci,
+                            Render::VtEngine::ReattachRow& reattachRow)
+{
+    const CharRow& charRow = row.GetCharRow();
+    const ATTR_ROW& attrRow = row.GetAttrRow();
+    reattachRow.wrapped = charRow.WasWrapForced();
+
+    const auto isErased = [&](const size_t column) {
+        const auto attr = attrRow.GetAttrByColumn(column);
+        return std::wstring_view{ charRow.GlyphAt(column) } == L"\x20" &&
+               gci.LookupBackgroundColor(attr) == gci.GetDefaultBackground() &&
+               WI_IsFlagClear(attr.GetLegacyAttributes(), COMMON_LVB_UNDERSCORE);
+    };
+
+    size_t end = charRow.size();
+    if (!reattachRow.wrapped)
+    {
+        while (end > 0 && isErased(end - 1))
+        {
+            end--;
+        }
+    }
+
+    for (size_t column = 0; column < end;)
+    {
+        size_t applies = 0;
+        const auto attr = attrRow.GetAttrByColumn(column, &applies);
+        const size_t runEnd = std::min(column + std::max<size_t>(applies, 1), end);
+
+        Render::VtEngine::ReattachRow::Run run{ 0,
+                                                gci.LookupForegroundColor(attr),
+                                                gci.LookupBackgroundColor(attr),
+                                                attr.GetLegacyAttributes(),
+                                                attr.IsBold() };
+        for (; column < runEnd; column++)
+        {
+            const auto& dbcsAttr = charRow.DbcsAttrAt(column);
+            if (!dbcsAttr.IsTrailing())
+            {
+                const std::wstring_view glyph = charRow.GlyphAt(column);
+                reattachRow.text.append(glyph);
+                reattachRow.clusters.emplace_back(glyph.size(), dbcsAttr.IsLeading() ? 2 : 1);
+                run.clusters++;
+            }
+        }
+
+        // Attributes that only differ in ways we don't paint make the same run.
+        auto& runs = reattachRow.runs;
+        if (!runs.empty() &&
+            runs.back().foreground == run.foreground &&
+            runs.back().background == run.background &&
+            runs.back().legacyColorAttribute == run.legacyColorAttribute &&
+            runs.back().isBold == run.isBold)
+        {
+            runs.back().clusters += run.clusters;
+        }
+        else if (run.clusters > 0)
+        {
+            runs.push_back(run);
+        }
+    }
+}
+
 void VtIo::CloseInput()
 {
     // This will release the lock when it goes out of scope
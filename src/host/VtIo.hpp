@@ -10,6 +10,9 @@
 #include "PtySignalInputThread.hpp"
 
 class ConsoleArguments;
+class SCREEN_INFORMATION;
+class CONSOLE_INFORMATION;
+class ROW;
 
 namespace Microsoft::Console::VirtualTerminal
 {
@@ -41,6 +44,12 @@ namespace Microsoft::Console::VirtualTerminal
         [[nodiscard]]
         HRESULT SetCursorPosition(const COORD coordCursor);
 
+        bool PassThrough(SCREEN_INFORMATION& screenInfo, const std::wstring_view str);
+        static bool s_IsPassThroughSafe(const std::wstring_view str) noexcept;
+
+        [[nodiscard]]
+        HRESULT Reattach() noexcept;
+
         void CloseInput() override;
         void CloseOutput() override;
 
@@ -50,12 +59,17 @@ namespace Microsoft::Console::VirtualTerminal
         wil::unique_hfile _hOutput;
         // After CreateAndStartSignalThread is called, this will be invalid.
         wil::unique_hfile _hSignal;
+        // After CreateIoHandlers is called, the render engine owns this.
+        std::unique_ptr<Microsoft::Console::Types::SharedRing> _outputRing;
         VtIoMode _IoMode;
 
         bool _initialized;
         bool _objectsCreated;
 
         bool _lookingForCursorPosition;
+        // Set if the terminal asked for the client's output to be passed
+        //      through to it when it can be. See PassThrough.
+        bool _passthrough;
         std::mutex _shutdownLock;
 
         std::unique_ptr<Microsoft::Console::Render::VtEngine> _pVtRenderEngine;
@@ -69,6 +83,17 @@ namespace Microsoft::Console::VirtualTerminal
 
         void _ShutdownIfNeeded();
 
+        static size_t s_PassThroughSequenceLength(const std::wstring_view str) noexcept;
+        static bool s_IsPassThroughGraphicsRendition(const std::wstring_view parameters) noexcept;
+        static COORD s_CursorInViewport(const SCREEN_INFORMATION& screenInfo) noexcept;
+
+        // How many of the rows above the viewport are sent to a terminal that
+        //      reattaches. See Reattach.
+        static constexpr size_t s_ReattachScrollbackRows = 1000;
+        static void s_GetReattachRow(const ROW& row,
+                                     const CONSOLE_INFORMATION& gci,
+                                     Microsoft::Console::Render::VtEngine::ReattachRow& reattachRow);
+
     #ifdef UNIT_TESTING
         friend class VtIoTests;
     #endif
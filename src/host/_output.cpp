@@ -13,7 +13,9 @@
 
 #include "../interactivity/inc/ServiceLocator.hpp"
 #include "../types/inc/Viewport.hpp"
+#include "../types/inc/GlyphWidth.hpp"
 #include "../types/inc/convert.hpp"
+#include "../types/inc/ScratchArena.hpp"
 #include "../types/inc/Utf16Parser.hpp"
 
 #include <algorithm>
@@ -166,7 +168,7 @@ HRESULT ApiRoutines::WriteConsoleOutputCharacterAImpl(IConsoleOutputObject& OutC
     try
     {
         // convert to wide chars so we can call the W version of this function
-        const auto wideChars = ConvertToW(codepage, chars);
+        const auto wideChars = ConvertToW(codepage, chars, &ScratchArena::ForThisThread());
 
         size_t wideCharsWritten = 0;
         RETURN_IF_FAILED(WriteConsoleOutputCharacterWImpl(OutContext, wideChars, target, wideCharsWritten));
@@ -241,10 +243,8 @@ HRESULT ApiRoutines::FillConsoleOutputAttributeImpl(IConsoleOutputObject& OutCon
 
         }
 
-        const OutputCellIterator it(useThisAttr, lengthToWrite);
-        const auto done = screenBuffer.Write(it, startingCoordinate);
-
-        cellsModified = done.GetCellDistance(it);
+        // One color over a linear run of cells is filled a row at a time, without a view of every cell.
+        cellsModified = screenBuffer.GetTextBuffer().FillAttributes(useThisAttr, startingCoordinate, lengthToWrite);
 
         // Notify accessibility
         auto endingCoordinate = startingCoordinate;
@@ -294,9 +294,18 @@ HRESULT ApiRoutines::FillConsoleOutputCharacterWImpl(IConsoleOutputObject& OutCo
 
     try
     {
-        const OutputCellIterator it(character, lengthToWrite);
-        const auto done = screenInfo.Write(it, startingCoordinate);
-        cellsModified = done.GetInputDistance(it);
+        // Narrow characters are filled a row at a time. Wide ones take up two cells each and have to be
+        // split over the ends of the rows, so they still go through the cell iterator.
+        if (!IsGlyphFullWidth(character))
+        {
+            cellsModified = screenInfo.GetTextBuffer().FillCharacters(character, startingCoordinate, lengthToWrite);
+        }
+        else
+        {
+            const OutputCellIterator it(character, lengthToWrite);
+            const auto done = screenInfo.Write(it, startingCoordinate);
+            cellsModified = done.GetInputDistance(it);
+        }
 
         // Notify accessibility
         auto endingCoordinate = startingCoordinate;
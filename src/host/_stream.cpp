@@ -19,6 +19,8 @@
 #include "../types/inc/convert.hpp"
 #include "../types/inc/GlyphWidth.hpp"
 #include "../types/inc/Viewport.hpp"
+#include "../renderer/base/InputLatency.hpp"
+#include "../renderer/base/PipelineActivity.hpp"
 
 #include "..\interactivity\inc\ServiceLocator.hpp"
 
@@ -28,6 +30,26 @@ using namespace Microsoft::Console::Types;
 // Used by WriteCharsLegacy.
 #define IS_GLYPH_CHAR(wch)   (((wch) < L' ') || ((wch) == 0x007F))
 
+// Routine Description:
+// - Counts how many characters at the start of the string are plain text, which
+//   is never a control character and always takes exactly one cell, whatever the
+//   output mode. Both the characters and what they were translated from have to
+//   be narrow text (see TextBuffer::IsNarrowText), so they can be written with
+//   TextBuffer::WriteNarrowLine.
+// Arguments:
+// - pwchString - The characters that would be written.
+// - pwchRealUnicode - The characters that they were translated from.
+// - cchMax - How many characters to look at, at most.
+// Return Value:
+// - The number of plain text characters.
+static size_t PlainTextRunLength(_In_reads_(cchMax) const wchar_t* const pwchString,
+                                 _In_reads_(cchMax) const wchar_t* const pwchRealUnicode,
+                                 const size_t cchMax) noexcept
+{
+    const size_t cch = TextBuffer::NarrowTextLength({ pwchString, cchMax });
+    return TextBuffer::NarrowTextLength({ pwchRealUnicode, cch });
+}
+
 // Routine Description:
 // - This routine updates the cursor position.  Its input is the non-special
 //   cased new location of the cursor.  For example, if the cursor were being
@@ -310,6 +332,8 @@ NTSTATUS WriteCharsLegacy(SCREEN_INFORMATION& screenInfo,
                           const DWORD dwFlags,
                           _Inout_opt_ PSHORT const psScrollY)
 {
+    Microsoft::Console::Render::PipelineActivity activity{ Microsoft::Console::Render::PipelineStage::BufferWrite, *pcb / sizeof(wchar_t) };
+
     const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
     TextBuffer& textBuffer = screenInfo.GetTextBuffer();
     Cursor& cursor = textBuffer.GetCursor();
@@ -320,6 +344,10 @@ NTSTATUS WriteCharsLegacy(SCREEN_INFORMATION& screenInfo,
     size_t TempNumSpaces = 0;
     const bool fUnprocessed = WI_IsFlagClear(screenInfo.OutputMode, ENABLE_PROCESSED_OUTPUT);
 
+    // Every character we write redraws its cell and the cursor. Hand the renderer
+    // all of the redraws at once, when we're done, instead of one at a time.
+    Microsoft::Console::Render::RenderTargetBatch renderBatch{ screenInfo.GetRenderTarget() };
+
     // Must not adjust cursor here. It has to stay on for many write scenarios. Consumers should call for the
     // cursor to be turned off if they want that.
 
@@ -401,6 +429,32 @@ NTSTATUS WriteCharsLegacy(SCREEN_INFORMATION& screenInfo,
         XPosition = cursor.GetPosition().X;
         size_t i = 0;
         wchar_t* LocalBufPtr = LocalBuffer;
+        const wchar_t* pwchText = LocalBuffer;
+        bool fPlainText = false;
+
+        // Plain text doesn't need any of the work below, and isn't limited to
+        // the size of LocalBuffer either: the rest of the row that it fills
+        // is written straight from the string, all at once.
+        if (XPosition < coordScreenBufferSize.X)
+        {
+            const size_t cchPlain = PlainTextRunLength(lpString,
+                                                       pwchRealUnicode,
+                                                       std::min((BufferSize - *pcb) / sizeof(wchar_t),
+                                                                gsl::narrow_cast<size_t>(coordScreenBufferSize.X - XPosition)));
+            if (cchPlain != 0)
+            {
+                pwchText = lpString;
+                fPlainText = true;
+                i = cchPlain;
+                XPosition += gsl::narrow_cast<SHORT>(cchPlain);
+                lpString += cchPlain;
+                pwchRealUnicode += cchPlain;
+                pwchBuffer += cchPlain;
+                *pcb += cchPlain * sizeof(wchar_t);
+                goto EndWhile;
+            }
+        }
+
         while (*pcb < BufferSize && i < LOCAL_BUFFER_SIZE && XPosition < coordScreenBufferSize.X)
         {
 #pragma prefast(suppress:26019, "Buffer is taken in multiples of 2. Validation is ok.")
@@ -558,8 +612,19 @@ NTSTATUS WriteCharsLegacy(SCREEN_INFORMATION& screenInfo,
             }
 
             // line was wrapped if we're writing up to the end of the current row
-            OutputCellIterator it(std::wstring_view(LocalBuffer, i), Attributes);
-            const auto itEnd = screenInfo.Write(it);
+            // Plain text is copied straight into the row, the rest is written a cell at a time.
+            const std::wstring_view text(pwchText, i);
+            size_t cellsWritten = 0;
+            if (fPlainText)
+            {
+                cellsWritten = screenInfo.GetTextBuffer().WriteNarrowLine(text, Attributes, CursorPosition, true);
+            }
+            else
+            {
+                OutputCellIterator it(text, Attributes);
+                const auto itEnd = screenInfo.Write(it);
+                cellsWritten = gsl::narrow_cast<size_t>(itEnd.GetCellDistance(it));
+            }
 
             // Notify accessibility
             screenInfo.NotifyAccessibilityEventing(CursorPosition.X, CursorPosition.Y,
@@ -567,7 +632,7 @@ NTSTATUS WriteCharsLegacy(SCREEN_INFORMATION& screenInfo,
 
             // The number of "spaces" or "cells" we have consumed needs to be reported and stored for later
             // when/if we need to erase the command line.
-            TempNumSpaces += itEnd.GetCellDistance(it);
+            TempNumSpaces += cellsWritten;
             CursorPosition.X = XPosition;
 
             // enforce a delayed newline if we're about to pass the end and the WC_DELAY_EOL_WRAP flag is set.
@@ -981,7 +1046,15 @@ NTSTATUS WriteChars(SCREEN_INFORMATION& screenInfo,
                 StateMachine& machine = screenInfo.GetStateMachine();
                 size_t const cch = BufferSize / sizeof(WCHAR);
 
-                machine.ProcessString(pwchRealUnicode, cch);
+                // If the terminal can take this as it is, it's handed straight
+                //      to it, and only applied to the buffer here.
+                CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+                if (!gci.IsInVtIoMode() ||
+                    !gci.GetVtIo()->PassThrough(screenInfo, { pwchRealUnicode, cch }))
+                {
+                    Microsoft::Console::Render::PipelineActivity activity{ Microsoft::Console::Render::PipelineStage::Parse, cch };
+                    machine.ProcessString(pwchRealUnicode, cch);
+                }
                 *pcb += BufferSize;
             }
         }
@@ -995,10 +1068,30 @@ NTSTATUS WriteChars(SCREEN_INFORMATION& screenInfo,
     return Status;
 }
 
+// Routine Description:
+// - Lets go of the console lock for a moment, so that the threads waiting on
+//   it get their turn. If the lock is held more than once, by callers further
+//   up, letting go of it once wouldn't release it, so this does nothing.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+static void YieldConsoleLock()
+{
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    if (gci.IsConsoleLocked() && gci.GetCSRecursionCount() == 1)
+    {
+        UnlockConsole();
+        SwitchToThread();
+        LockConsole();
+    }
+}
+
 // Routine Description:
 // - Takes the given text and inserts it into the given screen buffer.
 // Note:
-// - Console lock must be held when calling this routine
+// - Console lock must be held when calling this routine. It's let go of in
+//   between slices of a long string, see YieldConsoleLock.
 // - String has been translated to unicode at this point.
 // Arguments:
 // - pwchBuffer - wide character text to be inserted into buffer
@@ -1034,16 +1127,75 @@ NTSTATUS DoWriteConsole(_In_reads_bytes_(*pcbBuffer) PWCHAR pwchBuffer,
         return CONSOLE_STATUS_WAIT;
     }
 
+    Microsoft::Console::Render::InputLatency::OutputArrived(Microsoft::Console::Render::LatencyStage::OutputWritten);
+    Microsoft::Console::Render::PipelineActivity activity{ Microsoft::Console::Render::PipelineStage::Output, *pcbBuffer / sizeof(wchar_t) };
+
+    // A lot of text at once is written a slice at a time, letting go of the
+    // lock in between, so that input, rendering and the rest don't have to
+    // wait on all of it. The server doesn't take another call until this one
+    // is done, so nothing else is written in between the slices. Each slice
+    // is still written as a part of the whole buffer, so that backspacing
+    // over what came before it works out the same.
     const auto& textBuffer = screenInfo.GetTextBuffer();
-    return WriteChars(screenInfo,
-                      pwchBuffer,
-                      pwchBuffer,
-                      pwchBuffer,
-                      pcbBuffer,
-                      nullptr,
-                      textBuffer.GetCursor().GetPosition().X,
-                      WC_LIMIT_BACKSPACE,
-                      nullptr);
+    const SHORT sOriginalXPosition = textBuffer.GetCursor().GetPosition().X;
+    const size_t cchBuffer = *pcbBuffer / sizeof(wchar_t);
+    size_t cchWritten = 0;
+    NTSTATUS Status = STATUS_SUCCESS;
+    do
+    {
+        size_t cchSlice = std::min(cchBuffer - cchWritten, static_cast<size_t>(WRITE_SLICE_SIZE));
+        if (cchWritten + cchSlice < cchBuffer && IS_HIGH_SURROGATE(pwchBuffer[cchWritten + cchSlice - 1]))
+        {
+            // Don't split a surrogate pair between two slices.
+            cchSlice--;
+        }
+
+        const size_t cbSliceRequested = cchSlice * sizeof(wchar_t);
+        size_t cbSlice = cbSliceRequested;
+        Status = WriteChars(screenInfo,
+                            pwchBuffer,
+                            pwchBuffer + cchWritten,
+                            pwchBuffer + cchWritten,
+                            &cbSlice,
+                            nullptr,
+                            sOriginalXPosition,
+                            WC_LIMIT_BACKSPACE,
+                            nullptr);
+        cchWritten += cbSlice / sizeof(wchar_t);
+        if (!NT_SUCCESS(Status) || cbSlice < cbSliceRequested)
+        {
+            break;
+        }
+
+        if (cchWritten < cchBuffer)
+        {
+            YieldConsoleLock();
+
+            // If the output was blocked while we let go of the lock, wait to
+            // write the rest until it isn't anymore, like we would have if
+            // it had been blocked to begin with.
+            if (WI_IsAnyFlagSet(gci.Flags, (CONSOLE_SUSPENDED | CONSOLE_SELECTING | CONSOLE_SCROLLBAR_TRACKING)))
+            {
+                try
+                {
+                    waiter = std::make_unique<WriteData>(screenInfo,
+                                                         pwchBuffer,
+                                                         *pcbBuffer,
+                                                         gci.OutputCP);
+                    waiter->SetBytesWrittenBeforeWait(cchWritten * sizeof(wchar_t));
+                }
+                catch (...)
+                {
+                    return NTSTATUS_FROM_HRESULT(wil::ResultFromCaughtException());
+                }
+
+                return CONSOLE_STATUS_WAIT;
+            }
+        }
+    } while (cchWritten < cchBuffer);
+
+    *pcbBuffer = cchWritten * sizeof(wchar_t);
+    return Status;
 }
 
 // Routine Description:
@@ -1133,7 +1285,10 @@ HRESULT ApiRoutines::WriteConsoleAImpl(IConsoleOutputObject& context,
         const auto codepage = gci.OutputCP;
 
         // Convert our input parameters to Unicode
-        std::unique_ptr<wchar_t[]> wideCharBuffer{ nullptr };
+        // The converted text is written from directly, so it has to live on
+        // this call's stack: the lock may be let go of between slices of the
+        // write, and another write could come through the static parser then.
+        std::wstring wideChars;
         static Utf8ToWideCharParser parser{ gci.OutputCP };
 
         // update current codepage in case it was changed from last time
@@ -1146,19 +1301,16 @@ HRESULT ApiRoutines::WriteConsoleAImpl(IConsoleOutputObject& context,
         size_t cchBuffer;
         if (codepage == CP_UTF8)
         {
-            wideCharBuffer.release();
             unsigned int charCount;
             unsigned int charsConsumed;
-            unsigned int charsGenerated;
             RETURN_IF_FAILED(SizeTToUInt(buffer.size(), &charCount));
             RETURN_IF_FAILED(parser.Parse(reinterpret_cast<const byte*>(buffer.data()),
                                           charCount,
                                           charsConsumed,
-                                          wideCharBuffer,
-                                          charsGenerated));
+                                          wideChars));
 
-            pwchBuffer = reinterpret_cast<wchar_t*>(wideCharBuffer.get());
-            cchBuffer = charsGenerated;
+            pwchBuffer = wideChars.empty() ? nullptr : wideChars.data();
+            cchBuffer = wideChars.size();
             read = charsConsumed;
         }
         else
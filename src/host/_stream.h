@@ -43,6 +43,10 @@ NTSTATUS AdjustCursorPosition(SCREEN_INFORMATION& screenInfo,
 
 #define LOCAL_BUFFER_SIZE 100
 
+// The most characters DoWriteConsole writes at once without giving the other
+// threads that need the console lock a turn at it.
+#define WRITE_SLICE_SIZE 0x4000
+
 
 /*++
 Routine Description:
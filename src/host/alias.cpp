@@ -22,32 +22,110 @@
 
 #pragma hdrstop
 
-struct case_insensitive_hash
+// The aliases of every exe live in one table, keyed by both names. The keys are
+// views of the names each entry owns, and they're hashed and compared without
+// regard to case, so that looking an alias up doesn't need a string of its own.
+struct AliasKey
 {
-    std::size_t operator()(const std::wstring& key) const
+    std::wstring_view exe;
+    std::wstring_view source;
+};
+
+static bool NamesEqual(const std::wstring_view a, const std::wstring_view b) noexcept
+{
+    return std::equal(a.cbegin(), a.cend(), b.cbegin(), b.cend(), [](wchar_t x, wchar_t y) noexcept {
+        return ::towlower(x) == ::towlower(y);
+    });
+}
+
+struct AliasKeyHash
+{
+    size_t operator()(const AliasKey& key) const noexcept
     {
-        std::wstring lower(key);
-        std::transform(lower.begin(), lower.end(), lower.begin(), ::towlower);
-        std::hash<std::wstring> hash;
-        return hash(lower);
+        // FNV-1a, over the lower case folding of both names with a null between them.
+        uint64_t hash = 14695981039346656037ull;
+        for (const auto name : { key.exe, key.source })
+        {
+            for (const auto wch : name)
+            {
+                hash ^= ::towlower(wch);
+                hash *= 1099511628211ull;
+            }
+            hash *= 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
     }
 };
 
-struct case_insensitive_equality
+struct AliasKeyEqual
 {
-    bool operator()(const std::wstring& lhs, const std::wstring& rhs) const
+    bool operator()(const AliasKey& lhs, const AliasKey& rhs) const noexcept
     {
-        return 0 == _wcsicmp(lhs.data(), rhs.data());
+        return NamesEqual(lhs.exe, rhs.exe) && NamesEqual(lhs.source, rhs.source);
     }
 };
 
-std::unordered_map<std::wstring,
-    std::unordered_map<std::wstring,
-    std::wstring,
-    case_insensitive_hash,
-    case_insensitive_equality>,
-    case_insensitive_hash,
-    case_insensitive_equality> g_aliasData;
+struct AliasEntry
+{
+    std::wstring exe;
+    std::wstring source;
+    std::wstring target;
+    Alias::Expansion expansion;
+};
+
+std::unordered_map<AliasKey, AliasEntry, AliasKeyHash, AliasKeyEqual> g_aliasData;
+
+// Every exe that has ever had an alias, for listing them. An exe stays on here
+// after its aliases are removed, as it always has.
+std::vector<std::wstring> g_aliasExes;
+
+// Routine Description:
+// - Defines an alias for the given exe, or replaces its target if it already has one.
+// Arguments:
+// - exeName - The client EXE application that the alias applies to
+// - source - The shorthand/alias
+// - target - The expansion. Must not be empty.
+void Alias::s_SetAlias(const std::wstring_view exeName,
+                       const std::wstring_view source,
+                       const std::wstring_view target)
+{
+    auto expansion = s_CompileExpansion(target);
+
+    const auto found = g_aliasData.find(AliasKey{ exeName, source });
+    if (found != g_aliasData.end())
+    {
+        found->second.target = target;
+        found->second.expansion = std::move(expansion);
+        return;
+    }
+
+    if (std::none_of(g_aliasExes.cbegin(), g_aliasExes.cend(), [&](const auto& exe) { return NamesEqual(exe, exeName); }))
+    {
+        g_aliasExes.emplace_back(exeName);
+    }
+
+    // Nodes don't move around in the table, so once the entry is in, the key
+    // can be pointed at the entry's own names rather than at the caller's.
+    const auto inserted = g_aliasData.emplace(AliasKey{ exeName, source },
+                                              AliasEntry{ std::wstring{ exeName },
+                                                          std::wstring{ source },
+                                                          std::wstring{ target },
+                                                          std::move(expansion) }).first;
+    auto node = g_aliasData.extract(inserted);
+    node.key() = AliasKey{ node.mapped().exe, node.mapped().source };
+    g_aliasData.insert(std::move(node));
+}
+
+// Routine Description:
+// - Removes an alias of the given exe, if it has one.
+// Arguments:
+// - exeName - The client EXE application that the alias applies to
+// - source - The shorthand/alias
+void Alias::s_RemoveAlias(const std::wstring_view exeName,
+                          const std::wstring_view source)
+{
+    g_aliasData.erase(AliasKey{ exeName, source });
+}
 
 // Routine Description:
 // - Adds a command line alias to the global set.
@@ -99,24 +177,17 @@ HRESULT ApiRoutines::AddConsoleAliasWImpl(const std::wstring_view source,
     {
         std::wstring exeNameString(exeName);
         std::wstring sourceString(source);
-        std::wstring targetString(target);
 
         std::transform(exeNameString.begin(), exeNameString.end(), exeNameString.begin(), towlower);
         std::transform(sourceString.begin(), sourceString.end(), sourceString.begin(), towlower);
 
-        if (targetString.size() == 0)
+        if (target.size() == 0)
         {
-            // Only try to dig in and erase if the exeName exists.
-            auto exeData = g_aliasData.find(exeNameString);
-            if (exeData != g_aliasData.end())
-            {
-                g_aliasData[exeNameString].erase(sourceString);
-            }
+            Alias::s_RemoveAlias(exeNameString, sourceString);
         }
         else
         {
-            // Map will auto-create each level as necessary
-            g_aliasData[exeNameString][sourceString] = targetString;
+            Alias::s_SetAlias(exeNameString, sourceString, target);
         }
     }
     CATCH_RETURN();
@@ -152,17 +223,10 @@ HRESULT GetConsoleAliasWImplHelper(const std::wstring_view source,
         target.value().at(0) = UNICODE_NULL;
     }
 
-    std::wstring exeNameString(exeName);
-    std::wstring sourceString(source);
-
     // For compatibility, return ERROR_GEN_FAILURE for any result where the alias can't be found.
-    // We use .find for the iterators then dereference to search without creating entries.
-    const auto exeIter = g_aliasData.find(exeNameString);
-    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), exeIter == g_aliasData.end());
-    const auto exeData = exeIter->second;
-    const auto sourceIter = exeData.find(sourceString);
-    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), sourceIter == exeData.end());
-    const auto targetString = sourceIter->second;
+    const auto found = g_aliasData.find(AliasKey{ exeName, source });
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), found == g_aliasData.end());
+    const auto& targetString = found->second.target;
     RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), targetString.size() == 0);
 
     // TargetLength is a byte count, convert to characters.
@@ -321,8 +385,6 @@ HRESULT GetConsoleAliasesLengthWImplHelper(const std::wstring_view exeName,
     
     try
     {
-        const std::wstring exeNameString(exeName);
-
         size_t cchNeeded = 0;
 
         // Each of the aliases will be made up of the source, a seperator, the target, then a null character.
@@ -335,22 +397,19 @@ HRESULT GetConsoleAliasesLengthWImplHelper(const std::wstring_view exeName,
             cchSeperator = GetALengthFromW(codepage, aliasesSeparator);
         }
 
-        // Find without creating.
-        auto exeIter = g_aliasData.find(exeNameString);
-        if (exeIter != g_aliasData.end())
+        for (const auto& pair : g_aliasData)
         {
-            auto list = exeIter->second;
-            for (auto& pair : list)
+            const auto& alias = pair.second;
+            if (NamesEqual(alias.exe, exeName))
             {
-                // Alias stores lengths in bytes.
-                size_t cchSource = pair.first.size();
-                size_t cchTarget = pair.second.size();
+                size_t cchSource = alias.source.size();
+                size_t cchTarget = alias.target.size();
 
                 // If we're counting how much multibyte space will be needed, trial convert the source and target strings before we add.
                 if (!countInUnicode)
                 {
-                    cchSource = GetALengthFromW(codepage, pair.first);
-                    cchTarget = GetALengthFromW(codepage, pair.second);
+                    cchSource = GetALengthFromW(codepage, alias.source);
+                    cchTarget = GetALengthFromW(codepage, alias.target);
                 }
 
                 // Accumulate all sizes to the final string count.
@@ -425,11 +484,16 @@ HRESULT ApiRoutines::GetConsoleAliasesLengthWImpl(const std::wstring_view exeNam
 // - Clears all aliases on CMD.exe.
 void Alias::s_ClearCmdExeAliases()
 {
-    // find without creating.
-    auto exeIter = g_aliasData.find(L"cmd.exe");
-    if (exeIter != g_aliasData.end())
+    for (auto it = g_aliasData.begin(); it != g_aliasData.end();)
     {
-        exeIter->second.clear();
+        if (NamesEqual(it->second.exe, L"cmd.exe"))
+        {
+            it = g_aliasData.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
     }
 }
 
@@ -460,8 +524,6 @@ HRESULT GetConsoleAliasesWImplHelper(const std::wstring_view exeName,
         aliasBuffer.value().at(0) = UNICODE_NULL;
     }
 
-    std::wstring exeNameString(exeName);
-
     LPWSTR AliasesBufferPtrW = aliasBuffer.has_value() ? aliasBuffer.value().data() : nullptr;
     size_t cchTotalLength = 0; // accumulate the characters we need/have copied as we walk the list
 
@@ -469,16 +531,13 @@ HRESULT GetConsoleAliasesWImplHelper(const std::wstring_view exeName,
     // They are of the form "Source=Target" when returned.
     size_t const cchNull = 1;
 
-    // Find without creating.
-    auto exeIter = g_aliasData.find(exeNameString);
-    if (exeIter != g_aliasData.end())
+    for (const auto& pair : g_aliasData)
     {
-        auto list = exeIter->second;
-        for (auto& pair : list)
+        const auto& alias = pair.second;
+        if (NamesEqual(alias.exe, exeName))
         {
-            // Alias stores lengths in bytes.
-            size_t const cchSource = pair.first.size();
-            size_t const cchTarget = pair.second.size();
+            size_t const cchSource = alias.source.size();
+            size_t const cchTarget = alias.target.size();
 
             // Add up how many characters we will need for the full alias data.
             size_t cchNeeded = 0;
@@ -500,7 +559,7 @@ HRESULT GetConsoleAliasesWImplHelper(const std::wstring_view exeName,
                 size_t cchAliasBufferRemaining;
                 RETURN_IF_FAILED(SizeTSub(aliasBuffer.value().size(), cchTotalLength, &cchAliasBufferRemaining));
 
-                RETURN_IF_FAILED(StringCchCopyNW(AliasesBufferPtrW, cchAliasBufferRemaining, pair.first.data(), cchSource));
+                RETURN_IF_FAILED(StringCchCopyNW(AliasesBufferPtrW, cchAliasBufferRemaining, alias.source.data(), cchSource));
                 RETURN_IF_FAILED(SizeTSub(cchAliasBufferRemaining, cchSource, &cchAliasBufferRemaining));
                 AliasesBufferPtrW += cchSource;
 
@@ -508,7 +567,7 @@ HRESULT GetConsoleAliasesWImplHelper(const std::wstring_view exeName,
                 RETURN_IF_FAILED(SizeTSub(cchAliasBufferRemaining, aliasesSeparator.size(), &cchAliasBufferRemaining));
                 AliasesBufferPtrW += aliasesSeparator.size();
 
-                RETURN_IF_FAILED(StringCchCopyNW(AliasesBufferPtrW, cchAliasBufferRemaining, pair.second.data(), cchTarget));
+                RETURN_IF_FAILED(StringCchCopyNW(AliasesBufferPtrW, cchAliasBufferRemaining, alias.target.data(), cchTarget));
                 RETURN_IF_FAILED(SizeTSub(cchAliasBufferRemaining, cchTarget, &cchAliasBufferRemaining));
                 AliasesBufferPtrW += cchTarget;
 
@@ -637,14 +696,14 @@ HRESULT GetConsoleAliasExesLengthImplHelper(const bool countInUnicode, const UIN
     // Each alias exe will be made up of the string payload and a null terminator.
     size_t const cchNull = 1;
 
-    for (auto& pair : g_aliasData)
+    for (const auto& exe : g_aliasExes)
     {
-        size_t cchExe = pair.first.size();
+        size_t cchExe = exe.size();
 
         // If we're counting how much multibyte space will be needed, trial convert the exe string before we add.
         if (!countInUnicode)
         {
-            cchExe = GetALengthFromW(codepage, pair.first);
+            cchExe = GetALengthFromW(codepage, exe);
         }
 
         // Accumulate to total
@@ -718,10 +777,10 @@ HRESULT GetConsoleAliasExesWImplHelper(std::optional<gsl::span<wchar_t>> aliasEx
 
     size_t const cchNull = 1;
 
-    for (auto& pair : g_aliasData)
+    for (const auto& exe : g_aliasExes)
     {
-        // AliasList stores length in bytes. Add 1 for null terminator.
-        size_t const cchExe = pair.first.size();
+        // Add 1 for null terminator.
+        size_t const cchExe = exe.size();
 
         size_t cchNeeded;
         RETURN_IF_FAILED(SizeTAdd(cchExe, cchNull, &cchNeeded));
@@ -739,7 +798,7 @@ HRESULT GetConsoleAliasExesWImplHelper(std::optional<gsl::span<wchar_t>> aliasEx
             size_t cchRemaining;
             RETURN_IF_FAILED(SizeTSub(aliasExesBuffer.value().size(), cchTotalLength, &cchRemaining));
 
-            RETURN_IF_FAILED(StringCchCopyNW(AliasExesBufferPtrW, cchRemaining, pair.first.data(), cchExe));
+            RETURN_IF_FAILED(StringCchCopyNW(AliasExesBufferPtrW, cchRemaining, exe.data(), cchExe));
             AliasExesBufferPtrW += cchNeeded;
         }
 
@@ -840,55 +899,55 @@ HRESULT ApiRoutines::GetConsoleAliasExesWImpl(gsl::span<wchar_t> aliasExes,
 // - Trims leading spaces off of a string
 // Arguments:
 // - str - String to trim
-void Alias::s_TrimLeadingSpaces(std::wstring& str)
+void Alias::s_TrimLeadingSpaces(std::wstring_view& str) noexcept
 {
-    // Erase from the beginning of the string up until the first
+    // Drop from the beginning of the string up until the first
     // character found that is not a space.
-    str.erase(str.begin(),
-              std::find_if(str.begin(), str.end(), [](wchar_t ch) { return !std::iswspace(ch); }));
+    const auto firstNonSpace = std::find_if(str.cbegin(), str.cend(), [](wchar_t ch) { return !std::iswspace(ch); });
+    str.remove_prefix(firstNonSpace - str.cbegin());
 }
 
 // Routine Description:
 // - Trims trailing \r\n off of a string
 // Arguments:
 // - str - String to trim
-void Alias::s_TrimTrailingCrLf(std::wstring& str)
+void Alias::s_TrimTrailingCrLf(std::wstring_view& str) noexcept
 {
     const auto trailingCrLfPos = str.find_last_of(UNICODE_CARRIAGERETURN);
-    if (std::wstring::npos != trailingCrLfPos)
+    if (std::wstring_view::npos != trailingCrLfPos)
     {
-        str.erase(trailingCrLfPos);
+        str = str.substr(0, trailingCrLfPos);
     }
 }
 
 // Routine Description:
-// - Tokenizes a string into a collection using space as a separator
+// - Tokenizes a string using space as a separator. Only the tokens the
+//   macros can refer to are kept. The rest are left out.
 // Arguments:
 // - str - String to tokenize
+// - tokens - Receives the tokens, which are views of str. Any past the end are empty.
 // Return Value:
-// - Collection of tokenized strings
-std::deque<std::wstring> Alias::s_Tokenize(const std::wstring& str)
+// - The number of tokens found, up to the size of tokens.
+size_t Alias::s_Tokenize(const std::wstring_view str, Tokens& tokens) noexcept
 {
-    std::deque<std::wstring> result;
+    tokens.fill({});
 
+    size_t count = 0;
     size_t prevIndex = 0;
-    auto spaceIndex = str.find(L' ');
-    while (std::wstring::npos != spaceIndex)
+    while (count < tokens.size())
     {
-        const auto length = spaceIndex - prevIndex;
-
-        result.emplace_back(str.substr(prevIndex, length));
+        const auto spaceIndex = str.find(L' ', prevIndex);
+        tokens[count++] = str.substr(prevIndex, spaceIndex - prevIndex);
 
-        spaceIndex++;
-        prevIndex = spaceIndex;
-
-        spaceIndex = str.find(L' ', spaceIndex);
+        // The text after the last space is the final one.
+        if (std::wstring_view::npos == spaceIndex)
+        {
+            break;
+        }
+        prevIndex = spaceIndex + 1;
     }
 
-    // Place the final one into the set.
-    result.emplace_back(str.substr(prevIndex));
-
-    return result;
+    return count;
 }
 
 // Routine Description:
@@ -898,20 +957,19 @@ std::deque<std::wstring> Alias::s_Tokenize(const std::wstring& str)
 // - str - String to split into just args
 // Return Value:
 // - Only the arguments part of the string or empty if there are no arguments.
-std::wstring Alias::s_GetArgString(const std::wstring& str)
+std::wstring_view Alias::s_GetArgString(const std::wstring_view str) noexcept
 {
-    std::wstring result;
     auto firstSpace = str.find_first_of(L' ');
-    if (std::wstring::npos != firstSpace)
+    if (std::wstring_view::npos != firstSpace)
     {
         firstSpace++;
         if (firstSpace < str.size())
         {
-            result = str.substr(firstSpace);
+            return str.substr(firstSpace);
         }
     }
 
-    return result;
+    return {};
 }
 
 // Routine Description:
@@ -926,7 +984,7 @@ std::wstring Alias::s_GetArgString(const std::wstring& str)
 // - False if the given character doesn't match this macro.
 bool Alias::s_TryReplaceNumberedArgMacro(const wchar_t ch,
                                          std::wstring& appendToStr,
-                                         const std::deque<std::wstring>& tokens)
+                                         const Tokens& tokens)
 {
     if (ch >= L'1' && ch <= L'9')
     {
@@ -956,7 +1014,7 @@ bool Alias::s_TryReplaceNumberedArgMacro(const wchar_t ch,
 // - False if the given character doesn't match this macro.
 bool Alias::s_TryReplaceWildcardArgMacro(const wchar_t ch,
                                          std::wstring& appendToStr,
-                                         const std::wstring fullArgString)
+                                         const std::wstring_view fullArgString)
 {
     if (L'*' == ch)
     {
@@ -1068,83 +1126,80 @@ void Alias::s_AppendCrLf(std::wstring& appendToStr,
 }
 
 // Routine Description:
-// - Searches through the given string for macros and replaces them
-//   with the matching action
+// - Works out the macros in an alias's target, so that they don't have to be
+//   searched for again every time the alias is used. Only the arguments are
+//   left to put in.
 // Arguments:
-// - str - On input, the string to search. On output, the string is replaced.
-// - tokens - The tokenized command line input. 0 is the alias, 1-N are arguments.
-// - fullArgString - Shorthand to 1-N argument string in case of wildcard match.
+// - target - The target of the alias.
 // Return Value:
-// - The number of commands in the final string (line feeds, CRLFs)
-size_t Alias::s_ReplaceMacros(std::wstring& str,
-                              const std::deque<std::wstring>& tokens,
-                              const std::wstring& fullArgString)
+// - The target, ready to be expanded.
+Alias::Expansion Alias::s_CompileExpansion(const std::wstring_view target)
 {
-    size_t lineCount = 0;
-    std::wstring finalText;
+    Expansion expansion;
 
     // The target text may contain substitution macros indicated by $.
     // Walk through and substitute them as appropriate.
-    for (auto ch = str.cbegin(); ch < str.cend(); ch++)
+    for (auto ch = target.cbegin(); ch < target.cend(); ch++)
     {
-        if (L'$' == *ch)
+        // If it didn't match the macro specifier $, or there's no read-ahead,
+        // just push the character.
+        const auto chNext = ch + 1;
+        if (L'$' != *ch || chNext == target.cend())
         {
-            // Attempt to read ahead by one character.
-            const auto chNext = ch + 1;
-
-            if (chNext < str.cend())
-            {
-                auto isProcessed = s_TryReplaceNumberedArgMacro(*chNext, finalText, tokens);
-                if (!isProcessed)
-                {
-                    isProcessed = s_TryReplaceWildcardArgMacro(*chNext, finalText, fullArgString);
-                }
-                if (!isProcessed)
-                {
-                    isProcessed = s_TryReplaceInputRedirMacro(*chNext, finalText);
-                }
-                if (!isProcessed)
-                {
-                    isProcessed = s_TryReplaceOutputRedirMacro(*chNext, finalText);
-                }
-                if (!isProcessed)
-                {
-                    isProcessed = s_TryReplacePipeRedirMacro(*chNext, finalText);
-                }
-                if (!isProcessed)
-                {
-                    isProcessed = s_TryReplaceNextCommandMacro(*chNext, finalText, lineCount);
-                }
-                if (!isProcessed)
-                {
-                    // If nothing matches, just push these two characters in.
-                    finalText.push_back(*ch);
-                    finalText.push_back(*chNext);
-                }
+            expansion.text.push_back(*ch);
+            continue;
+        }
 
-                // Since we read ahead and used that character,
-                // advance the iterator one extra to compensate.
-                ch++;
-            }
-            else
-            {
-                // If no read-ahead, just push this character and be done.
-                finalText.push_back(*ch);
-            }
+        if ((*chNext >= L'1' && *chNext <= L'9') || L'*' == *chNext)
+        {
+            // The arguments aren't known until the alias is used.
+            expansion.arguments.emplace_back(expansion.text.size(), *chNext);
         }
-        else
+        else if (!s_TryReplaceInputRedirMacro(*chNext, expansion.text) &&
+                 !s_TryReplaceOutputRedirMacro(*chNext, expansion.text) &&
+                 !s_TryReplacePipeRedirMacro(*chNext, expansion.text) &&
+                 !s_TryReplaceNextCommandMacro(*chNext, expansion.text, expansion.lineCount))
         {
-            // If it didn't match the macro specifier $, push the character.
-            finalText.push_back(*ch);
+            // If nothing matches, just push these two characters in.
+            expansion.text.push_back(*ch);
+            expansion.text.push_back(*chNext);
         }
+
+        // Since we read ahead and used that character,
+        // advance the iterator one extra to compensate.
+        ch++;
     }
 
     // We always terminate with a CRLF to symbolize end of command.
-    s_AppendCrLf(finalText, lineCount);
+    s_AppendCrLf(expansion.text, expansion.lineCount);
 
-    // Give back the final text and count.
-    str.swap(finalText);
-    return lineCount;
+    return expansion;
+}
+
+// Routine Description:
+// - Puts the arguments of a command into an alias's target.
+// Arguments:
+// - expansion - The target of the alias.
+// - tokens - The tokenized command line input. 0 is the alias, 1-9 are arguments.
+// - fullArgString - Shorthand to 1-N argument string in case of wildcard match.
+// - appendToStr - Append the expanded text here.
+void Alias::s_Expand(const Expansion& expansion,
+                     const Tokens& tokens,
+                     const std::wstring_view fullArgString,
+                     std::wstring& appendToStr)
+{
+    size_t copied = 0;
+    for (const auto& [offset, macro] : expansion.arguments)
+    {
+        appendToStr.append(expansion.text, copied, offset - copied);
+        copied = offset;
+
+        if (!s_TryReplaceNumberedArgMacro(macro, appendToStr, tokens))
+        {
+            s_TryReplaceWildcardArgMacro(macro, appendToStr, fullArgString);
+        }
+    }
+    appendToStr.append(expansion.text, copied, std::wstring::npos);
 }
 
 // Routine Description:
@@ -1152,71 +1207,41 @@ size_t Alias::s_ReplaceMacros(std::wstring& str,
 // Arguments:
 // - sourceText - The string to search for an alias
 // - exeName - The name of the EXE that has aliases associated
+// - targetText - If we found a matching alias, receives the processed data.
+//                Otherwise it's left alone.
 // - lineCount - Number of lines worth of text processed.
 // Return Value:
-// - If we found a matching alias, this will be the processed data
-//   and lineCount is updated to the new number of lines.
-// - If we didn't match and process an alias, return an empty string.
-std::wstring Alias::s_MatchAndCopyAlias(const std::wstring& sourceText,
-                                        const std::wstring& exeName,
-                                        size_t& lineCount)
+// - True if we found a matching alias and lineCount was updated to the new number of lines.
+// - False if we didn't match and process an alias.
+bool Alias::s_MatchAndCopyAlias(std::wstring_view sourceText,
+                                const std::wstring_view exeName,
+                                std::wstring& targetText,
+                                size_t& lineCount)
 {
-    // Copy source text into a local for manipulation.
-    std::wstring sourceCopy(sourceText);
-
-    // Trim trailing \r\n off of sourceCopy if it has one.
-    s_TrimTrailingCrLf(sourceCopy);
+    // Trim trailing \r\n off of the source text if it has one.
+    s_TrimTrailingCrLf(sourceText);
 
-    // Trim leading spaces off of sourceCopy if it has any.
-    s_TrimLeadingSpaces(sourceCopy);
+    // Trim leading spaces off of the source text if it has any.
+    s_TrimLeadingSpaces(sourceText);
 
-    // Check if we have an EXE in the list that matches the request first.
-    auto exeIter = g_aliasData.find(exeName);
-    if (exeIter == g_aliasData.end())
-    {
-        // We found no data for this exe. Give back an empty string.
-        return std::wstring();
-    }
+    // Tokenize the text by spaces. The first token is the alias.
+    Tokens tokens;
+    s_Tokenize(sourceText, tokens);
 
-    auto exeList = exeIter->second;
-    if (exeList.size() == 0)
+    const auto found = g_aliasData.find(AliasKey{ exeName, tokens.front() });
+    if (found == g_aliasData.end() || found->second.target.empty())
     {
-        // If there's no match, give back an empty string.
-        return std::wstring();
+        // We found no alias pair with this name.
+        return false;
     }
 
-    // Tokenize the text by spaces
-    const auto tokens = s_Tokenize(sourceCopy);
+    // The final text will be the target but with the arguments put in.
+    const auto& expansion = found->second.expansion;
+    targetText.clear();
+    s_Expand(expansion, tokens, s_GetArgString(sourceText), targetText);
+    lineCount = expansion.lineCount;
 
-    // If there are no tokens, return an empty string
-    if (tokens.size() == 0)
-    {
-        return std::wstring();
-    }
-
-    // Find alias. If there isn't one, return an empty string
-    const auto alias = tokens.front();
-    const auto aliasIter = exeList.find(alias);
-    if (aliasIter == exeList.end())
-    {
-        // We found no alias pair with this name. Give back an empty string.
-        return std::wstring();
-    }
-
-    const auto target = aliasIter->second;
-    if (target.size() == 0)
-    {
-        return std::wstring();
-    }
-
-    // Get the string of all parameters as a shorthand for $* later.
-    const auto allParams = s_GetArgString(sourceCopy);
-
-    // The final text will be the target but with macros replaced.
-    std::wstring finalText(target);
-    lineCount = s_ReplaceMacros(finalText, tokens, allParams);
-
-    return finalText;
+    return true;
 }
 
 // Routine Description:
@@ -1242,13 +1267,16 @@ void Alias::s_MatchAndCopyAliasLegacy(_In_reads_bytes_(cbSource) PWCHAR pwchSour
 {
     try
     {
-        std::wstring sourceText(pwchSource, cbSource / sizeof(WCHAR));
-        size_t lineCount = lines;
+        // The source and target are usually the same buffer, so the text is
+        // expanded somewhere else first. That's kept from one line to the next
+        // (we're always under the console lock here), so that once it's grown
+        // to fit, matching an alias doesn't allocate.
+        static std::wstring targetText;
 
-        const auto targetText = s_MatchAndCopyAlias(sourceText, exeName, lineCount);
+        size_t lineCount = lines;
 
-        // Only return data if the reply was non-empty (we had a match).
-        if (!targetText.empty())
+        // Only return data if we had a match.
+        if (s_MatchAndCopyAlias({ pwchSource, cbSource / sizeof(WCHAR) }, exeName, targetText, lineCount))
         {
             const auto cchTargetSize = cbTargetSize / sizeof(wchar_t);
 
@@ -1277,12 +1305,13 @@ void Alias::s_TestAddAlias(std::wstring& exe,
                            std::wstring& alias,
                            std::wstring& target)
 {
-    g_aliasData[exe][alias] = target;
+    s_SetAlias(exe, alias, target);
 }
 
 void Alias::s_TestClearAliases()
 {
     g_aliasData.clear();
+    g_aliasExes.clear();
 }
 
 #endif
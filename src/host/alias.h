@@ -11,12 +11,33 @@ Abstract:
 --*/
 #pragma once
 
-
-
+#include <array>
 
 class Alias
 {
 public:
+    // The target of an alias, with its macros worked out when the alias is
+    // defined, so that using it only has to put the arguments in.
+    struct Expansion
+    {
+        // The target with every macro but the argument ones already replaced.
+        std::wstring text;
+        // Where in text the arguments go, and which ones they are ('1'-'9' or '*').
+        std::vector<std::pair<size_t, wchar_t>> arguments;
+        // One line for each $T, and one for the end.
+        size_t lineCount = 0;
+    };
+
+    // The alias and its first nine arguments. The macros can't reach any further.
+    using Tokens = std::array<std::wstring_view, 10>;
+
+    static void s_SetAlias(const std::wstring_view exeName,
+                           const std::wstring_view source,
+                           const std::wstring_view target);
+
+    static void s_RemoveAlias(const std::wstring_view exeName,
+                              const std::wstring_view source);
+
     static void s_ClearCmdExeAliases();
 
     static void s_MatchAndCopyAliasLegacy(_In_reads_bytes_(cbSource) PWCHAR pwchSource,
@@ -27,26 +48,30 @@ public:
                                           const std::wstring& exeName,
                                           DWORD& lines);
 
-    static std::wstring s_MatchAndCopyAlias(const std::wstring& sourceText,
-                                            const std::wstring& exeName,
-                                            size_t& lineCount);
+    static bool s_MatchAndCopyAlias(std::wstring_view sourceText,
+                                    const std::wstring_view exeName,
+                                    std::wstring& targetText,
+                                    size_t& lineCount);
 
 
 private:
-    static void s_TrimLeadingSpaces(std::wstring& str);
-    static void s_TrimTrailingCrLf(std::wstring& str);
-    static std::deque<std::wstring> s_Tokenize(const std::wstring& str);
-    static std::wstring s_GetArgString(const std::wstring& str);
-    static size_t s_ReplaceMacros(std::wstring& str,
-                                  const std::deque<std::wstring>& tokens,
-                                  const std::wstring& fullArgString);
+    static void s_TrimLeadingSpaces(std::wstring_view& str) noexcept;
+    static void s_TrimTrailingCrLf(std::wstring_view& str) noexcept;
+    static size_t s_Tokenize(const std::wstring_view str, Tokens& tokens) noexcept;
+    static std::wstring_view s_GetArgString(const std::wstring_view str) noexcept;
+
+    static Expansion s_CompileExpansion(const std::wstring_view target);
+    static void s_Expand(const Expansion& expansion,
+                         const Tokens& tokens,
+                         const std::wstring_view fullArgString,
+                         std::wstring& appendToStr);
 
     static bool s_TryReplaceNumberedArgMacro(const wchar_t ch,
                                              std::wstring& appendToStr,
-                                             const std::deque<std::wstring>& tokens);
+                                             const Tokens& tokens);
     static bool s_TryReplaceWildcardArgMacro(const wchar_t ch,
                                              std::wstring& appendToStr,
-                                             const std::wstring fullArgString);
+                                             const std::wstring_view fullArgString);
 
     static bool s_TryReplaceInputRedirMacro(const wchar_t ch,
                                             std::wstring& appendToStr);
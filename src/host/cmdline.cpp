@@ -297,6 +297,88 @@ void RedrawCommandLine(COOKED_READ_DATA& cookedReadData)
     }
 }
 
+// Routine Description:
+// - Redraws the echoed command line after it's been edited by writing only the
+//   cells that differ from what's on the screen, instead of erasing the whole
+//   line and writing it out again. This only works while every character of the
+//   line takes up exactly one cell (printable ASCII), and while the line fits
+//   in the buffer without having to scroll it.
+// Arguments:
+// - cookedReadData - The cooked read data to operate on. Its buffer holds the line after the edit.
+// - oldLine - The line as it's shown on the screen, from before the edit.
+// Return Value:
+// - true if the line was redrawn. If false, the caller has to redraw all of it.
+bool RedrawCommandLineChanges(COOKED_READ_DATA& cookedReadData, const std::wstring_view oldLine)
+{
+    const std::wstring_view newLine{ cookedReadData.BufferStartPtr(), cookedReadData.BytesRead() / sizeof(wchar_t) };
+    const COORD origin = cookedReadData.OriginalCursorPosition();
+    const COORD bufferSize = cookedReadData.ScreenInfo().GetBufferSize().Dimensions();
+
+    const auto isPlain = [](const std::wstring_view line) {
+        return std::all_of(line.cbegin(), line.cend(), [](const wchar_t wch) {
+            return wch >= UNICODE_SPACE && wch < 0x007F;
+        });
+    };
+    if (!cookedReadData.IsEchoInput() ||
+        origin.X < 0 ||
+        origin.Y < 0 ||
+        cookedReadData.VisibleCharCount() != oldLine.size() ||
+        !isPlain(oldLine) ||
+        !isPlain(newLine))
+    {
+        return false;
+    }
+
+    // The line can't reach the last cell of the buffer, or writing it would have scrolled.
+    const size_t cellsAvailable = gsl::narrow_cast<size_t>(bufferSize.Y - origin.Y) * bufferSize.X - origin.X;
+    if (newLine.size() >= cellsAvailable)
+    {
+        return false;
+    }
+
+    // Past the end of a line, its cells are blank.
+    const auto cellAt = [](const std::wstring_view line, const size_t i) {
+        return i < line.size() ? line.at(i) : UNICODE_SPACE;
+    };
+    const size_t cells = std::max(oldLine.size(), newLine.size());
+    size_t first = 0;
+    while (first < cells && cellAt(oldLine, first) == cellAt(newLine, first))
+    {
+        ++first;
+    }
+    size_t last = cells;
+    while (last > first && cellAt(oldLine, last - 1) == cellAt(newLine, last - 1))
+    {
+        --last;
+    }
+
+    if (first < last)
+    {
+        try
+        {
+            std::wstring changed(last - first, UNICODE_SPACE);
+            if (first < newLine.size())
+            {
+                const auto text = newLine.substr(first, last - first);
+                std::copy(text.cbegin(), text.cend(), changed.begin());
+            }
+
+            const size_t start = origin.X + first;
+            const COORD target{ gsl::narrow<SHORT>(start % bufferSize.X), gsl::narrow<SHORT>(origin.Y + start / bufferSize.X) };
+            SCREEN_INFORMATION& screenInfo = cookedReadData.ScreenInfo();
+            screenInfo.Write(OutputCellIterator(changed, screenInfo.GetAttributes()), target);
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            return false;
+        }
+    }
+
+    cookedReadData.VisibleCharCount() = newLine.size();
+    return true;
+}
+
 // Routine Description:
 // - This routine copies the commandline specified by Index into the cooked read buffer
 void SetCurrentCommandLine(COOKED_READ_DATA& cookedReadData, _In_ SHORT Index) // index, not command number
@@ -1073,9 +1155,14 @@ COORD CommandLine::DeleteFromRightOfCursor(COOKED_READ_DATA& cookedReadData) noe
 
     if (!cookedReadData.AtEol())
     {
-        // Delete commandline.
-#pragma prefast(suppress:__WARNING_BUFFER_OVERFLOW, "Not sure why prefast is getting confused here")
-        DeleteCommandLine(cookedReadData, false);
+        // Keep what the line looked like, so that only the cells that change have to be redrawn.
+        std::wstring oldLine;
+        try
+        {
+            oldLine.assign(cookedReadData.BufferStartPtr(), cookedReadData.BytesRead() / sizeof(WCHAR));
+        }
+        CATCH_LOG();
+        const bool lineSaved = oldLine.size() == cookedReadData.BytesRead() / sizeof(WCHAR);
 
         // Delete char.
         cookedReadData.BytesRead() -= sizeof(WCHAR);
@@ -1088,18 +1175,26 @@ COORD CommandLine::DeleteFromRightOfCursor(COOKED_READ_DATA& cookedReadData) noe
             *buf = (WCHAR)' ';
         }
 
-        // Write commandline.
-        if (cookedReadData.IsEchoInput())
+        // Redraw only what changed if we can, otherwise delete and write the whole commandline.
+        if (!(cookedReadData.IsEchoInput() && lineSaved && RedrawCommandLineChanges(cookedReadData, oldLine)))
         {
-            FAIL_FAST_IF_NTSTATUS_FAILED(WriteCharsLegacy(cookedReadData.ScreenInfo(),
-                                                          cookedReadData.BufferStartPtr(),
-                                                          cookedReadData.BufferStartPtr(),
-                                                          cookedReadData.BufferStartPtr(),
-                                                          &cookedReadData.BytesRead(),
-                                                          &cookedReadData.VisibleCharCount(),
-                                                          cookedReadData.OriginalCursorPosition().X,
-                                                          WC_DESTRUCTIVE_BACKSPACE | WC_KEEP_CURSOR_VISIBLE | WC_ECHO,
-                                                          nullptr));
+            // Delete commandline.
+#pragma prefast(suppress:__WARNING_BUFFER_OVERFLOW, "Not sure why prefast is getting confused here")
+            DeleteCommandLine(cookedReadData, false);
+
+            // Write commandline.
+            if (cookedReadData.IsEchoInput())
+            {
+                FAIL_FAST_IF_NTSTATUS_FAILED(WriteCharsLegacy(cookedReadData.ScreenInfo(),
+                                                              cookedReadData.BufferStartPtr(),
+                                                              cookedReadData.BufferStartPtr(),
+                                                              cookedReadData.BufferStartPtr(),
+                                                              &cookedReadData.BytesRead(),
+                                                              &cookedReadData.VisibleCharCount(),
+                                                              cookedReadData.OriginalCursorPosition().X,
+                                                              WC_DESTRUCTIVE_BACKSPACE | WC_KEEP_CURSOR_VISIBLE | WC_ECHO,
+                                                              nullptr));
+            }
         }
 
         // restore cursor position
@@ -143,6 +143,8 @@ void DeleteCommandLine(COOKED_READ_DATA& cookedReadData, const bool fUpdateField
 
 void RedrawCommandLine(COOKED_READ_DATA& cookedReadData);
 
+bool RedrawCommandLineChanges(COOKED_READ_DATA& cookedReadData, const std::wstring_view oldLine);
+
 // Values for WriteChars(), WriteCharsLegacy() dwFlags
 #define WC_DESTRUCTIVE_BACKSPACE 0x01
 #define WC_KEEP_CURSOR_VISIBLE   0x02
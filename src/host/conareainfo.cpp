@@ -51,9 +51,16 @@ ConversionAreaInfo::ConversionAreaInfo(const COORD bufferSize,
 ConversionAreaInfo::ConversionAreaInfo(ConversionAreaInfo&& other) :
     _caInfo(other._caInfo),
     _isHidden(other._isHidden),
-    _screenBuffer(nullptr)
+    _screenBuffer(nullptr),
+    _cells(std::move(other._cells))
 {
     std::swap(_screenBuffer, other._screenBuffer);
+
+    // The screen buffer points back at the area that owns it.
+    if (_screenBuffer)
+    {
+        _screenBuffer->ConvScreenInfo = this;
+    }
 }
 
 // Routine Description:
@@ -115,12 +122,87 @@ void ConversionAreaInfo::WriteText(const std::vector<OutputCell>& text,
     _screenBuffer->Write(view, { column, 0 });
 }
 
+// Routine Description:
+// - Shows a line of the composition in the area, at the given place over the screen.
+// - If the area is already showing a line at the same place, only the cells from
+//   the first one that's different onwards are written and painted again. The
+//   rest of the composition stays as it was on the screen.
+// Arguments:
+// - cells - The line to show. It must not be empty.
+// - column - Column of the area's buffer to write the line at, which is also the
+//            column of the screen buffer it's shown over
+// - viewPos - Where the area's buffer goes relative to the viewport
+// Return Value:
+// - The columns that were painted again, in the area's buffer (inclusive), or
+//   nothing if the line was already showing.
+std::optional<SMALL_RECT> ConversionAreaInfo::ShowLine(const std::vector<OutputCell>& cells,
+                                                       const SHORT column,
+                                                       const COORD viewPos)
+{
+    const SMALL_RECT window{ column, 0, gsl::narrow<SHORT>(column + cells.size() - 1), 0 };
+
+    if (IsHidden() ||
+        column != _caInfo.rcViewCaWindow.Left ||
+        viewPos.X != _caInfo.coordConView.X ||
+        viewPos.Y != _caInfo.coordConView.Y)
+    {
+        // It's moving, so it's painted out of where it was and into where it's going.
+        if (!IsHidden())
+        {
+            SetHidden(true);
+            Paint();
+        }
+
+        WriteText(cells, column);
+        _cells = cells;
+
+        _caInfo.rcViewCaWindow = window;
+        _caInfo.coordConView = viewPos;
+
+        SetHidden(false);
+        Paint();
+        return window;
+    }
+
+    const auto mismatch = std::mismatch(_cells.cbegin(), _cells.cend(), cells.cbegin(), cells.cend(), s_IsSameCell);
+    if (mismatch.first == _cells.cend() && mismatch.second == cells.cend())
+    {
+        return std::nullopt;
+    }
+
+    // A wide glyph is written from its leading half, never just its trailing one.
+    auto firstChanged = mismatch.second;
+    if (firstChanged != cells.cbegin() && firstChanged != cells.cend() && firstChanged->DbcsAttr().IsTrailing())
+    {
+        --firstChanged;
+    }
+
+    const auto first = firstChanged - cells.cbegin();
+    const auto changedEnd = std::max(_cells.size(), cells.size());
+
+    if (firstChanged != cells.cend())
+    {
+        const std::vector<OutputCell> changedCells(firstChanged, cells.cend());
+        WriteText(changedCells, gsl::narrow<SHORT>(column + first));
+    }
+    _cells = cells;
+    _caInfo.rcViewCaWindow = window;
+
+    // What used to be past the end of a line that got shorter is painted with
+    // what's under it again.
+    const SMALL_RECT changed{ gsl::narrow<SHORT>(column + first), 0, gsl::narrow<SHORT>(column + changedEnd - 1), 0 };
+    _PaintColumns(changed.Left, changed.Right);
+    return changed;
+}
+
 // Routine Description:
 // - Clears out a conversion area
 void ConversionAreaInfo::ClearArea() noexcept
 {
     SetHidden(true);
 
+    _cells.clear();
+
     try
     {
         _screenBuffer->ClearTextData();
@@ -222,3 +304,32 @@ void ConversionAreaInfo::Paint() const noexcept
         WriteToScreen(ScreenInfo, Viewport::FromInclusive(WriteRegion));
     }
 }
+
+// Routine Description:
+// - Paints some of the columns of the area's row, along with whatever's under them.
+// Arguments:
+// - left - First column to paint, in the area's buffer
+// - right - Last column to paint, in the area's buffer (inclusive)
+void ConversionAreaInfo::_PaintColumns(const SHORT left, const SHORT right) const noexcept
+{
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    SCREEN_INFORMATION& ScreenInfo = gci.GetActiveOutputBuffer();
+    const auto viewport = ScreenInfo.GetViewport();
+
+    SMALL_RECT WriteRegion;
+    WriteRegion.Left = viewport.Left() + _caInfo.coordConView.X + left;
+    WriteRegion.Right = viewport.Left() + _caInfo.coordConView.X + right;
+    WriteRegion.Top = viewport.Top() + _caInfo.coordConView.Y + _caInfo.rcViewCaWindow.Top;
+    WriteRegion.Bottom = WriteRegion.Top + (_caInfo.rcViewCaWindow.Bottom - _caInfo.rcViewCaWindow.Top);
+
+    WriteToScreen(ScreenInfo, Viewport::FromInclusive(WriteRegion));
+}
+
+// Routine Description:
+// - Checks whether two cells of a line would look the same on the screen.
+bool ConversionAreaInfo::s_IsSameCell(const OutputCell& a, const OutputCell& b)
+{
+    return a.Chars() == b.Chars() &&
+           a.DbcsAttr() == b.DbcsAttr() &&
+           a.TextAttr() == b.TextAttr();
+}
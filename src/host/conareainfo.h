@@ -63,13 +63,21 @@ public:
     void Paint() const noexcept;
 
     void WriteText(const std::vector<OutputCell>& text, const SHORT column);
+    std::optional<SMALL_RECT> ShowLine(const std::vector<OutputCell>& cells, const SHORT column, const COORD viewPos);
     void SetAttributes(const TextAttribute& attr);
 
     const TextBuffer& GetTextBuffer() const noexcept;
     const ConversionAreaBufferInfo& GetAreaBufferInfo() const noexcept;
 
 private:
+    void _PaintColumns(const SHORT left, const SHORT right) const noexcept;
+
+    static bool s_IsSameCell(const OutputCell& a, const OutputCell& b);
+
     ConversionAreaBufferInfo _caInfo;
     std::unique_ptr<SCREEN_INFORMATION> _screenBuffer;
     bool _isHidden;
+
+    // The line the area is showing, starting from the left of its window.
+    std::vector<OutputCell> _cells;
 };
@@ -38,11 +38,11 @@ void ConsoleImeInfo::RefreshAreaAttributes()
 // Routine Description:
 // - Takes the internally held composition message data from the last WriteCompMessage call
 //   and attempts to redraw it on the screen which will account for changes in viewport dimensions
+// - The lines that have moved are painted again. The ones that haven't are left alone.
 void ConsoleImeInfo::RedrawCompMessage()
 {
     if (!_text.empty())
     {
-        ClearAllAreas();
         _WriteUndeterminedChars(_text, _attributes, _colorArray);
     }
 }
@@ -51,6 +51,7 @@ void ConsoleImeInfo::RedrawCompMessage()
 // - Writes an undetermined composition message to the screen including the text
 //   and color and cursor positioning attribute data so the user can walk through
 //   what they're proposing to insert into the buffer.
+// - Only the cells that are different from the last message are painted again.
 // Arguments:
 // - text - The actual text of what the user would like to insert (UTF-16)
 // - attributes - Encoded attributes including the cursor position and the color index (to the array)
@@ -62,8 +63,6 @@ void ConsoleImeInfo::WriteCompMessage(const std::wstring_view text,
     // Backup the cursor visibility state and turn it off for drawing.
     _SaveCursorVisibility();
 
-    ClearAllAreas();
-
     // Save copies of the composition message in case we need to redraw it as things scroll/resize
     _text = text;
     _attributes = attributes;
@@ -227,14 +226,10 @@ std::vector<OutputCell> ConsoleImeInfo::s_ConvertToCells(const std::wstring_view
 {
     std::vector<OutputCell> cells;
 
-    // - Convert incoming wchar_t stream into UTF-16 units.
-    const auto glyphs = Utf16Parser::Parse(text);
-
-    // - Walk through all of the grouped up text, match up the correct attribute to it, and make a new cell.
+    // - Walk through the text a UTF-16 unit at a time, match up the correct attribute to it, and make a new cell.
     size_t attributesUsed = 0;
-    for (const auto& parsedGlyph : glyphs)
+    for (const auto glyph : Utf16Parser::Glyphs(text))
     {
-        const std::wstring_view glyph{ parsedGlyph.data(), parsedGlyph.size() };
         // Collect up attributes that apply to this glyph range.
         auto drawingAttr = s_RetrieveAttributeAt(attributesUsed, attributes, colorArray);
         attributesUsed++;
@@ -302,6 +297,8 @@ std::vector<OutputCell> ConsoleImeInfo::s_ConvertToCells(const std::wstring_view
 //       - Updated to set up the next conversion area down a line (and to the left viewport edge)
 // - view - The rectangle representing the viewable area of the screen right now to let us know how many cells can fit.
 // - screenInfo - A reference to the screen information we will use for accessibility notifications
+// - areaIndex - The conversion area to show this line in. If there isn't one yet, it's added.
+//             - Updated to the conversion area for the next line.
 // Return Value:
 // - Updated begin position for the next call. It will normally be >begin and <= end.
 //   However, if text couldn't fit in our line (full-width character starting at the very last cell)
@@ -311,7 +308,8 @@ std::vector<OutputCell>::const_iterator ConsoleImeInfo::_WriteConversionArea(con
                                                                              const std::vector<OutputCell>::const_iterator end,
                                                                              COORD& pos,
                                                                              const Microsoft::Console::Types::Viewport view,
-                                                                             SCREEN_INFORMATION& screenInfo)
+                                                                             SCREEN_INFORMATION& screenInfo,
+                                                                             size_t& areaIndex)
 {
     // The position in the viewport where we will start inserting cells for this conversion area
     // NOTE: We might exit early if there's not enough space to fit here, so we take a copy of
@@ -352,30 +350,32 @@ std::vector<OutputCell>::const_iterator ConsoleImeInfo::_WriteConversionArea(con
         lineEnd--;
     }
 
+    // Nothing fits on this line, so it all goes on the next one.
+    if (lineEnd == lineBegin)
+    {
+        return lineEnd;
+    }
+
     // Copy out the substring into a vector.
     const std::vector<OutputCell> lineVec(lineBegin, lineEnd);
 
-    // Add a conversion area to the internal state to hold this line.
-    THROW_IF_FAILED(_AddConversionArea());
-
-    // Get the added conversion area.
-    auto& area = ConvAreaCompStr.back();
-
-    // Write our text into the conversion area.
-    area.WriteText(lineVec, insertionPos.X);
-
-    // Set the viewport and positioning parameters for the conversion area to describe to the renderer
-    // the appropriate location to overlay this conversion area on top of the main screen buffer inside the viewport.
-    const SMALL_RECT region{ insertionPos.X, 0, gsl::narrow<SHORT>(insertionPos.X + lineVec.size() - 1), 0 };
-    area.SetWindowInfo(region);
-    area.SetViewPos({ 0 - view.Left(), insertionPos.Y - view.Top() });
+    // Add a conversion area to the internal state to hold this line, if the last
+    // composition didn't leave one.
+    if (areaIndex >= ConvAreaCompStr.size())
+    {
+        THROW_IF_FAILED(_AddConversionArea());
+    }
+    auto& area = ConvAreaCompStr.at(areaIndex++);
 
-    // Make it visible and paint it.
-    area.SetHidden(false);
-    area.Paint();
+    // Write our text into the conversion area and show it over the main screen buffer inside the viewport.
+    // Only what's changed since the area last showed a line here is painted again.
+    const auto changed = area.ShowLine(lineVec, insertionPos.X, { 0 - view.Left(), insertionPos.Y - view.Top() });
 
     // Notify accessibility that we have updated the text in this display region within the viewport.
-    screenInfo.NotifyAccessibilityEventing(insertionPos.X, insertionPos.Y, gsl::narrow<SHORT>(insertionPos.X + lineVec.size() - 1), insertionPos.Y);
+    if (changed.has_value())
+    {
+        screenInfo.NotifyAccessibilityEventing(changed->Left, insertionPos.Y, changed->Right, insertionPos.Y);
+    }
 
     // Hand back the iterator representing the end of what we used to be fed into the beginning of the next call.
     return lineEnd;
@@ -401,16 +401,14 @@ void ConsoleImeInfo::_WriteUndeterminedChars(const std::wstring_view text,
     // Ensure cursor is visible for prompt line
     screenInfo.MakeCurrentCursorVisible();
 
-    // Clear out existing conversion areas.
-    ConvAreaCompStr.clear();
-
     // If the text length and attribute length don't match,
     // it's a programming error on our part. We control the sizes here.
     FAIL_FAST_IF(text.size() != attributes.size());
 
-    // If we have no text, return. We've already cleared above.
+    // If we have no text, take down all of the conversion areas and return.
     if (text.empty())
     {
+        _RemoveAreasFrom(0);
         return;
     }
 
@@ -431,10 +429,33 @@ void ConsoleImeInfo::_WriteUndeterminedChars(const std::wstring_view text,
     const auto end = cells.cend();
 
     // Write over and over updating the beginning iterator until we reach the end.
+    // The conversion areas from last time are used again, in order, so that the lines
+    // that haven't changed don't have to be painted again.
+    size_t areaIndex = 0;
     do
     {
-        begin = _WriteConversionArea(begin, end, pos, view, screenInfo);
+        begin = _WriteConversionArea(begin, end, pos, view, screenInfo, areaIndex);
     } while (begin < end);
+
+    // The composition might be on fewer lines than it was.
+    _RemoveAreasFrom(areaIndex);
+}
+
+// Routine Description:
+// - Takes down the conversion areas from the given one onwards.
+// Arguments:
+// - index - The first conversion area to take down
+void ConsoleImeInfo::_RemoveAreasFrom(const size_t index)
+{
+    for (auto area = ConvAreaCompStr.begin() + std::min(index, ConvAreaCompStr.size()); area != ConvAreaCompStr.end(); ++area)
+    {
+        if (!area->IsHidden())
+        {
+            area->ClearArea();
+        }
+    }
+
+    ConvAreaCompStr.erase(ConvAreaCompStr.begin() + std::min(index, ConvAreaCompStr.size()), ConvAreaCompStr.end());
 }
 
 // Routine Description:
@@ -80,7 +80,10 @@ private:
                                                                                  const std::vector<OutputCell>::const_iterator end,
                                                                                  COORD& pos,
                                                                                  const Microsoft::Console::Types::Viewport view,
-                                                                                 SCREEN_INFORMATION& screenInfo);
+                                                                                 SCREEN_INFORMATION& screenInfo,
+                                                                                 size_t& areaIndex);
+
+    void _RemoveAreasFrom(const size_t index);
 
     void _SaveCursorVisibility();
     void _RestoreCursorVisibility();
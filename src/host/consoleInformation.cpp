@@ -8,6 +8,10 @@
 #include "output.h"
 #include "srvinit.h"
 
+#include "ApiStatistics.hpp"
+
+#include "..\server\CompletionBatch.h"
+
 #include "..\interactivity\inc\ServiceLocator.hpp"
 #include "..\types\inc\convert.hpp"
 
@@ -40,6 +44,7 @@ CONSOLE_INFORMATION::CONSOLE_INFORMATION() :
     ZeroMemory((void*)&CPInfo, sizeof(CPInfo));
     ZeroMemory((void*)&OutputCPInfo, sizeof(OutputCPInfo));
     InitializeCriticalSection(&_csConsoleLock);
+    InitializeSRWLock(&_srwConsoleLock);
 }
 
 CONSOLE_INFORMATION::~CONSOLE_INFORMATION()
@@ -47,6 +52,10 @@ CONSOLE_INFORMATION::~CONSOLE_INFORMATION()
     DeleteCriticalSection(&_csConsoleLock);
 }
 
+// How many times this thread has locked the console for reading, and not
+// unlocked it yet. Only the first of them holds the SRW lock.
+static thread_local ULONG t_sharedLockCount = 0;
+
 bool CONSOLE_INFORMATION::IsConsoleLocked() const
 {
     // The critical section structure's OwningThread field contains the ThreadId despite having the HANDLE type.
@@ -57,19 +66,132 @@ bool CONSOLE_INFORMATION::IsConsoleLocked() const
 #pragma prefast(suppress:26135, "Adding lock annotation spills into entire project. Future work.")
 void CONSOLE_INFORMATION::LockConsole()
 {
+    // A reader that's about to write has to let the other readers finish
+    // first, and it can't wait for them while it holds its share.
+    if (t_sharedLockCount > 0 && !IsConsoleLocked())
+    {
+        ReleaseSRWLockShared(&_srwConsoleLock);
+    }
+
+    const bool measure = ApiStatistics::s_IsMeasuringThisThread();
+    const auto start = measure ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
     EnterCriticalSection(&_csConsoleLock);
+    if (_csConsoleLock.RecursionCount == 1)
+    {
+        AcquireSRWLockExclusive(&_srwConsoleLock);
+    }
+
+    if (measure)
+    {
+        ApiStatistics::s_AddLockWait(std::chrono::steady_clock::now() - start);
+    }
 }
 
 #pragma prefast(suppress:26135, "Adding lock annotation spills into entire project. Future work.")
 bool CONSOLE_INFORMATION::TryLockConsole()
 {
-    return !!TryEnterCriticalSection(&_csConsoleLock);
+    if (t_sharedLockCount > 0 && !IsConsoleLocked())
+    {
+        return false;
+    }
+
+    if (!TryEnterCriticalSection(&_csConsoleLock))
+    {
+        return false;
+    }
+
+    if (_csConsoleLock.RecursionCount == 1 && !TryAcquireSRWLockExclusive(&_srwConsoleLock))
+    {
+        LeaveCriticalSection(&_csConsoleLock);
+        return false;
+    }
+
+    return true;
 }
 
 #pragma prefast(suppress:26135, "Adding lock annotation spills into entire project. Future work.")
 void CONSOLE_INFORMATION::UnlockConsole()
 {
+    // The replies to the waits that were satisfied while we had the lock are
+    // sent once we let go of it, so nobody waits on the driver for them.
+    if (_csConsoleLock.RecursionCount != 1)
+    {
+        LeaveCriticalSection(&_csConsoleLock);
+        return;
+    }
+
+    stateSnapshot.Publish(*this);
+
+    auto replies = CompletionBatch::s_HasPending() ? CompletionBatch::s_TakePending() : std::vector<CONSOLE_API_MSG>{};
+    ReleaseSRWLockExclusive(&_srwConsoleLock);
     LeaveCriticalSection(&_csConsoleLock);
+    CompletionBatch::s_CompleteAll(replies);
+
+    // A reader that wrote for a bit goes back to reading.
+    if (t_sharedLockCount > 0)
+    {
+        AcquireSRWLockShared(&_srwConsoleLock);
+    }
+}
+
+// Routine Description:
+// - Locks the console for reading only. Any number of threads can hold it
+//   this way at once, while those that lock it with LockConsole wait for all
+//   of them to be done (and the other way around).
+// - Whoever holds it this way must not change anything the console lock
+//   guards. If it has to after all, LockConsole can still be called, but the
+//   console may have changed by the time it returns.
+// - A thread that already holds the console with LockConsole simply locks it
+//   again that way.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+#pragma prefast(suppress:26135, "Adding lock annotation spills into entire project. Future work.")
+void CONSOLE_INFORMATION::LockConsoleShared()
+{
+    if (IsConsoleLocked())
+    {
+        LockConsole();
+        return;
+    }
+
+    if (t_sharedLockCount++ == 0)
+    {
+        const bool measure = ApiStatistics::s_IsMeasuringThisThread();
+        const auto start = measure ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+        AcquireSRWLockShared(&_srwConsoleLock);
+
+        if (measure)
+        {
+            ApiStatistics::s_AddLockWait(std::chrono::steady_clock::now() - start);
+        }
+    }
+}
+
+// Routine Description:
+// - Unlocks the console after a call to LockConsoleShared.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+#pragma prefast(suppress:26135, "Adding lock annotation spills into entire project. Future work.")
+void CONSOLE_INFORMATION::UnlockConsoleShared()
+{
+    // The lock calls nest, so if we hold it exclusively now, that's how the
+    // matching LockConsoleShared took it.
+    if (IsConsoleLocked())
+    {
+        UnlockConsole();
+        return;
+    }
+
+    if (--t_sharedLockCount == 0)
+    {
+        ReleaseSRWLockShared(&_srwConsoleLock);
+    }
 }
 
 ULONG CONSOLE_INFORMATION::GetCSRecursionCount()
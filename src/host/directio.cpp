@@ -16,6 +16,7 @@
 
 #include "../types/inc/convert.hpp"
 #include "../types/inc/GlyphWidth.hpp"
+#include "../types/inc/ScratchArena.hpp"
 #include "../types/inc/viewport.hpp"
 
 #include "..\interactivity\inc\ServiceLocator.hpp"
@@ -251,6 +252,66 @@ static NTSTATUS _DoGetConsoleInput(InputBuffer& inputBuffer,
     }
 }
 
+// Routine Description:
+// - This routine reads or peeks input records for the W APIs, which take the
+//   records just as they're stored. They're copied straight into the
+//   client's buffer with the console locked only for that copy.
+// Arguments:
+// - inputBuffer - The input buffer to take records from to return to the client
+// - outRecords - The client's buffer. As many records are read as fit.
+// - eventsRead - On exit, how many records were read.
+// - readHandleState - Input context kept across calls on the same handle,
+// for the waiter.
+// - IsPeek - If this is a peek operation (a.k.a. do not remove
+// records from the input buffer while copying to client buffer.)
+// - waiter - If we have to wait (no data to return to the client), this
+// contains context that will allow the server to restore this call later.
+// Return Value:
+// - STATUS_SUCCESS - If data was found and ready for return to the client.
+// - CONSOLE_STATUS_WAIT - If we didn't have any data, along with context in waiter.
+// - Or an out of memory error message in NTSTATUS format.
+[[nodiscard]]
+static NTSTATUS _DoGetConsoleInputW(InputBuffer& inputBuffer,
+                                    const gsl::span<INPUT_RECORD> outRecords,
+                                    size_t& eventsRead,
+                                    INPUT_READ_HANDLE_DATA& readHandleState,
+                                    const bool IsPeek,
+                                    std::unique_ptr<IWaitRoutine>& waiter) noexcept
+{
+    try
+    {
+        waiter.reset();
+        eventsRead = 0;
+
+        if (outRecords.empty())
+        {
+            return STATUS_SUCCESS;
+        }
+
+        NTSTATUS Status;
+        {
+            LockConsole();
+            auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+            Status = inputBuffer.Read(outRecords, eventsRead, IsPeek, true);
+        }
+
+        if (CONSOLE_STATUS_WAIT == Status)
+        {
+            // If we're told to wait until later, the read data object will
+            // finish the read once there's input.
+            waiter = std::make_unique<DirectReadData>(&inputBuffer,
+                                                      &readHandleState,
+                                                      gsl::narrow_cast<size_t>(outRecords.size()),
+                                                      std::deque<std::unique_ptr<IInputEvent>>{});
+        }
+        return Status;
+    }
+    catch (...)
+    {
+        return NTSTATUS_FROM_HRESULT(wil::ResultFromCaughtException());
+    }
+}
+
 // Routine Description:
 // - Retrieves input records from the given input object and returns them to the client.
 // - The peek version will NOT remove records when it copies them out.
@@ -293,8 +354,8 @@ HRESULT ApiRoutines::PeekConsoleInputAImpl(IConsoleInputObject& context,
 // - The W version accepts UCS-2 formatted characters (wide characters)
 // Arguments:
 // - context - The input buffer to take records from to return to the client
-// - outEvents - storage location for read events
-// - eventsToRead - The number of input events to read
+// - outRecords - the client's buffer, to copy the records to
+// - eventsRead - on exit, the number of input events read
 // - readHandleState - A structure that will help us maintain
 // some input context across various calls on the same input
 // handle. Primarily used to restore the "other piece" of partially
@@ -305,22 +366,17 @@ HRESULT ApiRoutines::PeekConsoleInputAImpl(IConsoleInputObject& context,
 // restore this call later.
 [[nodiscard]]
 HRESULT ApiRoutines::PeekConsoleInputWImpl(IConsoleInputObject& context,
-                                           std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                           const size_t eventsToRead,
+                                           gsl::span<INPUT_RECORD> outRecords,
+                                           size_t& eventsRead,
                                            INPUT_READ_HANDLE_DATA& readHandleState,
                                            std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
-    try
-    {
-        RETURN_NTSTATUS(_DoGetConsoleInput(context,
-                                           outEvents,
-                                           eventsToRead,
-                                           readHandleState,
-                                           true,
-                                           true,
-                                           waiter));
-    }
-    CATCH_RETURN();
+    RETURN_NTSTATUS(_DoGetConsoleInputW(context,
+                                        outRecords,
+                                        eventsRead,
+                                        readHandleState,
+                                        true,
+                                        waiter));
 }
 
 // Routine Description:
@@ -365,8 +421,8 @@ HRESULT ApiRoutines::ReadConsoleInputAImpl(IConsoleInputObject& context,
 // - The W version accepts UCS-2 formatted characters (wide characters)
 // Arguments:
 // - context - The input buffer to take records from to return to the client
-// - outEvents - storage location for read events
-// - eventsToRead - The number of input events to read
+// - outRecords - the client's buffer, to copy the records to
+// - eventsRead - on exit, the number of input events read
 // - readHandleState - A structure that will help us maintain
 // some input context across various calls on the same input
 // handle. Primarily used to restore the "other piece" of partially
@@ -377,22 +433,17 @@ HRESULT ApiRoutines::ReadConsoleInputAImpl(IConsoleInputObject& context,
 // restore this call later.
 [[nodiscard]]
 HRESULT ApiRoutines::ReadConsoleInputWImpl(IConsoleInputObject& context,
-                                           std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                           const size_t eventsToRead,
+                                           gsl::span<INPUT_RECORD> outRecords,
+                                           size_t& eventsRead,
                                            INPUT_READ_HANDLE_DATA& readHandleState,
                                            std::unique_ptr<IWaitRoutine>& waiter) noexcept
 {
-    try
-    {
-        RETURN_NTSTATUS(_DoGetConsoleInput(context,
-                                           outEvents,
-                                           eventsToRead,
-                                           readHandleState,
-                                           true,
-                                           false,
-                                           waiter));
-    }
-    CATCH_RETURN();
+    RETURN_NTSTATUS(_DoGetConsoleInputW(context,
+                                        outRecords,
+                                        eventsRead,
+                                        readHandleState,
+                                        false,
+                                        waiter));
 }
 
 // Routine Description:
@@ -601,11 +652,10 @@ static HRESULT _ConvertCellsToAInplace(const UINT codepage, const gsl::span<CHAR
 {
     try
     {
-        std::vector<CHAR_INFO> tempBuffer(buffer.cbegin(), buffer.cend());
-
+        // Each cell is converted in place. Only the cell being converted is read, and it's read before it's
+        // written, so there's no need for a copy of the buffer to convert from.
         const auto size = rectangle.Dimensions();
-        auto tempIter = tempBuffer.cbegin();
-        auto outIter = buffer.begin();
+        auto iter = buffer.begin();
 
         for (int i = 0; i < size.Y; i++)
         {
@@ -614,7 +664,7 @@ static HRESULT _ConvertCellsToAInplace(const UINT codepage, const gsl::span<CHAR
                 // Any time we see the lead flag, we presume there will be a trailing one following it.
                 // Giving us two bytes of space (one per cell in the ascii part of the character union)
                 // to fill with whatever this Unicode character converts into.
-                if (WI_IsFlagSet(tempIter->Attributes, COMMON_LVB_LEADING_BYTE))
+                if (WI_IsFlagSet(iter->Attributes, COMMON_LVB_LEADING_BYTE))
                 {
                     // As long as we're not looking at the exact last column of the buffer...
                     if (j < size.X - 1)
@@ -625,37 +675,30 @@ static HRESULT _ConvertCellsToAInplace(const UINT codepage, const gsl::span<CHAR
                         // Try to convert the unicode character (2 bytes) in the leading cell to the codepage.
                         CHAR AsciiDbcs[2] = { 0 };
                         UINT NumBytes = gsl::narrow<UINT>(sizeof(AsciiDbcs));
-                        NumBytes = ConvertToOem(codepage, &tempIter->Char.UnicodeChar, 1, &AsciiDbcs[0], NumBytes);
+                        NumBytes = ConvertToOem(codepage, &iter->Char.UnicodeChar, 1, &AsciiDbcs[0], NumBytes);
 
                         // Fill the 1 byte (AsciiChar) portion of the leading and trailing cells with each of the bytes returned.
-                        outIter->Char.AsciiChar = AsciiDbcs[0];
-                        outIter->Attributes = tempIter->Attributes;
-                        outIter++;
-                        tempIter++;
-                        outIter->Char.AsciiChar = AsciiDbcs[1];
-                        outIter->Attributes = tempIter->Attributes;
-                        outIter++;
-                        tempIter++;
+                        iter->Char.AsciiChar = AsciiDbcs[0];
+                        iter++;
+                        iter->Char.AsciiChar = AsciiDbcs[1];
+                        iter++;
                     }
                     else
                     {
                         // When we're in the last column with only a leading byte, we can't return that without a trailing.
                         // Instead, replace the output data with just a space and clear all flags.
-                        outIter->Char.AsciiChar = UNICODE_SPACE;
-                        outIter->Attributes = tempIter->Attributes;
-                        WI_ClearAllFlags(outIter->Attributes, COMMON_LVB_SBCSDBCS);
-                        outIter++;
-                        tempIter++;
+                        iter->Char.AsciiChar = UNICODE_SPACE;
+                        WI_ClearAllFlags(iter->Attributes, COMMON_LVB_SBCSDBCS);
+                        iter++;
                     }
                 }
-                else if (WI_AreAllFlagsClear(tempIter->Attributes, COMMON_LVB_SBCSDBCS))
+                else if (WI_AreAllFlagsClear(iter->Attributes, COMMON_LVB_SBCSDBCS))
                 {
                     // If there are no leading/trailing pair flags, then we only have 1 ascii byte to try to fit the
                     // 2 byte UTF-16 character into. Give it a go.
-                    ConvertToOem(codepage, &tempIter->Char.UnicodeChar, 1, &outIter->Char.AsciiChar, 1);
-                    outIter->Attributes = tempIter->Attributes;
-                    outIter++;
-                    tempIter++;
+                    const wchar_t wch = iter->Char.UnicodeChar;
+                    ConvertToOem(codepage, &wch, 1, &iter->Char.AsciiChar, 1);
+                    iter++;
                 }
             }
         }
@@ -746,9 +789,9 @@ static HRESULT _ConvertCellsToWInplace(const UINT codepage, gsl::span<CHAR_INFO>
 }
 
 [[nodiscard]]
-static std::vector<CHAR_INFO> _ConvertCellsToMungedW(gsl::span<CHAR_INFO> buffer, const Viewport& rectangle)
+static std::pmr::vector<CHAR_INFO> _ConvertCellsToMungedW(gsl::span<CHAR_INFO> buffer, const Viewport& rectangle)
 {
-    std::vector<CHAR_INFO> result;
+    std::pmr::vector<CHAR_INFO> result{ &ScratchArena::ForThisThread() };
     result.reserve(buffer.size() * 2); // we estimate we'll need up to double the cells if they all expand.
 
     const auto size = rectangle.Dimensions();
@@ -854,40 +897,50 @@ static HRESULT _ReadConsoleOutputWImplHelper(const SCREEN_INFORMATION& context,
         // We will start reading the buffer at the point of the top left corner (origin) of the (potentially adjusted) request
         const auto sourcePoint = clippedRequestRectangle.Origin();
 
-        // Get an iterator to the beginning of the return buffer
-        // We might have to seek this forward or skip around if we clipped the request.
-        auto targetIter = targetBuffer.begin();
-        COORD targetPos = { 0 };
-        const auto targetLimit = Viewport::FromDimensions(targetPoint, clippedRequestRectangle.Dimensions());
-
-        // Get an iterator to the beginning of the request inside the screen buffer
-        // This should walk exactly along every cell of the clipped request.
-        auto sourceIter = storageBuffer.GetCellDataAt(sourcePoint, clippedRequestRectangle);
-
-        // Walk through every cell of the target, advancing the buffer.
-        // Validate that we always still have a valid iterator to the backgin store,
-        // that we always are writing inside the user's buffer (before the end)
-        // and we're always targeting the user's buffer inside its original bounds.
-        while (sourceIter && targetIter < targetBuffer.end())
+        // Convert the clipped request a row at a time, straight from the rows of the text buffer into the
+        // user's buffer. Cells outside of it (because we clipped the request) are left alone.
+        // Colors come in runs, so the legacy form of one (which might mean finding the nearest
+        // table color to an RGB one) is only worked out again when the color changes.
+        if (clip.Right > clip.Left && clip.Bottom > clip.Top)
         {
-            // If the point we're trying to write is inside the limited buffer write zone...
-            if (targetLimit.IsInBounds(targetPos))
-            {
-                // Copy the data into position...
-                *targetIter = gci.AsCharInfo(*sourceIter);
-                // ... and advance the read iterator.
-                sourceIter++;
-            }
+            const auto& textBuffer = storageBuffer.GetTextBuffer();
+            const auto width = clippedRequestRectangle.Width();
 
-            // Always advance the write iterator, we might have skipped it due to clipping.
-            targetIter++;
+            bool haveLegacyAttributes = false;
+            TextAttribute lastAttributes;
+            WORD lastLegacyAttributes = 0;
 
-            // Increment the target
-            targetPos.X++;
-            if (targetPos.X >= targetSize.X)
+            std::optional<ROW> scratch;
+            for (SHORT row = 0; row < clippedRequestRectangle.Height(); row++)
             {
-                targetPos.X = 0;
-                targetPos.Y++;
+                const ROW& sourceRow = textBuffer.GetRowByOffset(gsl::narrow_cast<size_t>(sourcePoint.Y + row), scratch);
+                const CharRow& charRow = sourceRow.GetCharRow();
+                auto attrIter = sourceRow.GetAttrRow().cbegin();
+                attrIter += sourcePoint.X;
+
+                // Find where the row goes in the user's buffer by the dimensions of the original request.
+                ptrdiff_t targetOffset = 0;
+                RETURN_IF_FAILED(PtrdiffTAdd(targetPoint.Y, row, &targetOffset));
+                RETURN_IF_FAILED(PtrdiffTMult(targetOffset, targetSize.X, &targetOffset));
+                RETURN_IF_FAILED(PtrdiffTAdd(targetOffset, targetPoint.X, &targetOffset));
+                RETURN_HR_IF(E_INVALIDARG, targetOffset + width > gsl::narrow_cast<ptrdiff_t>(targetBuffer.size()));
+                const auto targetRow = targetBuffer.subspan(targetOffset, width);
+
+                for (SHORT col = 0; col < width; col++, attrIter++)
+                {
+                    const TextAttribute& attributes = *attrIter;
+                    if (!haveLegacyAttributes || attributes != lastAttributes)
+                    {
+                        lastAttributes = attributes;
+                        lastLegacyAttributes = gci.GenerateLegacyAttributes(attributes);
+                        haveLegacyAttributes = true;
+                    }
+
+                    const size_t column = sourcePoint.X + col;
+                    CHAR_INFO& target = targetRow[col];
+                    target.Char.UnicodeChar = Utf16ToUcs2(charRow.GlyphAt(column));
+                    target.Attributes = lastLegacyAttributes | charRow.DbcsAttrAt(column).GeneratePublicApiAttributeFormat();
+                }
             }
         }
 
@@ -1017,34 +1070,25 @@ static HRESULT _WriteConsoleOutputWImplHelper(SCREEN_INFORMATION& context,
 
         const auto writeRectangle = Viewport::FromInclusive(writeRegion);
 
-        auto target = writeRectangle.Origin();
+        const auto target = writeRectangle.Origin();
 
-        // For every row in the request, create a view into the clamped portion of just the one line to write.
-        // This allows us to restrict the width of the call without allocating/copying any memory by just making
-        // a smaller view over the existing big blob of data from the original call.
-        for (; target.Y < writeRectangle.BottomExclusive(); target.Y++)
-        {
-            // We find the offset into the original buffer by the dimensions of the original request rectangle.
-            ptrdiff_t rowOffset = 0;
-            RETURN_IF_FAILED(PtrdiffTSub(target.Y, requestRectangle.Top(), &rowOffset));
-            RETURN_IF_FAILED(PtrdiffTMult(rowOffset, requestRectangle.Width(), &rowOffset));
-
-            ptrdiff_t colOffset = 0;
-            RETURN_IF_FAILED(PtrdiffTSub(target.X, requestRectangle.Left(), &colOffset));
+        // We find the offset of the first cell to write into the original buffer by the dimensions of the
+        // original request rectangle. Each row after it is one request width further along.
+        ptrdiff_t rowOffset = 0;
+        RETURN_IF_FAILED(PtrdiffTSub(target.Y, requestRectangle.Top(), &rowOffset));
+        RETURN_IF_FAILED(PtrdiffTMult(rowOffset, requestRectangle.Width(), &rowOffset));
 
-            ptrdiff_t totalOffset = 0;
-            RETURN_IF_FAILED(PtrdiffTAdd(rowOffset, colOffset, &totalOffset));
+        ptrdiff_t colOffset = 0;
+        RETURN_IF_FAILED(PtrdiffTSub(target.X, requestRectangle.Left(), &colOffset));
 
-            // Now we make a subspan starting from that offset for as much of the original request as would fit
-            const auto subspan = buffer.subspan(totalOffset, writeRectangle.Width());
+        ptrdiff_t totalOffset = 0;
+        RETURN_IF_FAILED(PtrdiffTAdd(rowOffset, colOffset, &totalOffset));
 
-            // Convert to a CHAR_INFO view to fit into the iterator
-            const auto charInfos = std::basic_string_view<CHAR_INFO>(subspan.data(), subspan.size());
-
-            // Make the iterator and write to the target position.
-            OutputCellIterator it(charInfos);
-            storageBuffer.Write(it, target);
-        }
+        // Write the whole clamped rectangle straight from a view over the original big blob of data,
+        // without allocating/copying any memory, and with one repaint for all of it.
+        const auto subspan = buffer.subspan(totalOffset);
+        const auto charInfos = std::basic_string_view<CHAR_INFO>(subspan.data(), subspan.size());
+        storageBuffer.WriteRect(charInfos, gsl::narrow<size_t>(requestRectangle.Width()), writeRectangle);
 
         // Since we've managed to write part of the request, return the clamped part that we actually used.
         writtenRectangle = writeRectangle;
@@ -1117,7 +1161,7 @@ HRESULT ApiRoutines::ReadConsoleOutputAttributeImpl(const SCREEN_INFORMATION& co
 
     try
     {
-        const auto attrs = ReadOutputAttributes(context.GetActiveBuffer(), origin, buffer.size());
+        const auto attrs = ReadOutputAttributes(context.GetActiveBuffer(), origin, buffer.size(), &ScratchArena::ForThisThread());
         std::copy(attrs.cbegin(), attrs.cend(), buffer.begin());
         written = attrs.size();
 
@@ -1141,7 +1185,8 @@ HRESULT ApiRoutines::ReadConsoleOutputCharacterAImpl(const SCREEN_INFORMATION& c
     {
         const auto chars = ReadOutputStringA(context.GetActiveBuffer(),
                                              origin,
-                                             buffer.size());
+                                             buffer.size(),
+                                             &ScratchArena::ForThisThread());
 
         // for compatibility reasons, if we receive more chars than can fit in the buffer
             // then we don't send anything back.
@@ -1171,7 +1216,8 @@ HRESULT ApiRoutines::ReadConsoleOutputCharacterWImpl(const SCREEN_INFORMATION& c
     {
         const auto chars = ReadOutputStringW(context.GetActiveBuffer(),
                                              origin,
-                                             buffer.size());
+                                             buffer.size(),
+                                             &ScratchArena::ForThisThread());
 
         // Only copy if the whole result will fit.
         if (chars.size() <= gsl::narrow<size_t>(buffer.size()))
@@ -168,7 +168,8 @@ int CALLBACK wWinMain(
     HRESULT hr = args.ParseCommandline();
     if (SUCCEEDED(hr))
     {
-        if (ShouldUseLegacyConhost(args.GetForceV1()))
+        // Measuring the buffers and parsers only means anything for this conhost.
+        if (!args.IsRenderless() && ShouldUseLegacyConhost(args.GetForceV1()))
         {
             if (args.ShouldCreateServerHandle())
             {
@@ -0,0 +1,547 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "findAll.h"
+#include "handle.h"
+#include "selection.hpp"
+
+#include "..\interactivity\inc\ServiceLocator.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Types;
+
+std::unique_ptr<FindAll> FindAll::_instance;
+
+FindAll::FindAll() :
+    _lock{},
+    _wake{},
+    _stop{ false },
+    _thread{},
+    _needle{},
+    _sensitivity{ Search::Sensitivity::CaseInsensitive },
+    _active{ false },
+    _scannedBuffer{ nullptr },
+    _scannedSize{ 0 },
+    _scannedGeneration{ 0 },
+    _scannedCircledRows{ 0 },
+    _matches{},
+    _pendingRows{},
+    _current{},
+    _rowText{},
+    _rowColumns{},
+    _overlayRenderTarget{},
+    _overlayBuffer{}
+{
+}
+
+FindAll::~FindAll()
+{
+    _StopThread();
+}
+
+FindAll& FindAll::Instance()
+{
+    if (!_instance)
+    {
+        _instance.reset(new FindAll());
+    }
+    return *_instance;
+}
+
+// Routine Description:
+// - Starts finding every match of the given string in the active screen
+//      buffer, in place of whatever was being found before. The matches are
+//      highlighted as they're found. The console must not be locked.
+// Arguments:
+// - str - the string to find.
+// - sensitivity - whether the case of the string has to match.
+// Return Value:
+// - <none>
+void FindAll::Start(const std::wstring& str, const Search::Sensitivity sensitivity)
+{
+    Stop();
+
+    {
+        LockConsole();
+        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+
+        _needle = Search::s_CreateNeedleFromString(str, sensitivity);
+        _sensitivity = sensitivity;
+        _active = !_needle.empty();
+        _scannedBuffer = nullptr;
+    }
+
+    if (_active)
+    {
+        _stop = false;
+        _thread = std::thread([this]() { _ScanLoop(); });
+    }
+}
+
+// Routine Description:
+// - Stops finding matches and takes down their highlights. The console must
+//      not be locked, as this waits for the batch being scanned to finish.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void FindAll::Stop() noexcept
+{
+    _StopThread();
+
+    LockConsole();
+    auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+
+    try
+    {
+        const bool hadMatches = !_matches.empty();
+        _Clear();
+
+        if (hadMatches)
+        {
+            SCREEN_INFORMATION& screenInfo = ServiceLocator::LocateGlobals().getConsoleInformation().GetActiveOutputBuffer();
+            screenInfo.GetTextBuffer().GetRenderTarget().TriggerRedraw(screenInfo.GetViewport());
+        }
+    }
+    CATCH_LOG();
+}
+
+// Routine Description:
+// - Checks whether the matches being found are the ones for this string, so
+//      that the next of them can be selected rather than searched for again.
+// Arguments:
+// - str - the string to find.
+// - sensitivity - whether the case of the string has to match.
+// Return Value:
+// - true if it's this string that's being found.
+bool FindAll::IsActiveFor(const std::wstring& str, const Search::Sensitivity sensitivity) const
+{
+    return _active &&
+           _sensitivity == sensitivity &&
+           _needle == Search::s_CreateNeedleFromString(str, sensitivity);
+}
+
+// Routine Description:
+// - Selects the match after the one that was selected last, in the given
+//      direction, going around the buffer when it gets to the end.
+// Arguments:
+// - direction - which way to go from the last match.
+// Return Value:
+// - true if a match was selected, false if nothing's been found (yet).
+bool FindAll::SelectNext(const Search::Direction direction)
+{
+    const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    if (!_active || _matches.empty() || &gci.GetActiveOutputBuffer().GetTextBuffer() != _scannedBuffer)
+    {
+        return false;
+    }
+
+    uint64_t row = 0;
+    const Match* match = nullptr;
+    if (direction == Search::Direction::Forward)
+    {
+        if (_current.has_value())
+        {
+            for (auto it = _matches.lower_bound(_current->first); it != _matches.end() && match == nullptr; ++it)
+            {
+                for (const auto& candidate : it->second)
+                {
+                    if (it->first > _current->first || candidate.column > _current->second)
+                    {
+                        row = it->first;
+                        match = &candidate;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (match == nullptr)
+        {
+            row = _matches.begin()->first;
+            match = &_matches.begin()->second.front();
+        }
+    }
+    else
+    {
+        if (_current.has_value())
+        {
+            for (auto it = std::make_reverse_iterator(_matches.upper_bound(_current->first)); it != _matches.rend() && match == nullptr; ++it)
+            {
+                for (auto candidate = it->second.rbegin(); candidate != it->second.rend(); ++candidate)
+                {
+                    if (it->first < _current->first || candidate->column < _current->second)
+                    {
+                        row = it->first;
+                        match = &*candidate;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (match == nullptr)
+        {
+            row = _matches.rbegin()->first;
+            match = &_matches.rbegin()->second.back();
+        }
+    }
+
+    _current.emplace(row, match->column);
+    Selection::Instance().SelectNewRegion(_GetStart(row, *match), _GetEnd(row, *match));
+    return true;
+}
+
+// Routine Description:
+// - Adds an overlay for each piece of a match that's in view, which draws its
+//      text over the buffer's in the highlight's colors.
+// Arguments:
+// - overlays - the overlays to add to.
+// Return Value:
+// - <none>
+void FindAll::AppendOverlays(std::vector<RenderOverlay>& overlays)
+{
+    const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    const SCREEN_INFORMATION& screenInfo = gci.GetActiveOutputBuffer();
+    const TextBuffer& textBuffer = screenInfo.GetTextBuffer();
+    if (!_active || _matches.empty() || &textBuffer != _scannedBuffer)
+    {
+        return;
+    }
+
+    const Viewport viewport = screenInfo.GetViewport();
+    const COORD dimensions = viewport.Dimensions();
+    if (!_overlayBuffer || _overlayBuffer->GetSize().Dimensions() != dimensions)
+    {
+        _overlayBuffer = std::make_unique<TextBuffer>(dimensions,
+                                                      TextAttribute{ s_HighlightAttributes },
+                                                      CURSOR_SMALL_SIZE,
+                                                      _overlayRenderTarget);
+    }
+
+    // A match in the row above the viewport can run on into its top row.
+    const SHORT firstRow = std::max<SHORT>(viewport.Top() - 1, 0);
+    const auto first = _matches.lower_bound(_scannedCircledRows + firstRow);
+    const auto last = _matches.upper_bound(_scannedCircledRows + viewport.BottomInclusive());
+    for (auto it = first; it != last; ++it)
+    {
+        for (const auto& match : it->second)
+        {
+            COORD position{ match.column, gsl::narrow<SHORT>(it->first - _scannedCircledRows) };
+            size_t remaining = match.cells;
+            while (remaining > 0 && position.Y < _scannedSize.Y)
+            {
+                const size_t count = std::min<size_t>(remaining, _scannedSize.X - position.X);
+                if (position.Y >= viewport.Top() && position.Y <= viewport.BottomInclusive())
+                {
+                    const SHORT left = std::max(position.X, viewport.Left());
+                    const SHORT right = std::min(gsl::narrow_cast<SHORT>(position.X + count - 1), viewport.RightInclusive());
+                    if (left <= right)
+                    {
+                        _rowText.clear();
+                        textBuffer.ReadText(_rowText, { left, position.Y }, static_cast<size_t>(right) - left + 1);
+
+                        const COORD target{ gsl::narrow_cast<SHORT>(left - viewport.Left()),
+                                            gsl::narrow_cast<SHORT>(position.Y - viewport.Top()) };
+                        _overlayBuffer->Write(OutputCellIterator(_rowText, TextAttribute{ s_HighlightAttributes }), target);
+
+                        const SMALL_RECT region{ target.X, target.Y, gsl::narrow_cast<SHORT>(right - viewport.Left()), target.Y };
+                        overlays.emplace_back(RenderOverlay{ *_overlayBuffer, { 0, 0 }, Viewport::FromInclusive(region) });
+                    }
+                }
+
+                remaining -= count;
+                position.X = 0;
+                position.Y++;
+            }
+        }
+    }
+}
+
+// Routine Description:
+// - Tells the scanning thread to finish and waits for it to.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void FindAll::_StopThread() noexcept
+{
+    if (!_thread.joinable())
+    {
+        return;
+    }
+
+    try
+    {
+        std::lock_guard<std::mutex> guard{ _lock };
+        _stop = true;
+    }
+    CATCH_LOG();
+    _wake.notify_one();
+
+    _thread.join();
+}
+
+// Routine Description:
+// - The scanning thread. Scans a batch of rows at a time with the console
+//      locked, and once there's nothing left to scan, looks for rows that have
+//      changed every so often, until it's stopped.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void FindAll::_ScanLoop() noexcept
+{
+    try
+    {
+        std::unique_lock<std::mutex> guard{ _lock };
+        while (!_stop)
+        {
+            guard.unlock();
+
+            bool morePending = false;
+            {
+                LockConsole();
+                auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+                morePending = _ScanBatch();
+            }
+
+            guard.lock();
+            if (!morePending)
+            {
+                _wake.wait_for(guard, std::chrono::milliseconds(s_PollIntervalMs), [this]() { return _stop; });
+            }
+        }
+    }
+    CATCH_LOG();
+}
+
+// Routine Description:
+// - Works out which rows of the active screen buffer have to be scanned, from
+//      what's changed since it was last looked at, and scans a batch of them.
+//      Must be called with the console locked.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if there are rows left to scan.
+bool FindAll::_ScanBatch()
+{
+    if (!_active)
+    {
+        return false;
+    }
+
+    SCREEN_INFORMATION& screenInfo = ServiceLocator::LocateGlobals().getConsoleInformation().GetActiveOutputBuffer();
+    TextBuffer& textBuffer = screenInfo.GetTextBuffer();
+    const COORD size = textBuffer.GetSize().Dimensions();
+    const uint64_t generation = textBuffer.GetGeneration();
+    const uint64_t circledRows = textBuffer.GetCircledRowCount();
+
+    bool changed = false;
+    if (&textBuffer != _scannedBuffer || size != _scannedSize || circledRows < _scannedCircledRows)
+    {
+        // The buffer's been replaced or resized, so none of what we found in
+        // it before can be trusted.
+        changed = !_matches.empty();
+        _matches.clear();
+        _pendingRows.clear();
+        _current.reset();
+        for (SHORT y = 0; y < size.Y; y++)
+        {
+            _pendingRows.insert(circledRows + y);
+        }
+
+        _scannedBuffer = &textBuffer;
+        _scannedSize = size;
+    }
+    else if (generation != _scannedGeneration)
+    {
+        for (SHORT y = 0; y < size.Y; y++)
+        {
+            if (textBuffer.GetRowGeneration(y) > _scannedGeneration)
+            {
+                // The row above's matches can run on into this one.
+                _pendingRows.insert(circledRows + y);
+                if (y > 0)
+                {
+                    _pendingRows.insert(circledRows + y - 1);
+                }
+            }
+        }
+    }
+
+    // Forget the rows that have circled off the top of the buffer since.
+    if (circledRows > _scannedCircledRows)
+    {
+        const auto gone = _matches.lower_bound(circledRows);
+        changed = changed || gone != _matches.begin();
+        _matches.erase(_matches.begin(), gone);
+        _pendingRows.erase(_pendingRows.begin(), _pendingRows.lower_bound(circledRows));
+        if (_current.has_value() && _current->first < circledRows)
+        {
+            _current.reset();
+        }
+    }
+
+    _scannedGeneration = generation;
+    _scannedCircledRows = circledRows;
+
+    for (size_t scanned = 0; scanned < s_RowsPerBatch && !_pendingRows.empty(); scanned++)
+    {
+        const auto next = _pendingRows.begin();
+        const uint64_t row = *next - circledRows;
+        _pendingRows.erase(next);
+
+        if (row < static_cast<uint64_t>(size.Y))
+        {
+            changed = _ScanRow(textBuffer, static_cast<size_t>(row)) || changed;
+        }
+    }
+
+    if (changed)
+    {
+        textBuffer.GetRenderTarget().TriggerRedraw(screenInfo.GetViewport());
+    }
+
+    return !_pendingRows.empty();
+}
+
+// Routine Description:
+// - Finds the matches that start in the given row, and puts them in place of
+//      the ones found in it before.
+// Arguments:
+// - textBuffer - the buffer to scan.
+// - row - the row to scan, from the top of the buffer.
+// Return Value:
+// - true if the row's matches are different from before.
+bool FindAll::_ScanRow(const TextBuffer& textBuffer, const size_t row)
+{
+    _rowText.clear();
+    _rowColumns.clear();
+
+    // Adds the glyphs of a row to _rowText, until there's at least limit
+    // characters in it, and returns the column of the glyph after the last.
+    const auto appendGlyphs = [this](const CharRow& charRow, const int columnBase, const size_t limit) {
+        const auto cells = charRow.cbegin();
+        size_t column = 0;
+        for (; column < charRow.size() && _rowText.size() < limit; column++)
+        {
+            const auto& cell = cells[column];
+            if (cell.DbcsAttr().IsTrailing())
+            {
+                continue;
+            }
+
+            const size_t offset = _rowText.size();
+            if (cell.DbcsAttr().IsGlyphStored())
+            {
+                _rowText += std::wstring_view{ charRow.GlyphAt(column) };
+            }
+            else
+            {
+                _rowText += cell.Char();
+            }
+            _rowColumns.resize(_rowText.size(), -1);
+            _rowColumns[offset] = columnBase + gsl::narrow_cast<int>(column);
+        }
+
+        while (column < charRow.size() && cells[column].DbcsAttr().IsTrailing())
+        {
+            column++;
+        }
+        return columnBase + gsl::narrow_cast<int>(column);
+    };
+
+    const SHORT width = textBuffer.GetSize().Width();
+    const SHORT height = textBuffer.GetSize().Height();
+    std::optional<ROW> scratch;
+    int endColumn = appendGlyphs(textBuffer.GetRowByOffset(row, scratch).GetCharRow(), 0, SIZE_MAX);
+    const size_t rowLength = _rowText.size();
+
+    // A match can start at the end of this row and run on into the next one,
+    // unless this is the last row in the buffer.
+    if (row + 1 < static_cast<size_t>(height) && _needle.size() > 1)
+    {
+        endColumn = appendGlyphs(textBuffer.GetRowByOffset(row + 1, scratch).GetCharRow(), width, rowLength + _needle.size() - 1);
+    }
+    _rowColumns.push_back(endColumn);
+
+    if (_sensitivity == Search::Sensitivity::CaseInsensitive)
+    {
+        std::transform(_rowText.begin(), _rowText.end(), _rowText.begin(), ::towlower);
+    }
+
+    // The matches don't overlap, so that each of the highlights stands apart.
+    std::vector<Match> matches;
+    size_t offset = 0;
+    while ((offset = Search::s_FindFirst(_rowText, _needle, offset, rowLength)) != std::wstring_view::npos)
+    {
+        const size_t endOffset = offset + _needle.size();
+        if (_rowColumns[offset] >= 0 && _rowColumns[endOffset] >= 0)
+        {
+            matches.push_back({ gsl::narrow_cast<SHORT>(_rowColumns[offset]),
+                                gsl::narrow_cast<size_t>(_rowColumns[endOffset] - _rowColumns[offset]) });
+            offset = endOffset;
+        }
+        else
+        {
+            offset++;
+        }
+    }
+
+    const uint64_t key = _scannedCircledRows + row;
+    const auto found = _matches.find(key);
+    if (matches.empty())
+    {
+        if (found == _matches.end())
+        {
+            return false;
+        }
+        _matches.erase(found);
+        return true;
+    }
+
+    const bool same = found != _matches.end() &&
+                      std::equal(matches.begin(), matches.end(), found->second.begin(), found->second.end(), [](const Match& a, const Match& b) {
+                          return a.column == b.column && a.cells == b.cells;
+                      });
+    if (!same)
+    {
+        _matches[key] = std::move(matches);
+    }
+    return !same;
+}
+
+// Routine Description:
+// - Forgets everything that's been found. Must be called with the console locked.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void FindAll::_Clear()
+{
+    _needle.clear();
+    _active = false;
+    _scannedBuffer = nullptr;
+    _scannedSize = { 0 };
+    _scannedGeneration = 0;
+    _scannedCircledRows = 0;
+    _matches.clear();
+    _pendingRows.clear();
+    _current.reset();
+}
+
+COORD FindAll::_GetStart(const uint64_t row, const Match& match) const noexcept
+{
+    return { match.column, gsl::narrow_cast<SHORT>(row - _scannedCircledRows) };
+}
+
+COORD FindAll::_GetEnd(const uint64_t row, const Match& match) const noexcept
+{
+    const uint64_t cell = (row - _scannedCircledRows) * _scannedSize.X + match.column + match.cells - 1;
+    return { gsl::narrow_cast<SHORT>(cell % _scannedSize.X), gsl::narrow_cast<SHORT>(cell / _scannedSize.X) };
+}
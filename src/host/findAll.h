@@ -0,0 +1,111 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- findAll.h
+
+Abstract:
+- Finds every match of a search term in the active screen buffer, on a thread
+  of its own, so that the window never waits on it.
+- The buffer is scanned a batch of rows at a time, with the console only locked
+  for each batch. Once it's all been scanned, the rows that change are scanned
+  again as they do, found by their generations, so the matches keep up with
+  new output without the whole buffer being read again.
+- The matches that are in view are highlighted as overlays on the buffer, and
+  can be stepped through without searching again.
+--*/
+
+#pragma once
+
+#include "search.h"
+
+#include "../renderer/inc/DummyRenderTarget.hpp"
+#include "../renderer/inc/IRenderData.hpp"
+
+#include <condition_variable>
+#include <memory_resource>
+#include <set>
+
+class FindAll final
+{
+public:
+    static FindAll& Instance();
+
+    ~FindAll();
+
+    // These wait for the scanning thread, so the console mustn't be locked.
+    void Start(const std::wstring& str, const Search::Sensitivity sensitivity);
+    void Stop() noexcept;
+
+    // These must be called with the console locked.
+    bool IsActiveFor(const std::wstring& str, const Search::Sensitivity sensitivity) const;
+    bool SelectNext(const Search::Direction direction);
+    void AppendOverlays(std::vector<Microsoft::Console::Render::RenderOverlay>& overlays);
+
+private:
+    FindAll();
+
+    // A match, by the cell it starts in and how many cells it covers. A match
+    // that starts at the end of a row can run on into the next one.
+    struct Match
+    {
+        SHORT column;
+        size_t cells;
+    };
+
+    // How many rows are scanned each time the console is locked, and how long
+    // to wait before looking for changes again once everything's been scanned.
+    static constexpr size_t s_RowsPerBatch = 256;
+    static constexpr DWORD s_PollIntervalMs = 100;
+
+    // Black on yellow.
+    static constexpr WORD s_HighlightAttributes = BACKGROUND_RED | BACKGROUND_GREEN | BACKGROUND_INTENSITY;
+
+    void _StopThread() noexcept;
+    void _ScanLoop() noexcept;
+    bool _ScanBatch();
+    bool _ScanRow(const TextBuffer& textBuffer, const size_t row);
+    void _Clear();
+
+    COORD _GetStart(const uint64_t row, const Match& match) const noexcept;
+    COORD _GetEnd(const uint64_t row, const Match& match) const noexcept;
+
+    // Guards _stop, which is how the scanning thread is told to finish.
+    std::mutex _lock;
+    std::condition_variable _wake;
+    bool _stop;
+    std::thread _thread;
+
+    // Everything below is only touched with the console locked.
+    std::wstring _needle;
+    Search::Sensitivity _sensitivity;
+    bool _active;
+
+    // The buffer the matches are from, as it was when it was last scanned. If
+    // it's replaced or resized, its rows are all scanned again.
+    const TextBuffer* _scannedBuffer;
+    COORD _scannedSize;
+    uint64_t _scannedGeneration;
+    uint64_t _scannedCircledRows;
+
+    // The matches in each row, by the row's number counting the rows that have
+    // circled off the top of the buffer, so that they don't change as it scrolls.
+    std::map<uint64_t, std::vector<Match>> _matches;
+    std::set<uint64_t> _pendingRows;
+
+    // The match that SelectNext last selected.
+    std::optional<std::pair<uint64_t, SHORT>> _current;
+
+    // Scratch space for a row's text, and the column each of its glyphs starts
+    // in (or -1 for the rest of a glyph stored as more than one character).
+    std::pmr::wstring _rowText;
+    std::vector<int> _rowColumns;
+
+    // The highlights are drawn from a buffer the size of the viewport, which holds
+    // the text of the matches that are in view in the highlight's colors.
+    DummyRenderTarget _overlayRenderTarget;
+    std::unique_ptr<TextBuffer> _overlayBuffer;
+
+    static std::unique_ptr<FindAll> _instance;
+};
@@ -76,6 +76,11 @@ MODULE_SETUP(ModuleSetup)
         v2ModeHelper.reset(new CommonV1V2Helper(CommonV1V2Helper::ForceV2States::V2));
     }
 
+    // Look up a runtime parameter to see if we want the console we built to run without a window
+    // or any renderers. This is for running the perf tests on build agents with no desktop.
+    bool noRender = false;
+    RuntimeParameters::TryGetValue(L"NoRender", noRender);
+
     // Retrieve location of directory that the test was deployed to.
     // We're going to look for OpenConsole.exe in the same directory.
     String value;
@@ -90,7 +95,7 @@ MODULE_SETUP(ModuleSetup)
     else
     {
         // If we're outside or testing V2, let's use the open console binary we built.
-        value = value.Append(L"OpenConsole.exe Nihilist.exe");
+        value = value.Append(noRender ? L"OpenConsole.exe --norender Nihilist.exe" : L"OpenConsole.exe Nihilist.exe");
     }
 
     // Must make mutable string of appropriate length to feed into args.
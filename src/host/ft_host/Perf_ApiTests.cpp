@@ -0,0 +1,340 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+// This class drives the console server through the kinds of API traffic that
+// real clients send, and measures how long it takes. Nothing here verifies
+// output beyond the calls succeeding; that's what the API tests are for.
+//
+// Each scenario logs one line with its throughput and call latencies, in the
+// same format from build to build. To collect them for comparing builds, run
+// with /p:PerfResults=<path> and every scenario appends a row to that CSV file.
+// /p:PerfScale=<n> runs each scenario n times as long, for steadier numbers.
+class PerfApiTests
+{
+    BEGIN_TEST_CLASS(PerfApiTests)
+        TEST_CLASS_PROPERTY(L"IsolationLevel", L"Method")
+        TEST_CLASS_PROPERTY(L"IsPerfTest", L"true")
+        TEST_CLASS_PROPERTY(L"BinaryUnderTest", L"conhost.exe")
+        TEST_CLASS_PROPERTY(L"ArtifactUnderTest", L"wincon.h")
+        TEST_CLASS_PROPERTY(L"ArtifactUnderTest", L"conmsgl1.h")
+        TEST_CLASS_PROPERTY(L"ArtifactUnderTest", L"conmsgl2.h")
+    END_TEST_CLASS()
+
+    TEST_METHOD_SETUP(MethodSetup);
+    TEST_METHOD_CLEANUP(MethodCleanup);
+
+    TEST_METHOD(BulkWriteConsole);
+    TEST_METHOD(WriteConsoleOutputFrames);
+    TEST_METHOD(InputFlood);
+    TEST_METHOD(ManyAttachedProcesses);
+    TEST_METHOD(ScrollStorm);
+};
+
+namespace
+{
+    // Collects how long each call of a scenario took, and reports them.
+    class ScenarioTimer final
+    {
+    public:
+        ScenarioTimer(const wchar_t* const scenario, const wchar_t* const unit) :
+            _scenario{ scenario },
+            _unit{ unit },
+            _samples{},
+            _units{ 0 },
+            _total{}
+        {
+        }
+
+        // Times one call of fn, which does the given amount of the scenario's unit of work.
+        template<typename T>
+        void Measure(const size_t units, T&& fn)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            fn();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            _samples.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+            _units += units;
+            _total += elapsed;
+        }
+
+        void Report()
+        {
+            VERIFY_IS_FALSE(_samples.empty());
+
+            std::sort(_samples.begin(), _samples.end());
+            const double seconds = std::chrono::duration<double>(_total).count();
+            const double throughput = seconds > 0 ? _units / seconds : 0;
+            const double p50 = _Percentile(0.50);
+            const double p99 = _Percentile(0.99);
+            const double max = _samples.back();
+
+            Log::Comment(String().Format(L"PERF %s: %Iu calls, %.0f %s/s, p50 %.1f us, p99 %.1f us, max %.1f us",
+                                         _scenario,
+                                         _samples.size(),
+                                         throughput,
+                                         _unit,
+                                         p50,
+                                         p99,
+                                         max));
+
+            String path;
+            if (SUCCEEDED(RuntimeParameters::TryGetValue(L"PerfResults", path)) && !path.IsEmpty())
+            {
+                const bool existed = CheckIfFileExists(path);
+                std::wofstream results{ static_cast<const wchar_t*>(path), std::ios::app };
+                if (!existed)
+                {
+                    results << L"scenario,calls,unit,throughput,p50us,p99us,maxus\n";
+                }
+                results << _scenario << L',' << _samples.size() << L',' << _unit << L','
+                        << throughput << L',' << p50 << L',' << p99 << L',' << max << L'\n';
+                VERIFY_IS_FALSE(results.fail(), L"Appending to the results file.");
+            }
+        }
+
+    private:
+        const wchar_t* const _scenario;
+        const wchar_t* const _unit;
+        std::vector<double> _samples;
+        size_t _units;
+        std::chrono::steady_clock::duration _total;
+
+        // The sample that the given fraction of the sorted samples are at or below.
+        double _Percentile(const double fraction) const
+        {
+            const size_t rank = static_cast<size_t>(fraction * _samples.size() + 0.999999);
+            return _samples[std::clamp<size_t>(rank, 1, _samples.size()) - 1];
+        }
+    };
+
+    // How many times over to run each scenario.
+    size_t GetScale()
+    {
+        int scale = 1;
+        RuntimeParameters::TryGetValue(L"PerfScale", scale);
+        return gsl::narrow_cast<size_t>(std::max(scale, 1));
+    }
+}
+
+bool PerfApiTests::MethodSetup()
+{
+    return Common::TestBufferSetup();
+}
+
+bool PerfApiTests::MethodCleanup()
+{
+    return Common::TestBufferCleanup();
+}
+
+void PerfApiTests::BulkWriteConsole()
+{
+    const HANDLE out = Common::_hConsole;
+
+    // Lines of plain text, the way a build log or a directory listing comes in.
+    std::wstring chunk;
+    while (chunk.size() < 4000)
+    {
+        chunk += L"The quick brown fox jumps over the lazy dog. 0123456789 ~!@#$%^&*()\r\n";
+    }
+
+    ScenarioTimer timer{ L"BulkWriteConsole", L"chars" };
+    const size_t calls = 500 * GetScale();
+    for (size_t i = 0; i < calls; i++)
+    {
+        timer.Measure(chunk.size(), [&]() {
+            DWORD written = 0;
+            VERIFY_WIN32_BOOL_SUCCEEDED(WriteConsoleW(out, chunk.data(), gsl::narrow<DWORD>(chunk.size()), &written, nullptr));
+        });
+    }
+    timer.Report();
+}
+
+void PerfApiTests::WriteConsoleOutputFrames()
+{
+    const HANDLE out = Common::_hConsole;
+
+    CONSOLE_SCREEN_BUFFER_INFO sbi;
+    VERIFY_WIN32_BOOL_SUCCEEDED(GetConsoleScreenBufferInfo(out, &sbi));
+    const COORD frameSize{ gsl::narrow<SHORT>(sbi.srWindow.Right - sbi.srWindow.Left + 1),
+                           gsl::narrow<SHORT>(sbi.srWindow.Bottom - sbi.srWindow.Top + 1) };
+    const size_t cellCount = gsl::narrow_cast<size_t>(frameSize.X) * frameSize.Y;
+
+    // Two frames that differ in every cell, like a full screen app that redraws
+    // everything each time, so that nothing about a frame is left as it was.
+    std::vector<CHAR_INFO> frames[2];
+    for (size_t f = 0; f < 2; f++)
+    {
+        frames[f].resize(cellCount);
+        for (size_t i = 0; i < cellCount; i++)
+        {
+            frames[f][i].Char.UnicodeChar = static_cast<wchar_t>(L'A' + (i + f) % 26);
+            frames[f][i].Attributes = static_cast<WORD>(1 + (i / frameSize.X + f) % 15);
+        }
+    }
+
+    ScenarioTimer timer{ L"WriteConsoleOutputFrames", L"frames" };
+    const size_t calls = 500 * GetScale();
+    for (size_t i = 0; i < calls; i++)
+    {
+        timer.Measure(1, [&]() {
+            SMALL_RECT region = sbi.srWindow;
+            VERIFY_WIN32_BOOL_SUCCEEDED(WriteConsoleOutputW(out, frames[i % 2].data(), frameSize, { 0, 0 }, &region));
+        });
+    }
+    timer.Report();
+}
+
+void PerfApiTests::InputFlood()
+{
+    const HANDLE in = GetStdInputHandle();
+    VERIFY_WIN32_BOOL_SUCCEEDED(FlushConsoleInputBuffer(in));
+
+    // A paste's worth of key presses and releases, as fast as they can be written.
+    std::vector<INPUT_RECORD> records(512);
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        auto& record = records[i];
+        record.EventType = KEY_EVENT;
+        record.Event.KeyEvent.bKeyDown = (i % 2) == 0;
+        record.Event.KeyEvent.wRepeatCount = 1;
+        record.Event.KeyEvent.wVirtualKeyCode = static_cast<WORD>('A' + (i / 2) % 26);
+        record.Event.KeyEvent.uChar.UnicodeChar = static_cast<wchar_t>(L'a' + (i / 2) % 26);
+    }
+    std::vector<INPUT_RECORD> readBack(records.size());
+
+    ScenarioTimer writeTimer{ L"InputFloodWrite", L"events" };
+    ScenarioTimer readTimer{ L"InputFloodRead", L"events" };
+    const size_t calls = 200 * GetScale();
+    for (size_t i = 0; i < calls; i++)
+    {
+        writeTimer.Measure(records.size(), [&]() {
+            DWORD written = 0;
+            VERIFY_WIN32_BOOL_SUCCEEDED(WriteConsoleInputW(in, records.data(), gsl::narrow<DWORD>(records.size()), &written));
+            VERIFY_ARE_EQUAL(gsl::narrow<DWORD>(records.size()), written);
+        });
+
+        readTimer.Measure(records.size(), [&]() {
+            DWORD read = 0;
+            size_t total = 0;
+            while (total < readBack.size())
+            {
+                VERIFY_WIN32_BOOL_SUCCEEDED(ReadConsoleInputW(in, readBack.data() + total, gsl::narrow<DWORD>(readBack.size() - total), &read));
+                total += read;
+            }
+        });
+    }
+    writeTimer.Report();
+    readTimer.Report();
+}
+
+void PerfApiTests::ManyAttachedProcesses()
+{
+    const HANDLE out = Common::_hConsole;
+    const DWORD childCount = 32;
+
+    // The children are all attached to our console, but have their output sent
+    // nowhere and never read input, and they're done for when the job goes.
+    wil::unique_handle job{ CreateJobObjectW(nullptr, nullptr) };
+    VERIFY_IS_NOT_NULL(job.get());
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+    limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+    VERIFY_WIN32_BOOL_SUCCEEDED(SetInformationJobObject(job.get(), JobObjectExtendedLimitInformation, &limits, sizeof(limits)));
+
+    SECURITY_ATTRIBUTES inheritable{ sizeof(inheritable), nullptr, TRUE };
+    wil::unique_hfile nul{ CreateFileW(L"NUL", GENERIC_READ | GENERIC_WRITE, 0, &inheritable, OPEN_EXISTING, 0, nullptr) };
+    VERIFY_ARE_NOT_EQUAL(INVALID_HANDLE_VALUE, nul.get());
+
+    std::vector<DWORD> processes(childCount * 4);
+    const auto countAttached = [&]() {
+        return GetConsoleProcessList(processes.data(), gsl::narrow<DWORD>(processes.size()));
+    };
+    const DWORD attachedBefore = countAttached();
+
+    ScenarioTimer attachTimer{ L"ProcessAttach", L"processes" };
+    for (DWORD i = 0; i < childCount; i++)
+    {
+        STARTUPINFOW si{ sizeof(si) };
+        si.dwFlags = STARTF_USESTDHANDLES;
+        si.hStdInput = nul.get();
+        si.hStdOutput = nul.get();
+        si.hStdError = nul.get();
+        wil::unique_process_information pi;
+        wchar_t commandLine[] = L"ping.exe -n 600 127.0.0.1";
+
+        attachTimer.Measure(1, [&]() {
+            VERIFY_WIN32_BOOL_SUCCEEDED(CreateProcessW(nullptr, commandLine, nullptr, nullptr, TRUE, CREATE_SUSPENDED, nullptr, nullptr, &si, &pi));
+            VERIFY_WIN32_BOOL_SUCCEEDED(AssignProcessToJobObject(job.get(), pi.hProcess));
+            ResumeThread(pi.hThread);
+            while (countAttached() < attachedBefore + i + 1)
+            {
+                Sleep(0);
+            }
+        });
+    }
+    attachTimer.Report();
+
+    // With that many clients, the calls that have to look through all of them
+    // and plain output both still have to be quick.
+    ScenarioTimer listTimer{ L"ProcessListWithManyAttached", L"calls" };
+    ScenarioTimer writeTimer{ L"WriteWithManyAttached", L"chars" };
+    const std::wstring line{ L"Output while many processes share the console.\r\n" };
+    const size_t calls = 1000 * GetScale();
+    for (size_t i = 0; i < calls; i++)
+    {
+        listTimer.Measure(1, [&]() {
+            VERIFY_IS_GREATER_THAN_OR_EQUAL(countAttached(), attachedBefore + childCount);
+        });
+        writeTimer.Measure(line.size(), [&]() {
+            DWORD written = 0;
+            VERIFY_WIN32_BOOL_SUCCEEDED(WriteConsoleW(out, line.data(), gsl::narrow<DWORD>(line.size()), &written, nullptr));
+        });
+    }
+    listTimer.Report();
+    writeTimer.Report();
+}
+
+void PerfApiTests::ScrollStorm()
+{
+    const HANDLE out = Common::_hConsole;
+
+    CONSOLE_SCREEN_BUFFER_INFO sbi;
+    VERIFY_WIN32_BOOL_SUCCEEDED(GetConsoleScreenBufferInfo(out, &sbi));
+
+    // A tall buffer with the cursor on its last line, so that every line of
+    // output scrolls the whole thing, like a long running log.
+    COORD size = sbi.dwSize;
+    size.Y = 9001;
+    VERIFY_WIN32_BOOL_SUCCEEDED(SetConsoleScreenBufferSize(out, size));
+    VERIFY_WIN32_BOOL_SUCCEEDED(SetConsoleCursorPosition(out, { 0, gsl::narrow<SHORT>(size.Y - 1) }));
+
+    ScenarioTimer newlineTimer{ L"ScrollStormNewlines", L"lines" };
+    const std::wstring lines{ L"a\nb\nc\nd\ne\nf\ng\nh\n" };
+    const size_t calls = 500 * GetScale();
+    for (size_t i = 0; i < calls; i++)
+    {
+        newlineTimer.Measure(8, [&]() {
+            DWORD written = 0;
+            VERIFY_WIN32_BOOL_SUCCEEDED(WriteConsoleW(out, lines.data(), gsl::narrow<DWORD>(lines.size()), &written, nullptr));
+        });
+    }
+    newlineTimer.Report();
+
+    const SMALL_RECT all{ 0, 0, gsl::narrow<SHORT>(size.X - 1), gsl::narrow<SHORT>(size.Y - 1) };
+    const CHAR_INFO fill{ L' ', sbi.wAttributes };
+    ScenarioTimer scrollTimer{ L"ScrollStormScrollBuffer", L"scrolls" };
+    for (size_t i = 0; i < calls; i++)
+    {
+        scrollTimer.Measure(1, [&]() {
+            VERIFY_WIN32_BOOL_SUCCEEDED(ScrollConsoleScreenBufferW(out, &all, nullptr, { 0, -1 }, &fill));
+        });
+    }
+    scrollTimer.Report();
+}
@@ -14,9 +14,11 @@
 #include "cmdline.h"
 
 #include "../types/inc/convert.hpp"
+#include "../types/inc/ScratchArena.hpp"
 #include "../types/inc/viewport.hpp"
 
 #include "ApiRoutines.h"
+#include "MemoryStatistics.hpp"
 
 #include "..\interactivity\inc\ServiceLocator.hpp"
 
@@ -41,9 +43,17 @@ void ApiRoutines::GetConsoleInputModeImpl(InputBuffer& context, ULONG& mode) noe
     try
     {
         Telemetry::Instance().LogApiCall(Telemetry::ApiCall::GetConsoleMode);
-        const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+        ConsoleStateSnapshot::State state;
+        if (gci.stateSnapshot.TryRead(state) && state.inputBuffer == &context)
+        {
+            mode = state.inputMode;
+            return;
+        }
+
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         mode = context.InputMode;
 
@@ -67,8 +77,15 @@ void ApiRoutines::GetConsoleOutputModeImpl(SCREEN_INFORMATION& context, ULONG& m
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        ConsoleStateSnapshot::State state;
+        if (ServiceLocator::LocateGlobals().getConsoleInformation().stateSnapshot.TryRead(state) && state.IsFor(context))
+        {
+            mode = state.outputMode;
+            return;
+        }
+
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         mode = context.GetActiveBuffer().OutputMode;
     }
@@ -87,8 +104,8 @@ HRESULT ApiRoutines::GetNumberOfConsoleInputEventsImpl(const InputBuffer& contex
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         const auto readyEventCount = context.GetNumberOfReadyEvents();
         RETURN_IF_FAILED(SizeTToULong(readyEventCount, &events));
@@ -108,11 +125,27 @@ void ApiRoutines::GetConsoleScreenBufferInfoExImpl(const SCREEN_INFORMATION& con
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
-
         data.bFullscreenSupported = FALSE; // traditional full screen with the driver support is no longer supported.
         // see MSFT: 19918103
+
+        ConsoleStateSnapshot::State state;
+        if (ServiceLocator::LocateGlobals().getConsoleInformation().stateSnapshot.TryRead(state) && state.IsFor(context))
+        {
+            data.dwSize = state.size;
+            data.dwCursorPosition = state.cursorPosition;
+            data.srWindow = state.window;
+            data.wAttributes = state.attributes;
+            data.dwMaximumWindowSize = state.maximumWindowSize;
+            data.wPopupAttributes = state.popupAttributes;
+            std::copy(std::begin(state.colorTable), std::end(state.colorTable), std::begin(data.ColorTable));
+            // Callers of this function expect to recieve an exclusive rect, not an inclusive one.
+            data.srWindow.Right += 1;
+            data.srWindow.Bottom += 1;
+            return;
+        }
+
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
         // Make sure to use the active buffer here. There are clients that will
         //      use WINDOW_SIZE_EVENTs as a signal to then query the console
         //      with GetConsoleScreenBufferInfoEx to get the actual viewport
@@ -146,8 +179,16 @@ void ApiRoutines::GetConsoleCursorInfoImpl(const SCREEN_INFORMATION& context,
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        ConsoleStateSnapshot::State state;
+        if (ServiceLocator::LocateGlobals().getConsoleInformation().stateSnapshot.TryRead(state) && state.IsFor(context))
+        {
+            size = state.cursorSize;
+            isVisible = &context == state.activeBuffer ? state.activeCursorVisible : state.mainCursorVisible;
+            return;
+        }
+
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         size = context.GetActiveBuffer().GetTextBuffer().GetCursor().GetSize();
         isVisible = context.GetTextBuffer().GetCursor().IsVisible();
@@ -163,8 +204,8 @@ void ApiRoutines::GetConsoleSelectionInfoImpl(CONSOLE_SELECTION_INFO& consoleSel
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         const auto& selection = Selection::Instance();
         if (selection.IsInSelectingState())
@@ -921,28 +962,37 @@ void DoSrvPrivateSetDefaultAttributes(SCREEN_INFORMATION& screenInfo,
     buffer.SetAttributes(NewAttributes);
 }
 
-void DoSrvPrivateSetConsoleXtermTextAttribute(SCREEN_INFORMATION& screenInfo,
-                                              const int iXtermTableEntry,
-                                              const bool fIsForeground)
+// Routine Description:
+// - Looks up the color that an entry of the xterm table stands for. The first
+//     16 entries are the console's own colors, in xterm's order.
+// Arguments:
+// - iXtermTableEntry - The entry of the xterm table to look up.
+// Return Value:
+// - The color of that entry.
+COLORREF DoSrvPrivateGetXtermColor(const int iXtermTableEntry)
 {
     const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
-    auto& buffer = screenInfo.GetActiveBuffer();
-    TextAttribute NewAttributes = buffer.GetAttributes();
-
-    COLORREF rgbColor;
     if (iXtermTableEntry < COLOR_TABLE_SIZE)
     {
         //Convert the xterm index to the win index
         WORD iWinEntry = ::XtermToWindowsIndex(iXtermTableEntry);
 
-        rgbColor = gci.GetColorTableEntry(iWinEntry);
+        return gci.GetColorTableEntry(iWinEntry);
     }
     else
     {
-        rgbColor = gci.GetColorTableEntry(iXtermTableEntry);
+        return gci.GetColorTableEntry(iXtermTableEntry);
     }
+}
 
-    NewAttributes.SetColor(rgbColor, fIsForeground);
+void DoSrvPrivateSetConsoleXtermTextAttribute(SCREEN_INFORMATION& screenInfo,
+                                              const int iXtermTableEntry,
+                                              const bool fIsForeground)
+{
+    auto& buffer = screenInfo.GetActiveBuffer();
+    TextAttribute NewAttributes = buffer.GetAttributes();
+
+    NewAttributes.SetColor(DoSrvPrivateGetXtermColor(iXtermTableEntry), fIsForeground);
 
     buffer.SetAttributes(NewAttributes);
 }
@@ -973,6 +1023,16 @@ void DoSrvPrivateBoldText(SCREEN_INFORMATION& screenInfo, const bool bolded)
     buffer.SetAttributes(attrs);
 }
 
+TextAttribute DoSrvPrivateGetTextAttributes(const SCREEN_INFORMATION& screenInfo)
+{
+    return screenInfo.GetActiveBuffer().GetAttributes();
+}
+
+void DoSrvPrivateSetTextAttributes(SCREEN_INFORMATION& screenInfo, const TextAttribute& attrs)
+{
+    screenInfo.GetActiveBuffer().SetAttributes(attrs);
+}
+
 // Routine Description:
 // - Sets the codepage used for translating text when calling A versions of functions affecting the output buffer.
 // Arguments:
@@ -1046,8 +1106,8 @@ void ApiRoutines::GetConsoleInputCodePageImpl(ULONG& codepage) noexcept
     try
     {
         const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         codepage = gci.CP;
     }
@@ -1068,8 +1128,8 @@ void ApiRoutines::GetConsoleOutputCodePageImpl(ULONG& codepage) noexcept
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
         unsigned int uiCodepage;
         DoSrvGetConsoleOutputCodePage(&uiCodepage);
         codepage = uiCodepage;
@@ -1121,8 +1181,8 @@ void ApiRoutines::GetConsoleHistoryInfoImpl(CONSOLE_HISTORY_INFO& consoleHistory
     try
     {
         const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         consoleHistoryInfo.HistoryBufferSize = gci.GetHistoryBufferSize();
         consoleHistoryInfo.NumberOfHistoryBuffers = gci.GetNumberOfHistoryBuffers();
@@ -1159,6 +1219,36 @@ HRESULT ApiRoutines::SetConsoleHistoryInfoImpl(const CONSOLE_HISTORY_INFO& conso
     CATCH_RETURN();
 }
 
+// Routine Description:
+// - Gets how much memory one part of the console is holding. Undocumented, for
+//   finding out which part is to blame when a console has grown too big.
+// Arguments:
+// - subsystem - The part to measure, as a CONSOLE_MEMORY_SUBSYSTEM.
+// - bytes - Receives roughly how many bytes it's holding.
+// - allocations - Receives how many allocations they're in.
+// Return Value:
+// - S_OK, E_INVALIDARG for a part there isn't, or failure code from thrown exception
+HRESULT ApiRoutines::GetConsoleMemoryUsageImpl(const ULONG subsystem,
+                                               ULONG64& bytes,
+                                               ULONG64& allocations) noexcept
+{
+    try
+    {
+        bytes = 0;
+        allocations = 0;
+        RETURN_HR_IF(E_INVALIDARG, subsystem >= MemoryStatistics::s_SubsystemCount);
+
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
+
+        const auto usage = MemoryStatistics::s_Measure().at(subsystem);
+        bytes = usage.bytes;
+        allocations = usage.allocations;
+        return S_OK;
+    }
+    CATCH_RETURN();
+}
+
 // Routine Description:
 // - Gets whether or not the console is full screen
 // Arguments:
@@ -1168,8 +1258,8 @@ void ApiRoutines::GetConsoleDisplayModeImpl(ULONG& flags) noexcept
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         // Initialize flags portion of structure
         flags = 0;
@@ -1638,6 +1728,26 @@ void DoSrvPrivateEnableAlternateScroll(const bool fEnable)
     gci.terminalMouseInput.EnableAlternateScroll(fEnable);
 }
 
+// Routine Description:
+// - A private API call for enabling bracketed paste mode. While it's on, text
+//      pasted into the window is sent to the input between bracketed paste
+//      markers.
+// Parameters:
+// - fEnable - true to enable bracketed paste mode, false to disable.
+// Return value:
+// - STATUS_SUCCESS if handled successfully. Otherwise, an appropriate status code indicating the error.
+[[nodiscard]]
+NTSTATUS DoSrvPrivateEnableBracketedPasteMode(const bool fEnable)
+{
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    if (gci.pInputBuffer == nullptr)
+    {
+        return STATUS_UNSUCCESSFUL;
+    }
+    gci.pInputBuffer->GetTerminalInput().ChangeBracketedPasteMode(fEnable);
+    return STATUS_SUCCESS;
+}
+
 // Routine Description:
 // - A private API call for performing a VT-style erase all operation on the buffer.
 //      See SCREEN_INFORMATION::VtEraseAll's description for details.
@@ -1810,17 +1920,17 @@ HRESULT GetConsoleTitleAImplHelper(gsl::span<char> title,
         RETURN_HR_IF(S_OK, 0 == unicodeNeeded);
 
         // Allocate a unicode buffer of the right size.
+        auto& scratch = ScratchArena::ForThisThread();
         size_t const unicodeSize = unicodeNeeded + 1; // add one for null terminator space
-        std::unique_ptr<wchar_t[]> unicodeBuffer = std::make_unique<wchar_t[]>(unicodeSize);
-        RETURN_IF_NULL_ALLOC(unicodeBuffer);
+        std::pmr::wstring unicodeBuffer(unicodeSize, UNICODE_NULL, &scratch);
 
-        const gsl::span<wchar_t> unicodeSpan(unicodeBuffer.get(), unicodeSize);
+        const gsl::span<wchar_t> unicodeSpan(unicodeBuffer.data(), unicodeSize);
 
         // Retrieve the title in Unicode.
         RETURN_IF_FAILED(GetConsoleTitleWImplHelper(unicodeSpan, unicodeWritten, unicodeNeeded, isOriginal));
 
         // Convert result to A
-        const auto converted = ConvertToA(gci.CP, { unicodeBuffer.get(), unicodeWritten });
+        const auto converted = ConvertToA(gci.CP, { unicodeBuffer.data(), unicodeWritten }, &scratch);
 
         // The legacy A behavior is a bit strange. If the buffer given doesn't have enough space to hold
         // the string without null termination (e.g. the title is 9 long, 10 with null. The buffer given isn't >= 9).
@@ -1881,8 +1991,8 @@ HRESULT ApiRoutines::GetConsoleTitleAImpl(gsl::span<char> title,
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         return GetConsoleTitleAImplHelper(title, written, needed, false);
     }
@@ -1905,8 +2015,8 @@ HRESULT ApiRoutines::GetConsoleTitleWImpl(gsl::span<wchar_t> title,
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         return GetConsoleTitleWImplHelper(title, written, needed, false);
     }
@@ -1929,8 +2039,8 @@ HRESULT ApiRoutines::GetConsoleOriginalTitleAImpl(gsl::span<char> title,
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         return GetConsoleTitleAImplHelper(title, written, needed, true);
     }
@@ -1953,8 +2063,8 @@ HRESULT ApiRoutines::GetConsoleOriginalTitleWImpl(gsl::span<wchar_t> title,
 {
     try
     {
-        LockConsole();
-        auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+        LockConsoleShared();
+        auto Unlock = wil::scope_exit([&] { UnlockConsoleShared(); });
 
         return GetConsoleTitleWImplHelper(title, written, needed, true);
     }
@@ -17,6 +17,7 @@ Revision History:
 #pragma once
 #include "../inc/conattrs.hpp"
 class SCREEN_INFORMATION;
+class TextAttribute;
 
 
 void DoSrvPrivateSetLegacyAttributes(SCREEN_INFORMATION& screenInfo,
@@ -60,6 +61,8 @@ void DoSrvPrivateEnableSGRExtendedMouseMode(const bool fEnable);
 void DoSrvPrivateEnableButtonEventMouseMode(const bool fEnable);
 void DoSrvPrivateEnableAnyEventMouseMode(const bool fEnable);
 void DoSrvPrivateEnableAlternateScroll(const bool fEnable);
+[[nodiscard]]
+NTSTATUS DoSrvPrivateEnableBracketedPasteMode(const bool fEnable);
 
 void DoSrvPrivateSetConsoleXtermTextAttribute(SCREEN_INFORMATION& screenInfo,
                                               const int iXtermTableEntry,
@@ -70,6 +73,10 @@ void DoSrvPrivateSetConsoleRGBTextAttribute(SCREEN_INFORMATION& screenInfo,
 
 void DoSrvPrivateBoldText(SCREEN_INFORMATION& screenInfo, const bool bolded);
 
+TextAttribute DoSrvPrivateGetTextAttributes(const SCREEN_INFORMATION& screenInfo);
+void DoSrvPrivateSetTextAttributes(SCREEN_INFORMATION& screenInfo, const TextAttribute& attrs);
+COLORREF DoSrvPrivateGetXtermColor(const int iXtermTableEntry);
+
 [[nodiscard]]
 NTSTATUS DoSrvPrivateEraseAll(SCREEN_INFORMATION& screenInfo);
 
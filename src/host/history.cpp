@@ -28,20 +28,93 @@
 // (where other collections like deque do not.)
 // If CommandHistory::s_Allocate and friends stop shuffling elements
 // for maintaining LRU, then this datatype can be changed.
+// Elements are only ever moved around with splice, so that the lookups
+// below can hold on to iterators to them.
 std::list<CommandHistory> CommandHistory::s_historyLists;
+std::unordered_map<HANDLE, CommandHistory::HistoryIterator> CommandHistory::s_historiesByProcess;
+std::unordered_map<std::wstring_view,
+                   std::vector<CommandHistory::HistoryIterator>,
+                   CommandHistory::AppNameHash,
+                   CommandHistory::AppNameEqual> CommandHistory::s_historiesByAppName;
 
-CommandHistory* CommandHistory::s_Find(const HANDLE processHandle)
+size_t CommandHistory::AppNameHash::operator()(const std::wstring_view appName) const noexcept
 {
-    for (auto& historyList : s_historyLists)
+    // FNV-1a, over the lower case folding of the name.
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto wch : appName)
+    {
+        hash ^= ::towlower(wch);
+        hash *= 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+bool CommandHistory::AppNameEqual::operator()(const std::wstring_view a, const std::wstring_view b) const noexcept
+{
+    return std::equal(a.cbegin(), a.cend(), b.cbegin(), b.cend(), [](wchar_t x, wchar_t y) noexcept {
+        return ::towlower(x) == ::towlower(y);
+    });
+}
+
+// Routine Description:
+// - Adds a history to the lookup by app name, as the most recently used one with its name.
+// Arguments:
+// - it - the history, which must be in s_historyLists.
+void CommandHistory::s_IndexByAppName(const HistoryIterator it)
+{
+    auto& histories = s_historiesByAppName[it->_appName];
+    histories.insert(histories.cbegin(), it);
+}
+
+// Routine Description:
+// - Takes a history out of the lookup by app name.
+// Arguments:
+// - it - the history, which must be in s_historyLists.
+void CommandHistory::s_UnindexByAppName(const HistoryIterator it)
+{
+    const auto found = s_historiesByAppName.find(it->_appName);
+    if (found != s_historiesByAppName.end())
     {
-        if (historyList._processHandle == processHandle)
+        auto& histories = found->second;
+        histories.erase(std::remove(histories.begin(), histories.end(), it), histories.end());
+        if (histories.empty())
         {
-            FAIL_FAST_IF(WI_IsFlagClear(historyList.Flags, CLE_ALLOCATED));
-            return &historyList;
+            s_historiesByAppName.erase(found);
+        }
+        else if (found->first.data() == it->_appName.data())
+        {
+            // The key is a view of this history's name, which may be about to change,
+            // so it has to be a view of one of the histories that are left instead.
+            auto node = s_historiesByAppName.extract(found);
+            node.key() = node.mapped().front()->_appName;
+            s_historiesByAppName.insert(std::move(node));
         }
     }
+}
 
-    return nullptr;
+// Routine Description:
+// - Makes a history the most recently used one.
+// Arguments:
+// - it - the history, which must be in s_historyLists.
+void CommandHistory::s_MoveToFront(const HistoryIterator it)
+{
+    s_historyLists.splice(s_historyLists.begin(), s_historyLists, it);
+
+    auto& histories = s_historiesByAppName.at(it->_appName);
+    const auto found = std::find(histories.begin(), histories.end(), it);
+    std::rotate(histories.begin(), found, std::next(found));
+}
+
+CommandHistory* CommandHistory::s_Find(const HANDLE processHandle)
+{
+    const auto found = s_historiesByProcess.find(processHandle);
+    if (found == s_historiesByProcess.end())
+    {
+        return nullptr;
+    }
+
+    FAIL_FAST_IF(WI_IsFlagClear(found->second->Flags, CLE_ALLOCATED));
+    return &*found->second;
 }
 
 // Routine Description:
@@ -50,11 +123,13 @@ CommandHistory* CommandHistory::s_Find(const HANDLE processHandle)
 // - processHandle - handle to client process.
 void CommandHistory::s_Free(const HANDLE processHandle)
 {
-    CommandHistory* const History = CommandHistory::s_Find(processHandle);
-    if (History)
+    const auto found = s_historiesByProcess.find(processHandle);
+    if (found != s_historiesByProcess.end())
     {
-        WI_ClearFlag(History->Flags, CLE_ALLOCATED);
-        History->_processHandle = nullptr;
+        CommandHistory& History = *found->second;
+        WI_ClearFlag(History.Flags, CLE_ALLOCATED);
+        History._processHandle = nullptr;
+        s_historiesByProcess.erase(found);
     }
 }
 
@@ -70,14 +145,112 @@ void CommandHistory::s_ResizeAll(const size_t commands)
     }
 }
 
-static bool CaseInsensitiveEquality(wchar_t a, wchar_t b)
+bool CommandHistory::IsAppNameMatch(const std::wstring_view other) const
 {
-    return ::towlower(a) == ::towlower(b);
+    return AppNameEqual{}(_appName, other);
 }
 
-bool CommandHistory::IsAppNameMatch(const std::wstring_view other) const
+// Routine Description:
+// - Folds a command to lower case, the way commands are compared when they're searched for.
+std::wstring CommandHistory::s_Fold(const std::wstring_view command)
+{
+    std::wstring folded{ command };
+    std::transform(folded.begin(), folded.end(), folded.begin(), ::towlower);
+    return folded;
+}
+
+// Routine Description:
+// - Adds a command after the newest one, and to the prefix index.
+// Arguments:
+// - command - the command to add
+void CommandHistory::_Append(std::wstring command)
+{
+    auto folded = s_Fold(command);
+    _commands.emplace_back(std::move(command));
+    auto unappend = wil::scope_exit([&]() { _commands.pop_back(); });
+
+    _ids.push_back(_nextId);
+    auto unid = wil::scope_exit([&]() { _ids.pop_back(); });
+
+    _prefixIndex[std::move(folded)].push_back(_nextId);
+
+    unid.release();
+    unappend.release();
+    ++_nextId;
+}
+
+// Routine Description:
+// - Opens the file this app's commands are kept in between sessions, if that's turned on,
+//   and loads the newest of them. Only the commands that will fit are read from it.
+void CommandHistory::_OpenStore()
+{
+    _store.reset();
+
+    const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    if (!gci.GetPersistHistory() || _maxCommands <= 0)
+    {
+        return;
+    }
+
+    try
+    {
+        auto store = HistoryStore::s_OpenForApp(_appName);
+        for (auto& command : store->ReadNewest(gsl::narrow_cast<size_t>(_maxCommands)))
+        {
+            if (!command.empty())
+            {
+                _Append(std::move(command));
+            }
+        }
+        _store = std::move(store);
+    }
+    CATCH_LOG();
+
+    LastDisplayed = gsl::narrow<SHORT>(_commands.size()) - 1;
+}
+
+// Routine Description:
+// - Takes the command at the given index out of the prefix index, before it's erased from _commands.
+// Arguments:
+// - index - the index of the command
+void CommandHistory::_Unindex(const SHORT index)
+{
+    const auto id = _ids.at(index);
+    const auto found = _prefixIndex.find(s_Fold(_commands.at(index)));
+    if (found != _prefixIndex.end())
+    {
+        auto& ids = found->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+        if (ids.empty())
+        {
+            _prefixIndex.erase(found);
+        }
+    }
+    _ids.erase(_ids.cbegin() + index);
+}
+
+// Routine Description:
+// - Indexes all the commands again, after they were moved around or replaced.
+void CommandHistory::_RebuildIndex()
+{
+    _prefixIndex.clear();
+    _ids.clear();
+    _nextId = 0;
+
+    _ids.reserve(_commands.size());
+    for (const auto& command : _commands)
+    {
+        _prefixIndex[s_Fold(command)].push_back(_nextId);
+        _ids.push_back(_nextId++);
+    }
+}
+
+// Routine Description:
+// - Finds the index of the command with the given ID.
+SHORT CommandHistory::_IndexOf(const size_t id) const
 {
-    return std::equal(_appName.cbegin(), _appName.cend(), other.cbegin(), other.cend(), CaseInsensitiveEquality);
+    const auto found = std::lower_bound(_ids.cbegin(), _ids.cend(), id);
+    return gsl::narrow<SHORT>(found - _ids.cbegin());
 }
 
 // Routine Description:
@@ -121,6 +294,7 @@ HRESULT CommandHistory::Add(const std::wstring_view newCommand,
             // find free record.  if all records are used, free the lru one.
             if ((SHORT)_commands.size() == _maxCommands)
             {
+                _Unindex(0);
                 _commands.erase(_commands.cbegin());
                 // move LastDisplayed back one in order to stay synced with the
                 // command it referred to before erasing the lru one
@@ -130,11 +304,20 @@ HRESULT CommandHistory::Add(const std::wstring_view newCommand,
             // add newCommand to array
             if (!reuse.empty())
             {
-                _commands.emplace_back(reuse);
+                _Append(std::move(reuse));
             }
             else
             {
-                _commands.emplace_back(newCommand);
+                _Append(std::wstring{ newCommand });
+            }
+
+            if (_store)
+            {
+                try
+                {
+                    _store->Append(newCommand);
+                }
+                CATCH_LOG();
             }
 
             if (LastDisplayed == -1 ||
@@ -245,7 +428,17 @@ std::wstring_view CommandHistory::GetLastCommand() const
 
 void CommandHistory::Empty()
 {
+    if (_store)
+    {
+        try
+        {
+            _store->Clear();
+        }
+        CATCH_LOG();
+    }
+
     _commands.clear();
+    _RebuildIndex();
     LastDisplayed = -1;
     Flags = CLE_RESET;
 }
@@ -288,6 +481,8 @@ void CommandHistory::Realloc(const size_t commands)
         _commands.emplace_back(oldCommands[i]);
     }
 
+    _RebuildIndex();
+
     WI_SetFlag(Flags, CLE_RESET);
     LastDisplayed = gsl::narrow<SHORT>(_commands.size()) - 1;
     _maxCommands = (SHORT)commands;
@@ -295,16 +490,18 @@ void CommandHistory::Realloc(const size_t commands)
 
 void CommandHistory::s_ReallocExeToFront(const std::wstring_view appName, const size_t commands)
 {
-    for (auto it = s_historyLists.begin(); it != s_historyLists.end(); it++)
+    const auto found = s_historiesByAppName.find(appName);
+    if (found == s_historiesByAppName.end())
     {
-        if (WI_IsFlagSet(it->Flags, CLE_ALLOCATED) && it->IsAppNameMatch(appName))
-        {
-            CommandHistory backup = *it;
-            backup.Realloc(commands);
-
-            s_historyLists.erase(it);
-            s_historyLists.push_front(backup);
+        return;
+    }
 
+    for (const auto it : found->second)
+    {
+        if (WI_IsFlagSet(it->Flags, CLE_ALLOCATED))
+        {
+            it->Realloc(commands);
+            s_MoveToFront(it);
             return;
         }
     }
@@ -312,11 +509,15 @@ void CommandHistory::s_ReallocExeToFront(const std::wstring_view appName, const
 
 CommandHistory* CommandHistory::s_FindByExe(const std::wstring_view appName)
 {
-    for (auto& historyList : s_historyLists)
+    const auto found = s_historiesByAppName.find(appName);
+    if (found != s_historiesByAppName.end())
     {
-        if (WI_IsFlagSet(historyList.Flags, CLE_ALLOCATED) && historyList.IsAppNameMatch(appName))
+        for (const auto it : found->second)
         {
-            return &historyList;
+            if (WI_IsFlagSet(it->Flags, CLE_ALLOCATED))
+            {
+                return &*it;
+            }
         }
     }
     return nullptr;
@@ -327,6 +528,31 @@ size_t CommandHistory::s_CountOfHistories()
     return s_historyLists.size();
 }
 
+// Routine Description:
+// - Estimates how much memory all of the command histories are holding, along
+//   with the tables they're found by.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of every history.
+Microsoft::Console::Types::MemoryUsage CommandHistory::s_MeasureMemory() noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddNodes(s_historyLists);
+    for (const auto& history : s_historyLists)
+    {
+        usage += history.MeasureMemory();
+    }
+
+    usage.AddHashTable(s_historiesByProcess);
+    usage.AddHashTable(s_historiesByAppName);
+    for (const auto& entry : s_historiesByAppName)
+    {
+        usage.AddContiguous(entry.second);
+    }
+    return usage;
+}
+
 // Routine Description:
 // - This routine returns the LRU command history buffer, or the command history buffer that corresponds to the app name.
 // Arguments:
@@ -338,19 +564,19 @@ CommandHistory* CommandHistory::s_Allocate(const std::wstring_view appName, cons
     CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
     // Reuse a history buffer.  The buffer must be !CLE_ALLOCATED.
     // If possible, the buffer should have the same app name.
-    std::optional<CommandHistory> BestCandidate;
+    auto BestCandidate = s_historyLists.end();
     bool SameApp = false;
 
-    for (auto it = s_historyLists.cbegin(); it != s_historyLists.cend(); it++)
+    // use LRU history buffer with same app name
+    const auto sameName = s_historiesByAppName.find(appName);
+    if (sameName != s_historiesByAppName.end())
     {
-        if (WI_IsFlagClear(it->Flags, CLE_ALLOCATED))
+        for (const auto it : sameName->second)
         {
-            // use LRU history buffer with same app name
-            if (it->IsAppNameMatch(appName))
+            if (WI_IsFlagClear(it->Flags, CLE_ALLOCATED))
             {
-                BestCandidate = *it;
+                BestCandidate = it;
                 SameApp = true;
-                s_historyLists.erase(it);
                 break;
             }
         }
@@ -367,37 +593,56 @@ CommandHistory* CommandHistory::s_Allocate(const std::wstring_view appName, cons
         History.LastDisplayed = -1;
         History._maxCommands = gsl::narrow<SHORT>(gci.GetHistoryBufferSize());
         History._processHandle = processHandle;
-        return &s_historyLists.emplace_front(History);
+        History._OpenStore();
+
+        s_historyLists.emplace_front(std::move(History));
+        const auto it = s_historyLists.begin();
+        auto unlist = wil::scope_exit([&]() { s_historyLists.erase(it); });
+
+        s_IndexByAppName(it);
+        auto unindex = wil::scope_exit([&]() { s_UnindexByAppName(it); });
+
+        s_historiesByProcess.emplace(processHandle, it);
+
+        unindex.release();
+        unlist.release();
+        return &*it;
     }
-    else if (!BestCandidate.has_value() && s_historyLists.size() > 0)
+    else if (BestCandidate == s_historyLists.end() && s_historyLists.size() > 0)
     {
         // If we have no candidate already and we need one, take the LRU (which is the back/last one) which isn't allocated.
-        for (auto it = s_historyLists.crbegin(); it != s_historyLists.crend(); it++)
+        for (auto it = s_historyLists.rbegin(); it != s_historyLists.rend(); it++)
         {
             if (WI_IsFlagClear(it->Flags, CLE_ALLOCATED))
             {
-                BestCandidate = *it;
-                s_historyLists.erase(std::next(it).base()); // trickery to turn reverse iterator into forward iterator for erase.
+                BestCandidate = std::next(it).base(); // trickery to turn reverse iterator into forward iterator.
                 break;
             }
         }
-
     }
 
     // If the app name doesn't match, copy in the new app name and free the old commands.
-    if (BestCandidate.has_value())
+    if (BestCandidate != s_historyLists.end())
     {
+        s_historiesByProcess.emplace(processHandle, BestCandidate);
+
         if (!SameApp)
         {
+            // The lookup by name holds a view of the old name, so the history comes out of it before it changes.
+            s_UnindexByAppName(BestCandidate);
             BestCandidate->_commands.clear();
+            BestCandidate->_RebuildIndex();
             BestCandidate->LastDisplayed = -1;
             BestCandidate->_appName = appName;
+            BestCandidate->_OpenStore();
+            s_IndexByAppName(BestCandidate);
         }
 
         BestCandidate->_processHandle = processHandle;
         WI_SetFlag(BestCandidate->Flags, CLE_ALLOCATED);
 
-        return &s_historyLists.emplace_front(BestCandidate.value());
+        s_MoveToFront(BestCandidate);
+        return &*BestCandidate;
     }
 
     return nullptr;
@@ -469,6 +714,7 @@ std::wstring CommandHistory::Remove(const SHORT iDel)
     try
     {
         const auto str = _commands.at(iDel);
+        _Unindex(iDel);
 
         if (iDel < iLast)
         {
@@ -527,22 +773,56 @@ bool CommandHistory::FindMatchingCommand(const std::wstring_view givenCommand,
         return true;
     }
 
+    const SHORT count = gsl::narrow<SHORT>(_commands.size());
+    if (indexFound < 0 || indexFound >= count)
+    {
+        return false;
+    }
+
     try
     {
-        for (size_t i = 0; i < _commands.size(); i++)
-        {
-            const auto& storedCommand = _commands.at(indexFound);
-            if ((WI_IsFlagClear(options, MatchOptions::ExactMatch) && (givenCommand.size() <= storedCommand.size())) || (givenCommand.size() == storedCommand.size()))
+        // Of the commands that match, the one we find is the one that's the fewest steps back from
+        // indexFound, going around from the oldest command to the newest.
+        const SHORT start = indexFound;
+        bool found = false;
+        SHORT fewestSteps = count;
+        const auto consider = [&](const std::vector<size_t>& ids) {
+            for (const auto id : ids)
             {
-                if (std::equal(storedCommand.begin(), storedCommand.begin() + givenCommand.size(),
-                               givenCommand.begin(), givenCommand.end(),
-                               CaseInsensitiveEquality))
+                const SHORT index = _IndexOf(id);
+                const SHORT steps = gsl::narrow_cast<SHORT>((start - index + count) % count);
+                if (steps < fewestSteps)
                 {
-                    return true;
+                    fewestSteps = steps;
+                    indexFound = index;
+                    found = true;
                 }
             }
+        };
+
+        const auto folded = s_Fold(givenCommand);
+        if (WI_IsFlagSet(options, MatchOptions::ExactMatch))
+        {
+            const auto exact = _prefixIndex.find(folded);
+            if (exact != _prefixIndex.end())
+            {
+                consider(exact->second);
+            }
+        }
+        else
+        {
+            // The commands that start with the given one are all together in the index, from where it would go.
+            for (auto it = _prefixIndex.lower_bound(folded);
+                 it != _prefixIndex.end() && it->first.compare(0, folded.size(), folded) == 0;
+                 ++it)
+            {
+                consider(it->second);
+            }
+        }
 
-            _Prev(indexFound);
+        if (found)
+        {
+            return true;
         }
     }
     CATCH_LOG();
@@ -553,10 +833,44 @@ bool CommandHistory::FindMatchingCommand(const std::wstring_view givenCommand,
 #ifdef UNIT_TESTING
 void CommandHistory::s_ClearHistoryListStorage()
 {
+    s_historiesByProcess.clear();
+    s_historiesByAppName.clear();
     s_historyLists.clear();
 }
 #endif
 
+// Routine Description:
+// - Estimates how much memory this history's commands and their index are
+//   holding. The history itself is counted by s_MeasureMemory.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of this history.
+Microsoft::Console::Types::MemoryUsage CommandHistory::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddContiguous(_commands);
+    for (const auto& command : _commands)
+    {
+        usage.AddContiguous(command);
+    }
+
+    usage.AddNodes(_prefixIndex);
+    for (const auto& entry : _prefixIndex)
+    {
+        usage.AddContiguous(entry.first);
+        usage.AddContiguous(entry.second);
+    }
+    usage.AddContiguous(_ids);
+    usage.AddContiguous(_appName);
+
+    if (_store)
+    {
+        usage.AddAllocation(sizeof(HistoryStore));
+    }
+    return usage;
+}
+
 // Routine Description:
 // - swaps the locations of two history items
 // Arguments:
@@ -565,6 +879,11 @@ void CommandHistory::s_ClearHistoryListStorage()
 void CommandHistory::Swap(const short indexA, const short indexB)
 {
     std::swap(_commands.at(indexA), _commands.at(indexB));
+
+    // The IDs belong to the indices rather than to the commands, so the two that
+    // changed places now have each other's. This only comes from the command list
+    // popup, a command at a time, so going over all of them again is fine.
+    _RebuildIndex();
 }
 
 // Routine Description:
@@ -12,6 +12,9 @@ Abstract:
 
 #pragma once
 
+#include "historyStore.h"
+#include "../types/inc/MemoryUsage.hpp"
+
 // CommandHistory Flags
 #define CLE_ALLOCATED 0x00000001
 #define CLE_RESET     0x00000002
@@ -26,6 +29,7 @@ public:
     static void s_Free(const HANDLE processHandle);
     static void s_ResizeAll(const size_t commands);
     static size_t s_CountOfHistories();
+    static Microsoft::Console::Types::MemoryUsage s_MeasureMemory() noexcept;
 
     enum class MatchOptions
     {
@@ -75,6 +79,8 @@ public:
 
     void Swap(const short indexA, const short indexB);
 
+    Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+
 private:
     void _Reset();
 
@@ -86,15 +92,56 @@ private:
     void _Dec(SHORT& ind) const;
     void _Inc(SHORT& ind) const;
 
+    void _Append(std::wstring command);
+    void _OpenStore();
+    void _Unindex(const SHORT index);
+    void _RebuildIndex();
+    SHORT _IndexOf(const size_t id) const;
+
+    static std::wstring s_Fold(const std::wstring_view command);
 
     std::vector<std::wstring> _commands;
     SHORT _maxCommands;
 
+    // The commands in order of their lower case folding, so that the ones that start with what's
+    // been typed (F8) or are the same as a new one (HISTORY_NO_DUP) are found without comparing
+    // against every command. Each command has an ID, kept in _ids at the command's index. The IDs
+    // only grow from the oldest command to the newest, so they stay sorted as commands come and go,
+    // and a command's index is found from its ID by binary search.
+    std::map<std::wstring, std::vector<size_t>, std::less<>> _prefixIndex;
+    std::vector<size_t> _ids;
+    size_t _nextId = 0;
+
     std::wstring _appName;
     HANDLE _processHandle;
 
+    // Where the commands are kept between sessions, if they are. Commands are only ever
+    // added to the end of it, so removing or moving them around only lasts this session.
+    std::unique_ptr<HistoryStore> _store;
+
+    using HistoryIterator = std::list<CommandHistory>::iterator;
+
+    // App names are matched without regard to case.
+    struct AppNameHash
+    {
+        size_t operator()(const std::wstring_view appName) const noexcept;
+    };
+    struct AppNameEqual
+    {
+        bool operator()(const std::wstring_view a, const std::wstring_view b) const noexcept;
+    };
+
     static std::list<CommandHistory> s_historyLists;
 
+    // The allocated histories by the process they belong to, and all of them by their app name,
+    // most recently used first. The names are views of the histories' own _appName.
+    static std::unordered_map<HANDLE, HistoryIterator> s_historiesByProcess;
+    static std::unordered_map<std::wstring_view, std::vector<HistoryIterator>, AppNameHash, AppNameEqual> s_historiesByAppName;
+
+    static void s_IndexByAppName(const HistoryIterator it);
+    static void s_UnindexByAppName(const HistoryIterator it);
+    static void s_MoveToFront(const HistoryIterator it);
+
 public:
     DWORD Flags;
     SHORT LastDisplayed;
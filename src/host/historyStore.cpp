@@ -0,0 +1,298 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "historyStore.h"
+
+#pragma hdrstop
+
+// Routine Description:
+// - Opens the history file at the given path, creating it if it isn't there. A file
+//   that isn't a history file (or is from another version) is started over.
+// Arguments:
+// - path - location of the history file
+// Return Value:
+// - constructed object
+// Note: will throw exception if the file cannot be opened
+HistoryStore::HistoryStore(const std::wstring_view path)
+{
+    const std::wstring filePath{ path };
+    _file.reset(CreateFileW(filePath.c_str(),
+                            GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            nullptr,
+                            OPEN_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL,
+                            nullptr));
+    THROW_LAST_ERROR_IF(!_file);
+
+    const HeaderLock lock{ _file.get() };
+    if (_ReadHeader().signature != s_Signature)
+    {
+        _ClearLocked();
+    }
+}
+
+// Routine Description:
+// - Opens the history file for an app, in the user's local app data.
+// Arguments:
+// - appName - the name of the app's executable
+// Return Value:
+// - the app's history file
+// Note: will throw exception if the file cannot be opened
+std::unique_ptr<HistoryStore> HistoryStore::s_OpenForApp(const std::wstring_view appName)
+{
+    return std::make_unique<HistoryStore>(s_GetPath(appName));
+}
+
+// Routine Description:
+// - Gets where an app's history file goes, creating the directories on the way to it.
+// Arguments:
+// - appName - the name of the app's executable
+// Return Value:
+// - the path of the app's history file
+std::wstring HistoryStore::s_GetPath(const std::wstring_view appName)
+{
+    THROW_HR_IF(E_INVALIDARG, appName.empty());
+
+    wchar_t localAppData[MAX_PATH + 1];
+    const auto length = GetEnvironmentVariableW(L"LOCALAPPDATA", localAppData, ARRAYSIZE(localAppData));
+    THROW_LAST_ERROR_IF(length == 0);
+    THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_BUFFER_OVERFLOW), length >= ARRAYSIZE(localAppData));
+
+    std::wstring path{ localAppData, length };
+    for (const auto directory : { L"\\Microsoft", L"\\Console", L"\\History" })
+    {
+        path += directory;
+        if (!CreateDirectoryW(path.c_str(), nullptr))
+        {
+            THROW_LAST_ERROR_IF(GetLastError() != ERROR_ALREADY_EXISTS);
+        }
+    }
+
+    // App names are matched without regard to case, so the file name is folded too.
+    std::wstring fileName{ appName };
+    std::transform(fileName.begin(), fileName.end(), fileName.begin(), [](const wchar_t wch) {
+        return std::wstring_view{ L"\\/:*?\"<>|" }.find(wch) == std::wstring_view::npos ? ::towlower(wch) : L'_';
+    });
+
+    path += L'\\';
+    path += fileName;
+    path += L".history";
+    return path;
+}
+
+// Routine Description:
+// - Reads the newest commands in the file.
+// - If the file has grown too big, it's rewritten with just these.
+// Arguments:
+// - count - the most commands to read
+// Return Value:
+// - the commands, oldest first
+// Note: will throw exception on I/O failure, or if the file is damaged
+std::vector<std::wstring> HistoryStore::ReadNewest(const size_t count)
+{
+    const HeaderLock lock{ _file.get() };
+
+    auto commands = _ReadNewestLocked(count);
+    if (_ReadHeader().end > s_CompactSize)
+    {
+        _Compact(commands);
+    }
+    return commands;
+}
+
+// Routine Description:
+// - Adds a command to the end of the file.
+// Arguments:
+// - command - the command to add
+// Note: will throw exception on I/O failure
+void HistoryStore::Append(const std::wstring_view command)
+{
+    const HeaderLock lock{ _file.get() };
+
+    auto header = _ReadHeader();
+
+    // The header's only updated once the command is all there, so a command that
+    // didn't get written in full is just never found.
+    const RecordHeader record{ header.newest, gsl::narrow<uint32_t>(command.size()) };
+    std::vector<BYTE> data(sizeof(record) + command.size() * sizeof(wchar_t));
+    memcpy(data.data(), &record, sizeof(record));
+    memcpy(data.data() + sizeof(record), command.data(), command.size() * sizeof(wchar_t));
+    _Write(header.end, data.data(), data.size());
+
+    header.newest = header.end;
+    header.end += data.size();
+    _Write(0, &header, sizeof(header));
+}
+
+// Routine Description:
+// - Forgets all of the commands in the file.
+// Note: will throw exception on I/O failure
+void HistoryStore::Clear()
+{
+    const HeaderLock lock{ _file.get() };
+    _ClearLocked();
+}
+
+// Routine Description:
+// - Empties the file, leaving just a header. The header lock must be held.
+// Note: will throw exception on I/O failure
+void HistoryStore::_ClearLocked()
+{
+    const FileHeader header{ s_Signature, s_Version, 0, sizeof(FileHeader) };
+    _Write(0, &header, sizeof(header));
+
+    LARGE_INTEGER position;
+    position.QuadPart = sizeof(header);
+    THROW_IF_WIN32_BOOL_FALSE(SetFilePointerEx(_file.get(), position, nullptr, FILE_BEGIN));
+    THROW_IF_WIN32_BOOL_FALSE(SetEndOfFile(_file.get()));
+}
+
+HistoryStore::HeaderLock::HeaderLock(const HANDLE file) :
+    _file{ file }
+{
+    OVERLAPPED overlapped{};
+    THROW_IF_WIN32_BOOL_FALSE(LockFileEx(_file,
+                                         LOCKFILE_EXCLUSIVE_LOCK,
+                                         0,
+                                         sizeof(FileHeader),
+                                         0,
+                                         &overlapped));
+}
+
+HistoryStore::HeaderLock::~HeaderLock()
+{
+    OVERLAPPED overlapped{};
+    LOG_IF_WIN32_BOOL_FALSE(UnlockFileEx(_file, 0, sizeof(FileHeader), 0, &overlapped));
+}
+
+// Routine Description:
+// - Reads the file's header. The header lock must be held.
+// Return Value:
+// - the header. Its signature is 0 if the file doesn't have a valid one.
+// Note: will throw exception on I/O failure
+HistoryStore::FileHeader HistoryStore::_ReadHeader()
+{
+    FileHeader header{};
+    OVERLAPPED overlapped{};
+    DWORD read = 0;
+    THROW_IF_WIN32_BOOL_FALSE(ReadFile(_file.get(), &header, sizeof(header), &read, &overlapped));
+
+    LARGE_INTEGER size;
+    THROW_IF_WIN32_BOOL_FALSE(GetFileSizeEx(_file.get(), &size));
+
+    if (read != sizeof(header) ||
+        header.signature != s_Signature ||
+        header.version != s_Version ||
+        header.end < sizeof(header) ||
+        header.end > gsl::narrow<uint64_t>(size.QuadPart) ||
+        header.newest >= header.end)
+    {
+        return {};
+    }
+    return header;
+}
+
+// Routine Description:
+// - Writes to the file at the given offset.
+// Note: will throw exception on I/O failure
+void HistoryStore::_Write(const uint64_t offset, const void* const data, const size_t length)
+{
+    ULARGE_INTEGER position;
+    position.QuadPart = offset;
+
+    OVERLAPPED overlapped{};
+    overlapped.Offset = position.LowPart;
+    overlapped.OffsetHigh = position.HighPart;
+
+    DWORD written = 0;
+    THROW_IF_WIN32_BOOL_FALSE(WriteFile(_file.get(), data, gsl::narrow<DWORD>(length), &written, &overlapped));
+    THROW_HR_IF(E_UNEXPECTED, written != length);
+}
+
+// Routine Description:
+// - Reads the newest commands by walking back from the newest one, through a view
+//   of the file. The header lock must be held.
+// Arguments:
+// - count - the most commands to read
+// Return Value:
+// - the commands, oldest first
+// Note: will throw exception on I/O failure, or if the file is damaged
+std::vector<std::wstring> HistoryStore::_ReadNewestLocked(const size_t count)
+{
+    const auto header = _ReadHeader();
+    THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), header.signature != s_Signature);
+
+    std::vector<std::wstring> commands;
+    if (header.newest == 0 || count == 0)
+    {
+        return commands;
+    }
+
+    wil::unique_handle mapping{ CreateFileMappingW(_file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+    THROW_LAST_ERROR_IF(!mapping);
+
+    const wil::unique_mapview_ptr<BYTE> view{ static_cast<BYTE*>(MapViewOfFile(mapping.get(),
+                                                                                FILE_MAP_READ,
+                                                                                0,
+                                                                                0,
+                                                                                gsl::narrow<SIZE_T>(header.end))) };
+    THROW_LAST_ERROR_IF(!view);
+
+    // Each record points back at an earlier one, so a damaged file can't send this
+    // around in circles.
+    uint64_t offset = header.newest;
+    while (offset != 0 && commands.size() < count)
+    {
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), offset < sizeof(FileHeader) || offset + sizeof(RecordHeader) > header.end);
+
+        RecordHeader record;
+        memcpy(&record, view.get() + offset, sizeof(record));
+
+        const uint64_t textStart = offset + sizeof(record);
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), textStart + record.length * sizeof(wchar_t) > header.end);
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), record.previous >= offset);
+
+        auto& command = commands.emplace_back(record.length, UNICODE_NULL);
+        memcpy(command.data(), view.get() + textStart, record.length * sizeof(wchar_t));
+
+        offset = record.previous;
+    }
+
+    std::reverse(commands.begin(), commands.end());
+    return commands;
+}
+
+// Routine Description:
+// - Rewrites the file with just the given commands. The header lock must be held.
+// Arguments:
+// - commands - the commands to keep, oldest first
+// Note: will throw exception on I/O failure
+void HistoryStore::_Compact(const std::vector<std::wstring>& commands)
+{
+    FileHeader header{ s_Signature, s_Version, 0, sizeof(FileHeader) };
+
+    std::vector<BYTE> data;
+    for (const auto& command : commands)
+    {
+        const RecordHeader record{ header.newest, gsl::narrow<uint32_t>(command.size()) };
+        const auto bytes = reinterpret_cast<const BYTE*>(&record);
+        data.insert(data.end(), bytes, bytes + sizeof(record));
+
+        const auto text = reinterpret_cast<const BYTE*>(command.data());
+        data.insert(data.end(), text, text + command.size() * sizeof(wchar_t));
+
+        header.newest = header.end;
+        header.end = sizeof(FileHeader) + data.size();
+    }
+
+    _Write(sizeof(FileHeader), data.data(), data.size());
+    _Write(0, &header, sizeof(header));
+
+    LARGE_INTEGER position;
+    position.QuadPart = gsl::narrow<LONGLONG>(header.end);
+    THROW_IF_WIN32_BOOL_FALSE(SetFilePointerEx(_file.get(), position, nullptr, FILE_BEGIN));
+    THROW_IF_WIN32_BOOL_FALSE(SetEndOfFile(_file.get()));
+}
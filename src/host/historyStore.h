@@ -0,0 +1,82 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- historyStore.h
+
+Abstract:
+- Append-only file that keeps an app's command history between sessions.
+- Each command is written once, at the end of the file, with the offset of the
+  one before it. The file's header holds the offset of the newest command, so
+  the most recent ones are read by walking back from it through a read-only view
+  of the file, without parsing anything older than what's asked for.
+- Several consoles can keep the same file. Appends are made under a lock on the
+  file's header, and are chained onto whatever command was newest at the time.
+- Once a file has grown past s_CompactSize, it's rewritten with only its newest
+  commands the next time it's opened.
+--*/
+
+#pragma once
+
+class HistoryStore final
+{
+public:
+    HistoryStore(const std::wstring_view path);
+    ~HistoryStore() = default;
+
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    static std::unique_ptr<HistoryStore> s_OpenForApp(const std::wstring_view appName);
+
+    std::vector<std::wstring> ReadNewest(const size_t count);
+    void Append(const std::wstring_view command);
+    void Clear();
+
+private:
+    static constexpr uint32_t s_Signature = 0x54534843; // "CHST"
+    static constexpr uint32_t s_Version = 1;
+    static constexpr uint64_t s_CompactSize = 1024 * 1024;
+
+#pragma pack(push, 1)
+    struct FileHeader
+    {
+        uint32_t signature;
+        uint32_t version;
+        uint64_t newest; // offset of the newest record, or 0 if there are none
+        uint64_t end; // offset just past the last record
+    };
+
+    struct RecordHeader
+    {
+        uint64_t previous; // offset of the record before this one, or 0 for the oldest
+        uint32_t length; // in wchar_t, followed by the command's text
+    };
+#pragma pack(pop)
+
+    // Holds the lock on the file's header for as long as it's around. Everything that
+    // reads or writes the file does so with it held.
+    class HeaderLock final
+    {
+    public:
+        HeaderLock(const HANDLE file);
+        ~HeaderLock();
+
+        HeaderLock(const HeaderLock&) = delete;
+        HeaderLock& operator=(const HeaderLock&) = delete;
+
+    private:
+        const HANDLE _file;
+    };
+
+    static std::wstring s_GetPath(const std::wstring_view appName);
+
+    FileHeader _ReadHeader();
+    void _Write(const uint64_t offset, const void* const data, const size_t length);
+    void _ClearLocked();
+    std::vector<std::wstring> _ReadNewestLocked(const size_t count);
+    void _Compact(const std::vector<std::wstring>& commands);
+
+    wil::unique_hfile _file;
+};
@@ -161,11 +161,11 @@ void HandleGenericKeyEvent(_In_ KeyEvent keyEvent, const bool generateBreak)
         size_t EventsWritten = 0;
         try
         {
-            EventsWritten = gci.pInputBuffer->Write(std::make_unique<KeyEvent>(keyEvent));
+            EventsWritten = gci.pInputBuffer->Write(keyEvent.ToInputRecord());
             if (EventsWritten && generateBreak)
             {
                 keyEvent.SetKeyDown(false);
-                EventsWritten = gci.pInputBuffer->Write(std::make_unique<KeyEvent>(keyEvent));
+                EventsWritten = gci.pInputBuffer->Write(keyEvent.ToInputRecord());
             }
         }
         catch(...)
@@ -6,6 +6,8 @@
 #include "dbcs.h"
 #include "stream.h"
 #include "../types/inc/GlyphWidth.hpp"
+#include "../types/inc/ScratchArena.hpp"
+#include "../renderer/base/InputLatency.hpp"
 
 #include <functional>
 
@@ -13,6 +15,15 @@
 
 #define INPUT_BUFFER_DEFAULT_INPUT_MODE (ENABLE_LINE_INPUT | ENABLE_PROCESSED_INPUT | ENABLE_ECHO_INPUT | ENABLE_MOUSE_INPUT)
 
+// mouse moves and wheel runs go first, as they're by far the most common
+const std::array<InputBuffer::Coalescer, 5> InputBuffer::s_coalescers{
+    &InputBuffer::_CoalesceMouseMovedEvents,
+    &InputBuffer::_CoalesceMouseWheelEvents,
+    &InputBuffer::_CoalesceRepeatedKeyPressEvents,
+    &InputBuffer::_CoalesceWindowSizeEvents,
+    &InputBuffer::_CoalesceFocusEvents,
+};
+
 // Routine Description:
 // - This method creates an input buffer.
 // Arguments:
@@ -22,6 +33,7 @@
 InputBuffer::InputBuffer() :
     InputMode{ INPUT_BUFFER_DEFAULT_INPUT_MODE },
     WaitQueue{},
+    _compactAt{ s_CompactThreshold },
     _termInput(std::bind(&InputBuffer::_HandleTerminalInputCallback, this, std::placeholders::_1))
 {
     // The _termInput's constructor takes a reference to this object's _HandleTerminalInputCallback.
@@ -209,11 +221,10 @@ void InputBuffer::Flush()
 // - The console lock must be held when calling this routine.
 void InputBuffer::FlushAllButKeys()
 {
-    auto newEnd = std::remove_if(_storage.begin(), _storage.end(), [](const std::unique_ptr<IInputEvent>& event)
+    _storage.remove_if([](const INPUT_RECORD& record) noexcept
     {
-        return event->EventType() != InputEventType::KeyEvent;
+        return record.EventType != KEY_EVENT;
     });
-    _storage.erase(newEnd, _storage.end());
 }
 
 // Routine Description:
@@ -253,10 +264,9 @@ NTSTATUS InputBuffer::Read(_Out_ std::deque<std::unique_ptr<IInputEvent>>& OutEv
         }
 
         // read from buffer
-        std::deque<std::unique_ptr<IInputEvent>> events;
         size_t eventsRead;
         bool resetWaitEvent;
-        _ReadBuffer(events,
+        _ReadBuffer(OutEvents,
                     AmountToRead,
                     eventsRead,
                     Peek,
@@ -264,13 +274,6 @@ NTSTATUS InputBuffer::Read(_Out_ std::deque<std::unique_ptr<IInputEvent>>& OutEv
                     Unicode,
                     Stream);
 
-        // copy events to outEvents
-        while (!events.empty())
-        {
-            OutEvents.push_back(std::move(events.front()));
-            events.pop_front();
-        }
-
         if (resetWaitEvent)
         {
             ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
@@ -283,6 +286,53 @@ NTSTATUS InputBuffer::Read(_Out_ std::deque<std::unique_ptr<IInputEvent>>& OutEv
     }
 }
 
+// Routine Description:
+// - This routine reads records from the input buffer straight into the
+//   caller's array, as they're stored, for the unicode non-stream reads that
+//   take them as they are (ReadConsoleInputW/PeekConsoleInputW). Nothing is
+//   converted or allocated on the way.
+// Note:
+// - The console lock must be held when calling this routine.
+// Arguments:
+// - outRecords - where the records are copied to. As many are read as fit.
+// - eventsRead - on exit, how many records were read.
+// - Peek - If true, copy the records but don't remove them from the input buffer.
+// - WaitForData - if true, wait until an event is input if there are none. if false, return immediately
+// Return Value:
+// - STATUS_SUCCESS if records were read into the client buffer and everything is OK.
+// - CONSOLE_STATUS_WAIT if there weren't any records (and waits are allowed)
+[[nodiscard]]
+NTSTATUS InputBuffer::Read(const gsl::span<INPUT_RECORD> outRecords,
+                           _Out_ size_t& eventsRead,
+                           const bool Peek,
+                           const bool WaitForData)
+{
+    eventsRead = 0;
+    if (_storage.empty())
+    {
+        if (!WaitForData)
+        {
+            return STATUS_SUCCESS;
+        }
+        return CONSOLE_STATUS_WAIT;
+    }
+
+    eventsRead = _storage.copy_to(outRecords);
+    if (eventsRead > 0)
+    {
+        Microsoft::Console::Render::InputLatency::Mark(Microsoft::Console::Render::LatencyStage::ClientRead);
+    }
+    if (!Peek)
+    {
+        _storage.pop_front(eventsRead);
+        if (_storage.empty())
+        {
+            ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
+        }
+    }
+    return STATUS_SUCCESS;
+}
+
 // Routine Description:
 // - This routine reads a single event from the input buffer.
 // - It can convert returned data to through the currently set Input CP, it can optionally return a wait condition
@@ -356,94 +406,62 @@ void InputBuffer::_ReadBuffer(_Out_ std::deque<std::unique_ptr<IInputEvent>>& ou
     FAIL_FAST_IF(streamRead && readCount != 1);
 
     resetWaitEvent = false;
+    eventsRead = 0;
 
-    std::deque<std::unique_ptr<IInputEvent>> readEvents;
     // we need another var to keep track of how many we've read
     // because dbcs records count for two when we aren't doing a
     // unicode read but the eventsRead count should return the number
     // of events actually put into outRecords.
     size_t virtualReadCount = 0;
 
-    while (!_storage.empty() && virtualReadCount < readCount)
+    // when peeking, the records are copied out from where they are
+    // instead of being taken out of storage.
+    size_t peekIndex = 0;
+
+    while (peekIndex < _storage.size() && virtualReadCount < readCount)
     {
-        bool performNormalRead = true;
+        INPUT_RECORD& stored = peek ? _storage[peekIndex] : _storage.front();
+        INPUT_RECORD record = stored;
+
         // for stream reads we need to split any key events that have been coalesced
-        if (streamRead)
+        const bool split = streamRead &&
+                           record.EventType == KEY_EVENT &&
+                           record.Event.KeyEvent.wRepeatCount > 1;
+        if (split)
         {
-            if (_storage.front()->EventType() == InputEventType::KeyEvent)
-            {
-                KeyEvent* const pKeyEvent = static_cast<KeyEvent* const>(_storage.front().get());
-                if (pKeyEvent->GetRepeatCount() > 1)
-                {
-                    // split the key event
-                    std::unique_ptr<KeyEvent> streamKeyEvent = std::make_unique<KeyEvent>(*pKeyEvent);
-                    streamKeyEvent->SetRepeatCount(1);
-                    readEvents.push_back(std::move(streamKeyEvent));
-                    pKeyEvent->SetRepeatCount(pKeyEvent->GetRepeatCount() - 1);
-                    performNormalRead = false;
-                }
-            }
+            record.Event.KeyEvent.wRepeatCount = 1;
         }
 
-        if (performNormalRead)
+        if (peek)
         {
-            readEvents.push_back(std::move(_storage.front()));
-            _storage.pop_front();
+            ++peekIndex;
         }
-
-        ++virtualReadCount;
-        if (!unicode)
+        else if (split)
         {
-            if (readEvents.back()->EventType() == InputEventType::KeyEvent)
-            {
-                const KeyEvent* const pKeyEvent = static_cast<const KeyEvent* const>(readEvents.back().get());
-                if (IsGlyphFullWidth(pKeyEvent->GetCharData()))
-                {
-                    ++virtualReadCount;
-                }
-            }
+            --stored.Event.KeyEvent.wRepeatCount;
         }
-    }
-
-    // the amount of events that were actually read
-    eventsRead = readEvents.size();
-
-    // copy the events back if we were supposed to peek
-    if (peek)
-    {
-        if (streamRead)
+        else
         {
-            // we need to check and see if the event was split from a coalesced key event
-            // or if it was unrelated to the current front event in storage
-            if (!readEvents.empty() &&
-                !_storage.empty() &&
-                readEvents.back()->EventType() == InputEventType::KeyEvent &&
-                _storage.front()->EventType() == InputEventType::KeyEvent &&
-                _CanCoalesce(static_cast<const KeyEvent&>(*readEvents.back()),
-                                static_cast<const KeyEvent&>(*_storage.front())))
-            {
-                KeyEvent& keyEvent = static_cast<KeyEvent&>(*_storage.front());
-                keyEvent.SetRepeatCount(keyEvent.GetRepeatCount() + 1);
-            }
-            else
-            {
-                _storage.push_front(IInputEvent::Create(readEvents.back()->ToInputRecord()));
-            }
+            _storage.pop_front();
         }
-        else
+
+        // this is the only place the records become events, on their way out to the client.
+        outEvents.push_back(IInputEvent::Create(record));
+        ++eventsRead;
+
+        ++virtualReadCount;
+        if (!unicode)
         {
-            for (auto it = readEvents.crbegin(); it != readEvents.crend(); ++it)
+            if (record.EventType == KEY_EVENT && IsGlyphFullWidth(record.Event.KeyEvent.uChar.UnicodeChar))
             {
-                _storage.push_front(IInputEvent::Create((*it)->ToInputRecord()));
+                ++virtualReadCount;
             }
         }
     }
 
-    // move events read to proper deque
-    while (!readEvents.empty())
+    if (eventsRead > 0)
     {
-        outEvents.push_back(std::move(readEvents.front()));
-        readEvents.pop_front();
+        Microsoft::Console::Render::InputLatency::Mark(Microsoft::Console::Render::LatencyStage::ClientRead);
     }
 
     // signal if we emptied the buffer
@@ -466,8 +484,8 @@ size_t InputBuffer::Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& in
 {
     try
     {
-        _HandleConsoleSuspensionEvents(inEvents);
-        if (inEvents.empty())
+        const auto inRecords = _ToRecords(inEvents);
+        if (inRecords.empty())
         {
             return STATUS_SUCCESS;
         }
@@ -476,18 +494,23 @@ size_t InputBuffer::Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& in
         // this way to handle any coalescing that might occur.
 
         // get all of the existing records, "emptying" the buffer
-        std::deque<std::unique_ptr<IInputEvent>> existingStorage;
-        existingStorage.swap(_storage);
+        std::pmr::vector<INPUT_RECORD> existingStorage{ &Microsoft::Console::Types::ScratchArena::ForThisThread() };
+        existingStorage.reserve(_storage.size());
+        for (size_t i = 0; i < _storage.size(); ++i)
+        {
+            existingStorage.push_back(_storage[i]);
+        }
+        _storage.clear();
 
         // We will need this variable to pass to _WriteBuffer so it can attempt to determine wait status.
-        // However, because we swapped the storage out from under it with an empty deque, it will always
+        // However, because we emptied the storage out from under it, it will always
         // return true after the first one (as it is filling the newly emptied backing deque.)
         // Then after the second one, because we've inserted some input, it will always say false.
         bool unusedWaitStatus = false;
 
         // write the prepend records
         size_t prependEventsWritten;
-        _WriteBuffer(inEvents, prependEventsWritten, unusedWaitStatus);
+        _WriteBuffer(inRecords, prependEventsWritten, unusedWaitStatus);
         FAIL_FAST_IF(!(unusedWaitStatus));
 
         // write all previously existing records
@@ -500,7 +523,7 @@ size_t InputBuffer::Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& in
         // Because we did interesting manipulation of the wait queue
         // in order to prepend, we can't trust what _WriteBuffer said
         // and instead need to set the event if the original backing
-        // buffer (the one we swapped out at the top) was empty
+        // buffer (the one we emptied at the top) was empty
         // when this whole thing started.
         if (existingStorage.empty())
         {
@@ -532,9 +555,113 @@ size_t InputBuffer::Write(_Inout_ std::unique_ptr<IInputEvent> inEvent)
 {
     try
     {
-        std::deque<std::unique_ptr<IInputEvent>> inEvents;
-        inEvents.push_back(std::move(inEvent));
-        return Write(inEvents);
+        return Write(inEvent->ToInputRecord());
+    }
+    catch (...)
+    {
+        LOG_HR(wil::ResultFromCaughtException());
+        return 0;
+    }
+}
+
+// Routine Description:
+// - Writes a single record to the input buffer. Wakes up any readers that are
+// waiting for additional input events.
+// - This is what the window's input goes through, one event at a time, and it
+// doesn't allocate unless the storage has to grow.
+// Arguments:
+// - inRecord - input record to store in the buffer.
+// Return Value:
+// - The number of events that were written to input buffer.
+// Note:
+// - The console lock must be held when calling this routine.
+size_t InputBuffer::Write(const INPUT_RECORD& inRecord)
+{
+    try
+    {
+        if (_HandleConsoleSuspensionEvent(inRecord))
+        {
+            return 0;
+        }
+
+        // Write to buffer.
+        size_t EventsWritten;
+        bool SetWaitEvent;
+        _WriteBuffer({ &inRecord, 1 }, EventsWritten, SetWaitEvent);
+
+        if (SetWaitEvent)
+        {
+            ServiceLocator::LocateGlobals().hInputEvent.SetEvent();
+        }
+
+        // Alert any writers waiting for space.
+        WakeUpReadersWaitingForData();
+        return EventsWritten;
+    }
+    catch (...)
+    {
+        LOG_HR(wil::ResultFromCaughtException());
+        return 0;
+    }
+}
+
+// Routine Description:
+// - Writes pasted text to the input buffer in one go, for an app that reads
+// VT input. Each character is stored as a key press with no key, which is
+// what the VT input module sends for text, and nothing is coalesced or
+// translated on the way. If the app turned on bracketed paste mode, the
+// text is sent between the bracketed paste markers. Wakes up any readers
+// that are waiting for additional input events.
+// Arguments:
+// - text - the text to store in the buffer.
+// Return Value:
+// - The number of events that were written to input buffer.
+// Note:
+// - The console lock must be held when calling this routine.
+size_t InputBuffer::WritePastedText(const std::wstring_view text)
+{
+    try
+    {
+        if (text.empty())
+        {
+            return 0;
+        }
+
+        const bool initiallyEmptyQueue = _storage.empty();
+        const bool bracketed = _termInput.IsBracketedPasteModeEnabled();
+        size_t EventsWritten = 0;
+
+        INPUT_RECORD record{};
+        record.EventType = KEY_EVENT;
+        record.Event.KeyEvent.bKeyDown = TRUE;
+        record.Event.KeyEvent.wRepeatCount = 1;
+        const auto writeChars = [&](const std::wstring_view chars) {
+            for (const wchar_t wch : chars)
+            {
+                record.Event.KeyEvent.uChar.UnicodeChar = wch;
+                _storage.push_back(record);
+                ++EventsWritten;
+            }
+        };
+
+        if (bracketed)
+        {
+            writeChars(TerminalInput::s_BracketedPasteStart);
+        }
+        writeChars(text);
+        if (bracketed)
+        {
+            writeChars(TerminalInput::s_BracketedPasteEnd);
+        }
+
+        if (initiallyEmptyQueue)
+        {
+            ServiceLocator::LocateGlobals().hInputEvent.SetEvent();
+        }
+
+        // Alert any writers waiting for space.
+        WakeUpReadersWaitingForData();
+        return EventsWritten;
     }
     catch (...)
     {
@@ -556,8 +683,30 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
 {
     try
     {
-        _HandleConsoleSuspensionEvents(inEvents);
-        if (inEvents.empty())
+        const auto inRecords = _ToRecords(inEvents);
+        return Write(gsl::make_span(inRecords));
+    }
+    catch (...)
+    {
+        LOG_HR(wil::ResultFromCaughtException());
+        return 0;
+    }
+}
+
+// Routine Description:
+// - Writes records to the input buffer, as they are. Wakes up any readers
+// that are waiting for additional input events.
+// Arguments:
+// - inRecords - the records to store in the buffer.
+// Return Value:
+// - The number of events that were written to input buffer.
+// Note:
+// - The console lock must be held when calling this routine.
+size_t InputBuffer::Write(const gsl::span<const INPUT_RECORD> inRecords)
+{
+    try
+    {
+        if (inRecords.empty())
         {
             return 0;
         }
@@ -565,7 +714,7 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
         // Write to buffer.
         size_t EventsWritten;
         bool SetWaitEvent;
-        _WriteBuffer(inEvents, EventsWritten, SetWaitEvent);
+        _WriteBuffer(inRecords, EventsWritten, SetWaitEvent);
 
         if (SetWaitEvent)
         {
@@ -595,28 +744,29 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
 // Note:
 // - The console lock must be held when calling this routine.
 // - will throw on failure
-void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
+void InputBuffer::_WriteBuffer(const gsl::span<const INPUT_RECORD> inRecords,
                                _Out_ size_t& eventsWritten,
                                _Out_ bool& setWaitEvent)
 {
     eventsWritten = 0;
     setWaitEvent = false;
     const bool initiallyEmptyQueue = _storage.empty();
-    const size_t initialInEventsSize = inEvents.size();
     const bool vtInputMode = IsInVirtualTerminalInputMode();
+    if (initiallyEmptyQueue)
+    {
+        _compactAt = s_CompactThreshold;
+    }
 
-    while(!inEvents.empty())
+    for (const INPUT_RECORD& inRecord : inRecords)
     {
-        // Pop the next event.
         // If we're in vt mode, try and handle it with the vt input module.
         // If it was handled, do nothing else for it.
         // If there was one event passed in, try coalescing it with the previous event currently in the buffer.
         // If it's not coalesced, append it to the buffer.
-        std::unique_ptr<IInputEvent> inEvent = std::move(inEvents.front());
-        inEvents.pop_front();
-        if (vtInputMode)
+        if (vtInputMode && inRecord.EventType == KEY_EVENT)
         {
-            const bool handled = _termInput.HandleKey(inEvent.get());
+            const KeyEvent keyEvent{ inRecord.Event.KeyEvent };
+            const bool handled = _termInput.HandleKey(&keyEvent);
             if (handled)
             {
                 eventsWritten++;
@@ -628,44 +778,26 @@ void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>&
         // record at a time because this is the original behavior of
         // the input buffer. Changing this behavior may break stuff
         // that was depending on it.
-        if (initialInEventsSize == 1 && !_storage.empty())
+        if (inRecords.size() == 1 && !_storage.empty())
         {
-            // coalescing requires a deque of events, so push it back onto the front.
-            inEvents.push_front(std::move(inEvent));
-
-            bool coalesced = false;
-            // this looks kinda weird but we don't want to coalesce a
-            // mouse event and then try to coalesce a key event right after.
-            //
-            // we also pass the whole deque to the coalescing methods
-            // even though they only want one event because it should
-            // be their responsibility to maintain the correct state
-            // of the deque if they process any records in it.
-            if (_CoalesceMouseMovedEvents(inEvents))
-            {
-                coalesced = true;
-            }
-            else if (_CoalesceRepeatedKeyPressEvents(inEvents))
-            {
-                coalesced = true;
-            }
-            if (coalesced)
+            if (_Coalesce(inRecord))
             {
                 eventsWritten = 1;
                 return;
             }
-            else
-            {
-                // We didn't coalesce the event. pull it from the queue again,
-                //  to keep the state consistent with the start of this block.
-                inEvent = std::move(inEvents.front());
-                inEvents.pop_front();
-            }
         }
         // At this point, the event was neither coalesced, nor processed by VT.
-        _storage.push_back(std::move(inEvent));
+        _storage.push_back(inRecord);
         ++eventsWritten;
     }
+    if (_storage.size() >= _compactAt)
+    {
+        _CompactStorage();
+    }
+    if (eventsWritten > 0)
+    {
+        Microsoft::Console::Render::InputLatency::Mark(Microsoft::Console::Render::LatencyStage::InputBuffered);
+    }
     if (initiallyEmptyQueue && !_storage.empty())
     {
         setWaitEvent = true;
@@ -673,48 +805,114 @@ void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>&
 }
 
 // Routine Description:
-// - Checks if the last saved event and the first event of inRecords are
+// - Runs the incoming record past each of the coalescers in turn, until one
+//   of them takes it.
+// Arguments:
+// - inRecord - The incoming record to process.
+// Return Value:
+// - true if the record was coalesced and mustn't be stored, false if it
+//   still has to be.
+// Note:
+// - The storage must not be empty.
+bool InputBuffer::_Coalesce(const INPUT_RECORD& inRecord)
+{
+    for (const Coalescer coalescer : s_coalescers)
+    {
+        if ((this->*coalescer)(inRecord))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Routine Description:
+// - Checks if the last saved event and the incoming record are
 // both MOUSE_MOVED events. If they are, the last saved event is
-// updated with the new mouse position and the first event of inRecords is
+// updated with the new mouse position and the incoming record can be
 // dropped.
 // Arguments:
-// - inRecords - The incoming records to process.
+// - inRecord - The incoming record to process.
 // Return Value:
 // true if events were coalesced, false if they were not.
 // Note:
-// - The size of inRecords must be 1.
 // - Coalescing here means updating a record that already exists in
 // the buffer with updated values from an incoming event, instead of
 // storing the incoming event (which would make the original one
 // redundant/out of date with the most current state).
-bool InputBuffer::_CoalesceMouseMovedEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+bool InputBuffer::_CoalesceMouseMovedEvents(const INPUT_RECORD& inRecord)
 {
-    FAIL_FAST_IF(!(inEvents.size() == 1));
     FAIL_FAST_IF(_storage.empty());
-    const IInputEvent* const pFirstInEvent = inEvents.front().get();
-    const IInputEvent* const pLastStoredEvent = _storage.back().get();
-    if (pFirstInEvent->EventType() == InputEventType::MouseEvent &&
-        pLastStoredEvent->EventType() == InputEventType::MouseEvent)
+    INPUT_RECORD& lastStored = _storage.back();
+    if (inRecord.EventType == MOUSE_EVENT &&
+        lastStored.EventType == MOUSE_EVENT)
     {
-        const MouseEvent* const pInMouseEvent = static_cast<const MouseEvent* const>(pFirstInEvent);
-        const MouseEvent* const pLastMouseEvent = static_cast<const MouseEvent* const>(pLastStoredEvent);
+        const MouseEvent inMouseEvent{ inRecord.Event.MouseEvent };
+        const MouseEvent lastMouseEvent{ lastStored.Event.MouseEvent };
 
-        if (pInMouseEvent->IsMouseMoveEvent() &&
-            pLastMouseEvent->IsMouseMoveEvent())
+        if (inMouseEvent.IsMouseMoveEvent() &&
+            lastMouseEvent.IsMouseMoveEvent())
         {
             // update mouse moved position
-            MouseEvent* const pMouseEvent = static_cast<MouseEvent* const>(_storage.back().release());
-            pMouseEvent->SetPosition(pInMouseEvent->GetPosition());
-            std::unique_ptr<IInputEvent> tempPtr(pMouseEvent);
-            tempPtr.swap(_storage.back());
-
-            inEvents.pop_front();
+            lastStored.Event.MouseEvent.dwMousePosition = inMouseEvent.GetPosition();
             return true;
         }
     }
     return false;
 }
 
+// Routine Description:
+// - Checks if the last saved event and the incoming record are both turns
+// of the same mouse wheel, in the same place with the same buttons and keys
+// held. If they are, the incoming record's delta is added to the saved one
+// and the incoming record can be dropped.
+// Arguments:
+// - inRecord - The incoming record to process.
+// Return Value:
+// true if events were coalesced, false if they were not.
+bool InputBuffer::_CoalesceMouseWheelEvents(const INPUT_RECORD& inRecord)
+{
+    FAIL_FAST_IF(_storage.empty());
+    INPUT_RECORD& lastStored = _storage.back();
+    if (inRecord.EventType == MOUSE_EVENT &&
+        lastStored.EventType == MOUSE_EVENT)
+    {
+        return s_TryMergeWheelDelta(lastStored.Event.MouseEvent, inRecord.Event.MouseEvent);
+    }
+    return false;
+}
+
+// Routine Description:
+// - Adds the delta of one mouse wheel event to another, if they're turns of
+// the same wheel in the same place with the same buttons and keys held, and
+// the sum still fits.
+// Arguments:
+// - into - the event to add the delta to
+// - from - the event whose delta is added
+// Return Value:
+// - true if the delta was merged, in which case from is obsolete.
+bool InputBuffer::s_TryMergeWheelDelta(MOUSE_EVENT_RECORD& into, const MOUSE_EVENT_RECORD& from) noexcept
+{
+    if ((from.dwEventFlags != MOUSE_WHEELED && from.dwEventFlags != MOUSE_HWHEELED) ||
+        into.dwEventFlags != from.dwEventFlags ||
+        into.dwControlKeyState != from.dwControlKeyState ||
+        LOWORD(into.dwButtonState) != LOWORD(from.dwButtonState) ||
+        into.dwMousePosition.X != from.dwMousePosition.X ||
+        into.dwMousePosition.Y != from.dwMousePosition.Y)
+    {
+        return false;
+    }
+
+    // the delta is the signed high word of the button state
+    const int delta = static_cast<SHORT>(HIWORD(into.dwButtonState)) + static_cast<SHORT>(HIWORD(from.dwButtonState));
+    if (delta < SHRT_MIN || delta > SHRT_MAX)
+    {
+        return false;
+    }
+    into.dwButtonState = MAKELONG(LOWORD(into.dwButtonState), static_cast<WORD>(static_cast<SHORT>(delta)));
+    return true;
+}
+
 // Routine Description:
 // - checks two KeyEvents to see if they're similiar enough to be coalesced
 // Arguments:
@@ -741,44 +939,36 @@ bool InputBuffer::_CanCoalesce(const KeyEvent& a, const KeyEvent& b) const noexc
 }
 
 // Routine Description::
-// - If the last input event saved and the first input event in inRecords
+// - If the last input event saved and the incoming record
 // are both a keypress down event for the same key, update the repeat
-// count of the saved event and drop the first from inRecords.
+// count of the saved event so that the incoming record can be dropped.
 // Arguments:
-// - inRecords - The incoming records to process.
+// - inRecord - The incoming record to process.
 // Return Value:
 // true if events were coalesced, false if they were not.
 // Note:
-// - The size of inRecords must be 1.
 // - Coalescing here means updating a record that already exists in
 // the buffer with updated values from an incoming event, instead of
 // storing the incoming event (which would make the original one
 // redundant/out of date with the most current state).
-bool InputBuffer::_CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+bool InputBuffer::_CoalesceRepeatedKeyPressEvents(const INPUT_RECORD& inRecord)
 {
-    FAIL_FAST_IF(!(inEvents.size() == 1));
     FAIL_FAST_IF(_storage.empty());
-    const IInputEvent* const pFirstInEvent = inEvents.front().get();
-    const IInputEvent* const pLastStoredEvent = _storage.back().get();
-    if (pFirstInEvent->EventType() == InputEventType::KeyEvent &&
-        pLastStoredEvent->EventType() == InputEventType::KeyEvent)
-    {
-        const KeyEvent* const pInKeyEvent = static_cast<const KeyEvent* const>(pFirstInEvent);
-        const KeyEvent* const pLastKeyEvent = static_cast<const KeyEvent* const>(pLastStoredEvent);
-
-        if (pInKeyEvent->IsKeyDown() &&
-            pLastKeyEvent->IsKeyDown() &&
-            !IsGlyphFullWidth(pInKeyEvent->GetCharData()) &&
-            _CanCoalesce(*pInKeyEvent, *pLastKeyEvent))
+    INPUT_RECORD& lastStored = _storage.back();
+    if (inRecord.EventType == KEY_EVENT &&
+        lastStored.EventType == KEY_EVENT)
+    {
+        const KeyEvent inKeyEvent{ inRecord.Event.KeyEvent };
+        const KeyEvent lastKeyEvent{ lastStored.Event.KeyEvent };
+
+        if (inKeyEvent.IsKeyDown() &&
+            lastKeyEvent.IsKeyDown() &&
+            !IsGlyphFullWidth(inKeyEvent.GetCharData()) &&
+            _CanCoalesce(inKeyEvent, lastKeyEvent))
         {
             // increment repeat count
-            KeyEvent* const pKeyEvent = static_cast<KeyEvent* const>(_storage.back().release());
-            WORD repeatCount = pKeyEvent->GetRepeatCount() + pInKeyEvent->GetRepeatCount();
-            pKeyEvent->SetRepeatCount(repeatCount);
-            std::unique_ptr<IInputEvent> tempPtr(pKeyEvent);
-            tempPtr.swap(_storage.back());
-
-            inEvents.pop_front();
+            const WORD repeatCount = lastKeyEvent.GetRepeatCount() + inKeyEvent.GetRepeatCount();
+            lastStored.Event.KeyEvent.wRepeatCount = repeatCount;
             return true;
         }
     }
@@ -786,44 +976,160 @@ bool InputBuffer::_CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique
 }
 
 // Routine Description:
-// - Handles records that suspend/resume the console.
+// - A window size event makes any other one still pending obsolete, as the
+// reader only needs to know what size the buffer is now. Those are dropped,
+// and the incoming record is stored in their place at the end of the queue.
 // Arguments:
-// - records - records to check for pause/unpause events
+// - inRecord - The incoming record to process.
 // Return Value:
-// - None
+// - true if the incoming record was a window size event, and has been stored.
+bool InputBuffer::_CoalesceWindowSizeEvents(const INPUT_RECORD& inRecord)
+{
+    if (inRecord.EventType != WINDOW_BUFFER_SIZE_EVENT)
+    {
+        return false;
+    }
+    _storage.remove_if([](const INPUT_RECORD& record) noexcept {
+        return record.EventType == WINDOW_BUFFER_SIZE_EVENT;
+    });
+    _storage.push_back(inRecord);
+    return true;
+}
+
+// Routine Description:
+// - Like window size events, only the last focus event matters to a reader
+// that hasn't gotten to them yet. Any pending ones are dropped and the
+// incoming record is stored at the end of the queue.
+// Arguments:
+// - inRecord - The incoming record to process.
+// Return Value:
+// - true if the incoming record was a focus event, and has been stored.
+bool InputBuffer::_CoalesceFocusEvents(const INPUT_RECORD& inRecord)
+{
+    if (inRecord.EventType != FOCUS_EVENT)
+    {
+        return false;
+    }
+    _storage.remove_if([](const INPUT_RECORD& record) noexcept {
+        return record.EventType == FOCUS_EVENT;
+    });
+    _storage.push_back(inRecord);
+    return true;
+}
+
+// Routine Description:
+// - Drops the mouse events that newer ones in the queue have made obsolete,
+//   for when a reader has fallen far behind:
+//   - a mouse move, when the next mouse event after it is another move with
+//     the same buttons and keys held (the events between them can't have
+//     depended on where the mouse was).
+//   - a mouse wheel turn, when the next mouse event after it turns the same
+//     wheel, in which case its delta is added to that one.
+//   Clicks, and the last move before each of them, are kept.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
 // Note:
-// - The console lock must be held when calling this routine.
 // - will throw exception on error
-void InputBuffer::_HandleConsoleSuspensionEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+void InputBuffer::_CompactStorage()
+{
+    std::pmr::vector<bool> dropped(_storage.size(), false, &Microsoft::Console::Types::ScratchArena::ForThisThread());
+    MOUSE_EVENT_RECORD* nextMouseEvent = nullptr;
+    for (size_t i = _storage.size(); i-- > 0;)
+    {
+        INPUT_RECORD& record = _storage[i];
+        if (record.EventType != MOUSE_EVENT)
+        {
+            continue;
+        }
+
+        MOUSE_EVENT_RECORD& mouseEvent = record.Event.MouseEvent;
+        if (nextMouseEvent != nullptr)
+        {
+            if (mouseEvent.dwEventFlags == MOUSE_MOVED &&
+                nextMouseEvent->dwEventFlags == MOUSE_MOVED &&
+                mouseEvent.dwButtonState == nextMouseEvent->dwButtonState &&
+                mouseEvent.dwControlKeyState == nextMouseEvent->dwControlKeyState)
+            {
+                dropped[i] = true;
+                continue;
+            }
+            if (s_TryMergeWheelDelta(*nextMouseEvent, mouseEvent))
+            {
+                dropped[i] = true;
+                continue;
+            }
+        }
+        nextMouseEvent = &mouseEvent;
+    }
+
+    // remove_if goes through the records in order
+    size_t index = 0;
+    _storage.remove_if([&](const INPUT_RECORD&) noexcept {
+        return dropped[index++];
+    });
+
+    _compactAt = std::max(s_CompactThreshold, _storage.size() * 2);
+}
+
+// Routine Description:
+// - Handles a record that suspends/resumes the console.
+// Arguments:
+// - inRecord - record to check for a pause/unpause event
+// Return Value:
+// - true if the record was a pause/unpause event, which is to be dropped.
+// Note:
+// - The console lock must be held when calling this routine.
+bool InputBuffer::_HandleConsoleSuspensionEvent(const INPUT_RECORD& inRecord)
 {
     CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
 
-    std::deque<std::unique_ptr<IInputEvent>> outEvents;
-    while (!inEvents.empty())
+    if (inRecord.EventType == KEY_EVENT)
     {
-        std::unique_ptr<IInputEvent> currEvent = std::move(inEvents.front());
-        inEvents.pop_front();
-        if (currEvent->EventType() == InputEventType::KeyEvent)
+        const KeyEvent keyEvent{ inRecord.Event.KeyEvent };
+        if (keyEvent.IsKeyDown())
         {
-            const KeyEvent* const pKeyEvent = static_cast<const KeyEvent* const>(currEvent.get());
-            if (pKeyEvent->IsKeyDown())
+            if (WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) &&
+                !IsSystemKey(keyEvent.GetVirtualKeyCode()))
+            {
+                UnblockWriteConsole(CONSOLE_OUTPUT_SUSPENDED);
+                return true;
+            }
+            else if (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && keyEvent.IsPauseKey())
             {
-                if (WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) &&
-                    !IsSystemKey(pKeyEvent->GetVirtualKeyCode()))
-                {
-                    UnblockWriteConsole(CONSOLE_OUTPUT_SUSPENDED);
-                    continue;
-                }
-                else if (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && pKeyEvent->IsPauseKey())
-                {
-                    WI_SetFlag(gci.Flags, CONSOLE_SUSPENDED);
-                    continue;
-                }
+                WI_SetFlag(gci.Flags, CONSOLE_SUSPENDED);
+                return true;
             }
         }
-        outEvents.push_back(std::move(currEvent));
     }
-    inEvents.swap(outEvents);
+    return false;
+}
+
+// Routine Description:
+// - Takes the events to be written to the buffer and turns them into the
+//   records that it stores, dropping the ones that suspend/resume the console.
+// Arguments:
+// - inEvents - events to write to buffer. Empty on exit.
+// Return Value:
+// - The records, drawn from this thread's scratch arena.
+// Note:
+// - The console lock must be held when calling this routine.
+// - will throw exception on error
+std::pmr::vector<INPUT_RECORD> InputBuffer::_ToRecords(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+{
+    std::pmr::vector<INPUT_RECORD> inRecords{ &Microsoft::Console::Types::ScratchArena::ForThisThread() };
+    inRecords.reserve(inEvents.size());
+    for (const auto& inEvent : inEvents)
+    {
+        const INPUT_RECORD inRecord = inEvent->ToInputRecord();
+        if (!_HandleConsoleSuspensionEvent(inRecord))
+        {
+            inRecords.push_back(inRecord);
+        }
+    }
+    inEvents.clear();
+    return inRecords;
 }
 
 // Routine Description:
@@ -850,12 +1156,11 @@ void InputBuffer::_HandleTerminalInputCallback(std::deque<std::unique_ptr<IInput
     try
     {
         // add all input events to the storage queue
-        while (!inEvents.empty())
+        for (const auto& inEvent : inEvents)
         {
-            std::unique_ptr<IInputEvent> inEvent = std::move(inEvents.front());
-            inEvents.pop_front();
-            _storage.push_back(std::move(inEvent));
+            _storage.push_back(inEvent->ToInputRecord());
         }
+        inEvents.clear();
     }
     catch (...)
     {
@@ -863,6 +1168,28 @@ void InputBuffer::_HandleTerminalInputCallback(std::deque<std::unique_ptr<IInput
     }
 }
 
+// Routine Description:
+// - Estimates how much memory the events waiting to be read are holding: the
+//   array they're kept in, and the halves of any DBCS characters held back.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of the buffer's events.
+Microsoft::Console::Types::MemoryUsage InputBuffer::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddAllocation(_storage.capacity() * sizeof(INPUT_RECORD));
+    if (_readPartialByteSequence)
+    {
+        usage.AddAllocation(sizeof(KeyEvent));
+    }
+    if (_writePartialByteSequence)
+    {
+        usage.AddAllocation(sizeof(KeyEvent));
+    }
+    return usage;
+}
+
 TerminalInput& InputBuffer::GetTerminalInput()
 {
     return _termInput;
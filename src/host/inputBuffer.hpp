@@ -19,13 +19,16 @@ Revision History:
 #pragma once
 
 #include "inputReadHandleData.h"
+#include "inputRecordRing.hpp"
 #include "readData.hpp"
 #include "../types/inc/IInputEvent.hpp"
+#include "../types/inc/MemoryUsage.hpp"
 
 #include "../server/ObjectHandle.h"
 #include "../server/ObjectHeader.h"
 #include "../terminal/input/terminalInput.hpp"
 
+#include <array>
 #include <deque>
 
 class InputBuffer final : public ConsoleObjectHeader
@@ -63,6 +66,12 @@ public:
                   const bool Unicode,
                   const bool Stream);
 
+    [[nodiscard]]
+    NTSTATUS Read(const gsl::span<INPUT_RECORD> outRecords,
+                  _Out_ size_t& eventsRead,
+                  const bool Peek,
+                  const bool WaitForData);
+
     [[nodiscard]]
     NTSTATUS Read(_Out_ std::unique_ptr<IInputEvent>& inEvent,
                   const bool Peek,
@@ -75,12 +84,17 @@ public:
 
     size_t Write(_Inout_ std::unique_ptr<IInputEvent> inEvent);
     size_t Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    size_t Write(const INPUT_RECORD& inRecord);
+    size_t Write(const gsl::span<const INPUT_RECORD> inRecords);
+    size_t WritePastedText(const std::wstring_view text);
 
     bool IsInVirtualTerminalInputMode() const;
     Microsoft::Console::VirtualTerminal::TerminalInput& GetTerminalInput();
 
+    Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+
 private:
-    std::deque<std::unique_ptr<IInputEvent>> _storage;
+    InputRecordRing _storage;
     std::unique_ptr<IInputEvent> _readPartialByteSequence;
     std::unique_ptr<IInputEvent> _writePartialByteSequence;
     Microsoft::Console::VirtualTerminal::TerminalInput _termInput;
@@ -93,14 +107,34 @@ private:
                      const bool unicode,
                      const bool streamRead);
 
-    void _WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inRecords,
+    void _WriteBuffer(const gsl::span<const INPUT_RECORD> inRecords,
                       _Out_ size_t& eventsWritten,
                       _Out_ bool& setWaitEvent);
 
+    // Each of these gets a look at an incoming record before it's stored. The
+    //      first one to return true has merged it into what's already pending
+    //      (or stored it itself, in place of what it made obsolete) and the
+    //      record is done with. To coalesce another kind of event, add it here.
+    using Coalescer = bool (InputBuffer::*)(const INPUT_RECORD& inRecord);
+    static const std::array<Coalescer, 5> s_coalescers;
+
+    // Once this many records are pending, the queue is compacted, dropping
+    //      the mouse events that newer ones have made obsolete. Then it may only
+    //      grow to twice what was left before it's compacted again.
+    static constexpr size_t s_CompactThreshold = 1024;
+    size_t _compactAt;
+
+    bool _Coalesce(const INPUT_RECORD& inRecord);
     bool _CanCoalesce(const KeyEvent& a, const KeyEvent& b) const noexcept;
-    bool _CoalesceMouseMovedEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
-    bool _CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
-    void _HandleConsoleSuspensionEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    bool _CoalesceMouseMovedEvents(const INPUT_RECORD& inRecord);
+    bool _CoalesceMouseWheelEvents(const INPUT_RECORD& inRecord);
+    bool _CoalesceRepeatedKeyPressEvents(const INPUT_RECORD& inRecord);
+    bool _CoalesceWindowSizeEvents(const INPUT_RECORD& inRecord);
+    bool _CoalesceFocusEvents(const INPUT_RECORD& inRecord);
+    void _CompactStorage();
+    static bool s_TryMergeWheelDelta(MOUSE_EVENT_RECORD& into, const MOUSE_EVENT_RECORD& from) noexcept;
+    bool _HandleConsoleSuspensionEvent(const INPUT_RECORD& inRecord);
+    std::pmr::vector<INPUT_RECORD> _ToRecords(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
 
     void _HandleTerminalInputCallback(_In_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
 
@@ -0,0 +1,161 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "inputRecordRing.hpp"
+
+InputRecordRing::InputRecordRing() noexcept :
+    _records{},
+    _head{ 0 },
+    _size{ 0 }
+{
+}
+
+size_t InputRecordRing::size() const noexcept
+{
+    return _size;
+}
+
+// Routine Description:
+// - Gets how many records fit before the array has to grow again.
+size_t InputRecordRing::capacity() const noexcept
+{
+    return _records.capacity();
+}
+
+bool InputRecordRing::empty() const noexcept
+{
+    return _size == 0;
+}
+
+// Routine Description:
+// - Drops all the records. The array is kept for the records to come.
+void InputRecordRing::clear() noexcept
+{
+    _head = 0;
+    _size = 0;
+}
+
+INPUT_RECORD& InputRecordRing::operator[](const size_t index) noexcept
+{
+    return _records[_Wrap(_head + index)];
+}
+
+const INPUT_RECORD& InputRecordRing::operator[](const size_t index) const noexcept
+{
+    return _records[_Wrap(_head + index)];
+}
+
+INPUT_RECORD& InputRecordRing::front() noexcept
+{
+    return (*this)[0];
+}
+
+INPUT_RECORD& InputRecordRing::back() noexcept
+{
+    return (*this)[_size - 1];
+}
+
+// Routine Description:
+// - Adds a record to the end of the queue.
+// - NOTE: Throws if the array has to grow and that fails.
+// Arguments:
+// - record - the record to add
+void InputRecordRing::push_back(const INPUT_RECORD& record)
+{
+    if (_size == _records.size())
+    {
+        _Grow();
+    }
+    _records[_Wrap(_head + _size)] = record;
+    ++_size;
+}
+
+// Routine Description:
+// - Adds a record to the front of the queue, to be taken out next.
+// - NOTE: Throws if the array has to grow and that fails.
+// Arguments:
+// - record - the record to add
+void InputRecordRing::push_front(const INPUT_RECORD& record)
+{
+    if (_size == _records.size())
+    {
+        _Grow();
+    }
+    _head = _Wrap(_head + _records.size() - 1);
+    _records[_head] = record;
+    ++_size;
+}
+
+void InputRecordRing::pop_front() noexcept
+{
+    _head = _Wrap(_head + 1);
+    --_size;
+    if (_size == 0)
+    {
+        _head = 0;
+    }
+}
+
+// Routine Description:
+// - Drops the given number of records from the front of the queue.
+// Arguments:
+// - count - how many to drop. Must be no more than there are.
+void InputRecordRing::pop_front(const size_t count) noexcept
+{
+    FAIL_FAST_IF(count > _size);
+    _size -= count;
+    _head = _size == 0 ? 0 : _Wrap(_head + count);
+}
+
+// Routine Description:
+// - Copies the records from the front of the queue out, in at most two runs
+//   (one on each side of where the ring wraps around), without taking them
+//   out of the queue.
+// Arguments:
+// - records - where to copy the records to
+// Return Value:
+// - How many records were copied. That's as many as fit, or as many as there are.
+size_t InputRecordRing::copy_to(const gsl::span<INPUT_RECORD> records) const noexcept
+{
+    const size_t count = std::min(gsl::narrow_cast<size_t>(records.size()), _size);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    const size_t first = std::min(count, _records.size() - _head);
+    std::copy_n(_records.data() + _head, first, records.data());
+    std::copy_n(_records.data(), count - first, records.data() + first);
+    return count;
+}
+
+void InputRecordRing::swap(InputRecordRing& other) noexcept
+{
+    _records.swap(other._records);
+    std::swap(_head, other._head);
+    std::swap(_size, other._size);
+}
+
+size_t InputRecordRing::_Wrap(const size_t index) const noexcept
+{
+    return index & (_records.size() - 1);
+}
+
+// Routine Description:
+// - Doubles the array, moving the records over so that they start at the
+//   front of the new one.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void InputRecordRing::_Grow()
+{
+    std::vector<INPUT_RECORD> records(std::max(s_InitialCapacity, _records.size() * 2));
+    for (size_t i = 0; i < _size; ++i)
+    {
+        records[i] = (*this)[i];
+    }
+    _records.swap(records);
+    _head = 0;
+}
@@ -0,0 +1,70 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- inputRecordRing.hpp
+
+Abstract:
+- The storage behind the input buffer: a queue of INPUT_RECORDs kept by
+  value, one after the other, in a ring that wraps around a single array.
+- Adding or taking an event just copies a record in or out. The array only
+  grows, doubling, when the queue's full, so a steady stream of input, like
+  mouse moves or a paste, doesn't allocate per event.
+--*/
+
+#pragma once
+
+class InputRecordRing final
+{
+public:
+    InputRecordRing() noexcept;
+
+    size_t size() const noexcept;
+    size_t capacity() const noexcept;
+    bool empty() const noexcept;
+    void clear() noexcept;
+
+    INPUT_RECORD& operator[](const size_t index) noexcept;
+    const INPUT_RECORD& operator[](const size_t index) const noexcept;
+
+    INPUT_RECORD& front() noexcept;
+    INPUT_RECORD& back() noexcept;
+
+    void push_back(const INPUT_RECORD& record);
+    void push_front(const INPUT_RECORD& record);
+    void pop_front() noexcept;
+    void pop_front(const size_t count) noexcept;
+
+    size_t copy_to(const gsl::span<INPUT_RECORD> records) const noexcept;
+
+    template<typename Predicate>
+    void remove_if(Predicate pred) noexcept
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < _size; ++i)
+        {
+            const INPUT_RECORD& record = (*this)[i];
+            if (!pred(record))
+            {
+                (*this)[kept] = record;
+                ++kept;
+            }
+        }
+        _size = kept;
+    }
+
+    void swap(InputRecordRing& other) noexcept;
+
+private:
+    static constexpr size_t s_InitialCapacity = 64;
+
+    // The capacity is always a power of two, so that wrapping an index
+    //      around is only a mask.
+    std::vector<INPUT_RECORD> _records;
+    size_t _head;
+    size_t _size;
+
+    size_t _Wrap(const size_t index) const noexcept;
+    void _Grow();
+};
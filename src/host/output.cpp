@@ -117,30 +117,33 @@ static void _CopyRectangle(SCREEN_INFORMATION& screenInfo,
 // - screenInfo - reference to screen buffer information.
 // - coordRead - Screen buffer coordinate to begin reading from.
 // - amountToRead - the number of elements to read
+// - resource - where to allocate the result from
 // Return Value:
 // - vector of attribute data
-std::vector<WORD> ReadOutputAttributes(const SCREEN_INFORMATION& screenInfo,
-                                       const COORD coordRead,
-                                       const size_t amountToRead)
+std::pmr::vector<WORD> ReadOutputAttributes(const SCREEN_INFORMATION& screenInfo,
+                                            const COORD coordRead,
+                                            const size_t amountToRead,
+                                            std::pmr::memory_resource* const resource)
 {
+    // Prepare the return value string.
+    std::pmr::vector<WORD> retVal{ resource };
+
     // Short circuit. If nothing to read, leave early.
     if (amountToRead == 0)
     {
-        return {};
+        return retVal;
     }
 
     // Short circuit, if reading out of bounds, leave early.
     if (!screenInfo.GetBufferSize().IsInBounds(coordRead))
     {
-        return {};
+        return retVal;
     }
 
     // Get iterator to the position we should start reading at.
     auto it = screenInfo.GetCellDataAt(coordRead);
     // Count up the number of cells we've attempted to read.
     ULONG amountRead = 0;
-    // Prepare the return value string.
-    std::vector<WORD> retVal;
     // Reserve the number of cells. If we have >U+FFFF, it will auto-grow later and that's OK.
     retVal.reserve(amountToRead);
 
@@ -172,56 +175,35 @@ std::vector<WORD> ReadOutputAttributes(const SCREEN_INFORMATION& screenInfo,
 // - screenInfo - reference to screen buffer information.
 // - coordRead - Screen buffer coordinate to begin reading from.
 // - amountToRead - the number of elements to read
+// - resource - where to allocate the result from
 // Return Value:
 // - wstring
-std::wstring ReadOutputStringW(const SCREEN_INFORMATION& screenInfo,
-                               const COORD coordRead,
-                               const size_t amountToRead)
+std::pmr::wstring ReadOutputStringW(const SCREEN_INFORMATION& screenInfo,
+                                    const COORD coordRead,
+                                    const size_t amountToRead,
+                                    std::pmr::memory_resource* const resource)
 {
+    // Prepare the return value string.
+    std::pmr::wstring retVal{ resource };
+
     // Short circuit. If nothing to read, leave early.
     if (amountToRead == 0)
     {
-        return {};
+        return retVal;
     }
 
     // Short circuit, if reading out of bounds, leave early.
     if (!screenInfo.GetBufferSize().IsInBounds(coordRead))
     {
-        return {};
+        return retVal;
     }
 
-    // Get iterator to the position we should start reading at.
-    auto it = screenInfo.GetCellDataAt(coordRead);
-
-    // Count up the number of cells we've attempted to read.
-    ULONG amountRead = 0;
-
-    // Prepare the return value string.
-    std::wstring retVal;
     retVal.reserve(amountToRead); // Reserve the number of cells. If we have >U+FFFF, it will auto-grow later and that's OK.
 
-    // While we haven't read enough cells yet and the iterator is still valid (hasn't reached end of buffer)
-    while (amountRead < amountToRead && it)
-    {
-        // If the first thing we read is trailing, pad with a space.
-        // OR If the last thing we read is leading, pad with a space.
-        if ((amountRead == 0 && it->DbcsAttr().IsTrailing()) ||
-            (amountRead == (amountToRead - 1) && it->DbcsAttr().IsLeading()))
-        {
-            retVal += UNICODE_SPACE;
-        }
-        else
-        {
-            // Otherwise, add anything that isn't a trailing cell. (Trailings are duplicate copies of the leading.)
-            if (!it->DbcsAttr().IsTrailing())
-            {
-                retVal += it->Chars();
-            }
-        }
-
-        amountRead++;
-        it++;
-    }
+    // Read a row's worth of cells at a time, rather than walking a cell iterator over them. Halves of wide
+    // characters cut off by either end of the read come out as spaces, and trailing halves are skipped
+    // otherwise, since they're duplicate copies of the leading ones.
+    screenInfo.GetTextBuffer().ReadText(retVal, coordRead, amountToRead);
 
     return retVal;
 }
@@ -232,16 +214,18 @@ std::wstring ReadOutputStringW(const SCREEN_INFORMATION& screenInfo,
 // - screenInfo - reference to screen buffer information.
 // - coordRead - Screen buffer coordinate to begin reading from.
 // - amountToRead - the number of elements to read
+// - resource - where to allocate the result from
 // Return Value:
 // - string of char data
-std::string ReadOutputStringA(const SCREEN_INFORMATION& screenInfo,
-                              const COORD coordRead,
-                              const size_t amountToRead)
+std::pmr::string ReadOutputStringA(const SCREEN_INFORMATION& screenInfo,
+                                   const COORD coordRead,
+                                   const size_t amountToRead,
+                                   std::pmr::memory_resource* const resource)
 {
-    const auto wstr = ReadOutputStringW(screenInfo, coordRead, amountToRead);
+    const auto wstr = ReadOutputStringW(screenInfo, coordRead, amountToRead, resource);
 
     const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
-    return ConvertToA(gci.OutputCP, wstr);
+    return ConvertToA(gci.OutputCP, wstr, resource);
 }
 
 void ScreenBufferSizeChange(const COORD coordNewSize)
@@ -280,6 +264,25 @@ static void _ScrollScreen(SCREEN_INFORMATION& screenInfo, const Viewport& source
     // Get the render target and send it commands.
     // It will figure out whether or not we're active and where the messages need to go.
     auto& render = screenInfo.GetRenderTarget();
+
+    // If the contents only slid up and down or only left and right, the renderer
+    // can move what's already on the screen instead of redrawing all of it. The
+    // rest of the region they slid inside of was uncovered, so it's redrawn anyway.
+    const COORD delta = target.Origin() - source.Origin();
+    if ((delta.X == 0) != (delta.Y == 0) && Viewport::Intersect(source, target).IsValid())
+    {
+        const auto region = Viewport::Union(source, target);
+        render.TriggerScroll(region, &delta);
+
+        // Anything filled outside of that region still has to be redrawn.
+        const auto outside = Viewport::Subtract(fill, region);
+        for (size_t i = 0; i < outside.size(); i++)
+        {
+            render.TriggerRedraw(outside.at(i));
+        }
+        return;
+    }
+
     // Redraw anything in the target area
     render.TriggerRedraw(target);
     // Also redraw anything that was filled.
@@ -391,15 +394,19 @@ void ScrollRegion(SCREEN_INFORMATION& screenInfo,
 
     // Determine the cell we will use to fill in any revealed/uncovered space.
     // We generally use exactly what was given to us.
-    OutputCellIterator fillData(fillCharGiven, fillAttrsGiven);
+    auto fillChar = fillCharGiven;
+    auto fillAttrs = fillAttrsGiven;
 
     // However, if the character is null and we were given a null attribute (represented as legacy 0),
     // then we'll just fill with spaces and whatever the buffer's default colors are.
     if (fillCharGiven == UNICODE_NULL && fillAttrsGiven.IsLegacy() && fillAttrsGiven.GetLegacyAttributes() == 0)
     {
-        fillData = OutputCellIterator(UNICODE_SPACE, screenInfo.GetAttributes());
+        fillChar = UNICODE_SPACE;
+        fillAttrs = screenInfo.GetAttributes();
     }
 
+    OutputCellIterator fillData(fillChar, fillAttrs);
+
     // ------ 4. PREP TARGET ------
     // Now it's time to think about the target. We're only given the origin of the target
     // because it is assumed that it will have the same relative dimensions as the original source.
@@ -471,7 +478,17 @@ void ScrollRegion(SCREEN_INFORMATION& screenInfo,
     for (size_t i = 0; i < remaining.size(); i++)
     {
         const auto& view = remaining.at(i);
-        screenInfo.WriteRect(fillData, view);
+
+        // The rows uncovered by scrolling whole rows are usually blanked out
+        // entirely, and that can be done a row at a time instead of a cell at a time.
+        if (fillChar == UNICODE_SPACE && view.Left() == 0 && view.Width() == buffer.Width())
+        {
+            screenInfo.GetTextBuffer().ClearRows(view.Top(), view.Height(), fillAttrs);
+        }
+        else
+        {
+            screenInfo.WriteRect(fillData, view);
+        }
     }
 }
 
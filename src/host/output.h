@@ -27,17 +27,20 @@ void ScreenBufferSizeChange(const COORD coordNewSize);
 [[nodiscard]]
 NTSTATUS DoCreateScreenBuffer();
 
-std::vector<WORD> ReadOutputAttributes(const SCREEN_INFORMATION& screenInfo,
-                                       const COORD coordRead,
-                                       const size_t amountToRead);
+std::pmr::vector<WORD> ReadOutputAttributes(const SCREEN_INFORMATION& screenInfo,
+                                            const COORD coordRead,
+                                            const size_t amountToRead,
+                                            std::pmr::memory_resource* const resource);
 
-std::wstring ReadOutputStringW(const SCREEN_INFORMATION& screenInfo,
-                               const COORD coordRead,
-                               const size_t amountToRead);
-
-std::string ReadOutputStringA(const SCREEN_INFORMATION& screenInfo,
+std::pmr::wstring ReadOutputStringW(const SCREEN_INFORMATION& screenInfo,
                                     const COORD coordRead,
-                                    const size_t amountToRead);
+                                    const size_t amountToRead,
+                                    std::pmr::memory_resource* const resource);
+
+std::pmr::string ReadOutputStringA(const SCREEN_INFORMATION& screenInfo,
+                                   const COORD coordRead,
+                                   const size_t amountToRead,
+                                   std::pmr::memory_resource* const resource);
 
 void ScrollRegion(SCREEN_INFORMATION& screenInfo,
                   const SMALL_RECT scrollRect,
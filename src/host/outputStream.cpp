@@ -272,6 +272,44 @@ BOOL ConhostInternalGetSet::PrivateBoldText(const bool bolded)
     return TRUE;
 }
 
+// Routine Description:
+// - Gets the current attributes of the screen buffer, colors and all.
+// Arguments:
+// - attrs - Receives the attributes.
+// Return Value:
+// - TRUE if successful (see DoSrvPrivateGetTextAttributes). FALSE otherwise.
+BOOL ConhostInternalGetSet::PrivateGetTextAttributes(TextAttribute& attrs) const
+{
+    attrs = DoSrvPrivateGetTextAttributes(_io.GetActiveOutputBuffer());
+    return TRUE;
+}
+
+// Routine Description:
+// - Replaces the current attributes of the screen buffer in one go. This lets
+//     an SGR with many options apply them all at once.
+// Arguments:
+// - attrs - The new attributes.
+// Return Value:
+// - TRUE if successful (see DoSrvPrivateSetTextAttributes). FALSE otherwise.
+BOOL ConhostInternalGetSet::PrivateSetTextAttributes(const TextAttribute& attrs)
+{
+    DoSrvPrivateSetTextAttributes(_io.GetActiveOutputBuffer(), attrs);
+    return TRUE;
+}
+
+// Routine Description:
+// - Looks up the color that an entry of the xterm table stands for.
+// Arguments:
+// - iXtermTableEntry - The entry of the xterm table to look up.
+// - rgbColor - Receives the color.
+// Return Value:
+// - TRUE if successful (see DoSrvPrivateGetXtermColor). FALSE otherwise.
+BOOL ConhostInternalGetSet::PrivateGetXtermColor(const int iXtermTableEntry, COLORREF& rgbColor) const
+{
+    rgbColor = DoSrvPrivateGetXtermColor(iXtermTableEntry);
+    return TRUE;
+}
+
 // Routine Description:
 // - Connects the WriteConsoleInput API call directly into our Driver Message servicing call inside Conhost.exe
 // Arguments:
@@ -594,6 +632,19 @@ BOOL ConhostInternalGetSet::PrivateEnableAlternateScroll(const bool fEnabled)
     return TRUE;
 }
 
+// Routine Description:
+// - Connects the PrivateEnableBracketedPasteMode call directly into our Driver Message servicing call inside Conhost.exe
+//   PrivateEnableBracketedPasteMode is an internal-only "API" call that the vt commands can execute,
+//     but it is not represented as a function call on out public API surface.
+// Arguments:
+// - fEnabled - set to true to enable bracketed paste mode, false to disable
+// Return Value:
+// - TRUE if successful (see DoSrvPrivateEnableBracketedPasteMode). FALSE otherwise.
+BOOL ConhostInternalGetSet::PrivateEnableBracketedPasteMode(const bool fEnabled)
+{
+    return NT_SUCCESS(DoSrvPrivateEnableBracketedPasteMode(fEnabled));
+}
+
 // Routine Description:
 // - Connects the PrivateEraseAll call directly into our Driver Message servicing call inside Conhost.exe
 //   PrivateEraseAll is an internal-only "API" call that the vt commands can execute,
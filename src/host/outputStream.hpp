@@ -89,6 +89,13 @@ public:
 
     BOOL PrivateBoldText(const bool bolded) override;
 
+    BOOL PrivateGetTextAttributes(TextAttribute& attrs) const override;
+
+    BOOL PrivateSetTextAttributes(const TextAttribute& attrs) override;
+
+    BOOL PrivateGetXtermColor(const int iXtermTableEntry,
+                              COLORREF& rgbColor) const override;
+
     BOOL PrivateWriteConsoleInputW(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& events,
                             _Out_ size_t& eventsWritten) override;
 
@@ -130,6 +137,7 @@ public:
     BOOL PrivateEnableButtonEventMouseMode(const bool fEnabled) override;
     BOOL PrivateEnableAnyEventMouseMode(const bool fEnabled) override;
     BOOL PrivateEnableAlternateScroll(const bool fEnabled) override;
+    BOOL PrivateEnableBracketedPasteMode(const bool fEnabled) override;
     BOOL PrivateEraseAll() override;
 
     BOOL PrivateGetConsoleScreenBufferAttributes(_Out_ WORD* const pwAttributes) override;
@@ -72,7 +72,9 @@ COOKED_READ_DATA::COOKED_READ_DATA(_In_ InputBuffer* const pInputBuffer,
     _lineInput{ WI_IsFlagSet(pInputBuffer->InputMode, ENABLE_LINE_INPUT) },
     _processedInput{ WI_IsFlagSet(pInputBuffer->InputMode, ENABLE_PROCESSED_INPUT) },
     _insertMode{ ServiceLocator::LocateGlobals().getConsoleInformation().GetInsertMode() },
-    _unicode{ false }
+    _unicode{ false },
+    _gapOpen{ false },
+    _gapOldLine{}
 {
 #ifndef UNIT_TESTING
     THROW_IF_FAILED(screenInfo.GetMainBuffer().AllocateIoHandle(ConsoleHandleData::HandleType::Output,
@@ -493,6 +495,14 @@ bool COOKED_READ_DATA::ProcessInput(const wchar_t wchOrig,
         return false;
     }
 
+    // A run of plain characters going into the middle of the line is only
+    // drawn once it's ended.
+    if (_TryInsertIntoGap(wch))
+    {
+        return false;
+    }
+    _CloseGap();
+
     if (_ctrlWakeupMask != 0 && wch < L' ' && (_ctrlWakeupMask & (1 << wch)))
     {
         *_bufPtr = wch;
@@ -586,6 +596,14 @@ bool COOKED_READ_DATA::ProcessInput(const wchar_t wchOrig,
         // write the new command line to the screen
         // update the cursor position
 
+        // Keep what the line looks like on the screen, so that afterwards only the
+        // cells that changed have to be redrawn, when that's possible.
+        std::wstring oldLine;
+        if (_echoInput)
+        {
+            oldLine.assign(_backupLimit, _bytesRead / sizeof(WCHAR));
+        }
+
         if (wch == UNICODE_BACKSPACE && _processedInput)
         {
             // for backspace, use writechars to calculate the new cursor position.
@@ -621,6 +639,12 @@ bool COOKED_READ_DATA::ProcessInput(const wchar_t wchOrig,
                         {
                             RIPMSG1(RIP_WARNING, "WriteCharsLegacy failed %x", status);
                         }
+
+                        // The backspace blanked out the cell before the cursor.
+                        if (_currentPosition - 1 < oldLine.size())
+                        {
+                            oldLine.at(_currentPosition - 1) = UNICODE_SPACE;
+                        }
                     }
                     _bytesRead -= sizeof(WCHAR);
                     _bufPtr -= 1;
@@ -707,32 +731,36 @@ bool COOKED_READ_DATA::ProcessInput(const wchar_t wchOrig,
             CursorPosition = _screenInfo.GetTextBuffer().GetCursor().GetPosition();
             CursorPosition.X = (SHORT)(CursorPosition.X + NumSpaces);
 
-            // clear the current command line from the screen
+            // write only the cells that changed, if we can
+            if (!RedrawCommandLineChanges(*this, oldLine))
+            {
+                // clear the current command line from the screen
 #pragma prefast(suppress:__WARNING_BUFFER_OVERFLOW, "Not sure why prefast doesn't like this call.")
-            DeleteCommandLine(*this, FALSE);
+                DeleteCommandLine(*this, FALSE);
 
-            // write the new command line to the screen
-            NumToWrite = _bytesRead;
+                // write the new command line to the screen
+                NumToWrite = _bytesRead;
 
-            DWORD dwFlags = WC_DESTRUCTIVE_BACKSPACE | WC_ECHO;
-            if (wch == UNICODE_CARRIAGERETURN)
-            {
-                dwFlags |= WC_KEEP_CURSOR_VISIBLE;
-            }
-            status = WriteCharsLegacy(_screenInfo,
-                                      _backupLimit,
-                                      _backupLimit,
-                                      _backupLimit,
-                                      &NumToWrite,
-                                      &_visibleCharCount,
-                                      _originalCursorPosition.X,
-                                      dwFlags,
-                                      &ScrollY);
-            if (!NT_SUCCESS(status))
-            {
-                RIPMSG1(RIP_WARNING, "WriteCharsLegacy failed 0x%x", status);
-                _bytesRead = 0;
-                return true;
+                DWORD dwFlags = WC_DESTRUCTIVE_BACKSPACE | WC_ECHO;
+                if (wch == UNICODE_CARRIAGERETURN)
+                {
+                    dwFlags |= WC_KEEP_CURSOR_VISIBLE;
+                }
+                status = WriteCharsLegacy(_screenInfo,
+                                          _backupLimit,
+                                          _backupLimit,
+                                          _backupLimit,
+                                          &NumToWrite,
+                                          &_visibleCharCount,
+                                          _originalCursorPosition.X,
+                                          dwFlags,
+                                          &ScrollY);
+                if (!NT_SUCCESS(status))
+                {
+                    RIPMSG1(RIP_WARNING, "WriteCharsLegacy failed 0x%x", status);
+                    _bytesRead = 0;
+                    return true;
+                }
             }
 
             // update cursor position
@@ -856,6 +884,123 @@ size_t COOKED_READ_DATA::Write(const std::wstring_view wstr)
     return charsInserted;
 }
 
+// Routine Description:
+// - Puts a character into the gap at the cursor, opening the gap first if
+//      more input is waiting behind this character. Only plain characters
+//      typed in insert mode into a plain line that's echoed go into the gap,
+//      since those are the only ones we can work out where the cursor ends
+//      up for without drawing them.
+// Arguments:
+// - wch - the character.
+// Return Value:
+// - true if the character went into the gap, and there's nothing more to do with it.
+bool COOKED_READ_DATA::_TryInsertIntoGap(const wchar_t wch) noexcept
+{
+    if (!_echoInput || !_insertMode || wch < UNICODE_SPACE || wch >= 0x007F)
+    {
+        return false;
+    }
+
+    const size_t length = _bytesRead / sizeof(wchar_t);
+    if (!_gapOpen)
+    {
+        if (AtEol() ||
+            _originalCursorPosition.X < 0 ||
+            _visibleCharCount != length ||
+            _pInputBuffer->GetNumberOfReadyEvents() == 0 ||
+            !std::all_of(_backupLimit, _backupLimit + length, [](const wchar_t ch) { return ch >= UNICODE_SPACE && ch < 0x007F; }))
+        {
+            return false;
+        }
+
+        try
+        {
+            _gapOldLine.assign(_backupLimit, length);
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            return false;
+        }
+
+        const size_t capacity = _bufferSize / sizeof(wchar_t);
+        const size_t tail = length - _currentPosition;
+        wmemmove(_backupLimit + capacity - tail, _bufPtr, tail);
+        _gapOpen = true;
+    }
+
+    *_bufPtr = wch;
+    _bufPtr += 1;
+    _currentPosition += 1;
+    _bytesRead += sizeof(wchar_t);
+
+    if (_pInputBuffer->GetNumberOfReadyEvents() == 0)
+    {
+        _CloseGap();
+    }
+    return true;
+}
+
+// Routine Description:
+// - Closes the gap, if it's open, putting the text after the cursor back
+//      where it belongs, and draws the characters that went into the gap and
+//      what they pushed along, all at once.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void COOKED_READ_DATA::_CloseGap() noexcept
+{
+    if (!_gapOpen)
+    {
+        return;
+    }
+    _gapOpen = false;
+
+    const size_t capacity = _bufferSize / sizeof(wchar_t);
+    const size_t length = _bytesRead / sizeof(wchar_t);
+    const size_t tail = length - _currentPosition;
+    wmemmove(_bufPtr, _backupLimit + capacity - tail, tail);
+
+    // The buffer past the end of the line is kept blank.
+    const size_t blankFrom = std::max(length, capacity - tail);
+    std::fill(_backupLimit + blankFrom, _backupLimit + capacity, UNICODE_SPACE);
+
+    try
+    {
+        if (!RedrawCommandLineChanges(*this, _gapOldLine))
+        {
+            DeleteCommandLine(*this, FALSE);
+
+            size_t NumToWrite = _bytesRead;
+            SHORT ScrollY = 0;
+            const NTSTATUS status = WriteCharsLegacy(_screenInfo,
+                                                     _backupLimit,
+                                                     _backupLimit,
+                                                     _backupLimit,
+                                                     &NumToWrite,
+                                                     &_visibleCharCount,
+                                                     _originalCursorPosition.X,
+                                                     WC_DESTRUCTIVE_BACKSPACE | WC_ECHO,
+                                                     &ScrollY);
+            if (!NT_SUCCESS(status))
+            {
+                RIPMSG1(RIP_WARNING, "WriteCharsLegacy failed 0x%x", status);
+            }
+            _originalCursorPosition.Y += ScrollY;
+        }
+
+        // The line's plain, so every character in it takes one cell.
+        const SHORT width = _screenInfo.GetBufferSize().Width();
+        const size_t cell = _originalCursorPosition.X + _currentPosition;
+        const COORD cursorPosition{ gsl::narrow<SHORT>(cell % width), gsl::narrow<SHORT>(_originalCursorPosition.Y + cell / width) };
+        LOG_IF_NTSTATUS_FAILED(AdjustCursorPosition(_screenInfo, cursorPosition, TRUE, nullptr));
+    }
+    CATCH_LOG();
+
+    _gapOldLine.clear();
+}
+
 // Routine Description:
 // - saves data in the prompt buffer to the outgoing user buffer
 // Arguments:
@@ -954,6 +1099,8 @@ NTSTATUS COOKED_READ_DATA::_readCharInputLoop(const bool isUnicode, size_t& numB
 
         if (commandLineEditingKeys)
         {
+            _CloseGap();
+
             // TODO: this is super weird for command line popups only
             _unicode = isUnicode;
 
@@ -987,6 +1134,9 @@ NTSTATUS COOKED_READ_DATA::_readCharInputLoop(const bool isUnicode, size_t& numB
             }
         }
     }
+
+    // Whatever went into the gap is drawn before we wait for more input.
+    _CloseGap();
     return Status;
 }
 
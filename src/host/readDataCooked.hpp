@@ -156,6 +156,18 @@ private:
     bool _insertMode;
     bool _unicode;
 
+    // While a run of characters is being typed or pasted into the middle of
+    // the line, the text after the cursor is kept at the far end of the
+    // buffer, so each character goes in without moving the rest of the line,
+    // and the line is only redrawn once the run ends. The gap is only ever
+    // open inside _readCharInputLoop. _gapOldLine is the line as it's shown
+    // on the screen, from when the gap was opened.
+    bool _gapOpen;
+    std::wstring _gapOldLine;
+
+    bool _TryInsertIntoGap(const wchar_t wch) noexcept;
+    void _CloseGap() noexcept;
+
     [[nodiscard]]
     NTSTATUS _readCharInputLoop(const bool isUnicode, size_t& numBytes) noexcept;
 
@@ -40,6 +40,18 @@ DirectReadData::~DirectReadData()
 {
 }
 
+// Routine Description:
+// - A direct read keeps waiting through a ctrl-c or ctrl-break (see Notify),
+//   so there's no need to notify it of them.
+// Arguments:
+// - <none>
+// Return Value:
+// - false
+bool DirectReadData::IsInterruptible() const noexcept
+{
+    return false;
+}
+
 // Routine Description:
 // - This routine is called to complete a direct read that blocked in
 //   ReadInputBuffer. The context of the read was saved in the DirectReadData
@@ -41,6 +41,8 @@ public:
 
     ~DirectReadData() override;
 
+    bool IsInterruptible() const noexcept override;
+
     bool Notify(const WaitTerminationReason TerminationReason,
                 const bool fIsUnicode,
                 _Out_ NTSTATUS* const pReplyStatus,
@@ -6,6 +6,7 @@
 #include "renderData.hpp"
 
 #include "dbcs.h"
+#include "findAll.h"
 #include "handle.h"
 
 #include "..\interactivity\inc\ServiceLocator.hpp"
@@ -183,7 +184,10 @@ const std::vector<RenderOverlay> RenderData::GetOverlays() const noexcept
 
     try
     {
-        // First retrieve the IME information and build overlays.
+        // The highlights of a find-all go under the IME's overlays.
+        FindAll::Instance().AppendOverlays(overlays);
+
+        // Then retrieve the IME information and build overlays.
         const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
         const auto& ime = gci.ConsoleIme;
 
@@ -316,14 +320,16 @@ const COLORREF RenderData::GetBackgroundColor(const TextAttribute& attr) const n
 //      operation.
 //   Callers should make sure to also call RenderData::UnlockConsole once
 //      they're done with any querying they need to do.
+// - The console is only locked for reading, so the queries that only read
+//      (like the cursor or the mode) don't have to wait for a paint.
 void RenderData::LockConsole() noexcept
 {
-    ::LockConsole();
+    ::LockConsoleShared();
 }
 
 // Method Description:
 // - Unlocks the console after a call to RenderData::LockConsole.
 void RenderData::UnlockConsole() noexcept
 {
-    ::UnlockConsole();
+    ::UnlockConsoleShared();
 }
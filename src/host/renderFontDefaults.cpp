@@ -7,14 +7,20 @@
 
 #pragma hdrstop
 
-RenderFontDefaults::RenderFontDefaults()
+// The list of TrueType fonts is read from the registry the first time a
+//      default font is asked for, rather than when we start. Plenty of consoles
+//      never ask for one (a pseudoconsole, or one that was given a font).
+RenderFontDefaults::RenderFontDefaults() :
+    _initialized(false)
 {
-    LOG_IF_NTSTATUS_FAILED(TrueTypeFontList::s_Initialize());
 }
 
 RenderFontDefaults::~RenderFontDefaults()
 {
-    LOG_IF_FAILED(TrueTypeFontList::s_Destroy());
+    if (_initialized)
+    {
+        LOG_IF_FAILED(TrueTypeFontList::s_Destroy());
+    }
 }
 
 [[nodiscard]]
@@ -22,6 +28,12 @@ HRESULT RenderFontDefaults::RetrieveDefaultFontNameForCodepage(const UINT uiCode
                                                                _Out_writes_(cchFaceName) PWSTR pwszFaceName,
                                                                const size_t cchFaceName)
 {
+    std::call_once(_initializeOnce, [this]() {
+        const auto trace = Tracing::s_TraceStartupPhase("TrueTypeFontList");
+        LOG_IF_NTSTATUS_FAILED(TrueTypeFontList::s_Initialize());
+        _initialized = true;
+    });
+
     NTSTATUS status = TrueTypeFontList::s_SearchByCodePage(uiCodePage, pwszFaceName, cchFaceName);
     return HRESULT_FROM_NT(status);
 }
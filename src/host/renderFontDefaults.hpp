@@ -28,4 +28,8 @@ public:
     HRESULT RetrieveDefaultFontNameForCodepage(const UINT uiCodePage,
                                                _Out_writes_(cchFaceName) PWSTR pwszFaceName,
                                                const size_t cchFaceName);
+
+private:
+    std::once_flag _initializeOnce;
+    bool _initialized;
 };
@@ -547,6 +547,7 @@ void SCREEN_INFORMATION::RefreshFontWithRenderer()
                                     GetCurrentFont());
 
             NotifyGlyphWidthFontChanged();
+            PrewarmGlyphWidthFallback(LockConsole, UnlockConsole);
         }
     }
 }
@@ -616,13 +617,8 @@ void SCREEN_INFORMATION::NotifyAccessibilityEventing(const short sStartX,
             _pAccessibilityNotifier->NotifyConsoleUpdateRegionEvent(MAKELONG(sStartX, sStartY),
                                                                     MAKELONG(sEndX, sEndY));
         }
-        IConsoleWindow* pConsoleWindow = ServiceLocator::LocateConsoleWindow();
-        if (pConsoleWindow)
-        {
-            LOG_IF_FAILED(pConsoleWindow->SignalUia(UIA_Text_TextChangedEventId));
-            // TODO MSFT 7960168 do we really need this event to not signal?
-            //pConsoleWindow->SignalUia(UIA_LayoutInvalidatedEventId);
-        }
+        // The notifier lets UIA know the text changed along with the update, once it
+        // has gathered up the rest of the frame's changes.
     }
 }
 
@@ -1428,197 +1424,8 @@ NTSTATUS SCREEN_INFORMATION::ResizeWithReflow(const COORD coordNewScreenSize)
     oldCursor.StartDeferDrawing();
     newCursor.StartDeferDrawing();
 
-    // We need to save the old cursor position so that we can
-    // place the new cursor back on the equivalent character in
-    // the new buffer.
-    COORD cOldCursorPos = oldCursor.GetPosition();
-    COORD cOldLastChar = _textBuffer->GetLastNonSpaceCharacter();
-
-    short const cOldRowsTotal = cOldLastChar.Y + 1;
-    short const cOldColsTotal = GetBufferSize().Width();
-
-    COORD cNewCursorPos = { 0 };
-    bool fFoundCursorPos = false;
-
-    NTSTATUS status = STATUS_SUCCESS;
-    // Loop through all the rows of the old buffer and reprint them into the new buffer
-    for (short iOldRow = 0; iOldRow < cOldRowsTotal; iOldRow++)
-    {
-        // Fetch the row and its "right" which is the last printable character.
-        const ROW& Row = _textBuffer->GetRowByOffset(iOldRow);
-        const CharRow& charRow = Row.GetCharRow();
-        short iRight = static_cast<short>(charRow.MeasureRight());
-
-        // There is a special case here. If the row has a "wrap"
-        // flag on it, but the right isn't equal to the width (one
-        // index past the final valid index in the row) then there
-        // were a bunch trailing of spaces in the row.
-        // (But the measuring functions for each row Left/Right do
-        // not count spaces as "displayable" so they're not
-        // included.)
-        // As such, adjust the "right" to be the width of the row
-        // to capture all these spaces
-        if (charRow.WasWrapForced())
-        {
-            iRight = cOldColsTotal;
-
-            // And a combined special case.
-            // If we wrapped off the end of the row by adding a
-            // piece of padding because of a double byte LEADING
-            // character, then remove one from the "right" to
-            // leave this padding out of the copy process.
-            if (charRow.WasDoubleBytePadded())
-            {
-                iRight--;
-            }
-        }
-
-        // Loop through every character in the current row (up to
-        // the "right" boundary, which is one past the final valid
-        // character)
-        for (short iOldCol = 0; iOldCol < iRight; iOldCol++)
-        {
-            if (iOldCol == cOldCursorPos.X && iOldRow == cOldCursorPos.Y)
-            {
-                cNewCursorPos = newCursor.GetPosition();
-                fFoundCursorPos = true;
-            }
-
-            try
-            {
-                // TODO: MSFT: 19446208 - this should just use an iterator and the inserter...
-                const auto glyph = Row.GetCharRow().GlyphAt(iOldCol);
-                const auto dbcsAttr = Row.GetCharRow().DbcsAttrAt(iOldCol);
-                const auto textAttr = Row.GetAttrRow().GetAttrByColumn(iOldCol);
-
-                if (!newTextBuffer->InsertCharacter(glyph, dbcsAttr, textAttr))
-                {
-                    status = STATUS_NO_MEMORY;
-                    break;
-                }
-            }
-            catch (...)
-            {
-                return NTSTATUS_FROM_HRESULT(wil::ResultFromCaughtException());
-            }
-        }
-        if (NT_SUCCESS(status))
-        {
-            // If we didn't have a full row to copy, insert a new
-            // line into the new buffer.
-            // Only do so if we were not forced to wrap. If we did
-            // force a word wrap, then the existing line break was
-            // only because we ran out of space.
-            if (iRight < cOldColsTotal && !charRow.WasWrapForced())
-            {
-                if (iRight == cOldCursorPos.X && iOldRow == cOldCursorPos.Y)
-                {
-                    cNewCursorPos = newCursor.GetPosition();
-                    fFoundCursorPos = true;
-                }
-                // Only do this if it's not the final line in the buffer.
-                // On the final line, we want the cursor to sit
-                // where it is done printing for the cursor
-                // adjustment to follow.
-                if (iOldRow < cOldRowsTotal - 1)
-                {
-                    status = newTextBuffer->NewlineCursor() ? status : STATUS_NO_MEMORY;
-                }
-                else
-                {
-                    // If we are on the final line of the buffer, we have one more check.
-                    // We got into this code path because we are at the right most column of a row in the old buffer
-                    // that had a hard return (no wrap was forced).
-                    // However, as we're inserting, the old row might have just barely fit into the new buffer and
-                    // caused a new soft return (wrap was forced) putting the cursor at x=0 on the line just below.
-                    // We need to preserve the memory of the hard return at this point by inserting one additional
-                    // hard newline, otherwise we've lost that information.
-                    // We only do this when the cursor has just barely poured over onto the next line so the hard return
-                    // isn't covered by the soft one.
-                    // e.g.
-                    // The old line was:
-                    // |aaaaaaaaaaaaaaaaaaa | with no wrap which means there was a newline after that final a.
-                    // The cursor was here ^
-                    // And the new line will be:
-                    // |aaaaaaaaaaaaaaaaaaa| and show a wrap at the end
-                    // |                   |
-                    //  ^ and the cursor is now there.
-                    // If we leave it like this, we've lost the newline information.
-                    // So we insert one more newline so a continued reflow of this buffer by resizing larger will
-                    // continue to look as the original output intended with the newline data.
-                    // After this fix, it looks like this:
-                    // |aaaaaaaaaaaaaaaaaaa| no wrap at the end (preserved hard newline)
-                    // |                   |
-                    //  ^ and the cursor is now here.
-                    const COORD coordNewCursor = newCursor.GetPosition();
-                    if (coordNewCursor.X == 0 && coordNewCursor.Y > 0)
-                    {
-                        if (newTextBuffer->GetRowByOffset(coordNewCursor.Y - 1).GetCharRow().WasWrapForced())
-                        {
-                            status = newTextBuffer->NewlineCursor() ? status : STATUS_NO_MEMORY;
-                        }
-                    }
-                }
-            }
-        }
-    }
-    if (NT_SUCCESS(status))
-    {
-        // Finish copying remaining parameters from the old text buffer to the new one
-        newTextBuffer->CopyProperties(*_textBuffer);
-
-        // If we found where to put the cursor while placing characters into the buffer,
-        //   just put the cursor there. Otherwise we have to advance manually.
-        if (fFoundCursorPos)
-        {
-            newCursor.SetPosition(cNewCursorPos);
-        }
-        else
-        {
-            // Advance the cursor to the same offset as before
-            // get the number of newlines and spaces between the old end of text and the old cursor,
-            //   then advance that many newlines and chars
-            int iNewlines = cOldCursorPos.Y - cOldLastChar.Y;
-            int iIncrements = cOldCursorPos.X - cOldLastChar.X;
-            const COORD cNewLastChar = newTextBuffer->GetLastNonSpaceCharacter();
-
-            // If the last row of the new buffer wrapped, there's going to be one less newline needed,
-            //   because the cursor is already on the next line
-            if (newTextBuffer->GetRowByOffset(cNewLastChar.Y).GetCharRow().WasWrapForced())
-            {
-                iNewlines = std::max(iNewlines - 1, 0);
-            }
-            else
-            {
-                // if this buffer didn't wrap, but the old one DID, then the d(columns) of the
-                //   old buffer will be one more than in this buffer, so new need one LESS.
-                if (_textBuffer->GetRowByOffset(cOldLastChar.Y).GetCharRow().WasWrapForced())
-                {
-                    iNewlines = std::max(iNewlines - 1, 0);
-                }
-            }
-
-            for (int r = 0; r < iNewlines; r++)
-            {
-                if (!newTextBuffer->NewlineCursor())
-                {
-                    status = STATUS_NO_MEMORY;
-                    break;
-                }
-            }
-            if (NT_SUCCESS(status))
-            {
-                for (int c = 0; c < iIncrements - 1; c++)
-                {
-                    if (!newTextBuffer->IncrementCursor())
-                    {
-                        status = STATUS_NO_MEMORY;
-                        break;
-                    }
-                }
-            }
-        }
-    }
+    // Reprint the text of the old buffer into the new one, rewrapping as we go.
+    NTSTATUS status = NTSTATUS_FROM_HRESULT(TextBuffer::Reflow(*_textBuffer, *newTextBuffer));
 
     if (NT_SUCCESS(status))
     {
@@ -2532,23 +2339,21 @@ OutputCellRect SCREEN_INFORMATION::ReadRect(const Viewport viewport) const
     const OutputCell paddingCell{ std::wstring_view{ &UNICODE_SPACE, 1 }, {}, GetAttributes() };
     for (size_t rowIndex = 0; rowIndex < gsl::narrow<size_t>(viewport.Height()); ++rowIndex)
     {
-        COORD location = viewport.Origin();
-        location.Y += (SHORT)rowIndex;
+        // Each row is copied straight out of its character and attribute storage in one
+        // pass, rather than moving a cell iterator (and looking the row up again) per cell.
+        const auto& row = _textBuffer->GetRowByOffset(viewport.Top() + rowIndex);
+        const auto& charRow = row.GetCharRow();
+        auto attr = row.GetAttrRow().cbegin();
+        attr += viewport.Left();
 
-        auto data = GetCellLineDataAt(location);
         const auto span = result.GetRow(rowIndex);
-        auto it = span.begin();
-
-        // Copy row data while there still is data and we haven't run out of rect to store it into.
-        while (data && it < span.end())
+        size_t column = viewport.Left();
+        for (auto it = span.begin(); it < span.end(); ++it, ++attr, ++column)
         {
-            *it++ = *data++;
-        }
-
-        // Pad out any remaining space.
-        while (it < span.end())
-        {
-            *it++ = paddingCell;
+            *it = OutputCell{ OutputCellView{ charRow.GlyphAt(column),
+                                              charRow.DbcsAttrAt(column),
+                                              *attr,
+                                              TextAttributeBehavior::Stored } };
         }
 
         // if we're clipping a dbcs char then don't include it, add a space instead
@@ -2642,6 +2447,23 @@ void SCREEN_INFORMATION::WriteRect(const OutputCellRect& data,
     }
 }
 
+// Routine Description:
+// - This routine writes a rectangular region of legacy cells into the screen buffer.
+// Arguments:
+// - cells - the cells to write, in rows that are stride cells apart
+// - stride - how many cells apart the start of each row is in cells
+// - viewport - rectangular region for insertion
+// Return Value:
+// - <none>
+// Note:
+// - will throw exception on error.
+void SCREEN_INFORMATION::WriteRect(const std::basic_string_view<CHAR_INFO> cells,
+                                   const size_t stride,
+                                   const Viewport viewport)
+{
+    _textBuffer->WriteCharInfoRect(cells, stride, viewport);
+}
+
 // Routine Description:
 // - Clears out the entire text buffer with the default character and
 //   the current default attribute applied to this screen.
@@ -2665,28 +2487,21 @@ std::pair<COORD, COORD> SCREEN_INFORMATION::GetWordBoundary(const COORD position
     COORD start{ clampedPosition };
     COORD end{ clampedPosition };
 
-    // find the start of the word
-    auto startIt = GetTextLineDataAt(clampedPosition);
-    while (startIt)
+    // find the start of the word: the start of the run of word characters just before the position, if there is one
+    if (start.X > 0)
     {
-        --startIt;
-        if (!startIt || IsWordDelim(*startIt))
+        const auto before = GetWordRun({ gsl::narrow_cast<SHORT>(start.X - 1), start.Y });
+        if (!before.delimiter)
         {
-            break;
+            start.X = before.left;
         }
-        --start.X;
     }
 
-    // find the end of the word
-    auto endIt = GetTextLineDataAt(clampedPosition);
-    while (endIt)
+    // find the end of the word: the first delimiter at or after the position, or the end of the row
+    const auto at = GetWordRun(clampedPosition);
+    if (!at.delimiter)
     {
-        if (IsWordDelim(*endIt))
-        {
-            break;
-        }
-        ++endIt;
-        ++end.X;
+        end.X = gsl::narrow_cast<SHORT>(at.right + 1);
     }
 
     // trim leading zeros if we need to
@@ -2731,6 +2546,44 @@ std::pair<COORD, COORD> SCREEN_INFORMATION::GetWordBoundary(const COORD position
     return { start, end };
 }
 
+// Routine Description:
+// - Gets the run of word characters, or of delimiters, that a position is in.
+//   The runs of each row are worked out once and reused until the row changes.
+// Arguments:
+// - position - a position inside the buffer
+// Return Value:
+// - the run, within the position's row
+WordRunCache::Run SCREEN_INFORMATION::GetWordRun(const COORD position) const
+{
+    return _wordRuns.GetRun(*_textBuffer, position);
+}
+
+// Routine Description:
+// - Starts exporting all of this buffer's text to a file, in the background, from a
+//   snapshot taken now. The colors are the ones the console paints with right now.
+//   An export of this buffer that's still going from before is cancelled first.
+// - The caller should hold the console lock, but only until this returns.
+// Arguments:
+// - path - the file to export to. Whatever's there already is replaced.
+// - format - whether to write plain text, VT or HTML
+// Return Value:
+// - the export, to follow its progress or wait for it. It's good until the next
+//   export of this buffer is started, or the buffer goes away.
+// Note: will throw exception if the file can't be created
+TextBufferExport& SCREEN_INFORMATION::StartExport(const std::wstring& path, const TextBufferExport::Format format)
+{
+    const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+    ResolvedColorTable colors;
+    colors.Update({ gci.GetColorTable(), gci.GetColorTableSize() },
+                  gci.CalculateDefaultForeground(),
+                  gci.CalculateDefaultBackground());
+
+    _export.reset();
+    _export = std::make_unique<TextBufferExport>(*_textBuffer, colors, path, format);
+    return *_export;
+}
+
 TextBuffer& SCREEN_INFORMATION::GetTextBuffer() noexcept
 {
     return *_textBuffer;
@@ -23,10 +23,12 @@ Revision History:
 #include "settings.hpp"
 #include "outputStream.hpp"
 #include "ScreenBufferRenderTarget.hpp"
+#include "wordRuns.h"
 
 #include "../buffer/out/OutputCellRect.hpp"
 #include "../buffer/out/TextAttribute.hpp"
 #include "../buffer/out/textBuffer.hpp"
+#include "../buffer/out/TextBufferExport.hpp"
 #include "../buffer/out/textBufferCellIterator.hpp"
 #include "../buffer/out/textBufferTextIterator.hpp"
 
@@ -147,9 +149,16 @@ public:
     void WriteRect(const OutputCellRect& data,
                    const COORD location);
 
+    void WriteRect(const std::basic_string_view<CHAR_INFO> cells,
+                   const size_t stride,
+                   const Microsoft::Console::Types::Viewport viewport);
+
     void ClearTextData();
 
     std::pair<COORD, COORD> GetWordBoundary(const COORD position) const;
+    WordRunCache::Run GetWordRun(const COORD position) const;
+
+    TextBufferExport& StartExport(const std::wstring& path, const TextBufferExport::Format format);
 
     TextBuffer& GetTextBuffer() noexcept;
     const TextBuffer& GetTextBuffer() const noexcept;
@@ -169,6 +178,9 @@ public:
     short HWheelDelta;
 private:
     std::unique_ptr<TextBuffer> _textBuffer;
+    mutable WordRunCache _wordRuns;
+    // the export that was started last, if any. It goes away before the buffer does.
+    std::unique_ptr<TextBufferExport> _export;
 public:
     SCREEN_INFORMATION *Next;
     BYTE WriteConsoleDbcsLeadByte[2];
@@ -7,8 +7,10 @@
 
 #include "dbcs.h"
 #include "../buffer/out/CharRow.hpp"
-#include "../types/inc/Utf16Parser.hpp"
-#include "../types/inc/GlyphWidth.hpp"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 // Routine Description:
 // - Constructs a Search object.
@@ -19,14 +21,18 @@
 // - str - The search term you want to find (the "needle")
 // - direction - The direction to search (upward or downward)
 // - sensitivity - Whether or not you care about case
+// - syntax - Whether the search term is text or a regular expression
+// - NOTE: Throws E_INVALIDARG if the search term isn't a valid regular expression.
 Search::Search(const SCREEN_INFORMATION& screenInfo,
                const std::wstring& str,
                const Direction direction,
-               const Sensitivity sensitivity) :
+               const Sensitivity sensitivity,
+               const Syntax syntax) :
     _direction(direction),
     _sensitivity(sensitivity),
     _screenInfo(screenInfo),
-    _needle(s_CreateNeedleFromString(str)),
+    _needle(s_CreateNeedleFromString(str, sensitivity)),
+    _regex(s_CreateRegex(str, sensitivity, syntax)),
     _coordAnchor(s_GetInitialAnchor(screenInfo, direction))
 {
     _coordNext = _coordAnchor;
@@ -42,15 +48,19 @@ Search::Search(const SCREEN_INFORMATION& screenInfo,
 // - direction - The direction to search (upward or downward)
 // - sensitivity - Whether or not you care about case
 // - anchor - starting search location in screenInfo
+// - syntax - Whether the search term is text or a regular expression
+// - NOTE: Throws E_INVALIDARG if the search term isn't a valid regular expression.
 Search::Search(const SCREEN_INFORMATION& screenInfo,
                const std::wstring& str,
                const Direction direction,
                const Sensitivity sensitivity,
-               const COORD anchor) :
+               const COORD anchor,
+               const Syntax syntax) :
     _direction(direction),
     _sensitivity(sensitivity),
     _screenInfo(screenInfo),
-    _needle(s_CreateNeedleFromString(str)),
+    _needle(s_CreateNeedleFromString(str, sensitivity)),
+    _regex(s_CreateRegex(str, sensitivity, syntax)),
     _coordAnchor(anchor)
 {
     _coordNext = _coordAnchor;
@@ -71,21 +81,56 @@ bool Search::FindNext()
         return false;
     }
 
-    do
+    if (_needle.empty())
     {
-        if (_FindNeedleInHaystackAt(_coordNext, _coordSelStart, _coordSelEnd))
-        {
-            _UpdateNextPosition();
-            _reachedEnd = _coordNext == _coordAnchor;
-            return true;
-        }
-        else
-        {
-            _UpdateNextPosition();
-        }
+        return false;
+    }
 
-    } while (_coordNext != _coordAnchor);
+    if (!_regex)
+    {
+        _CreateHaystack();
+    }
+
+    // We look at every cell from the next one on, until we're back at the
+    // anchor. If we're starting at the anchor, that's all of them.
+    const auto bufferSize = _screenInfo.GetBufferSize().Dimensions();
+    const size_t cells = static_cast<size_t>(bufferSize.X) * bufferSize.Y;
+    const auto next = _CellFromCoord(_coordNext);
+    const auto anchor = _CellFromCoord(_coordAnchor);
 
+    bool found = false;
+    if (_direction == Direction::Forward)
+    {
+        const auto count = (anchor + cells - next) % cells;
+        const auto stop = next + (count == 0 ? cells : count);
+        found = stop <= cells ? _FindForward(next, stop, _coordSelStart, _coordSelEnd) :
+                                _FindForward(next, cells, _coordSelStart, _coordSelEnd) ||
+                                    _FindForward(0, stop - cells, _coordSelStart, _coordSelEnd);
+    }
+    else if (_direction == Direction::Backward)
+    {
+        auto count = (next + cells - anchor) % cells;
+        count = count == 0 ? cells : count;
+        found = count <= next + 1 ? _FindBackward(next + 1 - count, next + 1, _coordSelStart, _coordSelEnd) :
+                                    _FindBackward(0, next + 1, _coordSelStart, _coordSelEnd) ||
+                                        _FindBackward(cells - (count - next - 1), cells, _coordSelStart, _coordSelEnd);
+    }
+    else
+    {
+        THROW_HR(E_NOTIMPL);
+    }
+
+    if (found)
+    {
+        _coordNext = _coordSelStart;
+        _UpdateNextPosition();
+        _reachedEnd = _coordNext == _coordAnchor;
+        return true;
+    }
+
+    _coordSelStart = { 0 };
+    _coordSelEnd = { 0 };
+    _coordNext = _coordAnchor;
     return false;
 }
 
@@ -164,91 +209,352 @@ COORD Search::s_GetInitialAnchor(const SCREEN_INFORMATION& screenInfo, const Dir
 }
 
 // Routine Description:
-// - Attempts to compare the search term (the needle) to the screen buffer (the haystack)
-//   at the given coordinate position of the screen buffer.
-// - Performs one comparison. Call again with new positions to check other spots.
+// - How much of the haystack a cell is: nothing for the second half of a
+//   wide glyph, else the length of its glyph.
 // Arguments:
-// - pos - The position in the haystack (screen buffer) to compare
-// - start - If we found it, this is filled with the coordinate of the first character of the needle.
-// - end - If we found it, this is filled with the coordinate of the last character of the needle.
+// - charRow - The row that the cell is in
+// - column - The cell
 // Return Value:
-// - True if we found it. False if not.
-bool Search::_FindNeedleInHaystackAt(const COORD pos, COORD& start, COORD& end) const
+// - The number of characters.
+static size_t s_CellLength(const CharRow& charRow, const size_t column)
+{
+    const auto& attr = charRow.DbcsAttrAt(column);
+    if (attr.IsTrailing())
+    {
+        return 0;
+    }
+    return attr.IsGlyphStored() ? std::wstring_view{ charRow.GlyphAt(column) }.size() : 1;
+}
+
+// Routine Description:
+// - Takes the text out of the screen buffer to search through, if we haven't yet.
+//   It doesn't change while we're searching, since the console is locked, and
+//   coloring the matches only touches the attributes.
+void Search::_CreateHaystack()
+{
+    if (!_rowOffsets.empty())
+    {
+        return;
+    }
+
+    const auto& textBuffer = _screenInfo.GetTextBuffer();
+    const auto bufferSize = _screenInfo.GetBufferSize().Dimensions();
+
+    _rowOffsets.reserve(bufferSize.Y + 1);
+    std::optional<ROW> scratch;
+    for (SHORT y = 0; y < bufferSize.Y; y++)
+    {
+        _rowOffsets.push_back(_haystack.size());
+        textBuffer.GetRowByOffset(y, scratch).AppendText(_haystack, 0, bufferSize.X);
+    }
+    _rowOffsets.push_back(_haystack.size());
+
+    if (_sensitivity == Sensitivity::CaseInsensitive)
+    {
+        std::transform(_haystack.begin(), _haystack.end(), _haystack.begin(), ::towlower);
+    }
+
+    // A match can start at the bottom of the buffer and run on from the top.
+    const auto wrap = std::min(_needle.size() - 1, _haystack.size());
+    _haystack.reserve(_haystack.size() + wrap);
+    _haystack.append(_haystack.data(), wrap);
+}
+
+// Routine Description:
+// - Finds where a cell's glyph starts in the haystack.
+// Arguments:
+// - cell - The index of the cell, counting across each row and then down.
+//          It can be one past the last cell.
+// Return Value:
+// - Where the cell's glyph starts. For the second half of a wide glyph, that's
+//   where the next glyph starts, since no match can start there.
+size_t Search::_OffsetOfCell(const size_t cell) const
 {
-    start = { 0 };
-    end = { 0 };
+    const size_t width = _screenInfo.GetBufferSize().Width();
+    const auto row = cell / width;
+    if (row >= _rowOffsets.size() - 1)
+    {
+        return _rowOffsets.back();
+    }
 
-    COORD bufferPos = pos;
+    std::optional<ROW> scratch;
+    const auto& charRow = _screenInfo.GetTextBuffer().GetRowByOffset(row, scratch).GetCharRow();
+    auto offset = _rowOffsets.at(row);
+    for (size_t column = 0; column < cell % width; column++)
+    {
+        offset += s_CellLength(charRow, column);
+    }
+    return offset;
+}
 
-    for (const auto& needleCell : _needle)
+// Routine Description:
+// - Finds the cell whose glyph starts at the given place in the haystack.
+// Arguments:
+// - offset - The place in the haystack. It can be the end of the buffer's text.
+// - cell - If a glyph starts there, receives the index of its cell, counting
+//          across each row and then down (or one past the last cell, for the end).
+// Return Value:
+// - True if a glyph starts there. False if it's in the middle of one.
+bool Search::_TryGetCellAtOffset(const size_t offset, size_t& cell) const
+{
+    const size_t width = _screenInfo.GetBufferSize().Width();
+    if (offset >= _rowOffsets.back())
     {
-        // Haystack is the buffer. Needle is the string we were given.
-        const auto hayIter = _screenInfo.GetTextDataAt(bufferPos);
-        const auto hayChars = *hayIter;
-        const auto needleChars = std::wstring_view(needleCell.data(), needleCell.size());
+        cell = width * (_rowOffsets.size() - 1);
+        return true;
+    }
 
-        // If we didn't match at any point of the needle, return false.
-        if (!_CompareChars(hayChars, needleChars))
+    const auto row = gsl::narrow_cast<size_t>(std::upper_bound(_rowOffsets.cbegin(), _rowOffsets.cend(), offset) - _rowOffsets.cbegin()) - 1;
+    std::optional<ROW> scratch;
+    const auto& charRow = _screenInfo.GetTextBuffer().GetRowByOffset(row, scratch).GetCharRow();
+    auto glyphOffset = _rowOffsets.at(row);
+    for (size_t column = 0; column < width && glyphOffset <= offset; column++)
+    {
+        const auto length = s_CellLength(charRow, column);
+        if (length != 0 && glyphOffset == offset)
         {
-            return false;
+            cell = row * width + column;
+            return true;
         }
-
-        _IncrementCoord(bufferPos);
+        glyphOffset += length;
     }
+    return false;
+}
 
-    _DecrementCoord(bufferPos);
+// Routine Description:
+// - Checks that the needle, found at the given place in the haystack, covers
+//   whole glyphs, and works out which cells it covers.
+// Arguments:
+// - offset - Where the needle was found in the haystack.
+// - start - If it's a match, this is filled with the coordinate of the first cell of the needle.
+// - end - If it's a match, this is filled with the coordinate of the last cell of the needle.
+// Return Value:
+// - True if it's a match. False if not.
+bool Search::_TryMatchAt(const size_t offset, COORD& start, COORD& end) const
+{
+    const auto textSize = _rowOffsets.back();
+    auto endOffset = offset + _needle.size();
+    if (endOffset > textSize)
+    {
+        endOffset -= textSize;
+    }
 
-    // If we made it the whole way through the needle, then it was in the haystack.
-    // Fill out the span that we found the result at and return true.
-    start = pos;
-    end = bufferPos;
+    size_t first = 0;
+    size_t after = 0;
+    if (!_TryGetCellAtOffset(offset, first) || !_TryGetCellAtOffset(endOffset, after))
+    {
+        return false;
+    }
 
+    // The needle ends in the cell before the one after it, which can be back
+    // at the bottom of the buffer if it ended at the top.
+    const auto cells = _screenInfo.GetBufferSize().Width() * (_rowOffsets.size() - 1);
+    start = _CoordFromCell(first);
+    end = _CoordFromCell((after + cells - 1) % cells);
     return true;
 }
 
 // Routine Description:
-// - Provides an abstraction for comparing two spans of text.
-// - Internally handles case sensitivity based on object construction.
+// - Finds the first match of the needle that starts in the given cells.
 // Arguments:
-// - one - String view representing the first string of text
-// - two - String view representing the second string of text
+// - firstCell - The first cell the match can start in
+// - endCell - The cell after the last one that the match can start in
+// - start - If we found it, this is filled with the coordinate of the first cell of the needle.
+// - end - If we found it, this is filled with the coordinate of the last cell of the needle.
 // Return Value:
-// - True if they are the same. False otherwise.
-bool Search::_CompareChars(const std::wstring_view one, const std::wstring_view two) const
+// - True if we found it. False if not.
+bool Search::_FindForward(const size_t firstCell, const size_t endCell, COORD& start, COORD& end) const
 {
-    if (one.size() != two.size())
+    if (_regex)
     {
-        return false;
+        size_t startCell = 0;
+        size_t lastCell = 0;
+        if (!_regex->FindFirst(_screenInfo.GetTextBuffer(), firstCell, endCell, startCell, lastCell))
+        {
+            return false;
+        }
+        start = _CoordFromCell(startCell);
+        end = _CoordFromCell(lastCell);
+        return true;
+    }
+
+    auto offset = _OffsetOfCell(firstCell);
+    const auto endOffset = _OffsetOfCell(endCell);
+    while ((offset = s_FindFirst(_haystack, _needle, offset, endOffset)) != std::wstring_view::npos)
+    {
+        if (_TryMatchAt(offset, start, end))
+        {
+            return true;
+        }
+        offset++;
     }
+    return false;
+}
 
-    for (size_t i = 0; i < one.size(); i++)
+// Routine Description:
+// - Finds the last match of the needle that starts in the given cells.
+// Arguments:
+// - firstCell - The first cell the match can start in
+// - endCell - The cell after the last one that the match can start in
+// - start - If we found it, this is filled with the coordinate of the first cell of the needle.
+// - end - If we found it, this is filled with the coordinate of the last cell of the needle.
+// Return Value:
+// - True if we found it. False if not.
+bool Search::_FindBackward(const size_t firstCell, const size_t endCell, COORD& start, COORD& end) const
+{
+    if (_regex)
     {
-        if (_ApplySensitivity(one[i]) != _ApplySensitivity(two[i]))
+        size_t startCell = 0;
+        size_t lastCell = 0;
+        if (!_regex->FindLast(_screenInfo.GetTextBuffer(), firstCell, endCell, startCell, lastCell))
         {
             return false;
         }
+        start = _CoordFromCell(startCell);
+        end = _CoordFromCell(lastCell);
+        return true;
     }
 
-    return true;
+    const auto firstOffset = _OffsetOfCell(firstCell);
+    auto offset = _OffsetOfCell(endCell);
+    while ((offset = s_FindLast(_haystack, _needle, firstOffset, offset)) != std::wstring_view::npos)
+    {
+        if (_TryMatchAt(offset, start, end))
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 // Routine Description:
-// - Provides an abstraction for conditionally applying case sensitivity
-//   based on object construction
+// - Finds the first place the needle is in the haystack, starting in the given range.
+//   Where SSE2 is available, this looks for the needle's first character 8 at a
+//   time, and only compares the rest of it where that matched.
 // Arguments:
-// - wch - Character to adjust if necessary
+// - haystack - The text to search
+// - needle - The text to find. Must not be empty.
+// - first - The first place the needle can start
+// - end - The place after the last one the needle can start
 // Return Value:
-// - Adjusted value (or not).
-wchar_t Search::_ApplySensitivity(const wchar_t wch) const
+// - Where the needle starts, or npos if it's not there.
+size_t Search::s_FindFirst(const std::wstring_view haystack, const std::wstring_view needle, const size_t first, const size_t end) noexcept
 {
-    if (_sensitivity == Sensitivity::CaseInsensitive)
+    if (needle.size() > haystack.size())
     {
-        return ::towlower(wch);
+        return std::wstring_view::npos;
     }
-    else
+
+    const auto hay = haystack.data();
+    const auto isNeedleAt = [&](const size_t i) noexcept {
+        return hay[i] == needle.front() && wmemcmp(hay + i + 1, needle.data() + 1, needle.size() - 1) == 0;
+    };
+
+    const auto limit = std::min(end, haystack.size() - needle.size() + 1);
+    size_t i = first;
+
+#if defined(_M_IX86) || defined(_M_X64)
+    const __m128i needleFront = _mm_set1_epi16(static_cast<short>(needle.front()));
+    for (; i + 8 <= limit; i += 8)
     {
-        return wch;
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+
+        // Each matching character sets both bytes of its lane in the mask.
+        auto mask = static_cast<unsigned long>(_mm_movemask_epi8(_mm_cmpeq_epi16(chars, needleFront)));
+        while (mask != 0)
+        {
+            unsigned long bit = 0;
+            _BitScanForward(&bit, mask);
+            if (isNeedleAt(i + bit / 2))
+            {
+                return i + bit / 2;
+            }
+            mask &= ~(3ul << (bit / 2 * 2));
+        }
     }
+#endif
+
+    // Check whatever is left (or everything, without SSE2) one at a time.
+    for (; i < limit; i++)
+    {
+        if (isNeedleAt(i))
+        {
+            return i;
+        }
+    }
+    return std::wstring_view::npos;
+}
+
+// Routine Description:
+// - Finds the last place the needle is in the haystack, starting in the given range.
+//   Where SSE2 is available, this looks for the needle's first character 8 at a
+//   time, and only compares the rest of it where that matched.
+// Arguments:
+// - haystack - The text to search
+// - needle - The text to find. Must not be empty.
+// - first - The first place the needle can start
+// - end - The place after the last one the needle can start
+// Return Value:
+// - Where the needle starts, or npos if it's not there.
+size_t Search::s_FindLast(const std::wstring_view haystack, const std::wstring_view needle, const size_t first, const size_t end) noexcept
+{
+    if (needle.size() > haystack.size())
+    {
+        return std::wstring_view::npos;
+    }
+
+    const auto hay = haystack.data();
+    const auto isNeedleAt = [&](const size_t i) noexcept {
+        return hay[i] == needle.front() && wmemcmp(hay + i + 1, needle.data() + 1, needle.size() - 1) == 0;
+    };
+
+    size_t i = std::min(end, haystack.size() - needle.size() + 1);
+
+#if defined(_M_IX86) || defined(_M_X64)
+    const __m128i needleFront = _mm_set1_epi16(static_cast<short>(needle.front()));
+    for (; i >= first + 8; i -= 8)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i - 8));
+
+        // Each matching character sets both bytes of its lane in the mask.
+        auto mask = static_cast<unsigned long>(_mm_movemask_epi8(_mm_cmpeq_epi16(chars, needleFront)));
+        while (mask != 0)
+        {
+            unsigned long bit = 0;
+            _BitScanReverse(&bit, mask);
+            if (isNeedleAt(i - 8 + bit / 2))
+            {
+                return i - 8 + bit / 2;
+            }
+            mask &= ~(3ul << (bit / 2 * 2));
+        }
+    }
+#endif
+
+    // Check whatever is left (or everything, without SSE2) one at a time.
+    for (; i > first; i--)
+    {
+        if (isNeedleAt(i - 1))
+        {
+            return i - 1;
+        }
+    }
+    return std::wstring_view::npos;
+}
+
+// Routine Description:
+// - Converts a coordinate to the index of its cell, counting across each row and then down.
+size_t Search::_CellFromCoord(const COORD coord) const noexcept
+{
+    return static_cast<size_t>(coord.Y) * _screenInfo.GetBufferSize().Width() + coord.X;
+}
+
+// Routine Description:
+// - Converts the index of a cell, counting across each row and then down, to its coordinate.
+COORD Search::_CoordFromCell(const size_t cell) const noexcept
+{
+    const size_t width = _screenInfo.GetBufferSize().Width();
+    return { gsl::narrow_cast<SHORT>(cell % width), gsl::narrow_cast<SHORT>(cell / width) };
 }
 
 // Routine Description:
@@ -290,23 +596,36 @@ void Search::_UpdateNextPosition()
 }
 
 // Routine Description:
-// - Creates a "needle" of the correct format for comparison to the screen buffer text data
+// - Creates a "needle" of the correct format for comparison to the haystack
 //   that we can use for our search
 // Arguments:
 // - wstr - String that will be our search term
+// - sensitivity - Whether or not we care about case
 // Return Value:
-// - Structured text data for comparison to screen buffer text data.
-std::vector<std::vector<wchar_t>> Search::s_CreateNeedleFromString(const std::wstring& wstr)
+// - The search term, folded to lower case if we don't care about case.
+std::wstring Search::s_CreateNeedleFromString(const std::wstring& wstr, const Sensitivity sensitivity)
 {
-    const auto charData = Utf16Parser::Parse(wstr);
-    std::vector<std::vector<wchar_t>> cells;
-    for (const auto chars : charData)
+    std::wstring needle{ wstr };
+    if (sensitivity == Sensitivity::CaseInsensitive)
     {
-        if (IsGlyphFullWidth(std::wstring_view{ chars.data(), chars.size() }))
-        {
-            cells.emplace_back(chars);
-        }
-        cells.emplace_back(chars);
+        std::transform(needle.begin(), needle.end(), needle.begin(), ::towlower);
+    }
+    return needle;
+}
+
+// Routine Description:
+// - Compiles the search term as a regular expression, if that's what it is.
+// Arguments:
+// - wstr - String that will be our search term
+// - sensitivity - Whether or not we care about case
+// - syntax - Whether the search term is text or a regular expression
+// Return Value:
+// - The compiled expression, or null to search for the text itself.
+std::unique_ptr<TextBufferRegex> Search::s_CreateRegex(const std::wstring& wstr, const Sensitivity sensitivity, const Syntax syntax)
+{
+    if (syntax != Syntax::RegularExpression || wstr.empty())
+    {
+        return nullptr;
     }
-    return cells;
+    return std::make_unique<TextBufferRegex>(wstr, sensitivity == Sensitivity::CaseSensitive);
 }
@@ -17,6 +17,10 @@ Revision History:
 
 #pragma once
 
+#include <memory_resource>
+
+#include "../buffer/out/TextBufferRegex.hpp"
+
 // This used to be in find.h.
 #define SEARCH_STRING_LENGTH    (80)
 
@@ -35,16 +39,24 @@ public:
         CaseSensitive
     };
 
+    enum class Syntax
+    {
+        Text,
+        RegularExpression
+    };
+
     Search(const SCREEN_INFORMATION& ScreenInfo,
            const std::wstring& str,
            const Direction dir,
-           const Sensitivity sensitivity);
+           const Sensitivity sensitivity,
+           const Syntax syntax = Syntax::Text);
 
     Search(const SCREEN_INFORMATION& ScreenInfo,
            const std::wstring& str,
            const Direction dir,
            const Sensitivity sensitivity,
-           const COORD anchor);
+           const COORD anchor,
+           const Syntax syntax = Syntax::Text);
 
     bool FindNext();
     void Select() const;
@@ -52,29 +64,55 @@ public:
 
     std::pair<COORD, COORD> GetFoundLocation() const noexcept;
 
+    static std::wstring s_CreateNeedleFromString(const std::wstring& wstr, const Sensitivity sensitivity);
+    static size_t s_FindFirst(const std::wstring_view haystack, const std::wstring_view needle, const size_t first, const size_t end) noexcept;
+
 private:
 
-    wchar_t _ApplySensitivity(const wchar_t wch) const;
-    bool Search::_FindNeedleInHaystackAt(const COORD pos, COORD& start, COORD& end) const;
-    bool _CompareChars(const std::wstring_view one, const std::wstring_view two) const;
+    void _CreateHaystack();
+    size_t _OffsetOfCell(const size_t cell) const;
+    bool _TryGetCellAtOffset(const size_t offset, size_t& cell) const;
+    bool _TryMatchAt(const size_t offset, COORD& start, COORD& end) const;
+    bool _FindForward(const size_t firstCell, const size_t endCell, COORD& start, COORD& end) const;
+    bool _FindBackward(const size_t firstCell, const size_t endCell, COORD& start, COORD& end) const;
+
+    size_t _CellFromCoord(const COORD coord) const noexcept;
+    COORD _CoordFromCell(const size_t cell) const noexcept;
+
     void _UpdateNextPosition();
 
     void _IncrementCoord(COORD& coord) const;
     void _DecrementCoord(COORD& coord) const;
 
     static COORD s_GetInitialAnchor(const SCREEN_INFORMATION& screenInfo, const Direction dir);
-    static std::vector<std::vector<wchar_t>> s_CreateNeedleFromString(const std::wstring& wstr);
+    static std::unique_ptr<TextBufferRegex> s_CreateRegex(const std::wstring& wstr, const Sensitivity sensitivity, const Syntax syntax);
+
+    static size_t s_FindLast(const std::wstring_view haystack, const std::wstring_view needle, const size_t first, const size_t end) noexcept;
 
     bool _reachedEnd = false;
     COORD _coordNext = { 0 };
     COORD _coordSelStart = { 0 };
     COORD _coordSelEnd = { 0 };
 
+    // The text of the whole buffer, row after row, with each glyph in it once
+    // (and folded to lower case, for a case insensitive search). It's made the
+    // first time we look for something, and the search is done on it rather
+    // than cell by cell, with the cells only worked out where the needle is.
+    // _rowOffsets has where each row starts in it, and then where the last ends.
+    // The start of the text is repeated after that end, for as much as the
+    // needle needs to wrap around from the bottom of the buffer to the top.
+    std::pmr::wstring _haystack;
+    std::vector<size_t> _rowOffsets;
+
     const COORD _coordAnchor;
-    const std::vector<std::vector<wchar_t>> _needle;
     const Direction _direction;
     const Sensitivity _sensitivity;
     const SCREEN_INFORMATION& _screenInfo;
+    const std::wstring _needle;
+
+    // For a regular expression, the search is done by this instead, over the
+    // buffer's logical lines rather than the haystack.
+    const std::unique_ptr<TextBufferRegex> _regex;
 
 #ifdef UNIT_TESTING
     friend class SearchTests;
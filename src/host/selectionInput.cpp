@@ -130,6 +130,54 @@ bool Selection::s_IsValidKeyboardLineSelection(const INPUT_KEY_INFO* const pInpu
     return fIsValidCombination;
 }
 
+// Routine Description:
+// - Finds how far word by word selection can jump from a position in one go. Every cell
+//   in a run of word characters (or of delimiters) is the same as the next, so the
+//   selection can't stop partway through one, except where the edit line ends.
+// Arguments:
+// - screenInfo - the screen the selection is in
+// - position - the position to jump from
+// - reverse - whether the selection is moving right to left
+// - maxLeft - the position the selection stops at when it reaches it
+// - maxRight - the selection stops at any position at or past this one
+// Return Value:
+// - the far end of the position's run, or the first place before it the selection has to stop
+static COORD skipWordRun(const SCREEN_INFORMATION& screenInfo,
+                         const COORD position,
+                         const bool reverse,
+                         const COORD maxLeft,
+                         const COORD maxRight)
+{
+    if (Utils::s_CompareCoords(position, maxRight) >= 0)
+    {
+        return position;
+    }
+
+    const auto run = screenInfo.GetWordRun(position);
+    COORD target = position;
+    if (!reverse)
+    {
+        target.X = run.right;
+        if (maxLeft.Y == position.Y && maxLeft.X >= position.X)
+        {
+            target.X = std::min(target.X, maxLeft.X);
+        }
+        if (maxRight.Y == position.Y)
+        {
+            target.X = std::min(target.X, maxRight.X);
+        }
+    }
+    else
+    {
+        target.X = run.left;
+        if (maxLeft.Y == position.Y && maxLeft.X <= position.X)
+        {
+            target.X = std::max(target.X, maxLeft.X);
+        }
+    }
+    return target;
+}
+
 // Routine Description:
 // - Modifies the given selection point to the edge of the next (or previous) word.
 // - By default operates in a left-to-right fashion.
@@ -203,6 +251,9 @@ COORD Selection::WordByWordSelection(const bool fReverse,
         // store previous state
         fPrevIsDelim = fCurrIsDelim;
 
+        // skip over the rest of the run the position is in, since none of it can change the state
+        outCoord = skipWordRun(screenInfo, outCoord, fReverse, coordMaxLeft, coordMaxRight);
+
         // to make us "sticky" within the edit line, stop moving once we've reached a given max position left/right
         // users can repeat the command to move past the line and continue word selecting
         // if we're at the max position left, stop moving
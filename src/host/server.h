@@ -24,6 +24,7 @@ Revision History:
 #include "..\terminal\adapter\MouseInput.hpp"
 #include "VtIo.hpp"
 #include "CursorBlinker.hpp"
+#include "ConsoleStateSnapshot.hpp"
 
 #include "..\server\ProcessList.h"
 #include "..\server\WaitQueue.h"
@@ -110,6 +111,8 @@ public:
     void LockConsole();
     bool TryLockConsole();
     void UnlockConsole();
+    void LockConsoleShared();
+    void UnlockConsoleShared();
     bool IsConsoleLocked() const;
     ULONG GetCSRecursionCount();
 
@@ -153,8 +156,15 @@ public:
 
     RenderData renderData;
 
+    // What the polled queries answer with, readable without the lock. It's
+    // republished whenever the lock is let go of.
+    ConsoleStateSnapshot stateSnapshot;
+
 private:
     CRITICAL_SECTION _csConsoleLock;   // serialize input and output using this
+    // Held exclusively by whoever holds _csConsoleLock, and shared by the
+    // threads that only read (see LockConsoleShared).
+    SRWLOCK _srwConsoleLock;
     std::wstring _Title;
     std::wstring _TitlePrefix; // Eg Select, Mark - things that we manually prepend to the title.
     std::wstring _OriginalTitle;
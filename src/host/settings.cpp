@@ -55,7 +55,8 @@ Settings::Settings() :
     _DefaultForeground(INVALID_COLOR),
     _DefaultBackground(INVALID_COLOR),
     _fUseDx(false),
-    _fCopyColor(false)
+    _fCopyColor(false),
+    _fPersistHistory(false)
 {
     _dwScreenBufferSize.X = 80;
     _dwScreenBufferSize.Y = 25;
@@ -946,3 +947,11 @@ bool Settings::GetCopyColor() const noexcept
 {
     return _fCopyColor;
 }
+
+// Routine Description:
+// - Whether each app's command history is kept in a file, so it's still there the
+//   next time the app is started in a console.
+bool Settings::GetPersistHistory() const noexcept
+{
+    return _fPersistHistory;
+}
@@ -184,6 +184,7 @@ public:
 
     bool GetUseDx() const noexcept;
     bool GetCopyColor() const noexcept;
+    bool GetPersistHistory() const noexcept;
 
     COLORREF CalculateDefaultForeground() const noexcept;
     COLORREF CalculateDefaultBackground() const noexcept;
@@ -233,6 +234,7 @@ private:
     bool _fRenderGridWorldwide;
     bool _fUseDx;
     bool _fCopyColor;
+    bool _fPersistHistory;
 
     COLORREF _XtermColorTable[XTERM_COLOR_TABLE_SIZE];
 
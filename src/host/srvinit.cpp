@@ -115,8 +115,12 @@ NTSTATUS SetUpConsole(_Inout_ Settings* pStartupSettings,
     // If we are, we don't want to load any user settings, because that could
     //      result in some strange rendering results in the end terminal.
     // Use the launch args because the VtIo hasn't been initialized yet.
-    if (!launchArgs.InConptyMode())
+    // We don't want them when there's nothing to render to either, so that what
+    //      a renderless console measures doesn't depend on who's running it.
+    if (!launchArgs.InConptyMode() && !launchArgs.IsRenderless())
     {
+        const auto trace = Tracing::s_TraceStartupPhase("LoadSettings");
+
         // 3. Read the default registry values.
         Registry reg(&settings);
         reg.LoadGlobalsFromRegistry();
@@ -179,6 +183,7 @@ NTSTATUS SetUpConsole(_Inout_ Settings* pStartupSettings,
     }
 
 // Allocate console will read the global ServiceLocator::LocateGlobals().getConsoleInformation for the settings we just set.
+    const auto trace = Tracing::s_TraceStartupPhase("CreateBuffers");
     NTSTATUS Status = CONSOLE_INFORMATION::AllocateConsole({ Title, TitleLength / sizeof(wchar_t)});
     if (!NT_SUCCESS(Status))
     {
@@ -216,6 +221,9 @@ NTSTATUS RemoveConsole(_In_ ConsoleProcessHandle* ProcessData)
 
 DWORD WINAPI ConsoleIoThread(LPVOID lpParameter);
 
+// The most threads that service the driver's messages, see ConsoleIoThread.
+#define MAX_IO_THREADS 4
+
 void ConsoleCheckDebug()
 {
 #ifdef DBG
@@ -247,6 +255,8 @@ void ConsoleCheckDebug()
 [[nodiscard]]
 HRESULT ConsoleCreateIoThreadLegacy(_In_ HANDLE Server, const ConsoleArguments* const args)
 {
+    const auto trace = Tracing::s_TraceStartupPhase("ServerInitialization");
+
     auto& g = ServiceLocator::LocateGlobals();
     RETURN_IF_FAILED(ConsoleServerInitialization(Server, args));
     RETURN_IF_FAILED(g.hConsoleInputInitEvent.create(wil::EventOptions::None));
@@ -258,9 +268,22 @@ HRESULT ConsoleCreateIoThreadLegacy(_In_ HANDLE Server, const ConsoleArguments*
     ServerInformation.InputAvailableEvent = ServiceLocator::LocateGlobals().hInputEvent.get();
     RETURN_IF_FAILED(g.pDeviceComm->SetServerInformation(&ServerInformation));
 
-    HANDLE const hThread = CreateThread(nullptr, 0, ConsoleIoThread, 0, 0, nullptr);
-    RETURN_HR_IF(E_HANDLE, hThread == nullptr);
-    LOG_IF_WIN32_BOOL_FALSE(CloseHandle(hThread)); // The thread will run on its own and close itself. Free the associated handle.
+    // Several threads service the clients' messages, so that while one of them
+    //      is waiting on the driver, another can get on with the next message.
+    //      The threads run on their own and close themselves, so free their handles.
+    const auto ioThreadCount = std::clamp(std::thread::hardware_concurrency(), 1u, static_cast<unsigned int>(MAX_IO_THREADS));
+    for (unsigned int i = 0; i < ioThreadCount; i++)
+    {
+        HANDLE const hThread = CreateThread(nullptr, 0, ConsoleIoThread, 0, 0, nullptr);
+        if (hThread == nullptr)
+        {
+            // We can do with fewer of them, as long as there's one.
+            RETURN_HR_IF(E_HANDLE, i == 0);
+            LOG_LAST_ERROR();
+            break;
+        }
+        LOG_IF_WIN32_BOOL_FALSE(CloseHandle(hThread));
+    }
 
     // See MSFT:19918626
     // Make sure to always set up the signal thread if we need to.
@@ -503,6 +526,10 @@ NTSTATUS ConsoleAllocateConsole(PCONSOLE_API_CONNECTINFO p)
 
     CONSOLE_INFORMATION& gci = g.getConsoleInformation();
 
+    // The phases of starting up that wait for the first client, each traced
+    //      with the Startup keyword. See ConsolePerf.regions.xml.
+    const auto trace = Tracing::s_TraceStartupPhase("AllocateConsole");
+
     NTSTATUS Status = SetUpConsole(&p->ConsoleInfo, p->TitleLength, p->Title, p->CurDir, p->AppName);
     if (!NT_SUCCESS(Status))
     {
@@ -512,6 +539,7 @@ NTSTATUS ConsoleAllocateConsole(PCONSOLE_API_CONNECTINFO p)
     // No matter what, create a renderer.
     try
     {
+        const auto rendererTrace = Tracing::s_TraceStartupPhase("CreateRenderer");
         g.pRender = nullptr;
 
         auto renderThread = std::make_unique<RenderThread>();
@@ -523,6 +551,14 @@ NTSTATUS ConsoleAllocateConsole(PCONSOLE_API_CONNECTINFO p)
 
         g.pRender = new Renderer(&gci.renderData, nullptr, 0, std::move(renderThread));
 
+        // Frames that are slow for someone can be written down, to be replayed
+        //      elsewhere with tools/framereplay.
+        const auto frameCapturePath = g.launchArgs.GetFrameCapturePath();
+        if (!frameCapturePath.empty())
+        {
+            static_cast<Renderer*>(g.pRender)->CaptureFrames(frameCapturePath);
+        }
+
         THROW_IF_FAILED(localPointerToThread->Initialize(g.pRender));
 
         // Allow the renderer to paint.
@@ -542,6 +578,7 @@ NTSTATUS ConsoleAllocateConsole(PCONSOLE_API_CONNECTINFO p)
 
     if (NT_SUCCESS(Status) && p->WindowVisible)
     {
+        const auto windowTrace = Tracing::s_TraceStartupPhase("CreateWindow");
         HANDLE Thread = nullptr;
 
         IConsoleInputThread *pNewThread = nullptr;
@@ -602,6 +639,7 @@ NTSTATUS ConsoleAllocateConsole(PCONSOLE_API_CONNECTINFO p)
     // We'll need the size of the screen buffer in the vt i/o initialization
     if (NT_SUCCESS(Status))
     {
+        const auto vtTrace = Tracing::s_TraceStartupPhase("StartVtIo");
         HRESULT hr = gci.GetVtIo()->CreateIoHandlers();
         if (hr == S_FALSE)
         {
@@ -632,8 +670,11 @@ NTSTATUS ConsoleAllocateConsole(PCONSOLE_API_CONNECTINFO p)
 }
 
 // Routine Description:
-// - This routine is the main one in the console server IO thread.
+// - This routine is the main one in the console server IO threads.
 // - It reads IO requests submitted by clients through the driver, services and completes them in a loop.
+// - Up to MAX_IO_THREADS of these run at once. Each has its own message, and
+//   the driver hands every request to only one of them. IoSorter sorts out
+//   which messages can be serviced at the same time.
 // Arguments:
 // - <none>
 // Return Value:
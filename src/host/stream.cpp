@@ -472,10 +472,17 @@ static HRESULT _ReadLineInput(InputBuffer& inputBuffer,
     RETURN_HR_IF(E_FAIL, !gci.HasActiveOutputBuffer());
 
     SCREEN_INFORMATION& screenInfo = gci.GetActiveOutputBuffer();
-    CommandHistory* const pCommandHistory = CommandHistory::s_Find(processData);
 
     try
     {
+        // A process only gets a command history once it reads its first line. The exe name it reads with
+        // is the one it connected with, so it still gets back the history its last instance left.
+        CommandHistory* pCommandHistory = CommandHistory::s_Find(processData);
+        if (pCommandHistory == nullptr)
+        {
+            pCommandHistory = CommandHistory::s_Allocate(exeName, processData);
+        }
+
         auto cookedReadData = std::make_unique<COOKED_READ_DATA>(&inputBuffer, // pInputBuffer
                                                                  &readHandleState, // pInputReadHandleData
                                                                  screenInfo, // pScreenInfo
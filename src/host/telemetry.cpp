@@ -6,8 +6,11 @@
 #include <Intsafe.h>
 #include "Shlwapi.h"
 #include "telemetry.hpp"
+#include "ApiStatistics.hpp"
+#include "MemoryStatistics.hpp"
 #include <time.h>
 
+#include "handle.h"
 #include "history.h"
 
 #include "..\interactivity\inc\ServiceLocator.hpp"
@@ -17,6 +20,24 @@ TRACELOGGING_DEFINE_PROVIDER(g_hConhostV2EventTraceProvider,
     // {fe1ff234-1f09-50a8-d38d-c44fab43e818}
     (0xfe1ff234, 0x1f09, 0x50a8, 0xd3, 0x8d, 0xc4, 0x4f, 0xab, 0x43, 0xe8, 0x18),
     TraceLoggingOptionMicrosoftTelemetry());
+// Routine Description:
+// - Called whenever a trace session changes what it wants from the provider.
+//   When a session asks for the provider's state, the API and memory statistics are written to it.
+static void NTAPI s_ProviderCallback(LPCGUID /*sourceId*/,
+                                     ULONG controlCode,
+                                     UCHAR /*level*/,
+                                     ULONGLONG /*matchAnyKeyword*/,
+                                     ULONGLONG /*matchAllKeyword*/,
+                                     PEVENT_FILTER_DESCRIPTOR /*filterData*/,
+                                     PVOID /*callbackContext*/)
+{
+    if (controlCode == EVENT_CONTROL_CODE_CAPTURE_STATE)
+    {
+        ApiStatistics::s_TraceRundown();
+        MemoryStatistics::s_TraceRundown();
+    }
+}
+
 #pragma warning(push)
 // Disable 4351 so we can initialize the arrays to 0 without a warning.
 #pragma warning(disable:4351)
@@ -55,7 +76,7 @@ Telemetry::Telemetry()
     _uiQuickEditPasteRawUsed(0)
 {
     time(&_tStartedAt);
-    TraceLoggingRegister(g_hConhostV2EventTraceProvider);
+    TraceLoggingRegisterEx(g_hConhostV2EventTraceProvider, s_ProviderCallback, nullptr);
     TraceLoggingWriteStart(_activity, "ActivityStart");
     // initialize wil tracelogging
     wil::SetResultLoggingCallback(&Tracing::TraceFailure);
@@ -157,27 +178,29 @@ void Telemetry::SetKeyboardTextEditingUsed()
 }
 
 // Log an API call was used.
-void Telemetry::LogApiCall(const ApiCall api, const BOOLEAN fUnicode)
+void Telemetry::LogApiCall(const ApiCall api, const BOOLEAN fUnicode) noexcept
 {
     // Initially we thought about passing over a string (ex. "XYZ") and use a dictionary data type to hold the counts.
     // However we would have to search through the dictionary every time we called this method, so we decided
     // to use an array which has very quick access times.
     // The downside is we have to create an enum type, and then convert them to strings when we finally
     // send out the telemetry, but the upside is we should have very good performance.
+    // The APIs that only read are serviced on several threads at once, so the counts are bumped with
+    // interlocked operations. They're only sent out once, when the console is closing.
     if (fUnicode)
     {
-        _rguiTimesApiUsed[api]++;
+        InterlockedIncrement(&_rguiTimesApiUsed[api]);
     }
     else
     {
-        _rguiTimesApiUsedAnsi[api]++;
+        InterlockedIncrement(&_rguiTimesApiUsedAnsi[api]);
     }
 }
 
 // Log an API call was used.
-void Telemetry::LogApiCall(const ApiCall api)
+void Telemetry::LogApiCall(const ApiCall api) noexcept
 {
-    _rguiTimesApiUsed[api]++;
+    InterlockedIncrement(&_rguiTimesApiUsed[api]);
 }
 
 // Log usage of the Find Dialog.
@@ -281,67 +304,117 @@ void Telemetry::LogProcessConnected(const HANDLE hProcess)
     // This is a bit of processing, so don't do it for the 95% of machines that aren't being sampled.
     if (TraceLoggingProviderEnabled(g_hConhostV2EventTraceProvider, 0, MICROSOFT_KEYWORD_MEASURES))
     {
-        TotalCodesForPreviousProcess();
-
-        // Don't initialize wszFilePathAndName, QueryFullProcessImageName does that for us.  Use QueryFullProcessImageName instead of
-        // GetProcessImageFileName because we need the path to begin with a drive letter and not a device name.
-        WCHAR wszFilePathAndName[MAX_PATH];
-        DWORD dwSize = ARRAYSIZE(wszFilePathAndName);
-        if (QueryFullProcessImageName(hProcess, 0, wszFilePathAndName, &dwSize))
+        // Looking up the name of the process asks the kernel about it, and the process is connecting on the
+        // IO thread which every other client waits on, so it's done on the thread pool with a handle of its own.
+        HANDLE hDuplicate = nullptr;
+        if (LOG_IF_WIN32_BOOL_FALSE(DuplicateHandle(GetCurrentProcess(),
+                                                    hProcess,
+                                                    GetCurrentProcess(),
+                                                    &hDuplicate,
+                                                    0,
+                                                    FALSE,
+                                                    DUPLICATE_SAME_ACCESS)))
         {
-            // Stripping out the path also helps with PII issues in case they launched the program
-            // from a path containing their username.
-            PWSTR pwszFileName = PathFindFileName(wszFilePathAndName);
-
-            size_t iFileName;
-            if (FindProcessName(pwszFileName, &iFileName))
+            if (!TrySubmitThreadpoolCallback(s_LogProcessConnectedCallback, hDuplicate, nullptr))
             {
-                // We already logged this process name, so just increment the count.
-                _iProcessConnectedCurrently = _rgiAlphabeticalIndex[iFileName];
-                _rguiProcessFileNamesCount[_iProcessConnectedCurrently]++;
+                LOG_LAST_ERROR();
+                CloseHandle(hDuplicate);
             }
-            else if ((_uiNumberProcessFileNames < ARRAYSIZE(_rguiProcessFileNamesCount)) &&
-                (_iProcessFileNamesNext < ARRAYSIZE(_wchProcessFileNames) - 10))
+        }
+    }
+}
+
+// Routine Description:
+// - Looks up the name of a process that connected, on the thread pool, and records it under the console lock.
+// Arguments:
+// - instance - unused
+// - context - a handle to the process, which is ours to close
+// Return Value:
+// - <none>
+void CALLBACK Telemetry::s_LogProcessConnectedCallback(PTP_CALLBACK_INSTANCE /*instance*/, PVOID context) noexcept
+{
+    wil::unique_handle hProcess{ static_cast<HANDLE>(context) };
+
+    // Don't initialize wszFilePathAndName, QueryFullProcessImageName does that for us.  Use QueryFullProcessImageName instead of
+    // GetProcessImageFileName because we need the path to begin with a drive letter and not a device name.
+    WCHAR wszFilePathAndName[MAX_PATH];
+    DWORD dwSize = ARRAYSIZE(wszFilePathAndName);
+    const bool fHaveName = QueryFullProcessImageName(hProcess.get(), 0, wszFilePathAndName, &dwSize);
+
+    LockConsole();
+    auto Unlock = wil::scope_exit([] { UnlockConsole(); });
+    try
+    {
+        Instance().RecordProcessConnected(fHaveName ? wszFilePathAndName : nullptr);
+    }
+    CATCH_LOG();
+}
+
+// Routine Description:
+// - Counts a connection from a process with the given image path, if we could find it out.
+// - NOTE: Must be called with the console lock held.
+// Arguments:
+// - wszFilePathAndName - the full path of the process's image, or nullptr if it couldn't be looked up
+// Return Value:
+// - <none>
+void Telemetry::RecordProcessConnected(_In_opt_ PCWSTR wszFilePathAndName)
+{
+    TotalCodesForPreviousProcess();
+
+    if (wszFilePathAndName != nullptr)
+    {
+        // Stripping out the path also helps with PII issues in case they launched the program
+        // from a path containing their username.
+        PWSTR pwszFileName = PathFindFileName(wszFilePathAndName);
+
+        size_t iFileName;
+        if (FindProcessName(pwszFileName, &iFileName))
+        {
+            // We already logged this process name, so just increment the count.
+            _iProcessConnectedCurrently = _rgiAlphabeticalIndex[iFileName];
+            _rguiProcessFileNamesCount[_iProcessConnectedCurrently]++;
+        }
+        else if ((_uiNumberProcessFileNames < ARRAYSIZE(_rguiProcessFileNamesCount)) &&
+            (_iProcessFileNamesNext < ARRAYSIZE(_wchProcessFileNames) - 10))
+        {
+            // Check if the MS released bash was used.  MS bash is installed under windows\system32, and it's possible somebody else
+            // could be installing their bash into that directory, but not likely.  If the user first runs a non-MS bash,
+            // and then runs MS bash, we won't detect the MS bash as running, but it's an acceptable compromise.
+            if (!_fBashUsed && !_wcsnicmp(c_pwszBashExeName, pwszFileName, MAX_PATH))
             {
-                // Check if the MS released bash was used.  MS bash is installed under windows\system32, and it's possible somebody else
-                // could be installing their bash into that directory, but not likely.  If the user first runs a non-MS bash,
-                // and then runs MS bash, we won't detect the MS bash as running, but it's an acceptable compromise.
-                if (!_fBashUsed && !_wcsnicmp(c_pwszBashExeName, pwszFileName, MAX_PATH))
+                // We could have gotten the system directory once when this class starts, but we'd have to hold the memory for it
+                // plus we're not sure we'd ever need it, so just get it when we know we're running bash.exe.
+                WCHAR wszSystemDirectory[MAX_PATH] = L"";
+                if (GetSystemDirectory(wszSystemDirectory, ARRAYSIZE(wszSystemDirectory)))
                 {
-                    // We could have gotten the system directory once when this class starts, but we'd have to hold the memory for it
-                    // plus we're not sure we'd ever need it, so just get it when we know we're running bash.exe.
-                    WCHAR wszSystemDirectory[MAX_PATH] = L"";
-                    if (GetSystemDirectory(wszSystemDirectory, ARRAYSIZE(wszSystemDirectory)))
-                    {
-                        _fBashUsed = (PathIsSameRoot(wszFilePathAndName, wszSystemDirectory) == TRUE);
-                    }
+                    _fBashUsed = (PathIsSameRoot(wszFilePathAndName, wszSystemDirectory) == TRUE);
                 }
+            }
 
-                // In order to send out a dynamic array of strings through telemetry, we have to pack the strings into a single WCHAR array.
-                // There currently aren't any helper functions for this, and we have to pack it manually.
-                // To understand the format of the single string, consult the documentation in the traceloggingprovider.h file.
-                if (SUCCEEDED(StringCchCopyW(_wchProcessFileNames + _iProcessFileNamesNext, ARRAYSIZE(_wchProcessFileNames) - _iProcessFileNamesNext - 1, pwszFileName)))
+            // In order to send out a dynamic array of strings through telemetry, we have to pack the strings into a single WCHAR array.
+            // There currently aren't any helper functions for this, and we have to pack it manually.
+            // To understand the format of the single string, consult the documentation in the traceloggingprovider.h file.
+            if (SUCCEEDED(StringCchCopyW(_wchProcessFileNames + _iProcessFileNamesNext, ARRAYSIZE(_wchProcessFileNames) - _iProcessFileNamesNext - 1, pwszFileName)))
+            {
+                // As each FileName comes in, it's appended to the end.  However to improve searching speed, we have an array of indexes
+                // that is alphabetically sorted.  We could call qsort, but that would be a waste in performance since we're just adding one string
+                // at a time and we always keep the array sorted, so just shift everything over one.
+                for (size_t n = _uiNumberProcessFileNames; n > iFileName; n--)
                 {
-                    // As each FileName comes in, it's appended to the end.  However to improve searching speed, we have an array of indexes
-                    // that is alphabetically sorted.  We could call qsort, but that would be a waste in performance since we're just adding one string
-                    // at a time and we always keep the array sorted, so just shift everything over one.
-                    for (size_t n = _uiNumberProcessFileNames; n > iFileName; n--)
-                    {
-                        _rgiAlphabeticalIndex[n] = _rgiAlphabeticalIndex[n - 1];
-                    }
-
-                    // Now point to the string, and set the count to 1.
-                    _rgiAlphabeticalIndex[iFileName] = _uiNumberProcessFileNames;
-                    _rgiProccessFileNameIndex[_uiNumberProcessFileNames] = _iProcessFileNamesNext;
-                    _rguiProcessFileNamesCount[_uiNumberProcessFileNames] = 1;
-                    _iProcessFileNamesNext += wcslen(pwszFileName) + 1;
-                    _iProcessConnectedCurrently = _uiNumberProcessFileNames++;
-
-                    // Packed arrays start with a UINT16 value indicating the number of elements in the array.
-                    BYTE *pbFileNames = reinterpret_cast<BYTE*>(_wchProcessFileNames);
-                    pbFileNames[0] = (BYTE)_uiNumberProcessFileNames;
-                    pbFileNames[1] = (BYTE)(_uiNumberProcessFileNames >> 8);
+                    _rgiAlphabeticalIndex[n] = _rgiAlphabeticalIndex[n - 1];
                 }
+
+                // Now point to the string, and set the count to 1.
+                _rgiAlphabeticalIndex[iFileName] = _uiNumberProcessFileNames;
+                _rgiProccessFileNameIndex[_uiNumberProcessFileNames] = _iProcessFileNamesNext;
+                _rguiProcessFileNamesCount[_uiNumberProcessFileNames] = 1;
+                _iProcessFileNamesNext += wcslen(pwszFileName) + 1;
+                _iProcessConnectedCurrently = _uiNumberProcessFileNames++;
+
+                // Packed arrays start with a UINT16 value indicating the number of elements in the array.
+                BYTE *pbFileNames = reinterpret_cast<BYTE*>(_wchProcessFileNames);
+                pbFileNames[0] = (BYTE)_uiNumberProcessFileNames;
+                pbFileNames[1] = (BYTE)(_uiNumberProcessFileNames >> 8);
             }
         }
     }
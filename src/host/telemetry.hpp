@@ -120,8 +120,8 @@ public:
         // Only use this last enum as a count of the number of api enums.
         NUMBER_OF_APIS
     };
-    void LogApiCall(const ApiCall api);
-    void LogApiCall(const ApiCall api, const BOOLEAN fUnicode);
+    void LogApiCall(const ApiCall api) noexcept;
+    void LogApiCall(const ApiCall api, const BOOLEAN fUnicode) noexcept;
 
 private:
     // Used to prevent multiple instances
@@ -132,6 +132,9 @@ private:
 
     bool FindProcessName(const WCHAR* pszProcessName, _Out_ size_t *iPosition) const;
     void TotalCodesForPreviousProcess();
+    void RecordProcessConnected(_In_opt_ PCWSTR wszFilePathAndName);
+
+    static void CALLBACK s_LogProcessConnectedCallback(PTP_CALLBACK_INSTANCE instance, PVOID context) noexcept;
 
     static const int c_iMaxProcessesConnected = 100;
 
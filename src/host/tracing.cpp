@@ -19,7 +19,10 @@ enum TraceKeywords
     Input = 0x200,
     API = 0x400,
     UIA = 0x800,
-    All = 0xFFF
+    ApiStatistics = 0x1000, // see ApiStatistics.cpp
+    MemoryStatistics = 0x2000, // see MemoryStatistics.cpp
+    Startup = 0x4000,
+    All = 0x7FFF
 };
 DEFINE_ENUM_FLAG_OPERATORS(TraceKeywords);
 
@@ -56,8 +59,15 @@ Tracing::~Tracing()
 // Return Value:
 // - An object for the caller to hold until the API call is complete. 
 //   Then destroy it to signal that the call is over so the stop trace can be written.
+// - NOTE: This runs for every API call, so when nobody's listening for API events,
+//   it hands back an object that does nothing, without building the stop routine.
 Tracing Tracing::s_TraceApiCall(const NTSTATUS& result, PCSTR traceName)
 {
+    if (!s_IsApiTracingEnabled())
+    {
+        return Tracing(nullptr);
+    }
+
     TraceLoggingWrite(g_hConhostV2EventTraceProvider, "ApiCall",
                       TraceLoggingString(traceName, "ApiName"),
                       TraceLoggingOpcode(WINEVENT_OPCODE_START),
@@ -74,6 +84,47 @@ Tracing Tracing::s_TraceApiCall(const NTSTATUS& result, PCSTR traceName)
     });
 }
 
+// Routine Description:
+// - Checks whether a trace session is listening for the API events, so that the
+//   hot API paths can skip gathering what goes into them when none is.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if the API events will be written somewhere.
+bool Tracing::s_IsApiTracingEnabled() noexcept
+{
+    return TraceLoggingProviderEnabled(g_hConhostV2EventTraceProvider, WINEVENT_LEVEL_VERBOSE, TraceKeywords::API);
+}
+
+// Routine Description:
+// - Writes start/stop events around one phase of starting up, so what each
+//   phase costs can be seen before the first client message is served.
+// Arguments:
+// - phaseName - The name of the phase to list in the trace details
+// Return Value:
+// - An object for the caller to hold until the phase is over.
+Tracing Tracing::s_TraceStartupPhase(PCSTR phaseName)
+{
+    if (!TraceLoggingProviderEnabled(g_hConhostV2EventTraceProvider, WINEVENT_LEVEL_INFO, TraceKeywords::Startup))
+    {
+        return Tracing(nullptr);
+    }
+
+    TraceLoggingWrite(g_hConhostV2EventTraceProvider, "StartupPhase",
+                      TraceLoggingString(phaseName, "Phase"),
+                      TraceLoggingOpcode(WINEVENT_OPCODE_START),
+                      TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+                      TraceLoggingKeyword(TraceKeywords::Startup));
+
+    return Tracing([phaseName] {
+        TraceLoggingWrite(g_hConhostV2EventTraceProvider, "StartupPhase",
+                          TraceLoggingString(phaseName, "Phase"),
+                          TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+                          TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+                          TraceLoggingKeyword(TraceKeywords::Startup));
+    });
+}
+
 ULONG Tracing::s_ulDebugFlag = 0x0;
 
 void Tracing::s_TraceApi(const NTSTATUS status, const CONSOLE_GETLARGESTWINDOWSIZE_MSG* const a)
@@ -147,8 +198,13 @@ void Tracing::s_TraceApi(const NTSTATUS status, const CONSOLE_SETWINDOWINFO_MSG*
         );
 }
 
-void Tracing::s_TraceApi(_In_ const void* const buffer, const CONSOLE_WRITECONSOLE_MSG* const a)
+void Tracing::s_TraceApi(_In_opt_ const void* const buffer, const CONSOLE_WRITECONSOLE_MSG* const a)
 {
+    if (buffer == nullptr)
+    {
+        return;
+    }
+
     if (a->Unicode)
     {
         const wchar_t* const buf = static_cast<const wchar_t* const>(buffer);
@@ -196,11 +252,11 @@ void Tracing::s_TraceApi(const CONSOLE_SCREENBUFFERINFO_MSG* const a)
     static_assert(sizeof(UINT32) == sizeof(*a->ColorTable), "a->ColorTable");
 }
 
-void Tracing::s_TraceApi(const CONSOLE_MODE_MSG* const a, const std::wstring& handleType)
+void Tracing::s_TraceApi(const CONSOLE_MODE_MSG* const a, _In_z_ const wchar_t* const handleType)
 {
     TraceLoggingWrite(g_hConhostV2EventTraceProvider, "API_GetConsoleMode",
         TraceLoggingHexUInt32(a->Mode, "Mode"),
-        TraceLoggingWideString(handleType.c_str(), "Handle type"),
+        TraceLoggingWideString(handleType, "Handle type"),
         TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
         TraceLoggingKeyword(TraceKeywords::API)
         );
@@ -371,6 +371,41 @@ class AliasTests
         VERIFY_ARE_EQUAL(dwLinesExpected, dwLines, L"Line count be updated to 1.");
     }
 
+    TEST_METHOD(TestMatchAndCopyRedefinedAlias)
+    {
+        std::wstring exe(L"exe.exe");
+        std::wstring source(L"source");
+        std::wstring target(L"first $1");
+        Alias::s_TestAddAlias(exe, source, target);
+
+        // Defining it again, in any case, replaces the one target there is.
+        std::wstring exeUpper(L"EXE.EXE");
+        std::wstring sourceUpper(L"SOURCE");
+        std::wstring targetAgain(L"second $2$tthird");
+        Alias::s_TestAddAlias(exeUpper, sourceUpper, targetAgain);
+
+        std::wstring original(L"Source one two\r\n");
+        const size_t cchTarget = 60;
+        auto rgwchTarget = std::make_unique<wchar_t[]>(cchTarget);
+        wcscpy_s(rgwchTarget.get(), cchTarget, original.data());
+
+        size_t cbTargetUsed = 0;
+        DWORD dwLines = 0;
+
+        Alias::s_MatchAndCopyAliasLegacy(rgwchTarget.get(),
+                                         original.size() * sizeof(wchar_t),
+                                         rgwchTarget.get(),
+                                         cchTarget * sizeof(wchar_t),
+                                         cbTargetUsed,
+                                         L"Exe.Exe",
+                                         dwLines);
+
+        const std::wstring targetExpected(L"second two\r\nthird\r\n");
+        VERIFY_ARE_EQUAL(targetExpected.size() * sizeof(wchar_t), cbTargetUsed);
+        VERIFY_ARE_EQUAL(String(targetExpected.data()), String(rgwchTarget.get(), gsl::narrow<int>(cbTargetUsed / sizeof(wchar_t))));
+        VERIFY_ARE_EQUAL(2u, dwLines);
+    }
+
     TEST_METHOD(TrimTrailing)
     {
         BEGIN_TEST_METHOD_PROPERTIES()
@@ -388,9 +423,10 @@ class AliasTests
         _ReplacePercentWithCRLF(target);
         _ReplacePercentWithCRLF(expected);
 
-        Alias::s_TrimTrailingCrLf(target);
+        std::wstring_view actual{ target };
+        Alias::s_TrimTrailingCrLf(actual);
 
-        VERIFY_ARE_EQUAL(String(expected.data()), String(target.data()));
+        VERIFY_ARE_EQUAL(String(expected.data()), String(actual.data(), gsl::narrow<int>(actual.size())));
     }
 
     TEST_METHOD(Tokenize)
@@ -401,13 +437,14 @@ class AliasTests
         tokensExpected.emplace_back(L"two");
         tokensExpected.emplace_back(L"three");
 
-        auto tokensActual = Alias::s_Tokenize(tokenStr);
+        Alias::Tokens tokensActual;
+        const auto countActual = Alias::s_Tokenize(tokenStr, tokensActual);
 
-        VERIFY_ARE_EQUAL(tokensExpected.size(), tokensActual.size());
+        VERIFY_ARE_EQUAL(tokensExpected.size(), countActual);
 
         for (size_t i = 0; i < tokensExpected.size(); i++)
         {
-            VERIFY_ARE_EQUAL(String(tokensExpected[i].data()), String(tokensActual[i].data()));
+            VERIFY_ARE_EQUAL(String(tokensExpected[i].data()), String(tokensActual[i].data(), gsl::narrow<int>(tokensActual[i].size())));
         }
     }
 
@@ -417,16 +454,29 @@ class AliasTests
         std::deque<std::wstring> tokensExpected;
         tokensExpected.emplace_back(tokenStr);
 
-        auto tokensActual = Alias::s_Tokenize(tokenStr);
+        Alias::Tokens tokensActual;
+        const auto countActual = Alias::s_Tokenize(tokenStr, tokensActual);
 
-        VERIFY_ARE_EQUAL(tokensExpected.size(), tokensActual.size());
+        VERIFY_ARE_EQUAL(tokensExpected.size(), countActual);
 
         for (size_t i = 0; i < tokensExpected.size(); i++)
         {
-            VERIFY_ARE_EQUAL(String(tokensExpected[i].data()), String(tokensActual[i].data()));
+            VERIFY_ARE_EQUAL(String(tokensExpected[i].data()), String(tokensActual[i].data(), gsl::narrow<int>(tokensActual[i].size())));
         }
     }
 
+    TEST_METHOD(TokenizeStopsAtNinthArgument)
+    {
+        std::wstring tokenStr(L"alias one two three four five six seven eight nine ten eleven");
+
+        Alias::Tokens tokensActual;
+        const auto countActual = Alias::s_Tokenize(tokenStr, tokensActual);
+
+        VERIFY_ARE_EQUAL(tokensActual.size(), countActual);
+        VERIFY_ARE_EQUAL(String(L"alias"), String(tokensActual.front().data(), gsl::narrow<int>(tokensActual.front().size())));
+        VERIFY_ARE_EQUAL(String(L"nine"), String(tokensActual.back().data(), gsl::narrow<int>(tokensActual.back().size())));
+    }
+
     TEST_METHOD(GetArgString)
     {
         BEGIN_TEST_METHOD_PROPERTIES()
@@ -440,9 +490,9 @@ class AliasTests
         std::wstring expected;
         _RetrieveTargetExpectedPair(target, expected);
 
-        std::wstring actual = Alias::s_GetArgString(target);
+        const auto actual = Alias::s_GetArgString(target);
 
-        VERIFY_ARE_EQUAL(String(expected.data()), String(actual.data()));
+        VERIFY_ARE_EQUAL(String(expected.data()), String(actual.data(), gsl::narrow<int>(actual.size())));
     }
 
     TEST_METHOD(NumberedArgMacro)
@@ -467,18 +517,7 @@ class AliasTests
         std::wstring expected;
         _RetrieveTargetExpectedPair(target, expected);
 
-        std::deque<std::wstring> tokens;
-        tokens.emplace_back(L"alias");
-        tokens.emplace_back(L"one");
-        tokens.emplace_back(L"two");
-        tokens.emplace_back(L"three");
-        tokens.emplace_back(L"four");
-        tokens.emplace_back(L"five");
-        tokens.emplace_back(L"six");
-        tokens.emplace_back(L"seven");
-        tokens.emplace_back(L"eight");
-        tokens.emplace_back(L"nine");
-        tokens.emplace_back(L"ten");
+        const Alias::Tokens tokens{ L"alias", L"one", L"two", L"three", L"four", L"five", L"six", L"seven", L"eight", L"nine" };
 
         // if we expect non-empty results, then we should get a bool back saying it was processed
         const bool returnExpected = !expected.empty();
@@ -311,6 +311,69 @@ class ApiRoutinesTests
         VERIFY_ARE_EQUAL(WEX::Common::String(gci.GetOriginalTitle().c_str()), WEX::Common::String(pwszTitle));
     }
 
+    TEST_METHOD(ApiQueriesShareTheConsoleLock)
+    {
+        CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+        wil::unique_event held(wil::EventOptions::ManualReset);
+        wil::unique_event release(wil::EventOptions::ManualReset);
+        std::thread reader([&]() {
+            gci.LockConsoleShared();
+            held.SetEvent();
+            release.wait();
+            gci.UnlockConsoleShared();
+        });
+        auto join = wil::scope_exit([&]() {
+            release.SetEvent();
+            reader.join();
+        });
+        VERIFY_IS_TRUE(held.wait(5000));
+
+        Log::Comment(L"A query doesn't wait for another reader.");
+        ULONG size = 0;
+        bool isVisible = false;
+        _pApiRoutines->GetConsoleCursorInfoImpl(gci.GetActiveOutputBuffer(), size, isVisible);
+        VERIFY_ARE_EQUAL(gci.GetActiveOutputBuffer().GetTextBuffer().GetCursor().GetSize(), size);
+
+        Log::Comment(L"A writer does.");
+        VERIFY_IS_FALSE(gci.TryLockConsole());
+
+        join.reset();
+
+        VERIFY_IS_TRUE(gci.TryLockConsole());
+        gci.UnlockConsole();
+    }
+
+    TEST_METHOD(ApiPolledQueriesReadTheSnapshot)
+    {
+        CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        SCREEN_INFORMATION& si = gci.GetActiveOutputBuffer();
+
+        Log::Comment(L"The first query asks for the snapshot, and has to take the lock.");
+        CONSOLE_SCREEN_BUFFER_INFOEX info{ sizeof(info) };
+        _pApiRoutines->GetConsoleScreenBufferInfoExImpl(si, info);
+
+        Log::Comment(L"Whoever lets go of the lock next publishes it.");
+        const COORD position{ 5, 3 };
+        gci.LockConsole();
+        si.GetTextBuffer().GetCursor().SetPosition(position);
+        gci.UnlockConsole();
+
+        ConsoleStateSnapshot::State state;
+        VERIFY_IS_TRUE(gci.stateSnapshot.TryRead(state));
+        VERIFY_IS_TRUE(state.IsFor(si));
+        VERIFY_ARE_EQUAL(position, state.cursorPosition);
+
+        _pApiRoutines->GetConsoleScreenBufferInfoExImpl(si, info);
+        VERIFY_ARE_EQUAL(position, info.dwCursorPosition);
+        VERIFY_ARE_EQUAL(si.GetViewport().RightExclusive(), info.srWindow.Right);
+        VERIFY_ARE_EQUAL(si.GetViewport().BottomExclusive(), info.srWindow.Bottom);
+
+        ULONG mode = 0;
+        _pApiRoutines->GetConsoleOutputModeImpl(si, mode);
+        VERIFY_ARE_EQUAL(si.OutputMode, mode);
+    }
+
     static void s_AdjustOutputWait(const bool fShouldBlock)
     {
         WI_SetFlagIf(ServiceLocator::LocateGlobals().getConsoleInformation().Flags, CONSOLE_SELECTING, fShouldBlock);
@@ -590,6 +653,103 @@ class ApiRoutinesTests
         }
     }
 
+    TEST_METHOD(ApiWriteConsoleOutputWClipsRectangle)
+    {
+        CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        SCREEN_INFORMATION& si = gci.GetActiveOutputBuffer();
+
+        VERIFY_SUCCEEDED(si.GetTextBuffer().ResizeTraditional({ 5, 5 }), L"Make the buffer small so this doesn't take forever.");
+
+        gci.LockConsole();
+        auto Unlock = wil::scope_exit([&] { gci.UnlockConsole(); });
+
+        si.GetActiveBuffer().ClearTextData(); // Clean out screen
+
+        Log::Comment(L"Write a 4x3 rectangle hanging off the left and the bottom of the 5x5 buffer.");
+        const SHORT width = 4;
+        const SHORT height = 3;
+        std::vector<CHAR_INFO> cells(width * height);
+        for (SHORT y = 0; y < height; y++)
+        {
+            for (SHORT x = 0; x < width; x++)
+            {
+                auto& cell = cells[y * width + x];
+                cell.Char.UnicodeChar = static_cast<wchar_t>(L'a' + y * width + x);
+                cell.Attributes = x < 2 ? FOREGROUND_BLUE : BACKGROUND_RED;
+            }
+        }
+
+        const auto request = Viewport::FromDimensions({ -1, 3 }, { width, height });
+        Viewport written = Viewport::Empty();
+        VERIFY_SUCCEEDED(_pApiRoutines->WriteConsoleOutputWImpl(si, cells, request, written));
+        VERIFY_ARE_EQUAL((SMALL_RECT{ 0, 3, 2, 4 }), written.ToInclusive());
+
+        Log::Comment(L"Only the part inside the buffer should have been written, from the matching source cells.");
+        for (SHORT y = 0; y < 5; y++)
+        {
+            for (SHORT x = 0; x < 5; x++)
+            {
+                const auto it = si.GetCellDataAt({ x, y });
+                if (written.IsInBounds(COORD{ x, y }))
+                {
+                    const auto& expected = cells[(y - 3) * width + (x + 1)];
+                    VERIFY_ARE_EQUAL(std::wstring_view(&expected.Char.UnicodeChar, 1), it->Chars());
+                    VERIFY_ARE_EQUAL(expected.Attributes, it->TextAttr().GetLegacyAttributes());
+                }
+                else
+                {
+                    VERIFY_ARE_EQUAL(L" ", it->Chars());
+                }
+            }
+        }
+    }
+
+    TEST_METHOD(ApiReadConsoleOutputWClipsRectangle)
+    {
+        CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        SCREEN_INFORMATION& si = gci.GetActiveOutputBuffer();
+
+        VERIFY_SUCCEEDED(si.GetTextBuffer().ResizeTraditional({ 5, 5 }), L"Make the buffer small so this doesn't take forever.");
+
+        gci.LockConsole();
+        auto Unlock = wil::scope_exit([&] { gci.UnlockConsole(); });
+
+        si.GetActiveBuffer().ClearTextData(); // Clean out screen
+
+        Log::Comment(L"Fill the buffer with a letter per cell, alternating colors every two columns.");
+        std::vector<CHAR_INFO> screen(5 * 5);
+        for (SHORT i = 0; i < 5 * 5; i++)
+        {
+            screen[i].Char.UnicodeChar = static_cast<wchar_t>(L'a' + i);
+            screen[i].Attributes = (i % 5) < 2 ? FOREGROUND_GREEN : BACKGROUND_BLUE;
+        }
+        Viewport written = Viewport::Empty();
+        VERIFY_SUCCEEDED(_pApiRoutines->WriteConsoleOutputWImpl(si, screen, si.GetBufferSize(), written));
+
+        Log::Comment(L"Read a 3x3 rectangle hanging off the top and the left of the buffer.");
+        CHAR_INFO untouched;
+        untouched.Char.UnicodeChar = L'!';
+        untouched.Attributes = FOREGROUND_RED;
+        std::vector<CHAR_INFO> cells(3 * 3, untouched);
+
+        const auto request = Viewport::FromDimensions({ -1, -1 }, { 3, 3 });
+        Viewport read = Viewport::Empty();
+        VERIFY_SUCCEEDED(_pApiRoutines->ReadConsoleOutputWImpl(si, cells, request, read));
+        VERIFY_ARE_EQUAL((SMALL_RECT{ 0, 0, 1, 1 }), read.ToInclusive());
+
+        Log::Comment(L"The cells outside the buffer should be left alone, the rest should match the buffer.");
+        for (SHORT y = 0; y < 3; y++)
+        {
+            for (SHORT x = 0; x < 3; x++)
+            {
+                const auto& cell = cells[y * 3 + x];
+                const auto& expected = (x == 0 || y == 0) ? untouched : screen[(y - 1) * 5 + (x - 1)];
+                VERIFY_ARE_EQUAL(expected.Char.UnicodeChar, cell.Char.UnicodeChar);
+                VERIFY_ARE_EQUAL(expected.Attributes, cell.Attributes);
+            }
+        }
+    }
+
     TEST_METHOD(ApiScrollConsoleScreenBufferW)
     {
         BEGIN_TEST_METHOD_PROPERTIES()
@@ -62,6 +62,7 @@ namespace WEX {
 
 class AttrRowTests
 {
+    TextAttributePalette _palette;
     ATTR_ROW* pSingle;
     ATTR_ROW* pChain;
 
@@ -81,7 +82,7 @@ class AttrRowTests
 
     TEST_METHOD_SETUP(MethodSetup)
     {
-        pSingle = new ATTR_ROW(_sDefaultLength, _DefaultAttr);
+        pSingle = new ATTR_ROW(_sDefaultLength, _DefaultAttr, _palette);
 
         // Segment length is the expected length divided by the row length
         // E.g. row of 80, 4 segments, 20 segment length each
@@ -101,31 +102,47 @@ class AttrRowTests
         }
 
         // Create the chain
-        pChain = new ATTR_ROW(_sDefaultLength, _DefaultAttr);
+        pChain = new ATTR_ROW(_sDefaultLength, _DefaultAttr, _palette);
         pChain->_list.resize(sChainSegmentsNeeded);
 
         // Attach all chain segments that are even multiples of the row length
         for (short iChain = 0; iChain < _sDefaultChainLength; iChain++)
         {
-            TextAttributeRun* pRun = &pChain->_list[iChain];
-
-            pRun->SetAttributesFromLegacy(iChain); // Just use the chain position as the value
-            pRun->SetLength(sChainSegLength);
+            // Just use the chain position as the value
+            pChain->_list[iChain] = _LegacyRun(sChainSegLength, iChain);
         }
 
         if (sChainLeftover > 0)
         {
             // If we had a leftover, then this chain is one longer than we expected (the default length)
             // So use it as the index (because indicies start at 0)
-            TextAttributeRun* pRun = &pChain->_list[_sDefaultChainLength];
-
-            pRun->SetAttributes(_DefaultChainAttr);
-            pRun->SetLength(sChainLeftover);
+            pChain->_list[_sDefaultChainLength] = InternedAttributeRun(sChainLeftover, _palette.Intern(_DefaultChainAttr));
         }
 
         return true;
     }
 
+    // Routine Description:
+    // - Makes a run of the given legacy attribute in the form the row stores it.
+    InternedAttributeRun _LegacyRun(const size_t length, const WORD legacyAttr)
+    {
+        TextAttribute attr;
+        attr.SetFromLegacy(legacyAttr);
+        return InternedAttributeRun(length, _palette.Intern(attr));
+    }
+
+    // Routine Description:
+    // - Gets a copy of the runs stored in a row with their attributes looked up from the palette.
+    std::vector<TextAttributeRun> _ExpandRuns(const ATTR_ROW& row)
+    {
+        std::vector<TextAttributeRun> runs;
+        for (const auto& run : row._list)
+        {
+            runs.emplace_back(run.GetLength(), _palette.Lookup(run.GetHandle()));
+        }
+        return runs;
+    }
+
     TEST_METHOD_CLEANUP(MethodCleanup)
     {
         delete pSingle;
@@ -151,7 +168,7 @@ class AttrRowTests
             pUnderTest->Reset(attr);
 
             VERIFY_ARE_EQUAL(pUnderTest->_list.size(), 1u);
-            VERIFY_ARE_EQUAL(pUnderTest->_list[0].GetAttributes(), attr);
+            VERIFY_ARE_EQUAL(_palette.Lookup(pUnderTest->_list[0].GetHandle()), attr);
             VERIFY_ARE_EQUAL(pUnderTest->_list[0].GetLength(), (unsigned int)_sDefaultLength);
         }
     }
@@ -265,16 +282,14 @@ class AttrRowTests
 
         // Set up our "original row" that we are going to try to insert into.
         // This will represent a 10 column run of R3->B5->G2 that we will use for all tests.
-        ATTR_ROW originalRow{ static_cast<UINT>(_sDefaultLength), _DefaultAttr };
+        ATTR_ROW originalRow{ static_cast<UINT>(_sDefaultLength), _DefaultAttr, _palette };
         originalRow._list.resize(3);
         originalRow._cchRowWidth = 10;
-        originalRow._list[0].SetAttributesFromLegacy('R');
-        originalRow._list[0].SetLength(3);
-        originalRow._list[1].SetAttributesFromLegacy('B');
-        originalRow._list[1].SetLength(5);
-        originalRow._list[2].SetAttributesFromLegacy('G');
-        originalRow._list[2].SetLength(2);
-        LogChain(L"Original: ", originalRow._list);
+        originalRow._list[0] = _LegacyRun(3, 'R');
+        originalRow._list[1] = _LegacyRun(5, 'B');
+        originalRow._list[2] = _LegacyRun(2, 'G');
+        auto originalRuns = _ExpandRuns(originalRow);
+        LogChain(L"Original: ", originalRuns);
 
         // Set up our "insertion run"
         size_t cInsertRow = 1;
@@ -352,12 +367,13 @@ class AttrRowTests
         std::vector<TextAttributeRun> packedRunExpected;
         std::copy_n(packedRun.get(), cPackedRun, std::back_inserter(packedRunExpected));
 
+        auto actualRuns = _ExpandRuns(originalRow);
         LogChain(L"Expected: ", packedRunExpected);
-        LogChain(L"Actual: ", originalRow._list);
+        LogChain(L"Actual: ", actualRuns);
 
         for (size_t testIndex = 0; testIndex < cPackedRun; testIndex++)
         {
-            VERIFY_ARE_EQUAL(packedRun[testIndex], originalRow._list[testIndex]);
+            VERIFY_ARE_EQUAL(packedRun[testIndex], actualRuns[testIndex]);
         }
     }
 
@@ -514,10 +530,10 @@ class AttrRowTests
         // Was 1 (single), should now have 2 segments
         VERIFY_ARE_EQUAL(pSingle->_list.size(), 2u);
 
-        VERIFY_ARE_EQUAL(pSingle->_list[0].GetAttributes(), _DefaultAttr);
+        VERIFY_ARE_EQUAL(_palette.Lookup(pSingle->_list[0].GetHandle()), _DefaultAttr);
         VERIFY_ARE_EQUAL(pSingle->_list[0].GetLength(), (unsigned int)(_sDefaultLength - (_sDefaultLength - iTestIndex)));
 
-        VERIFY_ARE_EQUAL(pSingle->_list[1].GetAttributes(), TestAttr);
+        VERIFY_ARE_EQUAL(_palette.Lookup(pSingle->_list[1].GetHandle()), TestAttr);
         VERIFY_ARE_EQUAL(pSingle->_list[1].GetLength(), (unsigned int)(_sDefaultLength - iTestIndex));
 
         Log::Comment(L"SetAttrToEnd for existing chain of multiple colors.");
@@ -527,19 +543,19 @@ class AttrRowTests
         VERIFY_ARE_EQUAL(pChain->_list.size(), 5u);
 
         // Verify chain colors and lengths
-        VERIFY_ARE_EQUAL(TextAttribute(0), pChain->_list[0].GetAttributes());
+        VERIFY_ARE_EQUAL(TextAttribute(0), _palette.Lookup(pChain->_list[0].GetHandle()));
         VERIFY_ARE_EQUAL(pChain->_list[0].GetLength(), (unsigned int)13);
 
-        VERIFY_ARE_EQUAL(TextAttribute(1), pChain->_list[1].GetAttributes());
+        VERIFY_ARE_EQUAL(TextAttribute(1), _palette.Lookup(pChain->_list[1].GetHandle()));
         VERIFY_ARE_EQUAL(pChain->_list[1].GetLength(), (unsigned int)13);
 
-        VERIFY_ARE_EQUAL(TextAttribute(2), pChain->_list[2].GetAttributes());
+        VERIFY_ARE_EQUAL(TextAttribute(2), _palette.Lookup(pChain->_list[2].GetHandle()));
         VERIFY_ARE_EQUAL(pChain->_list[2].GetLength(), (unsigned int)13);
 
-        VERIFY_ARE_EQUAL(TextAttribute(3), pChain->_list[3].GetAttributes());
+        VERIFY_ARE_EQUAL(TextAttribute(3), _palette.Lookup(pChain->_list[3].GetHandle()));
         VERIFY_ARE_EQUAL(pChain->_list[3].GetLength(), (unsigned int)11);
 
-        VERIFY_ARE_EQUAL(TestAttr, pChain->_list[4].GetAttributes());
+        VERIFY_ARE_EQUAL(TestAttr, _palette.Lookup(pChain->_list[4].GetHandle()));
         VERIFY_ARE_EQUAL(pChain->_list[4].GetLength(), (unsigned int)30);
 
         Log::Comment(L"SECOND: Set index to 0 to test replacing anything with a single");
@@ -556,13 +572,34 @@ class AttrRowTests
             VERIFY_ARE_EQUAL(pUnderTest->_list.size(), 1u);
 
             // singular pair should contain the color
-            VERIFY_ARE_EQUAL(pUnderTest->_list[0].GetAttributes(), TestAttr);
+            VERIFY_ARE_EQUAL(_palette.Lookup(pUnderTest->_list[0].GetHandle()), TestAttr);
 
             // and its length should be the length of the whole string
             VERIFY_ARE_EQUAL(pUnderTest->_list[0].GetLength(), (unsigned int)_sDefaultLength);
         }
     }
 
+    TEST_METHOD(TestRunsShareInternedAttributes)
+    {
+        const TextAttribute truecolor{ RGB(0x12, 0x34, 0x56), RGB(0xab, 0xcd, 0xef) };
+
+        Log::Comment(L"Rows that use the same attribute should store the same handle.");
+        pSingle->SetAttrToEnd(10, truecolor);
+        pChain->SetAttrToEnd(20, truecolor);
+        VERIFY_ARE_EQUAL(pSingle->_list.back().GetHandle(), pChain->_list.back().GetHandle());
+        VERIFY_ARE_EQUAL(truecolor, pSingle->GetAttrByColumn(_sDefaultLength - 1));
+        VERIFY_ARE_NOT_EQUAL(pSingle->_list.front().GetHandle(), pSingle->_list.back().GetHandle());
+
+        Log::Comment(L"Moving a row to a new palette keeps its attributes but not necessarily its handles.");
+        const std::vector<TextAttribute> before{ pChain->begin(), pChain->end() };
+        auto oldPalette = std::move(_palette);
+        _palette = TextAttributePalette{};
+        pChain->RemapPalette(oldPalette);
+        const std::vector<TextAttribute> after{ pChain->begin(), pChain->end() };
+        VERIFY_IS_TRUE(before == after);
+        VERIFY_ARE_EQUAL(pChain->_list.size(), _palette.size() - 1, L"Every run has its own attribute, plus the palette's default entry.");
+    }
+
     TEST_METHOD(TestTotalLength)
     {
         ATTR_ROW* pTestItems[]{ pSingle, pChain };
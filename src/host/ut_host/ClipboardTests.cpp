@@ -158,6 +158,38 @@ class ClipboardTests
         VERIFY_IS_NOT_NULL(ptr);
     }
 
+    TEST_METHOD(GenHTMLWritesASpanForEachColorRun)
+    {
+        const std::wstring text{ L"red\x00e9\r\nblue" };
+        const std::vector<TextBuffer::ColorRun> colors{
+            { 4, RGB(0xff, 0x00, 0x00), RGB(0x00, 0x00, 0x00) },
+            { 2, RGB(0x00, 0x00, 0x00), RGB(0x00, 0x00, 0x00) },
+            { 4, RGB(0x00, 0x00, 0xff), RGB(0x10, 0x20, 0x30) }
+        };
+
+        const std::string html = Clipboard::Instance().GenHTML(text, colors);
+        VERIFY_IS_FALSE(html.empty());
+
+        // the offsets in the header have to point at what they say they do
+        const auto readOffset = [&](const char* const name) {
+            const auto at = html.find(name);
+            VERIFY_ARE_NOT_EQUAL(std::string::npos, at);
+            return static_cast<size_t>(std::stoul(html.substr(at + strlen(name), 10)));
+        };
+        VERIFY_ARE_EQUAL(0, html.compare(readOffset("StartHTML:"), 15, "<!DOCTYPE><HTML"));
+        VERIFY_ARE_EQUAL(html.size() - 1, readOffset("EndHTML:"));
+        VERIFY_ARE_EQUAL(0, html.compare(readOffset("StartFragment:"), 17, "<!--StartFragment"));
+        VERIFY_ARE_EQUAL(0, html.compare(readOffset("EndFragment:"), 14, "</BODY></HTML>"));
+
+        VERIFY_ARE_NOT_EQUAL(std::string::npos, html.find(R"(<SPAN STYLE="color:#ff0000;background-color:#000000">red)"
+                                                          "\xC3\xA9</SPAN>"));
+        VERIFY_ARE_NOT_EQUAL(std::string::npos, html.find(R"(<SPAN STYLE="color:#000000;background-color:#000000">)"
+                                                          "\r\n</SPAN>"));
+        VERIFY_ARE_NOT_EQUAL(std::string::npos, html.find(R"(<SPAN STYLE="color:#0000ff;background-color:#102030">blue</SPAN>)"));
+
+        VERIFY_IS_TRUE(Clipboard::Instance().GenHTML(L"", {}).empty());
+    }
+
     TEST_METHOD(CanConvertTextToInputEvents)
     {
         std::wstring wstr = L"hello world";
@@ -329,4 +361,48 @@ class ClipboardTests
             VERIFY_ARE_EQUAL(expectedEvents[i], currentKeyEvent, NoThrowString().Format(L"i == %d", i));
         }
     }
+
+    TEST_METHOD(BigPastesAreTypedInTheBackground)
+    {
+        CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        gci.pInputBuffer->Flush();
+
+        auto& clipboard = Clipboard::Instance();
+        const std::wstring wstr(Clipboard::s_SynchronousPasteLimit * 8, L'a');
+        clipboard.StringPaste(wstr.c_str(), wstr.size());
+
+        Log::Comment(L"The paste is typed a block at a time, as the app reads it.");
+        std::vector<INPUT_RECORD> records;
+        std::array<INPUT_RECORD, 1024> readRecords;
+        size_t mostPending = 0;
+        for (auto tries = 0; tries < 10000; ++tries)
+        {
+            const bool pasting = clipboard._pastePipeline.IsPasting();
+
+            gci.LockConsole();
+            auto Unlock = wil::scope_exit([&] { gci.UnlockConsole(); });
+            mostPending = std::max(mostPending, gci.pInputBuffer->GetNumberOfReadyEvents());
+            size_t eventsRead = 0;
+            VERIFY_NT_SUCCESS(gci.pInputBuffer->Read(readRecords, eventsRead, false, false));
+            records.insert(records.end(), readRecords.begin(), readRecords.begin() + eventsRead);
+            Unlock.reset();
+
+            if (!pasting && eventsRead == 0)
+            {
+                break;
+            }
+            Sleep(1);
+        }
+
+        VERIFY_IS_FALSE(clipboard._pastePipeline.IsPasting());
+        VERIFY_ARE_EQUAL(wstr.size() * 2, records.size());
+        VERIFY_IS_LESS_THAN(mostPending, records.size());
+
+        const KeyEvent keyDown{ records.front().Event.KeyEvent };
+        VERIFY_IS_TRUE(keyDown.IsKeyDown());
+        VERIFY_ARE_EQUAL(L'a', keyDown.GetCharData());
+        const KeyEvent keyUp{ records.back().Event.KeyEvent };
+        VERIFY_IS_FALSE(keyUp.IsKeyDown());
+        VERIFY_ARE_EQUAL(L'a', keyUp.GetCharData());
+    }
     };
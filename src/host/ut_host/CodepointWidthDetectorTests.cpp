@@ -8,6 +8,7 @@
 
 #include "../types/inc/CodepointWidthDetector.hpp"
 
+using namespace WEX::Common;
 using namespace WEX::Logging;
 
 static constexpr std::wstring_view emoji = L"\xD83E\xDD22"; // U+1F922 nauseated face
@@ -34,15 +35,18 @@ class CodepointWidthDetectorTests
     TEST_CLASS(CodepointWidthDetectorTests);
 
 
-    TEST_METHOD(CodepointWidthDetectDefersMapPopulation)
+    TEST_METHOD(TableMatchesRanges)
     {
-        CodepointWidthDetector widthDetector;
-        VERIFY_IS_TRUE(widthDetector._map.empty());
-        widthDetector.IsWide(UNICODE_SPACE);
-        VERIFY_IS_TRUE(widthDetector._map.empty());
-        // now force checking
-        widthDetector.GetWidth(emoji);
-        VERIFY_IS_FALSE(widthDetector._map.empty());
+        const auto& table = CodepointWidthDetector::s_GetWidthTable();
+        for (unsigned int codepoint = 0; codepoint < CodepointWidthDetector::s_CodepointCount; ++codepoint)
+        {
+            const auto expected = CodepointWidthDetector::s_LookupRange(codepoint);
+            const auto actual = table.blocks[table.blockIndices[codepoint >> CodepointWidthDetector::s_BlockShift]][codepoint & (CodepointWidthDetector::s_BlockSize - 1)];
+            if (expected != actual)
+            {
+                VERIFY_ARE_EQUAL(expected, actual, NoThrowString().Format(L"codepoint %x", codepoint));
+            }
+        }
     }
 
     TEST_METHOD(CanLookUpEmoji)
@@ -51,13 +55,14 @@ class CodepointWidthDetectorTests
         VERIFY_IS_TRUE(widthDetector.IsWide(emoji));
     }
 
-    TEST_METHOD(TestUnicodeRangeCompare)
+    TEST_METHOD(RangeLookupFindsBoundsAndGaps)
     {
-        CodepointWidthDetector::UnicodeRangeCompare compare;
-        // test comparing 2 search terms
-        CodepointWidthDetector::UnicodeRange a{ 0x10 };
-        CodepointWidthDetector::UnicodeRange b{ 0x15 };
-        VERIFY_IS_TRUE(static_cast<bool>(compare(a, b)));
+        VERIFY_ARE_EQUAL(CodepointWidth::Narrow, CodepointWidthDetector::s_LookupRange(0));
+        VERIFY_ARE_EQUAL(CodepointWidth::Narrow, CodepointWidthDetector::s_LookupRange(160));
+        VERIFY_ARE_EQUAL(CodepointWidth::Ambiguous, CodepointWidthDetector::s_LookupRange(161));
+        VERIFY_ARE_EQUAL(CodepointWidth::Ambiguous, CodepointWidthDetector::s_LookupRange(1114109));
+        VERIFY_ARE_EQUAL(CodepointWidth::Invalid, CodepointWidthDetector::s_LookupRange(1114110));
+        VERIFY_ARE_EQUAL(CodepointWidth::Invalid, CodepointWidthDetector::s_LookupRange(917506));
     }
 
     TEST_METHOD(CanExtractCodepoint)
@@ -98,27 +103,61 @@ class CodepointWidthDetectorTests
 
     TEST_METHOD(AmbiguousCache)
     {
-        // Set up a detector with fallback.
+        // Set up a detector with fallback that counts how often it's asked.
+        size_t asked = 0;
         CodepointWidthDetector widthDetector;
-        widthDetector.SetFallbackMethod(std::bind(&FallbackMethod, std::placeholders::_1));
+        widthDetector.SetFallbackMethod([&](const std::wstring_view glyph) {
+            ++asked;
+            return FallbackMethod(glyph);
+        });
+
+        const auto codepoint = widthDetector._extractCodepoint(ambiguous);
+        const auto generation = widthDetector.GetFontGeneration();
 
         // Ensure fallback cache is empty.
-        VERIFY_ARE_EQUAL(0u, widthDetector._fallbackCache.size());
+        VERIFY_IS_FALSE(widthDetector._findFallback(codepoint, generation).has_value());
 
-        // Lookup ambiguous width character.
+        // Lookup ambiguous width character. The cache should hold what the fallback said.
+        VERIFY_ARE_EQUAL(FallbackMethod(ambiguous), widthDetector.IsWide(ambiguous));
+        VERIFY_ARE_EQUAL(1u, asked);
+        const auto cached = widthDetector._findFallback(codepoint, generation);
+        VERIFY_IS_TRUE(cached.has_value());
+        VERIFY_ARE_EQUAL(FallbackMethod(ambiguous), *cached);
+
+        // Looking it up again shouldn't ask again.
         widthDetector.IsWide(ambiguous);
+        VERIFY_ARE_EQUAL(1u, asked);
 
-        // Cache should hold it.
-        VERIFY_ARE_EQUAL(1u, widthDetector._fallbackCache.size());
+        // Once the font changes, what was cached is for the old one, and is asked about again.
+        widthDetector.NotifyFontChanged();
+        VERIFY_ARE_NOT_EQUAL(generation, widthDetector.GetFontGeneration());
+        VERIFY_IS_FALSE(widthDetector._findFallback(codepoint, widthDetector.GetFontGeneration()).has_value());
+        widthDetector.IsWide(ambiguous);
+        VERIFY_ARE_EQUAL(2u, asked);
+    }
+
+    TEST_METHOD(PrewarmFillsAmbiguousOnly)
+    {
+        size_t asked = 0;
+        CodepointWidthDetector widthDetector;
+        widthDetector.SetFallbackMethod([&](const std::wstring_view glyph) {
+            ++asked;
+            return FallbackMethod(glyph);
+        });
+
+        const auto generation = widthDetector.GetFontGeneration();
+        VERIFY_IS_TRUE(widthDetector.PrewarmFallbackCache(L'\x0400', L'\x0452', generation));
+        VERIFY_IS_GREATER_THAN(asked, 0u);
 
-        // Cached item should match what we expect
-        const auto it = widthDetector._fallbackCache.begin();
-        VERIFY_ARE_EQUAL(ambiguous, it->first);
-        VERIFY_ARE_EQUAL(FallbackMethod(ambiguous), it->second);
+        Log::Comment(L"Everything that was asked about is cached, so writing it doesn't ask again.");
+        const auto prewarmed = asked;
+        widthDetector.IsWide(ambiguous);
+        VERIFY_ARE_EQUAL(prewarmed, asked);
 
-        // Cache should empty when font changes.
+        Log::Comment(L"Prewarming stops once the font has changed.");
         widthDetector.NotifyFontChanged();
-        VERIFY_ARE_EQUAL(0u, widthDetector._fallbackCache.size());
+        VERIFY_IS_FALSE(widthDetector.PrewarmFallbackCache(L'\x0400', L'\x0452', generation));
+        VERIFY_ARE_EQUAL(prewarmed, asked);
     }
 
 };
@@ -409,6 +409,36 @@ class CommandLineTests
         VerifyPromptText(cookedReadData, L"\x1a"); // ctrl-z
     }
 
+    TEST_METHOD(DeleteFromRightOfCursorRedrawsChangedCells)
+    {
+        auto buffer = std::make_unique<wchar_t[]>(PROMPT_SIZE);
+        VERIFY_IS_NOT_NULL(buffer.get());
+
+        auto& cookedReadData = ServiceLocator::LocateGlobals().getConsoleInformation().CookedReadData();
+        InitCookedReadData(cookedReadData, nullptr, buffer.get(), PROMPT_SIZE);
+        VERIFY_IS_TRUE(cookedReadData.IsEchoInput());
+
+        // Show the prompt text the way it would've been echoed.
+        auto& screenInfo = cookedReadData.ScreenInfo();
+        const std::wstring text = L"abcdef";
+        screenInfo.Write(OutputCellIterator(text), { 0, 0 });
+        SetPrompt(cookedReadData, text);
+        MoveCursor(cookedReadData, 2);
+
+        auto& commandLine = CommandLine::Instance();
+        commandLine.DeleteFromRightOfCursor(cookedReadData);
+        VerifyPromptText(cookedReadData, L"abdef");
+        VERIFY_ARE_EQUAL(static_cast<size_t>(5), cookedReadData.VisibleCharCount());
+
+        // The rest of the line moved over, and the cell it moved off of was blanked out.
+        const std::wstring expected = L"abdef ";
+        for (SHORT i = 0; i < gsl::narrow<SHORT>(expected.size()); i++)
+        {
+            const std::wstring cell{ screenInfo.GetCellDataAt({ i, 0 })->Chars() };
+            VERIFY_ARE_EQUAL(String(expected.substr(i, 1).c_str()), String(cell.c_str()));
+        }
+    }
+
     TEST_METHOD(CanDeleteCommandHistory)
     {
         auto buffer = std::make_unique<wchar_t[]>(PROMPT_SIZE);
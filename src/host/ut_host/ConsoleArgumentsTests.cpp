@@ -30,6 +30,8 @@ public:
     TEST_METHOD(InitialSizeTests);
 
     TEST_METHOD(HeadlessArgTests);
+    TEST_METHOD(NoRenderArgTests);
+    TEST_METHOD(FrameCaptureArgTests);
     TEST_METHOD(SignalHandleTests);
     TEST_METHOD(FeatureArgTests);
 
@@ -926,6 +928,74 @@ void ConsoleArgumentsTests::HeadlessArgTests()
                    true); // successful parse?
 }
 
+void ConsoleArgumentsTests::NoRenderArgTests()
+{
+    // Just some assorted positive values that could be valid handles. No specific correlation to anything.
+    HANDLE hInSample = UlongToHandle(0x10);
+    HANDLE hOutSample = UlongToHandle(0x24);
+
+    std::wstring commandline;
+
+    commandline = L"conhost.exe --norender";
+    Log::Comment(L"#1 Check that the norender arg is also headless");
+    {
+        const auto args = CreateAndParse(commandline, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE);
+        VERIFY_IS_TRUE(args.IsRenderless());
+        VERIFY_IS_TRUE(args.IsHeadless());
+        VERIFY_IS_FALSE(args.InConptyMode());
+    }
+
+    commandline = L"conhost.exe --norender this is the commandline";
+    Log::Comment(L"#2 Redirected standard handles aren't a VT connection when there's nothing to render");
+    {
+        const auto args = CreateAndParse(commandline, hInSample, hOutSample);
+        VERIFY_IS_TRUE(args.IsRenderless());
+        VERIFY_IS_FALSE(args.HasVtHandles());
+        VERIFY_IS_FALSE(args.InConptyMode());
+        VERIFY_ARE_EQUAL(std::wstring{ L"this is the commandline" }, args.GetClientCommandline());
+    }
+
+    commandline = L"conhost.exe -- this is the commandline --norender";
+    Log::Comment(L"#3 The norender arg belongs to the client after --");
+    {
+        const auto args = CreateAndParse(commandline, hInSample, hOutSample);
+        VERIFY_IS_FALSE(args.IsRenderless());
+        VERIFY_IS_TRUE(args.HasVtHandles());
+    }
+
+    commandline = L"conhost.exe --norender --signal 0x8";
+    Log::Comment(L"#4 A signal handle can't be used with norender");
+    {
+        CreateAndParseUnsuccessfully(commandline, hInSample, hOutSample);
+    }
+}
+
+void ConsoleArgumentsTests::FrameCaptureArgTests()
+{
+    std::wstring commandline;
+
+    commandline = L"conhost.exe --captureframes C:\\frames.bin cmd.exe";
+    Log::Comment(L"#1 The path after --captureframes is where frames go, and the rest is the client");
+    {
+        const auto args = CreateAndParse(commandline, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE);
+        VERIFY_ARE_EQUAL(std::wstring{ L"C:\\frames.bin" }, args.GetFrameCapturePath());
+        VERIFY_ARE_EQUAL(std::wstring{ L"cmd.exe" }, args.GetClientCommandline());
+    }
+
+    commandline = L"conhost.exe cmd.exe";
+    Log::Comment(L"#2 Without it, no frames are captured");
+    {
+        const auto args = CreateAndParse(commandline, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE);
+        VERIFY_IS_TRUE(args.GetFrameCapturePath().empty());
+    }
+
+    commandline = L"conhost.exe --captureframes";
+    Log::Comment(L"#3 --captureframes needs a path");
+    {
+        CreateAndParseUnsuccessfully(commandline, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE);
+    }
+}
+
 void ConsoleArgumentsTests::SignalHandleTests()
 {
     // Just some assorted positive values that could be valid handles. No specific correlation to anything.
@@ -8,6 +8,7 @@
 #include "CommonState.hpp"
 
 #include "search.h"
+#include "historyStore.h"
 
 using namespace WEX::Common;
 using namespace WEX::Logging;
@@ -114,7 +115,7 @@ class HistoryTests
             {
                 VERIFY_SUCCEEDED(history->Add(_manyHistoryItems[j], false));
             }
-            VERIFY_ARE_EQUAL(s_BufferSize, history->GetNumberOfCommands());
+            VERIFY_ARE_EQUAL(static_cast<size_t>(s_BufferSize), history->GetNumberOfCommands());
         }
         VERIFY_ARE_EQUAL(s_NumberOfBuffers, CommandHistory::s_historyLists.size());
 
@@ -140,7 +141,7 @@ class HistoryTests
         {
             VERIFY_SUCCEEDED(history->Add(_manyHistoryItems[j], false));
         }
-        VERIFY_ARE_EQUAL(s_BufferSize, history->GetNumberOfCommands());
+        VERIFY_ARE_EQUAL(static_cast<size_t>(s_BufferSize), history->GetNumberOfCommands());
 
         Log::Comment(L"Retrieve items/order.");
         std::vector<std::wstring> commandsStored;
@@ -151,7 +152,7 @@ class HistoryTests
 
         Log::Comment(L"Reallocate larger and ensure items and order are preserved.");
         history->Realloc(_manyHistoryItems.size());
-        VERIFY_ARE_EQUAL(s_BufferSize, history->GetNumberOfCommands());
+        VERIFY_ARE_EQUAL(static_cast<size_t>(s_BufferSize), history->GetNumberOfCommands());
         for (SHORT i = 0; i < (SHORT)commandsStored.size(); i++)
         {
             VERIFY_ARE_EQUAL(String(commandsStored[i].data()), String(history->GetNth(i).data()));
@@ -174,7 +175,7 @@ class HistoryTests
         {
             VERIFY_SUCCEEDED(history->Add(_manyHistoryItems[j], false));
         }
-        VERIFY_ARE_EQUAL(s_BufferSize, history->GetNumberOfCommands());
+        VERIFY_ARE_EQUAL(static_cast<size_t>(s_BufferSize), history->GetNumberOfCommands());
 
         Log::Comment(L"Retrieve items/order.");
         std::vector<std::wstring> commandsStored;
@@ -241,6 +242,107 @@ class HistoryTests
         VERIFY_ARE_EQUAL(2ul, history->GetNumberOfCommands());
     }
 
+    TEST_METHOD(FindMatchingCommandWalksBackThroughPrefixes)
+    {
+        auto history = CommandHistory::s_Allocate(_manyApps[0], _MakeHandle(0));
+        VERIFY_IS_NOT_NULL(history);
+
+        // Two more than fit, so the oldest two are gone and the rest have moved down.
+        for (const auto& item : _manyHistoryItems)
+        {
+            VERIFY_SUCCEEDED(history->Add(item, false));
+        }
+        VERIFY_ARE_EQUAL(static_cast<size_t>(s_BufferSize), history->GetNumberOfCommands());
+
+        SHORT index = 0;
+        const auto options = CommandHistory::MatchOptions::JustLooking;
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"IP", history->LastDisplayed, index, options));
+        VERIFY_ARE_EQUAL(String(L"ipconfig /all"), String(history->GetNth(index).data()));
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"IP", index, index, options));
+        VERIFY_ARE_EQUAL(String(L"ipconfig"), String(history->GetNth(index).data()));
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"IP", index, index, options));
+        VERIFY_ARE_EQUAL(String(L"ipconfig /all"), String(history->GetNth(index).data()), L"Past the oldest, it goes around to the newest.");
+
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"IPCONFIG", history->LastDisplayed, index, options | CommandHistory::MatchOptions::ExactMatch));
+        VERIFY_ARE_EQUAL(String(L"ipconfig"), String(history->GetNth(index).data()));
+
+        VERIFY_IS_FALSE(history->FindMatchingCommand(L"dir /w", history->LastDisplayed, index, options), L"That one rolled off.");
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"dir", history->LastDisplayed, index, options));
+        VERIFY_ARE_EQUAL(String(L"dir /p /w"), String(history->GetNth(index).data()));
+
+        Log::Comment(L"Removing or moving commands keeps the index in step.");
+        VERIFY_ARE_EQUAL(String(L"ipconfig"), String(history->Remove(2).c_str()));
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"ip", history->LastDisplayed, index, options));
+        VERIFY_ARE_EQUAL(static_cast<SHORT>(2), index);
+        VERIFY_IS_FALSE(history->FindMatchingCommand(L"ipconfig", history->LastDisplayed, index, options | CommandHistory::MatchOptions::ExactMatch));
+
+        history->Swap(0, 2);
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"ip", history->LastDisplayed, index, options));
+        VERIFY_ARE_EQUAL(static_cast<SHORT>(0), index);
+    }
+
+    TEST_METHOD(HistoriesAreFoundByProcessAndAppName)
+    {
+        for (size_t i = 0; i < s_NumberOfBuffers; i++)
+        {
+            VERIFY_IS_NOT_NULL(CommandHistory::s_Allocate(_manyApps[i], _MakeHandle(i)));
+        }
+
+        const auto first = CommandHistory::s_Find(_MakeHandle(0));
+        VERIFY_IS_NOT_NULL(first);
+        VERIFY_ARE_EQUAL(first, CommandHistory::s_FindByExe(L"FOO.EXE"), L"App names match without regard to case.");
+
+        CommandHistory::s_Free(_MakeHandle(0));
+        VERIFY_IS_NULL(CommandHistory::s_Find(_MakeHandle(0)));
+        VERIFY_IS_NULL(CommandHistory::s_FindByExe(_manyApps[0]), L"Freed histories aren't found by name.");
+
+        Log::Comment(L"The freed one is the only one to take when another app connects, and it takes its name.");
+        const auto reused = CommandHistory::s_Allocate(_manyApps[4], _MakeHandle(44));
+        VERIFY_ARE_EQUAL(first, reused);
+        VERIFY_ARE_EQUAL(reused, CommandHistory::s_Find(_MakeHandle(44)));
+        VERIFY_ARE_EQUAL(reused, CommandHistory::s_FindByExe(_manyApps[4]));
+        VERIFY_IS_NULL(CommandHistory::s_FindByExe(_manyApps[0]));
+        VERIFY_ARE_EQUAL(CommandHistory::s_Find(_MakeHandle(1)), CommandHistory::s_FindByExe(_manyApps[1]));
+    }
+
+    TEST_METHOD(StoreKeepsCommandsBetweenSessions)
+    {
+        wchar_t tempPath[MAX_PATH + 1];
+        VERIFY_ARE_NOT_EQUAL(0u, GetTempPathW(ARRAYSIZE(tempPath), tempPath));
+        wchar_t tempFile[MAX_PATH + 1];
+        VERIFY_ARE_NOT_EQUAL(0u, GetTempFileNameW(tempPath, L"cht", 0, tempFile));
+        auto deleteFile = wil::scope_exit([&]() { DeleteFileW(tempFile); });
+
+        Log::Comment(L"Write some commands in one session.");
+        {
+            HistoryStore store{ tempFile };
+            VERIFY_IS_TRUE(store.ReadNewest(s_BufferSize).empty(), L"A new file has nothing in it.");
+            for (const auto& item : _manyHistoryItems)
+            {
+                store.Append(item);
+            }
+        }
+
+        Log::Comment(L"Read back just the newest ones in another, oldest first.");
+        {
+            HistoryStore store{ tempFile };
+            const auto commands = store.ReadNewest(s_BufferSize);
+            VERIFY_ARE_EQUAL(static_cast<size_t>(s_BufferSize), commands.size());
+            for (size_t i = 0; i < commands.size(); i++)
+            {
+                VERIFY_ARE_EQUAL(_manyHistoryItems.at(_manyHistoryItems.size() - s_BufferSize + i), commands.at(i));
+            }
+
+            Log::Comment(L"A second store on the same file appends after the first.");
+            HistoryStore other{ tempFile };
+            other.Append(L"exit");
+            VERIFY_ARE_EQUAL(std::wstring{ L"exit" }, store.ReadNewest(1).at(0));
+
+            store.Clear();
+            VERIFY_IS_TRUE(other.ReadNewest(s_BufferSize).empty());
+        }
+    }
+
 private:
 
     const std::array<std::wstring, 5> _manyApps =
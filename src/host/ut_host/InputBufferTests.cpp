@@ -77,7 +77,7 @@ class InputBufferTests
             INPUT_RECORD record;
             record.EventType = MENU_EVENT;
             VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(record)), 0u);
-            VERIFY_ARE_EQUAL(record, inputBuffer._storage.back()->ToInputRecord());
+            VERIFY_ARE_EQUAL(record, inputBuffer._storage.back());
         }
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT);
     }
@@ -97,7 +97,7 @@ class InputBufferTests
         // verify that the events are the same in storage
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i]->ToInputRecord(), record);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i], record);
         }
     }
 
@@ -120,10 +120,9 @@ class InputBufferTests
         // check that they coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 1u);
         // check that the mouse position is being updated correctly
-        const IInputEvent* const pOutEvent = inputBuffer._storage.front().get();
-        const MouseEvent* const pMouseEvent = static_cast<const MouseEvent* const>(pOutEvent);
-        VERIFY_ARE_EQUAL(pMouseEvent->GetPosition().X, static_cast<SHORT>(RECORD_INSERT_COUNT));
-        VERIFY_ARE_EQUAL(pMouseEvent->GetPosition().Y, static_cast<SHORT>(RECORD_INSERT_COUNT * 2));
+        const MOUSE_EVENT_RECORD& outEvent = inputBuffer._storage.front().Event.MouseEvent;
+        VERIFY_ARE_EQUAL(outEvent.dwMousePosition.X, static_cast<SHORT>(RECORD_INSERT_COUNT));
+        VERIFY_ARE_EQUAL(outEvent.dwMousePosition.Y, static_cast<SHORT>(RECORD_INSERT_COUNT * 2));
 
         // add a key event and another mouse event to make sure that
         // an event between two mouse events stopped the coalescing.
@@ -161,10 +160,10 @@ class InputBufferTests
         // no events should have been coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT + 1);
         // check that the events stored match those inserted
-        VERIFY_ARE_EQUAL(inputBuffer._storage.front()->ToInputRecord(), mouseRecords[0]);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front(), mouseRecords[0]);
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1]->ToInputRecord(), mouseRecords[i]);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1], mouseRecords[i]);
         }
     }
 
@@ -220,10 +219,10 @@ class InputBufferTests
         // no events should have been coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT + 1);
         // check that the events stored match those inserted
-        VERIFY_ARE_EQUAL(inputBuffer._storage.front()->ToInputRecord(), keyRecords[0]);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front(), keyRecords[0]);
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1]->ToInputRecord(), keyRecords[i]);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1], keyRecords[i]);
         }
     }
 
@@ -238,7 +237,7 @@ class InputBufferTests
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
             VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(record)), 0u);
-            VERIFY_ARE_EQUAL(inputBuffer._storage.back()->ToInputRecord(), record);
+            VERIFY_ARE_EQUAL(inputBuffer._storage.back(), record);
         }
 
         // The events shouldn't be coalesced
@@ -588,22 +587,17 @@ class InputBufferTests
     {
         InputBuffer inputBuffer;
         INPUT_RECORD record = MakeKeyEvent(true, 1, L'a', 0, L'a', 0);
-        std::unique_ptr<IInputEvent> inputEvent = IInputEvent::Create(record);
         size_t eventsWritten;
         bool waitEvent = false;
         inputBuffer.Flush();
         // write one event to an empty buffer
-        std::deque<std::unique_ptr<IInputEvent>> storage;
-        storage.push_back(std::move(inputEvent));
-        inputBuffer._WriteBuffer(storage, eventsWritten, waitEvent);
+        inputBuffer._WriteBuffer({ &record, 1 }, eventsWritten, waitEvent);
         VERIFY_IS_TRUE(waitEvent);
         // write another, it shouldn't signal this time
         INPUT_RECORD record2 = MakeKeyEvent(true, 1, L'b', 0, L'b', 0);
-        std::unique_ptr<IInputEvent> inputEvent2 = IInputEvent::Create(record2);
         // write another event to a non-empty buffer
         waitEvent = false;
-        storage.push_back(std::move(inputEvent2));
-        inputBuffer._WriteBuffer(storage, eventsWritten, waitEvent);
+        inputBuffer._WriteBuffer({ &record2, 1 }, eventsWritten, waitEvent);
 
         VERIFY_IS_FALSE(waitEvent);
     }
@@ -624,7 +618,7 @@ class InputBufferTests
                                                  true));
         VERIFY_ARE_EQUAL(outEvents.size(), 1u);
         VERIFY_ARE_EQUAL(inputBuffer._storage.size(), 1u);
-        VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*inputBuffer._storage.front()).GetRepeatCount(), repeatCount - 1);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front().Event.KeyEvent.wRepeatCount, repeatCount - 1);
         VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*outEvents.front()).GetRepeatCount(), 1u);
     }
 
@@ -644,8 +638,210 @@ class InputBufferTests
                                                  true));
         VERIFY_ARE_EQUAL(outEvents.size(), 1u);
         VERIFY_ARE_EQUAL(inputBuffer._storage.size(), 1u);
-        VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*inputBuffer._storage.front()).GetRepeatCount(), repeatCount);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front().Event.KeyEvent.wRepeatCount, repeatCount);
         VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*outEvents.front()).GetRepeatCount(), 1u);
     }
 
+    TEST_METHOD(StorageKeepsOrderWhenItWrapsAndGrows)
+    {
+        InputBuffer inputBuffer;
+        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+
+        // leave one event behind, so that the start of the ring has moved along
+        // and what's written next wraps around the end of its array and then
+        // makes it grow
+        for (WCHAR ch = L'a'; ch < L'a' + RECORD_INSERT_COUNT; ++ch)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer.Write(MakeKeyEvent(true, 1, ch, 0, ch, 0)), 1u);
+        }
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents, RECORD_INSERT_COUNT - 1, false, false, true, false));
+        outEvents.clear();
+
+        std::vector<INPUT_RECORD> records;
+        for (WCHAR ch = L'A'; ch < L'A' + RECORD_INSERT_COUNT * 10; ++ch)
+        {
+            records.push_back(MakeKeyEvent(true, 1, ch, 0, ch, 0));
+        }
+        VERIFY_ARE_EQUAL(inputBuffer.Write(IInputEvent::Create(records)), records.size());
+        VERIFY_ARE_EQUAL(inputBuffer._storage.size(), records.size() + 1);
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1], records[i]);
+        }
+
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents, records.size() + 1, false, false, true, false));
+        VERIFY_ARE_EQUAL(outEvents.size(), records.size() + 1);
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(outEvents[i + 1]->ToInputRecord(), records[i]);
+        }
+        VERIFY_IS_TRUE(inputBuffer._storage.empty());
+    }
+
+    TEST_METHOD(CanReadRecordsStraightIntoArray)
+    {
+        InputBuffer inputBuffer;
+
+        // leave one event behind, so that the records read next sit on both
+        // sides of where the ring wraps around
+        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        for (WCHAR ch = L'a'; ch < L'a' + 63; ++ch)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer.Write(MakeKeyEvent(true, 1, ch, 0, ch, 0)), 1u);
+        }
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents, 62, false, false, true, false));
+
+        std::vector<INPUT_RECORD> records;
+        for (WCHAR ch = L'A'; ch < L'A' + RECORD_INSERT_COUNT; ++ch)
+        {
+            records.push_back(MakeKeyEvent(true, 1, ch, 0, ch, 0));
+        }
+        VERIFY_ARE_EQUAL(inputBuffer.Write(IInputEvent::Create(records)), records.size());
+        const INPUT_RECORD first = inputBuffer._storage.front();
+
+        std::vector<INPUT_RECORD> outRecords(RECORD_INSERT_COUNT * 2);
+        size_t eventsRead = 0;
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords, eventsRead, true, false));
+        VERIFY_ARE_EQUAL(eventsRead, RECORD_INSERT_COUNT + 1);
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT + 1);
+
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(gsl::make_span(outRecords.data(), 2), eventsRead, false, false));
+        VERIFY_ARE_EQUAL(eventsRead, static_cast<size_t>(2));
+        VERIFY_ARE_EQUAL(outRecords[0], first);
+        VERIFY_ARE_EQUAL(outRecords[1], records[0]);
+
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords, eventsRead, false, false));
+        VERIFY_ARE_EQUAL(eventsRead, RECORD_INSERT_COUNT - 1);
+        for (size_t i = 0; i < eventsRead; ++i)
+        {
+            VERIFY_ARE_EQUAL(outRecords[i], records[i + 1]);
+        }
+        VERIFY_IS_TRUE(inputBuffer._storage.empty());
+
+        VERIFY_ARE_EQUAL(inputBuffer.Read(outRecords, eventsRead, false, true), CONSOLE_STATUS_WAIT);
+        VERIFY_ARE_EQUAL(eventsRead, static_cast<size_t>(0));
+    }
+
+    TEST_METHOD(InputBufferCoalescesMouseWheelEvents)
+    {
+        InputBuffer inputBuffer;
+
+        INPUT_RECORD wheelRecord{};
+        wheelRecord.EventType = MOUSE_EVENT;
+        wheelRecord.Event.MouseEvent.dwEventFlags = MOUSE_WHEELED;
+        wheelRecord.Event.MouseEvent.dwButtonState = MAKELONG(0, static_cast<WORD>(-WHEEL_DELTA));
+
+        for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer.Write(wheelRecord), 1u);
+        }
+
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 1u);
+        const MOUSE_EVENT_RECORD& outEvent = inputBuffer._storage.front().Event.MouseEvent;
+        VERIFY_ARE_EQUAL(static_cast<SHORT>(HIWORD(outEvent.dwButtonState)), static_cast<SHORT>(-WHEEL_DELTA * static_cast<int>(RECORD_INSERT_COUNT)));
+
+        // the other wheel is kept apart
+        wheelRecord.Event.MouseEvent.dwEventFlags = MOUSE_HWHEELED;
+        VERIFY_ARE_EQUAL(inputBuffer.Write(wheelRecord), 1u);
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 2u);
+    }
+
+    TEST_METHOD(InputBufferKeepsOnlyTheLastWindowSizeAndFocusEvents)
+    {
+        InputBuffer inputBuffer;
+
+        INPUT_RECORD sizeRecord{};
+        sizeRecord.EventType = WINDOW_BUFFER_SIZE_EVENT;
+        INPUT_RECORD focusRecord{};
+        focusRecord.EventType = FOCUS_EVENT;
+        const INPUT_RECORD keyRecord = MakeKeyEvent(true, 1, L'a', 0, L'a', 0);
+
+        for (SHORT i = 1; i <= static_cast<SHORT>(RECORD_INSERT_COUNT); ++i)
+        {
+            sizeRecord.Event.WindowBufferSizeEvent.dwSize = { i, i };
+            focusRecord.Event.FocusEvent.bSetFocus = i % 2;
+            VERIFY_ARE_EQUAL(inputBuffer.Write(keyRecord), 1u);
+            VERIFY_ARE_EQUAL(inputBuffer.Write(sizeRecord), 1u);
+            VERIFY_ARE_EQUAL(inputBuffer.Write(focusRecord), 1u);
+        }
+
+        // the keys are all still there, and after them the last of each of
+        // the others, which hold the final state
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT + 2);
+        for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i], keyRecord);
+        }
+        const INPUT_RECORD& lastSize = inputBuffer._storage[RECORD_INSERT_COUNT];
+        VERIFY_ARE_EQUAL(lastSize.EventType, WINDOW_BUFFER_SIZE_EVENT);
+        VERIFY_ARE_EQUAL(lastSize.Event.WindowBufferSizeEvent.dwSize.X, static_cast<SHORT>(RECORD_INSERT_COUNT));
+        const INPUT_RECORD& lastFocus = inputBuffer._storage.back();
+        VERIFY_ARE_EQUAL(lastFocus.EventType, FOCUS_EVENT);
+        VERIFY_ARE_EQUAL(lastFocus.Event.FocusEvent.bSetFocus, static_cast<BOOL>(RECORD_INSERT_COUNT % 2));
+    }
+
+    TEST_METHOD(SlowReaderDoesNotPileUpObsoleteMouseMoves)
+    {
+        InputBuffer inputBuffer;
+
+        INPUT_RECORD mouseRecord{};
+        mouseRecord.EventType = MOUSE_EVENT;
+        mouseRecord.Event.MouseEvent.dwEventFlags = MOUSE_MOVED;
+
+        // a key between each move keeps them from being coalesced as they come in
+        const size_t moves = InputBuffer::s_CompactThreshold * 4;
+        for (size_t i = 0; i < moves; ++i)
+        {
+            const WCHAR ch = static_cast<WCHAR>(L'a' + i % 26);
+            VERIFY_ARE_EQUAL(inputBuffer.Write(MakeKeyEvent(true, 1, ch, 0, ch, 0)), 1u);
+            mouseRecord.Event.MouseEvent.dwMousePosition = { static_cast<SHORT>(i), static_cast<SHORT>(i) };
+            VERIFY_ARE_EQUAL(inputBuffer.Write(mouseRecord), 1u);
+        }
+
+        // all the keys are kept, but of the moves only a few since the last
+        // compaction, and the last one is where the mouse ended up
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(inputBuffer.GetNumberOfReadyEvents(), moves);
+        VERIFY_IS_LESS_THAN(inputBuffer.GetNumberOfReadyEvents(), moves * 2);
+        size_t keys = 0;
+        for (size_t i = 0; i < inputBuffer._storage.size(); ++i)
+        {
+            if (inputBuffer._storage[i].EventType == KEY_EVENT)
+            {
+                ++keys;
+            }
+        }
+        VERIFY_ARE_EQUAL(keys, moves);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.back(), mouseRecord);
+    }
+
+    TEST_METHOD(PastedTextIsWrittenAsTextWithBracketsWhenEnabled)
+    {
+        InputBuffer inputBuffer;
+        const std::wstring_view text{ L"ls\r" };
+
+        VERIFY_ARE_EQUAL(inputBuffer.WritePastedText(text), text.size());
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), text.size());
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i], MakeKeyEvent(true, 1, 0, 0, text[i], 0));
+        }
+        inputBuffer.Flush();
+
+        inputBuffer.GetTerminalInput().ChangeBracketedPasteMode(true);
+        std::wstring expected{ Microsoft::Console::VirtualTerminal::TerminalInput::s_BracketedPasteStart };
+        expected.append(text);
+        expected.append(Microsoft::Console::VirtualTerminal::TerminalInput::s_BracketedPasteEnd);
+
+        VERIFY_ARE_EQUAL(inputBuffer.WritePastedText(text), expected.size());
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i], MakeKeyEvent(true, 1, 0, 0, expected[i], 0));
+        }
+
+        // nothing pasted is nothing sent, not even the brackets
+        inputBuffer.Flush();
+        VERIFY_ARE_EQUAL(inputBuffer.WritePastedText({}), static_cast<size_t>(0));
+        VERIFY_IS_TRUE(inputBuffer._storage.empty());
+    }
 };
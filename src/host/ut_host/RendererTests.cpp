@@ -3,12 +3,15 @@
 
 #include "precomp.h"
 #include "WexTestClass.h"
+#include "..\..\inc\consoletaeftemplates.hpp"
 
 #include "CommonState.hpp"
 
 #include "..\..\host\renderData.hpp"
 #include "..\..\renderer\base\renderer.hpp"
 
+#include <sstream>
+
 using namespace WEX::Logging;
 using namespace WEX::TestExecution;
 
@@ -68,4 +71,54 @@ class RendererTests
     {
         m_renderer->TriggerTitleChange();
     }
+
+    TEST_METHOD(CapturedFramesRoundTrip);
 };
+
+void RendererTests::CapturedFramesRoundTrip()
+{
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    auto& buffer = gci.GetActiveOutputBuffer().GetTextBuffer();
+    const auto viewport = gci.GetActiveOutputBuffer().GetViewport();
+    const TextAttribute blue{ FOREGROUND_BLUE | COMMON_LVB_UNDERSCORE };
+    buffer.Write(OutputCellIterator(L"hello", blue), { viewport.Left(), viewport.Top() });
+
+    const std::vector<SMALL_RECT> dirty{ { 0, 0, 4, 0 } };
+    m_renderData->LockConsole();
+    const auto captured = CapturedFrame::s_Capture(*m_renderData, dirty);
+    m_renderData->UnlockConsole();
+
+    Log::Comment(L"The frame is the viewport's rows, all of its cells, and the colors they came out as.");
+    VERIFY_ARE_EQUAL(static_cast<size_t>(viewport.Height()), captured.rows.size());
+    VERIFY_ARE_EQUAL(static_cast<size_t>(viewport.Width()), captured.rows.front().cells.size());
+    const auto& first = captured.rows.front().cells.front();
+    VERIFY_ARE_EQUAL(std::wstring{ L"h" }, first.text);
+    const auto& attribute = captured.attributes.at(first.attribute);
+    VERIFY_ARE_EQUAL(gci.LookupForegroundColor(blue), attribute.foreground);
+    VERIFY_ARE_EQUAL(static_cast<WORD>(COMMON_LVB_UNDERSCORE), attribute.meta);
+
+    Log::Comment(L"Two frames written one after the other read back as they were.");
+    std::stringstream stream;
+    captured.Write(stream);
+    captured.Write(stream);
+    const auto frames = CapturedFrame::s_ReadAll(stream);
+    VERIFY_ARE_EQUAL(2u, frames.size());
+    for (const auto& frame : frames)
+    {
+        VERIFY_ARE_EQUAL(captured.viewport, frame.viewport);
+        VERIFY_ARE_EQUAL(captured.dirty.size(), frame.dirty.size());
+        VERIFY_ARE_EQUAL(captured.dirty.front(), frame.dirty.front());
+        VERIFY_ARE_EQUAL(captured.attributes.size(), frame.attributes.size());
+        VERIFY_ARE_EQUAL(captured.rows.size(), frame.rows.size());
+        VERIFY_ARE_EQUAL(first.text, frame.rows.front().cells.front().text);
+        VERIFY_ARE_EQUAL(first.attribute, frame.rows.front().cells.front().attribute);
+        VERIFY_ARE_EQUAL(captured.cursor.position, frame.cursor.position);
+        VERIFY_ARE_EQUAL(captured.font.faceName, frame.font.faceName);
+        VERIFY_ARE_EQUAL(captured.title, frame.title);
+    }
+
+    Log::Comment(L"A frame that's been cut short can't be read.");
+    const auto bytes = stream.str();
+    std::stringstream truncated{ bytes.substr(0, bytes.size() - 3) };
+    VERIFY_THROWS(CapturedFrame::s_ReadAll(truncated), wil::ResultException);
+}
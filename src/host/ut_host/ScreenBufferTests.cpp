@@ -158,6 +158,9 @@ class ScreenBufferTests
     TEST_METHOD(ScrollUpInMargins);
     TEST_METHOD(ScrollDownInMargins);
 
+    TEST_METHOD(WriteCharsLegacyPlainTextWraps);
+    TEST_METHOD(DoWriteConsoleWritesAllSlices);
+
 };
 
 void ScreenBufferTests::SingleAlternateBufferCreationTest()
@@ -3015,3 +3018,69 @@ void ScreenBufferTests::ScrollDownInMargins()
         VERIFY_ARE_EQUAL(L"B" , iter5->Chars());
     }
 }
+
+void ScreenBufferTests::WriteCharsLegacyPlainTextWraps()
+{
+    // Plain text is written a row at a time, straight from the string. Make
+    // sure that a run longer than both the row and LOCAL_BUFFER_SIZE still
+    // wraps onto the next row, and that what follows it is still processed.
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    SCREEN_INFORMATION& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+    const TextBuffer& tbi = si.GetTextBuffer();
+    Cursor& cursor = si.GetTextBuffer().GetCursor();
+
+    VERIFY_SUCCEEDED(si.SetViewportOrigin(true, COORD({0, 0}), true));
+    cursor.SetPosition({0, 0});
+
+    const size_t width = gsl::narrow<size_t>(si.GetBufferSize().Width());
+    std::wstring text;
+    for (size_t i = 0; i < width + LOCAL_BUFFER_SIZE + 5; i++)
+    {
+        text.push_back(static_cast<wchar_t>(L'a' + (i % 26)));
+    }
+    std::wstring str = text + L"\r\nZ";
+
+    size_t seqCb = str.size() * sizeof(wchar_t);
+    VERIFY_SUCCESS_NTSTATUS(WriteCharsLegacy(si, str.data(), str.data(), str.data(), &seqCb, nullptr, cursor.GetPosition().X, 0, nullptr));
+    VERIFY_ARE_EQUAL(str.size() * sizeof(wchar_t), seqCb);
+
+    const size_t rows = (text.size() + width - 1) / width;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        const COORD at{ gsl::narrow<SHORT>(i % width), gsl::narrow<SHORT>(i / width) };
+        VERIFY_ARE_EQUAL(std::wstring_view(&text[i], 1), tbi.GetCellDataAt(at)->Chars());
+    }
+    VERIFY_ARE_EQUAL(L"Z", tbi.GetCellDataAt({ 0, gsl::narrow<SHORT>(rows) })->Chars());
+
+    const COORD expectedCursor{ 1, gsl::narrow<SHORT>(rows) };
+    VERIFY_ARE_EQUAL(expectedCursor, cursor.GetPosition());
+}
+
+void ScreenBufferTests::DoWriteConsoleWritesAllSlices()
+{
+    // A long write is written WRITE_SLICE_SIZE characters at a time. All of
+    // it should still be written, without a surrogate pair on the edge of a
+    // slice being split in two.
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    SCREEN_INFORMATION& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+    const TextBuffer& tbi = si.GetTextBuffer();
+    Cursor& cursor = si.GetTextBuffer().GetCursor();
+
+    VERIFY_SUCCEEDED(si.SetViewportOrigin(true, COORD({0, 0}), true));
+    cursor.SetPosition({0, 0});
+
+    std::wstring str(WRITE_SLICE_SIZE - 1, L'x');
+    str.append(L"\xD83D\xDE00");
+    str.append(L"y");
+
+    std::unique_ptr<WriteData> waiter;
+    size_t seqCb = str.size() * sizeof(wchar_t);
+    VERIFY_SUCCEEDED(DoWriteConsole(str.data(), &seqCb, si, waiter));
+    VERIFY_ARE_EQUAL(str.size() * sizeof(wchar_t), seqCb);
+    VERIFY_IS_NULL(waiter.get());
+
+    const size_t width = gsl::narrow<size_t>(si.GetBufferSize().Width());
+    const COORD pairAt{ gsl::narrow<SHORT>((WRITE_SLICE_SIZE - 1) % width), gsl::narrow<SHORT>((WRITE_SLICE_SIZE - 1) / width) };
+    VERIFY_ARE_EQUAL(L"x", tbi.GetCellDataAt({ 0, 0 })->Chars());
+    VERIFY_ARE_EQUAL(L"\xD83D\xDE00", tbi.GetCellDataAt(pairAt)->Chars());
+}
@@ -163,4 +163,92 @@ class SearchTests
         Search s(outputBuffer, L"\x304b", Search::Direction::Backward, Search::Sensitivity::CaseInsensitive);
         DoFoundChecks(s, coordStartExpected, -1);
     }
+
+    TEST_METHOD(ForwardAcrossRowsAndAroundTheBuffer)
+    {
+        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        const auto& outputBuffer = gci.GetActiveOutputBuffer();
+        const auto bufferSize = outputBuffer.GetBufferSize().Dimensions();
+
+        // Each filled row ends in spaces and the next one starts with AB. So
+        // does the top of the buffer, after the empty row at the bottom.
+        const std::array<SHORT, 4> rowsExpected{ 0, 1, 2, gsl::narrow<SHORT>(bufferSize.Y - 1) };
+
+        Search s(outputBuffer, L"  ab", Search::Direction::Forward, Search::Sensitivity::CaseInsensitive);
+        for (const auto row : rowsExpected)
+        {
+            COORD coordStartExpected;
+            coordStartExpected.X = gsl::narrow_cast<SHORT>(bufferSize.X - 2);
+            coordStartExpected.Y = row;
+
+            COORD coordEndExpected;
+            coordEndExpected.X = 1;
+            coordEndExpected.Y = gsl::narrow_cast<SHORT>((row + 1) % bufferSize.Y);
+
+            VERIFY_IS_TRUE(s.FindNext());
+            VERIFY_ARE_EQUAL(coordStartExpected, s._coordSelStart);
+            VERIFY_ARE_EQUAL(coordEndExpected, s._coordSelEnd);
+        }
+
+        VERIFY_IS_FALSE(s.FindNext());
+    }
+
+    TEST_METHOD(RegexForwardToEndOfLine)
+    {
+        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        const auto& outputBuffer = gci.GetActiveOutputBuffer();
+
+        // The blanks after DE aren't part of the line, so it ends right there.
+        Search s(outputBuffer, L"C.+E$", Search::Direction::Forward, Search::Sensitivity::CaseSensitive, Search::Syntax::RegularExpression);
+        for (SHORT row = 0; row < 4; row++)
+        {
+            const COORD coordStartExpected{ 4, row };
+            const COORD coordEndExpected{ 8, row };
+
+            VERIFY_IS_TRUE(s.FindNext());
+            VERIFY_ARE_EQUAL(coordStartExpected, s._coordSelStart);
+            VERIFY_ARE_EQUAL(coordEndExpected, s._coordSelEnd);
+        }
+
+        VERIFY_IS_FALSE(s.FindNext());
+    }
+
+    TEST_METHOD(RegexBackwardAcrossWrappedRows)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        auto& outputBuffer = gci.GetActiveOutputBuffer();
+        outputBuffer.GetTextBuffer().GetRowByOffset(1).GetCharRow().SetWrapForced(true);
+
+        // Only the second row runs on into the third, so only it matches.
+        Search s(outputBuffer, L"de +ab", Search::Direction::Backward, Search::Sensitivity::CaseInsensitive, Search::Syntax::RegularExpression);
+
+        const COORD coordStartExpected{ 7, 1 };
+        const COORD coordEndExpected{ 1, 2 };
+        VERIFY_IS_TRUE(s.FindNext());
+        VERIFY_ARE_EQUAL(coordStartExpected, s._coordSelStart);
+        VERIFY_ARE_EQUAL(coordEndExpected, s._coordSelEnd);
+
+        VERIFY_IS_FALSE(s.FindNext());
+    }
+
+    TEST_METHOD(RegexInvalidPatternThrows)
+    {
+        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        const auto& outputBuffer = gci.GetActiveOutputBuffer();
+
+        VERIFY_THROWS_SPECIFIC(Search(outputBuffer, L"(AB", Search::Direction::Forward, Search::Sensitivity::CaseSensitive, Search::Syntax::RegularExpression),
+                               wil::ResultException,
+                               [](wil::ResultException& e) { return e.GetErrorCode() == E_INVALIDARG; });
+    }
+
+    TEST_METHOD(RegexLiteralPrefix)
+    {
+        VERIFY_ARE_EQUAL(std::wstring{ L"abc" }, TextBufferRegex::s_GetLiteralPrefix(L"abc"));
+        VERIFY_ARE_EQUAL(std::wstring{ L"ab" }, TextBufferRegex::s_GetLiteralPrefix(L"^ab+c"));
+        VERIFY_ARE_EQUAL(std::wstring{ L"a" }, TextBufferRegex::s_GetLiteralPrefix(L"ab?c"));
+        VERIFY_ARE_EQUAL(std::wstring{ L"a.b" }, TextBufferRegex::s_GetLiteralPrefix(L"a\\.b\\d"));
+        VERIFY_ARE_EQUAL(std::wstring{ L"x" }, TextBufferRegex::s_GetLiteralPrefix(L"x(a|b)"));
+        VERIFY_ARE_EQUAL(std::wstring{ L"" }, TextBufferRegex::s_GetLiteralPrefix(L"ab|cd"));
+        VERIFY_ARE_EQUAL(std::wstring{ L"" }, TextBufferRegex::s_GetLiteralPrefix(L"[ab]c"));
+    }
 };
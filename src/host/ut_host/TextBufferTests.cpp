@@ -10,6 +10,7 @@
 #include "globals.h"
 #include "../buffer/out/textBuffer.hpp"
 #include "../buffer/out/CharRow.hpp"
+#include "../buffer/out/TextBufferExport.hpp"
 
 #include "input.h"
 #include "_stream.h"
@@ -17,6 +18,8 @@
 #include "../interactivity/inc/ServiceLocator.hpp"
 #include "../renderer/inc/DummyRenderTarget.hpp"
 
+#include <chrono>
+
 using namespace Microsoft::Console::Types;
 using namespace WEX::Common;
 using namespace WEX::Logging;
@@ -136,12 +139,41 @@ class TextBufferTests
 
     TEST_METHOD(ResizeTraditionalRotationPreservesHighUnicode);
     TEST_METHOD(ScrollBufferRotationPreservesHighUnicode);
+    TEST_METHOD(ScrollRowsInCircledBuffer);
 
     TEST_METHOD(ResizeTraditionalHighUnicodeRowRemoval);
     TEST_METHOD(ResizeTraditionalHighUnicodeColumnRemoval);
 
     TEST_METHOD(TestBurrito);
 
+    TEST_METHOD(RowsShareContiguousCellArena);
+    TEST_METHOD(ColdRowsArePackedAndThawOnDemand);
+    TEST_METHOD(EvictedRowsSpillToDisk);
+    TEST_METHOD(ExportWritesSpilledRowsFirst);
+    TEST_METHOD(SpilledRowsCanBeSelectedAndShown);
+    TEST_METHOD(WriteLineBatchesAttributeRuns);
+    TEST_METHOD(WriteNarrowLineWritesPlainText);
+    TEST_METHOD(HighUnicodeStaysWithItsRow);
+    TEST_METHOD(ReflowRewrapsRunsAndKeepsCursor);
+    TEST_METHOD(RowGenerationsTrackChanges);
+    TEST_METHOD(SnapshotsShareCellsUntilWritten);
+    TEST_METHOD(FrozenRowsFreeTheirSlotOnceSnapshotsAreGone);
+    TEST_METHOD(RefreshSnapshotCopiesChangedRows);
+    TEST_METHOD(NarrowOnlyRowsTrackWrites);
+    TEST_METHOD(GetSelectedTextMatchesClipboardText);
+    TEST_METHOD(SpanFillsAndReadsCrossRows);
+
+    TEST_METHOD(ClearOldestRowsReleasesMemory);
+    TEST_METHOD(MeasureMemorySplitsUsage);
+
+    TEST_METHOD(SerializeRoundTripsContents);
+    TEST_METHOD(SerializeLargeBufferQuickly);
+
+    TEST_METHOD(PaletteIsCompactedWhenAWriteOverflowsIt);
+    TEST_METHOD(HyperlinksAreInternedAndCollected);
+
+    TEST_METHOD(LogicalLinesFollowWrapping);
+
 };
 
 void TextBufferTests::TestBufferCreate()
@@ -1874,6 +1906,64 @@ void TextBufferTests::ScrollBufferRotationPreservesHighUnicode()
     VERIFY_ARE_EQUAL(String(fire), String(shouldBeFireText.data(), gsl::narrow<int>(shouldBeFireText.size())));
 }
 
+// This tests that rows are scrolled correctly after the buffer has circled, both when the
+// scrolled rows are in order within the storage and when they wrap around the end of it.
+void TextBufferTests::ScrollRowsInCircledBuffer()
+{
+    const COORD bufferSize{ 80, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    for (auto i = 0; i < 3; i++)
+    {
+        VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+    }
+    VERIFY_ARE_EQUAL(3, _buffer->GetFirstRowIndex());
+
+    // Mark every row with its offset.
+    const auto mark = [&](const SHORT row) {
+        const auto text = *_buffer->GetTextDataAt({ 0, row });
+        return text.empty() ? L'\0' : text.front();
+    };
+    for (SHORT i = 0; i < bufferSize.Y; i++)
+    {
+        _buffer->GetRowByOffset(i).GetCharRow().GlyphAt(0) = std::wstring(1, static_cast<wchar_t>(L'0' + i));
+    }
+
+    Log::Comment(L"Scrolling rows that are in order within the storage leaves the first row where it is.");
+    _buffer->ScrollRows(2, 3, -2);
+    VERIFY_ARE_EQUAL(3, _buffer->GetFirstRowIndex());
+    const std::wstring upExpected = L"2340156789";
+    for (SHORT i = 0; i < bufferSize.Y; i++)
+    {
+        VERIFY_ARE_EQUAL(upExpected.at(i), mark(i));
+    }
+
+    Log::Comment(L"Scrolling rows that wrap around the end of the storage still moves them.");
+    _buffer->ScrollRows(5, 2, 2);
+    const std::wstring downExpected = L"2340178569";
+    for (SHORT i = 0; i < bufferSize.Y; i++)
+    {
+        VERIFY_ARE_EQUAL(downExpected.at(i), mark(i));
+    }
+
+    Log::Comment(L"Every row still knows where it is in the storage.");
+    for (size_t i = 0; i < _buffer->_storage.size(); i++)
+    {
+        VERIFY_ARE_EQUAL(gsl::narrow<SHORT>(i), _buffer->_storage.at(i).GetId());
+    }
+
+    Log::Comment(L"Clearing rows blanks them out in the given attributes.");
+    const TextAttribute fill{ 0x1e };
+    _buffer->ClearRows(5, 2, fill);
+    VERIFY_ARE_EQUAL(L'0', mark(4));
+    VERIFY_ARE_EQUAL(L' ', mark(5));
+    VERIFY_ARE_EQUAL(L' ', mark(6));
+    VERIFY_ARE_EQUAL(L'5', mark(7));
+    VERIFY_ARE_EQUAL(fill, _buffer->GetRowByOffset(5).GetAttrRow().GetAttrByColumn(79));
+}
+
 // This tests that rows removed from the buffer while resizing traditionally will also drop the high unicode
 // characters from the Unicode Storage buffer
 void TextBufferTests::ResizeTraditionalHighUnicodeRowRemoval()
@@ -1899,14 +1989,17 @@ void TextBufferTests::ResizeTraditionalHighUnicodeRowRemoval()
     const auto readBackText = *readBack;
     VERIFY_ARE_EQUAL(String(emoji), String(readBackText.data(), gsl::narrow<int>(readBackText.size())));
 
-    VERIFY_ARE_EQUAL(1u, _buffer->GetUnicodeStorage()._map.size(), L"There should be one item in the map.");
+    VERIFY_ARE_EQUAL(1u, _buffer->_storage[pos.Y].GetUnicodeStorage().size(), L"There should be one item in the row's storage.");
 
     // Perform resize to trim off the row of the buffer that included the emoji
     COORD trimmedBufferSize{ bufferSize.X, bufferSize.Y - 1 };
 
     VERIFY_NT_SUCCESS(_buffer->ResizeTraditional(trimmedBufferSize));
 
-    VERIFY_IS_TRUE(_buffer->GetUnicodeStorage()._map.empty(), L"The map should now be empty.");
+    for (const auto& row : _buffer->_storage)
+    {
+        VERIFY_IS_TRUE(row.GetUnicodeStorage().empty(), L"No remaining row should hold any stored glyphs.");
+    }
 }
 
 // This tests that columns removed from the buffer while resizing traditionally will also drop the high unicode
@@ -1934,14 +2027,14 @@ void TextBufferTests::ResizeTraditionalHighUnicodeColumnRemoval()
     const auto readBackText = *readBack;
     VERIFY_ARE_EQUAL(String(emoji), String(readBackText.data(), gsl::narrow<int>(readBackText.size())));
 
-    VERIFY_ARE_EQUAL(1u, _buffer->GetUnicodeStorage()._map.size(), L"There should be one item in the map.");
+    VERIFY_ARE_EQUAL(1u, _buffer->_storage[pos.Y].GetUnicodeStorage().size(), L"There should be one item in the row's storage.");
 
     // Perform resize to trim off the column of the buffer that included the emoji
     COORD trimmedBufferSize{ bufferSize.X - 1, bufferSize.Y};
 
     VERIFY_NT_SUCCESS(_buffer->ResizeTraditional(trimmedBufferSize));
 
-    VERIFY_IS_TRUE(_buffer->GetUnicodeStorage()._map.empty(), L"The map should now be empty.");
+    VERIFY_IS_TRUE(_buffer->_storage[pos.Y].GetUnicodeStorage().empty(), L"The row's storage should now be empty.");
 }
 
 void TextBufferTests::TestBurrito()
@@ -1964,3 +2057,992 @@ void TextBufferTests::TestBurrito()
     _buffer->IncrementCursor();
     VERIFY_IS_FALSE(afterBurritoIter);
 }
+
+void TextBufferTests::RowsShareContiguousCellArena()
+{
+    const COORD bufferSize{ 20, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    Log::Comment(L"Every row should be a view over its own slice of the one cell arena.");
+    VERIFY_ARE_EQUAL(static_cast<size_t>(bufferSize.X * bufferSize.Y), _buffer->_cellArena->size());
+    for (size_t i = 0; i < _buffer->_storage.size(); ++i)
+    {
+        VERIFY_ARE_EQUAL(_buffer->_cellArena->data() + (i * bufferSize.X), _buffer->_storage[i].GetCharRow().cbegin());
+    }
+
+    const auto stuff = L'Q';
+    _buffer->GetRowByOffset(3).GetCharRow().GlyphAt(5) = { &stuff, 1 };
+
+    Log::Comment(L"Circling the buffer should only move the first row index.");
+    const auto arenaBefore = _buffer->_cellArena->data();
+    VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+    VERIFY_ARE_EQUAL(arenaBefore, _buffer->_cellArena->data());
+    VERIFY_ARE_EQUAL(stuff, static_cast<std::wstring_view>(_buffer->GetRowByOffset(2).GetCharRow().GlyphAt(5)).front());
+
+    Log::Comment(L"Resizing moves the rows onto a new arena and preserves their text.");
+    const COORD newSize{ 30, 8 };
+    VERIFY_SUCCEEDED(_buffer->ResizeTraditional(newSize));
+    VERIFY_ARE_EQUAL(static_cast<size_t>(newSize.X * newSize.Y), _buffer->_cellArena->size());
+    for (size_t i = 0; i < _buffer->_storage.size(); ++i)
+    {
+        VERIFY_ARE_EQUAL(_buffer->_cellArena->data() + (i * newSize.X), _buffer->_storage[i].GetCharRow().cbegin());
+        VERIFY_ARE_EQUAL(static_cast<size_t>(newSize.X), _buffer->_storage[i].size());
+    }
+    VERIFY_ARE_EQUAL(stuff, static_cast<std::wstring_view>(_buffer->GetRowByOffset(2).GetCharRow().GlyphAt(5)).front());
+}
+
+void TextBufferTests::ColdRowsArePackedAndThawOnDemand()
+{
+    const COORD bufferSize{ 20, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    const auto stuff = L'Z';
+    _buffer->GetRowByOffset(1).GetCharRow().GlyphAt(4) = { &stuff, 1 };
+
+    Log::Comment(L"Only the bottom three rows should stay in the arena.");
+    _buffer->SetHotRowCount(3);
+    VERIFY_ARE_EQUAL(static_cast<size_t>(bufferSize.X * 3), _buffer->_cellArena->size());
+    for (size_t i = 0; i < _buffer->_storage.size(); ++i)
+    {
+        VERIFY_ARE_EQUAL(i < 7, _buffer->_storage[i].IsPacked());
+    }
+
+    Log::Comment(L"Reading a cold row decodes it into scratch and leaves it packed.");
+    std::optional<ROW> scratch;
+    const auto& decoded = std::as_const(*_buffer).GetRowByOffset(1, scratch);
+    VERIFY_IS_TRUE(scratch.has_value());
+    VERIFY_ARE_EQUAL(&scratch.value(), &decoded);
+    VERIFY_ARE_EQUAL(stuff, static_cast<std::wstring_view>(decoded.GetCharRow().GlyphAt(4)).front());
+    VERIFY_IS_TRUE(_buffer->_storage[1].IsPacked());
+    VERIFY_ARE_EQUAL(&_buffer->_storage[8], &std::as_const(*_buffer).GetRowByOffset(8, scratch));
+
+    Log::Comment(L"Touching a cold row brings its text back.");
+    const auto& row = _buffer->GetRowByOffset(1);
+    VERIFY_IS_FALSE(row.IsPacked());
+    VERIFY_ARE_EQUAL(static_cast<size_t>(bufferSize.X), row.size());
+    VERIFY_ARE_EQUAL(stuff, static_cast<std::wstring_view>(row.GetCharRow().GlyphAt(4)).front());
+    VERIFY_ARE_EQUAL(5u, row.GetCharRow().MeasureRight());
+
+    Log::Comment(L"Circling packs the touched row again and keeps the arena the same size.");
+    VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+    VERIFY_IS_TRUE(_buffer->_storage[1].IsPacked());
+    VERIFY_IS_TRUE(_buffer->_storage[6].IsPacked());
+    VERIFY_IS_FALSE(_buffer->GetRowByOffset(_buffer->TotalRowCount() - 1).IsPacked());
+    VERIFY_ARE_EQUAL(static_cast<size_t>(bufferSize.X * 3), _buffer->_cellArena->size());
+    VERIFY_ARE_EQUAL(stuff, static_cast<std::wstring_view>(_buffer->GetRowByOffset(0).GetCharRow().GlyphAt(4)).front());
+}
+
+void TextBufferTests::EvictedRowsSpillToDisk()
+{
+    const COORD bufferSize{ 20, 4 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+    _buffer->SetScrollbackSpill(ScrollbackSpill::CreateInTempDirectory());
+
+    Log::Comment(L"Write a numbered line into the top row and circle it off, many times over.");
+    const size_t rowsToSpill = 200;
+    for (size_t i = 0; i < rowsToSpill; ++i)
+    {
+        const auto text = std::to_wstring(i);
+        _buffer->WriteLine(OutputCellIterator{ text, TextAttribute{ static_cast<WORD>(i % 16) } }, { 0, 0 });
+        _buffer->GetRowByOffset(0).GetCharRow().SetWrapForced(i % 2 == 0);
+        VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+    }
+
+    auto& spill = *_buffer->GetScrollbackSpill();
+    VERIFY_ARE_EQUAL(rowsToSpill, spill.size());
+
+    Log::Comment(L"Read them back out of order.");
+    for (size_t i : { 199u, 0u, 64u, 63u, 128u, 1u })
+    {
+        const auto row = spill.ReadRow(i);
+        const auto expected = std::to_wstring(i);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(bufferSize.X), row.width);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(bufferSize.X), row.text.size());
+        VERIFY_ARE_EQUAL(String(expected.c_str()), String(row.text.substr(0, expected.size()).c_str()));
+        VERIFY_ARE_EQUAL(i % 2 == 0, row.wrapForced);
+        VERIFY_ARE_EQUAL(static_cast<WORD>(i % 16), row.attributes.front().GetAttributes().GetLegacyAttributes());
+    }
+}
+
+void TextBufferTests::ExportWritesSpilledRowsFirst()
+{
+    const COORD bufferSize{ 20, 4 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x07 };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+    _buffer->SetScrollbackSpill(ScrollbackSpill::CreateInTempDirectory());
+
+    const size_t rowsToSpill = 300;
+    std::string expected;
+    for (size_t i = 0; i < rowsToSpill; ++i)
+    {
+        const auto text = std::to_wstring(i);
+        _buffer->WriteLine(OutputCellIterator{ text, attr }, { 0, 0 });
+        VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+        expected.append(std::to_string(i)).append("\r\n");
+    }
+    _buffer->WriteLine(OutputCellIterator{ L"last   ", attr }, { 0, 0 });
+    expected.append("last\r\n");
+
+    wchar_t tempPath[MAX_PATH + 1];
+    VERIFY_ARE_NOT_EQUAL(0u, GetTempPathW(ARRAYSIZE(tempPath), tempPath));
+    wchar_t tempFile[MAX_PATH + 1];
+    VERIFY_ARE_NOT_EQUAL(0u, GetTempFileNameW(tempPath, L"cnh", 0, tempFile));
+    auto deleteFile = wil::scope_exit([&]() { DeleteFileW(tempFile); });
+
+    Log::Comment(L"Export as plain text, in more than one batch of spilled rows, and wait for it.");
+    {
+        ResolvedColorTable colors;
+        TextBufferExport exporter{ *_buffer, colors, tempFile, TextBufferExport::Format::PlainText };
+
+        Log::Comment(L"The buffer can be written to while the export is going.");
+        _buffer->WriteLine(OutputCellIterator{ L"changed", attr }, { 0, 0 });
+
+        VERIFY_SUCCEEDED(exporter.Wait());
+        VERIFY_IS_TRUE(exporter.IsDone());
+        VERIFY_ARE_EQUAL(rowsToSpill + 1, exporter.GetRowCount());
+        VERIFY_ARE_EQUAL(exporter.GetRowCount(), exporter.GetRowsWritten());
+    }
+
+    wil::unique_hfile file{ CreateFileW(tempFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    VERIFY_IS_TRUE(file.is_valid());
+    std::string actual(expected.size() + 1, '\0');
+    DWORD read = 0;
+    VERIFY_WIN32_BOOL_SUCCEEDED(ReadFile(file.get(), actual.data(), gsl::narrow<DWORD>(actual.size()), &read, nullptr));
+    actual.resize(read);
+    VERIFY_ARE_EQUAL(String(expected.c_str()), String(actual.c_str()));
+}
+
+void TextBufferTests::WriteLineBatchesAttributeRuns()
+{
+    const COORD bufferSize{ 20, 4 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x07 };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    const TextAttribute red{ FOREGROUND_RED };
+    const TextAttribute blue{ FOREGROUND_BLUE };
+    const std::vector<OutputCell> cells{
+        OutputCell{ L"a", {}, red },
+        OutputCell{ L"b", {}, red },
+        OutputCell{ L"c", {}, blue },
+        OutputCell{ L"\xD83C\xDF2F", {}, blue } // burrito
+    };
+
+    const auto it = _buffer->WriteLine(OutputCellIterator{ { cells.data(), cells.size() } }, { 2, 1 });
+    VERIFY_IS_FALSE(it);
+
+    const auto& row = _buffer->GetRowByOffset(1);
+    VERIFY_ARE_EQUAL(String(L"  abc\xD83C\xDF2F"), String(row.GetText().substr(0, 6).c_str()));
+
+    Log::Comment(L"Four written cells should make exactly two new runs in the middle of the row.");
+    const auto& attrRow = row.GetAttrRow();
+    VERIFY_ARE_EQUAL(4u, attrRow.GetNumberOfRuns());
+
+    size_t applies = 0;
+    VERIFY_ARE_EQUAL(attr, attrRow.GetAttrByColumn(0, &applies));
+    VERIFY_ARE_EQUAL(2u, applies);
+    VERIFY_ARE_EQUAL(red, attrRow.GetAttrByColumn(2, &applies));
+    VERIFY_ARE_EQUAL(2u, applies);
+    VERIFY_ARE_EQUAL(blue, attrRow.GetAttrByColumn(4, &applies));
+    VERIFY_ARE_EQUAL(2u, applies);
+    VERIFY_ARE_EQUAL(attr, attrRow.GetAttrByColumn(6, &applies));
+    VERIFY_ARE_EQUAL(14u, applies);
+}
+
+void TextBufferTests::WriteNarrowLineWritesPlainText()
+{
+    const COORD bufferSize{ 10, 2 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x07 };
+    const TextAttribute red{ FOREGROUND_RED };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, _renderTarget };
+
+    Log::Comment(L"Only printable ASCII is narrow whatever the font.");
+    VERIFY_IS_TRUE(TextBuffer::IsNarrowText(L"cat build.log"));
+    VERIFY_IS_FALSE(TextBuffer::IsNarrowText(L"tab\there"));
+    VERIFY_IS_FALSE(TextBuffer::IsNarrowText(L"caf\x00E9"));
+    VERIFY_IS_FALSE(TextBuffer::IsNarrowText(L"\x6F22"));
+    VERIFY_ARE_EQUAL(3u, TextBuffer::NarrowTextLength(L"tab\there"));
+    VERIFY_ARE_EQUAL(0u, TextBuffer::NarrowTextLength(L"\x007F"));
+
+    Log::Comment(L"A long glyph that's written over is let go of.");
+    buffer.Write(OutputCellIterator(L"\xD83C\xDF2E"), { 3, 0 });
+    VERIFY_ARE_EQUAL(1u, std::as_const(buffer).GetRowByOffset(0).GetUnicodeStorage().size());
+
+    Log::Comment(L"The text goes in as one run, up to the end of the row, which is marked as wrapped.");
+    VERIFY_ARE_EQUAL(8u, buffer.WriteNarrowLine(L"abcdefghij", red, { 2, 0 }, true));
+    const auto& row = std::as_const(buffer).GetRowByOffset(0);
+    VERIFY_ARE_EQUAL(String(L"  abcdefgh"), String(row.GetText().c_str()));
+    VERIFY_IS_TRUE(row.GetCharRow().WasWrapForced());
+    VERIFY_IS_TRUE(row.GetCharRow().IsNarrowOnly());
+    VERIFY_ARE_EQUAL(0u, row.GetUnicodeStorage().size());
+    VERIFY_ARE_EQUAL(2u, row.GetAttrRow().GetNumberOfRuns());
+    size_t applies = 0;
+    VERIFY_ARE_EQUAL(red, row.GetAttrRow().GetAttrByColumn(2, &applies));
+    VERIFY_ARE_EQUAL(8u, applies);
+
+    Log::Comment(L"It reads back the same as text written the usual way.");
+    buffer.Write(OutputCellIterator(L"abcdefgh", red), { 2, 1 });
+    VERIFY_ARE_EQUAL(std::as_const(buffer).GetRowByOffset(1).GetText(), row.GetText());
+    for (size_t column = 0; column < 10; ++column)
+    {
+        VERIFY_ARE_EQUAL(std::as_const(buffer).GetRowByOffset(1).GetAttrRow().GetAttrByColumn(column),
+                         row.GetAttrRow().GetAttrByColumn(column));
+    }
+
+    Log::Comment(L"Nothing's written outside of the buffer.");
+    VERIFY_ARE_EQUAL(0u, buffer.WriteNarrowLine(L"x", red, { 0, 2 }));
+}
+
+// This tests that high unicode items are held by the row they were written into,
+// survive that row going cold, and are dropped when the row is recycled.
+void TextBufferTests::HighUnicodeStaysWithItsRow()
+{
+    const COORD bufferSize{ 20, 6 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    // This is the taco emoji: 🌮
+    const auto taco = L"\xD83C\xDF2E";
+    const COORD pos{ 3, 0 };
+    _buffer->GetRowByOffset(pos.Y).GetCharRow().GlyphAt(pos.X) = taco;
+
+    for (SHORT i = 1; i < bufferSize.Y; ++i)
+    {
+        VERIFY_IS_TRUE(_buffer->GetRowByOffset(i).GetUnicodeStorage().empty());
+    }
+    VERIFY_ARE_EQUAL(1u, _buffer->GetRowByOffset(pos.Y).GetUnicodeStorage().size());
+
+    Log::Comment(L"Let the row go cold. Its glyph should come back when it is read.");
+    _buffer->SetHotRowCount(2);
+    VERIFY_IS_TRUE(_buffer->_storage[pos.Y].IsPacked());
+    const auto textIt = _buffer->GetTextDataAt(pos);
+    const auto thawedText = *textIt;
+    VERIFY_IS_TRUE(_buffer->_storage[pos.Y].IsPacked());
+    VERIFY_ARE_EQUAL(String(taco), String(thawedText.data(), gsl::narrow<int>(thawedText.size())));
+
+    Log::Comment(L"Circle the buffer so the row is recycled as the new bottom row.");
+    VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+    const auto& recycled = _buffer->GetRowByOffset(bufferSize.Y - 1);
+    VERIFY_IS_TRUE(recycled.GetUnicodeStorage().empty());
+    VERIFY_IS_FALSE(recycled.GetCharRow().DbcsAttrAt(pos.X).IsGlyphStored());
+}
+
+void TextBufferTests::ReflowRewrapsRunsAndKeepsCursor()
+{
+    const COORD oldSize{ 10, 5 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    const TextAttribute red{ FOREGROUND_RED };
+    TextBuffer oldBuffer{ oldSize, attr, cursorSize, _renderTarget };
+
+    // This is the taco emoji: 🌮
+    const std::wstring_view taco{ L"\xD83C\xDF2E" };
+    DbcsAttribute leading{ DbcsAttribute::Attribute::Leading };
+    leading.SetGlyphStored(true);
+    DbcsAttribute trailing{ DbcsAttribute::Attribute::Trailing };
+    trailing.SetGlyphStored(true);
+
+    Log::Comment(L"Write one line that wraps in the old buffer: abcd, a taco, efgh then a red ij.");
+    for (const auto wch : std::wstring_view{ L"abcd" })
+    {
+        VERIFY_IS_TRUE(oldBuffer.InsertCharacter(wch, {}, attr));
+    }
+    VERIFY_IS_TRUE(oldBuffer.InsertCharacter(taco, leading, attr));
+    VERIFY_IS_TRUE(oldBuffer.InsertCharacter(taco, trailing, attr));
+    for (const auto wch : std::wstring_view{ L"efgh" })
+    {
+        VERIFY_IS_TRUE(oldBuffer.InsertCharacter(wch, {}, attr));
+    }
+    for (const auto wch : std::wstring_view{ L"ij" })
+    {
+        VERIFY_IS_TRUE(oldBuffer.InsertCharacter(wch, {}, red));
+    }
+    VERIFY_IS_TRUE(oldBuffer.GetRowByOffset(0).GetCharRow().WasWrapForced());
+    VERIFY_ARE_EQUAL(COORD({ 2, 1 }), oldBuffer.GetCursor().GetPosition());
+
+    const COORD newSize{ 5, 5 };
+    TextBuffer newBuffer{ newSize, attr, cursorSize, _renderTarget };
+    VERIFY_SUCCEEDED(TextBuffer::Reflow(oldBuffer, newBuffer));
+
+    Log::Comment(L"The taco can't start in the final column, so the first row is padded out.");
+    const auto& first = newBuffer.GetRowByOffset(0).GetCharRow();
+    VERIFY_ARE_EQUAL(String(L"abcd "), String(first.GetText().c_str()));
+    VERIFY_IS_TRUE(first.WasWrapForced());
+    VERIFY_IS_TRUE(first.WasDoubleBytePadded());
+
+    const auto& second = newBuffer.GetRowByOffset(1);
+    VERIFY_IS_TRUE(second.GetCharRow().DbcsAttrAt(0).IsLeading());
+    VERIFY_IS_TRUE(second.GetCharRow().DbcsAttrAt(1).IsTrailing());
+    VERIFY_ARE_EQUAL(2u, second.GetUnicodeStorage().size());
+    const std::wstring_view glyph = second.GetCharRow().GlyphAt(0);
+    VERIFY_ARE_EQUAL(String(taco.data(), gsl::narrow<int>(taco.size())), String(glyph.data(), gsl::narrow<int>(glyph.size())));
+    VERIFY_IS_TRUE(second.GetCharRow().WasWrapForced());
+
+    Log::Comment(L"The rest of the line lands on the third row with its attributes.");
+    const auto& third = newBuffer.GetRowByOffset(2);
+    VERIFY_ARE_EQUAL(String(L"hij  "), String(third.GetCharRow().GetText().c_str()));
+    VERIFY_ARE_EQUAL(attr, third.GetAttrRow().GetAttrByColumn(0));
+    VERIFY_ARE_EQUAL(red, third.GetAttrRow().GetAttrByColumn(1));
+    VERIFY_ARE_EQUAL(red, third.GetAttrRow().GetAttrByColumn(4));
+    VERIFY_IS_FALSE(third.GetCharRow().WasWrapForced());
+
+    Log::Comment(L"The cursor should still be just past the j.");
+    VERIFY_ARE_EQUAL(COORD({ 3, 2 }), newBuffer.GetCursor().GetPosition());
+}
+
+void TextBufferTests::RowGenerationsTrackChanges()
+{
+    const COORD bufferSize{ 10, 6 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, _renderTarget };
+
+    const auto start = buffer.GetGeneration();
+    VERIFY_IS_TRUE(buffer.GetRowsChangedSince(start, 0, bufferSize.Y).empty(), L"Nothing has happened yet.");
+
+    Log::Comment(L"Writing cells and clearing a column each mark only their own row.");
+    buffer.Write(OutputCellIterator(L"abc"), { 0, 2 });
+    buffer.GetRowByOffset(4).ClearColumn(1);
+    VERIFY_IS_TRUE((std::vector<size_t>{ 2, 4 }) == buffer.GetRowsChangedSince(start, 0, bufferSize.Y));
+    VERIFY_IS_TRUE((std::vector<size_t>{ 4 }) == buffer.GetRowsChangedSince(start, 3, 2));
+    VERIFY_IS_TRUE(buffer.GetRowsChangedSince(start, 5, 100).empty(), L"The range is clipped to the buffer.");
+
+    Log::Comment(L"Scrolling marks every row in the scrolled span.");
+    const auto beforeScroll = buffer.GetGeneration();
+    buffer.ScrollRows(2, 2, -1);
+    VERIFY_IS_TRUE((std::vector<size_t>{ 1, 2, 3 }) == buffer.GetRowsChangedSince(beforeScroll, 0, bufferSize.Y));
+
+    Log::Comment(L"Circling moves every row, so they all look changed.");
+    const auto beforeCircle = buffer.GetGeneration();
+    VERIFY_IS_TRUE(buffer.IncrementCircularBuffer());
+    VERIFY_ARE_EQUAL(gsl::narrow<size_t>(bufferSize.Y), buffer.GetRowsChangedSince(beforeCircle, 0, bufferSize.Y).size());
+
+    const auto afterCircle = buffer.GetGeneration();
+    VERIFY_IS_TRUE(afterCircle > beforeCircle);
+    VERIFY_IS_TRUE(buffer.GetRowsChangedSince(afterCircle, 0, bufferSize.Y).empty());
+}
+
+void TextBufferTests::SnapshotsShareCellsUntilWritten()
+{
+    const COORD bufferSize{ 10, 4 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    const TextAttribute red{ FOREGROUND_RED };
+    auto source = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    source->Write(OutputCellIterator(L"first", red), { 0, 0 });
+    source->Write(OutputCellIterator(L"second"), { 0, 1 });
+    source->GetCursor().SetPosition({ 3, 2 });
+
+    auto snapshot = source->CreateSnapshot(_renderTarget);
+
+    Log::Comment(L"Taking the snapshot shouldn't copy any cells.");
+    for (SHORT i = 0; i < bufferSize.Y; ++i)
+    {
+        const auto& sourceRow = std::as_const(*source).GetRowByOffset(i).GetCharRow();
+        const auto& snapshotRow = std::as_const(*snapshot).GetRowByOffset(i).GetCharRow();
+        VERIFY_ARE_EQUAL(sourceRow.cbegin(), snapshotRow.cbegin());
+        VERIFY_IS_TRUE(snapshotRow.IsShared());
+    }
+    VERIFY_ARE_EQUAL(COORD({ 3, 2 }), snapshot->GetCursor().GetPosition());
+    VERIFY_ARE_EQUAL(red, snapshot->GetRowByOffset(0).GetAttrRow().GetAttrByColumn(0));
+
+    Log::Comment(L"Writing to the source copies only the row written to.");
+    source->Write(OutputCellIterator(L"FIRST"), { 0, 0 });
+    VERIFY_ARE_EQUAL(String(L"FIRST"), String(std::as_const(*source).GetRowByOffset(0).GetText().substr(0, 5).c_str()));
+    VERIFY_ARE_EQUAL(String(L"first"), String(std::as_const(*snapshot).GetRowByOffset(0).GetText().substr(0, 5).c_str()));
+    VERIFY_ARE_NOT_EQUAL(std::as_const(*source).GetRowByOffset(0).GetCharRow().cbegin(),
+                         std::as_const(*snapshot).GetRowByOffset(0).GetCharRow().cbegin());
+    VERIFY_ARE_EQUAL(std::as_const(*source).GetRowByOffset(1).GetCharRow().cbegin(),
+                     std::as_const(*snapshot).GetRowByOffset(1).GetCharRow().cbegin());
+
+    Log::Comment(L"Writing to the snapshot leaves the source alone.");
+    snapshot->Write(OutputCellIterator(L"SECOND"), { 0, 1 });
+    VERIFY_ARE_EQUAL(String(L"second"), String(std::as_const(*source).GetRowByOffset(1).GetText().substr(0, 6).c_str()));
+    VERIFY_ARE_EQUAL(String(L"SECOND"), String(std::as_const(*snapshot).GetRowByOffset(1).GetText().substr(0, 6).c_str()));
+
+    Log::Comment(L"The snapshot keeps the shared cells alive after the source goes away.");
+    source.reset();
+    VERIFY_ARE_EQUAL(String(L"first"), String(std::as_const(*snapshot).GetRowByOffset(0).GetText().substr(0, 5).c_str()));
+
+    Log::Comment(L"Nobody else can see them anymore, so writing to them doesn't copy them.");
+    const auto cells = std::as_const(*snapshot).GetRowByOffset(2).GetCharRow().cbegin();
+    VERIFY_IS_FALSE(std::as_const(*snapshot).GetRowByOffset(2).GetCharRow().IsShared());
+    snapshot->GetRowByOffset(2).GetCharRow().ClearCell(0);
+    VERIFY_ARE_EQUAL(cells, std::as_const(*snapshot).GetRowByOffset(2).GetCharRow().cbegin());
+}
+
+void TextBufferTests::FrozenRowsFreeTheirSlotOnceSnapshotsAreGone()
+{
+    const COORD bufferSize{ 10, 4 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer source{ bufferSize, attr, cursorSize, _renderTarget };
+
+    source.Write(OutputCellIterator(L"first"), { 0, 0 });
+    source.Write(OutputCellIterator(L"second"), { 0, 1 });
+
+    auto snapshot = source.CreateSnapshot(_renderTarget);
+
+    Log::Comment(L"A row that a snapshot can still see keeps its slot when it's frozen.");
+    VERIFY_IS_TRUE(std::as_const(source)._storage[0].GetCharRow().IsShared());
+    source._FreezeRow(source._storage[0]);
+    VERIFY_IS_TRUE(source._freeArenaSlots.empty());
+
+    Log::Comment(L"Once the snapshot is gone the row's cells aren't shared, and its slot is freed.");
+    snapshot.reset();
+    VERIFY_IS_FALSE(std::as_const(source)._storage[1].GetCharRow().IsShared());
+    source._FreezeRow(source._storage[1]);
+    VERIFY_ARE_EQUAL(1u, source._freeArenaSlots.size());
+    VERIFY_ARE_EQUAL(1u, source._freeArenaSlots.front());
+
+    std::optional<ROW> scratch;
+    VERIFY_ARE_EQUAL(String(L"second"), String(std::as_const(source).GetRowByOffset(1, scratch).GetText().substr(0, 6).c_str()));
+}
+
+void TextBufferTests::RefreshSnapshotCopiesChangedRows()
+{
+    const COORD bufferSize{ 10, 4 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    const TextAttribute blue{ FOREGROUND_BLUE };
+    TextBuffer source{ bufferSize, attr, cursorSize, _renderTarget };
+
+    source.Write(OutputCellIterator(L"first"), { 0, 0 });
+    source.Write(OutputCellIterator(L"second"), { 0, 1 });
+
+    auto snapshot = source.CreateSnapshot(_renderTarget);
+
+    Log::Comment(L"Rows written after the snapshot was taken are only picked up inside the refreshed range.");
+    source.Write(OutputCellIterator(L"FIRST", blue), { 0, 0 });
+    source.Write(OutputCellIterator(L"THIRD"), { 0, 2 });
+    const auto untouched = std::as_const(*snapshot).GetRowByOffset(1).GetCharRow().cbegin();
+    VERIFY_IS_TRUE(snapshot->RefreshSnapshot(source, 0, 2));
+    VERIFY_ARE_EQUAL(String(L"FIRST"), String(std::as_const(*snapshot).GetRowByOffset(0).GetText().substr(0, 5).c_str()));
+    VERIFY_ARE_EQUAL(blue, std::as_const(*snapshot).GetRowByOffset(0).GetAttrRow().GetAttrByColumn(0));
+    VERIFY_ARE_EQUAL(untouched, std::as_const(*snapshot).GetRowByOffset(1).GetCharRow().cbegin());
+    VERIFY_ARE_NOT_EQUAL(String(L"THIRD"), String(std::as_const(*snapshot).GetRowByOffset(2).GetText().substr(0, 5).c_str()));
+
+    VERIFY_IS_TRUE(snapshot->RefreshSnapshot(source, 2, 2));
+    VERIFY_ARE_EQUAL(String(L"THIRD"), String(std::as_const(*snapshot).GetRowByOffset(2).GetText().substr(0, 5).c_str()));
+
+    Log::Comment(L"Circling the source moves the rows the snapshot sees along with it.");
+    VERIFY_IS_TRUE(source.IncrementCircularBuffer());
+    VERIFY_IS_TRUE(snapshot->RefreshSnapshot(source, 0, bufferSize.Y));
+    VERIFY_ARE_EQUAL(String(L"second"), String(std::as_const(*snapshot).GetRowByOffset(0).GetText().substr(0, 6).c_str()));
+    VERIFY_ARE_EQUAL(String(L"THIRD"), String(std::as_const(*snapshot).GetRowByOffset(1).GetText().substr(0, 5).c_str()));
+
+    Log::Comment(L"A resized source needs a new snapshot.");
+    VERIFY_SUCCEEDED(source.ResizeTraditional({ 12, 4 }));
+    VERIFY_IS_FALSE(snapshot->RefreshSnapshot(source, 0, bufferSize.Y));
+}
+
+void TextBufferTests::NarrowOnlyRowsTrackWrites()
+{
+    const COORD bufferSize{ 10, 3 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, _renderTarget };
+
+    const auto& charRow = std::as_const(buffer).GetRowByOffset(0).GetCharRow();
+    VERIFY_IS_TRUE(charRow.IsNarrowOnly(), L"A blank row is all narrow cells.");
+
+    buffer.Write(OutputCellIterator(L"hello"), { 0, 0 });
+    VERIFY_IS_TRUE(charRow.IsNarrowOnly());
+    VERIFY_ARE_EQUAL(String(L"hello     "), String(charRow.GetText().c_str()));
+
+    Log::Comment(L"A double width glyph takes the row off the fast path.");
+    DbcsAttribute leading{ DbcsAttribute::Attribute::Leading };
+    buffer.GetRowByOffset(0).GetCharRow().DbcsAttrAt(6) = leading;
+    VERIFY_IS_FALSE(charRow.IsNarrowOnly());
+
+    Log::Comment(L"So does a long glyph, even in a single cell.");
+    const auto& secondRow = std::as_const(buffer).GetRowByOffset(1).GetCharRow();
+    VERIFY_IS_TRUE(secondRow.IsNarrowOnly());
+    buffer.GetRowByOffset(1).GetCharRow().GlyphAt(2) = std::wstring_view{ L"\xD83C\xDF2E" };
+    VERIFY_IS_FALSE(secondRow.IsNarrowOnly());
+
+    Log::Comment(L"Resetting the row puts it back.");
+    VERIFY_IS_TRUE(buffer.GetRowByOffset(1).Reset(attr));
+    VERIFY_IS_TRUE(secondRow.IsNarrowOnly());
+}
+
+void TextBufferTests::SpanFillsAndReadsCrossRows()
+{
+    const COORD bufferSize{ 10, 3 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    const TextAttribute blue{ FOREGROUND_BLUE };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, _renderTarget };
+
+    buffer.GetRowByOffset(0).GetCharRow().GlyphAt(9) = std::wstring_view{ L"\xD83C\xDF2E" };
+
+    Log::Comment(L"Characters fill to the end of the row and carry on at the start of the next.");
+    VERIFY_ARE_EQUAL(5u, buffer.FillCharacters(L'x', { 8, 0 }, 5));
+    const auto& firstRow = std::as_const(buffer).GetRowByOffset(0).GetCharRow();
+    const auto& secondRow = std::as_const(buffer).GetRowByOffset(1).GetCharRow();
+    VERIFY_ARE_EQUAL(String(L"        xx"), String(firstRow.GetText().c_str()));
+    VERIFY_ARE_EQUAL(String(L"xxx       "), String(secondRow.GetText().c_str()));
+    VERIFY_IS_TRUE(firstRow.WasWrapForced());
+    VERIFY_IS_TRUE(firstRow.IsNarrowOnly(), L"The long glyph that was filled over is gone.");
+
+    Log::Comment(L"Colors stop at the end of the buffer and leave the text alone.");
+    VERIFY_ARE_EQUAL(25u, buffer.FillAttributes(blue, { 5, 0 }, 100));
+    VERIFY_ARE_EQUAL(attr, buffer.GetRowByOffset(0).GetAttrRow().GetAttrByColumn(4));
+    VERIFY_ARE_EQUAL(blue, buffer.GetRowByOffset(0).GetAttrRow().GetAttrByColumn(5));
+    VERIFY_ARE_EQUAL(blue, buffer.GetRowByOffset(2).GetAttrRow().GetAttrByColumn(9));
+    VERIFY_ARE_EQUAL(String(L"xxx       "), String(secondRow.GetText().c_str()));
+
+    Log::Comment(L"Reading skips trailing halves, except where the read cuts a wide character in two.");
+    auto cells = buffer.GetRowByOffset(1).GetCharRow().begin();
+    cells[4] = CharRowCell{ L'\x3042', DbcsAttribute{ DbcsAttribute::Attribute::Leading } };
+    cells[5] = CharRowCell{ L'\x3042', DbcsAttribute{ DbcsAttribute::Attribute::Trailing } };
+
+    const auto read = [&](const COORD target, const size_t count) {
+        std::pmr::wstring text;
+        buffer.ReadText(text, target, count);
+        return String(text.c_str());
+    };
+    VERIFY_ARE_EQUAL(String(L"xxxxx"), read({ 8, 0 }, 5));
+    VERIFY_ARE_EQUAL(String(L"xxx \x3042    "), read({ 0, 1 }, 10));
+    VERIFY_ARE_EQUAL(String(L"xxx  "), read({ 0, 1 }, 5));
+    VERIFY_ARE_EQUAL(String(L" "), read({ 5, 1 }, 1));
+    VERIFY_ARE_EQUAL(String(L"  "), read({ 8, 2 }, 50));
+}
+
+void TextBufferTests::GetSelectedTextMatchesClipboardText()
+{
+    const COORD bufferSize{ 10, 3 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    const TextAttribute blue{ FOREGROUND_BLUE };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, _renderTarget };
+
+    buffer.Write(OutputCellIterator(L"ab"), { 0, 0 });
+    buffer.Write(OutputCellIterator(L"cd", blue), { 2, 0 });
+    buffer.Write(OutputCellIterator(L"efg"), { 0, 1 });
+    buffer.GetRowByOffset(1).GetCharRow().GlyphAt(1) = std::wstring_view{ L"\xD83C\xDF2E" };
+
+    const std::vector<SMALL_RECT> selection{ { 0, 0, 9, 0 }, { 0, 1, 9, 1 } };
+    const std::function<COLORREF(TextAttribute&)> GetForegroundColor = [](TextAttribute& attr) -> COLORREF { return attr.GetLegacyAttributes() & FG_ATTRS; };
+    const std::function<COLORREF(TextAttribute&)> GetBackgroundColor = [](TextAttribute& attr) -> COLORREF { return (attr.GetLegacyAttributes() & BG_ATTRS) >> 4; };
+
+    for (const bool trim : { false, true })
+    {
+        const auto expected = buffer.GetTextForClipboard(true, trim, selection, GetForegroundColor, GetBackgroundColor);
+        std::wstring expectedText;
+        std::vector<COLORREF> expectedForeground;
+        for (size_t i = 0; i < expected.text.size(); ++i)
+        {
+            expectedText += expected.text.at(i);
+            expectedForeground.insert(expectedForeground.end(), expected.FgAttr.at(i).cbegin(), expected.FgAttr.at(i).cend());
+        }
+
+        Log::Comment(L"Plain text comes out the same as the clipboard text.");
+        std::wstring text;
+        buffer.GetSelectedText(true, trim, selection, text);
+        VERIFY_ARE_EQUAL(String(expectedText.c_str()), String(text.c_str()));
+
+        Log::Comment(L"The color runs cover the text with the same colors, one run per change.");
+        std::vector<TextBuffer::ColorRun> colors;
+        text.clear();
+        buffer.GetSelectedText(true, trim, selection, text, &colors, GetForegroundColor, GetBackgroundColor);
+        VERIFY_ARE_EQUAL(String(expectedText.c_str()), String(text.c_str()));
+
+        std::vector<COLORREF> foreground;
+        for (size_t i = 0; i < colors.size(); ++i)
+        {
+            if (i > 0)
+            {
+                VERIFY_IS_TRUE(colors.at(i).foreground != colors.at(i - 1).foreground ||
+                               colors.at(i).background != colors.at(i - 1).background);
+            }
+            foreground.insert(foreground.end(), colors.at(i).length, colors.at(i).foreground);
+        }
+        VERIFY_IS_TRUE(expectedForeground == foreground);
+    }
+}
+
+void TextBufferTests::ClearOldestRowsReleasesMemory()
+{
+    const COORD bufferSize{ 20, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, _renderTarget };
+    buffer.SetHotRowCount(2);
+
+    for (SHORT row = 0; row < bufferSize.Y; ++row)
+    {
+        buffer.Write(OutputCellIterator(L"\xD83C\xDF2E text that fills the row"), { 0, row });
+    }
+
+    const auto before = buffer.GetMemoryUsage();
+    VERIFY_IS_GREATER_THAN(before, static_cast<size_t>(bufferSize.X * bufferSize.Y));
+
+    Log::Comment(L"Clearing the oldest rows blanks them and gives back what they held.");
+    const auto generation = buffer.GetGeneration();
+    buffer.ClearOldestRows(5);
+    VERIFY_IS_LESS_THAN(buffer.GetMemoryUsage(), before);
+    VERIFY_ARE_EQUAL(5u, buffer.GetRowsChangedSince(generation, 0, bufferSize.Y).size());
+
+    VERIFY_IS_FALSE(buffer.GetRowByOffset(4).GetCharRow().ContainsText());
+    VERIFY_IS_TRUE(buffer.GetRowByOffset(5).GetCharRow().ContainsText());
+}
+
+void TextBufferTests::MeasureMemorySplitsUsage()
+{
+    const COORD bufferSize{ 20, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, _renderTarget };
+
+    const auto empty = buffer.MeasureMemory();
+    VERIFY_ARE_EQUAL(0u, empty.unicodeStorage.allocations);
+    VERIFY_IS_GREATER_THAN_OR_EQUAL(empty.cells.bytes, static_cast<size_t>(bufferSize.X * bufferSize.Y) * sizeof(CharRowCell));
+
+    Log::Comment(L"A glyph too long for its cell is counted as stored, in the row it's in.");
+    buffer.Write(OutputCellIterator(L"\xD83C\xDF2E"), { 0, 3 });
+    const auto written = buffer.MeasureMemory();
+    VERIFY_IS_GREATER_THAN(written.unicodeStorage.allocations, 0u);
+    VERIFY_ARE_EQUAL(empty.cells.bytes, written.cells.bytes);
+
+    Log::Comment(L"The parts add up to the whole.");
+    VERIFY_ARE_EQUAL(buffer.GetMemoryUsage(),
+                     sizeof(TextBuffer) +
+                         written.cells.bytes +
+                         written.rows.bytes +
+                         written.attributeRuns.bytes +
+                         written.unicodeStorage.bytes +
+                         written.attributePalette.bytes +
+                         written.other.bytes);
+}
+
+void TextBufferTests::SerializeRoundTripsContents()
+{
+    const COORD bufferSize{ 10, 4 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    const TextAttribute red{ FOREGROUND_RED };
+    TextBuffer source{ bufferSize, attr, cursorSize, _renderTarget };
+
+    Log::Comment(L"Circle the buffer first, so that its top row isn't the first one stored.");
+    VERIFY_IS_TRUE(source.IncrementCircularBuffer());
+    source.Write(OutputCellIterator(L"first", red), { 0, 0 });
+    source.Write(OutputCellIterator(L"a\xD83C\xDF2E" L"b"), { 0, 1 });
+    source.GetRowByOffset(1).GetCharRow().SetWrapForced(true);
+    TextAttribute linked{ attr };
+    linked.SetHyperlinkId(source.AddHyperlink(L"https://example.com", L"7"));
+    source.Write(OutputCellIterator(L"link", linked), { 0, 2 });
+    source.GetCursor().SetPosition({ 3, 2 });
+    source.GetCursor().SetIsVisible(false);
+    source.SetCurrentAttributes(red);
+
+    std::vector<std::byte> data;
+    source.Serialize(data);
+
+    Log::Comment(L"Loading the copy takes on its size along with everything else.");
+    TextBuffer restored{ { 5, 2 }, attr, cursorSize, _renderTarget };
+    restored.Deserialize(data);
+    VERIFY_ARE_EQUAL(bufferSize, restored.GetSize().Dimensions());
+    VERIFY_ARE_EQUAL(COORD({ 3, 2 }), restored.GetCursor().GetPosition());
+    VERIFY_IS_FALSE(restored.GetCursor().IsVisible());
+    VERIFY_ARE_EQUAL(red, restored.GetCurrentAttributes());
+
+    for (SHORT i = 0; i < bufferSize.Y; ++i)
+    {
+        const auto& expected = std::as_const(source).GetRowByOffset(i);
+        const auto& actual = std::as_const(restored).GetRowByOffset(i);
+        VERIFY_ARE_EQUAL(String(expected.GetText().c_str()), String(actual.GetText().c_str()));
+        VERIFY_ARE_EQUAL(expected.GetCharRow().WasWrapForced(), actual.GetCharRow().WasWrapForced());
+        for (size_t column = 0; column < static_cast<size_t>(bufferSize.X); ++column)
+        {
+            VERIFY_ARE_EQUAL(expected.GetAttrRow().GetAttrByColumn(column), actual.GetAttrRow().GetAttrByColumn(column));
+        }
+    }
+    VERIFY_ARE_EQUAL(1u, std::as_const(restored).GetRowByOffset(1).GetUnicodeStorage().size());
+    VERIFY_IS_TRUE(std::as_const(restored).GetRowByOffset(1).GetCharRow().WasWrapForced());
+    const auto restoredLink = std::as_const(restored).GetRowByOffset(2).GetAttrRow().GetAttrByColumn(1).GetHyperlinkId();
+    VERIFY_ARE_EQUAL(String(L"https://example.com"), String(std::wstring{ restored.GetHyperlinkUri(restoredLink) }.c_str()));
+    VERIFY_ARE_EQUAL(String(L"7"), String(std::wstring{ restored.GetHyperlinks().GetId(restoredLink) }.c_str()));
+
+    Log::Comment(L"Rows above a buffer's hot window are loaded straight into cold storage.");
+    TextBuffer cold{ { 5, 2 }, attr, cursorSize, _renderTarget };
+    cold.SetHotRowCount(2);
+    cold.Deserialize(data);
+    VERIFY_ARE_EQUAL(bufferSize, cold.GetSize().Dimensions());
+    VERIFY_IS_TRUE(std::as_const(cold).GetRowByOffset(0).IsPacked());
+    VERIFY_IS_FALSE(std::as_const(cold).GetRowByOffset(3).IsPacked());
+    std::optional<ROW> scratch;
+    VERIFY_ARE_EQUAL(String(std::as_const(source).GetRowByOffset(0).GetText().c_str()),
+                     String(std::as_const(cold).GetRowByOffset(0, scratch).GetText().c_str()));
+
+    Log::Comment(L"A copy that's been cut short is rejected, and the buffer's left alone.");
+    TextBuffer untouched{ { 5, 2 }, attr, cursorSize, _renderTarget };
+    untouched.Write(OutputCellIterator(L"keep"), { 0, 0 });
+    const gsl::span<const std::byte> truncated{ data.data(), gsl::narrow<ptrdiff_t>(data.size() - 1) };
+    VERIFY_THROWS_SPECIFIC(untouched.Deserialize(truncated), wil::ResultException, [](wil::ResultException& e) { return e.GetErrorCode() == HRESULT_FROM_WIN32(ERROR_INVALID_DATA); });
+    VERIFY_ARE_EQUAL(COORD({ 5, 2 }), untouched.GetSize().Dimensions());
+    VERIFY_ARE_EQUAL(String(L"keep "), String(std::as_const(untouched).GetRowByOffset(0).GetText().c_str()));
+
+    Log::Comment(L"So is one with a cursor type that doesn't exist.");
+    auto badCursor = data;
+    badCursor[offsetof(TextBuffer::_SerializedHeader, cursorType)] = std::byte{ 0xff };
+    VERIFY_THROWS_SPECIFIC(untouched.Deserialize(badCursor), wil::ResultException, [](wil::ResultException& e) { return e.GetErrorCode() == HRESULT_FROM_WIN32(ERROR_INVALID_DATA); });
+    VERIFY_ARE_EQUAL(COORD({ 5, 2 }), untouched.GetSize().Dimensions());
+    VERIFY_ARE_EQUAL(String(L"keep "), String(std::as_const(untouched).GetRowByOffset(0).GetText().c_str()));
+}
+
+void TextBufferTests::SerializeLargeBufferQuickly()
+{
+    const COORD bufferSize{ 120, 9001 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer source{ bufferSize, attr, cursorSize, _renderTarget };
+    source.SetHotRowCount(100);
+
+    for (SHORT i = 0; i < bufferSize.Y; ++i)
+    {
+        const TextAttribute color{ gsl::narrow_cast<WORD>(i % 16) };
+        source.Write(OutputCellIterator(L"The quick brown fox jumps over the lazy dog", color), { gsl::narrow_cast<SHORT>(i % 50), i });
+    }
+
+    std::vector<std::byte> data;
+    TextBuffer restored{ { 80, 25 }, attr, cursorSize, _renderTarget };
+    restored.SetHotRowCount(100);
+
+    const auto start = std::chrono::steady_clock::now();
+    source.Serialize(data);
+    const auto saved = std::chrono::steady_clock::now();
+    restored.Deserialize(data);
+    const auto loaded = std::chrono::steady_clock::now();
+
+    using ms = std::chrono::duration<double, std::milli>;
+    Log::Comment(NoThrowString().Format(L"%zu bytes, saved in %.2fms, loaded in %.2fms",
+                                        data.size(),
+                                        ms(saved - start).count(),
+                                        ms(loaded - saved).count()));
+
+    VERIFY_ARE_EQUAL(bufferSize, restored.GetSize().Dimensions());
+    VERIFY_ARE_EQUAL(100u, restored.GetHotRowCount());
+    for (SHORT i = 0; i < bufferSize.Y; i += 1000)
+    {
+        VERIFY_ARE_EQUAL(String(std::as_const(source).GetRowByOffset(i).GetText().c_str()),
+                         String(std::as_const(restored).GetRowByOffset(i).GetText().c_str()));
+        VERIFY_ARE_EQUAL(source.GetRowByOffset(i).GetAttrRow().GetAttrByColumn(50), restored.GetRowByOffset(i).GetAttrRow().GetAttrByColumn(50));
+    }
+}
+
+void TextBufferTests::PaletteIsCompactedWhenAWriteOverflowsIt()
+{
+    const COORD bufferSize{ 4200, 1 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, _renderTarget };
+
+    Log::Comment(L"Fill the palette with attributes nothing uses, up to just short of where it's compacted.");
+    auto& palette = buffer.GetAttributePalette();
+    const size_t unused = TextAttributePalette::MaxEntries - 4097;
+    for (COLORREF color = 0; palette.size() < unused; ++color)
+    {
+        palette.Intern(TextAttribute{ color, RGB(1, 2, 3) });
+    }
+    VERIFY_IS_FALSE(palette.NeedsCompaction());
+
+    Log::Comment(L"One row with a different color in every cell needs more handles than are left.");
+    std::vector<OutputCell> cells;
+    for (COLORREF color = 0; color < gsl::narrow<COLORREF>(bufferSize.X); ++color)
+    {
+        cells.emplace_back(L"x", DbcsAttribute{}, TextAttribute{ color, RGB(4, 5, 6) });
+    }
+    buffer.Write(OutputCellIterator({ cells.data(), cells.size() }), { 0, 0 });
+
+    Log::Comment(L"The palette's compacted and the row's written again, so every cell keeps its color.");
+    const auto& row = std::as_const(buffer).GetRowByOffset(0);
+    for (size_t column = 0; column < cells.size(); ++column)
+    {
+        VERIFY_ARE_EQUAL(cells[column].TextAttr(), row.GetAttrRow().GetAttrByColumn(column));
+    }
+    VERIFY_IS_LESS_THAN(buffer.GetAttributePalette().size(), unused);
+    VERIFY_ARE_EQUAL(0u, buffer.GetAttributePalette().GetOverflowCount());
+}
+
+void TextBufferTests::HyperlinksAreInternedAndCollected()
+{
+    const COORD bufferSize{ 20, 4 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, _renderTarget };
+
+    Log::Comment(L"The same URI and id get the same handle, and a different id a different one.");
+    const auto link = buffer.AddHyperlink(L"https://example.com/a", L"");
+    VERIFY_ARE_NOT_EQUAL(HyperlinkTable::NoHyperlink, link);
+    VERIFY_ARE_EQUAL(link, buffer.AddHyperlink(L"https://example.com/a", L""));
+    const auto other = buffer.AddHyperlink(L"https://example.com/a", L"other");
+    VERIFY_ARE_NOT_EQUAL(link, other);
+    VERIFY_ARE_EQUAL(2u, buffer.GetHyperlinks().GetLinkCount());
+
+    Log::Comment(L"A link on every row is one attribute, and one URI.");
+    TextAttribute linked{ attr };
+    linked.SetHyperlinkId(link);
+    for (SHORT row = 0; row < bufferSize.Y; ++row)
+    {
+        buffer.Write(OutputCellIterator(L"file.txt", linked), { 0, row });
+    }
+    VERIFY_ARE_EQUAL(link, std::as_const(buffer).GetRowByOffset(3).GetAttrRow().GetAttrByColumn(2).GetHyperlinkId());
+    VERIFY_ARE_EQUAL(HyperlinkTable::NoHyperlink, std::as_const(buffer).GetRowByOffset(3).GetAttrRow().GetAttrByColumn(10).GetHyperlinkId());
+    VERIFY_ARE_EQUAL(String(L"https://example.com/a"), String(std::wstring{ buffer.GetHyperlinkUri(link) }.c_str()));
+
+    Log::Comment(L"Collecting only lets go of the link nothing refers to.");
+    buffer._CompactAttributePalette();
+    VERIFY_ARE_EQUAL(1u, buffer.GetHyperlinks().GetLinkCount());
+    VERIFY_IS_TRUE(buffer.GetHyperlinks().IsInUse(link));
+    VERIFY_IS_FALSE(buffer.GetHyperlinks().IsInUse(other));
+
+    Log::Comment(L"A link the buffer's writing with is kept, even before it's anywhere.");
+    TextAttribute current{ attr };
+    current.SetHyperlinkId(buffer.AddHyperlink(L"https://example.com/b", L""));
+    buffer.SetCurrentAttributes(current);
+    buffer._CompactAttributePalette();
+    VERIFY_IS_TRUE(buffer.GetHyperlinks().IsInUse(current.GetHyperlinkId()));
+
+    Log::Comment(L"Once the rows it was on are cleared, it's let go, and its handle is given out again.");
+    buffer.SetCurrentAttributes(attr);
+    buffer.ClearRows(0, bufferSize.Y, attr);
+    buffer._CompactAttributePalette();
+    VERIFY_ARE_EQUAL(0u, buffer.GetHyperlinks().GetLinkCount());
+    VERIFY_IS_TRUE(buffer.GetHyperlinkUri(link).empty());
+    const auto reused = buffer.AddHyperlink(L"https://example.com/c", L"");
+    VERIFY_ARE_EQUAL(3u, buffer.GetHyperlinks().size());
+
+    Log::Comment(L"A snapshot and another buffer can read the link too.");
+    TextAttribute moved{ attr };
+    moved.SetHyperlinkId(reused);
+    buffer.Write(OutputCellIterator(L"c", moved), { 0, 0 });
+    const auto snapshot = buffer.CreateSnapshot(_renderTarget);
+    VERIFY_ARE_EQUAL(String(L"https://example.com/c"), String(std::wstring{ snapshot->GetHyperlinkUri(reused) }.c_str()));
+
+    TextBuffer elsewhere{ bufferSize, attr, cursorSize, _renderTarget };
+    const auto imported = elsewhere.ImportAttributes(buffer, moved);
+    VERIFY_IS_TRUE(imported.IsHyperlink());
+    VERIFY_ARE_EQUAL(String(L"https://example.com/c"), String(std::wstring{ elsewhere.GetHyperlinkUri(imported.GetHyperlinkId()) }.c_str()));
+}
+
+void TextBufferTests::LogicalLinesFollowWrapping()
+{
+    const COORD bufferSize{ 10, 5 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, cursorSize, _renderTarget };
+    const auto wrap = [&](const SHORT row, const bool wrapForced) {
+        buffer.GetRowByOffset(row).GetCharRow().SetWrapForced(wrapForced);
+    };
+
+    Log::Comment(L"Every row starts out as a line of its own.");
+    for (size_t row = 0; row < static_cast<size_t>(bufferSize.Y); ++row)
+    {
+        VERIFY_ARE_EQUAL(row, buffer.GetLogicalLineStart(row));
+        VERIFY_ARE_EQUAL(row, buffer.GetLogicalLineEnd(row));
+    }
+
+    Log::Comment(L"Rows that wrap join the rows after them.");
+    wrap(1, true);
+    wrap(2, true);
+    VERIFY_ARE_EQUAL(1u, buffer.GetLogicalLineStart(3));
+    VERIFY_ARE_EQUAL(3u, buffer.GetLogicalLineEnd(1));
+    VERIFY_ARE_EQUAL(3u, buffer.GetLogicalLineEnd(2));
+    VERIFY_ARE_EQUAL(0u, buffer.GetLogicalLineEnd(0));
+    VERIFY_ARE_EQUAL(4u, buffer.GetLogicalLineStart(4));
+
+    Log::Comment(L"And split off again once they stop wrapping.");
+    wrap(2, false);
+    VERIFY_ARE_EQUAL(2u, buffer.GetLogicalLineEnd(1));
+    VERIFY_ARE_EQUAL(3u, buffer.GetLogicalLineStart(3));
+    VERIFY_ARE_EQUAL(3u, buffer.GetLogicalLineEnd(3));
+
+    wrap(0, true);
+    VERIFY_ARE_EQUAL(0u, buffer.GetLogicalLineStart(2));
+    VERIFY_ARE_EQUAL(2u, buffer.GetLogicalLineEnd(0));
+
+    Log::Comment(L"A line that circles partly off the top starts at the top row.");
+    VERIFY_IS_TRUE(buffer.IncrementCircularBuffer());
+    VERIFY_ARE_EQUAL(0u, buffer.GetLogicalLineStart(1));
+    VERIFY_ARE_EQUAL(1u, buffer.GetLogicalLineEnd(0));
+    VERIFY_ARE_EQUAL(4u, buffer.GetLogicalLineStart(4));
+
+    Log::Comment(L"Rows that are scrolled take their lines with them.");
+    buffer.ScrollRows(0, 2, 2);
+    VERIFY_ARE_EQUAL(2u, buffer.GetLogicalLineStart(3));
+    VERIFY_ARE_EQUAL(3u, buffer.GetLogicalLineEnd(2));
+    VERIFY_ARE_EQUAL(0u, buffer.GetLogicalLineEnd(0));
+    VERIFY_ARE_EQUAL(1u, buffer.GetLogicalLineStart(1));
+
+    Log::Comment(L"A line that wraps off the bottom carries on in the row that circles in below it.");
+    wrap(4, true);
+    VERIFY_ARE_EQUAL(4u, buffer.GetLogicalLineEnd(4));
+    VERIFY_IS_TRUE(buffer.IncrementCircularBuffer());
+    VERIFY_ARE_EQUAL(3u, buffer.GetLogicalLineStart(4));
+    VERIFY_ARE_EQUAL(4u, buffer.GetLogicalLineEnd(3));
+    VERIFY_ARE_EQUAL(2u, buffer.GetLogicalLineEnd(1));
+
+    Log::Comment(L"Resetting the buffer leaves every row on its own again.");
+    buffer.Reset();
+    VERIFY_ARE_EQUAL(4u, buffer.GetLogicalLineStart(4));
+    VERIFY_ARE_EQUAL(1u, buffer.GetLogicalLineEnd(1));
+}
+
+void TextBufferTests::SpilledRowsCanBeSelectedAndShown()
+{
+    const COORD bufferSize{ 20, 4 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x07 };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+    _buffer->SetScrollbackSpill(ScrollbackSpill::CreateInTempDirectory());
+
+    Log::Comment(L"Spill a row by circling the buffer.");
+    _buffer->WriteLine(OutputCellIterator{ L"first", TextAttribute{ 0x1e } }, { 0, 0 });
+    VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+
+    Log::Comment(L"Shrink the buffer with the cursor on its bottom row, dropping two more off the top.");
+    _buffer->WriteLine(OutputCellIterator{ L"second", attr }, { 0, 0 });
+    _buffer->WriteLine(OutputCellIterator{ L"third", attr }, { 0, 1 });
+    _buffer->WriteLine(OutputCellIterator{ L"fourth", attr }, { 0, 2 });
+    _buffer->GetCursor().SetPosition({ 0, 3 });
+    VERIFY_SUCCEEDED(_buffer->ResizeTraditional({ 20, 2 }));
+    VERIFY_ARE_EQUAL(3u, _buffer->GetSpilledRowCount());
+    VERIFY_ARE_EQUAL(String(L"fourth"), String(_buffer->GetRowByOffset(0).GetText().substr(0, 6).c_str()));
+
+    Log::Comment(L"Rows above the top of the buffer are selected out of the spill, the last one spilled at -1.");
+    std::wstring text;
+    _buffer->GetSelectedText(true, true, { { 0, -3, 19, -3 }, { 0, -1, 19, -1 }, { 0, 0, 19, 0 } }, text);
+    VERIFY_ARE_EQUAL(String(L"first\r\nthird\r\nfourth"), String(text.c_str()));
+
+    const auto legacy = [](TextAttribute& a) { return static_cast<COLORREF>(a.GetLegacyAttributes()); };
+    const auto data = _buffer->GetTextForClipboard(true, true, { { 1, -3, 3, -3 } }, legacy, legacy);
+    VERIFY_ARE_EQUAL(1u, data.text.size());
+    VERIFY_ARE_EQUAL(String(L"irs"), String(data.text.at(0).c_str()));
+    VERIFY_ARE_EQUAL(3u, data.FgAttr.at(0).size());
+    for (const auto foreground : data.FgAttr.at(0))
+    {
+        VERIFY_ARE_EQUAL(COLORREF{ 0x1e }, foreground);
+    }
+
+    Log::Comment(L"A row that was never spilled can't be selected.");
+    VERIFY_THROWS_SPECIFIC(_buffer->GetSelectedText(true, true, { { 0, -4, 19, -4 } }, text),
+                           wil::ResultException,
+                           [](wil::ResultException& e) { return e.GetErrorCode() == E_BOUNDS; });
+
+    Log::Comment(L"A spilled row can be written back over a row of a buffer to show it again.");
+    _buffer->WriteSpilledRow(_buffer->GetScrollbackSpill()->ReadRow(0), 1);
+    const auto& shown = _buffer->GetRowByOffset(1);
+    VERIFY_ARE_EQUAL(String(L"first               "), String(shown.GetText().c_str()));
+    VERIFY_ARE_EQUAL(WORD{ 0x1e }, shown.GetAttrRow().GetAttrByColumn(0).GetLegacyAttributes());
+}
@@ -86,4 +86,28 @@ class Utf16ParserTests
             VERIFY_ARE_EQUAL(result.at(0).at(i), SunglassesEmoji.at(i));
         }
     }
+
+    TEST_METHOD(GlyphsAreViewsIntoText)
+    {
+        // a stray trailing surrogate, a pair, a lone leading surrogate and a plain char
+        std::wstring wstr;
+        wstr.push_back(SunglassesEmoji.at(1));
+        wstr.append(SunglassesEmoji.begin(), SunglassesEmoji.end());
+        wstr.push_back(SunglassesEmoji.at(0));
+        wstr.push_back(LatinChar.at(0));
+
+        std::vector<std::wstring_view> glyphs;
+        for (const auto glyph : Utf16Parser::Glyphs(wstr))
+        {
+            glyphs.push_back(glyph);
+        }
+
+        VERIFY_ARE_EQUAL(glyphs.size(), 2u);
+        VERIFY_ARE_EQUAL(glyphs.at(0).data(), wstr.data() + 1);
+        VERIFY_ARE_EQUAL(glyphs.at(0).size(), SunglassesEmoji.size());
+        VERIFY_ARE_EQUAL(glyphs.at(1).data(), wstr.data() + 4);
+        VERIFY_ARE_EQUAL(glyphs.at(1).size(), 1u);
+
+        VERIFY_IS_TRUE(Utf16Parser::Glyphs(std::wstring_view{}).begin() == Utf16Parser::Glyphs(std::wstring_view{}).end());
+    }
 };
@@ -257,6 +257,38 @@ class Utf8ToWideCharParserTests
         }
     }
 
+    TEST_METHOD(ConvertsLongAsciiRunsAroundUtf8Test)
+    {
+        Log::Comment(L"Testing that long runs of ASCII are converted along with the UTF8 between them, into a reused buffer");
+        const std::string ascii = "The quick brown fox jumps over the lazy dog.";
+        // hiragana sushi
+        const std::string sushi = "\xe3\x81\x99\xe3\x81\x97";
+        const std::string input = ascii + sushi + ascii + "!";
+        const std::wstring wideAscii(ascii.cbegin(), ascii.cend());
+        const std::wstring expected = wideAscii + L"\x3059\x3057" + wideAscii + L"!";
+
+        unsigned int consumed = 0;
+        std::wstring output = L"left over from before";
+        auto parser = Utf8ToWideCharParser { utf8CodePage };
+
+        VERIFY_SUCCEEDED(parser.Parse(reinterpret_cast<const byte*>(input.data()), gsl::narrow<unsigned int>(input.size()), consumed, output));
+        VERIFY_ARE_EQUAL(consumed, gsl::narrow<unsigned int>(input.size()));
+        VERIFY_ARE_EQUAL(String(expected.c_str()), String(output.c_str()));
+
+        Log::Comment(L"A partial sequence at the end of a long run of ASCII waits for the rest of it");
+        const std::string partial = ascii + "\xe3\x81";
+        VERIFY_SUCCEEDED(parser.Parse(reinterpret_cast<const byte*>(partial.data()), gsl::narrow<unsigned int>(partial.size()), consumed, output));
+        VERIFY_ARE_EQUAL(consumed, gsl::narrow<unsigned int>(partial.size()));
+        VERIFY_ARE_EQUAL(String(wideAscii.c_str()), String(output.c_str()));
+        VERIFY_ARE_EQUAL(parser._currentState, Utf8ToWideCharParser::_State::BeginPartialParse);
+
+        const std::string rest = "\x99" + ascii;
+        VERIFY_SUCCEEDED(parser.Parse(reinterpret_cast<const byte*>(rest.data()), gsl::narrow<unsigned int>(rest.size()), consumed, output));
+        VERIFY_ARE_EQUAL(consumed, gsl::narrow<unsigned int>(rest.size()));
+        VERIFY_ARE_EQUAL(String((L"\x3059" + wideAscii).c_str()), String(output.c_str()));
+        VERIFY_ARE_EQUAL(parser._currentState, Utf8ToWideCharParser::_State::Ready);
+    }
+
     TEST_METHOD(PartialBytesAreDroppedOnCodePageChangeTest)
     {
         Log::Comment(L"Testing that a saved partial sequence is cleared when the codepage changes");
@@ -0,0 +1,231 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "..\..\inc\consoletaeftemplates.hpp"
+
+#include "CommonState.hpp"
+
+#include "globals.h"
+#include "screenInfo.hpp"
+
+#include "..\interactivity\inc\ServiceLocator.hpp"
+
+#include <psapi.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+// This class feeds streams of VT through the screen buffer's own state machine,
+// into the real AdaptDispatch and TextBuffer, and measures what each one costs.
+// It's meant for the streams that VTCommandFuzzer writes: the fuzzer makes up
+// the sequences, and this finds the ones that make the console spin.
+//
+// Run it with /p:VtCostCorpus=<directory>, and every file in that directory is
+// fed through once as it is, and once repeated s_Repeats times over. A stream
+// is slow if it costs more than s_MaxMicrosecondsPerChar for each character, or
+// if repeating it costs more than s_MaxGrowth times what it should if its cost
+// were linear in its length. It's also slow if feeding it through grows the
+// process by more than s_MaxPrivateBytes. Slow streams are copied into
+// /p:VtCostSaveTo=<directory> (or a "slow" directory beside the corpus) to
+// keep as regression cases, and the test fails. Running it on the saved
+// cases is how to check that they've been fixed.
+//
+// Without a corpus, there's nothing to measure, and the test is skipped.
+class VtCostTests
+{
+    CommonState* m_state;
+
+    BEGIN_TEST_CLASS(VtCostTests)
+        TEST_CLASS_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_CLASS()
+
+    TEST_CLASS_SETUP(ClassSetup)
+    {
+        m_state = new CommonState();
+
+        m_state->InitEvents();
+        m_state->PrepareGlobalFont();
+        m_state->PrepareGlobalScreenBuffer();
+        m_state->PrepareGlobalInputBuffer();
+
+        return true;
+    }
+
+    TEST_CLASS_CLEANUP(ClassCleanup)
+    {
+        m_state->CleanupGlobalScreenBuffer();
+        m_state->CleanupGlobalFont();
+        m_state->CleanupGlobalInputBuffer();
+
+        delete m_state;
+
+        return true;
+    }
+
+    TEST_METHOD(FuzzedStreamCost);
+
+    struct Cost
+    {
+        double microseconds;
+        SIZE_T privateBytes;
+        COORD bufferSize;
+    };
+
+    Cost _Measure(const std::wstring& stream, const size_t repeats);
+
+    static constexpr size_t s_Repeats = 4;
+    static constexpr double s_MaxMicrosecondsPerChar = 50.0;
+    static constexpr double s_MaxGrowth = 3.0;
+    static constexpr SIZE_T s_MaxPrivateBytes = 64 * 1024 * 1024;
+    // Below this, the cost of a stream is mostly noise, and isn't compared.
+    static constexpr double s_MinMeasurableMicroseconds = 2000.0;
+};
+
+namespace
+{
+    // Reads the stream a byte to a character, the same way the fuzz wrapper
+    // does with its ASCII codepage, so that the C1 controls the fuzzer writes
+    // come through as they are.
+    std::wstring ReadStream(const std::filesystem::path& path)
+    {
+        std::ifstream file{ path, std::ios::binary };
+        const std::string bytes{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+
+        std::wstring stream;
+        stream.reserve(bytes.size());
+        for (const auto ch : bytes)
+        {
+            stream.push_back(static_cast<wchar_t>(static_cast<unsigned char>(ch)));
+        }
+        return stream;
+    }
+
+    SIZE_T PrivateBytes()
+    {
+        PROCESS_MEMORY_COUNTERS_EX counters{};
+        counters.cb = sizeof(counters);
+        K32GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters));
+        return counters.PrivateUsage;
+    }
+}
+
+// Routine Description:
+// - Feeds a stream through a fresh screen buffer, the given number of times
+//   over, and measures what it cost. Afterwards, the buffer's put back the way
+//   the next stream expects to find it.
+// Arguments:
+// - stream - The VT to feed through
+// - repeats - How many times over to feed it
+// Return Value:
+// - How long it took, how much the process grew by, and how big the buffer
+//   ended up.
+VtCostTests::Cost VtCostTests::_Measure(const std::wstring& stream, const size_t repeats)
+{
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    m_state->PrepareNewTextBufferInfo();
+
+    const auto privateBytes = PrivateBytes();
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < repeats; ++i)
+    {
+        // The stream may switch to the alt buffer, so it's always written to
+        //      whichever buffer is active now.
+        gci.GetActiveOutputBuffer().GetStateMachine().ProcessString(stream.data(), stream.size());
+    }
+    const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    Cost cost;
+    cost.microseconds = elapsed.count();
+    const auto endBytes = PrivateBytes();
+    cost.privateBytes = endBytes > privateBytes ? endBytes - privateBytes : 0;
+    cost.bufferSize = gci.GetActiveOutputBuffer().GetBufferSize().Dimensions();
+
+    // Back out of the alt buffer and anything else the stream set, and throw
+    //      away whatever it asked to be sent back.
+    const std::wstring_view reset{ L"\x1b[?1049l\x1b[!p" };
+    gci.GetActiveOutputBuffer().GetStateMachine().ProcessString(reset.data(), reset.size());
+    gci.pInputBuffer->Flush();
+
+    m_state->CleanupNewTextBufferInfo();
+    return cost;
+}
+
+void VtCostTests::FuzzedStreamCost()
+{
+    String corpus;
+    if (FAILED(RuntimeParameters::TryGetValue(L"VtCostCorpus", corpus)) || corpus.IsEmpty())
+    {
+        Log::Result(TestResults::Skipped, L"No /p:VtCostCorpus=<directory> to measure.");
+        return;
+    }
+
+    const std::filesystem::path corpusPath{ static_cast<const wchar_t*>(corpus) };
+    String saveTo;
+    const std::filesystem::path savePath = SUCCEEDED(RuntimeParameters::TryGetValue(L"VtCostSaveTo", saveTo)) && !saveTo.IsEmpty() ?
+                                               std::filesystem::path{ static_cast<const wchar_t*>(saveTo) } :
+                                               corpusPath / L"slow";
+
+    size_t measured = 0;
+    size_t slow = 0;
+    for (const auto& entry : std::filesystem::directory_iterator{ corpusPath })
+    {
+        if (!entry.is_regular_file())
+        {
+            continue;
+        }
+
+        const auto stream = ReadStream(entry.path());
+        if (stream.empty())
+        {
+            continue;
+        }
+
+        const auto once = _Measure(stream, 1);
+        const auto repeated = _Measure(stream, s_Repeats);
+        ++measured;
+
+        const double perChar = once.microseconds / stream.size();
+        const double growth = once.microseconds > 0 ? repeated.microseconds / (once.microseconds * s_Repeats) : 0;
+        const bool tooSlow = perChar > s_MaxMicrosecondsPerChar && once.microseconds > s_MinMeasurableMicroseconds;
+        const bool superlinear = growth > s_MaxGrowth && repeated.microseconds > s_MinMeasurableMicroseconds;
+        const bool tooBig = std::max(once.privateBytes, repeated.privateBytes) > s_MaxPrivateBytes;
+
+        const auto name = entry.path().filename().wstring();
+        Log::Comment(String().Format(L"COST %s: %Iu chars, %.0f us (%.2f us/char), x%Iu %.0f us (%.2fx linear), +%Iu KB, buffer %dx%d",
+                                     name.c_str(),
+                                     stream.size(),
+                                     once.microseconds,
+                                     perChar,
+                                     s_Repeats,
+                                     repeated.microseconds,
+                                     growth,
+                                     std::max(once.privateBytes, repeated.privateBytes) / 1024,
+                                     repeated.bufferSize.X,
+                                     repeated.bufferSize.Y));
+
+        if (tooSlow || superlinear || tooBig)
+        {
+            ++slow;
+            Log::Warning(String().Format(L"%s is slow:%s%s%s",
+                                         name.c_str(),
+                                         tooSlow ? L" too slow per character" : L"",
+                                         superlinear ? L" superlinear in its length" : L"",
+                                         tooBig ? L" grows the process too much" : L""));
+
+            std::error_code error;
+            std::filesystem::create_directories(savePath, error);
+            std::filesystem::copy_file(entry.path(), savePath / entry.path().filename(), std::filesystem::copy_options::overwrite_existing, error);
+            VERIFY_IS_FALSE(static_cast<bool>(error), String().Format(L"Saving %s to %s", name.c_str(), savePath.c_str()));
+        }
+    }
+
+    Log::Comment(String().Format(L"Measured %Iu streams, %Iu of them slow.", measured, slow));
+    VERIFY_ARE_EQUAL(size_t{ 0 }, slow);
+}
@@ -27,6 +27,7 @@ class Microsoft::Console::VirtualTerminal::VtIoTests
     // General Tests:
     TEST_METHOD(NoOpStartTest);
     TEST_METHOD(ModeParsingTest);
+    TEST_METHOD(PassThroughSafeTest);
 
     TEST_METHOD(DtorTestJustEngine);
     TEST_METHOD(DtorTestDeleteVtio);
@@ -89,6 +90,38 @@ void VtIoTests::ModeParsingTest()
     VERIFY_ARE_EQUAL(mode, VtIoMode::INVALID);
 }
 
+void VtIoTests::PassThroughSafeTest()
+{
+    Log::Comment(L"Text, cursor movement, erasing and colors are passed through.");
+    VERIFY_IS_TRUE(VtIo::s_IsPassThroughSafe(L""));
+    VERIFY_IS_TRUE(VtIo::s_IsPassThroughSafe(L"Hello\r\nWorld\b\t!"));
+    VERIFY_IS_TRUE(VtIo::s_IsPassThroughSafe(L"\x1b[H\x1b[2J\x1b[5;10H\x1b[K\x1b[3X"));
+    VERIFY_IS_TRUE(VtIo::s_IsPassThroughSafe(L"\x1b[m\x1b[1;4;31;42m\x1b[;22;24;39;49m"));
+    VERIFY_IS_TRUE(VtIo::s_IsPassThroughSafe(L"\x1b[38;5;123;48;2;1;2;3m"));
+    VERIFY_IS_TRUE(VtIo::s_IsPassThroughSafe(L"\x1b[?25l\x1b[?1049h\x1b[?1049l\x1b[?25h"));
+    VERIFY_IS_TRUE(VtIo::s_IsPassThroughSafe(L"\x1b]0;title\x07\x1b]2;title\x1b\\"));
+
+    Log::Comment(L"Queries we answer are not.");
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b[6n"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b[c"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b[18t"));
+
+    Log::Comment(L"Nor are margins, other modes, or attributes we don't keep.");
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b[2;10r"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b[?1h"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b[7m"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b[38;5m"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b[38;5;256m"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b]4;1;rgb:00/00/00\x07"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b" L"7"));
+
+    Log::Comment(L"Nor are other control characters, or sequences left unfinished.");
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x07"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"abc\x1b"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"abc\x1b[3"));
+    VERIFY_IS_FALSE(VtIo::s_IsPassThroughSafe(L"\x1b]0;unfinished"));
+}
+
 Viewport SetUpViewport()
 {
     SMALL_RECT view = {};
@@ -95,6 +95,7 @@ class Microsoft::Console::Render::VtRendererTest
 
     TEST_METHOD(Xterm256TestInvalidate);
     TEST_METHOD(Xterm256TestColors);
+    TEST_METHOD(Xterm256TestGraphicsRendition);
     TEST_METHOD(Xterm256TestCursor);
 
     TEST_METHOD(XtermTestInvalidate);
@@ -109,6 +110,18 @@ class Microsoft::Console::Render::VtRendererTest
 
     TEST_METHOD(TestResize);
 
+    TEST_METHOD(TestDirtyRows);
+
+    TEST_METHOD(TestShadowFrame);
+
+    TEST_METHOD(TestRunCompression);
+
+    TEST_METHOD(TestScrollRegion);
+
+    TEST_METHOD(TestPassThrough);
+
+    TEST_METHOD(TestReattach);
+
     void Test16Colors(VtEngine* engine);
 
     std::deque<std::string> qExpectedInput;
@@ -247,6 +260,9 @@ void VtRendererTest::VtSequenceHelperTests()
 
     qExpectedInput.push_back("\x1b[10C");
     VERIFY_SUCCEEDED(engine->_CursorForward(10));
+
+    qExpectedInput.push_back("\x1b[5b");
+    VERIFY_SUCCEEDED(engine->_RepeatCharacter(5));
 }
 
 void VtRendererTest::Xterm256TestInvalidate()
@@ -428,8 +444,7 @@ void VtRendererTest::Xterm256TestColors()
         L"Begin by setting some test values - FG,BG = (1,2,3), (4,5,6) to start"
         L"These values were picked for ease of formatting raw COLORREF values."
     ));
-    qExpectedInput.push_back("\x1b[38;2;1;2;3m");
-    qExpectedInput.push_back("\x1b[48;2;5;6;7m");
+    qExpectedInput.push_back("\x1b[38;2;1;2;3;48;2;5;6;7m");
     VERIFY_SUCCEEDED(engine->UpdateDrawingBrushes(0x00030201, 0x00070605, 0, false, false));
 
     TestPaint(*engine, [&]()
@@ -517,6 +532,63 @@ void VtRendererTest::Xterm256TestColors()
     });
 }
 
+void VtRendererTest::Xterm256TestGraphicsRendition()
+{
+    wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    std::unique_ptr<Xterm256Engine> engine = std::make_unique<Xterm256Engine>(std::move(hFile), p, SetUpViewport(), g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE));
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+
+    // Verify the first paint emits a clear and go home
+    qExpectedInput.push_back("\x1b[2J");
+    VERIFY_IS_TRUE(engine->_firstPaint);
+    TestPaint(*engine, [&]() {
+        VERIFY_IS_FALSE(engine->_firstPaint);
+    });
+
+    Log::Comment(NoThrowString().Format(
+        L"Test that every attribute that changes is written in the same sequence, "
+        L"and that a reset is used when it's shorter."
+    ));
+
+    qExpectedInput.push_back("\x1b[m");
+    VERIFY_SUCCEEDED(engine->UpdateDrawingBrushes(g_ColorTable[15], g_ColorTable[0], 0, false, false));
+
+    TestPaint(*engine, [&]()
+    {
+        Log::Comment(NoThrowString().Format(
+            L"----Bold, underlined, DARK_RED on the default BG----"
+        ));
+        qExpectedInput.push_back("\x1b[1;4;31m");
+        VERIFY_SUCCEEDED(engine->UpdateDrawingBrushes(g_ColorTable[4], g_ColorTable[0], COMMON_LVB_UNDERSCORE, true, false));
+
+        Log::Comment(NoThrowString().Format(
+            L"----Nothing changed----"
+        ));
+        qExpectedInput.push_back(EMPTY_CALLBACK_SENTINEL);
+        VERIFY_SUCCEEDED(engine->UpdateDrawingBrushes(g_ColorTable[4], g_ColorTable[0], COMMON_LVB_UNDERSCORE, true, false));
+        WriteCallback(EMPTY_CALLBACK_SENTINEL, 1); // This will make sure nothing was written to the callback
+
+        Log::Comment(NoThrowString().Format(
+            L"----Default colors, still bold. A reset and bold is shorter than ending the underline and the FG----"
+        ));
+        qExpectedInput.push_back("\x1b[0;1m");
+        VERIFY_SUCCEEDED(engine->UpdateDrawingBrushes(g_ColorTable[15], g_ColorTable[0], 0, true, false));
+
+        Log::Comment(NoThrowString().Format(
+            L"----Change the FG and BG together----"
+        ));
+        qExpectedInput.push_back("\x1b[37;48;2;1;1;1m");
+        VERIFY_SUCCEEDED(engine->UpdateDrawingBrushes(g_ColorTable[7], 0x010101, 0, true, false));
+
+        Log::Comment(NoThrowString().Format(
+            L"----Back to defaults----"
+        ));
+        qExpectedInput.push_back("\x1b[m");
+        VERIFY_SUCCEEDED(engine->UpdateDrawingBrushes(g_ColorTable[15], g_ColorTable[0], 0, false, false));
+    });
+}
+
 void VtRendererTest::Xterm256TestCursor()
 {
     wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
@@ -1338,3 +1410,339 @@ void VtRendererTest::TestResize()
 
 
 }
+
+void VtRendererTest::TestDirtyRows()
+{
+    Viewport view = SetUpViewport();
+    wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    auto engine = std::make_unique<Xterm256Engine>(std::move(hFile), p, view, g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE));
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+
+    // Verify the first paint emits a clear and go home
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaint(*engine, [&]() {
+        VERIFY_IS_FALSE(engine->_firstPaint);
+    });
+
+    Log::Comment(NoThrowString().Format(
+        L"Make sure that invalidating two distant rows only paints those two rows"
+    ));
+    SMALL_RECT top = {0, 0, 5, 1};
+    SMALL_RECT bottom = {2, 20, 10, 21};
+    VERIFY_SUCCEEDED(engine->Invalidate(&top));
+    VERIFY_SUCCEEDED(engine->Invalidate(&bottom));
+    TestPaint(*engine, [&]()
+    {
+        // The bounding rectangle still covers everything in between.
+        VERIFY_ARE_EQUAL(Viewport::Union(Viewport::FromExclusive(top), Viewport::FromExclusive(bottom)), engine->_invalidRect);
+
+        const auto area = engine->GetDirtyArea();
+        VERIFY_ARE_EQUAL(2u, area.size());
+        VERIFY_ARE_EQUAL(Viewport::FromExclusive(top), Viewport::FromInclusive(area.at(0)));
+        VERIFY_ARE_EQUAL(Viewport::FromExclusive(bottom), Viewport::FromInclusive(area.at(1)));
+    });
+
+    Log::Comment(NoThrowString().Format(
+        L"Make sure that the dirty rows are clean again after painting"
+    ));
+    VERIFY_IS_TRUE(engine->GetDirtyArea().empty());
+}
+
+void VtRendererTest::TestShadowFrame()
+{
+    Viewport view = SetUpViewport();
+    wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    auto engine = std::make_unique<Xterm256Engine>(std::move(hFile), p, view, g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE));
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+
+    // Verify the first paint emits a clear and go home
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaint(*engine, [&]() {
+        VERIFY_IS_FALSE(engine->_firstPaint);
+    });
+
+    const auto makeClusters = [](const wchar_t* const line) {
+        std::vector<Cluster> clusters;
+        for (size_t i = 0; i < wcslen(line); i++)
+        {
+            clusters.emplace_back(std::wstring_view{ &line[i], 1 }, static_cast<size_t>(1));
+        }
+        return clusters;
+    };
+
+    const auto first = makeClusters(L"progress: 10%");
+    const auto second = makeClusters(L"progress: 20%");
+
+    TestPaintXterm(*engine, [&]()
+    {
+        Log::Comment(NoThrowString().Format(
+            L"The first time a line is painted, all of it is written."
+        ));
+        qExpectedInput.push_back("\x1b[H");
+        VERIFY_SUCCEEDED(engine->_MoveCursor({0, 0}));
+
+        qExpectedInput.push_back("progress: 10%");
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ first.data(), first.size() }, { 0, 0 }, false));
+    });
+
+    TestPaintXterm(*engine, [&]()
+    {
+        Log::Comment(NoThrowString().Format(
+            L"Painting the same line again writes nothing at all."
+        ));
+        qExpectedInput.push_back(EMPTY_CALLBACK_SENTINEL);
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ first.data(), first.size() }, { 0, 0 }, false));
+        WriteCallback(EMPTY_CALLBACK_SENTINEL, 1);
+    });
+
+    TestPaintXterm(*engine, [&]()
+    {
+        Log::Comment(NoThrowString().Format(
+            L"Painting it with one character changed only writes that character."
+        ));
+        qExpectedInput.push_back("\x1b[1;11H");
+        qExpectedInput.push_back("2");
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ second.data(), second.size() }, { 0, 0 }, false));
+    });
+
+    TestPaintXterm(*engine, [&]()
+    {
+        Log::Comment(NoThrowString().Format(
+            L"After the screen is cleared, the whole line is written again."
+        ));
+        qExpectedInput.push_back("\x1b[2J");
+        VERIFY_SUCCEEDED(engine->_ClearScreen());
+
+        qExpectedInput.push_back("\x1b[H");
+        qExpectedInput.push_back("progress: 20%");
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ second.data(), second.size() }, { 0, 0 }, false));
+    });
+}
+
+void VtRendererTest::TestRunCompression()
+{
+    Viewport view = SetUpViewport();
+    wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    auto engine = std::make_unique<Xterm256Engine>(std::move(hFile), p, view, g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE));
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+
+    // Verify the first paint emits a clear and go home
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaint(*engine, [&]() {
+        VERIFY_IS_FALSE(engine->_firstPaint);
+    });
+
+    const auto makeClusters = [](const std::wstring& line) {
+        std::vector<Cluster> clusters;
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            clusters.emplace_back(std::wstring_view{ &line[i], 1 }, static_cast<size_t>(1));
+        }
+        return clusters;
+    };
+
+    const auto first = makeClusters(L"ab" + std::wstring(20, L' ') + L"cd" + std::wstring(30, L'-'));
+    const auto second = makeClusters(L"xyz" + std::wstring(view.Width() - 3, L' '));
+
+    TestPaintXterm(*engine, [&]()
+    {
+        qExpectedInput.push_back("\x1b[H");
+        VERIFY_SUCCEEDED(engine->_MoveCursor({0, 0}));
+
+        Log::Comment(NoThrowString().Format(
+            L"A run of spaces is erased and skipped over, and a run of the same "
+            L"character is written once and repeated."
+        ));
+        qExpectedInput.push_back("ab");
+        qExpectedInput.push_back("\x1b[20X");
+        qExpectedInput.push_back("\x1b[20C");
+        qExpectedInput.push_back("cd-");
+        qExpectedInput.push_back("\x1b[29b");
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ first.data(), first.size() }, { 0, 0 }, false));
+
+        Log::Comment(NoThrowString().Format(
+            L"Spaces that run to the end of the line are erased with EL."
+        ));
+        qExpectedInput.push_back("\r\n");
+        qExpectedInput.push_back("xyz");
+        qExpectedInput.push_back("\x1b[K");
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ second.data(), second.size() }, { 0, 1 }, false));
+
+        qExpectedInput.push_back("\r\n");
+        VERIFY_SUCCEEDED(engine->_MoveCursor({0, 2}));
+    });
+}
+
+void VtRendererTest::TestScrollRegion()
+{
+    Viewport view = SetUpViewport();
+    wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    auto engine = std::make_unique<Xterm256Engine>(std::move(hFile), p, view, g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE));
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+
+    // Verify the first paint emits a clear and go home
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaint(*engine, [&]() {
+        VERIFY_IS_FALSE(engine->_firstPaint);
+    });
+
+    const SHORT width = view.Width();
+    const SMALL_RECT region = { 0, 5, width, 20 };
+    const COORD up = { 0, -1 };
+
+    Log::Comment(NoThrowString().Format(
+        L"Rows scrolling inside of margins only invalidate the row that was uncovered."
+    ));
+    VERIFY_SUCCEEDED(engine->InvalidateScrollRegion(&region, &up));
+    VERIFY_ARE_EQUAL(-1, engine->_scrollRegionDelta);
+    VERIFY_ARE_EQUAL(Viewport::FromExclusive({ 0, 19, width, 20 }), engine->_invalidRect);
+
+    TestPaintXterm(*engine, [&]()
+    {
+        Log::Comment(NoThrowString().Format(
+            L"The terminal's margins are set around the rows, they're scrolled, "
+            L"and the margins are set back."
+        ));
+        qExpectedInput.push_back("\x1b[6;20r");
+        qExpectedInput.push_back("\x1b[1S");
+        qExpectedInput.push_back("\x1b[r");
+        VERIFY_SUCCEEDED(engine->ScrollFrame());
+
+        const COORD home = { 0, 0 };
+        VERIFY_ARE_EQUAL(home, engine->_lastText);
+    });
+
+    Log::Comment(NoThrowString().Format(
+        L"Rows that aren't as wide as the terminal can't be scrolled with margins."
+    ));
+    const SMALL_RECT narrow = { 0, 5, static_cast<SHORT>(width / 2), 20 };
+    VERIFY_SUCCEEDED(engine->InvalidateScrollRegion(&narrow, &up));
+    VERIFY_ARE_EQUAL(0, engine->_scrollRegionDelta);
+    VERIFY_ARE_EQUAL(Viewport::FromExclusive(narrow), engine->_invalidRect);
+
+    Log::Comment(NoThrowString().Format(
+        L"Scrolling all of the screen after some of it scrolled repaints the region instead."
+    ));
+    VERIFY_SUCCEEDED(engine->InvalidateScrollRegion(&region, &up));
+    VERIFY_ARE_EQUAL(-1, engine->_scrollRegionDelta);
+    VERIFY_SUCCEEDED(engine->InvalidateScroll(&up));
+    VERIFY_ARE_EQUAL(0, engine->_scrollRegionDelta);
+    VERIFY_ARE_EQUAL(-1, engine->_scrollDelta.Y);
+}
+
+void VtRendererTest::TestPassThrough()
+{
+    Viewport view = SetUpViewport();
+    wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    auto engine = std::make_unique<Xterm256Engine>(std::move(hFile), p, view, g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE));
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+
+    const COLORREF foreground = RGB(1, 2, 3);
+    const COLORREF background = p.GetDefaultBackground();
+
+    Log::Comment(NoThrowString().Format(
+        L"Nothing can be passed through before the first frame is painted."
+    ));
+    VERIFY_ARE_EQUAL(S_FALSE, engine->BeginPassThrough(L"hello", { 5, 3 }, foreground, background, 0, false));
+
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaint(*engine, [&]() {
+        VERIFY_IS_FALSE(engine->_firstPaint);
+    });
+
+    Log::Comment(NoThrowString().Format(
+        L"The attributes and the cursor are set to the buffer's, and then the "
+        L"output is written as it is."
+    ));
+    qExpectedInput.push_back("\x1b[0;38;2;1;2;3m");
+    qExpectedInput.push_back("\x1b[4;6H");
+    qExpectedInput.push_back("hello");
+    VERIFY_ARE_EQUAL(S_OK, engine->BeginPassThrough(L"hello", { 5, 3 }, foreground, background, 0, false));
+    VERIFY_IS_TRUE(engine->_passingThrough);
+
+    Log::Comment(NoThrowString().Format(
+        L"What the output does to the buffer isn't painted again."
+    ));
+    const SMALL_RECT invalid = { 5, 3, 10, 4 };
+    const COORD up = { 0, -1 };
+    bool forcePaint = true;
+    VERIFY_SUCCEEDED(engine->Invalidate(&invalid));
+    VERIFY_SUCCEEDED(engine->InvalidateScroll(&up));
+    VERIFY_SUCCEEDED(engine->InvalidateCircling(&forcePaint));
+    VERIFY_IS_FALSE(engine->_fInvalidRectUsed);
+    VERIFY_ARE_EQUAL(0, engine->_scrollDelta.Y);
+    VERIFY_IS_FALSE(forcePaint);
+    VERIFY_IS_FALSE(engine->_circled);
+
+    const COORD cursor = { 10, 3 };
+    engine->EndPassThrough(cursor);
+    VERIFY_IS_FALSE(engine->_passingThrough);
+    VERIFY_ARE_EQUAL(cursor, engine->_lastText);
+
+    Log::Comment(NoThrowString().Format(
+        L"The output might have changed the attributes, so the next ones are "
+        L"written in full, even if they're the same."
+    ));
+    qExpectedInput.push_back("\x1b[0;38;2;1;2;3m");
+    VERIFY_SUCCEEDED(engine->UpdateDrawingBrushes(foreground, background, 0, false, false));
+
+    Log::Comment(NoThrowString().Format(
+        L"Once there's something waiting to be painted, output can't be passed "
+        L"through until it has been."
+    ));
+    VERIFY_SUCCEEDED(engine->Invalidate(&invalid));
+    VERIFY_ARE_EQUAL(S_FALSE, engine->BeginPassThrough(L"hello", cursor, foreground, background, 0, false));
+    VERIFY_IS_FALSE(engine->_passingThrough);
+}
+
+void VtRendererTest::TestReattach()
+{
+    Viewport view = SetUpViewport();
+    wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    auto engine = std::make_unique<Xterm256Engine>(std::move(hFile), p, view, g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE));
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaint(*engine, [&]() {
+        VERIFY_IS_FALSE(engine->_firstPaint);
+    });
+
+    VtEngine::ReattachRow row;
+    row.text = L"ab";
+    row.clusters = { { 1, 1 }, { 1, 1 } };
+    row.runs = { { 2, RGB(1, 2, 3), p.GetDefaultBackground(), 0, false } };
+    row.wrapped = false;
+    engine->Reattach({ row });
+
+    Log::Comment(NoThrowString().Format(
+        L"The next frame resets the terminal, writes the scrollback rows and "
+        L"scrolls them off the screen, and then paints the whole viewport."
+    ));
+    qExpectedInput.push_back("\x1b[m");
+    qExpectedInput.push_back("\x1b[r");
+    qExpectedInput.push_back("\x1b[H");
+    qExpectedInput.push_back("\x1b[2J");
+    qExpectedInput.push_back("\x1b[3J");
+    qExpectedInput.push_back("\x1b[0;38;2;1;2;3m");
+    qExpectedInput.push_back("ab");
+    qExpectedInput.push_back("\r\n");
+    qExpectedInput.push_back(std::string(static_cast<size_t>(view.Height() - 1), '\n'));
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaintXterm(*engine, [&]() {
+        VERIFY_IS_TRUE(engine->_clearedAllThisFrame);
+        VERIFY_ARE_EQUAL(VtEngine::INVALID_COORDS, engine->_lastText);
+        VERIFY_ARE_EQUAL(view, Viewport::FromInclusive(engine->GetDirtyRectInChars()));
+    });
+
+    Log::Comment(NoThrowString().Format(
+        L"It's only done the once."
+    ));
+    VERIFY_IS_FALSE(engine->_reattachPending);
+    VERIFY_ARE_EQUAL(0u, engine->_reattachScrollback.size());
+}
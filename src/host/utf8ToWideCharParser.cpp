@@ -6,6 +6,10 @@
 #include "utf8ToWideCharParser.hpp"
 #include <unicode.hpp>
 
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 #ifndef WIL_ENABLE_EXCEPTIONS
 #error WIL exception helpers must be enabled
 #endif
@@ -29,7 +33,7 @@ Utf8ToWideCharParser::Utf8ToWideCharParser(const unsigned int codePage) :
     _currentCodePage { codePage },
     _bytesStored { 0 },
     _currentState { _State::Ready },
-    _convertedWideChars { nullptr }
+    _convertedWideChars {}
 {
     std::fill_n(_utf8CodePointPieces, _UTF8_BYTE_SEQUENCE_MAX, 0ui8);
 }
@@ -72,8 +76,47 @@ HRESULT Utf8ToWideCharParser::Parse(_In_reads_(cchBuffer) const byte* const pByt
                                     _Inout_ std::unique_ptr<wchar_t[]>& converted,
                                     _Out_ unsigned int& cchConverted)
 {
-    cchConsumed = 0;
     cchConverted = 0;
+    converted.reset(nullptr);
+
+    HRESULT hr = Parse(pBytes, cchBuffer, cchConsumed, _convertedWideChars);
+    if (SUCCEEDED(hr) && !_convertedWideChars.empty())
+    {
+        try
+        {
+            converted = std::make_unique<wchar_t[]>(_convertedWideChars.size());
+            std::copy(_convertedWideChars.cbegin(), _convertedWideChars.cend(), converted.get());
+            cchConverted = gsl::narrow<unsigned int>(_convertedWideChars.size());
+        }
+        catch (...)
+        {
+            _Reset();
+            hr = wil::ResultFromCaughtException();
+        }
+    }
+    return hr;
+}
+
+// Routine Description:
+// - Parses the input multi-byte sequence into a buffer the caller
+// provides, so that it can be reused from one call to the next.
+// Arguments:
+// - pBytes - The byte sequence to parse.
+// - cchBuffer - The amount of bytes in pBytes.
+// - cchConsumed - The number of bytes consumed from pBytes.
+// - converted - Receives the parsed wide chars, replacing whatever it
+// held. Empty if an error occurs (or if there's nothing to give back
+// yet).
+// Return Value:
+// - S_OK, or an error if the bytes couldn't be parsed.
+[[nodiscard]]
+HRESULT Utf8ToWideCharParser::Parse(_In_reads_(cchBuffer) const byte* const pBytes,
+                                    _In_ unsigned int const cchBuffer,
+                                    _Out_ unsigned int& cchConsumed,
+                                    std::wstring& converted)
+{
+    cchConsumed = 0;
+    converted.clear();
 
     // we can't parse anything if we weren't given any data to parse
     if (cchBuffer == 0)
@@ -89,22 +132,20 @@ HRESULT Utf8ToWideCharParser::Parse(_In_reads_(cchBuffer) const byte* const pByt
     try
     {
         bool loop = true;
-        unsigned int wideCharCount = 0;
-        _convertedWideChars.reset(nullptr);
         while (loop)
         {
             switch(_currentState)
             {
                 case _State::Ready:
-                    wideCharCount = _ParseFullRange(pBytes, cchBuffer);
+                    _ParseFullRange(pBytes, cchBuffer, converted);
                     break;
                 case _State::BeginPartialParse:
-                    wideCharCount = _InvolvedParse(pBytes, cchBuffer);
+                    _InvolvedParse(pBytes, cchBuffer, converted);
                     break;
                 case _State::Error:
                     hr = E_FAIL;
                     _Reset();
-                    wideCharCount = 0;
+                    converted.clear();
                     loop = false;
                     break;
                 case _State::Finished:
@@ -122,12 +163,11 @@ HRESULT Utf8ToWideCharParser::Parse(_In_reads_(cchBuffer) const byte* const pByt
                     break;
             }
         }
-        converted.swap(_convertedWideChars);
-        cchConverted = wideCharCount;
     }
     catch (...)
     {
         _Reset();
+        converted.clear();
         hr = wil::ResultFromCaughtException();
     }
     return hr;
@@ -281,28 +321,24 @@ unsigned int Utf8ToWideCharParser::_Utf8SequenceSize(_In_ byte ch)
 // Routine Description:
 // - Attempts to parse pInputChars by themselves in wide chars,
 // without using any saved partial byte sequences. On success,
-// _convertedWideChars will contain the converted wide char sequence
+// converted will contain the converted wide char sequence
 // and _currentState will be set to _State::Finished. On failure,
 // _currentState will be set to either _State::Error or
 // _State::BeginPartialParse.
 // Arguments:
 // - pInputChars - The byte sequence to convert to wide chars.
 // - cb - The amount of bytes in pInputChars.
+// - converted - Receives the wide chars.
 // Return Value:
-// - The amount of wide chars that are stored in _convertedWideChars,
+// - The amount of wide chars that are stored in converted,
 // or 0 if pInputChars cannot be successfully converted.
-unsigned int Utf8ToWideCharParser::_ParseFullRange(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb)
+unsigned int Utf8ToWideCharParser::_ParseFullRange(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb, std::wstring& converted)
 {
-    int bufferSize = MultiByteToWideChar(_currentCodePage,
-                                         MB_ERR_INVALID_CHARS,
-                                         reinterpret_cast<LPCCH>(pInputChars),
-                                         cb,
-                                         nullptr,
-                                         0);
-    if (bufferSize == 0)
+    const DWORD err = _AppendWideChars(pInputChars, cb, converted);
+    if (err != ERROR_SUCCESS)
     {
-        DWORD err = GetLastError();
         LOG_WIN32(err);
+        converted.clear();
         if (err == ERROR_NO_UNICODE_TRANSLATION)
         {
             _currentState = _State::BeginPartialParse;
@@ -314,24 +350,9 @@ unsigned int Utf8ToWideCharParser::_ParseFullRange(_In_reads_(cb) const byte* co
     }
     else
     {
-        _convertedWideChars = std::make_unique<wchar_t[]>(bufferSize);
-        bufferSize = MultiByteToWideChar(_currentCodePage,
-                                         0,
-                                         reinterpret_cast<LPCCH>(pInputChars),
-                                         cb,
-                                         _convertedWideChars.get(),
-                                         bufferSize);
-        if (bufferSize == 0)
-        {
-            LOG_LAST_ERROR();
-            _currentState = _State::Error;
-        }
-        else 
-        {
-            _currentState = _State::Finished;
-        }
+        _currentState = _State::Finished;
     }
-    return bufferSize;
+    return gsl::narrow<unsigned int>(converted.size());
 }
 
 // Routine Description:
@@ -347,12 +368,13 @@ unsigned int Utf8ToWideCharParser::_ParseFullRange(_In_reads_(cb) const byte* co
 // Arguments:
 // - pInputChars - The byte sequence to convert to wide chars.
 // - cb - The amount of bytes in pInputChars.
+// - converted - Receives the wide chars.
 // Return Value:
-// - The amount of wide chars that are stored in _convertedWideChars,
+// - The amount of wide chars that are stored in converted,
 // or 0 if pInputChars cannot be successfully converted or if the
 // parser requires additional bytes before returning a valid wide
 // char.
-unsigned int Utf8ToWideCharParser::_InvolvedParse(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb)
+unsigned int Utf8ToWideCharParser::_InvolvedParse(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb, std::wstring& converted)
 {
     // Do safe math to add up the count and error if it won't fit.
     unsigned int count;
@@ -378,41 +400,169 @@ unsigned int Utf8ToWideCharParser::_InvolvedParse(_In_reads_(cb) const byte* con
         _currentState = _State::AwaitingMoreBytes;
         return 0;
     }
-    int bufferSize = MultiByteToWideChar(_currentCodePage,
-                                         MB_ERR_INVALID_CHARS,
-                                         reinterpret_cast<LPCCH>(validSequence.first.get()),
-                                         validSequence.second,
-                                         nullptr,
-                                         0);
-    if (bufferSize == 0)
+    const DWORD err = _AppendWideChars(validSequence.first.get(), validSequence.second, converted);
+    if (err != ERROR_SUCCESS)
     {
-        LOG_LAST_ERROR();
+        LOG_WIN32(err);
+        converted.clear();
         _currentState = _State::Error;
     }
+    else if (_bytesStored > 0)
+    {
+        _currentState = _State::AwaitingMoreBytes;
+    }
     else
     {
-        _convertedWideChars = std::make_unique<wchar_t[]>(bufferSize);
-        bufferSize = MultiByteToWideChar(_currentCodePage,
-                                        0,
-                                        reinterpret_cast<LPCCH>(validSequence.first.get()),
-                                        validSequence.second,
-                                        _convertedWideChars.get(),
-                                        bufferSize);
-        if (bufferSize == 0)
+        _currentState = _State::Finished;
+    }
+    return gsl::narrow<unsigned int>(converted.size());
+}
+
+// Routine Description:
+// - Converts a byte sequence that ends on a whole character to wide
+// chars, appending them to converted. Runs of ASCII are widened here,
+// and everything in between them goes through MultiByteToWideChar. A
+// multi-byte sequence never has an ASCII byte in it, so it's never
+// split by where the runs start and end.
+// Arguments:
+// - pInputChars - The byte sequence to convert to wide chars.
+// - cb - The amount of bytes in pInputChars.
+// - converted - The wide chars to append to.
+// Return Value:
+// - ERROR_SUCCESS, or the error MultiByteToWideChar failed with. This is
+// ERROR_NO_UNICODE_TRANSLATION if there was an invalid sequence.
+DWORD Utf8ToWideCharParser::_AppendWideChars(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb, std::wstring& converted)
+{
+    // Like MultiByteToWideChar, there's nothing to convert in an empty sequence.
+    if (cb == 0)
+    {
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    // A byte never turns into more than one wide char.
+    converted.reserve(converted.size() + cb);
+
+    size_t position = 0;
+    while (position < cb)
+    {
+        const size_t cbAscii = s_AsciiRunLength(pInputChars + position, cb - position);
+        s_AppendAscii(pInputChars + position, cbAscii, converted);
+        position += cbAscii;
+        if (position == cb)
         {
-            LOG_LAST_ERROR();
-            _currentState = _State::Error;
+            break;
         }
-        else if (_bytesStored > 0)
+
+        const size_t cbOther = s_NonAsciiRunLength(pInputChars + position, cb - position);
+        const size_t start = converted.size();
+        converted.resize(start + cbOther);
+        const int cch = MultiByteToWideChar(_currentCodePage,
+                                            MB_ERR_INVALID_CHARS,
+                                            reinterpret_cast<LPCCH>(pInputChars + position),
+                                            gsl::narrow<int>(cbOther),
+                                            converted.data() + start,
+                                            gsl::narrow<int>(cbOther));
+        if (cch == 0)
         {
-            _currentState = _State::AwaitingMoreBytes;
+            return GetLastError();
         }
-        else
+        converted.resize(start + cch);
+        position += cbOther;
+    }
+    return ERROR_SUCCESS;
+}
+
+// Routine Description:
+// - Counts the ASCII bytes at the start of a byte sequence. Where SSE2 is
+// available, this checks 16 bytes at a time.
+// Arguments:
+// - pInputChars - The byte sequence to scan.
+// - cb - The amount of bytes in pInputChars.
+// Return Value:
+// - The index of the first byte that isn't ASCII, or cb if they all are.
+size_t Utf8ToWideCharParser::s_AsciiRunLength(_In_reads_(cb) const byte* const pInputChars, const size_t cb) noexcept
+{
+    size_t i = 0;
+
+#if defined(_M_IX86) || defined(_M_X64)
+    for (; i + 16 <= cb; i += 16)
+    {
+        // The mask is just the most significant bit of every byte.
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pInputChars + i));
+        const auto mask = static_cast<unsigned long>(_mm_movemask_epi8(bytes));
+        if (mask != 0)
+        {
+            unsigned long bit = 0;
+            _BitScanForward(&bit, mask);
+            return i + bit;
+        }
+    }
+#endif
+
+    while (i < cb && !IsBitSet(pInputChars[i], NonAsciiBytePrefix))
+    {
+        ++i;
+    }
+    return i;
+}
+
+// Routine Description:
+// - Counts the bytes at the start of a byte sequence that come before the
+// next run of at least _MIN_ASCII_RUN ASCII bytes. Shorter runs of ASCII
+// are left in, for MultiByteToWideChar to convert along with the rest.
+// Arguments:
+// - pInputChars - The byte sequence to scan.
+// - cb - The amount of bytes in pInputChars.
+// Return Value:
+// - The index of the start of the next long run of ASCII, or cb if there isn't one.
+size_t Utf8ToWideCharParser::s_NonAsciiRunLength(_In_reads_(cb) const byte* const pInputChars, const size_t cb) noexcept
+{
+    size_t cbAscii = 0;
+    for (size_t i = 0; i < cb; ++i)
+    {
+        if (IsBitSet(pInputChars[i], NonAsciiBytePrefix))
+        {
+            cbAscii = 0;
+        }
+        else if (++cbAscii == _MIN_ASCII_RUN)
         {
-            _currentState = _State::Finished;
+            return i + 1 - _MIN_ASCII_RUN;
         }
     }
-    return bufferSize;
+    return cb;
+}
+
+// Routine Description:
+// - Widens ASCII bytes to wide chars, appending them to converted. Where
+// SSE2 is available, this widens 16 bytes at a time.
+// Arguments:
+// - pInputChars - The ASCII bytes.
+// - cb - The amount of bytes in pInputChars.
+// - converted - The wide chars to append to.
+// Return Value:
+// - <none>
+void Utf8ToWideCharParser::s_AppendAscii(_In_reads_(cb) const byte* const pInputChars, const size_t cb, std::wstring& converted)
+{
+    const size_t start = converted.size();
+    converted.resize(start + cb);
+    wchar_t* const pwch = converted.data() + start;
+
+    size_t i = 0;
+
+#if defined(_M_IX86) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= cb; i += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pInputChars + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pwch + i), _mm_unpacklo_epi8(bytes, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pwch + i + 8), _mm_unpackhi_epi8(bytes, zero));
+    }
+#endif
+
+    for (; i < cb; ++i)
+    {
+        pwch[i] = pInputChars[i];
+    }
 }
 
 // Routine Description:
@@ -508,5 +658,5 @@ void Utf8ToWideCharParser::_Reset()
 {
     _currentState = _State::Ready;
     _bytesStored = 0;
-    _convertedWideChars.reset(nullptr);
+    _convertedWideChars.clear();
 }
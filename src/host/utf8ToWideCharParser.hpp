@@ -9,6 +9,8 @@ Abstract:
 - This transforms a multi-byte character sequence into wide chars
 - It will attempt to work around invalid byte sequences
 - Partial byte sequences are supported
+- Runs of ASCII are widened directly, 16 bytes at a time where SSE2 is
+  available, and only the rest goes through MultiByteToWideChar
 
 Author(s):
 - Austin Diviness (AustDi) 16-August-2016
@@ -27,6 +29,11 @@ public:
                   _Out_ unsigned int& cchConsumed,
                   _Inout_ std::unique_ptr<wchar_t[]>& converted,
                   _Out_ unsigned int& cchConverted);
+    [[nodiscard]]
+    HRESULT Parse(_In_reads_(cchBuffer) const byte* const pBytes,
+                  _In_ unsigned int const cchBuffer,
+                  _Out_ unsigned int& cchConsumed,
+                  std::wstring& converted);
 
 private:
     enum class _State
@@ -44,8 +51,12 @@ private:
     bool _IsValidMultiByteSequence(_In_reads_(cb) const byte* const pLeadByte, const unsigned int cb);
     bool _IsPartialMultiByteSequence(_In_reads_(cb) const byte* const pLeadByte, const unsigned int cb);
     unsigned int _Utf8SequenceSize(_In_ byte ch);
-    unsigned int _ParseFullRange(_In_reads_(cb) const byte* const _InputChars, const unsigned int cb);
-    unsigned int _InvolvedParse(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb);
+    unsigned int _ParseFullRange(_In_reads_(cb) const byte* const _InputChars, const unsigned int cb, std::wstring& converted);
+    unsigned int _InvolvedParse(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb, std::wstring& converted);
+    DWORD _AppendWideChars(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb, std::wstring& converted);
+    static size_t s_AsciiRunLength(_In_reads_(cb) const byte* const pInputChars, const size_t cb) noexcept;
+    static size_t s_NonAsciiRunLength(_In_reads_(cb) const byte* const pInputChars, const size_t cb) noexcept;
+    static void s_AppendAscii(_In_reads_(cb) const byte* const pInputChars, const size_t cb, std::wstring& converted);
     std::pair<std::unique_ptr<byte[]>, unsigned int> _RemoveInvalidSequences(_In_reads_(cb) const byte* const pInputChars,
                                                                              const unsigned int cb);
     void _StorePartialSequence(_In_reads_(cb) const byte* const pLeadByte, const unsigned int cb);
@@ -53,10 +64,14 @@ private:
 
     static const unsigned int _UTF8_BYTE_SEQUENCE_MAX = 4;
 
+    // How many ASCII bytes in a row it takes for widening them ourselves to
+    // be worth another call to MultiByteToWideChar after them.
+    static const size_t _MIN_ASCII_RUN = 16;
+
     byte _utf8CodePointPieces[_UTF8_BYTE_SEQUENCE_MAX];
     unsigned int _bytesStored; // bytes stored in utf8CodePointPieces
     unsigned int _currentCodePage;
-    std::unique_ptr<wchar_t[]> _convertedWideChars;
+    std::wstring _convertedWideChars; // for the unique_ptr version of Parse
     _State _currentState;
 
 #ifdef UNIT_TESTING
@@ -0,0 +1,83 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "wordRuns.h"
+
+#include "cmdline.h"
+#include "../buffer/out/CharRow.hpp"
+
+#pragma hdrstop
+
+// Routine Description:
+// - Gets the run of word characters or delimiters that a cell is in.
+// Arguments:
+// - textBuffer - the buffer the cell is in.
+// - position - the cell. It must be inside the buffer.
+// Return Value:
+// - the run the cell is in.
+WordRunCache::Run WordRunCache::GetRun(const TextBuffer& textBuffer, const COORD position)
+{
+    const auto size = textBuffer.GetSize();
+    THROW_HR_IF(E_INVALIDARG, !size.IsInBounds(position));
+
+    if (_textBuffer != &textBuffer || _width != size.Width())
+    {
+        _rows.clear();
+        _textBuffer = &textBuffer;
+        _width = size.Width();
+    }
+
+    const uint64_t rowId = textBuffer.GetCircledRowCount() + position.Y;
+    const uint64_t generation = textBuffer.GetRowGeneration(position.Y);
+
+    auto found = _rows.find(rowId);
+    if (found == _rows.end() || found->second.generation != generation)
+    {
+        if (found == _rows.end() && _rows.size() >= s_MaxRows)
+        {
+            _rows.clear();
+        }
+
+        auto& row = _rows[rowId];
+        row.generation = generation;
+        std::optional<ROW> scratch;
+        row.runs = s_Measure(textBuffer.GetRowByOffset(position.Y, scratch));
+        found = _rows.find(rowId);
+    }
+
+    const auto& runs = found->second.runs;
+    const auto run = std::upper_bound(runs.cbegin(), runs.cend(), position.X, [](const SHORT column, const Run& run) {
+        return column < run.left;
+    });
+    return *std::prev(run);
+}
+
+// Routine Description:
+// - Splits a row into its runs. A glyph that's more than one character long is
+//   never a delimiter, and both halves of a wide glyph go along with the glyph.
+// Arguments:
+// - row - the row.
+// Return Value:
+// - the row's runs, from left to right.
+std::vector<WordRunCache::Run> WordRunCache::s_Measure(const ROW& row)
+{
+    const auto& charRow = row.GetCharRow();
+
+    std::vector<Run> runs;
+    for (size_t column = 0; column < charRow.size(); ++column)
+    {
+        const bool delimiter = IsWordDelim(std::wstring_view{ charRow.GlyphAt(column) });
+        const auto x = gsl::narrow<SHORT>(column);
+        if (runs.empty() || runs.back().delimiter != delimiter)
+        {
+            runs.push_back({ x, x, delimiter });
+        }
+        else
+        {
+            runs.back().right = x;
+        }
+    }
+    return runs;
+}
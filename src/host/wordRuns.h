@@ -0,0 +1,54 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- wordRuns.h
+
+Abstract:
+- Splits rows of a text buffer into runs of word characters and runs of word
+  delimiters, so that finding the edge of a word is a lookup rather than a walk
+  over every cell checking it against the delimiters.
+- A row's runs are worked out the first time they're asked for and kept until the
+  row's generation moves on, which it does whenever anything writes to it.
+--*/
+
+#pragma once
+
+#include "../buffer/out/textBuffer.hpp"
+
+class WordRunCache final
+{
+public:
+    // The cells from left to right (inclusive) of a row that are all word characters,
+    // or all delimiters.
+    struct Run
+    {
+        SHORT left;
+        SHORT right;
+        bool delimiter;
+    };
+
+    Run GetRun(const TextBuffer& textBuffer, const COORD position);
+
+private:
+    struct Row
+    {
+        uint64_t generation;
+        std::vector<Run> runs;
+    };
+
+    // Rows are only cached while they're being looked at. This many is plenty for
+    // selecting across a screenful of text.
+    static constexpr size_t s_MaxRows = 256;
+
+    static std::vector<Run> s_Measure(const ROW& row);
+
+    // The buffer the rows are from. If it's replaced or resized, they're all dropped.
+    const TextBuffer* _textBuffer = nullptr;
+    SHORT _width = 0;
+
+    // By the row's offset plus the number of rows that have circled off the top of the
+    // buffer, so that they stay put as it scrolls.
+    std::unordered_map<uint64_t, Row> _rows;
+};
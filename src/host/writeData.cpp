@@ -32,7 +32,8 @@ WriteData::WriteData(SCREEN_INFORMATION& siContext,
     _uiOutputCodepage(uiOutputCodepage),
     _fLeadByteCaptured(false),
     _fLeadByteConsumed(false),
-    _cchUtf8Consumed(0)
+    _cchUtf8Consumed(0),
+    _cbWritten(0)
 {
     memmove(_pwchContext, pwchContext, _cbContext);
 }
@@ -83,6 +84,18 @@ void WriteData::SetUtf8ConsumedCharacters(const size_t cchUtf8Consumed)
     _cchUtf8Consumed = cchUtf8Consumed;
 }
 
+// Routine Description:
+// - Remembers how much of the string was already written before the output was blocked, part of the
+//   way through it. The rest is written when the wait is serviced, and the byte count given back covers all of it.
+// Arguments:
+// - cbWritten - Byte count of the start of the string that's already been written.
+// Return Value:
+// - <none>
+void WriteData::SetBytesWrittenBeforeWait(const size_t cbWritten)
+{
+    _cbWritten = cbWritten;
+}
+
 // Routine Description:
 // - Called back at a later time to resume the writing operation when the output object becomes unblocked.
 // Arguments:
@@ -120,8 +133,8 @@ bool WriteData::Notify(const WaitTerminationReason TerminationReason,
     FAIL_FAST_IF(!(ServiceLocator::LocateGlobals().getConsoleInformation().IsConsoleLocked()));
 
     std::unique_ptr<WriteData> waiter;
-    size_t cbContext = _cbContext;
-    NTSTATUS Status = DoWriteConsole(_pwchContext,
+    size_t cbContext = _cbContext - _cbWritten;
+    NTSTATUS Status = DoWriteConsole(_pwchContext + _cbWritten / sizeof(wchar_t),
                                      &cbContext,
                                      _siContext,
                                      waiter);
@@ -129,10 +142,14 @@ bool WriteData::Notify(const WaitTerminationReason TerminationReason,
     if (Status == CONSOLE_STATUS_WAIT)
     {
         // an extra waiter will be created by DoWriteConsole, but we're already a waiter so discard it.
+        // If it got part of the way through before the output was blocked again, pick up after that next time.
+        _cbWritten += waiter->_cbWritten;
         waiter.reset();
         return false;
     }
 
+    cbContext += _cbWritten;
+
     // There's extra work to do to correct the byte counts if the original call was an A-version call.
     // We always process and hold text in the waiter as W-version text, but the A call is expecting
     // a byte value in its own codepage of how much we have written in that codepage.
@@ -35,6 +35,8 @@ public:
 
     void SetUtf8ConsumedCharacters(const size_t cchUtf8Consumed);
 
+    void SetBytesWrittenBeforeWait(const size_t cbWritten);
+
     bool Notify(const WaitTerminationReason TerminationReason,
                 const bool fIsUnicode,
                 _Out_ NTSTATUS* const pReplyStatus,
@@ -50,4 +52,5 @@ private:
     bool _fLeadByteCaptured;
     bool _fLeadByteConsumed;
     size_t _cchUtf8Consumed;
+    size_t _cbWritten;
 };
@@ -26,9 +26,11 @@
 #include <sstream>
 #include <strsafe.h>
 #include <memory>
+#include <atomic>
 #pragma once
 
 const unsigned int PTY_SIGNAL_RESIZE_WINDOW = 8u;
+const unsigned int PTY_SIGNAL_REATTACH = 10u;
 
 // A case-insensitive wide-character map is used to store environment variables
 // due to documented requirements:
@@ -64,6 +66,8 @@ bool SignalResizeWindow(const HANDLE hSignal,
                         const unsigned short w,
                         const unsigned short h);
 
+bool SignalReattach(const HANDLE hSignal);
+
 [[nodiscard]]
 HRESULT UpdateEnvironmentMapW(EnvironmentVariableMapW& map) noexcept;
 
@@ -191,6 +195,56 @@ HRESULT EnvironmentMapToEnvironmentStringsW(EnvironmentVariableMapW& map, std::v
     return S_OK;
 }
 
+// Function Description:
+// - Creates a pipe whose read side can be used for overlapped I/O. Anonymous
+//      pipes don't support that, so this is a named pipe with a unique name,
+//      which only this process can connect to (there's only ever one instance).
+// Arguments:
+// - bufferSize: The size to suggest for the pipe's buffer, in bytes.
+// - phRead: Receives the overlapped handle for reading from the pipe.
+// - phWrite: Receives an ordinary handle for writing to the pipe.
+// Return Value:
+// - S_OK if we succeeded, or an appropriate HRESULT for failing to create
+//      either end of the pipe
+[[nodiscard]]
+__declspec(noinline) inline
+HRESULT CreateOverlappedPipe(const DWORD bufferSize,
+                             _Out_ HANDLE* const phRead,
+                             _Out_ HANDLE* const phWrite) noexcept
+{
+    static std::atomic<uint32_t> s_pipeSerial{ 0 };
+    try
+    {
+        const auto name = L"\\\\.\\pipe\\conpty-output-" +
+                          std::to_wstring(GetCurrentProcessId()) + L"-" +
+                          std::to_wstring(s_pipeSerial.fetch_add(1));
+
+        wil::unique_hfile readSide{ CreateNamedPipeW(name.c_str(),
+                                                     PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                                     PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                                     1,
+                                                     0,
+                                                     bufferSize,
+                                                     0,
+                                                     nullptr) };
+        RETURN_LAST_ERROR_IF(!readSide);
+
+        wil::unique_hfile writeSide{ CreateFileW(name.c_str(),
+                                                 GENERIC_WRITE,
+                                                 0,
+                                                 nullptr,
+                                                 OPEN_EXISTING,
+                                                 FILE_ATTRIBUTE_NORMAL,
+                                                 nullptr) };
+        RETURN_LAST_ERROR_IF(!writeSide);
+
+        *phRead = readSide.release();
+        *phWrite = writeSide.release();
+        return S_OK;
+    }
+    CATCH_RETURN();
+}
+
 // Function Description:
 // - Creates a headless conhost in "pty mode" and launches the given commandline
 //      attached to the conhost. Gives back handles to three different pipes:
@@ -199,6 +253,7 @@ HRESULT EnvironmentMapToEnvironmentStringsW(EnvironmentVariableMapW& map, std::v
 //      caller should use the `TERM=xterm` VT sequences for encoding the input.
 //   * hOutput: The caller should read from this pipe. The headless conhost will
 //      "render" it's state to a stream of utf-8 encoded text with VT sequences.
+//      This end of the pipe is opened for overlapped I/O.
 //   * hSignal: The caller can use this to resize the size of the underlying PTY
 //      using the SignalResizeWindow function.
 // Arguments:
@@ -215,6 +270,9 @@ HRESULT EnvironmentMapToEnvironmentStringsW(EnvironmentVariableMapW& map, std::v
 // - extraEnvVars : A map of pairs of (Name, Value) representing additional
 //      environment variable strings and values to be set in the client process
 //      environment.  May override any already present in parent process.
+// - hOutputRing: An optional section holding a SharedRing. If given, the conhost
+//      writes its output to the ring instead of hOutput. The caller must have
+//      made the ring's handles inheritable.
 // Return Value:
 // - S_OK if we succeeded, or an appropriate HRESULT for failing format the
 //      commandline or failing to launch the conhost
@@ -228,7 +286,8 @@ HRESULT CreateConPty(const std::wstring& cmdline,
                      HANDLE* const hOutput,
                      HANDLE* const hSignal,
                      PROCESS_INFORMATION* const piPty,
-                     const EnvironmentVariableMapW& extraEnvVars = {}) noexcept
+                     const EnvironmentVariableMapW& extraEnvVars = {},
+                     const HANDLE hOutputRing = nullptr) noexcept
 {
     // Create some anon pipes so we can pass handles down and into the console.
     // IMPORTANT NOTE:
@@ -254,7 +313,13 @@ HRESULT CreateConPty(const std::wstring& cmdline,
     sa.lpSecurityDescriptor = nullptr;
 
     CreatePipe(&inPipeConhostSide, hInput, &sa, 0);
-    CreatePipe(hOutput, &outPipeConhostSide, &sa, 0);
+    const auto hrOutput = CreateOverlappedPipe(64 * 1024, hOutput, &outPipeConhostSide);
+    if (FAILED(hrOutput))
+    {
+        CloseHandle(inPipeConhostSide);
+        CloseHandle(*hInput);
+        return hrOutput;
+    }
     CreatePipe(&signalPipeConhostSide, hSignal, &sa, 0);
 
     SetHandleInformation(inPipeConhostSide, HANDLE_FLAG_INHERIT, 1);
@@ -271,6 +336,10 @@ HRESULT CreateConPty(const std::wstring& cmdline,
     }
 
     ss << L" --signal 0x" << std::hex << HandleToUlong(signalPipeConhostSide);
+    if (hOutputRing != nullptr)
+    {
+        ss << L" --outputring 0x" << std::hex << HandleToUlong(hOutputRing);
+    }
     conhostCmdline += ss.str();
     conhostCmdline += L" -- ";
     conhostCmdline += cmdline;
@@ -362,3 +431,20 @@ bool SignalResizeWindow(HANDLE hSignal, const unsigned short w, const unsigned s
     return !!WriteFile(hSignal, signalPacket, sizeof(signalPacket), nullptr, nullptr);
 }
 
+// Function Description:
+// - Tells the pty that's connected to hSignal that the terminal reading its
+//      output has reattached, and has none of what it was sent before. The pty
+//      resets the terminal and sends it the recent scrollback and the whole
+//      viewport again, in its next frame.
+// Arguments:
+// - hSignal: A signal pipe as returned by CreateConPty.
+// Return Value:
+// - true if the signal was sent, else false.
+__declspec(noinline) inline
+bool SignalReattach(HANDLE hSignal)
+{
+    const unsigned short signalPacket = PTY_SIGNAL_REATTACH;
+
+    return !!WriteFile(hSignal, &signalPacket, sizeof(signalPacket), nullptr, nullptr);
+}
+
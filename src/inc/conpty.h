@@ -8,6 +8,7 @@
 #pragma once
 
 const unsigned int PTY_SIGNAL_RESIZE_WINDOW = 8u;
+const unsigned int PTY_SIGNAL_REATTACH = 10u;
 
 HRESULT CreateConPty(const std::wstring& cmdline,       // _In_
                      const unsigned short w,            // _In_
@@ -21,6 +22,8 @@ bool SignalResizeWindow(const HANDLE hSignal,
                         const unsigned short w,
                         const unsigned short h);
 
+bool SignalReattach(const HANDLE hSignal);
+
 
 // Function Description:
 // - Creates a headless conhost in "pty mode" and launches the given commandline
@@ -157,3 +160,20 @@ bool SignalResizeWindow(HANDLE hSignal, const unsigned short w, const unsigned s
 
     return !!WriteFile(hSignal, signalPacket, sizeof(signalPacket), nullptr, nullptr);
 }
+
+// Function Description:
+// - Tells the pty that's connected to hSignal that the terminal reading its
+//      output has reattached, and has none of what it was sent before. The pty
+//      resets the terminal and sends it the recent scrollback and the whole
+//      viewport again, in its next frame.
+// Arguments:
+// - hSignal: A signal pipe as returned by CreateConPty.
+// Return Value:
+// - true if the signal was sent, else false.
+__declspec(noinline) inline
+bool SignalReattach(HANDLE hSignal)
+{
+    const unsigned short signalPacket = PTY_SIGNAL_REATTACH;
+
+    return !!WriteFile(hSignal, &signalPacket, sizeof(signalPacket), nullptr, nullptr);
+}
@@ -10,6 +10,21 @@
 
 using namespace Microsoft::Console::Interactivity::Win32;
 
+AccessibilityNotifier::AccessibilityNotifier() :
+    _hasPendingSimple{ false },
+    _pendingSimpleStart{ 0 },
+    _pendingSimpleCharAndAttribute{ 0 },
+    _hasPendingRegion{ false },
+    _pendingRegion{ 0 },
+    _hasPendingScroll{ false },
+    _pendingScrollX{ 0 },
+    _pendingScrollY{ 0 },
+    _flushScheduled{ false },
+    _lastFlushTick{ 0 },
+    _flushTimer{ THROW_LAST_ERROR_IF_NULL(CreateThreadpoolTimer(s_FlushTimerRoutine, this, nullptr)) }
+{
+}
+
 void AccessibilityNotifier::NotifyConsoleCaretEvent(_In_ RECT rectangle)
 {
     IConsoleWindow* const pWindow = ServiceLocator::LocateConsoleWindow();
@@ -65,42 +80,62 @@ void AccessibilityNotifier::NotifyConsoleCaretEvent(_In_ ConsoleCaretEventFlags
 
 void AccessibilityNotifier::NotifyConsoleUpdateScrollEvent(_In_ LONG x, _In_ LONG y)
 {
-    IConsoleWindow *pWindow = ServiceLocator::LocateConsoleWindow();
-    if (pWindow)
+    // Whatever was updated before the scroll has moved along with the text.
+    if (_hasPendingRegion)
     {
-        NotifyWinEvent(EVENT_CONSOLE_UPDATE_SCROLL,
-                       pWindow->GetWindowHandle(),
-                       x,
-                       y);
+        const LONG top = _pendingRegion.Top + y;
+        const LONG bottom = _pendingRegion.Bottom + y;
+        if (bottom < 0)
+        {
+            _hasPendingRegion = false;
+        }
+        else
+        {
+            _pendingRegion.Top = gsl::narrow_cast<SHORT>(std::max(top, 0L));
+            _pendingRegion.Bottom = gsl::narrow_cast<SHORT>(std::min(bottom, static_cast<LONG>(SHRT_MAX)));
+        }
     }
+
+    _hasPendingScroll = true;
+    _pendingScrollX += x;
+    _pendingScrollY += y;
+    _ScheduleFlush();
 }
 
 void AccessibilityNotifier::NotifyConsoleUpdateSimpleEvent(_In_ LONG start, _In_ LONG charAndAttribute)
 {
-    IConsoleWindow *pWindow = ServiceLocator::LocateConsoleWindow();
-    if (pWindow)
+    if (!_hasPendingSimple && !_hasPendingRegion)
     {
-        NotifyWinEvent(EVENT_CONSOLE_UPDATE_SIMPLE,
-                       pWindow->GetWindowHandle(),
-                       start,
-                       charAndAttribute);
+        _hasPendingSimple = true;
+        _pendingSimpleStart = start;
+        _pendingSimpleCharAndAttribute = charAndAttribute;
+    }
+    else
+    {
+        const SHORT x = static_cast<SHORT>(LOWORD(start));
+        const SHORT y = static_cast<SHORT>(HIWORD(start));
+        _AddToPendingRegion({ x, y, x, y });
     }
+    _ScheduleFlush();
 }
 
 void AccessibilityNotifier::NotifyConsoleUpdateRegionEvent(_In_ LONG startXY, _In_ LONG endXY)
 {
-    IConsoleWindow *pWindow = ServiceLocator::LocateConsoleWindow();
-    if (pWindow)
-    {
-        NotifyWinEvent(EVENT_CONSOLE_UPDATE_REGION,
-                       pWindow->GetWindowHandle(),
-                       startXY,
-                       endXY);
-    }
+    _AddToPendingRegion({ static_cast<SHORT>(LOWORD(startXY)),
+                          static_cast<SHORT>(HIWORD(startXY)),
+                          static_cast<SHORT>(LOWORD(endXY)),
+                          static_cast<SHORT>(HIWORD(endXY)) });
+    _ScheduleFlush();
 }
 
 void AccessibilityNotifier::NotifyConsoleLayoutEvent()
 {
+    // Changes from before the layout did are raised first, so they aren't taken to be about the new one.
+    if (_flushScheduled)
+    {
+        _FlushPendingEvents();
+    }
+
     IConsoleWindow *pWindow = ServiceLocator::LocateConsoleWindow();
     if (pWindow)
     {
@@ -134,3 +169,139 @@ void AccessibilityNotifier::NotifyConsoleEndApplicationEvent(_In_ DWORD processI
                        0);
     }
 }
+
+// Routine Description:
+// - Adds a rectangle of cells to what has changed since events were last raised.
+//   A single cell update that's waiting is folded into it.
+// Arguments:
+// - region - the cells that changed, inclusive
+void AccessibilityNotifier::_AddToPendingRegion(const SMALL_RECT region) noexcept
+{
+    if (_hasPendingSimple)
+    {
+        _hasPendingSimple = false;
+        const SHORT x = static_cast<SHORT>(LOWORD(_pendingSimpleStart));
+        const SHORT y = static_cast<SHORT>(HIWORD(_pendingSimpleStart));
+        _AddToPendingRegion({ x, y, x, y });
+    }
+
+    if (!_hasPendingRegion)
+    {
+        _hasPendingRegion = true;
+        _pendingRegion = region;
+    }
+    else
+    {
+        _pendingRegion.Left = std::min(_pendingRegion.Left, region.Left);
+        _pendingRegion.Top = std::min(_pendingRegion.Top, region.Top);
+        _pendingRegion.Right = std::max(_pendingRegion.Right, region.Right);
+        _pendingRegion.Bottom = std::max(_pendingRegion.Bottom, region.Bottom);
+    }
+}
+
+// Routine Description:
+// - Raises what's pending now if nothing has been raised for a frame, otherwise
+//   sets the timer to raise it once the frame is up.
+void AccessibilityNotifier::_ScheduleFlush() noexcept
+{
+    if (_flushScheduled)
+    {
+        return;
+    }
+
+    const ULONGLONG elapsed = GetTickCount64() - _lastFlushTick;
+    if (elapsed >= s_FlushIntervalMs)
+    {
+        _FlushPendingEvents();
+    }
+    else
+    {
+        _flushScheduled = true;
+        _SetFlushTimer(s_FlushIntervalMs - elapsed);
+    }
+}
+
+void AccessibilityNotifier::_SetFlushTimer(const ULONGLONG delayMs) noexcept
+{
+    // A negative due time is relative to now, in 100 nanosecond units.
+    ULARGE_INTEGER dueTime;
+    dueTime.QuadPart = static_cast<ULONGLONG>(-static_cast<LONGLONG>(delayMs) * 10000);
+    FILETIME ftDueTime;
+    ftDueTime.dwHighDateTime = dueTime.HighPart;
+    ftDueTime.dwLowDateTime = dueTime.LowPart;
+
+    SetThreadpoolTimer(_flushTimer.get(), &ftDueTime, 0, 0);
+}
+
+// Routine Description:
+// - Raises the events for everything that has changed since they were last raised.
+// - The console lock must be held.
+void AccessibilityNotifier::_FlushPendingEvents() noexcept
+{
+    _flushScheduled = false;
+    _lastFlushTick = GetTickCount64();
+
+    const bool textChanged = _hasPendingSimple || _hasPendingRegion;
+
+    IConsoleWindow* const pWindow = ServiceLocator::LocateConsoleWindow();
+    if (pWindow != nullptr)
+    {
+        const HWND hwnd = pWindow->GetWindowHandle();
+
+        if (_hasPendingScroll)
+        {
+            NotifyWinEvent(EVENT_CONSOLE_UPDATE_SCROLL, hwnd, _pendingScrollX, _pendingScrollY);
+        }
+
+        if (_hasPendingSimple)
+        {
+            NotifyWinEvent(EVENT_CONSOLE_UPDATE_SIMPLE, hwnd, _pendingSimpleStart, _pendingSimpleCharAndAttribute);
+        }
+        else if (_hasPendingRegion)
+        {
+            NotifyWinEvent(EVENT_CONSOLE_UPDATE_REGION,
+                           hwnd,
+                           MAKELONG(_pendingRegion.Left, _pendingRegion.Top),
+                           MAKELONG(_pendingRegion.Right, _pendingRegion.Bottom));
+        }
+    }
+
+    _hasPendingSimple = false;
+    _hasPendingRegion = false;
+    _hasPendingScroll = false;
+    _pendingScrollX = 0;
+    _pendingScrollY = 0;
+
+    if (textChanged && pWindow != nullptr)
+    {
+        LOG_IF_FAILED(pWindow->SignalUia(UIA_Text_TextChangedEventId));
+        // TODO MSFT 7960168 do we really need this event to not signal?
+        //pWindow->SignalUia(UIA_LayoutInvalidatedEventId);
+    }
+}
+
+// Routine Description:
+// - Raises the events that were held back for the rest of a frame.
+// - Like the cursor blink timer, this can't wait on the console lock: whoever
+//   holds it may be waiting for this to finish so they can close the timer. So if
+//   it's busy, this comes back around in a frame rather than waiting for it.
+void CALLBACK AccessibilityNotifier::s_FlushTimerRoutine(_Inout_ PTP_CALLBACK_INSTANCE /*instance*/,
+                                                         _Inout_opt_ PVOID context,
+                                                         _Inout_ PTP_TIMER /*timer*/)
+{
+    auto* const pNotifier = static_cast<AccessibilityNotifier*>(context);
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+    if (gci.TryLockConsole() != false)
+    {
+        if (pNotifier->_flushScheduled)
+        {
+            pNotifier->_FlushPendingEvents();
+        }
+        gci.UnlockConsole();
+    }
+    else
+    {
+        pNotifier->_SetFlushTimer(s_FlushIntervalMs);
+    }
+}
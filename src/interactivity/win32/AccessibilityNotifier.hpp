@@ -7,6 +7,12 @@ Module Name:
 
 Abstract:
 - Win32 implementation of the IAccessibilityNotifier interface.
+- Output can change the buffer thousands of times a second, and every event
+  raised here crosses over to each listening accessibility app. So updates,
+  scrolls and the text changed signal are gathered up and raised together,
+  at most once a frame. The first change after a quiet spell goes out right
+  away, the same as it always has.
+- Everything but the flush timer is called with the console lock held.
 
 Author(s):
 - Hernan Gatta (HeGatta) 29-Mar-2017
@@ -25,6 +31,7 @@ namespace Microsoft::Console::Interactivity::Win32
     class AccessibilityNotifier final : public IAccessibilityNotifier
     {
     public:
+        AccessibilityNotifier();
         ~AccessibilityNotifier() = default;
 
         void NotifyConsoleCaretEvent(_In_ RECT rectangle);
@@ -35,5 +42,36 @@ namespace Microsoft::Console::Interactivity::Win32
         void NotifyConsoleLayoutEvent();
         void NotifyConsoleStartApplicationEvent(_In_ DWORD processId);
         void NotifyConsoleEndApplicationEvent(_In_ DWORD processId);
+
+    private:
+        static constexpr ULONGLONG s_FlushIntervalMs = 16;
+
+        static void CALLBACK s_FlushTimerRoutine(_Inout_ PTP_CALLBACK_INSTANCE instance,
+                                                 _Inout_opt_ PVOID context,
+                                                 _Inout_ PTP_TIMER timer);
+
+        void _AddToPendingRegion(const SMALL_RECT region) noexcept;
+        void _ScheduleFlush() noexcept;
+        void _SetFlushTimer(const ULONGLONG delayMs) noexcept;
+        void _FlushPendingEvents() noexcept;
+
+        // A single cell update is passed on as it is. Anything more than that is
+        // merged into the smallest rectangle that holds all of it.
+        bool _hasPendingSimple;
+        LONG _pendingSimpleStart;
+        LONG _pendingSimpleCharAndAttribute;
+
+        bool _hasPendingRegion;
+        SMALL_RECT _pendingRegion;
+
+        bool _hasPendingScroll;
+        LONG _pendingScrollX;
+        LONG _pendingScrollY;
+
+        bool _flushScheduled;
+        ULONGLONG _lastFlushTick;
+
+        // Last, so it's closed (and waits for a callback in progress) before anything else goes.
+        wil::unique_threadpool_timer _flushTimer;
     };
 }
@@ -90,6 +90,10 @@ Clipboard& Clipboard::Instance()
 
 // Routine Description:
 // - This routine pastes given Unicode string into the console window.
+// - A big paste is made into key events, and written to the input buffer, on
+//      the paste pipeline's thread, a block at a time, so the window doesn't
+//      hang while it's made and the app can start reading it right away.
+//      Anything pasted while it's still being typed goes after it.
 // Arguments:
 // - pData - Unicode string that is pasted to the console window
 // - cchData - Size of the Unicode String in characters
@@ -107,6 +111,20 @@ void Clipboard::StringPaste(_In_reads_(cchData) const wchar_t* const pData,
 
     try
     {
+        // An app that reads VT input reads the text, not the keys, so there's
+        //      no need to make up the keys that would type it.
+        if (gci.pInputBuffer->IsInVirtualTerminalInputMode())
+        {
+            gci.pInputBuffer->WritePastedText(FilterPastedText(pData, cchData));
+            return;
+        }
+
+        if (cchData > s_SynchronousPasteLimit || _pastePipeline.IsPasting())
+        {
+            _pastePipeline.Paste(FilterPastedText(pData, cchData), gci.OutputCP);
+            return;
+        }
+
         std::deque<std::unique_ptr<IInputEvent>> inEvents = TextToKeyEvents(pData, cchData);
         gci.pInputBuffer->Write(inEvents);
     }
@@ -137,6 +155,38 @@ std::deque<std::unique_ptr<IInputEvent>> Clipboard::TextToKeyEvents(_In_reads_(c
 
     std::deque<std::unique_ptr<IInputEvent>> keyEvents;
 
+    const UINT codepage = ServiceLocator::LocateGlobals().getConsoleInformation().OutputCP;
+    for (const wchar_t currentChar : FilterPastedText(pData, cchData))
+    {
+        std::deque<std::unique_ptr<KeyEvent>> convertedEvents = CharToKeyEvents(currentChar, codepage);
+        while (!convertedEvents.empty())
+        {
+            keyEvents.push_back(std::move(convertedEvents.front()));
+            convertedEvents.pop_front();
+        }
+    }
+    return keyEvents;
+}
+
+// Routine Description:
+// - Gets the text that pasting the given text actually sends to the input:
+//      without the characters that are filtered out on paste, with CR/LF
+//      line endings collapsed to CR, and up to the first null.
+// Arguments:
+// - pData - the text to paste
+// - cchData - the size of pData, in wchars
+// Return Value:
+// - The text to send.
+// Note:
+// - will throw exception on error
+std::wstring Clipboard::FilterPastedText(_In_reads_(cchData) const wchar_t* const pData,
+                                         const size_t cchData)
+{
+    THROW_IF_NULL_ALLOC(pData);
+
+    std::wstring text;
+    text.reserve(cchData);
+
     for (size_t i = 0; i < cchData; ++i)
     {
         wchar_t currentChar = pData[i];
@@ -173,15 +223,9 @@ std::deque<std::unique_ptr<IInputEvent>> Clipboard::TextToKeyEvents(_In_reads_(c
             currentChar = UNICODE_CARRIAGERETURN;
         }
 
-        const UINT codepage = ServiceLocator::LocateGlobals().getConsoleInformation().OutputCP;
-        std::deque<std::unique_ptr<KeyEvent>> convertedEvents = CharToKeyEvents(currentChar, codepage);
-        while (!convertedEvents.empty())
-        {
-            keyEvents.push_back(std::move(convertedEvents.front()));
-            convertedEvents.pop_front();
-        }
+        text.push_back(currentChar);
     }
-    return keyEvents;
+    return text;
 }
 
 // Routine Description:
@@ -208,11 +252,15 @@ void Clipboard::StoreSelectionToClipboard(bool const fAlsoCopyHtml)
     const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
     const auto& screenInfo = gci.GetActiveOutputBuffer();
 
-    const auto text = RetrieveTextFromBuffer(screenInfo,
-                                             lineSelection,
-                                             selectionRects);
+    std::wstring text;
+    std::vector<TextBuffer::ColorRun> colors;
+    RetrieveSelectedText(screenInfo,
+                         lineSelection,
+                         selectionRects,
+                         text,
+                         fAlsoCopyHtml ? &colors : nullptr);
 
-    CopyTextToSystemClipboard(text, fAlsoCopyHtml);
+    CopyTextToSystemClipboard(text, fAlsoCopyHtml ? &colors : nullptr);
 }
 
 // Routine Description:
@@ -239,16 +287,84 @@ TextBuffer::TextAndColor Clipboard::RetrieveTextFromBuffer(const SCREEN_INFORMAT
                                       GetBackgroundColor);
 }
 
+// Routine Description:
+// - Retrieves the text of the selected region of the text buffer all in one string, and
+//   optionally its colors as runs.
+// Arguments:
+// - screenInfo - what is rendered on the screen
+// - lineSelection - true if entire line is being selected. False otherwise (box selection)
+// - selectionRects - the selection regions from which the data will be extracted from the buffer
+// - text - receives the selected text
+// - colors - if not null, receives the colors of the text
+void Clipboard::RetrieveSelectedText(const SCREEN_INFORMATION& screenInfo,
+                                     const bool lineSelection,
+                                     const std::vector<SMALL_RECT>& selectionRects,
+                                     std::wstring& text,
+                                     std::vector<TextBuffer::ColorRun>* const colors)
+{
+    const auto &buffer = screenInfo.GetTextBuffer();
+    const bool trimTrailingWhitespace = !WI_IsFlagSet(GetKeyState(VK_SHIFT), KEY_PRESSED);
+    const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+    std::function<COLORREF(TextAttribute&)> GetForegroundColor = std::bind(&CONSOLE_INFORMATION::LookupForegroundColor, &gci, std::placeholders::_1);
+    std::function<COLORREF(TextAttribute&)> GetBackgroundColor = std::bind(&CONSOLE_INFORMATION::LookupBackgroundColor, &gci, std::placeholders::_1);
+
+    buffer.GetSelectedText(lineSelection,
+                           trimTrailingWhitespace,
+                           selectionRects,
+                           text,
+                           colors,
+                           GetForegroundColor,
+                           GetBackgroundColor);
+}
+
+// Routine Description:
+// - Appends text to a string as UTF-8, converting straight into the end of it.
+// Arguments:
+// - destination - the string to append to
+// - text - the text to append
+static void s_AppendUtf8(std::string& destination, const std::wstring_view text)
+{
+    if (text.empty())
+    {
+        return;
+    }
+
+    // Each UTF-16 code unit becomes at most 3 bytes of UTF-8, and a surrogate pair 4.
+    const size_t start = destination.size();
+    const size_t cbMax = text.size() * 3;
+    destination.resize(start + cbMax);
+
+    const int cbWritten = WideCharToMultiByte(CP_UTF8,
+                                              0,
+                                              text.data(),
+                                              gsl::narrow<int>(text.size()),
+                                              destination.data() + start,
+                                              gsl::narrow<int>(cbMax),
+                                              nullptr,
+                                              nullptr);
+    THROW_LAST_ERROR_IF(0 == cbWritten);
+    destination.resize(start + cbWritten);
+}
+
 // Routine Description:
 // - Generates a CF_HTML compliant structure based on the passed in text and color data
+// - The HTML is written out in one go into a single string, a span for each run of
+//   colors, and the header's offsets are filled in once the rest is there.
 // Arguments:
-// - rows - the text and color data we will format & encapsulate
+// - text - the text we will format & encapsulate
+// - colors - the colors of the text, as runs in the order of the text
 // Return Value:
 // - string containing the generated HTML
-std::string Clipboard::GenHTML(const TextBuffer::TextAndColor& rows)
+std::string Clipboard::GenHTML(const std::wstring_view text, const std::vector<TextBuffer::ColorRun>& colors)
 {
     std::string szClipboard;            // we will build the data going back in this string buffer
 
+    if (text.empty() || colors.empty())
+    {
+        return szClipboard;
+    }
+
     try
     {
         std::string const szHtmlClipFormat =
@@ -292,8 +408,7 @@ std::string Clipboard::GenHTML(const TextBuffer::TextAndColor& rows)
         std::string const szSpanStartPattern = R"X(<SPAN STYLE="color:#%02x%02x%02x;background-color:#%02x%02x%02x">)X";
 
         size_t const cbSpanStart = 53;          // when format is expanded, there will be 53 bytes per color pattern.
-        std::string szSpanStart;
-        szSpanStart.resize(cbSpanStart + 1);    // +1 for null terminator
+        char szSpanStart[cbSpanStart + 1];      // +1 for null terminator
 
         std::string const szSpanStartFontPattern = R"X(<SPAN STYLE="font-family: '%s', monospace">)X";
         size_t const cbSpanStartFontPattern = 41;
@@ -334,6 +449,11 @@ std::string Clipboard::GenHTML(const TextBuffer::TextAndColor& rows)
         std::string const szSpanEnd = "</SPAN>";
         std::string const szDivEnd = "</DIV>";
 
+        // Grow the buffer once for all of it. The text is mostly ASCII, so it's about a byte a character.
+        szClipboard.reserve(cbHeader + cbHtmlHeader + szHtmlFragStart.size() + cbDivOuter + cbSpanStartFont + cbSpanFontSize +
+                            colors.size() * (cbSpanStart + szSpanEnd.size()) + text.size() +
+                            szSpanEnd.size() * 2 + szDivEnd.size() + szHtmlFragEnd.size() + cbHtmlFooter + 1);
+
         // Start building the HTML formated string to return
         // First we have to add the required header and then
         // some standard HTML boiler plate required for CF_HTML
@@ -342,7 +462,7 @@ std::string Clipboard::GenHTML(const TextBuffer::TextAndColor& rows)
         szClipboard.append(szHtmlHeader);
         szClipboard.append(szHtmlFragStart);
 
-        COLORREF iBgColor = rows.BkAttr.at(0).at(0);
+        COLORREF iBgColor = colors.front().background;
 
         szDivOuter.resize(cbDivOuter + 1);
         sprintf_s(szDivOuter.data(), cbDivOuter + 1, szDivOuterBackgroundPattern.data(), GetRValue(iBgColor), GetGValue(iBgColor), GetBValue(iBgColor));
@@ -355,83 +475,19 @@ std::string Clipboard::GenHTML(const TextBuffer::TextAndColor& rows)
         // copy font size start
         szClipboard.append(szSpanFontSize);
 
-        bool bColorFound = false;
-
-        // copy all text into the final clipboard data handle. There should be no nulls between rows of
-        // characters, but there should be a \0 at the end.
-        for (UINT iRow = 0; iRow < rows.text.size(); iRow++)
+        // copy all text into the final clipboard data handle, a span for each run of colors. There
+        // should be no nulls between rows of characters, but there should be a \0 at the end.
+        size_t offset = 0;
+        for (const auto& run : colors)
         {
-            size_t cbStartOffset = 0;
-            size_t cchCharsToPrint = 0;
-
-            COLORREF const Blackness = RGB(0x00, 0x00, 0x00);
-            COLORREF fgColor = Blackness;
-            COLORREF bkColor = Blackness;
-
-            for (UINT iCol = 0; iCol < rows.text.at(iRow).length(); iCol++)
-            {
-                bool fColorDelta = false;
-
-                if (!bColorFound)
-                {
-                    fgColor = rows.FgAttr.at(iRow).at(iCol);
-                    bkColor = rows.BkAttr.at(iRow).at(iCol);
-                    bColorFound = true;
-                    fColorDelta = true;
-                }
-                else if ((rows.FgAttr.at(iRow).at(iCol) != fgColor) || (rows.BkAttr.at(iRow).at(iCol) != bkColor))
-                {
-                    fgColor = rows.FgAttr.at(iRow).at(iCol);
-                    bkColor = rows.BkAttr.at(iRow).at(iCol);
-                    fColorDelta = true;
-                }
-
-                if (fColorDelta)
-                {
-                    if (cchCharsToPrint > 0)
-                    {
-                        // write accumulated characters to stream ....
-                        std::string TempBuff;
-                        int const cbTempCharsNeeded = WideCharToMultiByte(CP_UTF8, 0, rows.text[iRow].data() + cbStartOffset, static_cast<int>(cchCharsToPrint), nullptr, 0, nullptr, nullptr);
-                        TempBuff.resize(cbTempCharsNeeded);
-                        WideCharToMultiByte(CP_UTF8, 0, rows.text[iRow].data() + cbStartOffset, static_cast<int>(cchCharsToPrint), TempBuff.data(), cbTempCharsNeeded, nullptr, nullptr);
-                        szClipboard.append(TempBuff);
-                        cbStartOffset += cchCharsToPrint;
-                        cchCharsToPrint = 0;
-
-                        // close previous span
-                        szClipboard += szSpanEnd;
-                    }
-
-                    // start new span
-
-                    // format with color then copy formatted string
-                    szSpanStart.resize(cbSpanStart + 1);       // add room for null
-                    sprintf_s(szSpanStart.data(), cbSpanStart + 1, szSpanStartPattern.data(),
-                        GetRValue(fgColor), GetGValue(fgColor), GetBValue(fgColor),
-                        GetRValue(bkColor), GetGValue(bkColor), GetBValue(bkColor));
-                    szSpanStart.resize(cbSpanStart);        // chop null from sprintf
-                    szClipboard.append(szSpanStart);
-
-                }
-
-                // accumulate 1 character
-                cchCharsToPrint++;
-            }
-
-            PCWCHAR pwchAccumulateStart = rows.text.at(iRow).data() + cbStartOffset;
-
-            // write accumulated characters to stream
-            std::string CharsConverted;
-            int cbCharsConverted = WideCharToMultiByte(CP_UTF8, 0, pwchAccumulateStart, static_cast<int>(cchCharsToPrint), nullptr, 0, nullptr, nullptr);
-            CharsConverted.resize(cbCharsConverted);
-            WideCharToMultiByte(CP_UTF8, 0, pwchAccumulateStart, static_cast<int>(cchCharsToPrint), CharsConverted.data(), cbCharsConverted, nullptr, nullptr);
-            szClipboard.append(CharsConverted);
-        }
+            sprintf_s(szSpanStart, ARRAYSIZE(szSpanStart), szSpanStartPattern.data(),
+                GetRValue(run.foreground), GetGValue(run.foreground), GetBValue(run.foreground),
+                GetRValue(run.background), GetGValue(run.background), GetBValue(run.background));
+            szClipboard.append(szSpanStart, cbSpanStart);
+
+            s_AppendUtf8(szClipboard, text.substr(offset, run.length));
+            offset += run.length;
 
-        if (bColorFound)
-        {
-            // copy end span
             szClipboard.append(szSpanEnd);
         }
 
@@ -486,17 +542,10 @@ std::string Clipboard::GenHTML(const TextBuffer::TextAndColor& rows)
 // Routine Description:
 // - Copies the text given onto the global system clipboard.
 // Arguments:
-// - rows - Rows of text data to copy
-void Clipboard::CopyTextToSystemClipboard(const TextBuffer::TextAndColor& rows, bool const fAlsoCopyHtml)
+// - finalString - the text to copy
+// - colors - if not null, the colors of the text, to copy as HTML along with it
+void Clipboard::CopyTextToSystemClipboard(const std::wstring& finalString, const std::vector<TextBuffer::ColorRun>* const colors)
 {
-    std::wstring finalString;
-
-    // Concatenate strings into one giant string to put onto the clipboard.
-    for (const auto& str : rows.text)
-    {
-        finalString += str;
-    }
-
     // allocate the final clipboard data
     const size_t cchNeeded = finalString.size() + 1;
     const size_t cbNeeded = sizeof(wchar_t) * cchNeeded;
@@ -517,9 +566,9 @@ void Clipboard::CopyTextToSystemClipboard(const TextBuffer::TextAndColor& rows,
     THROW_LAST_ERROR_IF(!EmptyClipboard());
     THROW_LAST_ERROR_IF_NULL(SetClipboardData(CF_UNICODETEXT, globalHandle.get()));
 
-    if (fAlsoCopyHtml)
+    if (colors)
     {
-        std::string HTMLToPlaceOnClip = GenHTML(rows);
+        std::string HTMLToPlaceOnClip = GenHTML(finalString, *colors);
         const size_t cbNeededHTML = HTMLToPlaceOnClip.size();
         if (cbNeededHTML)
         {
@@ -0,0 +1,209 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "PastePipeline.hpp"
+
+#include "..\..\types\inc\convert.hpp"
+
+#include "..\inc\ServiceLocator.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Interactivity::Win32;
+
+// Routine Description:
+// - Constructor. The thread isn't started until there's something to paste.
+PastePipeline::PastePipeline() :
+    _lock{},
+    _changed{},
+    _pastes{},
+    _pasting{ false },
+    _exit{ false },
+    _thread{}
+{
+}
+
+// Routine Description:
+// - Destructor. Whatever's left of the pastes is dropped, and the thread is
+//      waited on to finish the block it's writing.
+PastePipeline::~PastePipeline()
+{
+    {
+        std::lock_guard<std::mutex> guard{ _lock };
+        _exit = true;
+        _pastes.clear();
+    }
+    _changed.notify_all();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+// Routine Description:
+// - Queues text to be typed into the input buffer, after any that's already
+//      being pasted. Returns right away.
+// Arguments:
+// - text - the text to paste, already filtered the way pasted text is.
+// - codepage - the codepage to type the characters that aren't on the
+//      keyboard in.
+// Return Value:
+// - <none>
+// Note:
+// - will throw exception on error
+void PastePipeline::Paste(std::wstring text, const UINT codepage)
+{
+    if (text.empty())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard{ _lock };
+        _pastes.push_back({ std::move(text), codepage });
+        _pasting = true;
+        if (!_thread.joinable())
+        {
+            _thread = std::thread{ &PastePipeline::_Run, this };
+        }
+    }
+    _changed.notify_all();
+}
+
+// Routine Description:
+// - Tells whether there's text that hasn't all been written to the input
+//      buffer yet.
+bool PastePipeline::IsPasting() const noexcept
+{
+    std::lock_guard<std::mutex> guard{ _lock };
+    return _pasting;
+}
+
+// Routine Description:
+// - The thread's loop. Pastes the queued text in order, and otherwise waits
+//      for more until the pipeline is destroyed.
+void PastePipeline::_Run()
+{
+    std::unique_lock<std::mutex> guard{ _lock };
+    while (!_exit)
+    {
+        if (_pastes.empty())
+        {
+            _pasting = false;
+            _changed.notify_all();
+            _changed.wait(guard, [&] { return _exit || !_pastes.empty(); });
+            continue;
+        }
+
+        const _Paste paste = std::move(_pastes.front());
+        _pastes.pop_front();
+
+        guard.unlock();
+        try
+        {
+            _PasteText(paste);
+        }
+        CATCH_LOG();
+        guard.lock();
+    }
+}
+
+// Routine Description:
+// - Types one paste into the input buffer, a block of characters at a time.
+//      Each block is made into events without the console lock, and then
+//      written all at once with it, as soon as the app has read enough of the
+//      blocks before it.
+// Arguments:
+// - paste - the text and the codepage to type it in.
+// Return Value:
+// - <none>
+// Note:
+// - will throw exception on error
+void PastePipeline::_PasteText(const _Paste& paste)
+{
+    const std::wstring_view text{ paste.text };
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+    for (size_t offset = 0; offset < text.size() && !_IsExiting(); offset += s_BlockChars)
+    {
+        auto block = s_TextToRecords(text.substr(offset, s_BlockChars), paste.codepage);
+
+        if (!_WaitForRoom())
+        {
+            return;
+        }
+
+        gci.LockConsole();
+        auto Unlock = wil::scope_exit([&] { gci.UnlockConsole(); });
+        gci.pInputBuffer->Write(gsl::make_span(block));
+    }
+}
+
+// Routine Description:
+// - Waits until the input buffer has room for another block, which it does
+//      once the app has read all but a few blocks' worth of what's there.
+// Return Value:
+// - true if there's room now. false if the pipeline is going away meanwhile.
+bool PastePipeline::_WaitForRoom()
+{
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    while (!_IsExiting())
+    {
+        size_t pending;
+        {
+            gci.LockConsole();
+            auto Unlock = wil::scope_exit([&] { gci.UnlockConsole(); });
+            pending = gci.pInputBuffer->GetNumberOfReadyEvents();
+        }
+        if (pending < s_MaxPendingEvents)
+        {
+            return true;
+        }
+
+        // Nothing tells us when the app reads, so look again in a bit, unless
+        //      we're stopped first.
+        std::unique_lock<std::mutex> guard{ _lock };
+        _changed.wait_for(guard, s_DrainPollInterval, [&] { return _exit; });
+    }
+    return false;
+}
+
+// Routine Description:
+// - Tells whether the pipeline is being destroyed, and the paste being written
+//      should stop where it is.
+bool PastePipeline::_IsExiting() const noexcept
+{
+    std::lock_guard<std::mutex> guard{ _lock };
+    return _exit;
+}
+
+// Routine Description:
+// - Makes up the key events that type the given text, the same ones
+//      CharToKeyEvents does for each character.
+// Arguments:
+// - text - the text to type.
+// - codepage - the codepage to type the characters that aren't on the
+//      keyboard in.
+// Return Value:
+// - The events, in order.
+// Note:
+// - will throw exception on error
+std::vector<INPUT_RECORD> PastePipeline::s_TextToRecords(const std::wstring_view text,
+                                                         const UINT codepage)
+{
+    std::vector<INPUT_RECORD> records;
+    // Most characters are a key down and a key up.
+    records.reserve(text.size() * 2);
+
+    for (const wchar_t wch : text)
+    {
+        for (const auto& keyEvent : CharToKeyEvents(wch, codepage))
+        {
+            records.push_back(keyEvent->ToInputRecord());
+        }
+    }
+    return records;
+}
@@ -0,0 +1,72 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- PastePipeline.hpp
+
+Abstract:
+- Turns pasted text into the key events that type it, on a thread of its own,
+  and feeds them to the input buffer a block at a time.
+- Making up the keys for a character (and converting it to the codepage, for
+  the ones that aren't on the keyboard) is what takes the time on a paste, so
+  none of it is done under the console lock. The lock is only held long enough
+  to write one block, so the window and the app reading the paste both keep
+  going however big it is, and the input buffer never holds more than a few
+  blocks of it that the app hasn't read yet.
+--*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace Microsoft::Console::Interactivity::Win32
+{
+    class PastePipeline final
+    {
+    public:
+        PastePipeline();
+        ~PastePipeline();
+
+        PastePipeline(const PastePipeline&) = delete;
+        PastePipeline& operator=(const PastePipeline&) = delete;
+
+        void Paste(std::wstring text, const UINT codepage);
+        bool IsPasting() const noexcept;
+
+    private:
+        // how many characters of the text are turned into one block of events.
+        static constexpr size_t s_BlockChars = 4096;
+
+        // a block isn't written while the input buffer has this many events
+        //      that haven't been read yet.
+        static constexpr size_t s_MaxPendingEvents = 4 * s_BlockChars;
+
+        // how long to wait before looking again whether the app has read enough.
+        static constexpr std::chrono::milliseconds s_DrainPollInterval{ 10 };
+
+        // A paste that's waiting its turn.
+        struct _Paste
+        {
+            std::wstring text;
+            UINT codepage;
+        };
+
+        mutable std::mutex _lock;
+        std::condition_variable _changed;
+        std::deque<_Paste> _pastes;
+        bool _pasting;
+        bool _exit;
+        std::thread _thread;
+
+        void _Run();
+        void _PasteText(const _Paste& paste);
+        bool _WaitForRoom();
+        bool _IsExiting() const noexcept;
+
+        static std::vector<INPUT_RECORD> s_TextToRecords(const std::wstring_view text,
+                                                         const UINT codepage);
+    };
+}
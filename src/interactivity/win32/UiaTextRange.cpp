@@ -22,6 +22,10 @@ using namespace Microsoft::Console::Interactivity::Win32::UiaTextRangeTracing;
 
 IdType UiaTextRange::id = 1;
 
+const TextBuffer* UiaTextRange::s_cachedRowsBuffer = nullptr;
+SHORT UiaTextRange::s_cachedRowsWidth = 0;
+std::unordered_map<uint64_t, UiaTextRange::CachedRow> UiaTextRange::s_cachedRows;
+
 UiaTextRange::MoveState::MoveState(const UiaTextRange& range,
                                    const MovementDirection direction) :
     StartScreenInfoRow{ UiaTextRange::_endpointToScreenInfoRow(range.GetStart()) },
@@ -658,27 +662,9 @@ IFACEMETHODIMP UiaTextRange::GetBoundingRectangles(_Outptr_result_maybenull_ SAF
     {
         // vector to put coords into. they go in as four doubles in the
         // order: left, top, width, height. each line will have its own
-        // set of coords.
+        // set of coords, unless it lines up with the one above it.
         std::vector<double> coords;
-        const TextBufferRow startRow = _endpointToTextBufferRow(_start);
-
-        if (_degenerate && _isScreenInfoRowInViewport(startRow))
-        {
-            _addScreenInfoRowBoundaries(_textBufferRowToScreenInfoRow(startRow), coords);
-        }
-        else
-        {
-            const unsigned int totalRowsInRange = _rowCountInRange();
-            for (unsigned int i = 0; i < totalRowsInRange; ++i)
-            {
-                ScreenInfoRow screenInfoRow = _textBufferRowToScreenInfoRow(startRow + i);
-                if (!_isScreenInfoRowInViewport(screenInfoRow))
-                {
-                    continue;
-                }
-                _addScreenInfoRowBoundaries(screenInfoRow, coords);
-            }
-        }
+        _addBoundingRectangles(coords);
 
         // convert to a safearray
         *ppRetVal = SafeArrayCreateVector(VT_R8, 0, static_cast<ULONG>(coords.size()));
@@ -686,17 +672,17 @@ IFACEMETHODIMP UiaTextRange::GetBoundingRectangles(_Outptr_result_maybenull_ SAF
         {
             return E_OUTOFMEMORY;
         }
-        HRESULT hr;
-        for (LONG i = 0; i < static_cast<LONG>(coords.size()); ++i)
+        // copy them all in at once rather than locking the array for each one.
+        double* pData = nullptr;
+        HRESULT hr = SafeArrayAccessData(*ppRetVal, reinterpret_cast<void**>(&pData));
+        if (FAILED(hr))
         {
-            hr = SafeArrayPutElement(*ppRetVal, &i, &coords[i]);
-            if (FAILED(hr))
-            {
-                SafeArrayDestroy(*ppRetVal);
-                *ppRetVal = nullptr;
-                return hr;
-            }
+            SafeArrayDestroy(*ppRetVal);
+            *ppRetVal = nullptr;
+            return hr;
         }
+        std::copy(coords.cbegin(), coords.cend(), pData);
+        LOG_IF_FAILED(SafeArrayUnaccessData(*ppRetVal));
     }
     CATCH_RETURN();
 
@@ -740,7 +726,6 @@ IFACEMETHODIMP UiaTextRange::GetText(_In_ int maxLength, _Out_ BSTR* pRetVal)
             const ScreenInfoRow endScreenInfoRow = _endpointToScreenInfoRow(_end);
             const Column endColumn = _endpointToColumn(_end);
             const unsigned int totalRowsInRange = _rowCountInRange();
-            const TextBuffer& textBuffer = _getTextBuffer();
 
 #if defined(_DEBUG) && defined(UIATEXTRANGE_DEBUG_MSGS)
             std::wstringstream ss;
@@ -753,10 +738,10 @@ IFACEMETHODIMP UiaTextRange::GetText(_In_ int maxLength, _Out_ BSTR* pRetVal)
             for (unsigned int i = 0; i < totalRowsInRange; ++i)
             {
                 currentScreenInfoRow = startScreenInfoRow + i;
-                const ROW& row = textBuffer.GetRowByOffset(currentScreenInfoRow);
-                if (row.GetCharRow().ContainsText())
+                const CachedRow& row = _getCachedRow(currentScreenInfoRow);
+                if (row.containsText)
                 {
-                    const size_t rowRight = row.GetCharRow().MeasureRight();
+                    const size_t rowRight = row.right;
                     size_t startIndex = 0;
                     size_t endIndex = rowRight;
                     if (currentScreenInfoRow == startScreenInfoRow)
@@ -775,7 +760,7 @@ IFACEMETHODIMP UiaTextRange::GetText(_In_ int maxLength, _Out_ BSTR* pRetVal)
                     // wouldn't be any text to grab.
                     if (startIndex < endIndex)
                     {
-                        wstr += row.GetText().substr(startIndex, endIndex - startIndex);
+                        wstr += row.text.substr(startIndex, endIndex - startIndex);
                     }
                 }
 
@@ -1269,6 +1254,52 @@ TextBuffer& UiaTextRange::_getTextBuffer()
     return _getScreenInfo().GetTextBuffer();
 }
 
+// Routine Description:
+// - gets what ranges need to know about a row of the current output text buffer.
+// - screen readers ask about the same few rows over and over while output is
+// streaming, so each row's text is only read out of the buffer again once
+// something has written to it. the rows are shared by all ranges, and the
+// console lock must be held while using them.
+// Arguments:
+// - row - the screen info row to get
+// Return Value:
+// - the row's text and where it ends. Only valid until the next call.
+const UiaTextRange::CachedRow& UiaTextRange::_getCachedRow(const ScreenInfoRow row)
+{
+    const TextBuffer& textBuffer = _getTextBuffer();
+    const SHORT width = textBuffer.GetSize().Width();
+    if (s_cachedRowsBuffer != &textBuffer || s_cachedRowsWidth != width)
+    {
+        s_cachedRows.clear();
+        s_cachedRowsBuffer = &textBuffer;
+        s_cachedRowsWidth = width;
+    }
+
+    // rows are kept by their offset plus the number of rows that have circled
+    // off the top of the buffer, so that they stay put as it scrolls.
+    const uint64_t rowId = textBuffer.GetCircledRowCount() + row;
+    const uint64_t generation = textBuffer.GetRowGeneration(row);
+
+    auto found = s_cachedRows.find(rowId);
+    if (found == s_cachedRows.end() || found->second.generation != generation)
+    {
+        if (found == s_cachedRows.end() && s_cachedRows.size() >= s_maxCachedRows)
+        {
+            s_cachedRows.clear();
+        }
+
+        std::optional<ROW> scratch;
+        const CharRow& charRow = textBuffer.GetRowByOffset(row, scratch).GetCharRow();
+        CachedRow& cachedRow = s_cachedRows[rowId];
+        cachedRow.generation = generation;
+        cachedRow.containsText = charRow.ContainsText();
+        cachedRow.right = charRow.MeasureRight();
+        cachedRow.text = cachedRow.containsText ? charRow.GetText() : std::wstring{};
+        return cachedRow;
+    }
+    return found->second;
+}
+
 // Routine Description:
 // - Gets the number of rows in the output text buffer.
 // Arguments:
@@ -1505,64 +1536,75 @@ const ScreenInfoRow UiaTextRange::_endpointToScreenInfoRow(const Endpoint endpoi
 }
 
 // Routine Description:
-// - adds the relevant coordinate points from screenInfoRow to coords.
+// - adds the rectangles covering the part of the range that's in the viewport
+// to coords, in screen coordinates.
+// - everything the geometry depends on is looked up once for the whole range,
+// and rows that cover the same columns one under the other are merged into
+// a single rectangle.
 // Arguments:
-// - screenInfoRow - row to calculate coordinate positions from
-// - coords - vector to add the calucated coords to
+// - coords - vector to add the calucated coords to, as left, top, width and
+// height for each rectangle
 // Return Value:
 // - <none>
 // Notes:
 // - alters coords. may throw an exception.
-void UiaTextRange::_addScreenInfoRowBoundaries(const ScreenInfoRow screenInfoRow,
-                                               _Inout_ std::vector<double>& coords) const
+void UiaTextRange::_addBoundingRectangles(_Inout_ std::vector<double>& coords) const
 {
     const SCREEN_INFORMATION& screenInfo = _getScreenInfo();
-    const COORD currentFontSize = screenInfo.GetScreenFontSize();
+    const COORD fontSize = screenInfo.GetScreenFontSize();
+    const SMALL_RECT viewport = screenInfo.GetViewport().ToInclusive();
+    const LONG viewportWidth = _getViewportWidth(viewport);
+    const TextBuffer& textBuffer = screenInfo.GetTextBuffer();
+    const unsigned int totalRows = textBuffer.TotalRowCount();
+    const TextBufferRow firstRowIndex = textBuffer.GetFirstRowIndex();
+
+    // the client area is only moved around, so finding where its origin is
+    // on the screen is enough to place all of the rectangles.
+    POINT origin{ 0, 0 };
+    ClientToScreen(_getWindowHandle(), &origin);
 
-    POINT topLeft;
-    POINT bottomRight;
+    const ScreenInfoRow startScreenInfoRow = _endpointToScreenInfoRow(_start);
+    const Column startColumn = _endpointToColumn(_start);
+    const ScreenInfoRow endScreenInfoRow = _endpointToScreenInfoRow(_end);
+    const Column endColumn = _endpointToColumn(_end);
 
-    if (_endpointToScreenInfoRow(_start) == screenInfoRow)
+    const TextBufferRow startRow = _endpointToTextBufferRow(_start);
+    const unsigned int totalRowsInRange = _degenerate ? 1 : _rowCountInRange();
+    for (unsigned int i = 0; i < totalRowsInRange; ++i)
     {
-        // start is somewhere in this row so we start from its position
-        topLeft.x = _endpointToColumn(_start) * currentFontSize.X;
-    }
-    else
-    {
-        // otherwise we start from the beginning of the row
-        topLeft.x = 0;
-    }
-
-    topLeft.y = _screenInfoRowToViewportRow(screenInfoRow) * currentFontSize.Y;
+        const ScreenInfoRow screenInfoRow = (startRow + i + totalRows - firstRowIndex) % totalRows;
+        if (!_isScreenInfoRowInViewport(screenInfoRow, viewport))
+        {
+            continue;
+        }
 
-    if (_endpointToScreenInfoRow(_end) == screenInfoRow)
-    {
-        // the endpoints are on the same row
-        bottomRight.x = (_endpointToColumn(_end) + 1) * currentFontSize.X;
-    }
-    else
-    {
-        // _end is not on this row so span to the end of the row
-        bottomRight.x = _getViewportWidth(_getViewport().ToInclusive()) * currentFontSize.X;
+        // start and end are somewhere in their rows. the rows between them
+        // span the whole width of the viewport.
+        const LONG left = screenInfoRow == startScreenInfoRow ? startColumn * fontSize.X : 0;
+        const LONG right = screenInfoRow == endScreenInfoRow ? (endColumn + 1) * fontSize.X : viewportWidth * fontSize.X;
+        const LONG top = _screenInfoRowToViewportRow(screenInfoRow, viewport) * fontSize.Y;
+
+        const double x = origin.x + left;
+        const double y = origin.y + top;
+        const double width = right - left;
+        const double height = fontSize.Y;
+
+        const size_t count = coords.size();
+        if (count >= 4 &&
+            coords[count - 4] == x &&
+            coords[count - 2] == width &&
+            coords[count - 3] + coords[count - 1] == y)
+        {
+            coords[count - 1] += height;
+        }
+        else
+        {
+            coords.push_back(x);
+            coords.push_back(y);
+            coords.push_back(width);
+            coords.push_back(height);
+        }
     }
-
-    // we add the font height only once here because we are adding each line individually
-    bottomRight.y = topLeft.y + currentFontSize.Y;
-
-    // convert the coords to be relative to the screen instead of
-    // the client window
-    HWND hwnd = _getWindowHandle();
-    ClientToScreen(hwnd, &topLeft);
-    ClientToScreen(hwnd, &bottomRight);
-
-    const LONG width = bottomRight.x - topLeft.x;
-    const LONG height = bottomRight.y - topLeft.y;
-
-    // insert the coords
-    coords.push_back(topLeft.x);
-    coords.push_back(topLeft.y);
-    coords.push_back(width);
-    coords.push_back(height);
 }
 
 // Routine Description:
@@ -1695,8 +1737,7 @@ std::pair<Endpoint, Endpoint> UiaTextRange::_moveByCharacterForward(const int mo
     for (int i = 0; i < abs(count); ++i)
     {
         // get the current row's right
-        const ROW& row = _getTextBuffer().GetRowByOffset(currentScreenInfoRow);
-        const size_t right = row.GetCharRow().MeasureRight();
+        const size_t right = _getCachedRow(currentScreenInfoRow).right;
 
         // check if we're at the edge of the screen info buffer
         if (currentScreenInfoRow == moveState.LimitingRow &&
@@ -1752,8 +1793,7 @@ std::pair<Endpoint, Endpoint> UiaTextRange::_moveByCharacterBackward(const int m
 
             currentScreenInfoRow += static_cast<int>(moveState.Increment);
             // get the right cell for the next row
-            const ROW& row = _getTextBuffer().GetRowByOffset(currentScreenInfoRow);
-            const size_t right = row.GetCharRow().MeasureRight();
+            const size_t right = _getCachedRow(currentScreenInfoRow).right;
             currentColumn = static_cast<Column>((right == 0) ? 0 : right - 1);
         }
         else
@@ -1897,8 +1937,7 @@ UiaTextRange::_moveEndpointByUnitCharacterForward(const int moveCount,
     for (int i = 0; i < abs(count); ++i)
     {
         // get the current row's right
-        const ROW& row = _getTextBuffer().GetRowByOffset(currentScreenInfoRow);
-        const size_t right = row.GetCharRow().MeasureRight();
+        const size_t right = _getCachedRow(currentScreenInfoRow).right;
 
         // check if we're at the edge of the screen info buffer
         if (currentScreenInfoRow == moveState.LimitingRow &&
@@ -1995,8 +2034,7 @@ UiaTextRange::_moveEndpointByUnitCharacterBackward(const int moveCount,
 
             currentScreenInfoRow += static_cast<int>(moveState.Increment);
             // get the right cell for the next row
-            const ROW& row = _getTextBuffer().GetRowByOffset(currentScreenInfoRow);
-            const size_t right = row.GetCharRow().MeasureRight();
+            const size_t right = _getCachedRow(currentScreenInfoRow).right;
             currentColumn = static_cast<Column>((right == 0) ? 0 : right - 1);
         }
         else
@@ -266,6 +266,24 @@ namespace Microsoft::Console::Interactivity::Win32
         // then both endpoints will contain the same value.
         bool _degenerate;
 
+        // what's needed from a row, kept until the row is next written to.
+        struct CachedRow
+        {
+            uint64_t generation;
+            bool containsText;
+            size_t right;
+            std::wstring text;
+        };
+
+        // plenty for a screen reader going back and forth over a screenful of text.
+        static constexpr size_t s_maxCachedRows = 256;
+
+        static const TextBuffer* s_cachedRowsBuffer;
+        static SHORT s_cachedRowsWidth;
+        static std::unordered_map<uint64_t, CachedRow> s_cachedRows;
+
+        static const CachedRow& _getCachedRow(const ScreenInfoRow row);
+
         static const Microsoft::Console::Types::Viewport& _getViewport();
         static HWND _getWindowHandle();
         static IConsoleWindow* const _getIConsoleWindow();
@@ -311,8 +329,7 @@ namespace Microsoft::Console::Interactivity::Win32
         static const unsigned int _getViewportHeight(const SMALL_RECT viewport);
         static const unsigned int _getViewportWidth(const SMALL_RECT viewport);
 
-        void _addScreenInfoRowBoundaries(const ScreenInfoRow screenInfoRow,
-                                         _Inout_ std::vector<double>& coords) const;
+        void _addBoundingRectangles(_Inout_ std::vector<double>& coords) const;
 
         static const int _compareScreenCoords(const ScreenInfoRow rowA,
                                               const Column colA,
@@ -21,6 +21,7 @@ Revision History:
 #include "precomp.h"
 
 #include "..\..\host\screenInfo.hpp"
+#include "PastePipeline.hpp"
 
 namespace Microsoft::Console::Interactivity::Win32
 {
@@ -37,6 +38,8 @@ namespace Microsoft::Console::Interactivity::Win32
     private:
         std::deque<std::unique_ptr<IInputEvent>> TextToKeyEvents(_In_reads_(cchData) const wchar_t* const pData,
                                                                  const size_t cchData);
+        std::wstring FilterPastedText(_In_reads_(cchData) const wchar_t* const pData,
+                                      const size_t cchData);
 
         void StoreSelectionToClipboard(_In_ bool const fAlsoCopyHtml);
 
@@ -44,12 +47,24 @@ namespace Microsoft::Console::Interactivity::Win32
                                                          const bool lineSelection,
                                                          const std::vector<SMALL_RECT>& selectionRects);
 
-        void CopyHTMLToClipboard(const TextBuffer::TextAndColor& rows);
-        std::string GenHTML(const TextBuffer::TextAndColor & rows);
-        void CopyTextToSystemClipboard(const TextBuffer::TextAndColor& rows, _In_ bool const fAlsoCopyHtml);
+        void RetrieveSelectedText(const SCREEN_INFORMATION& screenInfo,
+                                  const bool lineSelection,
+                                  const std::vector<SMALL_RECT>& selectionRects,
+                                  std::wstring& text,
+                                  std::vector<TextBuffer::ColorRun>* const colors);
+
+        std::string GenHTML(const std::wstring_view text, const std::vector<TextBuffer::ColorRun>& colors);
+        void CopyTextToSystemClipboard(const std::wstring& finalString, const std::vector<TextBuffer::ColorRun>* const colors);
 
         bool FilterCharacterOnPaste(_Inout_ WCHAR * const pwch);
 
+        // Pastes too big to type in one go are typed from here. See StringPaste.
+        PastePipeline _pastePipeline;
+
+        // Pastes of up to this many characters are typed right away, unless a
+        //      bigger one is still being typed.
+        static constexpr size_t s_SynchronousPasteLimit = 4096;
+
 #ifdef UNIT_TESTING
         friend class ClipboardTests;
 #endif
@@ -8,6 +8,7 @@
 #include "window.hpp"
 
 #include "..\..\host\dbcs.h"
+#include "..\..\host\findAll.h"
 #include "..\..\host\handle.h"
 #include "..\..\host\search.h"
 
@@ -42,32 +43,71 @@ INT_PTR CALLBACK FindDialogProc(HWND hWnd, UINT Message, WPARAM wParam, LPARAM l
                     }
                     bool const IgnoreCase = IsDlgButtonChecked(hWnd, ID_CONSOLE_FINDCASE) == 0;
                     bool const Reverse = IsDlgButtonChecked(hWnd, ID_CONSOLE_FINDDOWN) == 0;
+                    bool const Regex = IsDlgButtonChecked(hWnd, ID_CONSOLE_FINDREGEX) != 0;
                     fFindSearchUp = !!Reverse;
                     SCREEN_INFORMATION& ScreenInfo = gci.GetActiveOutputBuffer();
 
                     std::wstring wstr(szBuf, StringLength);
 
+                    const auto direction = Reverse ? Search::Direction::Backward : Search::Direction::Forward;
+                    const auto sensitivity = IgnoreCase ? Search::Sensitivity::CaseInsensitive : Search::Sensitivity::CaseSensitive;
+                    const auto syntax = Regex ? Search::Syntax::RegularExpression : Search::Syntax::Text;
+
                     LockConsole();
                     auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
 
-                    Search search(ScreenInfo,
-                                  wstr,
-                                  Reverse ? Search::Direction::Backward : Search::Direction::Forward,
-                                  IgnoreCase ? Search::Sensitivity::CaseInsensitive : Search::Sensitivity::CaseSensitive);
-
-                    if (search.FindNext())
+                    // Once all the matches have been found, step through them
+                    // rather than searching the buffer again.
+                    auto& findAll = FindAll::Instance();
+                    if (!Regex && findAll.IsActiveFor(wstr, sensitivity))
                     {
-                        Telemetry::Instance().LogFindDialogNextClicked(StringLength, (Reverse != 0), (IgnoreCase == 0));
-                        search.Select();
-                        return TRUE;
+                        if (findAll.SelectNext(direction))
+                        {
+                            return TRUE;
+                        }
+                        ScreenInfo.SendNotifyBeep();
+                        break;
                     }
-                    else
+
+                    try
                     {
-                        // The string wasn't found.
-                        ScreenInfo.SendNotifyBeep();
+                        Search search(ScreenInfo, wstr, direction, sensitivity, syntax);
+
+                        if (search.FindNext())
+                        {
+                            Telemetry::Instance().LogFindDialogNextClicked(StringLength, (Reverse != 0), (IgnoreCase == 0));
+                            search.Select();
+                            return TRUE;
+                        }
                     }
+                    CATCH_LOG();
+
+                    // The string wasn't found, or it isn't a valid regular expression.
+                    ScreenInfo.SendNotifyBeep();
                     break;
                 }
+                case ID_CONSOLE_FINDALL:
+                {
+                    USHORT const StringLength = (USHORT) GetDlgItemTextW(hWnd, ID_CONSOLE_FINDSTR, szBuf, ARRAYSIZE(szBuf));
+                    if (StringLength == 0)
+                    {
+                        break;
+                    }
+                    bool const IgnoreCase = IsDlgButtonChecked(hWnd, ID_CONSOLE_FINDCASE) == 0;
+
+                    // Finding all the matches is only done for text.
+                    if (IsDlgButtonChecked(hWnd, ID_CONSOLE_FINDREGEX) != 0)
+                    {
+                        gci.GetActiveOutputBuffer().SendNotifyBeep();
+                        break;
+                    }
+
+                    // This waits on the scan of the last string, so the
+                    // console mustn't be locked around it.
+                    FindAll::Instance().Start(std::wstring(szBuf, StringLength),
+                                              IgnoreCase ? Search::Sensitivity::CaseInsensitive : Search::Sensitivity::CaseSensitive);
+                    return TRUE;
+                }
                 case IDCANCEL:
                     Telemetry::Instance().FindDialogClosed();
                     EndDialog(hWnd, 0);
@@ -94,5 +134,8 @@ void DoFind()
         ++g.uiDialogBoxCount;
         DialogBoxParamW(g.hInstance, MAKEINTRESOURCE(ID_CONSOLE_FINDDLG), hwnd, FindDialogProc, (LPARAM) nullptr);
         --g.uiDialogBoxCount;
+
+        // The highlights only last as long as the dialog.
+        FindAll::Instance().Stop();
     }
 }
@@ -150,6 +150,24 @@ class UiaTextRangeTests
         VERIFY_ARE_EQUAL(1u, notDegenerate1._rowCountInRange());
     }
 
+    TEST_METHOD(CachedRowsFollowWritesToTheBuffer)
+    {
+        const auto& before = UiaTextRange::_getCachedRow(0);
+        VERIFY_IS_TRUE(before.containsText);
+        VERIFY_ARE_EQUAL(L'a', before.text.at(0));
+
+        // asking again without anything changing gives back the same row
+        VERIFY_ARE_EQUAL(&before, &UiaTextRange::_getCachedRow(0));
+
+        ROW& row = _pTextBuffer->GetRowByOffset(0);
+        row.GetCharRow().GlyphAt(0) = std::wstring_view{ L"b" };
+        row.MarkChanged();
+
+        const auto& after = UiaTextRange::_getCachedRow(0);
+        VERIFY_ARE_EQUAL(L'b', after.text.at(0));
+        VERIFY_ARE_EQUAL(L'a', UiaTextRange::_getCachedRow(1).text.at(0));
+    }
+
     TEST_METHOD(CanCheckIfScreenInfoRowIsInViewport)
     {
         // check a viewport that's one line tall
@@ -787,6 +787,9 @@ void Window::_HandleWindowPosChanged(const LPARAM lParam)
         _UpdateSystemMetrics();
     }
 
+    // There's no point in blinking the cursor while nobody can see it.
+    ServiceLocator::LocateGlobals().getConsoleInformation().GetCursorBlinker().WindowVisibilityChanged(IsWindowVisible(hWnd) && !IsIconic(hWnd));
+
     // This message is sent as the result of someone calling SetWindowPos(). We use it here to set/clear the
     // CONSOLE_IS_ICONIC bit appropriately. doing so in the WM_SIZE handler is incorrect because the WM_SIZE
     // comes after the WM_ERASEBKGND during SetWindowPos() processing, and the WM_ERASEBKGND needs to know if
@@ -0,0 +1,194 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "../inc/DirtyRows.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+DirtyRows::DirtyRows() noexcept :
+    _size{ 0, 0 },
+    _rows{}
+{
+}
+
+// Routine Description:
+// - Changes the size of the screen we're tracking. Whatever was dirty and is
+//   still on the screen stays dirty.
+// Arguments:
+// - size - The size of the screen, in characters
+// Return Value:
+// - <none>
+void DirtyRows::Resize(const COORD size)
+{
+    _rows.resize(std::max<SHORT>(size.Y, 0), Span{ 0, 0 });
+    for (auto& span : _rows)
+    {
+        span.right = std::min(span.right, size.X);
+    }
+    _size = size;
+}
+
+// Routine Description:
+// - Marks a rectangle of the screen as dirty. Anything off of the screen is ignored.
+// Arguments:
+// - exclusive - The rectangle, in characters. Exclusive.
+// Return Value:
+// - <none>
+void DirtyRows::Add(const SMALL_RECT exclusive) noexcept
+{
+    const auto top = std::max<SHORT>(exclusive.Top, 0);
+    const auto bottom = std::min<SHORT>(exclusive.Bottom, gsl::narrow_cast<SHORT>(_rows.size()));
+    for (auto row = top; row < bottom; ++row)
+    {
+        _Or(row, exclusive.Left, exclusive.Right);
+    }
+}
+
+// Routine Description:
+// - Moves what's dirty along with the screen when it scrolls. Like scrolling
+//   a window, what was dirty before the move stays dirty as well.
+// Arguments:
+// - delta - How far the contents of the screen moved, in characters
+// Return Value:
+// - <none>
+void DirtyRows::Offset(const COORD delta)
+{
+    if (delta.X == 0 && delta.Y == 0)
+    {
+        return;
+    }
+
+    // Walk against the direction of the move, so that every row is read
+    // before anything is moved onto it.
+    const auto count = gsl::narrow_cast<SHORT>(_rows.size());
+    for (SHORT i = 0; i < count; ++i)
+    {
+        const auto row = delta.Y > 0 ? gsl::narrow_cast<SHORT>(count - 1 - i) : i;
+        const auto span = _rows.at(row);
+        if (span.left < span.right)
+        {
+            _Or(gsl::narrow_cast<SHORT>(row + delta.Y),
+                gsl::narrow_cast<SHORT>(span.left + delta.X),
+                gsl::narrow_cast<SHORT>(span.right + delta.X));
+        }
+    }
+}
+
+// Routine Description:
+// - Moves what's dirty in some of the rows up or down, when only those rows of
+//   the screen scrolled. Like Offset, what was dirty before the move stays
+//   dirty, and nothing moves into or out of the rows.
+// Arguments:
+// - deltaY - How far the rows moved, in characters
+// - top - The first row that moved
+// - bottom - The row after the last one that moved
+// Return Value:
+// - <none>
+void DirtyRows::OffsetInside(const SHORT deltaY, const SHORT top, const SHORT bottom)
+{
+    const auto first = std::max<SHORT>(top, 0);
+    const auto last = std::min<SHORT>(bottom, gsl::narrow_cast<SHORT>(_rows.size()));
+    if (deltaY == 0 || first >= last)
+    {
+        return;
+    }
+
+    // Walk against the direction of the move, as in Offset.
+    for (SHORT i = 0; i < last - first; ++i)
+    {
+        const auto row = deltaY > 0 ? gsl::narrow_cast<SHORT>(last - 1 - i) : gsl::narrow_cast<SHORT>(first + i);
+        const auto target = row + deltaY;
+        const auto span = _rows.at(row);
+        if (target >= first && target < last && span.left < span.right)
+        {
+            _Or(gsl::narrow_cast<SHORT>(target), span.left, span.right);
+        }
+    }
+}
+
+// Routine Description:
+// - Marks the whole screen as clean again, once it's been painted.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void DirtyRows::Clear() noexcept
+{
+    std::fill(_rows.begin(), _rows.end(), Span{ 0, 0 });
+}
+
+// Routine Description:
+// - Gets the dirty parts of the screen, as few rectangles as it takes to
+//   cover exactly them. Consecutive rows that are dirty in the same columns
+//   share one rectangle.
+// Arguments:
+// - firstRow - Rows above this one are left out, even if they're dirty.
+// Return Value:
+// - The dirty rectangles, in characters, from top to bottom. Inclusive.
+std::vector<SMALL_RECT> DirtyRows::GetSpans(const SHORT firstRow) const
+{
+    std::vector<SMALL_RECT> spans;
+    for (size_t row = std::max<SHORT>(firstRow, 0); row < _rows.size(); ++row)
+    {
+        const auto& span = _rows.at(row);
+        if (span.left >= span.right)
+        {
+            continue;
+        }
+
+        const auto top = gsl::narrow_cast<SHORT>(row);
+        const auto left = span.left;
+        const auto right = gsl::narrow_cast<SHORT>(span.right - 1);
+        if (!spans.empty() &&
+            spans.back().Bottom == top - 1 &&
+            spans.back().Left == left &&
+            spans.back().Right == right)
+        {
+            spans.back().Bottom = top;
+        }
+        else
+        {
+            spans.push_back({ left, top, right, top });
+        }
+    }
+    return spans;
+}
+
+// Routine Description:
+// - Extends the dirty columns of one row to cover the given ones too. Anything
+//   off of the screen is ignored.
+// Arguments:
+// - row - The row
+// - left - The first dirty column
+// - right - The column after the last dirty one
+// Return Value:
+// - <none>
+void DirtyRows::_Or(const SHORT row, const SHORT left, const SHORT right) noexcept
+{
+    if (row < 0 || gsl::narrow_cast<size_t>(row) >= _rows.size())
+    {
+        return;
+    }
+
+    const auto clippedLeft = std::max<SHORT>(left, 0);
+    const auto clippedRight = std::min<SHORT>(right, _size.X);
+    if (clippedLeft >= clippedRight)
+    {
+        return;
+    }
+
+    auto& span = _rows.at(row);
+    if (span.left >= span.right)
+    {
+        span = { clippedLeft, clippedRight };
+    }
+    else
+    {
+        span.left = std::min(span.left, clippedLeft);
+        span.right = std::max(span.right, clippedRight);
+    }
+}
@@ -0,0 +1,276 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "FrameCapture.hpp"
+
+#include "../../buffer/out/textBuffer.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Types;
+
+namespace
+{
+    // Every frame starts with these, so that a file that's been cut short, or
+    //      was written by a different version, is noticed when it's read.
+    constexpr uint32_t s_magic = 0x4D524643; // "CFRM"
+    constexpr uint32_t s_version = 1;
+
+    template<typename T>
+    void WriteValue(std::ostream& stream, const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    T ReadValue(std::istream& stream)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value{};
+        stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), !stream);
+        return value;
+    }
+
+    void WriteString(std::ostream& stream, const std::wstring_view text)
+    {
+        WriteValue(stream, gsl::narrow<uint32_t>(text.size()));
+        stream.write(reinterpret_cast<const char*>(text.data()), text.size() * sizeof(wchar_t));
+    }
+
+    std::wstring ReadString(std::istream& stream)
+    {
+        std::wstring text(ReadValue<uint32_t>(stream), L'\0');
+        stream.read(reinterpret_cast<char*>(text.data()), text.size() * sizeof(wchar_t));
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), !stream);
+        return text;
+    }
+
+    template<typename T>
+    void WriteValues(std::ostream& stream, const std::vector<T>& values)
+    {
+        WriteValue(stream, gsl::narrow<uint32_t>(values.size()));
+        for (const auto& value : values)
+        {
+            WriteValue(stream, value);
+        }
+    }
+
+    template<typename T>
+    std::vector<T> ReadValues(std::istream& stream)
+    {
+        std::vector<T> values(ReadValue<uint32_t>(stream));
+        for (auto& value : values)
+        {
+            value = ReadValue<T>(stream);
+        }
+        return values;
+    }
+}
+
+// Routine Description:
+// - Takes down everything the renderer will paint a frame from. The data is
+//   expected to be locked.
+// Arguments:
+// - data - What the frame is painted from
+// - dirty - The area of the screen that the frame is painting
+// Return Value:
+// - The frame.
+CapturedFrame CapturedFrame::s_Capture(IRenderData& data, const std::vector<SMALL_RECT>& dirty)
+{
+    CapturedFrame frame{};
+    const auto viewport = data.GetViewport();
+    frame.viewport = viewport.ToInclusive();
+    frame.dirty = dirty;
+
+    // Each attribute is kept as the colors it resolved to, so that the color
+    //      table doesn't have to be captured along with it.
+    std::unordered_map<TextAttribute, uint16_t> indices;
+    const auto indexOf = [&](const TextAttribute& attr) {
+        const auto found = indices.find(attr);
+        if (found != indices.end())
+        {
+            return found->second;
+        }
+        const auto index = gsl::narrow<uint16_t>(frame.attributes.size());
+        frame.attributes.push_back({ data.GetForegroundColor(attr),
+                                     data.GetBackgroundColor(attr),
+                                     attr.GetMetaAttributes(),
+                                     attr.IsBold() });
+        indices.emplace(attr, index);
+        return index;
+    };
+    frame.defaultAttribute = indexOf(data.GetDefaultBrushColors());
+
+    const auto& buffer = data.GetTextBuffer();
+    const auto bufferSize = buffer.GetSize();
+    for (SHORT y = viewport.Top(); y <= viewport.BottomInclusive(); ++y)
+    {
+        Row row{};
+        if (bufferSize.IsInBounds(COORD{ viewport.Left(), y }))
+        {
+            row.wrapForced = buffer.GetRowByOffset(y).GetCharRow().WasWrapForced();
+
+            const auto line = Viewport::FromInclusive({ viewport.Left(), y, viewport.RightInclusive(), y });
+            for (auto it = buffer.GetCellDataAt({ viewport.Left(), y }, line); it; ++it)
+            {
+                const auto dbcs = it->DbcsAttr();
+                row.cells.push_back({ std::wstring{ it->Chars() },
+                                      dbcs.IsLeading() ? DbcsAttribute::Attribute::Leading :
+                                                         dbcs.IsTrailing() ? DbcsAttribute::Attribute::Trailing :
+                                                                             DbcsAttribute::Attribute::Single,
+                                      indexOf(it->TextAttr()) });
+            }
+        }
+        frame.rows.push_back(std::move(row));
+    }
+
+    auto cursor = data.GetCursorPosition();
+    viewport.ConvertToOrigin(&cursor);
+    frame.cursor = { cursor,
+                     data.IsCursorVisible(),
+                     data.IsCursorOn(),
+                     data.IsCursorDoubleWidth(),
+                     data.GetCursorHeight(),
+                     data.GetCursorPixelWidth(),
+                     data.GetCursorStyle(),
+                     data.GetCursorColor() };
+
+    for (const auto& rect : data.GetSelectionRects())
+    {
+        frame.selection.push_back(viewport.ConvertToOrigin(rect).ToInclusive());
+    }
+
+    const auto& font = data.GetFontInfo();
+    frame.font = { font.GetFaceName(), font.GetFamily(), font.GetWeight(), font.GetUnscaledSize(), font.GetCodePage() };
+    frame.gridLinesAllowed = data.IsGridLineDrawingAllowed();
+    frame.title = data.GetConsoleTitle();
+    return frame;
+}
+
+// Routine Description:
+// - Appends the frame to the stream.
+// Arguments:
+// - stream - Where to write it
+// Return Value:
+// - <none>
+void CapturedFrame::Write(std::ostream& stream) const
+{
+    WriteValue(stream, s_magic);
+    WriteValue(stream, s_version);
+    WriteValue(stream, viewport);
+    WriteValues(stream, dirty);
+    WriteValues(stream, selection);
+    WriteValues(stream, attributes);
+    WriteValue(stream, defaultAttribute);
+
+    WriteValue(stream, gsl::narrow<uint32_t>(rows.size()));
+    for (const auto& row : rows)
+    {
+        WriteValue(stream, row.wrapForced);
+        WriteValue(stream, gsl::narrow<uint32_t>(row.cells.size()));
+        for (const auto& cell : row.cells)
+        {
+            WriteString(stream, cell.text);
+            WriteValue(stream, cell.dbcs);
+            WriteValue(stream, cell.attribute);
+        }
+    }
+
+    WriteValue(stream, cursor);
+    WriteString(stream, font.faceName);
+    WriteValue(stream, font.family);
+    WriteValue(stream, font.weight);
+    WriteValue(stream, font.size);
+    WriteValue(stream, font.codePage);
+    WriteValue(stream, gridLinesAllowed);
+    WriteString(stream, title);
+}
+
+// Routine Description:
+// - Reads every frame in the stream, in the order they were captured.
+// Arguments:
+// - stream - Where to read them from
+// Return Value:
+// - The frames. Throws if the stream isn't made of whole frames.
+std::vector<CapturedFrame> CapturedFrame::s_ReadAll(std::istream& stream)
+{
+    std::vector<CapturedFrame> frames;
+    while (stream.peek() != std::char_traits<char>::eof())
+    {
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), ReadValue<uint32_t>(stream) != s_magic);
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_REVISION_MISMATCH), ReadValue<uint32_t>(stream) != s_version);
+
+        CapturedFrame frame{};
+        frame.viewport = ReadValue<SMALL_RECT>(stream);
+        frame.dirty = ReadValues<SMALL_RECT>(stream);
+        frame.selection = ReadValues<SMALL_RECT>(stream);
+        frame.attributes = ReadValues<Attribute>(stream);
+        frame.defaultAttribute = ReadValue<uint16_t>(stream);
+
+        frame.rows.resize(ReadValue<uint32_t>(stream));
+        for (auto& row : frame.rows)
+        {
+            row.wrapForced = ReadValue<bool>(stream);
+            row.cells.resize(ReadValue<uint32_t>(stream));
+            for (auto& cell : row.cells)
+            {
+                cell.text = ReadString(stream);
+                cell.dbcs = ReadValue<DbcsAttribute::Attribute>(stream);
+                cell.attribute = ReadValue<uint16_t>(stream);
+                THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), cell.attribute >= frame.attributes.size());
+            }
+        }
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), frame.defaultAttribute >= frame.attributes.size());
+
+        frame.cursor = ReadValue<CursorState>(stream);
+        frame.font.faceName = ReadString(stream);
+        frame.font.family = ReadValue<BYTE>(stream);
+        frame.font.weight = ReadValue<LONG>(stream);
+        frame.font.size = ReadValue<COORD>(stream);
+        frame.font.codePage = ReadValue<UINT>(stream);
+        frame.gridLinesAllowed = ReadValue<bool>(stream);
+        frame.title = ReadString(stream);
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+// Routine Description:
+// - Opens the file the frames are appended to.
+// Arguments:
+// - path - The file to append them to
+FrameCapture::FrameCapture(const std::wstring& path) :
+    _file{ path, std::ios::binary | std::ios::app },
+    _frames{ 0 }
+{
+    THROW_HR_IF(E_ACCESSDENIED, !_file);
+}
+
+// Routine Description:
+// - Captures the frame that's about to be painted, and appends it to the file,
+//   unless enough frames have been captured already.
+// Arguments:
+// - data - What the frame is painted from. It's expected to be locked.
+// - dirty - The area of the screen that the frame is painting
+// Return Value:
+// - <none>
+void FrameCapture::Capture(IRenderData& data, const std::vector<SMALL_RECT>& dirty) noexcept
+{
+    if (_frames >= s_MaxFrames)
+    {
+        return;
+    }
+
+    try
+    {
+        CapturedFrame::s_Capture(data, dirty).Write(_file);
+        _file.flush();
+        ++_frames;
+    }
+    CATCH_LOG();
+}
@@ -0,0 +1,106 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- FrameCapture.hpp
+
+Abstract:
+- Writes down what the renderer was given to paint a frame with, so that the
+  frame can be painted again somewhere else, by any engine (see
+  tools/framereplay). That way a frame that's slow for someone can be looked
+  at without their buffer, their font or their machine.
+- A frame is the visible rows, with the colors each of their attributes came
+  out as, the dirty area of the first engine, the cursor, the selection and
+  the font. Frames are appended to the file one after the other, as they're
+  painted, until there are s_MaxFrames of them.
+- Overlays (the IME's conversion areas) aren't captured.
+--*/
+
+#pragma once
+
+#include "../inc/IRenderData.hpp"
+#include "../../buffer/out/DbcsAttribute.hpp"
+
+#include <fstream>
+
+namespace Microsoft::Console::Render
+{
+    struct CapturedFrame
+    {
+        // What an attribute looked like: the colors it came out as, and
+        //      everything other than its colors that changes how it's drawn.
+        struct Attribute
+        {
+            COLORREF foreground;
+            COLORREF background;
+            WORD meta;
+            bool bold;
+        };
+
+        struct Cell
+        {
+            std::wstring text;
+            DbcsAttribute::Attribute dbcs;
+            uint16_t attribute; // an index into attributes
+        };
+
+        struct Row
+        {
+            std::vector<Cell> cells;
+            bool wrapForced;
+        };
+
+        struct Font
+        {
+            std::wstring faceName;
+            BYTE family;
+            LONG weight;
+            COORD size;
+            UINT codePage;
+        };
+
+        struct CursorState
+        {
+            COORD position; // relative to the viewport
+            bool visible;
+            bool on;
+            bool doubleWidth;
+            ULONG height;
+            ULONG pixelWidth;
+            CursorType style;
+            COLORREF color;
+        };
+
+        // Where the viewport was in the buffer. Everything else is relative to it.
+        SMALL_RECT viewport;
+        std::vector<SMALL_RECT> dirty;
+        std::vector<SMALL_RECT> selection;
+        std::vector<Attribute> attributes;
+        uint16_t defaultAttribute;
+        std::vector<Row> rows;
+        CursorState cursor;
+        Font font;
+        bool gridLinesAllowed;
+        std::wstring title;
+
+        static CapturedFrame s_Capture(IRenderData& data, const std::vector<SMALL_RECT>& dirty);
+
+        void Write(std::ostream& stream) const;
+        static std::vector<CapturedFrame> s_ReadAll(std::istream& stream);
+    };
+
+    class FrameCapture final
+    {
+    public:
+        FrameCapture(const std::wstring& path);
+
+        void Capture(IRenderData& data, const std::vector<SMALL_RECT>& dirty) noexcept;
+
+        static constexpr size_t s_MaxFrames = 1000;
+
+    private:
+        std::ofstream _file;
+        size_t _frames;
+    };
+}
@@ -0,0 +1,155 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "FrameStats.hpp"
+
+#pragma hdrstop
+
+TRACELOGGING_DEFINE_PROVIDER(g_hConsoleRendererTraceProvider,
+    "Microsoft.Windows.Console.Render",
+    // tl:{41a35baf-cd55-5e23-782b-7323338b5283}
+    (0x41a35baf, 0xcd55, 0x5e23, 0x78, 0x2b, 0x73, 0x23, 0x33, 0x8b, 0x52, 0x83),
+    TraceLoggingOptionMicrosoftTelemetry());
+
+using namespace Microsoft::Console::Render;
+using namespace std::chrono;
+
+namespace
+{
+    // Every renderer in the process shares the one provider, so it's registered
+    //      the first time anything's traced, and not again.
+    struct ProviderRegistration
+    {
+        ProviderRegistration() noexcept
+        {
+            TraceLoggingRegister(g_hConsoleRendererTraceProvider);
+        }
+
+        ~ProviderRegistration()
+        {
+            TraceLoggingUnregister(g_hConsoleRendererTraceProvider);
+        }
+    };
+
+    uint64_t ToMicroseconds(const FrameStats::Duration duration) noexcept
+    {
+        return gsl::narrow_cast<uint64_t>(duration_cast<microseconds>(duration).count());
+    }
+}
+
+void Microsoft::Console::Render::EnsureTraceProviderRegistered() noexcept
+{
+    static ProviderRegistration registration;
+}
+
+FrameStats::FrameStats() noexcept :
+    dirtyRows{ 0 },
+    clusters{ 0 },
+    brushChanges{ 0 },
+    bufferLines{ 0 },
+    _times{}
+{
+}
+
+// Routine Description:
+// - Zeroes everything, for the start of the next frame.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void FrameStats::Reset() noexcept
+{
+    *this = FrameStats{};
+}
+
+// Routine Description:
+// - Adds to the time spent in one phase of the frame.
+// Arguments:
+// - phase - The phase
+// - duration - How much longer it took
+// Return Value:
+// - <none>
+void FrameStats::AddTime(const FramePhase phase, const Duration duration) noexcept
+{
+    gsl::at(_times, static_cast<size_t>(phase)) += duration;
+}
+
+// Routine Description:
+// - Gets the time spent in one phase of the frame.
+// Arguments:
+// - phase - The phase
+// Return Value:
+// - The time spent in it, so far.
+FrameStats::Duration FrameStats::GetTime(const FramePhase phase) const noexcept
+{
+    return gsl::at(_times, static_cast<size_t>(phase));
+}
+
+// Routine Description:
+// - Writes the frame's numbers as an ETW event. Costs next to nothing when no
+//   one is listening.
+// Arguments:
+// - engine - The engine the frame was painted for, to tell engines apart.
+// Return Value:
+// - <none>
+void FrameStats::Trace(const void* const engine) const noexcept
+{
+#ifndef UNIT_TESTING
+    EnsureTraceProviderRegistered();
+
+    TraceLoggingWrite(g_hConsoleRendererTraceProvider,
+                      "Renderer_FrameStats",
+                      TraceLoggingPointer(engine, "engine"),
+                      TraceLoggingUInt64(ToMicroseconds(GetTime(FramePhase::Background)), "backgroundUs"),
+                      TraceLoggingUInt64(ToMicroseconds(GetTime(FramePhase::BufferOutput)), "bufferOutputUs"),
+                      TraceLoggingUInt64(ToMicroseconds(GetTime(FramePhase::Overlays)), "overlaysUs"),
+                      TraceLoggingUInt64(ToMicroseconds(GetTime(FramePhase::Selection)), "selectionUs"),
+                      TraceLoggingUInt64(ToMicroseconds(GetTime(FramePhase::Cursor)), "cursorUs"),
+                      TraceLoggingUInt64(ToMicroseconds(GetTime(FramePhase::Title)), "titleUs"),
+                      TraceLoggingUInt64(ToMicroseconds(GetTime(FramePhase::Present)), "presentUs"),
+                      TraceLoggingUInt64(dirtyRows, "dirtyRows"),
+                      TraceLoggingUInt64(clusters, "clusters"),
+                      TraceLoggingUInt64(brushChanges, "brushChanges"),
+                      TraceLoggingUInt64(bufferLines, "bufferLines"),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE));
+#else
+    UNREFERENCED_PARAMETER(engine);
+#endif UNIT_TESTING
+}
+
+// Routine Description:
+// - Describes the frame in one short line, for drawing onto the screen.
+// Arguments:
+// - <none>
+// Return Value:
+// - The description.
+std::wstring FrameStats::ToString() const
+{
+    std::wstringstream ss;
+    ss << L"bg " << ToMicroseconds(GetTime(FramePhase::Background))
+       << L" text " << ToMicroseconds(GetTime(FramePhase::BufferOutput))
+       << L" ovl " << ToMicroseconds(GetTime(FramePhase::Overlays))
+       << L" sel " << ToMicroseconds(GetTime(FramePhase::Selection))
+       << L" cur " << ToMicroseconds(GetTime(FramePhase::Cursor))
+       << L" title " << ToMicroseconds(GetTime(FramePhase::Title))
+       << L" present " << ToMicroseconds(GetTime(FramePhase::Present))
+       << L"us | rows " << dirtyRows
+       << L" clusters " << clusters
+       << L" brushes " << brushChanges
+       << L" lines " << bufferLines;
+    return ss.str();
+}
+
+FramePhaseTimer::FramePhaseTimer(FrameStats& stats, const FramePhase phase) noexcept :
+    _stats{ stats },
+    _phase{ phase },
+    _start{ steady_clock::now() }
+{
+}
+
+FramePhaseTimer::~FramePhaseTimer()
+{
+    _stats.AddTime(_phase, steady_clock::now() - _start);
+}
@@ -0,0 +1,85 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- FrameStats.hpp
+
+Abstract:
+- Measures what a frame cost to paint for one engine: how long each phase of
+  the frame took, and how much was handed to the engine along the way.
+- Each frame's numbers are written as an ETW event, and in Debug builds they
+  can be drawn onto the frame itself (see Renderer::_PaintDebugOverlay).
+--*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include <winmeta.h>
+#include <TraceLoggingProvider.h>
+#include <telemetry\ProjectTelemetry.h>
+
+TRACELOGGING_DECLARE_PROVIDER(g_hConsoleRendererTraceProvider);
+
+namespace Microsoft::Console::Render
+{
+    // Registers g_hConsoleRendererTraceProvider, the first time it's called.
+    void EnsureTraceProviderRegistered() noexcept;
+
+    // The phases of a frame, in the order they're painted.
+    enum class FramePhase : size_t
+    {
+        Background = 0,
+        BufferOutput,
+        Overlays,
+        Selection,
+        Cursor,
+        Title,
+        Present,
+        Count
+    };
+
+    class FrameStats final
+    {
+    public:
+        using Duration = std::chrono::steady_clock::duration;
+
+        FrameStats() noexcept;
+
+        void Reset() noexcept;
+
+        void AddTime(const FramePhase phase, const Duration duration) noexcept;
+        Duration GetTime(const FramePhase phase) const noexcept;
+
+        void Trace(const void* const engine) const noexcept;
+        std::wstring ToString() const;
+
+        // What was handed to the engine during the frame.
+        size_t dirtyRows;
+        size_t clusters;
+        size_t brushChanges;
+        size_t bufferLines;
+
+    private:
+        std::array<Duration, static_cast<size_t>(FramePhase::Count)> _times;
+    };
+
+    // Adds the time from when it's created to when it goes out of scope to
+    //      one phase of a frame.
+    class FramePhaseTimer final
+    {
+    public:
+        FramePhaseTimer(FrameStats& stats, const FramePhase phase) noexcept;
+        ~FramePhaseTimer();
+
+        FramePhaseTimer(const FramePhaseTimer&) = delete;
+        FramePhaseTimer& operator=(const FramePhaseTimer&) = delete;
+
+    private:
+        FrameStats& _stats;
+        const FramePhase _phase;
+        const std::chrono::steady_clock::time_point _start;
+    };
+}
@@ -0,0 +1,95 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "../inc/GlyphWidthCache.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// Routine Description:
+// - Sets the face that the glyphs are being measured in. If it isn't the one
+//   they were measured in before, the measurements are dropped.
+// Arguments:
+// - face - name of the font face
+void GlyphWidthCache::SetFace(const std::wstring_view face)
+{
+    if (_face != face)
+    {
+        _face = face;
+        _widths.clear();
+    }
+}
+
+// Routine Description:
+// - Looks up a glyph's measurement.
+// Arguments:
+// - glyph - the glyph to look up
+// Return Value:
+// - whether the glyph is wide, if it has been measured.
+std::optional<bool> GlyphWidthCache::Find(const std::wstring_view glyph) const noexcept
+{
+    const auto codepoint = s_GetCodepoint(glyph);
+    if (codepoint.has_value())
+    {
+        const auto found = _widths.find(codepoint.value());
+        if (found != _widths.end())
+        {
+            return found->second;
+        }
+    }
+    return std::nullopt;
+}
+
+// Routine Description:
+// - Remembers a glyph's measurement. Glyphs of more than one codepoint aren't kept.
+// Arguments:
+// - glyph - the glyph that was measured
+// - isWide - whether it's wide
+void GlyphWidthCache::Store(const std::wstring_view glyph, const bool isWide)
+{
+    const auto codepoint = s_GetCodepoint(glyph);
+    if (codepoint.has_value())
+    {
+        if (_widths.size() >= s_MaxEntries)
+        {
+            _widths.clear();
+        }
+        _widths[codepoint.value()] = isWide;
+    }
+}
+
+// Routine Description:
+// - Gets the codepoint of a glyph that's one UTF-16 character or a surrogate pair.
+// Arguments:
+// - glyph - the glyph
+// Return Value:
+// - the codepoint, or nothing if the glyph is anything else.
+std::optional<char32_t> GlyphWidthCache::s_GetCodepoint(const std::wstring_view glyph) noexcept
+{
+    if (glyph.size() == 1)
+    {
+        return glyph.front();
+    }
+    if (glyph.size() == 2 && IS_HIGH_SURROGATE(glyph.at(0)) && IS_LOW_SURROGATE(glyph.at(1)))
+    {
+        return 0x10000 + ((static_cast<char32_t>(glyph.at(0)) - 0xD800) << 10) + (glyph.at(1) - 0xDC00);
+    }
+    return std::nullopt;
+}
+
+// Routine Description:
+// - Estimates how much memory the measurements are holding.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of the cache.
+Microsoft::Console::Types::MemoryUsage GlyphWidthCache::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddContiguous(_face);
+    usage.AddHashTable(_widths);
+    return usage;
+}
@@ -0,0 +1,202 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "InputLatency.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+using namespace std::chrono;
+
+// Routine Description:
+// - Checks if anyone's tracing for latency. This is all that the marks cost
+//   when no one is.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if the stages should be marked and the latencies measured.
+bool InputLatency::IsEnabled() noexcept
+{
+#ifndef UNIT_TESTING
+    EnsureTraceProviderRegistered();
+    return TraceLoggingProviderEnabled(g_hConsoleRendererTraceProvider, WINEVENT_LEVEL_VERBOSE, s_Keyword);
+#else
+    return false;
+#endif UNIT_TESTING
+}
+
+// Routine Description:
+// - Writes an ETW event for a key press reaching one of its stages. The
+//   event's timestamp is the measurement.
+// Arguments:
+// - stage - The stage reached
+// Return Value:
+// - <none>
+void InputLatency::Mark(const LatencyStage stage) noexcept
+{
+#ifndef UNIT_TESTING
+    if (IsEnabled())
+    {
+        TraceLoggingWrite(g_hConsoleRendererTraceProvider,
+                          "InputLatency_Stage",
+                          TraceLoggingUInt32(static_cast<uint32_t>(stage), "stage"),
+                          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                          TraceLoggingKeyword(s_Keyword));
+    }
+#else
+    UNREFERENCED_PARAMETER(stage);
+#endif UNIT_TESTING
+}
+
+// Routine Description:
+// - Marks input coming in, and if nothing's being measured yet, starts
+//   measuring from now. Input that comes in before the frame that shows the
+//   last of it is counted from the oldest.
+// Arguments:
+// - stage - The stage the input reached
+// Return Value:
+// - <none>
+void InputLatency::InputArrived(const LatencyStage stage) noexcept
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    Mark(stage);
+    try
+    {
+        auto& state = s_State();
+        std::lock_guard<std::mutex> guard{ state.lock };
+        if (!state.inputTime.has_value())
+        {
+            state.inputTime = steady_clock::now();
+            state.outputSeen = false;
+        }
+    }
+    CATCH_LOG();
+}
+
+// Routine Description:
+// - Marks output coming in. The next frame that's presented is taken to be
+//   the one that shows what the input did.
+// Arguments:
+// - stage - The stage the output reached
+// Return Value:
+// - <none>
+void InputLatency::OutputArrived(const LatencyStage stage) noexcept
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    Mark(stage);
+    try
+    {
+        auto& state = s_State();
+        std::lock_guard<std::mutex> guard{ state.lock };
+        if (state.inputTime.has_value())
+        {
+            state.outputSeen = true;
+        }
+    }
+    CATCH_LOG();
+}
+
+// Routine Description:
+// - Called when a frame's been presented. If output came in for input that
+//   hasn't been shown yet, this finishes its measurement.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void InputLatency::Presented() noexcept
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    try
+    {
+        auto& state = s_State();
+        std::lock_guard<std::mutex> guard{ state.lock };
+        if (!state.inputTime.has_value() || !state.outputSeen)
+        {
+            return;
+        }
+
+        const auto latency = duration_cast<microseconds>(steady_clock::now() - state.inputTime.value());
+        state.inputTime.reset();
+        state.outputSeen = false;
+
+        Mark(LatencyStage::Presented);
+        state.samples.push_back(gsl::narrow_cast<uint32_t>(std::min<microseconds::rep>(latency.count(), UINT32_MAX)));
+        if (state.samples.size() >= s_BatchSize)
+        {
+            s_ReportBatch(state);
+        }
+    }
+    CATCH_LOG();
+}
+
+// Routine Description:
+// - Describes the percentiles of the last batch of latencies, for the debug overlay.
+// Arguments:
+// - <none>
+// Return Value:
+// - The description, or an empty string if there's nothing measured yet.
+std::wstring InputLatency::Summary()
+{
+    auto& state = s_State();
+    std::lock_guard<std::mutex> guard{ state.lock };
+    return state.summary;
+}
+
+InputLatency::State& InputLatency::s_State()
+{
+    static State state;
+    return state;
+}
+
+// Routine Description:
+// - Reports the percentiles of a batch of latencies as an ETW event, keeps
+//   them for the overlay and starts the next batch.
+// Arguments:
+// - state - The state, with its lock held.
+// Return Value:
+// - <none>
+void InputLatency::s_ReportBatch(State& state)
+{
+    auto& samples = state.samples;
+    const auto percentile = [&](const size_t pct) {
+        const auto nth = samples.begin() + (samples.size() - 1) * pct / 100;
+        std::nth_element(samples.begin(), nth, samples.end());
+        return *nth;
+    };
+
+    const uint32_t p50 = percentile(50);
+    const uint32_t p90 = percentile(90);
+    const uint32_t p99 = percentile(99);
+    const uint32_t max = *std::max_element(samples.begin(), samples.end());
+
+#ifndef UNIT_TESTING
+    TraceLoggingWrite(g_hConsoleRendererTraceProvider,
+                      "InputLatency_Percentiles",
+                      TraceLoggingUInt32(gsl::narrow_cast<uint32_t>(samples.size()), "samples"),
+                      TraceLoggingUInt32(p50, "p50Us"),
+                      TraceLoggingUInt32(p90, "p90Us"),
+                      TraceLoggingUInt32(p99, "p99Us"),
+                      TraceLoggingUInt32(max, "maxUs"),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(s_Keyword));
+#endif UNIT_TESTING
+
+    std::wstringstream ss;
+    ss << L"key p50 " << p50 << L" p90 " << p90 << L" p99 " << p99 << L" max " << max << L"us";
+    state.summary = ss.str();
+    samples.clear();
+}
@@ -0,0 +1,78 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- InputLatency.hpp
+
+Abstract:
+- Measures how long it takes from a key press to the frame that shows what it
+  did. It only does any work while someone's tracing the renderer provider
+  with the Latency keyword.
+- Every process on the path marks the stages it sees as ETW events, so that a
+  trace shows one key going from the Terminal through ConPTY to the client and
+  back to the screen, in order, on one clock.
+- Each process also measures its own stretch: from the first input it sees
+  (a key in the Terminal, VT input in conhost) to the first frame presented
+  after output came in after it. Those latencies are reported in batches, as
+  percentiles, and in Debug builds drawn by the debug overlay.
+--*/
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+#include "FrameStats.hpp"
+
+namespace Microsoft::Console::Render
+{
+    // The stages of a key press, in the order it goes through them.
+    enum class LatencyStage : uint32_t
+    {
+        KeyReceived = 0, // TermControl got the key
+        InputSent, // TermControl handed it to the connection
+        VtInputReceived, // conhost read it off the ConPTY input pipe
+        InputBuffered, // it was written to conhost's input buffer
+        ClientRead, // the client read it from the input buffer
+        OutputWritten, // the client wrote its echo
+        OutputParsed, // the Terminal parsed the output from the connection
+        Presented // the frame with the output was presented
+    };
+
+    class InputLatency final
+    {
+    public:
+        // The keyword that turns the measuring on.
+        static constexpr ULONGLONG s_Keyword = 0x2;
+
+        InputLatency() = delete;
+
+        static bool IsEnabled() noexcept;
+        static void Mark(const LatencyStage stage) noexcept;
+
+        static void InputArrived(const LatencyStage stage) noexcept;
+        static void OutputArrived(const LatencyStage stage) noexcept;
+        static void Presented() noexcept;
+
+        static std::wstring Summary();
+
+    private:
+        // How many latencies are gathered before their percentiles are reported.
+        static constexpr size_t s_BatchSize = 64;
+
+        struct State
+        {
+            std::mutex lock;
+            // When the oldest input that nothing's been shown for yet came in,
+            //      and whether any output's come in since then.
+            std::optional<std::chrono::steady_clock::time_point> inputTime;
+            bool outputSeen = false;
+            std::vector<uint32_t> samples;
+            std::wstring summary;
+        };
+
+        static State& s_State();
+        static void s_ReportBatch(State& state);
+    };
+}
@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "PaintWorker.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// Routine Description:
+// - Starts the worker's thread, which waits for work.
+// Arguments:
+// - <none>
+// Return Value:
+// - An instance of a PaintWorker.
+// NOTE: CAN THROW IF THE THREAD CAN'T BE STARTED.
+PaintWorker::PaintWorker() :
+    _lock{},
+    _changed{},
+    _work{},
+    _busy{ false },
+    _exiting{ false },
+    _thread{ &PaintWorker::_ThreadProc, this }
+{
+}
+
+// Routine Description:
+// - Lets whatever the worker is doing finish, then stops its thread.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+PaintWorker::~PaintWorker()
+{
+    {
+        std::unique_lock<std::mutex> lock{ _lock };
+        _exiting = true;
+    }
+    _changed.notify_all();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+// Routine Description:
+// - Hands the worker something to do, and returns without waiting for it.
+//   Anything that was handed over before has to be waited for first.
+// Arguments:
+// - work - What to do, on the worker's thread. What it throws is logged.
+// Return Value:
+// - <none>
+void PaintWorker::Run(std::function<void()> work)
+{
+    {
+        std::unique_lock<std::mutex> lock{ _lock };
+        FAIL_FAST_IF(_busy); // This is a programming error. Fail fast.
+        _work = std::move(work);
+        _busy = true;
+    }
+    _changed.notify_all();
+}
+
+// Routine Description:
+// - Waits for whatever the worker was handed to finish. Returns straight away
+//   if it isn't doing anything.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void PaintWorker::Wait()
+{
+    std::unique_lock<std::mutex> lock{ _lock };
+    _changed.wait(lock, [this]() { return !_busy; });
+}
+
+void PaintWorker::_ThreadProc()
+{
+    std::unique_lock<std::mutex> lock{ _lock };
+    while (true)
+    {
+        _changed.wait(lock, [this]() { return _busy || _exiting; });
+        if (!_busy)
+        {
+            return;
+        }
+
+        auto work = std::move(_work);
+        _work = nullptr;
+
+        lock.unlock();
+        try
+        {
+            work();
+        }
+        CATCH_LOG();
+        lock.lock();
+
+        _busy = false;
+        _changed.notify_all();
+    }
+}
@@ -0,0 +1,47 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- PaintWorker.hpp
+
+Abstract:
+- A thread that paints one render engine, so that the renderer can paint all
+  of its engines at the same time instead of one after the other.
+- An engine is always painted on the same worker. Engines that hold on to
+  per-thread resources from StartPaint to EndPaint (like a DC) still get them
+  back on the thread that asked for them.
+--*/
+
+#pragma once
+
+#include <condition_variable>
+
+namespace Microsoft::Console::Render
+{
+    class PaintWorker final
+    {
+    public:
+        PaintWorker();
+        ~PaintWorker();
+
+        PaintWorker(const PaintWorker&) = delete;
+        PaintWorker& operator=(const PaintWorker&) = delete;
+
+        void Run(std::function<void()> work);
+        void Wait();
+
+    private:
+        void _ThreadProc();
+
+        // The work that's been handed over and hasn't finished, guarded by _lock.
+        std::mutex _lock;
+        std::condition_variable _changed;
+        std::function<void()> _work;
+        bool _busy;
+        bool _exiting;
+
+        // Declared last, so that everything above is ready before it starts.
+        std::thread _thread;
+    };
+}
@@ -0,0 +1,204 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "PipelineActivity.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+namespace
+{
+    // The innermost activity that's running on this thread.
+    thread_local const PipelineActivity* t_current = nullptr;
+
+    std::atomic<uint64_t> s_nextSequence{ 1 };
+
+    const char* StageName(const PipelineStage stage) noexcept
+    {
+        switch (stage)
+        {
+        case PipelineStage::Output:
+            return "Output";
+        case PipelineStage::Parse:
+            return "Parse";
+        case PipelineStage::BufferWrite:
+            return "BufferWrite";
+        case PipelineStage::Frame:
+            return "Frame";
+        case PipelineStage::Paint:
+            return "Paint";
+        case PipelineStage::Present:
+            return "Present";
+        default:
+            return "Unknown";
+        }
+    }
+}
+
+// Routine Description:
+// - Starts an activity for one stage. If another activity is running on this
+//   thread, this one is related to it.
+// Arguments:
+// - stage - The stage that's starting
+// - size - How much it's handling, in characters, if that means anything for it
+PipelineActivity::PipelineActivity(const PipelineStage stage, const size_t size) noexcept :
+    PipelineActivity(stage, t_current, size)
+{
+}
+
+// Routine Description:
+// - Starts an activity for one stage, as a part of the given one. This is for
+//   stages that are run on another thread from the one they're a part of.
+// Arguments:
+// - stage - The stage that's starting
+// - parent - The activity this one is a part of, or null if it isn't a part of any
+// - size - How much it's handling, in characters, if that means anything for it
+PipelineActivity::PipelineActivity(const PipelineStage stage, const PipelineActivity* const parent, const size_t size) noexcept :
+    _stage{ stage },
+    _active{ false },
+    _id{},
+    _parent{ parent },
+    _previous{ nullptr }
+{
+    if (IsEnabled())
+    {
+        _Start(size);
+    }
+}
+
+PipelineActivity::~PipelineActivity()
+{
+    if (!_active)
+    {
+        return;
+    }
+
+#ifndef UNIT_TESTING
+    TraceLoggingWriteActivity(g_hConsoleRendererTraceProvider,
+                              "Pipeline_Stage",
+                              &_id.guid,
+                              nullptr,
+                              TraceLoggingString(StageName(_stage), "stage"),
+                              TraceLoggingUInt64(_id.sequence, "sequence"),
+                              TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+                              TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                              TraceLoggingKeyword(s_Keyword));
+#endif UNIT_TESTING
+
+    t_current = _previous;
+}
+
+// Routine Description:
+// - Checks if anyone's tracing the pipeline. This is all that an activity
+//   costs when no one is.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if the activities should be written.
+bool PipelineActivity::IsEnabled() noexcept
+{
+#ifndef UNIT_TESTING
+    EnsureTraceProviderRegistered();
+    return TraceLoggingProviderEnabled(g_hConsoleRendererTraceProvider, WINEVENT_LEVEL_VERBOSE, s_Keyword);
+#else
+    return false;
+#endif UNIT_TESTING
+}
+
+// Routine Description:
+// - Gets the chunk of output that's being handled on this thread, if there is
+//   one, so that an invalidation can be tied to what caused it.
+// Arguments:
+// - <none>
+// Return Value:
+// - The outermost activity running on this thread, if it's an Output one.
+std::optional<PipelineActivity::Id> PipelineActivity::s_CurrentOutput() noexcept
+{
+    auto activity = t_current;
+    if (!activity)
+    {
+        return std::nullopt;
+    }
+
+    while (activity->_parent)
+    {
+        activity = activity->_parent;
+    }
+
+    if (!activity->_active || activity->_stage != PipelineStage::Output)
+    {
+        return std::nullopt;
+    }
+    return activity->_id;
+}
+
+// Routine Description:
+// - Writes an event for each chunk of output that a frame is showing, with the
+//   output as its related activity.
+// Arguments:
+// - outputs - The chunks of output that invalidated what the frame is painting
+// Return Value:
+// - <none>
+void PipelineActivity::Includes(const std::vector<Id>& outputs) const noexcept
+{
+    if (!_active)
+    {
+        return;
+    }
+
+#ifndef UNIT_TESTING
+    for (const auto& output : outputs)
+    {
+        TraceLoggingWriteActivity(g_hConsoleRendererTraceProvider,
+                                  "Pipeline_FrameIncludes",
+                                  &_id.guid,
+                                  &output.guid,
+                                  TraceLoggingUInt64(_id.sequence, "sequence"),
+                                  TraceLoggingUInt64(output.sequence, "outputSequence"),
+                                  TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                                  TraceLoggingKeyword(s_Keyword));
+    }
+#else
+    UNREFERENCED_PARAMETER(outputs);
+#endif UNIT_TESTING
+}
+
+// Routine Description:
+// - Makes up an ID for the activity, writes its start event, and makes it the
+//   current activity on this thread.
+// Arguments:
+// - size - How much the stage is handling
+// Return Value:
+// - <none>
+void PipelineActivity::_Start(const size_t size) noexcept
+{
+#ifndef UNIT_TESTING
+    if (EventActivityIdControl(EVENT_ACTIVITY_CTRL_CREATE_ID, &_id.guid) != ERROR_SUCCESS)
+    {
+        return;
+    }
+    _id.sequence = s_nextSequence.fetch_add(1, std::memory_order_relaxed);
+
+    const GUID* const related = _parent && _parent->_active ? &_parent->_id.guid : nullptr;
+    TraceLoggingWriteActivity(g_hConsoleRendererTraceProvider,
+                              "Pipeline_Stage",
+                              &_id.guid,
+                              related,
+                              TraceLoggingString(StageName(_stage), "stage"),
+                              TraceLoggingUInt64(_id.sequence, "sequence"),
+                              TraceLoggingUInt64(_parent && _parent->_active ? _parent->_id.sequence : 0, "parentSequence"),
+                              TraceLoggingUInt64(size, "size"),
+                              TraceLoggingOpcode(WINEVENT_OPCODE_START),
+                              TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                              TraceLoggingKeyword(s_Keyword));
+
+    _active = true;
+    _previous = t_current;
+    t_current = this;
+#else
+    UNREFERENCED_PARAMETER(size);
+#endif UNIT_TESTING
+}
@@ -0,0 +1,75 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- PipelineActivity.hpp
+
+Abstract:
+- Follows a chunk of output through the stages it goes through before it's on
+  the screen: parsed, written to the buffer, invalidated, painted into a
+  frame, and presented. It only does any work while someone's tracing the
+  renderer provider with the Pipeline keyword.
+- Each stage is an ETW activity: a pair of Pipeline_Stage events, a start and
+  a stop, with the same activity ID. A stage that's run inside another on the same
+  thread (parsing inside a chunk of output, say) has the outer one as its
+  related activity.
+- A chunk of output that invalidates part of the screen is remembered by the
+  renderer it invalidated, and the next frame that renderer paints writes a
+  Pipeline_FrameIncludes event for it, tying the output to the frame that
+  showed it. See ConsolePerf.regions.xml for WPA regions built on these.
+--*/
+
+#pragma once
+
+#include "FrameStats.hpp"
+
+namespace Microsoft::Console::Render
+{
+    // The stages a chunk of output goes through, in order.
+    enum class PipelineStage : uint32_t
+    {
+        Output = 0, // a chunk of output came in, from a client or a connection
+        Parse, // it went through the state machine
+        BufferWrite, // its text was written to the buffer
+        Frame, // a frame was painted and presented, for every engine
+        Paint, // one engine painted its frame
+        Present // one engine presented its frame
+    };
+
+    class PipelineActivity final
+    {
+    public:
+        // The keyword that turns the activities on.
+        static constexpr ULONGLONG s_Keyword = 0x4;
+
+        // Enough to refer to an activity after it's over.
+        struct Id
+        {
+            GUID guid;
+            uint64_t sequence;
+        };
+
+        PipelineActivity(const PipelineStage stage, const size_t size = 0) noexcept;
+        PipelineActivity(const PipelineStage stage, const PipelineActivity* const parent, const size_t size = 0) noexcept;
+        ~PipelineActivity();
+
+        PipelineActivity(const PipelineActivity&) = delete;
+        PipelineActivity& operator=(const PipelineActivity&) = delete;
+
+        static bool IsEnabled() noexcept;
+        static std::optional<Id> s_CurrentOutput() noexcept;
+
+        void Includes(const std::vector<Id>& outputs) const noexcept;
+
+    private:
+        const PipelineStage _stage;
+        bool _active;
+        Id _id;
+        const PipelineActivity* _parent;
+        // The activity that was current on this thread before this one.
+        const PipelineActivity* _previous;
+
+        void _Start(const size_t size) noexcept;
+    };
+}
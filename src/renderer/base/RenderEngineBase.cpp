@@ -37,3 +37,54 @@ HRESULT RenderEngineBase::UpdateTitle(const std::wstring& newTitle) noexcept
     }
     return hr;
 }
+
+// Routine Description:
+// - By default, an engine can't move what's already been painted, so all of the
+//   region that scrolled has to be painted again.
+// Arguments:
+// - psrRegion - The region that the contents moved inside of, in characters. Exclusive.
+// - pcoordDelta - How far the contents moved, in characters
+// Return Value:
+// - S_OK, else an appropriate HRESULT for failing to invalidate.
+[[nodiscard]]
+HRESULT RenderEngineBase::InvalidateScrollRegion(const SMALL_RECT* const psrRegion,
+                                                 const COORD* const /*pcoordDelta*/) noexcept
+{
+    return Invalidate(psrRegion);
+}
+
+// Routine Description:
+// - By default, an engine has no idea when its display is ready for the next
+//   frame, so it leaves pacing the frames up to the render thread.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_FALSE
+[[nodiscard]]
+HRESULT RenderEngineBase::WaitUntilCanRender() noexcept
+{
+    return S_FALSE;
+}
+
+// Routine Description:
+// - By default, an engine only keeps one rectangle around everything that's
+//   dirty, so that's the whole of the area that needs to be painted.
+// Arguments:
+// - <none>
+// Return Value:
+// - The dirty rectangle, in characters. Inclusive.
+std::vector<SMALL_RECT> RenderEngineBase::GetDirtyArea()
+{
+    return { GetDirtyRectInChars() };
+}
+
+// Routine Description:
+// - By default, an engine doesn't keep anything from one frame to the next.
+// Arguments:
+// - <none>
+// Return Value:
+// - Nothing.
+Microsoft::Console::Types::MemoryUsage RenderEngineBase::GetCacheMemoryUsage() const noexcept
+{
+    return {};
+}
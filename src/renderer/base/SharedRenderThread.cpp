@@ -0,0 +1,463 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "SharedRenderThread.hpp"
+
+#include <condition_variable>
+
+#pragma hdrstop
+
+// Older SDKs don't know about high resolution timers, but Windows will just
+// ignore the flag if it doesn't support them either.
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+using namespace Microsoft::Console::Render;
+
+namespace Microsoft::Console::Render
+{
+    // The clock and the workers that every SharedRenderThread in the process shares.
+    //      It's made for the first of them, and goes away with the last one.
+    class RenderScheduler final
+    {
+    public:
+        static std::shared_ptr<RenderScheduler> s_Get();
+
+        RenderScheduler();
+        ~RenderScheduler();
+
+        RenderScheduler(const RenderScheduler&) = delete;
+        RenderScheduler& operator=(const RenderScheduler&) = delete;
+
+        size_t Add(SharedRenderThread& client);
+        void Remove(SharedRenderThread& client);
+
+        void Wake();
+        void SetEnabled(SharedRenderThread& client, const bool enabled);
+        void WaitForPaint(SharedRenderThread& client, const DWORD dwTimeoutMs);
+
+    private:
+        struct Worker
+        {
+            std::condition_variable ready;
+            std::deque<SharedRenderThread*> queue;
+            size_t clients = 0;
+            std::thread thread;
+        };
+
+        // There's no gain from more of these than there are cores to paint on.
+        static constexpr size_t s_MaxWorkers = 4;
+
+        // Renderers due within this long of each other are painted on the same tick.
+        static constexpr std::chrono::milliseconds s_TickSlack{ 2 };
+
+        static std::chrono::steady_clock::duration s_FrameInterval(const SharedRenderThread& client) noexcept;
+
+        bool _IsWaiting(const SharedRenderThread& client) const noexcept;
+        void _WaitUntil(const std::chrono::steady_clock::time_point time) noexcept;
+        void _ClockProc();
+        void _WorkerProc(Worker& worker);
+
+        static std::mutex s_instanceLock;
+        static std::weak_ptr<RenderScheduler> s_instance;
+
+        // Everything below is guarded by _lock.
+        std::mutex _lock;
+        std::condition_variable _wake; // for the clock: a renderer wants a frame
+        std::condition_variable _painted; // a renderer is done painting
+        std::vector<SharedRenderThread*> _clients;
+        std::vector<std::unique_ptr<Worker>> _workers;
+        bool _exiting;
+
+        wil::unique_handle _frameTimer;
+        std::thread _clock;
+    };
+}
+
+std::mutex RenderScheduler::s_instanceLock;
+std::weak_ptr<RenderScheduler> RenderScheduler::s_instance;
+
+// Routine Description:
+// - Gets the scheduler for the process, starting one if there isn't one.
+// Return Value:
+// - The scheduler.
+// NOTE: CAN THROW IF THE THREADS CAN'T BE STARTED.
+std::shared_ptr<RenderScheduler> RenderScheduler::s_Get()
+{
+    std::unique_lock<std::mutex> lock{ s_instanceLock };
+    auto scheduler = s_instance.lock();
+    if (!scheduler)
+    {
+        scheduler = std::make_shared<RenderScheduler>();
+        s_instance = scheduler;
+    }
+    return scheduler;
+}
+
+// Routine Description:
+// - Starts the clock and the workers.
+// NOTE: CAN THROW IF THE THREADS CAN'T BE STARTED.
+RenderScheduler::RenderScheduler() :
+    _exiting{ false }
+{
+    // A high resolution timer can wait for less than a tick of the system
+    // clock. Older versions of Windows don't have them, and fail to make
+    // one, in which case an ordinary timer has to do.
+    _frameTimer.reset(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+    if (!_frameTimer)
+    {
+        _frameTimer.reset(CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS));
+    }
+    THROW_LAST_ERROR_IF(!_frameTimer);
+
+    const auto workers = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, s_MaxWorkers);
+    try
+    {
+        for (size_t i = 0; i < workers; ++i)
+        {
+            auto& worker = *_workers.emplace_back(std::make_unique<Worker>());
+            worker.thread = std::thread{ &RenderScheduler::_WorkerProc, this, std::ref(worker) };
+        }
+        _clock = std::thread{ &RenderScheduler::_ClockProc, this };
+    }
+    catch (...)
+    {
+        // The destructor won't run, so the threads that did start are stopped here.
+        {
+            std::unique_lock<std::mutex> lock{ _lock };
+            _exiting = true;
+        }
+        for (auto& worker : _workers)
+        {
+            worker->ready.notify_all();
+            if (worker->thread.joinable())
+            {
+                worker->thread.join();
+            }
+        }
+        throw;
+    }
+}
+
+// Routine Description:
+// - Stops the clock and the workers. Every renderer has been removed by now.
+RenderScheduler::~RenderScheduler()
+{
+    {
+        std::unique_lock<std::mutex> lock{ _lock };
+        _exiting = true;
+    }
+    _wake.notify_all();
+
+    if (_clock.joinable())
+    {
+        _clock.join();
+    }
+
+    for (auto& worker : _workers)
+    {
+        worker->ready.notify_all();
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+// Routine Description:
+// - Starts painting for a renderer, on whichever worker has the fewest.
+// Arguments:
+// - client - The renderer's thread.
+// Return Value:
+// - The worker that'll paint it.
+size_t RenderScheduler::Add(SharedRenderThread& client)
+{
+    std::unique_lock<std::mutex> lock{ _lock };
+
+    const auto worker = std::min_element(_workers.cbegin(), _workers.cend(), [](const auto& a, const auto& b) {
+        return a->clients < b->clients;
+    });
+    const auto index = gsl::narrow_cast<size_t>(worker - _workers.cbegin());
+
+    _clients.push_back(&client);
+    ++_workers.at(index)->clients;
+    return index;
+}
+
+// Routine Description:
+// - Stops painting for a renderer. If it's being painted, this waits for that to finish.
+// Arguments:
+// - client - The renderer's thread.
+void RenderScheduler::Remove(SharedRenderThread& client)
+{
+    std::unique_lock<std::mutex> lock{ _lock };
+
+    auto& worker = *_workers.at(client._worker);
+    const auto queued = std::find(worker.queue.begin(), worker.queue.end(), &client);
+    if (queued != worker.queue.end())
+    {
+        worker.queue.erase(queued);
+        client._queued = false;
+    }
+    _painted.wait(lock, [&]() { return !client._queued; });
+
+    _clients.erase(std::remove(_clients.begin(), _clients.end(), &client), _clients.end());
+    --worker.clients;
+}
+
+// Routine Description:
+// - Lets the clock know that a renderer might want a frame.
+void RenderScheduler::Wake()
+{
+    {
+        // Taken so that the clock can't miss this between looking and waiting.
+        std::unique_lock<std::mutex> lock{ _lock };
+    }
+    _wake.notify_one();
+}
+
+// Routine Description:
+// - Turns painting on or off for a renderer.
+// Arguments:
+// - client - The renderer's thread.
+// - enabled - Whether it may paint.
+void RenderScheduler::SetEnabled(SharedRenderThread& client, const bool enabled)
+{
+    {
+        std::unique_lock<std::mutex> lock{ _lock };
+        client._enabled = enabled;
+    }
+    _wake.notify_one();
+}
+
+// Routine Description:
+// - Waits for a renderer to finish painting, if it's painting or about to.
+// Arguments:
+// - client - The renderer's thread.
+// - dwTimeoutMs - The longest to wait, or INFINITE.
+void RenderScheduler::WaitForPaint(SharedRenderThread& client, const DWORD dwTimeoutMs)
+{
+    std::unique_lock<std::mutex> lock{ _lock };
+    if (dwTimeoutMs == INFINITE)
+    {
+        _painted.wait(lock, [&]() { return !client._queued; });
+    }
+    else
+    {
+        _painted.wait_for(lock, std::chrono::milliseconds{ dwTimeoutMs }, [&]() { return !client._queued; });
+    }
+}
+
+std::chrono::steady_clock::duration RenderScheduler::s_FrameInterval(const SharedRenderThread& client) noexcept
+{
+    const std::chrono::steady_clock::duration second = std::chrono::seconds{ 1 };
+    return second / client._maxFrameRate.load(std::memory_order_relaxed);
+}
+
+// Routine Description:
+// - Checks whether a renderer has asked for a frame it hasn't been handed to
+//   its worker for yet. _lock must be held.
+bool RenderScheduler::_IsWaiting(const SharedRenderThread& client) const noexcept
+{
+    return client._enabled && !client._queued && client._pending.load();
+}
+
+// Routine Description:
+// - Waits until the given time, on the frame timer. _lock mustn't be held.
+void RenderScheduler::_WaitUntil(const std::chrono::steady_clock::time_point time) noexcept
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (now < time)
+    {
+        // The timer counts in 100ns units, and a negative time is relative to now.
+        using FileTimeDuration = std::chrono::duration<LONGLONG, std::ratio<1, 10'000'000>>;
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -std::chrono::duration_cast<FileTimeDuration>(time - now).count();
+        if (SetWaitableTimer(_frameTimer.get(), &dueTime, 0, nullptr, nullptr, FALSE))
+        {
+            WaitForSingleObject(_frameTimer.get(), INFINITE);
+        }
+    }
+}
+
+// Routine Description:
+// - The clock. Sleeps until some renderer wants a frame, then holds back until
+//   the first of them is due one, and hands everyone that's due to their workers.
+//   A renderer that's been idle for longer than a frame is due straight away, so
+//   a key that's echoed is painted right away.
+void RenderScheduler::_ClockProc()
+{
+    std::unique_lock<std::mutex> lock{ _lock };
+    while (!_exiting)
+    {
+        _wake.wait(lock, [this]() {
+            return _exiting || std::any_of(_clients.cbegin(), _clients.cend(), [this](const auto client) { return _IsWaiting(*client); });
+        });
+        if (_exiting)
+        {
+            break;
+        }
+
+        auto due = std::chrono::steady_clock::time_point::max();
+        for (const auto client : _clients)
+        {
+            if (_IsWaiting(*client))
+            {
+                due = std::min(due, client->_lastFrameStart + s_FrameInterval(*client));
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (due > now + s_TickSlack)
+        {
+            // More might ask while we wait, so everything's looked at again after.
+            lock.unlock();
+            _WaitUntil(due);
+            lock.lock();
+            continue;
+        }
+
+        for (const auto client : _clients)
+        {
+            if (_IsWaiting(*client) && client->_lastFrameStart + s_FrameInterval(*client) <= now + s_TickSlack)
+            {
+                client->_pending.store(false);
+                client->_queued = true;
+
+                auto& worker = *_workers.at(client->_worker);
+                worker.queue.push_back(client);
+                worker.ready.notify_one();
+            }
+        }
+    }
+}
+
+// Routine Description:
+// - A worker. Paints the renderers it's handed, one at a time, in the order they came.
+// Arguments:
+// - worker - The worker this thread is.
+void RenderScheduler::_WorkerProc(Worker& worker)
+{
+    std::unique_lock<std::mutex> lock{ _lock };
+    for (;;)
+    {
+        worker.ready.wait(lock, [&]() { return _exiting || !worker.queue.empty(); });
+        if (worker.queue.empty())
+        {
+            break;
+        }
+
+        const auto client = worker.queue.front();
+        worker.queue.pop_front();
+
+        // Painting was turned off after it was handed over. The frame's still
+        //      owed, for when it's turned back on.
+        if (!client->_enabled)
+        {
+            client->_pending.store(true);
+            client->_queued = false;
+            _painted.notify_all();
+            continue;
+        }
+
+        client->_lastFrameStart = std::chrono::steady_clock::now();
+        const auto renderer = client->_pRenderer;
+
+        lock.unlock();
+        LOG_IF_FAILED(renderer->WaitUntilCanRender());
+        LOG_IF_FAILED(renderer->PaintFrame());
+        lock.lock();
+
+        client->_queued = false;
+        _painted.notify_all();
+
+        // It might have asked for another frame while it was painting.
+        if (client->_pending.load())
+        {
+            _wake.notify_one();
+        }
+    }
+}
+
+SharedRenderThread::SharedRenderThread() :
+    _pRenderer(nullptr),
+    _scheduler(nullptr),
+    _worker(0),
+    _pending(false),
+    _maxFrameRate(s_DefaultMaxFrameRate),
+    _enabled(false),
+    _queued(false),
+    _lastFrameStart()
+{
+}
+
+SharedRenderThread::~SharedRenderThread()
+{
+    if (_scheduler)
+    {
+        _scheduler->Remove(*this);
+    }
+}
+
+// Method Description:
+// - Joins the process's renderers in painting on the shared workers. Like a
+//      RenderThread, it doesn't paint until painting is enabled.
+// Arguments:
+// - pRendererParent: the IRenderer that owns this thread, and which we should
+//      trigger frames for.
+// Return Value:
+// - S_OK if we succeeded, else an HRESULT corresponding to a failure to start
+//      the shared workers.
+[[nodiscard]]
+HRESULT SharedRenderThread::Initialize(IRenderer* const pRendererParent) noexcept
+try
+{
+    _pRenderer = pRendererParent;
+    _scheduler = RenderScheduler::s_Get();
+    _worker = _scheduler->Add(*this);
+    return S_OK;
+}
+CATCH_RETURN();
+
+void SharedRenderThread::NotifyPaint()
+{
+    if (!_pending.exchange(true) && _scheduler)
+    {
+        _scheduler->Wake();
+    }
+}
+
+void SharedRenderThread::EnablePainting()
+{
+    if (_scheduler)
+    {
+        _scheduler->SetEnabled(*this, true);
+    }
+}
+
+// Method Description:
+// - Turns painting off, and waits for the frame that's being painted, if there
+//      is one, to finish.
+// Arguments:
+// - dwTimeoutMs: the longest to wait for the frame
+void SharedRenderThread::WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs)
+{
+    if (_scheduler)
+    {
+        _scheduler->SetEnabled(*this, false);
+        _scheduler->WaitForPaint(*this, dwTimeoutMs);
+    }
+}
+
+// Method Description:
+// - Sets the most frames we'll paint in a second. This can be called from any
+//      thread, and applies from the next frame on.
+// Arguments:
+// - framesPerSecond: the frame rate, or 0 for the default
+void SharedRenderThread::SetMaxFrameRate(const unsigned int framesPerSecond) noexcept
+{
+    _maxFrameRate.store(framesPerSecond == 0 ? s_DefaultMaxFrameRate : framesPerSecond, std::memory_order_relaxed);
+}
@@ -0,0 +1,68 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- SharedRenderThread.hpp
+
+Abstract:
+- A render thread for a process with lots of renderers, like a terminal with a
+  tab for each. Instead of a thread for every renderer, they all share a few
+  workers, and one clock that paces the frames for all of them.
+- The clock only runs while some renderer has asked for a frame. When it ticks,
+  the renderers that have asked and are due one by their own frame rate are
+  painted, all together. The rest aren't touched.
+- A renderer is always painted on the same worker, so an engine that cares
+  which thread it's used on always gets the one it started on. Renderers are
+  spread over the workers as they come along.
+--*/
+
+#pragma once
+
+#include "..\inc\IRenderer.hpp"
+#include "..\inc\IRenderThread.hpp"
+
+namespace Microsoft::Console::Render
+{
+    class RenderScheduler;
+
+    class SharedRenderThread final : public IRenderThread
+    {
+    public:
+        SharedRenderThread();
+        ~SharedRenderThread() override;
+
+        SharedRenderThread(const SharedRenderThread&) = delete;
+        SharedRenderThread& operator=(const SharedRenderThread&) = delete;
+
+        [[nodiscard]]
+        HRESULT Initialize(_In_ IRenderer* const pRendererParent) noexcept;
+
+        void NotifyPaint() override;
+
+        void EnablePainting() override;
+        void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) override;
+
+        void SetMaxFrameRate(const unsigned int framesPerSecond) noexcept;
+
+    private:
+        friend class RenderScheduler;
+
+        // The same as RenderThread's.
+        static constexpr unsigned int s_DefaultMaxFrameRate = 125;
+
+        IRenderer* _pRenderer; // Non-ownership pointer
+        std::shared_ptr<RenderScheduler> _scheduler;
+        size_t _worker;
+
+        // Set without the scheduler's lock, so that asking for a frame that's
+        //      already been asked for doesn't take it.
+        std::atomic<bool> _pending;
+        std::atomic<unsigned int> _maxFrameRate;
+
+        // Guarded by the scheduler's lock.
+        bool _enabled;
+        bool _queued; // handed to its worker, and not done painting yet
+        std::chrono::steady_clock::time_point _lastFrameStart;
+    };
+}
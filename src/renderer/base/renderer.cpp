@@ -24,8 +24,17 @@ Renderer::Renderer(IRenderData* pData,
                    const size_t cEngines,
                    std::unique_ptr<IRenderThread> thread) :
     _pData(pData),
+    _pPaintData(pData),
     _pThread{ std::move(thread) },
-    _destructing{ false }
+    _destructing{ false },
+    _painting{ false },
+    _cacheMemoryUsage{},
+    _measureCachesAfterPaint{ false },
+    _passingThrough{ false },
+    _batchDepth{ 0 },
+    _batchNeedsPaint{ false },
+    _paintStates{},
+    _paintWorkers{}
 {
 
     _srViewportPrevious = { 0 };
@@ -63,28 +72,305 @@ HRESULT Renderer::PaintFrame()
         return S_FALSE;
     }
 
-    for (IRenderEngine* const pEngine : _rgpEngines)
+    if (_rgpEngines.size() > 1)
     {
-        LOG_IF_FAILED(_PaintFrameForEngine(pEngine));
+        LOG_IF_FAILED(_PaintFrameForAllEngines());
+    }
+    else
+    {
+        for (IRenderEngine* const pEngine : _rgpEngines)
+        {
+            LOG_IF_FAILED(_PaintFrameForEngine(pEngine));
+        }
     }
 
     return S_OK;
 }
 
+// Routine Description:
+// - Waits until every engine that can tell is ready for the next frame.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK if at least one of the engines waited for its display, S_FALSE if
+//   none of them could, and the caller has to pace the frames itself.
+[[nodiscard]]
+HRESULT Renderer::WaitUntilCanRender()
+{
+    HRESULT hr = S_FALSE;
+    for (IRenderEngine* const pEngine : _rgpEngines)
+    {
+        const auto hrEngine = pEngine->WaitUntilCanRender();
+        if (hrEngine == S_OK)
+        {
+            hr = S_OK;
+        }
+        else
+        {
+            LOG_IF_FAILED(hrEngine);
+        }
+    }
+    return hr;
+}
+
+// Routine Description:
+// - Paints from a different source of data than the one invalidations are read from.
+// - The frame's LockConsole is expected to take a copy of everything a frame needs
+//   under a short lock on the live data, and its UnlockConsole to release nothing
+//   the live data needs. Painting then runs without holding up the live data's writers,
+//   and their invalidations are held back until the frame is done (see _Invalidate).
+// Arguments:
+// - pFrameData - The data to paint from, or nullptr to paint from the live data again.
+// Return Value:
+// - <none>
+void Renderer::SetFrameData(IRenderData* const pFrameData)
+{
+    _pPaintData = pFrameData ? pFrameData : _pData;
+}
+
+// Routine Description:
+// - Starts writing down what every frame from now on is painted from, so that
+//   the frames can be replayed later. See FrameCapture.
+// - This is meant to be called before painting is enabled.
+// Arguments:
+// - path - The file to append the frames to
+// Return Value:
+// - <none>
+void Renderer::CaptureFrames(const std::wstring& path)
+{
+    _frameCapture = std::make_unique<FrameCapture>(path);
+}
+
+// Routine Description:
+// - Hands an invalidation to the engines. While a frame is being painted, the engines
+//   belong to the paint, so the invalidation is held back and handed over after it.
+// - Whatever the invalidation needs from the live data has to be read before calling this.
+// Arguments:
+// - invalidate - Tells the engines what changed.
+// Return Value:
+// - <none>
+void Renderer::_Invalidate(std::function<void()> invalidate)
+{
+    // Anything a batch is holding back came first, so it has to be handed over
+    // first. A scroll would otherwise move redraws that were meant for after it.
+    _FlushBatch();
+    _HandOverInvalidation(std::move(invalidate));
+}
+
+// Routine Description:
+// - Does the work of _Invalidate, for invalidations that nothing can be held back in front of.
+// Arguments:
+// - invalidate - Tells the engines what changed.
+// Return Value:
+// - <none>
+void Renderer::_HandOverInvalidation(std::function<void()> invalidate)
+{
+    std::unique_lock<std::mutex> lock{ _invalidateLock };
+    if (_painting && !_passingThrough)
+    {
+        _deferredInvalidations.push_back(std::move(invalidate));
+    }
+    else
+    {
+        invalidate();
+    }
+}
+
+// Routine Description:
+// - Hands the invalidations that arrived during a paint to the engines, and makes sure
+//   another frame will come along to paint them.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_FinishPainting()
+{
+    std::unique_lock<std::mutex> lock{ _invalidateLock };
+    _painting = false;
+
+    if (_measureCachesAfterPaint)
+    {
+        _cacheMemoryUsage = _MeasureCaches();
+        _measureCachesAfterPaint = false;
+    }
+
+    if (!_deferredInvalidations.empty())
+    {
+        for (const auto& invalidate : _deferredInvalidations)
+        {
+            invalidate();
+        }
+        _deferredInvalidations.clear();
+
+        _NotifyPaintFrame();
+    }
+}
 
 [[nodiscard]]
 HRESULT Renderer::_PaintFrameForEngine(_In_ IRenderEngine* const pEngine)
 {
     FAIL_FAST_IF_NULL(pEngine); // This is a programming error. Fail fast.
 
-    _pData->LockConsole();
+    PipelineActivity frame{ PipelineStage::Frame };
+    frame.Includes(_TakePendingOutputs());
+
+    // From here on, invalidations are meant for the next frame. Anything that changed
+    // before this point is either in the data we're about to lock, or has already been
+    // handed to the engine.
+    {
+        std::unique_lock<std::mutex> lock{ _invalidateLock };
+        _painting = true;
+    }
+    auto finishPainting = wil::scope_exit([&]()
+    {
+        _FinishPainting();
+    });
+
+    _pPaintData->LockConsole();
     auto unlock = wil::scope_exit([&]()
     {
-        _pData->UnlockConsole();
+        _pPaintData->UnlockConsole();
     });
 
     // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
-    _CheckViewportAndScroll();
+    _CheckViewportAndScroll(_pPaintData->GetViewport());
+
+    bool painted = false;
+    {
+        PipelineActivity paint{ PipelineStage::Paint };
+        RETURN_IF_FAILED(_PaintFrameLocked(pEngine, painted));
+    }
+
+    // Force scope exit unlock to let go of global lock so other threads can run
+    unlock.reset();
+
+    // Trigger out-of-lock presentation for renderers that can support it
+    if (painted)
+    {
+        PipelineActivity present{ PipelineStage::Present };
+        RETURN_IF_FAILED(_PresentFrame(pEngine));
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Paints a frame for every engine at once. The data is locked once for all of
+//   them, so they all paint the same frame, and the first engine is painted on
+//   this thread while each of the others is painted on its own worker.
+// - An engine that's slow to paint, like the VT engine formatting its output for
+//   the pipe, no longer holds up the engines painting the screen. The frame is
+//   done when the last of them is.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK, or the first failure of one of the engines. Every failure is logged.
+[[nodiscard]]
+HRESULT Renderer::_PaintFrameForAllEngines()
+{
+    PipelineActivity frame{ PipelineStage::Frame };
+    frame.Includes(_TakePendingOutputs());
+
+    {
+        std::unique_lock<std::mutex> lock{ _invalidateLock };
+        _painting = true;
+    }
+    auto finishPainting = wil::scope_exit([&]()
+    {
+        _FinishPainting();
+    });
+
+    _pPaintData->LockConsole();
+    auto unlock = wil::scope_exit([&]()
+    {
+        _pPaintData->UnlockConsole();
+    });
+
+    // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
+    _CheckViewportAndScroll(_pPaintData->GetViewport());
+
+    struct EngineFrame
+    {
+        HRESULT hr = S_OK;
+        bool painted = false;
+    };
+    std::vector<EngineFrame> frames(_rgpEngines.size());
+
+    const auto waitForWorkers = [&]() {
+        for (auto& worker : _paintWorkers)
+        {
+            worker->Wait();
+        }
+    };
+
+    // The workers read the data under our lock, so none of them may still be
+    //      running once it's let go of.
+    auto waitForPaint = wil::scope_exit(waitForWorkers);
+
+    for (size_t i = 1; i < _rgpEngines.size(); i++)
+    {
+        _paintWorkers.at(i - 1)->Run([this, i, &frames, &frame]() {
+            PipelineActivity paint{ PipelineStage::Paint, &frame };
+            auto& engineFrame = frames.at(i);
+            engineFrame.hr = _PaintFrameLocked(_rgpEngines.at(i), engineFrame.painted);
+        });
+    }
+    {
+        PipelineActivity paint{ PipelineStage::Paint };
+        frames.at(0).hr = _PaintFrameLocked(_rgpEngines.at(0), frames.at(0).painted);
+    }
+
+    waitForPaint.reset();
+
+    // Force scope exit unlock to let go of global lock so other threads can run
+    unlock.reset();
+
+    // Trigger out-of-lock presentation for renderers that can support it, each on
+    //      the same thread it was painted on.
+    auto waitForPresent = wil::scope_exit(waitForWorkers);
+
+    for (size_t i = 1; i < _rgpEngines.size(); i++)
+    {
+        if (frames.at(i).painted)
+        {
+            _paintWorkers.at(i - 1)->Run([this, i, &frames, &frame]() {
+                PipelineActivity present{ PipelineStage::Present, &frame };
+                frames.at(i).hr = _PresentFrame(_rgpEngines.at(i));
+            });
+        }
+    }
+    if (frames.at(0).painted)
+    {
+        PipelineActivity present{ PipelineStage::Present };
+        frames.at(0).hr = _PresentFrame(_rgpEngines.at(0));
+    }
+
+    waitForPresent.reset();
+
+    HRESULT hr = S_OK;
+    for (const auto& frame : frames)
+    {
+        if (FAILED(frame.hr))
+        {
+            LOG_HR(frame.hr);
+            hr = SUCCEEDED(hr) ? frame.hr : hr;
+        }
+    }
+    return hr;
+}
+
+// Routine Description:
+// - Paints one engine's frame, from StartPaint to EndPaint. The data must already
+//   be locked, and the viewport checked for scrolling.
+// Arguments:
+// - pEngine - The engine to paint
+// - painted - Set to true if the engine painted a frame that needs presenting.
+// Return Value:
+// - S_OK, or a suitable HRESULT for the engine failing to paint.
+[[nodiscard]]
+HRESULT Renderer::_PaintFrameLocked(_In_ IRenderEngine* const pEngine, bool& painted)
+{
+    painted = false;
 
     // Try to start painting a frame
     HRESULT const hr = pEngine->StartPaint();
@@ -103,49 +389,388 @@ HRESULT Renderer::_PaintFrameForEngine(_In_ IRenderEngine* const pEngine)
         LOG_IF_FAILED(pEngine->EndPaint());
     });
 
+    // Only the first engine's frames are captured, so that each frame is only
+    //      captured once.
+    if (_frameCapture && pEngine == _rgpEngines.front())
+    {
+        try
+        {
+            _frameCapture->Capture(*_pPaintData, pEngine->GetDirtyArea());
+        }
+        CATCH_LOG();
+    }
+
+    auto& state = _paintStates.at(pEngine);
+    auto& stats = state.stats;
+    stats.Reset();
+
+    // Whatever the engine was drawing with at the end of the last frame, the
+    //      default brushes are about to replace it.
+    state.brushes.reset();
+
     // A. Prep Colors
-    RETURN_IF_FAILED(_UpdateDrawingBrushes(pEngine, _pData->GetDefaultBrushColors(), true));
+    RETURN_IF_FAILED(_UpdateDrawingBrushes(pEngine, _pPaintData->GetDefaultBrushColors(), true));
 
     // B. Perform Scroll Operations
     RETURN_IF_FAILED(_PerformScrolling(pEngine));
 
     // 1. Paint Background
-    RETURN_IF_FAILED(_PaintBackground(pEngine));
+    {
+        FramePhaseTimer timer{ stats, FramePhase::Background };
+        RETURN_IF_FAILED(_PaintBackground(pEngine));
+    }
 
     // 2. Paint Rows of Text
-    _PaintBufferOutput(pEngine);
+    {
+        FramePhaseTimer timer{ stats, FramePhase::BufferOutput };
+        _PaintBufferOutput(pEngine);
+    }
 
     // 3. Paint overlays that reside above the text buffer
-    _PaintOverlays(pEngine);
+    {
+        FramePhaseTimer timer{ stats, FramePhase::Overlays };
+        _PaintOverlays(pEngine);
+    }
+
+    // The selection and the cursor are free to draw with whatever they like, so
+    //      we can't know what the engine's brushes are anymore.
+    state.brushes.reset();
 
     // 4. Paint Selection
-    _PaintSelection(pEngine);
+    {
+        FramePhaseTimer timer{ stats, FramePhase::Selection };
+        _PaintSelection(pEngine);
+    }
 
     // 5. Paint Cursor
-    _PaintCursor(pEngine);
+    {
+        FramePhaseTimer timer{ stats, FramePhase::Cursor };
+        _PaintCursor(pEngine);
+    }
+
+    if (_fDebug)
+    {
+        _PaintDebugOverlay(pEngine);
+    }
 
     // 6. Paint window title
-    RETURN_IF_FAILED(_PaintTitle(pEngine));
+    {
+        FramePhaseTimer timer{ stats, FramePhase::Title };
+        RETURN_IF_FAILED(_PaintTitle(pEngine));
+    }
 
     // Force scope exit end paint to finish up collecting information and possibly painting
     endPaint.reset();
 
-    // Force scope exit unlock to let go of global lock so other threads can run
-    unlock.reset();
+    painted = true;
+    return S_OK;
+}
 
-    // Trigger out-of-lock presentation for renderers that can support it
-    RETURN_IF_FAILED(pEngine->Present());
+// Routine Description:
+// - Presents the frame an engine just painted, and then reports what the whole
+//   frame cost.
+// Arguments:
+// - pEngine - The engine to present
+// Return Value:
+// - S_OK, or a suitable HRESULT for the engine failing to present.
+[[nodiscard]]
+HRESULT Renderer::_PresentFrame(_In_ IRenderEngine* const pEngine)
+{
+    auto& state = _paintStates.at(pEngine);
+    {
+        FramePhaseTimer timer{ state.stats, FramePhase::Present };
+        RETURN_IF_FAILED(pEngine->Present());
+    }
 
-    // As we leave the scope, EndPaint will be called (declared above)
+    InputLatency::Presented();
+    state.stats.Trace(pEngine);
+    state.lastFrame = state.stats;
     return S_OK;
 }
 
+// Routine Description:
+// - Draws what the last frame cost onto the top of the area that's being painted,
+//   for watching the numbers change without a trace running.
+// - NOTE: You must set _fDebug flag for this to operate using a debugger.
+// Arguments:
+// - pEngine - The engine to draw onto
+// Return Value:
+// - <none>
+void Renderer::_PaintDebugOverlay(_In_ IRenderEngine* const pEngine)
+{
+    try
+    {
+        const auto area = pEngine->GetDirtyArea();
+        if (area.empty())
+        {
+            return;
+        }
+
+        // Only the area we're painting anyways can be drawn on, or what's drawn will
+        //      never be painted over again.
+        const auto dirty = Viewport::FromInclusive(area.front());
+        if (dirty.Width() <= 0)
+        {
+            return;
+        }
+
+        auto text = _paintStates.at(pEngine).lastFrame.ToString();
+        const auto latency = InputLatency::Summary();
+        if (!latency.empty())
+        {
+            text += L" | " + latency;
+        }
+        const auto length = std::min<size_t>(text.size(), dirty.Width());
+
+        std::vector<Cluster> clusters;
+        clusters.reserve(length);
+        for (size_t i = 0; i < length; i++)
+        {
+            clusters.emplace_back(std::wstring_view{ &text.at(i), 1 }, 1);
+        }
+
+        const COORD target{ gsl::narrow<SHORT>(dirty.RightExclusive() - length), dirty.Top() };
+        LOG_IF_FAILED(_UpdateDrawingBrushes(pEngine, _pPaintData->GetDefaultBrushColors(), false));
+        LOG_IF_FAILED(pEngine->PaintBufferLine({ clusters.data(), clusters.size() }, target, false));
+    }
+    CATCH_LOG();
+}
+
+// Routine Description:
+// - Hands over the chunks of output that have asked for a paint since the last
+//   frame started, for the frame that's starting now to say it includes.
+// Arguments:
+// - <none>
+// Return Value:
+// - The chunks of output. Empty unless the pipeline's being traced.
+std::vector<PipelineActivity::Id> Renderer::_TakePendingOutputs() noexcept
+{
+    std::vector<PipelineActivity::Id> outputs;
+    std::unique_lock<std::mutex> lock{ _batchLock };
+    outputs.swap(_pendingOutputs);
+    return outputs;
+}
+
 void Renderer::_NotifyPaintFrame()
 {
+    const auto output = PipelineActivity::s_CurrentOutput();
+
+    // While a batch is open, the thread is told once, when it's closed.
+    {
+        std::unique_lock<std::mutex> lock{ _batchLock };
+        if (output.has_value() &&
+            (_pendingOutputs.empty() || _pendingOutputs.back().sequence != output->sequence) &&
+            _pendingOutputs.size() < s_MaxPendingOutputs)
+        {
+            try
+            {
+                _pendingOutputs.push_back(output.value());
+            }
+            CATCH_LOG();
+        }
+
+        if (_batchDepth > 0)
+        {
+            _batchNeedsPaint = true;
+            return;
+        }
+    }
+
     // The thread will provide throttling for us.
     _pThread->NotifyPaint();
 }
 
+// Routine Description:
+// - Opens a batch. Until it's closed, redraws of regions and of the cursor are
+//      held back and merged where they touch, and the render thread isn't told
+//      that there's something to paint. Batches can be nested, and only the
+//      outermost one hands anything over.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::BeginBatch()
+{
+    std::unique_lock<std::mutex> lock{ _batchLock };
+    ++_batchDepth;
+}
+
+// Routine Description:
+// - Closes a batch. If it was the outermost one, everything it held back is
+//      handed to the engines, and the render thread is told to paint once.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::EndBatch()
+{
+    {
+        std::unique_lock<std::mutex> lock{ _batchLock };
+        if (_batchDepth == 0 || --_batchDepth > 0)
+        {
+            return;
+        }
+    }
+
+    _FlushBatch();
+
+    bool needsPaint = false;
+    {
+        std::unique_lock<std::mutex> lock{ _batchLock };
+        needsPaint = std::exchange(_batchNeedsPaint, false);
+    }
+
+    if (needsPaint)
+    {
+        _NotifyPaintFrame();
+    }
+}
+
+// Routine Description:
+// - Called before output is written to the terminal as it is, instead of
+//      being painted. Everything that changed before it has to have been
+//      handed to the engines already, so that an engine that's caught up can
+//      tell the terminal already shows what the output does to the buffer.
+// - Until EndPassThrough, invalidations are handed to the engines right away,
+//      even if the render thread has started on a frame. It's still waiting
+//      on the console lock that our caller is holding, so it can't be painting.
+// - NOTE: The console lock must be held until EndPassThrough.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if the output can be passed through. false if some of the changes
+//      before it haven't been handed to the engines yet, and it has to be
+//      painted like everything else.
+bool Renderer::BeginPassThrough()
+{
+    _FlushBatch();
+
+    std::unique_lock<std::mutex> lock{ _invalidateLock };
+    const SMALL_RECT view = _pData->GetViewport().ToInclusive();
+    if (!_deferredInvalidations.empty() ||
+        view.Left != _srViewportPrevious.Left ||
+        view.Top != _srViewportPrevious.Top)
+    {
+        return false;
+    }
+
+    _passingThrough = true;
+    return true;
+}
+
+// Routine Description:
+// - Called once the output that was passed through has been applied to the
+//      buffer. Anything it did to the buffer that's still held back is handed
+//      to the engines first, and if it moved the viewport, the engines aren't
+//      told to scroll for it. The terminal has already done that on its own.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::EndPassThrough()
+{
+    _FlushBatch();
+
+    std::unique_lock<std::mutex> lock{ _invalidateLock };
+    const SMALL_RECT view = _pData->GetViewport().ToInclusive();
+    _srViewportPrevious.Left = view.Left;
+    _srViewportPrevious.Top = view.Top;
+    _passingThrough = false;
+}
+
+// Routine Description:
+// - Holds back a redraw while a batch is open. A region is merged into whatever
+//      it overlaps or lines up with, which is how a run of text written one
+//      character at a time comes out.
+// Arguments:
+// - region - The region to redraw, in characters relative to the viewport. Exclusive.
+// Return Value:
+// - True if the redraw was held back. False if it has to be handed over now.
+bool Renderer::_BatchRedraw(const SMALL_RECT& region) noexcept
+try
+{
+    std::unique_lock<std::mutex> lock{ _batchLock };
+    if (_batchDepth == 0)
+    {
+        return false;
+    }
+
+    _batchedRedraws.Add(region);
+    return true;
+}
+catch (...)
+{
+    LOG_CAUGHT_EXCEPTION();
+    return false;
+}
+
+// Routine Description:
+// - Holds back a redraw of the cursor while a batch is open. Engines can care
+//      about the order the cursor moved in, so these are all kept, in order.
+// Arguments:
+// - coord - Where the cursor is, relative to the viewport.
+// - isDoubleWidth - Whether the cursor covers the cell after it as well.
+// Return Value:
+// - True if the redraw was held back. False if it has to be handed over now.
+bool Renderer::_BatchCursorRedraw(const COORD coord, const bool isDoubleWidth) noexcept
+try
+{
+    std::unique_lock<std::mutex> lock{ _batchLock };
+    if (_batchDepth == 0)
+    {
+        return false;
+    }
+
+    _batchedCursorRedraws.push_back(coord);
+    if (isDoubleWidth)
+    {
+        _batchedCursorRedraws.push_back({ gsl::narrow_cast<SHORT>(coord.X + 1), coord.Y });
+    }
+    return true;
+}
+catch (...)
+{
+    LOG_CAUGHT_EXCEPTION();
+    return false;
+}
+
+// Routine Description:
+// - Hands everything the open batch has held back so far to the engines.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_FlushBatch()
+{
+    Microsoft::Console::Types::Region redraws;
+    std::vector<COORD> cursorRedraws;
+    {
+        std::unique_lock<std::mutex> lock{ _batchLock };
+        redraws = _batchedRedraws;
+        _batchedRedraws.Clear();
+        cursorRedraws.swap(_batchedCursorRedraws);
+    }
+
+    if (redraws.empty() && cursorRedraws.empty())
+    {
+        return;
+    }
+
+    _HandOverInvalidation([this, redraws, cursorRedraws{ std::move(cursorRedraws) }]() {
+        for (IRenderEngine* const pEngine : _rgpEngines)
+        {
+            for (const auto& region : redraws)
+            {
+                LOG_IF_FAILED(pEngine->Invalidate(&region));
+            }
+            for (const auto& coord : cursorRedraws)
+            {
+                LOG_IF_FAILED(pEngine->InvalidateCursor(&coord));
+            }
+        }
+    });
+}
+
 // Routine Description:
 // - Called when the system has requested we redraw a portion of the console.
 // Arguments:
@@ -154,8 +779,11 @@ void Renderer::_NotifyPaintFrame()
 // - <none>
 void Renderer::TriggerSystemRedraw(const RECT* const prcDirtyClient)
 {
-    std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
-        LOG_IF_FAILED(pEngine->InvalidateSystem(prcDirtyClient));
+    const RECT rcDirtyClient = *prcDirtyClient;
+    _Invalidate([this, rcDirtyClient]() {
+        std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
+            LOG_IF_FAILED(pEngine->InvalidateSystem(&rcDirtyClient));
+        });
     });
 
     _NotifyPaintFrame();
@@ -175,9 +803,14 @@ void Renderer::TriggerRedraw(const Viewport& region)
     if (view.TrimToViewport(&srUpdateRegion))
     {
         view.ConvertToOrigin(&srUpdateRegion);
-        std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
-            LOG_IF_FAILED(pEngine->Invalidate(&srUpdateRegion));
-        });
+        if (!_BatchRedraw(srUpdateRegion))
+        {
+            _Invalidate([this, srUpdateRegion]() {
+                std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
+                    LOG_IF_FAILED(pEngine->Invalidate(&srUpdateRegion));
+                });
+            });
+        }
 
         _NotifyPaintFrame();
     }
@@ -211,16 +844,22 @@ void Renderer::TriggerRedrawCursor(const COORD* const pcoord)
     if (view.IsInBounds(updateCoord))
     {
         view.ConvertToOrigin(&updateCoord);
-        for (IRenderEngine* pEngine : _rgpEngines)
+        const bool fIsDoubleWidth = _pData->IsCursorDoubleWidth();
+        if (!_BatchCursorRedraw(updateCoord, fIsDoubleWidth))
         {
-            LOG_IF_FAILED(pEngine->InvalidateCursor(&updateCoord));
-
-            // Double-wide cursors need to invalidate the right half as well.
-            if (_pData->IsCursorDoubleWidth())
-            {
-                updateCoord.X++;
-                LOG_IF_FAILED(pEngine->InvalidateCursor(&updateCoord));
-            }
+            _Invalidate([this, updateCoord, fIsDoubleWidth]() mutable {
+                for (IRenderEngine* pEngine : _rgpEngines)
+                {
+                    LOG_IF_FAILED(pEngine->InvalidateCursor(&updateCoord));
+
+                    // Double-wide cursors need to invalidate the right half as well.
+                    if (fIsDoubleWidth)
+                    {
+                        updateCoord.X++;
+                        LOG_IF_FAILED(pEngine->InvalidateCursor(&updateCoord));
+                    }
+                }
+            });
         }
 
         _NotifyPaintFrame();
@@ -236,8 +875,10 @@ void Renderer::TriggerRedrawCursor(const COORD* const pcoord)
 // - <none>
 void Renderer::TriggerRedrawAll()
 {
-    std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
-        LOG_IF_FAILED(pEngine->InvalidateAll());
+    _Invalidate([this]() {
+        std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
+            LOG_IF_FAILED(pEngine->InvalidateAll());
+        });
     });
 
     _NotifyPaintFrame();
@@ -280,14 +921,16 @@ void Renderer::TriggerSelection()
     try
     {
         // Get selection rectangles
-        const auto rects = _GetSelectionRects();
+        auto rects = _GetSelectionRects(*_pData);
 
-        std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
-            LOG_IF_FAILED(pEngine->InvalidateSelection(_previousSelection));
-            LOG_IF_FAILED(pEngine->InvalidateSelection(rects));
-        });
+        _Invalidate([this, rects{ std::move(rects) }]() {
+            std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
+                LOG_IF_FAILED(pEngine->InvalidateSelection(_previousSelection));
+                LOG_IF_FAILED(pEngine->InvalidateSelection(rects));
+            });
 
-        _previousSelection = rects;
+            _previousSelection = rects;
+        });
 
         _NotifyPaintFrame();
     }
@@ -297,13 +940,13 @@ void Renderer::TriggerSelection()
 // Routine Description:
 // - Called when we want to check if the viewport has moved and scroll accordingly if so.
 // Arguments:
-// - <none>
+// - view - Where the viewport is now.
 // Return Value:
 // - True if something changed and we scrolled. False otherwise.
-bool Renderer::_CheckViewportAndScroll()
+bool Renderer::_CheckViewportAndScroll(const Viewport& view)
 {
     SMALL_RECT const srOldViewport = _srViewportPrevious;
-    SMALL_RECT const srNewViewport = _pData->GetViewport().ToInclusive();
+    SMALL_RECT const srNewViewport = view.ToInclusive();
 
     COORD coordDelta;
     coordDelta.X = srOldViewport.Left - srNewViewport.Left;
@@ -327,10 +970,12 @@ bool Renderer::_CheckViewportAndScroll()
 // - <none>
 void Renderer::TriggerScroll()
 {
-    if (_CheckViewportAndScroll())
-    {
-        _NotifyPaintFrame();
-    }
+    const auto view = _pData->GetViewport();
+    _Invalidate([this, view]() {
+        _CheckViewportAndScroll(view);
+    });
+
+    _NotifyPaintFrame();
 }
 
 // Routine Description:
@@ -344,13 +989,45 @@ void Renderer::TriggerScroll()
 // - <none>
 void Renderer::TriggerScroll(const COORD* const pcoordDelta)
 {
-    std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
-        LOG_IF_FAILED(pEngine->InvalidateScroll(pcoordDelta));
+    const COORD coordDelta = *pcoordDelta;
+    _Invalidate([this, coordDelta]() {
+        std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
+            LOG_IF_FAILED(pEngine->InvalidateScroll(&coordDelta));
+        });
     });
 
     _NotifyPaintFrame();
 }
 
+// Routine Description:
+// - Called when the contents of only part of the buffer moved, like a scroll
+//      inside of the margins. Everything that moved stays inside the region.
+// - Engines that can move what's already on the screen only have to paint what
+//      was uncovered, instead of all of the region.
+// Arguments:
+// - region - The buffer-space rectangle that the contents moved inside of
+// - pcoordDelta - How far the contents moved
+// Return Value:
+// - <none>
+void Renderer::TriggerScroll(const Viewport& region, const COORD* const pcoordDelta)
+{
+    Viewport view = _pData->GetViewport();
+    SMALL_RECT srScrollRegion = region.ToExclusive();
+
+    if (view.TrimToViewport(&srScrollRegion))
+    {
+        view.ConvertToOrigin(&srScrollRegion);
+        const COORD coordDelta = *pcoordDelta;
+        _Invalidate([this, srScrollRegion, coordDelta]() {
+            std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
+                LOG_IF_FAILED(pEngine->InvalidateScrollRegion(&srScrollRegion, &coordDelta));
+            });
+        });
+
+        _NotifyPaintFrame();
+    }
+}
+
 // Routine Description:
 // - Called when the text buffer is about to circle its backing buffer.
 //      A renderer might want to get painted before that happens.
@@ -383,10 +1060,12 @@ void Renderer::TriggerCircling()
 void Renderer::TriggerTitleChange()
 {
     const std::wstring newTitle = _pData->GetConsoleTitle();
-    for (IRenderEngine* const pEngine : _rgpEngines)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateTitle(newTitle));
-    }
+    _Invalidate([this, newTitle]() {
+        for (IRenderEngine* const pEngine : _rgpEngines)
+        {
+            LOG_IF_FAILED(pEngine->InvalidateTitle(newTitle));
+        }
+    });
     _NotifyPaintFrame();
 }
 
@@ -398,7 +1077,7 @@ void Renderer::TriggerTitleChange()
 // - the HRESULT of the underlying engine's UpdateTitle call.
 HRESULT Renderer::_PaintTitle(IRenderEngine* const pEngine)
 {
-    const std::wstring newTitle = _pData->GetConsoleTitle();
+    const std::wstring newTitle = _pPaintData->GetConsoleTitle();
     return pEngine->UpdateTitle(newTitle);
 }
 
@@ -459,6 +1138,53 @@ HRESULT Renderer::GetProposedFont(const int iDpi, const FontInfoDesired& FontInf
     return E_FAIL;
 }
 
+// Routine Description:
+// - Gets how much memory the engines are holding on to between frames, and
+//   what the renderer keeps for painting them.
+// - The engines' caches belong to the paint while a frame is being painted. If
+//   one is, this gets what they held when they were last measured, and they're
+//   measured again as soon as it's done.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of every engine's caches.
+Microsoft::Console::Types::MemoryUsage Renderer::GetCacheMemoryUsage()
+{
+    std::unique_lock<std::mutex> lock{ _invalidateLock };
+    if (_painting)
+    {
+        _measureCachesAfterPaint = true;
+    }
+    else
+    {
+        _cacheMemoryUsage = _MeasureCaches();
+    }
+    return _cacheMemoryUsage;
+}
+
+// Routine Description:
+// - Adds up what the engines' caches and their paint states are holding. Only
+//   call this with _invalidateLock held while no frame is being painted.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of every engine's caches.
+Microsoft::Console::Types::MemoryUsage Renderer::_MeasureCaches() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    for (const auto engine : _rgpEngines)
+    {
+        usage += engine->GetCacheMemoryUsage();
+    }
+
+    usage.AddHashTable(_paintStates);
+    for (const auto& entry : _paintStates)
+    {
+        usage.AddContiguous(entry.second.clusters);
+    }
+    return usage;
+}
+
 // Routine Description:
 // - Tests against the current rendering engine to see if this particular character would be considered
 // full-width (inscribed in a square, twice as wide as a standard Western character, typically used for CJK
@@ -540,26 +1266,37 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
     // This is the subsection of the entire screen buffer that is currently being presented.
     // It can move left/right or top/bottom depending on how the viewport is scrolled
     // relative to the entire buffer.
-    const auto view = _pData->GetViewport();
-
-    // This is effectively the number of cells on the visible screen that need to be redrawn.
-    // The origin is always 0, 0 because it represents the screen itself, not the underlying buffer.
-    auto dirty = Viewport::FromInclusive(pEngine->GetDirtyRectInChars());
+    const auto view = _pPaintData->GetViewport();
 
-    // Shift the origin of the dirty region to match the underlying buffer so we can
-    // compare the two regions directly for intersection.
-    dirty = Viewport::Offset(dirty, view.Origin());
+    // Retrieve the text buffer so we can read information out of it.
+    const auto& buffer = _pPaintData->GetTextBuffer();
 
-    // The intersection between what is dirty on the screen (in need of repaint)
-    // and what is supposed to be visible on the screen (the viewport) is what
-    // we need to walk through line-by-line and repaint onto the screen.
-    const auto redraw = Viewport::Intersect(dirty, view);
+    auto& stats = _paintStates.at(pEngine).stats;
 
-    // Shortcut: don't bother redrawing if the width is 0.
-    if (redraw.Width() > 0)
+    // These are effectively the cells on the visible screen that need to be redrawn.
+    // The origin is always 0, 0 because they represent the screen itself, not the underlying buffer.
+    // An engine that tracks each row separately gives us a rectangle for each run of
+    // rows that's dirty, so the clean rows in between them are never painted.
+    for (const auto& dirtyRect : pEngine->GetDirtyArea())
     {
-        // Retrieve the text buffer so we can read information out of it.
-        const auto& buffer = _pData->GetTextBuffer();
+        auto dirty = Viewport::FromInclusive(dirtyRect);
+
+        // Shift the origin of the dirty region to match the underlying buffer so we can
+        // compare the two regions directly for intersection.
+        dirty = Viewport::Offset(dirty, view.Origin());
+
+        // The intersection between what is dirty on the screen (in need of repaint)
+        // and what is supposed to be visible on the screen (the viewport) is what
+        // we need to walk through line-by-line and repaint onto the screen.
+        const auto redraw = Viewport::Intersect(dirty, view);
+
+        // Shortcut: don't bother redrawing if the width is 0.
+        if (redraw.Width() <= 0)
+        {
+            continue;
+        }
+
+        stats.dirtyRows += redraw.Height();
 
         // Now walk through each row of text that we need to redraw.
         for (auto row = redraw.Top(); row < redraw.BottomExclusive(); row++)
@@ -591,15 +1328,17 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
     // If we have valid data, let's figure out how to draw it.
     if (it)
     {
-        // TODO: MSFT: 20961091 -  This is a perf issue. Instead of rebuilding this and allocing memory to hold the reinterpretation,
-        // we should have an iterator/view adapter for the rendering.
-        // That would probably also eliminate the RenderData needing to give us the entire TextBuffer as well...
-        // Retrieve the iterator for one line of information.
-        std::vector<Cluster> clusters;
+        // The clusters only point at the text in the buffer, and they're collected
+        // into a buffer that we keep between runs, so a steady stream of frames
+        // doesn't allocate at all.
+        // TODO: MSFT: 20961091 - The RenderData still has to give us the entire TextBuffer to iterate.
+        auto& state = _paintStates.at(pEngine);
+        auto& clusters = state.clusters;
         size_t cols = 0;
 
-        // Retrieve the first color.
+        // Retrieve the first color, and what it's drawn with.
         auto color = it->TextAttr();
+        auto brushes = _GetTextBrushes(color);
 
         // And hold the point where we should start drawing.
         auto screenPoint = target;
@@ -612,9 +1351,10 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
             // when a run changes, but we will still need to know this color at the bottom
             // when we go to draw gridlines for the length of the run.
             const auto currentRunColor = color;
+            const auto currentRunBrushes = brushes;
 
             // Update the drawing brushes with our color.
-            THROW_IF_FAILED(_UpdateDrawingBrushes(pEngine, currentRunColor, false));
+            THROW_IF_FAILED(_UpdateDrawingBrushes(pEngine, currentRunBrushes, false));
 
             // Advance the point by however many columns we've just outputted and reset the accumulator.
             screenPoint.X += gsl::narrow<SHORT>(cols);
@@ -624,13 +1364,19 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
             clusters.clear();
 
             // This inner loop will accumulate clusters until the color changes.
-            // When the color changes, it will save the new color off and break.
+            // When the color changes, it will save the new color off, and break if
+            // the new one isn't drawn the same as the run. A legacy color and the
+            // RGB color it maps to, for example, are painted as one run.
             do
             {
                 if (color != it->TextAttr())
                 {
                     color = it->TextAttr();
-                    break;
+                    brushes = _GetTextBrushes(color);
+                    if (brushes != currentRunBrushes)
+                    {
+                        break;
+                    }
                 }
 
                 // Walk through the text data and turn it into rendering clusters.
@@ -646,9 +1392,11 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
             // Do the painting.
             // TODO: Calculate when trim left should be TRUE
             THROW_IF_FAILED(pEngine->PaintBufferLine({ clusters.data(), clusters.size() }, screenPoint, false));
+            state.stats.bufferLines++;
+            state.stats.clusters += clusters.size();
 
             // If we're allowed to do grid drawing, draw that now too (since it will be coupled with the color data)
-            if (_pData->IsGridLineDrawingAllowed())
+            if (_pPaintData->IsGridLineDrawingAllowed())
             {
                 // We're only allowed to draw the grid lines under certain circumstances.
                 _PaintBufferOutputGridLineHelper(pEngine, currentRunColor, cols, screenPoint);
@@ -706,7 +1454,7 @@ void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngin
                                                 const size_t cchLine,
                                                 const COORD coordTarget)
 {
-    const COLORREF rgb = _pData->GetForegroundColor(textAttribute);
+    const COLORREF rgb = _pPaintData->GetForegroundColor(textAttribute);
 
     // Convert console grid line representations into rendering engine enum representations.
     IRenderEngine::GridLines lines = Renderer::s_GetGridlines(textAttribute);
@@ -723,27 +1471,27 @@ void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngin
 // - <none>
 void Renderer::_PaintCursor(_In_ IRenderEngine* const pEngine)
 {
-    if (_pData->IsCursorVisible())
+    if (_pPaintData->IsCursorVisible())
     {
         // Get cursor position in buffer
-        COORD coordCursor = _pData->GetCursorPosition();
+        COORD coordCursor = _pPaintData->GetCursorPosition();
         // Adjust cursor to viewport
-        Viewport view = _pData->GetViewport();
+        Viewport view = _pPaintData->GetViewport();
         view.ConvertToOrigin(&coordCursor);
 
-        COLORREF cursorColor = _pData->GetCursorColor();
+        COLORREF cursorColor = _pPaintData->GetCursorColor();
         bool useColor = cursorColor != INVALID_COLOR;
 
         // Build up the cursor parameters including position, color, and drawing options
         IRenderEngine::CursorOptions options;
         options.coordCursor = coordCursor;
-        options.ulCursorHeightPercent = _pData->GetCursorHeight();
-        options.cursorPixelWidth = _pData->GetCursorPixelWidth();
-        options.fIsDoubleWidth = _pData->IsCursorDoubleWidth();
-        options.cursorType = _pData->GetCursorStyle();
+        options.ulCursorHeightPercent = _pPaintData->GetCursorHeight();
+        options.cursorPixelWidth = _pPaintData->GetCursorPixelWidth();
+        options.fIsDoubleWidth = _pPaintData->IsCursorDoubleWidth();
+        options.cursorType = _pPaintData->GetCursorStyle();
         options.fUseColor = useColor;
         options.cursorColor = cursorColor;
-        options.isOn = _pData->IsCursorOn();
+        options.isOn = _pPaintData->IsCursorOn();
 
         // Draw it within the viewport
         LOG_IF_FAILED(pEngine->PaintCursor(options));
@@ -765,7 +1513,7 @@ void Renderer::_PaintOverlay(IRenderEngine& engine,
     try
     {
         // First get the screen buffer's viewport.
-        Viewport view = _pData->GetViewport();
+        Viewport view = _pPaintData->GetViewport();
 
         // Now get the overlay's viewport and adjust it to where it is supposed to be relative to the window.
 
@@ -793,7 +1541,10 @@ void Renderer::_PaintOverlay(IRenderEngine& engine,
                 const COORD target{ viewDirty.Left(), iRow };
                 const auto source = target - overlay.origin;
 
-                auto it = overlay.buffer.GetCellLineDataAt(source);
+                // Only the overlay's region is drawn. What's beside it in the
+                // overlay's row is empty, and mustn't cover the text underneath.
+                const COORD width{ gsl::narrow<SHORT>(srDirty.Right - srDirty.Left), 1 };
+                auto it = overlay.buffer.GetCellDataAt(source, Viewport::FromDimensions(source, width));
 
                 _PaintBufferOutputHelper(&engine, it, target);
             }
@@ -814,7 +1565,7 @@ void Renderer::_PaintOverlays(_In_ IRenderEngine* const pEngine)
 {
     try
     {
-        const auto overlays = _pData->GetOverlays();
+        const auto overlays = _pPaintData->GetOverlays();
 
         for (const auto& overlay : overlays)
         {
@@ -838,7 +1589,7 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
         Viewport dirtyView = Viewport::FromInclusive(srDirty);
 
         // Get selection rectangles
-        const auto rectangles = _GetSelectionRects();
+        const auto rectangles = _GetSelectionRects(*_pPaintData);
         for (auto rect : rectangles)
         {
             if (dirtyView.TrimToViewport(&rect))
@@ -864,18 +1615,53 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
 [[nodiscard]]
 HRESULT Renderer::_UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine, const TextAttribute textAttributes, const bool isSettingDefaultBrushes)
 {
-    const COLORREF rgbForeground = _pData->GetForegroundColor(textAttributes);
-    const COLORREF rgbBackground = _pData->GetBackgroundColor(textAttributes);
-    const WORD legacyAttributes = textAttributes.GetLegacyAttributes();
-    const bool isBold = textAttributes.IsBold();
+    return _UpdateDrawingBrushes(pEngine, _GetTextBrushes(textAttributes), isSettingDefaultBrushes);
+}
+
+// Routine Description:
+// - Updates the rendering pen/brush within the rendering engine before the next draw operation,
+//   unless the engine was already told to use exactly these during this frame.
+// Arguments:
+// - pEngine - Which engine is being updated
+// - brushes - What to draw with, already resolved from the text attributes.
+// - isSettingDefaultBrushes - Alerts that the default brushes are being set. These are always
+//                             handed to the engine, see the overload above.
+// Return Value:
+// - S_OK, or a suitable HRESULT for the engine failing to update its brushes.
+[[nodiscard]]
+HRESULT Renderer::_UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine, const TextBrushes brushes, const bool isSettingDefaultBrushes)
+{
+    auto& state = _paintStates.at(pEngine);
+    if (!isSettingDefaultBrushes && state.brushes == brushes)
+    {
+        return S_OK;
+    }
 
     // The last color needs to be each engine's responsibility. If it's local to this function,
     //      then on the next engine we might not update the color.
-    RETURN_IF_FAILED(pEngine->UpdateDrawingBrushes(rgbForeground, rgbBackground, legacyAttributes, isBold, isSettingDefaultBrushes));
+    RETURN_IF_FAILED(pEngine->UpdateDrawingBrushes(brushes.foreground, brushes.background, brushes.legacyAttributes, brushes.isBold, isSettingDefaultBrushes));
+    state.brushes = brushes;
+    state.stats.brushChanges++;
 
     return S_OK;
 }
 
+// Routine Description:
+// - Resolves text attributes to what a run of text with them is drawn with.
+// Arguments:
+// - textAttributes - The attributes of the text
+// Return Value:
+// - The colors and the rest of what the engines are told to draw the text with.
+Renderer::TextBrushes Renderer::_GetTextBrushes(const TextAttribute textAttributes) const
+{
+    TextBrushes brushes;
+    brushes.foreground = _pPaintData->GetForegroundColor(textAttributes);
+    brushes.background = _pPaintData->GetBackgroundColor(textAttributes);
+    brushes.legacyAttributes = textAttributes.GetLegacyAttributes();
+    brushes.isBold = textAttributes.IsBold();
+    return brushes;
+}
+
 // Routine Description:
 // - Helper called before a majority of paint operations to scroll most of the previous frame into the appropriate
 //   position before we paint the remaining invalid area.
@@ -892,13 +1678,15 @@ HRESULT Renderer::_PerformScrolling(_In_ IRenderEngine* const pEngine)
 
 // Routine Description:
 // - Helper to determine the selected region of the buffer.
+// Arguments:
+// - data - The data to read the selection from, live or a frame.
 // Return Value:
 // - A vector of rectangles representing the regions to select, line by line.
-std::vector<SMALL_RECT> Renderer::_GetSelectionRects() const
+std::vector<SMALL_RECT> Renderer::_GetSelectionRects(IRenderData& data) const
 {
-    auto rects = _pData->GetSelectionRects();
+    auto rects = data.GetSelectionRects();
     // Adjust rectangles to viewport
-    Viewport view = _pData->GetViewport();
+    Viewport view = data.GetViewport();
 
     std::vector<SMALL_RECT> result;
 
@@ -928,5 +1716,13 @@ std::vector<SMALL_RECT> Renderer::_GetSelectionRects() const
 void Renderer::AddRenderEngine(_In_ IRenderEngine* const pEngine)
 {
     THROW_IF_NULL_ALLOC(pEngine);
+
+    // Every engine but the first is painted on a worker of its own.
+    if (!_rgpEngines.empty())
+    {
+        _paintWorkers.push_back(std::make_unique<PaintWorker>());
+    }
+    _paintStates.emplace(pEngine, EnginePaintState{});
+
     _rgpEngines.push_back(pEngine);
 }
@@ -21,9 +21,15 @@ Author(s):
 #include "../inc/IRenderData.hpp"
 
 #include "thread.hpp"
+#include "PaintWorker.hpp"
+#include "FrameStats.hpp"
+#include "InputLatency.hpp"
+#include "PipelineActivity.hpp"
+#include "FrameCapture.hpp"
 
 #include "../../buffer/out/textBuffer.hpp"
 #include "../../buffer/out/CharRow.hpp"
+#include "../../types/inc/region.hpp"
 
 namespace Microsoft::Console::Render
 {
@@ -50,6 +56,9 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT PaintFrame();
 
+        [[nodiscard]]
+        HRESULT WaitUntilCanRender();
+
         void TriggerSystemRedraw(const RECT* const prcDirtyClient) override;
         void TriggerRedraw(const Microsoft::Console::Types::Viewport& region) override;
         void TriggerRedraw(const COORD* const pcoord) override;
@@ -60,6 +69,7 @@ namespace Microsoft::Console::Render
         void TriggerSelection() override;
         void TriggerScroll() override;
         void TriggerScroll(const COORD* const pcoordDelta) override;
+        void TriggerScroll(const Microsoft::Console::Types::Viewport& region, const COORD* const pcoordDelta) override;
 
         void TriggerCircling() override;
         void TriggerTitleChange() override;
@@ -68,6 +78,12 @@ namespace Microsoft::Console::Render
                                const FontInfoDesired& FontInfoDesired,
                                _Out_ FontInfo& FontInfo) override;
 
+        void BeginBatch() override;
+        void EndBatch() override;
+
+        bool BeginPassThrough() override;
+        void EndPassThrough() override;
+
         [[nodiscard]]
         HRESULT GetProposedFont(const int iDpi,
                                 const FontInfoDesired& FontInfoDesired,
@@ -80,20 +96,121 @@ namespace Microsoft::Console::Render
 
         void AddRenderEngine(_In_ IRenderEngine* const pEngine) override;
 
+        Microsoft::Console::Types::MemoryUsage GetCacheMemoryUsage() override;
+
+        void SetFrameData(IRenderData* const pFrameData);
+        void CaptureFrames(const std::wstring& path);
+
     private:
         std::deque<IRenderEngine*> _rgpEngines;
 
-        IRenderData* _pData; // Non-ownership pointer
+        IRenderData* _pData; // Non-ownership pointer. Invalidations are read from here.
+        IRenderData* _pPaintData; // Non-ownership pointer. Frames are painted from here.
 
         std::unique_ptr<IRenderThread> _pThread;
         bool _destructing = false;
 
+        // Set to write down what each frame is painted from. See CaptureFrames.
+        std::unique_ptr<FrameCapture> _frameCapture;
+
+        // Invalidations that arrive while a frame is painting wait here for it to finish.
+        std::mutex _invalidateLock;
+        bool _painting;
+        std::vector<std::function<void()>> _deferredInvalidations;
+        // What the engines' caches held when they were last measured, and whether
+        //      the frame that's painting should measure them again once it's done.
+        //      Guarded by _invalidateLock, see GetCacheMemoryUsage.
+        Microsoft::Console::Types::MemoryUsage _cacheMemoryUsage;
+        bool _measureCachesAfterPaint;
+        // Set while output is passed through to the terminal as it is. The
+        //      invalidations that come from it are handed to the engines right
+        //      away, so that they know to drop them. See BeginPassThrough.
+        bool _passingThrough;
+
+        // Redraws that arrive while a batch is open wait here, with the ones that
+        //      touch merged together, until it's closed or something that has to
+        //      come after them arrives. Guarded by _batchLock.
+        std::mutex _batchLock;
+        size_t _batchDepth;
+        bool _batchNeedsPaint;
+        Microsoft::Console::Types::Region _batchedRedraws;
+        std::vector<COORD> _batchedCursorRedraws;
+        // The chunks of output that have asked for a paint since the last frame
+        //      started, for the next frame to say it includes. Only gathered
+        //      while the pipeline's being traced. Guarded by _batchLock.
+        std::vector<PipelineActivity::Id> _pendingOutputs;
+        static constexpr size_t s_MaxPendingOutputs = 256;
+
+        // What a run of text is drawn with, as the engine is told it. Attributes
+        //      that differ but come out the same are drawn as one run.
+        struct TextBrushes
+        {
+            COLORREF foreground;
+            COLORREF background;
+            WORD legacyAttributes;
+            bool isBold;
+
+            bool operator==(const TextBrushes& other) const noexcept
+            {
+                return foreground == other.foreground &&
+                       background == other.background &&
+                       legacyAttributes == other.legacyAttributes &&
+                       isBold == other.isBold;
+            }
+
+            bool operator!=(const TextBrushes& other) const noexcept
+            {
+                return !(*this == other);
+            }
+        };
+
+        // What each engine needs while it's painted. Only the thread that paints
+        //      the engine uses its state.
+        struct EnginePaintState
+        {
+            // The clusters of the run that's being painted. Kept from one run to
+            //      the next, and one frame to the next, so that painting doesn't
+            //      allocate once it's grown to fit the widest run.
+            std::vector<Cluster> clusters;
+
+            // What the frame that's being painted has cost so far, and what the
+            //      one before it cost altogether.
+            FrameStats stats;
+            FrameStats lastFrame;
+
+            // What the engine was last told to draw text with during this frame,
+            //      so that it's not told the same thing again.
+            std::optional<TextBrushes> brushes;
+        };
+        std::unordered_map<IRenderEngine*, EnginePaintState> _paintStates;
+
+        // The first engine is painted on the render thread. Every engine after it
+        //      has a worker of its own, at one less than the engine's index, so
+        //      that they're all painted at once.
+        std::deque<std::unique_ptr<PaintWorker>> _paintWorkers;
+
+        void _Invalidate(std::function<void()> invalidate);
+        void _HandOverInvalidation(std::function<void()> invalidate);
+        void _FinishPainting();
+        Microsoft::Console::Types::MemoryUsage _MeasureCaches() const noexcept;
+
+        bool _BatchRedraw(const SMALL_RECT& region) noexcept;
+        bool _BatchCursorRedraw(const COORD coord, const bool isDoubleWidth) noexcept;
+        void _FlushBatch();
+
+        std::vector<PipelineActivity::Id> _TakePendingOutputs() noexcept;
         void _NotifyPaintFrame();
 
         [[nodiscard]]
         HRESULT _PaintFrameForEngine(_In_ IRenderEngine* const pEngine);
+        [[nodiscard]]
+        HRESULT _PaintFrameForAllEngines();
+        [[nodiscard]]
+        HRESULT _PaintFrameLocked(_In_ IRenderEngine* const pEngine, bool& painted);
+        [[nodiscard]]
+        HRESULT _PresentFrame(_In_ IRenderEngine* const pEngine);
 
-        bool _CheckViewportAndScroll();
+        bool _CheckViewportAndScroll(const Microsoft::Console::Types::Viewport& view);
 
         [[nodiscard]]
         HRESULT _PaintBackground(_In_ IRenderEngine* const pEngine);
@@ -117,15 +234,19 @@ namespace Microsoft::Console::Render
         void _PaintOverlays(_In_ IRenderEngine* const pEngine);
         void _PaintOverlay(IRenderEngine& engine, const RenderOverlay& overlay);
 
+        TextBrushes _GetTextBrushes(const TextAttribute attr) const;
+
         [[nodiscard]]
         HRESULT _UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine, const TextAttribute attr, const bool isSettingDefaultBrushes);
+        [[nodiscard]]
+        HRESULT _UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine, const TextBrushes brushes, const bool isSettingDefaultBrushes);
 
         [[nodiscard]]
         HRESULT _PerformScrolling(_In_ IRenderEngine* const pEngine);
 
         SMALL_RECT _srViewportPrevious;
 
-        std::vector<SMALL_RECT> _GetSelectionRects() const;
+        std::vector<SMALL_RECT> _GetSelectionRects(IRenderData& data) const;
         std::vector<SMALL_RECT> _previousSelection;
 
         [[nodiscard]]
@@ -134,5 +255,7 @@ namespace Microsoft::Console::Render
         // Helper functions to diagnose issues with painting and layout.
         // These are only actually effective/on in Debug builds when the flag is set using an attached debugger.
         bool _fDebug = false;
+
+        void _PaintDebugOverlay(_In_ IRenderEngine* const pEngine);
     };
 }
@@ -8,12 +8,21 @@
 
 #pragma hdrstop
 
+// Older SDKs don't know about high resolution timers, but Windows will just
+// ignore the flag if it doesn't support them either.
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
 using namespace Microsoft::Console::Render;
 
 RenderThread::RenderThread() :
     _pRenderer(nullptr),
     _hThread(INVALID_HANDLE_VALUE),
     _hEvent(INVALID_HANDLE_VALUE),
+    _hFrameTimer(INVALID_HANDLE_VALUE),
+    _maxFrameRate(s_DefaultMaxFrameRate),
+    _lastFrameStart(),
     _hPaintCompletedEvent(INVALID_HANDLE_VALUE),
     _fKeepRunning(true),
     _hPaintEnabledEvent(INVALID_HANDLE_VALUE)
@@ -38,6 +47,12 @@ RenderThread::~RenderThread()
         _hEvent = INVALID_HANDLE_VALUE;
     }
 
+    if (_hFrameTimer != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_hFrameTimer);
+        _hFrameTimer = INVALID_HANDLE_VALUE;
+    }
+
     if (_hPaintEnabledEvent != INVALID_HANDLE_VALUE)
     {
         CloseHandle(_hPaintEnabledEvent);
@@ -119,6 +134,30 @@ HRESULT RenderThread::Initialize(IRenderer* const pRendererParent) noexcept
         }
     }
 
+    if (SUCCEEDED(hr))
+    {
+        // A high resolution timer can wait for less than a tick of the system
+        // clock. Older versions of Windows don't have them, and fail to make
+        // one, in which case an ordinary timer has to do.
+        HANDLE hFrameTimer = CreateWaitableTimerExW(nullptr,
+                                                    nullptr,
+                                                    CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                                    TIMER_ALL_ACCESS);
+        if (hFrameTimer == nullptr)
+        {
+            hFrameTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        }
+
+        if (hFrameTimer == nullptr)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else
+        {
+            _hFrameTimer = hFrameTimer;
+        }
+    }
+
     if (SUCCEEDED(hr))
     {
         HANDLE hThread = CreateThread(nullptr,      // non-inheritable security attributes
@@ -163,20 +202,64 @@ DWORD WINAPI RenderThread::_ThreadProc()
         WaitForSingleObject(_hPaintEnabledEvent, INFINITE);
         WaitForSingleObject(_hEvent, INFINITE);
 
+        // extra check before we wait since it's a "long" activity, relatively speaking.
+        if (_fKeepRunning)
+        {
+            _WaitForNextFrame();
+        }
+
         ResetEvent(_hPaintCompletedEvent);
 
+        _lastFrameStart = std::chrono::steady_clock::now();
         LOG_IF_FAILED(_pRenderer->PaintFrame());
 
         SetEvent(_hPaintCompletedEvent);
+    }
 
-        // extra check before we sleep since it's a "long" activity, relatively speaking.
-        if (_fKeepRunning)
+    return S_OK;
+}
+
+// Method Description:
+// - Holds the next frame back until it's due. When we've been idle for longer
+//      than a frame, say when a key's echoed, the frame is painted right away.
+//      Under a steady stream of output, the frames are spaced out to the frame
+//      rate, and then lined up with the display's refresh by any engine that
+//      can tell when the display is ready for another one.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void RenderThread::_WaitForNextFrame()
+{
+    const auto frameRate = _maxFrameRate.load(std::memory_order_relaxed);
+    const std::chrono::steady_clock::duration frameInterval = std::chrono::seconds{ 1 };
+    const auto nextFrame = _lastFrameStart + frameInterval / frameRate;
+    const auto now = std::chrono::steady_clock::now();
+    if (now < nextFrame)
+    {
+        // The timer counts in 100ns units, and a negative time is relative to now.
+        using FileTimeDuration = std::chrono::duration<LONGLONG, std::ratio<1, 10'000'000>>;
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -std::chrono::duration_cast<FileTimeDuration>(nextFrame - now).count();
+        if (SetWaitableTimer(_hFrameTimer, &dueTime, 0, nullptr, nullptr, FALSE))
         {
-            Sleep(s_FrameLimitMilliseconds);
+            WaitForSingleObject(_hFrameTimer, INFINITE);
         }
     }
 
-    return S_OK;
+    LOG_IF_FAILED(_pRenderer->WaitUntilCanRender());
+}
+
+// Method Description:
+// - Sets the most frames we'll paint in a second. This can be called from any
+//      thread, and applies from the next frame on.
+// Arguments:
+// - framesPerSecond: the frame rate, or 0 for the default
+// Return Value:
+// - <none>
+void RenderThread::SetMaxFrameRate(const unsigned int framesPerSecond) noexcept
+{
+    _maxFrameRate.store(framesPerSecond == 0 ? s_DefaultMaxFrameRate : framesPerSecond, std::memory_order_relaxed);
 }
 
 void RenderThread::NotifyPaint()
@@ -32,16 +32,27 @@ namespace Microsoft::Console::Render
 
         void EnablePainting() override;
         void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) override;
-        
+
+        void SetMaxFrameRate(const unsigned int framesPerSecond) noexcept;
+
     private:
         static DWORD WINAPI s_ThreadProc(_In_ LPVOID lpParameter);
         DWORD WINAPI _ThreadProc();
 
-        static DWORD const s_FrameLimitMilliseconds = 8;
+        void _WaitForNextFrame();
+
+        // About as often as we used to paint when we slept 8ms after every frame.
+        static constexpr unsigned int s_DefaultMaxFrameRate = 125;
 
         HANDLE _hThread;
         HANDLE _hEvent;
 
+        // Holds back the next frame until it's due, when frames are asked for faster
+        //      than the frame rate allows.
+        HANDLE _hFrameTimer;
+        std::atomic<unsigned int> _maxFrameRate;
+        std::chrono::steady_clock::time_point _lastFrameStart;
+
         HANDLE _hPaintEnabledEvent;
         HANDLE _hPaintCompletedEvent;
 
@@ -0,0 +1,114 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "BackgroundBatch.h"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// Routine Description:
+// - Adds the background of a run. Runs are painted left to right, so a run
+//   that picks up where the last one left off in the same color just makes
+//   the last rectangle longer.
+// Arguments:
+// - rect - Where to fill
+// - color - What to fill it with
+// Return Value:
+// - <none>
+void BackgroundBatch::Add(const D2D1_RECT_F& rect, const D2D1_COLOR_F& color)
+{
+    if (!_backgrounds.empty())
+    {
+        auto& last = _backgrounds.back();
+        if (s_IsSameColor(last.color, color) &&
+            last.rect.top == rect.top &&
+            last.rect.bottom == rect.bottom &&
+            last.rect.right == rect.left)
+        {
+            last.rect.right = rect.right;
+            return;
+        }
+    }
+
+    _backgrounds.push_back({ color, rect });
+}
+
+// Routine Description:
+// - Forgets every background, for the next frame.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void BackgroundBatch::Clear() noexcept
+{
+    _backgrounds.clear();
+}
+
+// Routine Description:
+// - Fills every background that's been added, one color at a time. Rectangles
+//   of the same color stacked exactly on top of each other, like a status bar
+//   or a block of highlighted lines, are filled as one. The batch is emptied.
+// - Backgrounds never overlap, so the order they're filled in doesn't matter.
+// Arguments:
+// - renderTarget - The target to fill them on
+// - brushes - Where to get the brush for each color from
+// Return Value:
+// - S_OK, or a memory or DirectX error.
+[[nodiscard]]
+HRESULT BackgroundBatch::Fill(ID2D1RenderTarget* const renderTarget,
+                              BrushCache& brushes) noexcept
+{
+    try
+    {
+        auto clearOnExit = wil::scope_exit([&]() noexcept { Clear(); });
+
+        // Sort by color, then by column span, then top to bottom, so that the
+        // rectangles that can be filled together end up next to each other.
+        std::sort(_backgrounds.begin(), _backgrounds.end(), [](const Background& a, const Background& b) {
+            const auto colorA = std::tie(a.color.r, a.color.g, a.color.b, a.color.a);
+            const auto colorB = std::tie(b.color.r, b.color.g, b.color.b, b.color.a);
+            if (colorA != colorB)
+            {
+                return colorA < colorB;
+            }
+            return std::tie(a.rect.left, a.rect.right, a.rect.top) < std::tie(b.rect.left, b.rect.right, b.rect.top);
+        });
+
+        for (size_t i = 0; i < _backgrounds.size();)
+        {
+            const auto& color = _backgrounds.at(i).color;
+            ::Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> brush;
+            RETURN_IF_FAILED(brushes.Get(renderTarget, color, &brush));
+
+            // Fill everything in this color.
+            while (i < _backgrounds.size() && s_IsSameColor(_backgrounds.at(i).color, color))
+            {
+                auto rect = _backgrounds.at(i).rect;
+                ++i;
+
+                while (i < _backgrounds.size() &&
+                       s_IsSameColor(_backgrounds.at(i).color, color) &&
+                       _backgrounds.at(i).rect.left == rect.left &&
+                       _backgrounds.at(i).rect.right == rect.right &&
+                       _backgrounds.at(i).rect.top == rect.bottom)
+                {
+                    rect.bottom = _backgrounds.at(i).rect.bottom;
+                    ++i;
+                }
+
+                renderTarget->FillRectangle(rect, brush.Get());
+            }
+        }
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+bool BackgroundBatch::s_IsSameColor(const D2D1_COLOR_F& a, const D2D1_COLOR_F& b) noexcept
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
@@ -0,0 +1,36 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <d2d1.h>
+
+#include "BrushCache.h"
+
+namespace Microsoft::Console::Render
+{
+    // Collects the backgrounds of every run painted in a frame, so they can all
+    // be filled at once, before any text, with one brush for each color.
+    // Rectangles of the same color that touch are filled as one.
+    class BackgroundBatch final
+    {
+    public:
+        void Add(const D2D1_RECT_F& rect, const D2D1_COLOR_F& color);
+        void Clear() noexcept;
+
+        [[nodiscard]]
+        HRESULT Fill(ID2D1RenderTarget* const renderTarget,
+                     BrushCache& brushes) noexcept;
+
+    private:
+        struct Background
+        {
+            D2D1_COLOR_F color;
+            D2D1_RECT_F rect;
+        };
+
+        static bool s_IsSameColor(const D2D1_COLOR_F& a, const D2D1_COLOR_F& b) noexcept;
+
+        std::vector<Background> _backgrounds;
+    };
+}
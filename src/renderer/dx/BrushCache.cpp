@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "BrushCache.h"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// Routine Description:
+// - Creates an empty cache.
+// Arguments:
+// - capacity - How many colors to keep brushes for before starting over
+BrushCache::BrushCache(const size_t capacity) :
+    _capacity{ capacity }
+{
+}
+
+// Routine Description:
+// - Gets the brush for a color, making it the first time the color is used.
+//   If the cache is full, every other brush is let go first: the colors
+//   still in use get new brushes the next time they're drawn with.
+// - The brush mustn't have its color changed.
+// Arguments:
+// - renderTarget - The target to make the brush on
+// - color - The color of the brush
+// - brush - Receives the brush, with a reference for the caller
+// Return Value:
+// - S_OK or relevant DirectX error.
+[[nodiscard]]
+HRESULT BrushCache::Get(ID2D1RenderTarget* const renderTarget,
+                        const D2D1_COLOR_F& color,
+                        _COM_Outptr_ ID2D1SolidColorBrush** const brush) noexcept
+{
+    *brush = nullptr;
+
+    try
+    {
+        const auto key = s_Key(color);
+
+        const auto found = _brushes.find(key);
+        if (found != _brushes.end())
+        {
+            found->second.CopyTo(brush);
+            return S_OK;
+        }
+
+        ::Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> created;
+        RETURN_IF_FAILED(renderTarget->CreateSolidColorBrush(color, &created));
+
+        if (_brushes.size() >= _capacity)
+        {
+            _brushes.clear();
+        }
+
+        _brushes.emplace(key, created);
+        *brush = created.Detach();
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Lets go of every brush, for when the device goes away.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void BrushCache::Clear() noexcept
+{
+    _brushes.clear();
+}
+
+// Routine Description:
+// - Packs a color into the 8 bits per channel that it came from, so that
+//   colors that only differ by rounding share a brush.
+// Arguments:
+// - color - The color to pack
+// Return Value:
+// - The color as RGBA, one byte each.
+UINT32 BrushCache::s_Key(const D2D1_COLOR_F& color) noexcept
+{
+    const auto channel = [](const float value) noexcept {
+        return static_cast<UINT32>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    };
+
+    return channel(color.r) << 24 | channel(color.g) << 16 | channel(color.b) << 8 | channel(color.a);
+}
+
+// Routine Description:
+// - Estimates how much memory the table of brushes is holding. The brushes
+//   themselves belong to Direct2D, and aren't counted.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of the cache.
+Microsoft::Console::Types::MemoryUsage BrushCache::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddHashTable(_brushes);
+    return usage;
+}
@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "../../types/inc/MemoryUsage.hpp"
+
+#include <d2d1.h>
+
+#include <wrl/client.h>
+
+namespace Microsoft::Console::Render
+{
+    // Keeps one solid color brush for each color that's been drawn with, so
+    // that runs in different colors each have a brush of their own instead of
+    // sharing one whose color is changed between them. Direct2D has to flush
+    // whatever it's batched that uses a brush before the brush can change, so
+    // a brush's color is never changed once it's in here.
+    // - The brushes belong to the device they were made on, so the cache must
+    //   be cleared when the device goes away.
+    class BrushCache final
+    {
+    public:
+        BrushCache(const size_t capacity = s_defaultCapacity);
+
+        [[nodiscard]]
+        HRESULT Get(ID2D1RenderTarget* const renderTarget,
+                    const D2D1_COLOR_F& color,
+                    _COM_Outptr_ ID2D1SolidColorBrush** const brush) noexcept;
+        void Clear() noexcept;
+        Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+
+    private:
+        static UINT32 s_Key(const D2D1_COLOR_F& color) noexcept;
+
+        static constexpr size_t s_defaultCapacity = 1024;
+
+        const size_t _capacity;
+        std::unordered_map<UINT32, ::Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>> _brushes;
+    };
+}
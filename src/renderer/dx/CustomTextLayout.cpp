@@ -4,6 +4,8 @@
 #include "precomp.h"
 
 #include "CustomTextLayout.h"
+#include "ShapedTextCache.h"
+#include "FontFallbackCache.h"
 
 #include <wrl.h>
 #include <wrl/client.h>
@@ -19,12 +21,16 @@ using namespace Microsoft::Console::Render;
 // - font - The DirectWrite font face to use while calculating layout (by default, will fallback if necessary)
 // - clusters - From the backing buffer, the text to be displayed clustered by the columns it should consume.
 // - width - The count of pixels available per column (the expected pixel width of every column)
+// - cache - Optional place to find text that's been shaped before, and to keep what's shaped here
+// - fallbackCache - Optional place to find the fonts that characters were mapped to before, and to keep what's mapped here
 CustomTextLayout::CustomTextLayout(IDWriteFactory2* const factory,
                                    IDWriteTextAnalyzer1* const analyzer,
                                    IDWriteTextFormat2* const format,
                                    IDWriteFontFace5* const font,
                                    std::basic_string_view<Cluster> const clusters,
-                                   size_t const width) :
+                                   size_t const width,
+                                   ShapedTextCache* const cache,
+                                   FontFallbackCache* const fallbackCache) :
     _factory{ factory },
     _analyzer{ analyzer },
     _format{ format },
@@ -35,7 +41,9 @@ CustomTextLayout::CustomTextLayout(IDWriteFactory2* const factory,
     _runs{},
     _breakpoints{},
     _runIndex{ 0 },
-    _width{ width }
+    _width{ width },
+    _cache{ cache },
+    _fallbackCache{ fallbackCache }
 {
     // Fetch the locale name out once now from the format
     _localeName.resize(format->GetLocaleNameLength() + 1); // +1 for null
@@ -77,6 +85,8 @@ HRESULT STDMETHODCALLTYPE CustomTextLayout::GetColumns(_Out_ UINT32* columns)
 //   the context information.
 // - This specific class does the layout calculations and complexity analysis, not the
 //   final drawing. That's the renderer's job (passed in.)
+// - If the same text was shaped before with the same font and cell width, and it's
+//   still in the cache, the analysis is skipped entirely.
 // Arguments:
 // - clientDrawingContext - Optional pointer to information that the renderer might need
 //                          while attempting to graphically place the text onto the screen
@@ -91,10 +101,40 @@ HRESULT STDMETHODCALLTYPE CustomTextLayout::Draw(_In_opt_ void* clientDrawingCon
                                                  FLOAT originX,
                                                  FLOAT originY)
 {
-    RETURN_IF_FAILED(_AnalyzeRuns());
-    RETURN_IF_FAILED(_ShapeGlyphRuns());
-    RETURN_IF_FAILED(_CorrectGlyphRuns());
-    RETURN_IF_FAILED(_DrawGlyphRuns(clientDrawingContext, renderer, { originX, originY }));
+    try
+    {
+        std::optional<ShapedTextCache::Key> key;
+        std::shared_ptr<const ShapedText> shaped;
+
+        if (_cache)
+        {
+            key.emplace(ShapedTextCache::Key{ _text, _textClusterColumns, _font.Get(), _format->GetFontSize(), _width });
+            shaped = _cache->Find(*key);
+        }
+
+        if (!shaped)
+        {
+            RETURN_IF_FAILED(_AnalyzeRuns());
+            RETURN_IF_FAILED(_ShapeGlyphRuns());
+            RETURN_IF_FAILED(_CorrectGlyphRuns());
+
+            auto made = std::make_shared<ShapedText>();
+            made->runs = std::move(_runs);
+            made->glyphOffsets = std::move(_glyphOffsets);
+            made->glyphClusters = std::move(_glyphClusters);
+            made->glyphIndices = std::move(_glyphIndices);
+            made->glyphAdvances = std::move(_glyphAdvances);
+            shaped = made;
+
+            if (key)
+            {
+                _cache->Insert(std::move(*key), shaped);
+            }
+        }
+
+        RETURN_IF_FAILED(_DrawGlyphRuns(clientDrawingContext, renderer, { originX, originY }, *shaped));
+    }
+    CATCH_RETURN();
 
     return S_OK;
 }
@@ -471,12 +511,14 @@ HRESULT CustomTextLayout::_CorrectGlyphRun(const UINT32 runIndex) noexcept
 //                          while attempting to graphically place the text onto the screen
 // - renderer - The interface to be used for actually putting text onto the screen
 // - origin - pixel point of top left corner on final surface for drawing
+// - shaped - The runs and glyphs to draw
 // Return Value: 
 // - S_OK or suitable DirectX/DirectWrite/Direct2D result code.
 [[nodiscard]]
 HRESULT CustomTextLayout::_DrawGlyphRuns(_In_opt_ void* clientDrawingContext,
                                          IDWriteTextRenderer* renderer,
-                                         const D2D_POINT_2F origin) noexcept
+                                         const D2D_POINT_2F origin,
+                                         const ShapedText& shaped) noexcept
 {
     try
     {
@@ -485,10 +527,10 @@ HRESULT CustomTextLayout::_DrawGlyphRuns(_In_opt_ void* clientDrawingContext,
         auto mutableOrigin = origin;
 
         // Draw each run separately.
-        for (UINT32 runIndex = 0; runIndex < _runs.size(); ++runIndex)
+        for (UINT32 runIndex = 0; runIndex < shaped.runs.size(); ++runIndex)
         {
             // Get the run
-            Run& run = _runs.at(runIndex);
+            const Run& run = shaped.runs.at(runIndex);
 
             // Prepare the glyph run and description objects by converting our
             // internal storage representation into something that matches DWrite's structures.
@@ -496,14 +538,14 @@ HRESULT CustomTextLayout::_DrawGlyphRuns(_In_opt_ void* clientDrawingContext,
             glyphRun.bidiLevel = run.bidiLevel;
             glyphRun.fontEmSize = _format->GetFontSize() * run.fontScale;
             glyphRun.fontFace = run.fontFace.Get();
-            glyphRun.glyphAdvances = _glyphAdvances.data() + run.glyphStart;
+            glyphRun.glyphAdvances = shaped.glyphAdvances.data() + run.glyphStart;
             glyphRun.glyphCount = run.glyphCount;
-            glyphRun.glyphIndices = _glyphIndices.data() + run.glyphStart;
-            glyphRun.glyphOffsets = _glyphOffsets.data() + run.glyphStart;
+            glyphRun.glyphIndices = shaped.glyphIndices.data() + run.glyphStart;
+            glyphRun.glyphOffsets = shaped.glyphOffsets.data() + run.glyphStart;
             glyphRun.isSideways = false;
 
             DWRITE_GLYPH_RUN_DESCRIPTION glyphRunDescription = { 0 };
-            glyphRunDescription.clusterMap = _glyphClusters.data();
+            glyphRunDescription.clusterMap = shaped.glyphClusters.data();
             glyphRunDescription.localeName = _localeName.data();
             glyphRunDescription.string = _text.data();
             glyphRunDescription.stringLength = run.textLength;
@@ -519,8 +561,8 @@ HRESULT CustomTextLayout::_DrawGlyphRuns(_In_opt_ void* clientDrawingContext,
                                                     nullptr));
 
             // Shift origin to the right for the next run based on the amount of space consumed.
-            mutableOrigin.x = std::accumulate(_glyphAdvances.begin() + run.glyphStart,
-                                              _glyphAdvances.begin() + run.glyphStart + run.glyphCount,
+            mutableOrigin.x = std::accumulate(shaped.glyphAdvances.begin() + run.glyphStart,
+                                              shaped.glyphAdvances.begin() + run.glyphStart + run.glyphCount,
                                               mutableOrigin.x);
         }
     }
@@ -821,23 +863,78 @@ HRESULT STDMETHODCALLTYPE CustomTextLayout::_AnalyzeFontFallback(IDWriteTextAnal
         // Walk through and analyze the entire string
         while (textLength > 0)
         {
+            // Characters that were mapped before go to the same font again,
+            // along with any after them that went to that font too.
+            if (_fallbackCache)
+            {
+                UINT32 length = 0;
+                const auto codePoint = _ReadCodePoint(textPosition, textLength, length);
+                if (const auto cached = _fallbackCache->Find(codePoint, _font.Get()))
+                {
+                    const auto face = cached->fontFace;
+                    const auto scale = cached->scale;
+
+                    UINT32 mappedLength = length;
+                    while (mappedLength < textLength)
+                    {
+                        const auto next = _ReadCodePoint(textPosition + mappedLength, textLength - mappedLength, length);
+                        const auto nextCached = _fallbackCache->Find(next, _font.Get());
+                        if (!nextCached || nextCached->fontFace != face || nextCached->scale != scale)
+                        {
+                            break;
+                        }
+                        mappedLength += length;
+                    }
+
+                    RETURN_IF_FAILED(_SetMappedFont(textPosition, mappedLength, face.Get(), scale));
+
+                    textPosition += mappedLength;
+                    textLength -= mappedLength;
+                    continue;
+                }
+            }
+
             UINT32 mappedLength = 0;
-            IDWriteFont* mappedFont = nullptr;
+            ::Microsoft::WRL::ComPtr<IDWriteFont> mappedFont;
             FLOAT scale = 0.0f;
 
-            fallback->MapCharacters(source,
-                                    textPosition,
-                                    textLength,
-                                    collection.Get(),
-                                    familyName.data(),
-                                    weight,
-                                    style,
-                                    stretch,
-                                    &mappedLength,
-                                    &mappedFont,
-                                    &scale);
+            RETURN_IF_FAILED(fallback->MapCharacters(source,
+                                                     textPosition,
+                                                     textLength,
+                                                     collection.Get(),
+                                                     familyName.data(),
+                                                     weight,
+                                                     style,
+                                                     stretch,
+                                                     &mappedLength,
+                                                     &mappedFont,
+                                                     &scale));
+            RETURN_HR_IF(E_UNEXPECTED, mappedLength == 0);
+
+            ::Microsoft::WRL::ComPtr<IDWriteFontFace5> mappedFace;
+            if (mappedFont)
+            {
+                // Get font face from font metadata
+                ::Microsoft::WRL::ComPtr<IDWriteFontFace> face;
+                RETURN_IF_FAILED(mappedFont->CreateFontFace(&face));
+
+                // QI for Face5 interface from base face interface
+                RETURN_IF_FAILED(face.As(&mappedFace));
+            }
 
-            RETURN_IF_FAILED(_SetMappedFont(textPosition, mappedLength, mappedFont, scale));
+            RETURN_IF_FAILED(_SetMappedFont(textPosition, mappedLength, mappedFace.Get(), scale));
+
+            if (_fallbackCache)
+            {
+                const FontFallbackCache::Result result{ mappedFace, scale };
+                for (UINT32 offset = 0; offset < mappedLength;)
+                {
+                    UINT32 length = 0;
+                    const auto codePoint = _ReadCodePoint(textPosition + offset, mappedLength - offset, length);
+                    _fallbackCache->Insert(codePoint, _font.Get(), result);
+                    offset += length;
+                }
+            }
 
             textPosition += mappedLength;
             textLength -= mappedLength;
@@ -854,13 +951,13 @@ HRESULT STDMETHODCALLTYPE CustomTextLayout::_AnalyzeFontFallback(IDWriteTextAnal
 // Arguments:
 // - textPosition - the index to start the substring operation
 // - textLength - the length of the substring operation
-// - font - the font that applies to the substring range
+// - fontFace - the font that applies to the substring range, or nullptr for the primary font
 // - scale - the scale of the font to apply
 // - S_OK or appropriate STL/GSL failure code.
 [[nodiscard]]
 HRESULT STDMETHODCALLTYPE CustomTextLayout::_SetMappedFont(UINT32 textPosition,
                                                            UINT32 textLength,
-                                                           IDWriteFont* const font,
+                                                           IDWriteFontFace5* const fontFace,
                                                            FLOAT const scale)
 {
     try
@@ -871,14 +968,9 @@ HRESULT STDMETHODCALLTYPE CustomTextLayout::_SetMappedFont(UINT32 textPosition,
         {
             auto& run = _FetchNextRun(textLength);
 
-            if (font != nullptr)
+            if (fontFace != nullptr)
             {
-                // Get font face from font metadata
-                ::Microsoft::WRL::ComPtr<IDWriteFontFace> face;
-                RETURN_IF_FAILED(font->CreateFontFace(&face));
-
-                // QI for Face5 interface from base face interface, store into run
-                RETURN_IF_FAILED(face.As(&run.fontFace));
+                run.fontFace = fontFace;
             }
             else
             {
@@ -894,6 +986,34 @@ HRESULT STDMETHODCALLTYPE CustomTextLayout::_SetMappedFont(UINT32 textPosition,
     return S_OK;
 }
 
+// Routine Description:
+// - Reads the code point at a position in the text, which takes two code
+//   units if it's a surrogate pair.
+// Arguments:
+// - textPosition - the index of the code point's first code unit
+// - textLength - how many code units there are from there to read from
+// - length - Filled with how many code units the code point takes
+// Return Value:
+// - The code point. An unpaired surrogate is returned by itself.
+UINT32 CustomTextLayout::_ReadCodePoint(const UINT32 textPosition,
+                                        const UINT32 textLength,
+                                        UINT32& length) const noexcept
+{
+    const wchar_t first = _text[textPosition];
+    if (IS_HIGH_SURROGATE(first) && textLength > 1)
+    {
+        const wchar_t second = _text[textPosition + 1];
+        if (IS_LOW_SURROGATE(second))
+        {
+            length = 2;
+            return 0x10000 + ((first - 0xD800) << 10) + (second - 0xDC00);
+        }
+    }
+
+    length = 1;
+    return first;
+}
+
 #pragma endregion
 
 #pragma region internal Run manipulation functions for storing information from sink callbacks
@@ -14,6 +14,9 @@
 
 namespace Microsoft::Console::Render
 {
+    class ShapedTextCache;
+    class FontFallbackCache;
+
     class CustomTextLayout : public ::Microsoft::WRL::RuntimeClass<::Microsoft::WRL::RuntimeClassFlags<::Microsoft::WRL::ClassicCom |
         ::Microsoft::WRL::InhibitFtmBase>,
         IDWriteTextAnalysisSource,
@@ -27,7 +30,9 @@ namespace Microsoft::Console::Render
                          IDWriteTextFormat2* const format,
                          IDWriteFontFace5* const font,
                          const std::basic_string_view<::Microsoft::Console::Render::Cluster> clusters,
-                         size_t const width);
+                         size_t const width,
+                         ShapedTextCache* const cache = nullptr,
+                         FontFallbackCache* const fallbackCache = nullptr);
 
         [[nodiscard]]
         HRESULT STDMETHODCALLTYPE GetColumns(_Out_ UINT32* columns);
@@ -128,6 +133,18 @@ namespace Microsoft::Console::Render
             UINT32 nextRunIndex;  // index of next run
         };
 
+    public:
+        // Everything needed to draw the text once it's been analyzed, shaped and corrected.
+        struct ShapedText
+        {
+            std::vector<LinkedRun> runs;
+            std::vector<DWRITE_GLYPH_OFFSET> glyphOffsets;
+            std::vector<UINT16> glyphClusters;
+            std::vector<UINT16> glyphIndices;
+            std::vector<float> glyphAdvances;
+        };
+
+    protected:
         [[nodiscard]]
         LinkedRun& _FetchNextRun(UINT32& textLength);
         void _SetCurrentRun(const UINT32 textPosition);
@@ -136,7 +153,8 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT STDMETHODCALLTYPE _AnalyzeFontFallback(IDWriteTextAnalysisSource* const source, UINT32 textPosition, UINT32 textLength);
         [[nodiscard]]
-        HRESULT STDMETHODCALLTYPE _SetMappedFont(UINT32 textPosition, UINT32 textLength, IDWriteFont* const font, FLOAT const scale);
+        HRESULT STDMETHODCALLTYPE _SetMappedFont(UINT32 textPosition, UINT32 textLength, IDWriteFontFace5* const fontFace, FLOAT const scale);
+        UINT32 _ReadCodePoint(const UINT32 textPosition, const UINT32 textLength, UINT32& length) const noexcept;
 
         [[nodiscard]]
         HRESULT _AnalyzeRuns() noexcept;
@@ -151,7 +169,8 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT _DrawGlyphRuns(_In_opt_ void* clientDrawingContext,
                                IDWriteTextRenderer* renderer,
-                               const D2D_POINT_2F origin) noexcept;
+                               const D2D_POINT_2F origin,
+                               const ShapedText& shaped) noexcept;
 
         [[nodiscard]]
         static UINT32 _EstimateGlyphCount(const UINT32 textLength) noexcept;
@@ -174,6 +193,12 @@ namespace Microsoft::Console::Render
         std::vector<UINT16> _textClusterColumns;
         size_t _width;
 
+        // Where text that's been shaped before is kept, if anywhere.
+        ShapedTextCache* const _cache;
+
+        // Where the fonts that characters were mapped to before are kept, if anywhere.
+        FontFallbackCache* const _fallbackCache;
+
         // Properties of the text that might be relevant.
         std::wstring _localeName;
         ::Microsoft::WRL::ComPtr<IDWriteNumberSubstitution> _numberSubstitution;
@@ -4,6 +4,9 @@
 #include "precomp.h"
 
 #include "CustomTextRenderer.h"
+#include "GlyphAtlas.h"
+#include "BackgroundBatch.h"
+#include "BrushCache.h"
 
 #include <wrl.h>
 #include <wrl/client.h>
@@ -261,7 +264,18 @@ HRESULT CustomTextRenderer::DrawGlyphRun(
         rect.right += glyphRun->glyphAdvances[i];
     }
 
-    d2dContext4->FillRectangle(rect, drawingContext->backgroundBrush);
+    if (drawingContext->backgrounds)
+    {
+        try
+        {
+            drawingContext->backgrounds->Add(rect, drawingContext->backgroundColor);
+        }
+        CATCH_RETURN();
+    }
+    else
+    {
+        d2dContext4->FillRectangle(rect, drawingContext->backgroundBrush);
+    }
 
     // Now go onto drawing the text.
 
@@ -367,6 +381,12 @@ HRESULT CustomTextRenderer::DrawGlyphRun(
                         // This run uses the current text color.
                         layerBrush = drawingContext->foregroundBrush;
                     }
+                    else if (drawingContext->brushes)
+                    {
+                        // This run specifies its own color, which keeps its own brush.
+                        RETURN_IF_FAILED(drawingContext->brushes->Get(d2dContext4.Get(), colorRun->runColor, &tempBrush));
+                        layerBrush = tempBrush.Get();
+                    }
                     else
                     {
                         if (!tempBrush)
@@ -418,6 +438,23 @@ HRESULT CustomTextRenderer::_DrawBasicGlyphRun(DrawingContext* clientDrawingCont
                                                _In_ const DWRITE_GLYPH_RUN_DESCRIPTION* glyphRunDescription,
                                                ID2D1Brush* brush)
 {
+    // Glyphs we've drawn before are already rasterized in the atlas.
+    if (clientDrawingContext->glyphAtlas)
+    {
+        const auto hr = clientDrawingContext->glyphAtlas->DrawGlyphRun(clientDrawingContext->renderTarget,
+                                                                       clientDrawingContext->cellSize,
+                                                                       clientDrawingContext->spacing.baseline,
+                                                                       baselineOrigin,
+                                                                       measuringMode,
+                                                                       glyphRun,
+                                                                       brush);
+        RETURN_IF_FAILED(hr);
+        if (hr == S_OK)
+        {
+            return S_OK;
+        }
+    }
+
     ::Microsoft::WRL::ComPtr<ID2D1DeviceContext4> d2dContext4;
     RETURN_IF_FAILED(clientDrawingContext->renderTarget->QueryInterface(d2dContext4.GetAddressOf()));
 
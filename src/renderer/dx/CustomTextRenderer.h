@@ -7,6 +7,10 @@
 
 namespace Microsoft::Console::Render
 {
+    class GlyphAtlas;
+    class BackgroundBatch;
+    class BrushCache;
+
     struct DrawingContext
     {
         DrawingContext(ID2D1RenderTarget* renderTarget,
@@ -24,6 +28,10 @@ namespace Microsoft::Console::Render
             this->spacing = spacing;
             this->cellSize = cellSize;
             this->options = options;
+            this->glyphAtlas = nullptr;
+            this->backgrounds = nullptr;
+            this->backgroundColor = {};
+            this->brushes = nullptr;
         }
 
         ID2D1RenderTarget* renderTarget;
@@ -33,6 +41,18 @@ namespace Microsoft::Console::Render
         DWRITE_LINE_SPACING spacing;
         D2D_SIZE_F cellSize;
         D2D1_DRAW_TEXT_OPTIONS options;
+
+        // If set, glyphs are drawn from here instead of being rasterized every time.
+        GlyphAtlas* glyphAtlas;
+
+        // If set, backgrounds are added here in backgroundColor, to be filled
+        // later with the rest of the frame's, instead of being filled right away.
+        BackgroundBatch* backgrounds;
+        D2D1_COLOR_F backgroundColor;
+
+        // If set, runs in a color of their own get their brush from here
+        // instead of making one.
+        BrushCache* brushes;
     };
 
     class CustomTextRenderer : public ::Microsoft::WRL::RuntimeClass<::Microsoft::WRL::RuntimeClassFlags<::Microsoft::WRL::ClassicCom |
@@ -13,8 +13,6 @@
 
 #pragma hdrstop
 
-static constexpr float POINTS_PER_INCH = 72.0f;
-
 using namespace Microsoft::Console::Render;
 using namespace Microsoft::Console::Types;
 
@@ -28,6 +26,7 @@ DxEngine::DxEngine() :
     _invalidScroll{ 0 },
     _presentParams{ 0 },
     _presentReady{ false },
+    _presentFull{ true },
     _presentScroll{ 0 },
     _presentDirty{ 0 },
     _presentOffset{ 0 },
@@ -37,6 +36,8 @@ DxEngine::DxEngine() :
     _foregroundColor{ 0 },
     _backgroundColor{ 0 },
     _glyphCell{ 0 },
+    _asciiGlyphIndices{},
+    _asciiGlyphOffsets{},
     _haveDeviceResources{ false },
     _hwndTarget{ static_cast<HWND>(INVALID_HANDLE_VALUE) },
     _sizeTarget{ 0 },
@@ -45,13 +46,7 @@ DxEngine::DxEngine() :
     _chainMode{ SwapChainMode::ForComposition },
     _customRenderer{ ::Microsoft::WRL::Make<CustomTextRenderer>() }
 {
-    THROW_IF_FAILED(D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, IID_PPV_ARGS(&_d2dFactory)));
-
-    THROW_IF_FAILED(DWriteCreateFactory(
-        DWRITE_FACTORY_TYPE_SHARED,
-        __uuidof(_dwriteFactory),
-        reinterpret_cast<IUnknown **>(_dwriteFactory.GetAddressOf())
-    ));
+    THROW_IF_FAILED(SharedResources::GetFactories(_d2dFactory, _dwriteFactory));
 }
 
 // Routine Description:
@@ -132,40 +127,9 @@ HRESULT DxEngine::_CreateDeviceResources(const bool createSwapChain) noexcept
 
     auto freeOnFail = wil::scope_exit([&] { _ReleaseDeviceResources(); });
 
-    RETURN_IF_FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&_dxgiFactory2)));
-
-    RETURN_IF_FAILED(_dxgiFactory2->EnumAdapters1(0, &_dxgiAdapter1));
-
-    const DWORD DeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT |
-        // This causes problems for folks who do not have the whole DirectX SDK installed
-        // when they try to run the rest of the project in debug mode.
-        // As such, I'm leaving this flag here for people doing DX-specific work to toggle it
-        // only when they need it and shutting it off otherwise.
-        // Find out more about the debug layer here:
-        // https://docs.microsoft.com/en-us/windows/desktop/direct3d11/overviews-direct3d-11-devices-layers
-        // You can find out how to install it here:
-        // https://docs.microsoft.com/en-us/windows/uwp/gaming/use-the-directx-runtime-and-visual-studio-graphics-diagnostic-features
-        // D3D11_CREATE_DEVICE_DEBUG |
-        D3D11_CREATE_DEVICE_SINGLETHREADED;
-
-    D3D_FEATURE_LEVEL FeatureLevels[] = {
-        D3D_FEATURE_LEVEL_11_1,
-        D3D_FEATURE_LEVEL_11_0,
-        D3D_FEATURE_LEVEL_10_1,
-        D3D_FEATURE_LEVEL_10_0,
-        D3D_FEATURE_LEVEL_9_1,
-    };
-
-    RETURN_IF_FAILED(D3D11CreateDevice(_dxgiAdapter1.Get(),
-                                       D3D_DRIVER_TYPE_UNKNOWN,
-                                       NULL,
-                                       DeviceFlags,
-                                       FeatureLevels,
-                                       ARRAYSIZE(FeatureLevels),
-                                       D3D11_SDK_VERSION,
-                                       &_d3dDevice,
-                                       NULL,
-                                       &_d3dDeviceContext));
+    // Every engine in the process draws with the same device. It's only made
+    // again once it's lost, or the adapters have changed since.
+    RETURN_IF_FAILED(SharedResources::GetDevice(_dxgiFactory2, _dxgiAdapter1, _d3dDevice, _d3dDeviceContext));
 
     RETURN_IF_FAILED(_dxgiAdapter1->EnumOutputs(0, &_dxgiOutput));
 
@@ -181,6 +145,7 @@ HRESULT DxEngine::_CreateDeviceResources(const bool createSwapChain) noexcept
         SwapChainDesc.SampleDesc.Count = 1;
         SwapChainDesc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
         SwapChainDesc.Scaling = DXGI_SCALING_NONE;
+        SwapChainDesc.Flags = s_SwapChainFlags;
 
         switch (_chainMode)
         {
@@ -196,6 +161,7 @@ HRESULT DxEngine::_CreateDeviceResources(const bool createSwapChain) noexcept
             // We can't do alpha for HWNDs. Set to ignore. It will fail otherwise.
             SwapChainDesc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
 
+            const SharedResources::DeviceLock lock{ _d2dFactory.Get() };
             RETURN_IF_FAILED(_dxgiFactory2->CreateSwapChainForHwnd(_d3dDevice.Get(),
                                                                    _hwndTarget,
                                                                    &SwapChainDesc,
@@ -215,6 +181,7 @@ HRESULT DxEngine::_CreateDeviceResources(const bool createSwapChain) noexcept
             // It's 100% required to use scaling mode stretch for composition. There is no other choice.
             SwapChainDesc.Scaling = DXGI_SCALING_STRETCH;
 
+            const SharedResources::DeviceLock lock{ _d2dFactory.Get() };
             RETURN_IF_FAILED(_dxgiFactory2->CreateSwapChainForComposition(_d3dDevice.Get(),
                                                                           &SwapChainDesc,
                                                                           nullptr,
@@ -225,9 +192,19 @@ HRESULT DxEngine::_CreateDeviceResources(const bool createSwapChain) noexcept
             THROW_HR(E_NOTIMPL);
         }
 
-        // With a new swap chain, mark the entire thing as invalid.
+        // Only ever queue up one frame, so that what we present is never more
+        // than a refresh behind what's in the buffer.
+        ::Microsoft::WRL::ComPtr<IDXGISwapChain2> sc2;
+        RETURN_IF_FAILED(_dxgiSwapChain.As(&sc2));
+        RETURN_IF_FAILED(sc2->SetMaximumFrameLatency(1));
+        _swapChainFrameLatencyWaitable.reset(sc2->GetFrameLatencyWaitableObject());
+
+        // With a new swap chain, mark the entire thing as invalid. Nothing is in
+        // its buffers yet, so the first frame has to be presented whole.
         RETURN_IF_FAILED(InvalidateAll());
+        _presentFull = true;
 
+        RETURN_IF_FAILED(_PrepareDeviceContext());
         RETURN_IF_FAILED(_PrepareRenderTarget());
     }
 
@@ -248,34 +225,66 @@ HRESULT DxEngine::_CreateDeviceResources(const bool createSwapChain) noexcept
     return S_OK;
 }
 
+// Routine Description:
+// - Creates the Direct2D device and context that draw onto the swap chain,
+//   along with everything drawn with them that doesn't depend on the size
+//   of the swap chain: the brushes, and the glyph atlas made from them later.
+// - These last until the device does, so that resizing doesn't rebuild them.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or relevant DirectX error.
 [[nodiscard]]
-HRESULT DxEngine::_PrepareRenderTarget() noexcept
+HRESULT DxEngine::_PrepareDeviceContext() noexcept
 {
-    RETURN_IF_FAILED(_dxgiSwapChain->GetBuffer(0, IID_PPV_ARGS(&_dxgiSurface)));
-
-    D2D1_RENDER_TARGET_PROPERTIES props =
-        D2D1::RenderTargetProperties(
-            D2D1_RENDER_TARGET_TYPE_DEFAULT,
-            D2D1::PixelFormat(DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED),
-            0.0f,
-            0.0f);
+    ::Microsoft::WRL::ComPtr<IDXGIDevice> dxgiDevice;
+    RETURN_IF_FAILED(_d3dDevice.As(&dxgiDevice));
 
-    RETURN_IF_FAILED(_d2dFactory->CreateDxgiSurfaceRenderTarget(_dxgiSurface.Get(),
-                                                                &props,
-                                                                &_d2dRenderTarget));
+    RETURN_IF_FAILED(_d2dFactory->CreateDevice(dxgiDevice.Get(), &_d2dDevice));
+    RETURN_IF_FAILED(_d2dDevice->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, &_d2dDeviceContext));
+    RETURN_IF_FAILED(_d2dDeviceContext.As(&_d2dRenderTarget));
 
     _d2dRenderTarget->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
-    RETURN_IF_FAILED(_d2dRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::DarkRed),
-                                                             &_d2dBrushBackground));
 
-    RETURN_IF_FAILED(_d2dRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White),
-                                                             &_d2dBrushForeground));
+    // Pick up the colors from before the device was made (or lost) again.
+    RETURN_IF_FAILED(_brushes.Get(_d2dRenderTarget.Get(), _backgroundColor, &_d2dBrushBackground));
+    RETURN_IF_FAILED(_brushes.Get(_d2dRenderTarget.Get(), _foregroundColor, &_d2dBrushForeground));
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Points the Direct2D context at the swap chain's back buffer. This has to
+//   be done again whenever the swap chain's buffers are resized.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or relevant DirectX error.
+[[nodiscard]]
+HRESULT DxEngine::_PrepareRenderTarget() noexcept
+{
+    ::Microsoft::WRL::ComPtr<IDXGISurface> dxgiSurface;
+    RETURN_IF_FAILED(_dxgiSwapChain->GetBuffer(0, IID_PPV_ARGS(&dxgiSurface)));
+
+    // For HWND swap chains, the font is sized for the DPI instead, so a pixel
+    // is a pixel. Composition swap chains are drawn at the DPI (see below).
+    const auto fdpi = _chainMode == SwapChainMode::ForComposition ? static_cast<float>(_dpi) : static_cast<float>(USER_DEFAULT_SCREEN_DPI);
+
+    const D2D1_BITMAP_PROPERTIES1 props =
+        D2D1::BitmapProperties1(D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+                                D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+                                fdpi,
+                                fdpi);
+
+    RETURN_IF_FAILED(_d2dDeviceContext->CreateBitmapFromDxgiSurface(dxgiSurface.Get(),
+                                                                     &props,
+                                                                     &_d2dTargetBitmap));
+    _d2dDeviceContext->SetTarget(_d2dTargetBitmap.Get());
+    _d2dRenderTarget->SetDpi(fdpi, fdpi);
 
     // If in composition mode, apply scaling factor matrix
     if (_chainMode == SwapChainMode::ForComposition)
     {
-        const auto fdpi = static_cast<float>(_dpi);
-        _d2dRenderTarget->SetDpi(fdpi, fdpi);
 
         DXGI_MATRIX_3X2_F inverseScale = { 0 };
         inverseScale._11 = 1.0f / _scale;
@@ -296,20 +305,51 @@ HRESULT DxEngine::_PrepareRenderTarget() noexcept
 // - <none>
 // Return Value:
 // - <none>
+// Routine Description:
+// - Lets go of the swap chain's back buffer, so that it can be resized. The
+//   Direct2D context and everything made with it are kept.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void DxEngine::_ReleaseRenderTarget() noexcept
+{
+    if (_d2dDeviceContext)
+    {
+        _d2dDeviceContext->SetTarget(nullptr);
+    }
+    _d2dTargetBitmap.Reset();
+}
+
+// Routine Description:
+// - Releases device-specific resources (typically held on the GPU)
+// - What doesn't depend on the device, like the fonts, the shaped text and
+//   the DXGI factory, is kept, so that a new device is quick to get going.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
 void DxEngine::_ReleaseDeviceResources() noexcept
 {
     _haveDeviceResources = false;
+    _glyphAtlas.Reset();
     _d2dBrushForeground.Reset();
     _d2dBrushBackground.Reset();
+    _brushes.Clear();
 
     if (nullptr != _d2dRenderTarget.Get() && _isPainting)
     {
         _d2dRenderTarget->EndDraw();
     }
 
+    _d2dFrameCommands.Reset();
+    _d2dFrameTarget.Reset();
+    _ReleaseRenderTarget();
+    _d2dDeviceContext.Reset();
     _d2dRenderTarget.Reset();
+    _d2dDevice.Reset();
 
-    _dxgiSurface.Reset();
+    _swapChainFrameLatencyWaitable.reset();
     _dxgiSwapChain.Reset();
     _dxgiOutput.Reset();
 
@@ -317,6 +357,7 @@ void DxEngine::_ReleaseDeviceResources() noexcept
     {
         // To ensure the swap chain goes away we must unbind any views from the
         // D3D pipeline
+        const SharedResources::DeviceLock lock{ _d2dFactory.Get() };
         _d3dDeviceContext->OMSetRenderTargets(0, nullptr, nullptr);
     }
     _d3dDeviceContext.Reset();
@@ -324,7 +365,6 @@ void DxEngine::_ReleaseDeviceResources() noexcept
     _d3dDevice.Reset();
 
     _dxgiAdapter1.Reset();
-    _dxgiFactory2.Reset();
 }
 
 // Routine Description:
@@ -682,7 +722,6 @@ HRESULT DxEngine::PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept
 [[nodiscard]]
 HRESULT DxEngine::StartPaint() noexcept
 {
-    FAIL_FAST_IF_FAILED(InvalidateAll());
     RETURN_HR_IF(E_NOT_VALID_STATE, _isPainting); // invalid to start a paint while painting.
 
     if (_isEnabled) {
@@ -694,13 +733,61 @@ HRESULT DxEngine::StartPaint() noexcept
         else if (_displaySizePixels.cy != clientSize.cy ||
                  _displaySizePixels.cx != clientSize.cx)
         {
-            _dxgiSurface.Reset();
-            _d2dRenderTarget.Reset();
-            _dxgiSwapChain->ResizeBuffers(2, clientSize.cx, clientSize.cy, DXGI_FORMAT_B8G8R8A8_UNORM, 0);
-            RETURN_IF_FAILED(_PrepareRenderTarget());
+            // Only the buffers change size. The device, the context, the
+            // brushes and the glyph atlas all stay as they are.
+            _ReleaseRenderTarget();
+            const auto hr = [&]() {
+                const SharedResources::DeviceLock lock{ _d2dFactory.Get() };
+                return _dxgiSwapChain->ResizeBuffers(2, clientSize.cx, clientSize.cy, DXGI_FORMAT_B8G8R8A8_UNORM, s_SwapChainFlags);
+            }();
+            if (s_IsDeviceLost(hr))
+            {
+                RETURN_IF_FAILED(_CreateDeviceResources(true));
+            }
+            else
+            {
+                RETURN_IF_FAILED(hr);
+                RETURN_IF_FAILED(_PrepareRenderTarget());
+            }
             _displaySizePixels = clientSize;
+
+            // The resized buffers hold nothing we drew.
+            _presentFull = true;
+        }
+
+        if (_presentFull)
+        {
+            RETURN_IF_FAILED(InvalidateAll());
+        }
+        else if (_invalidScroll.cx != 0 || _invalidScroll.cy != 0)
+        {
+            // The back buffer holds what was last presented. Move the part that
+            // scrolled, so only what the scroll uncovered has to be painted.
+            const auto scroll = _GetScrollRect();
+            if (!IsRectEmpty(&scroll))
+            {
+                RECT source = scroll;
+                OffsetRect(&source, -_invalidScroll.cx, -_invalidScroll.cy);
+                RETURN_IF_FAILED(_CopyFrontToBack(source, { scroll.left, scroll.top }));
+            }
         }
 
+        // The atlas is made to go with the back buffer, so it has to be ready
+        // before the frame starts being recorded.
+        DWRITE_LINE_SPACING spacing;
+        RETURN_IF_FAILED(_dwriteTextFormat->GetLineSpacing(&spacing));
+        LOG_IF_FAILED(_glyphAtlas.Prepare(_d2dRenderTarget.Get(),
+                                          D2D1::SizeF(gsl::narrow<FLOAT>(_glyphCell.cx), gsl::narrow<FLOAT>(_glyphCell.cy)),
+                                          spacing.baseline));
+
+        // Everything but the backgrounds is recorded into a command list while
+        // the frame is painted. The backgrounds are collected instead, so that
+        // EndPaint can fill all of them at once, underneath everything else.
+        RETURN_IF_FAILED(_d2dDeviceContext->CreateCommandList(&_d2dFrameCommands));
+        _d2dDeviceContext->GetTarget(&_d2dFrameTarget);
+        _d2dDeviceContext->SetTarget(_d2dFrameCommands.Get());
+        _backgrounds.Clear();
+
         _d2dRenderTarget->BeginDraw();
         _isPainting = true;
     }
@@ -708,6 +795,47 @@ HRESULT DxEngine::StartPaint() noexcept
     return S_OK;
 }
 
+// Routine Description:
+// - Puts the frame that's been painted onto the back buffer: first the
+//   backgrounds, all at once, then everything that was recorded on top.
+// - Everything outside of what's invalid is already right in the back buffer,
+//   so nothing is drawn over it.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or relevant DirectX error.
+[[nodiscard]]
+HRESULT DxEngine::_DrawFrame() noexcept
+{
+    auto releaseOnExit = wil::scope_exit([&]() noexcept {
+        _d2dFrameCommands.Reset();
+        _d2dFrameTarget.Reset();
+    });
+
+    RETURN_HR_IF_NULL(E_NOT_VALID_STATE, _d2dFrameCommands.Get());
+
+    _d2dDeviceContext->SetTarget(_d2dFrameTarget.Get());
+    RETURN_IF_FAILED(_d2dFrameCommands->Close());
+
+    _d2dRenderTarget->PushAxisAlignedClip(D2D1::RectF(static_cast<float>(_invalidRect.left),
+                                                      static_cast<float>(_invalidRect.top),
+                                                      static_cast<float>(_invalidRect.right),
+                                                      static_cast<float>(_invalidRect.bottom)),
+                                          D2D1_ANTIALIAS_MODE_ALIASED);
+    auto popClipOnExit = wil::scope_exit([&]() noexcept {
+        _d2dRenderTarget->PopAxisAlignedClip();
+    });
+
+    D2D1_COLOR_F nothing = { 0 };
+    _d2dRenderTarget->Clear(nothing);
+
+    RETURN_IF_FAILED(_backgrounds.Fill(_d2dRenderTarget.Get(), _brushes));
+
+    _d2dDeviceContext->DrawImage(_d2dFrameCommands.Get());
+
+    return S_OK;
+}
+
 // Routine Description:
 // - Ends batch drawing and captures any state necessary for presentation
 // Arguments:
@@ -724,38 +852,50 @@ HRESULT DxEngine::EndPaint() noexcept
     if (_haveDeviceResources) {
         _isPainting = false;
 
+        LOG_IF_FAILED(_DrawFrame());
         hr = _d2dRenderTarget->EndDraw();
 
         if (SUCCEEDED(hr)) {
 
-            if (_invalidScroll.cy != 0 || _invalidScroll.cx != 0)
-            {
-                _presentDirty = _invalidRect;
-
-                RECT display = _GetDisplayRect();
-                SubtractRect(&_presentScroll, &display, &_presentDirty);
-                _presentOffset.x = _invalidScroll.cx;
-                _presentOffset.y = _invalidScroll.cy;
+            // Tell DXGI only what changed, so that DWM only has to compose that.
+            // The first frame in a swap chain has to be presented whole.
+            _presentParams = { 0 };
+            _presentDirty = _invalidRect;
+            _presentScroll = { 0 };
+            _presentOffset = { 0 };
 
+            if (!_presentFull)
+            {
                 _presentParams.DirtyRectsCount = 1;
                 _presentParams.pDirtyRects = &_presentDirty;
 
-                _presentParams.pScrollOffset = &_presentOffset;
-                _presentParams.pScrollRect = &_presentScroll;
-
-                if (IsRectEmpty(&_presentScroll))
+                if (_invalidScroll.cy != 0 || _invalidScroll.cx != 0)
                 {
-                    _presentParams.pScrollRect = nullptr;
-                    _presentParams.pScrollOffset = nullptr;
+                    _presentScroll = _GetScrollRect();
+                    _presentOffset.x = _invalidScroll.cx;
+                    _presentOffset.y = _invalidScroll.cy;
+
+                    if (!IsRectEmpty(&_presentScroll))
+                    {
+                        _presentParams.pScrollRect = &_presentScroll;
+                        _presentParams.pScrollOffset = &_presentOffset;
+                    }
                 }
             }
 
-            _presentReady = true;
+            // If nothing changed, there's nothing to show.
+            _presentReady = _presentFull || !IsRectEmpty(&_presentDirty);
         }
         else
         {
             _presentReady = false;
             _ReleaseDeviceResources();
+
+            // The device is made again at the next frame, which is painted whole.
+            if (s_IsDeviceLost(hr))
+            {
+                hr = S_OK;
+            }
         }
     }
 
@@ -768,15 +908,16 @@ HRESULT DxEngine::EndPaint() noexcept
 }
 
 // Routine Description:
-// - Copies the front surface of the swap chain (the one being displayed)
+// - Copies part of the front surface of the swap chain (the one being displayed)
 //   to the back surface of the swap chain (the one we draw on next)
 //   so we can draw on top of what's already there.
 // Arguments:
-// - <none>
+// - source - The pixels of the front surface to copy
+// - destination - Where the top left corner of them goes in the back surface
 // Return Value:
 // - Any DirectX error, a memory error, etc.
 [[nodiscard]]
-HRESULT DxEngine::_CopyFrontToBack() noexcept
+HRESULT DxEngine::_CopyFrontToBack(const RECT source, const POINT destination) noexcept
 {
     Microsoft::WRL::ComPtr<ID3D11Resource> backBuffer;
     Microsoft::WRL::ComPtr<ID3D11Resource> frontBuffer;
@@ -784,11 +925,46 @@ HRESULT DxEngine::_CopyFrontToBack() noexcept
     RETURN_IF_FAILED(_dxgiSwapChain->GetBuffer(0, IID_PPV_ARGS(&backBuffer)));
     RETURN_IF_FAILED(_dxgiSwapChain->GetBuffer(1, IID_PPV_ARGS(&frontBuffer)));
 
-    _d3dDeviceContext->CopyResource(backBuffer.Get(), frontBuffer.Get());
+    D3D11_BOX box;
+    box.left = gsl::narrow_cast<UINT>(source.left);
+    box.top = gsl::narrow_cast<UINT>(source.top);
+    box.right = gsl::narrow_cast<UINT>(source.right);
+    box.bottom = gsl::narrow_cast<UINT>(source.bottom);
+    box.front = 0;
+    box.back = 1;
+
+    const SharedResources::DeviceLock lock{ _d2dFactory.Get() };
+    _d3dDeviceContext->CopySubresourceRegion(backBuffer.Get(),
+                                             0,
+                                             gsl::narrow_cast<UINT>(destination.x),
+                                             gsl::narrow_cast<UINT>(destination.y),
+                                             0,
+                                             frontBuffer.Get(),
+                                             0,
+                                             &box);
 
     return S_OK;
 }
 
+// Routine Description:
+// - Gets the part of the display that's been scrolled since the last frame,
+//   where it is now. Anything in it only moved, and doesn't need to be painted.
+// Arguments:
+// - <none>
+// Return Value:
+// - The scrolled pixels, or an empty rectangle if everything scrolled away.
+[[nodiscard]]
+RECT DxEngine::_GetScrollRect() const noexcept
+{
+    const RECT display = _GetDisplayRect();
+    RECT moved = display;
+    OffsetRect(&moved, _invalidScroll.cx, _invalidScroll.cy);
+
+    RECT scroll;
+    IntersectRect(&scroll, &moved, &display);
+    return scroll;
+}
+
 // Routine Description:
 // - Takes queued drawing information and presents it to the screen.
 // - This is separated out so it can be done outside the lock as it's expensive.
@@ -801,11 +977,38 @@ HRESULT DxEngine::Present() noexcept
 {
     if (_presentReady)
     {
-        FAIL_FAST_IF_FAILED(_dxgiSwapChain->Present(1, 0));
-        /*FAIL_FAST_IF_FAILED(_dxgiSwapChain->Present1(1, 0, &_presentParams));*/
+        const auto hr = [&]() {
+            const SharedResources::DeviceLock lock{ _d2dFactory.Get() };
+            return _dxgiSwapChain->Present1(1, 0, &_presentParams);
+        }();
+        if (s_IsDeviceLost(hr))
+        {
+            // The driver was reset or the adapter went away. Only the device
+            // is made again, at the next frame, which is painted whole.
+            _presentReady = false;
+            _ReleaseDeviceResources();
+            return S_OK;
+        }
+        FAIL_FAST_IF_FAILED(hr);
+
+        // The back buffer is now the frame before the one we just presented.
+        // Bring what changed in between over, so that it matches what's on
+        // the screen and the next frame only has to paint what it changes.
+        if (_presentParams.DirtyRectsCount == 0)
+        {
+            RETURN_IF_FAILED(_CopyFrontToBack(_GetDisplayRect(), { 0, 0 }));
+        }
+        else
+        {
+            RETURN_IF_FAILED(_CopyFrontToBack(_presentDirty, { _presentDirty.left, _presentDirty.top }));
+            if (_presentParams.pScrollRect)
+            {
+                RETURN_IF_FAILED(_CopyFrontToBack(_presentScroll, { _presentScroll.left, _presentScroll.top }));
+            }
+        }
 
-        RETURN_IF_FAILED(_CopyFrontToBack());
         _presentReady = false;
+        _presentFull = false;
 
         _presentDirty = { 0 };
         _presentOffset = { 0 };
@@ -816,6 +1019,29 @@ HRESULT DxEngine::Present() noexcept
     return S_OK;
 }
 
+// Routine Description:
+// - Waits until the swap chain can take another frame, so that the next frame
+//   is painted from the newest data there is, right before it's needed. When
+//   nothing is queued up, this returns right away.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK once we've waited, S_FALSE if there's no swap chain to wait on yet.
+[[nodiscard]]
+HRESULT DxEngine::WaitUntilCanRender() noexcept
+{
+    if (!_swapChainFrameLatencyWaitable)
+    {
+        return S_FALSE;
+    }
+
+    // Don't hang the render thread on a swap chain that's stopped presenting
+    // (say, the window's been minimized): give up after a second.
+    const auto wait = WaitForSingleObjectEx(_swapChainFrameLatencyWaitable.get(), 1000, TRUE);
+    RETURN_LAST_ERROR_IF(wait == WAIT_FAILED);
+    return S_OK;
+}
+
 // Routine Description:
 // - This is currently unused.
 // Arguments:
@@ -830,6 +1056,7 @@ HRESULT DxEngine::ScrollFrame() noexcept
 
 // Routine Description:
 // - This paints in the back most layer of the frame with the background color.
+// - This happens in _DrawFrame instead.
 // Arguments:
 // - <none>
 // Return Value:
@@ -837,17 +1064,9 @@ HRESULT DxEngine::ScrollFrame() noexcept
 [[nodiscard]]
 HRESULT DxEngine::PaintBackground() noexcept
 {
-    /*_d2dRenderTarget->FillRectangle(D2D1::RectF((float)_invalidRect.left,
-                                                  (float)_invalidRect.top,
-                                                  (float)_invalidRect.right,
-                                                  (float)_invalidRect.bottom),
-                                                   _d2dBrushBackground.Get());
-*/
-
-    D2D1_COLOR_F nothing = { 0 };
-
-    _d2dRenderTarget->Clear(nothing);
-
+    // What's invalid is cleared when the frame is drawn onto the back buffer
+    // at EndPaint, underneath the backgrounds. It can't be recorded with the
+    // rest of the frame: a clear drawn from a command list covers nothing.
     return S_OK;
 }
 
@@ -871,14 +1090,6 @@ HRESULT DxEngine::PaintBufferLine(std::basic_string_view<Cluster> const clusters
         origin.x = static_cast<float>(coord.X * _glyphCell.cx);
         origin.y = static_cast<float>(coord.Y * _glyphCell.cy);
 
-        // Create the text layout
-        CustomTextLayout layout(_dwriteFactory.Get(),
-                                _dwriteTextAnalyzer.Get(),
-                                _dwriteTextFormat.Get(),
-                                _dwriteFontFace.Get(),
-                                clusters,
-                                _glyphCell.cx);
-
         // Get the baseline for this font as that's where we draw from
         DWRITE_LINE_SPACING spacing;
         RETURN_IF_FAILED(_dwriteTextFormat->GetLineSpacing(&spacing));
@@ -891,6 +1102,28 @@ HRESULT DxEngine::PaintBufferLine(std::basic_string_view<Cluster> const clusters
                                spacing,
                                D2D1::SizeF(gsl::narrow<FLOAT>(_glyphCell.cx), gsl::narrow<FLOAT>(_glyphCell.cy)),
                                D2D1_DRAW_TEXT_OPTIONS_ENABLE_COLOR_FONT);
+        context.glyphAtlas = &_glyphAtlas;
+        context.backgrounds = &_backgrounds;
+        context.backgroundColor = _backgroundColor;
+        context.brushes = &_brushes;
+
+        // Plain ASCII doesn't need to be shaped at all.
+        const auto hr = _PaintAsciiBufferLine(clusters, origin, context);
+        RETURN_IF_FAILED(hr);
+        if (hr == S_OK)
+        {
+            return S_OK;
+        }
+
+        // Create the text layout
+        CustomTextLayout layout(_dwriteFactory.Get(),
+                                _dwriteTextAnalyzer.Get(),
+                                _dwriteTextFormat.Get(),
+                                _dwriteFontFace.Get(),
+                                clusters,
+                                _glyphCell.cx,
+                                &_shapedTextCache,
+                                &_fontFallbackCache);
 
         // Layout then render the text
         RETURN_IF_FAILED(layout.Draw(&context, _customRenderer.Get(), origin.x, origin.y));
@@ -900,6 +1133,136 @@ HRESULT DxEngine::PaintBufferLine(std::basic_string_view<Cluster> const clusters
     return S_OK;
 }
 
+// Routine Description:
+// - Draws a run of text that's all printable ASCII, one column per character, in
+//   the primary font, without any shaping. Each character's glyph comes from the
+//   table built when the font was chosen, and gets exactly one cell.
+// Arguments:
+// - clusters - The text to draw
+// - origin - Where the top left corner of the run goes
+// - context - How to draw it
+// Return Value:
+// - S_OK if the run was drawn, S_FALSE if it needs to be shaped instead, or the
+//   relevant DirectX error.
+[[nodiscard]]
+HRESULT DxEngine::_PaintAsciiBufferLine(std::basic_string_view<Cluster> const clusters,
+                                        const D2D1_POINT_2F origin,
+                                        DrawingContext& context) noexcept
+{
+    try
+    {
+        for (const auto& cluster : clusters)
+        {
+            const auto& text = cluster.GetText();
+            if (text.size() != 1 ||
+                cluster.GetColumns() != 1 ||
+                text.front() < s_firstAsciiGlyph ||
+                text.front() > s_lastAsciiGlyph ||
+                _asciiGlyphIndices.at(text.front() - s_firstAsciiGlyph) == 0)
+            {
+                return S_FALSE;
+            }
+        }
+
+        const auto count = clusters.size();
+        _asciiText.resize(count);
+        _asciiIndices.resize(count);
+        _asciiAdvances.resize(count);
+        _asciiOffsets.resize(count);
+        _asciiClusters.resize(count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto ch = clusters.at(i).GetTextAsSingle();
+            const auto entry = gsl::narrow_cast<size_t>(ch - s_firstAsciiGlyph);
+
+            _asciiText.at(i) = ch;
+            _asciiIndices.at(i) = _asciiGlyphIndices.at(entry);
+            _asciiAdvances.at(i) = static_cast<float>(_glyphCell.cx);
+            _asciiOffsets.at(i) = { _asciiGlyphOffsets.at(entry), 0.0f };
+            _asciiClusters.at(i) = gsl::narrow_cast<UINT16>(i);
+        }
+
+        wchar_t localeName[LOCALE_NAME_MAX_LENGTH];
+        RETURN_IF_FAILED(_dwriteTextFormat->GetLocaleName(localeName, ARRAYSIZE(localeName)));
+
+        DWRITE_GLYPH_RUN glyphRun = { 0 };
+        glyphRun.fontEmSize = _dwriteTextFormat->GetFontSize();
+        glyphRun.fontFace = _dwriteFontFace.Get();
+        glyphRun.glyphAdvances = _asciiAdvances.data();
+        glyphRun.glyphCount = gsl::narrow<UINT32>(count);
+        glyphRun.glyphIndices = _asciiIndices.data();
+        glyphRun.glyphOffsets = _asciiOffsets.data();
+
+        DWRITE_GLYPH_RUN_DESCRIPTION glyphRunDescription = { 0 };
+        glyphRunDescription.clusterMap = _asciiClusters.data();
+        glyphRunDescription.localeName = localeName;
+        glyphRunDescription.string = _asciiText.data();
+        glyphRunDescription.stringLength = gsl::narrow<UINT32>(count);
+
+        RETURN_IF_FAILED(_customRenderer->DrawGlyphRun(&context,
+                                                       origin.x,
+                                                       origin.y,
+                                                       DWRITE_MEASURING_MODE_NATURAL,
+                                                       &glyphRun,
+                                                       &glyphRunDescription,
+                                                       nullptr));
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Looks up the glyph for each printable ASCII character in the primary font,
+//   and how far it has to be moved over to be centered in its cell, so that
+//   _PaintAsciiBufferLine doesn't need to ask DirectWrite.
+// - Characters that aren't in the font, or that are too wide for a cell and
+//   would have to be shrunk, are left out and get shaped like everything else.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or relevant DirectWrite error
+[[nodiscard]]
+HRESULT DxEngine::_BuildAsciiGlyphTable() noexcept
+{
+    _asciiGlyphIndices.fill(0);
+    _asciiGlyphOffsets.fill(0.0f);
+
+    RETURN_HR_IF_NULL(E_NOT_VALID_STATE, _dwriteFontFace.Get());
+    RETURN_HR_IF_NULL(E_NOT_VALID_STATE, _dwriteTextFormat.Get());
+
+    std::array<UINT32, s_lastAsciiGlyph - s_firstAsciiGlyph + 1> codePoints;
+    std::iota(codePoints.begin(), codePoints.end(), static_cast<UINT32>(s_firstAsciiGlyph));
+
+    decltype(_asciiGlyphIndices) indices{};
+    RETURN_IF_FAILED(_dwriteFontFace->GetGlyphIndicesW(codePoints.data(), gsl::narrow<UINT32>(codePoints.size()), indices.data()));
+
+    std::array<DWRITE_GLYPH_METRICS, s_lastAsciiGlyph - s_firstAsciiGlyph + 1> metrics;
+    RETURN_IF_FAILED(_dwriteFontFace->GetDesignGlyphMetrics(indices.data(), gsl::narrow<UINT32>(indices.size()), metrics.data(), false));
+
+    DWRITE_FONT_METRICS fontMetrics;
+    _dwriteFontFace->GetMetrics(&fontMetrics);
+
+    const auto scale = _dwriteTextFormat->GetFontSize() / fontMetrics.designUnitsPerEm;
+    const auto cellWidth = static_cast<float>(_glyphCell.cx);
+
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        const auto advance = metrics.at(i).advanceWidth * scale;
+
+        // CustomTextLayout would shrink a glyph that's wider than its cell, so
+        // those are left for it to do.
+        if (indices.at(i) != 0 && advance <= cellWidth)
+        {
+            _asciiGlyphIndices.at(i) = indices.at(i);
+            _asciiGlyphOffsets.at(i) = (cellWidth - advance) / 2;
+        }
+    }
+
+    return S_OK;
+}
+
 // Routine Description:
 // - Paints lines around cells (draws in pieces of the grid)
 // Arguments:
@@ -916,10 +1279,8 @@ HRESULT DxEngine::PaintBufferGridLines(GridLines const lines,
                                        size_t const cchLine,
                                        COORD const coordTarget) noexcept
 {
-    const auto existingColor = _d2dBrushForeground->GetColor();
-    const auto restoreBrushOnExit = wil::scope_exit([&] {_d2dBrushForeground->SetColor(existingColor); });
-
-    _d2dBrushForeground->SetColor(D2D1::ColorF(color));
+    ::Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> brush;
+    RETURN_IF_FAILED(_brushes.Get(_d2dRenderTarget.Get(), D2D1::ColorF(color), &brush));
 
     const auto font = _GetFontSize();
     D2D_POINT_2F target;
@@ -938,7 +1299,7 @@ HRESULT DxEngine::PaintBufferGridLines(GridLines const lines,
             end = start;
             end.x += font.X;
 
-            _d2dRenderTarget->DrawLine(start, end, _d2dBrushForeground.Get());
+            _d2dRenderTarget->DrawLine(start, end, brush.Get());
         }
 
         if (lines & GridLines::Left)
@@ -946,7 +1307,7 @@ HRESULT DxEngine::PaintBufferGridLines(GridLines const lines,
             end = start;
             end.y += font.Y;
 
-            _d2dRenderTarget->DrawLine(start, end, _d2dBrushForeground.Get());
+            _d2dRenderTarget->DrawLine(start, end, brush.Get());
         }
 
         // NOTE: Watch out for inclusive/exclusive rectangles here.
@@ -964,7 +1325,7 @@ HRESULT DxEngine::PaintBufferGridLines(GridLines const lines,
             end = start;
             end.x += font.X;
 
-            _d2dRenderTarget->DrawLine(start, end, _d2dBrushForeground.Get());
+            _d2dRenderTarget->DrawLine(start, end, brush.Get());
         }
 
         start = target;
@@ -975,7 +1336,7 @@ HRESULT DxEngine::PaintBufferGridLines(GridLines const lines,
             end = start;
             end.y += font.Y;
 
-            _d2dRenderTarget->DrawLine(start, end, _d2dBrushForeground.Get());
+            _d2dRenderTarget->DrawLine(start, end, brush.Get());
         }
 
         // Move to the next character in this run.
@@ -994,14 +1355,13 @@ HRESULT DxEngine::PaintBufferGridLines(GridLines const lines,
 [[nodiscard]]
 HRESULT DxEngine::PaintSelection(const SMALL_RECT rect) noexcept
 {
-    const auto existingColor = _d2dBrushForeground->GetColor();
     const auto selectionColor = D2D1::ColorF(_defaultForegroundColor.r,
                                              _defaultForegroundColor.g,
                                              _defaultForegroundColor.b,
                                              0.5f);
 
-    _d2dBrushForeground->SetColor(selectionColor);
-    const auto resetColorOnExit = wil::scope_exit([&] {_d2dBrushForeground->SetColor(existingColor); });
+    ::Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> brush;
+    RETURN_IF_FAILED(_brushes.Get(_d2dRenderTarget.Get(), selectionColor, &brush));
 
     RECT pixels;
     pixels.left = rect.Left * _glyphCell.cx;
@@ -1015,7 +1375,7 @@ HRESULT DxEngine::PaintSelection(const SMALL_RECT rect) noexcept
     draw.right = static_cast<float>(pixels.right);
     draw.bottom = static_cast<float>(pixels.bottom);
 
-    _d2dRenderTarget->FillRectangle(draw, _d2dBrushForeground.Get());
+    _d2dRenderTarget->FillRectangle(draw, brush.Get());
 
     return S_OK;
 }
@@ -1098,7 +1458,7 @@ HRESULT DxEngine::PaintCursor(const IRenderEngine::CursorOptions& options) noexc
     if (options.fUseColor)
     {
         // Make sure to make the cursor opaque
-        RETURN_IF_FAILED(_d2dRenderTarget->CreateSolidColorBrush(_ColorFFromColorRef(OPACITY_OPAQUE | options.cursorColor), &brush));
+        RETURN_IF_FAILED(_brushes.Get(_d2dRenderTarget.Get(), _ColorFFromColorRef(OPACITY_OPAQUE | options.cursorColor), &brush));
     }
 
     switch (paintType)
@@ -1140,8 +1500,13 @@ HRESULT DxEngine::UpdateDrawingBrushes(COLORREF const colorForeground,
     _foregroundColor = _ColorFFromColorRef(colorForeground);
     _backgroundColor = _ColorFFromColorRef(colorBackground);
 
-    _d2dBrushForeground->SetColor(_foregroundColor);
-    _d2dBrushBackground->SetColor(_backgroundColor);
+    // Switch to the brushes for these colors, rather than recoloring the
+    // ones that the runs painted so far are still waiting to be drawn with.
+    if (_d2dRenderTarget)
+    {
+        RETURN_IF_FAILED(_brushes.Get(_d2dRenderTarget.Get(), _foregroundColor, &_d2dBrushForeground));
+        RETURN_IF_FAILED(_brushes.Get(_d2dRenderTarget.Get(), _backgroundColor, &_d2dBrushBackground));
+    }
 
     // If this flag is set, then we need to update the default brushes too and the swap chain background.
     if (isSettingDefaultBrushes)
@@ -1171,6 +1536,9 @@ HRESULT DxEngine::UpdateDrawingBrushes(COLORREF const colorForeground,
 [[nodiscard]]
 HRESULT DxEngine::UpdateFont(const FontInfoDesired& pfiFontInfoDesired, FontInfo& fiFontInfo) noexcept
 {
+    const auto previousFormat = _dwriteTextFormat;
+    const auto previousCell = _glyphCell;
+
     const auto hr = _GetProposedFont(pfiFontInfoDesired,
                                      fiFontInfo,
                                      _dpi,
@@ -1183,6 +1551,32 @@ HRESULT DxEngine::UpdateFont(const FontInfoDesired& pfiFontInfoDesired, FontInfo
     _glyphCell.cx = size.X;
     _glyphCell.cy = size.Y;
 
+    // The fonts are cached, so the same font comes back as the same format,
+    // and everything made for it can be kept.
+    if (SUCCEEDED(hr) &&
+        previousFormat &&
+        previousFormat == _dwriteTextFormat &&
+        previousCell.cx == _glyphCell.cx &&
+        previousCell.cy == _glyphCell.cy)
+    {
+        return hr;
+    }
+
+    // The glyphs in the atlas were rasterized, the text in the cache was
+    // shaped, and the fallback fonts were picked, for the old font.
+    _glyphAtlas.Reset();
+    _shapedTextCache.Clear();
+    _fontFallbackCache.Clear();
+    if (SUCCEEDED(hr))
+    {
+        LOG_IF_FAILED(_BuildAsciiGlyphTable());
+        try
+        {
+            _glyphWidthCache.SetFace(fiFontInfo.GetFaceName());
+        }
+        CATCH_LOG();
+    }
+
     return hr;
 }
 
@@ -1204,11 +1598,20 @@ Viewport DxEngine::GetViewportInCharacters(const Viewport& viewInPixels) noexcep
 [[nodiscard]]
 HRESULT DxEngine::UpdateDpi(int const iDpi) noexcept
 {
+    // Moving to another display with the same DPI doesn't change what's drawn.
+    if (iDpi == _dpi)
+    {
+        return S_OK;
+    }
+
     _dpi = iDpi;
 
     // The scale factor may be necessary for composition contexts, so save it once here.
     _scale = _dpi / static_cast<float>(USER_DEFAULT_SCREEN_DPI);
 
+    _glyphAtlas.Reset();
+    _shapedTextCache.Clear();
+
     RETURN_IF_FAILED(InvalidateAll());
 
     return S_OK;
@@ -1273,11 +1676,13 @@ HRESULT DxEngine::GetProposedFont(const FontInfoDesired& pfiFontInfoDesired,
 [[nodiscard]]
 SMALL_RECT DxEngine::GetDirtyRectInChars() noexcept
 {
+    // Only what's invalid is drawn, so a cell that's only partly invalid still
+    // has to be painted whole.
     SMALL_RECT r;
     r.Top = (SHORT)(floor(_invalidRect.top / _glyphCell.cy));
     r.Left = (SHORT)(floor(_invalidRect.left / _glyphCell.cx));
-    r.Bottom = (SHORT)(floor(_invalidRect.bottom / _glyphCell.cy));
-    r.Right = (SHORT)(floor(_invalidRect.right / _glyphCell.cx));
+    r.Bottom = (SHORT)((_invalidRect.bottom + _glyphCell.cy - 1) / _glyphCell.cy);
+    r.Right = (SHORT)((_invalidRect.right + _glyphCell.cx - 1) / _glyphCell.cx);
 
     // Exclusive to inclusive
     r.Bottom--;
@@ -1313,7 +1718,8 @@ HRESULT DxEngine::GetFontSize(_Out_ COORD* const pFontSize) noexcept
 }
 
 // Routine Description:
-// - Currently unused by this renderer.
+// - Works out whether a glyph takes two columns in the current font, by laying it
+//   out. Glyphs of one codepoint are only laid out the first time they're asked about.
 // Arguments:
 // - glyph - The glyph run to process for column width.
 // - pResult - True if it should take two columns. False if it should take one.
@@ -1322,6 +1728,13 @@ HRESULT DxEngine::GetFontSize(_Out_ COORD* const pFontSize) noexcept
 [[nodiscard]]
 HRESULT DxEngine::IsGlyphWideByFont(const std::wstring_view glyph, _Out_ bool* const pResult) noexcept
 {
+    const auto cached = _glyphWidthCache.Find(glyph);
+    if (cached.has_value())
+    {
+        *pResult = cached.value();
+        return S_OK;
+    }
+
     Cluster cluster(glyph, 0); // columns don't matter, we're doing analysis not layout.
 
     // Create the text layout
@@ -1330,16 +1743,41 @@ HRESULT DxEngine::IsGlyphWideByFont(const std::wstring_view glyph, _Out_ bool* c
         _dwriteTextFormat.Get(),
         _dwriteFontFace.Get(),
         { &cluster, 1 },
-        _glyphCell.cx);
+        _glyphCell.cx,
+        nullptr,
+        &_fontFallbackCache);
 
     UINT32 columns = 0;
     RETURN_IF_FAILED(layout.GetColumns(&columns));
 
     *pResult = columns != 1;
-    
+
+    try
+    {
+        _glyphWidthCache.Store(glyph, *pResult);
+    }
+    CATCH_LOG();
+
     return S_OK;
 }
 
+// Routine Description:
+// - Adds up what the engine's caches are holding: the glyph atlas, the shaped
+//   text, the fallback fonts, the brushes and the glyph widths.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of the caches.
+Microsoft::Console::Types::MemoryUsage DxEngine::GetCacheMemoryUsage() const noexcept
+{
+    auto usage = _glyphAtlas.MeasureMemory();
+    usage += _shapedTextCache.MeasureMemory();
+    usage += _fontFallbackCache.MeasureMemory();
+    usage += _brushes.MeasureMemory();
+    usage += _glyphWidthCache.MeasureMemory();
+    return usage;
+}
+
 // Method Description:
 // - Updates the window's title string.
 // Arguments:
@@ -1352,47 +1790,6 @@ HRESULT DxEngine::_DoUpdateTitle(_In_ const std::wstring& /*newTitle*/) noexcept
     return PostMessageW(_hwndTarget, CM_UPDATE_TITLE, 0, (LPARAM)nullptr) ? S_OK : E_FAIL;
 }
 
-// Routine Description:
-// - Locates a suitable font face from the given information
-// Arguments:
-// - familyName - The font name we should be looking for
-// - weight - The weight (bold, light, etc.)
-// - stretch - The stretch of the font is the spacing between each letter
-// - style - Normal, italic, etc.
-// Return Value:
-// - Smart pointer holding interface reference for queryable font data.
-[[nodiscard]]
-Microsoft::WRL::ComPtr<IDWriteFontFace5> DxEngine::_FindFontFace(const std::wstring& familyName,
-                                                                 DWRITE_FONT_WEIGHT weight,
-                                                                 DWRITE_FONT_STRETCH stretch,
-                                                                 DWRITE_FONT_STYLE style) const
-{
-    Microsoft::WRL::ComPtr<IDWriteFontFace5> fontFace;
-
-    Microsoft::WRL::ComPtr<IDWriteFontCollection> fontCollection;
-    THROW_IF_FAILED(_dwriteFactory->GetSystemFontCollection(&fontCollection, false));
-
-    UINT32 familyIndex;
-    BOOL familyExists;
-    THROW_IF_FAILED(fontCollection->FindFamilyName(familyName.c_str(), &familyIndex, &familyExists));
-
-    if (familyExists)
-    {
-        Microsoft::WRL::ComPtr<IDWriteFontFamily> fontFamily;
-        THROW_IF_FAILED(fontCollection->GetFontFamily(familyIndex, &fontFamily));
-
-        Microsoft::WRL::ComPtr<IDWriteFont> font;
-        THROW_IF_FAILED(fontFamily->GetFirstMatchingFont(weight, stretch, style, &font));
-
-        Microsoft::WRL::ComPtr<IDWriteFontFace> fontFace0;
-        THROW_IF_FAILED(font->CreateFontFace(&fontFace0));
-
-        THROW_IF_FAILED(fontFace0.As(&fontFace));
-    }
-
-    return fontFace;
-}
-
 // Routine Description:
 // - Updates the font used for drawing
 // Arguments:
@@ -1409,150 +1806,30 @@ HRESULT DxEngine::_GetProposedFont(const FontInfoDesired& desired,
                                    Microsoft::WRL::ComPtr<IDWriteTextAnalyzer1>& textAnalyzer,
                                    Microsoft::WRL::ComPtr<IDWriteFontFace5>& fontFace) const noexcept
 {
-    try
-    {
-        const std::wstring fontName(desired.GetFaceName());
-        const DWRITE_FONT_WEIGHT weight = DWRITE_FONT_WEIGHT_NORMAL;
-        const DWRITE_FONT_STYLE style = DWRITE_FONT_STYLE_NORMAL;
-        const DWRITE_FONT_STRETCH stretch = DWRITE_FONT_STRETCH_NORMAL;
-
-        const auto face = _FindFontFace(fontName, weight, stretch, style);
-        THROW_IF_NULL_ALLOC_MSG(face, "Failed to find the requested font");
-
-        DWRITE_FONT_METRICS1 fontMetrics;
-        face->GetMetrics(&fontMetrics);
-
-        const UINT32 spaceCodePoint = UNICODE_SPACE;
-        UINT16 spaceGlyphIndex;
-        THROW_IF_FAILED(face->GetGlyphIndicesW(&spaceCodePoint, 1, &spaceGlyphIndex));
-
-        INT32 advanceInDesignUnits;
-        THROW_IF_FAILED(face->GetDesignGlyphAdvances(1, &spaceGlyphIndex, &advanceInDesignUnits));
-
-        // The math here is actually:
-        // Requested Size in Points * DPI scaling factor * Points to Pixels scaling factor.
-        // - DPI = dots per inch
-        // - PPI = points per inch or "points" as usually seen when choosing a font size
-        // - The DPI scaling factor is the current monitor DPI divided by 96, the default DPI.
-        // - The Points to Pixels factor is based on the typography definition of 72 points per inch.
-        //    As such, converting requires taking the 96 pixel per inch default and dividing by the 72 points per inch
-        //    to get a factor of 1 and 1/3.
-        // This turns into something like:
-        // - 12 ppi font * (96 dpi / 96 dpi) * (96 dpi / 72 points per inch) = 16 pixels tall font for 100% display (96 dpi is 100%)
-        // - 12 ppi font * (144 dpi / 96 dpi) * (96 dpi / 72 points per inch) = 24 pixels tall font for 150% display (144 dpi is 150%)
-        // - 12 ppi font * (192 dpi / 96 dpi) * (96 dpi / 72 points per inch) = 32 pixels tall font for 200% display (192 dpi is 200%)
-        float heightDesired = static_cast<float>(desired.GetEngineSize().Y) * static_cast<float>(USER_DEFAULT_SCREEN_DPI) / POINTS_PER_INCH;
-
-        // The advance is the number of pixels left-to-right (X dimension) for the given font.
-        // We're finding a proportional factor here with the design units in "ems", not an actual pixel measurement.
-
-        // For HWND swap chains, we play trickery with the font size. For others, we use inherent scaling.
-        // For composition swap chains, we scale by the DPI later during drawing and presentation.
-        if (_chainMode == SwapChainMode::ForHwnd)
-        {
-            heightDesired *= (static_cast<float>(dpi) / static_cast<float>(USER_DEFAULT_SCREEN_DPI));
-        }
-
-        const float widthAdvance = static_cast<float>(advanceInDesignUnits) / fontMetrics.designUnitsPerEm;
-
-        // Use the real pixel height desired by the "em" factor for the width to get the number of pixels
-        // we will need per character in width. This will almost certainly result in fractional X-dimension pixels.
-        const float widthApprox = heightDesired * widthAdvance;
-
-        // Since we can't deal with columns of the presentation grid being fractional pixels in width, round to the nearest whole pixel.
-        const float widthExact = round(widthApprox);
-
-        // Now reverse the "em" factor from above to turn the exact pixel width into a (probably) fractional
-        // height in pixels of each character. It's easier for us to pad out height and align vertically
-        // than it is horizontally.
-        const auto fontSize = widthExact / widthAdvance;
-
-        // Now figure out the basic properties of the character height which include ascent and descent
-        // for this specific font size.
-        const float ascent = (fontSize * fontMetrics.ascent) / fontMetrics.designUnitsPerEm;
-        const float descent = (fontSize * fontMetrics.descent) / fontMetrics.designUnitsPerEm;
-
-        // We're going to build a line spacing object here to track all of this data in our format.
-        DWRITE_LINE_SPACING lineSpacing = {};
-        lineSpacing.method = DWRITE_LINE_SPACING_METHOD_UNIFORM;
-
-        // We need to make sure the baseline falls on a round pixel (not a fractional pixel).
-        // If the baseline is fractional, the text appears blurry, especially at small scales.
-        // Since we also need to make sure the bounding box as a whole is round pixels
-        // (because the entire console system maths in full cell units),
-        // we're just going to ceiling up the ascent and descent to make a full pixel amount
-        // and set the baseline to the full round pixel ascent value.
-        //
-        // For reference, for the letters "ag":
-        // aaaaaa   ggggggg     <===================================
-        //      a   g    g            |                            |
-        //  aaaaa   ggggg             |<-ascent                    |
-        // a    a   g                 |                            |---- height
-        // aaaaa a  gggggg      <-------------------baseline       |
-        //          g     g           |<-descent                   |
-        //          gggggg      <===================================
-        //
-        const auto fullPixelAscent = ceil(ascent);
-        const auto fullPixelDescent = ceil(descent);
-        lineSpacing.height = fullPixelAscent + fullPixelDescent;
-        lineSpacing.baseline = fullPixelAscent;
-
-        // Create the font with the fractional pixel height size.
-        // It should have an integer pixel width by our math above.
-        // Then below, apply the line spacing to the format to position the floating point pixel height characters
-        // into a cell that has an integer pixel height leaving some padding above/below as necessary to round them out.
-        Microsoft::WRL::ComPtr<IDWriteTextFormat> format;
-        THROW_IF_FAILED(_dwriteFactory->CreateTextFormat(fontName.data(),
-                                                         nullptr,
-                                                         weight,
-                                                         style,
-                                                         stretch,
-                                                         fontSize,
-                                                         L"",
-                                                         &format));
-
-        THROW_IF_FAILED(format.As(&textFormat));
-
-        Microsoft::WRL::ComPtr<IDWriteTextAnalyzer> analyzer;
-        THROW_IF_FAILED(_dwriteFactory->CreateTextAnalyzer(&analyzer));
-        THROW_IF_FAILED(analyzer.As(&textAnalyzer));
-
-        fontFace = face;
-
-        THROW_IF_FAILED(textFormat->SetLineSpacing(&lineSpacing));
-        THROW_IF_FAILED(textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR));
-        THROW_IF_FAILED(textFormat->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP));
-
-        // The scaled size needs to represent the pixel box that each character will fit within for the purposes
-        // of hit testing math and other such multiplication/division.
-        COORD coordSize = { 0 };
-        coordSize.X = gsl::narrow<SHORT>(widthExact);
-        coordSize.Y = gsl::narrow<SHORT>(lineSpacing.height);
-
-        const auto familyNameLength = textFormat->GetFontFamilyNameLength() + 1; // 1 for space for null
-        const auto familyNameBuffer = std::make_unique<wchar_t[]>(familyNameLength);
-        THROW_IF_FAILED(textFormat->GetFontFamilyName(familyNameBuffer.get(), familyNameLength));
-
-        const DWORD weightDword = static_cast<DWORD>(textFormat->GetFontWeight());
-
-        // Unscaled is for the purposes of re-communicating this font back to the renderer again later.
-        // As such, we need to give the same original size parameter back here without padding
-        // or rounding or scaling manipulation.
-        COORD unscaled = desired.GetEngineSize();
-
-        COORD scaled = coordSize;
-
-        actual.SetFromEngine(familyNameBuffer.get(),
-                             desired.GetFamily(),
-                             weightDword,
-                             false,
-                             scaled,
-                             unscaled);
-
-    }
-    CATCH_RETURN();
+    // For HWND swap chains, the font is sized up by the DPI. Composition swap
+    // chains are scaled by the DPI later, during drawing and presentation.
+    return FontSelection::GetProposedFont(_dwriteFactory.Get(),
+                                          desired,
+                                          actual,
+                                          dpi,
+                                          _chainMode == SwapChainMode::ForHwnd,
+                                          textFormat,
+                                          textAnalyzer,
+                                          fontFace);
+}
 
-    return S_OK;
+// Routine Description:
+// - Checks whether a failure means that the device has to be made again
+// Arguments:
+// - hr - What DXGI or Direct2D returned
+// Return Value:
+// - True if the device was removed or reset, or the target has to be recreated.
+[[nodiscard]]
+bool DxEngine::s_IsDeviceLost(const HRESULT hr) noexcept
+{
+    return hr == DXGI_ERROR_DEVICE_REMOVED ||
+           hr == DXGI_ERROR_DEVICE_RESET ||
+           hr == D2DERR_RECREATE_TARGET;
 }
 
 // Routine Description:
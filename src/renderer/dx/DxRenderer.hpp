@@ -10,6 +10,7 @@
 
 #include <d3d11.h>
 #include <d2d1.h>
+#include <d2d1_1.h>
 #include <d2d1helper.h>
 #include <dwrite.h>
 #include <dwrite_1.h>
@@ -19,7 +20,17 @@
 #include <wrl.h>
 #include <wrl/client.h>
 
+#include <array>
+
 #include "CustomTextRenderer.h"
+#include "BackgroundBatch.h"
+#include "BrushCache.h"
+#include "GlyphAtlas.h"
+#include "ShapedTextCache.h"
+#include "FontFallbackCache.h"
+#include "FontSelection.h"
+#include "SharedResources.h"
+#include "../inc/GlyphWidthCache.hpp"
 
 #include "../../types/inc/Viewport.hpp"
 
@@ -74,6 +85,9 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT Present() noexcept override;
 
+        [[nodiscard]]
+        HRESULT WaitUntilCanRender() noexcept override;
+
         [[nodiscard]]
         HRESULT ScrollFrame() noexcept override;
 
@@ -116,6 +130,8 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT IsGlyphWideByFont(const std::wstring_view glyph, _Out_ bool* const pResult) noexcept override;
 
+        Microsoft::Console::Types::MemoryUsage GetCacheMemoryUsage() const noexcept override;
+
         [[nodiscard]]
         ::Microsoft::Console::Types::Viewport GetViewportInCharacters(const ::Microsoft::Console::Types::Viewport& viewInPixels) noexcept;
 
@@ -166,6 +182,7 @@ namespace Microsoft::Console::Render
         void _InvalidOffset(POINT pt) noexcept;
 
         bool _presentReady;
+        bool _presentFull;
         RECT _presentDirty;
         RECT _presentScroll;
         POINT _presentOffset;
@@ -175,13 +192,38 @@ namespace Microsoft::Console::Render
         static const ULONG s_ulMaxCursorHeightPercent = 100;
 
         // Device-Independent Resources
-        ::Microsoft::WRL::ComPtr<ID2D1Factory> _d2dFactory;
+        ::Microsoft::WRL::ComPtr<ID2D1Factory1> _d2dFactory;
         ::Microsoft::WRL::ComPtr<IDWriteFactory2> _dwriteFactory;
         ::Microsoft::WRL::ComPtr<IDWriteTextFormat2> _dwriteTextFormat;
         ::Microsoft::WRL::ComPtr<IDWriteFontFace5> _dwriteFontFace;
         ::Microsoft::WRL::ComPtr<IDWriteTextAnalyzer1> _dwriteTextAnalyzer;
         ::Microsoft::WRL::ComPtr<CustomTextRenderer> _customRenderer;
 
+        // Text shaped with the current font, to draw again without shaping it again.
+        ShapedTextCache _shapedTextCache;
+
+        // The fonts that characters the current font can't draw were mapped to.
+        FontFallbackCache _fontFallbackCache;
+
+        // Which glyphs have been measured as wide in the current face. These are kept
+        // when only the size changes.
+        GlyphWidthCache _glyphWidthCache;
+
+        // The glyph for each printable ASCII character in the primary font, and how
+        // far over it goes to be centered in its cell. A glyph of 0 means that
+        // character has to be shaped after all.
+        static constexpr wchar_t s_firstAsciiGlyph = L' ';
+        static constexpr wchar_t s_lastAsciiGlyph = L'~';
+        std::array<UINT16, s_lastAsciiGlyph - s_firstAsciiGlyph + 1> _asciiGlyphIndices;
+        std::array<float, s_lastAsciiGlyph - s_firstAsciiGlyph + 1> _asciiGlyphOffsets;
+
+        // Room to put together an ASCII run, kept so it isn't allocated for every run.
+        std::wstring _asciiText;
+        std::vector<UINT16> _asciiIndices;
+        std::vector<float> _asciiAdvances;
+        std::vector<DWRITE_GLYPH_OFFSET> _asciiOffsets;
+        std::vector<UINT16> _asciiClusters;
+
         // Device-Dependent Resources
         bool _haveDeviceResources;
         ::Microsoft::WRL::ComPtr<ID3D11Device> _d3dDevice;
@@ -189,20 +231,48 @@ namespace Microsoft::Console::Render
         ::Microsoft::WRL::ComPtr<IDXGIAdapter1> _dxgiAdapter1;
         ::Microsoft::WRL::ComPtr<IDXGIFactory2> _dxgiFactory2;
         ::Microsoft::WRL::ComPtr<IDXGIOutput> _dxgiOutput;
-        ::Microsoft::WRL::ComPtr<IDXGISurface> _dxgiSurface;
+        ::Microsoft::WRL::ComPtr<ID2D1Device> _d2dDevice;
         ::Microsoft::WRL::ComPtr<ID2D1RenderTarget> _d2dRenderTarget;
+        ::Microsoft::WRL::ComPtr<ID2D1DeviceContext> _d2dDeviceContext;
+        ::Microsoft::WRL::ComPtr<ID2D1Bitmap1> _d2dTargetBitmap;
+        ::Microsoft::WRL::ComPtr<IDXGISwapChain1> _dxgiSwapChain;
+
+        // A brush for every color drawn with. _d2dBrushForeground and
+        // _d2dBrushBackground are the ones for the current colors, and like
+        // the rest of them, never have their colors changed.
+        BrushCache _brushes;
         ::Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> _d2dBrushForeground;
         ::Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> _d2dBrushBackground;
-        ::Microsoft::WRL::ComPtr<IDXGISwapChain1> _dxgiSwapChain;
+
+        // Glyphs already rasterized for _d2dRenderTarget, with the current font.
+        GlyphAtlas _glyphAtlas;
+
+        // While a frame is painted, everything but the backgrounds is recorded
+        // into _d2dFrameCommands instead of being drawn onto _d2dFrameTarget,
+        // and the backgrounds are collected in _backgrounds. See _DrawFrame.
+        ::Microsoft::WRL::ComPtr<ID2D1CommandList> _d2dFrameCommands;
+        ::Microsoft::WRL::ComPtr<ID2D1Image> _d2dFrameTarget;
+        BackgroundBatch _backgrounds;
+
+        // Signaled whenever the swap chain can take another frame.
+        wil::unique_handle _swapChainFrameLatencyWaitable;
+        static constexpr UINT s_SwapChainFlags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
         [[nodiscard]]
         HRESULT _CreateDeviceResources(const bool createSwapChain) noexcept;
 
+        [[nodiscard]]
+        HRESULT _PrepareDeviceContext() noexcept;
+
         [[nodiscard]]
         HRESULT _PrepareRenderTarget() noexcept;
 
+        void _ReleaseRenderTarget() noexcept;
         void _ReleaseDeviceResources() noexcept;
 
+        [[nodiscard]]
+        HRESULT _DrawFrame() noexcept;
+
         [[nodiscard]]
         HRESULT _CreateTextLayout(
             _In_reads_(StringLength) PCWCHAR String,
@@ -210,16 +280,14 @@ namespace Microsoft::Console::Render
             _Out_ IDWriteTextLayout **ppTextLayout) noexcept;
 
         [[nodiscard]]
-        HRESULT _CopyFrontToBack() noexcept;
+        HRESULT _CopyFrontToBack(const RECT source, const POINT destination) noexcept;
 
         [[nodiscard]]
-        HRESULT _EnableDisplayAccess(const bool outputEnabled) noexcept;
+        RECT _GetScrollRect() const noexcept;
 
         [[nodiscard]]
-        ::Microsoft::WRL::ComPtr<IDWriteFontFace5> _FindFontFace(const std::wstring& familyName,
-                                                                 DWRITE_FONT_WEIGHT weight,
-                                                                 DWRITE_FONT_STRETCH stretch,
-                                                                 DWRITE_FONT_STYLE style) const;
+        HRESULT _EnableDisplayAccess(const bool outputEnabled) noexcept;
+
 
         [[nodiscard]]
         HRESULT _GetProposedFont(const FontInfoDesired& desired,
@@ -229,6 +297,14 @@ namespace Microsoft::Console::Render
                                  ::Microsoft::WRL::ComPtr<IDWriteTextAnalyzer1>& textAnalyzer,
                                  ::Microsoft::WRL::ComPtr<IDWriteFontFace5>& fontFace) const noexcept;
 
+        [[nodiscard]]
+        HRESULT _PaintAsciiBufferLine(std::basic_string_view<Cluster> const clusters,
+                                      const D2D1_POINT_2F origin,
+                                      DrawingContext& context) noexcept;
+
+        [[nodiscard]]
+        HRESULT _BuildAsciiGlyphTable() noexcept;
+
         [[nodiscard]]
         COORD _GetFontSize() const noexcept;
 
@@ -240,5 +316,8 @@ namespace Microsoft::Console::Render
 
         [[nodiscard]]
         static DXGI_RGBA s_RgbaFromColorF(const D2D1_COLOR_F color) noexcept;
+
+        [[nodiscard]]
+        static bool s_IsDeviceLost(const HRESULT hr) noexcept;
     };
 }
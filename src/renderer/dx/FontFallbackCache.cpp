@@ -0,0 +1,91 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "FontFallbackCache.h"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// Routine Description:
+// - Creates an empty cache.
+// Arguments:
+// - capacity - How many code points to remember before starting over
+FontFallbackCache::FontFallbackCache(const size_t capacity) :
+    _capacity{ capacity }
+{
+}
+
+// Routine Description:
+// - Looks for the font that a code point was mapped to before.
+// Arguments:
+// - codePoint - The character that was mapped
+// - baseFont - The font it was mapped from
+// Return Value:
+// - The font it was mapped to and at what scale, or nothing if it hasn't
+//   been mapped yet. It's only good until the next Insert or Clear.
+[[nodiscard]]
+const FontFallbackCache::Result* FontFallbackCache::Find(const UINT32 codePoint, IDWriteFontFace* const baseFont) const
+{
+    const auto found = _results.find(Key{ codePoint, baseFont });
+    return found == _results.end() ? nullptr : &found->second;
+}
+
+// Routine Description:
+// - Remembers the font that a code point was mapped to. If the cache is full,
+//   everything else is forgotten first: the characters still in use are
+//   mapped again the next time they're drawn.
+// Arguments:
+// - codePoint - The character that was mapped
+// - baseFont - The font it was mapped from
+// - result - The font it was mapped to and at what scale
+// Return Value:
+// - <none>
+void FontFallbackCache::Insert(const UINT32 codePoint, IDWriteFontFace* const baseFont, const Result& result)
+{
+    if (_results.size() >= _capacity)
+    {
+        _results.clear();
+    }
+
+    _results.insert_or_assign(Key{ codePoint, baseFont }, result);
+}
+
+// Routine Description:
+// - Forgets every font, for when the primary font changes.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void FontFallbackCache::Clear() noexcept
+{
+    _results.clear();
+}
+
+bool FontFallbackCache::Key::operator==(const Key& other) const noexcept
+{
+    return codePoint == other.codePoint && baseFont == other.baseFont;
+}
+
+size_t FontFallbackCache::KeyHash::operator()(const Key& key) const noexcept
+{
+    size_t hash = std::hash<const void*>{}(key.baseFont);
+    hash ^= key.codePoint + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+// Routine Description:
+// - Estimates how much memory the table of fallback fonts is holding. The
+//   fonts themselves belong to DirectWrite, and aren't counted.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of the cache.
+Microsoft::Console::Types::MemoryUsage FontFallbackCache::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddHashTable(_results);
+    return usage;
+}
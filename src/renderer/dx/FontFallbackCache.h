@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "../../types/inc/MemoryUsage.hpp"
+
+#include <dwrite.h>
+#include <dwrite_3.h>
+
+#include <wrl/client.h>
+
+namespace Microsoft::Console::Render
+{
+    // Remembers which font the system font fallback picked for each code point
+    // that the primary font couldn't draw, so that the same CJK or emoji
+    // characters coming by again don't go through the fallback every frame.
+    // - The fonts are only held on to here, so the cache must be cleared when
+    //   the primary font changes.
+    class FontFallbackCache final
+    {
+    public:
+        struct Result
+        {
+            // The font to draw the code point in, or nothing for the primary font.
+            ::Microsoft::WRL::ComPtr<IDWriteFontFace5> fontFace;
+            float scale;
+        };
+
+        FontFallbackCache(const size_t capacity = s_defaultCapacity);
+
+        [[nodiscard]]
+        const Result* Find(const UINT32 codePoint, IDWriteFontFace* const baseFont) const;
+        void Insert(const UINT32 codePoint, IDWriteFontFace* const baseFont, const Result& result);
+        void Clear() noexcept;
+        Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+
+    private:
+        struct Key
+        {
+            UINT32 codePoint;
+            IDWriteFontFace* baseFont;
+
+            bool operator==(const Key& other) const noexcept;
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const noexcept;
+        };
+
+        static constexpr size_t s_defaultCapacity = 4096;
+
+        const size_t _capacity;
+        std::unordered_map<Key, Result, KeyHash> _results;
+    };
+}
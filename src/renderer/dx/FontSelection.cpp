@@ -0,0 +1,310 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "FontSelection.h"
+
+#include "../../inc/unicode.hpp"
+
+#pragma hdrstop
+
+static constexpr float POINTS_PER_INCH = 72.0f;
+
+using namespace Microsoft::Console::Render;
+
+std::mutex FontSelection::s_cacheLock;
+std::vector<FontSelection::CachedFont> FontSelection::s_cache;
+
+// Routine Description:
+// - Locates a suitable font face from the given information
+// Arguments:
+// - factory - The DirectWrite factory to look in the system fonts of
+// - familyName - The font name we should be looking for
+// - weight - The weight (bold, light, etc.)
+// - stretch - The stretch of the font is the spacing between each letter
+// - style - Normal, italic, etc.
+// Return Value:
+// - Smart pointer holding interface reference for queryable font data.
+[[nodiscard]]
+Microsoft::WRL::ComPtr<IDWriteFontFace5> FontSelection::FindFontFace(IDWriteFactory2* const factory,
+                                                                     const std::wstring& familyName,
+                                                                     DWRITE_FONT_WEIGHT weight,
+                                                                     DWRITE_FONT_STRETCH stretch,
+                                                                     DWRITE_FONT_STYLE style)
+{
+    Microsoft::WRL::ComPtr<IDWriteFontFace5> fontFace;
+
+    Microsoft::WRL::ComPtr<IDWriteFontCollection> fontCollection;
+    THROW_IF_FAILED(factory->GetSystemFontCollection(&fontCollection, false));
+
+    UINT32 familyIndex;
+    BOOL familyExists;
+    THROW_IF_FAILED(fontCollection->FindFamilyName(familyName.c_str(), &familyIndex, &familyExists));
+
+    if (familyExists)
+    {
+        Microsoft::WRL::ComPtr<IDWriteFontFamily> fontFamily;
+        THROW_IF_FAILED(fontCollection->GetFontFamily(familyIndex, &fontFamily));
+
+        Microsoft::WRL::ComPtr<IDWriteFont> font;
+        THROW_IF_FAILED(fontFamily->GetFirstMatchingFont(weight, stretch, style, &font));
+
+        Microsoft::WRL::ComPtr<IDWriteFontFace> fontFace0;
+        THROW_IF_FAILED(font->CreateFontFace(&fontFace0));
+
+        THROW_IF_FAILED(fontFace0.As(&fontFace));
+    }
+
+    return fontFace;
+}
+
+// Routine Description:
+// - Picks the font used for drawing, sized so that each cell is a whole number of pixels
+// - If the same font was picked before at the same DPI, by any engine, what was
+//   made for it then is given back again.
+// Arguments:
+// - factory - The DirectWrite factory to create the font with
+// - desired - Information specifying the font that is requested
+// - actual - Filled with the nearest font actually chosen for drawing
+// - dpi - The DPI of the screen
+// - scaleByDpi - Whether the font is sized up by the DPI here. If not, the
+//                drawing is scaled by the DPI later instead.
+// - textFormat - Filled with the format to lay out text in that font
+// - textAnalyzer - Filled with an analyzer to shape text with
+// - fontFace - Filled with the face of that font
+// Return Value:
+// - S_OK or relevant DirectX error
+[[nodiscard]]
+HRESULT FontSelection::GetProposedFont(IDWriteFactory2* const factory,
+                                       const FontInfoDesired& desired,
+                                       FontInfo& actual,
+                                       const int dpi,
+                                       const bool scaleByDpi,
+                                       Microsoft::WRL::ComPtr<IDWriteTextFormat2>& textFormat,
+                                       Microsoft::WRL::ComPtr<IDWriteTextAnalyzer1>& textAnalyzer,
+                                       Microsoft::WRL::ComPtr<IDWriteFontFace5>& fontFace) noexcept
+{
+    try
+    {
+        const std::wstring_view faceName{ desired.GetFaceName() };
+        const COORD engineSize = desired.GetEngineSize();
+        const BYTE family = desired.GetFamily();
+        const int effectiveDpi = scaleByDpi ? dpi : 0;
+
+        std::unique_lock<std::mutex> lock{ s_cacheLock };
+
+        const auto found = std::find_if(s_cache.begin(), s_cache.end(), [&](const CachedFont& font) {
+            return font.factory.Get() == factory &&
+                   font.faceName == faceName &&
+                   font.engineSize.X == engineSize.X &&
+                   font.engineSize.Y == engineSize.Y &&
+                   font.family == family &&
+                   font.dpi == effectiveDpi;
+        });
+
+        if (found != s_cache.end())
+        {
+            std::rotate(found, std::next(found), s_cache.end());
+        }
+        else
+        {
+            CachedFont font{};
+            s_CreateFont(factory, desired, actual, dpi, scaleByDpi, font.textFormat, font.textAnalyzer, font.fontFace);
+
+            font.factory = factory;
+            font.faceName = faceName;
+            font.engineSize = engineSize;
+            font.family = family;
+            font.dpi = effectiveDpi;
+            font.familyName = actual.GetFaceName();
+            font.weight = actual.GetWeight();
+            font.size = actual.GetSize();
+
+            if (s_cache.size() >= s_MaxCachedFonts)
+            {
+                s_cache.erase(s_cache.begin());
+            }
+            s_cache.push_back(std::move(font));
+        }
+
+        const auto& font = s_cache.back();
+        textFormat = font.textFormat;
+        textAnalyzer = font.textAnalyzer;
+        fontFace = font.fontFace;
+
+        // Unscaled is for the purposes of re-communicating this font back to the renderer again later,
+        // so it's the size that was asked for.
+        actual.SetFromEngine(font.familyName.c_str(),
+                             font.family,
+                             font.weight,
+                             false,
+                             font.size,
+                             font.engineSize);
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Makes the font used for drawing, sized so that each cell is a whole number of pixels
+// Arguments:
+// - factory - The DirectWrite factory to create the font with
+// - desired - Information specifying the font that is requested
+// - actual - Filled with the nearest font actually chosen for drawing
+// - dpi - The DPI of the screen
+// - scaleByDpi - Whether the font is sized up by the DPI here
+// - textFormat - Filled with the format to lay out text in that font
+// - textAnalyzer - Filled with an analyzer to shape text with
+// - fontFace - Filled with the face of that font
+// Return Value:
+// - <none>
+// Note: will throw exception on DirectWrite failure, or if the font isn't found
+void FontSelection::s_CreateFont(IDWriteFactory2* const factory,
+                                 const FontInfoDesired& desired,
+                                 FontInfo& actual,
+                                 const int dpi,
+                                 const bool scaleByDpi,
+                                 Microsoft::WRL::ComPtr<IDWriteTextFormat2>& textFormat,
+                                 Microsoft::WRL::ComPtr<IDWriteTextAnalyzer1>& textAnalyzer,
+                                 Microsoft::WRL::ComPtr<IDWriteFontFace5>& fontFace)
+{
+    const std::wstring fontName(desired.GetFaceName());
+    const DWRITE_FONT_WEIGHT weight = DWRITE_FONT_WEIGHT_NORMAL;
+    const DWRITE_FONT_STYLE style = DWRITE_FONT_STYLE_NORMAL;
+    const DWRITE_FONT_STRETCH stretch = DWRITE_FONT_STRETCH_NORMAL;
+
+    const auto face = FindFontFace(factory, fontName, weight, stretch, style);
+    THROW_IF_NULL_ALLOC_MSG(face, "Failed to find the requested font");
+
+    DWRITE_FONT_METRICS1 fontMetrics;
+    face->GetMetrics(&fontMetrics);
+
+    const UINT32 spaceCodePoint = UNICODE_SPACE;
+    UINT16 spaceGlyphIndex;
+    THROW_IF_FAILED(face->GetGlyphIndicesW(&spaceCodePoint, 1, &spaceGlyphIndex));
+
+    INT32 advanceInDesignUnits;
+    THROW_IF_FAILED(face->GetDesignGlyphAdvances(1, &spaceGlyphIndex, &advanceInDesignUnits));
+
+    // The math here is actually:
+    // Requested Size in Points * DPI scaling factor * Points to Pixels scaling factor.
+    // - DPI = dots per inch
+    // - PPI = points per inch or "points" as usually seen when choosing a font size
+    // - The DPI scaling factor is the current monitor DPI divided by 96, the default DPI.
+    // - The Points to Pixels factor is based on the typography definition of 72 points per inch.
+    //    As such, converting requires taking the 96 pixel per inch default and dividing by the 72 points per inch
+    //    to get a factor of 1 and 1/3.
+    // This turns into something like:
+    // - 12 ppi font * (96 dpi / 96 dpi) * (96 dpi / 72 points per inch) = 16 pixels tall font for 100% display (96 dpi is 100%)
+    // - 12 ppi font * (144 dpi / 96 dpi) * (96 dpi / 72 points per inch) = 24 pixels tall font for 150% display (144 dpi is 150%)
+    // - 12 ppi font * (192 dpi / 96 dpi) * (96 dpi / 72 points per inch) = 32 pixels tall font for 200% display (192 dpi is 200%)
+    float heightDesired = static_cast<float>(desired.GetEngineSize().Y) * static_cast<float>(USER_DEFAULT_SCREEN_DPI) / POINTS_PER_INCH;
+
+    // The advance is the number of pixels left-to-right (X dimension) for the given font.
+    // We're finding a proportional factor here with the design units in "ems", not an actual pixel measurement.
+
+    // For HWND swap chains, we play trickery with the font size. For others, we use inherent scaling.
+    // For composition swap chains, we scale by the DPI later during drawing and presentation.
+    if (scaleByDpi)
+    {
+        heightDesired *= (static_cast<float>(dpi) / static_cast<float>(USER_DEFAULT_SCREEN_DPI));
+    }
+
+    const float widthAdvance = static_cast<float>(advanceInDesignUnits) / fontMetrics.designUnitsPerEm;
+
+    // Use the real pixel height desired by the "em" factor for the width to get the number of pixels
+    // we will need per character in width. This will almost certainly result in fractional X-dimension pixels.
+    const float widthApprox = heightDesired * widthAdvance;
+
+    // Since we can't deal with columns of the presentation grid being fractional pixels in width, round to the nearest whole pixel.
+    const float widthExact = round(widthApprox);
+
+    // Now reverse the "em" factor from above to turn the exact pixel width into a (probably) fractional
+    // height in pixels of each character. It's easier for us to pad out height and align vertically
+    // than it is horizontally.
+    const auto fontSize = widthExact / widthAdvance;
+
+    // Now figure out the basic properties of the character height which include ascent and descent
+    // for this specific font size.
+    const float ascent = (fontSize * fontMetrics.ascent) / fontMetrics.designUnitsPerEm;
+    const float descent = (fontSize * fontMetrics.descent) / fontMetrics.designUnitsPerEm;
+
+    // We're going to build a line spacing object here to track all of this data in our format.
+    DWRITE_LINE_SPACING lineSpacing = {};
+    lineSpacing.method = DWRITE_LINE_SPACING_METHOD_UNIFORM;
+
+    // We need to make sure the baseline falls on a round pixel (not a fractional pixel).
+    // If the baseline is fractional, the text appears blurry, especially at small scales.
+    // Since we also need to make sure the bounding box as a whole is round pixels
+    // (because the entire console system maths in full cell units),
+    // we're just going to ceiling up the ascent and descent to make a full pixel amount
+    // and set the baseline to the full round pixel ascent value.
+    //
+    // For reference, for the letters "ag":
+    // aaaaaa   ggggggg     <===================================
+    //      a   g    g            |                            |
+    //  aaaaa   ggggg             |<-ascent                    |
+    // a    a   g                 |                            |---- height
+    // aaaaa a  gggggg      <-------------------baseline       |
+    //          g     g           |<-descent                   |
+    //          gggggg      <===================================
+    //
+    const auto fullPixelAscent = ceil(ascent);
+    const auto fullPixelDescent = ceil(descent);
+    lineSpacing.height = fullPixelAscent + fullPixelDescent;
+    lineSpacing.baseline = fullPixelAscent;
+
+    // Create the font with the fractional pixel height size.
+    // It should have an integer pixel width by our math above.
+    // Then below, apply the line spacing to the format to position the floating point pixel height characters
+    // into a cell that has an integer pixel height leaving some padding above/below as necessary to round them out.
+    Microsoft::WRL::ComPtr<IDWriteTextFormat> format;
+    THROW_IF_FAILED(factory->CreateTextFormat(fontName.data(),
+                                                     nullptr,
+                                                     weight,
+                                                     style,
+                                                     stretch,
+                                                     fontSize,
+                                                     L"",
+                                                     &format));
+
+    THROW_IF_FAILED(format.As(&textFormat));
+
+    Microsoft::WRL::ComPtr<IDWriteTextAnalyzer> analyzer;
+    THROW_IF_FAILED(factory->CreateTextAnalyzer(&analyzer));
+    THROW_IF_FAILED(analyzer.As(&textAnalyzer));
+
+    fontFace = face;
+
+    THROW_IF_FAILED(textFormat->SetLineSpacing(&lineSpacing));
+    THROW_IF_FAILED(textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR));
+    THROW_IF_FAILED(textFormat->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP));
+
+    // The scaled size needs to represent the pixel box that each character will fit within for the purposes
+    // of hit testing math and other such multiplication/division.
+    COORD coordSize = { 0 };
+    coordSize.X = gsl::narrow<SHORT>(widthExact);
+    coordSize.Y = gsl::narrow<SHORT>(lineSpacing.height);
+
+    const auto familyNameLength = textFormat->GetFontFamilyNameLength() + 1; // 1 for space for null
+    const auto familyNameBuffer = std::make_unique<wchar_t[]>(familyNameLength);
+    THROW_IF_FAILED(textFormat->GetFontFamilyName(familyNameBuffer.get(), familyNameLength));
+
+    const DWORD weightDword = static_cast<DWORD>(textFormat->GetFontWeight());
+
+    // Unscaled is for the purposes of re-communicating this font back to the renderer again later.
+    // As such, we need to give the same original size parameter back here without padding
+    // or rounding or scaling manipulation.
+    COORD unscaled = desired.GetEngineSize();
+
+    COORD scaled = coordSize;
+
+    actual.SetFromEngine(familyNameBuffer.get(),
+                         desired.GetFamily(),
+                         weightDword,
+                         false,
+                         scaled,
+                         unscaled);
+}
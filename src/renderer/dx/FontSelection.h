@@ -0,0 +1,83 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <dwrite.h>
+#include <dwrite_1.h>
+#include <dwrite_2.h>
+#include <dwrite_3.h>
+
+#include <wrl/client.h>
+
+#include "../inc/FontInfoDesired.hpp"
+
+namespace Microsoft::Console::Render
+{
+    // Finds the DirectWrite font for what the console asked for, and sizes it
+    // so that it fits a grid of whole pixel cells. This is shared by the
+    // engines that draw with DirectWrite, so that they pick the same font.
+    // - The fonts it's made are kept for the whole process, so that every
+    //   engine using the same font at the same DPI shares one format, analyzer
+    //   and face, rather than each loading its own.
+    class FontSelection final
+    {
+    public:
+        FontSelection() = delete;
+
+        [[nodiscard]]
+        static ::Microsoft::WRL::ComPtr<IDWriteFontFace5> FindFontFace(IDWriteFactory2* const factory,
+                                                                       const std::wstring& familyName,
+                                                                       DWRITE_FONT_WEIGHT weight,
+                                                                       DWRITE_FONT_STRETCH stretch,
+                                                                       DWRITE_FONT_STYLE style);
+
+        [[nodiscard]]
+        static HRESULT GetProposedFont(IDWriteFactory2* const factory,
+                                       const FontInfoDesired& desired,
+                                       FontInfo& actual,
+                                       const int dpi,
+                                       const bool scaleByDpi,
+                                       ::Microsoft::WRL::ComPtr<IDWriteTextFormat2>& textFormat,
+                                       ::Microsoft::WRL::ComPtr<IDWriteTextAnalyzer1>& textAnalyzer,
+                                       ::Microsoft::WRL::ComPtr<IDWriteFontFace5>& fontFace) noexcept;
+
+    private:
+        struct CachedFont
+        {
+            // What was asked for
+            ::Microsoft::WRL::ComPtr<IDWriteFactory2> factory;
+            std::wstring faceName;
+            COORD engineSize;
+            BYTE family;
+            int dpi; // 0 if it wasn't scaled by DPI
+
+            // What was chosen
+            ::Microsoft::WRL::ComPtr<IDWriteTextFormat2> textFormat;
+            ::Microsoft::WRL::ComPtr<IDWriteTextAnalyzer1> textAnalyzer;
+            ::Microsoft::WRL::ComPtr<IDWriteFontFace5> fontFace;
+            std::wstring familyName;
+            LONG weight;
+            COORD size;
+        };
+
+        // A window only ever has one font at a time, and a few between them
+        // as they're moved across displays or zoomed.
+        static constexpr size_t s_MaxCachedFonts = 16;
+
+        static void s_CreateFont(IDWriteFactory2* const factory,
+                                 const FontInfoDesired& desired,
+                                 FontInfo& actual,
+                                 const int dpi,
+                                 const bool scaleByDpi,
+                                 ::Microsoft::WRL::ComPtr<IDWriteTextFormat2>& textFormat,
+                                 ::Microsoft::WRL::ComPtr<IDWriteTextAnalyzer1>& textAnalyzer,
+                                 ::Microsoft::WRL::ComPtr<IDWriteFontFace5>& fontFace);
+
+        // Guards s_cache. The engines pick their fonts from their own threads.
+        static std::mutex s_cacheLock;
+
+        // Most recently used last.
+        static std::vector<CachedFont> s_cache;
+    };
+}
@@ -0,0 +1,347 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "GlyphAtlas.h"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+GlyphAtlas::GlyphAtlas() noexcept :
+    _cellSize{ 0 },
+    _baseline{ 0 },
+    _nextSlot{ 0 }
+{
+}
+
+// Routine Description:
+// - Throws away the bitmap and every glyph in it. This must be done whenever
+//   the render target the bitmap was made for goes away, or when the font
+//   or DPI changes.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void GlyphAtlas::Reset() noexcept
+{
+    _ClearGlyphs();
+    _atlasBrush.Reset();
+    _atlasBitmap.Reset();
+    _atlasTarget.Reset();
+    _cellSize = { 0 };
+    _baseline = 0;
+}
+
+// Routine Description:
+// - Gets the atlas ready for a frame: makes the bitmap for the given render
+//   target if there isn't one for these cells yet, and starts over if the
+//   last frame filled it up.
+// - Glyphs drawn in a frame may not be drawn until the frame ends (say, into
+//   a command list), so slots are only ever reused here, between frames.
+// Arguments:
+// - renderTarget - The target the glyphs are going to be drawn onto
+// - cellSize - The size of a cell in the grid
+// - baseline - How far down the cell the baseline is
+// Return Value:
+// - S_OK or the relevant DirectX error.
+[[nodiscard]]
+HRESULT GlyphAtlas::Prepare(ID2D1RenderTarget* const renderTarget,
+                            const D2D1_SIZE_F cellSize,
+                            const float baseline) noexcept
+{
+    // The slots are laid out in cells, so a different cell means starting over.
+    if (!_atlasTarget || _cellSize.width != cellSize.width || _cellSize.height != cellSize.height || _baseline != baseline)
+    {
+        Reset();
+        RETURN_IF_FAILED(_Create(renderTarget, cellSize, baseline));
+    }
+    else if (_nextSlot == s_slotColumns * s_slotRows)
+    {
+        _ClearGlyphs();
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Draws a run of glyphs from the atlas, rasterizing any of them that aren't
+//   in it yet.
+// - Only left-to-right, upright runs are drawn this way. For anything else,
+//   if the atlas hasn't been prepared for these cells, or if the run doesn't
+//   fit in the atlas, nothing is drawn and the caller should draw the run itself.
+// Arguments:
+// - renderTarget - The target to draw onto. Must be between BeginDraw and EndDraw.
+// - cellSize - The size of a cell in the grid
+// - baseline - How far down the cell the baseline is
+// - baselineOrigin - Where the run's baseline starts
+// - measuringMode - How the glyphs were measured
+// - glyphRun - The glyphs to draw
+// - brush - What to fill the glyphs with
+// Return Value:
+// - S_OK if the run was drawn, S_FALSE if the caller needs to draw it, or
+//   the relevant DirectX error.
+[[nodiscard]]
+HRESULT GlyphAtlas::DrawGlyphRun(ID2D1RenderTarget* const renderTarget,
+                                 const D2D1_SIZE_F cellSize,
+                                 const float baseline,
+                                 const D2D1_POINT_2F baselineOrigin,
+                                 const DWRITE_MEASURING_MODE measuringMode,
+                                 _In_ const DWRITE_GLYPH_RUN* const glyphRun,
+                                 ID2D1Brush* const brush) noexcept
+{
+    try
+    {
+        RETURN_HR_IF(S_FALSE, glyphRun->isSideways || WI_IsFlagSet(glyphRun->bidiLevel, 1));
+        RETURN_HR_IF(S_FALSE, glyphRun->glyphAdvances == nullptr);
+        RETURN_HR_IF(S_FALSE, glyphRun->glyphCount > s_slotColumns * s_slotRows);
+
+        RETURN_HR_IF(S_FALSE, !_atlasTarget);
+        RETURN_HR_IF(S_FALSE, _cellSize.width != cellSize.width || _cellSize.height != cellSize.height || _baseline != baseline);
+
+        // First find every glyph of the run, rasterizing the ones we haven't seen.
+        // Drawing into the atlas has to be finished before it can be drawn from.
+        bool isBeginDrawCalled = false;
+        auto endDraw = wil::scope_exit([&]() noexcept {
+            if (isBeginDrawCalled)
+            {
+                LOG_IF_FAILED(_atlasTarget->EndDraw());
+            }
+        });
+
+        _runSlots.clear();
+        for (UINT32 i = 0; i < glyphRun->glyphCount; i++)
+        {
+            Key key{ glyphRun->fontFace,
+                     glyphRun->glyphIndices[i],
+                     glyphRun->fontEmSize,
+                     glyphRun->glyphOffsets ? glyphRun->glyphOffsets[i].advanceOffset : 0.0f,
+                     glyphRun->glyphOffsets ? glyphRun->glyphOffsets[i].ascenderOffset : 0.0f };
+
+            auto found = _glyphs.find(key);
+            if (found == _glyphs.end())
+            {
+                // When the atlas is full, the rest of the frame is drawn without
+                // it, and it starts over at the next Prepare.
+                if (_nextSlot == s_slotColumns * s_slotRows)
+                {
+                    return S_FALSE;
+                }
+
+                Slot slot{};
+                RETURN_IF_FAILED(_Rasterize(key, measuringMode, isBeginDrawCalled, slot));
+                isBeginDrawCalled = isBeginDrawCalled || !slot.isEmpty;
+
+                if (std::find_if(_fontFaces.cbegin(), _fontFaces.cend(), [&](const auto& face) { return face.Get() == key.fontFace; }) == _fontFaces.cend())
+                {
+                    _fontFaces.emplace_back(key.fontFace);
+                }
+
+                found = _glyphs.emplace(key, slot).first;
+            }
+
+            _runSlots.push_back(&found->second);
+        }
+
+        endDraw.release();
+        if (isBeginDrawCalled)
+        {
+            RETURN_IF_FAILED(_atlasTarget->EndDraw());
+        }
+
+        // Opacity masks can only be filled with aliased drawing.
+        const auto antialiasMode = renderTarget->GetAntialiasMode();
+        renderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+        auto restoreAntialiasMode = wil::scope_exit([&]() noexcept {
+            renderTarget->SetAntialiasMode(antialiasMode);
+        });
+
+        auto penX = baselineOrigin.x;
+        for (UINT32 i = 0; i < glyphRun->glyphCount; i++)
+        {
+            const auto slot = _runSlots.at(i);
+            if (!slot->isEmpty)
+            {
+                const auto slotWidth = slot->rect.right - slot->rect.left;
+                const auto left = penX - _cellSize.width;
+                const auto top = baselineOrigin.y - _baseline;
+                const D2D1_RECT_F destination{ left, top, left + slotWidth, top + _cellSize.height };
+
+                renderTarget->FillOpacityMask(_atlasBitmap.Get(),
+                                              brush,
+                                              D2D1_OPACITY_MASK_CONTENT_TEXT_GRAYSCALE,
+                                              &destination,
+                                              &slot->rect);
+            }
+
+            penX += glyphRun->glyphAdvances[i];
+        }
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Makes the bitmap the glyphs are kept in, to go with the given render target.
+// Arguments:
+// - renderTarget - The target the glyphs are going to be drawn onto
+// - cellSize - The size of a cell in the grid
+// - baseline - How far down the cell the baseline is
+// Return Value:
+// - S_OK or the relevant DirectX error.
+[[nodiscard]]
+HRESULT GlyphAtlas::_Create(ID2D1RenderTarget* const renderTarget,
+                            const D2D1_SIZE_F cellSize,
+                            const float baseline) noexcept
+{
+    // The atlas has the same DPI as the target it's made for, so its slots are
+    // laid out in the same units the cells are.
+    const auto size = D2D1::SizeF(cellSize.width * s_slotCells * s_slotColumns,
+                                  cellSize.height * s_slotRows);
+    const auto format = D2D1::PixelFormat(DXGI_FORMAT_A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED);
+
+    RETURN_IF_FAILED(renderTarget->CreateCompatibleRenderTarget(&size,
+                                                                nullptr,
+                                                                &format,
+                                                                D2D1_COMPATIBLE_RENDER_TARGET_OPTIONS_NONE,
+                                                                &_atlasTarget));
+
+    // Rasterize the same way the glyphs are drawn when they don't come from the atlas.
+    _atlasTarget->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+
+    RETURN_IF_FAILED(_atlasTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), &_atlasBrush));
+    RETURN_IF_FAILED(_atlasTarget->GetBitmap(&_atlasBitmap));
+
+    _cellSize = cellSize;
+    _baseline = baseline;
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Forgets every glyph, so the slots can be used again. The bitmap is kept.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void GlyphAtlas::_ClearGlyphs() noexcept
+{
+    _glyphs.clear();
+    _fontFaces.clear();
+    _runSlots.clear();
+    _nextSlot = 0;
+}
+
+// Routine Description:
+// - Draws one glyph into the next free slot of the atlas. Glyphs with no ink,
+//   like spaces, aren't drawn and don't take a slot.
+// Arguments:
+// - key - The glyph to draw
+// - measuringMode - How the glyph was measured
+// - isBeginDrawCalled - Whether the atlas is already being drawn to
+// - slot - Filled with where the glyph was put
+// Return Value:
+// - S_OK or the relevant DirectX error.
+[[nodiscard]]
+HRESULT GlyphAtlas::_Rasterize(const Key& key,
+                               const DWRITE_MEASURING_MODE measuringMode,
+                               const bool isBeginDrawCalled,
+                               Slot& slot) noexcept
+{
+    DWRITE_GLYPH_METRICS metrics;
+    RETURN_IF_FAILED(key.fontFace->GetDesignGlyphMetrics(&key.glyphIndex, 1, &metrics, false));
+
+    const auto inkWidth = static_cast<INT64>(metrics.advanceWidth) - metrics.leftSideBearing - metrics.rightSideBearing;
+    const auto inkHeight = static_cast<INT64>(metrics.advanceHeight) - metrics.topSideBearing - metrics.bottomSideBearing;
+    if (inkWidth <= 0 || inkHeight <= 0)
+    {
+        slot.isEmpty = true;
+        return S_OK;
+    }
+
+    const auto slotWidth = _cellSize.width * s_slotCells;
+    const auto column = _nextSlot % s_slotColumns;
+    const auto row = _nextSlot / s_slotColumns;
+
+    slot.isEmpty = false;
+    slot.rect.left = slotWidth * column;
+    slot.rect.top = _cellSize.height * row;
+    slot.rect.right = slot.rect.left + slotWidth;
+    slot.rect.bottom = slot.rect.top + _cellSize.height;
+
+    if (!isBeginDrawCalled)
+    {
+        _atlasTarget->BeginDraw();
+    }
+
+    // Whatever was in the slot before has to go first.
+    _atlasTarget->PushAxisAlignedClip(slot.rect, D2D1_ANTIALIAS_MODE_ALIASED);
+    _atlasTarget->Clear(D2D1::ColorF(0, 0.0f));
+
+    const DWRITE_GLYPH_OFFSET offset{ key.advanceOffset, key.ascenderOffset };
+    const FLOAT advance = 0;
+
+    DWRITE_GLYPH_RUN run{};
+    run.fontFace = key.fontFace;
+    run.fontEmSize = key.fontEmSize;
+    run.glyphCount = 1;
+    run.glyphIndices = &key.glyphIndex;
+    run.glyphAdvances = &advance;
+    run.glyphOffsets = &offset;
+
+    const auto origin = D2D1::Point2F(slot.rect.left + _cellSize.width, slot.rect.top + _baseline);
+    _atlasTarget->DrawGlyphRun(origin, &run, _atlasBrush.Get(), measuringMode);
+
+    _atlasTarget->PopAxisAlignedClip();
+
+    ++_nextSlot;
+
+    return S_OK;
+}
+
+bool GlyphAtlas::Key::operator==(const Key& other) const noexcept
+{
+    return fontFace == other.fontFace &&
+           glyphIndex == other.glyphIndex &&
+           fontEmSize == other.fontEmSize &&
+           advanceOffset == other.advanceOffset &&
+           ascenderOffset == other.ascenderOffset;
+}
+
+size_t GlyphAtlas::KeyHash::operator()(const Key& key) const noexcept
+{
+    size_t hash = std::hash<const void*>{}(key.fontFace);
+    const auto combine = [&](const size_t value) {
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    };
+
+    combine(key.glyphIndex);
+    combine(std::hash<float>{}(key.fontEmSize));
+    combine(std::hash<float>{}(key.advanceOffset));
+    combine(std::hash<float>{}(key.ascenderOffset));
+    return hash;
+}
+
+// Routine Description:
+// - Estimates how much memory the atlas is holding: the bitmap, and the table
+//   of where each glyph is in it.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of the cache.
+Microsoft::Console::Types::MemoryUsage GlyphAtlas::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddHashTable(_glyphs);
+    usage.AddContiguous(_fontFaces);
+    usage.AddContiguous(_runSlots);
+    if (_atlasBitmap)
+    {
+        // The bitmap is an 8 bit opacity mask, and lives on the GPU.
+        const auto size = _atlasBitmap->GetPixelSize();
+        usage.AddAllocation(static_cast<size_t>(size.width) * size.height);
+    }
+    return usage;
+}
@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "../../types/inc/MemoryUsage.hpp"
+
+#include <d2d1.h>
+#include <dwrite.h>
+
+#include <wrl/client.h>
+
+namespace Microsoft::Console::Render
+{
+    // A cache of glyphs that have already been rasterized, kept in one A8 bitmap
+    // on the GPU. Each glyph is keyed by its font face, glyph index, size and
+    // offsets, and is rasterized by DirectWrite the first time it's drawn. After
+    // that, drawing it is only a textured quad from the bitmap (an opacity mask
+    // filled with the text brush), which Direct2D batches together.
+    class GlyphAtlas final
+    {
+    public:
+        GlyphAtlas() noexcept;
+
+        void Reset() noexcept;
+        Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+
+        [[nodiscard]]
+        HRESULT Prepare(ID2D1RenderTarget* const renderTarget,
+                        const D2D1_SIZE_F cellSize,
+                        const float baseline) noexcept;
+
+        [[nodiscard]]
+        HRESULT DrawGlyphRun(ID2D1RenderTarget* const renderTarget,
+                             const D2D1_SIZE_F cellSize,
+                             const float baseline,
+                             const D2D1_POINT_2F baselineOrigin,
+                             const DWRITE_MEASURING_MODE measuringMode,
+                             _In_ const DWRITE_GLYPH_RUN* const glyphRun,
+                             ID2D1Brush* const brush) noexcept;
+
+    private:
+        struct Key
+        {
+            IDWriteFontFace* fontFace;
+            UINT16 glyphIndex;
+            float fontEmSize;
+            float advanceOffset;
+            float ascenderOffset;
+
+            bool operator==(const Key& other) const noexcept;
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const noexcept;
+        };
+
+        struct Slot
+        {
+            D2D1_RECT_F rect;
+            bool isEmpty;
+        };
+
+        [[nodiscard]]
+        HRESULT _Create(ID2D1RenderTarget* const renderTarget,
+                        const D2D1_SIZE_F cellSize,
+                        const float baseline) noexcept;
+
+        void _ClearGlyphs() noexcept;
+
+        [[nodiscard]]
+        HRESULT _Rasterize(const Key& key,
+                           const DWRITE_MEASURING_MODE measuringMode,
+                           const bool isBeginDrawCalled,
+                           Slot& slot) noexcept;
+
+        // How many glyphs fit in the bitmap, in slots of _slotColumns by _slotRows.
+        static constexpr size_t s_slotColumns = 32;
+        static constexpr size_t s_slotRows = 32;
+
+        // Each slot is three cells wide, with the glyph drawn in the middle one,
+        // so that anything that hangs over the sides of its cell is kept.
+        static constexpr float s_slotCells = 3.0f;
+
+        D2D1_SIZE_F _cellSize;
+        float _baseline;
+
+        ::Microsoft::WRL::ComPtr<ID2D1BitmapRenderTarget> _atlasTarget;
+        ::Microsoft::WRL::ComPtr<ID2D1Bitmap> _atlasBitmap;
+        ::Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> _atlasBrush;
+
+        std::unordered_map<Key, Slot, KeyHash> _glyphs;
+        size_t _nextSlot;
+
+        // The keys only point at their font faces, so they're held on to here
+        // until the glyphs are thrown away.
+        std::vector<::Microsoft::WRL::ComPtr<IDWriteFontFace>> _fontFaces;
+
+        // Where each glyph of the run being drawn is, kept around to save
+        // allocating it for each run.
+        std::vector<const Slot*> _runSlots;
+    };
+}
@@ -0,0 +1,1499 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "GridEngine.hpp"
+#include "CustomTextLayout.h"
+
+#include "../../interactivity/win32/CustomWindowMessages.h"
+
+#include <d3dcompiler.h>
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// The atlas is at most this many slots wide and tall. The slots are two cells
+// wide, so that a glyph two columns wide fits in one.
+static constexpr UINT32 s_atlasMaxSlotsPerSide = 64;
+static constexpr UINT32 s_atlasMaxPixelsPerSide = 8192;
+
+// One quad per cell: the vertex shader makes the four corners of a cell out of
+// the vertex and instance IDs, so there are no vertex or index buffers at all.
+// The pixel shader looks its cell up, and paints the background, the glyph out
+// of the atlas, the grid lines, the selection and the cursor over each other.
+static constexpr std::string_view s_shaderSource{ R"(
+cbuffer Constants : register(b0)
+{
+    float2 cellSize;
+    float2 viewportSize;
+    uint gridWidth;
+    uint atlasSlotsPerRow;
+    uint cursorOn;
+    uint reserved;
+    float4 cursorRect;
+    float4 cursorInnerRect;
+    float4 cursorColor;
+    float4 selectionColor;
+};
+
+struct Cell
+{
+    uint glyph;
+    uint foreground;
+    uint background;
+    uint flags;
+    uint lineColor;
+};
+
+StructuredBuffer<Cell> cells : register(t0);
+Texture2D<float4> atlas : register(t1);
+
+struct PixelInput
+{
+    float4 position : SV_Position;
+    nointerpolation uint cell : CELL;
+};
+
+float2 CellOrigin(uint cell)
+{
+    return float2(cell % gridWidth, cell / gridWidth) * cellSize;
+}
+
+float4 Unpack(uint color)
+{
+    return float4(color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff, 255) / 255.0;
+}
+
+bool IsInRect(float2 pixel, float4 rect)
+{
+    return all(pixel >= rect.xy) && all(pixel < rect.zw);
+}
+
+PixelInput VS(uint vertex : SV_VertexID, uint instance : SV_InstanceID)
+{
+    const float2 corner = float2(vertex & 1, vertex >> 1);
+    const float2 pixel = CellOrigin(instance) + corner * cellSize;
+
+    PixelInput output;
+    output.position = float4(pixel / viewportSize * float2(2, -2) + float2(-1, 1), 0, 1);
+    output.cell = instance;
+    return output;
+}
+
+float4 PS(PixelInput input) : SV_Target
+{
+    const Cell cell = cells[input.cell];
+    const float2 pixel = input.position.xy;
+    const float2 inCell = pixel - CellOrigin(input.cell);
+
+    float4 color = Unpack(cell.background);
+
+    if (cell.glyph != 0)
+    {
+        const uint slot = cell.glyph >> 1;
+        const float2 slotOrigin = float2((slot % atlasSlotsPerRow) * 2 + (cell.glyph & 1), slot / atlasSlotsPerRow) * cellSize;
+        const float coverage = atlas.Load(int3(slotOrigin + inCell, 0)).a;
+        color = lerp(color, Unpack(cell.foreground), coverage);
+    }
+
+    if (((cell.flags & 0x1) && inCell.y < 1) ||
+        ((cell.flags & 0x2) && inCell.y >= cellSize.y - 1) ||
+        ((cell.flags & 0x4) && inCell.x < 1) ||
+        ((cell.flags & 0x8) && inCell.x >= cellSize.x - 1))
+    {
+        color = Unpack(cell.lineColor);
+    }
+
+    if (cell.flags & 0x10)
+    {
+        color = lerp(color, float4(selectionColor.rgb, 1), selectionColor.a);
+    }
+
+    if (cursorOn && IsInRect(pixel, cursorRect) && !IsInRect(pixel, cursorInnerRect))
+    {
+        color = cursorColor;
+    }
+
+    return color;
+}
+)" };
+
+// Routine Description:
+// - Constructs a DirectX-based renderer for console text which keeps the
+//   whole grid on the GPU and draws it with one instanced draw per frame
+GridEngine::GridEngine() :
+    RenderEngineBase(),
+    _hwndTarget{ static_cast<HWND>(INVALID_HANDLE_VALUE) },
+    _dpi{ USER_DEFAULT_SCREEN_DPI },
+    _isEnabled{ false },
+    _isPainting{ false },
+    _displaySizePixels{ 0 },
+    _glyphCell{ 0 },
+    _gridSize{ 0 },
+    _defaultForegroundColor{ 0 },
+    _defaultBackgroundColor{ 0 },
+    _foregroundColor{ 0 },
+    _backgroundColor{ 0 },
+    _isInvalidUsed{ false },
+    _invalidRect{ 0 },
+    _constants{},
+    _constantsChanged{ true },
+    _presentReady{ false },
+    _haveDeviceResources{ false },
+    _atlasSlotsPerRow{ 0 },
+    _atlasSlotCount{ 0 },
+    _atlasNextSlot{ 1 },
+    _isAtlasDrawing{ false },
+    _isAtlasFull{ false },
+    _customRenderer{ ::Microsoft::WRL::Make<CustomTextRenderer>() }
+{
+    // The factories are shared with the other engines, so that the fonts are too.
+    // The device isn't: the pipeline state set up for the grid is its own.
+    ::Microsoft::WRL::ComPtr<ID2D1Factory1> d2dFactory;
+    THROW_IF_FAILED(SharedResources::GetFactories(d2dFactory, _dwriteFactory));
+    _d2dFactory = d2dFactory;
+}
+
+// Routine Description:
+// - Destroys an instance of the grid rendering engine
+GridEngine::~GridEngine()
+{
+    _ReleaseDeviceResources();
+}
+
+// Routine Description:
+// - Sets this engine to enabled allowing painting and presentation to occur
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK, or invalid state if you enable an enabled engine.
+[[nodiscard]]
+HRESULT GridEngine::Enable() noexcept
+{
+    RETURN_HR_IF(E_NOT_VALID_STATE, _isEnabled);
+    _isEnabled = true;
+    return S_OK;
+}
+
+// Routine Description:
+// - Sets this engine to disabled to prevent painting and presentation from
+//   occurring, and gives up its device resources
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK, or invalid state if you disable a disabled engine.
+[[nodiscard]]
+HRESULT GridEngine::Disable() noexcept
+{
+    RETURN_HR_IF(E_NOT_VALID_STATE, !_isEnabled);
+    _isEnabled = false;
+    _ReleaseDeviceResources();
+    return S_OK;
+}
+
+// Routine Description:
+// - Sets the window that this engine presents onto
+// Arguments:
+// - hwnd - The window to draw into
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::SetHwnd(const HWND hwnd) noexcept
+{
+    _hwndTarget = hwnd;
+    return S_OK;
+}
+
+// Routine Description;
+// - Creates the device, the swap chain for the window and everything that's
+//   drawn with them. Frees whatever device resources already existed first.
+// Arguments:
+// - <none>
+// Return Value:
+// - Could be any DirectX/D3D/D2D/DXGI error or memory issue.
+[[nodiscard]]
+HRESULT GridEngine::_CreateDeviceResources() noexcept
+{
+    _ReleaseDeviceResources();
+
+    auto freeOnFail = wil::scope_exit([&] { _ReleaseDeviceResources(); });
+
+    RETURN_IF_FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&_dxgiFactory2)));
+
+    // Direct2D rasterizes the glyphs into the atlas on the same device, which
+    // it can only do with BGRA support.
+    const DWORD DeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT |
+        D3D11_CREATE_DEVICE_SINGLETHREADED;
+
+    // The cells are read from a structured buffer, which needs shader model 5.
+    D3D_FEATURE_LEVEL FeatureLevels[] = {
+        D3D_FEATURE_LEVEL_11_1,
+        D3D_FEATURE_LEVEL_11_0,
+    };
+
+    RETURN_IF_FAILED(D3D11CreateDevice(nullptr,
+                                       D3D_DRIVER_TYPE_HARDWARE,
+                                       NULL,
+                                       DeviceFlags,
+                                       FeatureLevels,
+                                       ARRAYSIZE(FeatureLevels),
+                                       D3D11_SDK_VERSION,
+                                       &_d3dDevice,
+                                       NULL,
+                                       &_d3dDeviceContext));
+
+    _displaySizePixels = _GetClientSize();
+
+    DXGI_SWAP_CHAIN_DESC1 SwapChainDesc = { 0 };
+    SwapChainDesc.Width = _displaySizePixels.cx;
+    SwapChainDesc.Height = _displaySizePixels.cy;
+    SwapChainDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    SwapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    SwapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+    SwapChainDesc.BufferCount = 2;
+    SwapChainDesc.SampleDesc.Count = 1;
+    SwapChainDesc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
+    SwapChainDesc.Scaling = DXGI_SCALING_NONE;
+    SwapChainDesc.Flags = s_SwapChainFlags;
+
+    RETURN_IF_FAILED(_dxgiFactory2->CreateSwapChainForHwnd(_d3dDevice.Get(),
+                                                           _hwndTarget,
+                                                           &SwapChainDesc,
+                                                           nullptr,
+                                                           nullptr,
+                                                           &_dxgiSwapChain));
+
+    // Only ever queue up one frame, so that a key that's echoed is on the
+    // screen by the next refresh rather than behind frames already queued.
+    ::Microsoft::WRL::ComPtr<IDXGISwapChain2> sc2;
+    RETURN_IF_FAILED(_dxgiSwapChain.As(&sc2));
+    RETURN_IF_FAILED(sc2->SetMaximumFrameLatency(1));
+    _swapChainFrameLatencyWaitable.reset(sc2->GetFrameLatencyWaitableObject());
+
+    RETURN_IF_FAILED(_CreateTargetView());
+    RETURN_IF_FAILED(_CreateShaders());
+
+    D3D11_BUFFER_DESC constantDesc = { 0 };
+    constantDesc.ByteWidth = sizeof(Constants);
+    constantDesc.Usage = D3D11_USAGE_DEFAULT;
+    constantDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    RETURN_IF_FAILED(_d3dDevice->CreateBuffer(&constantDesc, nullptr, &_constantBuffer));
+
+    // The quads of neighboring cells wind in the same direction, but there's
+    // nothing behind them to cull anyway.
+    D3D11_RASTERIZER_DESC rasterizerDesc = { 0 };
+    rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+    rasterizerDesc.CullMode = D3D11_CULL_NONE;
+    rasterizerDesc.DepthClipEnable = TRUE;
+    RETURN_IF_FAILED(_d3dDevice->CreateRasterizerState(&rasterizerDesc, &_rasterizerState));
+
+    RETURN_IF_FAILED(_CreateAtlas());
+    RETURN_IF_FAILED(_CreateGrid());
+
+    _haveDeviceResources = true;
+
+    freeOnFail.release(); // don't need to release if we made it to the bottom and everything was good.
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Compiles the shaders that draw the grid
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or the compiler's or D3D's error.
+[[nodiscard]]
+HRESULT GridEngine::_CreateShaders() noexcept
+{
+    const auto compile = [&](PCSTR entryPoint, PCSTR target, ::Microsoft::WRL::ComPtr<ID3DBlob>& code) -> HRESULT {
+        ::Microsoft::WRL::ComPtr<ID3DBlob> errors;
+        const auto hr = D3DCompile(s_shaderSource.data(),
+                                   s_shaderSource.size(),
+                                   nullptr,
+                                   nullptr,
+                                   nullptr,
+                                   entryPoint,
+                                   target,
+                                   D3DCOMPILE_OPTIMIZATION_LEVEL3,
+                                   0,
+                                   &code,
+                                   &errors);
+        if (FAILED(hr) && errors)
+        {
+            OutputDebugStringA(static_cast<PCSTR>(errors->GetBufferPointer()));
+        }
+        return hr;
+    };
+
+    ::Microsoft::WRL::ComPtr<ID3DBlob> vertexCode;
+    RETURN_IF_FAILED(compile("VS", "vs_5_0", vertexCode));
+    RETURN_IF_FAILED(_d3dDevice->CreateVertexShader(vertexCode->GetBufferPointer(),
+                                                    vertexCode->GetBufferSize(),
+                                                    nullptr,
+                                                    &_vertexShader));
+
+    ::Microsoft::WRL::ComPtr<ID3DBlob> pixelCode;
+    RETURN_IF_FAILED(compile("PS", "ps_5_0", pixelCode));
+    RETURN_IF_FAILED(_d3dDevice->CreatePixelShader(pixelCode->GetBufferPointer(),
+                                                   pixelCode->GetBufferSize(),
+                                                   nullptr,
+                                                   &_pixelShader));
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Creates the view that the frame is drawn into the swap chain's back buffer through
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or relevant D3D error.
+[[nodiscard]]
+HRESULT GridEngine::_CreateTargetView() noexcept
+{
+    ::Microsoft::WRL::ComPtr<ID3D11Texture2D> backBuffer;
+    RETURN_IF_FAILED(_dxgiSwapChain->GetBuffer(0, IID_PPV_ARGS(&backBuffer)));
+    RETURN_IF_FAILED(_d3dDevice->CreateRenderTargetView(backBuffer.Get(), nullptr, &_renderTargetView));
+
+    _constants.viewportSize[0] = static_cast<float>(_displaySizePixels.cx);
+    _constants.viewportSize[1] = static_cast<float>(_displaySizePixels.cy);
+    _constantsChanged = true;
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Sizes the grid to cover the whole window with the current font, and
+//   creates the buffer it's uploaded into. Everything has to be painted again.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or relevant D3D error or memory issue.
+[[nodiscard]]
+HRESULT GridEngine::_CreateGrid() noexcept
+{
+    _cellView.Reset();
+    _cellBuffer.Reset();
+
+    RETURN_HR_IF(E_NOT_VALID_STATE, _glyphCell.cx <= 0 || _glyphCell.cy <= 0);
+
+    // A cell that's only partly in the window still gets drawn.
+    _gridSize.X = gsl::narrow<SHORT>(std::max<LONG>((_displaySizePixels.cx + _glyphCell.cx - 1) / _glyphCell.cx, 1));
+    _gridSize.Y = gsl::narrow<SHORT>(std::max<LONG>((_displaySizePixels.cy + _glyphCell.cy - 1) / _glyphCell.cy, 1));
+
+    try
+    {
+        _cells.assign(_gridSize.X * _gridSize.Y, Cell{ 0, _defaultForegroundColor, _defaultBackgroundColor, 0, 0 });
+        _dirtyRows.assign(_gridSize.Y, true);
+    }
+    CATCH_RETURN();
+
+    D3D11_BUFFER_DESC cellDesc = { 0 };
+    cellDesc.ByteWidth = gsl::narrow<UINT>(_cells.size() * sizeof(Cell));
+    cellDesc.Usage = D3D11_USAGE_DEFAULT;
+    cellDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    cellDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    cellDesc.StructureByteStride = sizeof(Cell);
+    RETURN_IF_FAILED(_d3dDevice->CreateBuffer(&cellDesc, nullptr, &_cellBuffer));
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+    viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+    viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    viewDesc.Buffer.FirstElement = 0;
+    viewDesc.Buffer.NumElements = gsl::narrow<UINT>(_cells.size());
+    RETURN_IF_FAILED(_d3dDevice->CreateShaderResourceView(_cellBuffer.Get(), &viewDesc, &_cellView));
+
+    _constants.cellSize[0] = static_cast<float>(_glyphCell.cx);
+    _constants.cellSize[1] = static_cast<float>(_glyphCell.cy);
+    _constants.gridWidth = _gridSize.X;
+    _constantsChanged = true;
+
+    _isInvalidUsed = false;
+    return InvalidateAll();
+}
+
+// Routine Description:
+// - Creates the atlas texture for the current font, and the Direct2D target
+//   that rasterizes glyphs into it. Whatever was in the old one is forgotten.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or relevant DirectX error.
+[[nodiscard]]
+HRESULT GridEngine::_CreateAtlas() noexcept
+{
+    _atlasForeground.Reset();
+    _atlasBackground.Reset();
+    _atlasTarget.Reset();
+    _atlasView.Reset();
+    _atlasTexture.Reset();
+    _atlasSlots.clear();
+    _atlasNextSlot = 1;
+    _isAtlasDrawing = false;
+    _isAtlasFull = false;
+
+    RETURN_HR_IF(E_NOT_VALID_STATE, _glyphCell.cx <= 0 || _glyphCell.cy <= 0);
+
+    const UINT32 slotWidth = 2 * _glyphCell.cx;
+    const UINT32 slotHeight = _glyphCell.cy;
+    _atlasSlotsPerRow = std::clamp(s_atlasMaxPixelsPerSide / slotWidth, 1u, s_atlasMaxSlotsPerSide);
+    const UINT32 slotRows = std::clamp(s_atlasMaxPixelsPerSide / slotHeight, 1u, s_atlasMaxSlotsPerSide);
+    _atlasSlotCount = _atlasSlotsPerRow * slotRows;
+
+    D3D11_TEXTURE2D_DESC textureDesc = { 0 };
+    textureDesc.Width = _atlasSlotsPerRow * slotWidth;
+    textureDesc.Height = slotRows * slotHeight;
+    textureDesc.MipLevels = 1;
+    textureDesc.ArraySize = 1;
+    textureDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+    RETURN_IF_FAILED(_d3dDevice->CreateTexture2D(&textureDesc, nullptr, &_atlasTexture));
+    RETURN_IF_FAILED(_d3dDevice->CreateShaderResourceView(_atlasTexture.Get(), nullptr, &_atlasView));
+
+    ::Microsoft::WRL::ComPtr<IDXGISurface> surface;
+    RETURN_IF_FAILED(_atlasTexture.As(&surface));
+
+    D2D1_RENDER_TARGET_PROPERTIES props =
+        D2D1::RenderTargetProperties(D2D1_RENDER_TARGET_TYPE_DEFAULT,
+                                     D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+                                     static_cast<float>(USER_DEFAULT_SCREEN_DPI),
+                                     static_cast<float>(USER_DEFAULT_SCREEN_DPI));
+    RETURN_IF_FAILED(_d2dFactory->CreateDxgiSurfaceRenderTarget(surface.Get(), &props, &_atlasTarget));
+
+    // Only how much of each pixel the glyph covers is kept, so it has to be
+    // grayscale. It's colored in by the pixel shader.
+    _atlasTarget->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+
+    RETURN_IF_FAILED(_atlasTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), &_atlasForeground));
+    RETURN_IF_FAILED(_atlasTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Black, 0.0f), &_atlasBackground));
+
+    _constants.atlasSlotsPerRow = _atlasSlotsPerRow;
+    _constantsChanged = true;
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Releases device-specific resources (typically held on the GPU)
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void GridEngine::_ReleaseDeviceResources() noexcept
+{
+    _haveDeviceResources = false;
+    _presentReady = false;
+
+    if (_isAtlasDrawing && _atlasTarget)
+    {
+        LOG_IF_FAILED(_atlasTarget->EndDraw());
+    }
+    _isAtlasDrawing = false;
+
+    _atlasForeground.Reset();
+    _atlasBackground.Reset();
+    _atlasTarget.Reset();
+    _atlasView.Reset();
+    _atlasTexture.Reset();
+    _atlasSlots.clear();
+
+    _cellView.Reset();
+    _cellBuffer.Reset();
+    _rasterizerState.Reset();
+    _constantBuffer.Reset();
+    _pixelShader.Reset();
+    _vertexShader.Reset();
+    _renderTargetView.Reset();
+
+    _swapChainFrameLatencyWaitable.reset();
+    _dxgiSwapChain.Reset();
+
+    if (nullptr != _d3dDeviceContext.Get())
+    {
+        // To ensure the swap chain goes away we must unbind any views from the
+        // D3D pipeline
+        _d3dDeviceContext->OMSetRenderTargets(0, nullptr, nullptr);
+    }
+    _d3dDeviceContext.Reset();
+    _d3dDevice.Reset();
+    _dxgiFactory2.Reset();
+
+    _constantsChanged = true;
+}
+
+// Routine Description:
+// - Invalidates a rectangle described in characters
+// Arguments:
+// - psrRegion - Character rectangle, inclusive
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::Invalidate(const SMALL_RECT* const psrRegion) noexcept
+{
+    _InvalidOr(psrRegion->Left, psrRegion->Top, psrRegion->Right, psrRegion->Bottom);
+    return S_OK;
+}
+
+// Routine Description:
+// - Invalidates one specific character coordinate
+// Arguments:
+// - pcoordCursor - single point in the character cell grid
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::InvalidateCursor(const COORD* const pcoordCursor) noexcept
+{
+    _InvalidOr(pcoordCursor->X, pcoordCursor->Y, pcoordCursor->X, pcoordCursor->Y);
+    return S_OK;
+}
+
+// Routine Description:
+// - Invalidates a rectangle describing a pixel area on the display
+// Arguments:
+// - prcDirtyClient - pixel rectangle
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::InvalidateSystem(const RECT* const prcDirtyClient) noexcept
+{
+    RETURN_HR_IF(S_OK, _glyphCell.cx <= 0 || _glyphCell.cy <= 0);
+
+    _InvalidOr(prcDirtyClient->left / _glyphCell.cx,
+               prcDirtyClient->top / _glyphCell.cy,
+               (prcDirtyClient->right - 1) / _glyphCell.cx,
+               (prcDirtyClient->bottom - 1) / _glyphCell.cy);
+    return S_OK;
+}
+
+// Routine Description:
+// - Invalidates a series of character rectangles
+// Arguments:
+// - rectangles - One or more rectangles describing character positions on the grid
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::InvalidateSelection(const std::vector<SMALL_RECT>& rectangles) noexcept
+{
+    for (const auto& rect : rectangles)
+    {
+        RETURN_IF_FAILED(Invalidate(&rect));
+    }
+    return S_OK;
+}
+
+// Routine Description:
+// - Scrolls the existing dirty region (if it exists) and invalidates the area
+//   that is uncovered in the window.
+// - The cells on the CPU are moved along with it, so only what's uncovered
+//   has to be painted again. All of the rows are uploaded again, though.
+// Arguments:
+// - pcoordDelta - The number of characters to move and uncover.
+//               - -Y is up, Y is down, -X is left, X is right.
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::InvalidateScroll(const COORD* const pcoordDelta) noexcept
+{
+    const int dx = pcoordDelta->X;
+    const int dy = pcoordDelta->Y;
+    if (dx == 0 && dy == 0)
+    {
+        return S_OK;
+    }
+
+    const int width = _gridSize.X;
+    const int height = _gridSize.Y;
+    if (!_cells.empty())
+    {
+        // Walk against the direction of the scroll, so that nothing is read
+        // after it's been written over.
+        const bool rowsBackward = dy > 0;
+        const bool columnsBackward = dx > 0;
+        for (int i = 0; i < height; ++i)
+        {
+            const int y = rowsBackward ? height - 1 - i : i;
+            const int sourceY = y - dy;
+            if (sourceY < 0 || sourceY >= height)
+            {
+                continue;
+            }
+
+            for (int j = 0; j < width; ++j)
+            {
+                const int x = columnsBackward ? width - 1 - j : j;
+                const int sourceX = x - dx;
+                if (sourceX >= 0 && sourceX < width)
+                {
+                    _cells[y * width + x] = _cells[sourceY * width + sourceX];
+                }
+            }
+        }
+        _MarkRowsDirty(0, height);
+    }
+
+    if (_isInvalidUsed)
+    {
+        const auto invalid = _invalidRect;
+        _isInvalidUsed = false;
+        _InvalidOr(invalid.Left + dx, invalid.Top + dy, invalid.Right + dx, invalid.Bottom + dy);
+    }
+
+    // Add the revealed portion of the screen from the scroll to the invalid area.
+    if (dy < 0)
+    {
+        _InvalidOr(0, height + dy, width - 1, height - 1);
+    }
+    else if (dy > 0)
+    {
+        _InvalidOr(0, 0, width - 1, dy - 1);
+    }
+
+    if (dx < 0)
+    {
+        _InvalidOr(width + dx, 0, width - 1, height - 1);
+    }
+    else if (dx > 0)
+    {
+        _InvalidOr(0, 0, dx - 1, height - 1);
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Invalidates the entire window area
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::InvalidateAll() noexcept
+{
+    _InvalidOr(0, 0, _gridSize.X - 1, _gridSize.Y - 1);
+    return S_OK;
+}
+
+// Routine Description:
+// - This currently has no effect in this renderer.
+// Arguments:
+// - pForcePaint - Always filled with false
+// Return Value:
+// - S_FALSE because we don't use this.
+[[nodiscard]]
+HRESULT GridEngine::InvalidateCircling(_Out_ bool* const pForcePaint) noexcept
+{
+    *pForcePaint = false;
+    return S_FALSE;
+}
+
+// Routine Description:
+// - This currently has no effect in this renderer.
+// Arguments:
+// - pForcePaint - Always filled with false
+// Return Value:
+// - S_FALSE because we don't use this.
+[[nodiscard]]
+HRESULT GridEngine::PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept
+{
+    *pForcePaint = false;
+    return S_FALSE;
+}
+
+// Routine Description:
+// - Adds a character rectangle to what the renderer has to paint. Anything
+//   off of the grid is ignored.
+// Arguments:
+// - left, top, right, bottom - The rectangle, in characters, inclusive
+// Return Value:
+// - <none>
+void GridEngine::_InvalidOr(const int left, const int top, const int right, const int bottom) noexcept
+{
+    const SMALL_RECT clipped{ gsl::narrow_cast<SHORT>(std::max(left, 0)),
+                              gsl::narrow_cast<SHORT>(std::max(top, 0)),
+                              gsl::narrow_cast<SHORT>(std::min(right, _gridSize.X - 1)),
+                              gsl::narrow_cast<SHORT>(std::min(bottom, _gridSize.Y - 1)) };
+    if (clipped.Left > clipped.Right || clipped.Top > clipped.Bottom)
+    {
+        return;
+    }
+
+    if (!_isInvalidUsed)
+    {
+        _invalidRect = clipped;
+        _isInvalidUsed = true;
+    }
+    else
+    {
+        _invalidRect.Left = std::min(_invalidRect.Left, clipped.Left);
+        _invalidRect.Top = std::min(_invalidRect.Top, clipped.Top);
+        _invalidRect.Right = std::max(_invalidRect.Right, clipped.Right);
+        _invalidRect.Bottom = std::max(_invalidRect.Bottom, clipped.Bottom);
+    }
+}
+
+// Routine Description:
+// - Marks rows of the grid to be uploaded again at the end of the frame
+// Arguments:
+// - top - The first row
+// - bottom - The row after the last one
+// Return Value:
+// - <none>
+void GridEngine::_MarkRowsDirty(const size_t top, const size_t bottom) noexcept
+{
+    const auto end = std::min(bottom, _dirtyRows.size());
+    for (auto row = top; row < end; ++row)
+    {
+        _dirtyRows[row] = true;
+    }
+}
+
+// Routine description:
+// - Makes sure there's a device to draw with that's the size of the window,
+//   and starts a frame if there's anything to paint.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_FALSE if there's nothing to paint, or any DirectX error, a memory error, etc.
+[[nodiscard]]
+HRESULT GridEngine::StartPaint() noexcept
+{
+    RETURN_HR_IF(E_NOT_VALID_STATE, _isPainting); // invalid to start a paint while painting.
+    RETURN_HR_IF(S_FALSE, !_isEnabled);
+
+    if (!_haveDeviceResources)
+    {
+        RETURN_IF_FAILED(_CreateDeviceResources());
+    }
+    else
+    {
+        const auto clientSize = _GetClientSize();
+        if (clientSize.cx != _displaySizePixels.cx || clientSize.cy != _displaySizePixels.cy)
+        {
+            // OK we need to resize the swap chain, and the grid along with it.
+            _renderTargetView.Reset();
+            _d3dDeviceContext->OMSetRenderTargets(0, nullptr, nullptr);
+            RETURN_IF_FAILED(_dxgiSwapChain->ResizeBuffers(2, clientSize.cx, clientSize.cy, DXGI_FORMAT_B8G8R8A8_UNORM, s_SwapChainFlags));
+            _displaySizePixels = clientSize;
+            RETURN_IF_FAILED(_CreateTargetView());
+            RETURN_IF_FAILED(_CreateGrid());
+        }
+    }
+
+    RETURN_HR_IF(S_FALSE, !_isInvalidUsed && !_titleChanged);
+
+    // The cursor is painted again every frame that it's still visible.
+    if (_constants.cursorOn)
+    {
+        _constants.cursorOn = 0;
+        _constantsChanged = true;
+    }
+
+    _isPainting = true;
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Uploads what changed in the grid and draws the whole of it, one instance
+//   per cell, onto the back buffer.
+// Arguments:
+// - <none>
+// Return Value:
+// - Any DirectX error, a memory error, etc.
+[[nodiscard]]
+HRESULT GridEngine::EndPaint() noexcept
+{
+    RETURN_HR_IF(E_INVALIDARG, !_isPainting); // can't end paint if we're not painting.
+
+    _isPainting = false;
+    _isInvalidUsed = false;
+    _invalidRect = { 0 };
+
+    // The glyphs rasterized during the frame have to be in the atlas before
+    // it's read from.
+    if (_isAtlasDrawing)
+    {
+        _isAtlasDrawing = false;
+        const auto hr = _atlasTarget->EndDraw();
+        if (hr == D2DERR_RECREATE_TARGET)
+        {
+            // The device is gone. Everything is made again on the next frame.
+            _ReleaseDeviceResources();
+            return S_OK;
+        }
+        RETURN_IF_FAILED(hr);
+    }
+
+    RETURN_IF_FAILED(_UploadDirtyRows());
+
+    if (_constantsChanged)
+    {
+        _d3dDeviceContext->UpdateSubresource(_constantBuffer.Get(), 0, nullptr, &_constants, 0, 0);
+        _constantsChanged = false;
+    }
+
+    D3D11_VIEWPORT viewport = { 0 };
+    viewport.Width = static_cast<float>(_displaySizePixels.cx);
+    viewport.Height = static_cast<float>(_displaySizePixels.cy);
+    viewport.MaxDepth = 1.0f;
+
+    ID3D11Buffer* const constantBuffers[]{ _constantBuffer.Get() };
+    ID3D11ShaderResourceView* const resources[]{ _cellView.Get(), _atlasView.Get() };
+
+    _d3dDeviceContext->OMSetRenderTargets(1, _renderTargetView.GetAddressOf(), nullptr);
+    _d3dDeviceContext->RSSetViewports(1, &viewport);
+    _d3dDeviceContext->RSSetState(_rasterizerState.Get());
+    _d3dDeviceContext->IASetInputLayout(nullptr);
+    _d3dDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    _d3dDeviceContext->VSSetShader(_vertexShader.Get(), nullptr, 0);
+    _d3dDeviceContext->VSSetConstantBuffers(0, ARRAYSIZE(constantBuffers), constantBuffers);
+    _d3dDeviceContext->PSSetShader(_pixelShader.Get(), nullptr, 0);
+    _d3dDeviceContext->PSSetConstantBuffers(0, ARRAYSIZE(constantBuffers), constantBuffers);
+    _d3dDeviceContext->PSSetShaderResources(0, ARRAYSIZE(resources), resources);
+
+    _d3dDeviceContext->DrawInstanced(4, gsl::narrow<UINT>(_cells.size()), 0, 0);
+
+    // Direct2D draws into the atlas again next frame, so it can't still be
+    // bound to be read from.
+    ID3D11ShaderResourceView* const unbound[ARRAYSIZE(resources)]{};
+    _d3dDeviceContext->PSSetShaderResources(0, ARRAYSIZE(unbound), unbound);
+
+    _presentReady = true;
+
+    // Some of this frame's glyphs didn't fit. Start the atlas over with only
+    // what's on the screen, which is all painted again next frame.
+    if (_isAtlasFull)
+    {
+        _atlasSlots.clear();
+        _atlasNextSlot = 1;
+        _isAtlasFull = false;
+        RETURN_IF_FAILED(InvalidateAll());
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Copies the rows that changed since the last frame into the cell buffer,
+//   with one upload for each run of changed rows.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::_UploadDirtyRows() noexcept
+{
+    const size_t width = _gridSize.X;
+    const size_t height = _dirtyRows.size();
+
+    size_t row = 0;
+    while (row < height)
+    {
+        if (!_dirtyRows[row])
+        {
+            ++row;
+            continue;
+        }
+
+        const size_t top = row;
+        while (row < height && _dirtyRows[row])
+        {
+            _dirtyRows[row] = false;
+            ++row;
+        }
+
+        D3D11_BOX box = { 0 };
+        box.left = gsl::narrow_cast<UINT>(top * width * sizeof(Cell));
+        box.right = gsl::narrow_cast<UINT>(row * width * sizeof(Cell));
+        box.bottom = 1;
+        box.back = 1;
+        _d3dDeviceContext->UpdateSubresource(_cellBuffer.Get(), 0, &box, &_cells[top * width], 0, 0);
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Shows the frame that was drawn, waiting for the next vertical blank.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK, or the error if the device is lost.
+[[nodiscard]]
+HRESULT GridEngine::Present() noexcept
+{
+    if (_presentReady)
+    {
+        _presentReady = false;
+
+        const auto hr = _dxgiSwapChain->Present(1, 0);
+        if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
+        {
+            // Everything is made again, and painted again, on the next frame.
+            _ReleaseDeviceResources();
+            return S_OK;
+        }
+        RETURN_IF_FAILED(hr);
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Blocks until the swap chain can take another frame, so that the frame is
+//   painted from the newest state just before it can be shown, and the render
+//   thread is paced by the display rather than by its own timer.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK once the swap chain is ready, S_FALSE if there's no swap chain yet.
+[[nodiscard]]
+HRESULT GridEngine::WaitUntilCanRender() noexcept
+{
+    if (!_swapChainFrameLatencyWaitable)
+    {
+        return S_FALSE;
+    }
+
+    // Don't hang the render thread on a swap chain that's stopped presenting
+    // (say, the window's been minimized): give up after a second.
+    const auto wait = WaitForSingleObjectEx(_swapChainFrameLatencyWaitable.get(), 1000, TRUE);
+    RETURN_LAST_ERROR_IF(wait == WAIT_FAILED);
+    return S_OK;
+}
+
+// Routine Description:
+// - This is currently unused.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::ScrollFrame() noexcept
+{
+    return S_OK;
+}
+
+// Routine Description:
+// - Clears what's invalid back to the default background, with no text,
+//   lines or selection on it.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::PaintBackground() noexcept
+{
+    const Cell blank{ 0, _defaultForegroundColor, _defaultBackgroundColor, 0, 0 };
+    for (auto y = _invalidRect.Top; y <= _invalidRect.Bottom; ++y)
+    {
+        const auto row = _cells.begin() + y * _gridSize.X;
+        std::fill(row + _invalidRect.Left, row + _invalidRect.Right + 1, blank);
+    }
+    _MarkRowsDirty(_invalidRect.Top, _invalidRect.Bottom + 1);
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Places one line of text into the grid at the given position, with the
+//   current colors. Glyphs that aren't in the atlas yet are rasterized.
+// Arguments:
+// - clusters - Iterable collection of cluster information (text and columns it should consume)
+// - coord - Character coordinate position in the cell grid
+// - fTrimLeft - Whether or not to trim off the left half of a double wide character
+// Return Value:
+// - S_OK or relevant DirectX error
+[[nodiscard]]
+HRESULT GridEngine::PaintBufferLine(std::basic_string_view<Cluster> const clusters,
+                                    COORD const coord,
+                                    const bool /*trimLeft*/) noexcept
+{
+    RETURN_HR_IF(S_FALSE, coord.Y < 0 || coord.Y >= _gridSize.Y);
+
+    const auto row = _cells.begin() + coord.Y * _gridSize.X;
+    int x = coord.X;
+    for (const auto& cluster : clusters)
+    {
+        if (x >= _gridSize.X)
+        {
+            break;
+        }
+
+        UINT32 slot = 0;
+        RETURN_IF_FAILED(_GetGlyph(cluster, &slot));
+
+        // A glyph takes up to two cells of its slot. Anything wider than that
+        // is cut off.
+        const int columns = gsl::narrow_cast<int>(cluster.GetColumns());
+        for (int column = 0; column < columns && x < _gridSize.X; ++column, ++x)
+        {
+            if (x < 0)
+            {
+                continue;
+            }
+
+            const UINT32 glyph = slot != 0 && column < 2 ? (slot << 1) | column : 0;
+            row[x] = Cell{ glyph, _foregroundColor, _backgroundColor, 0, 0 };
+        }
+    }
+
+    _dirtyRows[coord.Y] = true;
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Finds a cluster's glyph in the atlas, rasterizing it the first time.
+// Arguments:
+// - cluster - The text to find, and how many columns it takes
+// - slot - Filled with the cluster's atlas slot, or 0 if there's nothing to draw
+// Return Value:
+// - S_OK or relevant DirectX error or memory issue
+[[nodiscard]]
+HRESULT GridEngine::_GetGlyph(const Cluster& cluster, _Out_ UINT32* const slot) noexcept
+{
+    *slot = 0;
+
+    const auto text = cluster.GetText();
+    if (text.empty() || text == L" ")
+    {
+        return S_OK;
+    }
+
+    try
+    {
+        std::wstring key{ text };
+        const auto found = _atlasSlots.find(key);
+        if (found != _atlasSlots.end())
+        {
+            *slot = found->second;
+            return S_OK;
+        }
+
+        if (_atlasNextSlot >= _atlasSlotCount)
+        {
+            // It's started over when the frame is done.
+            _isAtlasFull = true;
+            return S_OK;
+        }
+
+        if (!_isAtlasDrawing)
+        {
+            _atlasTarget->BeginDraw();
+            _isAtlasDrawing = true;
+        }
+
+        const UINT32 newSlot = _atlasNextSlot;
+        const D2D1_POINT_2F origin{ static_cast<float>((newSlot % _atlasSlotsPerRow) * 2 * _glyphCell.cx),
+                                    static_cast<float>((newSlot / _atlasSlotsPerRow) * _glyphCell.cy) };
+        const D2D1_RECT_F slotRect{ origin.x,
+                                    origin.y,
+                                    origin.x + 2 * _glyphCell.cx,
+                                    origin.y + _glyphCell.cy };
+
+        DWRITE_LINE_SPACING spacing;
+        RETURN_IF_FAILED(_dwriteTextFormat->GetLineSpacing(&spacing));
+
+        // Color glyphs are drawn in the one color as well: the atlas only
+        // keeps how much of each pixel is covered.
+        DrawingContext context(_atlasTarget.Get(),
+                               _atlasForeground.Get(),
+                               _atlasBackground.Get(),
+                               _dwriteFactory.Get(),
+                               spacing,
+                               D2D1::SizeF(gsl::narrow<FLOAT>(_glyphCell.cx), gsl::narrow<FLOAT>(_glyphCell.cy)));
+
+        CustomTextLayout layout(_dwriteFactory.Get(),
+                                _dwriteTextAnalyzer.Get(),
+                                _dwriteTextFormat.Get(),
+                                _dwriteFontFace.Get(),
+                                { &cluster, 1 },
+                                _glyphCell.cx);
+
+        _atlasTarget->PushAxisAlignedClip(slotRect, D2D1_ANTIALIAS_MODE_ALIASED);
+        _atlasTarget->Clear(D2D1::ColorF(D2D1::ColorF::Black, 0.0f));
+        const auto hr = layout.Draw(&context, _customRenderer.Get(), origin.x, origin.y);
+        _atlasTarget->PopAxisAlignedClip();
+        RETURN_IF_FAILED(hr);
+
+        _atlasSlots.emplace(std::move(key), newSlot);
+        ++_atlasNextSlot;
+        *slot = newSlot;
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Sets lines around cells (or underneath them) to be drawn, in the given color
+// Arguments:
+// - lines - Which lines to draw
+// - color - The color to draw them in
+// - cchLine - How many cells in a row to draw them on
+// - coordTarget - The cell to start at
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::PaintBufferGridLines(GridLines const lines,
+                                         COLORREF const color,
+                                         size_t const cchLine,
+                                         COORD const coordTarget) noexcept
+{
+    RETURN_HR_IF(S_FALSE, coordTarget.Y < 0 || coordTarget.Y >= _gridSize.Y);
+
+    const auto row = _cells.begin() + coordTarget.Y * _gridSize.X;
+    const auto left = std::max<int>(coordTarget.X, 0);
+    const auto right = std::min<int>(coordTarget.X + gsl::narrow_cast<int>(cchLine), _gridSize.X);
+    for (auto x = left; x < right; ++x)
+    {
+        row[x].flags |= static_cast<UINT32>(lines);
+        row[x].lineColor = color;
+    }
+
+    _dirtyRows[coordTarget.Y] = true;
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Sets the cells in the rectangle to be drawn selected
+// Arguments:
+// - rect - Rectangle to select, in characters, exclusive
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::PaintSelection(const SMALL_RECT rect) noexcept
+{
+    const auto left = std::max<int>(rect.Left, 0);
+    const auto right = std::min<int>(rect.Right, _gridSize.X);
+    const auto top = std::max<int>(rect.Top, 0);
+    const auto bottom = std::min<int>(rect.Bottom, _gridSize.Y);
+    for (auto y = top; y < bottom; ++y)
+    {
+        const auto row = _cells.begin() + y * _gridSize.X;
+        for (auto x = left; x < right; ++x)
+        {
+            row[x].flags |= s_cellSelected;
+        }
+    }
+
+    if (top < bottom)
+    {
+        _MarkRowsDirty(top, bottom);
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Sets up the cursor to be drawn over the grid, at the given position
+// - May be a styled cursor at the character cell location that is less than a full block
+// Arguments:
+// - options - Packed options relevant to how to draw the cursor
+// Return Value:
+// - S_OK, S_FALSE if the cursor is off, or E_NOTIMPL for an unknown style.
+[[nodiscard]]
+HRESULT GridEngine::PaintCursor(const IRenderEngine::CursorOptions& options) noexcept
+{
+    // if the cursor is off, do nothing - it should not be visible.
+    if (!options.isOn)
+    {
+        return S_FALSE;
+    }
+
+    // Create rectangular block representing where the cursor can fill.
+    D2D1_RECT_F rect = { 0 };
+    rect.left = static_cast<float>(options.coordCursor.X * _glyphCell.cx);
+    rect.top = static_cast<float>(options.coordCursor.Y * _glyphCell.cy);
+    rect.right = static_cast<float>(rect.left + _glyphCell.cx);
+    rect.bottom = static_cast<float>(rect.top + _glyphCell.cy);
+
+    // If we're double-width, make it one extra glyph wider
+    if (options.fIsDoubleWidth)
+    {
+        rect.right += _glyphCell.cx;
+    }
+
+    // Nothing is left out of the cursor, unless it's only an outline.
+    D2D1_RECT_F inner = { 0 };
+
+    switch (options.cursorType)
+    {
+    case CursorType::Legacy:
+    {
+        // Enforce min/max cursor height
+        ULONG ulHeight = std::clamp(options.ulCursorHeightPercent, s_ulMinCursorHeightPercent, s_ulMaxCursorHeightPercent);
+        ulHeight = (ULONG)((_glyphCell.cy * ulHeight) / 100);
+        rect.top = rect.bottom - ulHeight;
+        break;
+    }
+    case CursorType::VerticalBar:
+    {
+        // It can't be wider than one cell or we'll have problems in invalidation, so restrict here.
+        rect.right = std::min(rect.right, rect.left + options.cursorPixelWidth);
+        break;
+    }
+    case CursorType::Underscore:
+    {
+        rect.top = rect.bottom - 1;
+        break;
+    }
+    case CursorType::EmptyBox:
+    {
+        inner = { rect.left + 1, rect.top + 1, rect.right - 1, rect.bottom - 1 };
+        break;
+    }
+    case CursorType::FullBox:
+    {
+        break;
+    }
+    default:
+        return E_NOTIMPL;
+    }
+
+    _constants.cursorRect[0] = rect.left;
+    _constants.cursorRect[1] = rect.top;
+    _constants.cursorRect[2] = rect.right;
+    _constants.cursorRect[3] = rect.bottom;
+    _constants.cursorInnerRect[0] = inner.left;
+    _constants.cursorInnerRect[1] = inner.top;
+    _constants.cursorInnerRect[2] = inner.right;
+    _constants.cursorInnerRect[3] = inner.bottom;
+
+    // Make sure to make the cursor opaque
+    s_ColorFromColorRef(options.fUseColor ? options.cursorColor : _foregroundColor, _constants.cursorColor, 1.0f);
+    _constants.cursorOn = 1;
+    _constantsChanged = true;
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Updates the colors that the cells painted next get
+// Arguments:
+// - colorForeground - Foreground color
+// - colorBackground - Background color
+// - legacyColorAttribute - <unused>
+// - isBold - <unused>
+// - isSettingDefaultBrushes - Lets us know that these are the default colors to clear the grid to and select with
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::UpdateDrawingBrushes(COLORREF const colorForeground,
+                                         COLORREF const colorBackground,
+                                         const WORD /*legacyColorAttribute*/,
+                                         const bool /*isBold*/,
+                                         bool const isSettingDefaultBrushes) noexcept
+{
+    _foregroundColor = colorForeground & 0x00FFFFFF;
+    _backgroundColor = colorBackground & 0x00FFFFFF;
+
+    if (isSettingDefaultBrushes)
+    {
+        _defaultForegroundColor = _foregroundColor;
+        _defaultBackgroundColor = _backgroundColor;
+
+        // The selection is the default foreground, at half opacity.
+        s_ColorFromColorRef(_defaultForegroundColor, _constants.selectionColor, 0.5f);
+        _constantsChanged = true;
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Updates the font used for drawing. The grid and the atlas are made again
+//   for the new size of the cells.
+// Arguments:
+// - pfiFontInfoDesired - Information specifying the font that is requested
+// - fiFontInfo - Filled with the nearest font actually chosen for drawing
+// Return Value:
+// - S_OK or relevant DirectX error
+[[nodiscard]]
+HRESULT GridEngine::UpdateFont(const FontInfoDesired& pfiFontInfoDesired, FontInfo& fiFontInfo) noexcept
+{
+    RETURN_IF_FAILED(FontSelection::GetProposedFont(_dwriteFactory.Get(),
+                                                    pfiFontInfoDesired,
+                                                    fiFontInfo,
+                                                    _dpi,
+                                                    true,
+                                                    _dwriteTextFormat,
+                                                    _dwriteTextAnalyzer,
+                                                    _dwriteFontFace));
+
+    const auto size = fiFontInfo.GetSize();
+    _glyphCell.cx = size.X;
+    _glyphCell.cy = size.Y;
+
+    if (_haveDeviceResources)
+    {
+        RETURN_IF_FAILED(_CreateAtlas());
+        RETURN_IF_FAILED(_CreateGrid());
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Sets the DPI in this renderer. It's used to size the font, so it takes
+//   effect when the font is updated next.
+// Arguments:
+// - iDpi - DPI
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::UpdateDpi(int const iDpi) noexcept
+{
+    _dpi = iDpi;
+
+    RETURN_IF_FAILED(InvalidateAll());
+
+    return S_OK;
+}
+
+// Method Description:
+// - This method will update our internal reference for how big the viewport is.
+//      Does nothing here: the grid always covers the whole window.
+// Arguments:
+// - srNewViewport - The bounds of the new viewport.
+// Return Value:
+// - HRESULT S_OK
+[[nodiscard]]
+HRESULT GridEngine::UpdateViewport(const SMALL_RECT /*srNewViewport*/) noexcept
+{
+    return S_OK;
+}
+
+// Routine Description:
+// - Finds the font nearest to what's desired, without changing the one in use
+// Arguments:
+// - pfiFontInfoDesired - Information specifying the font that is requested
+// - pfiFontInfo - Filled with the nearest font actually chosen
+// - iDpi - The DPI it'd be drawn at
+// Return Value:
+// - S_OK or relevant DirectWrite error
+[[nodiscard]]
+HRESULT GridEngine::GetProposedFont(const FontInfoDesired& pfiFontInfoDesired,
+                                    FontInfo& pfiFontInfo,
+                                    int const iDpi) noexcept
+{
+    Microsoft::WRL::ComPtr<IDWriteTextFormat2> format;
+    Microsoft::WRL::ComPtr<IDWriteTextAnalyzer1> analyzer;
+    Microsoft::WRL::ComPtr<IDWriteFontFace5> face;
+
+    return FontSelection::GetProposedFont(_dwriteFactory.Get(),
+                                          pfiFontInfoDesired,
+                                          pfiFontInfo,
+                                          iDpi,
+                                          true,
+                                          format,
+                                          analyzer,
+                                          face);
+}
+
+// Routine Description:
+// - Gets the area that we currently believe is dirty within the character cell grid
+// Arguments:
+// - <none>
+// Return Value:
+// - Rectangle describing dirty area in characters, inclusive.
+[[nodiscard]]
+SMALL_RECT GridEngine::GetDirtyRectInChars() noexcept
+{
+    return _invalidRect;
+}
+
+// Routine Description:
+// - Gets COORD packed with shorts of each glyph (character) cell's
+//   height and width.
+// Arguments:
+// - pFontSize - Filled with the font size.
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::GetFontSize(_Out_ COORD* const pFontSize) noexcept
+{
+    *pFontSize = { gsl::narrow_cast<SHORT>(_glyphCell.cx), gsl::narrow_cast<SHORT>(_glyphCell.cy) };
+    return S_OK;
+}
+
+// Routine Description:
+// - Currently unused by this renderer.
+// Arguments:
+// - glyph - The glyph run to process for column width.
+// - pResult - True if it should take two columns. False if it should take one.
+// Return Value:
+// - S_OK or relevant DirectWrite error.
+[[nodiscard]]
+HRESULT GridEngine::IsGlyphWideByFont(const std::wstring_view glyph, _Out_ bool* const pResult) noexcept
+{
+    Cluster cluster(glyph, 0); // columns don't matter, we're doing analysis not layout.
+
+    CustomTextLayout layout(_dwriteFactory.Get(),
+                            _dwriteTextAnalyzer.Get(),
+                            _dwriteTextFormat.Get(),
+                            _dwriteFontFace.Get(),
+                            { &cluster, 1 },
+                            _glyphCell.cx);
+
+    UINT32 columns = 0;
+    RETURN_IF_FAILED(layout.GetColumns(&columns));
+
+    *pResult = columns != 1;
+
+    return S_OK;
+}
+
+// Method Description:
+// - Updates the window's title string.
+// Arguments:
+// - newTitle: the new string to use for the title of the window
+// Return Value:
+// - S_OK
+[[nodiscard]]
+HRESULT GridEngine::_DoUpdateTitle(_In_ const std::wstring& /*newTitle*/) noexcept
+{
+    return PostMessageW(_hwndTarget, CM_UPDATE_TITLE, 0, (LPARAM)nullptr) ? S_OK : E_FAIL;
+}
+
+// Routine Description:
+// - Gets the area in pixels of the window we are drawing into
+// Arguments:
+// - <none>
+// Return Value:
+// - X by Y area in pixels of the window
+[[nodiscard]]
+SIZE GridEngine::_GetClientSize() const noexcept
+{
+    RECT clientRect = { 0 };
+    LOG_IF_WIN32_BOOL_FALSE(GetClientRect(_hwndTarget, &clientRect));
+
+    SIZE clientSize = { 0 };
+    clientSize.cx = std::max(clientRect.right - clientRect.left, 1L);
+    clientSize.cy = std::max(clientRect.bottom - clientRect.top, 1L);
+
+    return clientSize;
+}
+
+// Routine Description:
+// - Converts a GDI COLORREF into the red, green, blue and alpha that the shaders take
+// Arguments:
+// - color - GDI color
+// - rgba - Filled with the color
+// - alpha - The opacity to give it
+// Return Value:
+// - <none>
+void GridEngine::s_ColorFromColorRef(const COLORREF color, float (&rgba)[4], const float alpha) noexcept
+{
+    rgba[0] = GetRValue(color) / 255.0f;
+    rgba[1] = GetGValue(color) / 255.0f;
+    rgba[2] = GetBValue(color) / 255.0f;
+    rgba[3] = alpha;
+}
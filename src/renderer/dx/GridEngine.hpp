@@ -0,0 +1,263 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "../../renderer/inc/RenderEngineBase.hpp"
+
+#include <dxgi.h>
+#include <dxgi1_2.h>
+
+#include <d3d11.h>
+#include <d2d1.h>
+#include <d2d1helper.h>
+#include <dwrite.h>
+#include <dwrite_1.h>
+#include <dwrite_2.h>
+#include <dwrite_3.h>
+
+#include <wrl.h>
+#include <wrl/client.h>
+
+#include "CustomTextRenderer.h"
+#include "FontSelection.h"
+#include "SharedResources.h"
+
+namespace Microsoft::Console::Render
+{
+    // A DirectX engine that keeps the whole visible grid on the GPU. Each cell
+    // is one record in a structured buffer (which glyph, its colors and its
+    // lines) and the frame is drawn with a single instanced draw, one quad per
+    // cell, with the pixel shader doing the glyphs, grid lines, selection and
+    // cursor. The glyphs are rasterized by DirectWrite once, into an atlas
+    // texture, and only the rows that changed are uploaded again each frame.
+    class GridEngine final : public RenderEngineBase
+    {
+    public:
+        GridEngine();
+        virtual ~GridEngine() override;
+
+        // Used to release device resources so that another instance of
+        // conhost can render to the screen (i.e. only one DirectX
+        // application may control the screen at a time.)
+        [[nodiscard]]
+        HRESULT Enable() noexcept;
+        [[nodiscard]]
+        HRESULT Disable() noexcept;
+
+        [[nodiscard]]
+        HRESULT SetHwnd(const HWND hwnd) noexcept;
+
+        // IRenderEngine Members
+        [[nodiscard]]
+        HRESULT Invalidate(const SMALL_RECT* const psrRegion) noexcept override;
+        [[nodiscard]]
+        HRESULT InvalidateCursor(const COORD* const pcoordCursor) noexcept override;
+        [[nodiscard]]
+        HRESULT InvalidateSystem(const RECT* const prcDirtyClient) noexcept override;
+        [[nodiscard]]
+        HRESULT InvalidateSelection(const std::vector<SMALL_RECT>& rectangles) noexcept override;
+        [[nodiscard]]
+        HRESULT InvalidateScroll(const COORD* const pcoordDelta) noexcept override;
+        [[nodiscard]]
+        HRESULT InvalidateAll() noexcept override;
+        [[nodiscard]]
+        HRESULT InvalidateCircling(_Out_ bool* const pForcePaint) noexcept override;
+        [[nodiscard]]
+        HRESULT PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept override;
+
+        [[nodiscard]]
+        HRESULT StartPaint() noexcept override;
+        [[nodiscard]]
+        HRESULT EndPaint() noexcept override;
+        [[nodiscard]]
+        HRESULT Present() noexcept override;
+        [[nodiscard]]
+        HRESULT WaitUntilCanRender() noexcept override;
+
+        [[nodiscard]]
+        HRESULT ScrollFrame() noexcept override;
+
+        [[nodiscard]]
+        HRESULT PaintBackground() noexcept override;
+        [[nodiscard]]
+        HRESULT PaintBufferLine(std::basic_string_view<Cluster> const clusters,
+                                COORD const coord,
+                                bool const fTrimLeft) noexcept override;
+
+        [[nodiscard]]
+        HRESULT PaintBufferGridLines(GridLines const lines, COLORREF const color, size_t const cchLine, COORD const coordTarget) noexcept override;
+        [[nodiscard]]
+        HRESULT PaintSelection(const SMALL_RECT rect) noexcept override;
+
+        [[nodiscard]]
+        HRESULT PaintCursor(const CursorOptions& options) noexcept override;
+
+        [[nodiscard]]
+        HRESULT UpdateDrawingBrushes(COLORREF const colorForeground,
+                                     COLORREF const colorBackground,
+                                     const WORD legacyColorAttribute,
+                                     const bool isBold,
+                                     bool const isSettingDefaultBrushes) noexcept override;
+        [[nodiscard]]
+        HRESULT UpdateFont(const FontInfoDesired& fiFontInfoDesired, FontInfo& fiFontInfo) noexcept override;
+        [[nodiscard]]
+        HRESULT UpdateDpi(int const iDpi) noexcept override;
+        [[nodiscard]]
+        HRESULT UpdateViewport(const SMALL_RECT srNewViewport) noexcept override;
+
+        [[nodiscard]]
+        HRESULT GetProposedFont(const FontInfoDesired& fiFontInfoDesired, FontInfo& fiFontInfo, int const iDpi) noexcept override;
+
+        [[nodiscard]]
+        SMALL_RECT GetDirtyRectInChars() noexcept override;
+
+        [[nodiscard]]
+        HRESULT GetFontSize(_Out_ COORD* const pFontSize) noexcept override;
+        [[nodiscard]]
+        HRESULT IsGlyphWideByFont(const std::wstring_view glyph, _Out_ bool* const pResult) noexcept override;
+
+    protected:
+        [[nodiscard]]
+        HRESULT _DoUpdateTitle(_In_ const std::wstring& newTitle) noexcept override;
+
+    private:
+        // One of these for every cell of the grid, in the same layout as the
+        // structured buffer that the shaders read (see GridEngine.cpp).
+        struct Cell
+        {
+            // The atlas slot of the glyph, shifted left a bit, with the lowest bit
+            // set for the right half of a glyph two cells wide. 0 is no glyph.
+            UINT32 glyph;
+            UINT32 foreground;
+            UINT32 background;
+            // GridLines, and s_cellSelected.
+            UINT32 flags;
+            UINT32 lineColor;
+        };
+
+        // The constant buffer that the shaders read, with everything that
+        // isn't kept per cell.
+        struct Constants
+        {
+            float cellSize[2];
+            float viewportSize[2];
+            UINT32 gridWidth;
+            UINT32 atlasSlotsPerRow;
+            UINT32 cursorOn;
+            UINT32 reserved;
+            float cursorRect[4];
+            float cursorInnerRect[4];
+            float cursorColor[4];
+            float selectionColor[4];
+        };
+
+        static constexpr UINT32 s_cellSelected = 0x10;
+
+        static const ULONG s_ulMinCursorHeightPercent = 25;
+        static const ULONG s_ulMaxCursorHeightPercent = 100;
+
+        HWND _hwndTarget;
+        int _dpi;
+
+        bool _isEnabled;
+        bool _isPainting;
+
+        SIZE _displaySizePixels;
+        SIZE _glyphCell;
+        COORD _gridSize;
+
+        COLORREF _defaultForegroundColor;
+        COLORREF _defaultBackgroundColor;
+
+        COLORREF _foregroundColor;
+        COLORREF _backgroundColor;
+
+        // What the renderer has to paint, in characters, inclusive.
+        bool _isInvalidUsed;
+        SMALL_RECT _invalidRect;
+
+        void _InvalidOr(const int left, const int top, const int right, const int bottom) noexcept;
+
+        // The CPU copy of the grid, and which of its rows haven't been
+        // uploaded to _cellBuffer since they changed.
+        std::vector<Cell> _cells;
+        std::vector<bool> _dirtyRows;
+
+        void _MarkRowsDirty(const size_t top, const size_t bottom) noexcept;
+
+        Constants _constants;
+        bool _constantsChanged;
+
+        bool _presentReady;
+
+        // Device-Independent Resources
+        ::Microsoft::WRL::ComPtr<ID2D1Factory> _d2dFactory;
+        ::Microsoft::WRL::ComPtr<IDWriteFactory2> _dwriteFactory;
+        ::Microsoft::WRL::ComPtr<IDWriteTextFormat2> _dwriteTextFormat;
+        ::Microsoft::WRL::ComPtr<IDWriteFontFace5> _dwriteFontFace;
+        ::Microsoft::WRL::ComPtr<IDWriteTextAnalyzer1> _dwriteTextAnalyzer;
+        ::Microsoft::WRL::ComPtr<CustomTextRenderer> _customRenderer;
+
+        // Device-Dependent Resources
+        bool _haveDeviceResources;
+        ::Microsoft::WRL::ComPtr<ID3D11Device> _d3dDevice;
+        ::Microsoft::WRL::ComPtr<ID3D11DeviceContext> _d3dDeviceContext;
+        ::Microsoft::WRL::ComPtr<IDXGIFactory2> _dxgiFactory2;
+        ::Microsoft::WRL::ComPtr<IDXGISwapChain1> _dxgiSwapChain;
+        ::Microsoft::WRL::ComPtr<ID3D11RenderTargetView> _renderTargetView;
+        ::Microsoft::WRL::ComPtr<ID3D11RasterizerState> _rasterizerState;
+        ::Microsoft::WRL::ComPtr<ID3D11VertexShader> _vertexShader;
+        ::Microsoft::WRL::ComPtr<ID3D11PixelShader> _pixelShader;
+        ::Microsoft::WRL::ComPtr<ID3D11Buffer> _constantBuffer;
+        ::Microsoft::WRL::ComPtr<ID3D11Buffer> _cellBuffer;
+        ::Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> _cellView;
+
+        // Signaled whenever the swap chain can take another frame.
+        wil::unique_handle _swapChainFrameLatencyWaitable;
+        static constexpr UINT s_SwapChainFlags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+
+        // The glyphs, white on transparent, each in a slot two cells wide. The
+        // text of each cluster that's been rasterized maps to its slot.
+        ::Microsoft::WRL::ComPtr<ID3D11Texture2D> _atlasTexture;
+        ::Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> _atlasView;
+        ::Microsoft::WRL::ComPtr<ID2D1RenderTarget> _atlasTarget;
+        ::Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> _atlasForeground;
+        ::Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> _atlasBackground;
+        std::unordered_map<std::wstring, UINT32> _atlasSlots;
+        UINT32 _atlasSlotsPerRow;
+        UINT32 _atlasSlotCount;
+        UINT32 _atlasNextSlot;
+        bool _isAtlasDrawing;
+        bool _isAtlasFull;
+
+        [[nodiscard]]
+        HRESULT _CreateDeviceResources() noexcept;
+
+        [[nodiscard]]
+        HRESULT _CreateShaders() noexcept;
+
+        [[nodiscard]]
+        HRESULT _CreateTargetView() noexcept;
+
+        [[nodiscard]]
+        HRESULT _CreateGrid() noexcept;
+
+        [[nodiscard]]
+        HRESULT _CreateAtlas() noexcept;
+
+        void _ReleaseDeviceResources() noexcept;
+
+        [[nodiscard]]
+        HRESULT _GetGlyph(const Cluster& cluster, _Out_ UINT32* const slot) noexcept;
+
+        [[nodiscard]]
+        HRESULT _UploadDirtyRows() noexcept;
+
+        [[nodiscard]]
+        SIZE _GetClientSize() const noexcept;
+
+
+        static void s_ColorFromColorRef(const COLORREF color, float (&rgba)[4], const float alpha) noexcept;
+    };
+}
@@ -0,0 +1,142 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "ShapedTextCache.h"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// Routine Description:
+// - Creates an empty cache.
+// Arguments:
+// - capacity - How many shaped strings to keep before forgetting the oldest
+ShapedTextCache::ShapedTextCache(const size_t capacity) :
+    _capacity{ capacity }
+{
+}
+
+// Routine Description:
+// - Looks for text that's been shaped before, and marks it as just used.
+// Arguments:
+// - key - The text, and what it was shaped with
+// Return Value:
+// - The shaped text, or nothing if it isn't in the cache.
+[[nodiscard]]
+std::shared_ptr<const CustomTextLayout::ShapedText> ShapedTextCache::Find(const Key& key)
+{
+    const auto found = _index.find(key);
+    if (found == _index.end())
+    {
+        return nullptr;
+    }
+
+    _entries.splice(_entries.begin(), _entries, found->second);
+    return found->second->second;
+}
+
+// Routine Description:
+// - Keeps text that's just been shaped, forgetting the text used longest ago
+//   if there isn't room.
+// Arguments:
+// - key - The text, and what it was shaped with
+// - shaped - The result of shaping it
+// Return Value:
+// - <none>
+void ShapedTextCache::Insert(Key key, std::shared_ptr<const CustomTextLayout::ShapedText> shaped)
+{
+    const auto found = _index.find(key);
+    if (found != _index.end())
+    {
+        found->second->second = std::move(shaped);
+        _entries.splice(_entries.begin(), _entries, found->second);
+        return;
+    }
+
+    if (_entries.size() >= _capacity)
+    {
+        _index.erase(_entries.back().first);
+        _entries.pop_back();
+    }
+
+    _entries.emplace_front(std::move(key), std::move(shaped));
+    try
+    {
+        _index.emplace(_entries.front().first, _entries.begin());
+    }
+    catch (...)
+    {
+        _entries.pop_front();
+        throw;
+    }
+}
+
+// Routine Description:
+// - Forgets everything. Done whenever the font or DPI changes, since nothing
+//   that was shaped before would be shaped the same way now.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void ShapedTextCache::Clear() noexcept
+{
+    _index.clear();
+    _entries.clear();
+}
+
+bool ShapedTextCache::Key::operator==(const Key& other) const noexcept
+{
+    return font == other.font &&
+           fontSize == other.fontSize &&
+           width == other.width &&
+           text == other.text &&
+           columns == other.columns;
+}
+
+size_t ShapedTextCache::KeyHash::operator()(const Key& key) const noexcept
+{
+    size_t hash = std::hash<std::wstring_view>{}(key.text);
+    const auto combine = [&](const size_t value) {
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    };
+
+    for (const auto columns : key.columns)
+    {
+        combine(columns);
+    }
+    combine(std::hash<const void*>{}(key.font));
+    combine(std::hash<float>{}(key.fontSize));
+    combine(key.width);
+    return hash;
+}
+
+// Routine Description:
+// - Estimates how much memory the cache is holding: the text it's been given,
+//   and what it was shaped into.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of the cache.
+Microsoft::Console::Types::MemoryUsage ShapedTextCache::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddNodes(_entries);
+    usage.AddHashTable(_index);
+    for (const auto& entry : _entries)
+    {
+        usage.AddContiguous(entry.first.text);
+        usage.AddContiguous(entry.first.columns);
+        if (const auto& shaped = entry.second)
+        {
+            usage.AddAllocation(sizeof(*shaped));
+            usage.AddContiguous(shaped->runs);
+            usage.AddContiguous(shaped->glyphOffsets);
+            usage.AddContiguous(shaped->glyphClusters);
+            usage.AddContiguous(shaped->glyphIndices);
+            usage.AddContiguous(shaped->glyphAdvances);
+        }
+    }
+    return usage;
+}
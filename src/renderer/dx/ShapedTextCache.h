@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "../../types/inc/MemoryUsage.hpp"
+
+#include "CustomTextLayout.h"
+
+namespace Microsoft::Console::Render
+{
+    // Keeps the text that's been shaped most recently, so that text we see again
+    // (the same prompt, the same log prefix) can be drawn without going through
+    // DirectWrite's analysis and shaping again. When it's full, whatever was
+    // used longest ago is forgotten first.
+    // - The cache must be cleared when the font or the DPI changes.
+    class ShapedTextCache final
+    {
+    public:
+        struct Key
+        {
+            std::wstring text;
+            std::vector<UINT16> columns;
+            IDWriteFontFace* font;
+            float fontSize;
+            size_t width;
+
+            bool operator==(const Key& other) const noexcept;
+        };
+
+        ShapedTextCache(const size_t capacity = s_defaultCapacity);
+
+        [[nodiscard]]
+        std::shared_ptr<const CustomTextLayout::ShapedText> Find(const Key& key);
+        void Insert(Key key, std::shared_ptr<const CustomTextLayout::ShapedText> shaped);
+        void Clear() noexcept;
+        Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+
+    private:
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const noexcept;
+        };
+
+        using Entry = std::pair<Key, std::shared_ptr<const CustomTextLayout::ShapedText>>;
+
+        static constexpr size_t s_defaultCapacity = 256;
+
+        const size_t _capacity;
+
+        // The most recently used text is at the front.
+        std::list<Entry> _entries;
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _index;
+    };
+}
@@ -0,0 +1,164 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "SharedResources.h"
+
+#include <d3d10.h>
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+using Microsoft::WRL::ComPtr;
+
+std::mutex SharedResources::s_lock;
+ComPtr<ID2D1Factory1> SharedResources::s_d2dFactory;
+ComPtr<IDWriteFactory2> SharedResources::s_dwriteFactory;
+ComPtr<IDXGIFactory2> SharedResources::s_dxgiFactory;
+ComPtr<IDXGIAdapter1> SharedResources::s_adapter;
+ComPtr<ID3D11Device> SharedResources::s_device;
+ComPtr<ID3D11DeviceContext> SharedResources::s_deviceContext;
+
+SharedResources::DeviceLock::DeviceLock(ID2D1Factory1* const factory) noexcept
+{
+    if (factory && SUCCEEDED(factory->QueryInterface(IID_PPV_ARGS(&_multithread))))
+    {
+        _multithread->Enter();
+    }
+}
+
+SharedResources::DeviceLock::~DeviceLock()
+{
+    if (_multithread)
+    {
+        _multithread->Leave();
+    }
+}
+
+// Routine Description:
+// - Gets the process's Direct2D and DirectWrite factories, making them the first time.
+// Arguments:
+// - d2dFactory - Filled with the Direct2D factory
+// - dwriteFactory - Filled with the DirectWrite factory
+// Return Value:
+// - S_OK or relevant DirectX error
+[[nodiscard]]
+HRESULT SharedResources::GetFactories(ComPtr<ID2D1Factory1>& d2dFactory,
+                                      ComPtr<IDWriteFactory2>& dwriteFactory) noexcept
+try
+{
+    std::unique_lock<std::mutex> lock{ s_lock };
+
+    if (!s_d2dFactory)
+    {
+        RETURN_IF_FAILED(D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED, IID_PPV_ARGS(&s_d2dFactory)));
+    }
+
+    if (!s_dwriteFactory)
+    {
+        RETURN_IF_FAILED(DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED,
+                                             __uuidof(s_dwriteFactory),
+                                             reinterpret_cast<IUnknown**>(s_dwriteFactory.GetAddressOf())));
+    }
+
+    d2dFactory = s_d2dFactory;
+    dwriteFactory = s_dwriteFactory;
+    return S_OK;
+}
+CATCH_RETURN();
+
+// Routine Description:
+// - Gets the process's Direct3D device, making it if there isn't one, if it's
+//   been lost, or if the adapters have changed since it was made (a display or a
+//   driver came or went).
+// Arguments:
+// - dxgiFactory - Filled with the DXGI factory the device's adapter came from
+// - adapter - Filled with the adapter the device is on
+// - device - Filled with the device
+// - deviceContext - Filled with the device's immediate context
+// Return Value:
+// - S_OK or relevant DirectX error
+[[nodiscard]]
+HRESULT SharedResources::GetDevice(ComPtr<IDXGIFactory2>& dxgiFactory,
+                                   ComPtr<IDXGIAdapter1>& adapter,
+                                   ComPtr<ID3D11Device>& device,
+                                   ComPtr<ID3D11DeviceContext>& deviceContext) noexcept
+try
+{
+    std::unique_lock<std::mutex> lock{ s_lock };
+
+    if (!s_device ||
+        FAILED(s_device->GetDeviceRemovedReason()) ||
+        !s_dxgiFactory->IsCurrent())
+    {
+        RETURN_IF_FAILED(s_CreateDevice());
+    }
+
+    dxgiFactory = s_dxgiFactory;
+    adapter = s_adapter;
+    device = s_device;
+    deviceContext = s_deviceContext;
+    return S_OK;
+}
+CATCH_RETURN();
+
+// Routine Description:
+// - Makes the shared device, replacing the one there was. Engines that still have
+//   the old one keep it until they find out it's been lost. s_lock must be held.
+// Return Value:
+// - S_OK or relevant DirectX error
+[[nodiscard]]
+HRESULT SharedResources::s_CreateDevice() noexcept
+{
+    s_deviceContext.Reset();
+    s_device.Reset();
+    s_adapter.Reset();
+
+    if (!s_dxgiFactory || !s_dxgiFactory->IsCurrent())
+    {
+        s_dxgiFactory.Reset();
+        RETURN_IF_FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&s_dxgiFactory)));
+    }
+
+    ComPtr<IDXGIAdapter1> adapter;
+    RETURN_IF_FAILED(s_dxgiFactory->EnumAdapters1(0, &adapter));
+
+    // Not D3D11_CREATE_DEVICE_SINGLETHREADED, since the engines share it.
+    const DWORD DeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT |
+        // Toggle this on for DX-specific work. Find out more about the debug layer here:
+        // https://docs.microsoft.com/en-us/windows/desktop/direct3d11/overviews-direct3d-11-devices-layers
+        // D3D11_CREATE_DEVICE_DEBUG |
+        0;
+
+    D3D_FEATURE_LEVEL FeatureLevels[] = {
+        D3D_FEATURE_LEVEL_11_1,
+        D3D_FEATURE_LEVEL_11_0,
+        D3D_FEATURE_LEVEL_10_1,
+        D3D_FEATURE_LEVEL_10_0,
+        D3D_FEATURE_LEVEL_9_1,
+    };
+
+    ComPtr<ID3D11Device> device;
+    ComPtr<ID3D11DeviceContext> deviceContext;
+    RETURN_IF_FAILED(D3D11CreateDevice(adapter.Get(),
+                                       D3D_DRIVER_TYPE_UNKNOWN,
+                                       NULL,
+                                       DeviceFlags,
+                                       FeatureLevels,
+                                       ARRAYSIZE(FeatureLevels),
+                                       D3D11_SDK_VERSION,
+                                       &device,
+                                       NULL,
+                                       &deviceContext));
+
+    // The immediate context is used by every engine, so it takes a lock on every call.
+    ComPtr<ID3D10Multithread> multithread;
+    RETURN_IF_FAILED(device.As(&multithread));
+    multithread->SetMultithreadProtected(TRUE);
+
+    s_adapter = std::move(adapter);
+    s_device = std::move(device);
+    s_deviceContext = std::move(deviceContext);
+    return S_OK;
+}
@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <dxgi1_2.h>
+#include <d3d11.h>
+#include <d2d1_1.h>
+#include <dwrite_2.h>
+
+#include <wrl/client.h>
+
+namespace Microsoft::Console::Render
+{
+    // The DirectX objects that every engine in the process can share, instead of
+    // each making its own: the Direct2D and DirectWrite factories, and a Direct3D
+    // device on the first adapter.
+    // - Engines paint on different threads at the same time, so the Direct2D
+    //   factory is a multithreaded one, and the device is protected for use from
+    //   more than one thread. Anything an engine does with Direct3D or DXGI itself
+    //   (rather than through Direct2D) has to be done holding a DeviceLock.
+    // - The device is made again for the next engine that asks after it's lost, or
+    //   once the adapters have changed.
+    class SharedResources final
+    {
+    public:
+        SharedResources() = delete;
+
+        // Holds Direct2D's lock on the shared factory, and so on the device, for
+        // as long as it's around.
+        class DeviceLock final
+        {
+        public:
+            DeviceLock(ID2D1Factory1* const factory) noexcept;
+            ~DeviceLock();
+
+            DeviceLock(const DeviceLock&) = delete;
+            DeviceLock& operator=(const DeviceLock&) = delete;
+
+        private:
+            ::Microsoft::WRL::ComPtr<ID2D1Multithread> _multithread;
+        };
+
+        [[nodiscard]]
+        static HRESULT GetFactories(::Microsoft::WRL::ComPtr<ID2D1Factory1>& d2dFactory,
+                                    ::Microsoft::WRL::ComPtr<IDWriteFactory2>& dwriteFactory) noexcept;
+
+        [[nodiscard]]
+        static HRESULT GetDevice(::Microsoft::WRL::ComPtr<IDXGIFactory2>& dxgiFactory,
+                                 ::Microsoft::WRL::ComPtr<IDXGIAdapter1>& adapter,
+                                 ::Microsoft::WRL::ComPtr<ID3D11Device>& device,
+                                 ::Microsoft::WRL::ComPtr<ID3D11DeviceContext>& deviceContext) noexcept;
+
+    private:
+        [[nodiscard]]
+        static HRESULT s_CreateDevice() noexcept;
+
+        // Guards everything below.
+        static std::mutex s_lock;
+
+        static ::Microsoft::WRL::ComPtr<ID2D1Factory1> s_d2dFactory;
+        static ::Microsoft::WRL::ComPtr<IDWriteFactory2> s_dwriteFactory;
+
+        static ::Microsoft::WRL::ComPtr<IDXGIFactory2> s_dxgiFactory;
+        static ::Microsoft::WRL::ComPtr<IDXGIAdapter1> s_adapter;
+        static ::Microsoft::WRL::ComPtr<ID3D11Device> s_device;
+        static ::Microsoft::WRL::ComPtr<ID3D11DeviceContext> s_deviceContext;
+    };
+}
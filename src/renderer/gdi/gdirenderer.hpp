@@ -15,6 +15,10 @@ Author(s):
 #pragma once
 
 #include "..\inc\RenderEngineBase.hpp"
+#include "glyphcache.hpp"
+#include "..\inc\GlyphWidthCache.hpp"
+
+#include <array>
 
 namespace Microsoft::Console::Render
 {
@@ -27,11 +31,15 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT SetHwnd(const HWND hwnd) noexcept;
 
+        void SetGlyphCacheEnabled(const bool enabled) noexcept;
+
         [[nodiscard]]
         HRESULT InvalidateSelection(const std::vector<SMALL_RECT>& rectangles) noexcept override;
         [[nodiscard]]
         HRESULT InvalidateScroll(const COORD* const pcoordDelta) noexcept override;
         [[nodiscard]]
+        HRESULT InvalidateScrollRegion(const SMALL_RECT* const psrRegion, const COORD* const pcoordDelta) noexcept override;
+        [[nodiscard]]
         HRESULT InvalidateSystem(const RECT* const prcDirtyClient) noexcept override;
         [[nodiscard]]
         HRESULT Invalidate(const SMALL_RECT* const psrRegion) noexcept override;
@@ -96,6 +104,8 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT IsGlyphWideByFont(const std::wstring_view glyph, _Out_ bool* const pResult) noexcept override;
 
+        Microsoft::Console::Types::MemoryUsage GetCacheMemoryUsage() const noexcept override;
+
     protected:
         [[nodiscard]]
         HRESULT _DoUpdateTitle(_In_ const std::wstring& newTitle) noexcept override;
@@ -120,6 +130,22 @@ namespace Microsoft::Console::Render
         static const size_t s_cPolyTextCache = 80;
         POLYTEXTW _pPolyText[s_cPolyTextCache];
         size_t _cPolyText;
+
+        // The text and widths that each of _pPolyText points at. They're kept
+        // from one frame to the next, and only ever grow, so that painting a
+        // line doesn't allocate once they're as long as the viewport is wide.
+        std::array<std::wstring, s_cPolyTextCache> _polyStrings;
+        std::array<std::vector<int>, s_cPolyTextCache> _polyWidths;
+
+        // For raster fonts, where the text is put through the font's codepage.
+        std::string _polyConvertBuffer;
+
+        // If set, lines of plain ASCII are copied from here instead of being drawn.
+        std::unique_ptr<GdiGlyphCache> _glyphCache;
+
+        // Which glyphs have been measured as wide in the current face.
+        GlyphWidthCache _glyphWidthCache;
+
         [[nodiscard]]
         HRESULT _FlushBufferLines() noexcept;
 
@@ -139,6 +165,11 @@ namespace Microsoft::Console::Render
         RECT _rcInvalid;
         bool _fInvalidRectUsed;
 
+        // A scroll of only part of the frame, like inside of the margins.
+        // Only one can be held at a time, and never along with _szInvalidScroll.
+        SIZE _szInvalidScrollRegion;
+        RECT _rcScrollRegion;
+
         COLORREF _lastFg;
         COLORREF _lastBg;
 
@@ -147,6 +178,8 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT _InvalidOffset(const POINT* const ppt) noexcept;
         [[nodiscard]]
+        HRESULT _InvalidOffsetInside(const RECT* const prcRegion, const POINT* const ppt) noexcept;
+        [[nodiscard]]
         HRESULT _InvalidRestrict() noexcept;
 
         [[nodiscard]]
@@ -176,11 +209,45 @@ namespace Microsoft::Console::Render
 
         bool _IsFontTrueType() const;
 
+        // The fonts that were made before, so that going back to one (moving back to a
+        // display with a DPI we've seen, or zooming back) doesn't make and measure it again.
+        // The cache owns the fonts, _hfont included, so the one in use is never evicted.
+        struct _CachedFont
+        {
+            // What was asked for
+            std::wstring faceName;
+            COORD engineSize;
+            LONG weight;
+            BYTE family;
+            UINT codePage;
+            int dpi;
+
+            // What was chosen
+            wil::unique_hfont hfont;
+            std::wstring chosenFaceName;
+            BYTE chosenFamily;
+            LONG chosenWeight;
+            COORD size;
+            COORD unscaledSize;
+        };
+
+        // A window only ever has one font at a time, and a few between them
+        // as it's moved across displays or zoomed.
+        static constexpr size_t s_cMaxCachedFonts = 8;
+
+        // Most recently used last.
+        std::vector<_CachedFont> _fontCache;
+
         [[nodiscard]]
         HRESULT _GetProposedFont(const FontInfoDesired& FontDesired,
                                  _Out_ FontInfo& Font,
                                  const int iDpi,
-                                 _Inout_ wil::unique_hfont& hFont) noexcept;
+                                 _Out_ HFONT& hFont) noexcept;
+        [[nodiscard]]
+        HRESULT _CreateFont(const FontInfoDesired& FontDesired,
+                            _Out_ FontInfo& Font,
+                            const int iDpi,
+                            _Inout_ wil::unique_hfont& hFont) noexcept;
 
         COORD _GetFontSize() const;
         bool _IsMinimized() const;
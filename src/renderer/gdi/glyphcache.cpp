@@ -0,0 +1,261 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "glyphcache.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// Routine Description:
+// - Creates an empty cache. Nothing's drawn until the first line is.
+GdiGlyphCache::GdiGlyphCache() noexcept :
+    _hbitmapOriginal(nullptr),
+    _hfontOriginal(nullptr),
+    _isStripSelected(false),
+    _coordFontSize{ 0 }
+{
+}
+
+// Routine Description:
+// - Lets go of the strips, after putting the strip DC back the way it came.
+GdiGlyphCache::~GdiGlyphCache()
+{
+    Reset();
+}
+
+// Routine Description:
+// - Forgets every strip, and the DC they're drawn with, for when the font or
+//   the DC they're copied onto changes.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void GdiGlyphCache::Reset() noexcept
+{
+    _DeselectStrip();
+    if (_hdcStrip && _hfontOriginal != nullptr)
+    {
+        SelectObject(_hdcStrip.get(), _hfontOriginal);
+        _hfontOriginal = nullptr;
+    }
+
+    _strips.clear();
+    _hdcStrip.reset();
+    _coordFontSize = { 0 };
+}
+
+// Routine Description:
+// - Estimates how much memory the strips are holding. Each strip's bitmap is
+//   the glyphs it holds, side by side, at 32 bits per pixel. The bitmaps
+//   belong to GDI, but they take up as much as they would in the heap.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of the cache.
+Microsoft::Console::Types::MemoryUsage GdiGlyphCache::MeasureMemory() const noexcept
+{
+    Microsoft::Console::Types::MemoryUsage usage;
+    usage.AddContiguous(_strips);
+    const size_t bitmapBytes = s_cchStrip * std::max<SHORT>(_coordFontSize.X, 0) * std::max<SHORT>(_coordFontSize.Y, 0) * sizeof(DWORD);
+    for (size_t i = 0; i < _strips.size(); ++i)
+    {
+        usage.AddAllocation(bitmapBytes);
+    }
+    return usage;
+}
+
+// Routine Description:
+// - Checks whether a line is made only of characters that are kept in the
+//   strips, each one column wide.
+// Arguments:
+// - clusters - The text of the line
+// Return Value:
+// - True if the whole line can be drawn from the strips.
+[[nodiscard]]
+bool GdiGlyphCache::s_CanDraw(const std::basic_string_view<Cluster> clusters) noexcept
+{
+    return std::all_of(clusters.begin(), clusters.end(), [](const Cluster& cluster) noexcept {
+        const auto text = cluster.GetText();
+        return cluster.GetColumns() == 1 &&
+               text.size() == 1 &&
+               text.front() >= s_wchFirst &&
+               text.front() <= s_wchLast;
+    });
+}
+
+// Routine Description:
+// - Draws a line of printable ASCII by copying each character's cell out of
+//   the strip for its colors. The strip is drawn the first time the colors
+//   are used.
+// - The caller is expected to check the line with s_CanDraw first.
+// Arguments:
+// - hdcTarget - The DC to draw onto, which the strips are made to match
+// - hfont - The font to draw the strips in
+// - coordFontSize - The size of a cell in pixels
+// - colorForeground - The text color
+// - colorBackground - The color behind the text
+// - clusters - The text to draw
+// - ptDraw - Where the line starts on hdcTarget, in pixels
+// Return Value:
+// - S_OK or suitable GDI HRESULT error.
+[[nodiscard]]
+HRESULT GdiGlyphCache::Draw(const HDC hdcTarget,
+                            const HFONT hfont,
+                            const COORD coordFontSize,
+                            const COLORREF colorForeground,
+                            const COLORREF colorBackground,
+                            const std::basic_string_view<Cluster> clusters,
+                            const POINT ptDraw) noexcept
+{
+    RETURN_IF_FAILED(_SelectStrip(hdcTarget, hfont, coordFontSize, colorForeground, colorBackground));
+
+    LONG x = ptDraw.x;
+    for (const auto& cluster : clusters)
+    {
+        const auto index = cluster.GetText().front() - s_wchFirst;
+        RETURN_HR_IF(E_FAIL, !(BitBlt(hdcTarget,
+                                      x,
+                                      ptDraw.y,
+                                      coordFontSize.X,
+                                      coordFontSize.Y,
+                                      _hdcStrip.get(),
+                                      index * coordFontSize.X,
+                                      0,
+                                      SRCCOPY)));
+        x += coordFontSize.X;
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Selects the strip for a pair of colors into the strip DC, drawing a new one
+//   if there isn't one yet. If the font's size changed, every strip is thrown
+//   out first.
+// Arguments:
+// - hdcTarget - The DC that the strips are copied onto
+// - hfont - The font to draw the strip in
+// - coordFontSize - The size of a cell in pixels
+// - colorForeground - The text color
+// - colorBackground - The color behind the text
+// Return Value:
+// - S_OK or suitable GDI HRESULT error.
+[[nodiscard]]
+HRESULT GdiGlyphCache::_SelectStrip(const HDC hdcTarget,
+                                    const HFONT hfont,
+                                    const COORD coordFontSize,
+                                    const COLORREF colorForeground,
+                                    const COLORREF colorBackground) noexcept
+{
+    try
+    {
+        if (coordFontSize.X != _coordFontSize.X || coordFontSize.Y != _coordFontSize.Y)
+        {
+            Reset();
+            _coordFontSize = coordFontSize;
+        }
+
+        if (!_hdcStrip)
+        {
+            _hdcStrip.reset(CreateCompatibleDC(hdcTarget));
+            RETURN_HR_IF_NULL(E_FAIL, _hdcStrip.get());
+        }
+
+        if (_isStripSelected)
+        {
+            const auto& selected = _strips.back();
+            if (selected.colorForeground == colorForeground && selected.colorBackground == colorBackground)
+            {
+                return S_OK;
+            }
+        }
+
+        _DeselectStrip();
+
+        const auto found = std::find_if(_strips.begin(), _strips.end(), [&](const Strip& strip) noexcept {
+            return strip.colorForeground == colorForeground && strip.colorBackground == colorBackground;
+        });
+
+        const bool isNew = found == _strips.end();
+        if (!isNew)
+        {
+            // Move it to the back, as the most recently used.
+            std::rotate(found, found + 1, _strips.end());
+        }
+        else
+        {
+            if (_strips.size() >= s_cStripsMax)
+            {
+                _strips.erase(_strips.begin());
+            }
+
+            Strip strip;
+            strip.colorForeground = colorForeground;
+            strip.colorBackground = colorBackground;
+            strip.bitmap.reset(CreateCompatibleBitmap(hdcTarget, gsl::narrow<int>(s_cchStrip * coordFontSize.X), coordFontSize.Y));
+            RETURN_HR_IF_NULL(E_FAIL, strip.bitmap.get());
+            _strips.emplace_back(std::move(strip));
+        }
+
+        auto& strip = _strips.back();
+        _hbitmapOriginal = SelectObject(_hdcStrip.get(), strip.bitmap.get());
+        RETURN_HR_IF_NULL(E_FAIL, _hbitmapOriginal);
+        _isStripSelected = true;
+
+        if (isNew)
+        {
+            // Don't keep a strip that didn't get drawn all the way.
+            auto dropStripOnFailure = wil::scope_exit([&]() noexcept {
+                _DeselectStrip();
+                _strips.pop_back();
+            });
+
+            const auto hfontOld = SelectObject(_hdcStrip.get(), hfont);
+            RETURN_HR_IF_NULL(E_FAIL, hfontOld);
+            if (_hfontOriginal == nullptr)
+            {
+                _hfontOriginal = hfontOld;
+            }
+
+            RETURN_HR_IF(E_FAIL, CLR_INVALID == SetTextColor(_hdcStrip.get(), colorForeground));
+            RETURN_HR_IF(E_FAIL, CLR_INVALID == SetBkColor(_hdcStrip.get(), colorBackground));
+
+            // Draw every character in its own cell, clipped to it.
+            for (size_t i = 0; i < s_cchStrip; i++)
+            {
+                const wchar_t wch = gsl::narrow_cast<wchar_t>(s_wchFirst + i);
+                RECT rcCell;
+                rcCell.left = gsl::narrow<LONG>(i * coordFontSize.X);
+                rcCell.top = 0;
+                rcCell.right = rcCell.left + coordFontSize.X;
+                rcCell.bottom = coordFontSize.Y;
+                RETURN_HR_IF(E_FAIL, !(ExtTextOutW(_hdcStrip.get(), rcCell.left, rcCell.top, ETO_OPAQUE | ETO_CLIPPED, &rcCell, &wch, 1, nullptr)));
+            }
+
+            dropStripOnFailure.release();
+        }
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Puts the strip DC's own bitmap back, so that the strip that was selected
+//   can be thrown out.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void GdiGlyphCache::_DeselectStrip() noexcept
+{
+    if (_isStripSelected)
+    {
+        SelectObject(_hdcStrip.get(), _hbitmapOriginal);
+        _hbitmapOriginal = nullptr;
+        _isStripSelected = false;
+    }
+}
@@ -0,0 +1,84 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- glyphcache.hpp
+
+Abstract:
+- A cache of the printable ASCII characters already drawn by GDI, one strip of
+  cells for each foreground and background color pair. Text made only of those
+  characters is then copied out of the strip a cell at a time instead of being
+  laid out and rasterized by ExtTextOut again.
+- Each character is clipped to its own cell, so fonts that overhang their cells
+  look slightly different than they do through PolyTextOut. That's why the
+  cache is off unless it's asked for.
+--*/
+
+#pragma once
+
+#include "..\inc\Cluster.hpp"
+#include "..\..\types\inc\MemoryUsage.hpp"
+
+namespace Microsoft::Console::Render
+{
+    class GdiGlyphCache final
+    {
+    public:
+        GdiGlyphCache() noexcept;
+        ~GdiGlyphCache();
+
+        void Reset() noexcept;
+
+        Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+
+        [[nodiscard]]
+        static bool s_CanDraw(const std::basic_string_view<Cluster> clusters) noexcept;
+
+        [[nodiscard]]
+        HRESULT Draw(const HDC hdcTarget,
+                     const HFONT hfont,
+                     const COORD coordFontSize,
+                     const COLORREF colorForeground,
+                     const COLORREF colorBackground,
+                     const std::basic_string_view<Cluster> clusters,
+                     const POINT ptDraw) noexcept;
+
+    private:
+        struct Strip
+        {
+            COLORREF colorForeground;
+            COLORREF colorBackground;
+            wil::unique_hbitmap bitmap;
+        };
+
+        [[nodiscard]]
+        HRESULT _SelectStrip(const HDC hdcTarget,
+                             const HFONT hfont,
+                             const COORD coordFontSize,
+                             const COLORREF colorForeground,
+                             const COLORREF colorBackground) noexcept;
+
+        void _DeselectStrip() noexcept;
+
+        static constexpr wchar_t s_wchFirst = L' ';
+        static constexpr wchar_t s_wchLast = L'~';
+        static constexpr size_t s_cchStrip = s_wchLast - s_wchFirst + 1;
+
+        // The most color pairs kept at once. The one used longest ago goes first.
+        static constexpr size_t s_cStripsMax = 16;
+
+        // The strips are all drawn with this DC, with whichever one is in use
+        // selected into it.
+        wil::unique_hdc _hdcStrip;
+        HGDIOBJ _hbitmapOriginal;
+        HGDIOBJ _hfontOriginal;
+
+        // The least recently used strip is at the front, and the one selected
+        // into _hdcStrip, if any, is at the back.
+        std::vector<Strip> _strips;
+        bool _isStripSelected;
+
+        COORD _coordFontSize;
+    };
+}
@@ -33,6 +33,15 @@ HRESULT GdiEngine::InvalidateScroll(const COORD* const pcoordDelta) noexcept
 {
     if (pcoordDelta->X != 0 || pcoordDelta->Y != 0)
     {
+        // The whole frame can't move along with just part of it, so whatever
+        // part was going to move just gets painted instead.
+        if (_szInvalidScrollRegion.cx != 0 || _szInvalidScrollRegion.cy != 0)
+        {
+            RETURN_IF_FAILED(_InvalidateRect(&_rcScrollRegion));
+            _szInvalidScrollRegion = { 0 };
+            _rcScrollRegion = { 0 };
+        }
+
         POINT ptDelta = { 0 };
         RETURN_IF_FAILED(_ScaleByFont(pcoordDelta, &ptDelta));
 
@@ -49,6 +58,48 @@ HRESULT GdiEngine::InvalidateScroll(const COORD* const pcoordDelta) noexcept
     return S_OK;
 }
 
+// Routine Description:
+// - Notifies us that the console has moved the contents of just part of the
+//   screen area, like inside of the margins. Only what's uncovered by the move
+//   has to be painted again.
+// Arguments:
+// - psrRegion - Character region (SMALL_RECT) that the contents moved inside of
+// - pcoordDelta - Pointer to character dimension (COORD) of the distance the contents moved
+// Return Value:
+// - HRESULT S_OK, GDI-based error code, or safemath error
+HRESULT GdiEngine::InvalidateScrollRegion(const SMALL_RECT* const psrRegion, const COORD* const pcoordDelta) noexcept
+{
+    RETURN_HR_IF(S_OK, pcoordDelta->X == 0 && pcoordDelta->Y == 0);
+
+    RECT rcRegion = { 0 };
+    RETURN_IF_FAILED(_ScaleByFont(psrRegion, &rcRegion));
+
+    // We can only move one region per frame, and not on top of moving the
+    // whole frame. If something else is already going to move, this region
+    // just gets painted instead.
+    const bool fRegionScrollPending = _szInvalidScrollRegion.cx != 0 || _szInvalidScrollRegion.cy != 0;
+    if ((_szInvalidScroll.cx != 0 || _szInvalidScroll.cy != 0) ||
+        (fRegionScrollPending && !EqualRect(&rcRegion, &_rcScrollRegion)))
+    {
+        RETURN_HR(_InvalidateRect(&rcRegion));
+    }
+
+    POINT ptDelta = { 0 };
+    RETURN_IF_FAILED(_ScaleByFont(pcoordDelta, &ptDelta));
+
+    SIZE szInvalidScrollNew;
+    RETURN_IF_FAILED(LongAdd(_szInvalidScrollRegion.cx, ptDelta.x, &szInvalidScrollNew.cx));
+    RETURN_IF_FAILED(LongAdd(_szInvalidScrollRegion.cy, ptDelta.y, &szInvalidScrollNew.cy));
+
+    RETURN_IF_FAILED(_InvalidOffsetInside(&rcRegion, &ptDelta));
+
+    // Store if safemath succeeded
+    _szInvalidScrollRegion = szInvalidScrollNew;
+    _rcScrollRegion = rcRegion;
+
+    return S_OK;
+}
+
 // Routine Description:
 // - Notifies us that the console has changed the selection region and would like it updated
 // Arguments:
@@ -193,6 +244,38 @@ HRESULT GdiEngine::_InvalidOffset(const POINT* const ppt) noexcept
     return S_OK;
 }
 
+// Routine Description:
+// - Helper to adjust the invalid region when only part of the frame scrolls.
+//   Whatever part of the invalid region is inside of the scrolled part gets moved
+//   along with it, and what's left behind stays invalid.
+// Arguments:
+// - prcRegion - Pixel region (RECT) that scrolled
+// - ppt - Distances by which the contents of the region moved
+// Return Value:
+// - S_OK, GDI related failure, or safemath failure.
+HRESULT GdiEngine::_InvalidOffsetInside(const RECT* const prcRegion, const POINT* const ppt) noexcept
+{
+    RECT rcMoving;
+    if (_fInvalidRectUsed && IntersectRect(&rcMoving, &_rcInvalid, prcRegion))
+    {
+        RECT rcMoved;
+
+        RETURN_IF_FAILED(LongAdd(rcMoving.left, ppt->x, &rcMoved.left));
+        RETURN_IF_FAILED(LongAdd(rcMoving.right, ppt->x, &rcMoved.right));
+        RETURN_IF_FAILED(LongAdd(rcMoving.top, ppt->y, &rcMoved.top));
+        RETURN_IF_FAILED(LongAdd(rcMoving.bottom, ppt->y, &rcMoved.bottom));
+
+        // Whatever moved past the edge of the region is gone.
+        RECT rcInside;
+        if (IntersectRect(&rcInside, &rcMoved, prcRegion))
+        {
+            RETURN_IF_FAILED(_InvalidCombine(&rcInside));
+        }
+    }
+
+    return S_OK;
+}
+
 // Routine Description:
 // - Helper to ensure the invalid region remains within the bounds of the window.
 // Arguments:
@@ -42,6 +42,13 @@ HRESULT GdiEngine::IsGlyphWideByFont(const std::wstring_view glyph, _Out_ bool*
 
     if (glyph.size() == 1)
     {
+        const auto cached = _glyphWidthCache.Find(glyph);
+        if (cached.has_value())
+        {
+            *pResult = cached.value();
+            return S_OK;
+        }
+
         const wchar_t wch = glyph.front();
         if (_IsFontTrueType())
         {
@@ -61,6 +68,12 @@ HRESULT GdiEngine::IsGlyphWideByFont(const std::wstring_view glyph, _Out_ bool*
                 isFullWidth = cpxWidth > _GetFontSize().X;
             }
         }
+
+        try
+        {
+            _glyphWidthCache.Store(glyph, isFullWidth);
+        }
+        CATCH_LOG();
     }
     else
     {
@@ -73,6 +86,35 @@ HRESULT GdiEngine::IsGlyphWideByFont(const std::wstring_view glyph, _Out_ bool*
     return S_OK;
 }
 
+// Routine Description:
+// - Adds up what the engine's caches are holding: the strips of glyphs, the
+//   glyph widths, and the buffers the text of a frame is gathered in.
+// Arguments:
+// - <none>
+// Return Value:
+// - The bytes and allocations of the caches.
+Microsoft::Console::Types::MemoryUsage GdiEngine::GetCacheMemoryUsage() const noexcept
+{
+    auto usage = _glyphWidthCache.MeasureMemory();
+    if (_glyphCache)
+    {
+        usage.AddAllocation(sizeof(GdiGlyphCache));
+        usage += _glyphCache->MeasureMemory();
+    }
+    for (size_t i = 0; i < s_cPolyTextCache; ++i)
+    {
+        usage.AddContiguous(_polyStrings.at(i));
+        usage.AddContiguous(_polyWidths.at(i));
+    }
+    usage.AddContiguous(_fontCache);
+    for (const auto& cached : _fontCache)
+    {
+        usage.AddContiguous(cached.faceName);
+        usage.AddContiguous(cached.chosenFaceName);
+    }
+    return usage;
+}
+
 // Routine Description:
 // - Scales a character region (SMALL_RECT) into a pixel region (RECT) by the current font size.
 // Arguments:
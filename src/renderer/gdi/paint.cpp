@@ -68,7 +68,9 @@ HRESULT GdiEngine::StartPaint() noexcept
 HRESULT GdiEngine::ScrollFrame() noexcept
 {
     // If we don't have any scrolling to do, return early.
-    RETURN_HR_IF(S_OK, 0 == _szInvalidScroll.cx && 0 == _szInvalidScroll.cy);
+    RETURN_HR_IF(S_OK,
+                 0 == _szInvalidScroll.cx && 0 == _szInvalidScroll.cy &&
+                 0 == _szInvalidScrollRegion.cx && 0 == _szInvalidScrollRegion.cy);
 
     // If we have an inverted cursor, we have to see if we have to clean it before we scroll to prevent
     // left behind cursor copies in the scrolled region.
@@ -97,10 +99,18 @@ HRESULT GdiEngine::ScrollFrame() noexcept
     RETURN_IF_FAILED(LongSub(_szMemorySurface.cx, szGutter.cx, &rcScrollLimit.right));
     RETURN_IF_FAILED(LongSub(_szMemorySurface.cy, szGutter.cy, &rcScrollLimit.bottom));
 
+    // If only part of the frame scrolled, only that part can move.
+    SIZE szScroll = _szInvalidScroll;
+    if (0 != _szInvalidScrollRegion.cx || 0 != _szInvalidScrollRegion.cy)
+    {
+        szScroll = _szInvalidScrollRegion;
+        RETURN_HR_IF(S_OK, !IntersectRect(&rcScrollLimit, &rcScrollLimit, &_rcScrollRegion));
+    }
+
     // Scroll real window and memory buffer in-sync.
     LOG_LAST_ERROR_IF(!ScrollWindowEx(_hwndTargetWindow,
-                                      _szInvalidScroll.cx,
-                                      _szInvalidScroll.cy,
+                                      szScroll.cx,
+                                      szScroll.cy,
                                       &rcScrollLimit,
                                       &rcScrollLimit,
                                       nullptr,
@@ -108,7 +118,7 @@ HRESULT GdiEngine::ScrollFrame() noexcept
                                       0));
 
     RECT rcUpdate = { 0 };
-    LOG_HR_IF(E_FAIL, !(ScrollDC(_hdcMemoryContext, _szInvalidScroll.cx, _szInvalidScroll.cy, &rcScrollLimit, &rcScrollLimit, nullptr, &rcUpdate)));
+    LOG_HR_IF(E_FAIL, !(ScrollDC(_hdcMemoryContext, szScroll.cx, szScroll.cy, &rcScrollLimit, &rcScrollLimit, nullptr, &rcUpdate)));
 
     LOG_IF_FAILED(_InvalidCombine(&rcUpdate));
 
@@ -208,6 +218,8 @@ HRESULT GdiEngine::EndPaint() noexcept
     _rcInvalid = { 0 };
     _fInvalidRectUsed = false;
     _szInvalidScroll = { 0 };
+    _szInvalidScrollRegion = { 0 };
+    _rcScrollRegion = { 0 };
 
     LOG_HR_IF(E_FAIL, !(GdiFlush()));
     LOG_HR_IF(E_FAIL, !(ReleaseDC(_hwndTargetWindow, _psInvalidData.hdc)));
@@ -307,15 +319,25 @@ HRESULT GdiEngine::PaintBufferLine(std::basic_string_view<Cluster> const cluster
         POINT ptDraw = { 0 };
         RETURN_IF_FAILED(_ScaleByFont(&coord, &ptDraw));
 
-        const auto pPolyTextLine = &_pPolyText[_cPolyText];
+        COORD const coordFontSize = _GetFontSize();
 
-        auto pwsPoly = std::make_unique<wchar_t[]>(cchLine);
-        RETURN_IF_NULL_ALLOC(pwsPoly);
+        // A line of plain ASCII can be copied from the glyphs drawn before in
+        // the same colors. Raster fonts are left to PolyTextOut, since their
+        // text goes through the font's codepage.
+        if (_glyphCache && _isTrueTypeFont && !trimLeft &&
+            _lastFg != INVALID_COLOR && _lastBg != INVALID_COLOR &&
+            GdiGlyphCache::s_CanDraw(clusters))
+        {
+            RETURN_HR(_glyphCache->Draw(_hdcMemoryContext, _hfont, coordFontSize, _lastFg, _lastBg, clusters, ptDraw));
+        }
 
-        COORD const coordFontSize = _GetFontSize();
+        const auto pPolyTextLine = &_pPolyText[_cPolyText];
 
-        auto rgdxPoly = std::make_unique<int[]>(cchLine);
-        RETURN_IF_NULL_ALLOC(rgdxPoly);
+        // Reuse this line's buffers from the last time it was painted.
+        auto& polyString = _polyStrings.at(_cPolyText);
+        auto& polyWidths = _polyWidths.at(_cPolyText);
+        polyString.resize(cchLine);
+        polyWidths.resize(cchLine);
 
         // Sum up the total widths the entire line/run is expected to take while
         // copying the pixel widths into a structure to direct GDI how many pixels to use per character.
@@ -328,9 +350,9 @@ HRESULT GdiEngine::PaintBufferLine(std::basic_string_view<Cluster> const cluster
 
             // Our GDI renderer hasn't and isn't going to handle things above U+FFFF or sequences. 
             // So replace anything complicated with a replacement character for drawing purposes.
-            pwsPoly[i] = cluster.GetTextAsSingle();
-            rgdxPoly[i] = gsl::narrow<int>(cluster.GetColumns()) * coordFontSize.X;
-            cchCharWidths += rgdxPoly[i];
+            polyString.at(i) = cluster.GetTextAsSingle();
+            polyWidths.at(i) = gsl::narrow<int>(cluster.GetColumns()) * coordFontSize.X;
+            cchCharWidths += polyWidths.at(i);
         }
 
         // Detect and convert for raster font...
@@ -339,40 +361,35 @@ HRESULT GdiEngine::PaintBufferLine(std::basic_string_view<Cluster> const cluster
             // dispatch conversion into our codepage
 
             // Find out the bytes required
-            int const cbRequired = WideCharToMultiByte(_fontCodepage, 0, pwsPoly.get(), (int)cchLine, nullptr, 0, nullptr, nullptr);
+            int const cbRequired = WideCharToMultiByte(_fontCodepage, 0, polyString.data(), (int)cchLine, nullptr, 0, nullptr, nullptr);
 
             if (cbRequired != 0)
             {
-                // Allocate buffer for MultiByte
-                auto psConverted = std::make_unique<char[]>(cbRequired);
+                // Size buffer for MultiByte
+                _polyConvertBuffer.resize(cbRequired);
 
                 // Attempt conversion to current codepage
-                int const cbConverted = WideCharToMultiByte(_fontCodepage, 0, pwsPoly.get(), (int)cchLine, psConverted.get(), cbRequired, nullptr, nullptr);
+                int const cbConverted = WideCharToMultiByte(_fontCodepage, 0, polyString.data(), (int)cchLine, _polyConvertBuffer.data(), cbRequired, nullptr, nullptr);
 
                 // If successful...
                 if (cbConverted != 0)
                 {
                     // Now we have to convert back to Unicode but using the system ANSI codepage. Find buffer size first.
-                    int const cchRequired = MultiByteToWideChar(CP_ACP, 0, psConverted.get(), cbRequired, nullptr, 0);
+                    int const cchRequired = MultiByteToWideChar(CP_ACP, 0, _polyConvertBuffer.data(), cbRequired, nullptr, 0);
 
                     if (cchRequired != 0)
                     {
-                        auto pwsConvert = std::make_unique<wchar_t[]>(cchRequired);
-
-                        // Then do the actual conversion.
-                        int const cchConverted = MultiByteToWideChar(CP_ACP, 0, psConverted.get(), cbRequired, pwsConvert.get(), cchRequired);
-
-                        if (cchConverted != 0)
-                        {
-                            // If all successful, use this instead.
-                            pwsPoly.swap(pwsConvert);
-                        }
+                        // Then do the actual conversion, back into the line's own buffer.
+                        // It's kept at least as long as the line, which is what's drawn.
+                        polyString.resize(std::max<size_t>(cchRequired, cchLine));
+                        int const cchConverted = MultiByteToWideChar(CP_ACP, 0, _polyConvertBuffer.data(), cbRequired, polyString.data(), cchRequired);
+                        LOG_LAST_ERROR_IF(cchConverted == 0);
                     }
                 }
             }
         }
 
-        pPolyTextLine->lpstr = pwsPoly.release();
+        pPolyTextLine->lpstr = polyString.data();
         pPolyTextLine->n = gsl::narrow<UINT>(clusters.size());
         pPolyTextLine->x = ptDraw.x;
         pPolyTextLine->y = ptDraw.y;
@@ -381,7 +398,7 @@ HRESULT GdiEngine::PaintBufferLine(std::basic_string_view<Cluster> const cluster
         pPolyTextLine->rcl.top = pPolyTextLine->y;
         pPolyTextLine->rcl.right = pPolyTextLine->rcl.left + ((SHORT)cchCharWidths * coordFontSize.X);
         pPolyTextLine->rcl.bottom = pPolyTextLine->rcl.top + coordFontSize.Y;
-        pPolyTextLine->pdx = rgdxPoly.release();
+        pPolyTextLine->pdx = polyWidths.data();
 
         if (trimLeft)
         {
@@ -401,7 +418,8 @@ HRESULT GdiEngine::PaintBufferLine(std::basic_string_view<Cluster> const cluster
 }
 
 // Routine Description:
-// - Flushes any buffer lines in the PolyTextOut cache by drawing them and freeing the strings.
+// - Flushes any buffer lines in the PolyTextOut cache by drawing them. Their
+//   buffers are kept for the lines painted after.
 // - See also: PaintBufferLine
 // Arguments:
 // - <none>
@@ -419,21 +437,6 @@ HRESULT GdiEngine::_FlushBufferLines() noexcept
             hr = E_FAIL;
         }
 
-        for (size_t iPoly = 0; iPoly < _cPolyText; iPoly++)
-        {
-            if (nullptr != _pPolyText[iPoly].lpstr)
-            {
-                delete[] _pPolyText[iPoly].lpstr;
-                _pPolyText[iPoly].lpstr = nullptr;
-            }
-
-            if (nullptr != _pPolyText[iPoly].pdx)
-            {
-                delete[] _pPolyText[iPoly].pdx;
-                _pPolyText[iPoly].pdx = nullptr;
-            }
-        }
-
         _cPolyText = 0;
     }
 
@@ -35,6 +35,8 @@ GdiEngine::GdiEngine() :
     ZeroMemory(_pPolyText, sizeof(POLYTEXTW) * s_cPolyTextCache);
     _rcInvalid = { 0 };
     _szInvalidScroll = { 0 };
+    _szInvalidScrollRegion = { 0 };
+    _rcScrollRegion = { 0 };
     _szMemorySurface = { 0 };
 
     _hdcMemoryContext = CreateCompatibleDC(nullptr);
@@ -68,13 +70,8 @@ GdiEngine::GdiEngine() :
 // - <none>
 GdiEngine::~GdiEngine()
 {
-    for (size_t iPoly = 0; iPoly < _cPolyText; iPoly++)
-    {
-        if (_pPolyText[iPoly].lpstr != nullptr)
-        {
-            delete[] _pPolyText[iPoly].lpstr;
-        }
-    }
+    // Let go of the cached glyphs first, so the font isn't still in use below.
+    _glyphCache.reset();
 
     if (_hbitmapMemorySurface != nullptr)
     {
@@ -82,11 +79,8 @@ GdiEngine::~GdiEngine()
         _hbitmapMemorySurface = nullptr;
     }
 
-    if (_hfont != nullptr)
-    {
-        LOG_HR_IF(E_FAIL, !(DeleteObject(_hfont)));
-        _hfont = nullptr;
-    }
+    // The font is deleted along with the rest of the cache, once the context is gone.
+    _hfont = nullptr;
 
     if (_hdcMemoryContext != nullptr)
     {
@@ -123,6 +117,12 @@ HRESULT GdiEngine::SetHwnd(const HWND hwnd) noexcept
     _hwndTargetWindow = hwnd;
     _hdcMemoryContext = hdcNewMemoryContext;
 
+    // The cached glyphs were made to match the old context.
+    if (_glyphCache)
+    {
+        _glyphCache->Reset();
+    }
+
     // If we have a font, apply it to the context.
     if (nullptr != _hfont)
     {
@@ -147,6 +147,31 @@ HRESULT GdiEngine::SetHwnd(const HWND hwnd) noexcept
     return S_OK;
 }
 
+// Routine Description:
+// - Turns the cache of printable ASCII glyphs on or off. With it on, lines made
+//   only of those characters are copied out of glyphs drawn earlier in the same
+//   colors, instead of being drawn by GDI every time. It's off to begin with,
+//   since each cached character is clipped to its cell.
+// - See also: GdiGlyphCache
+// Arguments:
+// - enabled - Whether to use the cache
+// Return Value:
+// - <none>
+void GdiEngine::SetGlyphCacheEnabled(const bool enabled) noexcept
+{
+    if (enabled == static_cast<bool>(_glyphCache))
+    {
+        return;
+    }
+
+    try
+    {
+        _glyphCache = enabled ? std::make_unique<GdiGlyphCache>() : nullptr;
+        LOG_IF_FAILED(InvalidateAll());
+    }
+    CATCH_LOG();
+}
+
 // Routine Description:
 // - This routine will help call SetWindowLongW with the correct semantics to retrieve the appropriate error code.
 // Arguments:
@@ -229,11 +254,11 @@ HRESULT GdiEngine::UpdateDrawingBrushes(const COLORREF colorForeground,
 [[nodiscard]]
 HRESULT GdiEngine::UpdateFont(const FontInfoDesired& FontDesired, _Out_ FontInfo& Font) noexcept
 {
-    wil::unique_hfont hFont;
+    HFONT hFont = nullptr;
     RETURN_IF_FAILED(_GetProposedFont(FontDesired, Font, _iCurrentDpi, hFont));
 
     // Select into DC
-    RETURN_HR_IF_NULL(E_FAIL, SelectFont(_hdcMemoryContext, hFont.get()));
+    RETURN_HR_IF_NULL(E_FAIL, SelectFont(_hdcMemoryContext, hFont));
 
     // Save off the font metrics for various other calculations
     RETURN_HR_IF(E_FAIL, !(GetTextMetricsW(_hdcMemoryContext, &_tmFontMetrics)));
@@ -241,20 +266,32 @@ HRESULT GdiEngine::UpdateFont(const FontInfoDesired& FontDesired, _Out_ FontInfo
     // Now find the size of a 0 in this current font and save it for conversions done later.
     _coordFontLast = Font.GetSize();
 
-    // Persist font for cleanup (and free existing if necessary)
-    if (_hfont != nullptr)
+    // The cached glyphs are in the old font. If it's the same font again, they still fit.
+    if (_glyphCache && hFont != _hfont)
     {
-        LOG_HR_IF(E_FAIL, !(DeleteObject(_hfont)));
-        _hfont = nullptr;
+        _glyphCache->Reset();
     }
 
-    // Save the font.
-    _hfont = hFont.release();
+    // Save the font. It belongs to the font cache.
+    _hfont = hFont;
 
     // Save raster vs. TrueType and codepage data in case we need to convert.
     _isTrueTypeFont = Font.IsTrueTypeFont();
     _fontCodepage = Font.GetCodePage();
 
+    // A TrueType face is the same shape at every size, but each size of a raster
+    // font is drawn from its own bitmaps, so its glyphs are measured again.
+    try
+    {
+        std::wstring face{ Font.GetFaceName() };
+        if (!_isTrueTypeFont)
+        {
+            face += L' ' + std::to_wstring(_coordFontLast.X) + L'x' + std::to_wstring(_coordFontLast.Y);
+        }
+        _glyphWidthCache.SetFace(face);
+    }
+    CATCH_LOG();
+
     LOG_IF_FAILED(InvalidateAll());
 
     return S_OK;
@@ -300,7 +337,7 @@ HRESULT GdiEngine::UpdateViewport(const SMALL_RECT /*srNewViewport*/) noexcept
 [[nodiscard]]
 HRESULT GdiEngine::GetProposedFont(const FontInfoDesired& FontDesired, _Out_ FontInfo& Font, const int iDpi) noexcept
 {
-    wil::unique_hfont hFont;
+    HFONT hFont = nullptr;
     return _GetProposedFont(FontDesired, Font, iDpi, hFont);
 }
 
@@ -321,20 +358,103 @@ HRESULT GdiEngine::_DoUpdateTitle(_In_ const std::wstring& /*newTitle*/) noexcep
 // Routine Description:
 // - This method will figure out what the new font should be given the starting font information and a DPI.
 // - When the final font is determined, the FontInfo structure given will be updated with the actual resulting font chosen as the nearest match.
-// - NOTE: It is left up to the underling rendering system to choose the nearest font. Please ask for the font dimensions if they are required using the interface. Do not use the size you requested with this structure.
-// - If the intent is to immediately turn around and use this font, pass the optional handle parameter and use it immediately.
+// - If the same font was asked for at the same DPI before, the font that was made then is given back
+//   again, without creating or measuring anything.
 // Arguments:
 // - FontDesired - reference to font information we should use while instantiating a font.
 // - Font - the actual font
 // - iDpi - The DPI we will have when rendering
-// - hFont - A smart pointer to receive a handle to a ready-to-use GDI font.
+// - hFont - Receives a handle to a ready-to-use GDI font. It belongs to the font cache.
 // Return Value:
 // - S_OK if set successfully or relevant GDI error via HRESULT.
 [[nodiscard]]
 HRESULT GdiEngine::_GetProposedFont(const FontInfoDesired& FontDesired,
                                     _Out_ FontInfo& Font,
                                     const int iDpi,
-                                    _Inout_ wil::unique_hfont& hFont) noexcept
+                                    _Out_ HFONT& hFont) noexcept
+{
+    hFont = nullptr;
+    try
+    {
+        const std::wstring_view faceName{ FontDesired.GetFaceName() };
+        const COORD engineSize = FontDesired.GetEngineSize();
+
+        auto found = std::find_if(_fontCache.begin(), _fontCache.end(), [&](const _CachedFont& cached) {
+            return cached.faceName == faceName &&
+                   cached.engineSize.X == engineSize.X &&
+                   cached.engineSize.Y == engineSize.Y &&
+                   cached.weight == FontDesired.GetWeight() &&
+                   cached.family == FontDesired.GetFamily() &&
+                   cached.codePage == FontDesired.GetCodePage() &&
+                   cached.dpi == iDpi;
+        });
+
+        if (found != _fontCache.end())
+        {
+            std::rotate(found, std::next(found), _fontCache.end());
+        }
+        else
+        {
+            wil::unique_hfont hFontNew;
+            RETURN_IF_FAILED(_CreateFont(FontDesired, Font, iDpi, hFontNew));
+
+            // Make room by letting go of the font that was used longest ago, unless it's the one selected.
+            if (_fontCache.size() >= s_cMaxCachedFonts)
+            {
+                const auto evicted = std::find_if(_fontCache.begin(), _fontCache.end(), [&](const _CachedFont& cached) {
+                    return cached.hfont.get() != _hfont;
+                });
+                if (evicted != _fontCache.end())
+                {
+                    _fontCache.erase(evicted);
+                }
+            }
+
+            _CachedFont cached{};
+            cached.faceName = faceName;
+            cached.engineSize = engineSize;
+            cached.weight = FontDesired.GetWeight();
+            cached.family = FontDesired.GetFamily();
+            cached.codePage = FontDesired.GetCodePage();
+            cached.dpi = iDpi;
+            cached.hfont = std::move(hFontNew);
+            cached.chosenFaceName = Font.GetFaceName();
+            cached.chosenFamily = Font.GetFamily();
+            cached.chosenWeight = Font.GetWeight();
+            cached.size = Font.GetSize();
+            cached.unscaledSize = Font.GetUnscaledSize();
+            _fontCache.push_back(std::move(cached));
+        }
+
+        const auto& cached = _fontCache.back();
+        Font.SetFromEngine(cached.chosenFaceName.c_str(),
+                           cached.chosenFamily,
+                           cached.chosenWeight,
+                           FontDesired.IsDefaultRasterFont(),
+                           cached.size,
+                           cached.unscaledSize);
+        hFont = cached.hfont.get();
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Creates the font that _GetProposedFont gives back, and measures it.
+// - NOTE: It is left up to the underling rendering system to choose the nearest font. Please ask for the font dimensions if they are required using the interface. Do not use the size you requested with this structure.
+// Arguments:
+// - FontDesired - reference to font information we should use while instantiating a font.
+// - Font - the actual font
+// - iDpi - The DPI we will have when rendering
+// - hFont - A smart pointer to receive a handle to a ready-to-use GDI font.
+// Return Value:
+// - S_OK if set successfully or relevant GDI error via HRESULT.
+[[nodiscard]]
+HRESULT GdiEngine::_CreateFont(const FontInfoDesired& FontDesired,
+                               _Out_ FontInfo& Font,
+                               const int iDpi,
+                               _Inout_ wil::unique_hfont& hFont) noexcept
 {
     wil::unique_hdc hdcTemp(CreateCompatibleDC(_hdcMemoryContext));
     RETURN_HR_IF_NULL(E_FAIL, hdcTemp.get());
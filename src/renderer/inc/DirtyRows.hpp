@@ -0,0 +1,47 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- DirtyRows.hpp
+
+Abstract:
+- Keeps track of which columns of each row of the screen need to be painted
+  again, rather than just one rectangle around all of them.
+- A cursor blinking at the top of the screen and a status line changing at
+  the bottom only cost those two rows, not everything in between.
+--*/
+
+#pragma once
+
+namespace Microsoft::Console::Render
+{
+    class DirtyRows final
+    {
+    public:
+        DirtyRows() noexcept;
+
+        void Resize(const COORD size);
+
+        void Add(const SMALL_RECT exclusive) noexcept;
+        void Offset(const COORD delta);
+        void OffsetInside(const SHORT deltaY, const SHORT top, const SHORT bottom);
+        void Clear() noexcept;
+
+        std::vector<SMALL_RECT> GetSpans(const SHORT firstRow) const;
+
+    private:
+        // The dirty columns of one row, from left up to (not including) right.
+        //      The row is clean if left isn't less than right.
+        struct Span
+        {
+            SHORT left;
+            SHORT right;
+        };
+
+        COORD _size;
+        std::vector<Span> _rows;
+
+        void _Or(const SHORT row, const SHORT left, const SHORT right) noexcept;
+    };
+}
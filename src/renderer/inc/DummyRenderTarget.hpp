@@ -29,6 +29,9 @@ public:
     void TriggerSelection() override {}
     void TriggerScroll() override {}
     void TriggerScroll(const COORD* const /*pcoordDelta*/) override {}
+    void TriggerScroll(const Microsoft::Console::Types::Viewport& /*region*/, const COORD* const /*pcoordDelta*/) override {}
     void TriggerCircling() override {}
     void TriggerTitleChange() override {}
+    void BeginBatch() override {}
+    void EndBatch() override {}
 };
@@ -0,0 +1,42 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- GlyphWidthCache.hpp
+
+Abstract:
+- Remembers which glyphs a render engine has measured as wide in its font, so
+  each one is only measured with the font APIs once.
+- Whether a glyph takes up one cell or two follows from its shape in the face,
+  not from the size it's drawn at. So the measurements are kept while the size
+  or DPI changes, and only dropped when the face does.
+--*/
+
+#pragma once
+
+#include "../../types/inc/MemoryUsage.hpp"
+
+namespace Microsoft::Console::Render
+{
+    class GlyphWidthCache final
+    {
+    public:
+        void SetFace(const std::wstring_view face);
+
+        std::optional<bool> Find(const std::wstring_view glyph) const noexcept;
+        void Store(const std::wstring_view glyph, const bool isWide);
+
+        Microsoft::Console::Types::MemoryUsage MeasureMemory() const noexcept;
+
+    private:
+        // Plenty for the ambiguous and fallback glyphs a session runs into, and
+        // small enough to start over when it fills up.
+        static constexpr size_t s_MaxEntries = 4096;
+
+        static std::optional<char32_t> s_GetCodepoint(const std::wstring_view glyph) noexcept;
+
+        std::wstring _face;
+        std::unordered_map<char32_t, bool> _widths;
+    };
+}
@@ -17,6 +17,7 @@ Author(s):
 #include "../../inc/conattrs.hpp"
 #include "Cluster.hpp"
 #include "FontInfoDesired.hpp"
+#include "../../types/inc/MemoryUsage.hpp"
 
 namespace Microsoft::Console::Render
 {
@@ -72,6 +73,11 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         virtual HRESULT Present() noexcept = 0;
 
+        // Blocks until the display can take another frame. Returns S_FALSE if the
+        //      engine can't tell, and the frames should be paced some other way.
+        [[nodiscard]]
+        virtual HRESULT WaitUntilCanRender() noexcept = 0;
+
         [[nodiscard]]
         virtual HRESULT PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept = 0;
 
@@ -89,6 +95,8 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         virtual HRESULT InvalidateScroll(const COORD* const pcoordDelta) noexcept = 0;
         [[nodiscard]]
+        virtual HRESULT InvalidateScrollRegion(const SMALL_RECT* const psrRegion, const COORD* const pcoordDelta) noexcept = 0;
+        [[nodiscard]]
         virtual HRESULT InvalidateAll() noexcept = 0;
         [[nodiscard]]
         virtual HRESULT InvalidateCircling(_Out_ bool* const pForcePaint) noexcept = 0;
@@ -133,12 +141,17 @@ namespace Microsoft::Console::Render
                                         const int iDpi) noexcept = 0;
 
         virtual SMALL_RECT GetDirtyRectInChars() = 0;
+        virtual std::vector<SMALL_RECT> GetDirtyArea() = 0;
         [[nodiscard]]
         virtual HRESULT GetFontSize(_Out_ COORD* const pFontSize) noexcept = 0;
         [[nodiscard]]
         virtual HRESULT IsGlyphWideByFont(const std::wstring_view glyph, _Out_ bool* const pResult) noexcept = 0;
         [[nodiscard]]
         virtual HRESULT UpdateTitle(const std::wstring& newTitle) noexcept = 0;
+
+        // What the engine is holding on to so it doesn't have to do the same work
+        // in every frame: glyphs, shaped text, brushes and the like.
+        virtual Microsoft::Console::Types::MemoryUsage GetCacheMemoryUsage() const noexcept = 0;
     };
 
     inline Microsoft::Console::Render::IRenderEngine::~IRenderEngine() { }
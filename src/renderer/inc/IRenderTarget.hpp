@@ -35,10 +35,38 @@ namespace Microsoft::Console::Render
         virtual void TriggerSelection() = 0;
         virtual void TriggerScroll() = 0;
         virtual void TriggerScroll(const COORD* const pcoordDelta) = 0;
+        virtual void TriggerScroll(const Microsoft::Console::Types::Viewport& region, const COORD* const pcoordDelta) = 0;
         virtual void TriggerCircling() = 0;
         virtual void TriggerTitleChange() = 0;
+
+        virtual void BeginBatch() = 0;
+        virtual void EndBatch() = 0;
     };
 
     inline Microsoft::Console::Render::IRenderTarget::~IRenderTarget() { }
 
+    // Holds back the redraws a render target is asked for, from when this is
+    //      created until it goes out of scope, and hands them over all at once.
+    //      Wrap anything that writes a lot of small pieces, like a run of text.
+    class RenderTargetBatch final
+    {
+    public:
+        explicit RenderTargetBatch(IRenderTarget& target) :
+            _target{ target }
+        {
+            _target.BeginBatch();
+        }
+
+        ~RenderTargetBatch()
+        {
+            _target.EndBatch();
+        }
+
+        RenderTargetBatch(const RenderTargetBatch&) = delete;
+        RenderTargetBatch& operator=(const RenderTargetBatch&) = delete;
+
+    private:
+        IRenderTarget& _target;
+    };
+
 }
@@ -29,6 +29,9 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         virtual HRESULT PaintFrame() = 0;
 
+        [[nodiscard]]
+        virtual HRESULT WaitUntilCanRender() = 0;
+
         virtual void TriggerSystemRedraw(const RECT* const prcDirtyClient) = 0;
 
         virtual void TriggerRedraw(const Microsoft::Console::Types::Viewport& region) = 0;
@@ -41,12 +44,19 @@ namespace Microsoft::Console::Render
         virtual void TriggerSelection() = 0;
         virtual void TriggerScroll() = 0;
         virtual void TriggerScroll(const COORD* const pcoordDelta) = 0;
+        virtual void TriggerScroll(const Microsoft::Console::Types::Viewport& region, const COORD* const pcoordDelta) = 0;
         virtual void TriggerCircling() = 0;
         virtual void TriggerTitleChange() = 0;
         virtual void TriggerFontChange(const int iDpi,
                                        const FontInfoDesired& FontInfoDesired,
                                        _Out_ FontInfo& FontInfo) = 0;
 
+        virtual void BeginBatch() = 0;
+        virtual void EndBatch() = 0;
+
+        virtual bool BeginPassThrough() = 0;
+        virtual void EndPassThrough() = 0;
+
         [[nodiscard]]
         virtual HRESULT GetProposedFont(const int iDpi,
                                         const FontInfoDesired& FontInfoDesired,
@@ -58,6 +68,8 @@ namespace Microsoft::Console::Render
         virtual void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) = 0;
 
         virtual void AddRenderEngine(_In_ IRenderEngine* const pEngine) = 0;
+
+        virtual Microsoft::Console::Types::MemoryUsage GetCacheMemoryUsage() = 0;
     };
 
     inline Microsoft::Console::Render::IRenderer::~IRenderer() { }
@@ -0,0 +1,296 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- NullRenderEngine.hpp
+
+Abstract:
+- Provides a render engine that draws nothing. It keeps track of what's been
+    invalidated the way a real engine would, so the renderer still does all of
+    its work, and it counts what the renderer hands it.
+- This is for measuring the renderer by itself, without the cost of GDI or
+    Direct3D in the way, and for tests that need an engine to paint to.
+--*/
+
+#pragma once
+#include "RenderEngineBase.hpp"
+
+namespace Microsoft::Console::Render
+{
+    class NullRenderEngine final : public RenderEngineBase
+    {
+    public:
+        // Everything the renderer has handed to the engine since the counts were last reset.
+        struct Counts
+        {
+            size_t frames;
+            size_t invalidations;
+            size_t bufferLines;
+            size_t clusters;
+            size_t gridLines;
+            size_t selections;
+            size_t cursors;
+            size_t brushChanges;
+        };
+
+        NullRenderEngine(const COORD fontSize = { 8, 16 }) noexcept :
+            _fontSize{ fontSize },
+            _viewport{ 0 },
+            _dirty{ 0 },
+            _dirtyUsed{ false },
+            _counts{}
+        {
+        }
+
+        const Counts& GetCounts() const noexcept
+        {
+            return _counts;
+        }
+
+        void ResetCounts() noexcept
+        {
+            _counts = Counts{};
+        }
+
+        [[nodiscard]]
+        HRESULT StartPaint() noexcept override
+        {
+            RETURN_HR_IF(S_FALSE, !_dirtyUsed && !_titleChanged);
+            ++_counts.frames;
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT EndPaint() noexcept override
+        {
+            _dirty = { 0 };
+            _dirtyUsed = false;
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT Present() noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept override
+        {
+            *pForcePaint = false;
+            return S_FALSE;
+        }
+
+        [[nodiscard]]
+        HRESULT ScrollFrame() noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT Invalidate(const SMALL_RECT* const psrRegion) noexcept override
+        {
+            ++_counts.invalidations;
+            _Combine(psrRegion->Left, psrRegion->Top, psrRegion->Right - 1, psrRegion->Bottom - 1);
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT InvalidateCursor(const COORD* const pcoordCursor) noexcept override
+        {
+            ++_counts.invalidations;
+            _Combine(pcoordCursor->X, pcoordCursor->Y, pcoordCursor->X, pcoordCursor->Y);
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT InvalidateSystem(const RECT* const /*prcDirtyClient*/) noexcept override
+        {
+            return InvalidateAll();
+        }
+
+        [[nodiscard]]
+        HRESULT InvalidateSelection(const std::vector<SMALL_RECT>& rectangles) noexcept override
+        {
+            for (const auto& rect : rectangles)
+            {
+                RETURN_IF_FAILED(Invalidate(&rect));
+            }
+            return S_OK;
+        }
+
+        // Like GDI, the frame is moved and only what's uncovered is painted.
+        [[nodiscard]]
+        HRESULT InvalidateScroll(const COORD* const pcoordDelta) noexcept override
+        {
+            if (pcoordDelta->X == 0 && pcoordDelta->Y == 0)
+            {
+                return S_OK;
+            }
+
+            ++_counts.invalidations;
+            if (_dirtyUsed)
+            {
+                _Combine(_dirty.Left + pcoordDelta->X,
+                         _dirty.Top + pcoordDelta->Y,
+                         _dirty.Right + pcoordDelta->X,
+                         _dirty.Bottom + pcoordDelta->Y);
+            }
+
+            const int width = _viewport.Right - _viewport.Left + 1;
+            const int height = _viewport.Bottom - _viewport.Top + 1;
+            if (pcoordDelta->Y < 0)
+            {
+                _Combine(0, height + pcoordDelta->Y, width - 1, height - 1);
+            }
+            else if (pcoordDelta->Y > 0)
+            {
+                _Combine(0, 0, width - 1, pcoordDelta->Y - 1);
+            }
+
+            if (pcoordDelta->X < 0)
+            {
+                _Combine(width + pcoordDelta->X, 0, width - 1, height - 1);
+            }
+            else if (pcoordDelta->X > 0)
+            {
+                _Combine(0, 0, pcoordDelta->X - 1, height - 1);
+            }
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT InvalidateAll() noexcept override
+        {
+            ++_counts.invalidations;
+            _Combine(0, 0, _viewport.Right - _viewport.Left, _viewport.Bottom - _viewport.Top);
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT InvalidateCircling(_Out_ bool* const pForcePaint) noexcept override
+        {
+            *pForcePaint = false;
+            return S_FALSE;
+        }
+
+        [[nodiscard]]
+        HRESULT PaintBackground() noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT PaintBufferLine(std::basic_string_view<Cluster> const clusters,
+                                const COORD /*coord*/,
+                                const bool /*fTrimLeft*/) noexcept override
+        {
+            ++_counts.bufferLines;
+            _counts.clusters += clusters.size();
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT PaintBufferGridLines(const GridLines /*lines*/,
+                                     const COLORREF /*color*/,
+                                     const size_t /*cchLine*/,
+                                     const COORD /*coordTarget*/) noexcept override
+        {
+            ++_counts.gridLines;
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT PaintSelection(const SMALL_RECT /*rect*/) noexcept override
+        {
+            ++_counts.selections;
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT PaintCursor(const CursorOptions& /*options*/) noexcept override
+        {
+            ++_counts.cursors;
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT UpdateDrawingBrushes(const COLORREF /*colorForeground*/,
+                                     const COLORREF /*colorBackground*/,
+                                     const WORD /*legacyColorAttribute*/,
+                                     const bool /*isBold*/,
+                                     const bool /*isSettingDefaultBrushes*/) noexcept override
+        {
+            ++_counts.brushChanges;
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT UpdateFont(const FontInfoDesired& /*FontInfoDesired*/,
+                           _Out_ FontInfo& /*FontInfo*/) noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT UpdateDpi(const int /*iDpi*/) noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT UpdateViewport(const SMALL_RECT srNewViewport) noexcept override
+        {
+            _viewport = srNewViewport;
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT GetProposedFont(const FontInfoDesired& /*FontInfoDesired*/,
+                                _Out_ FontInfo& /*FontInfo*/,
+                                const int /*iDpi*/) noexcept override { return S_OK; }
+
+        SMALL_RECT GetDirtyRectInChars() override
+        {
+            return _dirty;
+        }
+
+        [[nodiscard]]
+        HRESULT GetFontSize(_Out_ COORD* const pFontSize) noexcept override
+        {
+            *pFontSize = _fontSize;
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT IsGlyphWideByFont(const std::wstring_view /*glyph*/, _Out_ bool* const pResult) noexcept override
+        {
+            *pResult = false;
+            return S_OK;
+        }
+
+    protected:
+        [[nodiscard]]
+        HRESULT _DoUpdateTitle(const std::wstring& /*newTitle*/) noexcept override { return S_OK; }
+
+    private:
+        // Adds an inclusive rectangle, in characters relative to the viewport, to
+        //      what's dirty. Anything off of the viewport is ignored.
+        void _Combine(const int left, const int top, const int right, const int bottom) noexcept
+        {
+            const SMALL_RECT clipped{ gsl::narrow_cast<SHORT>(std::max(left, 0)),
+                                      gsl::narrow_cast<SHORT>(std::max(top, 0)),
+                                      gsl::narrow_cast<SHORT>(std::min(right, _viewport.Right - _viewport.Left)),
+                                      gsl::narrow_cast<SHORT>(std::min(bottom, _viewport.Bottom - _viewport.Top)) };
+            if (clipped.Left > clipped.Right || clipped.Top > clipped.Bottom)
+            {
+                return;
+            }
+
+            if (!_dirtyUsed)
+            {
+                _dirty = clipped;
+                _dirtyUsed = true;
+            }
+            else
+            {
+                _dirty.Left = std::min(_dirty.Left, clipped.Left);
+                _dirty.Top = std::min(_dirty.Top, clipped.Top);
+                _dirty.Right = std::max(_dirty.Right, clipped.Right);
+                _dirty.Bottom = std::max(_dirty.Bottom, clipped.Bottom);
+            }
+        }
+
+        const COORD _fontSize;
+        SMALL_RECT _viewport;
+        SMALL_RECT _dirty;
+        bool _dirtyUsed;
+        Counts _counts;
+    };
+}
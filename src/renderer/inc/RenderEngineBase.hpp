@@ -30,9 +30,19 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT InvalidateTitle(const std::wstring& proposedTitle) noexcept override;
 
+        [[nodiscard]]
+        HRESULT InvalidateScrollRegion(const SMALL_RECT* const psrRegion, const COORD* const pcoordDelta) noexcept override;
+
         [[nodiscard]]
         HRESULT UpdateTitle(const std::wstring& newTitle) noexcept override;
 
+        [[nodiscard]]
+        HRESULT WaitUntilCanRender() noexcept override;
+
+        std::vector<SMALL_RECT> GetDirtyArea() override;
+
+        Microsoft::Console::Types::MemoryUsage GetCacheMemoryUsage() const noexcept override;
+
     protected:
         [[nodiscard]]
         virtual HRESULT _DoUpdateTitle(const std::wstring& newTitle) noexcept = 0;
@@ -0,0 +1,245 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "ShadowFrame.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+ShadowFrame::ShadowFrame() noexcept :
+    _size{ 0, 0 },
+    _cells{}
+{
+}
+
+// Routine Description:
+// - Changes the size of the screen we're keeping. If it really changed, the
+//   terminal may have moved its contents around, so all of it is unknown.
+// Arguments:
+// - size - The size of the screen, in characters
+// Return Value:
+// - <none>
+void ShadowFrame::Resize(const COORD size)
+{
+    if (size.X == _size.X && size.Y == _size.Y)
+    {
+        return;
+    }
+
+    const auto width = std::max<SHORT>(size.X, 0);
+    const auto height = std::max<SHORT>(size.Y, 0);
+    _cells.assign(static_cast<size_t>(width) * height, Cell{});
+    _size = { width, height };
+}
+
+// Routine Description:
+// - Marks the whole screen as unknown, for when it's been cleared, or written
+//   to directly.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void ShadowFrame::Forget() noexcept
+{
+    for (auto& cell : _cells)
+    {
+        cell.isKnown = false;
+    }
+}
+
+// Routine Description:
+// - Marks some cells of one row as unknown, for text we didn't write out after
+//   all. Anything off of the screen is ignored.
+// Arguments:
+// - coord - Where the cells start, in characters
+// - columns - How many cells there are
+// Return Value:
+// - <none>
+void ShadowFrame::Forget(const COORD coord, const size_t columns) noexcept
+{
+    for (size_t i = 0; i < columns; ++i)
+    {
+        if (auto cell = _At(coord.Y, gsl::narrow_cast<SHORT>(coord.X + i)))
+        {
+            cell->isKnown = false;
+        }
+    }
+}
+
+// Routine Description:
+// - Moves the rows along with the terminal's, when it's scrolled by a newline
+//   at the bottom or a line inserted at the top. The rows that scroll in are
+//   unknown.
+// Arguments:
+// - delta - How many rows the contents moved down. Negative for up.
+// Return Value:
+// - <none>
+void ShadowFrame::Scroll(const SHORT delta) noexcept
+{
+    Scroll(delta, 0, _size.Y);
+}
+
+// Routine Description:
+// - Moves some of the rows along with the terminal's, when only those rows
+//   scrolled, inside of its margins. The rows that scroll in are unknown.
+// Arguments:
+// - delta - How many rows the contents moved down. Negative for up.
+// - top - The first row that moved
+// - bottom - The row after the last one that moved
+// Return Value:
+// - <none>
+void ShadowFrame::Scroll(const SHORT delta, const SHORT top, const SHORT bottom) noexcept
+{
+    const auto first = std::max<SHORT>(top, 0);
+    const auto last = std::min<SHORT>(bottom, _size.Y);
+    if (delta == 0 || _cells.empty() || first >= last)
+    {
+        return;
+    }
+
+    const size_t width = _size.X;
+    const size_t rows = std::min<size_t>(std::abs(delta), last - first);
+    const auto shift = rows * width;
+    const auto begin = _cells.begin() + first * width;
+    const auto end = _cells.begin() + last * width;
+
+    if (delta < 0)
+    {
+        std::move(begin + shift, end, begin);
+        std::for_each(end - shift, end, [](Cell& cell) noexcept { cell.isKnown = false; });
+    }
+    else
+    {
+        std::move_backward(begin, end - shift, end);
+        std::for_each(begin, begin + shift, [](Cell& cell) noexcept { cell.isKnown = false; });
+    }
+}
+
+// Routine Description:
+// - Checks whether the terminal already shows a cluster at a position, in the
+//   same colors and rendition.
+// Arguments:
+// - cluster - The text and its width in columns
+// - coord - Where it would be written, in characters
+// - attributes - What it would be written in
+// Return Value:
+// - True if writing it again wouldn't change anything.
+bool ShadowFrame::IsSame(const Cluster& cluster, const COORD coord, const Attributes& attributes) const noexcept
+{
+    const auto columns = cluster.GetColumns();
+    const auto first = _At(coord.Y, coord.X);
+    if (!first || columns == 0 ||
+        !first->isKnown || first->isTrailer ||
+        first->columns != columns ||
+        first->attributes != attributes ||
+        first->text != cluster.GetText())
+    {
+        return false;
+    }
+
+    for (size_t i = 1; i < columns; ++i)
+    {
+        const auto trailer = _At(coord.Y, gsl::narrow_cast<SHORT>(coord.X + i));
+        if (!trailer || !trailer->isKnown || !trailer->isTrailer)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Routine Description:
+// - Records that a cluster was written at a position. Writing over part of a
+//   wide cluster erases the rest of it too, so what's left of one that this
+//   overlaps becomes unknown.
+// Arguments:
+// - cluster - The text and its width in columns
+// - coord - Where it was written, in characters
+// - attributes - What it was written in
+// Return Value:
+// - <none>
+void ShadowFrame::Set(const Cluster& cluster, const COORD coord, const Attributes& attributes)
+{
+    const auto columns = std::max<size_t>(cluster.GetColumns(), 1);
+    const auto right = gsl::narrow_cast<SHORT>(coord.X + columns);
+
+    _ForgetCluster(coord);
+    _ForgetCluster({ right, coord.Y });
+
+    bool isTrailer = false;
+    for (auto column = coord.X; column < right; ++column)
+    {
+        if (auto cell = _At(coord.Y, column))
+        {
+            cell->text = isTrailer ? std::wstring{} : std::wstring{ cluster.GetText() };
+            cell->columns = columns;
+            cell->attributes = attributes;
+            cell->isKnown = true;
+            cell->isTrailer = isTrailer;
+        }
+        isTrailer = true;
+    }
+}
+
+// Routine Description:
+// - If a wide cluster is split at a column, forgets its cells on both sides.
+// Arguments:
+// - coord - The column that's about to be changed
+// Return Value:
+// - <none>
+void ShadowFrame::_ForgetCluster(const COORD coord) noexcept
+{
+    auto cell = _At(coord.Y, coord.X);
+    if (!cell || !cell->isTrailer)
+    {
+        return;
+    }
+
+    // Back to where it starts...
+    auto left = coord.X;
+    while (left > 0 && _At(coord.Y, left)->isTrailer)
+    {
+        --left;
+    }
+
+    // ...and on past where it ends.
+    auto right = gsl::narrow_cast<SHORT>(coord.X + 1);
+    while (right < _size.X && _At(coord.Y, right)->isTrailer)
+    {
+        ++right;
+    }
+
+    Forget({ left, coord.Y }, static_cast<size_t>(right) - left);
+}
+
+ShadowFrame::Cell* ShadowFrame::_At(const SHORT row, const SHORT column) noexcept
+{
+    return const_cast<Cell*>(std::as_const(*this)._At(row, column));
+}
+
+const ShadowFrame::Cell* ShadowFrame::_At(const SHORT row, const SHORT column) const noexcept
+{
+    if (row < 0 || row >= _size.Y || column < 0 || column >= _size.X)
+    {
+        return nullptr;
+    }
+
+    return &_cells.at(static_cast<size_t>(row) * _size.X + column);
+}
+
+bool ShadowFrame::Attributes::operator==(const Attributes& other) const noexcept
+{
+    return foreground == other.foreground &&
+           background == other.background &&
+           isBold == other.isBold &&
+           isUnderlined == other.isUnderlined;
+}
+
+bool ShadowFrame::Attributes::operator!=(const Attributes& other) const noexcept
+{
+    return !(*this == other);
+}
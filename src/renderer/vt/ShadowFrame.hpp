@@ -0,0 +1,69 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ShadowFrame.hpp
+
+Abstract:
+- Keeps a copy of what the terminal on the other end of the pipe is showing:
+  the text of each cell, and the colors and rendition it was written in.
+- Rows that are painted again with what's already there, like a status line
+  that was redrawn or a progress bar that didn't move, can then be left alone
+  instead of being written down the pipe again.
+- A cell that we can't be sure of, because something other than our own text
+  changed it, is unknown, and never matches anything.
+--*/
+
+#pragma once
+
+#include "../inc/Cluster.hpp"
+
+namespace Microsoft::Console::Render
+{
+    class ShadowFrame final
+    {
+    public:
+        struct Attributes
+        {
+            COLORREF foreground;
+            COLORREF background;
+            bool isBold;
+            bool isUnderlined;
+
+            bool operator==(const Attributes& other) const noexcept;
+            bool operator!=(const Attributes& other) const noexcept;
+        };
+
+        ShadowFrame() noexcept;
+
+        void Resize(const COORD size);
+
+        void Forget() noexcept;
+        void Forget(const COORD coord, const size_t columns) noexcept;
+        void Scroll(const SHORT delta) noexcept;
+        void Scroll(const SHORT delta, const SHORT top, const SHORT bottom) noexcept;
+
+        bool IsSame(const Cluster& cluster, const COORD coord, const Attributes& attributes) const noexcept;
+        void Set(const Cluster& cluster, const COORD coord, const Attributes& attributes);
+
+    private:
+        struct Cell
+        {
+            // The text of the cluster that starts here. The columns after the
+            // first of a wide cluster are trailers, with no text of their own.
+            std::wstring text;
+            size_t columns;
+            Attributes attributes;
+            bool isKnown;
+            bool isTrailer;
+        };
+
+        COORD _size;
+        std::vector<Cell> _cells;
+
+        Cell* _At(const SHORT row, const SHORT column) noexcept;
+        const Cell* _At(const SHORT row, const SHORT column) const noexcept;
+        void _ForgetCluster(const COORD coord) noexcept;
+    };
+}
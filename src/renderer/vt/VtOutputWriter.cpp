@@ -0,0 +1,220 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "VtOutputWriter.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// Routine Description:
+// - Starts a writer for the given pipe.
+// - NOTE: Will throw if the thread can't be started. Caller must catch.
+// Arguments:
+// - pipe: the pipe to write the frames to. The writer doesn't own it, but it
+//      has to stay open until the writer is shut down.
+// Return Value:
+// - An instance of a VtOutputWriter.
+VtOutputWriter::VtOutputWriter(const HANDLE pipe) :
+    _pipe{ pipe },
+    _lock{},
+    _pending{},
+    _writing{ 0 },
+    _result{ S_OK },
+    _bytesPerMs{ 0 },
+    _shutdown{ false },
+    _outputAvailable{},
+    _writeDone{},
+    _thread{}
+{
+    _thread = std::thread([this]() { _WriteLoop(); });
+}
+
+VtOutputWriter::~VtOutputWriter()
+{
+    Shutdown();
+}
+
+// Routine Description:
+// - Queues up a frame to be written to the pipe. This never waits on the
+//      pipe. The frame's buffer is traded for an empty one that's already been
+//      used, so that once both have grown, building a frame doesn't allocate.
+// Arguments:
+// - frame: the frame to write. Comes back empty.
+// Return Value:
+// - S_OK if the frame was queued, else the error that one of the writes
+//      before it failed with.
+[[nodiscard]]
+HRESULT VtOutputWriter::Write(std::string& frame) noexcept
+{
+    try
+    {
+        {
+            std::lock_guard<std::mutex> guard{ _lock };
+            RETURN_IF_FAILED(_result);
+            if (_shutdown || frame.empty())
+            {
+                frame.clear();
+                return S_OK;
+            }
+
+            if (_pending.empty())
+            {
+                _pending.swap(frame);
+            }
+            else
+            {
+                _pending.append(frame);
+            }
+        }
+
+        frame.clear();
+        _outputAvailable.notify_one();
+        return S_OK;
+    }
+    CATCH_RETURN();
+}
+
+// Routine Description:
+// - Waits until the output that hasn't been written yet is down to what the
+//      terminal can take in about a frame, so that painting now won't only
+//      pile more onto it.
+// Arguments:
+// - timeoutMs: how long to wait at most.
+// Return Value:
+// - true if the output is under the mark, false if we timed out.
+bool VtOutputWriter::WaitForBacklog(const DWORD timeoutMs) noexcept
+{
+    try
+    {
+        std::unique_lock<std::mutex> guard{ _lock };
+        return _writeDone.wait_for(guard, std::chrono::milliseconds(timeoutMs), [this]() {
+            return _pending.size() + _writing < _Backlog() || FAILED(_result) || _shutdown;
+        });
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return true;
+    }
+}
+
+// Routine Description:
+// - Stops the writer, once what's been queued up has been written, so that
+//      the last frame before we exit still makes it to the terminal. If the
+//      terminal isn't reading anymore, the write in flight is cancelled rather
+//      than waited on forever. Frames written after this are dropped.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void VtOutputWriter::Shutdown() noexcept
+{
+    if (!_thread.joinable())
+    {
+        return;
+    }
+
+    bool drained = false;
+    try
+    {
+        std::unique_lock<std::mutex> guard{ _lock };
+        _shutdown = true;
+        drained = _writeDone.wait_for(guard, std::chrono::milliseconds(s_ShutdownTimeoutMs), [this]() {
+            return (_pending.empty() && _writing == 0) || FAILED(_result);
+        });
+        if (!drained)
+        {
+            _pending.clear();
+        }
+    }
+    CATCH_LOG();
+    _outputAvailable.notify_one();
+
+    if (!drained)
+    {
+        const HANDLE thread = _thread.native_handle();
+        do
+        {
+            CancelSynchronousIo(thread);
+        } while (WaitForSingleObject(thread, 10) == WAIT_TIMEOUT);
+    }
+
+    _thread.join();
+}
+
+// Routine Description:
+// - The writer's thread. Takes all the frames that have been queued up since
+//      the last write and writes them at once, until it's shut down and
+//      there's nothing left to write.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void VtOutputWriter::_WriteLoop()
+{
+    std::string writing;
+    std::unique_lock<std::mutex> guard{ _lock };
+    while (true)
+    {
+        _outputAvailable.wait(guard, [this]() { return _shutdown || !_pending.empty(); });
+        if (_pending.empty())
+        {
+            break;
+        }
+
+        writing.swap(_pending);
+        _writing = writing.size();
+        guard.unlock();
+
+        HRESULT hr = S_OK;
+        DWORD written = 0;
+        const auto start = std::chrono::steady_clock::now();
+        if (!WriteFile(_pipe, writing.data(), gsl::narrow_cast<DWORD>(writing.size()), &written, nullptr))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        writing.clear();
+
+        guard.lock();
+        _writing = 0;
+        if (SUCCEEDED(hr) && written > 0)
+        {
+            // A write that didn't have to wait on the terminal at all comes
+            //      out as a huge rate, which only puts the limit back at
+            //      s_HighWaterMark, as it should be.
+            const double rate = written / std::max(elapsed.count(), 0.001);
+            _bytesPerMs = _bytesPerMs == 0 ? rate : (_bytesPerMs * 3 + rate) / 4;
+        }
+        if (FAILED(hr))
+        {
+            _result = hr;
+            _pending.clear();
+        }
+        _writeDone.notify_all();
+    }
+}
+
+// Routine Description:
+// - How much output can be waiting on the terminal before painting should
+//      wait for it. Must be called with _lock held.
+// Arguments:
+// - <none>
+// Return Value:
+// - The number of bytes.
+size_t VtOutputWriter::_Backlog() const noexcept
+{
+    if (_bytesPerMs == 0)
+    {
+        return s_HighWaterMark;
+    }
+
+    const double backlog = _bytesPerMs * s_DrainTargetMs;
+    if (backlog >= s_HighWaterMark)
+    {
+        return s_HighWaterMark;
+    }
+    return std::max(static_cast<size_t>(backlog), s_LowWaterMark);
+}
@@ -0,0 +1,76 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- VtOutputWriter.hpp
+
+Abstract:
+- Writes the VT engine's frames to its pipe on a thread of its own, so that a
+  terminal that's slow to read never blocks the render thread.
+- Each frame is built in one buffer while the frame before it is written from
+  the other. Frames that are finished while a write is still in flight are
+  queued up behind it and written together.
+- The writer measures how fast the terminal takes the output. When more is
+  queued than the terminal can take in about a frame, WaitForBacklog lets the
+  render thread hold off on painting for a bit. The changes that come in
+  meanwhile are all painted as one frame, with only their final state, instead
+  of the terminal having to read every state in between.
+--*/
+
+#pragma once
+
+#include <condition_variable>
+
+namespace Microsoft::Console::Render
+{
+    class VtOutputWriter final
+    {
+    public:
+        VtOutputWriter(const HANDLE pipe);
+        ~VtOutputWriter();
+
+        [[nodiscard]]
+        HRESULT Write(std::string& frame) noexcept;
+
+        bool WaitForBacklog(const DWORD timeoutMs) noexcept;
+
+        void Shutdown() noexcept;
+
+    private:
+        // How much output can be waiting to be written before the render
+        //      thread is asked to stop adding to it: as much as the terminal
+        //      takes in s_DrainTargetMs, but never more than s_HighWaterMark or
+        //      less than s_LowWaterMark. Until we know how fast the terminal
+        //      is, it's s_HighWaterMark.
+        static constexpr size_t s_HighWaterMark = 64 * 1024;
+        static constexpr size_t s_LowWaterMark = 4 * 1024;
+        static constexpr double s_DrainTargetMs = 16.0;
+
+        // How long shutting down waits for what's queued to be written, before
+        //      giving up on a terminal that's stopped reading.
+        static constexpr DWORD s_ShutdownTimeoutMs = 1000;
+
+        const HANDLE _pipe;
+
+        // Guards everything below it.
+        std::mutex _lock;
+        // The frames waiting to be written.
+        std::string _pending;
+        // How many bytes of the write in flight, if any.
+        size_t _writing;
+        // The error the last write failed with. Once it's set, nothing more is written.
+        HRESULT _result;
+        // How fast the terminal has been taking our output, averaged over the
+        //      last few writes. 0 until the first write's done.
+        double _bytesPerMs;
+        bool _shutdown;
+        std::condition_variable _outputAvailable;
+        std::condition_variable _writeDone;
+
+        std::thread _thread;
+
+        void _WriteLoop();
+        size_t _Backlog() const noexcept;
+    };
+}
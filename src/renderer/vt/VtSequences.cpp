@@ -8,6 +8,65 @@
 #pragma hdrstop
 using namespace Microsoft::Console::Render;
 
+VtEngine::CsiParameters::CsiParameters() noexcept :
+    _chars{},
+    _length{ 0 }
+{
+}
+
+// Method Description:
+// - Adds a parameter, separated from the ones already there by a ';'.
+// Arguments:
+// - value: the parameter to add.
+// Return Value:
+// - <none>
+void VtEngine::CsiParameters::Append(const int value) noexcept
+{
+    size_t length = _length;
+    if (length > 0)
+    {
+        FAIL_FAST_IF(length >= s_Capacity);
+        _chars[length++] = ';';
+    }
+
+    const auto result = std::to_chars(&_chars[length], &_chars[s_Capacity], value);
+    FAIL_FAST_IF(result.ec != std::errc{});
+    _length = static_cast<size_t>(result.ptr - _chars);
+}
+
+// Method Description:
+// - Gets the parameters added so far, as they're written.
+// Arguments:
+// - <none>
+// Return Value:
+// - The parameters, like "38;2;1;2;3".
+std::string_view VtEngine::CsiParameters::View() const noexcept
+{
+    return { _chars, _length };
+}
+
+// Method Description:
+// - Writes a CSI sequence with the given parameters. Like the parameters, the
+//      sequence is put together on the stack.
+// Arguments:
+// - parameters: the parameters of the sequence.
+// - finalChar: the character that ends the sequence.
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]]
+HRESULT VtEngine::_WriteCsi(const CsiParameters& parameters, const char finalChar) noexcept
+{
+    char sequence[CsiParameters::s_Capacity + 3];
+    const std::string_view view = parameters.View();
+
+    sequence[0] = '\x1b';
+    sequence[1] = '[';
+    std::copy(view.begin(), view.end(), &sequence[2]);
+    sequence[view.size() + 2] = finalChar;
+
+    return _Write({ sequence, view.size() + 3 });
+}
+
 // Method Description:
 // - Formats and writes a sequence to stop the cursor from blinking.
 // Arguments:
@@ -87,9 +146,7 @@ HRESULT VtEngine::_EraseLine() noexcept
 [[nodiscard]]
 HRESULT VtEngine::_EraseCharacter(const short chars) noexcept
 {
-    static const std::string format = "\x1b[%dX";
-
-    return _WriteFormattedString(&format, chars);
+    return _WriteCsi('X', chars);
 }
 
 // Method Description:
@@ -101,10 +158,62 @@ HRESULT VtEngine::_EraseCharacter(const short chars) noexcept
 [[nodiscard]]
 HRESULT VtEngine::_CursorForward(const short chars) noexcept
 {
+    return _WriteCsi('C', chars);
+}
+
+// Method Description:
+// - Formats and writes a sequence to write the last character written again,
+//      a number of times.
+// Arguments:
+// - chars: how many more times to write the character.
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]]
+HRESULT VtEngine::_RepeatCharacter(const short chars) noexcept
+{
+    return _WriteCsi('b', chars);
+}
+
+// Method Description:
+// - Formats and writes a sequence to set the top and bottom scrolling margins
+//      (DECSTBM). This also moves the cursor home.
+// Arguments:
+// - top: the first row inside the margins, from 0.
+// - bottom: the last row inside the margins, inclusive.
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]]
+HRESULT VtEngine::_SetTopBottomMargins(const short top, const short bottom) noexcept
+{
+    // VT rows start at 1
+    return _WriteCsi('r', top + 1, bottom + 1);
+}
 
-    static const std::string format = "\x1b[%dC";
+// Method Description:
+// - Writes the sequence to reset the scrolling margins to the whole screen.
+//      This also moves the cursor home.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]]
+HRESULT VtEngine::_ResetTopBottomMargins() noexcept
+{
+    return _Write("\x1b[r");
+}
 
-    return _WriteFormattedString(&format, chars);
+// Method Description:
+// - Formats and writes a sequence to scroll up (SU) or down (SD) what's
+//      inside of the scrolling margins.
+// Arguments:
+// - lines: how many lines to scroll.
+// - up: true to move the contents up (SU), false to move them down (SD).
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]]
+HRESULT VtEngine::_ScrollMargins(const short lines, const bool up) noexcept
+{
+    return _WriteCsi(up ? 'S' : 'T', lines);
 }
 
 // Method Description:
@@ -117,9 +226,26 @@ HRESULT VtEngine::_CursorForward(const short chars) noexcept
 [[nodiscard]]
 HRESULT VtEngine::_ClearScreen() noexcept
 {
+    // The cleared screen is filled in whatever the colors were when it went
+    //      out, which we don't keep track of.
+    _shadow.Forget();
+
     return _Write("\x1b[2J");
 }
 
+// Method Description:
+// - Formats and writes a sequence to erase the terminal's scrollback, the rows
+//      above its viewport.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]]
+HRESULT VtEngine::_EraseScrollback() noexcept
+{
+    return _Write("\x1b[3J");
+}
+
 // Method Description:
 // - Formats and writes a sequence to either insert or delete a number of lines
 //      into the buffer at the current cursor location.
@@ -139,9 +265,7 @@ HRESULT VtEngine::_InsertDeleteLine(const short sLines, const bool fInsertLine)
     {
         return _Write(fInsertLine ? "\x1b[L" : "\x1b[M");
     }
-    const std::string format = fInsertLine ? "\x1b[%dL" : "\x1b[%dM";
-
-    return _WriteFormattedString(&format, sLines);
+    return _WriteCsi(fInsertLine ? 'L' : 'M', sLines);
 }
 
 // Method Description:
@@ -181,14 +305,8 @@ HRESULT VtEngine::_InsertLine(const short sLines) noexcept
 [[nodiscard]]
 HRESULT VtEngine::_CursorPosition(const COORD coord) noexcept
 {
-    static const std::string cursorFormat = "\x1b[%d;%dH";
-
     // VT coords start at 1,1
-    COORD coordVt = coord;
-    coordVt.X++;
-    coordVt.Y++;
-
-    return _WriteFormattedString(&cursorFormat, coordVt.Y, coordVt.X);
+    return _WriteCsi('H', coord.Y + 1, coord.X + 1);
 }
 
 // Method Description:
@@ -212,8 +330,7 @@ HRESULT VtEngine::_CursorHome() noexcept
 [[nodiscard]]
 HRESULT VtEngine::_SetGraphicsBoldness(const bool isBold) noexcept
 {
-    const std::string fmt = isBold ? "\x1b[1m" : "\x1b[22m";
-    return _Write(fmt);
+    return _Write(isBold ? "\x1b[1m" : "\x1b[22m");
 }
 
 // Method Description:
@@ -239,8 +356,20 @@ HRESULT VtEngine::_SetGraphicsDefault() noexcept
 HRESULT VtEngine::_SetGraphicsRendition16Color(const WORD wAttr,
                                                const bool fIsForeground) noexcept
 {
-    static const std::string fmt = "\x1b[%dm";
+    return _WriteCsi('m', s_GraphicsRendition16ColorIndex(wAttr, fIsForeground));
+}
 
+// Method Description:
+// - Gets the SGR parameter that sets the current text color to one of the 16
+//      colors of the table.
+// Arguments:
+// - wAttr: Windows color table index to get the VT parameter for
+// - fIsForeground: true for the foreground parameter, false for background
+// Return Value:
+// - The parameter, in [30,37] U [90,97] or [40,47] U [100,107].
+int VtEngine::s_GraphicsRendition16ColorIndex(const WORD wAttr,
+                                              const bool fIsForeground) noexcept
+{
     // Always check using the foreground flags, because the bg flags constants
     //  are a higher byte
     // Foreground sequences are in [30,37] U [90,97]
@@ -253,14 +382,12 @@ HRESULT VtEngine::_SetGraphicsRendition16Color(const WORD wAttr,
     //      terminals display the bright color when displaying bolded text.
     // By specifying the boldness and brightness seperately, we'll make sure the
     //      terminal has an accurate representation of our buffer.
-    const int vtIndex = 30
-                        + (fIsForeground? 0 : 10)
-                        + ((WI_IsFlagSet(wAttr, FOREGROUND_INTENSITY)) ? 60 : 0)
-                        + (WI_IsFlagSet(wAttr, FOREGROUND_RED) ? 1 : 0)
-                        + (WI_IsFlagSet(wAttr, FOREGROUND_GREEN) ? 2 : 0)
-                        + (WI_IsFlagSet(wAttr, FOREGROUND_BLUE) ? 4 : 0);
-
-    return _WriteFormattedString(&fmt, vtIndex);
+    return 30
+           + (fIsForeground? 0 : 10)
+           + ((WI_IsFlagSet(wAttr, FOREGROUND_INTENSITY)) ? 60 : 0)
+           + (WI_IsFlagSet(wAttr, FOREGROUND_RED) ? 1 : 0)
+           + (WI_IsFlagSet(wAttr, FOREGROUND_GREEN) ? 2 : 0)
+           + (WI_IsFlagSet(wAttr, FOREGROUND_BLUE) ? 4 : 0);
 }
 
 // Method Description:
@@ -275,15 +402,7 @@ HRESULT VtEngine::_SetGraphicsRendition16Color(const WORD wAttr,
 HRESULT VtEngine::_SetGraphicsRenditionRGBColor(const COLORREF color,
                                                 const bool fIsForeground) noexcept
 {
-    const std::string fmt = fIsForeground ?
-        "\x1b[38;2;%d;%d;%dm" :
-        "\x1b[48;2;%d;%d;%dm";
-
-    DWORD const r = GetRValue(color);
-    DWORD const g = GetGValue(color);
-    DWORD const b = GetBValue(color);
-
-    return _WriteFormattedString(&fmt, r, g, b);
+    return _WriteCsi('m', fIsForeground ? 38 : 48, 2, GetRValue(color), GetGValue(color), GetBValue(color));
 }
 
 // Method Description:
@@ -296,9 +415,7 @@ HRESULT VtEngine::_SetGraphicsRenditionRGBColor(const COLORREF color,
 [[nodiscard]]
 HRESULT VtEngine::_SetGraphicsRenditionDefaultColor(const bool fIsForeground) noexcept
 {
-    const std::string fmt = fIsForeground ? ("\x1b[39m") : ("\x1b[49m");
-
-    return _Write(fmt);
+    return _Write(fIsForeground ? "\x1b[39m" : "\x1b[49m");
 }
 
 // Method Description:
@@ -311,13 +428,12 @@ HRESULT VtEngine::_SetGraphicsRenditionDefaultColor(const bool fIsForeground) no
 [[nodiscard]]
 HRESULT VtEngine::_ResizeWindow(const short sWidth, const short sHeight) noexcept
 {
-    static const std::string resizeFormat = "\x1b[8;%d;%dt";
     if (sWidth < 0 || sHeight < 0)
     {
         return E_INVALIDARG;
     }
 
-    return _WriteFormattedString(&resizeFormat, sHeight, sWidth);
+    return _WriteCsi('t', 8, sHeight, sWidth);
 }
 
 // Method Description:
@@ -40,7 +40,8 @@ HRESULT WinTelnetEngine::UpdateDrawingBrushes(const COLORREF colorForeground,
                                               const bool isBold,
                                               const bool /*isSettingDefaultBrushes*/) noexcept
 {
-    return VtEngine::_16ColorUpdateDrawingBrushes(colorForeground, colorBackground, isBold, _ColorTable, _cColorTable);
+    // The telnet client doesn't know about underlining.
+    return VtEngine::_16ColorUpdateDrawingBrushes(colorForeground, colorBackground, isBold, false, _ColorTable, _cColorTable);
 }
 
 // Routine Description:
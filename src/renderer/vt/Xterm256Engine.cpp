@@ -36,17 +36,18 @@ HRESULT Xterm256Engine::UpdateDrawingBrushes(const COLORREF colorForeground,
                                              const bool isBold,
                                              const bool /*isSettingDefaultBrushes*/) noexcept
 {
-    //When we update the brushes, check the wAttrs to see if the LVB_UNDERSCORE
-    //      flag is there. If the state of that flag is different then our
-    //      current state, change the underlining state.
+    // When we update the brushes, check the wAttrs to see if the LVB_UNDERSCORE
+    //      flag is there. The underlining is set along with the colors, in
+    //      the same sequence.
     // We have to do this here, instead of in PaintBufferGridLines, because
     //      we'll have already painted the text by the time PaintBufferGridLines
     //      is called.
-    RETURN_IF_FAILED(_UpdateUnderline(legacyColorAttribute));
+    const bool isUnderlined = WI_IsFlagSet(legacyColorAttribute, COMMON_LVB_UNDERSCORE);
 
     return VtEngine::_RgbUpdateDrawingBrushes(colorForeground,
                                               colorBackground,
                                               isBold,
+                                              isUnderlined,
                                               _ColorTable,
                                               _cColorTable);
 }
@@ -20,7 +20,6 @@ XtermEngine::XtermEngine(_In_ wil::unique_hfile hPipe,
     _cColorTable(cColorTable),
     _fUseAsciiOnly(fUseAsciiOnly),
     _previousLineWrapped(false),
-    _usingUnderLine(false),
     _needToDisableCursor(false)
 {
     // Set out initial cursor position to -1, -1. This will force our initial
@@ -126,32 +125,6 @@ HRESULT XtermEngine::EndPaint() noexcept
 }
 
 
-// Routine Description:
-// - Write a VT sequence to either start or stop underlining text.
-// Arguments:
-// - legacyColorAttribute: A console attributes bit field containing information
-//      about the underlining state of the text.
-// Return Value:
-// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
-[[nodiscard]]
-HRESULT XtermEngine::_UpdateUnderline(const WORD legacyColorAttribute) noexcept
-{
-    bool textUnderlined = WI_IsFlagSet(legacyColorAttribute, COMMON_LVB_UNDERSCORE);
-    if (textUnderlined != _usingUnderLine)
-    {
-        if (textUnderlined)
-        {
-            RETURN_IF_FAILED(_BeginUnderline());
-        }
-        else
-        {
-            RETURN_IF_FAILED(_EndUnderline());
-        }
-        _usingUnderLine = textUnderlined;
-    }
-    return S_OK;
-}
-
 // Routine Description:
 // - Write a VT sequence to change the current colors of text. Only writes
 //      16-color attributes.
@@ -171,16 +144,16 @@ HRESULT XtermEngine::UpdateDrawingBrushes(const COLORREF colorForeground,
                                           const bool isBold,
                                           const bool /*isSettingDefaultBrushes*/) noexcept
 {
-    //When we update the brushes, check the wAttrs to see if the LVB_UNDERSCORE
-    //      flag is there. If the state of that flag is different then our
-    //      current state, change the underlining state.
+    // When we update the brushes, check the wAttrs to see if the LVB_UNDERSCORE
+    //      flag is there. The underlining is set along with the colors, in
+    //      the same sequence.
     // We have to do this here, instead of in PaintBufferGridLines, because
     //      we'll have already painted the text by the time PaintBufferGridLines
     //      is called.
+    const bool isUnderlined = WI_IsFlagSet(legacyColorAttribute, COMMON_LVB_UNDERSCORE);
 
-    RETURN_IF_FAILED(_UpdateUnderline(legacyColorAttribute));
     // The base xterm mode only knows about 16 colors
-    return VtEngine::_16ColorUpdateDrawingBrushes(colorForeground, colorBackground, isBold, _ColorTable, _cColorTable);
+    return VtEngine::_16ColorUpdateDrawingBrushes(colorForeground, colorBackground, isBold, isUnderlined, _ColorTable, _cColorTable);
 }
 
 // Routine Description:
@@ -273,6 +246,8 @@ HRESULT XtermEngine::_MoveCursor(COORD const coord) noexcept
 //  Move the cursor to the origin, and insert or delete rows as appropriate.
 //      The inserted rows will be blank, but marked invalid by InvalidateScroll,
 //      so they will later be written by PaintBufferLine.
+//  If only the rows inside of some margins scrolled, set the terminal's margins
+//      to match and scroll just those instead.
 // Arguments:
 // - <none>
 // Return Value:
@@ -280,6 +255,11 @@ HRESULT XtermEngine::_MoveCursor(COORD const coord) noexcept
 [[nodiscard]]
 HRESULT XtermEngine::ScrollFrame() noexcept
 {
+    if (_scrollRegionDelta != 0)
+    {
+        return _ScrollRegion();
+    }
+
     if (_scrollDelta.X != 0)
     {
         // No easy way to shift left-right. Everything needs repainting.
@@ -310,6 +290,7 @@ HRESULT XtermEngine::ScrollFrame() noexcept
             // Mark that the bottom line is new, so we won't spend time with an
             // ECH on it.
             _newBottomLine = true;
+            _shadow.Scroll(dy);
         }
         // We don't need to _MoveCursor the cursor again, because it's still
         //      at the bottom of the viewport.
@@ -323,6 +304,10 @@ HRESULT XtermEngine::ScrollFrame() noexcept
         {
             hr = _InsertLine(absDy);
         }
+        if (SUCCEEDED(hr))
+        {
+            _shadow.Scroll(dy);
+        }
     }
 
     return hr;
@@ -340,11 +325,24 @@ HRESULT XtermEngine::ScrollFrame() noexcept
 [[nodiscard]]
 HRESULT XtermEngine::InvalidateScroll(const COORD* const pcoordDelta) noexcept
 {
+    // The terminal already scrolled on its own. See BeginPassThrough.
+    RETURN_HR_IF(S_OK, _passingThrough);
+
     const short dx = pcoordDelta->X;
     const short dy = pcoordDelta->Y;
 
     if (dx != 0 || dy != 0)
     {
+        // We only send one kind of scroll a frame. If some of the rows already
+        //      scrolled on their own, repaint those instead.
+        if (_scrollRegionDelta != 0)
+        {
+            const auto region = _scrollRegion.ToExclusive();
+            _scrollRegion = Viewport::Empty();
+            _scrollRegionDelta = 0;
+            RETURN_IF_FAILED(Invalidate(&region));
+        }
+
         // Scroll the current offset
         RETURN_IF_FAILED(_InvalidOffset(pcoordDelta));
 
@@ -373,6 +371,98 @@ HRESULT XtermEngine::InvalidateScroll(const COORD* const pcoordDelta) noexcept
     return S_OK;
 }
 
+// Routine Description:
+// - Notifies us that the console moved the contents of only some of the rows,
+//      inside of its margins, like a pager or a multiplexer's pane scrolling.
+//      If the rows are as wide as the terminal, we can have the terminal
+//      scroll them too, and only paint the rows that were uncovered. Anything
+//      we can't scroll just gets painted again.
+// Arguments:
+// - psrRegion - Character region (SMALL_RECT) that the contents moved inside
+//      of. Exclusive.
+// - pcoordDelta - Pointer to character dimension (COORD) of the distance the
+//      contents moved.
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for safemath failure
+[[nodiscard]]
+HRESULT XtermEngine::InvalidateScrollRegion(const SMALL_RECT* const psrRegion, const COORD* const pcoordDelta) noexcept
+{
+    const short dy = pcoordDelta->Y;
+    RETURN_HR_IF(S_OK, _passingThrough || (pcoordDelta->X == 0 && dy == 0));
+
+    const auto region = Viewport::FromExclusive(*psrRegion);
+    const bool fullWidth = psrRegion->Left <= 0 && psrRegion->Right >= _lastViewport.Width();
+    const bool samePending = _scrollRegionDelta != 0 && region == _scrollRegion;
+    const bool otherPending = (_scrollDelta.X != 0 || _scrollDelta.Y != 0) ||
+                              (_scrollRegionDelta != 0 && !samePending);
+
+    short newDelta;
+    RETURN_IF_FAILED(ShortAdd(samePending ? _scrollRegionDelta : short{ 0 }, dy, &newDelta));
+
+    // The margins only go across the whole terminal, and we only keep track of
+    //      one region's scroll a frame.
+    if (pcoordDelta->X != 0 || !fullWidth || otherPending ||
+        _virtualTop != 0 || abs(newDelta) >= region.Height())
+    {
+        if (samePending)
+        {
+            _scrollRegion = Viewport::Empty();
+            _scrollRegionDelta = 0;
+        }
+        return Invalidate(psrRegion);
+    }
+
+    // Whatever was going to be painted inside the region moves with it...
+    RETURN_IF_FAILED(_InvalidOffsetInside(region, dy));
+
+    // ...and the rows that were uncovered have to be painted.
+    SMALL_RECT uncovered = *psrRegion;
+    if (dy > 0)
+    {
+        uncovered.Bottom = uncovered.Top + dy;
+    }
+    else
+    {
+        uncovered.Top = uncovered.Bottom + dy;
+    }
+    RETURN_IF_FAILED(_InvalidCombine(Viewport::FromExclusive(uncovered)));
+
+    _scrollRegion = region;
+    _scrollRegionDelta = newDelta;
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Scrolls the rows inside of _scrollRegion by _scrollRegionDelta, by
+//      setting the terminal's top and bottom margins around them, scrolling
+//      what's inside (SU/SD), and then setting the margins back.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]]
+HRESULT XtermEngine::_ScrollRegion() noexcept
+{
+    const short dy = _scrollRegionDelta;
+    const short absDy = static_cast<short>(abs(dy));
+    const short top = _scrollRegion.Top();
+    const short bottom = _scrollRegion.BottomInclusive();
+
+    RETURN_IF_FAILED(_SetTopBottomMargins(top, bottom));
+    RETURN_IF_FAILED(_ScrollMargins(absDy, dy < 0));
+    RETURN_IF_FAILED(_ResetTopBottomMargins());
+
+    // Setting the margins moves the cursor home, and it shows there, so make
+    //      sure the cursor is off for the rest of the frame.
+    _lastText = { 0, 0 };
+    _needToDisableCursor = true;
+
+    _shadow.Scroll(dy, top, _scrollRegion.BottomExclusive());
+
+    return S_OK;
+}
+
 // Routine Description:
 // - Draws one line of the buffer to the screen. Writes the characters to the
 //      pipe, encoded in UTF-8 or ASCII only, depending on the VtIoMode.
@@ -390,9 +480,7 @@ HRESULT XtermEngine::PaintBufferLine(std::basic_string_view<Cluster> const clust
                                      const COORD coord,
                                      const bool /*trimLeft*/) noexcept
 {
-    return _fUseAsciiOnly ?
-        VtEngine::_PaintAsciiBufferLine(clusters, coord) :
-        VtEngine::_PaintUtf8BufferLine(clusters, coord);
+    return VtEngine::_PaintChangedBufferLine(clusters, coord, _fUseAsciiOnly);
 }
 
 // Method Description:
@@ -405,11 +493,28 @@ HRESULT XtermEngine::PaintBufferLine(std::basic_string_view<Cluster> const clust
 [[nodiscard]]
 HRESULT XtermEngine::WriteTerminalW(const std::wstring& wstr) noexcept
 {
+    // We can't tell what this does to the screen.
+    _shadow.Forget();
+
     return _fUseAsciiOnly ?
         VtEngine::_WriteTerminalAscii(wstr) :
         VtEngine::_WriteTerminalUtf8(wstr);
 }
 
+// Method Description:
+// - Called once the output that was passed through has been applied to the
+//      buffer. Whether the last line we painted wrapped doesn't tell us where
+//      the cursor is anymore.
+// Arguments:
+// - coordCursor - Where the buffer's cursor is now, in the viewport.
+// Return Value:
+// - <none>
+void XtermEngine::EndPassThrough(const COORD coordCursor) noexcept
+{
+    _previousLineWrapped = false;
+    VtEngine::EndPassThrough(coordCursor);
+}
+
 // Method Description:
 // - Updates the window's title string. Emits the VT sequence to SetWindowTitle.
 // Arguments:
@@ -56,23 +56,27 @@ namespace Microsoft::Console::Render
 
         [[nodiscard]]
         HRESULT InvalidateScroll(const COORD* const pcoordDelta) noexcept override;
+        [[nodiscard]]
+        HRESULT InvalidateScrollRegion(const SMALL_RECT* const psrRegion, const COORD* const pcoordDelta) noexcept override;
 
         [[nodiscard]]
         HRESULT WriteTerminalW(_In_ const std::wstring& str) noexcept override;
 
+        void EndPassThrough(const COORD coordCursor) noexcept override;
+
     protected:
         const COLORREF* const _ColorTable;
         const WORD _cColorTable;
         const bool _fUseAsciiOnly;
         bool _previousLineWrapped;
-        bool _usingUnderLine;
+
         bool _needToDisableCursor;
 
         [[nodiscard]]
         HRESULT _MoveCursor(const COORD coord) noexcept override;
 
         [[nodiscard]]
-        HRESULT _UpdateUnderline(const WORD wLegacyAttrs) noexcept;
+        HRESULT _ScrollRegion() noexcept;
 
         [[nodiscard]]
         HRESULT _DoUpdateTitle(const std::wstring& newTitle) noexcept override;
@@ -51,6 +51,9 @@ HRESULT VtEngine::InvalidateSelection(const std::vector<SMALL_RECT>& /*rectangle
 [[nodiscard]]
 HRESULT VtEngine::Invalidate(const SMALL_RECT* const psrRegion) noexcept
 {
+    // The terminal already shows it. See BeginPassThrough.
+    RETURN_HR_IF(S_OK, _passingThrough);
+
     Viewport newInvalid = Viewport::FromExclusive(*psrRegion);
     _trace.TraceInvalidate(newInvalid);
 
@@ -93,6 +96,8 @@ HRESULT VtEngine::InvalidateCursor(const COORD* const pcoordCursor) noexcept
 [[nodiscard]]
 HRESULT VtEngine::InvalidateAll() noexcept
 {
+    RETURN_HR_IF(S_OK, _passingThrough);
+
     _trace.TraceInvalidateAll(_lastViewport.ToOrigin());
     return this->_InvalidCombine(_lastViewport.ToOrigin());
 }
@@ -108,6 +113,19 @@ HRESULT VtEngine::InvalidateAll() noexcept
 [[nodiscard]]
 HRESULT VtEngine::InvalidateCircling(_Out_ bool* const pForcePaint) noexcept
 {
+    // The terminal already scrolled for the output that's being passed
+    //      through, so there's nothing to paint before the top line is lost.
+    //      Still move our virtual top up, like EndPaint would have.
+    if (_passingThrough)
+    {
+        *pForcePaint = false;
+        if (_virtualTop > 0)
+        {
+            _virtualTop--;
+        }
+        return S_OK;
+    }
+
     *pForcePaint = true;
 
     // Keep track of the fact that we circled, we'll need to do some work on
@@ -121,6 +139,7 @@ HRESULT VtEngine::InvalidateCircling(_Out_ bool* const pForcePaint) noexcept
 // - Notifies us that we're about to be torn down. This gives us a last chance
 //      to force a repaint before the buffer contents are lost. The VT renderer
 //      needs to be able to render all text before it's lost, so we return true.
+//      The frame that's painted next is written out before EndPaint returns.
 // Arguments:
 // - Recieves a bool indicating if we should force the repaint.
 // Return Value:
@@ -128,6 +147,7 @@ HRESULT VtEngine::InvalidateCircling(_Out_ bool* const pForcePaint) noexcept
 [[nodiscard]]
 HRESULT VtEngine::PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept
 {
+    _tearingDown = true;
     *pForcePaint = true;
     return S_OK;
 }
@@ -153,6 +173,7 @@ HRESULT VtEngine::_InvalidCombine(const Viewport invalid) noexcept
     {
         _invalidRect = Viewport::Union(_invalidRect, invalid);
     }
+    _dirtyRows.Add(invalid.ToExclusive());
 
     // Ensure invalid areas remain within bounds of window.
     RETURN_IF_FAILED(_InvalidRestrict());
@@ -179,6 +200,44 @@ HRESULT VtEngine::_InvalidOffset(const COORD* const pCoord) noexcept
             // Add the scrolled invalid rectangle to what was left behind to get the new invalid area.
             // This is the equivalent of adding in the "update rectangle" that we would get out of ScrollWindowEx/ScrollDC.
             _invalidRect = Viewport::Union(_invalidRect, newInvalid);
+            _dirtyRows.Offset(*pCoord);
+
+            // Ensure invalid areas remain within bounds of window.
+            RETURN_IF_FAILED(_InvalidRestrict());
+        }
+        CATCH_RETURN();
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Helper for scrolling only some of the rows, inside of the margins. Moves
+//      whatever's invalid inside of the region along with its contents, the
+//      same way _InvalidOffset does for the whole screen. Nothing's moved in
+//      or out of the region.
+// Arguments:
+// - region - the rows that scrolled, as wide as the viewport.
+// - dy - how far the contents of the region moved.
+// Return Value:
+// - S_OK, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]]
+HRESULT VtEngine::_InvalidOffsetInside(const Viewport& region, const short dy) noexcept
+{
+    if (_fInvalidRectUsed)
+    {
+        try
+        {
+            const auto inside = Viewport::Intersect(_invalidRect, region);
+            if (inside.IsValid())
+            {
+                const auto moved = Viewport::Intersect(Viewport::Offset(inside, { 0, dy }), region);
+                if (moved.IsValid())
+                {
+                    _invalidRect = Viewport::Union(_invalidRect, moved);
+                }
+            }
+            _dirtyRows.OffsetInside(dy, region.Top(), region.BottomExclusive());
 
             // Ensure invalid areas remain within bounds of window.
             RETURN_IF_FAILED(_InvalidRestrict());
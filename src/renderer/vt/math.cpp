@@ -27,6 +27,19 @@ SMALL_RECT VtEngine::GetDirtyRectInChars()
     return dirty;
 }
 
+// Routine Description:
+// - Gets the parts of the frame that need to be painted, row by row, so that
+//      the rows in between the dirty ones aren't sent down the pipe again.
+//      Like GetDirtyRectInChars, nothing above the virtual top is included.
+// Arguments:
+// - <none>
+// Return Value:
+// - The dirty rectangles, in characters, from top to bottom. Inclusive.
+std::vector<SMALL_RECT> VtEngine::GetDirtyArea()
+{
+    return _dirtyRows.GetSpans(_virtualTop);
+}
+
 // Routine Description:
 // - Uses the currently selected font to determine how wide the given character will be when renderered.
 // - NOTE: Only supports determining half-width/full-width status for CJK-type languages (e.g. is it 1 character wide or 2. a.k.a. is it a rectangle or square.)
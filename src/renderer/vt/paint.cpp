@@ -26,9 +26,27 @@ HRESULT VtEngine::StartPaint() noexcept
         return S_FALSE;
     }
 
+    // If the terminal reattached since the last frame, start it over from a
+    //      clean slate before the frame paints the viewport.
+    bool reattach = false;
+    std::vector<ReattachRow> scrollback;
+    try
+    {
+        std::lock_guard<std::mutex> guard{ _reattachLock };
+        reattach = std::exchange(_reattachPending, false);
+        scrollback.swap(_reattachScrollback);
+    }
+    CATCH_RETURN();
+
+    if (reattach)
+    {
+        RETURN_IF_FAILED(_PaintReattach(scrollback));
+    }
+
     // If there's nothing to do, quick return
     bool somethingToDo = _fInvalidRectUsed ||
         (_scrollDelta.X != 0 || _scrollDelta.Y != 0) ||
+        (_scrollRegionDelta != 0) ||
         _cursorMoved ||
         _titleChanged;
 
@@ -53,8 +71,11 @@ HRESULT VtEngine::EndPaint() noexcept
     _trace.TraceEndPaint();
 
     _invalidRect = Viewport::Empty();
+    _dirtyRows.Clear();
     _fInvalidRectUsed = false;
     _scrollDelta = {0};
+    _scrollRegion = Viewport::Empty();
+    _scrollRegionDelta = 0;
     _clearedAllThisFrame = false;
     _cursorMoved = false;
     _firstPaint = false;
@@ -98,6 +119,30 @@ HRESULT VtEngine::Present() noexcept
     return S_FALSE;
 }
 
+// Routine Description:
+// - Called by the render thread before painting. If the terminal has fallen
+//      so far behind that a lot of our output is still waiting to be written,
+//      hold off for a bit. Whatever changes in the meantime is painted as one
+//      frame once the terminal catches up, instead of as many frames that only
+//      add to what it has to read.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK if we might have waited, S_FALSE if there's nothing to wait on.
+[[nodiscard]]
+HRESULT VtEngine::WaitUntilCanRender() noexcept
+{
+    if (!_writer || _outputRing || _pipeBroken)
+    {
+        return S_FALSE;
+    }
+
+    // Don't hang the render thread (and the other engines) on a terminal
+    //      that's stopped reading altogether.
+    _writer->WaitForBacklog(s_BacklogWaitMs);
+    return S_OK;
+}
+
 // Routine Description:
 // - Paints the background of the invalid area of the frame.
 // Arguments:
@@ -184,82 +229,21 @@ HRESULT VtEngine::PaintSelection(const SMALL_RECT /*rect*/) noexcept
 // Arguments:
 // - colorForeground: The RGB Color to use to paint the foreground text.
 // - colorBackground: The RGB Color to use to paint the background of the text.
+// - isBold: Whether the text should be bold.
+// - isUnderlined: Whether the text should be underlined.
+// - ColorTable: An array of colors that can be written as 16-color indices.
+// - cColorTable: size of the color table.
 // Return Value:
 // - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
 [[nodiscard]]
 HRESULT VtEngine::_RgbUpdateDrawingBrushes(const COLORREF colorForeground,
                                            const COLORREF colorBackground,
                                            const bool isBold,
+                                           const bool isUnderlined,
                                            _In_reads_(cColorTable) const COLORREF* const ColorTable,
                                            const WORD cColorTable) noexcept
 {
-    const bool fgChanged = colorForeground != _LastFG;
-    const bool bgChanged = colorBackground != _LastBG;
-    const bool fgIsDefault = colorForeground == _colorProvider.GetDefaultForeground();
-    const bool bgIsDefault = colorBackground == _colorProvider.GetDefaultBackground();
-
-    // If both the FG and BG should be the defaults, emit a SGR reset.
-    if ((fgChanged || bgChanged) && fgIsDefault && bgIsDefault)
-    {
-        // SGR Reset will also clear out the boldness of the text.
-        RETURN_IF_FAILED(_SetGraphicsDefault());
-        _LastFG = colorForeground;
-        _LastBG = colorBackground;
-        _lastWasBold = false;
-
-        // I'm not sure this is possible currently, but if the text is bold, but
-        //      default colors, make sure we bold it.
-        if (isBold)
-        {
-            RETURN_IF_FAILED(_SetGraphicsBoldness(isBold));
-            _lastWasBold = isBold;
-        }
-    }
-    else
-    {
-        if (_lastWasBold != isBold)
-        {
-            RETURN_IF_FAILED(_SetGraphicsBoldness(isBold));
-            _lastWasBold = isBold;
-        }
-
-        WORD wFoundColor = 0;
-        if (fgChanged)
-        {
-            if (fgIsDefault)
-            {
-                RETURN_IF_FAILED(_SetGraphicsRenditionDefaultColor(true));
-            }
-            else if (::FindTableIndex(colorForeground, ColorTable, cColorTable, &wFoundColor))
-            {
-                RETURN_IF_FAILED(_SetGraphicsRendition16Color(wFoundColor, true));
-            }
-            else
-            {
-                RETURN_IF_FAILED(_SetGraphicsRenditionRGBColor(colorForeground, true));
-            }
-            _LastFG = colorForeground;
-        }
-
-        if (bgChanged)
-        {
-            if (bgIsDefault)
-            {
-                RETURN_IF_FAILED(_SetGraphicsRenditionDefaultColor(false));
-            }
-            else if (::FindTableIndex(colorBackground, ColorTable, cColorTable, &wFoundColor))
-            {
-                RETURN_IF_FAILED(_SetGraphicsRendition16Color(wFoundColor, false));
-            }
-            else
-            {
-                RETURN_IF_FAILED(_SetGraphicsRenditionRGBColor(colorBackground, false));
-            }
-            _LastBG = colorBackground;
-        }
-    }
-
-    return S_OK;
+    return _UpdateGraphicsRendition(colorForeground, colorBackground, isBold, isUnderlined, false, ColorTable, cColorTable);
 }
 
 // Routine Description:
@@ -269,6 +253,8 @@ HRESULT VtEngine::_RgbUpdateDrawingBrushes(const COLORREF colorForeground,
 // Arguments:
 // - colorForeground: The RGB Color to use to paint the foreground text.
 // - colorBackground: The RGB Color to use to paint the background of the text.
+// - isBold: Whether the text should be bold.
+// - isUnderlined: Whether the text should be underlined.
 // - ColorTable: An array of colors to find the closest match to.
 // - cColorTable: size of the color table.
 // Return Value:
@@ -277,58 +263,156 @@ HRESULT VtEngine::_RgbUpdateDrawingBrushes(const COLORREF colorForeground,
 HRESULT VtEngine::_16ColorUpdateDrawingBrushes(const COLORREF colorForeground,
                                                const COLORREF colorBackground,
                                                const bool isBold,
+                                               const bool isUnderlined,
                                                _In_reads_(cColorTable) const COLORREF* const ColorTable,
                                                const WORD cColorTable) noexcept
 {
+    return _UpdateGraphicsRendition(colorForeground, colorBackground, isBold, isUnderlined, true, ColorTable, cColorTable);
+}
+
+// Routine Description:
+// - Write the one SGR sequence that takes the terminal from the attributes we
+//      last gave it to the ones requested. Only the attributes that changed
+//      are written, all as parameters of the same sequence. If resetting
+//      everything and setting the few attributes that aren't the defaults
+//      is shorter than that (like when going back to the default colors),
+//      that's written instead.
+// Arguments:
+// - colorForeground: The RGB Color to use to paint the foreground text.
+// - colorBackground: The RGB Color to use to paint the background of the text.
+// - isBold: Whether the text should be bold.
+// - isUnderlined: Whether the text should be underlined.
+// - use16Colors: If true, colors are always written as the nearest entry of
+//      the color table. Otherwise, colors not in the table are written as RGB.
+// - ColorTable: An array of colors to find the colors in.
+// - cColorTable: size of the color table.
+// Return Value:
+// - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+[[nodiscard]]
+HRESULT VtEngine::_UpdateGraphicsRendition(const COLORREF colorForeground,
+                                           const COLORREF colorBackground,
+                                           const bool isBold,
+                                           const bool isUnderlined,
+                                           const bool use16Colors,
+                                           _In_reads_(cColorTable) const COLORREF* const ColorTable,
+                                           const WORD cColorTable) noexcept
+{
+    // If output we passed through might have changed them, we don't know
+    //      what the attributes are, so they all have to be reset.
+    const bool fgChanged = _renditionUnknown || colorForeground != _LastFG;
+    const bool bgChanged = _renditionUnknown || colorBackground != _LastBG;
+    const bool boldChanged = _renditionUnknown || isBold != _lastWasBold;
+    const bool underlineChanged = _renditionUnknown || isUnderlined != _usingUnderLine;
+    if (!(fgChanged || bgChanged || boldChanged || underlineChanged))
+    {
+        return S_OK;
+    }
 
-    const bool fgChanged = colorForeground != _LastFG;
-    const bool bgChanged = colorBackground != _LastBG;
     const bool fgIsDefault = colorForeground == _colorProvider.GetDefaultForeground();
     const bool bgIsDefault = colorBackground == _colorProvider.GetDefaultBackground();
 
-    // If both the FG and BG should be the defaults, emit a SGR reset.
-    if ((fgChanged || bgChanged) && fgIsDefault && bgIsDefault)
+    // Only what changed...
+    CsiParameters changes;
+    if (boldChanged)
     {
-        // SGR Reset will also clear out the boldness of the text.
-        RETURN_IF_FAILED(_SetGraphicsDefault());
-        _LastFG = colorForeground;
-        _LastBG = colorBackground;
-        _lastWasBold = false;
-        // I'm not sure this is possible currently, but if the text is bold, but
-        //      default colors, make sure we bold it.
-        if (isBold)
-        {
-            RETURN_IF_FAILED(_SetGraphicsBoldness(isBold));
-            _lastWasBold = isBold;
-        }
+        changes.Append(isBold ? 1 : 22);
     }
-    else
+    if (underlineChanged)
     {
-        if (_lastWasBold != isBold)
-        {
-            RETURN_IF_FAILED(_SetGraphicsBoldness(isBold));
-            _lastWasBold = isBold;
-        }
+        changes.Append(isUnderlined ? 4 : 24);
+    }
+    if (fgChanged)
+    {
+        _AppendColorParameters(changes, colorForeground, true, fgIsDefault, use16Colors, ColorTable, cColorTable);
+    }
+    if (bgChanged)
+    {
+        _AppendColorParameters(changes, colorBackground, false, bgIsDefault, use16Colors, ColorTable, cColorTable);
+    }
 
-        if (fgChanged)
-        {
-            const WORD wNearestFg = ::FindNearestTableIndex(colorForeground, ColorTable, cColorTable);
-            RETURN_IF_FAILED(_SetGraphicsRendition16Color(wNearestFg, true));
+    // ...or a reset, and then whatever isn't the default. A reset on its
+    //      own is just "\x1b[m".
+    CsiParameters reset;
+    if (isBold || isUnderlined || !fgIsDefault || !bgIsDefault)
+    {
+        reset.Append(0);
+    }
+    if (isBold)
+    {
+        reset.Append(1);
+    }
+    if (isUnderlined)
+    {
+        reset.Append(4);
+    }
+    if (!fgIsDefault)
+    {
+        _AppendColorParameters(reset, colorForeground, true, false, use16Colors, ColorTable, cColorTable);
+    }
+    if (!bgIsDefault)
+    {
+        _AppendColorParameters(reset, colorBackground, false, false, use16Colors, ColorTable, cColorTable);
+    }
 
-            _LastFG = colorForeground;
-        }
+    const bool useReset = _renditionUnknown || reset.View().size() < changes.View().size();
+    RETURN_IF_FAILED(_WriteCsi(useReset ? reset : changes, 'm'));
 
-        if (bgChanged)
-        {
-            const WORD wNearestBg = ::FindNearestTableIndex(colorBackground, ColorTable, cColorTable);
-            RETURN_IF_FAILED(_SetGraphicsRendition16Color(wNearestBg, false));
+    _LastFG = colorForeground;
+    _LastBG = colorBackground;
+    _lastWasBold = isBold;
+    _usingUnderLine = isUnderlined;
+    _renditionUnknown = false;
 
-            _LastBG = colorBackground;
-        }
+    return S_OK;
+}
 
+// Routine Description:
+// - Adds the SGR parameter(s) that set the foreground or background to the
+//      given color to the parameters of a sequence.
+// Arguments:
+// - parameters: The parameters to add to.
+// - color: The color to get the parameters for.
+// - isForeground: true for the foreground, false for the background.
+// - isDefault: true if the color is the default for what it's used for. This
+//      is written as the default color, unless use16Colors is set.
+// - use16Colors: If true, always use the nearest entry of the color table.
+// - ColorTable: An array of colors to find the color in.
+// - cColorTable: size of the color table.
+// Return Value:
+// - <none>
+void VtEngine::_AppendColorParameters(CsiParameters& parameters,
+                                      const COLORREF color,
+                                      const bool isForeground,
+                                      const bool isDefault,
+                                      const bool use16Colors,
+                                      _In_reads_(cColorTable) const COLORREF* const ColorTable,
+                                      const WORD cColorTable) const noexcept
+{
+    if (use16Colors)
+    {
+        const WORD wNearest = ::FindNearestTableIndex(color, ColorTable, cColorTable);
+        parameters.Append(s_GraphicsRendition16ColorIndex(wNearest, isForeground));
+        return;
     }
 
-    return S_OK;
+    if (isDefault)
+    {
+        parameters.Append(isForeground ? 39 : 49);
+        return;
+    }
+
+    WORD wFoundColor = 0;
+    if (::FindTableIndex(color, ColorTable, cColorTable, &wFoundColor))
+    {
+        parameters.Append(s_GraphicsRendition16ColorIndex(wFoundColor, isForeground));
+        return;
+    }
+
+    parameters.Append(isForeground ? 38 : 48);
+    parameters.Append(2);
+    parameters.Append(GetRValue(color));
+    parameters.Append(GetGValue(color));
+    parameters.Append(GetBValue(color));
 }
 
 // Routine Description:
@@ -387,45 +471,27 @@ HRESULT VtEngine::_PaintUtf8BufferLine(std::basic_string_view<Cluster> const clu
 {
     if (coord.Y < _virtualTop)
     {
+        // Nothing's written, so the terminal keeps whatever it had here.
+        size_t columns = 0;
+        for (const auto& cluster : clusters)
+        {
+            columns += cluster.GetColumns();
+        }
+        _shadow.Forget(coord, columns);
         return S_OK;
     }
 
-    RETURN_IF_FAILED(_MoveCursor(coord));
-
-    std::wstring unclusteredString;
-    unclusteredString.reserve(clusters.size());
     short totalWidth = 0;
     for (const auto& cluster : clusters)
     {
-        unclusteredString.append(cluster.GetText());
         RETURN_IF_FAILED(ShortAdd(totalWidth, static_cast<short>(cluster.GetColumns()), &totalWidth));
     }
-    const size_t cchLine = unclusteredString.size();
 
-    bool foundNonspace = false;
-    size_t lastNonSpace = 0;
-    for (size_t i = 0; i < cchLine; i++)
+    size_t numSpaces = 0;
+    while (numSpaces < clusters.size() && clusters.at(clusters.size() - numSpaces - 1).GetText() == L"\x20")
     {
-        if (unclusteredString.at(i) != L'\x20')
-        {
-            lastNonSpace = i;
-            foundNonspace = true;
-        }
+        numSpaces++;
     }
-    // Examples:
-    // - "  ":
-    //      cch = 2, lastNonSpace = 0, foundNonSpace = false
-    //      cch-lastNonSpace = 2 -> good
-    //      cch-lastNonSpace-(0) = 2 -> good
-    // - "A "
-    //      cch = 2, lastNonSpace = 0, foundNonSpace = true
-    //      cch-lastNonSpace = 2 -> bad
-    //      cch-lastNonSpace-(1) = 1 -> good
-    // - "AA"
-    //      cch = 2, lastNonSpace = 1, foundNonSpace = true
-    //      cch-lastNonSpace = 1 -> bad
-    //      cch-lastNonSpace-(1) = 0 -> good
-    const size_t numSpaces = cchLine - lastNonSpace - (foundNonspace ? 1 : 0);
 
     // Optimizations:
     // If there are lots of spaces at the end of the line, we can try to Erase
@@ -436,6 +502,8 @@ HRESULT VtEngine::_PaintUtf8BufferLine(std::basic_string_view<Cluster> const clu
     // ESC [ %d X ESC [ %d C
     // ESC [ %d %d X ESC [ %d %d C
     // So we need at least 9 spaces for the optimized sequence to make sense.
+    // If the spaces run all the way to the right side of the terminal, Erase
+    //      in Line (ESC [ K) does the same in even fewer characters.
     // Also, if we already erased the entire display this frame, then
     //    don't do ANYTHING with erasing at all.
 
@@ -447,21 +515,39 @@ HRESULT VtEngine::_PaintUtf8BufferLine(std::basic_string_view<Cluster> const clu
     const bool useEraseChar = (optimalToUseECH) &&
                               (!_newBottomLine) &&
                               (!_clearedAllThisFrame);
+    const bool useEraseLine = useEraseChar &&
+                              (coord.X + totalWidth >= _lastViewport.Width());
 
     // If we're not using erase char, but we did erase all at the start of the
     //      frame, don't add spaces at the end.
     const bool removeSpaces = (useEraseChar || (_clearedAllThisFrame) || (_newBottomLine));
-    const size_t cchActual = removeSpaces ?
-                                (cchLine - numSpaces) :
-                                cchLine;
+    const size_t clustersActual = removeSpaces ?
+                                    (clusters.size() - numSpaces) :
+                                    clusters.size();
 
     const size_t columnsActual = removeSpaces ?
                                     (totalWidth - numSpaces) :
                                     totalWidth;
 
+    // A blank line on a screen we've already cleared this frame is already
+    //      there. There's nothing to write, so don't even move the cursor.
+    if (clustersActual == 0 && _clearedAllThisFrame && !_newBottomLine)
+    {
+        _shadow.Forget(coord, numSpaces);
+        return S_OK;
+    }
+
+    RETURN_IF_FAILED(_MoveCursor(coord));
+
     // Write the actual text string
-    std::wstring wstr = std::wstring(unclusteredString.data(), cchActual);
-    RETURN_IF_FAILED(VtEngine::_WriteTerminalUtf8(wstr));
+    RETURN_IF_FAILED(_WriteClustersUtf8(clusters.substr(0, clustersActual)));
+
+    // The spaces that are left off without being erased are whatever was there
+    //      already, so we can't say what they are.
+    if (removeSpaces && !useEraseChar)
+    {
+        _shadow.Forget({ gsl::narrow_cast<SHORT>(coord.X + columnsActual), coord.Y }, numSpaces);
+    }
 
     // Update our internal tracker of the cursor's position.
     // See MSFT:20266233
@@ -489,8 +575,8 @@ HRESULT VtEngine::_PaintUtf8BufferLine(std::basic_string_view<Cluster> const clu
 
     if (useEraseChar)
     {
-        RETURN_IF_FAILED(_EraseCharacter(sNumSpaces));
-        // ECH doesn't actually move the cursor itself. However, we think that
+        RETURN_IF_FAILED(useEraseLine ? _EraseLine() : _EraseCharacter(sNumSpaces));
+        // Neither ECH nor EL actually move the cursor themselves. However, we think that
         //   the cursor *should* be at the end of the area we just erased. Stash
         //   that position as our new deferred position. If we don't move the
         //   cursor somewhere else before the end of the frame, we'll move the
@@ -522,6 +608,270 @@ HRESULT VtEngine::_PaintUtf8BufferLine(std::basic_string_view<Cluster> const clu
     return S_OK;
 }
 
+// Routine Description:
+// - Resets a terminal that's reattaching, and writes it the given rows, which
+//      scroll up into its scrollback. The rows are written the same way a frame
+//      writes text, so only the attributes that change between runs are sent,
+//      and runs of spaces and repeated characters are squeezed.
+// - Everything we knew about what the terminal shows is forgotten, and the
+//      whole viewport is invalidated, so that this same frame repaints it.
+// Arguments:
+// - scrollback - the rows from above the viewport, from the top down.
+// Return Value:
+// - S_OK or suitable HRESULT error from writing pipe.
+[[nodiscard]]
+HRESULT VtEngine::_PaintReattach(const std::vector<ReattachRow>& scrollback) noexcept
+{
+    try
+    {
+        _shadow.Forget();
+        _renditionUnknown = true;
+        _lastText = INVALID_COORDS;
+        _deferredCursorPos = INVALID_COORDS;
+        _virtualTop = 0;
+        _newBottomLine = false;
+        _scrollDelta = { 0 };
+        _scrollRegion = Viewport::Empty();
+        _scrollRegionDelta = 0;
+
+        RETURN_IF_FAILED(_SetGraphicsDefault());
+        RETURN_IF_FAILED(_ResetTopBottomMargins());
+        RETURN_IF_FAILED(_CursorHome());
+        RETURN_IF_FAILED(_ClearScreen());
+        RETURN_IF_FAILED(_EraseScrollback());
+
+        std::vector<Cluster> clusters;
+        for (size_t index = 0; index < scrollback.size(); index++)
+        {
+            const auto& row = scrollback.at(index);
+            const std::wstring_view text{ row.text };
+
+            clusters.clear();
+            size_t offset = 0;
+            for (const auto& cluster : row.clusters)
+            {
+                clusters.emplace_back(text.substr(offset, cluster.first), cluster.second);
+                offset += cluster.first;
+            }
+
+            const std::basic_string_view<Cluster> rowClusters{ clusters.data(), clusters.size() };
+            size_t first = 0;
+            for (const auto& run : row.runs)
+            {
+                const auto count = std::min(run.clusters, rowClusters.size() - first);
+                RETURN_IF_FAILED(UpdateDrawingBrushes(run.foreground,
+                                                      run.background,
+                                                      run.legacyColorAttribute,
+                                                      run.isBold,
+                                                      false));
+                RETURN_IF_FAILED(_WriteClustersUtf8(rowClusters.substr(first, count)));
+                first += count;
+            }
+
+            // A wrapped row just runs on into the next one. Otherwise, go to
+            //      the next line in the default background, so the rest of the
+            //      line, and the line that scrolls in, isn't filled in color.
+            if (!row.wrapped || index == scrollback.size() - 1)
+            {
+                if (_LastBG != _colorProvider.GetDefaultBackground())
+                {
+                    RETURN_IF_FAILED(_SetGraphicsDefault());
+                    _renditionUnknown = true;
+                }
+                RETURN_IF_FAILED(_Write("\r\n"));
+            }
+        }
+
+        // Push the last of the rows off the top of the viewport, so the screen
+        //      is blank again for the frame to paint.
+        if (!scrollback.empty() && _lastViewport.Height() > 1)
+        {
+            RETURN_IF_FAILED(_Write(std::string(gsl::narrow_cast<size_t>(_lastViewport.Height() - 1), '\n')));
+        }
+
+        _clearedAllThisFrame = true;
+        _firstPaint = false;
+    }
+    CATCH_RETURN();
+
+    return InvalidateAll();
+}
+
+// Routine Description:
+// - Writes the clusters of a line to the pipe, encoded in UTF-8, with the long
+//      runs in it squeezed. A run of spaces is erased (ECH) and skipped over
+//      (CUF), and a run of the same character is written once and then
+//      repeated (REP). Either leaves the terminal, and its cursor, just as
+//      writing out the whole run would have.
+//   Spaces that are underlined have to be written, since erasing them would
+//      lose the line, but they can still be repeated.
+// Arguments:
+// - clusters - text and column widths to be written
+// Return Value:
+// - S_OK or suitable HRESULT error from writing pipe.
+[[nodiscard]]
+HRESULT VtEngine::_WriteClustersUtf8(std::basic_string_view<Cluster> const clusters) noexcept
+{
+    try
+    {
+        std::wstring text;
+        text.reserve(clusters.size());
+
+        const auto flushText = [&]() -> HRESULT {
+            if (!text.empty())
+            {
+                RETURN_IF_FAILED(_WriteTerminalUtf8(text));
+                text.clear();
+            }
+            return S_OK;
+        };
+
+        size_t index = 0;
+        while (index < clusters.size())
+        {
+            const auto& cluster = clusters.at(index);
+            const auto glyph = cluster.GetText();
+
+            // REP repeats one character, so only a run of characters that are
+            //      each a single code unit and column can be squeezed.
+            size_t run = 1;
+            if (glyph.size() == 1 && cluster.GetColumns() == 1)
+            {
+                while (index + run < clusters.size() &&
+                       clusters.at(index + run).GetColumns() == 1 &&
+                       clusters.at(index + run).GetText() == glyph)
+                {
+                    run++;
+                }
+            }
+
+            // ESC [ %d X ESC [ %d C
+            const size_t eraseLength = 6 + 2 * std::to_string(run).size();
+            // ESC [ %d b, after the first one is written
+            const size_t repeatLength = 3 + std::to_string(run - 1).size();
+
+            if (glyph == L"\x20" && !_usingUnderLine && run > eraseLength)
+            {
+                const auto sRun = gsl::narrow<short>(run);
+                RETURN_IF_FAILED(flushText());
+                RETURN_IF_FAILED(_EraseCharacter(sRun));
+                RETURN_IF_FAILED(_CursorForward(sRun));
+            }
+            else if (run - 1 > repeatLength)
+            {
+                text.append(glyph);
+                RETURN_IF_FAILED(flushText());
+                RETURN_IF_FAILED(_RepeatCharacter(gsl::narrow<short>(run - 1)));
+            }
+            else
+            {
+                for (size_t i = 0; i < run; i++)
+                {
+                    text.append(clusters.at(index + i).GetText());
+                }
+            }
+
+            index += run;
+        }
+
+        return flushText();
+    }
+    CATCH_RETURN();
+}
+
+// Routine Description:
+// - Draws one line of the buffer to the screen, but only the parts of it that
+//      the terminal doesn't already show. Each cluster is checked against the
+//      shadow of what was written before, and only the spans that changed are
+//      painted, with the cursor moved over the ones in between.
+//   Short runs of unchanged clusters between changes are written again anyway,
+//      since that's cheaper than the sequence to move the cursor past them.
+//   The colors for this line have already been sent by UpdateDrawingBrushes,
+//      they're only used here to tell whether a cell changed.
+// Arguments:
+// - clusters - text and column widths to be written
+// - coord - character coordinate target to render within viewport
+// - asciiOnly - true to write the text with _PaintAsciiBufferLine, false for
+//      _PaintUtf8BufferLine
+// Return Value:
+// - S_OK or suitable HRESULT error from writing pipe.
+[[nodiscard]]
+HRESULT VtEngine::_PaintChangedBufferLine(std::basic_string_view<Cluster> const clusters,
+                                          const COORD coord,
+                                          const bool asciiOnly) noexcept
+{
+    // A cursor forward is ESC [ %d C, so it's only worth skipping more than this.
+    static constexpr size_t MIN_SKIPPED_COLUMNS = 5;
+
+    try
+    {
+        const ShadowFrame::Attributes attributes{ _LastFG, _LastBG, _lastWasBold, _usingUnderLine };
+
+        size_t index = 0;
+        SHORT column = coord.X;
+        while (index < clusters.size())
+        {
+            // Skip over what's already there.
+            while (index < clusters.size() && _shadow.IsSame(clusters.at(index), { column, coord.Y }, attributes))
+            {
+                column += gsl::narrow<SHORT>(clusters.at(index).GetColumns());
+                ++index;
+            }
+
+            if (index == clusters.size())
+            {
+                break;
+            }
+
+            // Find where the changes end, which is the last changed cluster
+            //      before enough unchanged ones to be worth skipping.
+            const auto first = index;
+            const auto firstColumn = column;
+            auto last = index;
+            auto lastColumn = column;
+            size_t unchangedColumns = 0;
+            for (; index < clusters.size() && unchangedColumns < MIN_SKIPPED_COLUMNS; ++index)
+            {
+                const auto& cluster = clusters.at(index);
+                const auto columns = gsl::narrow<SHORT>(cluster.GetColumns());
+                if (_shadow.IsSame(cluster, { column, coord.Y }, attributes))
+                {
+                    unchangedColumns += columns;
+                }
+                else
+                {
+                    unchangedColumns = 0;
+                    last = index;
+                    lastColumn = column + columns;
+                }
+                column += columns;
+            }
+
+            const auto span = clusters.substr(first, last - first + 1);
+            const COORD spanCoord{ firstColumn, coord.Y };
+
+            // Record the span before it's painted, so that whatever the painting
+            //      leaves off can be forgotten again.
+            auto at = spanCoord;
+            for (const auto& cluster : span)
+            {
+                _shadow.Set(cluster, at, attributes);
+                at.X += gsl::narrow<SHORT>(cluster.GetColumns());
+            }
+
+            RETURN_IF_FAILED(asciiOnly ?
+                             _PaintAsciiBufferLine(span, spanCoord) :
+                             _PaintUtf8BufferLine(span, spanCoord));
+
+            index = last + 1;
+            column = lastColumn;
+        }
+
+        return S_OK;
+    }
+    CATCH_RETURN();
+}
+
 // Method Description:
 // - Updates the window's title string. Emits the VT sequence to SetWindowTitle.
 //      Because wintelnet does not understand these sequences by default, we
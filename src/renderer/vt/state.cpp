@@ -30,16 +30,24 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
                    const Viewport initialViewport) :
     RenderEngineBase(),
     _hFile(std::move(pipe)),
+    _outputRing{ nullptr },
+    _writer{ nullptr },
     _colorProvider(colorProvider),
     _LastFG(INVALID_COLOR),
     _LastBG(INVALID_COLOR),
     _lastWasBold(false),
+    _usingUnderLine(false),
+    _renditionUnknown(false),
+    _shadow{},
     _lastViewport(initialViewport),
     _invalidRect(Viewport::Empty()),
+    _dirtyRows{},
     _fInvalidRectUsed(false),
     _lastRealCursor({0}),
     _lastText({0}),
     _scrollDelta({0}),
+    _scrollRegion(Viewport::Empty()),
+    _scrollRegionDelta(0),
     _quickReturn(false),
     _clearedAllThisFrame(false),
     _cursorMoved(false),
@@ -51,6 +59,11 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
     _skipCursor(false),
     _pipeBroken(false),
     _exitResult{ S_OK },
+    _tearingDown{ false },
+    _passingThrough{ false },
+    _reattachLock{},
+    _reattachPending{ false },
+    _reattachScrollback{},
     _terminalOwner{ nullptr },
     _newBottomLine{ false },
     _deferredCursorPos{ INVALID_COORDS },
@@ -63,6 +76,14 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
     // member is only defined when UNIT_TESTING is.
     _usingTestCallback = false;
 #endif
+
+    _dirtyRows.Resize(_lastViewport.Dimensions());
+    _shadow.Resize(_lastViewport.Dimensions());
+
+    if (_hFile.get() != INVALID_HANDLE_VALUE)
+    {
+        _writer = std::make_unique<VtOutputWriter>(_hFile.get());
+    }
 }
 
 // Method Description:
@@ -94,6 +115,16 @@ HRESULT VtEngine::_Write(std::string_view const str) noexcept
     CATCH_RETURN();
 }
 
+// Method Description:
+// - Sends everything written since the last flush to the terminal. If the
+//      terminal gave us a shared ring, that's written right away. Otherwise,
+//      the frame is queued up on our writer, so that a terminal that's slow to
+//      read only holds up the writer's thread, not the render thread.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK, else the error writing to the terminal failed with. Once it's
+//      failed, we treat the pipe as broken and stop writing.
 [[nodiscard]]
 HRESULT VtEngine::_Flush() noexcept
 {
@@ -107,11 +138,24 @@ HRESULT VtEngine::_Flush() noexcept
 
     if (!_pipeBroken)
     {
-        bool fSuccess = !!WriteFile(_hFile.get(), _buffer.data(), static_cast<DWORD>(_buffer.size()), nullptr, nullptr);
+        HRESULT hr = S_OK;
+        if (_outputRing)
+        {
+            hr = _outputRing->Write(_buffer);
+        }
+        else
+        {
+            hr = _writer->Write(_buffer);
+            if (SUCCEEDED(hr) && _tearingDown)
+            {
+                // Nothing else is coming, so wait for this to make it out.
+                _writer->Shutdown();
+            }
+        }
         _buffer.clear();
-        if (!fSuccess)
+        if (FAILED(hr))
         {
-            _exitResult = HRESULT_FROM_WIN32(GetLastError());
+            _exitResult = hr;
             _pipeBroken = true;
             if (_terminalOwner)
             {
@@ -129,9 +173,84 @@ HRESULT VtEngine::_Flush() noexcept
 [[nodiscard]]
 HRESULT VtEngine::WriteTerminalUtf8(const std::string& str) noexcept
 {
+    // We can't tell what this does to the screen.
+    _shadow.Forget();
+
     return _Write(str);
 }
 
+// Method Description:
+// - Writes output from the client to the terminal as it is, instead of
+//      painting what it does to the buffer. This is only done when the
+//      terminal would do the same thing with it that the host does, so once
+//      the host has applied it to the buffer too, the terminal is showing
+//      the buffer.
+// - First, the terminal's cursor and attributes are put where the buffer's
+//      are, because the output picks up from there. Then until
+//      EndPassThrough, the invalidations that come from applying the output
+//      are dropped.
+// - We can't pass anything through while some of the buffer still has to be
+//      painted. It would get to the terminal ahead of the changes that came
+//      before it.
+// Arguments:
+// - str - The output to pass through.
+// - coordCursor - Where the buffer's cursor is, in the viewport.
+// - colorForeground, colorBackground, legacyColorAttribute, isBold: what the
+//      buffer's current attributes are drawn with.
+// Return Value:
+// - S_OK if the output was passed through, S_FALSE if it has to be painted,
+//      else an appropriate HRESULT for failing to write.
+[[nodiscard]]
+HRESULT VtEngine::BeginPassThrough(const std::wstring_view str,
+                                   const COORD coordCursor,
+                                   const COLORREF colorForeground,
+                                   const COLORREF colorBackground,
+                                   const WORD legacyColorAttribute,
+                                   const bool isBold) noexcept
+{
+    const bool somethingToPaint = _fInvalidRectUsed ||
+        (_scrollDelta.X != 0 || _scrollDelta.Y != 0) ||
+        (_scrollRegionDelta != 0) ||
+        _titleChanged ||
+        _circled ||
+        _firstPaint;
+    RETURN_HR_IF(S_FALSE, _pipeBroken || somethingToPaint);
+
+    try
+    {
+        RETURN_IF_FAILED(UpdateDrawingBrushes(colorForeground, colorBackground, legacyColorAttribute, isBold, false));
+        if (coordCursor.X != _lastText.X || coordCursor.Y != _lastText.Y)
+        {
+            RETURN_IF_FAILED(_CursorPosition(coordCursor));
+        }
+        RETURN_IF_FAILED(WriteTerminalW(std::wstring{ str }));
+    }
+    CATCH_RETURN();
+
+    // We can't tell what the output left the attributes at, or where it left
+    //      the cursor until the buffer has it too.
+    _renditionUnknown = true;
+    _lastText = INVALID_COORDS;
+    _passingThrough = true;
+
+    return _Flush();
+}
+
+// Method Description:
+// - Called once the output from BeginPassThrough has been applied to the
+//      buffer. From here on, what changes is painted again.
+// Arguments:
+// - coordCursor - Where the buffer's cursor is now, in the viewport. The
+//      terminal's cursor is there too.
+// Return Value:
+// - <none>
+void VtEngine::EndPassThrough(const COORD coordCursor) noexcept
+{
+    _passingThrough = false;
+    _lastText = coordCursor;
+    _newBottomLine = false;
+}
+
 // Method Description:
 // - Writes a wstring to the tty, encoded as full utf-8. This is one
 //      implementation of the WriteTerminalW method.
@@ -177,42 +296,6 @@ HRESULT VtEngine::_WriteTerminalAscii(const std::wstring& wstr) noexcept
     return _Write(needed);
 }
 
-// Method Description:
-// - Helper for calling _Write with a string for formatting a sequence. Used
-//      extensively by VtSequences.cpp
-// Arguments:
-// - pFormat: the pointer to the string to write to the pipe.
-// - ...: a va_list of args to format the string with.
-// Return Value:
-// - S_OK, E_INVALIDARG for a invalid format string, or suitable HRESULT error
-//      from writing pipe.
-[[nodiscard]]
-HRESULT VtEngine::_WriteFormattedString(const std::string* const pFormat, ...) noexcept
-{
-
-    HRESULT hr = E_FAIL;
-    va_list argList;
-    va_start(argList, pFormat);
-
-    int cchNeeded = _scprintf(pFormat->c_str(), argList);
-    // -1 is the _scprintf error case https://msdn.microsoft.com/en-us/library/t32cf9tb.aspx
-    if (cchNeeded > -1)
-    {
-        wistd::unique_ptr<char[]> psz = wil::make_unique_nothrow<char[]>(cchNeeded + 1);
-        RETURN_IF_NULL_ALLOC(psz);
-
-        int cchWritten = _vsnprintf_s(psz.get(), cchNeeded + 1, cchNeeded, pFormat->c_str(), argList);
-        hr = _Write({ psz.get(), gsl::narrow<size_t>(cchWritten) });
-    }
-    else
-    {
-        hr = E_INVALIDARG;
-    }
-
-    va_end(argList);
-    return hr;
-}
-
 // Method Description:
 // - This method will update the active font on the current device context
 //      Does nothing for vt, the font is handed by the terminal.
@@ -259,6 +342,13 @@ HRESULT VtEngine::UpdateViewport(const SMALL_RECT srNewViewport) noexcept
 
     _lastViewport = newView;
 
+    try
+    {
+        _dirtyRows.Resize(newView.Dimensions());
+        _shadow.Resize(newView.Dimensions());
+    }
+    CATCH_RETURN();
+
     if ((oldView.Height() != newView.Height()) || (oldView.Width() != newView.Width()))
     {
         // Don't emit a resize event if we've requested it be suppressed
@@ -415,11 +505,47 @@ HRESULT VtEngine::InheritCursor(const COORD coordCursor) noexcept
     return S_OK;
 }
 
+// Method Description:
+// - Sends everything again to a terminal that's reattaching to us, say after
+//      its UI was restarted, and has none of what we painted before. The next
+//      frame resets the terminal, writes it the given rows for its scrollback,
+//      and paints the whole viewport, all in one go. See _PaintReattach.
+// - This can be called from any thread. The caller should make sure a frame
+//      is painted soon after, by invalidating everything.
+// Arguments:
+// - scrollback: the rows from above the viewport to send, from the top down.
+// Return Value:
+// - <none>
+void VtEngine::Reattach(std::vector<ReattachRow> scrollback) noexcept
+{
+    try
+    {
+        std::lock_guard<std::mutex> guard{ _reattachLock };
+        _reattachScrollback = std::move(scrollback);
+        _reattachPending = true;
+    }
+    CATCH_LOG();
+}
+
 void VtEngine::SetTerminalOwner(Microsoft::Console::ITerminalOwner* const terminalOwner)
 {
     _terminalOwner = terminalOwner;
 }
 
+// Method Description:
+// - Sends all our output through the given shared ring, rather than our pipe.
+//      The terminal reads it straight out of the ring, without a copy through
+//      the kernel on either side. If the ring is closed, we treat it like a
+//      broken pipe.
+// Arguments:
+// - ring: the ring to write to. We take ownership of it.
+// Return Value:
+// - <none>
+void VtEngine::SetOutputRing(std::unique_ptr<Microsoft::Console::Types::SharedRing> ring) noexcept
+{
+    _outputRing = std::move(ring);
+}
+
 // Method Description:
 // - sends a sequence to request the end terminal to tell us the
 //      cursor position. The terminal will reply back on the vt input handle.
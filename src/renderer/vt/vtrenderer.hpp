@@ -16,13 +16,18 @@ Author(s):
 #pragma once
 
 #include "../inc/RenderEngineBase.hpp"
+#include "../inc/DirtyRows.hpp"
 #include "../../inc/IDefaultColorProvider.hpp"
 #include "../../inc/ITerminalOutputConnection.hpp"
 #include "../../inc/ITerminalOwner.hpp"
 #include "../../types/inc/Viewport.hpp"
+#include "../../types/inc/SharedRing.hpp"
 #include "tracing.hpp"
+#include "ShadowFrame.hpp"
+#include "VtOutputWriter.hpp"
 #include <string>
 #include <functional>
+#include <charconv>
 
 namespace Microsoft::Console::Render
 {
@@ -62,6 +67,8 @@ namespace Microsoft::Console::Render
         virtual HRESULT EndPaint() noexcept override;
         [[nodiscard]]
         virtual HRESULT Present() noexcept override;
+        [[nodiscard]]
+        HRESULT WaitUntilCanRender() noexcept override;
 
         [[nodiscard]]
         virtual HRESULT ScrollFrame() noexcept = 0;
@@ -103,6 +110,7 @@ namespace Microsoft::Console::Render
                                 const int iDpi) noexcept override;
 
         SMALL_RECT GetDirtyRectInChars() override;
+        std::vector<SMALL_RECT> GetDirtyArea() override;
         [[nodiscard]]
         HRESULT GetFontSize(_Out_ COORD* const pFontSize) noexcept override;
         [[nodiscard]]
@@ -116,16 +124,58 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT InheritCursor(const COORD coordCursor) noexcept;
 
+        // A row from above the viewport, as it's sent to a terminal that
+        //      reattaches. See Reattach.
+        struct ReattachRow
+        {
+            // A stretch of the row's clusters that are all in the same attributes.
+            struct Run
+            {
+                size_t clusters;
+                COLORREF foreground;
+                COLORREF background;
+                WORD legacyColorAttribute;
+                bool isBold;
+            };
+
+            // The text of the clusters, back to back, and how many code units
+            //      of it and how many columns each one is.
+            std::wstring text;
+            std::vector<std::pair<size_t, size_t>> clusters;
+            std::vector<Run> runs;
+            bool wrapped;
+        };
+
+        void Reattach(std::vector<ReattachRow> scrollback) noexcept;
+
         [[nodiscard]]
         HRESULT WriteTerminalUtf8(const std::string& str) noexcept;
 
         [[nodiscard]]
         virtual HRESULT WriteTerminalW(const std::wstring& str) noexcept = 0;
 
+        [[nodiscard]]
+        HRESULT BeginPassThrough(const std::wstring_view str,
+                                 const COORD coordCursor,
+                                 const COLORREF colorForeground,
+                                 const COLORREF colorBackground,
+                                 const WORD legacyColorAttribute,
+                                 const bool isBold) noexcept;
+        virtual void EndPassThrough(const COORD coordCursor) noexcept;
+
         void SetTerminalOwner(Microsoft::Console::ITerminalOwner* const terminalOwner);
+        void SetOutputRing(std::unique_ptr<Microsoft::Console::Types::SharedRing> ring) noexcept;
 
     protected:
         wil::unique_hfile _hFile;
+        // If the terminal set up a shared ring for our output, we write to that instead of _hFile.
+        std::unique_ptr<Microsoft::Console::Types::SharedRing> _outputRing;
+        // Otherwise, each frame is handed to this to be written to _hFile from
+        //      another thread. It's declared after _hFile so that it's shut
+        //      down before the pipe is closed.
+        std::unique_ptr<VtOutputWriter> _writer;
+        // The longest the render thread waits for the terminal to catch up.
+        static constexpr DWORD s_BacklogWaitMs = 250;
         std::string _buffer;
 
         const Microsoft::Console::IDefaultColorProvider& _colorProvider;
@@ -133,14 +183,29 @@ namespace Microsoft::Console::Render
         COLORREF _LastFG;
         COLORREF _LastBG;
         bool _lastWasBold;
+        bool _usingUnderLine;
+        // Set when output we passed through might have changed the attributes
+        //      the terminal is using. The next SGR we write resets them all.
+        bool _renditionUnknown;
+
+        // What the terminal is showing, as far as we know. See _PaintChangedBufferLine.
+        ShadowFrame _shadow;
 
         Microsoft::Console::Types::Viewport _lastViewport;
         Microsoft::Console::Types::Viewport _invalidRect;
+        // What's dirty in each row. _invalidRect is still kept as the rectangle
+        //      around all of it.
+        DirtyRows _dirtyRows;
 
         bool _fInvalidRectUsed;
         COORD _lastRealCursor;
         COORD _lastText;
         COORD _scrollDelta;
+        // A scroll of only some of the rows, inside of the margins, that's
+        //      waiting to be sent. Only one of these and _scrollDelta is ever
+        //      set at once.
+        Microsoft::Console::Types::Viewport _scrollRegion;
+        short _scrollRegionDelta;
 
         bool _quickReturn;
         bool _clearedAllThisFrame;
@@ -158,6 +223,18 @@ namespace Microsoft::Console::Render
 
         bool _pipeBroken;
         HRESULT _exitResult;
+        // Set once we're about to go away, so that the last frame is written
+        //      out before EndPaint returns.
+        bool _tearingDown;
+        // Set between BeginPassThrough and EndPassThrough. Whatever the output
+        //      that's passed through does to the buffer, the terminal does too,
+        //      so we drop the invalidations it causes.
+        bool _passingThrough;
+        // Set by Reattach, which isn't called on the render thread, and
+        //      taken up by the next frame. Guarded by _reattachLock.
+        std::mutex _reattachLock;
+        bool _reattachPending;
+        std::vector<ReattachRow> _reattachScrollback;
         Microsoft::Console::ITerminalOwner* _terminalOwner;
 
         Microsoft::Console::VirtualTerminal::RenderTracing _trace;
@@ -165,16 +242,50 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT _Write(std::string_view const str) noexcept;
         [[nodiscard]]
-        HRESULT _WriteFormattedString(const std::string* const pFormat, ...) noexcept;
-        [[nodiscard]]
         HRESULT _Flush() noexcept;
 
+        // The parameters of a CSI sequence, formatted on the stack as they're
+        //      added. Sequences are written from these instead of through a
+        //      printf-style format, so that writing one doesn't allocate.
+        class CsiParameters final
+        {
+        public:
+            // Enough for the longest sequence we write, an SGR with a reset,
+            //      bold, underline, and two RGB colors.
+            static constexpr size_t s_Capacity = 64;
+
+            CsiParameters() noexcept;
+
+            void Append(const int value) noexcept;
+            std::string_view View() const noexcept;
+
+        private:
+            char _chars[s_Capacity];
+            size_t _length;
+        };
+
+        [[nodiscard]]
+        HRESULT _WriteCsi(const CsiParameters& parameters, const char finalChar) noexcept;
+
+        // Writes "\x1b[", each of the parameters, separated by ';', and then
+        //      the final character.
+        template<typename... Params>
+        [[nodiscard]]
+        HRESULT _WriteCsi(const char finalChar, const Params... params) noexcept
+        {
+            CsiParameters parameters;
+            (parameters.Append(static_cast<int>(params)), ...);
+            return _WriteCsi(parameters, finalChar);
+        }
+
         void _OrRect(_Inout_ SMALL_RECT* const pRectExisting, const SMALL_RECT* const pRectToOr) const;
         [[nodiscard]]
         HRESULT _InvalidCombine(const Microsoft::Console::Types::Viewport invalid) noexcept;
         [[nodiscard]]
         HRESULT _InvalidOffset(const COORD* const ppt) noexcept;
         [[nodiscard]]
+        HRESULT _InvalidOffsetInside(const Microsoft::Console::Types::Viewport& region, const short dy) noexcept;
+        [[nodiscard]]
         HRESULT _InvalidRestrict() noexcept;
         bool _AllIsInvalid() const;
 
@@ -199,16 +310,28 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT _EraseCharacter(const short chars) noexcept;
         [[nodiscard]]
+        HRESULT _RepeatCharacter(const short chars) noexcept;
+        [[nodiscard]]
+        HRESULT _SetTopBottomMargins(const short top, const short bottom) noexcept;
+        [[nodiscard]]
+        HRESULT _ResetTopBottomMargins() noexcept;
+        [[nodiscard]]
+        HRESULT _ScrollMargins(const short lines, const bool up) noexcept;
+        [[nodiscard]]
         HRESULT _CursorPosition(const COORD coord) noexcept;
         [[nodiscard]]
         HRESULT _CursorHome() noexcept;
         [[nodiscard]]
         HRESULT _ClearScreen() noexcept;
         [[nodiscard]]
+        HRESULT _EraseScrollback() noexcept;
+        [[nodiscard]]
         HRESULT _ChangeTitle(const std::string& title) noexcept;
         [[nodiscard]]
         HRESULT _SetGraphicsRendition16Color(const WORD wAttr,
                                             const bool fIsForeground) noexcept;
+        static int s_GraphicsRendition16ColorIndex(const WORD wAttr,
+                                                   const bool fIsForeground) noexcept;
         [[nodiscard]]
         HRESULT _SetGraphicsRenditionRGBColor(const COLORREF color,
                                             const bool fIsForeground) noexcept;
@@ -239,14 +362,31 @@ namespace Microsoft::Console::Render
         HRESULT _RgbUpdateDrawingBrushes(const COLORREF colorForeground,
                                          const COLORREF colorBackground,
                                          const bool isBold,
+                                         const bool isUnderlined,
                                          _In_reads_(cColorTable) const COLORREF* const ColorTable,
                                          const WORD cColorTable) noexcept;
         [[nodiscard]]
         HRESULT _16ColorUpdateDrawingBrushes(const COLORREF colorForeground,
                                              const COLORREF colorBackground,
                                              const bool isBold,
+                                             const bool isUnderlined,
                                              _In_reads_(cColorTable) const COLORREF* const ColorTable,
                                              const WORD cColorTable) noexcept;
+        [[nodiscard]]
+        HRESULT _UpdateGraphicsRendition(const COLORREF colorForeground,
+                                         const COLORREF colorBackground,
+                                         const bool isBold,
+                                         const bool isUnderlined,
+                                         const bool use16Colors,
+                                         _In_reads_(cColorTable) const COLORREF* const ColorTable,
+                                         const WORD cColorTable) noexcept;
+        void _AppendColorParameters(CsiParameters& parameters,
+                                    const COLORREF color,
+                                    const bool isForeground,
+                                    const bool isDefault,
+                                    const bool use16Colors,
+                                    _In_reads_(cColorTable) const COLORREF* const ColorTable,
+                                    const WORD cColorTable) const noexcept;
 
         bool _WillWriteSingleChar() const;
 
@@ -258,6 +398,17 @@ namespace Microsoft::Console::Render
         HRESULT _PaintAsciiBufferLine(std::basic_string_view<Cluster> const clusters,
                                       const COORD coord) noexcept;
 
+        [[nodiscard]]
+        HRESULT _PaintChangedBufferLine(std::basic_string_view<Cluster> const clusters,
+                                        const COORD coord,
+                                        const bool asciiOnly) noexcept;
+
+        [[nodiscard]]
+        HRESULT _WriteClustersUtf8(std::basic_string_view<Cluster> const clusters) noexcept;
+
+        [[nodiscard]]
+        HRESULT _PaintReattach(const std::vector<ReattachRow>& scrollback) noexcept;
+
         [[nodiscard]]
         HRESULT _WriteTerminalUtf8(const std::wstring& str) noexcept;
         [[nodiscard]]
@@ -26,6 +26,7 @@ WddmConEngine::WddmConEngine() :
     _displayHeight(0),
     _displayWidth(0),
     _displayState(nullptr),
+    _forceFullRedraw(true),
     _currentLegacyColorAttribute(DEFAULT_COLOR_ATTRIBUTE)
 {
 
@@ -155,6 +156,9 @@ bool WddmConEngine::IsInitialized()
 HRESULT WddmConEngine::Enable() noexcept
 {
     RETURN_IF_HANDLE_INVALID(_hWddmConCtx);
+
+    // Whoever had the display in the meantime drew over what we left on it.
+    _forceFullRedraw = true;
     return WDDMConEnableDisplayAccess((PHANDLE)_hWddmConCtx, TRUE);
 }
 
@@ -215,32 +219,85 @@ HRESULT WddmConEngine::PrepareForTeardown(_Out_ bool* const pForcePaint) noexcep
     return S_FALSE;
 }
 
+// Routine Description:
+// - Starts painting a frame. The frame is only painted into the New cells of
+//   each row here. Nothing is sent to the display until Present.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK, or E_HANDLE if the engine isn't initialized.
 [[nodiscard]]
 HRESULT WddmConEngine::StartPaint() noexcept
 {
     RETURN_IF_HANDLE_INVALID(_hWddmConCtx);
-    return WDDMConBeginUpdateDisplayBatch(_hWddmConCtx);
+    return S_OK;
 }
 
 [[nodiscard]]
 HRESULT WddmConEngine::EndPaint() noexcept
 {
     RETURN_IF_HANDLE_INVALID(_hWddmConCtx);
-    return WDDMConEndUpdateDisplayBatch(_hWddmConCtx);
+    return S_OK;
 }
 
 // Routine Description:
-// - Used to perform longer running presentation steps outside the lock so the other threads can continue.
-// - Not currently used by WddmConEngine.
+// - Sends the rows of the frame that differ from what the display shows, all in
+//   one batch, outside of the lock. The display only redraws the cells within a
+//   row that changed, so a row that didn't change is skipped altogether.
 // Arguments:
 // - <none>
 // Return Value:
-// - S_FALSE since we do nothing.
-
+// - S_OK if rows were sent, S_FALSE if nothing changed since the last frame,
+//   or a suitable HRESULT if the display didn't take the frame.
 [[nodiscard]]
 HRESULT WddmConEngine::Present() noexcept
 {
-    return S_FALSE;
+    RETURN_IF_HANDLE_INVALID(_hWddmConCtx);
+
+    const size_t rowBytes = _displayWidth * sizeof(CD_IO_CHARACTER);
+    const BOOLEAN invalidate = _forceFullRedraw ? TRUE : FALSE;
+    bool batched = false;
+    HRESULT hr = S_OK;
+
+    for (LONG rowIndex = 0; rowIndex < _displayHeight && SUCCEEDED(hr); rowIndex++)
+    {
+        const PCD_IO_ROW_INFORMATION row = _displayState[rowIndex];
+        if (!invalidate && memcmp(row->New, row->Old, rowBytes) == 0)
+        {
+            continue;
+        }
+
+        if (!batched)
+        {
+            hr = WDDMConBeginUpdateDisplayBatch(_hWddmConCtx);
+            if (FAILED(hr))
+            {
+                break;
+            }
+            batched = true;
+        }
+
+        hr = WDDMConUpdateDisplay(_hWddmConCtx, row, invalidate);
+        if (SUCCEEDED(hr))
+        {
+            memcpy(row->Old, row->New, rowBytes);
+        }
+    }
+
+    if (batched)
+    {
+        const HRESULT hrEnd = WDDMConEndUpdateDisplayBatch(_hWddmConCtx);
+        if (SUCCEEDED(hr))
+        {
+            hr = hrEnd;
+        }
+    }
+
+    // If the display didn't take all of the frame, we can't tell what it shows.
+    _forceFullRedraw = FAILED(hr);
+    RETURN_IF_FAILED(hr);
+
+    return batched ? S_OK : S_FALSE;
 }
 
 [[nodiscard]]
@@ -254,25 +311,20 @@ HRESULT WddmConEngine::PaintBackground() noexcept
 {
     RETURN_IF_HANDLE_INVALID(_hWddmConCtx);
 
-    PCD_IO_CHARACTER OldChar;
     PCD_IO_CHARACTER NewChar;
 
+    // What's on the display stays in the Old cells, for Present to compare against.
     for (LONG rowIndex = 0; rowIndex < _displayHeight; rowIndex++)
     {
         for (LONG colIndex = 0; colIndex < _displayWidth; colIndex++)
         {
-            OldChar = &_displayState[rowIndex]->Old[colIndex];
             NewChar = &_displayState[rowIndex]->New[colIndex];
 
-            OldChar->Character = NewChar->Character;
-            OldChar->Atribute = NewChar->Atribute;
-
             NewChar->Character = L' ';
             NewChar->Atribute = 0x0;
         }
     }
 
-
     return S_OK;
 }
 
@@ -284,23 +336,20 @@ HRESULT WddmConEngine::PaintBufferLine(std::basic_string_view<Cluster> const clu
     try
     {
         RETURN_IF_HANDLE_INVALID(_hWddmConCtx);
+        RETURN_HR_IF(E_INVALIDARG, coord.X < 0 || coord.Y < 0 || coord.Y >= _displayHeight);
 
-        PCD_IO_CHARACTER OldChar;
         PCD_IO_CHARACTER NewChar;
 
-        for (size_t i = 0; i < clusters.size() && i < (size_t)_displayWidth; i++)
+        // The line only goes into the frame. Present sends it if it changed.
+        for (size_t i = 0; i < clusters.size() && coord.X + i < (size_t)_displayWidth; i++)
         {
-            OldChar = &_displayState[coord.Y]->Old[coord.X + i];
             NewChar = &_displayState[coord.Y]->New[coord.X + i];
 
-            OldChar->Character = NewChar->Character;
-            OldChar->Atribute = NewChar->Atribute;
-
             NewChar->Character = clusters.at(i).GetTextAsSingle();
             NewChar->Atribute = _currentLegacyColorAttribute;
         }
 
-        return WDDMConUpdateDisplay(_hWddmConCtx, _displayState[coord.Y], FALSE);
+        return S_OK;
     }
     CATCH_RETURN();
 }
@@ -106,8 +106,14 @@ namespace Microsoft::Console::Render
         LONG _displayHeight;
         LONG _displayWidth;
 
+        // Each row's Old cells are what the display shows, and its New cells are
+        // the frame being painted. Present sends the rows where they differ.
         PCD_IO_ROW_INFORMATION *_displayState;
 
+        // Set when what the display shows isn't known, e.g. after it was given
+        // back to us or failed to take a frame, so that every row is sent again.
+        bool _forceFullRedraw;
+
         WORD _currentLegacyColorAttribute;
     };
 }
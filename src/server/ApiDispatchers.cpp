@@ -35,7 +35,7 @@ HRESULT ApiDispatchers::ServerGetConsoleMode(_Inout_ CONSOLE_API_MSG * const m,
 {
     Telemetry::Instance().LogApiCall(Telemetry::ApiCall::GetConsoleMode);
     CONSOLE_MODE_MSG* const a = &m->u.consoleMsgL1.GetConsoleMode;
-    std::wstring handleType = L"unknown";
+    const wchar_t* handleType = L"unknown";
 
     TraceLoggingWrite(g_hConhostV2EventTraceProvider, "API_GetConsoleMode",
                       TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
@@ -153,15 +153,18 @@ HRESULT ApiDispatchers::ServerGetConsoleInput(_Inout_ CONSOLE_API_MSG * const m,
     HRESULT hr;
     std::deque<std::unique_ptr<IInputEvent>> outEvents;
     size_t const eventsToRead = cRecords;
+    size_t eventsRead = 0;
     if (a->Unicode)
     {
+        // The W records go straight into the reply buffer, as they're stored.
+        const gsl::span<INPUT_RECORD> outRecords{ rgRecords, gsl::narrow_cast<ptrdiff_t>(cRecords) };
         if (fIsPeek)
         {
-            hr = m->_pApiRoutines->PeekConsoleInputWImpl(*pInputBuffer, outEvents, eventsToRead, *pInputReadHandleData, waiter);
+            hr = m->_pApiRoutines->PeekConsoleInputWImpl(*pInputBuffer, outRecords, eventsRead, *pInputReadHandleData, waiter);
         }
         else
         {
-            hr = m->_pApiRoutines->ReadConsoleInputWImpl(*pInputBuffer, outEvents, eventsToRead, *pInputReadHandleData, waiter);
+            hr = m->_pApiRoutines->ReadConsoleInputWImpl(*pInputBuffer, outRecords, eventsRead, *pInputReadHandleData, waiter);
         }
     }
     else
@@ -174,14 +177,15 @@ HRESULT ApiDispatchers::ServerGetConsoleInput(_Inout_ CONSOLE_API_MSG * const m,
         {
             hr = m->_pApiRoutines->ReadConsoleInputAImpl(*pInputBuffer, outEvents, eventsToRead, *pInputReadHandleData, waiter);
         }
+        eventsRead = outEvents.size();
     }
 
     // We must return the number of records in the message payload (to alert the client)
     // as well as in the message headers (below in SetReplyInfomration) to alert the driver.
-    LOG_IF_FAILED(SizeTToULong(outEvents.size(), &a->NumRecords));
+    LOG_IF_FAILED(SizeTToULong(eventsRead, &a->NumRecords));
 
     size_t cbWritten;
-    LOG_IF_FAILED(SizeTMult(outEvents.size(), sizeof(INPUT_RECORD), &cbWritten));
+    LOG_IF_FAILED(SizeTMult(eventsRead, sizeof(INPUT_RECORD), &cbWritten));
 
     if (nullptr != waiter.get())
     {
@@ -209,7 +213,7 @@ HRESULT ApiDispatchers::ServerGetConsoleInput(_Inout_ CONSOLE_API_MSG * const m,
             hr = S_OK;
         }
     }
-    else
+    else if (!a->Unicode)
     {
         try
         {
@@ -386,8 +390,8 @@ HRESULT ApiDispatchers::ServerWriteConsole(_Inout_ CONSOLE_API_MSG * const m, _I
     RETURN_IF_FAILED(HandleData->GetScreenBuffer(GENERIC_WRITE, &pScreenInfo));
 
     // Get input parameter buffer
-    PVOID pvBuffer;
-    ULONG cbBufferSize;
+    PVOID pvBuffer = nullptr;
+    ULONG cbBufferSize = 0;
     auto tracing = wil::scope_exit([&]()
     {
         Tracing::s_TraceApi(pvBuffer, a);
@@ -1679,3 +1683,14 @@ HRESULT ApiDispatchers::ServerSetConsoleCurrentFont(_Inout_ CONSOLE_API_MSG * co
 
     return m->_pApiRoutines->SetCurrentConsoleFontExImpl(*pObj, a->MaximumWindow, Info);
 }
+
+// Routine Description:
+// - Gets how much memory one part of the console is holding. This isn't a
+//   public API; it's for diagnosing a console that's grown too big.
+[[nodiscard]]
+HRESULT ApiDispatchers::ServerGetConsoleMemoryUsage(_Inout_ CONSOLE_API_MSG * const m, _Inout_ BOOL* const /*pbReplyPending*/)
+{
+    CONSOLE_GETMEMORYUSAGE_MSG* const a = &m->u.consoleMsgL3.GetConsoleMemoryUsage;
+
+    return m->_pApiRoutines->GetConsoleMemoryUsageImpl(a->Subsystem, a->Bytes, a->Allocations);
+}
@@ -7,6 +7,7 @@
 
 #include "ApiMessage.h"
 #include "DeviceComm.h"
+#include "MessageBufferPool.h"
 
 _CONSOLE_API_MSG::_CONSOLE_API_MSG() : 
     _pDeviceComm(nullptr),
@@ -67,12 +68,17 @@ HRESULT _CONSOLE_API_MSG::GetInputBuffer(_Outptr_result_bytebuffer_(*pcbSize) vo
 
         ULONG const cbReadSize = Descriptor.InputSize - State.ReadOffset;
 
-        wistd::unique_ptr<BYTE[]> pPayload = wil::make_unique_nothrow<BYTE[]>(cbReadSize);
+        BYTE* const pPayload = MessageBufferPool::s_Allocate(cbReadSize);
         RETURN_IF_NULL_ALLOC(pPayload);
 
-        RETURN_IF_FAILED(ReadMessageInput(0, pPayload.get(), cbReadSize));
+        const HRESULT hr = ReadMessageInput(0, pPayload, cbReadSize);
+        if (FAILED(hr))
+        {
+            MessageBufferPool::s_Free(pPayload, cbReadSize);
+            RETURN_HR(hr);
+        }
 
-        State.InputBuffer = pPayload.release(); // TODO: MSFT: 9565140 - don't release, maintain as smart pointer.
+        State.InputBuffer = pPayload; // TODO: MSFT: 9565140 - maintain as smart pointer.
         State.InputBufferSize = cbReadSize;
     }
 
@@ -106,7 +112,7 @@ HRESULT _CONSOLE_API_MSG::GetAugmentedOutputBuffer(const ULONG cbFactor,
         ULONG cbWriteSize = Descriptor.OutputSize - State.WriteOffset;
         RETURN_IF_FAILED(ULongMult(cbWriteSize, cbFactor, &cbWriteSize));
 
-        BYTE* pPayload = new(std::nothrow) BYTE[cbWriteSize];
+        BYTE* const pPayload = MessageBufferPool::s_Allocate(cbWriteSize);
         RETURN_IF_NULL_ALLOC(pPayload);
         ZeroMemory(pPayload, sizeof(BYTE) * cbWriteSize);
 
@@ -153,7 +159,7 @@ HRESULT _CONSOLE_API_MSG::ReleaseMessageBuffers()
 
     if (State.InputBuffer != nullptr)
     {
-        delete[] static_cast<BYTE*>(State.InputBuffer);
+        MessageBufferPool::s_Free(static_cast<BYTE*>(State.InputBuffer), State.InputBufferSize);
         State.InputBuffer = nullptr;
     }
 
@@ -170,7 +176,7 @@ HRESULT _CONSOLE_API_MSG::ReleaseMessageBuffers()
             LOG_IF_FAILED(_pDeviceComm->WriteOutput(&IoOperation));
         }
 
-        delete[] static_cast<BYTE*>(State.OutputBuffer);
+        MessageBufferPool::s_Free(static_cast<BYTE*>(State.OutputBuffer), State.OutputBufferSize);
         State.OutputBuffer = nullptr;
     }
 
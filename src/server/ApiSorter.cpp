@@ -7,19 +7,25 @@
 
 #include "ApiDispatchers.h"
 
+#include "../host/ApiStatistics.hpp"
 #include "../host/tracing.hpp"
+#include "../types/inc/ScratchArena.hpp"
 
-#define CONSOLE_API_STRUCT(Routine, Struct, TraceName) { Routine, sizeof(Struct), TraceName }
-#define CONSOLE_API_NO_PARAMETER(Routine, TraceName) { Routine, 0, TraceName }
+#define CONSOLE_API_STRUCT(Routine, Struct, TraceName) { Routine, sizeof(Struct), TraceName, false }
+#define CONSOLE_API_NO_PARAMETER(Routine, TraceName) { Routine, 0, TraceName, false }
 
-#define CONSOLE_API_DEPRECATED(Struct) { ApiDispatchers::ServerDeprecatedApi, sizeof(Struct), "Deprecated"}
-#define CONSOLE_API_DEPRECATED_NO_PARAM() {ApiDispatchers::ServerDeprecatedApi, 0, "Deprecated"}
+// An API that only reads the console's state. See ApiSorter::IsReadOnlyRequest.
+#define CONSOLE_API_READONLY_STRUCT(Routine, Struct, TraceName) { Routine, sizeof(Struct), TraceName, true }
+
+#define CONSOLE_API_DEPRECATED(Struct) { ApiDispatchers::ServerDeprecatedApi, sizeof(Struct), "Deprecated", false }
+#define CONSOLE_API_DEPRECATED_NO_PARAM() {ApiDispatchers::ServerDeprecatedApi, 0, "Deprecated", false }
 
 typedef struct _CONSOLE_API_DESCRIPTOR
 {
     PCONSOLE_API_ROUTINE Routine;
     ULONG RequiredSize;
     PCSTR TraceName;
+    bool ReadOnly;
 } CONSOLE_API_DESCRIPTOR, *PCONSOLE_API_DESCRIPTOR;
 
 typedef struct _CONSOLE_API_LAYER_DESCRIPTOR
@@ -29,15 +35,15 @@ typedef struct _CONSOLE_API_LAYER_DESCRIPTOR
 } CONSOLE_API_LAYER_DESCRIPTOR, *PCONSOLE_API_LAYER_DESCRIPTOR;
 
 const CONSOLE_API_DESCRIPTOR ConsoleApiLayer1[] = {
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleCP, CONSOLE_GETCP_MSG, "GetConsoleCP"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleMode, CONSOLE_MODE_MSG, "GetConsoleMode"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleCP, CONSOLE_GETCP_MSG, "GetConsoleCP"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleMode, CONSOLE_MODE_MSG, "GetConsoleMode"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleMode, CONSOLE_MODE_MSG, "SetConsoleMode"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetNumberOfInputEvents, CONSOLE_GETNUMBEROFINPUTEVENTS_MSG, "GetNumberOfConsoleInputEvents"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetNumberOfInputEvents, CONSOLE_GETNUMBEROFINPUTEVENTS_MSG, "GetNumberOfConsoleInputEvents"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleInput, CONSOLE_GETCONSOLEINPUT_MSG, "GetConsoleInput"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerReadConsole, CONSOLE_READCONSOLE_MSG, "ReadConsole"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerWriteConsole, CONSOLE_WRITECONSOLE_MSG, "WriteConsole"),
     CONSOLE_API_DEPRECATED_NO_PARAM(), // ApiDispatchers::ServerConsoleNotifyLastClose
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleLangId, CONSOLE_LANGID_MSG, "GetConsoleLangId"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleLangId, CONSOLE_LANGID_MSG, "GetConsoleLangId"),
     CONSOLE_API_DEPRECATED(CONSOLE_MAPBITMAP_MSG),
 };
 
@@ -47,31 +53,31 @@ const CONSOLE_API_DESCRIPTOR ConsoleApiLayer2[] = {
     CONSOLE_API_NO_PARAMETER(ApiDispatchers::ServerSetConsoleActiveScreenBuffer, "SetConsoleActiveScreenBuffer"),
     CONSOLE_API_NO_PARAMETER(ApiDispatchers::ServerFlushConsoleInputBuffer, "FlushConsoleInputBuffer"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleCP, CONSOLE_SETCP_MSG, "SetConsoleCP"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleCursorInfo, CONSOLE_GETCURSORINFO_MSG, "GetConsoleCursorInfo"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleCursorInfo, CONSOLE_GETCURSORINFO_MSG, "GetConsoleCursorInfo"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleCursorInfo, CONSOLE_SETCURSORINFO_MSG, "SetConsoleCursorInfo"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleScreenBufferInfo, CONSOLE_SCREENBUFFERINFO_MSG, "GetConsoleScreenBufferInfo"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleScreenBufferInfo, CONSOLE_SCREENBUFFERINFO_MSG, "GetConsoleScreenBufferInfo"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleScreenBufferInfo, CONSOLE_SCREENBUFFERINFO_MSG, "SetConsoleScreenBufferInfo"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleScreenBufferSize, CONSOLE_SETSCREENBUFFERSIZE_MSG, "SetConsoleScreenBufferSize"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleCursorPosition, CONSOLE_SETCURSORPOSITION_MSG, "SetConsoleCursorPosition"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetLargestConsoleWindowSize, CONSOLE_GETLARGESTWINDOWSIZE_MSG, "GetLargestConsoleWindowSize"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetLargestConsoleWindowSize, CONSOLE_GETLARGESTWINDOWSIZE_MSG, "GetLargestConsoleWindowSize"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerScrollConsoleScreenBuffer, CONSOLE_SCROLLSCREENBUFFER_MSG, "ScrollConsoleScreenBuffer"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleTextAttribute, CONSOLE_SETTEXTATTRIBUTE_MSG, "SetConsoleTextAttribute"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleWindowInfo, CONSOLE_SETWINDOWINFO_MSG, "SetConsoleWindowInfo"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerReadConsoleOutputString, CONSOLE_READCONSOLEOUTPUTSTRING_MSG, "ReadConsoleOutputString"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerReadConsoleOutputString, CONSOLE_READCONSOLEOUTPUTSTRING_MSG, "ReadConsoleOutputString"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerWriteConsoleInput, CONSOLE_WRITECONSOLEINPUT_MSG, "WriteConsoleInput"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerWriteConsoleOutput, CONSOLE_WRITECONSOLEOUTPUT_MSG, "WriteConsoleOutput"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerWriteConsoleOutputString, CONSOLE_WRITECONSOLEOUTPUTSTRING_MSG, "WriteConsoleOutputString"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerReadConsoleOutput, CONSOLE_READCONSOLEOUTPUT_MSG, "ReadConsoleOutput"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleTitle, CONSOLE_GETTITLE_MSG, "GetConsoleTitle"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerReadConsoleOutput, CONSOLE_READCONSOLEOUTPUT_MSG, "ReadConsoleOutput"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleTitle, CONSOLE_GETTITLE_MSG, "GetConsoleTitle"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleTitle, CONSOLE_SETTITLE_MSG, "SetConsoleTitle"),
 };
 
 const CONSOLE_API_DESCRIPTOR ConsoleApiLayer3[] = {
     CONSOLE_API_DEPRECATED(CONSOLE_GETNUMBEROFFONTS_MSG),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleMouseInfo, CONSOLE_GETMOUSEINFO_MSG, "GetNumberOfConsoleMouseButtons"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleMouseInfo, CONSOLE_GETMOUSEINFO_MSG, "GetNumberOfConsoleMouseButtons"),
     CONSOLE_API_DEPRECATED(CONSOLE_GETFONTINFO_MSG),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleFontSize, CONSOLE_GETFONTSIZE_MSG, "GetConsoleFontSize"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleCurrentFont, CONSOLE_CURRENTFONT_MSG, "GetCurrentConsoleFont"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleFontSize, CONSOLE_GETFONTSIZE_MSG, "GetConsoleFontSize"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleCurrentFont, CONSOLE_CURRENTFONT_MSG, "GetCurrentConsoleFont"),
     CONSOLE_API_DEPRECATED(CONSOLE_SETFONT_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_SETICON_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_INVALIDATERECT_MSG),
@@ -84,7 +90,7 @@ const CONSOLE_API_DESCRIPTOR ConsoleApiLayer3[] = {
     CONSOLE_API_DEPRECATED(CONSOLE_REGISTERVDM_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_GETHARDWARESTATE_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_SETHARDWARESTATE_MSG),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleDisplayMode, CONSOLE_GETDISPLAYMODE_MSG, "GetConsoleDisplayMode"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleDisplayMode, CONSOLE_GETDISPLAYMODE_MSG, "GetConsoleDisplayMode"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerAddConsoleAlias, CONSOLE_ADDALIAS_MSG, "AddConsoleAlias"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleAlias, CONSOLE_GETALIAS_MSG, "GetConsoleAlias"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleAliasesLength, CONSOLE_GETALIASESLENGTH_MSG, "GetConsoleAliasesLength"),
@@ -98,7 +104,7 @@ const CONSOLE_API_DESCRIPTOR ConsoleApiLayer3[] = {
     CONSOLE_API_DEPRECATED(CONSOLE_SETKEYSHORTCUTS_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_SETMENUCLOSE_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_GETKEYBOARDLAYOUTNAME_MSG),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleWindow, CONSOLE_GETCONSOLEWINDOW_MSG, "GetConsoleWindow"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleWindow, CONSOLE_GETCONSOLEWINDOW_MSG, "GetConsoleWindow"),
     CONSOLE_API_DEPRECATED(CONSOLE_CHAR_TYPE_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_LOCAL_EUDC_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_CURSOR_MODE_MSG),
@@ -107,11 +113,12 @@ const CONSOLE_API_DESCRIPTOR ConsoleApiLayer3[] = {
     CONSOLE_API_DEPRECATED(CONSOLE_SETOS2OEMFORMAT_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_NLS_MODE_MSG),
     CONSOLE_API_DEPRECATED(CONSOLE_NLS_MODE_MSG),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleSelectionInfo, CONSOLE_GETSELECTIONINFO_MSG, "GetConsoleSelectionInfo"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleProcessList, CONSOLE_GETCONSOLEPROCESSLIST_MSG, "GetConsoleProcessList"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerGetConsoleHistory, CONSOLE_HISTORY_MSG, "GetConsoleHistory"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleSelectionInfo, CONSOLE_GETSELECTIONINFO_MSG, "GetConsoleSelectionInfo"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleProcessList, CONSOLE_GETCONSOLEPROCESSLIST_MSG, "GetConsoleProcessList"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleHistory, CONSOLE_HISTORY_MSG, "GetConsoleHistory"),
     CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleHistory, CONSOLE_HISTORY_MSG, "SetConsoleHistory"),
-    CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleCurrentFont, CONSOLE_CURRENTFONT_MSG, "SetConsoleCurrentFont")
+    CONSOLE_API_STRUCT(ApiDispatchers::ServerSetConsoleCurrentFont, CONSOLE_CURRENTFONT_MSG, "SetConsoleCurrentFont"),
+    CONSOLE_API_READONLY_STRUCT(ApiDispatchers::ServerGetConsoleMemoryUsage, CONSOLE_GETMEMORYUSAGE_MSG, "GetConsoleMemoryUsage")
 };
 
 const CONSOLE_API_LAYER_DESCRIPTOR ConsoleApiLayerTable[] = {
@@ -120,6 +127,40 @@ const CONSOLE_API_LAYER_DESCRIPTOR ConsoleApiLayerTable[] = {
     { ConsoleApiLayer3, RTL_NUMBER_OF(ConsoleApiLayer3) },
 };
 
+// Routine Description:
+// - Gets the descriptor of the API that a user IO calls.
+// Arguments:
+// - Message - Supplies the message representing the user IO.
+// Return Value:
+// - The API's descriptor, or nullptr if there's no such API.
+static const CONSOLE_API_DESCRIPTOR* LookupDescriptor(const CONSOLE_API_MSG& Message) noexcept
+{
+    ULONG const LayerNumber = (Message.msgHeader.ApiNumber >> 24) - 1;
+    ULONG const ApiNumber = Message.msgHeader.ApiNumber & 0xffffff;
+
+    if ((LayerNumber >= RTL_NUMBER_OF(ConsoleApiLayerTable)) || (ApiNumber >= ConsoleApiLayerTable[LayerNumber].Count))
+    {
+        return nullptr;
+    }
+
+    return &ConsoleApiLayerTable[LayerNumber].Descriptor[ApiNumber];
+}
+
+// Routine Description:
+// - Determines whether a user IO only reads the console's state. Those are
+//   serviced alongside each other, see IoSorter::ServiceIoOperation.
+// - The routines of these APIs still take the console lock to read the state,
+//   but nothing they do can change it, free a handle or pend the reply.
+// Arguments:
+// - Message - Supplies the message representing the user IO.
+// Return Value:
+// - true if the API only reads. false if it might write, or if there's no such API.
+bool ApiSorter::IsReadOnlyRequest(const CONSOLE_API_MSG& Message) noexcept
+{
+    const auto Descriptor = LookupDescriptor(Message);
+    return Descriptor != nullptr && Descriptor->ReadOnly;
+}
+
 // Routine Description:
 // - This routine validates a user IO and dispatches it to the appropriate worker routine.
 // Arguments:
@@ -129,18 +170,14 @@ const CONSOLE_API_LAYER_DESCRIPTOR ConsoleApiLayerTable[] = {
 PCONSOLE_API_MSG ApiSorter::ConsoleDispatchRequest(_Inout_ PCONSOLE_API_MSG Message)
 {
     // Make sure the indices are valid and retrieve the API descriptor.
-    ULONG const LayerNumber = (Message->msgHeader.ApiNumber >> 24) - 1;
-    ULONG const ApiNumber = Message->msgHeader.ApiNumber & 0xffffff;
-
     NTSTATUS Status;
-    if ((LayerNumber >= RTL_NUMBER_OF(ConsoleApiLayerTable)) || (ApiNumber >= ConsoleApiLayerTable[LayerNumber].Count))
+    CONSOLE_API_DESCRIPTOR const *Descriptor = LookupDescriptor(*Message);
+    if (Descriptor == nullptr)
     {
         Status = STATUS_ILLEGAL_FUNCTION;
         goto Complete;
     }
 
-    CONSOLE_API_DESCRIPTOR const *Descriptor = &ConsoleApiLayerTable[LayerNumber].Descriptor[ApiNumber];
-
     // Validate the argument size and call the API.
     if ((Message->Descriptor.InputSize < sizeof(CONSOLE_MSG_HEADER)) ||
         (Message->msgHeader.ApiDescriptorSize > sizeof(Message->u)) ||
@@ -163,8 +200,14 @@ PCONSOLE_API_MSG ApiSorter::ConsoleDispatchRequest(_Inout_ PCONSOLE_API_MSG Mess
     // alias API.
     {
         const auto trace = Tracing::s_TraceApiCall(Status, Descriptor->TraceName);
+        const ApiStatistics::Call statistics(Message->msgHeader.ApiNumber, Descriptor->TraceName);
         Status = (*Descriptor->Routine)(Message, &ReplyPending);
     }
+
+    // Whatever the routine drew from the scratch arena was only for the call, and it's done with now,
+    // even if the reply is pending.
+    Microsoft::Console::Types::ScratchArena::ForThisThread().Reset();
+
     if (Status != STATUS_BUFFER_TOO_SMALL)
     {
         Status = NTSTATUS_FROM_HRESULT(Status);
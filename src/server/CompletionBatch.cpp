@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "CompletionBatch.h"
+
+#include "..\host\globals.h"
+
+#include "..\interactivity\inc\ServiceLocator.hpp"
+
+std::vector<CONSOLE_API_MSG> CompletionBatch::s_pending;
+
+// Routine Description:
+// - Holds on to the reply to a message until the console lock is let go of.
+//   The message keeps its buffers, so the caller must not release them.
+// - If this thread doesn't hold the lock, or the reply can't be kept, it's
+//   completed right away instead.
+// Arguments:
+// - message - The message to reply to. Once it's been taken, it no longer
+//             refers to its buffers.
+// Return Value:
+// - <none>
+void CompletionBatch::s_Defer(_Inout_ CONSOLE_API_MSG& message) noexcept
+{
+    if (!ServiceLocator::LocateGlobals().getConsoleInformation().IsConsoleLocked())
+    {
+        s_Complete(message);
+        return;
+    }
+
+    try
+    {
+        s_pending.push_back(message);
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        s_Complete(message);
+        return;
+    }
+
+    // The copy owns the buffers now.
+    message.State.InputBuffer = nullptr;
+    message.State.OutputBuffer = nullptr;
+}
+
+// Routine Description:
+// - Whether there are replies waiting on the lock. Must be called with the console locked.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if s_TakePending has something to hand back.
+bool CompletionBatch::s_HasPending() noexcept
+{
+    return !s_pending.empty();
+}
+
+// Routine Description:
+// - Hands over the replies waiting on the lock. Must be called with the console locked.
+// Arguments:
+// - <none>
+// Return Value:
+// - The replies, for s_CompleteAll once the lock's been let go of.
+std::vector<CONSOLE_API_MSG> CompletionBatch::s_TakePending() noexcept
+{
+    std::vector<CONSOLE_API_MSG> messages;
+    messages.swap(s_pending);
+    return messages;
+}
+
+// Routine Description:
+// - Sends the given replies to the driver, in the order they were deferred.
+//   This should be called without the console locked.
+// Arguments:
+// - messages - The replies from s_TakePending.
+// Return Value:
+// - <none>
+void CompletionBatch::s_CompleteAll(std::vector<CONSOLE_API_MSG>& messages) noexcept
+{
+    for (auto& message : messages)
+    {
+        s_Complete(message);
+    }
+}
+
+// Routine Description:
+// - Releases the message's buffers and tells the driver that it's done.
+// Arguments:
+// - message - The message to reply to.
+// Return Value:
+// - <none>
+void CompletionBatch::s_Complete(CONSOLE_API_MSG& message) noexcept
+{
+    // A reply that carries the message's payload was pointed at the message
+    // it was copied from.
+    if (message.Complete.Write.Data != nullptr)
+    {
+        message.Complete.Write.Data = &message.u;
+    }
+
+    LOG_IF_FAILED(message.ReleaseMessageBuffers());
+
+    LOG_IF_FAILED(ServiceLocator::LocateGlobals().pDeviceComm->CompleteIo(&message.Complete));
+}
@@ -0,0 +1,40 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- CompletionBatch.h
+
+Abstract:
+- This file holds the replies to waits that were satisfied while the console
+  lock was held, so that they're sent to the driver once it's let go of.
+- One burst of input can wake many readers at once. Instead of each of them
+  calling the driver with the console locked, and every other thread waiting on
+  them, the replies are all completed back to back after the lock is dropped.
+
+Revision History:
+--*/
+
+#pragma once
+
+#include <vector>
+
+#include "ApiMessage.h"
+
+class CompletionBatch final
+{
+public:
+    CompletionBatch() = delete;
+
+    static void s_Defer(_Inout_ CONSOLE_API_MSG& message) noexcept;
+
+    static bool s_HasPending() noexcept;
+    static std::vector<CONSOLE_API_MSG> s_TakePending() noexcept;
+    static void s_CompleteAll(std::vector<CONSOLE_API_MSG>& messages) noexcept;
+
+private:
+    static void s_Complete(CONSOLE_API_MSG& message) noexcept;
+
+    // Guarded by the console lock.
+    static std::vector<CONSOLE_API_MSG> s_pending;
+};
@@ -77,8 +77,8 @@ public:
 
     [[nodiscard]]
     virtual HRESULT PeekConsoleInputWImpl(IConsoleInputObject& context,
-                                          std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                          const size_t eventsToRead,
+                                          gsl::span<INPUT_RECORD> outRecords,
+                                          size_t& eventsRead,
                                           INPUT_READ_HANDLE_DATA& readHandleState,
                                           std::unique_ptr<IWaitRoutine>& waiter) noexcept = 0;
 
@@ -91,8 +91,8 @@ public:
 
     [[nodiscard]]
     virtual HRESULT ReadConsoleInputWImpl(IConsoleInputObject& context,
-                                          std::deque<std::unique_ptr<IInputEvent>>& outEvents,
-                                          const size_t eventsToRead,
+                                          gsl::span<INPUT_RECORD> outRecords,
+                                          size_t& eventsRead,
                                           INPUT_READ_HANDLE_DATA& readHandleState,
                                           std::unique_ptr<IWaitRoutine>& waiter) noexcept = 0;
 
@@ -450,5 +450,10 @@ public:
                                                 const bool isForMaximumWindowSize,
                                                 const CONSOLE_FONT_INFOEX& consoleFontInfoEx) noexcept = 0;
 
+    [[nodiscard]]
+    virtual HRESULT GetConsoleMemoryUsageImpl(const ULONG subsystem,
+                                              ULONG64& bytes,
+                                              ULONG64& allocations) noexcept = 0;
+
 #pragma endregion
 };
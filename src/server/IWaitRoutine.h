@@ -51,6 +51,13 @@ public:
         return _ReplyType;
     }
 
+    // Whether this waiter does anything when it's notified of a ctrl-c or
+    //      ctrl-break. If it doesn't, the wait queue leaves it out of those.
+    virtual bool IsInterruptible() const noexcept
+    {
+        return true;
+    }
+
 private:
     ReplyDataType const _ReplyType;
 };
@@ -146,23 +146,45 @@ PCONSOLE_API_MSG IoDispatchers::ConsoleHandleConnectionRequest(_In_ PCONSOLE_API
 
     ConsoleProcessHandle* ProcessData = nullptr;
 
-    LockConsole();
-
     DWORD const dwProcessId = (DWORD)pReceiveMsg->Descriptor.Process;
     DWORD const dwThreadId = (DWORD)pReceiveMsg->Descriptor.Object;
 
+    // Everything up to making the process's entry in the list only asks the client message and the system
+    // about the process, so it's done before taking the console lock. Otherwise each short-lived process of
+    // a build would hold up painting and input for as long as it took the kernel to answer about it.
     CONSOLE_API_CONNECTINFO Cac;
     NTSTATUS Status = ConsoleInitializeConnectInfo(pReceiveMsg, &Cac);
     if (!NT_SUCCESS(Status))
     {
-        goto Error;
+        pReceiveMsg->SetReplyStatus(Status);
+        return pReceiveMsg;
+    }
+
+    std::optional<ConsoleProcessHandle::SystemInfo> systemInfo;
+    try
+    {
+        systemInfo.emplace(ConsoleProcessHandle::SystemInfo::s_Query(dwProcessId));
+    }
+    catch (...)
+    {
+        pReceiveMsg->SetReplyStatus(NTSTATUS_FROM_HRESULT(wil::ResultFromCaughtException()));
+        return pReceiveMsg;
+    }
+
+    // ConsoleApp will be false in the AttachConsole case.
+    if (Cac.ConsoleApp)
+    {
+        ServiceLocator::LocateConsoleControl()->NotifyConsoleApplication(dwProcessId);
     }
 
+    LockConsole();
+
     Status = NTSTATUS_FROM_HRESULT(gci.ProcessHandleList.AllocProcessData(dwProcessId,
                                                                           dwThreadId,
                                                                           Cac.ProcessGroupId,
                                                                           nullptr,
-                                                                          &ProcessData));
+                                                                          &ProcessData,
+                                                                          &systemInfo.value()));
 
     if (!NT_SUCCESS(Status))
     {
@@ -171,12 +193,6 @@ PCONSOLE_API_MSG IoDispatchers::ConsoleHandleConnectionRequest(_In_ PCONSOLE_API
 
     ProcessData->fRootProcess = WI_IsFlagClear(gci.Flags, CONSOLE_INITIALIZED);
 
-    // ConsoleApp will be false in the AttachConsole case.
-    if (Cac.ConsoleApp)
-    {
-        ServiceLocator::LocateConsoleControl()->NotifyConsoleApplication(dwProcessId);
-    }
-
     ServiceLocator::LocateAccessibilityNotifier()->NotifyConsoleStartApplicationEvent(dwProcessId);
 
     if (WI_IsFlagClear(gci.Flags, CONSOLE_INITIALIZED))
@@ -190,15 +206,8 @@ PCONSOLE_API_MSG IoDispatchers::ConsoleHandleConnectionRequest(_In_ PCONSOLE_API
         WI_SetFlag(gci.Flags, CONSOLE_INITIALIZED);
     }
 
-    try
-    {
-        CommandHistory::s_Allocate({ Cac.AppName, Cac.AppNameLength / sizeof(wchar_t) }, (HANDLE)ProcessData);
-    }
-    catch (...)
-    {
-        LOG_CAUGHT_EXCEPTION();
-        goto Error;
-    }
+    // The process's command history is allocated the first time it reads a line, rather than now.
+    // Most processes that connect never do, and there are only so many histories to go around.
 
     gci.ProcessHandleList.ModifyConsoleProcessFocus(WI_IsFlagSet(gci.Flags, CONSOLE_HAS_FOCUS));
 
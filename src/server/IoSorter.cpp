@@ -15,6 +15,25 @@
 #include "..\host\getset.h"
 #include "..\host\stream.h"
 
+// Several threads read and service the driver's messages at once (see
+// ConsoleIoThread). The dispatchers look up a message's object handle before
+// its routine takes the console lock, and some routines let go of that lock
+// partway through, so the console lock alone can't keep one message from
+// closing a handle while another is using it. This lock can: the APIs that only
+// read are serviced alongside each other, and anything else is serviced alone.
+// Neither the input thread nor the renderer ever takes it.
+static wil::srwlock s_serviceLock;
+
+// Routine Description:
+// - Services a message from the driver, under the service lock. Messages that
+//   only read the console's state share it with each other, see
+//   ApiSorter::IsReadOnlyRequest.
+// Arguments:
+// - pMsg - the message to service
+// - ReplyMsg - receives the reply to send with the next read of the driver, or
+//   nullptr if the reply is pending or was already sent.
+// Return Value:
+// - <none>
 void IoSorter::ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
                                   _Out_ CONSOLE_API_MSG** ReplyMsg)
 {
@@ -22,6 +41,17 @@ void IoSorter::ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
     HRESULT hr;
     BOOL ReplyPending = FALSE;
 
+    wil::rwlock_release_shared_scope_exit sharedLock;
+    wil::rwlock_release_exclusive_scope_exit exclusiveLock;
+    if (pMsg->Descriptor.Function == CONSOLE_IO_USER_DEFINED && ApiSorter::IsReadOnlyRequest(*pMsg))
+    {
+        sharedLock = s_serviceLock.lock_shared();
+    }
+    else
+    {
+        exclusiveLock = s_serviceLock.lock_exclusive();
+    }
+
     ZeroMemory(&pMsg->State, sizeof(pMsg->State));
     ZeroMemory(&pMsg->Complete, sizeof(CD_IO_COMPLETE));
 
@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "MessageBufferPool.h"
+
+wil::srwlock MessageBufferPool::s_lock;
+BYTE* MessageBufferPool::s_free[MessageBufferPool::s_ClassCount][MessageBufferPool::s_MaxPerClass] = {};
+size_t MessageBufferPool::s_freeCount[MessageBufferPool::s_ClassCount] = {};
+size_t MessageBufferPool::s_cbRetained = 0;
+
+// Routine Description:
+// - Gets a buffer of at least the given size, reusing one that a message
+//   released before if there's one of the right class.
+// - The contents of the buffer are undefined.
+// Arguments:
+// - cbSize - The number of bytes needed.
+// Return Value:
+// - The buffer, or nullptr if we're out of memory. It must be given back with s_Free, with the same size.
+[[nodiscard]]
+BYTE* MessageBufferPool::s_Allocate(const ULONG cbSize) noexcept
+{
+    const size_t sizeClass = s_ClassOf(cbSize);
+    if (sizeClass >= s_ClassCount)
+    {
+        return new (std::nothrow) BYTE[cbSize];
+    }
+
+    {
+        auto lock = s_lock.lock_exclusive();
+        if (s_freeCount[sizeClass] > 0)
+        {
+            BYTE* const pbBuffer = s_free[sizeClass][--s_freeCount[sizeClass]];
+            s_cbRetained -= s_ClassSize(sizeClass);
+            return pbBuffer;
+        }
+    }
+
+    return new (std::nothrow) BYTE[s_ClassSize(sizeClass)];
+}
+
+// Routine Description:
+// - Gives back a buffer from s_Allocate. It's kept for the next message unless
+//   its class, or the pool, already holds as much as it may.
+// Arguments:
+// - pbBuffer - The buffer. nullptr is allowed and ignored.
+// - cbSize - The size it was allocated with.
+// Return Value:
+// - <none>
+void MessageBufferPool::s_Free(_In_opt_ BYTE* const pbBuffer, const ULONG cbSize) noexcept
+{
+    if (pbBuffer == nullptr)
+    {
+        return;
+    }
+
+    const size_t sizeClass = s_ClassOf(cbSize);
+    if (sizeClass < s_ClassCount)
+    {
+        auto lock = s_lock.lock_exclusive();
+        if (s_freeCount[sizeClass] < s_MaxPerClass &&
+            s_cbRetained + s_ClassSize(sizeClass) <= s_cbMaxRetained)
+        {
+            s_free[sizeClass][s_freeCount[sizeClass]++] = pbBuffer;
+            s_cbRetained += s_ClassSize(sizeClass);
+            return;
+        }
+    }
+
+    delete[] pbBuffer;
+}
+
+// Routine Description:
+// - Finds the smallest class whose buffers fit the given size.
+// Arguments:
+// - cbSize - The number of bytes needed.
+// Return Value:
+// - The index of the class, or s_ClassCount if the size is bigger than all of them.
+size_t MessageBufferPool::s_ClassOf(const ULONG cbSize) noexcept
+{
+    size_t sizeClass = 0;
+    while (sizeClass < s_ClassCount && s_ClassSize(sizeClass) < cbSize)
+    {
+        sizeClass++;
+    }
+    return sizeClass;
+}
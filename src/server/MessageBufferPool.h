@@ -0,0 +1,51 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- MessageBufferPool.h
+
+Abstract:
+- This file keeps the input and output payload buffers of API messages around
+  once they're released, so the next message of about the same size can reuse
+  one instead of going to the heap.
+- Buffers are sorted into classes by size, each a power of two. Only a few of
+  each class are kept, and only up to a cap on the total, so a burst of big
+  messages doesn't leave its memory behind. Buffers bigger than the biggest
+  class always come from and go back to the heap.
+- Messages are allocated on the IO threads and can be released on others (e.g.
+  when a wait is satisfied by input), so the pool is shared and locked.
+
+Revision History:
+--*/
+
+#pragma once
+
+class MessageBufferPool final
+{
+public:
+    MessageBufferPool() = delete;
+
+    [[nodiscard]]
+    static BYTE* s_Allocate(const ULONG cbSize) noexcept;
+    static void s_Free(_In_opt_ BYTE* const pbBuffer, const ULONG cbSize) noexcept;
+
+private:
+    // The classes are 256 bytes, 512 bytes, ... up to 64KB.
+    static constexpr ULONG s_cbSmallestClass = 256;
+    static constexpr size_t s_ClassCount = 9;
+    static constexpr size_t s_MaxPerClass = 4;
+    static constexpr size_t s_cbMaxRetained = 256 * 1024;
+
+    static size_t s_ClassOf(const ULONG cbSize) noexcept;
+    static constexpr size_t s_ClassSize(const size_t sizeClass) noexcept
+    {
+        return static_cast<size_t>(s_cbSmallestClass) << sizeClass;
+    }
+
+    // Everything below is guarded by s_lock.
+    static wil::srwlock s_lock;
+    static BYTE* s_free[s_ClassCount][s_MaxPerClass];
+    static size_t s_freeCount[s_ClassCount];
+    static size_t s_cbRetained;
+};
@@ -216,10 +216,11 @@ HRESULT ConsoleHandleData::_CloseInputHandle()
     // see if there are any reads waiting for data via this handle.  if
     // there are, wake them up.  there aren't any other outstanding i/o
     // operations via this handle because the console lock is held.
+    // the reads waiting on other handles to the same buffer carry on.
 
     if (pReadHandleData->GetReadCount() != 0)
     {
-        pInputBuffer->WaitQueue.NotifyWaiters(true, WaitTerminationReason::HandleClosing);
+        pInputBuffer->WaitQueue.NotifyWaiters(true, WaitTerminationReason::HandleClosing, this);
     }
 
     FAIL_FAST_IF(pReadHandleData->GetReadCount() > 0);
@@ -9,12 +9,34 @@
 #include "..\host\telemetry.hpp"
 
 // Routine Description:
-// - Constructs an instance of the ConsoleProcessHandle Class
-// - NOTE: Can throw if allocation fails or if there is a console policy we do not understand.
+// - Opens a client process by ID and works out the policy that applies to it.
+// - NOTE: Can throw if there is a console policy we do not understand.
 // - NOTE: Not being able to open the process by ID isn't a failure. It will be logged and continued.
+// Arguments:
+// - dwProcessId - the ID of the client process
+// Return Value:
+// - The handle to the process, if it could be opened, and its policy.
+ConsoleProcessHandle::SystemInfo ConsoleProcessHandle::SystemInfo::s_Query(const DWORD dwProcessId)
+{
+    wil::unique_handle hProcess{ LOG_LAST_ERROR_IF_NULL(OpenProcess(MAXIMUM_ALLOWED,
+                                                                    FALSE,
+                                                                    dwProcessId)) };
+    const ConsoleProcessPolicy policy = ConsoleProcessPolicy::s_CreateInstance(hProcess.get());
+    return { std::move(hProcess), policy };
+}
+
+// Routine Description:
+// - Constructs an instance of the ConsoleProcessHandle Class
+// - NOTE: Can throw if allocation fails.
+// Arguments:
+// - dwProcessId - the ID of the client process
+// - dwThreadId - the ID of the thread in it that connected
+// - ulProcessGroupId - the process group it's in
+// - systemInfo - its handle and policy, from SystemInfo::s_Query. The handle is moved into this instance.
 ConsoleProcessHandle::ConsoleProcessHandle(const DWORD dwProcessId,
                                            const DWORD dwThreadId,
-                                           const ULONG ulProcessGroupId) :
+                                           const ULONG ulProcessGroupId,
+                                           SystemInfo&& systemInfo) :
     pWaitBlockQueue(std::make_unique<ConsoleWaitQueue>()),
     pInputHandle(nullptr),
     pOutputHandle(nullptr),
@@ -23,11 +45,10 @@ ConsoleProcessHandle::ConsoleProcessHandle(const DWORD dwProcessId,
     dwThreadId(dwThreadId),
     _ulTerminateCount(0),
     _ulProcessGroupId(ulProcessGroupId),
-    _hProcess(LOG_LAST_ERROR_IF_NULL(OpenProcess(MAXIMUM_ALLOWED,
-                                                 FALSE,
-                                                 dwProcessId))),
-    _policy(ConsoleProcessPolicy::s_CreateInstance(_hProcess.get()))
+    _hProcess(std::move(systemInfo.hProcess)),
+    _policy(systemInfo.policy)
 {
+    // This only counts the process for telemetry. The lookup of its name is done off this thread.
     if (nullptr != _hProcess.get())
     {
         Telemetry::Instance().LogProcessConnected(_hProcess.get());
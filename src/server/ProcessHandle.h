@@ -27,6 +27,17 @@ Revision History:
 class ConsoleProcessHandle
 {
 public:
+    // What the system can tell us about a client process: a handle to it, and the policy
+    // that applies to it. Finding these out takes a few calls into the kernel but nothing
+    // of the console's, so a connecting process asks for them before taking the console lock.
+    struct SystemInfo
+    {
+        wil::unique_handle hProcess;
+        ConsoleProcessPolicy policy;
+
+        static SystemInfo s_Query(const DWORD dwProcessId);
+    };
+
     std::unique_ptr<ConsoleWaitQueue> const pWaitBlockQueue;
     std::unique_ptr<ConsoleHandleData> pInputHandle;
     std::unique_ptr<ConsoleHandleData> pOutputHandle;
@@ -43,7 +54,8 @@ public:
 private:
     ConsoleProcessHandle(const DWORD dwProcessId,
                          const DWORD dwThreadId,
-                         const ULONG ulProcessGroupId);
+                         const ULONG ulProcessGroupId,
+                         SystemInfo&& systemInfo);
     ~ConsoleProcessHandle() = default;
     ConsoleProcessHandle(const ConsoleProcessHandle&) = delete;
     ConsoleProcessHandle(ConsoleProcessHandle&&) = delete;
@@ -57,4 +69,5 @@ private:
     const ConsoleProcessPolicy _policy;
 
     friend class ConsoleProcessList; // ensure List manages lifetimes and not other classes.
+    friend struct std::default_delete<ConsoleProcessHandle>; // so the List can hold one in a unique_ptr while it's indexed.
 };
@@ -21,6 +21,8 @@
 // - pParentProcessData - Used to specify parent while locating appropriate scope of sending control messages
 // - ppProcessData - Filled on exit with a pointer to the process handle information. Optional.
 //                 - If not used, return code will specify whether this process is known to the list or not.
+// - pSystemInfo - The handle and policy for the process, if they were looked up already. Optional.
+//               - If given and a new entry is made, the handle is moved into it. If not, they're looked up here.
 // Return Value:
 // - S_OK if the process was recorded in the list successfully or already existed.
 // - E_FAIL if we're running into an LPC port conflict by nature of the process chain.
@@ -30,7 +32,8 @@ HRESULT ConsoleProcessList::AllocProcessData(const DWORD dwProcessId,
                                              const DWORD dwThreadId,
                                              const ULONG ulProcessGroupId,
                                              _In_opt_ ConsoleProcessHandle* const pParentProcessData,
-                                             _Outptr_opt_ ConsoleProcessHandle** const ppProcessData)
+                                             _Outptr_opt_ ConsoleProcessHandle** const ppProcessData,
+                                             _Inout_opt_ ConsoleProcessHandle::SystemInfo* const pSystemInfo)
 {
     FAIL_FAST_IF(!(ServiceLocator::LocateGlobals().getConsoleInformation().IsConsoleLocked()));
 
@@ -57,14 +60,26 @@ HRESULT ConsoleProcessList::AllocProcessData(const DWORD dwProcessId,
 
     try
     {
-        pProcessData = new ConsoleProcessHandle(dwProcessId,
-                                                dwThreadId,
-                                                ulProcessGroupId);
+        std::unique_ptr<ConsoleProcessHandle> pNewProcessData{ new ConsoleProcessHandle(dwProcessId,
+                                                                                        dwThreadId,
+                                                                                        ulProcessGroupId,
+                                                                                        pSystemInfo != nullptr ?
+                                                                                            std::move(*pSystemInfo) :
+                                                                                            ConsoleProcessHandle::SystemInfo::s_Query(dwProcessId)) };
 
         // Some applications, when reading the process list through the GetConsoleProcessList API, are expecting
         // the returned list of attached process IDs to be from newest to oldest.
         // As such, we have to put the newest process into the head of the list.
-        _processes.push_front(pProcessData);
+        _processes.push_front(pNewProcessData.get());
+        auto unindex = wil::scope_exit([&]() {
+            _Unindex(pNewProcessData.get());
+        });
+
+        _processesById.emplace(dwProcessId, _processes.begin());
+        _processesByGroup[ulProcessGroupId].push_back(pNewProcessData.get());
+
+        unindex.release();
+        pProcessData = pNewProcessData.release();
 
         if (nullptr != ppProcessData)
         {
@@ -86,14 +101,46 @@ void ConsoleProcessList::FreeProcessData(_In_ ConsoleProcessHandle* const pProce
 {
     FAIL_FAST_IF(!(ServiceLocator::LocateGlobals().getConsoleInformation().IsConsoleLocked()));
 
-    // Assert that the item exists in the list. If it doesn't exist, the end/last will be returned.
-    FAIL_FAST_IF(!(_processes.cend() != std::find(_processes.cbegin(), _processes.cend(), pProcessData)));
+    // Assert that the item exists in the list.
+    const auto found = _processesById.find(pProcessData->dwProcessId);
+    FAIL_FAST_IF(!(found != _processesById.end() && *found->second == pProcessData));
 
-    _processes.remove(pProcessData);
+    _Unindex(pProcessData);
 
     delete pProcessData;
 }
 
+// Routine Description:
+// - Takes a process out of the list and the indices, as far as it's in them.
+// Arguments:
+// - pProcessData - Pointer to the per-process data structure.
+// Return Value:
+// - <none>
+void ConsoleProcessList::_Unindex(_In_ ConsoleProcessHandle* const pProcessData) noexcept
+{
+    const auto byId = _processesById.find(pProcessData->dwProcessId);
+    if (byId != _processesById.end() && *byId->second == pProcessData)
+    {
+        _processes.erase(byId->second);
+        _processesById.erase(byId);
+    }
+    else
+    {
+        _processes.remove(pProcessData);
+    }
+
+    const auto byGroup = _processesByGroup.find(pProcessData->_ulProcessGroupId);
+    if (byGroup != _processesByGroup.end())
+    {
+        auto& group = byGroup->second;
+        group.erase(std::remove(group.begin(), group.end(), pProcessData), group.end());
+        if (group.empty())
+        {
+            _processesByGroup.erase(byGroup);
+        }
+    }
+}
+
 // Routine Description:
 // - Locates a process handle in this list.
 // - NOTE: Calling FindProcessInList(0) means you want the root process.
@@ -103,31 +150,17 @@ void ConsoleProcessList::FreeProcessData(_In_ ConsoleProcessHandle* const pProce
 // - Pointer to the process handle information or nullptr if no match was found.
 ConsoleProcessHandle* ConsoleProcessList::FindProcessInList(const DWORD dwProcessId) const
 {
-    auto it = _processes.cbegin();
-
-    while (it != _processes.cend())
+    if (ROOT_PROCESS_ID != dwProcessId)
     {
-        ConsoleProcessHandle* const pProcessHandleRecord = *it;
-
-        if (ROOT_PROCESS_ID != dwProcessId)
-        {
-            if (pProcessHandleRecord->dwProcessId == dwProcessId)
-            {
-                return pProcessHandleRecord;
-            }
-        }
-        else
-        {
-            if (pProcessHandleRecord->fRootProcess)
-            {
-                return pProcessHandleRecord;
-            }
-        }
-
-        it = std::next(it);
+        const auto found = _processesById.find(dwProcessId);
+        return found != _processesById.end() ? *found->second : nullptr;
     }
 
-    return nullptr;
+    // Whoever is the root process is decided outside of the list, so it has to be looked for.
+    const auto found = std::find_if(_processes.cbegin(), _processes.cend(), [](const ConsoleProcessHandle* const pProcessHandleRecord) {
+        return pProcessHandleRecord->fRootProcess;
+    });
+    return found != _processes.cend() ? *found : nullptr;
 }
 
 // Routine Description:
@@ -138,20 +171,14 @@ ConsoleProcessHandle* ConsoleProcessList::FindProcessInList(const DWORD dwProces
 // - Pointer to first matching process handle with given group ID. nullptr if no match was found.
 ConsoleProcessHandle* ConsoleProcessList::FindProcessByGroupId(_In_ ULONG ulProcessGroupId) const
 {
-    auto it = _processes.cbegin();
-
-    while (it != _processes.cend())
+    // The list is newest first, so its first match is the newest of the group.
+    const auto found = _processesByGroup.find(ulProcessGroupId);
+    if (found == _processesByGroup.end() || found->second.empty())
     {
-        ConsoleProcessHandle* const pProcessHandleRecord = *it;
-        if (pProcessHandleRecord->_ulProcessGroupId == ulProcessGroupId)
-        {
-            return pProcessHandleRecord;
-        }
-
-        it = std::next(it);
+        return nullptr;
     }
 
-    return nullptr;
+    return found->second.back();
 }
 
 // Routine Description:
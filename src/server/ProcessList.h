@@ -7,6 +7,8 @@ Module Name:
 
 Abstract:
 - This file defines a list of process handles maintained by an instance of a console server
+- Besides the list, newest first, the processes are kept hashed by their ID and
+  by their group, so finding one takes the same time however many are attached.
 
 Author:
 - Michael Niksa (miniksa) 12-Oct-2016
@@ -19,6 +21,8 @@ Revision History:
 
 #include "ProcessHandle.h"
 
+#include <unordered_map>
+
 // this structure is used to store relevant information from the console for ctrl processing so we can do it without
 // holding the console lock.
 struct ConsoleProcessTerminationRecord
@@ -39,7 +43,8 @@ public:
                              const DWORD dwThreadId,
                              const ULONG ulProcessGroupId,
                              _In_opt_ ConsoleProcessHandle* const pParentProcessData,
-                             _Outptr_opt_ ConsoleProcessHandle** const ppProcessData);
+                             _Outptr_opt_ ConsoleProcessHandle** const ppProcessData,
+                             _Inout_opt_ ConsoleProcessHandle::SystemInfo* const pSystemInfo = nullptr);
 
     void FreeProcessData(_In_ ConsoleProcessHandle* const ProcessData);
 
@@ -65,6 +70,11 @@ public:
 
 private:
     std::list<ConsoleProcessHandle*> _processes;
+    std::unordered_map<DWORD, std::list<ConsoleProcessHandle*>::iterator> _processesById;
+    // The processes of each group, oldest first.
+    std::unordered_map<ULONG, std::vector<ConsoleProcessHandle*>> _processesByGroup;
+
+    void _Unindex(_In_ ConsoleProcessHandle* const pProcessData) noexcept;
 
     void _ModifyProcessForegroundRights(const HANDLE hProcess, const bool fForeground) const;
 };
@@ -7,6 +7,7 @@
 #include "WaitQueue.h"
 
 #include "ApiSorter.h"
+#include "CompletionBatch.h"
 
 #include "..\host\globals.h"
 #include "..\host\utils.hpp"
@@ -20,18 +21,23 @@
 // Arguments:
 // - pProcessQueue - The queue attached to the client process ID that requested this action
 // - pObjectQueue - The queue attached to the console object that will service the action when data arrives
+// - pObjectHandle - The handle to the console object that the request came in on
 // - pWaitReplyMessage - The original API message related to the client process's service request
 // - pWaiter - The context to return to later when the wait is satisfied.
 ConsoleWaitBlock::ConsoleWaitBlock(_In_ ConsoleWaitQueue* const pProcessQueue,
                                    _In_ ConsoleWaitQueue* const pObjectQueue,
+                                   _In_ const ConsoleHandleData* const pObjectHandle,
                                    const CONSOLE_API_MSG* const pWaitReplyMessage,
                                    _In_ IWaitRoutine* const pWaiter) :
     _pProcessQueue(THROW_HR_IF_NULL(E_INVALIDARG, pProcessQueue)),
     _pObjectQueue(THROW_HR_IF_NULL(E_INVALIDARG, pObjectQueue)),
+    _pObjectHandle(THROW_HR_IF_NULL(E_INVALIDARG, pObjectHandle)),
     _pWaiter(THROW_HR_IF_NULL(E_INVALIDARG, pWaiter))
 {
-    _itProcessQueue = _pProcessQueue->_blocks.insert(_pProcessQueue->_blocks.end(), this);
-    _itObjectQueue = _pObjectQueue->_blocks.insert(_pObjectQueue->_blocks.end(), this);
+    _posProcessQueue = _pProcessQueue->_Insert(this);
+    auto removeFromProcessQueue = wil::scope_exit([&] { _pProcessQueue->_Remove(this, _posProcessQueue); });
+    _posObjectQueue = _pObjectQueue->_Insert(this);
+    removeFromProcessQueue.release();
 
     _WaitReplyMessage = *pWaitReplyMessage;
 
@@ -48,8 +54,8 @@ ConsoleWaitBlock::ConsoleWaitBlock(_In_ ConsoleWaitQueue* const pProcessQueue,
 //   constant time with the iterator acquired on construction.
 ConsoleWaitBlock::~ConsoleWaitBlock()
 {
-    _pProcessQueue->_blocks.erase(_itProcessQueue);
-    _pObjectQueue->_blocks.erase(_itObjectQueue);
+    _pProcessQueue->_Remove(this, _posProcessQueue);
+    _pObjectQueue->_Remove(this, _posObjectQueue);
 
     if (_pWaiter != nullptr)
     {
@@ -86,6 +92,7 @@ HRESULT ConsoleWaitBlock::s_CreateWait(_Inout_ CONSOLE_API_MSG* const pWaitReply
     {
         pWaitBlock = new ConsoleWaitBlock(pProcessQueue,
                                           pObjectQueue,
+                                          pHandleData,
                                           pWaitReplyMessage,
                                           pWaiter);
     }
@@ -99,6 +106,20 @@ HRESULT ConsoleWaitBlock::s_CreateWait(_Inout_ CONSOLE_API_MSG* const pWaitReply
     return S_OK;
 }
 
+// Routine Description:
+// - Whether the waiter wants to hear of ctrl-c and ctrl-break.
+bool ConsoleWaitBlock::IsInterruptible() const noexcept
+{
+    return _pWaiter->IsInterruptible();
+}
+
+// Routine Description:
+// - The handle the wait is on.
+const ConsoleHandleData* ConsoleWaitBlock::GetObjectHandle() const noexcept
+{
+    return _pObjectHandle;
+}
+
 // Routine Description:
 // - Used to trigger the callback routine inside this wait block.
 // Arguments:
@@ -211,9 +232,9 @@ bool ConsoleWaitBlock::Notify(const WaitTerminationReason TerminationReason)
             a->NumBytes = gsl::narrow<ULONG>(NumBytes);
         }
 
-        LOG_IF_FAILED(_WaitReplyMessage.ReleaseMessageBuffers());
-
-        LOG_IF_FAILED(ServiceLocator::LocateGlobals().pDeviceComm->CompleteIo(&_WaitReplyMessage.Complete));
+        // The reply goes out once the console is unlocked, along with those of
+        // any other waits that the same change satisfied.
+        CompletionBatch::s_Defer(_WaitReplyMessage);
 
         fRetVal = true;
     }
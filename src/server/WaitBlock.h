@@ -24,6 +24,7 @@ Revision History:
 #include <list>
 
 class ConsoleWaitQueue;
+class ConsoleHandleData;
 
 class ConsoleWaitBlock
 {
@@ -33,6 +34,18 @@ public:
 
     bool Notify(const WaitTerminationReason TerminationReason);
 
+    bool IsInterruptible() const noexcept;
+    const ConsoleHandleData* GetObjectHandle() const noexcept;
+
+    // Where a block is in each of the lists a queue keeps, so that it can be
+    //      taken out of them in constant time.
+    struct QueuePosition
+    {
+        std::list<ConsoleWaitBlock*>::const_iterator all;
+        std::list<ConsoleWaitBlock*>::const_iterator interruptible;
+        std::list<ConsoleWaitBlock*>::const_iterator byHandle;
+    };
+
     [[nodiscard]]
     static HRESULT s_CreateWait(_Inout_ CONSOLE_API_MSG* const pWaitReplymessage,
                                 _In_ IWaitRoutine* const pWaiter);
@@ -41,14 +54,18 @@ public:
 private:
     ConsoleWaitBlock(_In_ ConsoleWaitQueue* const pProcessQueue,
                      _In_ ConsoleWaitQueue* const pObjectQueue,
+                     _In_ const ConsoleHandleData* const pObjectHandle,
                      const CONSOLE_API_MSG* const pWaitReplyMessage,
                      _In_ IWaitRoutine* const pWaiter);
 
     ConsoleWaitQueue* const _pProcessQueue;
-    std::_List_const_iterator<std::_List_val<std::_List_simple_types<ConsoleWaitBlock*>>> _itProcessQueue;
+    QueuePosition _posProcessQueue;
 
     ConsoleWaitQueue* const _pObjectQueue;
-    std::_List_const_iterator<std::_List_val<std::_List_simple_types<ConsoleWaitBlock*>>> _itObjectQueue;
+    QueuePosition _posObjectQueue;
+
+    // The handle the wait is on.
+    const ConsoleHandleData* const _pObjectHandle;
 
     CONSOLE_API_MSG _WaitReplyMessage;
 
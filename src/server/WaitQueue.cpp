@@ -12,7 +12,9 @@
 // Routine Description:
 // - Instantiates a new ConsoleWaitQueue
 ConsoleWaitQueue::ConsoleWaitQueue() :
-    _blocks()
+    _blocks(),
+    _interruptibleBlocks(),
+    _blocksByHandle()
 {
 
 }
@@ -75,11 +77,57 @@ bool ConsoleWaitQueue::NotifyWaiters(const bool fNotifyAll)
 // - True if any block was successfully notified. False if no blocks were successful.
 bool ConsoleWaitQueue::NotifyWaiters(const bool fNotifyAll,
                                      const WaitTerminationReason TerminationReason)
+{
+    // The waiters that don't act on ctrl events would only go right back to waiting.
+    if (WI_IsAnyFlagSet(TerminationReason, WaitTerminationReason::CtrlC | WaitTerminationReason::CtrlBreak))
+    {
+        return _NotifyBlocks(_interruptibleBlocks, fNotifyAll, TerminationReason);
+    }
+    return _NotifyBlocks(_blocks, fNotifyAll, TerminationReason);
+}
+
+// Routine Description:
+// - Instructs this queue to attempt to callback the requests waiting on the
+//   given handle, and request termination with the given reason
+// Arguments:
+// - fNotifyAll - If true, we will notify all of the handle's items. If false, we will only notify the first one.
+// - TerminationReason - A reason/message to pass to each waiter signaling it should terminate appropriately.
+// - pObjectHandle - The handle whose waiters to notify.
+// Return Value:
+// - True if any block was successfully notified. False if no blocks were successful.
+bool ConsoleWaitQueue::NotifyWaiters(const bool fNotifyAll,
+                                     const WaitTerminationReason TerminationReason,
+                                     const ConsoleHandleData* const pObjectHandle)
+{
+    const auto handleBlocks = _blocksByHandle.find(pObjectHandle);
+    if (handleBlocks == _blocksByHandle.end())
+    {
+        return false;
+    }
+    return _NotifyBlocks(handleBlocks->second, fNotifyAll, TerminationReason);
+}
+
+// Routine Description:
+// - Attempts to callback the waiting requests in one of this queue's lists.
+// Arguments:
+// - blocks - The list to notify the blocks of. Notified blocks will remove
+//   themselves from it (and the list itself may go, once it's empty).
+// - fNotifyAll - If true, we will notify all items in the list. If false, we will only notify the first item.
+// - TerminationReason - A reason/message to pass to each waiter signaling it should terminate appropriately.
+// Return Value:
+// - True if any block was successfully notified. False if no blocks were successful.
+bool ConsoleWaitQueue::_NotifyBlocks(const std::list<ConsoleWaitBlock*>& blocks,
+                                     const bool fNotifyAll,
+                                     const WaitTerminationReason TerminationReason)
 {
     bool fResult = false;
 
-    auto it = _blocks.cbegin();
-    while (!_blocks.empty() && it != _blocks.cend())
+    // A handle's list is dropped along with the last of its blocks, so we
+    //      must not look at it again once that one's been notified.
+    auto it = blocks.cbegin();
+    auto const end = blocks.cend();
+    size_t remaining = blocks.size();
+    while (remaining != 0 && it != end)
     {
         ConsoleWaitBlock* const WaitBlock = (*it);
         if (nullptr == WaitBlock)
@@ -88,6 +136,7 @@ bool ConsoleWaitQueue::NotifyWaiters(const bool fNotifyAll,
         }
 
         auto const nextIt = std::next(it); // we have to capture next before it is potentially erased
+        --remaining;
 
         if (_NotifyBlock(WaitBlock, TerminationReason))
         {
@@ -126,3 +175,61 @@ bool ConsoleWaitQueue::_NotifyBlock(_In_ ConsoleWaitBlock* pWaitBlock,
 
     return fResult;
 }
+
+// Routine Description:
+// - Adds a block to the end of each of the lists of this queue it belongs in.
+// Arguments:
+// - pWaitBlock - The block to add.
+// Return Value:
+// - Where the block went in each list, to remove it with later.
+ConsoleWaitBlock::QueuePosition ConsoleWaitQueue::_Insert(_In_ ConsoleWaitBlock* const pWaitBlock)
+{
+    ConsoleWaitBlock::QueuePosition position;
+    position.all = _blocks.insert(_blocks.end(), pWaitBlock);
+    auto removeFromAll = wil::scope_exit([&] { _blocks.erase(position.all); });
+
+    if (pWaitBlock->IsInterruptible())
+    {
+        position.interruptible = _interruptibleBlocks.insert(_interruptibleBlocks.end(), pWaitBlock);
+    }
+    auto removeFromInterruptible = wil::scope_exit([&] {
+        if (pWaitBlock->IsInterruptible())
+        {
+            _interruptibleBlocks.erase(position.interruptible);
+        }
+    });
+
+    auto& handleBlocks = _blocksByHandle[pWaitBlock->GetObjectHandle()];
+    position.byHandle = handleBlocks.insert(handleBlocks.end(), pWaitBlock);
+
+    removeFromInterruptible.release();
+    removeFromAll.release();
+    return position;
+}
+
+// Routine Description:
+// - Takes a block out of each of the lists of this queue it's in.
+// Arguments:
+// - pWaitBlock - The block to remove.
+// - position - Where _Insert put it.
+// Return Value:
+// - <none>
+void ConsoleWaitQueue::_Remove(_In_ ConsoleWaitBlock* const pWaitBlock,
+                               const ConsoleWaitBlock::QueuePosition& position) noexcept
+{
+    _blocks.erase(position.all);
+    if (pWaitBlock->IsInterruptible())
+    {
+        _interruptibleBlocks.erase(position.interruptible);
+    }
+
+    const auto handleBlocks = _blocksByHandle.find(pWaitBlock->GetObjectHandle());
+    if (handleBlocks != _blocksByHandle.end())
+    {
+        handleBlocks->second.erase(position.byHandle);
+        if (handleBlocks->second.empty())
+        {
+            _blocksByHandle.erase(handleBlocks);
+        }
+    }
+}
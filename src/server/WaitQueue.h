@@ -7,6 +7,10 @@ Module Name:
 
 Abstract:
 - This file manages a queue of wait blocks
+- Besides the list of all of them, in the order they came in, the queue keeps
+  the blocks of waiters that act on ctrl-c/ctrl-break, and the blocks of each
+  handle, apart. That way a ctrl event, or a handle closing, only touches the
+  waiters that it's for, however many others are waiting.
 
 Author:
 - Michael Niksa (miniksa) 17-Oct-2016
@@ -18,6 +22,7 @@ Revision History:
 #pragma once
 
 #include <list>
+#include <unordered_map>
 
 #include "..\host\conapi.h"
 
@@ -37,15 +42,29 @@ public:
     bool NotifyWaiters(const bool fNotifyAll,
                        const WaitTerminationReason TerminationReason);
 
+    bool NotifyWaiters(const bool fNotifyAll,
+                       const WaitTerminationReason TerminationReason,
+                       const ConsoleHandleData* const pObjectHandle);
+
     [[nodiscard]]
     static HRESULT s_CreateWait(_Inout_ CONSOLE_API_MSG* const pWaitReplyMessage,
                                 _In_ IWaitRoutine* const pWaiter);
 
 private:
+    bool _NotifyBlocks(const std::list<ConsoleWaitBlock*>& blocks,
+                       const bool fNotifyAll,
+                       const WaitTerminationReason TerminationReason);
+
     bool _NotifyBlock(_In_ ConsoleWaitBlock* pWaitBlock,
                       const WaitTerminationReason TerminationReason);
 
+    ConsoleWaitBlock::QueuePosition _Insert(_In_ ConsoleWaitBlock* const pWaitBlock);
+    void _Remove(_In_ ConsoleWaitBlock* const pWaitBlock,
+                 const ConsoleWaitBlock::QueuePosition& position) noexcept;
+
     std::list<ConsoleWaitBlock*> _blocks;
+    std::list<ConsoleWaitBlock*> _interruptibleBlocks;
+    std::unordered_map<const ConsoleHandleData*, std::list<ConsoleWaitBlock*>> _blocksByHandle;
 
     friend class ConsoleWaitBlock; // Blocks live in multiple queues so we let them manage the lifetime.
 };
@@ -0,0 +1,187 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*
+Module Name:
+- DispatchBatch.hpp
+
+Abstract:
+- This is a compact list of parsed output operations. While it parses a string,
+    the output state machine engine collects the most common operations (print
+    runs, C0 controls, SGR, cursor moves and erases) into a batch, and hands
+    the whole batch to ITermDispatch::ApplyBatch in one call.
+- Consecutive print runs are joined into one, and so are consecutive SGRs.
+*/
+#pragma once
+#include "ITermDispatch.hpp"
+
+namespace Microsoft::Console::VirtualTerminal
+{
+    class DispatchBatch;
+};
+
+class Microsoft::Console::VirtualTerminal::DispatchBatch final
+{
+public:
+    enum class CommandType : BYTE
+    {
+        PrintString,
+        Execute,
+        SetGraphicsRendition,
+        CursorPosition,
+        CursorUp,
+        CursorDown,
+        CursorForward,
+        CursorBackward,
+        EraseInDisplay,
+        EraseInLine
+    };
+
+    struct Command
+    {
+        CommandType type;
+        // The distance, line, erase type or control character, depending on the type.
+        unsigned int arg;
+        // The column of a CursorPosition.
+        unsigned int column;
+        // Where the text of a PrintString or options of a SetGraphicsRendition are.
+        size_t start;
+        size_t length;
+    };
+
+    void AddPrintString(const wchar_t* const rgwch, const size_t cch)
+    {
+        if (!_commands.empty() && _commands.back().type == CommandType::PrintString)
+        {
+            _commands.back().length += cch;
+        }
+        else
+        {
+            _commands.push_back({ CommandType::PrintString, 0, 0, _text.size(), cch });
+        }
+        _text.append(rgwch, cch);
+    }
+
+    void AddExecute(const wchar_t wchControl)
+    {
+        _commands.push_back({ CommandType::Execute, wchControl, 0, 0, 0 });
+    }
+
+    void AddSetGraphicsRendition(_In_reads_(cOptions) const DispatchTypes::GraphicsOptions* const rgOptions,
+                                 const size_t cOptions)
+    {
+        // An extended color option consumes the options after it, so an SGR that
+        //   has one can't be joined with its neighbors without changing its meaning.
+        if (!_commands.empty() &&
+            _commands.back().type == CommandType::SetGraphicsRendition &&
+            !s_HasExtendedColor(_options.data() + _commands.back().start, _commands.back().length) &&
+            !s_HasExtendedColor(rgOptions, cOptions))
+        {
+            _commands.back().length += cOptions;
+        }
+        else
+        {
+            _commands.push_back({ CommandType::SetGraphicsRendition, 0, 0, _options.size(), cOptions });
+        }
+        _options.insert(_options.end(), rgOptions, rgOptions + cOptions);
+    }
+
+    void AddCursorPosition(const unsigned int uiLine, const unsigned int uiColumn)
+    {
+        _commands.push_back({ CommandType::CursorPosition, uiLine, uiColumn, 0, 0 });
+    }
+
+    // Adds a command that only has one argument, like a cursor movement or erase.
+    void Add(const CommandType type, const unsigned int arg)
+    {
+        _commands.push_back({ type, arg, 0, 0, 0 });
+    }
+
+    bool empty() const noexcept
+    {
+        return _commands.empty();
+    }
+
+    size_t size() const noexcept
+    {
+        return _commands.size();
+    }
+
+    void clear() noexcept
+    {
+        _commands.clear();
+        _text.clear();
+        _options.clear();
+    }
+
+    // Routine Description:
+    // - Applies every command in the batch to a dispatch, one at a time, in order.
+    //   This is what a dispatch that has nothing better to do with a batch should do.
+    // Arguments:
+    // - dispatch - The dispatch to apply the commands to.
+    // Return Value:
+    // - true iff every command succeeded.
+    bool Replay(ITermDispatch& dispatch) const
+    {
+        bool fSuccess = true;
+        for (const auto& command : _commands)
+        {
+            switch (command.type)
+            {
+            case CommandType::PrintString:
+                dispatch.PrintString(_text.data() + command.start, command.length);
+                break;
+            case CommandType::Execute:
+                dispatch.Execute(static_cast<wchar_t>(command.arg));
+                break;
+            case CommandType::SetGraphicsRendition:
+                fSuccess = dispatch.SetGraphicsRendition(_options.data() + command.start, command.length) && fSuccess;
+                break;
+            case CommandType::CursorPosition:
+                fSuccess = dispatch.CursorPosition(command.arg, command.column) && fSuccess;
+                break;
+            case CommandType::CursorUp:
+                fSuccess = dispatch.CursorUp(command.arg) && fSuccess;
+                break;
+            case CommandType::CursorDown:
+                fSuccess = dispatch.CursorDown(command.arg) && fSuccess;
+                break;
+            case CommandType::CursorForward:
+                fSuccess = dispatch.CursorForward(command.arg) && fSuccess;
+                break;
+            case CommandType::CursorBackward:
+                fSuccess = dispatch.CursorBackward(command.arg) && fSuccess;
+                break;
+            case CommandType::EraseInDisplay:
+                fSuccess = dispatch.EraseInDisplay(static_cast<DispatchTypes::EraseType>(command.arg)) && fSuccess;
+                break;
+            case CommandType::EraseInLine:
+                fSuccess = dispatch.EraseInLine(static_cast<DispatchTypes::EraseType>(command.arg)) && fSuccess;
+                break;
+            default:
+                fSuccess = false;
+                break;
+            }
+        }
+        return fSuccess;
+    }
+
+private:
+    std::vector<Command> _commands;
+    std::wstring _text;
+    std::vector<DispatchTypes::GraphicsOptions> _options;
+
+    static bool s_HasExtendedColor(_In_reads_(cOptions) const DispatchTypes::GraphicsOptions* const rgOptions,
+                                   const size_t cOptions) noexcept
+    {
+        for (size_t i = 0; i < cOptions; i++)
+        {
+            if (rgOptions[i] == DispatchTypes::GraphicsOptions::ForegroundExtended ||
+                rgOptions[i] == DispatchTypes::GraphicsOptions::BackgroundExtended)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
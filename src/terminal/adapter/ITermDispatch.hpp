@@ -17,6 +17,7 @@ Abstract:
 namespace Microsoft::Console::VirtualTerminal
 {
     class ITermDispatch;
+    class DispatchBatch;
 };
 
 class Microsoft::Console::VirtualTerminal::ITermDispatch
@@ -64,6 +65,7 @@ public:
     virtual bool EnableButtonEventMouseMode(const bool fEnabled) = 0; // ?1002
     virtual bool EnableAnyEventMouseMode(const bool fEnabled) = 0; // ?1003
     virtual bool EnableAlternateScroll(const bool fEnabled) = 0; // ?1007
+    virtual bool EnableBracketedPasteMode(const bool fEnabled) = 0; // ?2004
     virtual bool SetColorTableEntry(const size_t tableIndex, const DWORD dwColor) = 0; // OSCColorTable
 
     virtual bool EraseInDisplay(const DispatchTypes::EraseType  eraseType) = 0; // ED
@@ -90,11 +92,16 @@ public:
     virtual bool SetCursorStyle(const DispatchTypes::CursorStyle cursorStyle) = 0; // DECSCUSR
     virtual bool SetCursorColor(const COLORREF Color) = 0; // OSCSetCursorColor, OSCResetCursorColor
 
+    virtual bool AddHyperlink(const std::wstring_view uri, const std::wstring_view id) = 0; // OSCHyperlink
+    virtual bool EndHyperlink() = 0; // OSCHyperlink
+
     // DTTERM_WindowManipulation
     virtual bool WindowManipulation(const DispatchTypes::WindowManipulationType uiFunction,
                                     _In_reads_(cParams) const unsigned short* const rgusParams,
                                     const size_t cParams) = 0;
 
+    // Applies a batch of the operations above, in order
+    virtual bool ApplyBatch(const DispatchBatch& batch) = 0;
 };
 inline Microsoft::Console::VirtualTerminal::ITermDispatch::~ITermDispatch() { }
 
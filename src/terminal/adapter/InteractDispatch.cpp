@@ -66,22 +66,42 @@ bool InteractDispatch::WriteString(_In_reads_(cch) const wchar_t* const pws,
         return true;
     }
 
-    unsigned int codepage = 0;
-    bool fSuccess = !!_pConApi->GetConsoleOutputCP(&codepage);
+    std::deque<std::unique_ptr<IInputEvent>> keyEvents;
+    bool fSuccess = StringToInput(pws, cch, keyEvents);
     if (fSuccess)
     {
-        std::deque<std::unique_ptr<IInputEvent>> keyEvents;
+        fSuccess = WriteInput(keyEvents);
+    }
+    return fSuccess;
+}
 
+// Method Description:
+// - Converts a string of input to the keystrokes that will faithfully
+//      represent it (see CharToKeyEvents), without writing them to the host.
+//      This lets the input engine collect a whole string's worth of input
+//      and write it all at once.
+// Arguments:
+// - pws: a string to convert.
+// - cch: the number of chars in pws.
+// - inputEvents: the keystrokes are appended to the end of this.
+// Return Value:
+// True if handled successfully. False otherwise.
+bool InteractDispatch::StringToInput(_In_reads_(cch) const wchar_t* const pws,
+                                     const size_t cch,
+                                     _Inout_ std::deque<std::unique_ptr<IInputEvent>>& inputEvents)
+{
+    unsigned int codepage = 0;
+    const bool fSuccess = !!_pConApi->GetConsoleOutputCP(&codepage);
+    if (fSuccess)
+    {
         for (size_t i = 0; i < cch; ++i)
         {
             std::deque<std::unique_ptr<KeyEvent>> convertedEvents = CharToKeyEvents(pws[i], codepage);
 
             std::move(convertedEvents.begin(),
                       convertedEvents.end(),
-                      std::back_inserter(keyEvents));
+                      std::back_inserter(inputEvents));
         }
-
-        fSuccess = WriteInput(keyEvents);
     }
     return fSuccess;
 }
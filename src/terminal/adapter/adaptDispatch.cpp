@@ -1135,6 +1135,9 @@ bool AdaptDispatch::_PrivateModeParamsHelper(_In_ DispatchTypes::PrivateModePara
     case DispatchTypes::PrivateModeParams::ASB_AlternateScreenBuffer:
         fSuccess = fEnable? UseAlternateScreenBuffer() : UseMainScreenBuffer();
         break;
+    case DispatchTypes::PrivateModeParams::XTERM_BracketedPasteMode:
+        fSuccess = EnableBracketedPasteMode(fEnable);
+        break;
     default:
         // If no functions to call, overall dispatch was a failure.
         fSuccess = false;
@@ -1743,6 +1746,28 @@ bool AdaptDispatch::EnableAlternateScroll(const bool fEnabled)
     return !!_conApi->PrivateEnableAlternateScroll(fEnabled);
 }
 
+//Routine Description:
+// Enable Bracketed Paste Mode - Text that's pasted is sent to the input
+//      between ESC [ 200 ~ and ESC [ 201 ~, so that the app can tell it apart
+//      from what's typed.
+// - When we're a pty, it's the terminal that does the pasting, so we don't
+//      handle this. That passes the sequence along to the terminal.
+//Arguments:
+// - fEnabled - true to enable, false to disable.
+// Return value:
+// True if handled successfully. False othewise.
+bool AdaptDispatch::EnableBracketedPasteMode(const bool fEnabled)
+{
+    bool isPty = false;
+    _conApi->IsConsolePty(&isPty);
+    if (isPty)
+    {
+        return false;
+    }
+
+    return !!_conApi->PrivateEnableBracketedPasteMode(fEnabled);
+}
+
 //Routine Description:
 // Set Cursor Style - Changes the cursor's style to match the given Dispatch
 //      cursor style. Unix styles are a combination of the shape and the blinking state.
@@ -1853,6 +1878,29 @@ bool AdaptDispatch::SetColorTableEntry(const size_t tableIndex,
     return fSuccess;
 }
 
+// Method Description:
+// - Starts a hyperlink (OSC 8). The console doesn't keep links, so this is never
+//      handled here. Returning false lets a conpty send the sequence on to the
+//      terminal, which does.
+// Arguments:
+// - uri - where the link goes
+// - id - the id the application gave the link, if any
+// Return Value:
+// - false
+bool AdaptDispatch::AddHyperlink(const std::wstring_view /*uri*/, const std::wstring_view /*id*/)
+{
+    return false;
+}
+
+// Method Description:
+// - Ends a hyperlink (OSC 8). See AddHyperlink.
+// Return Value:
+// - false
+bool AdaptDispatch::EndHyperlink()
+{
+    return false;
+}
+
 //Routine Description:
 // Window Manipulation - Performs a variety of actions relating to the window,
 //      such as moving the window position, resizing the window, querying
@@ -1893,3 +1941,17 @@ bool AdaptDispatch::WindowManipulation(const DispatchTypes::WindowManipulationTy
 
     return fSuccess;
 }
+
+// Routine Description:
+// - Applies a batch of operations parsed from one string of output.
+//   The console lock is already held for the whole string, so there's nothing
+//     to gain from taking it per batch. Each command goes through its usual
+//     handler, in order.
+// Arguments:
+// - batch - The operations to apply
+// Return value:
+// True if every operation was handled successfully. False otherwise.
+bool AdaptDispatch::ApplyBatch(const DispatchBatch& batch)
+{
+    return batch.Replay(*this);
+}
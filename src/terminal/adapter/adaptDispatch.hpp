@@ -93,6 +93,7 @@ namespace Microsoft::Console::VirtualTerminal
         virtual bool EnableButtonEventMouseMode(const bool fEnabled); // ?1002
         virtual bool EnableAnyEventMouseMode(const bool fEnabled); // ?1003
         virtual bool EnableAlternateScroll(const bool fEnabled); // ?1007
+        virtual bool EnableBracketedPasteMode(const bool fEnabled); // ?2004
         virtual bool SetCursorStyle(const DispatchTypes::CursorStyle cursorStyle); // DECSCUSR
         virtual bool SetCursorColor(const COLORREF cursorColor);
 
@@ -101,6 +102,10 @@ namespace Microsoft::Console::VirtualTerminal
         virtual bool WindowManipulation(const DispatchTypes::WindowManipulationType uiFunction,
                                         _In_reads_(cParams) const unsigned short* const rgusParams,
                                         const size_t cParams); // DTTERM_WindowManipulation
+        virtual bool AddHyperlink(const std::wstring_view uri, const std::wstring_view id); // OSCHyperlink
+        virtual bool EndHyperlink(); // OSCHyperlink
+
+        virtual bool ApplyBatch(const DispatchBatch& batch);
 
     private:
 
@@ -164,6 +169,15 @@ namespace Microsoft::Console::VirtualTerminal
         bool _SetBoldColorHelper(const DispatchTypes::GraphicsOptions option);
         bool _SetDefaultColorHelper(const DispatchTypes::GraphicsOptions option);
 
+        bool _GetExtendedColorHelper(_In_reads_(cOptions) const DispatchTypes::GraphicsOptions* const rgOptions,
+                                     const size_t cOptions,
+                                     _Out_ COLORREF* const prgbColor,
+                                     _Out_ bool* const pfIsForeground,
+                                     _Out_ size_t* const pcOptionsConsumed) const;
+        bool _ApplyGraphicsOptions(_In_reads_(cOptions) const DispatchTypes::GraphicsOptions* const rgOptions,
+                                   const size_t cOptions,
+                                   TextAttribute& attrs);
+
         static bool s_IsXtermColorOption(const DispatchTypes::GraphicsOptions opt);
         static bool s_IsRgbColorOption(const DispatchTypes::GraphicsOptions opt);
         static bool s_IsBoldColorOption(const DispatchTypes::GraphicsOptions opt) noexcept;
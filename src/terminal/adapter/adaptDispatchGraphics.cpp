@@ -385,9 +385,144 @@ bool AdaptDispatch::_SetDefaultColorHelper(const DispatchTypes::GraphicsOptions
     return success;
 }
 
+// Routine Description:
+// - Helper to parse extended graphics options into a color, without applying it.
+//     See _SetRgbColorsHelper for the format of the options.
+// Arguments:
+// - rgOptions - An array of options that will be used to generate the RGB color
+// - cOptions - The count of options
+// - prgbColor - A pointer to place the generated RGB color into.
+// - pfIsForeground - a pointer to place whether or not the parsed color is for the foreground or not.
+// - pcOptionsConsumed - a pointer to place the number of options we consumed parsing this option.
+// Return Value:
+// Returns true if we successfully parsed an extended color option from the options array.
+bool AdaptDispatch::_GetExtendedColorHelper(_In_reads_(cOptions) const DispatchTypes::GraphicsOptions* const rgOptions,
+                                            const size_t cOptions,
+                                            _Out_ COLORREF* const prgbColor,
+                                            _Out_ bool* const pfIsForeground,
+                                            _Out_ size_t* const pcOptionsConsumed) const
+{
+    bool fSuccess = false;
+    *prgbColor = 0;
+    *pfIsForeground = true;
+    *pcOptionsConsumed = 1;
+    if (cOptions >= 2 && s_IsRgbColorOption(rgOptions[0]))
+    {
+        *pcOptionsConsumed = 2;
+        *pfIsForeground = rgOptions[0] == DispatchTypes::GraphicsOptions::ForegroundExtended;
+
+        const DispatchTypes::GraphicsOptions typeOpt = rgOptions[1];
+        if (typeOpt == DispatchTypes::GraphicsOptions::RGBColor && cOptions >= 5)
+        {
+            *pcOptionsConsumed = 5;
+            // ensure that each value fits in a byte
+            const unsigned int red = rgOptions[2] > 255 ? 255 : rgOptions[2];
+            const unsigned int green = rgOptions[3] > 255 ? 255 : rgOptions[3];
+            const unsigned int blue = rgOptions[4] > 255 ? 255 : rgOptions[4];
+
+            *prgbColor = RGB(red, green, blue);
+            fSuccess = true;
+        }
+        else if (typeOpt == DispatchTypes::GraphicsOptions::Xterm256Index && cOptions >= 3)
+        {
+            *pcOptionsConsumed = 3;
+            if (rgOptions[2] <= 255) // ensure that the provided index is on the table
+            {
+                fSuccess = !!_conApi->PrivateGetXtermColor(rgOptions[2], *prgbColor);
+            }
+        }
+    }
+    return fSuccess;
+}
+
+// Routine Description:
+// - Applies a whole list of graphics options to a copy of the attributes, with
+//     the same meaning as applying them to the buffer one at a time.
+// Arguments:
+// - rgOptions - An array of options that will be applied from 0 to N, in order.
+// - cOptions - The count of options
+// - attrs - The attributes to apply the options to.
+// Return Value:
+// - True if the last option was applied successfully. False otherwise.
+bool AdaptDispatch::_ApplyGraphicsOptions(_In_reads_(cOptions) const DispatchTypes::GraphicsOptions* const rgOptions,
+                                          const size_t cOptions,
+                                          TextAttribute& attrs)
+{
+    // The legacy options are worked out on the legacy form of the attributes,
+    //   just like when they're applied one at a time.
+    WORD attr = attrs.GetLegacyAttributes();
+    bool fSuccess = true;
+
+    for (size_t i = 0; i < cOptions; i++)
+    {
+        const DispatchTypes::GraphicsOptions opt = rgOptions[i];
+        if (s_IsDefaultColorOption(opt))
+        {
+            const bool fg = opt == GraphicsOptions::Off || opt == GraphicsOptions::ForegroundDefault;
+            const bool bg = opt == GraphicsOptions::Off || opt == GraphicsOptions::BackgroundDefault;
+            if (fg)
+            {
+                attrs.SetDefaultForeground();
+            }
+            if (bg)
+            {
+                attrs.SetDefaultBackground();
+            }
+            if (fg && bg)
+            {
+                // If we're resetting both the FG & BG, also reset the meta attributes (underline)
+                //      as well as the boldness
+                attrs.SetMetaAttributes(0);
+                attrs.Debolden();
+            }
+            fSuccess = true;
+        }
+        else if (s_IsBoldColorOption(opt))
+        {
+            if (opt == DispatchTypes::GraphicsOptions::BoldBright)
+            {
+                attrs.Embolden();
+            }
+            else
+            {
+                attrs.Debolden();
+            }
+            fSuccess = true;
+        }
+        else if (s_IsRgbColorOption(opt))
+        {
+            COLORREF rgbColor;
+            bool fIsForeground = true;
+            size_t cOptionsConsumed = 0;
+
+            fSuccess = _GetExtendedColorHelper(&(rgOptions[i]), cOptions - i, &rgbColor, &fIsForeground, &cOptionsConsumed);
+            if (fSuccess)
+            {
+                attrs.SetColor(rgbColor, fIsForeground);
+            }
+
+            i += (cOptionsConsumed - 1); // cOptionsConsumed includes the opt we're currently on.
+        }
+        else
+        {
+            _SetGraphicsOptionHelper(opt, &attr);
+            attrs.SetLegacyAttributes(attr, _fChangedForeground, _fChangedBackground, _fChangedMetaAttrs);
+            fSuccess = true;
+
+            _fChangedForeground = false;
+            _fChangedBackground = false;
+            _fChangedMetaAttrs = false;
+        }
+    }
+
+    return fSuccess;
+}
+
 // Routine Description:
 // - SGR - Modifies the graphical rendering options applied to the next characters written into the buffer.
 //       - Options include colors, invert, underlines, and other "font style" type options.
+//       - When the console can hand us its attributes, every option is applied to a copy of them,
+//         and the result is handed back once, instead of once per option.
 // Arguments:
 // - rgOptions - An array of options that will be applied from 0 to N, in order, one at a time by setting or removing flags in the font style properties.
 // - cOptions - The count of options (a.k.a. the N in the above line of comments)
@@ -395,6 +530,13 @@ bool AdaptDispatch::_SetDefaultColorHelper(const DispatchTypes::GraphicsOptions
 // - True if handled successfully. False otherwise.
 bool AdaptDispatch::SetGraphicsRendition(_In_reads_(cOptions) const DispatchTypes::GraphicsOptions* const rgOptions, const size_t cOptions)
 {
+    TextAttribute attrs;
+    if (_conApi->PrivateGetTextAttributes(attrs))
+    {
+        const bool fSuccess = _ApplyGraphicsOptions(rgOptions, cOptions, attrs);
+        return !!_conApi->PrivateSetTextAttributes(attrs) && fSuccess;
+    }
+
     // We use the private function here to get just the default color attributes as a performance optimization.
     // Calling the public GetConsoleScreenBufferInfoEx costs a lot of performance time/power in a tight loop
     // because it has to fill the Largest Window Size by asking the OS and wastes time memcpying colors and other data
@@ -18,6 +18,7 @@ Author(s):
 
 #include "..\..\types\inc\IInputEvent.hpp"
 #include "..\..\inc\conattrs.hpp"
+#include "..\..\buffer\out\TextAttribute.hpp"
 
 #include <deque>
 #include <memory>
@@ -53,6 +54,9 @@ namespace Microsoft::Console::VirtualTerminal
                                                   const bool fIsForeground) = 0;
         virtual BOOL SetConsoleRGBTextAttribute(const COLORREF rgbColor, const bool fIsForeground) = 0;
         virtual BOOL PrivateBoldText(const bool bolded) = 0;
+        virtual BOOL PrivateGetTextAttributes(TextAttribute& attrs) const = 0;
+        virtual BOOL PrivateSetTextAttributes(const TextAttribute& attrs) = 0;
+        virtual BOOL PrivateGetXtermColor(const int iXtermTableEntry, COLORREF& rgbColor) const = 0;
 
         virtual BOOL PrivateWriteConsoleInputW(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& events,
                                                _Out_ size_t& eventsWritten) = 0;
@@ -85,6 +89,7 @@ namespace Microsoft::Console::VirtualTerminal
         virtual BOOL PrivateEnableButtonEventMouseMode(const bool fEnabled) = 0;
         virtual BOOL PrivateEnableAnyEventMouseMode(const bool fEnabled) = 0;
         virtual BOOL PrivateEnableAlternateScroll(const bool fEnabled) = 0;
+        virtual BOOL PrivateEnableBracketedPasteMode(const bool fEnabled) = 0;
         virtual BOOL PrivateEraseAll() = 0;
         virtual BOOL SetCursorStyle(const CursorType cursorType) = 0;
         virtual BOOL SetCursorColor(const COLORREF cursorColor) = 0;
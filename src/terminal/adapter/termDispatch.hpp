@@ -10,6 +10,7 @@ Abstract:
     Fails on every callback, but handy for tests.
 */
 #include "ITermDispatch.hpp"
+#include "DispatchBatch.hpp"
 #pragma once
 
 namespace Microsoft::Console::VirtualTerminal
@@ -61,6 +62,7 @@ public:
     virtual bool EnableButtonEventMouseMode(const bool /*fEnabled*/) { return false; } // ?1002
     virtual bool EnableAnyEventMouseMode(const bool /*fEnabled*/) { return false; } // ?1003
     virtual bool EnableAlternateScroll(const bool /*fEnabled*/) { return false; } // ?1007
+    virtual bool EnableBracketedPasteMode(const bool /*fEnabled*/) { return false; } // ?2004
     virtual bool SetColorTableEntry(const size_t /*tableIndex*/, const DWORD /*dwColor*/) { return false; } // OSCColorTable
 
     virtual bool EraseInDisplay(const DispatchTypes::EraseType /* eraseType*/) { return false; } // ED
@@ -87,10 +89,14 @@ public:
     virtual bool SetCursorStyle(const DispatchTypes::CursorStyle /*cursorStyle*/){ return false; } // DECSCUSR
     virtual bool SetCursorColor(const COLORREF /*Color*/) { return false; } // OSCSetCursorColor, OSCResetCursorColor
 
+    virtual bool AddHyperlink(const std::wstring_view /*uri*/, const std::wstring_view /*id*/) { return false; } // OSCHyperlink
+    virtual bool EndHyperlink() { return false; } // OSCHyperlink
+
     // DTTERM_WindowManipulation
     virtual bool WindowManipulation(const DispatchTypes::WindowManipulationType /*uiFunction*/,
                                     _In_reads_(_Param_(3)) const unsigned short* const /*rgusParams*/,
                                     const size_t /*cParams*/) { return false; }
 
+    virtual bool ApplyBatch(const DispatchBatch& batch) { return batch.Replay(*this); }
 };
 
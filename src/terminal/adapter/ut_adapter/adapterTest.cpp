@@ -347,6 +347,38 @@ public:
         return !!_fPrivateBoldTextResult;
     }
 
+    BOOL PrivateGetTextAttributes(TextAttribute& attrs) const override
+    {
+        Log::Comment(L"PrivateGetTextAttributes MOCK called...");
+        if (_fPrivateGetTextAttributesResult)
+        {
+            attrs = _textAttributes;
+        }
+        return _fPrivateGetTextAttributesResult;
+    }
+
+    BOOL PrivateSetTextAttributes(const TextAttribute& attrs) override
+    {
+        Log::Comment(L"PrivateSetTextAttributes MOCK called...");
+        if (_fPrivateSetTextAttributesResult)
+        {
+            _textAttributes = attrs;
+            _cSetTextAttributes++;
+        }
+        return _fPrivateSetTextAttributesResult;
+    }
+
+    BOOL PrivateGetXtermColor(const int iXtermTableEntry, COLORREF& rgbColor) const override
+    {
+        Log::Comment(L"PrivateGetXtermColor MOCK called...");
+        if (_fPrivateGetXtermColorResult)
+        {
+            VERIFY_ARE_EQUAL(_iExpectedXtermTableEntry, iXtermTableEntry);
+            rgbColor = _xtermColor;
+        }
+        return _fPrivateGetXtermColorResult;
+    }
+
     BOOL PrivateWriteConsoleInputW(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& events,
                                    _Out_ size_t& eventsWritten) override
     {
@@ -652,6 +684,16 @@ public:
         return _fPrivateEnableAlternateScrollResult;
     }
 
+    BOOL PrivateEnableBracketedPasteMode(const bool fEnabled) override
+    {
+        Log::Comment(L"PrivateEnableBracketedPasteMode MOCK called...");
+        if (_fPrivateEnableBracketedPasteModeResult)
+        {
+            VERIFY_ARE_EQUAL(_fExpectedBracketedPasteModeEnabled, fEnabled);
+        }
+        return _fPrivateEnableBracketedPasteModeResult;
+    }
+
     BOOL PrivateEraseAll() override
     {
         Log::Comment(L"PrivateEraseAll MOCK called...");
@@ -1312,6 +1354,15 @@ public:
     bool _fExpectedIsBold = false;
     bool _fIsBold = false;
 
+    // These stay off unless a test turns them on, so that SetGraphicsRendition
+    //   applies options one at a time through the mocks above.
+    BOOL _fPrivateGetTextAttributesResult = false;
+    BOOL _fPrivateSetTextAttributesResult = false;
+    BOOL _fPrivateGetXtermColorResult = false;
+    TextAttribute _textAttributes;
+    size_t _cSetTextAttributes = 0;
+    COLORREF _xtermColor = 0;
+
     bool _privateShowCursorResult = false;
     bool _expectedShowCursor = false;
 
@@ -1354,12 +1405,14 @@ public:
     bool _fExpectedClearAll = false;
     bool _fExpectedMouseEnabled = false;
     bool _fExpectedAlternateScrollEnabled = false;
+    bool _fExpectedBracketedPasteModeEnabled = false;
     BOOL _fPrivateEnableVT200MouseModeResult = false;
     BOOL _fPrivateEnableUTF8ExtendedMouseModeResult = false;
     BOOL _fPrivateEnableSGRExtendedMouseModeResult = false;
     BOOL _fPrivateEnableButtonEventMouseModeResult = false;
     BOOL _fPrivateEnableAnyEventMouseModeResult = false;
     BOOL _fPrivateEnableAlternateScrollResult = false;
+    BOOL _fPrivateEnableBracketedPasteModeResult = false;
     BOOL _fSetConsoleXtermTextAttributeResult = false;
     BOOL _fSetConsoleRGBTextAttributeResult = false;
     BOOL _fPrivateSetLegacyAttributesResult = false;
@@ -3303,6 +3356,32 @@ public:
         VERIFY_IS_TRUE(_pDispatch->EnableAlternateScroll(false));
     }
 
+    TEST_METHOD(BracketedPasteModeTest)
+    {
+        Log::Comment(L"Starting test...");
+
+        Log::Comment(L"Test 1: Enable and disable bracketed paste mode");
+        _testGetSet->_fIsPty = false;
+        _testGetSet->_fIsConsolePtyResult = true;
+        _testGetSet->_fPrivateEnableBracketedPasteModeResult = TRUE;
+        _testGetSet->_fExpectedBracketedPasteModeEnabled = true;
+        VERIFY_IS_TRUE(_pDispatch->EnableBracketedPasteMode(true));
+        _testGetSet->_fExpectedBracketedPasteModeEnabled = false;
+        VERIFY_IS_TRUE(_pDispatch->EnableBracketedPasteMode(false));
+
+        Log::Comment(L"Test 2: Through DECSET/DECRST");
+        const DispatchTypes::PrivateModeParams param = DispatchTypes::PrivateModeParams::XTERM_BracketedPasteMode;
+        _testGetSet->_fExpectedBracketedPasteModeEnabled = true;
+        VERIFY_IS_TRUE(_pDispatch->SetPrivateModes(&param, 1));
+        _testGetSet->_fExpectedBracketedPasteModeEnabled = false;
+        VERIFY_IS_TRUE(_pDispatch->ResetPrivateModes(&param, 1));
+
+        Log::Comment(L"Test 3: A pty leaves it to the terminal");
+        _testGetSet->_fIsPty = true;
+        _testGetSet->_fPrivateEnableBracketedPasteModeResult = FALSE;
+        VERIFY_IS_FALSE(_pDispatch->EnableBracketedPasteMode(true));
+    }
+
     TEST_METHOD(Xterm256ColorTest)
     {
         Log::Comment(L"Starting test...");
@@ -3371,6 +3450,62 @@ public:
 
     }
 
+    TEST_METHOD(GraphicsSinglePassTests)
+    {
+        Log::Comment(L"Starting test...");
+
+        _testGetSet->PrepData();
+        _testGetSet->_fPrivateGetTextAttributesResult = true;
+        _testGetSet->_fPrivateSetTextAttributesResult = true;
+        _testGetSet->_fPrivateGetXtermColorResult = true;
+        _testGetSet->_textAttributes = TextAttribute{ FOREGROUND_BLUE | FOREGROUND_GREEN | FOREGROUND_RED };
+
+        DispatchTypes::GraphicsOptions rgOptions[16];
+
+        Log::Comment(L"Test 1: Every option, extended colors too, should be applied with one update.");
+        rgOptions[0] = DispatchTypes::GraphicsOptions::BoldBright;
+        rgOptions[1] = DispatchTypes::GraphicsOptions::Underline;
+        rgOptions[2] = DispatchTypes::GraphicsOptions::ForegroundRed;
+        rgOptions[3] = DispatchTypes::GraphicsOptions::BackgroundExtended;
+        rgOptions[4] = DispatchTypes::GraphicsOptions::RGBColor;
+        rgOptions[5] = (DispatchTypes::GraphicsOptions)10;
+        rgOptions[6] = (DispatchTypes::GraphicsOptions)20;
+        rgOptions[7] = (DispatchTypes::GraphicsOptions)30;
+        VERIFY_IS_TRUE(_pDispatch->SetGraphicsRendition(rgOptions, 8));
+
+        TextAttribute expected{ FOREGROUND_RED | COMMON_LVB_UNDERSCORE };
+        expected.Embolden();
+        expected.SetBackground(RGB(10, 20, 30));
+        VERIFY_ARE_EQUAL(1u, _testGetSet->_cSetTextAttributes);
+        VERIFY_IS_TRUE(expected == _testGetSet->_textAttributes);
+
+        Log::Comment(L"Test 2: Off should reset everything before the options after it are applied.");
+        rgOptions[0] = DispatchTypes::GraphicsOptions::Off;
+        rgOptions[1] = DispatchTypes::GraphicsOptions::ForegroundExtended;
+        rgOptions[2] = DispatchTypes::GraphicsOptions::Xterm256Index;
+        rgOptions[3] = (DispatchTypes::GraphicsOptions)42;
+        _testGetSet->_iExpectedXtermTableEntry = 42;
+        _testGetSet->_xtermColor = RGB(1, 2, 3);
+        VERIFY_IS_TRUE(_pDispatch->SetGraphicsRendition(rgOptions, 4));
+
+        VERIFY_ARE_EQUAL(2u, _testGetSet->_cSetTextAttributes);
+        VERIFY_IS_FALSE(_testGetSet->_textAttributes.IsBold());
+        VERIFY_ARE_EQUAL(0, _testGetSet->_textAttributes.GetMetaAttributes());
+        VERIFY_IS_TRUE(_testGetSet->_textAttributes.BackgroundIsDefault());
+        VERIFY_IS_FALSE(_testGetSet->_textAttributes.ForegroundIsDefault());
+        VERIFY_ARE_EQUAL(RGB(1, 2, 3), _testGetSet->_textAttributes.CalculateRgbForeground({}, 0, 0));
+
+        Log::Comment(L"Test 3: An index that isn't on the table fails, but the options before it are kept.");
+        rgOptions[0] = DispatchTypes::GraphicsOptions::Underline;
+        rgOptions[1] = DispatchTypes::GraphicsOptions::BackgroundExtended;
+        rgOptions[2] = DispatchTypes::GraphicsOptions::Xterm256Index;
+        rgOptions[3] = (DispatchTypes::GraphicsOptions)256;
+        VERIFY_IS_FALSE(_pDispatch->SetGraphicsRendition(rgOptions, 4));
+
+        VERIFY_ARE_EQUAL(3u, _testGetSet->_cSetTextAttributes);
+        VERIFY_ARE_EQUAL(COMMON_LVB_UNDERSCORE, _testGetSet->_textAttributes.GetMetaAttributes());
+    }
+
 
     TEST_METHOD(HardReset)
     {
@@ -203,6 +203,78 @@ const size_t TerminalInput::s_cKeypadApplicationMapping     = ARRAYSIZE(s_rgKeyp
 const size_t TerminalInput::s_cModifierKeyMapping           = ARRAYSIZE(s_rgModifierKeyMapping);
 const size_t TerminalInput::s_cSimpleModifedKeyMapping      = ARRAYSIZE(s_rgSimpleModifedKeyMapping);
 
+// These have to come after the tables above, so that the tables are filled in
+//      by the time the indices are built from them.
+const TerminalInput::_KeyIndex TerminalInput::s_cursorKeysNormalIndex      = s_BuildKeyIndex(s_rgCursorKeysNormalMapping, s_cCursorKeysNormalMapping);
+const TerminalInput::_KeyIndex TerminalInput::s_cursorKeysApplicationIndex = s_BuildKeyIndex(s_rgCursorKeysApplicationMapping, s_cCursorKeysApplicationMapping);
+const TerminalInput::_KeyIndex TerminalInput::s_keypadNumericIndex         = s_BuildKeyIndex(s_rgKeypadNumericMapping, s_cKeypadNumericMapping);
+const TerminalInput::_KeyIndex TerminalInput::s_keypadApplicationIndex     = s_BuildKeyIndex(s_rgKeypadApplicationMapping, s_cKeypadApplicationMapping);
+const TerminalInput::_KeyIndex TerminalInput::s_modifierKeyIndex           = s_BuildKeyIndex(s_rgModifierKeyMapping, s_cModifierKeyMapping);
+const TerminalInput::_KeyIndex TerminalInput::s_simpleModifedKeyIndex      = s_BuildKeyIndex(s_rgSimpleModifedKeyMapping, s_cSimpleModifedKeyMapping);
+
+// Routine Description:
+// - Gets the slot of a _KeyIndex that a virtual key with the given modifier
+//      keys pressed is found at.
+// Arguments:
+// - wVirtualKey - The virtual key. Must be less than 256.
+// - fShift, fAlt, fCtrl - Which of the modifier keys are pressed.
+// Return Value:
+// - The slot.
+static constexpr size_t s_KeyIndexSlot(const WORD wVirtualKey, const bool fShift, const bool fAlt, const bool fCtrl) noexcept
+{
+    return (wVirtualKey * 8) + (fShift ? 1 : 0) + (fAlt ? 2 : 0) + (fCtrl ? 4 : 0);
+}
+
+// Routine Description:
+// - Builds the index of a key mapping table, so that the entry a key
+//      translates to can be found without searching the table. Where more than
+//      one entry matches a key, the first one wins, as it would when walking
+//      the table.
+// Arguments:
+// - keyMapping - Array of key mappings to index
+// - cKeyMapping - number of entries in keyMapping
+// Return Value:
+// - The index.
+TerminalInput::_KeyIndex TerminalInput::s_BuildKeyIndex(_In_reads_(cKeyMapping) const TerminalInput::_TermKeyMap* keyMapping,
+                                                        const size_t cKeyMapping) noexcept
+{
+    // The slots are a BYTE each, and 0 means the key isn't in the table.
+    FAIL_FAST_IF(cKeyMapping >= UINT8_MAX);
+
+    _KeyIndex index{};
+    for (size_t i = 0; i < cKeyMapping; i++)
+    {
+        const _TermKeyMap& map = keyMapping[i];
+        FAIL_FAST_IF(map.wVirtualKey >= 256);
+
+        for (size_t state = 0; state < s_cKeyIndexModifierStates; state++)
+        {
+            const bool fShift = WI_IsFlagSet(state, 1);
+            const bool fAlt = WI_IsFlagSet(state, 2);
+            const bool fCtrl = WI_IsFlagSet(state, 4);
+
+            // If the mapping has no modifiers set, then it doesn't really care
+            //      what the modifiers are on the key. The caller will likely do
+            //      something with them.
+            // However, if there are modifiers set, then we only want to match
+            //      if the key's modifiers are the same as the modifiers in the
+            //      mapping.
+            const bool modifiersMatch =
+                WI_AreAllFlagsClear(map.dwModifiers, MOD_PRESSED) ||
+                ((WI_IsFlagSet(map.dwModifiers, SHIFT_PRESSED) == fShift) &&
+                 (WI_IsAnyFlagSet(map.dwModifiers, ALT_PRESSED) == fAlt) &&
+                 (WI_IsAnyFlagSet(map.dwModifiers, CTRL_PRESSED) == fCtrl));
+
+            BYTE& slot = index.at(s_KeyIndexSlot(map.wVirtualKey, fShift, fAlt, fCtrl));
+            if (modifiersMatch && slot == 0)
+            {
+                slot = gsl::narrow_cast<BYTE>(i + 1);
+            }
+        }
+    }
+    return index;
+}
+
 void TerminalInput::ChangeKeypadMode(const bool fApplicationMode)
 {
     _fKeypadApplicationMode = fApplicationMode;
@@ -213,6 +285,16 @@ void TerminalInput::ChangeCursorKeysMode(const bool fApplicationMode)
     _fCursorApplicationMode = fApplicationMode;
 }
 
+void TerminalInput::ChangeBracketedPasteMode(const bool fEnabled)
+{
+    _fBracketedPasteMode = fEnabled;
+}
+
+bool TerminalInput::IsBracketedPasteModeEnabled() const noexcept
+{
+    return _fBracketedPasteMode;
+}
+
 const size_t TerminalInput::GetKeyMappingLength(const KeyEvent& keyEvent) const
 {
     size_t length = 0;
@@ -242,6 +324,24 @@ const TerminalInput::_TermKeyMap* TerminalInput::GetKeyMapping(const KeyEvent& k
     return mapping;
 }
 
+// Routine Description:
+// - Gets the index of the table that GetKeyMapping returns for this key event.
+// Arguments:
+// - keyEvent - Key event to translate
+// Return Value:
+// - The index of the key mapping table for the key and the current modes.
+const TerminalInput::_KeyIndex& TerminalInput::_GetKeyMappingIndex(const KeyEvent& keyEvent) const
+{
+    if (keyEvent.IsCursorKey())
+    {
+        return (_fCursorApplicationMode) ? s_cursorKeysApplicationIndex : s_cursorKeysNormalIndex;
+    }
+    else
+    {
+        return (_fKeypadApplicationMode) ? s_keypadApplicationIndex : s_keypadNumericIndex;
+    }
+}
+
 // Routine Description:
 // - Searches the s_ModifierKeyMapping for a entry corresponding to this key event.
 //      Changes the second to last byte to correspond to the currently pressed modifier keys
@@ -256,7 +356,7 @@ bool TerminalInput::_SearchWithModifier(const KeyEvent& keyEvent) const
     const TerminalInput::_TermKeyMap* pMatchingMapping;
     bool fSuccess = _SearchKeyMapping(keyEvent,
                                       s_rgModifierKeyMapping,
-                                      s_cModifierKeyMapping,
+                                      s_modifierKeyIndex,
                                       &pMatchingMapping);
     if (fSuccess)
     {
@@ -286,7 +386,7 @@ bool TerminalInput::_SearchWithModifier(const KeyEvent& keyEvent) const
         //      don't need editing before sending.
         fSuccess = _SearchKeyMapping(keyEvent,
                                      s_rgSimpleModifedKeyMapping,
-                                     s_cSimpleModifedKeyMapping,
+                                     s_simpleModifedKeyIndex,
                                      &pMatchingMapping);
         if (fSuccess)
         {
@@ -314,52 +414,36 @@ bool TerminalInput::_SearchWithModifier(const KeyEvent& keyEvent) const
 }
 
 // Routine Description:
-// - Searches the keyMapping for a entry corresponding to this key event, and returns it.
+// - Looks up the entry of keyMapping corresponding to this key event, and returns it.
 // Arguments:
 // - keyEvent - Key event to translate
 // - keyMapping - Array of key mappings to search
-// - cKeyMapping - number of entries in keyMapping
+// - keyIndex - The index of keyMapping, from s_BuildKeyIndex
 // - pMatchingMapping - Where to put the pointer to the found match
 // Return Value:
 // - True if there was a match to a key translation
 bool TerminalInput::_SearchKeyMapping(const KeyEvent& keyEvent,
-                                      _In_reads_(cKeyMapping) const TerminalInput::_TermKeyMap* keyMapping,
-                                      const size_t cKeyMapping,
+                                      const TerminalInput::_TermKeyMap* keyMapping,
+                                      const _KeyIndex& keyIndex,
                                       _Out_ const TerminalInput::_TermKeyMap** pMatchingMapping) const
 {
-    bool fKeyTranslated = false;
-    for (size_t i = 0; i < cKeyMapping; i++)
+    const WORD wVirtualKey = keyEvent.GetVirtualKeyCode();
+    if (wVirtualKey >= 256)
     {
-        const _TermKeyMap* const pMap = &(keyMapping[i]);
-
-        if (pMap->wVirtualKey == keyEvent.GetVirtualKeyCode())
-        {
-            // If the mapping has no modifiers set, then it doesn't really care
-            //      what the modifiers are on the key. The caller will likely do
-            //      something with them.
-            // However, if there are modifiers set, then we only want to match
-            //      if the key's modifiers are the same as the modifiers in the
-            //      mapping.
-            bool modifiersMatch = WI_AreAllFlagsClear(pMap->dwModifiers, MOD_PRESSED);
-            if (!modifiersMatch)
-            {
-                // The modifier mapping expects certain modifier keys to be
-                //      pressed. Check those as well.
-                modifiersMatch =
-                    (WI_IsFlagSet(pMap->dwModifiers, SHIFT_PRESSED) == keyEvent.IsShiftPressed()) &&
-                    (WI_IsAnyFlagSet(pMap->dwModifiers, ALT_PRESSED) == keyEvent.IsAltPressed()) &&
-                    (WI_IsAnyFlagSet(pMap->dwModifiers, CTRL_PRESSED) == keyEvent.IsCtrlPressed());
-            }
+        return false;
+    }
 
-            if (modifiersMatch)
-            {
-                fKeyTranslated = true;
-                *pMatchingMapping = pMap;
-                break;
-            }
-        }
+    const BYTE entry = keyIndex[s_KeyIndexSlot(wVirtualKey,
+                                               keyEvent.IsShiftPressed(),
+                                               keyEvent.IsAltPressed(),
+                                               keyEvent.IsCtrlPressed())];
+    if (entry == 0)
+    {
+        return false;
     }
-    return fKeyTranslated;
+
+    *pMatchingMapping = &keyMapping[entry - 1];
+    return true;
 }
 
 // Routine Description:
@@ -367,15 +451,15 @@ bool TerminalInput::_SearchKeyMapping(const KeyEvent& keyEvent,
 // Arguments:
 // - keyEvent - Key event to translate
 // - keyMapping - Array of key mappings to search
-// - cKeyMapping - number of entries in keyMapping
+// - keyIndex - The index of keyMapping, from s_BuildKeyIndex
 // Return Value:
 // - True if there was a match to a key translation, and we successfully sent it to the input
 bool TerminalInput::_TranslateDefaultMapping(const KeyEvent& keyEvent,
-                                             _In_reads_(cKeyMapping) const TerminalInput::_TermKeyMap* keyMapping,
-                                             const size_t cKeyMapping) const
+                                             const TerminalInput::_TermKeyMap* keyMapping,
+                                             const _KeyIndex& keyIndex) const
 {
     const TerminalInput::_TermKeyMap* pMatchingMapping;
-    bool fSuccess = _SearchKeyMapping(keyEvent, keyMapping, cKeyMapping, &pMatchingMapping);
+    bool fSuccess = _SearchKeyMapping(keyEvent, keyMapping, keyIndex, &pMatchingMapping);
     if (fSuccess)
     {
         _SendInputSequence(pMatchingMapping->pwszSequence);
@@ -472,7 +556,7 @@ bool TerminalInput::HandleKey(const IInputEvent* const pInEvent) const
                 if ((keyEvent.GetVirtualKeyCode() < '0' || keyEvent.GetVirtualKeyCode() > 'Z') &&
                     keyEvent.GetVirtualKeyCode() != VK_CANCEL)
                 {
-                    fKeyHandled = _TranslateDefaultMapping(keyEvent, GetKeyMapping(keyEvent), GetKeyMappingLength(keyEvent));
+                    fKeyHandled = _TranslateDefaultMapping(keyEvent, GetKeyMapping(keyEvent), _GetKeyMappingIndex(keyEvent));
                 }
                 else
                 {
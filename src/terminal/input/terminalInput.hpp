@@ -13,7 +13,9 @@ Author(s):
 - Michael Niksa (MiNiksa) 30-Oct-2015
 --*/
 
+#include <array>
 #include <functional>
+#include <string_view>
 #include "../../types/inc/IInputEvent.hpp"
 #pragma once
 
@@ -28,12 +30,19 @@ namespace Microsoft::Console::VirtualTerminal
         bool HandleKey(const IInputEvent* const pInEvent) const;
         void ChangeKeypadMode(const bool fApplicationMode);
         void ChangeCursorKeysMode(const bool fApplicationMode);
+        void ChangeBracketedPasteMode(const bool fEnabled);
+        bool IsBracketedPasteModeEnabled() const noexcept;
+
+        // While bracketed paste mode is on, pasted text is sent between these.
+        static constexpr std::wstring_view s_BracketedPasteStart{ L"\x1b[200~" };
+        static constexpr std::wstring_view s_BracketedPasteEnd{ L"\x1b[201~" };
 
     private:
 
         std::function<void(std::deque<std::unique_ptr<IInputEvent>>&)> _pfnWriteEvents;
         bool _fKeypadApplicationMode = false;
         bool _fCursorApplicationMode = false;
+        bool _fBracketedPasteMode = false;
 
         void _SendNullInputSequence(const DWORD dwControlKeyState) const;
         void _SendInputSequence(_In_ PCWSTR const pwszSequence) const;
@@ -47,12 +56,12 @@ namespace Microsoft::Console::VirtualTerminal
 
             static const size_t s_cchMaxSequenceLength;
 
-            _TermKeyMap(const WORD wVirtualKey, _In_ PCWSTR const pwszSequence) :
+            constexpr _TermKeyMap(const WORD wVirtualKey, _In_ PCWSTR const pwszSequence) :
                 wVirtualKey(wVirtualKey),
                 pwszSequence(pwszSequence),
                 dwModifiers(0) {};
 
-            _TermKeyMap(const WORD wVirtualKey, const DWORD dwModifiers, _In_ PCWSTR const pwszSequence) :
+            constexpr _TermKeyMap(const WORD wVirtualKey, const DWORD dwModifiers, _In_ PCWSTR const pwszSequence) :
                 wVirtualKey(wVirtualKey),
                 pwszSequence(pwszSequence),
                 dwModifiers(dwModifiers) {};
@@ -77,13 +86,34 @@ namespace Microsoft::Console::VirtualTerminal
         static const size_t s_cModifierKeyMapping;
         static const size_t s_cSimpleModifedKeyMapping;
 
+        // For each of the tables above, which of its entries a key translates
+        //      to, by the virtual key and whether Shift, Alt and Ctrl are
+        //      pressed. Each slot holds the index of the entry + 1, or 0 when
+        //      the key isn't in the table. These are built from the tables
+        //      once, so that finding a key is a single lookup instead of a
+        //      walk through the table on every key press.
+        static constexpr size_t s_cKeyIndexModifierStates = 8;
+        using _KeyIndex = std::array<BYTE, 256 * s_cKeyIndexModifierStates>;
+
+        static const _KeyIndex s_cursorKeysNormalIndex;
+        static const _KeyIndex s_cursorKeysApplicationIndex;
+        static const _KeyIndex s_keypadNumericIndex;
+        static const _KeyIndex s_keypadApplicationIndex;
+        static const _KeyIndex s_modifierKeyIndex;
+        static const _KeyIndex s_simpleModifedKeyIndex;
+
+        static _KeyIndex s_BuildKeyIndex(_In_reads_(cKeyMapping) const TerminalInput::_TermKeyMap* keyMapping,
+                                         const size_t cKeyMapping) noexcept;
+
+        const _KeyIndex& _GetKeyMappingIndex(const KeyEvent& keyEvent) const;
+
         bool _SearchKeyMapping(const KeyEvent& keyEvent,
-                                _In_reads_(cKeyMapping) const TerminalInput::_TermKeyMap* keyMapping,
-                                const size_t cKeyMapping,
+                                const TerminalInput::_TermKeyMap* keyMapping,
+                                const _KeyIndex& keyIndex,
                                 _Out_ const TerminalInput::_TermKeyMap** pMatchingMapping) const;
         bool _TranslateDefaultMapping(const KeyEvent& keyEvent,
-                                        _In_reads_(cKeyMapping) const TerminalInput::_TermKeyMap* keyMapping,
-                                        const size_t cKeyMapping) const;
+                                        const TerminalInput::_TermKeyMap* keyMapping,
+                                        const _KeyIndex& keyIndex) const;
         bool _SearchWithModifier(const KeyEvent& keyEvent) const;
 
 
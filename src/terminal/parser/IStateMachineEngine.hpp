@@ -44,8 +44,8 @@ namespace Microsoft::Console::VirtualTerminal
 
         virtual bool ActionOscDispatch(const wchar_t wch,
                                         const unsigned short sOscParam,
-                                        _Inout_updates_(cchOscString) wchar_t* const pwchOscStringBuffer,
-                                        const unsigned short cchOscString) = 0;
+                                        _In_reads_(cchOscString) const wchar_t* const pwchOscStringBuffer,
+                                        const size_t cchOscString) = 0;
 
         virtual bool ActionSs3Dispatch(const wchar_t wch,
                                         _In_reads_(cParams) const unsigned short* const rgusParams,
@@ -54,6 +54,10 @@ namespace Microsoft::Console::VirtualTerminal
         virtual bool FlushAtEndOfString() const = 0;
         virtual bool DispatchControlCharsFromEscape() const = 0;
 
+        // Bracket the actions for one string, for engines that batch them up.
+        virtual void BeginString() = 0;
+        virtual void EndString() = 0;
+
     };
 
     inline IStateMachineEngine::~IStateMachineEngine() {}
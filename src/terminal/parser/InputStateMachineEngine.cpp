@@ -84,7 +84,9 @@ InputStateMachineEngine::InputStateMachineEngine(IInteractDispatch* const pDispa
 
 InputStateMachineEngine::InputStateMachineEngine(IInteractDispatch* const pDispatch, const bool lookingForDSR) :
     _pDispatch(THROW_IF_NULL_ALLOC(pDispatch)),
-    _lookingForDSR(lookingForDSR)
+    _lookingForDSR(lookingForDSR),
+    _pendingInput{},
+    _batchDepth{ 0 }
 {
 }
 
@@ -106,6 +108,8 @@ bool InputStateMachineEngine::_DoControlCharacter(const wchar_t wch, const bool
     if (wch == UNICODE_ETX && !writeAlt)
     {
         // This is Ctrl+C, which is handled specially by the host.
+        // Everything typed before it has to get there first.
+        _FlushPendingInput();
         fSuccess = _pDispatch->WriteCtrlC();
     }
     else if (wch >= '\x0' && wch < '\x20')
@@ -227,6 +231,13 @@ bool InputStateMachineEngine::ActionPrintString(const wchar_t* const rgwch,
     {
         return true;
     }
+
+    if (_batchDepth > 0)
+    {
+        std::deque<std::unique_ptr<IInputEvent>> inputEvents;
+        return _pDispatch->StringToInput(rgwch, cch, inputEvents) &&
+               _WriteInput(inputEvents);
+    }
     return _pDispatch->WriteString(rgwch, cch);
 }
 
@@ -314,6 +325,18 @@ bool InputStateMachineEngine::ActionCsiDispatch(const wchar_t wch,
     switch(wch)
     {
         case CsiActionCodes::Generic:
+            // The terminal sends what's pasted between these when the app asked
+            //      for bracketed paste mode. They aren't keys - the app that
+            //      asked for them reads VT, so pass them along as they are.
+            if (cParams == 1 &&
+                (rgusParams[0] == GenericKeyIdentifiers::BracketedPasteStart ||
+                 rgusParams[0] == GenericKeyIdentifiers::BracketedPasteEnd))
+            {
+                const std::wstring_view marker = rgusParams[0] == GenericKeyIdentifiers::BracketedPasteStart ?
+                                                 std::wstring_view{ L"\x1b[200~" } :
+                                                 std::wstring_view{ L"\x1b[201~" };
+                return ActionPrintString(marker.data(), marker.size());
+            }
             dwModifierState = _GetGenericKeysModifierState(rgusParams, cParams);
             fSuccess = _GetGenericVkey(rgusParams, cParams, &vkey);
             break;
@@ -367,6 +390,7 @@ bool InputStateMachineEngine::ActionCsiDispatch(const wchar_t wch,
             // Else, fall though to the _GetCursorKeysModifierState handler.
                 if (_lookingForDSR)
                 {
+                    _FlushPendingInput();
                     fSuccess = _pDispatch->MoveCursor(row, col);
                     // Right now we're only looking for on initial cursor
                     //      position response. After that, only look for F3.
@@ -388,6 +412,7 @@ bool InputStateMachineEngine::ActionCsiDispatch(const wchar_t wch,
                 fSuccess = _WriteSingleKey(vkey, dwModifierState);
                 break;
             case CsiActionCodes::DTTERM_WindowManipulation:
+                _FlushPendingInput();
                 fSuccess = _pDispatch->WindowManipulation(static_cast<DispatchTypes::WindowManipulationType>(uiFunction),
                                                           rgusRemainingArgs,
                                                           cRemainingArgs);
@@ -468,8 +493,8 @@ bool InputStateMachineEngine::ActionIgnore()
 // - true if we handled the dsipatch.
 bool InputStateMachineEngine::ActionOscDispatch(const wchar_t /*wch*/,
                                                 const unsigned short /*sOscParam*/,
-                                                _Inout_updates_(_Param_(4)) wchar_t* const /*pwchOscStringBuffer*/,
-                                                const unsigned short /*cchOscString*/)
+                                                _In_reads_(_Param_(4)) const wchar_t* const /*pwchOscStringBuffer*/,
+                                                const size_t /*cchOscString*/)
 {
     return false;
 }
@@ -664,6 +689,48 @@ bool InputStateMachineEngine::_WriteSingleKey(const wchar_t wch, const short vke
 
     std::deque<std::unique_ptr<IInputEvent>> inputEvents = IInputEvent::Create(gsl::make_span(rgInput, cInput));
 
+    return _WriteInput(inputEvents);
+}
+
+// Method Description:
+// - Writes input events to the dispatch. While a string is being processed,
+//      they're added to the pending input instead, so that the whole string
+//      is written to the input buffer at once, waking up any readers once.
+// Arguments:
+// - inputEvents - the events to write. They're moved out of the deque.
+// Return Value:
+// - true iff we successfully wrote (or queued) the events.
+bool InputStateMachineEngine::_WriteInput(std::deque<std::unique_ptr<IInputEvent>>& inputEvents)
+{
+    if (_batchDepth > 0)
+    {
+        std::move(inputEvents.begin(),
+                  inputEvents.end(),
+                  std::back_inserter(_pendingInput));
+        inputEvents.clear();
+        return true;
+    }
+    return _pDispatch->WriteInput(inputEvents);
+}
+
+// Method Description:
+// - Writes any pending input events to the dispatch in one call. This has to
+//      happen before anything else is dispatched, so that it all arrives in order.
+// Arguments:
+// - <none>
+// Return Value:
+// - true iff there was nothing to write, or we successfully wrote it.
+bool InputStateMachineEngine::_FlushPendingInput()
+{
+    if (_pendingInput.empty())
+    {
+        return true;
+    }
+
+    // The dispatch might feed more input through us, so take the pending
+    //      events out before handing them over.
+    std::deque<std::unique_ptr<IInputEvent>> inputEvents;
+    inputEvents.swap(_pendingInput);
     return _pDispatch->WriteInput(inputEvents);
 }
 
@@ -890,6 +957,34 @@ bool InputStateMachineEngine::DispatchControlCharsFromEscape() const
     return true;
 }
 
+// Routine Description:
+// - Called by the state machine when it starts processing a string. Until the
+//      matching EndString, the key events we generate are collected, instead
+//      of being written one sequence at a time.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void InputStateMachineEngine::BeginString()
+{
+    _batchDepth++;
+}
+
+// Routine Description:
+// - Called by the state machine when it's done processing a string. Writes
+//      all the input collected since BeginString in one call.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void InputStateMachineEngine::EndString()
+{
+    if (_batchDepth > 0 && --_batchDepth == 0)
+    {
+        _FlushPendingInput();
+    }
+}
+
 // Method Description:
 // - Retrieves the type of window manipulation operation from the parameter pool
 //      stored during Param actions.
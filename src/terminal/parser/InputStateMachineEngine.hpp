@@ -57,8 +57,8 @@ namespace Microsoft::Console::VirtualTerminal
 
         bool ActionOscDispatch(const wchar_t wch,
                             const unsigned short sOscParam,
-                            _Inout_updates_(cchOscString) wchar_t* const pwchOscStringBuffer,
-                            const unsigned short cchOscString) override;
+                            _In_reads_(cchOscString) const wchar_t* const pwchOscStringBuffer,
+                            const size_t cchOscString) override;
 
         bool ActionSs3Dispatch(const wchar_t wch,
                             _In_reads_(cParams) const unsigned short* const rgusParams,
@@ -67,11 +67,18 @@ namespace Microsoft::Console::VirtualTerminal
         bool FlushAtEndOfString() const override;
         bool DispatchControlCharsFromEscape() const override;
 
+        void BeginString() override;
+        void EndString() override;
+
     private:
 
         const std::unique_ptr<IInteractDispatch> _pDispatch;
         bool _lookingForDSR;
 
+        // Input generated while processing a string, waiting to be written all at once.
+        std::deque<std::unique_ptr<IInputEvent>> _pendingInput;
+        size_t _batchDepth;
+
         enum CsiActionCodes : wchar_t
         {
             ArrowUp = L'A',
@@ -123,6 +130,8 @@ namespace Microsoft::Console::VirtualTerminal
             F10 = 21,
             F11 = 23,
             F12 = 24,
+            BracketedPasteStart = 200,
+            BracketedPasteEnd = 201,
         };
 
         struct CSI_TO_VKEY {
@@ -163,6 +172,8 @@ namespace Microsoft::Console::VirtualTerminal
 
         bool _WriteSingleKey(const short vkey, const DWORD dwModifierState);
         bool _WriteSingleKey(const wchar_t wch, const short vkey, const DWORD dwModifierState);
+        bool _WriteInput(std::deque<std::unique_ptr<IInputEvent>>& inputEvents);
+        bool _FlushPendingInput();
 
         size_t _GenerateWrappedSequence(const wchar_t wch,
                                         const short vkey,
@@ -15,7 +15,9 @@ OutputStateMachineEngine::OutputStateMachineEngine(ITermDispatch* const pDispatc
     _dispatch(pDispatch),
     _pfnFlushToTerminal(nullptr),
     _pTtyConnection(nullptr),
-    _lastPrintedChar(AsciiChars::NUL)
+    _lastPrintedChar(AsciiChars::NUL),
+    _batch{},
+    _batchDepth(0)
 {
 }
 
@@ -43,7 +45,14 @@ ITermDispatch& OutputStateMachineEngine::Dispatch() noexcept
 // - true iff we successfully dispatched the sequence.
 bool OutputStateMachineEngine::ActionExecute(const wchar_t wch)
 {
-    _dispatch->Execute(wch);
+    if (_IsBatching())
+    {
+        _batch.AddExecute(wch);
+    }
+    else
+    {
+        _dispatch->Execute(wch);
+    }
     _ClearLastChar();
     return true;
 }
@@ -78,7 +87,14 @@ bool OutputStateMachineEngine::ActionPrint(const wchar_t wch)
         _lastPrintedChar = wch;
     }
 
-    _dispatch->Print(wch); // call print
+    if (_IsBatching())
+    {
+        _batch.AddPrintString(&wch, 1);
+    }
+    else
+    {
+        _dispatch->Print(wch); // call print
+    }
 
     return true;
 }
@@ -104,7 +120,14 @@ bool OutputStateMachineEngine::ActionPrintString(const wchar_t* const rgwch, con
         _lastPrintedChar = wch;
     }
 
-    _dispatch->PrintString(rgwch, cch); // call print
+    if (_IsBatching())
+    {
+        _batch.AddPrintString(rgwch, cch);
+    }
+    else
+    {
+        _dispatch->PrintString(rgwch, cch); // call print
+    }
 
     return true;
 }
@@ -125,6 +148,8 @@ bool OutputStateMachineEngine::ActionPrintString(const wchar_t* const rgwch, con
 bool OutputStateMachineEngine::ActionPassThroughString(const wchar_t* const rgwch,
                                                        _In_ size_t const cch)
 {
+    _FlushBatch();
+
     bool fSuccess = true;
     if (_pTtyConnection != nullptr)
     {
@@ -152,6 +177,8 @@ bool OutputStateMachineEngine::ActionEscDispatch(const wchar_t wch,
                                                  const unsigned short cIntermediate,
                                                  const wchar_t wchIntermediate)
 {
+    _FlushBatch();
+
     bool fSuccess = false;
 
     // no intermediates.
@@ -351,9 +378,12 @@ bool OutputStateMachineEngine::ActionCsiDispatch(const wchar_t wch,
             break;
         }
 
-        // if param filling successful, try to dispatch
-        if (fSuccess)
+        // if param filling successful, try to batch it up, or dispatch it
+        const bool fBatched = fSuccess && _TryBatchCsiDispatch(wch, uiDistance, uiLine, uiColumn, eraseType, rgGraphicsOptions, cOptions);
+        if (fSuccess && !fBatched)
         {
+            _FlushBatch();
+
             switch (wch)
             {
             case VTActionCodes::CUU_CursorUp:
@@ -494,6 +524,8 @@ bool OutputStateMachineEngine::ActionCsiDispatch(const wchar_t wch,
     }
     else if (cIntermediate == 1)
     {
+        _FlushBatch();
+
         switch (wchIntermediate)
         {
         case L'?':
@@ -678,21 +710,25 @@ bool OutputStateMachineEngine::ActionIgnore()
 // - true if we handled the dsipatch.
 bool OutputStateMachineEngine::ActionOscDispatch(const wchar_t /*wch*/,
                                                  const unsigned short sOscParam,
-                                                 _Inout_updates_(cchOscString) wchar_t* const pwchOscStringBuffer,
-                                                 const unsigned short cchOscString)
+                                                 _In_reads_(cchOscString) const wchar_t* const pwchOscStringBuffer,
+                                                 const size_t cchOscString)
 {
+    _FlushBatch();
+
     bool fSuccess = false;
-    wchar_t* pwchTitle = nullptr;
-    unsigned short sCchTitleLength = 0;
+    const wchar_t* pwchTitle = nullptr;
+    size_t cchTitle = 0;
     size_t tableIndex = 0;
     DWORD dwColor = 0;
+    std::wstring_view uri;
+    std::wstring_view id;
 
     switch (sOscParam)
     {
     case OscActionCodes::SetIconAndWindowTitle:
     case OscActionCodes::SetWindowIcon:
     case OscActionCodes::SetWindowTitle:
-        fSuccess = _GetOscTitle(pwchOscStringBuffer, cchOscString, &pwchTitle, &sCchTitleLength);
+        fSuccess = _GetOscTitle(pwchOscStringBuffer, cchOscString, &pwchTitle, &cchTitle);
         break;
     case OscActionCodes::SetColor:
         fSuccess = _GetOscSetColorTable(pwchOscStringBuffer, cchOscString, &tableIndex, &dwColor);
@@ -705,6 +741,9 @@ bool OutputStateMachineEngine::ActionOscDispatch(const wchar_t /*wch*/,
         dwColor = 0xffffffff;
         fSuccess = true;
         break;
+    case OscActionCodes::Hyperlink:
+        fSuccess = pwchOscStringBuffer != nullptr && s_GetOscHyperlink({ pwchOscStringBuffer, cchOscString }, uri, id);
+        break;
     default:
         // If no functions to call, overall dispatch was a failure.
         fSuccess = false;
@@ -717,7 +756,7 @@ bool OutputStateMachineEngine::ActionOscDispatch(const wchar_t /*wch*/,
         case OscActionCodes::SetIconAndWindowTitle:
         case OscActionCodes::SetWindowIcon:
         case OscActionCodes::SetWindowTitle:
-            fSuccess = _dispatch->SetWindowTitle({ pwchTitle, sCchTitleLength });
+            fSuccess = _dispatch->SetWindowTitle({ pwchTitle, cchTitle });
             TermTelemetry::Instance().Log(TermTelemetry::Codes::OSCWT);
             break;
         case OscActionCodes::SetColor:
@@ -732,6 +771,10 @@ bool OutputStateMachineEngine::ActionOscDispatch(const wchar_t /*wch*/,
             fSuccess = _dispatch->SetCursorColor(dwColor);
             TermTelemetry::Instance().Log(TermTelemetry::Codes::OSCRCC);
             break;
+        case OscActionCodes::Hyperlink:
+            fSuccess = uri.empty() ? _dispatch->EndHyperlink() : _dispatch->AddHyperlink(uri, id);
+            TermTelemetry::Instance().Log(TermTelemetry::Codes::OSCHL);
+            break;
         default:
             // If no functions to call, overall dispatch was a failure.
             fSuccess = false;
@@ -766,6 +809,7 @@ bool OutputStateMachineEngine::ActionSs3Dispatch(const wchar_t /*wch*/,
                                                  const unsigned short /*cParams*/)
 {
     // The output engine doesn't handle any SS3 sequences.
+    _FlushBatch();
     _ClearLastChar();
     return false;
 }
@@ -1166,10 +1210,10 @@ bool OutputStateMachineEngine::_VerifyDeviceAttributesParams(_In_reads_(cParams)
 // Return Value:
 // - True if there was a title to output. (a title with length=0 is still valid)
 _Success_(return)
-bool OutputStateMachineEngine::_GetOscTitle(_Inout_updates_(cchOscString) wchar_t* const pwchOscStringBuffer,
-                                            const unsigned short cchOscString,
-                                            _Outptr_result_buffer_(*pcchTitle) wchar_t** const ppwchTitle,
-                                            _Out_ unsigned short * pcchTitle) const
+bool OutputStateMachineEngine::_GetOscTitle(_In_reads_(cchOscString) const wchar_t* const pwchOscStringBuffer,
+                                            const size_t cchOscString,
+                                            _Outptr_result_buffer_(*pcchTitle) const wchar_t** const ppwchTitle,
+                                            _Out_ size_t* const pcchTitle) const
 {
     *ppwchTitle = pwchOscStringBuffer;
     *pcchTitle = cchOscString;
@@ -1301,6 +1345,126 @@ bool OutputStateMachineEngine::DispatchControlCharsFromEscape() const
     return false;
 }
 
+// Routine Description:
+// - Called by the state machine when it starts processing a string. Until the
+//      matching EndString, the common actions are collected into a batch,
+//      which is handed to the dispatch all at once.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void OutputStateMachineEngine::BeginString()
+{
+    _batchDepth++;
+}
+
+// Routine Description:
+// - Called by the state machine when it's done processing a string. Hands
+//      the batch of actions collected since BeginString to the dispatch.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void OutputStateMachineEngine::EndString()
+{
+    if (_batchDepth > 0 && --_batchDepth == 0)
+    {
+        _FlushBatch();
+    }
+}
+
+// Routine Description:
+// - Determines if actions should be batched up right now. When we have a tty
+//      to pass unhandled sequences through to, we need to know right away
+//      whether each one was handled, so nothing is batched.
+// Arguments:
+// - <none>
+// Return Value:
+// - true iff actions should be added to the batch.
+bool OutputStateMachineEngine::_IsBatching() const noexcept
+{
+    return _batchDepth > 0 && _pfnFlushToTerminal == nullptr;
+}
+
+// Routine Description:
+// - Hands any batched up actions to the dispatch. This must happen before any
+//      action that isn't batched, so the dispatch sees everything in order.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void OutputStateMachineEngine::_FlushBatch()
+{
+    if (!_batch.empty())
+    {
+        auto clearBatch = wil::scope_exit([&]() noexcept { _batch.clear(); });
+        _dispatch->ApplyBatch(_batch);
+    }
+}
+
+// Routine Description:
+// - Adds a control sequence to the batch, if it's one that can be batched.
+// Arguments:
+// - wch - Character to dispatch.
+// - uiDistance - The distance parameter of a cursor movement.
+// - uiLine, uiColumn - The position parameters of a CUP.
+// - eraseType - The parameter of an erase.
+// - rgOptions, cOptions - The graphics options of an SGR.
+// Return Value:
+// - true iff the sequence was added to the batch.
+bool OutputStateMachineEngine::_TryBatchCsiDispatch(const wchar_t wch,
+                                                    const unsigned int uiDistance,
+                                                    const unsigned int uiLine,
+                                                    const unsigned int uiColumn,
+                                                    const DispatchTypes::EraseType eraseType,
+                                                    _In_reads_(cOptions) const DispatchTypes::GraphicsOptions* const rgOptions,
+                                                    const size_t cOptions)
+{
+    if (!_IsBatching())
+    {
+        return false;
+    }
+
+    switch (wch)
+    {
+    case VTActionCodes::CUU_CursorUp:
+        _batch.Add(DispatchBatch::CommandType::CursorUp, uiDistance);
+        TermTelemetry::Instance().Log(TermTelemetry::Codes::CUU);
+        return true;
+    case VTActionCodes::CUD_CursorDown:
+        _batch.Add(DispatchBatch::CommandType::CursorDown, uiDistance);
+        TermTelemetry::Instance().Log(TermTelemetry::Codes::CUD);
+        return true;
+    case VTActionCodes::CUF_CursorForward:
+        _batch.Add(DispatchBatch::CommandType::CursorForward, uiDistance);
+        TermTelemetry::Instance().Log(TermTelemetry::Codes::CUF);
+        return true;
+    case VTActionCodes::CUB_CursorBackward:
+        _batch.Add(DispatchBatch::CommandType::CursorBackward, uiDistance);
+        TermTelemetry::Instance().Log(TermTelemetry::Codes::CUB);
+        return true;
+    case VTActionCodes::CUP_CursorPosition:
+    case VTActionCodes::HVP_HorizontalVerticalPosition:
+        _batch.AddCursorPosition(uiLine, uiColumn);
+        TermTelemetry::Instance().Log(TermTelemetry::Codes::CUP);
+        return true;
+    case VTActionCodes::ED_EraseDisplay:
+        _batch.Add(DispatchBatch::CommandType::EraseInDisplay, static_cast<unsigned int>(eraseType));
+        TermTelemetry::Instance().Log(TermTelemetry::Codes::ED);
+        return true;
+    case VTActionCodes::EL_EraseLine:
+        _batch.Add(DispatchBatch::CommandType::EraseInLine, static_cast<unsigned int>(eraseType));
+        TermTelemetry::Instance().Log(TermTelemetry::Codes::EL);
+        return true;
+    case VTActionCodes::SGR_SetGraphicsRendition:
+        _batch.AddSetGraphicsRendition(rgOptions, cOptions);
+        TermTelemetry::Instance().Log(TermTelemetry::Codes::SGR);
+        return true;
+    default:
+        return false;
+    }
+}
+
 // Routine Description:
 // - Converts a hex character to its equivalent integer value.
 // Arguments:
@@ -1578,6 +1742,47 @@ bool OutputStateMachineEngine::_GetOscSetCursorColor(_In_reads_(cchOscString) co
     return fSuccess;
 }
 
+// Routine Description:
+// - OSC 8 ; params ; URI ST
+//      params: a ':' separated list of key=value pairs. The only one that's
+//          defined is "id", which ties together the pieces of a link that's
+//          broken up, e.g. by wrapping or by a TUI drawing it in parts.
+//      URI: where the link goes. An empty one ends the link.
+// Arguments:
+// - oscString - the OSC string, after the "8;"
+// - uri - receives the link's URI, which is empty if this ends the link
+// - id - receives the link's id, which is empty if it wasn't given one
+// Return Value:
+// - True if the string was a link. Params other than "id" are ignored.
+bool OutputStateMachineEngine::s_GetOscHyperlink(const std::wstring_view oscString,
+                                                 std::wstring_view& uri,
+                                                 std::wstring_view& id) noexcept
+{
+    uri = {};
+    id = {};
+
+    const auto separator = oscString.find(L';');
+    if (separator == std::wstring_view::npos)
+    {
+        return false;
+    }
+
+    auto params = oscString.substr(0, separator);
+    while (!params.empty())
+    {
+        const auto end = std::min(params.find(L':'), params.size());
+        const auto param = params.substr(0, end);
+        if (param.size() > 3 && param.substr(0, 3) == L"id=")
+        {
+            id = param.substr(3);
+        }
+        params = params.substr(std::min(end + 1, params.size()));
+    }
+
+    uri = oscString.substr(separator + 1);
+    return true;
+}
+
 // Method Description:
 // - Retrieves the type of window manipulation operation from the parameter pool
 //      stored during Param actions.
@@ -1663,6 +1868,7 @@ bool OutputStateMachineEngine::_GetCursorStyle(_In_reads_(cParams) const unsigne
 void OutputStateMachineEngine::SetTerminalConnection(ITerminalOutputConnection* const pTtyConnection,
                                                      std::function<bool()> pfnFlushToTerminal)
 {
+    _FlushBatch();
     this->_pTtyConnection = pTtyConnection;
     this->_pfnFlushToTerminal = pfnFlushToTerminal;
 }
@@ -49,8 +49,8 @@ namespace Microsoft::Console::VirtualTerminal
 
         bool ActionOscDispatch(const wchar_t wch,
                                const unsigned short sOscParam,
-                               _Inout_updates_(cchOscString) wchar_t* const pwchOscStringBuffer,
-                               const unsigned short cchOscString) override;
+                               _In_reads_(cchOscString) const wchar_t* const pwchOscStringBuffer,
+                               const size_t cchOscString) override;
 
         bool ActionSs3Dispatch(const wchar_t wch,
                                _In_reads_(cParams) const unsigned short* const rgusParams,
@@ -59,6 +59,9 @@ namespace Microsoft::Console::VirtualTerminal
         bool FlushAtEndOfString() const override;
         bool DispatchControlCharsFromEscape() const override;
 
+        void BeginString() override;
+        void EndString() override;
+
         void SetTerminalConnection(Microsoft::Console::ITerminalOutputConnection* const pTtyConnection,
                                    std::function<bool()> pfnFlushToTerminal);
 
@@ -71,6 +74,19 @@ namespace Microsoft::Console::VirtualTerminal
         std::function<bool()> _pfnFlushToTerminal;
         wchar_t _lastPrintedChar;
 
+        DispatchBatch _batch;
+        size_t _batchDepth;
+
+        bool _IsBatching() const noexcept;
+        void _FlushBatch();
+        bool _TryBatchCsiDispatch(const wchar_t wch,
+                                  const unsigned int uiDistance,
+                                  const unsigned int uiLine,
+                                  const unsigned int uiColumn,
+                                  const DispatchTypes::EraseType eraseType,
+                                  _In_reads_(cOptions) const DispatchTypes::GraphicsOptions* const rgOptions,
+                                  const size_t cOptions);
+
         bool _IntermediateQuestionMarkDispatch(const wchar_t wchAction,
                                                _In_reads_(cParams) const unsigned short* const rgusParams,
                                                const unsigned short cParams);
@@ -132,6 +148,7 @@ namespace Microsoft::Console::VirtualTerminal
             SetWindowIcon = 1,
             SetWindowTitle = 2,
             SetColor = 4,
+            Hyperlink = 8,
             SetCursorColor = 12,
             ResetCursorColor = 112,
         };
@@ -210,10 +227,10 @@ namespace Microsoft::Console::VirtualTerminal
                                   _Out_ SHORT* const psBottomMargin) const;
 
         _Success_(return)
-        bool _GetOscTitle(_Inout_updates_(cchOscString) wchar_t* const pwchOscStringBuffer,
-                          const unsigned short cchOscString,
-                          _Outptr_result_buffer_(*pcchTitle) wchar_t** const ppwchTitle,
-                          _Out_ unsigned short * pcchTitle) const;
+        bool _GetOscTitle(_In_reads_(cchOscString) const wchar_t* const pwchOscStringBuffer,
+                          const size_t cchOscString,
+                          _Outptr_result_buffer_(*pcchTitle) const wchar_t** const ppwchTitle,
+                          _Out_ size_t* const pcchTitle) const;
 
         static const SHORT s_sDefaultTabDistance = 1;
         _Success_(return)
@@ -255,6 +272,10 @@ namespace Microsoft::Console::VirtualTerminal
                                    const size_t cchOscString,
                                    _Out_ DWORD* const pRgb) const;
 
+        static bool s_GetOscHyperlink(const std::wstring_view oscString,
+                                      std::wstring_view& uri,
+                                      std::wstring_view& id) noexcept;
+
         static const DispatchTypes::CursorStyle s_defaultCursorStyle = DispatchTypes::CursorStyle::BlinkingBlockDefault;
         _Success_(return)
         bool _GetCursorStyle(_In_reads_(cParams) const unsigned short* const rgusParams,
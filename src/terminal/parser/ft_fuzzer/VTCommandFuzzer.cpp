@@ -38,6 +38,10 @@ static std::string GenerateOscTitleToken();
 static std::string GenerateHardResetToken();
 static std::string GenerateSoftResetToken();
 static std::string GenerateOscColorTableToken();
+static std::string GenerateScrollMarginsToken();
+static std::string GenerateEditToken();
+static std::string GenerateRepeatToken();
+static std::string GenerateTabToken();
 
 const fuzz::_fuzz_type_entry<BYTE> g_repeatMap[] =
 {
@@ -60,7 +64,11 @@ const std::function<std::string()> g_tokenGenerators[] =
     GenerateOscTitleToken,
     GenerateHardResetToken,
     GenerateSoftResetToken,
-    GenerateOscColorTableToken
+    GenerateOscColorTableToken,
+    GenerateScrollMarginsToken,
+    GenerateEditToken,
+    GenerateRepeatToken,
+    GenerateTabToken
 };
 
 std::string GenerateTokenLowProbability()
@@ -356,6 +364,75 @@ std::string GenerateScrollToken()
     return GenerateFuzzedToken(FUZZ_MAP(map), tokens, ARRAYSIZE(tokens));
 }
 
+// Scroll margins, top and bottom. Valid values are within the viewport, but a
+// huge margin that gets clamped is as interesting as a valid one, since the
+// work that scrolling inside the margins does can depend on how big they are.
+std::string GenerateScrollMarginsToken()
+{
+    const LPSTR tokens[] = { "r" };
+    const _fuzz_type_entry<std::string> map[] =
+    {
+        { 40, [](std::string) { std::string s; AppendFormat(s, "%d;%d", CFuzzChance::GetRandom<BYTE>(), CFuzzChance::GetRandom<BYTE>()); return s; } },
+        { 20, [](std::string) { std::string s; AppendFormat(s, "%d;%d", CFuzzChance::GetRandom<USHORT>(), CFuzzChance::GetRandom<USHORT>()); return s; } },
+        { 10, [](std::string) { std::string s; AppendFormat(s, "%d", CFuzzChance::GetRandom<USHORT>()); return s; } },
+        { 10, [](std::string) { std::string s; AppendFormat(s, ";%d", CFuzzChance::GetRandom<USHORT>()); return s; } },
+        { 10, [](std::string) { std::string s; AppendFormat(s, "%08d;%08d", CFuzzChance::GetRandom<ULONG>(), CFuzzChance::GetRandom<ULONG>()); return s; } }
+        // 10% leave it blank, to reset the margins
+    };
+
+    return GenerateFuzzedToken(FUZZ_MAP(map), tokens, ARRAYSIZE(tokens));
+}
+
+// Editing sequences: insert and delete characters and lines, and erase
+// characters. Each of them takes a count, and a count a lot bigger than the
+// screen shouldn't cost more than one as big as the screen.
+std::string GenerateEditToken()
+{
+    const LPSTR tokens[] = { "@", "P", "L", "M", "X" };
+    const _fuzz_type_entry<std::string> map[] =
+    {
+        { 40, [](std::string) { std::string s; AppendFormat(s, "%d", CFuzzChance::GetRandom<BYTE>()); return s; } },
+        { 30, [](std::string) { std::string s; AppendFormat(s, "%d", CFuzzChance::GetRandom<USHORT>()); return s; } },
+        { 10, [](std::string) { std::string s; AppendFormat(s, "%08d", CFuzzChance::GetRandom<ULONG>()); return s; } }
+        // 20% leave it blank, for a count of one
+    };
+
+    return GenerateFuzzedToken(FUZZ_MAP(map), tokens, ARRAYSIZE(tokens));
+}
+
+// Repeat the last printed character. The count is only limited by how big a
+// parameter can be, so this is the easiest way to ask for a lot of work with
+// a few bytes.
+std::string GenerateRepeatToken()
+{
+    const LPSTR tokens[] = { "b" };
+    const _fuzz_type_entry<std::string> map[] =
+    {
+        { 40, [](std::string) { std::string s; AppendFormat(s, "%d", CFuzzChance::GetRandom<BYTE>()); return s; } },
+        { 40, [](std::string) { std::string s; AppendFormat(s, "%d", CFuzzChance::GetRandom<USHORT>()); return s; } },
+        { 10, [](std::string) { std::string s; AppendFormat(s, "%08d", CFuzzChance::GetRandom<ULONG>()); return s; } }
+        // 10% leave it blank, for a count of one
+    };
+
+    std::string s = GenerateTextToken();
+    s += GenerateFuzzedToken(FUZZ_MAP(map), tokens, ARRAYSIZE(tokens));
+    return s;
+}
+
+// Forward and back tabs, which take a count of tab stops to move over.
+std::string GenerateTabToken()
+{
+    const LPSTR tokens[] = { "I", "Z" };
+    const _fuzz_type_entry<std::string> map[] =
+    {
+        { 50, [](std::string) { std::string s; AppendFormat(s, "%d", CFuzzChance::GetRandom<BYTE>()); return s; } },
+        { 30, [](std::string) { std::string s; AppendFormat(s, "%d", CFuzzChance::GetRandom<USHORT>()); return s; } }
+        // 20% leave it blank, for a count of one
+    };
+
+    return GenerateFuzzedToken(FUZZ_MAP(map), tokens, ARRAYSIZE(tokens));
+}
+
 // Resize sequences, valid numeric values include 0-16384.
 std::string GenerateResizeToken()
 {
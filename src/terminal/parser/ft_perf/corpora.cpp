@@ -0,0 +1,234 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "corpora.hpp"
+
+using namespace Microsoft::Console::VirtualTerminal::Perf;
+
+// Each corpus is built up to about this many characters.
+static constexpr size_t s_cchCorpusTarget = 1024 * 1024;
+
+static const wchar_t* const s_sourceLines[] = {
+    L"// Routine Description:",
+    L"// - Processes a string of characters, one sequence at a time.",
+    L"void StateMachine::ProcessString(const wchar_t* const rgwch, const size_t cch)",
+    L"{",
+    L"    _pwchSequenceStart = rgwch;",
+    L"    for (size_t i = 0; i < cch; i++)",
+    L"    {",
+    L"        const wchar_t wch = rgwch[i];",
+    L"        if (_state == VTStates::Ground && !s_IsActionableFromGround(wch))",
+    L"        {",
+    L"            _pEngine->ActionPrintString(&rgwch[i], cch - i);",
+    L"        }",
+    L"    }",
+    L"}",
+    L"",
+};
+
+static const wchar_t* const s_fileNames[] = {
+    L"CMakeLists.txt",
+    L"README.md",
+    L"build",
+    L"src",
+    L"stateMachine.cpp",
+    L"stateMachine.hpp",
+    L"run.sh",
+    L"archive.tar.gz",
+    L"tools",
+    L"LICENSE",
+};
+
+static const wchar_t* const s_fileColors[] = {
+    L"0",
+    L"0",
+    L"01;34",
+    L"01;34",
+    L"0",
+    L"0",
+    L"01;32",
+    L"01;31",
+    L"01;34",
+    L"0",
+};
+
+static const wchar_t* const s_vimTokens[] = {
+    L"if",
+    L" (",
+    L"cch",
+    L" == ",
+    L"0",
+    L") ",
+    L"return",
+    L" ",
+    L"false",
+    L"; ",
+    L"// nothing to do",
+};
+
+// These are xterm-256 colors for keywords, punctuation, names and so on.
+static const unsigned int s_vimColors[] = { 130, 0, 0, 0, 125, 0, 130, 0, 125, 0, 34 };
+
+static void s_AppendNumber(std::wstring& text, const unsigned int value)
+{
+    text.append(std::to_wstring(value));
+}
+
+static void s_AppendCursorPosition(std::wstring& text, const unsigned int line, const unsigned int column)
+{
+    text.append(L"\x1b[");
+    s_AppendNumber(text, line);
+    text.push_back(L';');
+    s_AppendNumber(text, column);
+    text.push_back(L'H');
+}
+
+// Routine Description:
+// - Imitates `cat` of a source file: long runs of printable text and CRLFs.
+static Corpus s_BuildCatSource()
+{
+    Corpus corpus{ L"cat source", {} };
+    for (size_t i = 0; corpus.text.size() < s_cchCorpusTarget; i++)
+    {
+        corpus.text.append(s_sourceLines[i % ARRAYSIZE(s_sourceLines)]);
+        corpus.text.append(L"\r\n");
+    }
+    return corpus;
+}
+
+// Routine Description:
+// - Imitates `ls --color`: a short SGR around every name.
+static Corpus s_BuildLsColor()
+{
+    Corpus corpus{ L"ls --color", {} };
+    for (size_t i = 0; corpus.text.size() < s_cchCorpusTarget; i++)
+    {
+        const size_t entry = i % ARRAYSIZE(s_fileNames);
+        corpus.text.append(L"\x1b[0m\x1b[");
+        corpus.text.append(s_fileColors[entry]);
+        corpus.text.push_back(L'm');
+        corpus.text.append(s_fileNames[entry]);
+        corpus.text.append(L"\x1b[0m");
+        corpus.text.append((i % 6 == 5) ? L"\r\n" : L"  ");
+    }
+    return corpus;
+}
+
+// Routine Description:
+// - Imitates htop: full screen frames made of positioned, colored fields,
+//   meters drawn a few cells at a time and erased line ends.
+static Corpus s_BuildHtopFrames()
+{
+    Corpus corpus{ L"htop frames", {} };
+    for (unsigned int frame = 0; corpus.text.size() < s_cchCorpusTarget; frame++)
+    {
+        corpus.text.append(L"\x1b[?25l\x1b[H");
+        for (unsigned int cpu = 1; cpu <= 8; cpu++)
+        {
+            const unsigned int load = (frame * 7 + cpu * 13) % 40;
+            s_AppendCursorPosition(corpus.text, cpu, 3);
+            corpus.text.append(L"\x1b[36m");
+            s_AppendNumber(corpus.text, cpu);
+            corpus.text.append(L"\x1b[1m\x1b[39m[\x1b[32m");
+            corpus.text.append(load / 2, L'|');
+            corpus.text.append(L"\x1b[31m");
+            corpus.text.append(load - (load / 2), L'|');
+            corpus.text.append(L"\x1b[90m");
+            corpus.text.append(40 - load, L' ');
+            corpus.text.append(L"\x1b[39m");
+            s_AppendNumber(corpus.text, load * 2);
+            corpus.text.append(L".0%]\x1b[0m\x1b[K");
+        }
+        s_AppendCursorPosition(corpus.text, 10, 1);
+        corpus.text.append(L"\x1b[30;46m  PID USER      PRI  NI  VIRT   RES   SHR S CPU% MEM%   TIME+  Command\x1b[K\x1b[0m");
+        for (unsigned int process = 0; process < 30; process++)
+        {
+            s_AppendCursorPosition(corpus.text, 11 + process, 1);
+            corpus.text.append(process == frame % 30 ? L"\x1b[30;42m" : L"\x1b[0m");
+            s_AppendNumber(corpus.text, 1000 + process * 17);
+            corpus.text.append(L" \x1b[90mroot\x1b[39m       20   0  \x1b[36m1204M\x1b[39m  81M 9860 S  ");
+            s_AppendNumber(corpus.text, (frame + process) % 100);
+            corpus.text.append(L".0  1.2  0:01.23 \x1b[1m/usr/bin/process\x1b[0m\x1b[K");
+        }
+        corpus.text.append(L"\x1b[?25h");
+    }
+    return corpus;
+}
+
+// Routine Description:
+// - Imitates vim redrawing its window: a scroll region, lines that are
+//   positioned and erased one by one, syntax colors and a status line.
+static Corpus s_BuildVimRedraws()
+{
+    Corpus corpus{ L"vim redraws", {} };
+    while (corpus.text.size() < s_cchCorpusTarget)
+    {
+        corpus.text.append(L"\x1b[?25l\x1b[1;49r");
+        for (unsigned int line = 1; line <= 49; line++)
+        {
+            s_AppendCursorPosition(corpus.text, line, 1);
+            corpus.text.append(L"\x1b[K\x1b[38;5;130m");
+            s_AppendNumber(corpus.text, line);
+            corpus.text.append(L" \x1b[m    ");
+            for (size_t token = 0; token < ARRAYSIZE(s_vimTokens); token++)
+            {
+                if (s_vimColors[token] == 0)
+                {
+                    corpus.text.append(L"\x1b[m");
+                }
+                else
+                {
+                    corpus.text.append(L"\x1b[38;5;");
+                    s_AppendNumber(corpus.text, s_vimColors[token]);
+                    corpus.text.push_back(L'm');
+                }
+                corpus.text.append(s_vimTokens[token]);
+            }
+        }
+        corpus.text.append(L"\x1b[r");
+        s_AppendCursorPosition(corpus.text, 50, 1);
+        corpus.text.append(L"\x1b[7mstateMachine.cpp [+]                                   120,17         42%\x1b[m");
+        s_AppendCursorPosition(corpus.text, 12, 17);
+        corpus.text.append(L"\x1b[?25h");
+    }
+    return corpus;
+}
+
+// Routine Description:
+// - Imitates a truecolor gradient test: one 24-bit background SGR per cell.
+static Corpus s_BuildTruecolorGradient()
+{
+    Corpus corpus{ L"truecolor gradient", {} };
+    for (unsigned int row = 0; corpus.text.size() < s_cchCorpusTarget; row++)
+    {
+        for (unsigned int column = 0; column < 80; column++)
+        {
+            corpus.text.append(L"\x1b[48;2;");
+            s_AppendNumber(corpus.text, (column * 255) / 79);
+            corpus.text.push_back(L';');
+            s_AppendNumber(corpus.text, (row * 8) % 256);
+            corpus.text.push_back(L';');
+            s_AppendNumber(corpus.text, 255 - ((column * 255) / 79));
+            corpus.text.append(L"m ");
+        }
+        corpus.text.append(L"\x1b[0m\r\n");
+    }
+    return corpus;
+}
+
+// Routine Description:
+// - Builds every generated corpus.
+// Return Value:
+// - The corpora, in the order they should be reported.
+std::vector<Corpus> Microsoft::Console::VirtualTerminal::Perf::BuildCorpora()
+{
+    std::vector<Corpus> corpora;
+    corpora.push_back(s_BuildCatSource());
+    corpora.push_back(s_BuildLsColor());
+    corpora.push_back(s_BuildHtopFrames());
+    corpora.push_back(s_BuildVimRedraws());
+    corpora.push_back(s_BuildTruecolorGradient());
+    return corpora;
+}
@@ -0,0 +1,26 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*
+Module Name:
+- corpora.hpp
+
+Abstract:
+- Builds the VT streams that the parser benchmark replays.
+- Each one imitates the output of a common program, byte for byte in the shape
+    of its escape sequences, so that the results can be reproduced anywhere
+    without checking in recordings. Real recordings can be passed to the
+    benchmark on its command line as well.
+*/
+#pragma once
+
+namespace Microsoft::Console::VirtualTerminal::Perf
+{
+    struct Corpus
+    {
+        std::wstring name;
+        std::wstring text;
+    };
+
+    std::vector<Corpus> BuildCorpora();
+};
@@ -0,0 +1,220 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "corpora.hpp"
+#include "nullDispatch.hpp"
+#include "..\stateMachine.hpp"
+#include "..\OutputStateMachineEngine.hpp"
+
+using namespace Microsoft::Console::VirtualTerminal;
+using namespace Microsoft::Console::VirtualTerminal::Perf;
+
+// Every corpus is replayed until at least this much time has passed.
+static constexpr double s_secondsPerCorpus = 1.0;
+
+// All of the heap allocations made by this process go through these, so that
+//   the benchmark can tell how many allocations the parser makes.
+static std::atomic<size_t> s_cAllocations{ 0 };
+
+void* __cdecl operator new(const size_t cb)
+{
+    s_cAllocations++;
+    void* const pv = malloc(cb == 0 ? 1 : cb);
+    if (pv == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return pv;
+}
+
+void __cdecl operator delete(void* const pv) noexcept
+{
+    free(pv);
+}
+
+void __cdecl operator delete(void* const pv, const size_t /*cb*/) noexcept
+{
+    free(pv);
+}
+
+void PrintUsage()
+{
+    wprintf(L"Usage: conterm.parser.perf.exe [<recording> ...]\r\n");
+    wprintf(L"With no arguments, replays the built in corpora. Recordings are read as UTF-8.\r\n");
+}
+
+// Routine Description:
+// - Reads a recorded VT stream, such as one captured with `script`, from a file.
+// Arguments:
+// - pwszPath - The file to read.
+// - corpus - Receives the file's name and contents.
+// Return Value:
+// - S_OK or an appropriate failure.
+[[nodiscard]] HRESULT ReadRecording(const wchar_t* const pwszPath, Corpus& corpus)
+{
+    wil::unique_hfile file{ CreateFileW(pwszPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    RETURN_LAST_ERROR_IF(!file);
+
+    LARGE_INTEGER size;
+    RETURN_IF_WIN32_BOOL_FALSE(GetFileSizeEx(file.get(), &size));
+    RETURN_HR_IF(E_OUTOFMEMORY, size.QuadPart > INT_MAX);
+
+    std::string bytes(static_cast<size_t>(size.QuadPart), '\0');
+    DWORD cbRead = 0;
+    RETURN_IF_WIN32_BOOL_FALSE(ReadFile(file.get(), bytes.data(), static_cast<DWORD>(bytes.size()), &cbRead, nullptr));
+    bytes.resize(cbRead);
+
+    corpus.name = pwszPath;
+    corpus.text.clear();
+    if (!bytes.empty())
+    {
+        const int cch = MultiByteToWideChar(CP_UTF8, 0, bytes.data(), static_cast<int>(bytes.size()), nullptr, 0);
+        RETURN_LAST_ERROR_IF(cch == 0);
+        corpus.text.resize(cch);
+        RETURN_LAST_ERROR_IF(0 == MultiByteToWideChar(CP_UTF8, 0, bytes.data(), static_cast<int>(bytes.size()), corpus.text.data(), cch));
+    }
+    return S_OK;
+}
+
+std::string ToUtf8(const std::wstring& text)
+{
+    std::string utf8;
+    if (!text.empty())
+    {
+        const int cb = WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr);
+        THROW_LAST_ERROR_IF(cb == 0);
+        utf8.resize(cb);
+        THROW_LAST_ERROR_IF(0 == WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), utf8.data(), cb, nullptr, nullptr));
+    }
+    return utf8;
+}
+
+// Routine Description:
+// - Counts the sequences in a stream, taking every ESC or C1 CSI as the start of one.
+size_t CountSequences(const std::wstring& text) noexcept
+{
+    return std::count_if(text.cbegin(), text.cend(), [](const wchar_t wch) {
+        return wch == L'\x1b' || wch == L'\x9b';
+    });
+}
+
+struct Measurement
+{
+    double megabytesPerSecond;
+    size_t allocationsPerPass;
+};
+
+// Routine Description:
+// - Replays a stream through a state machine over and over, and measures how
+//   fast it went and how many allocations one pass made.
+// - The first pass is not counted, so that buffers that the parser grows once
+//   and then keeps don't show up as allocations.
+// Arguments:
+// - cbStream - The size of the stream in UTF-8, which is what throughput is reported in
+//      for both entry points, so that they can be compared.
+// - pass - Feeds the stream to the state machine once.
+// Return Value:
+// - The measurement.
+template<typename TPass>
+Measurement Measure(const size_t cbStream, TPass&& pass)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+
+    pass();
+
+    const size_t cAllocationsBefore = s_cAllocations;
+    pass();
+    const size_t cAllocations = s_cAllocations - cAllocationsBefore;
+
+    size_t cPasses = 0;
+    LARGE_INTEGER start;
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&start);
+    do
+    {
+        pass();
+        cPasses++;
+        QueryPerformanceCounter(&now);
+    } while (static_cast<double>(now.QuadPart - start.QuadPart) / frequency.QuadPart < s_secondsPerCorpus);
+
+    const double seconds = static_cast<double>(now.QuadPart - start.QuadPart) / frequency.QuadPart;
+    return { (static_cast<double>(cbStream) * cPasses) / (1024.0 * 1024.0) / seconds, cAllocations };
+}
+
+void RunCorpus(const Corpus& corpus)
+{
+    const std::string utf8 = ToUtf8(corpus.text);
+    const size_t cSequences = CountSequences(corpus.text);
+
+    StateMachine machine(new OutputStateMachineEngine(new NullDispatch));
+
+    const auto utf16 = Measure(utf8.size(), [&]() {
+        machine.ProcessString(corpus.text.data(), corpus.text.size());
+    });
+    const auto utf8Result = Measure(utf8.size(), [&]() {
+        machine.ProcessUtf8String(utf8.data(), utf8.size());
+    });
+
+    const auto allocationsPerSequence = [cSequences](const size_t cAllocations) {
+        return cSequences == 0 ? 0.0 : static_cast<double>(cAllocations) / cSequences;
+    };
+
+    wprintf(L"%-24s %10zu %10zu %10.1f %10.1f %10.3f %10.3f\r\n",
+            corpus.name.c_str(),
+            utf8.size(),
+            cSequences,
+            utf16.megabytesPerSecond,
+            utf8Result.megabytesPerSecond,
+            allocationsPerSequence(utf16.allocationsPerPass),
+            allocationsPerSequence(utf8Result.allocationsPerPass));
+}
+
+int __cdecl wmain(int argc, wchar_t* argv[])
+{
+    std::vector<Corpus> corpora;
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            Corpus corpus;
+            const HRESULT hr = ReadRecording(argv[i], corpus);
+            if (FAILED(hr))
+            {
+                wprintf(L"Couldn't read '%s': 0x%08x\r\n", argv[i], hr);
+                PrintUsage();
+                return hr;
+            }
+            corpora.push_back(std::move(corpus));
+        }
+    }
+    else
+    {
+        corpora = BuildCorpora();
+    }
+
+    wprintf(L"%-24s %10s %10s %10s %10s %10s %10s\r\n",
+            L"Corpus",
+            L"Bytes",
+            L"Sequences",
+            L"UTF16 MB/s",
+            L"UTF8 MB/s",
+            L"UTF16 a/s",
+            L"UTF8 a/s");
+
+    for (const auto& corpus : corpora)
+    {
+        RunCorpus(corpus);
+    }
+
+    wprintf(L"a/s is heap allocations per sequence, after the first pass.\r\n");
+#ifdef NO_PARSER_TRACING
+    wprintf(L"Parser tracing was compiled out of this build.\r\n");
+#else
+    wprintf(L"Parser tracing is compiled in, and %s.\r\n",
+            TraceLoggingProviderEnabled(g_hConsoleVirtTermParserEventTraceProvider, WINEVENT_LEVEL_VERBOSE, 0) ? L"a session is listening" : L"no session is listening");
+#endif
+    return 0;
+}
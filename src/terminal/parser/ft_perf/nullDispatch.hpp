@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*
+Module Name:
+- nullDispatch.hpp
+
+Abstract:
+- A dispatch that throws away everything the parser hands it, so that timing a
+    StateMachine measures the parser and not whatever is behind it.
+*/
+#pragma once
+
+#include "../../adapter/termDispatch.hpp"
+
+namespace Microsoft::Console::VirtualTerminal
+{
+    class NullDispatch;
+};
+
+class Microsoft::Console::VirtualTerminal::NullDispatch final : public TermDispatch
+{
+public:
+    void Print(const wchar_t /*wchPrintable*/) override {}
+    void PrintString(const wchar_t* const /*rgwch*/, const size_t /*cch*/) override {}
+    void Execute(const wchar_t /*wchControl*/) override {}
+
+    bool ApplyBatch(const DispatchBatch& batch) override
+    {
+        _cBatchedCommands += batch.size();
+        return true;
+    }
+
+    size_t BatchedCommandCount() const noexcept
+    {
+        return _cBatchedCommands;
+    }
+
+private:
+    size_t _cBatchedCommands = 0;
+};
@@ -0,0 +1,4 @@
+@echo off
+rem To see what the parser's tracing costs, run this once against a normal build
+rem and once against one built with /p:ParserTracing=false (NO_PARSER_TRACING=1 in razzle).
+%_NTTREE%\unittests\conterm.parser.perf.exe %1 %2 %3 %4 %5 %6
\ No newline at end of file
@@ -0,0 +1,3 @@
+mkdir %_NTTREE%\unittests\ft_fuzzcost
+CALL .\ft_fuzzer\run.bat %1 %_NTTREE%\unittests\ft_fuzzcost
+te %_NTTREE%\unittests\Microsoft.Console.Host.UnitTests.dll /name:VtCostTests::* /p:VtCostCorpus=%_NTTREE%\unittests\ft_fuzzcost /p:VtCostSaveTo=%_NTTREE%\unittests\ft_fuzzcost_slow
@@ -6,8 +6,14 @@
 #include "stateMachine.hpp"
 
 #include "ascii.hpp"
+#include "../../types/inc/Utf8Decoder.hpp"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 using namespace Microsoft::Console::VirtualTerminal;
+using Microsoft::Console::Types::Utf8Decoder;
 
 //Takes ownership of the pEngine.
 StateMachine::StateMachine(IStateMachineEngine* const pEngine) :
@@ -20,14 +26,15 @@ StateMachine::StateMachine(IStateMachineEngine* const pEngine) :
     _wchIntermediate(UNICODE_NULL),
     _pwchCurr(nullptr),
     _iParamAccumulatePos(0),
-    // pwchOscStringBuffer Initialized below
     _pwchSequenceStart(nullptr),
     // rgusParams Initialized below
-    _sOscNextChar(0),
     _sOscParam(0),
-    _currRunLength(0)
+    _pwchOscString(nullptr),
+    _cchOscString(0),
+    _oscStringBuffered(false),
+    _currRunLength(0),
+    _processingIndividually(false)
 {
-    ZeroMemory(_pwchOscStringBuffer, sizeof(_pwchOscStringBuffer));
     ZeroMemory(_rgusParams, sizeof(_rgusParams));
     _ActionClear();
 }
@@ -54,6 +61,56 @@ bool StateMachine::s_IsActionableFromGround(const wchar_t wch)
     return (wch <= AsciiChars::US) || s_IsC1Csi(wch) || s_IsDelete(wch);
 }
 
+// Routine Description:
+// - Finds the first character in a string that s_IsActionableFromGround, which is
+//     where a run of printable characters ends.
+//   Where SSE2 is available, this checks 8 characters at a time.
+// Arguments:
+// - pwch - The characters to scan
+// - cch - Count of characters to scan
+// Return Value:
+// - The index of the first actionable character, or cch if they're all printable.
+size_t StateMachine::s_FindActionableFromGround(const wchar_t* const pwch, const size_t cch) noexcept
+{
+    size_t i = 0;
+
+#if defined(_M_IX86) || defined(_M_X64)
+    // C0s are everything up to US. Subtracting US with unsigned saturation
+    //   leaves 0 for exactly those characters.
+    const __m128i c0Max = _mm_set1_epi16(static_cast<short>(AsciiChars::US));
+    const __m128i del = _mm_set1_epi16(static_cast<short>(AsciiChars::DEL));
+    const __m128i c1Csi = _mm_set1_epi16(static_cast<short>(L'\x9b'));
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 8 <= cch; i += 8)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pwch + i));
+        const __m128i isC0 = _mm_cmpeq_epi16(_mm_subs_epu16(chars, c0Max), zero);
+        const __m128i isDel = _mm_cmpeq_epi16(chars, del);
+        const __m128i isC1Csi = _mm_cmpeq_epi16(chars, c1Csi);
+
+        // Each matching character sets both bytes of its lane in the mask.
+        const auto mask = static_cast<unsigned long>(_mm_movemask_epi8(_mm_or_si128(isC0, _mm_or_si128(isDel, isC1Csi))));
+        if (mask != 0)
+        {
+            unsigned long bit = 0;
+            _BitScanForward(&bit, mask);
+            return i + (bit / 2);
+        }
+    }
+#endif
+
+    // Check whatever is left (or everything, without SSE2) one at a time.
+    for (; i < cch; i++)
+    {
+        if (s_IsActionableFromGround(pwch[i]))
+        {
+            return i;
+        }
+    }
+    return cch;
+}
+
 // Routine Description:
 // - Determines if a character belongs to the C0 escape range.
 //   This is character sequences less than a space character (null, backspace, new line, etc.)
@@ -62,7 +119,7 @@ bool StateMachine::s_IsActionableFromGround(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsC0Code(const wchar_t wch)
+constexpr bool StateMachine::s_IsC0Code(const wchar_t wch) noexcept
 {
     return (wch >= AsciiChars::NUL && wch <= AsciiChars::ETB) ||
            wch == AsciiChars::EM ||
@@ -88,7 +145,7 @@ bool StateMachine::s_IsC0Code(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsC1Csi(const wchar_t wch)
+constexpr bool StateMachine::s_IsC1Csi(const wchar_t wch) noexcept
 {
     return wch == L'\x9b';
 }
@@ -102,7 +159,7 @@ bool StateMachine::s_IsC1Csi(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsIntermediate(const wchar_t wch)
+constexpr bool StateMachine::s_IsIntermediate(const wchar_t wch) noexcept
 {
     return wch >= L' ' && wch <= L'/'; // 0x20 - 0x2F
 }
@@ -113,7 +170,7 @@ bool StateMachine::s_IsIntermediate(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsDelete(const wchar_t wch)
+constexpr bool StateMachine::s_IsDelete(const wchar_t wch) noexcept
 {
     return wch == AsciiChars::DEL;
 }
@@ -125,7 +182,7 @@ bool StateMachine::s_IsDelete(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsEscape(const wchar_t wch)
+constexpr bool StateMachine::s_IsEscape(const wchar_t wch) noexcept
 {
     return wch == AsciiChars::ESC;
 }
@@ -137,7 +194,7 @@ bool StateMachine::s_IsEscape(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsCsiIndicator(const wchar_t wch)
+constexpr bool StateMachine::s_IsCsiIndicator(const wchar_t wch) noexcept
 {
     return wch == L'['; // 0x5B
 }
@@ -150,7 +207,7 @@ bool StateMachine::s_IsCsiIndicator(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsCsiDelimiter(const wchar_t wch)
+constexpr bool StateMachine::s_IsCsiDelimiter(const wchar_t wch) noexcept
 {
     return wch == L';'; // 0x3B
 }
@@ -162,7 +219,7 @@ bool StateMachine::s_IsCsiDelimiter(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsCsiParamValue(const wchar_t wch)
+constexpr bool StateMachine::s_IsCsiParamValue(const wchar_t wch) noexcept
 {
     return wch >= L'0' && wch <= L'9'; // 0x30 - 0x39
 }
@@ -174,7 +231,7 @@ bool StateMachine::s_IsCsiParamValue(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsCsiPrivateMarker(const wchar_t wch)
+constexpr bool StateMachine::s_IsCsiPrivateMarker(const wchar_t wch) noexcept
 {
     return wch == L'<' || wch == L'=' || wch == L'>' || wch == L'?'; // 0x3C - 0x3F
 }
@@ -185,7 +242,7 @@ bool StateMachine::s_IsCsiPrivateMarker(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsCsiInvalid(const wchar_t wch)
+constexpr bool StateMachine::s_IsCsiInvalid(const wchar_t wch) noexcept
 {
     return wch == L':'; // 0x3A
 }
@@ -199,7 +256,7 @@ bool StateMachine::s_IsCsiInvalid(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsSs3Indicator(const wchar_t wch)
+constexpr bool StateMachine::s_IsSs3Indicator(const wchar_t wch) noexcept
 {
     return wch == L'O'; // 0x4F
 }
@@ -211,61 +268,11 @@ bool StateMachine::s_IsSs3Indicator(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsOscIndicator(const wchar_t wch)
+constexpr bool StateMachine::s_IsOscIndicator(const wchar_t wch) noexcept
 {
     return wch == L']'; // 0x5D
 }
 
-// Routine Description:
-// - Determines if a character is a delimiter between two parameters in a "operating system control sequence"
-//   This occurs in the middle of a control sequence after escape and OscIndicator have been recognized,
-//   after the paramater indicating which OSC action to take.
-// Arguments:
-// - wch - Character to check.
-// Return Value:
-// - True if it is. False if it isn't.
-bool StateMachine::s_IsOscDelimiter(const wchar_t wch)
-{
-    return wch == L';'; // 0x3B
-}
-
-// Routine Description:
-// - Determines if a character is a valid parameter value for an OSC String,
-//     that is, the indicator of which OSC action to take.
-//   Parameters must be numerical digits.
-// Arguments:
-// - wch - Character to check.
-// Return Value:
-// - True if it is. False if it isn't.
-bool StateMachine::s_IsOscParamValue(const wchar_t wch)
-{
-    return s_IsNumber(wch); // 0x30 - 0x39
-}
-
-// Routine Description:
-// - Determines if a character should be initiate the end of an OSC sequence.
-// Arguments:
-// - wch - Character to check.
-// Return Value:
-// - True if it is. False if it isn't.
-bool StateMachine::s_IsOscTerminationInitiator(const wchar_t wch)
-{
-    return wch == AsciiChars::ESC;
-}
-
-// Routine Description:
-// - Determines if a character should be ignored in a operating system control sequence
-// Arguments:
-// - wch - Character to check.
-// Return Value:
-// - True if it is. False if it isn't.
-bool StateMachine::s_IsOscInvalid(const wchar_t wch)
-{
-    return wch <= L'\x17' ||
-           wch == L'\x19' ||
-           (wch >= L'\x1c' && wch <= L'\x1f') ;
-}
-
 // Routine Description:
 // - Determines if a character is "operating system control string" termination indicator.
 //   This signals the end of an OSC string collection.
@@ -273,22 +280,11 @@ bool StateMachine::s_IsOscInvalid(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsOscTerminator(const wchar_t wch)
+constexpr bool StateMachine::s_IsOscTerminator(const wchar_t wch) noexcept
 {
     return wch == L'\x7' || wch == L'\x9C'; // Bell character or C1 terminator
 }
 
-// Routine Description:
-// - Determines if a character is a valid number character, 0-9.
-// Arguments:
-// - wch - Character to check.
-// Return Value:
-// - True if it is. False if it isn't.
-bool StateMachine::s_IsNumber(const wchar_t wch)
-{
-    return wch >= L'0' && wch <= L'9'; // 0x30 - 0x39
-}
-
 // Routine Description:
 // - Triggers the Execute action to indicate that the listener should immediately respond to a C0 control character.
 // Arguments:
@@ -493,7 +489,10 @@ void StateMachine::_ActionClear()
     _pusActiveParam = _rgusParams; // set pointer back to beginning of array
 
     _sOscParam = 0;
-    _sOscNextChar = 0;
+    _pwchOscString = nullptr;
+    _cchOscString = 0;
+    _oscString.clear();
+    _oscStringBuffered = false;
 
     _pEngine->ActionClear();
 
@@ -548,22 +547,61 @@ void StateMachine::_ActionOscParam(const wchar_t wch)
 }
 
 // Routine Description:
-// - Stores this character as part of the OSC string
+// - Stores this character as part of the OSC string.
+//   If the character comes right after the rest of the OSC string in the string
+//      being processed, the view of the OSC string just gets longer. Otherwise
+//      the OSC string is copied, and the character is added to the copy.
 // Arguments:
 // - wch - Character to dispatch.
+// - pwchInString - Where wch is in the string being processed, or nullptr if
+//      it isn't part of one.
 // Return Value:
 // - <none>
-void StateMachine::_ActionOscPut(const wchar_t wch)
+void StateMachine::_ActionOscPut(const wchar_t wch, const wchar_t* const pwchInString)
 {
     _trace.TraceOnAction(L"OscPut");
 
     // if we're past the end, this param is just ignored.
-    // need to leave one char for \0 at end
-    if (_sOscNextChar < s_cOscStringMaxLength - 1)
+    if ((_oscStringBuffered ? _oscString.size() : _cchOscString) >= s_cchOscStringMax)
+    {
+        return;
+    }
+
+    if (!_oscStringBuffered &&
+        pwchInString != nullptr &&
+        (_cchOscString == 0 || pwchInString == _pwchOscString + _cchOscString))
+    {
+        if (_cchOscString == 0)
+        {
+            _pwchOscString = pwchInString;
+        }
+        _cchOscString++;
+    }
+    else
+    {
+        _BufferOscString();
+        _oscString.push_back(wch);
+    }
+}
+
+// Routine Description:
+// - Copies the view of the OSC string, if there is one, into _oscString. This
+//      needs to happen before the string that the view points into goes away.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void StateMachine::_BufferOscString()
+{
+    if (!_oscStringBuffered)
     {
-        _pwchOscStringBuffer[_sOscNextChar] = wch;
-        _sOscNextChar++;
-        //we'll place the null at the end of the string when we send the actual action.
+        if (_cchOscString > 0)
+        {
+            _oscString.assign(_pwchOscString, _cchOscString);
+        }
+        _pwchOscString = nullptr;
+        _cchOscString = 0;
+        _oscStringBuffered = true;
     }
 }
 
@@ -578,7 +616,11 @@ void StateMachine::_ActionOscDispatch(const wchar_t wch)
 {
     _trace.TraceOnAction(L"OscDispatch");
 
-    bool fSuccess = _pEngine->ActionOscDispatch(wch, _sOscParam, _pwchOscStringBuffer, _sOscNextChar);
+    // An empty OSC string is still a valid one, so only a view that has
+    //   characters in it is handed out. _oscString always has a buffer.
+    bool fSuccess = _cchOscString > 0 ?
+                        _pEngine->ActionOscDispatch(wch, _sOscParam, _pwchOscString, _cchOscString) :
+                        _pEngine->ActionOscDispatch(wch, _sOscParam, _oscString.data(), _oscString.size());
 
     // Trace the result.
     _trace.DispatchSequenceTrace(fSuccess);
@@ -790,511 +832,539 @@ void StateMachine::_EnterSs3Param()
 }
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the Ground state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Handle a C1 Control Sequence Introducer
-//   3. Print all other characters
+// - Sorts a character into the class that decides its transition in every state.
+//   Characters past C1 never have any special meaning, so they're all CharClass::Other.
 // Arguments:
-// - wch - Character that triggered the event
+// - wch - Character to classify.
 // Return Value:
-// - <none>
-void StateMachine::_EventGround(const wchar_t wch)
+// - The class of the character.
+constexpr StateMachine::CharClass StateMachine::s_ClassifyCharacter(const wchar_t wch) noexcept
 {
-    _trace.TraceOnEvent(L"Ground");
-    if (s_IsC0Code(wch) || s_IsDelete(wch))
+    if (wch == AsciiChars::CAN || wch == AsciiChars::SUB)
     {
-        _ActionExecute(wch);
+        return CharClass::CancelOrSubstitute;
     }
-    else if (s_IsC1Csi(wch))
+    else if (s_IsEscape(wch))
     {
-        _EnterCsiEntry();
+        return CharClass::Escape;
     }
-    else
+    else if (wch == AsciiChars::BEL)
     {
-        _ActionPrint(wch);
+        return CharClass::Bell;
     }
-}
-
-// Routine Description:
-// - Processes a character event into an Action that occurs while in the Escape state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Enter Control Sequence state
-//   5. Dispatch an Escape action.
-// Arguments:
-// - wch - Character that triggered the event
-// Return Value:
-// - <none>
-void StateMachine::_EventEscape(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"Escape");
-    if (s_IsC0Code(wch))
+    else if (s_IsC0Code(wch))
     {
-        if (_pEngine->DispatchControlCharsFromEscape())
-        {
-            _ActionExecuteFromEscape(wch);
-            _EnterGround();
-        }
-        else
-        {
-            _ActionExecute(wch);
-        }
+        return CharClass::C0;
     }
-    else if (s_IsDelete(wch))
+    else if (s_IsIntermediate(wch))
     {
-        _ActionIgnore();
+        return CharClass::Intermediate;
     }
-    else if (s_IsIntermediate(wch))
+    else if (s_IsCsiParamValue(wch))
     {
-        _ActionCollect(wch);
-        _EnterEscapeIntermediate();
+        return CharClass::Digit;
     }
-    else if (s_IsCsiIndicator(wch))
+    else if (s_IsCsiInvalid(wch))
     {
-        _EnterCsiEntry();
+        return CharClass::Colon;
     }
-    else if (s_IsOscIndicator(wch))
+    else if (s_IsCsiDelimiter(wch))
     {
-        _EnterOscParam();
+        return CharClass::Semicolon;
     }
-    else if (s_IsSs3Indicator(wch))
+    else if (s_IsCsiPrivateMarker(wch))
     {
-        _EnterSs3Entry();
+        return CharClass::PrivateMarker;
     }
-    else
+    else if (s_IsCsiIndicator(wch))
     {
-        _ActionEscDispatch(wch);
-        _EnterGround();
+        return CharClass::CsiIndicator;
     }
-}
-
-// Routine Description:
-// - Processes a character event into an Action that occurs while in the EscapeIntermediate state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Dispatch an Escape action.
-// Arguments:
-// - wch - Character that triggered the event
-// Return Value:
-// - <none>
-void StateMachine::_EventEscapeIntermediate(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"EscapeIntermediate");
-    if (s_IsC0Code(wch))
+    else if (s_IsOscIndicator(wch))
     {
-        _ActionExecute(wch);
+        return CharClass::OscIndicator;
     }
-    else if (s_IsIntermediate(wch))
+    else if (s_IsSs3Indicator(wch))
     {
-        _ActionCollect(wch);
+        return CharClass::Ss3Indicator;
     }
     else if (s_IsDelete(wch))
     {
-        _ActionIgnore();
+        return CharClass::Delete;
     }
-    else
+    else if (s_IsC1Csi(wch))
     {
-        _ActionEscDispatch(wch);
-        _EnterGround();
+        return CharClass::C1Csi;
+    }
+    else if (s_IsOscTerminator(wch))
+    {
+        return CharClass::C1StringTerminator;
     }
+    return CharClass::Other;
 }
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the CsiEntry state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   5. Store parameter data
-//   6. Collect Control Sequence Private markers
-//   7. Dispatch a control sequence with parameters for action
+// - Builds the lookup table of character classes for 0x00-0x9F.
 // Arguments:
-// - wch - Character that triggered the event
-// Return Value:
 // - <none>
-void StateMachine::_EventCsiEntry(const wchar_t wch)
+// Return Value:
+// - A table indexed by character.
+constexpr StateMachine::CharClassTable StateMachine::s_BuildCharClassTable() noexcept
 {
-    _trace.TraceOnEvent(L"CsiEntry");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsIntermediate(wch))
-    {
-        _ActionCollect(wch);
-        _EnterCsiIntermediate();
-    }
-    else if (s_IsCsiInvalid(wch))
-    {
-        _EnterCsiIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
-    {
-        _ActionParam(wch);
-        _EnterCsiParam();
-    }
-    else if (s_IsCsiPrivateMarker(wch))
-    {
-        _ActionCollect(wch);
-        _EnterCsiParam();
-    }
-    else
+    CharClassTable table{};
+    for (size_t i = 0; i < table.size(); i++)
     {
-        _ActionCsiDispatch(wch);
-        _EnterGround();
+        table[i] = s_ClassifyCharacter(static_cast<wchar_t>(i));
     }
+    return table;
 }
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the CsiIntermediate state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   5. Dispatch a control sequence with parameters for action
+// - Decides what a character of the given class does in the given state.
+//   This is where the rules of the state machine live: any one character
+//      performs (at most) one action, and then optionally enters a new state.
 // Arguments:
-// - wch - Character that triggered the event
+// - state - The state the machine is in when the character arrives.
+// - charClass - The class of the character.
 // Return Value:
-// - <none>
-void StateMachine::_EventCsiIntermediate(const wchar_t wch)
+// - The action to perform and the state to enter afterwards.
+constexpr StateMachine::Transition StateMachine::s_ComputeTransition(const VTStates state, const CharClass charClass) noexcept
 {
-    _trace.TraceOnEvent(L"CsiIntermediate");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsIntermediate(wch))
-    {
-        _ActionCollect(wch);
-    }
-    else if (s_IsDelete(wch))
+    // Process "from anywhere" events first.
+    if (charClass == CharClass::CancelOrSubstitute)
     {
-        _ActionIgnore();
+        return Transition::To(Action::Execute, VTStates::Ground);
     }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiInvalid(wch) || s_IsCsiDelimiter(wch) || s_IsCsiPrivateMarker(wch))
+    else if (charClass == CharClass::Escape && state != VTStates::OscString)
     {
-        _EnterCsiIgnore();
+        // Don't go to escape from the OSC string state - ESC can be used to
+        //      terminate OSC strings.
+        return Transition::To(Action::None, VTStates::Escape);
     }
-    else
+
+    // C0 control characters are executed in all of the escape and control sequence states.
+    const bool isC0 = charClass == CharClass::C0 || charClass == CharClass::Bell;
+
+    switch (state)
     {
-        _ActionCsiDispatch(wch);
-        _EnterGround();
+    case VTStates::Ground:
+        // 1. Execute C0 control characters
+        // 2. Handle a C1 Control Sequence Introducer
+        // 3. Print all other characters
+        if (isC0 || charClass == CharClass::Delete)
+        {
+            return Transition::Stay(Action::Execute);
+        }
+        else if (charClass == CharClass::C1Csi)
+        {
+            return Transition::To(Action::None, VTStates::CsiEntry);
+        }
+        return Transition::Stay(Action::Print);
+
+    case VTStates::Escape:
+        // 1. Execute C0 control characters (possibly returning to ground, see Action::ExecuteFromEscape)
+        // 2. Ignore Delete characters
+        // 3. Collect Intermediate characters
+        // 4. Enter Control Sequence, OSC or SS3 state
+        // 5. Dispatch an Escape action.
+        switch (charClass)
+        {
+        case CharClass::C0:
+        case CharClass::Bell:
+            return Transition::Stay(Action::ExecuteFromEscape);
+        case CharClass::Delete:
+            return Transition::Stay(Action::Ignore);
+        case CharClass::Intermediate:
+            return Transition::To(Action::Collect, VTStates::EscapeIntermediate);
+        case CharClass::CsiIndicator:
+            return Transition::To(Action::None, VTStates::CsiEntry);
+        case CharClass::OscIndicator:
+            return Transition::To(Action::None, VTStates::OscParam);
+        case CharClass::Ss3Indicator:
+            return Transition::To(Action::None, VTStates::Ss3Entry);
+        default:
+            return Transition::To(Action::EscDispatch, VTStates::Ground);
+        }
+
+    case VTStates::EscapeIntermediate:
+        // 1. Execute C0 control characters
+        // 2. Ignore Delete characters
+        // 3. Collect Intermediate characters
+        // 4. Dispatch an Escape action.
+        if (isC0)
+        {
+            return Transition::Stay(Action::Execute);
+        }
+        else if (charClass == CharClass::Intermediate)
+        {
+            return Transition::Stay(Action::Collect);
+        }
+        else if (charClass == CharClass::Delete)
+        {
+            return Transition::Stay(Action::Ignore);
+        }
+        return Transition::To(Action::EscDispatch, VTStates::Ground);
+
+    case VTStates::CsiEntry:
+        // 1. Execute C0 control characters
+        // 2. Ignore Delete characters
+        // 3. Collect Intermediate characters
+        // 4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
+        // 5. Store parameter data
+        // 6. Collect Control Sequence Private markers
+        // 7. Dispatch a control sequence with parameters for action
+        switch (charClass)
+        {
+        case CharClass::C0:
+        case CharClass::Bell:
+            return Transition::Stay(Action::Execute);
+        case CharClass::Delete:
+            return Transition::Stay(Action::Ignore);
+        case CharClass::Intermediate:
+            return Transition::To(Action::Collect, VTStates::CsiIntermediate);
+        case CharClass::Colon:
+            return Transition::To(Action::None, VTStates::CsiIgnore);
+        case CharClass::Digit:
+        case CharClass::Semicolon:
+            return Transition::To(Action::Param, VTStates::CsiParam);
+        case CharClass::PrivateMarker:
+            return Transition::To(Action::Collect, VTStates::CsiParam);
+        default:
+            return Transition::To(Action::CsiDispatch, VTStates::Ground);
+        }
+
+    case VTStates::CsiIntermediate:
+        // 1. Execute C0 control characters
+        // 2. Ignore Delete characters
+        // 3. Collect Intermediate characters
+        // 4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
+        // 5. Dispatch a control sequence with parameters for action
+        switch (charClass)
+        {
+        case CharClass::C0:
+        case CharClass::Bell:
+            return Transition::Stay(Action::Execute);
+        case CharClass::Intermediate:
+            return Transition::Stay(Action::Collect);
+        case CharClass::Delete:
+            return Transition::Stay(Action::Ignore);
+        case CharClass::Digit:
+        case CharClass::Colon:
+        case CharClass::Semicolon:
+        case CharClass::PrivateMarker:
+            return Transition::To(Action::None, VTStates::CsiIgnore);
+        default:
+            return Transition::To(Action::CsiDispatch, VTStates::Ground);
+        }
+
+    case VTStates::CsiIgnore:
+        // 1. Execute C0 control characters
+        // 2. Ignore Delete, Intermediate and parameter characters
+        // 3. Return to Ground
+        switch (charClass)
+        {
+        case CharClass::C0:
+        case CharClass::Bell:
+            return Transition::Stay(Action::Execute);
+        case CharClass::Delete:
+        case CharClass::Intermediate:
+        case CharClass::Digit:
+        case CharClass::Colon:
+        case CharClass::Semicolon:
+        case CharClass::PrivateMarker:
+            return Transition::Stay(Action::Ignore);
+        default:
+            return Transition::To(Action::None, VTStates::Ground);
+        }
+
+    case VTStates::CsiParam:
+        // 1. Execute C0 control characters
+        // 2. Ignore Delete characters
+        // 3. Collect Intermediate characters
+        // 4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
+        // 5. Store parameter data
+        // 6. Dispatch a control sequence with parameters for action
+        switch (charClass)
+        {
+        case CharClass::C0:
+        case CharClass::Bell:
+            return Transition::Stay(Action::Execute);
+        case CharClass::Delete:
+            return Transition::Stay(Action::Ignore);
+        case CharClass::Digit:
+        case CharClass::Semicolon:
+            return Transition::Stay(Action::Param);
+        case CharClass::Intermediate:
+            return Transition::To(Action::Collect, VTStates::CsiIntermediate);
+        case CharClass::Colon:
+        case CharClass::PrivateMarker:
+            return Transition::To(Action::None, VTStates::CsiIgnore);
+        default:
+            return Transition::To(Action::CsiDispatch, VTStates::Ground);
+        }
+
+    case VTStates::OscParam:
+        // 1. Return to ground on an OSC terminator (BEL or a C1 ST)
+        // 2. Collect numeric values into an Osc Param
+        // 3. Move to the OscString state on a delimiter
+        // 4. Ignore everything else.
+        switch (charClass)
+        {
+        case CharClass::Bell:
+        case CharClass::C1StringTerminator:
+            return Transition::To(Action::None, VTStates::Ground);
+        case CharClass::Digit:
+            return Transition::Stay(Action::OscParam);
+        case CharClass::Semicolon:
+            return Transition::To(Action::None, VTStates::OscString);
+        default:
+            return Transition::Stay(Action::Ignore);
+        }
+
+    case VTStates::OscString:
+        // 1. Trigger the OSC action associated with the param on an OscTerminator
+        // 2. If we see a ESC, enter the OscTermination state. We'll wait for one
+        //    more character before we dispatch the string.
+        // 3. Ignore the other C0 characters.
+        // 4. Collect everything else into the OscString
+        switch (charClass)
+        {
+        case CharClass::Bell:
+        case CharClass::C1StringTerminator:
+            return Transition::To(Action::OscDispatch, VTStates::Ground);
+        case CharClass::Escape:
+            return Transition::To(Action::None, VTStates::OscTermination);
+        case CharClass::C0:
+            return Transition::Stay(Action::Ignore);
+        default:
+            return Transition::Stay(Action::OscPut);
+        }
+
+    case VTStates::OscTermination:
+        // 1. Trigger the OSC action associated with the param on any character
+        return Transition::To(Action::OscDispatch, VTStates::Ground);
+
+    case VTStates::Ss3Entry:
+        // 1. Execute C0 control characters
+        // 2. Ignore Delete characters
+        // 3. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
+        // 4. Store parameter data
+        // 5. Dispatch a control sequence with parameters for action
+        //  SS3 sequences are structurally the same as CSI sequences, just with a
+        //      different initiation. It's safe for us to go into the CSI ignore
+        //      state, because both SS3 and CSI sequences ignore characters the same way.
+        switch (charClass)
+        {
+        case CharClass::C0:
+        case CharClass::Bell:
+            return Transition::Stay(Action::Execute);
+        case CharClass::Delete:
+            return Transition::Stay(Action::Ignore);
+        case CharClass::Colon:
+            return Transition::To(Action::None, VTStates::CsiIgnore);
+        case CharClass::Digit:
+        case CharClass::Semicolon:
+            return Transition::To(Action::Param, VTStates::Ss3Param);
+        default:
+            return Transition::To(Action::Ss3Dispatch, VTStates::Ground);
+        }
+
+    case VTStates::Ss3Param:
+        // 1. Execute C0 control characters
+        // 2. Ignore Delete characters
+        // 3. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
+        // 4. Store parameter data
+        // 5. Dispatch a control sequence with parameters for action
+        switch (charClass)
+        {
+        case CharClass::C0:
+        case CharClass::Bell:
+            return Transition::Stay(Action::Execute);
+        case CharClass::Delete:
+            return Transition::Stay(Action::Ignore);
+        case CharClass::Digit:
+        case CharClass::Semicolon:
+            return Transition::Stay(Action::Param);
+        case CharClass::Colon:
+        case CharClass::PrivateMarker:
+            return Transition::To(Action::None, VTStates::CsiIgnore);
+        default:
+            return Transition::To(Action::Ss3Dispatch, VTStates::Ground);
+        }
+
+    default:
+        return Transition::Stay(Action::None);
     }
 }
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the CsiIgnore state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   5. Return to Ground
+// - Builds the transition table for every state and character class.
 // Arguments:
-// - wch - Character that triggered the event
-// Return Value:
 // - <none>
-void StateMachine::_EventCsiIgnore(const wchar_t wch)
+// Return Value:
+// - A table indexed by state, then character class.
+constexpr StateMachine::TransitionTable StateMachine::s_BuildTransitionTable() noexcept
 {
-    _trace.TraceOnEvent(L"CsiIgnore");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsIntermediate(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiInvalid(wch) || s_IsCsiDelimiter(wch) || s_IsCsiPrivateMarker(wch))
+    TransitionTable table{};
+    for (size_t state = 0; state < table.size(); state++)
     {
-        _ActionIgnore();
+        for (size_t charClass = 0; charClass < table[state].size(); charClass++)
+        {
+            table[state][charClass] = s_ComputeTransition(static_cast<VTStates>(state), static_cast<CharClass>(charClass));
+        }
     }
-    else
-    {
-        _EnterGround();
+    return table;
+}
+
+constexpr StateMachine::CharClassTable StateMachine::s_charClasses = StateMachine::s_BuildCharClassTable();
+constexpr StateMachine::TransitionTable StateMachine::s_transitions = StateMachine::s_BuildTransitionTable();
+
+// The names of the states, for tracing the state a character event occurs in.
+static constexpr PCWSTR s_stateNames[] = {
+    L"Ground",
+    L"Escape",
+    L"EscapeIntermediate",
+    L"CsiEntry",
+    L"CsiIntermediate",
+    L"CsiIgnore",
+    L"CsiParam",
+    L"OscParam",
+    L"OscString",
+    L"OscTermination",
+    L"Ss3Entry",
+    L"Ss3Param"
+};
+
+// Routine Description:
+// - Moves the state machine into the given state, by way of its _Enter function.
+// Arguments:
+// - state - The state to enter.
+// Return Value:
+// - <none>
+void StateMachine::_EnterState(const VTStates state)
+{
+    static_assert(ARRAYSIZE(s_stateNames) == s_cStates, "Every state needs a name");
+
+    switch (state)
+    {
+    case VTStates::Ground:
+        return _EnterGround();
+    case VTStates::Escape:
+        return _EnterEscape();
+    case VTStates::EscapeIntermediate:
+        return _EnterEscapeIntermediate();
+    case VTStates::CsiEntry:
+        return _EnterCsiEntry();
+    case VTStates::CsiIntermediate:
+        return _EnterCsiIntermediate();
+    case VTStates::CsiIgnore:
+        return _EnterCsiIgnore();
+    case VTStates::CsiParam:
+        return _EnterCsiParam();
+    case VTStates::OscParam:
+        return _EnterOscParam();
+    case VTStates::OscString:
+        return _EnterOscString();
+    case VTStates::OscTermination:
+        return _EnterOscTermination();
+    case VTStates::Ss3Entry:
+        return _EnterSs3Entry();
+    case VTStates::Ss3Param:
+        return _EnterSs3Param();
+    default:
+        return;
     }
 }
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the CsiParam state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   5. Store parameter data
-//   6. Dispatch a control sequence with parameters for action
+// - Entry to the state machine. Takes characters one by one and processes them according to the state machine rules.
+//   The character's class and the current state pick a precomputed transition,
+//      so each character costs one table lookup and one jump to its action.
 // Arguments:
-// - wch - Character that triggered the event
+// - wch - New character to operate upon
 // Return Value:
 // - <none>
-void StateMachine::_EventCsiParam(const wchar_t wch)
+void StateMachine::ProcessCharacter(const wchar_t wch)
 {
-    _trace.TraceOnEvent(L"CsiParam");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
-    {
-        _ActionParam(wch);
-    }
-    else if (s_IsIntermediate(wch))
-    {
-        _ActionCollect(wch);
-        _EnterCsiIntermediate();
-    }
-    else if (s_IsCsiInvalid(wch) || s_IsCsiPrivateMarker(wch))
-    {
-        _EnterCsiIgnore();
-    }
-    else
-    {
-        _ActionCsiDispatch(wch);
-        _EnterGround();
-    }
-}
-
-// Routine Description:
-// - Processes a character event into an Action that occurs while in the OscParam state.
-//   Events in this state will:
-//   1. Collect numeric values into an Osc Param
-//   2. Move to the OscString state on a delimiter
-//   3. Ignore everything else.
-// Arguments:
-// - wch - Character that triggered the event
-// Return Value:
-// - <none>
-void StateMachine::_EventOscParam(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"OscParam");
-    if (s_IsOscTerminator(wch))
-    {
-        _EnterGround();
-    }
-    else if (s_IsOscParamValue(wch))
-    {
-        _ActionOscParam(wch);
-    }
-    else if (s_IsOscDelimiter(wch))
-    {
-        _EnterOscString();
-    }
-    else
-    {
-        _ActionIgnore();
-    }
+    _ProcessCharacter(wch, nullptr);
 }
 
 // Routine Description:
-// - Processes a character event into a Action that occurs while in the OscParam state.
-//   Events in this state will:
-//   1. Trigger the OSC action associated with the param on an OscTerminator
-//   2. If we see a ESC, enter the OscTermination state. We'll wait for one
-//      more character before we dispatch the string.
-//   3. Ignore OscInvalid characters.
-//   4. Collect everything else into the OscString
+// - Processes one character, which may be part of a string that's being processed.
 // Arguments:
-// - wch - Character that triggered the event
+// - wch - New character to operate upon
+// - pwchInString - Where wch is in the string being processed, or nullptr if
+//      it isn't part of one. OSC strings are kept as views into the string.
 // Return Value:
 // - <none>
-void StateMachine::_EventOscString(const wchar_t wch)
+void StateMachine::_ProcessCharacter(const wchar_t wch, const wchar_t* const pwchInString)
 {
-    _trace.TraceOnEvent(L"OscString");
-    if (s_IsOscTerminator(wch))
-    {
-        _ActionOscDispatch(wch);
-        _EnterGround();
-    }
-    else if (s_IsOscTerminationInitiator(wch))
-    {
-        _EnterOscTermination();
-    }
-    else if (s_IsOscInvalid(wch))
-    {
-        _ActionIgnore();
-    }
-    else
-    {
-        // add this character to our OSC string
-        _ActionOscPut(wch);
-    }
-}
+    _trace.TraceCharInput(wch);
 
-// Routine Description:
-// - Handle the two-character termination of a OSC sequence.
-//   Events in this state will:
-//   1. Trigger the OSC action associated with the param on an OscTerminator
-// Arguments:
-// - wch - Character that triggered the event
-// Return Value:
-// - <none>
-void StateMachine::_EventOscTermination(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"OscTermination");
+    const auto charClass = wch < s_charClasses.size() ? s_charClasses[wch] : CharClass::Other;
+    const auto& transition = s_transitions[static_cast<size_t>(_state)][static_cast<size_t>(charClass)];
 
-    _ActionOscDispatch(wch);
-    _EnterGround();
-}
+    _trace.TraceOnEvent(s_stateNames[static_cast<size_t>(_state)]);
 
-// Routine Description:
-// - Processes a character event into an Action that occurs while in the Ss3Entry state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   4. Store parameter data
-//   5. Dispatch a control sequence with parameters for action
-//  SS3 sequences are structurally the same as CSI sequences, just with a
-//      different initiation. It's safe to reuse CSI's functions for
-//      determining if a character is a parameter, delimiter, or invalid.
-// Arguments:
-// - wch - Character that triggered the event
-// Return Value:
-// - <none>
-void StateMachine::_EventSs3Entry(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"Ss3Entry");
-    if (s_IsC0Code(wch))
+    switch (transition.action)
     {
+    case Action::None:
+        break;
+    case Action::Execute:
         _ActionExecute(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsCsiInvalid(wch))
-    {
-        // It's safe for us to go into the CSI ignore here, because both SS3 and
-        //      CSI sequences ignore characters the same way.
-        _EnterCsiIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
-    {
+        break;
+    case Action::ExecuteFromEscape:
+        // Whether C0s end an escape sequence is up to the engine.
+        if (_pEngine->DispatchControlCharsFromEscape())
+        {
+            _ActionExecuteFromEscape(wch);
+            _EnterGround();
+        }
+        else
+        {
+            _ActionExecute(wch);
+        }
+        break;
+    case Action::Print:
+        _ActionPrint(wch);
+        break;
+    case Action::Collect:
+        _ActionCollect(wch);
+        break;
+    case Action::Param:
         _ActionParam(wch);
-        _EnterSs3Param();
-    }
-    else
-    {
-        _ActionSs3Dispatch(wch);
-        _EnterGround();
-    }
-}
-
-// Routine Description:
-// - Processes a character event into an Action that occurs while in the CsiParam state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   4. Store parameter data
-//   5. Dispatch a control sequence with parameters for action
-// Arguments:
-// - wch - Character that triggered the event
-// Return Value:
-// - <none>
-void StateMachine::_EventSs3Param(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"Ss3Param");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
+        break;
+    case Action::Ignore:
         _ActionIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
-    {
-        _ActionParam(wch);
-    }
-    else if (s_IsCsiInvalid(wch) || s_IsCsiPrivateMarker(wch))
-    {
-        _EnterCsiIgnore();
-    }
-    else
-    {
+        break;
+    case Action::EscDispatch:
+        _ActionEscDispatch(wch);
+        break;
+    case Action::CsiDispatch:
+        _ActionCsiDispatch(wch);
+        break;
+    case Action::Ss3Dispatch:
         _ActionSs3Dispatch(wch);
-        _EnterGround();
+        break;
+    case Action::OscParam:
+        _ActionOscParam(wch);
+        break;
+    case Action::OscPut:
+        _ActionOscPut(wch, pwchInString);
+        break;
+    case Action::OscDispatch:
+        _ActionOscDispatch(wch);
+        break;
+    default:
+        break;
     }
-}
-
-// Routine Description:
-// - Entry to the state machine. Takes characters one by one and processes them according to the state machine rules.
-// Arguments:
-// - wch - New character to operate upon
-// Return Value:
-// - <none>
-void StateMachine::ProcessCharacter(const wchar_t wch)
-{
-    _trace.TraceCharInput(wch);
 
-    // Process "from anywhere" events first.
-    if (wch == AsciiChars::CAN ||
-        wch == AsciiChars::SUB)
+    if (transition.enterState)
     {
-        _ActionExecute(wch);
-        _EnterGround();
-    }
-    else if (s_IsEscape(wch) && _state != VTStates::OscString)
-    {
-        // Don't go to escape from the OSC string state - ESC can be used to
-        //      terminate OSC strings.
-        _EnterEscape();
-    }
-    else
-    {
-        // Then pass to the current state as an event
-        switch (_state)
-        {
-        case VTStates::Ground:
-            return _EventGround(wch);
-        case VTStates::Escape:
-            return _EventEscape(wch);
-        case VTStates::EscapeIntermediate:
-            return _EventEscapeIntermediate(wch);
-        case VTStates::CsiEntry:
-            return _EventCsiEntry(wch);
-        case VTStates::CsiIntermediate:
-            return _EventCsiIntermediate(wch);
-        case VTStates::CsiIgnore:
-            return _EventCsiIgnore(wch);
-        case VTStates::CsiParam:
-            return _EventCsiParam(wch);
-        case VTStates::OscParam:
-            return _EventOscParam(wch);
-        case VTStates::OscString:
-            return _EventOscString(wch);
-        case VTStates::OscTermination:
-            return _EventOscTermination(wch);
-        case VTStates::Ss3Entry:
-            return _EventSs3Entry(wch);
-        case VTStates::Ss3Param:
-            return _EventSs3Param(wch);
-        default:
-            return;
-        }
+        _EnterState(transition.nextState);
     }
 }
+
 // Method Description:
 // - Pass the current string we're processing through to the engine. It may eat
 //      the string, it may write it straight to the input unmodified, it might
@@ -1303,7 +1373,7 @@ void StateMachine::ProcessCharacter(const wchar_t wch)
 //      it doesn't understand to the tty.
 //  This does not modify the state of the state machine. Callers should be in
 //      the Action*Dispatch state, and upon completion, the state's handler (eg
-//      _EventCsiParam) should move us into the ground state.
+//      transition out of CsiParam) should move us into the ground state.
 // Arguments:
 // - <none>
 // Return Value:
@@ -1334,101 +1404,373 @@ void StateMachine::ProcessString(const wchar_t* const rgwch, const size_t cch)
     _pwchSequenceStart = rgwch;
     _currRunLength = 0;
 
-    // This should be static, because if one string starts a sequence, and the next finishes it,
-    //   we want the partial sequence state to persist.
-    static bool s_fProcessIndividually = false;
+    _pEngine->BeginString();
 
-    for(size_t cchCharsRemaining = cch; cchCharsRemaining > 0; cchCharsRemaining--)
+    const wchar_t* const pwchEnd = rgwch + cch;
+    while (_pwchCurr < pwchEnd)
     {
-        if (s_fProcessIndividually)
+        if (_processingIndividually)
         {
             // If we're processing characters individually, send it to the state machine.
-            ProcessCharacter(*_pwchCurr);
+            _ProcessCharacter(*_pwchCurr, _pwchCurr);
             _pwchCurr++;
             if (_state == VTStates::Ground)  // Then check if we're back at ground. If we are, the next character (pwchCurr)
             {                                //   is the start of the next run of characters that might be printable.
-                s_fProcessIndividually = false;
+                _processingIndividually = false;
                 _pwchSequenceStart = _pwchCurr;
                 _currRunLength = 0;
             }
         }
         else
         {
-            if (s_IsActionableFromGround(*_pwchCurr))  // If the current char is the start of an escape sequence, or should be executed in ground state...
+            // Skip over the whole run of printable characters at once.
+            const size_t cchPrintable = s_FindActionableFromGround(_pwchCurr, pwchEnd - _pwchCurr);
+            _currRunLength += cchPrintable;
+            _pwchCurr += cchPrintable;
+
+            if (_pwchCurr < pwchEnd)  // If we stopped on the start of an escape sequence, or a char that should be executed in ground state...
             {
                 FAIL_FAST_IF(!(_pwchSequenceStart + _currRunLength <= rgwch + cch));
                 _pEngine->ActionPrintString(_pwchSequenceStart, _currRunLength); // ... print all the chars leading up to it as part of the run...
                 _trace.DispatchPrintRunTrace(_pwchSequenceStart, _currRunLength);
-                s_fProcessIndividually = true; // begin processing future characters individually...
+                _processingIndividually = true; // begin processing future characters individually...
                 _currRunLength = 0;
                 _pwchSequenceStart = _pwchCurr;
-                ProcessCharacter(*_pwchCurr); // ... Then process the character individually.
+                _ProcessCharacter(*_pwchCurr, _pwchCurr); // ... Then process the character individually.
                 if (_state == VTStates::Ground)  // If the character took us right back to ground, start another run after it.
                 {
-                    s_fProcessIndividually = false;
+                    _processingIndividually = false;
                     _pwchSequenceStart = _pwchCurr + 1;
                     _currRunLength = 0;
                 }
+                _pwchCurr++;
             }
-            else
-            {
-                _currRunLength++; // Otherwise, add this char to the current run to be printed.
-            }
-            _pwchCurr++;
         }
     }
 
     // If we're at the end of the string and have remaining un-printed characters,
-    if (!s_fProcessIndividually && _currRunLength > 0)
+    if (!_processingIndividually && _currRunLength > 0)
     {
         // print the rest of the characters in the string
         _pEngine->ActionPrintString(_pwchSequenceStart, _currRunLength);
         _trace.DispatchPrintRunTrace(_pwchSequenceStart, _currRunLength);
 
     }
-    else if (s_fProcessIndividually)
+    else if (_processingIndividually)
     {
-        if (_pEngine->FlushAtEndOfString())
+        // An OSC string that isn't finished yet can't point into this string anymore.
+        _BufferOscString();
+        _FlushPartialSequence();
+    }
+
+    _pEngine->EndString();
+}
+
+// Routine Description:
+// - If the engine wants it, finishes off a sequence that's still in progress
+//     at the end of a string, by feeding its characters in again.
+//   The characters of the sequence are [_pwchSequenceStart, _pwchCurr).
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void StateMachine::_FlushPartialSequence()
+{
+    if (_pEngine->FlushAtEndOfString())
+    {
+        // Reset our state, and put all but the last char in again.
+        ResetState();
+        // Chars to flush are [pwchSequenceStart, pwchCurr)
+        const wchar_t* pwch = _pwchSequenceStart;
+        for (; pwch < _pwchCurr-1; pwch++)
         {
-            // Reset our state, and put all but the last char in again.
-            ResetState();
-            // Chars to flush are [pwchSequenceStart, pwchCurr)
-            const wchar_t* pwch = _pwchSequenceStart;
-            for (; pwch < _pwchCurr-1; pwch++)
-            {
-                ProcessCharacter(*pwch);
-            }
-            // Manually execute the last char [pwchCurr]
-            switch (_state)
+            ProcessCharacter(*pwch);
+        }
+        // Manually execute the last char [pwchCurr]
+        switch (_state)
+        {
+        case VTStates::Ground:
+            return _ActionExecute(*pwch);
+        case VTStates::Escape:
+        case VTStates::EscapeIntermediate:
+            return _ActionEscDispatch(*pwch);
+        case VTStates::CsiEntry:
+        case VTStates::CsiIntermediate:
+        case VTStates::CsiIgnore:
+        case VTStates::CsiParam:
+            return _ActionCsiDispatch(*pwch);
+        case VTStates::OscParam:
+        case VTStates::OscString:
+        case VTStates::OscTermination:
+            return _ActionOscDispatch(*pwch);
+        case VTStates::Ss3Entry:
+        case VTStates::Ss3Param:
+            return _ActionSs3Dispatch(*pwch);
+        default:
+            return;
+        }
+    }
+}
+
+void StateMachine::ProcessString(const std::wstring& wstr)
+{
+    return ProcessString(wstr.c_str(), wstr.length());
+}
+
+// Routine Description:
+// - Determines if the UTF-8 character at the given position is actionable
+//     from the ground state. These are the same characters as
+//     s_IsActionableFromGround, with the C1 CSI encoded as 0xC2 0x9B.
+// Arguments:
+// - pch - The character to check, followed by the rest of the string
+// - cb - Count of bytes left in the string
+// Return Value:
+// - True if it is. False if it isn't.
+bool StateMachine::s_IsActionableFromGroundUtf8(const char* const pch, const size_t cb) noexcept
+{
+    const auto ch = static_cast<unsigned char>(pch[0]);
+    return (ch <= AsciiChars::US) ||
+           (ch == AsciiChars::DEL) ||
+           (ch == 0xC2 && cb > 1 && static_cast<unsigned char>(pch[1]) == 0x9B);
+}
+
+// Routine Description:
+// - Finds the first character in a UTF-8 string that s_IsActionableFromGroundUtf8.
+//   Where SSE2 is available, this checks 16 bytes at a time.
+// Arguments:
+// - pch - The bytes to scan
+// - cb - Count of bytes to scan
+// Return Value:
+// - The index of the first actionable character, or cb if they're all printable.
+size_t StateMachine::s_FindActionableFromGroundUtf8(const char* const pch, const size_t cb) noexcept
+{
+    size_t i = 0;
+
+#if defined(_M_IX86) || defined(_M_X64)
+    const __m128i c0Max = _mm_set1_epi8(static_cast<char>(AsciiChars::US));
+    const __m128i del = _mm_set1_epi8(static_cast<char>(AsciiChars::DEL));
+    const __m128i c1Lead = _mm_set1_epi8(static_cast<char>(0xC2));
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 16 <= cb; i += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pch + i));
+        const __m128i isC0 = _mm_cmpeq_epi8(_mm_subs_epu8(bytes, c0Max), zero);
+        const __m128i isDel = _mm_cmpeq_epi8(bytes, del);
+        const __m128i isC1Lead = _mm_cmpeq_epi8(bytes, c1Lead);
+
+        // 0xC2 also leads printable characters like U+00A9, so those still need
+        //   to be checked one at a time.
+        auto mask = static_cast<unsigned long>(_mm_movemask_epi8(_mm_or_si128(isC0, _mm_or_si128(isDel, isC1Lead))));
+        while (mask != 0)
+        {
+            unsigned long bit = 0;
+            _BitScanForward(&bit, mask);
+            if (s_IsActionableFromGroundUtf8(pch + i + bit, cb - i - bit))
             {
-            case VTStates::Ground:
-                return _ActionExecute(*pwch);
-            case VTStates::Escape:
-            case VTStates::EscapeIntermediate:
-                return _ActionEscDispatch(*pwch);
-            case VTStates::CsiEntry:
-            case VTStates::CsiIntermediate:
-            case VTStates::CsiIgnore:
-            case VTStates::CsiParam:
-                return _ActionCsiDispatch(*pwch);
-            case VTStates::OscParam:
-            case VTStates::OscString:
-            case VTStates::OscTermination:
-                return _ActionOscDispatch(*pwch);
-            case VTStates::Ss3Entry:
-            case VTStates::Ss3Param:
-                return _ActionSs3Dispatch(*pwch);
-            default:
-                return;
+                return i + bit;
             }
+            mask &= mask - 1;
+        }
+    }
+#endif
 
+    for (; i < cb; i++)
+    {
+        if (s_IsActionableFromGroundUtf8(pch + i, cb - i))
+        {
+            return i;
         }
     }
+    return cb;
 }
 
-void StateMachine::ProcessString(const std::wstring& wstr)
+// Routine Description:
+// - Widens a run of printable UTF-8 characters and prints it.
+// Arguments:
+// - pch - The run of characters
+// - cb - Count of bytes in the run
+// Return Value:
+// - <none>
+void StateMachine::_PrintUtf8Run(const char* const pch, const size_t cb)
 {
-    return ProcessString(wstr.c_str(), wstr.length());
+    if (cb == 0)
+    {
+        return;
+    }
+
+    // A UTF-8 string never has more UTF-16 code units than it has bytes.
+    _utf8Widened.resize(cb);
+    const int cchWidened = MultiByteToWideChar(CP_UTF8,
+                                               0,
+                                               pch,
+                                               gsl::narrow<int>(cb),
+                                               _utf8Widened.data(),
+                                               gsl::narrow<int>(_utf8Widened.size()));
+    THROW_LAST_ERROR_IF(cchWidened == 0);
+
+    _pEngine->ActionPrintString(_utf8Widened.data(), cchWidened);
+    _trace.DispatchPrintRunTrace(_utf8Widened.data(), cchWidened);
+}
+
+// Routine Description:
+// - Widens a single UTF-8 codepoint and processes it, printing it straight
+//     away if it's printable and we're not in the middle of a sequence.
+// Arguments:
+// - pch - The codepoint
+// - cb - Count of bytes in the codepoint
+// Return Value:
+// - <none>
+void StateMachine::_ProcessUtf8Codepoint(const char* const pch, const size_t cb)
+{
+    wchar_t rgwch[4];
+    const int cch = MultiByteToWideChar(CP_UTF8, 0, pch, gsl::narrow<int>(cb), rgwch, ARRAYSIZE(rgwch));
+    THROW_LAST_ERROR_IF(cch == 0);
+
+    if (!_processingIndividually && !s_IsActionableFromGround(rgwch[0]))
+    {
+        _pEngine->ActionPrintString(rgwch, cch);
+        _trace.DispatchPrintRunTrace(rgwch, cch);
+        return;
+    }
+
+    for (int i = 0; i < cch; i++)
+    {
+        _ProcessUtf8Character(rgwch[i]);
+    }
+}
+
+// Routine Description:
+// - Processes one character of a sequence read from a UTF-8 string. The
+//     characters of the sequence are kept so FlushToTerminal can pass the
+//     whole sequence through, even when it spans more than one string.
+// Arguments:
+// - wch - The widened character
+// Return Value:
+// - <none>
+void StateMachine::_ProcessUtf8Character(const wchar_t wch)
+{
+    if (!_processingIndividually)
+    {
+        _utf8Sequence.clear();
+        _processingIndividually = true;
+    }
+
+    _utf8Sequence.push_back(wch);
+    _pwchSequenceStart = _utf8Sequence.data();
+    _pwchCurr = _pwchSequenceStart + _utf8Sequence.size() - 1;
+
+    ProcessCharacter(wch);
+
+    if (_state == VTStates::Ground)
+    {
+        _processingIndividually = false;
+        _utf8Sequence.clear();
+    }
+}
+
+// Routine Description:
+// - Helper for entry to the state machine with UTF-8 text, as it comes out of a pty.
+//     Escape sequences are recognized on the bytes themselves, so only the
+//     runs of printable characters between them need to be widened, once
+//     each, right before they're printed.
+//   A codepoint split across the end of the string is held until the next string.
+// Arguments:
+// - pch - Array of UTF-8 bytes to operate upon
+// - cb - Count of bytes in array
+// Return Value:
+// - <none>
+void StateMachine::ProcessUtf8String(const char* const pch, const size_t cb)
+{
+    const char* pchCurr = pch;
+    const char* const pchEnd = pch + cb;
+
+    // Finish off a codepoint that was split across the previous string and this one.
+    if (!_utf8Partial.empty())
+    {
+        while (pchCurr < pchEnd && Utf8Decoder::CodepointLength(_utf8Partial) == 0)
+        {
+            _utf8Partial.push_back(*pchCurr);
+            pchCurr++;
+        }
+
+        const size_t cbCodepoint = Utf8Decoder::CodepointLength(_utf8Partial);
+        if (cbCodepoint == 0)
+        {
+            // Still not done. Wait for the next string.
+            return;
+        }
+
+        // If the codepoint was cut short by a byte that isn't a continuation,
+        //   that byte starts the next character instead.
+        pchCurr -= _utf8Partial.size() - cbCodepoint;
+
+        _pEngine->BeginString();
+        _ProcessUtf8Codepoint(_utf8Partial.data(), cbCodepoint);
+        _utf8Partial.clear();
+    }
+    else
+    {
+        _pEngine->BeginString();
+    }
+
+    while (pchCurr < pchEnd)
+    {
+        const size_t cbRemaining = pchEnd - pchCurr;
+        if (_processingIndividually)
+        {
+            const size_t cbCodepoint = Utf8Decoder::CodepointLength({ pchCurr, cbRemaining });
+            if (cbCodepoint == 0)
+            {
+                _utf8Partial.assign(pchCurr, cbRemaining);
+                break;
+            }
+            _ProcessUtf8Codepoint(pchCurr, cbCodepoint);
+            pchCurr += cbCodepoint;
+        }
+        else
+        {
+            const size_t cbPrintable = s_FindActionableFromGroundUtf8(pchCurr, cbRemaining);
+            if (cbPrintable == cbRemaining)
+            {
+                // Print everything up to the last whole codepoint, and keep the rest for later.
+                size_t cbWhole = cbRemaining;
+                for (size_t i = 1; i <= 3 && i <= cbRemaining; i++)
+                {
+                    const char* const pchLead = pchEnd - i;
+                    if ((static_cast<unsigned char>(*pchLead) & 0xC0) != 0x80)
+                    {
+                        if (Utf8Decoder::CodepointLength({ pchLead, i }) == 0)
+                        {
+                            cbWhole = cbRemaining - i;
+                        }
+                        break;
+                    }
+                }
+
+                _PrintUtf8Run(pchCurr, cbWhole);
+                _utf8Partial.assign(pchCurr + cbWhole, cbRemaining - cbWhole);
+                break;
+            }
+
+            _PrintUtf8Run(pchCurr, cbPrintable);
+            pchCurr += cbPrintable;
+
+            // Actionable characters are all ASCII, except for the C1 CSI.
+            const size_t cbCodepoint = static_cast<unsigned char>(*pchCurr) == 0xC2 ? 2 : 1;
+            _ProcessUtf8Codepoint(pchCurr, cbCodepoint);
+            pchCurr += cbCodepoint;
+        }
+    }
+
+    if (_processingIndividually && _utf8Partial.empty())
+    {
+        _pwchSequenceStart = _utf8Sequence.data();
+        _pwchCurr = _pwchSequenceStart + _utf8Sequence.size();
+        _FlushPartialSequence();
+    }
+
+    _pEngine->EndString();
 }
 
 // Routine Description:
@@ -1443,3 +1785,15 @@ void StateMachine::ResetState()
 {
     _EnterGround();
 }
+
+// Routine Description:
+// - Tells if we're in the middle of a sequence. The next string is only
+//     printed as it is if we're not.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if we're in the ground state.
+bool StateMachine::IsInGroundState() const noexcept
+{
+    return _state == VTStates::Ground;
+}
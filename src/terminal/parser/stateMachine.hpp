@@ -17,6 +17,7 @@ Abstract:
 #include "IStateMachineEngine.hpp"
 #include "telemetry.hpp"
 #include "tracing.hpp"
+#include <array>
 #include <memory>
 
 namespace Microsoft::Console::VirtualTerminal
@@ -34,8 +35,10 @@ namespace Microsoft::Console::VirtualTerminal
         void ProcessCharacter(const wchar_t wch);
         void ProcessString(const wchar_t* const rgwch, const size_t cch);
         void ProcessString(const std::wstring& wstr);
+        void ProcessUtf8String(const char* const pch, const size_t cb);
 
         void ResetState();
+        bool IsInGroundState() const noexcept;
 
         bool FlushToTerminal();
 
@@ -44,30 +47,30 @@ namespace Microsoft::Console::VirtualTerminal
 
         static const short s_cIntermediateMax = 1;
         static const short s_cParamsMax = 16;
-        static const short s_cOscStringMaxLength = 256;
+        // OSC strings longer than this are cut off, so that a runaway one
+        //   can't take all of our memory.
+        static const size_t s_cchOscStringMax = 1024 * 1024;
 
     private:
         static bool s_IsActionableFromGround(const wchar_t wch);
-        static bool s_IsC0Code(const wchar_t wch);
-        static bool s_IsC1Csi(const wchar_t wch);
-        static bool s_IsIntermediate(const wchar_t wch);
-        static bool s_IsDelete(const wchar_t wch);
-        static bool s_IsEscape(const wchar_t wch);
-        static bool s_IsCsiIndicator(const wchar_t wch);
-        static bool s_IsCsiDelimiter(const wchar_t wch);
-        static bool s_IsCsiParamValue(const wchar_t wch);
-        static bool s_IsCsiPrivateMarker(const wchar_t wch);
-        static bool s_IsCsiInvalid(const wchar_t wch);
-        static bool s_IsOscIndicator(const wchar_t wch);
-        static bool s_IsOscDelimiter(const wchar_t wch);
-        static bool s_IsOscParamValue(const wchar_t wch);
-        static bool s_IsOscInvalid(const wchar_t wch);
-        static bool s_IsOscTerminator(const wchar_t wch);
-        static bool s_IsOscTerminationInitiator(const wchar_t wch);
+        static size_t s_FindActionableFromGround(const wchar_t* const pwch, const size_t cch) noexcept;
+        static bool s_IsActionableFromGroundUtf8(const char* const pch, const size_t cb) noexcept;
+        static size_t s_FindActionableFromGroundUtf8(const char* const pch, const size_t cb) noexcept;
+        static constexpr bool s_IsC0Code(const wchar_t wch) noexcept;
+        static constexpr bool s_IsC1Csi(const wchar_t wch) noexcept;
+        static constexpr bool s_IsIntermediate(const wchar_t wch) noexcept;
+        static constexpr bool s_IsDelete(const wchar_t wch) noexcept;
+        static constexpr bool s_IsEscape(const wchar_t wch) noexcept;
+        static constexpr bool s_IsCsiIndicator(const wchar_t wch) noexcept;
+        static constexpr bool s_IsCsiDelimiter(const wchar_t wch) noexcept;
+        static constexpr bool s_IsCsiParamValue(const wchar_t wch) noexcept;
+        static constexpr bool s_IsCsiPrivateMarker(const wchar_t wch) noexcept;
+        static constexpr bool s_IsCsiInvalid(const wchar_t wch) noexcept;
+        static constexpr bool s_IsOscIndicator(const wchar_t wch) noexcept;
+        static constexpr bool s_IsOscTerminator(const wchar_t wch) noexcept;
         static bool s_IsDesignateCharsetIndicator(const wchar_t wch);
         static bool s_IsCharsetCode(const wchar_t wch);
-        static bool s_IsNumber(const wchar_t wch);
-        static bool s_IsSs3Indicator(const wchar_t wch);
+        static constexpr bool s_IsSs3Indicator(const wchar_t wch) noexcept;
 
         void _ActionExecute(const wchar_t wch);
         void _ActionExecuteFromEscape(const wchar_t wch);
@@ -77,11 +80,13 @@ namespace Microsoft::Console::VirtualTerminal
         void _ActionParam(const wchar_t wch);
         void _ActionCsiDispatch(const wchar_t wch);
         void _ActionOscParam(const wchar_t wch);
-        void _ActionOscPut(const wchar_t wch);
+        void _ActionOscPut(const wchar_t wch, const wchar_t* const pwchInString);
         void _ActionOscDispatch(const wchar_t wch);
         void _ActionSs3Dispatch(const wchar_t wch);
 
         void _ActionClear();
+        void _BufferOscString();
+        void _ProcessCharacter(const wchar_t wch, const wchar_t* const pwchInString);
         void _ActionIgnore();
 
         void _EnterGround();
@@ -97,19 +102,6 @@ namespace Microsoft::Console::VirtualTerminal
         void _EnterSs3Entry();
         void _EnterSs3Param();
 
-        void _EventGround(const wchar_t wch);
-        void _EventEscape(const wchar_t wch);
-        void _EventEscapeIntermediate(const wchar_t wch);
-        void _EventCsiEntry(const wchar_t wch);
-        void _EventCsiIntermediate(const wchar_t wch);
-        void _EventCsiIgnore(const wchar_t wch);
-        void _EventCsiParam(const wchar_t wch);
-        void _EventOscParam(const wchar_t wch);
-        void _EventOscString(const wchar_t wch);
-        void _EventOscTermination(const wchar_t wch);
-        void _EventSs3Entry(const wchar_t wch);
-        void _EventSs3Param(const wchar_t wch);
-
         enum class VTStates
         {
             Ground,
@@ -125,6 +117,79 @@ namespace Microsoft::Console::VirtualTerminal
             Ss3Entry,
             Ss3Param
         };
+        static const size_t s_cStates = static_cast<size_t>(VTStates::Ss3Param) + 1;
+
+        void _EnterState(const VTStates state);
+
+        // Every character that means the same thing in every state shares a class.
+        enum class CharClass : BYTE
+        {
+            C0, // C0 control characters other than the ones below
+            Bell,
+            CancelOrSubstitute,
+            Escape,
+            Intermediate, // 0x20 - 0x2F
+            Digit, // 0x30 - 0x39
+            Colon,
+            Semicolon,
+            PrivateMarker, // 0x3C - 0x3F
+            CsiIndicator, // '['
+            OscIndicator, // ']'
+            Ss3Indicator, // 'O'
+            Delete,
+            C1Csi,
+            C1StringTerminator,
+            Other
+        };
+        static const size_t s_cCharClasses = static_cast<size_t>(CharClass::Other) + 1;
+
+        // Characters past the C1 range are all CharClass::Other, so they don't need a table entry.
+        static const size_t s_cClassifiedChars = 0xA0;
+
+        enum class Action : BYTE
+        {
+            None,
+            Execute,
+            ExecuteFromEscape, // Execute, and also return to ground if the engine wants C0s to end escapes.
+            Print,
+            Collect,
+            Param,
+            Ignore,
+            EscDispatch,
+            CsiDispatch,
+            Ss3Dispatch,
+            OscParam,
+            OscPut,
+            OscDispatch
+        };
+
+        struct Transition
+        {
+            Action action;
+            VTStates nextState;
+            bool enterState;
+
+            static constexpr Transition Stay(const Action action) noexcept
+            {
+                return { action, VTStates::Ground, false };
+            }
+
+            static constexpr Transition To(const Action action, const VTStates state) noexcept
+            {
+                return { action, state, true };
+            }
+        };
+
+        using CharClassTable = std::array<CharClass, s_cClassifiedChars>;
+        using TransitionTable = std::array<std::array<Transition, s_cCharClasses>, s_cStates>;
+
+        static constexpr CharClass s_ClassifyCharacter(const wchar_t wch) noexcept;
+        static constexpr CharClassTable s_BuildCharClassTable() noexcept;
+        static constexpr Transition s_ComputeTransition(const VTStates state, const CharClass charClass) noexcept;
+        static constexpr TransitionTable s_BuildTransitionTable() noexcept;
+
+        static const CharClassTable s_charClasses;
+        static const TransitionTable s_transitions;
 
         Microsoft::Console::VirtualTerminal::ParserTracing _trace;
 
@@ -141,8 +206,14 @@ namespace Microsoft::Console::VirtualTerminal
         unsigned short _iParamAccumulatePos;
 
         unsigned short _sOscParam;
-        unsigned short _sOscNextChar;
-        wchar_t _pwchOscStringBuffer[s_cOscStringMaxLength];
+
+        // When an OSC string arrives all in one string, it's kept as a view
+        //   into that string, and never copied. Otherwise, or once the string
+        //   it's in ends, it's copied into _oscString.
+        const wchar_t* _pwchOscString;
+        size_t _cchOscString;
+        std::wstring _oscString;
+        bool _oscStringBuffered;
 
         // These members track out state in the parsing of a single string.
         // FlushToTerminal uses these, so that an engine can force a string
@@ -151,5 +222,22 @@ namespace Microsoft::Console::VirtualTerminal
         const wchar_t* _pwchSequenceStart;
         size_t _currRunLength;
 
+        // This persists between strings, because if one string starts a sequence,
+        //   and the next finishes it, we want the partial sequence state to persist.
+        bool _processingIndividually;
+
+        // These members hold the state of ProcessUtf8String between strings.
+        // _utf8Partial is a codepoint that was split across the end of a string,
+        // _utf8Widened is reused to widen printable runs,
+        // and _utf8Sequence collects the widened characters of the sequence
+        // in progress, for FlushToTerminal.
+        std::string _utf8Partial;
+        std::wstring _utf8Widened;
+        std::wstring _utf8Sequence;
+
+        void _PrintUtf8Run(const char* const pch, const size_t cb);
+        void _ProcessUtf8Codepoint(const char* const pch, const size_t cb);
+        void _ProcessUtf8Character(const wchar_t wch);
+        void _FlushPartialSequence();
     };
 }
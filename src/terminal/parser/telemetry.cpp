@@ -38,46 +38,6 @@ TermTelemetry::~TermTelemetry()
     TraceLoggingUnregister(g_hConsoleVirtTermParserEventTraceProvider);
 }
 
-// Routine Description:
-// - Logs the usage of a particular VT100 code.
-//
-// Arguments:
-// - code - VT100 code.
-// Return Value:
-// - <none>
-void TermTelemetry::Log(const Codes code)
-{
-    // Initially we wanted to pass over a string (ex. "CUU") and use a dictionary data type to hold the counts.
-    // However we would have to search through the dictionary every time we called this method, so we decided
-    // to use an array which has very quick access times.
-    // The downside is we have to create an enum type, and then convert them to strings when we finally
-    // send out the telemetry, but the upside is we should have very good performance.
-    _uiTimesUsed[code]++;
-    _uiTimesUsedCurrent++;
-}
-
-// Routine Description:
-// - Logs a particular VT100 escape code failed or was unsupported.
-//
-// Arguments:
-// - code - VT100 code.
-// Return Value:
-// - <none>
-void TermTelemetry::LogFailed(const wchar_t wch)
-{
-    if (wch > CHAR_MAX)
-    {
-        _uiTimesFailedOutsideRange++;
-        _uiTimesFailedOutsideRangeCurrent++;
-    }
-    else
-    {
-        // Even though we pass over a wide character, we only care about the ASCII single byte character.
-        _uiTimesFailed[wch]++;
-        _uiTimesFailedCurrent++;
-    }
-}
-
 // Routine Description:
 // - Gets and resets the total count of codes used.
 //
@@ -244,6 +204,7 @@ void TermTelemetry::WriteFinalTraceLog() const
                 TraceLoggingUInt32(_uiTimesUsed[OSCSCC], "OscSetCursorColor"),
                 TraceLoggingUInt32(_uiTimesUsed[OSCRCC], "OscResetCursorColor"),
                 TraceLoggingUInt32(_uiTimesUsed[REP], "REP"),
+                TraceLoggingUInt32(_uiTimesUsed[OSCHL], "OscHyperlink"),
                 TraceLoggingUInt32Array(_uiTimesFailed, ARRAYSIZE(_uiTimesFailed), "Failed"),
                 TraceLoggingUInt32(_uiTimesFailedOutsideRange, "FailedOutsideRange"));
         }
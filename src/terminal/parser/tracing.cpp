@@ -8,7 +8,7 @@ using namespace Microsoft::Console::VirtualTerminal;
 
 ParserTracing::ParserTracing()
 {
-    ClearSequenceTrace();
+    _ClearSequenceTrace();
 }
 
 ParserTracing::~ParserTracing()
@@ -16,7 +16,7 @@ ParserTracing::~ParserTracing()
 
 }
 
-void ParserTracing::TraceStateChange(_In_ PCWSTR const pwszName) const
+void ParserTracing::_WriteStateChange(_In_ PCWSTR const pwszName) const
 {
     TraceLoggingWrite(g_hConsoleVirtTermParserEventTraceProvider, "StateMachine_EnterState",
         TraceLoggingWideString(pwszName),
@@ -24,7 +24,7 @@ void ParserTracing::TraceStateChange(_In_ PCWSTR const pwszName) const
         );
 }
 
-void ParserTracing::TraceOnAction(_In_ PCWSTR const pwszName) const
+void ParserTracing::_WriteOnAction(_In_ PCWSTR const pwszName) const
 {
     TraceLoggingWrite(g_hConsoleVirtTermParserEventTraceProvider, "StateMachine_Action",
         TraceLoggingWideString(pwszName),
@@ -32,7 +32,7 @@ void ParserTracing::TraceOnAction(_In_ PCWSTR const pwszName) const
         );
 }
 
-void ParserTracing::TraceOnExecute(const wchar_t wch) const
+void ParserTracing::_WriteOnExecute(const wchar_t wch) const
 {
     INT16 sch = (INT16)wch;
     TraceLoggingWrite(g_hConsoleVirtTermParserEventTraceProvider, "StateMachine_Execute",
@@ -42,7 +42,7 @@ void ParserTracing::TraceOnExecute(const wchar_t wch) const
         );
 }
 
-void ParserTracing::TraceOnExecuteFromEscape(const wchar_t wch) const
+void ParserTracing::_WriteOnExecuteFromEscape(const wchar_t wch) const
 {
     INT16 sch = (INT16)wch;
     TraceLoggingWrite(g_hConsoleVirtTermParserEventTraceProvider, "StateMachine_ExecuteFromEscape",
@@ -52,7 +52,7 @@ void ParserTracing::TraceOnExecuteFromEscape(const wchar_t wch) const
         );
 }
 
-void ParserTracing::TraceOnEvent(_In_ PCWSTR const pwszName) const
+void ParserTracing::_WriteOnEvent(_In_ PCWSTR const pwszName) const
 {
     TraceLoggingWrite(g_hConsoleVirtTermParserEventTraceProvider, "StateMachine_Event",
         TraceLoggingWideString(pwszName),
@@ -60,9 +60,8 @@ void ParserTracing::TraceOnEvent(_In_ PCWSTR const pwszName) const
         );
 }
 
-void ParserTracing::TraceCharInput(const wchar_t wch)
+void ParserTracing::_WriteCharInput(const wchar_t wch) const
 {
-    AddSequenceTrace(wch);
     INT16 sch = (INT16)wch;
 
     TraceLoggingWrite(g_hConsoleVirtTermParserEventTraceProvider, "StateMachine_NewChar",
@@ -82,7 +81,7 @@ void ParserTracing::AddSequenceTrace(const wchar_t wch)
     }
 }
 
-void ParserTracing::DispatchSequenceTrace(const bool fSuccess)
+void ParserTracing::_WriteSequenceTrace(const bool fSuccess) const
 {
     if (fSuccess)
     {
@@ -98,18 +97,16 @@ void ParserTracing::DispatchSequenceTrace(const bool fSuccess)
                           TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE)
                           );
     }
-
-    ClearSequenceTrace();
 }
 
-void ParserTracing::ClearSequenceTrace()
+void ParserTracing::_ClearSequenceTrace()
 {
     ZeroMemory(_rgwchSequenceTrace, sizeof(_rgwchSequenceTrace));
     _cchSequenceTrace = 0;
 }
 
 // NOTE: I'm expecting this to not be null terminated
-void ParserTracing::DispatchPrintRunTrace(const wchar_t* const pwsString, const size_t cchString) const
+void ParserTracing::_WritePrintRun(const wchar_t* const pwsString, const size_t cchString) const
 {
     size_t charsRemaining = cchString;
     wchar_t str[BYTE_MAX + 4 + sizeof(wchar_t) + sizeof('\0')];
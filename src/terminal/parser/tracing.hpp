@@ -18,6 +18,11 @@ Abstract:
 
 namespace Microsoft::Console::VirtualTerminal
 {
+    // Every method here is called from the parser's hot path, so they're all
+    //  inline and do nothing but check whether anyone is listening before
+    //  calling out to the functions that actually write the events.
+    // Define NO_PARSER_TRACING (build with /p:ParserTracing=false, or
+    //  NO_PARSER_TRACING=1 in razzle) to compile the tracing out entirely.
     class ParserTracing sealed
     {
     public:
@@ -25,17 +30,84 @@ namespace Microsoft::Console::VirtualTerminal
         ParserTracing();
         ~ParserTracing();
 
-        void TraceStateChange(_In_ PCWSTR const pwszName) const;
-        void TraceOnAction(_In_ PCWSTR const pwszName) const;
-        void TraceOnExecute(const wchar_t wch) const;
-        void TraceOnExecuteFromEscape(const wchar_t wch) const;
-        void TraceOnEvent(_In_ PCWSTR const pwszName) const;
-        void TraceCharInput(const wchar_t wch);
+        void TraceStateChange(_In_ PCWSTR const pwszName) const
+        {
+            if (s_IsEnabled())
+            {
+                _WriteStateChange(pwszName);
+            }
+        }
+
+        void TraceOnAction(_In_ PCWSTR const pwszName) const
+        {
+            if (s_IsEnabled())
+            {
+                _WriteOnAction(pwszName);
+            }
+        }
+
+        void TraceOnExecute(const wchar_t wch) const
+        {
+            if (s_IsEnabled())
+            {
+                _WriteOnExecute(wch);
+            }
+        }
+
+        void TraceOnExecuteFromEscape(const wchar_t wch) const
+        {
+            if (s_IsEnabled())
+            {
+                _WriteOnExecuteFromEscape(wch);
+            }
+        }
+
+        void TraceOnEvent(_In_ PCWSTR const pwszName) const
+        {
+            if (s_IsEnabled())
+            {
+                _WriteOnEvent(pwszName);
+            }
+        }
+
+        void TraceCharInput(const wchar_t wch)
+        {
+            if (s_IsEnabled())
+            {
+                AddSequenceTrace(wch);
+                _WriteCharInput(wch);
+            }
+        }
 
         void AddSequenceTrace(const wchar_t wch);
-        void DispatchSequenceTrace(const bool fSuccess);
-        void ClearSequenceTrace();
-        void DispatchPrintRunTrace(const wchar_t* const pwsString, const size_t cchString) const;
+
+        void DispatchSequenceTrace(const bool fSuccess)
+        {
+            if (s_IsEnabled())
+            {
+                _WriteSequenceTrace(fSuccess);
+            }
+            ClearSequenceTrace();
+        }
+
+        void ClearSequenceTrace()
+        {
+            // Nothing is collected while no one is listening, so there's
+            //  usually nothing to clear either.
+            if (_cchSequenceTrace > 0)
+            {
+                _ClearSequenceTrace();
+            }
+        }
+
+        // NOTE: I'm expecting this to not be null terminated
+        void DispatchPrintRunTrace(const wchar_t* const pwsString, const size_t cchString) const
+        {
+            if (s_IsEnabled())
+            {
+                _WritePrintRun(pwsString, cchString);
+            }
+        }
 
     private:
         static const size_t s_cMaxSequenceTrace = 32;
@@ -43,6 +115,28 @@ namespace Microsoft::Console::VirtualTerminal
         wchar_t _rgwchSequenceTrace[s_cMaxSequenceTrace];
         size_t _cchSequenceTrace;
 
+        // Routine Description:
+        // - Checks whether a session is listening to the parser's events. The
+        //   provider caches the level it was enabled with, so this is one compare.
+        // Return Value:
+        // - true if the events would be written anywhere.
+        static bool s_IsEnabled() noexcept
+        {
+#ifdef NO_PARSER_TRACING
+            return false;
+#else
+            return TraceLoggingProviderEnabled(g_hConsoleVirtTermParserEventTraceProvider, WINEVENT_LEVEL_VERBOSE, 0);
+#endif
+        }
 
+        void _WriteStateChange(_In_ PCWSTR const pwszName) const;
+        void _WriteOnAction(_In_ PCWSTR const pwszName) const;
+        void _WriteOnExecute(const wchar_t wch) const;
+        void _WriteOnExecuteFromEscape(const wchar_t wch) const;
+        void _WriteOnEvent(_In_ PCWSTR const pwszName) const;
+        void _WriteCharInput(const wchar_t wch) const;
+        void _WriteSequenceTrace(const bool fSuccess) const;
+        void _WritePrintRun(const wchar_t* const pwsString, const size_t cchString) const;
+        void _ClearSequenceTrace();
     };
 }
@@ -239,6 +239,7 @@ class Microsoft::Console::VirtualTerminal::InputEngineTest
     TEST_METHOD(CSICursorBackTabTest);
     TEST_METHOD(AltBackspaceTest);
     TEST_METHOD(AltCtrlDTest);
+    TEST_METHOD(BatchedInputTest);
 
     friend class TestInteractDispatch;
 };
@@ -256,6 +257,9 @@ public:
                                     const size_t cParams) override; // DTTERM_WindowManipulation
     virtual bool WriteString(_In_reads_(cch) const wchar_t* const pws,
                              const size_t cch) override;
+    virtual bool StringToInput(_In_reads_(cch) const wchar_t* const pws,
+                               const size_t cch,
+                               _Inout_ std::deque<std::unique_ptr<IInputEvent>>& inputEvents) override;
 
     virtual bool MoveCursor(const unsigned int row,
                             const unsigned int col) override;
@@ -306,7 +310,14 @@ bool TestInteractDispatch::WriteString(_In_reads_(cch) const wchar_t* const pws,
                                        const size_t cch)
 {
     std::deque<std::unique_ptr<IInputEvent>> keyEvents;
+    StringToInput(pws, cch, keyEvents);
+    return WriteInput(keyEvents);
+}
 
+bool TestInteractDispatch::StringToInput(_In_reads_(cch) const wchar_t* const pws,
+                                         const size_t cch,
+                                         _Inout_ std::deque<std::unique_ptr<IInputEvent>>& inputEvents)
+{
     for (size_t i = 0; i < cch; ++i)
     {
         const wchar_t wch = pws[i];
@@ -315,10 +326,9 @@ bool TestInteractDispatch::WriteString(_In_reads_(cch) const wchar_t* const pws,
         std::deque<std::unique_ptr<KeyEvent>> convertedEvents = CharToKeyEvents(wch, CP_USA);
         std::move(convertedEvents.begin(),
                   convertedEvents.end(),
-                  std::back_inserter(keyEvents));
+                  std::back_inserter(inputEvents));
     }
-
-    return WriteInput(keyEvents);
+    return true;
 }
 
 bool TestInteractDispatch::MoveCursor(const unsigned int row,
@@ -788,3 +798,41 @@ void InputEngineTest::AltCtrlDTest()
     Log::Comment(NoThrowString().Format(L"Processing \"\\x1b\\x04\""));
     _stateMachine->ProcessString(seq);
 }
+
+void InputEngineTest::BatchedInputTest()
+{
+    TestState testState;
+
+    // Keep track of the characters that were written by each call to WriteInput.
+    std::vector<std::wstring> writes;
+    auto pfn = [&writes](std::deque<std::unique_ptr<IInputEvent>>& inEvents) {
+        std::wstring keys;
+        for (const auto& inRec : IInputEvent::ToInputRecords(inEvents))
+        {
+            if (inRec.EventType == KEY_EVENT && inRec.Event.KeyEvent.bKeyDown && inRec.Event.KeyEvent.uChar.UnicodeChar != 0)
+            {
+                keys += inRec.Event.KeyEvent.uChar.UnicodeChar;
+            }
+        }
+        writes.push_back(keys);
+    };
+
+    auto inputEngine = std::make_unique<InputStateMachineEngine>(new TestInteractDispatch(pfn, &testState));
+    auto _stateMachine = std::make_unique<StateMachine>(inputEngine.release());
+    VERIFY_IS_NOT_NULL(_stateMachine);
+    testState._stateMachine = _stateMachine.get();
+
+    Log::Comment(L"Everything in one string should be written all at once.");
+    _stateMachine->ProcessString(std::wstring{ L"one\rtwo\t\x1b[Athree" });
+    VERIFY_ARE_EQUAL(1u, writes.size());
+    VERIFY_ARE_EQUAL(std::wstring{ L"one\rtwo\tthree" }, writes.at(0));
+
+    Log::Comment(L"A Ctrl+C has to arrive after the input before it, and before the input after it.");
+    writes.clear();
+    testState._expectSendCtrlC = true;
+    _stateMachine->ProcessString(std::wstring{ L"ab\x03cd" });
+    VERIFY_ARE_EQUAL(3u, writes.size());
+    VERIFY_ARE_EQUAL(std::wstring{ L"ab" }, writes.at(0));
+    VERIFY_ARE_EQUAL(std::wstring{ L"\x03" }, writes.at(1));
+    VERIFY_ARE_EQUAL(std::wstring{ L"cd" }, writes.at(2));
+}
@@ -397,12 +397,12 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         mach.ProcessCharacter(L'0');
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::OscParam);
         mach.ProcessCharacter(L';');
-        for (int i = 0; i < MAX_PATH; i++) // The buffer is only 256 long, so any longer value should work :P
+        for (int i = 0; i < MAX_PATH; i++) // This used to be longer than the OSC string could be.
         {
             mach.ProcessCharacter(L's');
             VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::OscString);
         }
-        VERIFY_ARE_EQUAL(mach._sOscNextChar, mach.s_cOscStringMaxLength - 1);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(MAX_PATH), mach._oscString.size());
         mach.ProcessCharacter(AsciiChars::BEL);
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
     }
@@ -550,16 +550,19 @@ class StatefulDispatch final : public TermDispatch
 {
 public:
 
-    virtual void Execute(const wchar_t /*wchControl*/) override
+    virtual void Execute(const wchar_t wchControl) override
     {
+        _executed.push_back(wchControl);
     }
 
-    virtual void Print(const wchar_t /*wchPrintable*/) override
+    virtual void Print(const wchar_t wchPrintable) override
     {
+        _printed.push_back(wchPrintable);
     }
 
-    virtual void PrintString(const wchar_t* const /*rgwch*/, const size_t /*cch*/) override
+    virtual void PrintString(const wchar_t* const rgwch, const size_t cch) override
     {
+        _printed.append(rgwch, cch);
     }
 
     StatefulDispatch() :
@@ -591,7 +594,9 @@ public:
         _fIsAltBuffer{ false },
         _fCursorKeysMode{ false },
         _fCursorBlinking{ true },
-        _uiWindowWidth{ 80 }
+        _uiWindowWidth{ 80 },
+        _cBatches{ 0 },
+        _fHyperlink{ false }
     {
         memset(_rgOptions, s_uiGraphicsCleared, sizeof(_rgOptions));
     }
@@ -723,6 +728,12 @@ public:
         return true;
     }
 
+    bool ApplyBatch(const DispatchBatch& batch) override
+    {
+        _cBatches++;
+        return TermDispatch::ApplyBatch(batch);
+    }
+
     bool DeviceStatusReport(const DispatchTypes::AnsiStatusType statusType) override
     {
         _fDeviceStatusReport = true;
@@ -819,6 +830,28 @@ public:
         return true;
     }
 
+    bool SetWindowTitle(std::wstring_view title) override
+    {
+        _title = title;
+        return true;
+    }
+
+    bool AddHyperlink(const std::wstring_view uri, const std::wstring_view id) override
+    {
+        _fHyperlink = true;
+        _hyperlinkUri = uri;
+        _hyperlinkId = id;
+        return true;
+    }
+
+    bool EndHyperlink() override
+    {
+        _fHyperlink = false;
+        _hyperlinkUri.clear();
+        _hyperlinkId.clear();
+        return true;
+    }
+
     unsigned int _uiCursorDistance;
     unsigned int _uiLine;
     unsigned int _uiColumn;
@@ -847,6 +880,13 @@ public:
     bool _fCursorKeysMode;
     bool _fCursorBlinking;
     unsigned int _uiWindowWidth;
+    std::wstring _printed;
+    std::wstring _executed;
+    size_t _cBatches;
+    std::wstring _title;
+    bool _fHyperlink;
+    std::wstring _hyperlinkUri;
+    std::wstring _hyperlinkId;
 
     static const size_t s_cMaxOptions = 16;
     static const unsigned int s_uiGraphicsCleared = UINT_MAX;
@@ -1647,4 +1687,229 @@ class StateMachineExternalTest final
         pDispatch->ClearState();
 
     }
+
+    TEST_METHOD(TestLongPrintableRuns)
+    {
+        StatefulDispatch* pDispatch = new StatefulDispatch;
+        VERIFY_IS_NOT_NULL(pDispatch);
+        StateMachine mach(new OutputStateMachineEngine(pDispatch));
+
+        Log::Comment(L"Controls on either side of every 8 character boundary should split the runs in the right place.");
+        std::wstring input(41, L'a');
+        // Include characters that would look negative as signed 16 bit values.
+        input[3] = L'\x8000';
+        input[12] = L'\xffff';
+        input[20] = L'\x9a';
+        const size_t controls[] = { 0, 7, 8, 15, 16, 17, 31, 40 };
+        for (const auto i : controls)
+        {
+            input[i] = AsciiChars::BEL;
+        }
+
+        std::wstring expectedPrinted;
+        for (const auto wch : input)
+        {
+            if (wch != AsciiChars::BEL)
+            {
+                expectedPrinted.push_back(wch);
+            }
+        }
+
+        mach.ProcessString(input.data(), input.size());
+
+        VERIFY_IS_TRUE(expectedPrinted == pDispatch->_printed);
+        VERIFY_ARE_EQUAL(ARRAYSIZE(controls), pDispatch->_executed.size());
+
+        pDispatch->ClearState();
+
+        Log::Comment(L"A C1 CSI after a long run should start a sequence.");
+        std::wstring sequence(19, L'b');
+        sequence.append(L"\x9b" L"2J");
+        mach.ProcessString(sequence.data(), sequence.size());
+
+        VERIFY_IS_TRUE(std::wstring(19, L'b') == pDispatch->_printed);
+        VERIFY_IS_TRUE(pDispatch->_fEraseDisplay);
+        VERIFY_ARE_EQUAL(DispatchTypes::EraseType::All, pDispatch->_eraseType);
+
+        pDispatch->ClearState();
+    }
+
+    TEST_METHOD(TestInterleavedMachines)
+    {
+        StatefulDispatch* pDispatch1 = new StatefulDispatch;
+        VERIFY_IS_NOT_NULL(pDispatch1);
+        StateMachine mach1(new OutputStateMachineEngine(pDispatch1));
+
+        StatefulDispatch* pDispatch2 = new StatefulDispatch;
+        VERIFY_IS_NOT_NULL(pDispatch2);
+        StateMachine mach2(new OutputStateMachineEngine(pDispatch2));
+
+        Log::Comment(L"A sequence split across strings shouldn't be affected by another machine's strings in between.");
+        mach1.ProcessString(L"\x1b[", 2);
+        mach2.ProcessString(L"Hello", 5);
+        mach1.ProcessString(L"2J", 2);
+
+        VERIFY_IS_TRUE(pDispatch1->_fEraseDisplay);
+        VERIFY_ARE_EQUAL(DispatchTypes::EraseType::All, pDispatch1->_eraseType);
+        VERIFY_IS_TRUE(pDispatch1->_printed.empty());
+
+        VERIFY_IS_FALSE(pDispatch2->_fEraseDisplay);
+        VERIFY_IS_TRUE(std::wstring(L"Hello") == pDispatch2->_printed);
+    }
+
+    TEST_METHOD(TestUtf8Strings)
+    {
+        StatefulDispatch* pDispatch = new StatefulDispatch;
+        VERIFY_IS_NOT_NULL(pDispatch);
+        StateMachine mach(new OutputStateMachineEngine(pDispatch));
+
+        Log::Comment(L"Sequences should be recognized between runs of UTF-8 text.");
+        const std::string text{ "Hello \xc3\xa9\xe2\x82\xac\x1b[2J\xf0\x9f\x98\x80 World" };
+        mach.ProcessUtf8String(text.data(), text.size());
+
+        VERIFY_IS_TRUE(pDispatch->_fEraseDisplay);
+        VERIFY_ARE_EQUAL(DispatchTypes::EraseType::All, pDispatch->_eraseType);
+        VERIFY_IS_TRUE(std::wstring(L"Hello \x00e9\x20ac\xd83d\xde00 World") == pDispatch->_printed);
+
+        Log::Comment(L"Splitting the same string at every byte shouldn't change anything.");
+        for (size_t split = 1; split < text.size(); split++)
+        {
+            pDispatch->ClearState();
+            mach.ProcessUtf8String(text.data(), split);
+            mach.ProcessUtf8String(text.data() + split, text.size() - split);
+
+            VERIFY_IS_TRUE(pDispatch->_fEraseDisplay);
+            VERIFY_IS_TRUE(std::wstring(L"Hello \x00e9\x20ac\xd83d\xde00 World") == pDispatch->_printed);
+        }
+
+        Log::Comment(L"A C1 CSI is encoded as two bytes, and other characters that share its lead byte are printed.");
+        pDispatch->ClearState();
+        const std::string c1{ "\xc2\xa9\xc2\x9b" "2J" };
+        mach.ProcessUtf8String(c1.data(), c1.size());
+
+        VERIFY_IS_TRUE(pDispatch->_fEraseDisplay);
+        VERIFY_IS_TRUE(std::wstring(L"\x00a9") == pDispatch->_printed);
+
+        Log::Comment(L"Invalid bytes should be printed as replacement characters.");
+        pDispatch->ClearState();
+        const std::string invalid{ "a\xe2\x82" "b\xff" };
+        mach.ProcessUtf8String(invalid.data(), invalid.size());
+
+        VERIFY_IS_TRUE(pDispatch->_printed.size() >= 3);
+        VERIFY_ARE_EQUAL(L'a', pDispatch->_printed.front());
+        VERIFY_IS_TRUE(pDispatch->_printed.find(L'b') != std::wstring::npos);
+        VERIFY_IS_TRUE(pDispatch->_printed.find(L'\xfffd') != std::wstring::npos);
+    }
+
+    TEST_METHOD(TestBatchedDispatch)
+    {
+        StatefulDispatch* pDispatch = new StatefulDispatch;
+        VERIFY_IS_NOT_NULL(pDispatch);
+        StateMachine mach(new OutputStateMachineEngine(pDispatch));
+
+        Log::Comment(L"Common operations in one string should reach the dispatch as a single batch.");
+        mach.ProcessString(L"\x1b[1m\x1b[31mHello\r\n\x1b[5;7HWorld\x1b[K");
+
+        VERIFY_ARE_EQUAL(1u, pDispatch->_cBatches);
+        VERIFY_IS_TRUE(std::wstring(L"HelloWorld") == pDispatch->_printed);
+        VERIFY_IS_TRUE(std::wstring(L"\r\n") == pDispatch->_executed);
+        VERIFY_IS_TRUE(pDispatch->_fCursorPosition);
+        VERIFY_ARE_EQUAL(5u, pDispatch->_uiLine);
+        VERIFY_ARE_EQUAL(7u, pDispatch->_uiColumn);
+        VERIFY_IS_TRUE(pDispatch->_fEraseLine);
+
+        Log::Comment(L"Consecutive SGRs are joined into one.");
+        DispatchTypes::GraphicsOptions rgExpected[2];
+        rgExpected[0] = DispatchTypes::GraphicsOptions::BoldBright;
+        rgExpected[1] = DispatchTypes::GraphicsOptions::ForegroundRed;
+        VerifyDispatchTypes(rgExpected, 2, *pDispatch);
+
+        pDispatch->ClearState();
+
+        Log::Comment(L"Anything that isn't batched flushes the batch first, so it's still in order.");
+        mach.ProcessString(L"\x1b[2J\x1b[?25lA");
+
+        VERIFY_ARE_EQUAL(2u, pDispatch->_cBatches);
+        VERIFY_IS_TRUE(pDispatch->_fEraseDisplay);
+        VERIFY_IS_FALSE(pDispatch->_fCursorVisible);
+        VERIFY_IS_TRUE(std::wstring(L"A") == pDispatch->_printed);
+
+        pDispatch->ClearState();
+
+        Log::Comment(L"Characters fed in one at a time are dispatched right away.");
+        mach.ProcessCharacter(L'B');
+
+        VERIFY_ARE_EQUAL(0u, pDispatch->_cBatches);
+        VERIFY_IS_TRUE(std::wstring(L"B") == pDispatch->_printed);
+    }
+
+    TEST_METHOD(TestLongOscStrings)
+    {
+        StatefulDispatch* pDispatch = new StatefulDispatch;
+        VERIFY_IS_NOT_NULL(pDispatch);
+        StateMachine mach(new OutputStateMachineEngine(pDispatch));
+
+        const std::wstring title(4096, L't');
+
+        Log::Comment(L"An OSC string in one string should come through whole, however long it is.");
+        std::wstring sequence = L"\x1b]0;" + title + L"\x07";
+        mach.ProcessString(sequence);
+        VERIFY_IS_TRUE(title == pDispatch->_title);
+
+        pDispatch->ClearState();
+
+        Log::Comment(L"An OSC string split across strings should be kept after the first string is gone.");
+        std::wstring first = L"\x1b]2;" + title.substr(0, 1000);
+        mach.ProcessString(first);
+        first.assign(first.size(), L'x');
+        const std::wstring second = title.substr(1000) + L"\x1b\\";
+        mach.ProcessString(second);
+        VERIFY_IS_TRUE(title == pDispatch->_title);
+
+        pDispatch->ClearState();
+
+        Log::Comment(L"Ignored characters in the middle of an OSC string shouldn't end up in it.");
+        mach.ProcessString(L"\x1b]0;ab\x01" L"cd\x07");
+        VERIFY_IS_TRUE(std::wstring(L"abcd") == pDispatch->_title);
+
+        pDispatch->ClearState();
+
+        Log::Comment(L"An empty OSC string is still a title.");
+        pDispatch->_title = L"old";
+        mach.ProcessString(L"\x1b]0;\x07");
+        VERIFY_IS_TRUE(pDispatch->_title.empty());
+    }
+
+    TEST_METHOD(TestOscHyperlink)
+    {
+        StatefulDispatch* pDispatch = new StatefulDispatch;
+        VERIFY_IS_NOT_NULL(pDispatch);
+        StateMachine mach(new OutputStateMachineEngine(pDispatch));
+
+        Log::Comment(L"A link without params.");
+        mach.ProcessString(L"\x1b]8;;https://example.com/a;b\x1b\\");
+        VERIFY_IS_TRUE(pDispatch->_fHyperlink);
+        VERIFY_IS_TRUE(std::wstring(L"https://example.com/a;b") == pDispatch->_hyperlinkUri);
+        VERIFY_IS_TRUE(pDispatch->_hyperlinkId.empty());
+
+        Log::Comment(L"Text after it isn't part of the sequence.");
+        mach.ProcessString(L"file\x1b]8;;\x1b\\");
+        VERIFY_IS_TRUE(std::wstring(L"file") == pDispatch->_printed);
+        VERIFY_IS_FALSE(pDispatch->_fHyperlink);
+
+        pDispatch->ClearState();
+
+        Log::Comment(L"The id is picked out of the params, and the rest are ignored.");
+        mach.ProcessString(L"\x1b]8;foo=bar:id=42;file:///tmp\x07");
+        VERIFY_IS_TRUE(pDispatch->_fHyperlink);
+        VERIFY_IS_TRUE(std::wstring(L"file:///tmp") == pDispatch->_hyperlinkUri);
+        VERIFY_IS_TRUE(std::wstring(L"42") == pDispatch->_hyperlinkId);
+
+        pDispatch->ClearState();
+
+        Log::Comment(L"Without the second ';' it isn't a link at all.");
+        mach.ProcessString(L"\x1b]8;https://example.com\x07");
+        VERIFY_IS_FALSE(pDispatch->_fHyperlink);
+        VERIFY_IS_TRUE(pDispatch->_hyperlinkUri.empty());
+    }
 };
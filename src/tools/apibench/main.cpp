@@ -0,0 +1,208 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// ApiBench measures what each call into the console costs, round trip, for a
+//      few of the calls that apps make the most. Run it in the console that's
+//      being measured (the OpenConsole.exe built from this tree, for instance).
+// Each call is made over and over, a few rounds of it, and the fastest round
+//      is reported, in nanoseconds per call.
+// With -etw, it's measured twice: once with nobody listening to the console
+//      host's events, then again with a trace session of our own enabling its
+//      API events, to show what tracing adds to every call. Starting a trace
+//      session needs the benchmark to be run elevated.
+
+#include <windows.h>
+#include <evntrace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cwchar>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <wil/resource.h>
+
+// Microsoft.Windows.Console.Host, see host/telemetry.cpp
+static constexpr GUID s_conhostProvider = { 0xfe1ff234, 0x1f09, 0x50a8, { 0xd3, 0x8d, 0xc4, 0x4f, 0xab, 0x43, 0xe8, 0x18 } };
+// TraceKeywords::API, see host/tracing.cpp
+static constexpr ULONGLONG s_apiKeyword = 0x400;
+static constexpr wchar_t s_sessionName[] = L"ApiBench";
+
+static constexpr size_t s_callsPerRound = 20000;
+static constexpr size_t s_rounds = 5;
+
+struct Benchmark
+{
+    const wchar_t* name;
+    std::function<void()> call;
+};
+
+// Function Description:
+// - Makes the given call over and over, and keeps the fastest round of them.
+// Arguments:
+// - call: the call to measure
+// Return Value:
+// - How long one call took, in nanoseconds.
+static double _Measure(const std::function<void()>& call)
+{
+    double best = 0;
+    for (size_t round = 0; round < s_rounds; ++round)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < s_callsPerRound; ++i)
+        {
+            call();
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        const double perCall = elapsed.count() / s_callsPerRound;
+        best = round == 0 ? perCall : std::min(best, perCall);
+    }
+    return best;
+}
+
+// A trace session of our own, written to a file in %TEMP%, that listens to
+//      the console host's API events for as long as it's around.
+class TraceSession final
+{
+public:
+    TraceSession() :
+        _properties(sizeof(EVENT_TRACE_PROPERTIES) + sizeof(s_sessionName) + MAX_PATH * sizeof(wchar_t)),
+        _handle{ 0 }
+    {
+        auto& properties = *_Properties();
+        properties.Wnode.BufferSize = _Size();
+        properties.Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+        properties.Wnode.ClientContext = 1; // QueryPerformanceCounter
+        properties.LogFileMode = EVENT_TRACE_FILE_MODE_SEQUENTIAL;
+        properties.LoggerNameOffset = sizeof(EVENT_TRACE_PROPERTIES);
+        properties.LogFileNameOffset = sizeof(EVENT_TRACE_PROPERTIES) + sizeof(s_sessionName);
+
+        wchar_t* const logFile = reinterpret_cast<wchar_t*>(_properties.data() + properties.LogFileNameOffset);
+        const DWORD length = GetTempPathW(MAX_PATH, logFile);
+        THROW_LAST_ERROR_IF(length == 0 || length > MAX_PATH - 16);
+        wcscat_s(logFile, MAX_PATH, L"ApiBench.etl");
+
+        // Stop a session that an earlier run of ours left behind.
+        ControlTraceW(0, s_sessionName, _Properties(), EVENT_TRACE_CONTROL_STOP);
+        properties.Wnode.BufferSize = _Size();
+
+        THROW_IF_WIN32_ERROR(StartTraceW(&_handle, s_sessionName, _Properties()));
+        THROW_IF_WIN32_ERROR(EnableTraceEx2(_handle,
+                                            &s_conhostProvider,
+                                            EVENT_CONTROL_CODE_ENABLE_PROVIDER,
+                                            TRACE_LEVEL_VERBOSE,
+                                            s_apiKeyword,
+                                            0,
+                                            0,
+                                            nullptr));
+    }
+
+    ~TraceSession()
+    {
+        ControlTraceW(_handle, nullptr, _Properties(), EVENT_TRACE_CONTROL_STOP);
+    }
+
+    TraceSession(const TraceSession&) = delete;
+    TraceSession& operator=(const TraceSession&) = delete;
+
+private:
+    std::vector<BYTE> _properties;
+    TRACEHANDLE _handle;
+
+    EVENT_TRACE_PROPERTIES* _Properties() noexcept
+    {
+        return reinterpret_cast<EVENT_TRACE_PROPERTIES*>(_properties.data());
+    }
+
+    ULONG _Size() const noexcept
+    {
+        return static_cast<ULONG>(_properties.size());
+    }
+};
+
+static void _Run(const std::vector<Benchmark>& benchmarks, std::vector<double>& results)
+{
+    for (const auto& benchmark : benchmarks)
+    {
+        results.push_back(_Measure(benchmark.call));
+    }
+}
+
+int __cdecl wmain(int argc, wchar_t* argv[])
+{
+    const bool withTracing = argc > 1 && _wcsicmp(argv[1], L"-etw") == 0;
+
+    const HANDLE input = GetStdHandle(STD_INPUT_HANDLE);
+    const HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+
+    CONSOLE_SCREEN_BUFFER_INFO info{};
+    if (!GetConsoleScreenBufferInfo(output, &info))
+    {
+        fwprintf(stderr, L"ApiBench has to be run in a console, with its output not redirected.\n");
+        return 1;
+    }
+
+    // Everything is written to a screen buffer of our own, so what's drawn
+    //      while we're measuring doesn't scroll away what we print.
+    wil::unique_handle buffer{ CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE, 0, nullptr, CONSOLE_TEXTMODE_BUFFER, nullptr) };
+    if (!buffer)
+    {
+        fwprintf(stderr, L"Couldn't create a screen buffer: %u\n", GetLastError());
+        return 1;
+    }
+
+    const HANDLE target = buffer.get();
+    const std::vector<Benchmark> benchmarks{
+        { L"GetConsoleMode", [=]() { DWORD mode; GetConsoleMode(target, &mode); } },
+        { L"GetConsoleScreenBufferInfo", [=]() { CONSOLE_SCREEN_BUFFER_INFO sbi; GetConsoleScreenBufferInfo(target, &sbi); } },
+        { L"SetConsoleCursorPosition", [=]() { SetConsoleCursorPosition(target, { 0, 0 }); } },
+        { L"SetConsoleTextAttribute", [=]() { SetConsoleTextAttribute(target, FOREGROUND_GREEN); } },
+        { L"GetNumberOfConsoleInputEvents", [=]() { DWORD events; GetNumberOfConsoleInputEvents(input, &events); } },
+        { L"WriteConsoleW (1 char)", [=]() { DWORD written; WriteConsoleW(target, L"x", 1, &written, nullptr); } },
+        { L"WriteConsoleA (80 chars)", [=]() {
+             static const std::string line(80, 'x');
+             DWORD written;
+             WriteConsoleA(target, line.data(), static_cast<DWORD>(line.size()), &written, nullptr);
+         } },
+    };
+
+    std::vector<double> untraced;
+    std::vector<double> traced;
+    try
+    {
+        _Run(benchmarks, untraced);
+        if (withTracing)
+        {
+            TraceSession session;
+            _Run(benchmarks, traced);
+        }
+    }
+    catch (const wil::ResultException& e)
+    {
+        fwprintf(stderr, L"Couldn't start the trace session (0x%08x). -etw has to be run elevated.\n", e.GetErrorCode());
+        return 1;
+    }
+
+    buffer.reset();
+
+    wprintf(L"%-32s %12s", L"API", L"ns/call");
+    if (withTracing)
+    {
+        wprintf(L" %12s %12s", L"traced", L"overhead");
+    }
+    wprintf(L"\n");
+
+    for (size_t i = 0; i < benchmarks.size(); ++i)
+    {
+        wprintf(L"%-32s %12.0f", benchmarks[i].name, untraced[i]);
+        if (withTracing)
+        {
+            wprintf(L" %12.0f %12.0f", traced[i], traced[i] - untraced[i]);
+        }
+        wprintf(L"\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,245 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// BufferBench measures the primitives of buffer/out on their own, without a
+//      console or a renderer around them, so that a change to how the buffer
+//      lays out its data can be weighed by itself. A TextBuffer of the given
+//      size is filled with text in a handful of colors, and each benchmark is
+//      run over and over until enough time has passed:
+//   * WriteCells: a whole row is written, through ROW::WriteCells.
+//   * InsertAttrRuns: a run of color is put in the middle of a row.
+//   * PackAttrs: a row's worth of attributes is packed into runs.
+//   * CellIterator: every cell of the buffer is visited, through a TextBufferCellIterator.
+//   * IncrementCircularBuffer: the buffer circles by one row.
+//   * ResizeTraditional: the buffer is resized, back and forth between two sizes.
+//   * GetTextForClipboard: the whole buffer is copied, the way the clipboard does it.
+// For each, we report the time it took and what that comes to per cell.
+
+#include "LibraryIncludes.h"
+
+#include "../../inc/operators.hpp"
+#include "../../inc/unicode.hpp"
+#include "../../buffer/out/textBuffer.hpp"
+#include "../../renderer/inc/DummyRenderTarget.hpp"
+
+// Every benchmark is run until at least this much time has passed.
+static constexpr double s_secondsPerBenchmark = 1.0;
+static constexpr UINT s_cursorSize = 12;
+
+struct BenchmarkResult
+{
+    size_t iterations;
+    double seconds;
+};
+
+// Function Description:
+// - Runs the given operation until enough time has passed.
+// Arguments:
+// - operation: the operation to time.
+// Return Value:
+// - How many times it ran, and how long that took altogether.
+template<typename T>
+static BenchmarkResult _Run(T operation)
+{
+    BenchmarkResult result{};
+    const auto start = std::chrono::steady_clock::now();
+    do
+    {
+        operation();
+        ++result.iterations;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (result.seconds < s_secondsPerBenchmark);
+    return result;
+}
+
+static void _Report(const wchar_t* const name, const BenchmarkResult& result, const size_t cellsPerIteration)
+{
+    const double iterations = static_cast<double>(std::max<size_t>(result.iterations, 1));
+    const double microseconds = result.seconds * 1000000.0 / iterations;
+    wprintf(L"%-24s %9zu iterations: %12.2f us/iteration %9.2f ns/cell\n",
+            name,
+            result.iterations,
+            microseconds,
+            microseconds * 1000.0 / static_cast<double>(std::max<size_t>(cellsPerIteration, 1)));
+}
+
+// A text buffer full of text, and the benchmarks that are run on it.
+class BufferBench final
+{
+public:
+    BufferBench(const COORD size) :
+        _size{ size },
+        _buffer{ size, TextAttribute{ 0x07 }, s_cursorSize, _renderTarget },
+        _line{ _MakeLine(size.X) },
+        _colors{ _MakeColors(size.X) }
+    {
+        for (SHORT y = 0; y < size.Y; ++y)
+        {
+            _WriteRow(_buffer.GetRowByOffset(y));
+        }
+    }
+
+    void WriteCells()
+    {
+        _WriteRow(_buffer.GetRowByOffset(_nextRow));
+        _nextRow = (_nextRow + 1) % _size.Y;
+    }
+
+    void InsertAttrRuns()
+    {
+        const TextAttributeRun run{ static_cast<size_t>(_size.X / 4), TextAttribute{ static_cast<WORD>(_nextRow % 16) } };
+        auto& attrRow = _buffer.GetRowByOffset(_nextRow).GetAttrRow();
+        THROW_IF_FAILED(attrRow.InsertAttrRuns({ &run, 1 }, _size.X / 2, _size.X / 2 + run.GetLength() - 1, _size.X));
+        _nextRow = (_nextRow + 1) % _size.Y;
+    }
+
+    void PackAttrs()
+    {
+        const auto runs = ATTR_ROW::PackAttrs(_colors);
+        _sink += runs.size();
+    }
+
+    void IterateCells()
+    {
+        for (auto it = _buffer.GetCellDataAt({ 0, 0 }); it; ++it)
+        {
+            _sink += it->Columns();
+        }
+    }
+
+    void IncrementCircularBuffer()
+    {
+        _buffer.IncrementCircularBuffer();
+    }
+
+    void ResizeTraditional()
+    {
+        // Half as wide and a few rows shorter, then back, so that rows are
+        //      both cut down and grown again, and renumbered each time.
+        _resized = !_resized;
+        const COORD newSize = _resized ? COORD{ std::max<SHORT>(1, _size.X / 2), std::max<SHORT>(1, _size.Y - 10) } : _size;
+        THROW_IF_FAILED(_buffer.ResizeTraditional(newSize));
+    }
+
+    void GetTextForClipboard()
+    {
+        static const std::function<COLORREF(TextAttribute&)> getForeground = [](TextAttribute& attr) -> COLORREF { return attr.GetLegacyAttributes() & 0x0F; };
+        static const std::function<COLORREF(TextAttribute&)> getBackground = [](TextAttribute& attr) -> COLORREF { return (attr.GetLegacyAttributes() & 0xF0) >> 4; };
+
+        const auto size = _buffer.GetSize();
+        const std::vector<SMALL_RECT> selection{ size.ToInclusive() };
+        const auto text = _buffer.GetTextForClipboard(true, true, selection, getForeground, getBackground);
+        _sink += text.text.size();
+    }
+
+    size_t Cells() const noexcept
+    {
+        return static_cast<size_t>(_size.X) * _size.Y;
+    }
+
+    size_t RowCells() const noexcept
+    {
+        return _size.X;
+    }
+
+    size_t Sink() const noexcept
+    {
+        return _sink;
+    }
+
+private:
+    // Function Description:
+    // - Makes a row of text that looks like what a colored build log would
+    //      print, in a new color every few cells, with some of it not ASCII.
+    static std::vector<OutputCell> _MakeLine(const SHORT width)
+    {
+        static constexpr std::wstring_view text{ L"Compiling src/buffer/out/textBuffer.cpp caf\x00e9 \x2502 box " };
+        std::vector<OutputCell> cells;
+        cells.reserve(width);
+        for (SHORT x = 0; x < width; ++x)
+        {
+            const TextAttribute attr{ static_cast<WORD>((x / 8) % 16) };
+            cells.emplace_back(text.substr(x % text.size(), 1), DbcsAttribute{}, attr);
+        }
+        return cells;
+    }
+
+    static std::vector<TextAttribute> _MakeColors(const SHORT width)
+    {
+        std::vector<TextAttribute> colors;
+        colors.reserve(width);
+        for (SHORT x = 0; x < width; ++x)
+        {
+            colors.emplace_back(static_cast<WORD>((x / 8) % 16));
+        }
+        return colors;
+    }
+
+    void _WriteRow(ROW& row)
+    {
+        row.WriteCells(OutputCellIterator{ std::basic_string_view<OutputCell>{ _line.data(), _line.size() } }, 0, false);
+    }
+
+    const COORD _size;
+    DummyRenderTarget _renderTarget;
+    TextBuffer _buffer;
+    const std::vector<OutputCell> _line;
+    const std::vector<TextAttribute> _colors;
+    SHORT _nextRow{ 0 };
+    bool _resized{ false };
+    // Whatever the benchmarks compute goes here, so that none of it is optimized away.
+    size_t _sink{ 0 };
+};
+
+static void _Usage()
+{
+    wprintf(L"usage: BufferBench [--size <columns> <rows>]\n");
+}
+
+int __cdecl wmain(int argc, WCHAR* argv[])
+{
+    COORD size{ 120, 9001 };
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::wstring_view arg{ argv[i] };
+        if (arg == L"--size" && i + 2 < argc)
+        {
+            size.X = gsl::narrow<SHORT>(std::stoi(argv[++i]));
+            size.Y = gsl::narrow<SHORT>(std::stoi(argv[++i]));
+        }
+        else
+        {
+            _Usage();
+            return 1;
+        }
+    }
+
+    try
+    {
+        wprintf(L"Measuring a %dx%d buffer\n", size.X, size.Y);
+
+        {
+            BufferBench bench{ size };
+            _Report(L"WriteCells", _Run([&]() { bench.WriteCells(); }), bench.RowCells());
+            _Report(L"InsertAttrRuns", _Run([&]() { bench.InsertAttrRuns(); }), bench.RowCells());
+            _Report(L"PackAttrs", _Run([&]() { bench.PackAttrs(); }), bench.RowCells());
+            _Report(L"CellIterator", _Run([&]() { bench.IterateCells(); }), bench.Cells());
+            _Report(L"IncrementCircularBuffer", _Run([&]() { bench.IncrementCircularBuffer(); }), bench.RowCells());
+            _Report(L"GetTextForClipboard", _Run([&]() { bench.GetTextForClipboard(); }), bench.Cells());
+            wprintf(L"(%zu)\n", bench.Sink());
+        }
+
+        // Resizing leaves the buffer a different size, so it gets one of its own.
+        {
+            BufferBench bench{ size };
+            _Report(L"ResizeTraditional", _Run([&]() { bench.ResizeTraditional(); }), bench.Cells());
+        }
+    }
+    catch (...)
+    {
+        wprintf(L"failed: 0x%08x\n", static_cast<unsigned int>(wil::ResultFromCaughtException()));
+        return 1;
+    }
+
+    return 0;
+}
@@ -10,7 +10,10 @@
 #include <stdlib.h>     /* srand, rand */
 #include <time.h>       /* time */
 
+#include <algorithm>
+#include <chrono>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <string>
@@ -45,12 +48,211 @@ void print256color(int bg)
     printf("\x1b[48;5;%dm", bg); // save cursor
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Stress mode
+// Allocates a couple of screen buffers as big as a maximized window can use,
+//      fills them, resizes them back and forth and switches between them, and
+//      reports how long each of those took. Those are what a user with a big
+//      buffer waits on when they maximize the window.
+
+// The tallest buffer the properties sheet lets anyone ask for.
+static constexpr SHORT s_maxHeight = 9999;
+static constexpr size_t s_buffers = 2;
+static constexpr size_t s_rounds = 5;
+// WriteConsoleOutput doesn't take much more than 64KB in one call.
+static constexpr size_t s_maxCellsPerWrite = 8192;
+
+struct Timing
+{
+    const wchar_t* name;
+    size_t count = 0;
+    double total = 0;
+    double fastest = 0;
+    double slowest = 0;
+
+    void Add(const double milliseconds)
+    {
+        fastest = count == 0 ? milliseconds : std::min(fastest, milliseconds);
+        slowest = std::max(slowest, milliseconds);
+        total += milliseconds;
+        ++count;
+    }
+};
+
+// Function Description:
+// - Times the given operation, and adds it to the timing.
+// Arguments:
+// - timing: where to keep how long it took
+// - operation: the operation to time. It returns false if it failed.
+// Return Value:
+// - true if the operation succeeded.
+static bool Time(Timing& timing, const std::function<bool()>& operation)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const bool succeeded = operation();
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if (succeeded)
+    {
+        timing.Add(elapsed.count());
+    }
+    return succeeded;
+}
+
+// Function Description:
+// - Fills the whole buffer through WriteConsoleOutputW, with a different
+//   color for every few cells, so there are plenty of attribute runs. Then a
+//   surrogate pair is written into every row, so that the buffer has plenty to
+//   keep in its UnicodeStorage, too.
+// Arguments:
+// - buffer: the screen buffer to fill
+// - size: how big it is
+// Return Value:
+// - true if it was all written.
+static bool Fill(const HANDLE buffer, const COORD size)
+{
+    const SHORT rowsPerWrite = static_cast<SHORT>(std::max<size_t>(1, s_maxCellsPerWrite / size.X));
+    std::vector<CHAR_INFO> cells(static_cast<size_t>(size.X) * rowsPerWrite);
+    for (size_t i = 0; i < cells.size(); ++i)
+    {
+        cells[i].Char.UnicodeChar = static_cast<wchar_t>(L'!' + i % 94);
+        cells[i].Attributes = static_cast<WORD>((i / 7) % 256);
+    }
+
+    for (SHORT top = 0; top < size.Y; top += rowsPerWrite)
+    {
+        SMALL_RECT region{ 0, top, size.X - 1, static_cast<SHORT>(std::min<int>(top + rowsPerWrite, size.Y) - 1) };
+        if (!WriteConsoleOutputW(buffer, cells.data(), { size.X, rowsPerWrite }, { 0, 0 }, &region))
+        {
+            return false;
+        }
+    }
+
+    static constexpr wchar_t glyph[] = L"\xD83D\xDE00";
+    for (SHORT row = 0; row < size.Y; ++row)
+    {
+        DWORD written = 0;
+        if (!SetConsoleCursorPosition(buffer, { static_cast<SHORT>(row % std::max(1, size.X - 1)), row }) ||
+            !WriteConsoleW(buffer, glyph, 2, &written, nullptr))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function Description:
+// - Runs the stress mode, and prints how long everything took.
+// Arguments:
+// - width, height: how big the buffers should be. 0 for as big as we can.
+// Return Value:
+// - 0 if everything it tried worked.
+static int Stress(SHORT width, SHORT height)
+{
+    CONSOLE_SCREEN_BUFFER_INFO info{};
+    if (!GetConsoleScreenBufferInfo(hOut, &info))
+    {
+        fwprintf(stderr, L"buffersize has to be run in a console, with its output not redirected.\n");
+        return 1;
+    }
+
+    const COORD window{ static_cast<SHORT>(info.srWindow.Right - info.srWindow.Left + 1),
+                        static_cast<SHORT>(info.srWindow.Bottom - info.srWindow.Top + 1) };
+    const COORD largest = GetLargestConsoleWindowSize(hOut);
+    const COORD maximum{ width > 0 ? width : std::max(largest.X, window.X),
+                         height > 0 ? height : s_maxHeight };
+    // What's resized between: all of it, the width of the window, and barely
+    //      any more than the window.
+    const std::vector<COORD> sizes{ maximum,
+                                    { window.X, maximum.Y },
+                                    { maximum.X, static_cast<SHORT>(std::min<int>(window.Y * 2, maximum.Y)) },
+                                    maximum };
+
+    Timing create{ L"CreateConsoleScreenBuffer" };
+    Timing allocate{ L"SetConsoleScreenBufferSize (allocate)" };
+    Timing fill{ L"Fill (WriteConsoleOutputW)" };
+    Timing resize{ L"SetConsoleScreenBufferSize (resize)" };
+    Timing activate{ L"SetConsoleActiveScreenBuffer" };
+
+    const auto fail = [](const wchar_t* what) {
+        fwprintf(stderr, L"%s failed: %u\n", what, GetLastError());
+        return 1;
+    };
+
+    wprintf(L"Stressing %zu buffers of %dx%d, %zu rounds\n", s_buffers, maximum.X, maximum.Y, s_rounds);
+
+    std::vector<wil::unique_handle> buffers;
+    for (size_t i = 0; i < s_buffers; ++i)
+    {
+        wil::unique_handle buffer;
+        if (!Time(create, [&]() {
+                buffer.reset(CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE, 0, nullptr, CONSOLE_TEXTMODE_BUFFER, nullptr));
+                return !!buffer;
+            }))
+        {
+            return fail(create.name);
+        }
+        if (!Time(allocate, [&]() { return !!SetConsoleScreenBufferSize(buffer.get(), maximum); }))
+        {
+            return fail(allocate.name);
+        }
+        buffers.emplace_back(std::move(buffer));
+    }
+
+    // Whatever goes wrong, the buffer we started in is what's left on screen.
+    auto restore = wil::scope_exit([&]() { SetConsoleActiveScreenBuffer(hOut); });
+
+    for (size_t round = 0; round < s_rounds; ++round)
+    {
+        for (const auto& buffer : buffers)
+        {
+            if (!Time(activate, [&]() { return !!SetConsoleActiveScreenBuffer(buffer.get()); }))
+            {
+                return fail(activate.name);
+            }
+            if (!Time(fill, [&]() { return Fill(buffer.get(), maximum); }))
+            {
+                return fail(fill.name);
+            }
+            for (const auto size : sizes)
+            {
+                if (!Time(resize, [&]() { return !!SetConsoleScreenBufferSize(buffer.get(), size); }))
+                {
+                    return fail(resize.name);
+                }
+            }
+        }
+    }
+
+    restore.reset();
+    buffers.clear();
+
+    wprintf(L"%-40s %6s %10s %10s %10s\n", L"Operation", L"count", L"fastest", L"average", L"slowest");
+    for (const auto& timing : { create, allocate, fill, resize, activate })
+    {
+        wprintf(L"%-40s %6zu %8.2fms %8.2fms %8.2fms\n",
+                timing.name,
+                timing.count,
+                timing.fastest,
+                timing.count ? timing.total / timing.count : 0.0,
+                timing.slowest);
+    }
+    return 0;
+}
+
 // bin\x64\Debug\buffersize.exe
-int __cdecl wmain(int /*argc*/, WCHAR* /*argv[]*/)
+// bin\x64\Debug\buffersize.exe -stress [width height]
+int __cdecl wmain(int argc, WCHAR* argv[])
 {
     hOut = GetStdHandle(STD_OUTPUT_HANDLE);
     hIn = GetStdHandle(STD_INPUT_HANDLE);
 
+    if (argc > 1 && _wcsicmp(argv[1], L"-stress") == 0)
+    {
+        const SHORT width = argc > 3 ? static_cast<SHORT>(_wtoi(argv[2])) : 0;
+        const SHORT height = argc > 3 ? static_cast<SHORT>(_wtoi(argv[3])) : 0;
+        return Stress(width, height);
+    }
+
     DWORD dwMode = 0;
     THROW_LAST_ERROR_IF(!GetConsoleMode(hOut, &dwMode));
     dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
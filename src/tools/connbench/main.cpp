@@ -0,0 +1,340 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// ConnBench measures how fast output gets from a connection into a Terminal.
+// Each run feeds a headless Terminal (with a render target that draws nothing)
+//      from one of these transports:
+//   * echo: chunks of UTF-16 handed straight to the terminal, the way the
+//      EchoConnection hands its output to the TermControl.
+//   * pipe: a conhost, launched like the ConhostConnection does, running a
+//      copy of this program that writes the payload. Its output is read off
+//      of the pipe in 64K reads, one at a time, and parsed as UTF-8.
+//   * ring: the same, but conhost writes into a SharedRing instead of the
+//      pipe. This needs the conhost.exe that's built from this tree to be
+//      found first on the search path (next to ConnBench.exe will do).
+// For each run, we report the throughput, the longest it took to parse a
+//      single chunk, and how many allocations were made while it ran.
+
+#include "LibraryIncludes.h"
+
+#include "../../cascadia/TerminalCore/Terminal.hpp"
+#include "../../renderer/inc/DummyRenderTarget.hpp"
+#include "../../types/inc/SharedRing.hpp"
+#include "../../types/inc/convert.hpp"
+#include <conpty-universal.h>
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Types;
+
+static std::atomic<size_t> s_allocations{ 0 };
+static std::atomic<size_t> s_allocatedBytes{ 0 };
+
+// Every allocation in the process is counted, so that we can tell how many
+//      of them feeding the terminal costs us.
+void* __cdecl operator new(size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* const p = malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void __cdecl operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+struct RunResult
+{
+    size_t bytes;
+    size_t chunks;
+    double seconds;
+    double peakChunkMs;
+    size_t allocations;
+    size_t allocatedBytes;
+};
+
+// Feeds a terminal, keeping track of how long each chunk took.
+class TerminalSink final
+{
+public:
+    TerminalSink()
+    {
+        _terminal.Create({ 120, 30 }, 9001, _renderTarget);
+    }
+
+    template<typename T>
+    void Feed(const T chunk)
+    {
+        if (_result.chunks == 0)
+        {
+            _start = std::chrono::steady_clock::now();
+            _startAllocations = s_allocations.load();
+            _startAllocatedBytes = s_allocatedBytes.load();
+        }
+
+        const auto before = std::chrono::steady_clock::now();
+        _terminal.Write(chunk);
+        const auto after = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double, std::milli> elapsed = after - before;
+        _result.peakChunkMs = std::max(_result.peakChunkMs, elapsed.count());
+        _result.bytes += chunk.size() * sizeof(typename T::value_type);
+        ++_result.chunks;
+        _end = after;
+    }
+
+    RunResult Finish()
+    {
+        if (_result.chunks != 0)
+        {
+            _result.seconds = std::chrono::duration<double>(_end - _start).count();
+            _result.allocations = s_allocations.load() - _startAllocations;
+            _result.allocatedBytes = s_allocatedBytes.load() - _startAllocatedBytes;
+        }
+        return _result;
+    }
+
+private:
+    DummyRenderTarget _renderTarget;
+    Terminal _terminal;
+    RunResult _result{};
+    std::chrono::steady_clock::time_point _start;
+    std::chrono::steady_clock::time_point _end;
+    size_t _startAllocations{};
+    size_t _startAllocatedBytes{};
+};
+
+// Function Description:
+// - Makes some output that looks like what a build or a log tail would print:
+//      lines of text, some of it colored, a few of them not ASCII.
+static std::string _MakePayload(const size_t size)
+{
+    static constexpr std::string_view lines[]{
+        "Compiling src/buffer/out/textBuffer.cpp\r\n",
+        "\x1b[32m  PASSED\x1b[m TextBufferTests::TestWrappedRowsAreCopied\r\n",
+        "\x1b[1;33mwarning\x1b[m C4100: 'args': unreferenced formal parameter\r\n",
+        "2019-05-13T10:42:17.123Z info  caf\xC3\xA9 \xE2\x94\x82 \xE6\xBC\xA2\xE5\xAD\x97 request served in 12ms\r\n",
+        "\x1b[38;2;255;128;0mtruecolor\x1b[48;5;17m 256 color \x1b[m plain text to the end of the line\r\n",
+    };
+
+    std::string payload;
+    payload.reserve(size);
+    for (size_t i = 0; payload.size() < size; ++i)
+    {
+        payload.append(lines[i % ARRAYSIZE(lines)]);
+    }
+    return payload;
+}
+
+// Function Description:
+// - The synthetic child: writes the payload to stdout, then exits.
+static int _RunChild(const size_t size)
+{
+    const auto payload = _MakePayload(size);
+    const auto out = GetStdHandle(STD_OUTPUT_HANDLE);
+
+    std::string_view remaining{ payload };
+    while (!remaining.empty())
+    {
+        const auto write = std::min<size_t>(remaining.size(), 16 * 1024);
+        DWORD written = 0;
+        if (!WriteFile(out, remaining.data(), static_cast<DWORD>(write), &written, nullptr))
+        {
+            return 1;
+        }
+        remaining.remove_prefix(written);
+    }
+    return 0;
+}
+
+// Function Description:
+// - Feeds the payload to a terminal in chunks of UTF-16, like the EchoConnection does.
+static RunResult _RunEcho(const size_t size, const size_t chunkSize)
+{
+    const auto payload = _MakePayload(size);
+    const auto wide = ConvertToW(CP_UTF8, payload);
+    std::wstring_view remaining{ wide };
+
+    TerminalSink sink;
+    while (!remaining.empty())
+    {
+        auto chunk = remaining.substr(0, chunkSize);
+        if (chunk.size() < remaining.size() && IS_HIGH_SURROGATE(chunk.back()))
+        {
+            chunk.remove_suffix(1);
+        }
+        sink.Feed(chunk);
+        remaining.remove_prefix(chunk.size());
+    }
+    return sink.Finish();
+}
+
+// Function Description:
+// - Runs a copy of ourselves that writes the payload under a conhost, and
+//      feeds whatever conhost renders to a terminal, as it arrives.
+// Arguments:
+// - size: how many bytes the child should write
+// - useRing: read conhost's output from a shared ring, instead of the pipe
+static RunResult _RunConpty(const size_t size, const bool useRing)
+{
+    std::wstring self(MAX_PATH, L'\0');
+    self.resize(GetModuleFileNameW(nullptr, self.data(), gsl::narrow<DWORD>(self.size())));
+    const auto cmdline = L"\"" + self + L"\" --child " + std::to_wstring(size);
+
+    std::unique_ptr<SharedRing> ring;
+    if (useRing)
+    {
+        THROW_IF_FAILED(SharedRing::s_Create(SharedRing::DefaultCapacity, ring));
+        THROW_IF_FAILED(ring->SetInheritable(true));
+    }
+
+    wil::unique_handle input;
+    wil::unique_handle output;
+    wil::unique_handle signal;
+    wil::unique_process_information pi;
+    THROW_IF_FAILED(CreateConPty(cmdline,
+                                 std::nullopt,
+                                 120,
+                                 30,
+                                 input.addressof(),
+                                 output.addressof(),
+                                 signal.addressof(),
+                                 &pi,
+                                 {},
+                                 ring ? ring->GetSection() : nullptr));
+
+    std::vector<char> buffer(64 * 1024);
+    TerminalSink sink;
+    if (ring)
+    {
+        THROW_IF_FAILED(ring->SetInheritable(false));
+
+        const HANDLE waits[]{ ring->GetDataEvent(), pi.hProcess };
+        bool exited = false;
+        while (true)
+        {
+            const auto read = ring->Read(buffer.data(), buffer.size());
+            if (read != 0)
+            {
+                sink.Feed(std::string_view{ buffer.data(), read });
+            }
+            else if (exited)
+            {
+                break;
+            }
+            else if (WaitForMultipleObjects(ARRAYSIZE(waits), waits, FALSE, INFINITE) != WAIT_OBJECT_0)
+            {
+                exited = true;
+            }
+        }
+    }
+    else
+    {
+        // The output pipe is overlapped, so even a plain read needs an OVERLAPPED.
+        wil::unique_event readDone{ wil::EventOptions::ManualReset };
+        OVERLAPPED overlapped{};
+        overlapped.hEvent = readDone.get();
+
+        DWORD read = 0;
+        while (ReadFile(output.get(), buffer.data(), gsl::narrow<DWORD>(buffer.size()), nullptr, &overlapped) ||
+               GetLastError() == ERROR_IO_PENDING)
+        {
+            if (!GetOverlappedResult(output.get(), &overlapped, &read, TRUE))
+            {
+                break;
+            }
+            if (read != 0)
+            {
+                sink.Feed(std::string_view{ buffer.data(), read });
+            }
+        }
+    }
+
+    TerminateProcess(pi.hProcess, 0);
+    return sink.Finish();
+}
+
+static void _Report(const wchar_t* const name, const size_t size, const RunResult& result)
+{
+    const double mb = result.bytes / (1024.0 * 1024.0);
+    wprintf(L"%-5s child wrote %8.1f MB, terminal got %8.1f MB in %6zu chunks: %8.1f MB/s, "
+            L"peak %7.2f ms/chunk, %8zu allocations (%.1f MB)\n",
+            name,
+            size / (1024.0 * 1024.0),
+            mb,
+            result.chunks,
+            result.seconds > 0 ? mb / result.seconds : 0.0,
+            result.peakChunkMs,
+            result.allocations,
+            result.allocatedBytes / (1024.0 * 1024.0));
+}
+
+static void _Usage()
+{
+    wprintf(L"usage: ConnBench [--mb <size>] [--chunk <KB>] [--transport echo|pipe|ring|all]\n");
+}
+
+int __cdecl wmain(int argc, WCHAR* argv[])
+{
+    if (argc == 3 && std::wstring_view{ argv[1] } == L"--child")
+    {
+        return _RunChild(std::stoull(argv[2]));
+    }
+
+    size_t size = 64 * 1024 * 1024;
+    size_t chunkSize = 64 * 1024;
+    std::wstring transport = L"all";
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::wstring_view arg{ argv[i] };
+        if (i + 1 >= argc)
+        {
+            _Usage();
+            return 1;
+        }
+        else if (arg == L"--mb")
+        {
+            size = std::stoull(argv[++i]) * 1024 * 1024;
+        }
+        else if (arg == L"--chunk")
+        {
+            chunkSize = std::max<size_t>(std::stoull(argv[++i]) * 1024 / sizeof(wchar_t), 1);
+        }
+        else if (arg == L"--transport")
+        {
+            transport = argv[++i];
+        }
+        else
+        {
+            _Usage();
+            return 1;
+        }
+    }
+
+    try
+    {
+        if (transport == L"echo" || transport == L"all")
+        {
+            _Report(L"echo", size, _RunEcho(size, chunkSize));
+        }
+        if (transport == L"pipe" || transport == L"all")
+        {
+            _Report(L"pipe", size, _RunConpty(size, false));
+        }
+        if (transport == L"ring" || transport == L"all")
+        {
+            _Report(L"ring", size, _RunConpty(size, true));
+        }
+    }
+    catch (...)
+    {
+        wprintf(L"failed: 0x%08x\n", static_cast<unsigned int>(wil::ResultFromCaughtException()));
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,413 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// FrameReplay paints the frames that conhost captured with --captureframes
+//      again, through whichever render engine is asked for, over and over, so
+//      that a frame that was slow for someone can be profiled without their
+//      buffer, their font or their machine. Each frame is put back together
+//      from what was captured: the visible rows, the colors they came out as,
+//      the cursor, the selection and the font. It's invalidated the way it
+//      was when it was captured, and then painted:
+//   * null: a NullRenderEngine, which draws nothing, to measure the Renderer by itself.
+//   * gdi: a GdiEngine, in a window of its own.
+//   * dx: a DxEngine, in a window of its own.
+// We report the time and CPU cycles per frame spent in PaintFrame.
+
+#include "LibraryIncludes.h"
+
+#include "../../buffer/out/textBuffer.hpp"
+#include "../../renderer/base/FrameCapture.hpp"
+#include "../../renderer/base/renderer.hpp"
+#include "../../renderer/dx/DxRenderer.hpp"
+#include "../../renderer/gdi/gdirenderer.hpp"
+#include "../../renderer/inc/DummyRenderTarget.hpp"
+#include "../../renderer/inc/NullRenderEngine.hpp"
+
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Types;
+
+static constexpr UINT s_cursorSize = 25;
+
+// The frames are painted by calling PaintFrame ourselves, so nobody needs to
+//      be told that there's something to paint.
+class NoRenderThread final : public IRenderThread
+{
+public:
+    void NotifyPaint() override {}
+    void EnablePainting() override {}
+    void WaitForPaintCompletionAndDisable(const DWORD /*dwTimeoutMs*/) override {}
+};
+
+// Function Description:
+// - Puts an attribute back together from what was captured of it. The colors
+//      it's given are the ones it came out as, so it doesn't need a color table.
+static TextAttribute _MakeAttribute(const CapturedFrame::Attribute& captured) noexcept
+{
+    TextAttribute attr{ captured.foreground, captured.background };
+    attr.SetMetaAttributes(captured.meta);
+    if (captured.bold)
+    {
+        attr.Embolden();
+    }
+    return attr;
+}
+
+// What the renderer paints from: one of the captured frames at a time, each
+//      in a buffer the size of its viewport.
+class CapturedRenderData final : public IRenderData
+{
+public:
+    CapturedRenderData(std::vector<CapturedFrame> frames) :
+        _frames{ std::move(frames) },
+        _current{ 0 }
+    {
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), _frames.empty());
+
+        for (const auto& frame : _frames)
+        {
+            _buffers.push_back(_MakeBuffer(frame));
+            _fonts.emplace_back(frame.font.faceName.c_str(), frame.font.family, frame.font.weight, frame.font.size, frame.font.codePage);
+        }
+    }
+
+    size_t FrameCount() const noexcept
+    {
+        return _frames.size();
+    }
+
+    const CapturedFrame& Frame() const noexcept
+    {
+        return _frames.at(_current);
+    }
+
+    void SetFrame(const size_t index)
+    {
+        _current = index;
+
+        // The renderer asks for the colors of the attributes it's been
+        //      handed, so each of them is kept with the colors it came out as.
+        _colors.clear();
+        for (const auto& captured : Frame().attributes)
+        {
+            _colors.emplace(_MakeAttribute(captured), std::pair{ captured.foreground, captured.background });
+        }
+    }
+
+    Viewport GetViewport() noexcept override
+    {
+        return Viewport::FromDimensions({ 0, 0 }, _Size(Frame()));
+    }
+
+    const TextBuffer& GetTextBuffer() noexcept override
+    {
+        return *_buffers.at(_current);
+    }
+
+    const FontInfo& GetFontInfo() noexcept override
+    {
+        return _fonts.at(_current);
+    }
+
+    const TextAttribute GetDefaultBrushColors() noexcept override
+    {
+        return _MakeAttribute(Frame().attributes.at(Frame().defaultAttribute));
+    }
+
+    const COLORREF GetForegroundColor(const TextAttribute& attr) const noexcept override
+    {
+        const auto found = _colors.find(attr);
+        return found != _colors.end() ? found->second.first : attr.CalculateRgbForeground({}, _DefaultForeground(), _DefaultBackground());
+    }
+
+    const COLORREF GetBackgroundColor(const TextAttribute& attr) const noexcept override
+    {
+        const auto found = _colors.find(attr);
+        return found != _colors.end() ? found->second.second : attr.CalculateRgbBackground({}, _DefaultForeground(), _DefaultBackground());
+    }
+
+    COORD GetCursorPosition() const noexcept override
+    {
+        return Frame().cursor.position;
+    }
+
+    bool IsCursorVisible() const noexcept override
+    {
+        return Frame().cursor.visible;
+    }
+
+    bool IsCursorOn() const noexcept override
+    {
+        return Frame().cursor.on;
+    }
+
+    ULONG GetCursorHeight() const noexcept override
+    {
+        return Frame().cursor.height;
+    }
+
+    CursorType GetCursorStyle() const noexcept override
+    {
+        return Frame().cursor.style;
+    }
+
+    ULONG GetCursorPixelWidth() const noexcept override
+    {
+        return Frame().cursor.pixelWidth;
+    }
+
+    COLORREF GetCursorColor() const noexcept override
+    {
+        return Frame().cursor.color;
+    }
+
+    bool IsCursorDoubleWidth() const noexcept override
+    {
+        return Frame().cursor.doubleWidth;
+    }
+
+    const std::vector<RenderOverlay> GetOverlays() const noexcept override
+    {
+        return {};
+    }
+
+    const bool IsGridLineDrawingAllowed() noexcept override
+    {
+        return Frame().gridLinesAllowed;
+    }
+
+    std::vector<Viewport> GetSelectionRects() noexcept override
+    {
+        std::vector<Viewport> rects;
+        for (const auto& rect : Frame().selection)
+        {
+            rects.push_back(Viewport::FromInclusive(rect));
+        }
+        return rects;
+    }
+
+    const std::wstring GetConsoleTitle() const noexcept override
+    {
+        return Frame().title;
+    }
+
+    void LockConsole() noexcept override {}
+    void UnlockConsole() noexcept override {}
+
+private:
+    static COORD _Size(const CapturedFrame& frame) noexcept
+    {
+        return Viewport::FromInclusive(frame.viewport).Dimensions();
+    }
+
+    std::unique_ptr<TextBuffer> _MakeBuffer(const CapturedFrame& frame)
+    {
+        const auto size = _Size(frame);
+        auto buffer = std::make_unique<TextBuffer>(size, _MakeAttribute(frame.attributes.at(frame.defaultAttribute)), s_cursorSize, _renderTarget);
+
+        SHORT y = 0;
+        for (const auto& row : frame.rows)
+        {
+            if (y >= size.Y)
+            {
+                break;
+            }
+
+            std::vector<OutputCell> cells;
+            cells.reserve(row.cells.size());
+            for (const auto& cell : row.cells)
+            {
+                cells.emplace_back(cell.text, DbcsAttribute{ cell.dbcs }, _MakeAttribute(frame.attributes.at(cell.attribute)));
+            }
+            if (!cells.empty())
+            {
+                buffer->WriteLine(OutputCellIterator{ cells }, { 0, y });
+            }
+            buffer->GetRowByOffset(y).GetCharRow().SetWrapForced(row.wrapForced);
+            ++y;
+        }
+        return buffer;
+    }
+
+    COLORREF _DefaultForeground() const noexcept
+    {
+        return Frame().attributes.at(Frame().defaultAttribute).foreground;
+    }
+
+    COLORREF _DefaultBackground() const noexcept
+    {
+        return Frame().attributes.at(Frame().defaultAttribute).background;
+    }
+
+    DummyRenderTarget _renderTarget;
+    const std::vector<CapturedFrame> _frames;
+    std::vector<std::unique_ptr<TextBuffer>> _buffers;
+    std::vector<FontInfo> _fonts;
+    std::unordered_map<TextAttribute, std::pair<COLORREF, COLORREF>> _colors;
+    size_t _current;
+};
+
+// Function Description:
+// - Makes a plain window for an engine to paint into, big enough for the
+//      first frame's viewport.
+static HWND _CreateWindow(const COORD size, const COORD fontSize)
+{
+    WNDCLASSW wc{};
+    wc.lpfnWndProc = DefWindowProcW;
+    wc.hInstance = GetModuleHandleW(nullptr);
+    wc.hCursor = LoadCursorW(nullptr, IDC_ARROW);
+    wc.lpszClassName = L"FrameReplayWindow";
+    RegisterClassW(&wc);
+
+    RECT rect{ 0, 0, size.X * fontSize.X, size.Y * fontSize.Y };
+    AdjustWindowRect(&rect, WS_OVERLAPPEDWINDOW, FALSE);
+    const auto hwnd = CreateWindowW(wc.lpszClassName,
+                                    L"FrameReplay",
+                                    WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+                                    CW_USEDEFAULT,
+                                    CW_USEDEFAULT,
+                                    rect.right - rect.left,
+                                    rect.bottom - rect.top,
+                                    nullptr,
+                                    nullptr,
+                                    wc.hInstance,
+                                    nullptr);
+    THROW_LAST_ERROR_IF_NULL(hwnd);
+    return hwnd;
+}
+
+static void _PumpMessages() noexcept
+{
+    MSG msg;
+    while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+    {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+}
+
+static void _Usage()
+{
+    wprintf(L"usage: FrameReplay <capture file> [--engine null|gdi|dx] [--loops <count>]\n");
+}
+
+int __cdecl wmain(int argc, WCHAR* argv[])
+{
+    std::wstring path;
+    std::wstring_view engineName{ L"null" };
+    size_t loops = 10;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::wstring_view arg{ argv[i] };
+        if (arg == L"--engine" && i + 1 < argc)
+        {
+            engineName = argv[++i];
+        }
+        else if (arg == L"--loops" && i + 1 < argc)
+        {
+            loops = std::stoul(argv[++i]);
+        }
+        else if (path.empty() && !arg.empty() && arg.front() != L'-')
+        {
+            path = arg;
+        }
+        else
+        {
+            _Usage();
+            return 1;
+        }
+    }
+
+    if (path.empty() || (engineName != L"null" && engineName != L"gdi" && engineName != L"dx"))
+    {
+        _Usage();
+        return 1;
+    }
+
+    try
+    {
+        std::ifstream file{ path, std::ios::binary };
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), !file);
+        CapturedRenderData data{ CapturedFrame::s_ReadAll(file) };
+        data.SetFrame(0);
+
+        const auto& font = data.Frame().font;
+        const auto viewportSize = data.GetViewport().Dimensions();
+
+        // Declared before the renderer, so that it goes away before them.
+        NullRenderEngine nullEngine{ font.size };
+        std::unique_ptr<GdiEngine> gdiEngine;
+        std::unique_ptr<DxEngine> dxEngine;
+        IRenderEngine* engine = &nullEngine;
+        if (engineName == L"gdi")
+        {
+            gdiEngine = std::make_unique<GdiEngine>();
+            THROW_IF_FAILED(gdiEngine->SetHwnd(_CreateWindow(viewportSize, font.size)));
+            engine = gdiEngine.get();
+        }
+        else if (engineName == L"dx")
+        {
+            dxEngine = std::make_unique<DxEngine>();
+            THROW_IF_FAILED(dxEngine->SetHwnd(_CreateWindow(viewportSize, font.size)));
+            THROW_IF_FAILED(dxEngine->Enable());
+            engine = dxEngine.get();
+        }
+
+        IRenderEngine* engines[]{ engine };
+        Renderer renderer{ &data, engines, ARRAYSIZE(engines), std::make_unique<NoRenderThread>() };
+
+        FontInfoDesired desired{ font.faceName.c_str(), font.family, font.weight, font.size, font.codePage };
+        FontInfo actual{ font.faceName.c_str(), font.family, font.weight, font.size, font.codePage };
+        renderer.TriggerFontChange(USER_DEFAULT_SCREEN_DPI, desired, actual);
+
+        wprintf(L"Replaying %zu frames of %dx%d, %zu times, with the %s engine\n",
+                data.FrameCount(),
+                viewportSize.X,
+                viewportSize.Y,
+                loops,
+                std::wstring{ engineName }.c_str());
+
+        size_t frames = 0;
+        double seconds = 0;
+        ULONG64 cycles = 0;
+        for (size_t loop = 0; loop < loops; ++loop)
+        {
+            for (size_t index = 0; index < data.FrameCount(); ++index)
+            {
+                data.SetFrame(index);
+                for (const auto& rect : data.Frame().dirty)
+                {
+                    renderer.TriggerRedraw(Viewport::FromInclusive(rect));
+                }
+
+                ULONG64 cyclesBefore = 0;
+                QueryThreadCycleTime(GetCurrentThread(), &cyclesBefore);
+                const auto before = std::chrono::steady_clock::now();
+
+                THROW_IF_FAILED(renderer.PaintFrame());
+
+                const auto after = std::chrono::steady_clock::now();
+                ULONG64 cyclesAfter = 0;
+                QueryThreadCycleTime(GetCurrentThread(), &cyclesAfter);
+
+                seconds += std::chrono::duration<double>(after - before).count();
+                cycles += cyclesAfter - cyclesBefore;
+                ++frames;
+
+                _PumpMessages();
+            }
+        }
+
+        const double count = static_cast<double>(std::max<size_t>(frames, 1));
+        wprintf(L"%7zu frames: %9.2f us/frame %9.1f Kcycles/frame\n",
+                frames,
+                seconds * 1000000.0 / count,
+                cycles / 1000.0 / count);
+    }
+    catch (...)
+    {
+        wprintf(L"failed: 0x%08x\n", static_cast<unsigned int>(wil::ResultFromCaughtException()));
+        return 1;
+    }
+
+    return 0;
+}
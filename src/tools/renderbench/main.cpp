@@ -0,0 +1,257 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// RenderBench measures what the Renderer itself costs per frame, without GDI
+//      or Direct3D in the way. A headless Terminal full of colored text is
+//      painted by a NullRenderEngine, which keeps track of what's dirty like a
+//      real engine but draws nothing. Each pattern invalidates the frame in a
+//      different way, and is painted over and over:
+//   * full: everything is invalidated, like a resize or a font change.
+//   * scroll: a line is written at the bottom, and the frame scrolls up.
+//   * cell: one cell in the middle of the screen changes.
+//   * selection: the end of a selection is dragged across the screen.
+// For each pattern, we report the time and CPU cycles per frame spent in
+//      PaintFrame, how many allocations it made, and what it handed the engine.
+
+#include "LibraryIncludes.h"
+
+#include "../../cascadia/TerminalCore/Terminal.hpp"
+#include "../../renderer/base/renderer.hpp"
+#include "../../renderer/inc/NullRenderEngine.hpp"
+#include "../../types/inc/convert.hpp"
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Types;
+
+// Every pattern is painted until at least this much time has passed.
+static constexpr double s_secondsPerPattern = 1.0;
+
+static std::atomic<size_t> s_allocations{ 0 };
+
+// Every allocation in the process is counted, so that we can tell how many
+//      of them a frame costs us.
+void* __cdecl operator new(size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* const p = malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void __cdecl operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+// The frames are painted by calling PaintFrame ourselves, so nobody needs to
+//      be told that there's something to paint.
+class NoRenderThread final : public IRenderThread
+{
+public:
+    void NotifyPaint() override {}
+    void EnablePainting() override {}
+    void WaitForPaintCompletionAndDisable(const DWORD /*dwTimeoutMs*/) override {}
+};
+
+struct PatternResult
+{
+    size_t frames;
+    double seconds;
+    ULONG64 cycles;
+    size_t allocations;
+    NullRenderEngine::Counts counts;
+};
+
+// Function Description:
+// - Makes some output that looks like what a colored build log or an ls would
+//      print: lines of text, a lot of it colored, a few of them not ASCII.
+static std::wstring _MakeContent(const size_t lineCount)
+{
+    static constexpr std::string_view lines[]{
+        "Compiling src/buffer/out/textBuffer.cpp\r\n",
+        "\x1b[32m  PASSED\x1b[m TextBufferTests::TestWrappedRowsAreCopied\r\n",
+        "\x1b[1;33mwarning\x1b[m C4100: 'args': unreferenced formal parameter\r\n",
+        "\x1b[34mdrwxr-xr-x\x1b[m  \x1b[1;34mbuffer\x1b[m  \x1b[1;32mbuild.cmd\x1b[m  \x1b[1;36mlink\x1b[m  README.md  \x1b[31marchive.zip\x1b[m\r\n",
+        "2019-05-13T10:42:17.123Z info  caf\xC3\xA9 \xE2\x94\x82 \xE6\xBC\xA2\xE5\xAD\x97 request served in 12ms\r\n",
+        "\x1b[38;2;255;128;0mtruecolor\x1b[48;5;17m 256 color \x1b[m plain text to the end of the line\r\n",
+        "\x1b[7m reversed status line \x1b[m\x1b[4m underlined \x1b[m \xE2\x94\x8C\xE2\x94\x80\xE2\x94\x80\xE2\x94\x90 box drawing\r\n",
+    };
+
+    std::string content;
+    for (size_t i = 0; i < lineCount; ++i)
+    {
+        content.append(lines[i % ARRAYSIZE(lines)]);
+    }
+    return ConvertToW(CP_UTF8, content);
+}
+
+// A headless terminal, painted by a renderer with a null engine.
+class RenderBench final
+{
+public:
+    RenderBench(const COORD size) :
+        _size{ size },
+        _content{ _MakeContent(1000) },
+        _nextLine{ 0 }
+    {
+        IRenderEngine* engines[]{ &_engine };
+        _renderer = std::make_unique<Renderer>(&_terminal, engines, ARRAYSIZE(engines), std::make_unique<NoRenderThread>());
+        _terminal.Create(size, 9001, *_renderer);
+        _terminal.Write(_content);
+
+        // The first frame tells the engine how big the viewport is.
+        _PaintFrame();
+        _renderer->TriggerRedrawAll();
+        _PaintFrame();
+    }
+
+    // Paints frames, with the invalidate function called before each of them,
+    //      until enough time has passed.
+    template<typename T>
+    PatternResult Run(T invalidate)
+    {
+        PatternResult result{};
+        _engine.ResetCounts();
+
+        while (result.seconds < s_secondsPerPattern)
+        {
+            invalidate(*this);
+
+            const auto allocationsBefore = s_allocations.load();
+            ULONG64 cyclesBefore = 0;
+            QueryThreadCycleTime(GetCurrentThread(), &cyclesBefore);
+            const auto before = std::chrono::steady_clock::now();
+
+            _PaintFrame();
+
+            const auto after = std::chrono::steady_clock::now();
+            ULONG64 cyclesAfter = 0;
+            QueryThreadCycleTime(GetCurrentThread(), &cyclesAfter);
+            result.allocations += s_allocations.load() - allocationsBefore;
+            result.cycles += cyclesAfter - cyclesBefore;
+            result.seconds += std::chrono::duration<double>(after - before).count();
+            ++result.frames;
+        }
+
+        result.counts = _engine.GetCounts();
+        return result;
+    }
+
+    void InvalidateAll()
+    {
+        _renderer->TriggerRedrawAll();
+    }
+
+    void WriteLine()
+    {
+        const size_t start = _nextLine;
+        const size_t end = _content.find(L'\n', start) + 1;
+        _terminal.Write(std::wstring_view{ _content }.substr(start, end - start));
+        _nextLine = end < _content.size() ? end : 0;
+    }
+
+    void InvalidateCell()
+    {
+        const auto view = _terminal.GetViewport();
+        const COORD cell{ gsl::narrow_cast<SHORT>(view.Left() + _size.X / 2),
+                          gsl::narrow_cast<SHORT>(view.Top() + _size.Y / 2) };
+        _renderer->TriggerRedraw(&cell);
+    }
+
+    void DragSelection()
+    {
+        if (!_terminal.IsSelectionActive())
+        {
+            _terminal.SetSelectionAnchor({ 0, 0 });
+            _selectionEnd = { 0, 0 };
+        }
+
+        // Sweep the end of the selection across the screen, a few cells at a time.
+        _selectionEnd.X += 7;
+        if (_selectionEnd.X >= _size.X)
+        {
+            _selectionEnd.X = 0;
+            _selectionEnd.Y = gsl::narrow_cast<SHORT>((_selectionEnd.Y + 1) % _size.Y);
+        }
+        _terminal.SetEndSelectionPosition(_selectionEnd);
+        _renderer->TriggerSelection();
+    }
+
+private:
+    void _PaintFrame()
+    {
+        THROW_IF_FAILED(_renderer->PaintFrame());
+    }
+
+    const COORD _size;
+    const std::wstring _content;
+    size_t _nextLine;
+    COORD _selectionEnd{};
+
+    // Declared in this order, so that the renderer goes away before the
+    //      engine and the terminal that it paints from.
+    NullRenderEngine _engine;
+    Terminal _terminal;
+    std::unique_ptr<Renderer> _renderer;
+};
+
+static void _Report(const wchar_t* const name, const PatternResult& result)
+{
+    const double frames = static_cast<double>(std::max<size_t>(result.frames, 1));
+    wprintf(L"%-9s %7zu frames: %9.2f us/frame %9.1f Kcycles/frame %7.1f allocs/frame | "
+            L"per frame: %6.1f lines %8.1f clusters %6.1f brushes %5.1f selections\n",
+            name,
+            result.frames,
+            result.seconds * 1000000.0 / frames,
+            result.cycles / 1000.0 / frames,
+            result.allocations / frames,
+            result.counts.bufferLines / frames,
+            result.counts.clusters / frames,
+            result.counts.brushChanges / frames,
+            result.counts.selections / frames);
+}
+
+static void _Usage()
+{
+    wprintf(L"usage: RenderBench [--size <columns> <rows>]\n");
+}
+
+int __cdecl wmain(int argc, WCHAR* argv[])
+{
+    COORD size{ 120, 30 };
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::wstring_view arg{ argv[i] };
+        if (arg == L"--size" && i + 2 < argc)
+        {
+            size.X = gsl::narrow<SHORT>(std::stoi(argv[++i]));
+            size.Y = gsl::narrow<SHORT>(std::stoi(argv[++i]));
+        }
+        else
+        {
+            _Usage();
+            return 1;
+        }
+    }
+
+    try
+    {
+        RenderBench bench{ size };
+        wprintf(L"Painting a %dx%d terminal with a null engine\n", size.X, size.Y);
+
+        _Report(L"full", bench.Run([](RenderBench& b) { b.InvalidateAll(); }));
+        _Report(L"scroll", bench.Run([](RenderBench& b) { b.WriteLine(); }));
+        _Report(L"cell", bench.Run([](RenderBench& b) { b.InvalidateCell(); }));
+        _Report(L"selection", bench.Run([](RenderBench& b) { b.DragSelection(); }));
+    }
+    catch (...)
+    {
+        wprintf(L"failed: 0x%08x\n", static_cast<unsigned int>(wil::ResultFromCaughtException()));
+        return 1;
+    }
+
+    return 0;
+}
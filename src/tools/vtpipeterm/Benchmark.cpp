@@ -0,0 +1,467 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "Benchmark.hpp"
+#include "VtConsole.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string_view>
+
+using namespace std::chrono;
+
+// The client sets the title to these to tell the benchmark where it's at.
+static constexpr std::string_view READY_TITLE{ "vtpt-bench:ready" };
+static constexpr std::string_view DONE_TITLE_PREFIX{ "vtpt-bench:done:" };
+
+// Written to the client's input to start it once the benchmark's ready, and to
+// stop the echo workload.
+static constexpr char GO_KEY = 'g';
+static constexpr char STOP_KEY = '\x04';
+
+static constexpr size_t BULK_BYTES = 16 * 1024 * 1024;
+static constexpr size_t COLOR_BYTES = 16 * 1024 * 1024;
+static constexpr size_t SCROLL_LINES = 200000;
+static constexpr size_t ECHO_KEYS = 500;
+
+static constexpr auto WORKLOAD_TIMEOUT = minutes(5);
+static constexpr auto ECHO_TIMEOUT = seconds(5);
+// Once the client's done, conpty's output is drained until it's been quiet for this long.
+static constexpr auto DRAIN_QUIET = milliseconds(250);
+
+static constexpr std::wstring_view WORKLOADS[] = { L"bulk", L"color", L"scroll", L"echo" };
+
+////////////////////////////////////////////////////////////////////////////////
+// What the benchmark has read from conpty so far. Everything's guarded by the
+//      lock, and the condition is signalled whenever more is read.
+enum class ParseState
+{
+    Ground,
+    Escape,
+    Csi,
+    Osc,
+    OscEscape
+};
+
+static struct
+{
+    std::mutex lock;
+    std::condition_variable changed;
+
+    uint64_t outputBytes;
+    // Characters that were printed, rather than part of an escape sequence.
+    uint64_t printedChars;
+    steady_clock::time_point lastOutput;
+
+    ParseState parseState;
+    std::string osc;
+    std::string title;
+} g_bench;
+
+// Function Description:
+// - Just enough of a VT parser to tell printed characters from the ones in
+//      escape sequences, and to pick out title changes.
+// Arguments:
+// - buffer: the VT that was read
+// - dwRead: the length of the buffer
+// Note: must be called with the lock held
+static void _ParseOutput(const BYTE* const buffer, const DWORD dwRead)
+{
+    for (DWORD i = 0; i < dwRead; ++i)
+    {
+        const char c = static_cast<char>(buffer[i]);
+        switch (g_bench.parseState)
+        {
+        case ParseState::Ground:
+            if (c == '\x1b')
+            {
+                g_bench.parseState = ParseState::Escape;
+            }
+            else if (static_cast<unsigned char>(c) >= ' ' && c != '\x7f')
+            {
+                g_bench.printedChars++;
+            }
+            break;
+        case ParseState::Escape:
+            if (c == '[')
+            {
+                g_bench.parseState = ParseState::Csi;
+            }
+            else if (c == ']')
+            {
+                g_bench.osc.clear();
+                g_bench.parseState = ParseState::Osc;
+            }
+            else
+            {
+                g_bench.parseState = ParseState::Ground;
+            }
+            break;
+        case ParseState::Csi:
+            if (c >= '\x40' && c <= '\x7e')
+            {
+                g_bench.parseState = ParseState::Ground;
+            }
+            break;
+        case ParseState::Osc:
+        case ParseState::OscEscape:
+            if (c == '\x7' || (g_bench.parseState == ParseState::OscEscape && c == '\\'))
+            {
+                // OSC 0 and 2 set the title.
+                if (g_bench.osc.rfind("0;", 0) == 0 || g_bench.osc.rfind("2;", 0) == 0)
+                {
+                    g_bench.title = g_bench.osc.substr(2);
+                }
+                g_bench.parseState = ParseState::Ground;
+            }
+            else if (c == '\x1b')
+            {
+                g_bench.parseState = ParseState::OscEscape;
+            }
+            else
+            {
+                g_bench.osc += c;
+                g_bench.parseState = ParseState::Osc;
+            }
+            break;
+        }
+    }
+}
+
+static void BenchmarkReadCallback(BYTE* buffer, DWORD dwRead)
+{
+    {
+        std::unique_lock<std::mutex> lock{ g_bench.lock };
+        g_bench.outputBytes += dwRead;
+        g_bench.lastOutput = steady_clock::now();
+        _ParseOutput(buffer, dwRead);
+    }
+    g_bench.changed.notify_all();
+}
+
+// Function Description:
+// - Waits until what's been read from conpty satisfies the given predicate.
+// Arguments:
+// - predicate: called with the lock held
+// - timeout: how long to wait before giving up
+// Return Value:
+// - true if the predicate was satisfied, false if we timed out
+template<typename Rep, typename Period>
+static bool _WaitFor(const std::function<bool()>& predicate, const duration<Rep, Period> timeout)
+{
+    std::unique_lock<std::mutex> lock{ g_bench.lock };
+    return g_bench.changed.wait_for(lock, timeout, predicate);
+}
+
+static void _ResetCounters()
+{
+    std::unique_lock<std::mutex> lock{ g_bench.lock };
+    g_bench.outputBytes = 0;
+    g_bench.printedChars = 0;
+    g_bench.lastOutput = steady_clock::now();
+}
+
+static bool _WriteKey(VtConsole& console, const char key)
+{
+    std::string seq(1, key);
+    return console.WriteInput(seq);
+}
+
+static double _Percentile(const std::vector<double>& sorted, const double percentile)
+{
+    const auto index = static_cast<size_t>(percentile * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted.at(index);
+}
+
+// Function Description:
+// - Runs one workload against a fresh conpty, and prints what it measured.
+// Arguments:
+// - workload: the name of the workload
+// - size: the size of the conpty, in characters
+// Return Value:
+// - true if the workload ran to the end.
+static bool _RunWorkload(const std::wstring_view workload, const COORD size)
+{
+    wchar_t selfPath[MAX_PATH];
+    THROW_LAST_ERROR_IF(GetModuleFileNameW(nullptr, selfPath, ARRAYSIZE(selfPath)) == 0);
+
+    std::wstring command{ L"\"" };
+    command += selfPath;
+    command += L"\" --bench-client ";
+    command += workload;
+
+    {
+        std::unique_lock<std::mutex> lock{ g_bench.lock };
+        g_bench.parseState = ParseState::Ground;
+        g_bench.title.clear();
+    }
+    _ResetCounters();
+
+    // The consoles are never torn down; each only lives as long as its workload
+    //      runs, but that's all for the life of the process anyways.
+    auto console = new VtConsole(BenchmarkReadCallback, false, true, size);
+    console->spawn(command);
+    console->activate();
+
+    if (!_WaitFor([]() { return g_bench.title == READY_TITLE; }, WORKLOAD_TIMEOUT))
+    {
+        wprintf(L"%-8ls timed out waiting for the client to start\n", workload.data());
+        return false;
+    }
+
+    _ResetCounters();
+    std::vector<double> latencies;
+    uint64_t inputBytes = 1;
+    const auto start = steady_clock::now();
+    _WriteKey(*console, GO_KEY);
+
+    if (workload == L"echo")
+    {
+        for (size_t i = 0; i < ECHO_KEYS; ++i)
+        {
+            uint64_t before;
+            {
+                std::unique_lock<std::mutex> lock{ g_bench.lock };
+                before = g_bench.printedChars;
+            }
+
+            const auto sent = steady_clock::now();
+            _WriteKey(*console, static_cast<char>('a' + (i % 26)));
+            inputBytes++;
+            if (!_WaitFor([before]() { return g_bench.printedChars > before; }, ECHO_TIMEOUT))
+            {
+                wprintf(L"%-8ls timed out waiting for key %zu to be echoed\n", workload.data(), i);
+                return false;
+            }
+            latencies.push_back(duration<double, std::micro>(steady_clock::now() - sent).count());
+        }
+        _WriteKey(*console, STOP_KEY);
+        inputBytes++;
+    }
+
+    if (!_WaitFor([]() { return g_bench.title.rfind(DONE_TITLE_PREFIX, 0) == 0; }, WORKLOAD_TIMEOUT))
+    {
+        wprintf(L"%-8ls timed out waiting for the client to finish\n", workload.data());
+        return false;
+    }
+    const auto end = steady_clock::now();
+
+    uint64_t clientBytes;
+    {
+        std::unique_lock<std::mutex> lock{ g_bench.lock };
+        clientBytes = std::stoull(g_bench.title.substr(DONE_TITLE_PREFIX.size()));
+    }
+
+    // The title can go out ahead of the last of the text, so keep reading
+    //      until conpty's gone quiet.
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock{ g_bench.lock };
+        if (steady_clock::now() - g_bench.lastOutput >= DRAIN_QUIET)
+        {
+            break;
+        }
+        g_bench.changed.wait_for(lock, DRAIN_QUIET);
+    }
+
+    uint64_t outputBytes;
+    {
+        std::unique_lock<std::mutex> lock{ g_bench.lock };
+        outputBytes = g_bench.outputBytes;
+    }
+
+    console->deactivate();
+
+    const auto seconds = duration<double>(end - start).count();
+    const auto inBytes = workload == L"echo" ? inputBytes : clientBytes;
+    wprintf(L"%-8ls %10.2f %10.2f %10.3f",
+            workload.data(),
+            static_cast<double>(clientBytes) / seconds / (1024 * 1024),
+            static_cast<double>(outputBytes) / seconds / (1024 * 1024),
+            inBytes > 0 ? static_cast<double>(outputBytes) / static_cast<double>(inBytes) : 0.0);
+
+    if (!latencies.empty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        wprintf(L" %10.0f %10.0f %10.0f %10.0f",
+                _Percentile(latencies, 0.5),
+                _Percentile(latencies, 0.9),
+                _Percentile(latencies, 0.99),
+                latencies.back());
+    }
+    wprintf(L"\n");
+    return true;
+}
+
+// Function Description:
+// - Runs each of the given workloads in turn, each against its own conpty, and
+//      prints a table of the results.
+// Arguments:
+// - workloads: the names of the workloads to run. If it's empty, all of them are run.
+// - size: the size of the conptys, in characters
+// Return Value:
+// - 0 if every workload ran to the end, 1 otherwise.
+int RunBenchmark(const std::vector<std::wstring>& workloads, const COORD size)
+{
+    std::vector<std::wstring_view> toRun{ workloads.cbegin(), workloads.cend() };
+    if (toRun.empty())
+    {
+        toRun.assign(std::cbegin(WORKLOADS), std::cend(WORKLOADS));
+    }
+
+    for (const auto workload : toRun)
+    {
+        if (std::find(std::cbegin(WORKLOADS), std::cend(WORKLOADS), workload) == std::cend(WORKLOADS))
+        {
+            wprintf(L"Unknown workload \"%ls\". The workloads are bulk, color, scroll and echo.\n", workload.data());
+            return 1;
+        }
+    }
+
+    wprintf(L"conpty %dx%d\n", size.X, size.Y);
+    wprintf(L"%-8ls %10ls %10ls %10ls %10ls %10ls %10ls %10ls\n",
+            L"workload", L"in MB/s", L"out MB/s", L"out/in", L"p50 us", L"p90 us", L"p99 us", L"max us");
+
+    bool succeeded = true;
+    for (const auto workload : toRun)
+    {
+        succeeded = _RunWorkload(workload, size) && succeeded;
+    }
+    return succeeded ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The client side, running attached to the conpty.
+
+static uint64_t _WriteAll(const HANDLE hOut, const std::string& text)
+{
+    DWORD written = 0;
+    THROW_LAST_ERROR_IF(!WriteFile(hOut, text.data(), static_cast<DWORD>(text.size()), &written, nullptr));
+    return written;
+}
+
+// Function Description:
+// - Writes the same block of text over and over, until at least totalBytes have been written.
+static uint64_t _WriteRepeated(const HANDLE hOut, const std::string& block, const size_t totalBytes)
+{
+    uint64_t written = 0;
+    while (written < totalBytes)
+    {
+        written += _WriteAll(hOut, block);
+    }
+    return written;
+}
+
+static std::string _MakeBulkBlock()
+{
+    std::string block;
+    for (int line = 0; block.size() < 64 * 1024; ++line)
+    {
+        for (int col = 0; col < 79; ++col)
+        {
+            block += static_cast<char>('!' + ((line + col) % 94));
+        }
+        block += "\r\n";
+    }
+    return block;
+}
+
+static std::string _MakeColorBlock()
+{
+    std::string block;
+    for (int line = 0; block.size() < 64 * 1024; ++line)
+    {
+        for (int word = 0; word < 8; ++word)
+        {
+            block += "\x1b[38;5;" + std::to_string((line + word) % 256) +
+                     ";48;5;" + std::to_string((line * 7 + word) % 256) + "m";
+            block += "word" + std::to_string(word) + "  ";
+        }
+        block += "\x1b[m\r\n";
+    }
+    return block;
+}
+
+// Function Description:
+// - The client side of a workload. It's run by vtpipeterm itself, attached to
+//      the conpty the benchmark made for it.
+// Arguments:
+// - workload: the name of the workload
+// Return Value:
+// - 0 on success.
+int RunBenchmarkClient(const std::wstring& workload)
+{
+    const HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    const HANDLE hIn = GetStdHandle(STD_INPUT_HANDLE);
+
+    DWORD dwMode = 0;
+    THROW_LAST_ERROR_IF(!GetConsoleMode(hOut, &dwMode));
+    THROW_LAST_ERROR_IF(!SetConsoleMode(hOut, dwMode | ENABLE_VIRTUAL_TERMINAL_PROCESSING | DISABLE_NEWLINE_AUTO_RETURN));
+    // Read keys one at a time, as they are, with nothing echoed for us.
+    THROW_LAST_ERROR_IF(!SetConsoleMode(hIn, 0));
+    THROW_LAST_ERROR_IF(!SetConsoleOutputCP(CP_UTF8));
+
+    THROW_LAST_ERROR_IF(!SetConsoleTitleA(READY_TITLE.data()));
+
+    char key = 0;
+    DWORD read = 0;
+    while (key != GO_KEY)
+    {
+        THROW_LAST_ERROR_IF(!ReadFile(hIn, &key, 1, &read, nullptr));
+    }
+
+    uint64_t written = 0;
+    if (workload == L"bulk")
+    {
+        written = _WriteRepeated(hOut, _MakeBulkBlock(), BULK_BYTES);
+    }
+    else if (workload == L"color")
+    {
+        written = _WriteRepeated(hOut, _MakeColorBlock(), COLOR_BYTES);
+    }
+    else if (workload == L"scroll")
+    {
+        std::string block;
+        for (size_t line = 0; line < SCROLL_LINES; ++line)
+        {
+            block += std::to_string(line);
+            block += "\r\n";
+            if (block.size() >= 4096)
+            {
+                written += _WriteAll(hOut, block);
+                block.clear();
+            }
+        }
+        written += _WriteAll(hOut, block);
+    }
+    else if (workload == L"echo")
+    {
+        for (;;)
+        {
+            THROW_LAST_ERROR_IF(!ReadFile(hIn, &key, 1, &read, nullptr));
+            if (read == 0)
+            {
+                continue;
+            }
+            if (key == STOP_KEY)
+            {
+                break;
+            }
+            written += _WriteAll(hOut, std::string(1, key));
+        }
+    }
+    else
+    {
+        return 1;
+    }
+
+    const auto doneTitle = std::string{ DONE_TITLE_PREFIX } + std::to_string(written);
+    THROW_LAST_ERROR_IF(!SetConsoleTitleA(doneTitle.c_str()));
+
+    // Give conpty a moment to send the title before our console goes away.
+    Sleep(500);
+    return 0;
+}
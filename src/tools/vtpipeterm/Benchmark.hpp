@@ -0,0 +1,31 @@
+/*++
+Copyright (c) Microsoft Corporation.
+Licensed under the MIT license.
+
+Module Name:
+- Benchmark.hpp
+
+Abstract:
+- A non-interactive mode for vtpipeterm that measures how fast a conpty turns
+  what a client writes into VT, and how long a key takes to come back when the
+  client echoes it.
+- Each workload launches a conpty with another vtpipeterm as its client, running
+  in --bench-client mode. The client writes the workload as fast as it can, and
+  sets the title to a marker when it's done, so that the benchmark knows when
+  conpty has sent everything out. The benchmark reads conpty's output as fast as
+  it can the whole time.
+- For each workload it reports the MB/s of what the client wrote that the host
+  got through, the MB/s of VT that came out, how many bytes of VT came out for
+  each byte that went in, and for the echo workload, the percentiles of the time
+  from writing a key to conpty's input to seeing it come back out.
+--*/
+
+#pragma once
+
+#include <windows.h>
+
+#include <string>
+#include <vector>
+
+int RunBenchmark(const std::vector<std::wstring>& workloads, const COORD size);
+int RunBenchmarkClient(const std::wstring& workload);
@@ -343,7 +343,8 @@ DWORD WINAPI VtConsole::StaticOutputThreadProc(LPVOID lpParameter)
 
 DWORD VtConsole::_OutputThread()
 {
-    BYTE buffer[256];
+    // Big enough that reading doesn't hold up a benchmark of how fast conpty writes.
+    BYTE buffer[4096];
     DWORD dwRead;
     while (true)
     {
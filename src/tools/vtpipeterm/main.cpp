@@ -18,6 +18,7 @@
 #include <assert.h>
 
 #include "VtConsole.hpp"
+#include "Benchmark.hpp"
 
 using namespace std;
 ////////////////////////////////////////////////////////////////////////////////
@@ -537,12 +538,30 @@ int __cdecl wmain(int argc, WCHAR* argv[])
     hIn = GetStdHandle(STD_INPUT_HANDLE);
 
     bool fUseDebug = false;
+    bool fBenchmark = false;
+    std::vector<std::wstring> benchmarkWorkloads;
 
     if (argc > 1)
     {
         for (int i = 0; i < argc; ++i)
         {
             std::wstring arg = argv[i];
+            if (arg == std::wstring(L"--bench-client") && i+1 < argc)
+            {
+                // We're the client of one of our own benchmark's conptys.
+                return RunBenchmarkClient(argv[i+1]);
+            }
+            else if (arg == std::wstring(L"--bench"))
+            {
+                // --bench [workload...] runs the given workloads (or all of
+                // them) and exits, rather than running interactively.
+                fBenchmark = true;
+                while (i+1 < argc && std::wstring(argv[i+1]).rfind(L"--", 0) != 0)
+                {
+                    benchmarkWorkloads.emplace_back(argv[i+1]);
+                    i++;
+                }
+            }
             if (arg == std::wstring(L"--headless"))
             {
                 g_headless = true;
@@ -564,6 +583,11 @@ int __cdecl wmain(int argc, WCHAR* argv[])
         }
     }
 
+    if (fBenchmark)
+    {
+        return RunBenchmark(benchmarkWorkloads, { 120, 30 });
+    }
+
     if (g_useConpty)
     {
         printf("Launching vtpipeterm with conpty API...\n");
@@ -0,0 +1,531 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// VtReplay writes a captured stream of VT to the console it's run in, and
+//      measures how long the console takes to get through it. Run it in the
+//      console that's being measured: conhost, a ConPTY, or the Terminal.
+// The stream is written as fast as the console will take it, and then a DSR
+//      (\x1b[6n) is written after it. The console can't answer that until it's
+//      processed everything before it, so the time until the cursor position
+//      report comes back is the time it took to get through the stream.
+//      Under a ConPTY (and so in the Terminal), it's ConPTY's conhost that
+//      answers, once it's processed the stream and passed it on; the Terminal
+//      may still be drawing the last of it when the report comes back.
+// With -timing, the stream is written with the gaps it was captured with,
+//      instead of all at once. The timing file is in the format that
+//      `script -t` writes: a line for each chunk of the stream, giving the
+//      seconds since the chunk before it, and how many bytes long it is.
+// The vttests scripts can be captured to replay with, for instance:
+//      python burrito.py > burrito.vt
+// The file can also be a session that the Terminal recorded (with the
+//      recordingDirectory setting). Its output is replayed in the chunks it
+//      came in, and with -realtime, with the gaps it came in with. The input
+//      and the resizes in it aren't replayed.
+
+#define NOMINMAX
+#include <windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../../cascadia/TerminalCore/TerminalRecording.hpp"
+
+using Microsoft::Terminal::Core::TerminalRecording;
+
+static constexpr char s_deviceStatusReport[] = "\x1b[6n";
+// Puts back the modes, margins and colors that the stream may have changed,
+//      so that each run starts out the same as the first.
+static constexpr char s_softReset[] = "\x1b[!p\x1b[?1049l\x1b[0m";
+
+static constexpr size_t s_defaultChunkSize = 16 * 1024;
+static constexpr DWORD s_replyTimeoutMs = 30 * 1000;
+
+struct Chunk
+{
+    std::chrono::microseconds delay;
+    size_t size;
+};
+
+struct Result
+{
+    double writtenMs;
+    double processedMs;
+};
+
+// Function Description:
+// - Prints how VtReplay is used.
+static void _PrintUsage()
+{
+    fwprintf(stderr,
+             L"usage: VtReplay [-n <runs>] [-chunk <bytes>] [-timing <file>] [-realtime] <file>\n"
+             L"    -n <runs>        how many times to replay the stream (default 1)\n"
+             L"    -chunk <bytes>   how many bytes to write at a time (default %zu)\n"
+             L"    -timing <file>   replay with the timing that `script -t` wrote for the stream\n"
+             L"    -realtime        replay a Terminal recording with the timing it was recorded with\n",
+             s_defaultChunkSize);
+}
+
+// Function Description:
+// - Reads a whole file.
+// Arguments:
+// - path: the file to read
+// Return Value:
+// - What's in the file, or nothing if it couldn't be read.
+static std::optional<std::string> _ReadFile(const wchar_t* const path)
+{
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        return std::nullopt;
+    }
+    return std::string{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+}
+
+// Function Description:
+// - Reads a timing file in the format that `script -t` writes. Each line is
+//   the seconds to wait before the next chunk of the stream, and that chunk's
+//   length in bytes.
+// Arguments:
+// - path: the timing file
+// - streamSize: the length of the stream that the timing is for. Chunks past
+//   its end are cut off.
+// Return Value:
+// - The chunks, or nothing if the file couldn't be read.
+static std::optional<std::vector<Chunk>> _ReadTiming(const wchar_t* const path, const size_t streamSize)
+{
+    std::ifstream file{ path };
+    if (!file)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<Chunk> chunks;
+    size_t total = 0;
+    double seconds;
+    size_t size;
+    while (total < streamSize && file >> seconds >> size)
+    {
+        size = std::min(size, streamSize - total);
+        total += size;
+        chunks.push_back({ std::chrono::microseconds{ static_cast<long long>(seconds * 1000000.0) }, size });
+    }
+
+    // Whatever the timing doesn't cover is written straight after the rest.
+    if (total < streamSize)
+    {
+        chunks.push_back({ std::chrono::microseconds::zero(), streamSize - total });
+    }
+    return chunks;
+}
+
+// Function Description:
+// - Reads the output out of a session that the Terminal recorded, in the
+//   chunks it came in. Output that came in as UTF-16 is turned into UTF-8.
+// Arguments:
+// - recording: the whole recording file
+// - stream: receives the output
+// - chunks: receives how the output was split up, and the gaps between its chunks
+// Return Value:
+// - false if the recording isn't one. One that's been cut off is read up to
+//   the last record in it that's whole.
+static bool _ReadRecording(const std::string& recording, std::string& stream, std::vector<Chunk>& chunks)
+{
+    TerminalRecording::FileHeader fileHeader;
+    if (recording.size() < sizeof(fileHeader))
+    {
+        return false;
+    }
+    memcpy(&fileHeader, recording.data(), sizeof(fileHeader));
+    if (fileHeader.signature != TerminalRecording::s_Signature ||
+        fileHeader.formatVersion != TerminalRecording::s_FormatVersion)
+    {
+        return false;
+    }
+
+    size_t skipped = 0;
+    size_t dropped = 0;
+    bool truncated = false;
+    int64_t lastMicroseconds = 0;
+    size_t offset = sizeof(fileHeader);
+    while (offset < recording.size())
+    {
+        TerminalRecording::RecordHeader header;
+        if (recording.size() - offset < sizeof(header))
+        {
+            truncated = true;
+            break;
+        }
+        memcpy(&header, recording.data() + offset, sizeof(header));
+        offset += sizeof(header);
+
+        const auto padded = TerminalRecording::s_PaddedSize(header.size);
+        if (recording.size() - offset < header.size)
+        {
+            truncated = true;
+            break;
+        }
+        const auto payload = recording.data() + offset;
+        offset += std::min(padded, recording.size() - offset);
+
+        const auto before = stream.size();
+        if (header.type == TerminalRecording::RecordType::OutputUtf8)
+        {
+            stream.append(payload, header.size);
+        }
+        else if (header.type == TerminalRecording::RecordType::Output)
+        {
+            const auto text = reinterpret_cast<const wchar_t*>(payload);
+            const auto length = static_cast<int>(header.size / sizeof(wchar_t));
+            const auto size = WideCharToMultiByte(CP_UTF8, 0, text, length, nullptr, 0, nullptr, nullptr);
+            stream.resize(before + size);
+            WideCharToMultiByte(CP_UTF8, 0, text, length, stream.data() + before, size, nullptr, nullptr);
+        }
+        else if (header.type == TerminalRecording::RecordType::Dropped && header.size >= sizeof(uint64_t))
+        {
+            uint64_t count;
+            memcpy(&count, payload, sizeof(count));
+            dropped += static_cast<size_t>(count);
+        }
+        else
+        {
+            ++skipped;
+        }
+
+        if (stream.size() > before)
+        {
+            const auto delay = std::max<int64_t>(header.microseconds - lastMicroseconds, 0);
+            lastMicroseconds = header.microseconds;
+            chunks.push_back({ std::chrono::microseconds{ delay }, stream.size() - before });
+        }
+    }
+
+    if (truncated)
+    {
+        fwprintf(stderr, L"The recording was cut off - replaying what's there of it.\n");
+    }
+    if (skipped != 0)
+    {
+        fwprintf(stderr, L"Skipping the %zu input and resize records in the recording.\n", skipped);
+    }
+    if (dropped != 0)
+    {
+        fwprintf(stderr, L"The recording is missing %zu records that were dropped while it was recorded.\n", dropped);
+    }
+    return true;
+}
+
+// Function Description:
+// - Writes all of the given bytes to the console.
+// Return Value:
+// - false if the console wouldn't take them.
+static bool _Write(const HANDLE output, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        DWORD written = 0;
+        if (!WriteFile(output, data, static_cast<DWORD>(std::min<size_t>(size, MAXDWORD)), &written, nullptr))
+        {
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Function Description:
+// - Waits for the console to answer a DSR with a cursor position report,
+//   \x1b[<row>;<col>R. Anything else that's in the input, like keys that
+//   were pressed while the stream was being replayed, is skipped over.
+// Arguments:
+// - input: the console's input
+// - timeoutMs: how long to wait for the report
+// Return Value:
+// - true if the report came back.
+static bool _WaitForCursorPositionReport(const HANDLE input, const DWORD timeoutMs)
+{
+    enum class State
+    {
+        Ground,
+        Escape,
+        Parameters
+    };
+
+    auto state = State::Ground;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds{ timeoutMs };
+    INPUT_RECORD records[64];
+    for (;;)
+    {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0 ||
+            WaitForSingleObject(input, static_cast<DWORD>(remaining.count())) != WAIT_OBJECT_0)
+        {
+            return false;
+        }
+
+        DWORD read = 0;
+        if (!ReadConsoleInputW(input, records, ARRAYSIZE(records), &read))
+        {
+            return false;
+        }
+
+        for (DWORD i = 0; i < read; ++i)
+        {
+            const auto& record = records[i];
+            if (record.EventType != KEY_EVENT || !record.Event.KeyEvent.bKeyDown)
+            {
+                continue;
+            }
+
+            const auto ch = record.Event.KeyEvent.uChar.UnicodeChar;
+            if (ch == L'\x1b')
+            {
+                state = State::Escape;
+            }
+            else if (state == State::Escape)
+            {
+                state = ch == L'[' ? State::Parameters : State::Ground;
+            }
+            else if (state == State::Parameters)
+            {
+                if (ch == L'R')
+                {
+                    return true;
+                }
+                if (!(ch == L';' || (ch >= L'0' && ch <= L'9')))
+                {
+                    state = State::Ground;
+                }
+            }
+        }
+    }
+}
+
+// Function Description:
+// - Replays the stream once, and waits for the console to get through it.
+// Arguments:
+// - output, input: the console
+// - stream: the VT to replay
+// - chunks: how to split up the stream, and how long to wait before each chunk
+// Return Value:
+// - How long the stream took to write, and to be processed, or nothing if the
+//   console never answered the DSR.
+static std::optional<Result> _Replay(const HANDLE output,
+                                     const HANDLE input,
+                                     const std::string& stream,
+                                     const std::vector<Chunk>& chunks)
+{
+    FlushConsoleInputBuffer(input);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto due = start;
+    size_t offset = 0;
+    for (const auto& chunk : chunks)
+    {
+        if (chunk.delay.count() > 0)
+        {
+            due += chunk.delay;
+            std::this_thread::sleep_until(due);
+        }
+        if (!_Write(output, stream.data() + offset, chunk.size))
+        {
+            return std::nullopt;
+        }
+        offset += chunk.size;
+    }
+    const auto written = std::chrono::steady_clock::now();
+
+    if (!_Write(output, s_deviceStatusReport, ARRAYSIZE(s_deviceStatusReport) - 1) ||
+        !_WaitForCursorPositionReport(input, s_replyTimeoutMs))
+    {
+        return std::nullopt;
+    }
+    const auto processed = std::chrono::steady_clock::now();
+
+    const std::chrono::duration<double, std::milli> writtenMs = written - start;
+    const std::chrono::duration<double, std::milli> processedMs = processed - start;
+    return Result{ writtenMs.count(), processedMs.count() };
+}
+
+int __cdecl wmain(int argc, wchar_t* argv[])
+{
+    size_t runs = 1;
+    size_t chunkSize = s_defaultChunkSize;
+    const wchar_t* timingPath = nullptr;
+    const wchar_t* streamPath = nullptr;
+    bool realtime = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (_wcsicmp(argv[i], L"-n") == 0 && i + 1 < argc)
+        {
+            runs = std::wcstoul(argv[++i], nullptr, 10);
+        }
+        else if (_wcsicmp(argv[i], L"-chunk") == 0 && i + 1 < argc)
+        {
+            chunkSize = std::wcstoul(argv[++i], nullptr, 10);
+        }
+        else if (_wcsicmp(argv[i], L"-timing") == 0 && i + 1 < argc)
+        {
+            timingPath = argv[++i];
+        }
+        else if (_wcsicmp(argv[i], L"-realtime") == 0)
+        {
+            realtime = true;
+        }
+        else if (argv[i][0] != L'-' && !streamPath)
+        {
+            streamPath = argv[i];
+        }
+        else
+        {
+            _PrintUsage();
+            return 1;
+        }
+    }
+
+    if (!streamPath || runs == 0 || chunkSize == 0)
+    {
+        _PrintUsage();
+        return 1;
+    }
+
+    auto stream = _ReadFile(streamPath);
+    if (!stream)
+    {
+        fwprintf(stderr, L"Couldn't read %s\n", streamPath);
+        return 1;
+    }
+
+    // `script` starts the typescript with a line of its own, which its timing
+    //      doesn't count.
+    static constexpr std::string_view scriptHeader{ "Script started" };
+    if (timingPath && stream->compare(0, scriptHeader.size(), scriptHeader) == 0)
+    {
+        const auto newline = stream->find('\n');
+        stream->erase(0, newline == std::string::npos ? stream->size() : newline + 1);
+    }
+
+    std::vector<Chunk> chunks;
+    std::string recorded;
+    if (_ReadRecording(*stream, recorded, chunks))
+    {
+        if (timingPath)
+        {
+            fwprintf(stderr, L"A recording has its own timing - use -realtime instead of -timing.\n");
+            return 1;
+        }
+        stream = std::move(recorded);
+        if (!realtime)
+        {
+            for (auto& chunk : chunks)
+            {
+                chunk.delay = std::chrono::microseconds::zero();
+            }
+        }
+    }
+    else if (realtime)
+    {
+        fwprintf(stderr, L"%s isn't a recording - use -timing to replay it with a timing file.\n", streamPath);
+        return 1;
+    }
+    else if (timingPath)
+    {
+        auto timing = _ReadTiming(timingPath, stream->size());
+        if (!timing)
+        {
+            fwprintf(stderr, L"Couldn't read %s\n", timingPath);
+            return 1;
+        }
+        chunks = std::move(*timing);
+    }
+    else
+    {
+        for (size_t offset = 0; offset < stream->size(); offset += chunkSize)
+        {
+            chunks.push_back({ std::chrono::microseconds::zero(), std::min(chunkSize, stream->size() - offset) });
+        }
+    }
+
+    const HANDLE input = GetStdHandle(STD_INPUT_HANDLE);
+    const HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+
+    DWORD inputMode = 0;
+    DWORD outputMode = 0;
+    if (!GetConsoleMode(input, &inputMode) || !GetConsoleMode(output, &outputMode))
+    {
+        fwprintf(stderr, L"VtReplay has to be run in a console, with neither its input nor its output redirected.\n");
+        return 1;
+    }
+
+    // The stream is replayed as the bytes that were captured, so it's written
+    //      as UTF-8, and the report has to come back as input, not be echoed.
+    const auto outputCP = GetConsoleOutputCP();
+    SetConsoleOutputCP(CP_UTF8);
+    SetConsoleMode(input, ENABLE_VIRTUAL_TERMINAL_INPUT);
+    if (!SetConsoleMode(output, outputMode | ENABLE_PROCESSED_OUTPUT | ENABLE_VIRTUAL_TERMINAL_PROCESSING))
+    {
+        SetConsoleMode(input, inputMode);
+        SetConsoleOutputCP(outputCP);
+        fwprintf(stderr, L"This console doesn't support VT processing.\n");
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (size_t run = 0; run < runs; ++run)
+    {
+        const auto result = _Replay(output, input, *stream, chunks);
+        _Write(output, s_softReset, ARRAYSIZE(s_softReset) - 1);
+        if (!result)
+        {
+            break;
+        }
+        results.push_back(*result);
+    }
+
+    SetConsoleMode(output, outputMode);
+    SetConsoleMode(input, inputMode);
+    SetConsoleOutputCP(outputCP);
+
+    if (results.empty())
+    {
+        fwprintf(stderr, L"\nThe console never answered the DSR (after %u ms).\n", s_replyTimeoutMs);
+        return 1;
+    }
+
+    const double megabytes = stream->size() / (1024.0 * 1024.0);
+    wprintf(L"\n%-8s %14s %14s %10s\n", L"run", L"written (ms)", L"processed (ms)", L"MB/s");
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        wprintf(L"%-8zu %14.2f %14.2f %10.2f\n",
+                i + 1,
+                results[i].writtenMs,
+                results[i].processedMs,
+                megabytes / (results[i].processedMs / 1000.0));
+    }
+
+    if (results.size() > 1)
+    {
+        std::vector<double> processed;
+        std::transform(results.begin(), results.end(), std::back_inserter(processed), [](const auto& result) { return result.processedMs; });
+        std::sort(processed.begin(), processed.end());
+        wprintf(L"%-8s %14s %14.2f %10.2f\n", L"best", L"", processed.front(), megabytes / (processed.front() / 1000.0));
+        wprintf(L"%-8s %14s %14.2f %10.2f\n", L"median", L"", processed[processed.size() / 2], megabytes / (processed[processed.size() / 2] / 1000.0));
+    }
+
+    if (results.size() < runs)
+    {
+        fwprintf(stderr, L"The console stopped answering the DSR after %zu of %zu runs.\n", results.size(), runs);
+        return 1;
+    }
+    return 0;
+}
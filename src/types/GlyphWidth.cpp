@@ -48,3 +48,42 @@ void NotifyGlyphWidthFontChanged()
 {
     widthDetector.NotifyFontChanged();
 }
+
+// Function Description:
+// - Asks the fallback about the common ambiguous characters for the current font, on
+//   a thread of its own, so that the thread writing text doesn't have to when they're
+//   first written. It gives up as soon as the font changes again.
+// - The fallback is only ever called between lock and unlock, which must keep anything
+//   else from using whatever the fallback measures with at the same time. It's taken
+//   for a small range of characters at a time, so that it's never held for long.
+// Arguments:
+// - lock - takes the lock the fallback is used under.
+// - unlock - releases it.
+// Return Value:
+// - <none>
+void PrewarmGlyphWidthFallback(std::function<void()> lock, std::function<void()> unlock)
+{
+    static constexpr unsigned int charactersPerLock = 32;
+
+    const auto generation = widthDetector.GetFontGeneration();
+    std::thread([lock = std::move(lock), unlock = std::move(unlock), generation]() noexcept {
+        try
+        {
+            for (const auto& range : CodepointWidthDetector::s_CommonAmbiguousRanges)
+            {
+                for (unsigned int first = range.first; first <= range.second; first += charactersPerLock)
+                {
+                    const auto last = std::min<unsigned int>(first + charactersPerLock - 1, range.second);
+
+                    lock();
+                    auto unlockOnExit = wil::scope_exit([&]() { unlock(); });
+                    if (!widthDetector.PrewarmFallbackCache(static_cast<wchar_t>(first), static_cast<wchar_t>(last), generation))
+                    {
+                        return;
+                    }
+                }
+            }
+        }
+        CATCH_LOG();
+    }).detach();
+}
@@ -0,0 +1,160 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "inc/ScratchArena.hpp"
+
+using namespace Microsoft::Console::Types;
+
+ScratchArena::ScratchArena() noexcept :
+    _block{ nullptr },
+    _blockSize{ 0 },
+    _used{ 0 },
+    _spills{},
+    _spilledBytes{ 0 },
+    _live{ 0 }
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    _FreeSpills();
+    if (_block)
+    {
+        std::pmr::new_delete_resource()->deallocate(_block, _blockSize, alignof(std::max_align_t));
+    }
+}
+
+// Routine Description:
+// - Gets the arena of the calling thread, making it the first time it's asked for.
+// Arguments:
+// - <none>
+// Return Value:
+// - The arena. It lives as long as the thread does.
+ScratchArena& ScratchArena::ForThisThread() noexcept
+{
+    thread_local ScratchArena s_arena;
+    return s_arena;
+}
+
+// Routine Description:
+// - Called once a message is done with. If everything drawn from the arena has
+//   been given back, and some of it had to spill over into the heap, grows the
+//   block so that as much would fit in it the next time.
+// - If something's still holding on to memory from the arena, this does nothing,
+//   so that it's never pulled out from under anybody.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void ScratchArena::Reset() noexcept
+{
+    if (_live != 0)
+    {
+        return;
+    }
+
+    _used = 0;
+    if (_spilledBytes == 0)
+    {
+        return;
+    }
+
+    const size_t wanted = std::min(_blockSize + _spilledBytes, s_MaxBlockSize);
+    _spilledBytes = 0;
+
+    if (wanted > _blockSize)
+    {
+        try
+        {
+            std::byte* const block = static_cast<std::byte*>(std::pmr::new_delete_resource()->allocate(wanted, alignof(std::max_align_t)));
+            if (_block)
+            {
+                std::pmr::new_delete_resource()->deallocate(_block, _blockSize, alignof(std::max_align_t));
+            }
+            _block = block;
+            _blockSize = wanted;
+        }
+        catch (...)
+        {
+            // Keeping the smaller block is fine. We'll spill again next time.
+        }
+    }
+}
+
+void* ScratchArena::do_allocate(size_t bytes, size_t alignment)
+{
+    if (!_block)
+    {
+        _block = static_cast<std::byte*>(std::pmr::new_delete_resource()->allocate(s_InitialSize, alignof(std::max_align_t)));
+        _blockSize = s_InitialSize;
+    }
+
+    // The block itself is aligned for anything, so only the offset into it has to be.
+    const size_t start = (_used + alignment - 1) & ~(alignment - 1);
+    if (alignment <= alignof(std::max_align_t) && start <= _blockSize && bytes <= _blockSize - start)
+    {
+        _used = start + bytes;
+        ++_live;
+        return _block + start;
+    }
+
+    _spills.reserve(_spills.size() + 1);
+    void* const p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    _spills.push_back({ p, bytes, alignment });
+    _spilledBytes += bytes;
+    ++_live;
+    return p;
+}
+
+void ScratchArena::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+    std::byte* const allocation = static_cast<std::byte*>(p);
+    if (allocation >= _block && allocation < _block + _blockSize)
+    {
+        // Only the space of what was allocated last can be used again before
+        //      everything's been freed, like a temporary that's gone before
+        //      the ones made ahead of it.
+        if (allocation + bytes == _block + _used)
+        {
+            _used = allocation - _block;
+        }
+    }
+    else
+    {
+        // _spilledBytes keeps counting until the next reset, so that it knows
+        //      how much the block would have had to hold.
+        const auto spill = std::find_if(_spills.begin(), _spills.end(), [=](const Spill& s) { return s.p == p; });
+        if (spill != _spills.end())
+        {
+            _spills.erase(spill);
+        }
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    if (--_live == 0)
+    {
+        _used = 0;
+    }
+}
+
+bool ScratchArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+// Routine Description:
+// - Frees whatever spilled over into the heap that was never given back. Only
+//   the arena going away can leave any.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void ScratchArena::_FreeSpills() noexcept
+{
+    for (const auto& spill : _spills)
+    {
+        std::pmr::new_delete_resource()->deallocate(spill.p, spill.bytes, spill.alignment);
+    }
+    _spills.clear();
+}
@@ -0,0 +1,248 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "inc/SharedRing.hpp"
+
+using namespace Microsoft::Console::Types;
+
+SharedRing::SharedRing() noexcept :
+    _section{},
+    _dataEvent{},
+    _spaceEvent{},
+    _view{},
+    _header{ nullptr },
+    _data{ nullptr },
+    _mask{ 0 }
+{
+}
+
+// Routine Description:
+// - Creates a new, empty ring in a section of its own.
+// Arguments:
+// - capacity - how many bytes the ring should hold. This is rounded up to a power of two.
+// - ring - receives the ring
+// Return Value:
+// - S_OK, E_INVALIDARG if the capacity is out of range, or a suitable HRESULT
+//   for failing to create the section or its events.
+[[nodiscard]]
+HRESULT SharedRing::s_Create(const size_t capacity, std::unique_ptr<SharedRing>& ring) noexcept
+{
+    RETURN_HR_IF(E_INVALIDARG, capacity == 0 || capacity > (1u << 30));
+
+    uint64_t rounded = 4096;
+    while (rounded < capacity)
+    {
+        rounded <<= 1;
+    }
+
+    try
+    {
+        std::unique_ptr<SharedRing> created{ new SharedRing() };
+
+        ULARGE_INTEGER size;
+        size.QuadPart = sizeof(Header) + rounded;
+        created->_section.reset(CreateFileMappingW(INVALID_HANDLE_VALUE,
+                                                   nullptr,
+                                                   PAGE_READWRITE,
+                                                   size.HighPart,
+                                                   size.LowPart,
+                                                   nullptr));
+        RETURN_LAST_ERROR_IF(!created->_section);
+
+        created->_dataEvent.reset(CreateEventW(nullptr, FALSE, FALSE, nullptr));
+        RETURN_LAST_ERROR_IF(!created->_dataEvent);
+        created->_spaceEvent.reset(CreateEventW(nullptr, FALSE, FALSE, nullptr));
+        RETURN_LAST_ERROR_IF(!created->_spaceEvent);
+
+        RETURN_IF_FAILED(created->_Map());
+
+        // A new section is zeroed, so both indices already start at 0.
+        created->_header->capacity = rounded;
+        created->_header->dataEvent = HandleToULong(created->_dataEvent.get());
+        created->_header->spaceEvent = HandleToULong(created->_spaceEvent.get());
+        created->_mask = rounded - 1;
+
+        ring = std::move(created);
+        return S_OK;
+    }
+    CATCH_RETURN();
+}
+
+// Routine Description:
+// - Opens a ring that another process created and handed down to us. The
+//   section and the events named in its header must have been inherited.
+// Arguments:
+// - section - the ring's section. The ring takes ownership of it.
+// - ring - receives the ring
+// Return Value:
+// - S_OK, E_INVALIDARG if the section doesn't hold a valid ring, or a suitable
+//   HRESULT for failing to map it.
+[[nodiscard]]
+HRESULT SharedRing::s_Open(const HANDLE section, std::unique_ptr<SharedRing>& ring) noexcept
+{
+    try
+    {
+        std::unique_ptr<SharedRing> opened{ new SharedRing() };
+        opened->_section.reset(section);
+        RETURN_IF_FAILED(opened->_Map());
+
+        MEMORY_BASIC_INFORMATION info;
+        RETURN_LAST_ERROR_IF(VirtualQuery(opened->_header, &info, sizeof(info)) == 0);
+
+        const auto capacity = opened->_header->capacity;
+        RETURN_HR_IF(E_INVALIDARG, capacity == 0 || (capacity & (capacity - 1)) != 0);
+        RETURN_HR_IF(E_INVALIDARG, capacity > info.RegionSize - sizeof(Header));
+
+        opened->_dataEvent.reset(ULongToHandle(opened->_header->dataEvent));
+        opened->_spaceEvent.reset(ULongToHandle(opened->_header->spaceEvent));
+        opened->_mask = capacity - 1;
+
+        ring = std::move(opened);
+        return S_OK;
+    }
+    CATCH_RETURN();
+}
+
+// Routine Description:
+// - Maps the whole section, and finds the header and the data in it.
+[[nodiscard]]
+HRESULT SharedRing::_Map() noexcept
+{
+    _view.reset(MapViewOfFile(_section.get(), FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0));
+    RETURN_LAST_ERROR_IF(!_view);
+
+    _header = static_cast<Header*>(_view.get());
+    _data = reinterpret_cast<char*>(_header + 1);
+    return S_OK;
+}
+
+// Routine Description:
+// - Gets the section the ring lives in, to hand down to the other process.
+HANDLE SharedRing::GetSection() const noexcept
+{
+    return _section.get();
+}
+
+// Routine Description:
+// - Gets the event that's set when data is written to an empty ring, or the
+//   ring is closed. The reader should wait on this when Read returns nothing.
+HANDLE SharedRing::GetDataEvent() const noexcept
+{
+    return _dataEvent.get();
+}
+
+// Routine Description:
+// - Marks the ring's handles as inheritable or not. The creator of the ring
+//   should only leave them inheritable while it launches the other process,
+//   so that nothing else it launches gets a hold of them.
+[[nodiscard]]
+HRESULT SharedRing::SetInheritable(const bool inheritable) noexcept
+{
+    const DWORD flags = inheritable ? HANDLE_FLAG_INHERIT : 0;
+    RETURN_IF_WIN32_BOOL_FALSE(SetHandleInformation(_section.get(), HANDLE_FLAG_INHERIT, flags));
+    RETURN_IF_WIN32_BOOL_FALSE(SetHandleInformation(_dataEvent.get(), HANDLE_FLAG_INHERIT, flags));
+    RETURN_IF_WIN32_BOOL_FALSE(SetHandleInformation(_spaceEvent.get(), HANDLE_FLAG_INHERIT, flags));
+    return S_OK;
+}
+
+// Routine Description:
+// - Writes all of the given data to the ring, waiting for the reader to make
+//   room whenever it's full. Only the writer may call this.
+// Arguments:
+// - data - the bytes to write
+// Return Value:
+// - S_OK, HRESULT_FROM_WIN32(ERROR_BROKEN_PIPE) if the ring was closed, or a
+//   suitable HRESULT for failing to wait.
+[[nodiscard]]
+HRESULT SharedRing::Write(std::string_view data) noexcept
+{
+    const auto capacity = _mask + 1;
+    while (!data.empty())
+    {
+        RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_BROKEN_PIPE), IsClosed());
+
+        const auto tail = _header->tail.load(std::memory_order_relaxed);
+        const auto head = _header->head.load();
+        const auto space = capacity - (tail - head);
+        if (space == 0)
+        {
+            RETURN_LAST_ERROR_IF(WaitForSingleObject(_spaceEvent.get(), INFINITE) == WAIT_FAILED);
+            continue;
+        }
+
+        const size_t count = gsl::narrow_cast<size_t>(std::min<uint64_t>(space, data.size()));
+        const size_t offset = gsl::narrow_cast<size_t>(tail & _mask);
+        const size_t first = std::min(count, gsl::narrow_cast<size_t>(capacity) - offset);
+        memcpy(_data + offset, data.data(), first);
+        memcpy(_data, data.data() + first, count - first);
+
+        // Publishing the tail and then looking at the head pairs with the reader
+        //      moving the head and then looking at the tail: at least one of us
+        //      sees what the other did. So if the reader had caught up to where
+        //      we started, and might be about to wait, we wake it. Otherwise it's
+        //      still going, and will see the new tail before it waits.
+        _header->tail.store(tail + count);
+        if (_header->head.load() == tail)
+        {
+            SetEvent(_dataEvent.get());
+        }
+
+        data.remove_prefix(count);
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Reads as much as is available from the ring, without waiting. Only the
+//   reader may call this.
+// Arguments:
+// - buffer - receives the data
+// - size - the size of the buffer
+// Return Value:
+// - the number of bytes read. 0 if the ring is empty.
+size_t SharedRing::Read(char* const buffer, const size_t size) noexcept
+{
+    const auto capacity = _mask + 1;
+    const auto head = _header->head.load(std::memory_order_relaxed);
+    const auto tail = _header->tail.load();
+    if (tail == head || size == 0)
+    {
+        return 0;
+    }
+
+    const size_t count = gsl::narrow_cast<size_t>(std::min<uint64_t>(tail - head, size));
+    const size_t offset = gsl::narrow_cast<size_t>(head & _mask);
+    const size_t first = std::min(count, gsl::narrow_cast<size_t>(capacity) - offset);
+    memcpy(buffer, _data + offset, first);
+    memcpy(buffer + first, _data, count - first);
+
+    // The mirror of Write: wake the writer if it had filled the ring.
+    _header->head.store(head + count);
+    if (_header->tail.load() - head == capacity)
+    {
+        SetEvent(_spaceEvent.get());
+    }
+
+    return count;
+}
+
+// Routine Description:
+// - Closes the ring from either end. A writer waiting for room gives up, and
+//   a reader waiting for data is woken, and should stop once it's read
+//   whatever is left.
+void SharedRing::Close() noexcept
+{
+    _header->closed.store(1);
+    SetEvent(_dataEvent.get());
+    SetEvent(_spaceEvent.get());
+}
+
+// Routine Description:
+// - Checks if either end has closed the ring.
+bool SharedRing::IsClosed() const noexcept
+{
+    return _header->closed.load() != 0;
+}
@@ -58,27 +58,72 @@ std::wstring_view Utf16Parser::ParseNext(std::wstring_view wstr)
 std::vector<std::vector<wchar_t>> Utf16Parser::Parse(std::wstring_view wstr)
 {
     std::vector<std::vector<wchar_t>> result;
-    std::vector<wchar_t> sequence;
-    for (const auto wch : wstr)
+    for (const auto glyph : Glyphs(wstr))
     {
+        result.emplace_back(glyph.cbegin(), glyph.cend());
+    }
+    return result;
+}
+
+// Routine Description:
+// - Creates an iterator at the first codepoint of a string.
+// Arguments:
+// - wstr - the string to walk. It must outlive the iterator.
+// Return Value:
+// - iterator at the first codepoint, or the end iterator if there aren't any.
+Utf16Parser::GlyphIterator::GlyphIterator(const std::wstring_view wstr) noexcept :
+    _remaining{ wstr }
+{
+    ++(*this);
+}
+
+// Routine Description:
+// - Moves on to the next codepoint. Leading surrogates that aren't followed by a
+//   trailing one, and trailing surrogates without a leading one, are passed over.
+// Return Value:
+// - reference to the iterator, which is the end iterator once the string runs out.
+Utf16Parser::GlyphIterator& Utf16Parser::GlyphIterator::operator++() noexcept
+{
+    size_t pos = 0;
+    while (pos < _remaining.size())
+    {
+        const auto wch = _remaining[pos];
         if (IsLeadingSurrogate(wch))
         {
-            sequence.clear();
-            sequence.push_back(wch);
-        }
-        else if (IsTrailingSurrogate(wch))
-        {
-            if (!sequence.empty())
+            if (pos + 1 < _remaining.size() && IsTrailingSurrogate(_remaining[pos + 1]))
             {
-                sequence.push_back(wch);
-                result.push_back(sequence);
-                sequence.clear();
+                _glyph = _remaining.substr(pos, 2);
+                _remaining = _remaining.substr(pos + 2);
+                return *this;
             }
         }
-        else
+        else if (!IsTrailingSurrogate(wch))
         {
-            result.push_back({ wch });
+            _glyph = _remaining.substr(pos, 1);
+            _remaining = _remaining.substr(pos + 1);
+            return *this;
         }
+        ++pos;
     }
-    return result;
+
+    _glyph = {};
+    _remaining = {};
+    return *this;
+}
+
+Utf16Parser::GlyphIterator Utf16Parser::GlyphIterator::operator++(int) noexcept
+{
+    auto temp = *this;
+    ++(*this);
+    return temp;
+}
+
+bool Utf16Parser::GlyphIterator::operator==(const GlyphIterator& it) const noexcept
+{
+    return _glyph.data() == it._glyph.data() && _glyph.size() == it._glyph.size();
+}
+
+bool Utf16Parser::GlyphIterator::operator!=(const GlyphIterator& it) const noexcept
+{
+    return !(*this == it);
 }
@@ -0,0 +1,90 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "inc/Utf8Decoder.hpp"
+
+using namespace Microsoft::Console::Types;
+
+Utf8Decoder::Utf8Decoder() noexcept :
+    _partial{},
+    _decoded{}
+{
+}
+
+// Routine Description:
+// - Decodes the next chunk of the stream.
+// Arguments:
+// - utf8 - the next bytes of the stream
+// Return Value:
+// - The text that could be decoded so far. This is only valid until the next
+//   call to Decode or Reset.
+// - NOTE: Throws if the buffer can't be grown.
+std::wstring_view Utf8Decoder::Decode(std::string_view utf8)
+{
+    _decoded.clear();
+
+    // Finish off the sequence the last chunk ended in the middle of.
+    if (!_partial.empty())
+    {
+        while (CodepointLength(_partial) == 0 && !utf8.empty() && (utf8.front() & 0xC0) == 0x80)
+        {
+            _partial.push_back(utf8.front());
+            utf8.remove_prefix(1);
+        }
+
+        // If we ran out of input, it might still be finished by the next chunk.
+        if (CodepointLength(_partial) == 0 && utf8.empty())
+        {
+            return {};
+        }
+
+        // Otherwise it's either whole, or it was broken off by something else
+        //      and will come out as U+FFFD.
+        wchar_t wch[2];
+        const auto cch = MultiByteToWideChar(CP_UTF8, 0, _partial.data(), gsl::narrow<int>(_partial.size()), wch, ARRAYSIZE(wch));
+        _decoded.append(wch, cch);
+        _partial.clear();
+    }
+
+    // Hold back a sequence that's cut off at the end.
+    for (size_t back = 1; back <= std::min<size_t>(3, utf8.size()); ++back)
+    {
+        const auto ch = utf8.at(utf8.size() - back);
+        if ((ch & 0xC0) != 0x80)
+        {
+            if (CodepointLength(utf8.substr(utf8.size() - back)) == 0)
+            {
+                _partial.assign(utf8.substr(utf8.size() - back));
+                utf8.remove_suffix(back);
+            }
+            break;
+        }
+    }
+
+    if (!utf8.empty())
+    {
+        // UTF-8 never takes fewer code units than UTF-16 does for the same text.
+        const auto start = _decoded.size();
+        _decoded.resize(start + utf8.size());
+        const auto cch = MultiByteToWideChar(CP_UTF8,
+                                             0,
+                                             utf8.data(),
+                                             gsl::narrow<int>(utf8.size()),
+                                             _decoded.data() + start,
+                                             gsl::narrow<int>(utf8.size()));
+        _decoded.resize(start + cch);
+    }
+
+    return _decoded;
+}
+
+// Routine Description:
+// - Forgets any sequence that was cut off at the end of the last chunk.
+void Utf8Decoder::Reset() noexcept
+{
+    _partial.clear();
+    _decoded.clear();
+}
+
@@ -10,6 +10,10 @@
 #include "../../interactivity/inc/VtApiRedirection.hpp"
 #endif
 
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 #pragma hdrstop
 
 // TODO: MSFT 14150722 - can these const values be generated at
@@ -18,83 +22,296 @@ static const WORD altScanCode = 0x38;
 static const WORD leftShiftScanCode = 0x2A;
 
 // Routine Description:
-// - Takes a multibyte string, allocates the appropriate amount of memory for the conversion, performs the conversion,
-//   and returns the Unicode UTF-16 result in the smart pointer (and the length).
+// - Determines whether a code page maps all of 0x00-0x7F to the same ASCII characters, in both directions,
+//   without any shift state. Text in these that's all ASCII can be converted without asking the system.
+// - This is a list of the common console code pages rather than a test, as a few (EBCDIC, UTF-7, ISO-2022,
+//   864 and Johab) move some of those characters around.
+// Arguments:
+// - codePage - Windows Code Page to check
+// Return Value:
+// - True if ASCII converts to and from it unchanged.
+static bool _IsAsciiCompatible(const UINT codePage) noexcept
+{
+    switch (codePage)
+    {
+    case CP_UTF8:
+    case 437:
+    case 720:
+    case 737:
+    case 775:
+    case 850:
+    case 852:
+    case 855:
+    case 857:
+    case 858:
+    case 860:
+    case 861:
+    case 862:
+    case 863:
+    case 865:
+    case 866:
+    case 869:
+    case 874:
+    case 932:
+    case 936:
+    case 949:
+    case 950:
+        return true;
+    default:
+        return (codePage >= 1250 && codePage <= 1258) || (codePage >= 28591 && codePage <= 28605);
+    }
+}
+
+// Routine Description:
+// - Widens the run of ASCII bytes at the start of a string straight into the destination.
+// Arguments:
+// - source - View of multibyte characters of source text
+// - destination - Where to write the characters. Must have room for all of source.
+// Return Value:
+// - The count of bytes that were ASCII and have been written, up to the first one that isn't.
+static size_t _WidenAsciiRun(const std::string_view source, wchar_t* const destination) noexcept
+{
+    size_t i = 0;
+
+#if defined(_M_IX86) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= source.size(); i += 16)
+    {
+        // The mask is just the most significant bit of every byte.
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.data() + i));
+        const auto mask = static_cast<unsigned long>(_mm_movemask_epi8(bytes));
+        if (mask != 0)
+        {
+            break;
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_unpacklo_epi8(bytes, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 8), _mm_unpackhi_epi8(bytes, zero));
+    }
+#endif
+
+    for (; i < source.size(); ++i)
+    {
+        const auto ch = static_cast<unsigned char>(source[i]);
+        if (ch >= 0x80)
+        {
+            break;
+        }
+        destination[i] = ch;
+    }
+    return i;
+}
+
+// Routine Description:
+// - Narrows the run of ASCII characters at the start of a string straight into the destination.
+// Arguments:
+// - source - Unicode (UTF-16) characters of source text
+// - destination - Where to write the bytes. Must have room for all of source.
+// Return Value:
+// - The count of characters that were ASCII and have been written, up to the first one that isn't.
+static size_t _NarrowAsciiRun(const std::wstring_view source, char* const destination) noexcept
+{
+    size_t i = 0;
+
+#if defined(_M_IX86) || defined(_M_X64)
+    const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= source.size(); i += 16)
+    {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.data() + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.data() + i + 8));
+
+        // Every lane is left as zero only if neither character has bits above 0x7F.
+        const __m128i outside = _mm_and_si128(_mm_or_si128(low, high), nonAscii);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(outside, zero)) != 0xFFFF)
+        {
+            break;
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_packus_epi16(low, high));
+    }
+#endif
+
+    for (; i < source.size(); ++i)
+    {
+        const auto wch = source[i];
+        if (wch >= 0x80)
+        {
+            break;
+        }
+        destination[i] = static_cast<char>(wch);
+    }
+    return i;
+}
+
+// Routine Description:
+// - Takes a multibyte string, sizes the given string for the conversion, performs the conversion,
+//   and returns the Unicode UTF-16 result in it.
 // Arguments:
 // - codepage - Windows Code Page representing the multibyte source text
 // - source - View of multibyte characters of source text
+// - result - An empty string, allocating from wherever the caller wants the result to live.
 // Return Value:
 // - The UTF-16 wide string.
 // - NOTE: Throws suitable HRESULT errors from memory allocation, safe math, or MultiByteToWideChar failures.
+template<typename TString>
 [[nodiscard]]
-std::wstring ConvertToW(const UINT codePage, const std::string_view source)
+static TString _ConvertToW(const UINT codePage, const std::string_view source, TString result)
 {
     // If there's nothing to convert, bail early.
     if (source.empty())
     {
-        return {};
+        return result;
+    }
+
+    // Most text is ASCII. Widen as much of it as we can ourselves, and only ask the system about what's
+    // left after it. Nothing before the first non-ASCII byte can be in the middle of a character, so
+    // the rest converts the same on its own.
+    size_t cchAscii = 0;
+    if (_IsAsciiCompatible(codePage))
+    {
+        result.resize(source.size());
+        cchAscii = _WidenAsciiRun(source, result.data());
+        if (cchAscii == source.size())
+        {
+            return result;
+        }
     }
 
+    const auto rest = source.substr(cchAscii);
+
     int iSource; // convert to int because Mb2Wc requires it.
-    THROW_IF_FAILED(SizeTToInt(source.size(), &iSource));
+    THROW_IF_FAILED(SizeTToInt(rest.size(), &iSource));
 
     // Ask how much space we will need.
-    int const iTarget = MultiByteToWideChar(codePage, 0, source.data(), iSource, nullptr, 0);
+    int const iTarget = MultiByteToWideChar(codePage, 0, rest.data(), iSource, nullptr, 0);
     THROW_LAST_ERROR_IF(0 == iTarget);
 
     size_t cchNeeded;
     THROW_IF_FAILED(IntToSizeT(iTarget, &cchNeeded));
+    THROW_IF_FAILED(SizeTAdd(cchNeeded, cchAscii, &cchNeeded));
+
+    // Convert straight into the string.
+    result.resize(cchNeeded);
+    THROW_LAST_ERROR_IF(0 == MultiByteToWideChar(codePage, 0, rest.data(), iSource, result.data() + cchAscii, iTarget));
 
-    // Allocate ourselves space in a smart pointer.
-    std::unique_ptr<wchar_t[]> pwsOut = std::make_unique<wchar_t[]>(cchNeeded);
-    THROW_IF_NULL_ALLOC(pwsOut);
+    return result;
+}
 
-    // Attempt conversion for real.
-    THROW_LAST_ERROR_IF(0 == MultiByteToWideChar(codePage, 0, source.data(), iSource, pwsOut.get(), iTarget));
+// Routine Description:
+// - Takes a multibyte string, allocates the appropriate amount of memory for the conversion, performs the conversion,
+//   and returns the Unicode UTF-16 result.
+// Arguments:
+// - codepage - Windows Code Page representing the multibyte source text
+// - source - View of multibyte characters of source text
+// Return Value:
+// - The UTF-16 wide string.
+// - NOTE: Throws suitable HRESULT errors from memory allocation, safe math, or MultiByteToWideChar failures.
+[[nodiscard]]
+std::wstring ConvertToW(const UINT codePage, const std::string_view source)
+{
+    return _ConvertToW(codePage, source, std::wstring{});
+}
 
-    // Return as a string
-    return std::wstring(pwsOut.get(), cchNeeded);
+// Routine Description:
+// - Same as above, but the result is allocated from the given memory resource, like the scratch arena of
+//   the thread that's serving an API call.
+// Arguments:
+// - codepage - Windows Code Page representing the multibyte source text
+// - source - View of multibyte characters of source text
+// - resource - Where to allocate the result from
+// Return Value:
+// - The UTF-16 wide string.
+// - NOTE: Throws suitable HRESULT errors from memory allocation, safe math, or MultiByteToWideChar failures.
+[[nodiscard]]
+std::pmr::wstring ConvertToW(const UINT codePage, const std::string_view source, std::pmr::memory_resource* const resource)
+{
+    return _ConvertToW(codePage, source, std::pmr::wstring{ resource });
 }
 
 // Routine Description:
-// - Takes a wide string, allocates the appropriate amount of memory for the conversion, performs the conversion,
-//   and returns the Multibyte result
+// - Takes a wide string, sizes the given string for the conversion, performs the conversion,
+//   and returns the Multibyte result in it.
 // Arguments:
 // - codepage - Windows Code Page representing the multibyte destination text
 // - source - Unicode (UTF-16) characters of source text
+// - result - An empty string, allocating from wherever the caller wants the result to live.
 // Return Value:
 // - The multibyte string encoded in the given codepage
 // - NOTE: Throws suitable HRESULT errors from memory allocation, safe math, or MultiByteToWideChar failures.
+template<typename TString>
 [[nodiscard]]
-std::string ConvertToA(const UINT codepage, const std::wstring_view source)
+static TString _ConvertToA(const UINT codepage, const std::wstring_view source, TString result)
 {
     // If there's nothing to convert, bail early.
     if (source.empty())
     {
-        return {};
+        return result;
     }
-    
+
+    // Narrow the ASCII at the start ourselves, and only ask the system about what's left after it.
+    size_t cchAscii = 0;
+    if (_IsAsciiCompatible(codepage))
+    {
+        result.resize(source.size());
+        cchAscii = _NarrowAsciiRun(source, result.data());
+        if (cchAscii == source.size())
+        {
+            return result;
+        }
+    }
+
+    const auto rest = source.substr(cchAscii);
+
     int iSource; // convert to int because Wc2Mb requires it.
-    THROW_IF_FAILED(SizeTToInt(source.size(), &iSource));
+    THROW_IF_FAILED(SizeTToInt(rest.size(), &iSource));
 
     // Ask how much space we will need.
 #pragma prefast(suppress:__WARNING_W2A_BEST_FIT, "WC_NO_BEST_FIT_CHARS doesn't work in many codepages. Retain old behavior.")
-    int const iTarget = WideCharToMultiByte(codepage, 0, source.data(), iSource, nullptr, 0, nullptr, nullptr);
+    int const iTarget = WideCharToMultiByte(codepage, 0, rest.data(), iSource, nullptr, 0, nullptr, nullptr);
     THROW_LAST_ERROR_IF(0 == iTarget);
 
     size_t cchNeeded;
     THROW_IF_FAILED(IntToSizeT(iTarget, &cchNeeded));
+    THROW_IF_FAILED(SizeTAdd(cchNeeded, cchAscii, &cchNeeded));
 
-    // Allocate ourselves space in a smart pointer
-    std::unique_ptr<char[]> psOut = std::make_unique<char[]>(cchNeeded);
-    THROW_IF_NULL_ALLOC(psOut.get());
-
-    // Attempt conversion for real.
+    // Convert straight into the string.
+    result.resize(cchNeeded);
 #pragma prefast(suppress:__WARNING_W2A_BEST_FIT, "WC_NO_BEST_FIT_CHARS doesn't work in many codepages. Retain old behavior.")
-    THROW_LAST_ERROR_IF(0 == WideCharToMultiByte(codepage, 0, source.data(), iSource, psOut.get(), iTarget, nullptr, nullptr));
+    THROW_LAST_ERROR_IF(0 == WideCharToMultiByte(codepage, 0, rest.data(), iSource, result.data() + cchAscii, iTarget, nullptr, nullptr));
 
-    // Return as a string
-    return std::string(psOut.get(), cchNeeded);
+    return result;
+}
+
+// Routine Description:
+// - Takes a wide string, allocates the appropriate amount of memory for the conversion, performs the conversion,
+//   and returns the Multibyte result
+// Arguments:
+// - codepage - Windows Code Page representing the multibyte destination text
+// - source - Unicode (UTF-16) characters of source text
+// Return Value:
+// - The multibyte string encoded in the given codepage
+// - NOTE: Throws suitable HRESULT errors from memory allocation, safe math, or MultiByteToWideChar failures.
+[[nodiscard]]
+std::string ConvertToA(const UINT codepage, const std::wstring_view source)
+{
+    return _ConvertToA(codepage, source, std::string{});
+}
+
+// Routine Description:
+// - Same as above, but the result is allocated from the given memory resource, like the scratch arena of
+//   the thread that's serving an API call.
+// Arguments:
+// - codepage - Windows Code Page representing the multibyte destination text
+// - source - Unicode (UTF-16) characters of source text
+// - resource - Where to allocate the result from
+// Return Value:
+// - The multibyte string encoded in the given codepage
+// - NOTE: Throws suitable HRESULT errors from memory allocation, safe math, or MultiByteToWideChar failures.
+[[nodiscard]]
+std::pmr::string ConvertToA(const UINT codepage, const std::wstring_view source, std::pmr::memory_resource* const resource)
+{
+    return _ConvertToA(codepage, source, std::pmr::string{ resource });
 }
 
 // Routine Description:
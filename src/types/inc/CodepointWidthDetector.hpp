@@ -22,82 +22,31 @@ static_assert(sizeof(unsigned int) == sizeof(wchar_t) * 2,
 // use to measure the width of a codepoint
 class CodepointWidthDetector final
 {
-protected:
-
-    // used to store range data in CodepointWidthDetector's internal map
-    class UnicodeRange final
+public:
+    // A range of codepoints (inclusive) that all have the same width.
+    struct UnicodeRange final
     {
-    public:
-        UnicodeRange(const unsigned int lowerBound,
-                     const unsigned int upperBound) :
-                     _lowerBound{ lowerBound },
-                     _upperBound{ upperBound },
-                     _isBounds{ true }
-        {
-        }
-
-        UnicodeRange(const unsigned int searchTerm) :
-                     _lowerBound{ searchTerm },
-                     _upperBound{ searchTerm },
-                     _isBounds{ false }
-        {
-        }
-
-        bool IsBounds() const noexcept
-        {
-            return _isBounds;
-        }
-
-        unsigned int LowerBound() const
-        {
-            FAIL_FAST_IF(!_isBounds);
-            return _lowerBound;
-        }
-
-        unsigned int UpperBound() const
-        {
-            FAIL_FAST_IF(!_isBounds);
-            return _upperBound;
-        }
-
-        unsigned int SearchTerm() const
-        {
-            FAIL_FAST_IF(_isBounds);
-            return _lowerBound;
-        }
-
-    private:
-        unsigned int _lowerBound;
-        unsigned int _upperBound;
-        bool _isBounds;
+        unsigned int lowerBound;
+        unsigned int upperBound;
+        CodepointWidth width;
     };
 
-    // used for comparing if we've found the range that a searching UnicodeRange falls into
-    struct UnicodeRangeCompare final
-    {
-        bool operator()(const UnicodeRange& a, const UnicodeRange& b) const
-        {
-            if (!a.IsBounds() && b.IsBounds())
-            {
-                return a.SearchTerm() < b.LowerBound();
-            }
-            else if (a.IsBounds() && !b.IsBounds())
-            {
-                return a.UpperBound() < b.SearchTerm();
-            }
-            else if (a.IsBounds() && b.IsBounds())
-            {
-                return a.LowerBound() < b.LowerBound();
-            }
-            else
-            {
-                return a.SearchTerm() < b.SearchTerm();
-            }
-        }
+    static constexpr unsigned int s_CodepointCount = 0x110000;
+
+    // Characters that are ambiguous and likely to be written, whose widths are worth
+    // asking the font about before they turn up.
+    static constexpr std::pair<wchar_t, wchar_t> s_CommonAmbiguousRanges[] = {
+        { 0x00A1, 0x00FF }, // Latin-1 Supplement
+        { 0x0391, 0x03C9 }, // Greek
+        { 0x0401, 0x0451 }, // Cyrillic
+        { 0x2010, 0x203E }, // General Punctuation
+        { 0x2190, 0x21FF }, // Arrows
+        { 0x2460, 0x24FF }, // Enclosed Alphanumerics
+        { 0x2500, 0x25FF }, // Box Drawing, Block Elements, Geometric Shapes
+        { 0x2600, 0x26FF } // Miscellaneous Symbols
     };
 
-public:
-    CodepointWidthDetector() = default;
+    CodepointWidthDetector();
     CodepointWidthDetector(const CodepointWidthDetector&) = delete;
     CodepointWidthDetector(CodepointWidthDetector&&) = delete;
     ~CodepointWidthDetector() = default;
@@ -109,18 +58,59 @@ public:
     void SetFallbackMethod(std::function<bool(const std::wstring_view)> pfnFallback);
     void NotifyFontChanged() const noexcept;
 
+    uint64_t GetFontGeneration() const noexcept;
+    bool PrewarmFallbackCache(const wchar_t first, const wchar_t last, const uint64_t fontGeneration) const;
+
 #ifdef UNIT_TESTING
     friend class CodepointWidthDetectorTests;
 #endif
 
 private:
+    // The widths of the whole code space are looked up in two stages: the top bits of a
+    // codepoint pick a block of s_BlockSize widths, and the bottom bits pick the width
+    // within it. Most blocks are entirely one width, so the blocks that are the same are
+    // only stored once.
+    static constexpr unsigned int s_BlockShift = 8;
+    static constexpr unsigned int s_BlockSize = 1u << s_BlockShift;
+    static constexpr unsigned int s_BlockCount = s_CodepointCount >> s_BlockShift;
+
+    struct WidthTable
+    {
+        std::array<BYTE, s_BlockCount> blockIndices;
+        std::vector<std::array<CodepointWidth, s_BlockSize>> blocks;
+    };
+
+    // The fallback's answers are kept in an open addressed table of slots that can be read
+    // and written from any thread without a lock. Each slot packs the codepoint, whether it's
+    // wide, and the font generation it was asked about for into one atomic value. A slot of 0
+    // is empty, which is why generations start at 1.
+    static constexpr size_t s_FallbackSlotCount = 4096;
+    static constexpr size_t s_FallbackMaxProbes = 8;
+    static constexpr unsigned int s_SlotValidBit = 0x1;
+    static constexpr unsigned int s_SlotWideBit = 0x2;
+    static constexpr unsigned int s_SlotCodepointShift = 2;
+    static constexpr unsigned int s_SlotGenerationShift = 24;
+    static constexpr uint64_t s_GenerationMask = (1ull << (64 - s_SlotGenerationShift)) - 1;
+
+    static uint64_t s_MakeSlot(const unsigned int codepoint, const bool isWide, const uint64_t generation) noexcept;
+    static unsigned int s_SlotCodepoint(const uint64_t slot) noexcept;
+    static uint64_t s_SlotGeneration(const uint64_t slot) noexcept;
+    static size_t s_SlotIndex(const unsigned int codepoint) noexcept;
+
+    static const WidthTable& s_GetWidthTable();
+    static CodepointWidth s_LookupRange(const unsigned int codepoint) noexcept;
+
     bool _lookupIsWide(const std::wstring_view glyph) const noexcept;
+    bool _isAmbiguous(const wchar_t wch) const noexcept;
     bool _checkFallbackViaCache(const std::wstring_view glyph) const;
+    std::optional<bool> _findFallback(const unsigned int codepoint, const uint64_t generation) const noexcept;
+    void _storeFallback(const unsigned int codepoint, const bool isWide, const uint64_t generation) const noexcept;
     unsigned int _extractCodepoint(const std::wstring_view glyph) const noexcept;
-    void _populateUnicodeSearchMap();
 
-    mutable std::map<std::wstring, bool> _fallbackCache;
-    std::map<UnicodeRange, CodepointWidth, UnicodeRangeCompare> _map;
+    // Changing the font doesn't empty the cache, it just moves on to a new generation,
+    // and whatever was cached for an older one gets asked about again.
+    std::unique_ptr<std::atomic<uint64_t>[]> _fallbackSlots;
+    mutable std::atomic<uint64_t> _fontGeneration;
     std::function<bool(std::wstring_view)> _pfnFallbackMethod;
     bool _hasFallback = false;
 };
@@ -0,0 +1,75 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- MemoryUsage.hpp
+
+Abstract:
+- How much of the heap something is holding on to: the bytes, and how many
+  separate allocations they're in. Each part of the console adds up its own
+  when asked, by looking at its containers, so keeping track costs nothing
+  until someone wants to know.
+- These are estimates. Allocator overhead isn't counted, and the nodes of the
+  node based containers are counted as their value and a couple of pointers.
+--*/
+
+#pragma once
+
+namespace Microsoft::Console::Types
+{
+    struct MemoryUsage
+    {
+        size_t bytes = 0;
+        size_t allocations = 0;
+
+        MemoryUsage& operator+=(const MemoryUsage& other) noexcept
+        {
+            bytes += other.bytes;
+            allocations += other.allocations;
+            return *this;
+        }
+
+        // One allocation of the given size, if there is one.
+        void AddAllocation(const size_t size) noexcept
+        {
+            if (size != 0)
+            {
+                bytes += size;
+                allocations++;
+            }
+        }
+
+        // The storage of a vector or a string, whether or not it's all in use.
+        // A string short enough to be kept inside of itself doesn't allocate.
+        template<typename T>
+        void AddContiguous(const T& container) noexcept
+        {
+            using value_type = typename T::value_type;
+            if constexpr (std::is_same_v<T, std::basic_string<value_type>>)
+            {
+                if (container.capacity() <= T{}.capacity())
+                {
+                    return;
+                }
+            }
+            AddAllocation(container.capacity() * sizeof(value_type));
+        }
+
+        // A node for each element of a list, map or set.
+        template<typename T>
+        void AddNodes(const T& container) noexcept
+        {
+            bytes += container.size() * (sizeof(typename T::value_type) + 2 * sizeof(void*));
+            allocations += container.size();
+        }
+
+        // The nodes of a hash table, and its buckets.
+        template<typename T>
+        void AddHashTable(const T& container) noexcept
+        {
+            AddNodes(container);
+            AddAllocation(container.bucket_count() * sizeof(void*));
+        }
+    };
+}
@@ -0,0 +1,68 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ScratchArena.hpp
+
+Abstract:
+- A bump allocator for the temporary strings and vectors that an API call
+  needs only for as long as it runs, like the text of an A call converted to
+  W. Each thread has its own, so it takes no lock.
+- It's a std::pmr::memory_resource, so the std::pmr containers can draw from
+  it. Allocating only moves a pointer along one block of memory that's kept
+  from one call to the next. Once everything allocated from it has been
+  freed, it starts from the front of its block again.
+- What doesn't fit in the block spills over into the heap. When the arena is
+  reset after a message that spilled, the block is grown to fit everything at
+  once next time, up to a limit.
+- Nothing drawn from it may outlive the message it was drawn for.
+--*/
+
+#pragma once
+
+#include <memory_resource>
+
+namespace Microsoft::Console::Types
+{
+    class ScratchArena final : public std::pmr::memory_resource
+    {
+    public:
+        ScratchArena() noexcept;
+        ~ScratchArena() override;
+
+        ScratchArena(const ScratchArena&) = delete;
+        ScratchArena& operator=(const ScratchArena&) = delete;
+
+        static ScratchArena& ForThisThread() noexcept;
+
+        void Reset() noexcept;
+
+    private:
+        static constexpr size_t s_InitialSize = 64 * 1024;
+        static constexpr size_t s_MaxBlockSize = 1024 * 1024;
+
+        struct Spill
+        {
+            void* p;
+            size_t bytes;
+            size_t alignment;
+        };
+
+        std::byte* _block;
+        size_t _blockSize;
+        size_t _used;
+        // What didn't fit in the block and hasn't been freed yet, and how much
+        //      has spilled since the last reset.
+        std::vector<Spill> _spills;
+        size_t _spilledBytes;
+        // How many allocations haven't been freed yet.
+        size_t _live;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        void _FreeSpills() noexcept;
+    };
+}
@@ -0,0 +1,73 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- SharedRing.hpp
+
+Abstract:
+- A ring of bytes in a section of shared memory, for streaming output from one
+  process to another without going through a pipe.
+- There's exactly one writer and one reader, so the ring only needs a pair of
+  indices that each side moves on its own.
+- The reader waits on an event when the ring is empty. The writer only sets it
+  when it's written to an empty ring, so a busy stream doesn't make a kernel
+  call per write. The same goes for the writer waiting on a full ring.
+- The process that creates the ring makes its handles inheritable while it
+  launches the other one, and passes it the section handle. The other handles
+  are found in the ring's header.
+--*/
+
+#pragma once
+
+namespace Microsoft::Console::Types
+{
+    class SharedRing final
+    {
+    public:
+        static constexpr size_t DefaultCapacity = 1024 * 1024;
+
+        [[nodiscard]]
+        static HRESULT s_Create(const size_t capacity, std::unique_ptr<SharedRing>& ring) noexcept;
+        [[nodiscard]]
+        static HRESULT s_Open(const HANDLE section, std::unique_ptr<SharedRing>& ring) noexcept;
+
+        HANDLE GetSection() const noexcept;
+        HANDLE GetDataEvent() const noexcept;
+        [[nodiscard]]
+        HRESULT SetInheritable(const bool inheritable) noexcept;
+
+        [[nodiscard]]
+        HRESULT Write(std::string_view data) noexcept;
+        size_t Read(char* const buffer, const size_t size) noexcept;
+        void Close() noexcept;
+        bool IsClosed() const noexcept;
+
+    private:
+        // The start of the section. Each index only ever grows, and is only
+        //      moved by one side: the writer moves the tail, the reader the head.
+        //      They're kept in their own cache lines so the two don't contend.
+        struct Header
+        {
+            alignas(64) std::atomic<uint64_t> head;
+            alignas(64) std::atomic<uint64_t> tail;
+            alignas(64) uint64_t capacity;
+            uint32_t dataEvent;
+            uint32_t spaceEvent;
+            std::atomic<uint32_t> closed;
+        };
+
+        SharedRing() noexcept;
+
+        wil::unique_handle _section;
+        wil::unique_handle _dataEvent;
+        wil::unique_handle _spaceEvent;
+        wil::unique_mapview_ptr<void> _view;
+        Header* _header;
+        char* _data;
+        uint64_t _mask;
+
+        [[nodiscard]]
+        HRESULT _Map() noexcept;
+    };
+}
@@ -17,7 +17,7 @@ Author(s):
 #include <vector>
 #include <optional>
 #include <bitset>
-
+#include <iterator>
 
 class Utf16Parser final
 {
@@ -28,6 +28,50 @@ private:
     static constexpr std::bitset<IndicatorBitCount> TrailingSurrogateMask = { 55 }; // 110 111 indicates a trailing surrogate
 
 public:
+    // Walks the codepoints of a string as views into it, without copying them out.
+    // Badly formed leading/trailing char sequences are skipped, the same as Parse.
+    class GlyphIterator final
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::wstring_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::wstring_view*;
+        using reference = const std::wstring_view&;
+
+        GlyphIterator() noexcept = default;
+        GlyphIterator(const std::wstring_view wstr) noexcept;
+
+        reference operator*() const noexcept { return _glyph; }
+        pointer operator->() const noexcept { return &_glyph; }
+
+        GlyphIterator& operator++() noexcept;
+        GlyphIterator operator++(int) noexcept;
+
+        bool operator==(const GlyphIterator& it) const noexcept;
+        bool operator!=(const GlyphIterator& it) const noexcept;
+
+    private:
+        std::wstring_view _remaining;
+        std::wstring_view _glyph;
+    };
+
+    // The glyphs of a string, for use in a range-based for loop.
+    class GlyphRange final
+    {
+    public:
+        constexpr GlyphRange(const std::wstring_view wstr) noexcept :
+            _wstr{ wstr } {}
+
+        GlyphIterator begin() const noexcept { return { _wstr }; }
+        GlyphIterator end() const noexcept { return {}; }
+
+    private:
+        std::wstring_view _wstr;
+    };
+
+    static GlyphRange Glyphs(const std::wstring_view wstr) noexcept { return { wstr }; }
+
     static std::vector<std::vector<wchar_t>> Parse(std::wstring_view wstr);
     static std::wstring_view ParseNext(std::wstring_view wstr);
 
@@ -0,0 +1,73 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- Utf8Decoder.hpp
+
+Abstract:
+- Incrementally decodes a stream of UTF-8 that arrives in arbitrary chunks,
+  like the output read from a pipe, into UTF-16.
+- A sequence that's cut off at the end of one chunk is held on to until the
+  next chunk completes it. Invalid sequences become U+FFFD.
+- The decoded text is written into a buffer that's kept between calls, so
+  decoding a steady stream doesn't allocate.
+- The VT state machine decodes UTF-8 on its own as it parses it (see
+  StateMachine::ProcessUtf8String), but measures codepoints the same way.
+--*/
+
+#pragma once
+
+namespace Microsoft::Console::Types
+{
+    class Utf8Decoder final
+    {
+    public:
+        Utf8Decoder() noexcept;
+
+        std::wstring_view Decode(std::string_view utf8);
+        void Reset() noexcept;
+
+        // Measures the codepoint at the start of utf8, in bytes. It's 0 if utf8 ends
+        // before the codepoint does. A lead byte that isn't followed by enough
+        // continuation bytes is only as long as the ones that do follow it, and will
+        // be decoded to U+FFFD.
+        static constexpr size_t CodepointLength(const std::string_view utf8) noexcept
+        {
+            const auto lead = static_cast<unsigned char>(utf8.front());
+            size_t length = 1;
+            if (lead >= 0xC2 && lead <= 0xDF)
+            {
+                length = 2;
+            }
+            else if (lead >= 0xE0 && lead <= 0xEF)
+            {
+                length = 3;
+            }
+            else if (lead >= 0xF0 && lead <= 0xF4)
+            {
+                length = 4;
+            }
+
+            for (size_t i = 1; i < length; i++)
+            {
+                if (i >= utf8.size())
+                {
+                    return 0;
+                }
+                if ((static_cast<unsigned char>(utf8[i]) & 0xC0) != 0x80)
+                {
+                    return i;
+                }
+            }
+            return length;
+        }
+
+    private:
+
+        // the start of a sequence that was cut off at the end of the last chunk.
+        std::string _partial;
+        // the buffer each chunk is decoded into.
+        std::wstring _decoded;
+    };
+}
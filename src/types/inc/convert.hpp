@@ -16,6 +16,7 @@ Author:
 #pragma once
 #include <deque>
 #include <memory>
+#include <memory_resource>
 #include "IInputEvent.hpp"
 
 enum class CodepointWidth : BYTE
@@ -34,6 +35,16 @@ std::wstring ConvertToW(const UINT codepage,
 std::string ConvertToA(const UINT codepage,
                        const std::wstring_view source);
 
+[[nodiscard]]
+std::pmr::wstring ConvertToW(const UINT codepage,
+                             const std::string_view source,
+                             std::pmr::memory_resource* const resource);
+
+[[nodiscard]]
+std::pmr::string ConvertToA(const UINT codepage,
+                            const std::wstring_view source,
+                            std::pmr::memory_resource* const resource);
+
 [[nodiscard]]
 size_t GetALengthFromW(const UINT codepage,
                        const std::wstring_view source);
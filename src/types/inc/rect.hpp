@@ -0,0 +1,119 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- rect.hpp
+
+Abstract:
+- Arithmetic on exclusive SMALL_RECTs, for code that does a lot of it, like
+  keeping track of what has to be drawn again.
+- Unlike Viewport, nothing here converts between inclusive and exclusive
+  rectangles or checks for overflow along the way. Everything is constexpr and
+  works out its answer with min and max rather than with branches.
+- A rectangle is empty if it has no width or no height. All empty rectangles
+  are the same, and operations that come out empty give back {0, 0, 0, 0}.
+--*/
+
+#pragma once
+
+namespace Microsoft::Console::Types::Rect
+{
+    constexpr SMALL_RECT Empty() noexcept
+    {
+        return { 0, 0, 0, 0 };
+    }
+
+    constexpr bool IsEmpty(const SMALL_RECT& rect) noexcept
+    {
+        return rect.Left >= rect.Right || rect.Top >= rect.Bottom;
+    }
+
+    constexpr int Area(const SMALL_RECT& rect) noexcept
+    {
+        return IsEmpty(rect) ? 0 : (rect.Right - rect.Left) * (rect.Bottom - rect.Top);
+    }
+
+    constexpr bool Overlaps(const SMALL_RECT& lhs, const SMALL_RECT& rhs) noexcept
+    {
+        return lhs.Left < rhs.Right && rhs.Left < lhs.Right &&
+               lhs.Top < rhs.Bottom && rhs.Top < lhs.Bottom;
+    }
+
+    constexpr bool Contains(const SMALL_RECT& outer, const SMALL_RECT& inner) noexcept
+    {
+        return IsEmpty(inner) ||
+               (outer.Left <= inner.Left && outer.Top <= inner.Top &&
+                outer.Right >= inner.Right && outer.Bottom >= inner.Bottom);
+    }
+
+    constexpr SMALL_RECT Intersect(const SMALL_RECT& lhs, const SMALL_RECT& rhs) noexcept
+    {
+        const SMALL_RECT intersection{ std::max(lhs.Left, rhs.Left),
+                                       std::max(lhs.Top, rhs.Top),
+                                       std::min(lhs.Right, rhs.Right),
+                                       std::min(lhs.Bottom, rhs.Bottom) };
+        return IsEmpty(intersection) ? Empty() : intersection;
+    }
+
+    // The smallest rectangle around both of them. An empty one doesn't count.
+    constexpr SMALL_RECT Union(const SMALL_RECT& lhs, const SMALL_RECT& rhs) noexcept
+    {
+        if (IsEmpty(lhs))
+        {
+            return IsEmpty(rhs) ? Empty() : rhs;
+        }
+        if (IsEmpty(rhs))
+        {
+            return lhs;
+        }
+        return { std::min(lhs.Left, rhs.Left),
+                 std::min(lhs.Top, rhs.Top),
+                 std::max(lhs.Right, rhs.Right),
+                 std::max(lhs.Bottom, rhs.Bottom) };
+    }
+
+    // Whether the rectangle around both of them covers nothing that neither of them
+    // does: they're on the same rows and touch or overlap across, or the same in
+    // columns and touch or overlap down, or one is inside the other.
+    constexpr bool CanMerge(const SMALL_RECT& lhs, const SMALL_RECT& rhs) noexcept
+    {
+        return (lhs.Top == rhs.Top && lhs.Bottom == rhs.Bottom && lhs.Left <= rhs.Right && rhs.Left <= lhs.Right) ||
+               (lhs.Left == rhs.Left && lhs.Right == rhs.Right && lhs.Top <= rhs.Bottom && rhs.Top <= lhs.Bottom) ||
+               Contains(lhs, rhs) ||
+               Contains(rhs, lhs);
+    }
+
+    // Moves the rectangle, pinning its edges at the ends of what a SHORT can hold
+    // instead of letting them wrap around.
+    constexpr SMALL_RECT Offset(const SMALL_RECT& rect, const COORD delta) noexcept
+    {
+        constexpr int low = SHRT_MIN;
+        constexpr int high = SHRT_MAX;
+        return { static_cast<SHORT>(std::clamp(rect.Left + delta.X, low, high)),
+                 static_cast<SHORT>(std::clamp(rect.Top + delta.Y, low, high)),
+                 static_cast<SHORT>(std::clamp(rect.Right + delta.X, low, high)),
+                 static_cast<SHORT>(std::clamp(rect.Bottom + delta.Y, low, high)) };
+    }
+
+    constexpr SMALL_RECT FromInclusive(const SMALL_RECT& inclusive) noexcept
+    {
+        return { inclusive.Left,
+                 inclusive.Top,
+                 static_cast<SHORT>(inclusive.Right + 1),
+                 static_cast<SHORT>(inclusive.Bottom + 1) };
+    }
+
+    constexpr SMALL_RECT ToInclusive(const SMALL_RECT& rect) noexcept
+    {
+        return { rect.Left,
+                 rect.Top,
+                 static_cast<SHORT>(rect.Right - 1),
+                 static_cast<SHORT>(rect.Bottom - 1) };
+    }
+
+    constexpr RECT ToRect(const SMALL_RECT& rect) noexcept
+    {
+        return { rect.Left, rect.Top, rect.Right, rect.Bottom };
+    }
+}
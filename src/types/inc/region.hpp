@@ -0,0 +1,53 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- region.hpp
+
+Abstract:
+- A handful of exclusive rectangles that don't overlap, for keeping track of
+  what has to be drawn again without a std::vector<SMALL_RECT> and its
+  allocations.
+- A rectangle that's added is merged with whatever it overlaps, or whatever it
+  can be merged with without covering anything more. So text written one
+  character at a time comes out as one rectangle.
+- There's only room for s_MaxRects rectangles. Once they're all used, the next
+  one is merged with whichever rectangle that grows the least, so the region
+  only ever covers more than what was added, never less.
+--*/
+
+#pragma once
+
+#include "rect.hpp"
+
+#include <array>
+
+namespace Microsoft::Console::Types
+{
+    class Region final
+    {
+    public:
+        static constexpr size_t s_MaxRects = 16;
+
+        Region() noexcept;
+
+        void Add(const SMALL_RECT& exclusive) noexcept;
+        void Offset(const COORD delta) noexcept;
+        void Clip(const SMALL_RECT& exclusive) noexcept;
+        void Clear() noexcept;
+
+        bool empty() const noexcept;
+        size_t size() const noexcept;
+        SMALL_RECT GetBounds() const noexcept;
+
+        const SMALL_RECT* begin() const noexcept;
+        const SMALL_RECT* end() const noexcept;
+
+    private:
+        void _Remove(const size_t index) noexcept;
+
+        std::array<SMALL_RECT, s_MaxRects> _rects;
+        size_t _count;
+    };
+}
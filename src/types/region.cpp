@@ -0,0 +1,160 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "inc/region.hpp"
+
+using namespace Microsoft::Console::Types;
+
+Region::Region() noexcept :
+    _rects{},
+    _count{ 0 }
+{
+}
+
+// Routine Description:
+// - Adds a rectangle to the region.
+// Arguments:
+// - exclusive - the rectangle to add
+void Region::Add(const SMALL_RECT& exclusive) noexcept
+{
+    auto rect = exclusive;
+    if (Rect::IsEmpty(rect))
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        // Whatever it overlaps, or can be merged with exactly, it takes in. Each time
+        // it grows it might reach others, so it's checked against all of them again.
+        bool merged = false;
+        for (size_t i = 0; i < _count; ++i)
+        {
+            if (Rect::Contains(_rects[i], rect))
+            {
+                return;
+            }
+            if (Rect::Overlaps(_rects[i], rect) || Rect::CanMerge(_rects[i], rect))
+            {
+                rect = Rect::Union(rect, _rects[i]);
+                _Remove(i);
+                merged = true;
+                break;
+            }
+        }
+
+        if (merged)
+        {
+            continue;
+        }
+
+        if (_count < _rects.size())
+        {
+            _rects[_count++] = rect;
+            return;
+        }
+
+        // There's no room for it, so it goes in with the one that grows the least.
+        size_t best = 0;
+        int bestGrowth = INT_MAX;
+        for (size_t i = 0; i < _count; ++i)
+        {
+            const auto growth = Rect::Area(Rect::Union(rect, _rects[i])) - Rect::Area(_rects[i]);
+            if (growth < bestGrowth)
+            {
+                best = i;
+                bestGrowth = growth;
+            }
+        }
+        rect = Rect::Union(rect, _rects[best]);
+        _Remove(best);
+    }
+}
+
+// Routine Description:
+// - Moves everything in the region.
+// Arguments:
+// - delta - how far to move it
+void Region::Offset(const COORD delta) noexcept
+{
+    for (size_t i = 0; i < _count; ++i)
+    {
+        _rects[i] = Rect::Offset(_rects[i], delta);
+    }
+
+    // Pinning them at the edges of what can be held can squash some of them flat.
+    for (size_t i = _count; i > 0; --i)
+    {
+        if (Rect::IsEmpty(_rects[i - 1]))
+        {
+            _Remove(i - 1);
+        }
+    }
+}
+
+// Routine Description:
+// - Cuts off any of the region that's outside the given rectangle.
+// Arguments:
+// - exclusive - the rectangle to keep the region inside of
+void Region::Clip(const SMALL_RECT& exclusive) noexcept
+{
+    for (size_t i = _count; i > 0; --i)
+    {
+        _rects[i - 1] = Rect::Intersect(_rects[i - 1], exclusive);
+        if (Rect::IsEmpty(_rects[i - 1]))
+        {
+            _Remove(i - 1);
+        }
+    }
+}
+
+void Region::Clear() noexcept
+{
+    _count = 0;
+}
+
+bool Region::empty() const noexcept
+{
+    return _count == 0;
+}
+
+size_t Region::size() const noexcept
+{
+    return _count;
+}
+
+// Routine Description:
+// - Gets the smallest rectangle around everything in the region.
+// Return Value:
+// - the rectangle, or an empty one if the region is.
+SMALL_RECT Region::GetBounds() const noexcept
+{
+    auto bounds = Rect::Empty();
+    for (size_t i = 0; i < _count; ++i)
+    {
+        bounds = Rect::Union(bounds, _rects[i]);
+    }
+    return bounds;
+}
+
+const SMALL_RECT* Region::begin() const noexcept
+{
+    return _rects.data();
+}
+
+const SMALL_RECT* Region::end() const noexcept
+{
+    return _rects.data() + _count;
+}
+
+// Routine Description:
+// - Takes a rectangle out, putting the last one in its place.
+// Arguments:
+// - index - which rectangle to take out
+void Region::_Remove(const size_t index) noexcept
+{
+    _rects[index] = _rects[_count - 1];
+    --_count;
+}
@@ -0,0 +1,53 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "..\..\inc\consoletaeftemplates.hpp"
+
+#include "..\inc\convert.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class ConvertTests
+{
+    TEST_CLASS(ConvertTests);
+
+    TEST_METHOD(AsciiRoundTripsWithoutTheSystem)
+    {
+        // Long enough to go through the vector loop more than once, with a tail.
+        std::string ascii;
+        for (int i = 0; i < 37; ++i)
+        {
+            ascii.push_back(static_cast<char>(0x20 + i * 2));
+        }
+
+        const auto wide = ConvertToW(CP_UTF8, ascii);
+        VERIFY_ARE_EQUAL(ascii.size(), wide.size());
+        for (size_t i = 0; i < ascii.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(static_cast<wchar_t>(ascii[i]), wide[i]);
+        }
+
+        VERIFY_ARE_EQUAL(ascii, ConvertToA(437, wide));
+    }
+
+    TEST_METHOD(TextAfterAsciiIsStillConverted)
+    {
+        // Non-ASCII at the start, in the middle of a vector's worth and at the very end.
+        const std::wstring wide{ L"\x00e9" L"0123456789abcdefghij\x6f22z0123456789abcdefghij\x00fc" };
+        const std::string utf8{ "\xC3\xA9" "0123456789abcdefghij\xE6\xBC\xA2z0123456789abcdefghij\xC3\xBC" };
+
+        VERIFY_ARE_EQUAL(wide, ConvertToW(CP_UTF8, utf8));
+        VERIFY_ARE_EQUAL(utf8, ConvertToA(CP_UTF8, wide));
+
+        // Shift-JIS trail bytes overlap ASCII (katakana so ends in a backslash), so what follows
+        // the first lead byte has to be left to the system.
+        const std::string sjis{ "abc\x83\x5c\\" };
+        const std::wstring expected{ L"abc\x30bd\\" };
+        VERIFY_ARE_EQUAL(expected, ConvertToW(932, sjis));
+        VERIFY_ARE_EQUAL(sjis, ConvertToA(932, expected));
+    }
+};
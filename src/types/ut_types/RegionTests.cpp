@@ -0,0 +1,94 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "..\..\inc\consoletaeftemplates.hpp"
+
+#include "..\inc\region.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Console::Types;
+
+static_assert(Rect::IsEmpty(Rect::Intersect({ 0, 0, 5, 5 }, { 5, 0, 10, 5 })));
+static_assert(Rect::Area(Rect::Union({ 0, 0, 2, 1 }, { 8, 3, 10, 4 })) == 40);
+static_assert(Rect::Offset({ 0, 0, 10, 10 }, { SHRT_MAX, -5 }).Right == SHRT_MAX);
+
+class RegionTests
+{
+    TEST_CLASS(RegionTests);
+
+    TEST_METHOD(MergesCharactersWrittenOneAtATime)
+    {
+        Region region;
+        for (SHORT x = 0; x < 10; ++x)
+        {
+            region.Add({ x, 3, gsl::narrow_cast<SHORT>(x + 1), 4 });
+        }
+
+        VERIFY_ARE_EQUAL(1u, region.size());
+        const SMALL_RECT expected{ 0, 3, 10, 4 };
+        VERIFY_ARE_EQUAL(expected, *region.begin());
+    }
+
+    TEST_METHOD(KeepsRectanglesThatDoNotTouchApart)
+    {
+        Region region;
+        region.Add({ 0, 0, 5, 1 });
+        region.Add({ 0, 10, 5, 11 });
+        region.Add({ 0, 0, 0, 20 });
+
+        VERIFY_ARE_EQUAL(2u, region.size());
+
+        Log::Comment(L"A rectangle that overlaps both takes them in.");
+        region.Add({ 2, 0, 3, 11 });
+        VERIFY_ARE_EQUAL(1u, region.size());
+        const SMALL_RECT expected{ 0, 0, 5, 11 };
+        VERIFY_ARE_EQUAL(expected, region.GetBounds());
+    }
+
+    TEST_METHOD(CoversEverythingAddedOnceItIsFull)
+    {
+        Region region;
+        std::vector<SMALL_RECT> added;
+        for (SHORT y = 0; y < 40; y += 2)
+        {
+            const SMALL_RECT rect{ gsl::narrow_cast<SHORT>(y % 7), y, gsl::narrow_cast<SHORT>(y % 7 + 1), gsl::narrow_cast<SHORT>(y + 1) };
+            region.Add(rect);
+            added.push_back(rect);
+        }
+
+        VERIFY_IS_TRUE(region.size() <= Region::s_MaxRects);
+        for (const auto& rect : added)
+        {
+            VERIFY_IS_TRUE(std::any_of(region.begin(), region.end(), [&](const SMALL_RECT& have) { return Rect::Contains(have, rect); }));
+        }
+        for (auto a = region.begin(); a != region.end(); ++a)
+        {
+            for (auto b = a + 1; b != region.end(); ++b)
+            {
+                VERIFY_IS_FALSE(Rect::Overlaps(*a, *b));
+            }
+        }
+    }
+
+    TEST_METHOD(ClipsAndOffsets)
+    {
+        Region region;
+        region.Add({ 0, 0, 10, 1 });
+        region.Add({ 0, 5, 10, 6 });
+
+        region.Offset({ 2, 1 });
+        region.Clip({ 0, 0, 8, 8 });
+
+        VERIFY_ARE_EQUAL(2u, region.size());
+        const SMALL_RECT expected{ 2, 1, 8, 7 };
+        VERIFY_ARE_EQUAL(expected, region.GetBounds());
+
+        region.Clip({ 0, 2, 8, 8 });
+        VERIFY_ARE_EQUAL(1u, region.size());
+    }
+};
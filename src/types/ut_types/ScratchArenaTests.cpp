@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "..\..\inc\consoletaeftemplates.hpp"
+
+#include "..\inc\ScratchArena.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Console::Types;
+
+class ScratchArenaTests
+{
+    TEST_CLASS(ScratchArenaTests);
+
+    TEST_METHOD(ReusesItsBlockOnceEverythingIsFreed)
+    {
+        ScratchArena arena;
+
+        const wchar_t* first;
+        {
+            std::pmr::wstring text(100, L'a', &arena);
+            std::pmr::vector<WORD> attributes(100, WORD{ 7 }, &arena);
+            first = text.data();
+            VERIFY_IS_TRUE(reinterpret_cast<const void*>(attributes.data()) > reinterpret_cast<const void*>(first));
+        }
+
+        std::pmr::wstring again(100, L'b', &arena);
+        VERIFY_ARE_EQUAL(reinterpret_cast<const void*>(first), reinterpret_cast<const void*>(again.data()));
+    }
+
+    TEST_METHOD(GrowsToFitWhatSpilledOnReset)
+    {
+        ScratchArena arena;
+
+        const size_t big = 256 * 1024;
+        {
+            std::pmr::vector<char> header(16, 'h', &arena);
+            std::pmr::vector<char> spilled(big, 's', &arena);
+            const auto headerStart = reinterpret_cast<uintptr_t>(header.data());
+            const auto spilledStart = reinterpret_cast<uintptr_t>(spilled.data());
+            Log::Comment(L"What doesn't fit in the block comes from elsewhere.");
+            VERIFY_IS_TRUE(spilledStart < headerStart || spilledStart > headerStart + 64 * 1024);
+        }
+
+        arena.Reset();
+
+        Log::Comment(L"After the reset, the same allocations fit in the block, one after the other.");
+        std::pmr::vector<char> header(16, 'h', &arena);
+        std::pmr::vector<char> fits(big, 'f', &arena);
+        const auto headerStart = reinterpret_cast<uintptr_t>(header.data());
+        const auto fitsStart = reinterpret_cast<uintptr_t>(fits.data());
+        VERIFY_IS_TRUE(fitsStart > headerStart);
+        VERIFY_IS_TRUE(fitsStart - headerStart < 64);
+    }
+};
@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "..\..\inc\consoletaeftemplates.hpp"
+
+#include "..\inc\SharedRing.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Console::Types;
+
+class SharedRingTests
+{
+    TEST_CLASS(SharedRingTests);
+
+    TEST_METHOD(DataWrapsAroundTheEndOfTheRing)
+    {
+        std::unique_ptr<SharedRing> ring;
+        VERIFY_SUCCEEDED(SharedRing::s_Create(1, ring));
+
+        Log::Comment(L"The capacity is rounded up, so 4000 bytes fit without waiting.");
+        const std::string first(4000, 'a');
+        VERIFY_SUCCEEDED(ring->Write(first));
+
+        std::string read(4096, '\0');
+        VERIFY_ARE_EQUAL(4000u, ring->Read(read.data(), read.size()));
+        VERIFY_ARE_EQUAL(0u, ring->Read(read.data(), read.size()));
+
+        Log::Comment(L"The next write starts near the end, and has to wrap.");
+        const std::string second{ "0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz" };
+        VERIFY_SUCCEEDED(ring->Write(second));
+        const auto count = ring->Read(read.data(), read.size());
+        VERIFY_ARE_EQUAL(second.size(), count);
+        VERIFY_ARE_EQUAL(String(second.c_str()), String(read.substr(0, count).c_str()));
+    }
+
+    TEST_METHOD(WriterWaitsForRoomAndClosingStopsIt)
+    {
+        std::unique_ptr<SharedRing> ring;
+        VERIFY_SUCCEEDED(SharedRing::s_Create(4096, ring));
+
+        Log::Comment(L"A write bigger than the ring finishes once the reader drains it.");
+        const std::string big(10000, 'x');
+        std::thread writer([&]() { VERIFY_SUCCEEDED(ring->Write(big)); });
+
+        size_t total = 0;
+        std::string read(1000, '\0');
+        while (total < big.size())
+        {
+            const auto count = ring->Read(read.data(), read.size());
+            if (count == 0)
+            {
+                WaitForSingleObject(ring->GetDataEvent(), INFINITE);
+            }
+            total += count;
+        }
+        writer.join();
+        VERIFY_ARE_EQUAL(big.size(), total);
+
+        Log::Comment(L"Once the ring is closed, writes fail.");
+        ring->Close();
+        VERIFY_IS_TRUE(ring->IsClosed());
+        VERIFY_ARE_EQUAL(HRESULT_FROM_WIN32(ERROR_BROKEN_PIPE), ring->Write("hello"));
+    }
+};
@@ -0,0 +1,65 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "..\..\inc\consoletaeftemplates.hpp"
+
+#include "..\inc\Utf8Decoder.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Console::Types;
+
+class Utf8DecoderTests
+{
+    TEST_CLASS(Utf8DecoderTests);
+
+    TEST_METHOD(DecodesSequencesSplitAcrossChunks)
+    {
+        Utf8Decoder decoder;
+
+        // U+6F22 (3 bytes) then U+1F600 (4 bytes), cut after every byte.
+        const std::string utf8{ "a\xE6\xBC\xA2\xF0\x9F\x98\x80z" };
+        std::wstring decoded;
+        for (const auto ch : utf8)
+        {
+            decoded.append(decoder.Decode(std::string_view{ &ch, 1 }));
+        }
+        VERIFY_ARE_EQUAL(String(L"a\x6F22\xD83D\xDE00z"), String(decoded.c_str()));
+    }
+
+    TEST_METHOD(BrokenSequencesBecomeReplacementCharacters)
+    {
+        Utf8Decoder decoder;
+
+        Log::Comment(L"A sequence that's interrupted by another character is invalid.");
+        VERIFY_ARE_EQUAL(0u, decoder.Decode("\xE6\xBC").size());
+        const auto decoded = decoder.Decode("x");
+        VERIFY_ARE_EQUAL(String(L"\xFFFDx"), String(std::wstring{ decoded }.c_str()));
+
+        Log::Comment(L"Reset forgets a partial sequence.");
+        VERIFY_ARE_EQUAL(0u, decoder.Decode("\xF0\x9F").size());
+        decoder.Reset();
+        VERIFY_ARE_EQUAL(String(L"y"), String(std::wstring{ decoder.Decode("y") }.c_str()));
+    }
+
+    TEST_METHOD(MeasuresCodepoints)
+    {
+        VERIFY_ARE_EQUAL(1u, Utf8Decoder::CodepointLength("a\xE6"));
+        VERIFY_ARE_EQUAL(3u, Utf8Decoder::CodepointLength("\xE6\xBC\xA2z"));
+        VERIFY_ARE_EQUAL(4u, Utf8Decoder::CodepointLength("\xF0\x9F\x98\x80"));
+
+        Log::Comment(L"A codepoint that's cut off at the end is 0 bytes long, for now.");
+        VERIFY_ARE_EQUAL(0u, Utf8Decoder::CodepointLength("\xF0\x9F\x98"));
+
+        Log::Comment(L"One that's cut off by anything else ends where it was cut off.");
+        VERIFY_ARE_EQUAL(2u, Utf8Decoder::CodepointLength("\xF0\x9Fx"));
+
+        Log::Comment(L"Bytes that can't start a codepoint are one byte long.");
+        VERIFY_ARE_EQUAL(1u, Utf8Decoder::CodepointLength("\xC0\x80"));
+        VERIFY_ARE_EQUAL(1u, Utf8Decoder::CodepointLength("\xBC"));
+    }
+};